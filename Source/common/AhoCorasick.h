@@ -0,0 +1,144 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_AHOCORASICK_H
+#define SANTA_COMMON_AHOCORASICK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace santa {
+
+/// An Aho-Corasick automaton answering whether a byte string contains any of a
+/// fixed set of patterns, in a single pass over the input.
+///
+/// Each node of the pattern trie keeps its outgoing edges sorted by byte, plus
+/// a failure link to the node for its longest proper suffix that is also in
+/// the trie. Matching follows edges where it can and failure links where it
+/// can't, so the work is linear in the length of the input regardless of how
+/// many patterns there are.
+///
+/// The automaton is immutable once built and safe to use from multiple
+/// threads.
+class AhoCorasick {
+ public:
+  /// Empty patterns are ignored, rather than matching everything.
+  explicit AhoCorasick(const std::vector<std::string>& patterns) {
+    nodes_.emplace_back();
+    for (const std::string& pattern : patterns) {
+      if (pattern.empty()) {
+        continue;
+      }
+      uint32_t node = 0;
+      for (unsigned char c : pattern) {
+        uint32_t next = Edge(node, c);
+        if (next == kNil) {
+          next = static_cast<uint32_t>(nodes_.size());
+          auto& edges = nodes_[node].edges;
+          edges.insert(std::lower_bound(edges.begin(), edges.end(), std::make_pair(c, 0u)),
+                       {c, next});
+          nodes_.emplace_back();
+        }
+        node = next;
+      }
+      nodes_[node].terminal = true;
+      num_patterns_++;
+    }
+    BuildFailureLinks();
+  }
+
+  AhoCorasick(const AhoCorasick&) = delete;
+  AhoCorasick& operator=(const AhoCorasick&) = delete;
+  AhoCorasick(AhoCorasick&&) = default;
+  AhoCorasick& operator=(AhoCorasick&&) = default;
+
+  /// Returns true if any pattern occurs in text.
+  bool ContainsAny(std::string_view text) const {
+    if (num_patterns_ == 0) {
+      return false;
+    }
+    uint32_t node = 0;
+    for (unsigned char c : text) {
+      node = Step(node, c);
+      if (nodes_[node].terminal) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t NumPatterns() const { return num_patterns_; }
+
+ private:
+  static constexpr uint32_t kNil = UINT32_MAX;
+
+  struct Node {
+    std::vector<std::pair<unsigned char, uint32_t>> edges;
+    uint32_t fail = 0;
+    // Set if a pattern ends here, or at any node on this node's failure chain.
+    bool terminal = false;
+  };
+
+  uint32_t Edge(uint32_t node, unsigned char c) const {
+    const auto& edges = nodes_[node].edges;
+    auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(c, 0u));
+    return (it != edges.end() && it->first == c) ? it->second : kNil;
+  }
+
+  uint32_t Step(uint32_t node, unsigned char c) const {
+    while (true) {
+      uint32_t next = Edge(node, c);
+      if (next != kNil) {
+        return next;
+      }
+      if (node == 0) {
+        return 0;
+      }
+      node = nodes_[node].fail;
+    }
+  }
+
+  // Breadth first, so a node's failure target is always shallower and already
+  // has its own link.
+  void BuildFailureLinks() {
+    std::deque<uint32_t> queue;
+    for (const auto& [c, child] : nodes_[0].edges) {
+      nodes_[child].fail = 0;
+      queue.push_back(child);
+    }
+    while (!queue.empty()) {
+      uint32_t node = queue.front();
+      queue.pop_front();
+      for (const auto& [c, child] : nodes_[node].edges) {
+        uint32_t fail = Step(nodes_[node].fail, c);
+        nodes_[child].fail = fail;
+        nodes_[child].terminal = nodes_[child].terminal || nodes_[fail].terminal;
+        queue.push_back(child);
+      }
+    }
+  }
+
+  std::vector<Node> nodes_;
+  size_t num_patterns_ = 0;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_AHOCORASICK_H
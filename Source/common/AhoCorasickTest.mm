@@ -0,0 +1,97 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/AhoCorasick.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using santa::AhoCorasick;
+
+@interface AhoCorasickTest : XCTestCase
+@end
+
+@implementation AhoCorasickTest
+
+- (void)testEmpty {
+  AhoCorasick none({});
+  XCTAssertEqual(none.NumPatterns(), 0);
+  XCTAssertFalse(none.ContainsAny("anything"));
+
+  // Empty patterns don't match everything
+  AhoCorasick empty({""});
+  XCTAssertEqual(empty.NumPatterns(), 0);
+  XCTAssertFalse(empty.ContainsAny("anything"));
+  XCTAssertFalse(empty.ContainsAny(""));
+}
+
+- (void)testMatches {
+  AhoCorasick ac({"he", "she", "his", "hers"});
+  XCTAssertEqual(ac.NumPatterns(), 4);
+
+  XCTAssertTrue(ac.ContainsAny("ushers"));
+  XCTAssertTrue(ac.ContainsAny("his"));
+  XCTAssertTrue(ac.ContainsAny("ahishers"));
+  XCTAssertFalse(ac.ContainsAny("hi"));
+  XCTAssertFalse(ac.ContainsAny("s h e"));
+  XCTAssertFalse(ac.ContainsAny(""));
+}
+
+- (void)testSuffixReachedThroughFailureLink {
+  // "bcd" is only found by falling back from the "abc" branch
+  AhoCorasick ac({"abce", "bcd"});
+  XCTAssertTrue(ac.ContainsAny("xabcd"));
+  XCTAssertFalse(ac.ContainsAny("xabcx"));
+}
+
+- (void)testBinaryBytes {
+  std::string pattern("\x00\xff\x7f", 3);
+  AhoCorasick ac({pattern});
+  XCTAssertTrue(ac.ContainsAny(std::string("\x01\x00\xff\x7f\x02", 5)));
+  XCTAssertFalse(ac.ContainsAny(std::string("\x00\xff\x00\x7f", 4)));
+}
+
+- (void)testMatchesNaiveSearch {
+  std::mt19937 rng(1);
+  auto random_string = [&rng](size_t max_len) {
+    std::string s(1 + rng() % max_len, '\0');
+    for (char& c : s) {
+      c = "abc"[rng() % 3];
+    }
+    return s;
+  };
+
+  for (int round = 0; round < 200; round++) {
+    std::vector<std::string> patterns;
+    for (int i = 0; i < 1 + static_cast<int>(rng() % 6); i++) {
+      patterns.push_back(random_string(5));
+    }
+    AhoCorasick ac(patterns);
+
+    for (int i = 0; i < 20; i++) {
+      std::string text = random_string(30);
+      bool want = false;
+      for (const std::string& pattern : patterns) {
+        want = want || text.find(pattern) != std::string::npos;
+      }
+      XCTAssertEqual(ac.ContainsAny(text), want);
+    }
+  }
+}
+
+@end
@@ -0,0 +1,122 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_BLOOMFILTER_H
+#define SANTA_COMMON_BLOOMFILTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace santa {
+
+// A fixed size bloom filter over pre-computed 64-bit hashes.
+//
+// Add and MayContain may be called concurrently. A hash is guaranteed to be
+// visible to MayContain calls that begin after the Add call returns. Entries
+// cannot be removed; callers rebuild the filter when too many stale entries
+// have accumulated or when Count() exceeds Capacity().
+class BloomFilter {
+ public:
+  BloomFilter(size_t capacity, double false_positive_rate)
+      : capacity_(std::max<size_t>(capacity, 1)) {
+    // Optimal bit count m = -n * ln(p) / ln(2)^2 and probe count
+    // k = m / n * ln(2).
+    double ln2 = std::log(2.0);
+    double bits = -static_cast<double>(capacity_) *
+                  std::log(false_positive_rate) / (ln2 * ln2);
+    num_words_ =
+        std::max<size_t>(static_cast<size_t>(std::ceil(bits / 64.0)), 16);
+    num_bits_ = num_words_ * 64;
+    double probes =
+        std::round(static_cast<double>(num_bits_) / capacity_ * ln2);
+    num_probes_ = static_cast<uint32_t>(std::clamp<double>(probes, 1, 16));
+    words_ = std::make_unique<std::atomic<uint64_t>[]>(num_words_);
+  }
+
+  BloomFilter(const BloomFilter&) = delete;
+  BloomFilter& operator=(const BloomFilter&) = delete;
+
+  void Add(uint64_t hash) {
+    uint64_t h1 = hash;
+    uint64_t h2 = Rehash(hash);
+    for (uint32_t i = 0; i < num_probes_; ++i) {
+      uint64_t bit = Reduce(h1 + i * h2);
+      words_[bit >> 6].fetch_or(1ULL << (bit & 63), std::memory_order_release);
+    }
+    count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  bool MayContain(uint64_t hash) const {
+    uint64_t h1 = hash;
+    uint64_t h2 = Rehash(hash);
+    for (uint32_t i = 0; i < num_probes_; ++i) {
+      uint64_t bit = Reduce(h1 + i * h2);
+      uint64_t word = words_[bit >> 6].load(std::memory_order_acquire);
+      if (!(word & (1ULL << (bit & 63)))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Number of Add calls, including duplicates.
+  size_t Count() const { return count_.load(std::memory_order_relaxed); }
+
+  size_t Capacity() const { return capacity_; }
+
+  size_t SizeBytes() const { return num_words_ * sizeof(uint64_t); }
+
+  // Estimates the false positive rate from the fraction of bits set. This is
+  // accurate regardless of duplicate or stale entries, at the cost of a scan
+  // over the filter, and so is meant for periodic reporting only.
+  double EstimatedFalsePositiveRate() const {
+    uint64_t set_bits = 0;
+    for (size_t i = 0; i < num_words_; ++i) {
+      set_bits += std::popcount(words_[i].load(std::memory_order_relaxed));
+    }
+    return std::pow(static_cast<double>(set_bits) / num_bits_, num_probes_);
+  }
+
+ private:
+  // Derives the second hash for double hashing. Forced odd so that successive
+  // probes always differ.
+  static uint64_t Rehash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash | 1;
+  }
+
+  // Maps a 64-bit value uniformly onto [0, num_bits_) without a division.
+  uint64_t Reduce(uint64_t hash) const {
+    return static_cast<uint64_t>(
+        (static_cast<__uint128_t>(hash) * num_bits_) >> 64);
+  }
+
+  size_t capacity_;
+  size_t num_words_;
+  size_t num_bits_;
+  uint32_t num_probes_;
+  std::unique_ptr<std::atomic<uint64_t>[]> words_;
+  std::atomic<size_t> count_{0};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_BLOOMFILTER_H
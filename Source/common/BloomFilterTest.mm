@@ -0,0 +1,67 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/BloomFilter.h"
+
+#import <XCTest/XCTest.h>
+
+#include <random>
+
+using santa::BloomFilter;
+
+@interface BloomFilterTest : XCTestCase
+@end
+
+@implementation BloomFilterTest
+
+- (void)testNoFalseNegatives {
+  BloomFilter filter(10000, 0.01);
+  std::mt19937_64 gen(1);
+  for (int i = 0; i < 10000; ++i) {
+    filter.Add(gen());
+  }
+
+  std::mt19937_64 replay(1);
+  for (int i = 0; i < 10000; ++i) {
+    XCTAssertTrue(filter.MayContain(replay()));
+  }
+  XCTAssertEqual(filter.Count(), 10000);
+}
+
+- (void)testFalsePositiveRateNearTarget {
+  BloomFilter filter(10000, 0.01);
+  std::mt19937_64 gen(2);
+  for (int i = 0; i < 10000; ++i) {
+    filter.Add(gen());
+  }
+
+  int falsePositives = 0;
+  for (int i = 0; i < 100000; ++i) {
+    falsePositives += filter.MayContain(gen());
+  }
+
+  XCTAssertLessThan(falsePositives / 100000.0, 0.02);
+  XCTAssertLessThan(filter.EstimatedFalsePositiveRate(), 0.02);
+  XCTAssertGreaterThan(filter.EstimatedFalsePositiveRate(), 0.0);
+}
+
+- (void)testEmptyFilter {
+  BloomFilter filter(100, 0.01);
+  XCTAssertFalse(filter.MayContain(0));
+  XCTAssertFalse(filter.MayContain(0xDEADBEEF));
+  XCTAssertEqual(filter.EstimatedFalsePositiveRate(), 0.0);
+  XCTAssertGreaterThan(filter.SizeBytes(), 0);
+}
+
+@end
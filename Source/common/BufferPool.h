@@ -0,0 +1,137 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_BUFFERPOOL_H
+#define SANTA_COMMON_BUFFERPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace santa {
+
+// A fixed size pool of byte vectors, used to recycle the storage of buffers
+// that are handed from one component to another (e.g. serialized telemetry
+// flowing from a serializer to a writer) instead of freeing and reallocating
+// it for every message.
+//
+// Buffers are plain std::vector<uint8_t>s so they can be moved through
+// existing interfaces unchanged. Only their capacity is retained; contents are
+// always cleared on release.
+//
+// Acquire and Release are lock-free and may be called from any thread. Each
+// slot holds at most one buffer, so the pool never retains more than
+// num_slots buffers. When the pool is empty Acquire allocates a new buffer,
+// and when it is full Release frees the buffer.
+class BufferPool {
+ public:
+  BufferPool(size_t num_slots, size_t max_retained_capacity)
+      : num_slots_(num_slots > 0 ? num_slots : 1),
+        max_retained_capacity_(max_retained_capacity),
+        slots_(std::make_unique<Slot[]>(num_slots_)) {}
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  // The pool shared by the telemetry serializers and writers.
+  static BufferPool& Shared() {
+    static BufferPool* pool = new BufferPool(64, 256 * 1024);
+    return *pool;
+  }
+
+  // Returns an empty buffer with at least min_capacity bytes of capacity.
+  std::vector<uint8_t> Acquire(size_t min_capacity = 0) {
+    size_t start = NextSlot();
+    for (size_t i = 0; i < num_slots_; ++i) {
+      Slot& slot = slots_[(start + i) % num_slots_];
+      uint8_t expected = kFull;
+      if (slot.state.load(std::memory_order_relaxed) != kFull ||
+          !slot.state.compare_exchange_strong(expected, kBusy,
+                                              std::memory_order_acquire)) {
+        continue;
+      }
+      std::vector<uint8_t> buf = std::move(slot.buf);
+      slot.state.store(kEmpty, std::memory_order_release);
+      buf.reserve(min_capacity);
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return buf;
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    std::vector<uint8_t> buf;
+    buf.reserve(min_capacity);
+    return buf;
+  }
+
+  // Returns a buffer's storage to the pool. Buffers without storage, or with
+  // more than max_retained_capacity bytes of it, are freed instead so a single
+  // large message doesn't pin memory.
+  void Release(std::vector<uint8_t>&& buf) {
+    std::vector<uint8_t> owned = std::move(buf);
+    if (owned.capacity() == 0 || owned.capacity() > max_retained_capacity_) {
+      return;
+    }
+    owned.clear();
+
+    size_t start = NextSlot();
+    for (size_t i = 0; i < num_slots_; ++i) {
+      Slot& slot = slots_[(start + i) % num_slots_];
+      uint8_t expected = kEmpty;
+      if (slot.state.load(std::memory_order_relaxed) != kEmpty ||
+          !slot.state.compare_exchange_strong(expected, kBusy,
+                                              std::memory_order_acquire)) {
+        continue;
+      }
+      slot.buf = std::move(owned);
+      slot.state.store(kFull, std::memory_order_release);
+      return;
+    }
+  }
+
+  // Number of Acquire calls satisfied from, and not from, the pool.
+  uint64_t Hits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t Misses() const { return misses_.load(std::memory_order_relaxed); }
+
+ private:
+  static constexpr uint8_t kEmpty = 0;
+  static constexpr uint8_t kBusy = 1;
+  static constexpr uint8_t kFull = 2;
+
+  // Slots are cache line aligned so that threads working on neighbouring
+  // slots don't contend.
+  struct alignas(64) Slot {
+    std::atomic<uint8_t> state{kEmpty};
+    std::vector<uint8_t> buf;
+  };
+
+  // Spreads concurrent callers across the slots so they rarely race for the
+  // same one.
+  size_t NextSlot() {
+    return next_.fetch_add(1, std::memory_order_relaxed) % num_slots_;
+  }
+
+  const size_t num_slots_;
+  const size_t max_retained_capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<size_t> next_{0};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_BUFFERPOOL_H
@@ -0,0 +1,100 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/BufferPool.h"
+
+#import <XCTest/XCTest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using santa::BufferPool;
+
+@interface BufferPoolTest : XCTestCase
+@end
+
+@implementation BufferPoolTest
+
+- (void)testReleasedStorageIsReused {
+  BufferPool pool(4, 1024);
+
+  std::vector<uint8_t> buf = pool.Acquire(100);
+  XCTAssertGreaterThanOrEqual(buf.capacity(), 100);
+  XCTAssertEqual(pool.Misses(), 1);
+  buf.assign(100, 0xAB);
+  const uint8_t* storage = buf.data();
+  pool.Release(std::move(buf));
+
+  std::vector<uint8_t> reused = pool.Acquire(50);
+  XCTAssertEqual(pool.Hits(), 1);
+  XCTAssertEqual(reused.data(), storage);
+  XCTAssertTrue(reused.empty());
+}
+
+- (void)testAcquireGrowsReusedBuffer {
+  BufferPool pool(1, 4096);
+  pool.Release(pool.Acquire(16));
+
+  std::vector<uint8_t> buf = pool.Acquire(2048);
+  XCTAssertEqual(pool.Hits(), 1);
+  XCTAssertGreaterThanOrEqual(buf.capacity(), 2048);
+}
+
+- (void)testOversizedAndEmptyBuffersAreNotRetained {
+  BufferPool pool(4, 1024);
+  pool.Release(std::vector<uint8_t>());
+  pool.Release(pool.Acquire(4096));
+
+  (void)pool.Acquire();
+  XCTAssertEqual(pool.Hits(), 0);
+}
+
+- (void)testFullPoolFreesBuffers {
+  BufferPool pool(2, 1024);
+  for (int i = 0; i < 4; ++i) {
+    pool.Release(std::vector<uint8_t>(10));
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    (void)pool.Acquire();
+  }
+  XCTAssertEqual(pool.Hits(), 2);
+  XCTAssertEqual(pool.Misses(), 2);
+}
+
+- (void)testConcurrentUse {
+  BufferPool pool(8, 1 << 20);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&pool, t] {
+      for (int i = 0; i < 10000; ++i) {
+        std::vector<uint8_t> buf = pool.Acquire(64);
+        buf.assign(64, static_cast<uint8_t>(t));
+        for (uint8_t b : buf) {
+          if (b != static_cast<uint8_t>(t)) abort();
+        }
+        pool.Release(std::move(buf));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  XCTAssertEqual(pool.Hits() + pool.Misses(), 80000);
+  XCTAssertGreaterThan(pool.Hits(), 0);
+}
+
+@end
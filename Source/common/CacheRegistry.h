@@ -0,0 +1,119 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_CACHEREGISTRY_H
+#define SANTA_COMMON_CACHEREGISTRY_H
+
+#import <Foundation/Foundation.h>
+#include <dispatch/dispatch.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#import "Source/common/SNTMetricSet.h"
+#include "Source/common/SantaCacheStats.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Sizes registered caches according to system memory pressure and exports
+// their sizes as metrics.
+//
+// Each cache is registered with the size it was created with as its base
+// size. Under memory pressure caches are shrunk to a fraction of their base
+// size, evicting entries as needed, and they return to their base size once
+// pressure subsides. On hosts with a lot of physical memory, e.g. build
+// machines, caches grow beyond their base size while there is no pressure.
+class CacheRegistry {
+ public:
+  enum class MemoryPressure {
+    kNormal,
+    kWarning,
+    kCritical,
+  };
+
+  // Hosts with at least this much memory double their cache sizes.
+  static constexpr uint64_t kLargeMemoryBytes = 32ull << 30;
+  // Caches are never shrunk below this many entries, unless their base size
+  // is smaller.
+  static constexpr uint64_t kMinCacheSize = 64;
+
+  // The registry used by santad.
+  static CacheRegistry& Shared();
+
+  explicit CacheRegistry(uint64_t physical_memory_bytes);
+  ~CacheRegistry();
+
+  CacheRegistry(const CacheRegistry&) = delete;
+  CacheRegistry& operator=(const CacheRegistry&) = delete;
+
+  // Track a cache. The base size is read from usage_fn, which is also called
+  // each time metrics are exported. resize_fn is called with the new maximum
+  // number of entries whenever memory pressure changes, and immediately if
+  // the cache should not be at its base size. Either may return
+  // std::nullopt / false once the cache no longer exists, in which case it is
+  // no longer tracked.
+  void Register(NSString* name, std::function<std::optional<SantaCacheUsage>()> usage_fn,
+                std::function<bool(uint64_t)> resize_fn);
+
+  // Begin resizing caches in response to system memory pressure events.
+  void StartMonitoring();
+
+  // Resize every registered cache for the given pressure level.
+  void HandleMemoryPressure(MemoryPressure pressure);
+
+  // The size a cache with the given base size should have at the current
+  // memory pressure.
+  uint64_t SizeFor(uint64_t base_size);
+
+  // Approximate bytes used by all registered caches.
+  uint64_t TotalBytes();
+
+  // Export the /santa/cache/entries, /santa/cache/max_entries,
+  // /santa/cache/bytes and /santa/cache/hit_ratio gauges, using the
+  // registered name as the "Cache" field value. The hit ratio covers lookups
+  // since the previous export. With kSantaCacheInstrumentation,
+  // /santa/cache/buckets also counts each cache's buckets by length.
+  void RegisterMetrics(SNTMetricSet* metric_set);
+
+ private:
+  struct Entry {
+    NSString* name;
+    uint64_t base_size;
+    std::function<std::optional<SantaCacheUsage>()> usage_fn;
+    std::function<bool(uint64_t)> resize_fn;
+    SantaCacheStats last_stats;
+  };
+
+  static uint64_t SizeFor(uint64_t base_size, MemoryPressure pressure, uint64_t growth);
+
+  // Removes a cache that no longer exists.
+  void Forget(const std::shared_ptr<Entry>& entry);
+  std::vector<std::shared_ptr<Entry>> Entries();
+
+  const uint64_t growth_;
+  dispatch_source_t pressure_source_ = nullptr;
+
+  absl::Mutex mtx_;
+  MemoryPressure pressure_ ABSL_GUARDED_BY(mtx_) = MemoryPressure::kNormal;
+  std::vector<std::shared_ptr<Entry>> entries_ ABSL_GUARDED_BY(mtx_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_CACHEREGISTRY_H
@@ -0,0 +1,231 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/CacheRegistry.h"
+
+#include <algorithm>
+#include <utility>
+
+#import "Source/common/SNTLogging.h"
+
+namespace santa {
+
+namespace {
+
+NSString* PressureName(CacheRegistry::MemoryPressure pressure) {
+  switch (pressure) {
+    case CacheRegistry::MemoryPressure::kNormal: return @"normal";
+    case CacheRegistry::MemoryPressure::kWarning: return @"warning";
+    case CacheRegistry::MemoryPressure::kCritical: return @"critical";
+  }
+}
+
+}  // namespace
+
+CacheRegistry& CacheRegistry::Shared() {
+  static CacheRegistry* registry = new CacheRegistry([NSProcessInfo processInfo].physicalMemory);
+  return *registry;
+}
+
+CacheRegistry::CacheRegistry(uint64_t physical_memory_bytes)
+    : growth_(physical_memory_bytes >= kLargeMemoryBytes ? 2 : 1) {}
+
+CacheRegistry::~CacheRegistry() {
+  if (pressure_source_) {
+    dispatch_source_cancel(pressure_source_);
+  }
+}
+
+uint64_t CacheRegistry::SizeFor(uint64_t base_size, MemoryPressure pressure, uint64_t growth) {
+  switch (pressure) {
+    case MemoryPressure::kNormal: return base_size * growth;
+    case MemoryPressure::kWarning:
+      return std::max(base_size / 2, std::min(base_size, kMinCacheSize));
+    case MemoryPressure::kCritical:
+      return std::max(base_size / 8, std::min(base_size, kMinCacheSize));
+  }
+}
+
+uint64_t CacheRegistry::SizeFor(uint64_t base_size) {
+  absl::MutexLock lock(mtx_);
+  return SizeFor(base_size, pressure_, growth_);
+}
+
+void CacheRegistry::Register(NSString* name,
+                             std::function<std::optional<SantaCacheUsage>()> usage_fn,
+                             std::function<bool(uint64_t)> resize_fn) {
+  std::optional<SantaCacheUsage> usage = usage_fn();
+  if (!usage.has_value()) {
+    return;
+  }
+
+  auto entry = std::make_shared<Entry>(Entry{
+      .name = [name copy],
+      .base_size = usage->max_entries,
+      .usage_fn = std::move(usage_fn),
+      .resize_fn = std::move(resize_fn),
+      .last_stats = usage->stats,
+  });
+
+  uint64_t size;
+  {
+    absl::MutexLock lock(mtx_);
+    entries_.push_back(entry);
+    size = SizeFor(entry->base_size, pressure_, growth_);
+  }
+
+  if (size != entry->base_size && !entry->resize_fn(size)) {
+    Forget(entry);
+  }
+}
+
+void CacheRegistry::Forget(const std::shared_ptr<Entry>& entry) {
+  absl::MutexLock lock(mtx_);
+  std::erase(entries_, entry);
+}
+
+std::vector<std::shared_ptr<CacheRegistry::Entry>> CacheRegistry::Entries() {
+  absl::MutexLock lock(mtx_);
+  return entries_;
+}
+
+uint64_t CacheRegistry::TotalBytes() {
+  uint64_t bytes = 0;
+  for (const auto& entry : Entries()) {
+    std::optional<SantaCacheUsage> usage = entry->usage_fn();
+    if (!usage.has_value()) {
+      Forget(entry);
+      continue;
+    }
+    bytes += usage->bytes;
+  }
+  return bytes;
+}
+
+void CacheRegistry::StartMonitoring() {
+  if (pressure_source_) {
+    return;
+  }
+
+  dispatch_queue_t queue = dispatch_queue_create_with_target(
+      "com.northpolesec.santa.cache_registry", DISPATCH_QUEUE_SERIAL,
+      dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+  dispatch_source_t source = dispatch_source_create(
+      DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+      DISPATCH_MEMORYPRESSURE_NORMAL | DISPATCH_MEMORYPRESSURE_WARN |
+          DISPATCH_MEMORYPRESSURE_CRITICAL,
+      queue);
+  if (!source) {
+    LOGW(@"Unable to monitor memory pressure, cache sizes will not be adjusted");
+    return;
+  }
+
+  dispatch_source_set_event_handler(source, ^{
+    unsigned long level = dispatch_source_get_data(pressure_source_);
+    if (level & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+      HandleMemoryPressure(MemoryPressure::kCritical);
+    } else if (level & DISPATCH_MEMORYPRESSURE_WARN) {
+      HandleMemoryPressure(MemoryPressure::kWarning);
+    } else {
+      HandleMemoryPressure(MemoryPressure::kNormal);
+    }
+  });
+
+  pressure_source_ = source;
+  dispatch_resume(pressure_source_);
+
+  // Caches registered so far were created at their base size.
+  HandleMemoryPressure(MemoryPressure::kNormal);
+}
+
+void CacheRegistry::HandleMemoryPressure(MemoryPressure pressure) {
+  std::vector<std::shared_ptr<Entry>> entries;
+  {
+    absl::MutexLock lock(mtx_);
+    if (pressure != pressure_) {
+      LOGI(@"Memory pressure is %@, resizing caches", PressureName(pressure));
+    }
+    pressure_ = pressure;
+    entries = entries_;
+  }
+
+  for (const auto& entry : entries) {
+    if (!entry->resize_fn(SizeFor(entry->base_size, pressure, growth_))) {
+      Forget(entry);
+    }
+  }
+}
+
+void CacheRegistry::RegisterMetrics(SNTMetricSet* metric_set) {
+  SNTMetricInt64Gauge* entries_gauge =
+      [metric_set int64GaugeWithName:@"/santa/cache/entries"
+                          fieldNames:@[ @"Cache" ]
+                            helpText:@"Number of entries in the cache"];
+  SNTMetricInt64Gauge* max_entries_gauge =
+      [metric_set int64GaugeWithName:@"/santa/cache/max_entries"
+                          fieldNames:@[ @"Cache" ]
+                            helpText:@"Maximum number of entries the cache currently holds"];
+  SNTMetricInt64Gauge* bytes_gauge =
+      [metric_set int64GaugeWithName:@"/santa/cache/bytes"
+                          fieldNames:@[ @"Cache" ]
+                            helpText:@"Approximate bytes used by the cache"];
+  SNTMetricDoubleGauge* hit_ratio_gauge =
+      [metric_set doubleGaugeWithName:@"/santa/cache/hit_ratio"
+                           fieldNames:@[ @"Cache" ]
+                             helpText:@"Fraction of cache lookups that hit since the last export"];
+
+  SNTMetricInt64Gauge* bucket_length_gauge = nil;
+  if (kSantaCacheInstrumentation) {
+    bucket_length_gauge =
+        [metric_set int64GaugeWithName:@"/santa/cache/buckets"
+                            fieldNames:@[ @"Cache", @"Length" ]
+                              helpText:@"Number of cache buckets holding the given number of "
+                                       @"entries"];
+  }
+
+  [metric_set registerCallback:^{
+    // Metric callbacks run one at a time, so last_stats needs no locking.
+    for (const auto& entry : Entries()) {
+      std::optional<SantaCacheUsage> usage = entry->usage_fn();
+      if (!usage.has_value()) {
+        Forget(entry);
+        continue;
+      }
+
+      NSArray<NSString*>* fields = @[ entry->name ];
+      [entries_gauge set:(long long)usage->entries forFieldValues:fields];
+      [max_entries_gauge set:(long long)usage->max_entries forFieldValues:fields];
+      [bytes_gauge set:(long long)usage->bytes forFieldValues:fields];
+
+      uint64_t hits = usage->stats.hits - entry->last_stats.hits;
+      uint64_t lookups = hits + usage->stats.misses - entry->last_stats.misses;
+      if (lookups > 0) {
+        [hit_ratio_gauge set:(double)hits / (double)lookups forFieldValues:fields];
+      }
+      entry->last_stats = usage->stats;
+
+      if (kSantaCacheInstrumentation) {
+        for (size_t i = 0; i < kSantaCacheBucketLengths; i++) {
+          // The last length counts all longer buckets too.
+          NSString* length = [NSString
+              stringWithFormat:(i + 1 < kSantaCacheBucketLengths ? @"%zu" : @"%zu+"), i];
+          [bucket_length_gauge set:(long long)usage->bucket_lengths[i]
+                    forFieldValues:@[ entry->name, length ]];
+        }
+      }
+    }
+  }];
+}
+
+}  // namespace santa
@@ -0,0 +1,171 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/CacheRegistry.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <optional>
+
+#import "Source/common/SNTMetricSet.h"
+#include "Source/common/SantaCache.h"
+#include "Source/common/SantaSeqlockCache.h"
+
+using santa::CacheRegistry;
+
+using TestCache = SantaCache<uint64_t, uint64_t>;
+
+static void RegisterCache(CacheRegistry& registry, NSString* name,
+                          const std::shared_ptr<TestCache>& cache) {
+  std::weak_ptr<TestCache> weakCache = cache;
+  registry.Register(
+      name,
+      [weakCache]() -> std::optional<SantaCacheUsage> {
+        auto c = weakCache.lock();
+        if (!c) return std::nullopt;
+        return c->usage();
+      },
+      [weakCache](uint64_t maxSize) {
+        auto c = weakCache.lock();
+        if (!c) return false;
+        c->set_max_size(maxSize);
+        return true;
+      });
+}
+
+@interface CacheRegistryTest : XCTestCase
+@end
+
+@implementation CacheRegistryTest
+
+- (void)testSizeFor {
+  CacheRegistry registry(8ull << 30);
+  XCTAssertEqual(registry.SizeFor(1000), 1000);
+
+  registry.HandleMemoryPressure(CacheRegistry::MemoryPressure::kWarning);
+  XCTAssertEqual(registry.SizeFor(1000), 500);
+  XCTAssertEqual(registry.SizeFor(100), CacheRegistry::kMinCacheSize);
+  XCTAssertEqual(registry.SizeFor(10), 10);
+
+  registry.HandleMemoryPressure(CacheRegistry::MemoryPressure::kCritical);
+  XCTAssertEqual(registry.SizeFor(1000), 125);
+
+  CacheRegistry largeRegistry(CacheRegistry::kLargeMemoryBytes);
+  XCTAssertEqual(largeRegistry.SizeFor(1000), 2000);
+  largeRegistry.HandleMemoryPressure(CacheRegistry::MemoryPressure::kWarning);
+  XCTAssertEqual(largeRegistry.SizeFor(1000), 500);
+}
+
+- (void)testPressureResizesCaches {
+  CacheRegistry registry(8ull << 30);
+  auto cache = std::make_shared<TestCache>(1000, 5, SantaCacheEvictionPolicy::kClock);
+  RegisterCache(registry, @"test", cache);
+  XCTAssertEqual(cache->max_size(), 1000);
+
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    cache->set(i, i);
+  }
+  XCTAssertEqual(cache->count(), 1000);
+
+  registry.HandleMemoryPressure(CacheRegistry::MemoryPressure::kCritical);
+  XCTAssertEqual(cache->max_size(), 125);
+  XCTAssertLessThanOrEqual(cache->count(), 125);
+  XCTAssertGreaterThan(cache->stats().evictions, 0);
+
+  registry.HandleMemoryPressure(CacheRegistry::MemoryPressure::kNormal);
+  XCTAssertEqual(cache->max_size(), 1000);
+
+  // Caches registered under pressure are shrunk right away.
+  registry.HandleMemoryPressure(CacheRegistry::MemoryPressure::kWarning);
+  auto lateCache = std::make_shared<TestCache>(1000);
+  RegisterCache(registry, @"late", lateCache);
+  XCTAssertEqual(lateCache->max_size(), 500);
+
+  // Caches that no longer exist are forgotten.
+  cache.reset();
+  registry.HandleMemoryPressure(CacheRegistry::MemoryPressure::kNormal);
+  XCTAssertEqual(lateCache->max_size(), 1000);
+}
+
+- (void)testLargeMemoryGrowsCaches {
+  CacheRegistry registry(CacheRegistry::kLargeMemoryBytes);
+  auto cache = std::make_shared<TestCache>(100);
+  RegisterCache(registry, @"test", cache);
+  XCTAssertEqual(cache->max_size(), 200);
+
+  for (uint64_t i = 1; i <= 200; ++i) {
+    cache->set(i, i);
+  }
+  XCTAssertEqual(cache->count(), 200);
+}
+
+- (void)testSeqlockCacheGrowthIsCapped {
+  SantaSeqlockCache<uint64_t, uint64_t> cache(64, 4);
+  cache.set_max_size(1000000);
+  XCTAssertEqual(cache.max_size(), 16 * SantaSeqlockCache<uint64_t, uint64_t>::kSlotsPerBucket);
+
+  for (uint64_t i = 1; i <= 64; ++i) {
+    cache.set(i, i);
+  }
+  cache.set_max_size(10);
+  XCTAssertEqual(cache.count(), 0);
+}
+
+- (void)testMetrics {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
+  CacheRegistry registry(8ull << 30);
+  auto cache = std::make_shared<TestCache>(100);
+  RegisterCache(registry, @"test", cache);
+  registry.RegisterMetrics(metricSet);
+
+  for (uint64_t i = 1; i <= 10; ++i) {
+    cache->set(i, i);
+  }
+  cache->get(1);
+  cache->get(2);
+  cache->get(3);
+  cache->get(11);
+
+  [metricSet export];
+
+  SNTMetricInt64Gauge* entries =
+      [metricSet int64GaugeWithName:@"/santa/cache/entries"
+                         fieldNames:@[ @"Cache" ]
+                           helpText:@"Number of entries in the cache"];
+  SNTMetricInt64Gauge* maxEntries =
+      [metricSet int64GaugeWithName:@"/santa/cache/max_entries"
+                         fieldNames:@[ @"Cache" ]
+                           helpText:@"Maximum number of entries the cache currently holds"];
+  SNTMetricInt64Gauge* bytes =
+      [metricSet int64GaugeWithName:@"/santa/cache/bytes"
+                         fieldNames:@[ @"Cache" ]
+                           helpText:@"Approximate bytes used by the cache"];
+  SNTMetricDoubleGauge* hitRatio =
+      [metricSet doubleGaugeWithName:@"/santa/cache/hit_ratio"
+                          fieldNames:@[ @"Cache" ]
+                            helpText:@"Fraction of cache lookups that hit since the last export"];
+
+  XCTAssertEqual([entries getGaugeValueForFieldValues:@[ @"test" ]], 10);
+  XCTAssertEqual([maxEntries getGaugeValueForFieldValues:@[ @"test" ]], 100);
+  XCTAssertGreaterThan([bytes getGaugeValueForFieldValues:@[ @"test" ]], 0);
+  XCTAssertEqualWithAccuracy([hitRatio getGaugeValueForFieldValues:@[ @"test" ]], 0.75, 0.001);
+
+  // Only lookups since the previous export count towards the ratio.
+  cache->get(12);
+  [metricSet export];
+  XCTAssertEqualWithAccuracy([hitRatio getGaugeValueForFieldValues:@[ @"test" ]], 0.0, 0.001);
+}
+
+@end
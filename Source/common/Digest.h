@@ -0,0 +1,98 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_DIGEST_H
+#define SANTA_COMMON_DIGEST_H
+
+#import <Foundation/Foundation.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "Source/common/String.h"
+
+namespace santa {
+
+// A fixed size binary digest, e.g. a SHA-256 or a CDHash.
+//
+// Digests compare and hash as a few machine words, without the allocation and
+// 40 or 64 character comparisons of their hex strings, making them suitable as
+// keys on the exec path. Convert to hex only where a string is needed, e.g. for
+// logging or sync.
+template <size_t N>
+class Digest {
+ public:
+  static constexpr size_t kSize = N;
+
+  Digest() = default;
+  explicit Digest(const std::array<uint8_t, N>& bytes) : bytes_(bytes) {}
+  explicit Digest(const uint8_t (&bytes)[N]) { std::copy(bytes, bytes + N, bytes_.begin()); }
+
+  // Parses the lowercase hex form Santa uses for all digests. Any other input,
+  // including uppercase hex, returns std::nullopt, so that a digest always
+  // converts back to the exact string it was parsed from.
+  static std::optional<Digest> FromHex(std::string_view hex) {
+    if (hex.size() != N * 2) {
+      return std::nullopt;
+    }
+    Digest digest;
+    for (size_t i = 0; i < N; i++) {
+      int hi = HexValue(hex[i * 2]);
+      int lo = HexValue(hex[i * 2 + 1]);
+      if (hi < 0 || lo < 0) {
+        return std::nullopt;
+      }
+      digest.bytes_[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return digest;
+  }
+
+  static std::optional<Digest> FromHex(NSString* hex) {
+    return FromHex(NSStringToUTF8StringView(hex));
+  }
+
+  std::string ToHex() const { return BufToHexString(bytes_.data(), N); }
+  NSString* ToNSString() const { return StringToNSString(ToHex()); }
+
+  const std::array<uint8_t, N>& Bytes() const { return bytes_; }
+
+  bool operator==(const Digest& rhs) const = default;
+
+  template <typename H>
+  friend H AbslHashValue(H h, const Digest& digest) {
+    return H::combine(std::move(h), digest.bytes_);
+  }
+
+ private:
+  static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+  }
+
+  std::array<uint8_t, N> bytes_ = {};
+};
+
+using SHA256Digest = Digest<32>;
+using CDHashDigest = Digest<20>;
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_DIGEST_H
@@ -0,0 +1,76 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/Digest.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "absl/container/flat_hash_set.h"
+
+using santa::CDHashDigest;
+using santa::SHA256Digest;
+
+static NSString* const kSHA256 = @"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b670";
+static NSString* const kCDHash = @"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670a";
+
+@interface DigestTest : XCTestCase
+@end
+
+@implementation DigestTest
+
+- (void)testHexRoundTrip {
+  std::optional<SHA256Digest> sha256 = SHA256Digest::FromHex(kSHA256);
+  XCTAssertTrue(sha256.has_value());
+  XCTAssertEqual(sha256->Bytes()[0], 0xb7);
+  XCTAssertEqual(sha256->Bytes()[31], 0x70);
+  XCTAssertEqualObjects(sha256->ToNSString(), kSHA256);
+
+  std::optional<CDHashDigest> cdhash = CDHashDigest::FromHex(kCDHash);
+  XCTAssertTrue(cdhash.has_value());
+  XCTAssertEqual(cdhash->ToHex(), std::string(kCDHash.UTF8String));
+
+  uint8_t raw[20];
+  for (size_t i = 0; i < sizeof(raw); i++) {
+    raw[i] = static_cast<uint8_t>(i);
+  }
+  XCTAssertEqual(CDHashDigest(raw).ToHex(), "000102030405060708090a0b0c0d0e0f10111213");
+}
+
+- (void)testOnlyCanonicalHexParses {
+  XCTAssertFalse(SHA256Digest::FromHex(nil).has_value());
+  XCTAssertFalse(SHA256Digest::FromHex(@"").has_value());
+  XCTAssertFalse(SHA256Digest::FromHex(kCDHash).has_value());
+  XCTAssertFalse(CDHashDigest::FromHex(kSHA256).has_value());
+  XCTAssertFalse(SHA256Digest::FromHex(kSHA256.uppercaseString).has_value());
+  XCTAssertFalse(CDHashDigest::FromHex(@"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670g").has_value());
+}
+
+- (void)testEqualityAndHashing {
+  SHA256Digest a = *SHA256Digest::FromHex(kSHA256);
+  SHA256Digest b = *SHA256Digest::FromHex(kSHA256);
+  SHA256Digest c;
+  XCTAssertTrue(a == b);
+  XCTAssertFalse(a == c);
+
+  absl::flat_hash_set<SHA256Digest> set = {a, c};
+  XCTAssertEqual(set.size(), 2);
+  XCTAssertTrue(set.contains(b));
+}
+
+@end
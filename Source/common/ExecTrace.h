@@ -0,0 +1,215 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_EXECTRACE_H
+#define SANTA_COMMON_EXECTRACE_H
+
+#include <os/signpost.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// The stages of authorizing an exec that are timed by an ExecTrace.
+enum class ExecTraceStage : uint8_t {
+  // From the ES message being created until santad started handling it
+  kQueueWait = 0,
+  kAuthResultCache,
+  kFileInfo,
+  kCodesign,
+  // Includes waiting for a hash started in the background
+  kHash,
+  kRuleLookup,
+  // The part of a rule lookup spent querying the rules database
+  kSQLite,
+  kCEL,
+  // The whole policy decision, including the stages it runs
+  kPolicy,
+  kNotificationQueue,
+};
+
+inline constexpr size_t kExecTraceStageCount =
+    static_cast<size_t>(ExecTraceStage::kNotificationQueue) + 1;
+
+std::string_view ExecTraceStageName(ExecTraceStage stage);
+
+// The time spent in each stage of authorizing a single exec.
+//
+// A trace is made current on the thread handling the exec with ScopedCurrent,
+// and code anywhere along the way marks its stage with a Span. Spans do
+// nothing when there is no current trace, so they can be left in place on the
+// hot path. Each span is also emitted as an os_signpost interval so traced
+// execs can be inspected in Instruments.
+//
+// Stages may be recorded from other threads, e.g. by a hash computed in the
+// background, so stage times and counters are atomic. A stage that runs more
+// than once has its times summed.
+class ExecTrace : public std::enable_shared_from_this<ExecTrace> {
+ public:
+  struct Summary {
+    uint64_t id;
+    pid_t pid;
+    std::string path;
+    std::string result;
+    struct timespec start_time;
+    struct timespec end_time;
+    uint64_t total_ns;
+    uint64_t hash_bytes_read;
+    std::array<uint64_t, kExecTraceStageCount> stage_ns;
+  };
+
+  ExecTrace(uint64_t id, pid_t pid, std::string path);
+
+  ExecTrace(const ExecTrace&) = delete;
+  ExecTrace& operator=(const ExecTrace&) = delete;
+
+  // The trace of the exec being handled on this thread, or nullptr.
+  static ExecTrace* Current();
+
+  // Makes a trace current on this thread for the lifetime of the scope.
+  class ScopedCurrent {
+   public:
+    explicit ScopedCurrent(ExecTrace* trace);
+    ~ScopedCurrent();
+
+    ScopedCurrent(const ScopedCurrent&) = delete;
+    ScopedCurrent& operator=(const ScopedCurrent&) = delete;
+
+   private:
+    ExecTrace* previous_;
+  };
+
+  // Times a stage of a trace, by default the current one, from construction
+  // until destruction.
+  class Span {
+   public:
+    explicit Span(ExecTraceStage stage) : Span(Current(), stage) {}
+    Span(ExecTrace* trace, ExecTraceStage stage);
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+   private:
+    ExecTrace* trace_;
+    ExecTraceStage stage_;
+    uint64_t start_mach_time_;
+  };
+
+  void AddStageTime(ExecTraceStage stage, uint64_t nanos);
+  void AddHashBytesRead(uint64_t bytes);
+
+  // Records how the exec was answered. Only called from the thread handling
+  // the exec.
+  void SetResult(std::string_view result) { result_ = result; }
+
+  os_signpost_id_t SignpostID() const { return signpost_id_; }
+
+  Summary Finish() const;
+
+ private:
+  uint64_t id_;
+  pid_t pid_;
+  std::string path_;
+  std::string result_;
+  uint64_t start_mach_time_;
+  struct timespec start_time_;
+  os_signpost_id_t signpost_id_;
+  std::array<std::atomic<uint64_t>, kExecTraceStageCount> stage_ns_ = {};
+  std::atomic<uint64_t> hash_bytes_read_ = 0;
+};
+
+struct ExecTraceConfig {
+  // Only trace execs by this pid
+  std::optional<pid_t> pid;
+  // Only trace execs of paths starting with this prefix, if set
+  std::string path_prefix;
+  // Trace 1 in every N of the execs that match the filters above
+  uint32_t sample_rate = 1;
+  // Tracing turns itself off after this many seconds
+  uint32_t duration_secs = 300;
+  // Pass finished traces to the export callback, e.g. to write them to the
+  // telemetry spool
+  bool export_traces = false;
+};
+
+// Decides which execs are traced and keeps the most recent finished traces
+// until they're fetched (e.g. by `santactl trace`).
+//
+// Tracing is off by default, and checking whether to trace an exec is a
+// single relaxed load while it is.
+class ExecTracer {
+ public:
+  static constexpr size_t kMaxCompletedTraces = 256;
+
+  ExecTracer() = default;
+
+  ExecTracer(const ExecTracer&) = delete;
+  ExecTracer& operator=(const ExecTracer&) = delete;
+
+  // The tracer used for execs authorized by santad.
+  static ExecTracer& Shared() {
+    static ExecTracer* tracer = new ExecTracer();
+    return *tracer;
+  }
+
+  void Enable(ExecTraceConfig config);
+  void Disable();
+  bool Enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  std::optional<ExecTraceConfig> Config();
+
+  // Returns a trace for the exec if it should be traced, or nullptr. The time
+  // since message_mach_time is recorded as its queue wait.
+  std::shared_ptr<ExecTrace> BeginTrace(pid_t pid, std::string_view path,
+                                        uint64_t message_mach_time);
+
+  void EndTrace(const ExecTrace& trace);
+
+  // Returns finished traces, oldest first, and forgets them.
+  std::vector<ExecTrace::Summary> TakeCompletedTraces();
+
+  void SetExportCallback(std::function<void(const ExecTrace::Summary&)> callback);
+
+ private:
+  // Returns false once the configured duration has passed.
+  bool StillEnabled() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  std::atomic<bool> enabled_ = false;
+  std::atomic<uint64_t> next_id_ = 1;
+  absl::Mutex mu_;
+  ExecTraceConfig config_ ABSL_GUARDED_BY(mu_);
+  uint64_t deadline_mach_time_ ABSL_GUARDED_BY(mu_) = 0;
+  uint64_t candidates_ ABSL_GUARDED_BY(mu_) = 0;
+  std::deque<ExecTrace::Summary> completed_ ABSL_GUARDED_BY(mu_);
+  std::function<void(const ExecTrace::Summary&)> export_callback_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_EXECTRACE_H
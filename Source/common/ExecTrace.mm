@@ -0,0 +1,212 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/ExecTrace.h"
+
+#include <mach/mach_time.h>
+#include <os/log.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "Source/common/SystemResources.h"
+
+namespace santa {
+
+static os_log_t ExecTraceLog() {
+  static os_log_t log = os_log_create("com.northpolesec.santa.daemon", "ExecTrace");
+  return log;
+}
+
+static thread_local ExecTrace* current_trace = nullptr;
+
+std::string_view ExecTraceStageName(ExecTraceStage stage) {
+  switch (stage) {
+    case ExecTraceStage::kQueueWait: return "queue_wait";
+    case ExecTraceStage::kAuthResultCache: return "auth_result_cache";
+    case ExecTraceStage::kFileInfo: return "file_info";
+    case ExecTraceStage::kCodesign: return "codesign";
+    case ExecTraceStage::kHash: return "hash";
+    case ExecTraceStage::kRuleLookup: return "rule_lookup";
+    case ExecTraceStage::kSQLite: return "sqlite";
+    case ExecTraceStage::kCEL: return "cel";
+    case ExecTraceStage::kPolicy: return "policy";
+    case ExecTraceStage::kNotificationQueue: return "notification_queue";
+  }
+  return "unknown";
+}
+
+ExecTrace::ExecTrace(uint64_t id, pid_t pid, std::string path)
+    : id_(id),
+      pid_(pid),
+      path_(std::move(path)),
+      start_mach_time_(mach_absolute_time()),
+      signpost_id_(os_signpost_id_generate(ExecTraceLog())) {
+  clock_gettime(CLOCK_REALTIME, &start_time_);
+  os_signpost_interval_begin(ExecTraceLog(), signpost_id_, "Exec", "id=%llu pid=%d path=%{public}s",
+                             id_, pid_, path_.c_str());
+}
+
+ExecTrace* ExecTrace::Current() {
+  return current_trace;
+}
+
+ExecTrace::ScopedCurrent::ScopedCurrent(ExecTrace* trace) : previous_(current_trace) {
+  current_trace = trace;
+}
+
+ExecTrace::ScopedCurrent::~ScopedCurrent() {
+  current_trace = previous_;
+}
+
+ExecTrace::Span::Span(ExecTrace* trace, ExecTraceStage stage)
+    : trace_(trace), stage_(stage), start_mach_time_(trace ? mach_absolute_time() : 0) {
+  if (trace_) {
+    // Spans of one trace can overlap, e.g. a background hash with the
+    // signature check, so each one is its own interval under the trace's id.
+    os_signpost_interval_begin(ExecTraceLog(), trace_->SignpostID(), "Stage",
+                               "id=%llu stage=%{public}s", trace_->id_,
+                               ExecTraceStageName(stage_).data());
+  }
+}
+
+ExecTrace::Span::~Span() {
+  if (trace_) {
+    trace_->AddStageTime(stage_, MachTimeToNanos(mach_absolute_time() - start_mach_time_));
+    os_signpost_interval_end(ExecTraceLog(), trace_->SignpostID(), "Stage",
+                             "id=%llu stage=%{public}s", trace_->id_,
+                             ExecTraceStageName(stage_).data());
+  }
+}
+
+void ExecTrace::AddStageTime(ExecTraceStage stage, uint64_t nanos) {
+  stage_ns_[static_cast<size_t>(stage)].fetch_add(nanos, std::memory_order_relaxed);
+}
+
+void ExecTrace::AddHashBytesRead(uint64_t bytes) {
+  hash_bytes_read_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+ExecTrace::Summary ExecTrace::Finish() const {
+  Summary summary{
+      .id = id_,
+      .pid = pid_,
+      .path = path_,
+      .result = result_,
+      .start_time = start_time_,
+      .total_ns = MachTimeToNanos(mach_absolute_time() - start_mach_time_),
+      .hash_bytes_read = hash_bytes_read_.load(std::memory_order_relaxed),
+  };
+  clock_gettime(CLOCK_REALTIME, &summary.end_time);
+  for (size_t i = 0; i < kExecTraceStageCount; i++) {
+    summary.stage_ns[i] = stage_ns_[i].load(std::memory_order_relaxed);
+  }
+
+  os_signpost_interval_end(ExecTraceLog(), signpost_id_, "Exec", "id=%llu result=%{public}s", id_,
+                           result_.c_str());
+  return summary;
+}
+
+void ExecTracer::Enable(ExecTraceConfig config) {
+  absl::MutexLock lock(mu_);
+  config.sample_rate = std::max<uint32_t>(config.sample_rate, 1);
+  deadline_mach_time_ = AddNanosecondsToMachTime(
+      static_cast<uint64_t>(config.duration_secs) * NSEC_PER_SEC, mach_absolute_time());
+  config_ = std::move(config);
+  candidates_ = 0;
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void ExecTracer::Disable() {
+  absl::MutexLock lock(mu_);
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+std::optional<ExecTraceConfig> ExecTracer::Config() {
+  absl::MutexLock lock(mu_);
+  if (!StillEnabled()) {
+    return std::nullopt;
+  }
+  return config_;
+}
+
+bool ExecTracer::StillEnabled() {
+  if (!enabled_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  if (mach_absolute_time() >= deadline_mach_time_) {
+    enabled_.store(false, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<ExecTrace> ExecTracer::BeginTrace(pid_t pid, std::string_view path,
+                                                  uint64_t message_mach_time) {
+  if (!Enabled()) {
+    return nullptr;
+  }
+
+  {
+    absl::MutexLock lock(mu_);
+    if (!StillEnabled() || (config_.pid && *config_.pid != pid) ||
+        !path.starts_with(config_.path_prefix) || candidates_++ % config_.sample_rate != 0) {
+      return nullptr;
+    }
+  }
+
+  auto trace = std::make_shared<ExecTrace>(next_id_.fetch_add(1, std::memory_order_relaxed), pid,
+                                           std::string(path));
+  uint64_t now = mach_absolute_time();
+  if (message_mach_time > 0 && message_mach_time < now) {
+    trace->AddStageTime(ExecTraceStage::kQueueWait, MachTimeToNanos(now - message_mach_time));
+  }
+  return trace;
+}
+
+void ExecTracer::EndTrace(const ExecTrace& trace) {
+  ExecTrace::Summary summary = trace.Finish();
+
+  std::function<void(const ExecTrace::Summary&)> export_callback;
+  {
+    absl::MutexLock lock(mu_);
+    if (config_.export_traces) {
+      export_callback = export_callback_;
+    }
+    if (completed_.size() >= kMaxCompletedTraces) {
+      completed_.pop_front();
+    }
+    completed_.push_back(summary);
+  }
+
+  if (export_callback) {
+    export_callback(summary);
+  }
+}
+
+std::vector<ExecTrace::Summary> ExecTracer::TakeCompletedTraces() {
+  absl::MutexLock lock(mu_);
+  std::vector<ExecTrace::Summary> traces(std::make_move_iterator(completed_.begin()),
+                                         std::make_move_iterator(completed_.end()));
+  completed_.clear();
+  return traces;
+}
+
+void ExecTracer::SetExportCallback(std::function<void(const ExecTrace::Summary&)> callback) {
+  absl::MutexLock lock(mu_);
+  export_callback_ = std::move(callback);
+}
+
+}  // namespace santa
@@ -0,0 +1,157 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/ExecTrace.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <mach/mach_time.h>
+#include <unistd.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using santa::ExecTrace;
+using santa::ExecTraceConfig;
+using santa::ExecTracer;
+using santa::ExecTraceStage;
+
+@interface ExecTraceTest : XCTestCase
+@end
+
+@implementation ExecTraceTest
+
+- (void)testDisabledByDefault {
+  ExecTracer tracer;
+  XCTAssertFalse(tracer.Enabled());
+  XCTAssertFalse(tracer.Config().has_value());
+  XCTAssertEqual(tracer.BeginTrace(1, "/bin/ls", 0), nullptr);
+}
+
+- (void)testFilters {
+  ExecTracer tracer;
+  tracer.Enable({.pid = 123, .path_prefix = "/usr/"});
+  XCTAssertTrue(tracer.Config().has_value());
+
+  XCTAssertEqual(tracer.BeginTrace(1, "/usr/bin/make", 0), nullptr);
+  XCTAssertEqual(tracer.BeginTrace(123, "/bin/ls", 0), nullptr);
+  XCTAssertNotEqual(tracer.BeginTrace(123, "/usr/bin/make", 0), nullptr);
+
+  tracer.Disable();
+  XCTAssertEqual(tracer.BeginTrace(123, "/usr/bin/make", 0), nullptr);
+}
+
+- (void)testSampleRate {
+  ExecTracer tracer;
+  tracer.Enable({.sample_rate = 4});
+
+  int traced = 0;
+  for (int i = 0; i < 100; i++) {
+    if (tracer.BeginTrace(i, "/bin/ls", 0)) {
+      traced++;
+    }
+  }
+  XCTAssertEqual(traced, 25);
+}
+
+- (void)testDurationExpires {
+  ExecTracer tracer;
+  tracer.Enable({.duration_secs = 0});
+  XCTAssertEqual(tracer.BeginTrace(1, "/bin/ls", 0), nullptr);
+  XCTAssertFalse(tracer.Enabled());
+}
+
+- (void)testSpansRecordIntoCurrentTrace {
+  ExecTracer tracer;
+  tracer.Enable({});
+
+  std::shared_ptr<ExecTrace> trace = tracer.BeginTrace(1, "/bin/ls", mach_absolute_time());
+  XCTAssertEqual(ExecTrace::Current(), nullptr);
+
+  {
+    // No current trace, nothing is recorded
+    ExecTrace::Span span(ExecTraceStage::kCodesign);
+  }
+
+  {
+    ExecTrace::ScopedCurrent scoped(trace.get());
+    XCTAssertEqual(ExecTrace::Current(), trace.get());
+    {
+      ExecTrace::Span span(ExecTraceStage::kHash);
+      trace->AddHashBytesRead(100);
+      usleep(1000);
+    }
+    {
+      ExecTrace::Span span(ExecTraceStage::kHash);
+      trace->AddHashBytesRead(50);
+    }
+
+    // Spans can also be recorded from another thread
+    std::thread([trace] {
+      ExecTrace::Span span(trace.get(), ExecTraceStage::kSQLite);
+      usleep(1000);
+    }).join();
+
+    trace->SetResult("allow");
+  }
+  XCTAssertEqual(ExecTrace::Current(), nullptr);
+
+  tracer.EndTrace(*trace);
+  std::vector<ExecTrace::Summary> traces = tracer.TakeCompletedTraces();
+  XCTAssertEqual(traces.size(), 1);
+
+  const ExecTrace::Summary& summary = traces[0];
+  XCTAssertEqual(summary.pid, 1);
+  XCTAssertTrue(summary.path == "/bin/ls");
+  XCTAssertTrue(summary.result == "allow");
+  XCTAssertEqual(summary.hash_bytes_read, 150);
+  XCTAssertEqual(summary.stage_ns[static_cast<size_t>(ExecTraceStage::kCodesign)], 0);
+  XCTAssertGreaterThanOrEqual(summary.stage_ns[static_cast<size_t>(ExecTraceStage::kHash)],
+                              1000 * NSEC_PER_USEC);
+  XCTAssertGreaterThanOrEqual(summary.stage_ns[static_cast<size_t>(ExecTraceStage::kSQLite)],
+                              1000 * NSEC_PER_USEC);
+  XCTAssertGreaterThanOrEqual(summary.total_ns, 2000 * NSEC_PER_USEC);
+
+  XCTAssertTrue(tracer.TakeCompletedTraces().empty());
+}
+
+- (void)testCompletedTracesAreBounded {
+  ExecTracer tracer;
+  tracer.Enable({});
+
+  for (size_t i = 0; i < ExecTracer::kMaxCompletedTraces + 10; i++) {
+    tracer.EndTrace(*tracer.BeginTrace(static_cast<pid_t>(i), "/bin/ls", 0));
+  }
+
+  std::vector<ExecTrace::Summary> traces = tracer.TakeCompletedTraces();
+  XCTAssertEqual(traces.size(), ExecTracer::kMaxCompletedTraces);
+  XCTAssertEqual(traces.front().pid, 10);
+}
+
+- (void)testExportCallback {
+  ExecTracer tracer;
+  int exported = 0;
+  tracer.SetExportCallback([&exported](const ExecTrace::Summary&) { exported++; });
+
+  tracer.Enable({});
+  tracer.EndTrace(*tracer.BeginTrace(1, "/bin/ls", 0));
+  XCTAssertEqual(exported, 0);
+
+  tracer.Enable({.export_traces = true});
+  tracer.EndTrace(*tracer.BeginTrace(1, "/bin/ls", 0));
+  XCTAssertEqual(exported, 1);
+}
+
+@end
@@ -0,0 +1,34 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_FILEVERSION_H
+#define SANTA_COMMON_FILEVERSION_H
+
+#include <sys/stat.h>
+
+namespace santa {
+
+// Any write to a file updates its ctime, which cannot be set from userspace,
+// so matching size, mtime and ctime imply the contents are unchanged.
+inline bool SameFileVersion(const struct stat& a, const struct stat& b) {
+  return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_size == b.st_size &&
+         a.st_mtimespec.tv_sec == b.st_mtimespec.tv_sec &&
+         a.st_mtimespec.tv_nsec == b.st_mtimespec.tv_nsec &&
+         a.st_ctimespec.tv_sec == b.st_ctimespec.tv_sec &&
+         a.st_ctimespec.tv_nsec == b.st_ctimespec.tv_nsec;
+}
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_FILEVERSION_H
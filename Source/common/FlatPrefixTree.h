@@ -0,0 +1,348 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_FLATPREFIXTREE_H
+#define SANTA_COMMON_FLATPREFIXTREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+
+namespace santa {
+
+/// An immutable prefix tree with the same matching semantics as PrefixTree.
+///
+/// The tree is built once from all of its entries and stored in a handful of
+/// flat arrays instead of individually allocated nodes. Since it can't be
+/// modified after construction, lookups don't take any locks and a tree can
+/// be freely shared between threads, e.g. published as a snapshot through an
+/// atomic shared pointer and replaced wholesale when the entries change.
+template <typename ValueT>
+class FlatPrefixTree {
+ public:
+  struct Entry {
+    std::string key;
+    bool is_prefix;
+    ValueT value;
+  };
+
+  class Builder {
+   public:
+    void InsertPrefix(std::string key, ValueT value) {
+      Insert(std::move(key), true, std::move(value));
+    }
+
+    void InsertLiteral(std::string key, ValueT value) {
+      Insert(std::move(key), false, std::move(value));
+    }
+
+    FlatPrefixTree Build() && { return FlatPrefixTree(std::move(entries_)); }
+
+   private:
+    void Insert(std::string key, bool is_prefix, ValueT value) {
+      entries_.push_back({std::move(key), is_prefix, std::move(value)});
+    }
+
+    std::vector<Entry> entries_;
+  };
+
+  FlatPrefixTree() : FlatPrefixTree(std::vector<Entry>()) {}
+
+  /// Builds the tree from the given entries. If a key appears more than once,
+  /// the last entry for it wins, as if they were inserted into a PrefixTree in
+  /// order. Empty keys and keys containing a NUL are ignored.
+  explicit FlatPrefixTree(std::vector<Entry> entries);
+
+  FlatPrefixTree(FlatPrefixTree&& other) = default;
+  FlatPrefixTree& operator=(FlatPrefixTree&& rhs) = default;
+
+  // Copying not supported
+  FlatPrefixTree(const FlatPrefixTree& other) = delete;
+  FlatPrefixTree& operator=(const FlatPrefixTree& other) = delete;
+
+  bool HasPrefix(const char* input) const {
+    return Match(input, true) != kNoMatch;
+  }
+
+  std::optional<ValueT> LookupLongestMatchingPrefix(
+      const std::string& input) const {
+    uint32_t match = Match(input.c_str(), false);
+    if (match == kNoMatch) {
+      return std::nullopt;
+    }
+    return std::make_optional<ValueT>(values_[nodes_[match].value_index]);
+  }
+
+  /// Looks up the longest matching prefix of each input, e.g. both paths of a
+  /// rename, in a single pass. Inputs are visited in sorted order so that the
+  /// walk for each one resumes from the nodes it shares with the previous one.
+  /// Results are returned in the same order as the inputs.
+  std::vector<std::optional<ValueT>> LookupLongestMatchingPrefixes(
+      const std::vector<std::string_view>& inputs) const;
+
+  /// Number of nodes in the tree, not counting the root.
+  uint32_t NodeCount() const { return (uint32_t)nodes_.size() - 1; }
+
+  /// Number of distinct keys in the tree.
+  size_t Count() const { return values_.size(); }
+
+  /// Bytes allocated for the tree's arrays, not counting anything the values
+  /// themselves point to.
+  size_t MemoryUsageBytes() const {
+    return nodes_.capacity() * sizeof(Node) + edges_.capacity() +
+           bytes_.capacity() + values_.capacity() * sizeof(ValueT);
+  }
+
+ private:
+  enum class NodeType : uint8_t {
+    kInner = 0,
+    kPrefix,
+    kLiteral,
+  };
+
+  static constexpr uint32_t kNoMatch = UINT32_MAX;
+
+  ///
+  ///  Nodes are laid out breadth first so that the children of each node are
+  ///  contiguous and sorted by the byte that selects them, which is stored
+  ///  separately in `edges_` to keep child searches within a few cache lines.
+  ///  Runs of bytes without branches are stored once in `bytes_`.
+  ///
+  struct Node {
+    uint32_t bytes_offset;
+    uint32_t bytes_len;
+    uint32_t first_child;
+    uint32_t child_count;
+    uint32_t value_index;
+    NodeType node_type;
+  };
+
+  uint32_t FindChild(const Node& node, uint8_t byte) const {
+    const uint8_t* begin = edges_.data() + node.first_child;
+    const uint8_t* end = begin + node.child_count;
+    const uint8_t* it = std::lower_bound(begin, end, byte);
+    if (it == end || *it != byte) {
+      return kNoMatch;
+    }
+    return node.first_child + (uint32_t)(it - begin);
+  }
+
+  uint32_t Match(const char* input, bool stop_at_first_match) const {
+    uint32_t node_index = 0;
+    uint32_t match = kNoMatch;
+    const char* p = input;
+
+    while (*p) {
+      node_index = FindChild(nodes_[node_index], (uint8_t)*p++);
+      if (node_index == kNoMatch) {
+        break;
+      }
+
+      // The node's bytes never contain a NUL, so this stops at the end of a
+      // shorter input.
+      const Node& node = nodes_[node_index];
+      if (node.bytes_len &&
+          strncmp(p, bytes_.data() + node.bytes_offset, node.bytes_len) != 0) {
+        break;
+      }
+      p += node.bytes_len;
+
+      if (node.node_type == NodeType::kPrefix ||
+          (*p == '\0' && node.node_type == NodeType::kLiteral)) {
+        match = node_index;
+        if (stop_at_first_match) {
+          break;
+        }
+      }
+    }
+
+    return match;
+  }
+
+  std::vector<Node> nodes_;
+  std::vector<uint8_t> edges_;
+  std::string bytes_;
+  std::vector<ValueT> values_;
+};
+
+template <typename ValueT>
+std::vector<std::optional<ValueT>>
+FlatPrefixTree<ValueT>::LookupLongestMatchingPrefixes(
+    const std::vector<std::string_view>& inputs) const {
+  std::vector<std::optional<ValueT>> results(inputs.size());
+
+  absl::InlinedVector<size_t, 4> order(inputs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&inputs](size_t a, size_t b) { return inputs[a] < inputs[b]; });
+
+  // The nodes fully matched by the previous input, along with the input
+  // length consumed to reach each and the deepest prefix node at or above it.
+  struct Step {
+    uint32_t node_index;
+    size_t depth;
+    uint32_t prefix_match;
+  };
+  absl::InlinedVector<Step, 16> path = {{0, 0, kNoMatch}};
+  std::string_view prev;
+
+  for (size_t i : order) {
+    std::string_view input = inputs[i];
+
+    size_t shared = 0;
+    size_t max_shared = std::min(prev.size(), input.size());
+    while (shared < max_shared && prev[shared] == input[shared]) {
+      shared++;
+    }
+    while (path.back().depth > shared) {
+      path.pop_back();
+    }
+
+    Step cur = path.back();
+    while (cur.depth < input.size()) {
+      uint32_t child_index =
+          FindChild(nodes_[cur.node_index], (uint8_t)input[cur.depth]);
+      if (child_index == kNoMatch) {
+        break;
+      }
+
+      const Node& child = nodes_[child_index];
+      size_t child_depth = cur.depth + 1 + child.bytes_len;
+      if (child_depth > input.size() ||
+          memcmp(input.data() + cur.depth + 1,
+                 bytes_.data() + child.bytes_offset, child.bytes_len) != 0) {
+        break;
+      }
+
+      cur.node_index = child_index;
+      cur.depth = child_depth;
+      if (child.node_type == NodeType::kPrefix) {
+        cur.prefix_match = child_index;
+      }
+      path.push_back(cur);
+    }
+
+    uint32_t match = cur.prefix_match;
+    if (cur.depth == input.size() &&
+        nodes_[cur.node_index].node_type == NodeType::kLiteral) {
+      match = cur.node_index;
+    }
+    if (match != kNoMatch) {
+      results[i] = values_[nodes_[match].value_index];
+    }
+
+    prev = input;
+  }
+
+  return results;
+}
+
+template <typename ValueT>
+FlatPrefixTree<ValueT>::FlatPrefixTree(std::vector<Entry> entries) {
+  // Sort by key, keeping the last of any duplicates.
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const Entry& a, const Entry& b) { return a.key < b.key; });
+  std::vector<Entry> keys;
+  keys.reserve(entries.size());
+  for (Entry& entry : entries) {
+    if (entry.key.empty() || entry.key.find('\0') != std::string::npos) {
+      continue;
+    }
+    if (!keys.empty() && keys.back().key == entry.key) {
+      keys.back() = std::move(entry);
+    } else {
+      keys.push_back(std::move(entry));
+    }
+  }
+
+  // Each pending node covers a range of sorted keys that all start with the
+  // same `depth` bytes, which is everything up to and including the byte that
+  // selects the node in its parent.
+  struct Pending {
+    size_t begin;
+    size_t end;
+    size_t depth;
+  };
+
+  // The root never has bytes of its own since keys can't be empty.
+  nodes_.push_back({0, 0, 0, 0, 0, NodeType::kInner});
+  edges_.push_back(0);
+
+  std::deque<Pending> pending;
+
+  auto add_children = [&](uint32_t node_index, size_t begin, size_t end,
+                          size_t depth) {
+    nodes_[node_index].first_child = (uint32_t)nodes_.size();
+    while (begin < end) {
+      uint8_t byte = (uint8_t)keys[begin].key[depth];
+      size_t child_end = begin + 1;
+      while (child_end < end && (uint8_t)keys[child_end].key[depth] == byte) {
+        child_end++;
+      }
+      nodes_.push_back({0, 0, 0, 0, 0, NodeType::kInner});
+      edges_.push_back(byte);
+      pending.push_back({begin, child_end, depth + 1});
+      nodes_[node_index].child_count++;
+      begin = child_end;
+    }
+  };
+
+  add_children(0, 0, keys.size(), 0);
+
+  for (uint32_t node_index = 1; !pending.empty(); node_index++) {
+    Pending cur = pending.front();
+    pending.pop_front();
+
+    // Keys are sorted, so the bytes shared by the whole range are those
+    // shared by its first and last keys.
+    const std::string& lo = keys[cur.begin].key;
+    const std::string& hi = keys[cur.end - 1].key;
+    size_t shared = cur.depth;
+    while (shared < lo.size() && shared < hi.size() &&
+           lo[shared] == hi[shared]) {
+      shared++;
+    }
+
+    Node& node = nodes_[node_index];
+    node.bytes_offset = (uint32_t)bytes_.size();
+    node.bytes_len = (uint32_t)(shared - cur.depth);
+    bytes_.append(lo, cur.depth, shared - cur.depth);
+
+    // If a key ends at this node it sorts first in the range.
+    size_t children_begin = cur.begin;
+    if (lo.size() == shared) {
+      node.node_type =
+          keys[cur.begin].is_prefix ? NodeType::kPrefix : NodeType::kLiteral;
+      node.value_index = (uint32_t)values_.size();
+      values_.push_back(std::move(keys[cur.begin].value));
+      children_begin++;
+    }
+
+    add_children(node_index, children_begin, cur.end, shared);
+  }
+}
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_FLATPREFIXTREE_H
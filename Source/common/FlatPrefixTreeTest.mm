@@ -0,0 +1,169 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/FlatPrefixTree.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Source/common/PrefixTree.h"
+
+using santa::FlatPrefixTree;
+using santa::PrefixTree;
+
+@interface FlatPrefixTreeTest : XCTestCase
+@end
+
+@implementation FlatPrefixTreeTest
+
+- (void)testEmpty {
+  FlatPrefixTree<int> tree;
+
+  XCTAssertEqual(tree.Count(), 0);
+  XCTAssertEqual(tree.NodeCount(), 0);
+  XCTAssertFalse(tree.HasPrefix("/foo"));
+  XCTAssertFalse(tree.HasPrefix(""));
+  XCTAssertFalse(tree.LookupLongestMatchingPrefix("/foo").has_value());
+}
+
+- (void)testLookupLongestMatchingPrefix {
+  FlatPrefixTree<int>::Builder builder;
+  builder.InsertPrefix("/foo", 12);
+  builder.InsertPrefix("/bar", 34);
+  builder.InsertLiteral("/foo/bar.txt", 56);
+  builder.InsertPrefix("/foo/baz/", 78);
+  FlatPrefixTree<int> tree = std::move(builder).Build();
+
+  XCTAssertEqual(tree.Count(), 4);
+
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/foo").value_or(0), 12);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/foo/bar.txt").value_or(0), 56);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/foo/bar.txt.tmp").value_or(0), 12);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/foo/baz/qux").value_or(0), 78);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/bar/foo").value_or(0), 34);
+
+  XCTAssertFalse(tree.LookupLongestMatchingPrefix("/fo").has_value());
+  XCTAssertFalse(tree.LookupLongestMatchingPrefix("/asdf").has_value());
+
+  XCTAssertTrue(tree.HasPrefix("/foo/bar"));
+  XCTAssertFalse(tree.HasPrefix("/ba"));
+}
+
+- (void)testLastDuplicateWins {
+  FlatPrefixTree<int>::Builder builder;
+  builder.InsertPrefix("/foo", 1);
+  builder.InsertLiteral("/foo", 2);
+  builder.InsertLiteral("/bar", 3);
+  builder.InsertPrefix("/bar", 4);
+  FlatPrefixTree<int> tree = std::move(builder).Build();
+
+  XCTAssertEqual(tree.Count(), 2);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/foo").value_or(0), 2);
+  XCTAssertFalse(tree.LookupLongestMatchingPrefix("/foo/x").has_value());
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/bar/x").value_or(0), 4);
+}
+
+- (void)testUnsupportedKeysIgnored {
+  FlatPrefixTree<int>::Builder builder;
+  builder.InsertPrefix("", 1);
+  builder.InsertPrefix(std::string("/a\0b", 4), 2);
+  FlatPrefixTree<int> tree = std::move(builder).Build();
+
+  XCTAssertEqual(tree.Count(), 0);
+  XCTAssertFalse(tree.HasPrefix("/a"));
+}
+
+- (void)testMatchesPrefixTree {
+  // Keys with shared prefixes, high bytes, and keys that are prefixes of
+  // other keys.
+  std::vector<std::string> keys = {
+      "/a", "/ab", "/abc/", "/abd", "/b/🤘", "/b/🤘/x", "/b/\xff", "/c", "/cc/dd/ee",
+  };
+
+  PrefixTree<int> prefixTree;
+  FlatPrefixTree<int>::Builder builder;
+  for (int i = 0; i < keys.size(); i++) {
+    if (i % 2) {
+      prefixTree.InsertLiteral(keys[i].c_str(), i);
+      builder.InsertLiteral(keys[i], i);
+    } else {
+      prefixTree.InsertPrefix(keys[i].c_str(), i);
+      builder.InsertPrefix(keys[i], i);
+    }
+  }
+  FlatPrefixTree<int> tree = std::move(builder).Build();
+
+  XCTAssertEqual(tree.NodeCount(), prefixTree.NodeCount());
+
+  std::vector<std::string> inputs = {
+      "/",    "/a",    "/ab",      "/abc",    "/abc/", "/abc/d",  "/abd",      "/abde",
+      "/b",   "/b/🤘", "/b/🤘/",   "/b/🤘/x", "/b/\xff", "/b/\xfe", "/cc/dd/e", "/cc/dd/ee/f",
+      "/c/x", "",      "/zzzzzzz",
+  };
+  for (const auto& input : inputs) {
+    XCTAssertTrue(tree.LookupLongestMatchingPrefix(input) ==
+                      prefixTree.LookupLongestMatchingPrefix(input),
+                  @"Mismatch for input: %s", input.c_str());
+    XCTAssertEqual(tree.HasPrefix(input.c_str()), prefixTree.HasPrefix(input.c_str()),
+                   @"Mismatch for input: %s", input.c_str());
+  }
+}
+
+- (void)testLookupLongestMatchingPrefixes {
+  FlatPrefixTree<int>::Builder builder;
+  builder.InsertPrefix("/foo/", 1);
+  builder.InsertLiteral("/foo/bar.txt", 2);
+  builder.InsertPrefix("/foo/baz/", 3);
+  builder.InsertPrefix("/qux", 4);
+  FlatPrefixTree<int> tree = std::move(builder).Build();
+
+  std::vector<std::string> inputs = {
+      "/foo/baz/a", "/foo/bar.txt", "/foo/bar.txt.tmp", "/qux/x", "/foo/bar.txt",
+      "/nope",      "/foo",         "",                 "/foo/baz",
+  };
+  std::vector<std::string_view> views(inputs.begin(), inputs.end());
+
+  std::vector<std::optional<int>> results = tree.LookupLongestMatchingPrefixes(views);
+  XCTAssertEqual(results.size(), inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    XCTAssertTrue(results[i] == tree.LookupLongestMatchingPrefix(inputs[i]),
+                  @"Mismatch for input: %s", inputs[i].c_str());
+  }
+
+  XCTAssertEqual(results[0].value_or(0), 3);
+  XCTAssertEqual(results[1].value_or(0), 2);
+  XCTAssertEqual(results[2].value_or(0), 1);
+  XCTAssertFalse(results[5].has_value());
+
+  XCTAssertEqual(tree.LookupLongestMatchingPrefixes({}).size(), 0);
+}
+
+- (void)testSharedSnapshot {
+  FlatPrefixTree<std::shared_ptr<int>>::Builder builder;
+  builder.InsertPrefix("/foo", std::make_shared<int>(123));
+  auto tree =
+      std::make_shared<const FlatPrefixTree<std::shared_ptr<int>>>(std::move(builder).Build());
+
+  dispatch_apply(64, dispatch_get_global_queue(0, 0), ^(size_t i) {
+    std::optional<std::shared_ptr<int>> value = tree->LookupLongestMatchingPrefix("/foo/bar");
+    XCTAssertTrue(value.has_value() && **value == 123);
+  });
+}
+
+@end
@@ -17,13 +17,22 @@
 
 #import <Foundation/Foundation.h>
 
+#include <functional>
 #include <string>
 #include <vector>
 
 namespace santa {
 
+// Expands the glob pattern into the paths it matches, sorted. A path without
+// any glob characters is returned as-is, whether or not it exists.
 std::vector<std::string> FindMatches(NSString* path);
 
+// Like the above, but each match is passed to on_match as soon as it is found,
+// so work on early matches can start while the rest are still being expanded.
+// Directories are expanded on several threads. on_match is never called
+// concurrently, but matches are reported in no particular order.
+void FindMatches(NSString* path, const std::function<void(const std::string&)>& on_match);
+
 }  // namespace santa
 
 #endif  // SANTA_COMMON_GLOB_H
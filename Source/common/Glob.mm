@@ -15,17 +15,48 @@
 #include "Source/common/Glob.h"
 
 #include <glob.h>
+#include <string.h>
+
+#include <algorithm>
 
 #import "Source/common/SNTLogging.h"
 #include "absl/cleanup/cleanup.h"
+#include "absl/synchronization/mutex.h"
 
 namespace santa {
 
-void FindMatches(NSString* base, NSMutableArray<NSString*>* path_components, NSUInteger idx,
-                 std::vector<std::string>& matches) {
+namespace {
+
+using MatchCallback = std::function<void(const std::string&)>;
+
+// Whether glob(3) would set GLOB_MAGCHAR for the pattern, determined without
+// touching the filesystem. Brace and tilde expansion are never requested, so
+// only unescaped `*`, `?` and complete bracket expressions count.
+bool HasMagicChars(const char* pattern) {
+  for (const char* p = pattern; *p; p++) {
+    switch (*p) {
+      case '\\':
+        if (p[1]) p++;
+        break;
+      case '*':
+      case '?': return true;
+      case '[': {
+        const char* q = p + 1;
+        if (*q == '!') q++;
+        if (*q && strchr(q + 1, ']')) return true;
+        break;
+      }
+      default: break;
+    }
+  }
+  return false;
+}
+
+void FindMatches(NSString* base, NSArray<NSString*>* path_components, NSUInteger idx,
+                 const MatchCallback* on_match) {
   if (path_components.count == idx) {
     // Nothing left to match, add the current full base path
-    matches.push_back(base.UTF8String);
+    (*on_match)(base.UTF8String);
     return;
   }
 
@@ -58,50 +89,41 @@ void FindMatches(NSString* base, NSMutableArray<NSString*>* path_components, NSU
                     subarrayWithRange:NSMakeRange(idx + 1, path_components.count - idx - 1)];
       NSString* remaining_path = [remaining_components componentsJoinedByString:@""];
 
-      // Need to manually globfree here since we're about to re-glob
-      globfree(g);
-      glob(remaining_path.UTF8String, 0, NULL, g);
-      if ((g->gl_flags & GLOB_MAGCHAR) == 0) {
-        matches.push_back([NSString stringWithFormat:@"%@%@", path, remaining_path].UTF8String);
+      if (!HasMagicChars(remaining_path.UTF8String)) {
+        (*on_match)([NSString stringWithFormat:@"%@%@", path, remaining_path].UTF8String);
       }
     } else {
       // There was a magic char but no FS match. No paths will be watched.
     }
+  } else if (g->gl_pathc == 1) {
+    FindMatches(@(g->gl_pathv[g->gl_offs]), path_components, idx + 1, on_match);
   } else {
-    // For every subpath match, recurse into
-    for (size_t i = g->gl_offs; i < g->gl_pathc; i++) {
-      FindMatches(@(g->gl_pathv[i]), path_components, idx + 1, matches);
-    }
+    // Every subpath match is recursed into concurrently. The directories under
+    // each are independent, and for patterns like /Users/*/Applications/* most
+    // of the time is spent waiting on reads of them.
+    dispatch_apply(g->gl_pathc, DISPATCH_APPLY_AUTO, ^(size_t i) {
+      @autoreleasepool {
+        FindMatches(@(g->gl_pathv[g->gl_offs + i]), path_components, idx + 1, on_match);
+      }
+    });
   }
 }
 
-std::vector<std::string> FindMatches(NSString* path) {
+}  // namespace
+
+void FindMatches(NSString* path, const std::function<void(const std::string&)>& on_match) {
   if (!path) {
-    return {};
+    return;
   }
 
   if (![path hasPrefix:@"/"]) {
     path = [NSString stringWithFormat:@"/%@", path];
   }
 
-  glob_t* g = (glob_t*)alloca(sizeof(glob_t));
-  // Ensure gl_pathv is NULL so globfree can always safely be called
-  g->gl_pathv = NULL;
-
-  // Ensure globfree is always called
-  absl::Cleanup glob_cleanup = ^{
-    globfree(g);
-  };
-
-  int err = glob(path.UTF8String, 0, nullptr, g);
-  if (err != 0 && err != GLOB_NOMATCH) {
-    LOGE(@"Failed to generate path names from glob: %@", path);
-    return {};
-  }
-
   // If the path had no glob char, begin watching it whether or not it exists
-  if ((g->gl_flags & GLOB_MAGCHAR) == 0) {
-    return {path.UTF8String};
+  if (!HasMagicChars(path.UTF8String)) {
+    on_match(path.UTF8String);
+    return;
   }
 
   NSArray<NSString*>* path_components = [path pathComponents];
@@ -112,7 +134,7 @@ std::vector<std::string> FindMatches(NSString* path) {
   // anyone ever has a good use case.
   if (path_components.count > 40) {
     LOGW(@"Glob path contained too many components, skipping: %@", path);
-    return {};
+    return;
   }
 
   // Modify each path component to have a trailing slash. This is to ensure that when path
@@ -128,9 +150,22 @@ std::vector<std::string> FindMatches(NSString* path) {
     }
   }
 
+  // Matches are found on several threads, but handed to the caller one at a time.
+  absl::Mutex mu;
+  MatchCallback report = [&mu, &on_match](const std::string& match) {
+    absl::MutexLock lock(mu);
+    on_match(match);
+  };
+  FindMatches(@"/", modified_path_components, 0, &report);
+}
+
+std::vector<std::string> FindMatches(NSString* path) {
   std::vector<std::string> matches;
-  FindMatches(@"/", modified_path_components, 0, matches);
+  FindMatches(path, [&matches](const std::string& match) { matches.push_back(match); });
 
+  // Matches are found in no particular order, sort them so callers see the same
+  // result for the same filesystem.
+  std::sort(matches.begin(), matches.end());
   return matches;
 }
 
@@ -0,0 +1,80 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_HEAPSAMPLE_H
+#define SANTA_COMMON_HEAPSAMPLE_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace santa {
+
+// A summary of the live malloc heap of the current process, for diagnosing
+// leaks and bloat offline.
+//
+// Each malloc zone is enumerated through its introspection functions while it
+// is locked, one zone at a time, so threads allocating from that zone wait
+// until it has been walked. Blocks are counted in power of two size classes.
+// As with heap(1), a block that begins with the isa of a registered
+// Objective-C class whose instances fit in it is counted as an instance of
+// that class. The summary has a fixed size however large the heap is, and
+// nothing is allocated while a zone is locked.
+class HeapSample {
+ public:
+  // Size class i holds blocks of [2^(i-1), 2^i) bytes, with class 0 holding
+  // empty blocks and the last class holding everything larger.
+  static constexpr size_t kSizeClasses = 40;
+  // The most classes that are reported, by bytes of instances.
+  static constexpr size_t kMaxClasses = 100;
+
+  struct SizeClass {
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+  };
+
+  struct Zone {
+    std::string name;
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+    std::array<SizeClass, kSizeClasses> size_classes = {};
+  };
+
+  struct ClassUsage {
+    std::string name;
+    uint64_t instances = 0;
+    uint64_t bytes = 0;
+  };
+
+  struct Result {
+    std::vector<Zone> zones;
+    // Most bytes first, at most max_classes of them.
+    std::vector<ClassUsage> classes;
+    uint64_t duration_ns = 0;
+  };
+
+  static Result Collect(size_t max_classes = kMaxClasses);
+
+  static size_t SizeClassForSize(uint64_t size) {
+    return std::min<size_t>(std::bit_width(size), kSizeClasses - 1);
+  }
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_HEAPSAMPLE_H
@@ -0,0 +1,153 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/HeapSample.h"
+
+#include <mach/mach.h>
+#include <malloc/malloc.h>
+#include <objc/runtime.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+
+// Exported by the Objective-C runtime for tools like heap(1), to find the bits
+// of an isa that point to the class.
+extern "C" const uintptr_t objc_debug_isa_class_mask __attribute__((weak_import));
+
+namespace santa {
+
+namespace {
+
+struct ClassEntry {
+  uintptr_t isa;
+  size_t instance_size;
+  const char* name;
+  uint64_t instances;
+  uint64_t bytes;
+};
+
+struct RecordContext {
+  HeapSample::Zone* zone;
+  std::vector<ClassEntry>* classes;
+  uintptr_t isa_mask;
+};
+
+// Blocks are enumerated in this process, so their addresses can be read
+// directly.
+kern_return_t ReadLocalMemory(task_t task, vm_address_t address, vm_size_t size, void** local) {
+  *local = reinterpret_cast<void*>(address);
+  return KERN_SUCCESS;
+}
+
+// Called with the zone locked, so this must not allocate.
+void RecordRanges(task_t task, void* context, unsigned type, vm_range_t* ranges, unsigned count) {
+  RecordContext* ctx = static_cast<RecordContext*>(context);
+  std::vector<ClassEntry>& classes = *ctx->classes;
+
+  for (unsigned i = 0; i < count; i++) {
+    uint64_t size = ranges[i].size;
+    ctx->zone->blocks++;
+    ctx->zone->bytes += size;
+    HeapSample::SizeClass& size_class =
+        ctx->zone->size_classes[HeapSample::SizeClassForSize(size)];
+    size_class.blocks++;
+    size_class.bytes += size;
+
+    if (size < sizeof(uintptr_t)) continue;
+    uintptr_t isa = *reinterpret_cast<const uintptr_t*>(ranges[i].address) & ctx->isa_mask;
+    auto it = std::lower_bound(
+        classes.begin(), classes.end(), isa,
+        [](const ClassEntry& entry, uintptr_t value) { return entry.isa < value; });
+    if (it == classes.end() || it->isa != isa || it->instance_size > size) continue;
+    it->instances++;
+    it->bytes += size;
+  }
+}
+
+// All registered classes, sorted by address. Everything needed while zones
+// are locked is looked up here, since the runtime may allocate.
+std::vector<ClassEntry> RegisteredClasses() {
+  unsigned int count = 0;
+  Class* class_list = objc_copyClassList(&count);
+
+  std::vector<ClassEntry> classes;
+  classes.reserve(count);
+  for (unsigned int i = 0; i < count; i++) {
+    classes.push_back(ClassEntry{
+        .isa = reinterpret_cast<uintptr_t>((__bridge void*)class_list[i]),
+        .instance_size = class_getInstanceSize(class_list[i]),
+        .name = class_getName(class_list[i]),
+    });
+  }
+  free(class_list);
+
+  std::sort(classes.begin(), classes.end(),
+            [](const ClassEntry& a, const ClassEntry& b) { return a.isa < b.isa; });
+  return classes;
+}
+
+}  // namespace
+
+HeapSample::Result HeapSample::Collect(size_t max_classes) {
+  uint64_t start_ns = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  Result result;
+
+  std::vector<ClassEntry> classes = RegisteredClasses();
+  uintptr_t isa_mask = &objc_debug_isa_class_mask ? objc_debug_isa_class_mask : ~uintptr_t{0};
+
+  vm_address_t* addresses = nullptr;
+  unsigned int zone_count = 0;
+  if (malloc_get_all_zones(mach_task_self(), nullptr, &addresses, &zone_count) != KERN_SUCCESS) {
+    zone_count = 0;
+  }
+
+  result.zones.reserve(zone_count);
+  for (unsigned int i = 0; i < zone_count; i++) {
+    malloc_zone_t* zone = reinterpret_cast<malloc_zone_t*>(addresses[i]);
+    malloc_introspection_t* introspect = zone->introspect;
+    if (!introspect || !introspect->enumerator || !introspect->force_lock ||
+        !introspect->force_unlock) {
+      continue;
+    }
+
+    Zone& sampled = result.zones.emplace_back();
+    const char* name = malloc_get_zone_name(zone);
+    sampled.name = name ? name : "unnamed";
+
+    RecordContext context{.zone = &sampled, .classes = &classes, .isa_mask = isa_mask};
+    introspect->force_lock(zone);
+    introspect->enumerator(mach_task_self(), &context, MALLOC_PTR_IN_USE_RANGE_TYPE, addresses[i],
+                           ReadLocalMemory, RecordRanges);
+    introspect->force_unlock(zone);
+  }
+
+  std::erase_if(classes, [](const ClassEntry& entry) { return entry.instances == 0; });
+  size_t reported = std::min(max_classes, classes.size());
+  std::partial_sort(classes.begin(), classes.begin() + reported, classes.end(),
+                    [](const ClassEntry& a, const ClassEntry& b) { return a.bytes > b.bytes; });
+  result.classes.reserve(reported);
+  for (size_t i = 0; i < reported; i++) {
+    result.classes.push_back(ClassUsage{
+        .name = classes[i].name,
+        .instances = classes[i].instances,
+        .bytes = classes[i].bytes,
+    });
+  }
+
+  result.duration_ns = clock_gettime_nsec_np(CLOCK_MONOTONIC) - start_ns;
+  return result;
+}
+
+}  // namespace santa
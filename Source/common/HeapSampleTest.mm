@@ -0,0 +1,97 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/HeapSample.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <objc/runtime.h>
+
+#include <cstdint>
+
+using santa::HeapSample;
+
+@interface HeapSampleTestObject : NSObject {
+  uint64_t _payload[8];
+}
+@end
+
+@implementation HeapSampleTestObject
+@end
+
+@interface HeapSampleTest : XCTestCase
+@end
+
+@implementation HeapSampleTest
+
+- (void)testSizeClassForSize {
+  XCTAssertEqual(HeapSample::SizeClassForSize(0), 0);
+  XCTAssertEqual(HeapSample::SizeClassForSize(1), 1);
+  XCTAssertEqual(HeapSample::SizeClassForSize(15), 4);
+  XCTAssertEqual(HeapSample::SizeClassForSize(16), 5);
+  XCTAssertEqual(HeapSample::SizeClassForSize(1ULL << 40), HeapSample::kSizeClasses - 1);
+  XCTAssertEqual(HeapSample::SizeClassForSize(UINT64_MAX), HeapSample::kSizeClasses - 1);
+}
+
+- (void)testCountsInstances {
+  const int kObjects = 500;
+  NSMutableArray* objects = [NSMutableArray arrayWithCapacity:kObjects];
+  for (int i = 0; i < kObjects; i++) {
+    [objects addObject:[[HeapSampleTestObject alloc] init]];
+  }
+
+  size_t instanceSize = class_getInstanceSize([HeapSampleTestObject class]);
+  HeapSample::Result result = HeapSample::Collect(SIZE_MAX);
+  bool found = false;
+  for (const auto& usage : result.classes) {
+    if (usage.name == "HeapSampleTestObject") {
+      found = true;
+      XCTAssertGreaterThanOrEqual(usage.instances, kObjects);
+      XCTAssertGreaterThanOrEqual(usage.bytes, kObjects * instanceSize);
+    }
+  }
+  XCTAssertTrue(found);
+  XCTAssertEqual(objects.count, kObjects);
+}
+
+- (void)testSizeClassesSumToZoneTotals {
+  HeapSample::Result result = HeapSample::Collect();
+  XCTAssertFalse(result.zones.empty());
+
+  uint64_t total_bytes = 0;
+  for (const auto& zone : result.zones) {
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+    for (const auto& size_class : zone.size_classes) {
+      blocks += size_class.blocks;
+      bytes += size_class.bytes;
+    }
+    XCTAssertEqual(blocks, zone.blocks);
+    XCTAssertEqual(bytes, zone.bytes);
+    total_bytes += zone.bytes;
+  }
+  XCTAssertGreaterThan(total_bytes, 0);
+}
+
+- (void)testMaxClasses {
+  XCTAssertLessThanOrEqual(HeapSample::Collect(3).classes.size(), 3);
+  XCTAssertTrue(HeapSample::Collect(0).classes.empty());
+
+  HeapSample::Result result = HeapSample::Collect();
+  for (size_t i = 1; i < result.classes.size(); i++) {
+    XCTAssertGreaterThanOrEqual(result.classes[i - 1].bytes, result.classes[i].bytes);
+  }
+}
+
+@end
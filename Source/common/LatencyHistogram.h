@@ -0,0 +1,165 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_LATENCYHISTOGRAM_H
+#define SANTA_COMMON_LATENCYHISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace santa {
+
+// A histogram of nanosecond latencies with log-linear buckets, in the style of
+// HdrHistogram.
+//
+// Values are bucketed by their power of two, and each power of two is split
+// into 8 linear sub-buckets, so a value is known to within 12.5% regardless of
+// its magnitude. Values of 2^36ns (about 69 seconds) or more share the last
+// bucket.
+//
+// Recording is lock-free and only touches counters in one of a few stripes,
+// chosen per thread, so threads recording at the same time mostly don't share
+// cache lines. Stripes are merged when a snapshot is taken.
+class LatencyHistogram {
+ public:
+  static constexpr size_t kSubBucketBits = 3;
+  static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+  static constexpr size_t kMaxValueBits = 36;
+  static constexpr size_t kNumBuckets = kSubBuckets * (kMaxValueBits - kSubBucketBits + 1);
+
+  class Snapshot {
+   public:
+    uint64_t Count() const { return count_; }
+    uint64_t Max() const { return max_; }
+
+    // Returns the upper bound of the bucket holding the value at the given
+    // percentile, in the range [0, 100], capped to the largest recorded value.
+    // Returns 0 if the snapshot is empty.
+    uint64_t ValueAtPercentile(double percentile) const {
+      if (count_ == 0) {
+        return 0;
+      }
+
+      double clamped = std::clamp(percentile, 0.0, 100.0);
+      uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(clamped / 100.0 * count_ + 0.5), 1);
+      uint64_t seen = 0;
+      for (size_t i = 0; i < kNumBuckets; i++) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+          return std::min(BucketUpperBound(i), max_);
+        }
+      }
+      return max_;
+    }
+
+    uint64_t BucketCount(size_t bucket) const { return buckets_[bucket]; }
+
+   private:
+    friend class LatencyHistogram;
+
+    std::array<uint64_t, kNumBuckets> buckets_ = {};
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+  };
+
+  LatencyHistogram() = default;
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  // Negative values, e.g. a missed deadline, are recorded as 0.
+  void Record(int64_t nanos) {
+    uint64_t value = nanos > 0 ? static_cast<uint64_t>(nanos) : 0;
+    Stripe& stripe = stripes_[ThreadStripe()];
+    stripe.buckets[BucketForValue(value)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = stripe.max.load(std::memory_order_relaxed);
+    while (value > max &&
+           !stripe.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Merge all stripes. When reset is true, the counts are cleared so the next
+  // snapshot only covers values recorded after this one. Values recorded while
+  // the snapshot is being taken are counted in either this snapshot or the
+  // next one.
+  Snapshot TakeSnapshot(bool reset) {
+    Snapshot snapshot;
+    for (Stripe& stripe : stripes_) {
+      for (size_t i = 0; i < kNumBuckets; i++) {
+        uint64_t count = reset ? stripe.buckets[i].exchange(0, std::memory_order_relaxed)
+                               : stripe.buckets[i].load(std::memory_order_relaxed);
+        snapshot.buckets_[i] += count;
+        snapshot.count_ += count;
+      }
+      uint64_t max = reset ? stripe.max.exchange(0, std::memory_order_relaxed)
+                           : stripe.max.load(std::memory_order_relaxed);
+      snapshot.max_ = std::max(snapshot.max_, max);
+    }
+    return snapshot;
+  }
+
+  static size_t BucketForValue(uint64_t value) {
+    if (value < kSubBuckets) {
+      return static_cast<size_t>(value);
+    }
+
+    size_t exponent = std::bit_width(value) - 1;
+    if (exponent >= kMaxValueBits) {
+      return kNumBuckets - 1;
+    }
+    size_t shift = exponent - kSubBucketBits;
+    size_t sub_bucket = (value >> shift) & (kSubBuckets - 1);
+    return kSubBuckets * (shift + 1) + sub_bucket;
+  }
+
+  // The largest value that falls in the bucket.
+  static uint64_t BucketUpperBound(size_t bucket) {
+    if (bucket < kSubBuckets) {
+      return bucket;
+    }
+    if (bucket >= kNumBuckets - 1) {
+      return UINT64_MAX;
+    }
+
+    size_t shift = bucket / kSubBuckets - 1;
+    uint64_t sub_bucket = bucket % kSubBuckets;
+    return ((kSubBuckets + sub_bucket + 1) << shift) - 1;
+  }
+
+ private:
+  static constexpr size_t kStripes = 4;
+
+  struct alignas(64) Stripe {
+    std::array<std::atomic<uint32_t>, kNumBuckets> buckets = {};
+    std::atomic<uint64_t> max = 0;
+  };
+
+  // Threads are spread over the stripes in the order they first record.
+  static size_t ThreadStripe() {
+    static std::atomic<size_t> next_stripe = 0;
+    thread_local size_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % kStripes;
+    return stripe;
+  }
+
+  std::array<Stripe, kStripes> stripes_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_LATENCYHISTOGRAM_H
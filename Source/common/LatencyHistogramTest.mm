@@ -0,0 +1,119 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/LatencyHistogram.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using santa::LatencyHistogram;
+
+@interface LatencyHistogramTest : XCTestCase
+@end
+
+@implementation LatencyHistogramTest
+
+- (void)testBucketBounds {
+  // Every value must fall within its bucket, and above the previous one
+  for (uint64_t value = 0; value < (1ULL << 24); value += 1 + value / 97) {
+    size_t bucket = LatencyHistogram::BucketForValue(value);
+    XCTAssertLessThanOrEqual(value, LatencyHistogram::BucketUpperBound(bucket));
+    if (bucket > 0) {
+      XCTAssertGreaterThan(value, LatencyHistogram::BucketUpperBound(bucket - 1));
+    }
+  }
+
+  // Small values are exact
+  for (uint64_t value = 0; value < LatencyHistogram::kSubBuckets; value++) {
+    XCTAssertEqual(LatencyHistogram::BucketUpperBound(LatencyHistogram::BucketForValue(value)),
+                   value);
+  }
+
+  // Very large values share the last bucket
+  XCTAssertEqual(LatencyHistogram::BucketForValue(1ULL << 40), LatencyHistogram::kNumBuckets - 1);
+  XCTAssertEqual(LatencyHistogram::BucketForValue(UINT64_MAX), LatencyHistogram::kNumBuckets - 1);
+}
+
+- (void)testPercentiles {
+  LatencyHistogram histogram;
+  XCTAssertEqual(histogram.TakeSnapshot(false).ValueAtPercentile(50), 0);
+
+  for (int i = 1; i <= 1000; i++) {
+    histogram.Record(i * 1000);
+  }
+
+  LatencyHistogram::Snapshot snapshot = histogram.TakeSnapshot(false);
+  XCTAssertEqual(snapshot.Count(), 1000);
+  XCTAssertEqual(snapshot.Max(), 1000000);
+
+  for (double percentile : {1.0, 50.0, 90.0, 99.0}) {
+    uint64_t want = percentile * 10 * 1000;
+    uint64_t got = snapshot.ValueAtPercentile(percentile);
+    XCTAssertGreaterThanOrEqual(got, want);
+    XCTAssertLessThanOrEqual(got, want * 9 / 8);
+  }
+
+  // The top percentile is exact
+  XCTAssertEqual(snapshot.ValueAtPercentile(100), 1000000);
+}
+
+- (void)testNegativeValuesRecordedAsZero {
+  LatencyHistogram histogram;
+  histogram.Record(-5);
+  histogram.Record(0);
+
+  LatencyHistogram::Snapshot snapshot = histogram.TakeSnapshot(false);
+  XCTAssertEqual(snapshot.BucketCount(0), 2);
+  XCTAssertEqual(snapshot.Max(), 0);
+}
+
+- (void)testReset {
+  LatencyHistogram histogram;
+  histogram.Record(100);
+
+  XCTAssertEqual(histogram.TakeSnapshot(false).Count(), 1);
+  XCTAssertEqual(histogram.TakeSnapshot(true).Count(), 1);
+
+  LatencyHistogram::Snapshot snapshot = histogram.TakeSnapshot(false);
+  XCTAssertEqual(snapshot.Count(), 0);
+  XCTAssertEqual(snapshot.Max(), 0);
+}
+
+- (void)testConcurrentRecording {
+  LatencyHistogram histogram;
+  const int kThreads = 8;
+  const int kValuesPerThread = 10000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&histogram, t] {
+      for (int i = 0; i < kValuesPerThread; i++) {
+        histogram.Record(t * kValuesPerThread + i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  LatencyHistogram::Snapshot snapshot = histogram.TakeSnapshot(true);
+  XCTAssertEqual(snapshot.Count(), kThreads * kValuesPerThread);
+  XCTAssertEqual(snapshot.Max(), kThreads * kValuesPerThread - 1);
+}
+
+@end
@@ -24,11 +24,16 @@
 @interface MOLAuthenticatingURLSession : NSObject <NSURLSessionDelegate, NSURLSessionDataDelegate>
 
 /**
-  Returns a new NSURLSession configured with the correct delegate and session configuration.
+  Returns an NSURLSession configured with the correct delegate and session configuration.
 
-  You can either retrieve this instance and re-use it or keep calling session to get a new session
-  every time. The properties below, with the exception of userAgent, will be updated even in
-  already-created session objects.
+  The session is created on first use and the same session is returned on every call, so that
+  connections, negotiated TLS sessions and HTTP/2 streams are reused by all requests made through
+  this object. If the session is invalidated, the next call creates a new one. The properties below,
+  with the exception of userAgent, will be updated even in already-created session objects.
+
+  A client credential found during client certificate authentication is reused for later
+  challenges for up to an hour, or until the certificate expires or the client certificate
+  properties change.
 */
 @property(readonly) NSURLSession* session;
 
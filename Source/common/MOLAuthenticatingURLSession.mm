@@ -30,13 +30,24 @@ using ScopedCFDataRef = santa::ScopedCFTypeRef<CFDataRef>;
 using ScopedSecKeyRef = santa::ScopedCFTypeRef<SecKeyRef>;
 using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
 
+// How long a client credential found in the keychain is reused before it is looked up again, so
+// that a renewed certificate is picked up without restarting.
+static const NSTimeInterval kClientCredentialCacheLifetime = 3600;
+
 @interface MOLAuthenticatingURLSession ()
 @property NSURLSessionConfiguration* sessionConfig;
 @property(copy, nonatomic) NSArray* anchors;
 @property(readwrite, nonatomic) MOLCertificate* clientCertificate;
 @end
 
-@implementation MOLAuthenticatingURLSession
+@implementation MOLAuthenticatingURLSession {
+  NSURLSession* _session;
+
+  // The client credential from the last challenge, along with the settings it was found with.
+  NSURLCredential* _cachedClientCredential;
+  NSArray* _cachedClientCredentialKey;
+  NSDate* _cachedClientCredentialExpiry;
+}
 
 - (instancetype)initWithSessionConfiguration:(NSURLSessionConfiguration*)configuration {
   self = [super init];
@@ -56,7 +67,14 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
 #pragma mark Session Fetching
 
 - (NSURLSession*)session {
-  return [NSURLSession sessionWithConfiguration:self.sessionConfig delegate:self delegateQueue:nil];
+  @synchronized(self) {
+    if (!_session) {
+      _session = [NSURLSession sessionWithConfiguration:self.sessionConfig
+                                               delegate:self
+                                          delegateQueue:nil];
+    }
+    return _session;
+  }
 }
 
 #pragma mark User Agent property
@@ -122,6 +140,7 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
   NSURLProtectionSpace* protectionSpace = challenge.protectionSpace;
 
   if (challenge.previousFailureCount > 0) {
+    [self clearCachedClientCredential];
     completionHandler(NSURLSessionAuthChallengeCancelAuthenticationChallenge, nil);
     return;
   }
@@ -146,7 +165,7 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
   NSString* authMethod = [protectionSpace authenticationMethod];
 
   if (authMethod == NSURLAuthenticationMethodClientCertificate) {
-    NSURLCredential* cred = [self clientCredentialForProtectionSpace:protectionSpace];
+    NSURLCredential* cred = [self cachedClientCredentialForProtectionSpace:protectionSpace];
     if (cred) {
       completionHandler(NSURLSessionAuthChallengeUseCredential, cred);
       return;
@@ -170,6 +189,12 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
   completionHandler(NSURLSessionAuthChallengePerformDefaultHandling, nil);
 }
 
+- (void)URLSession:(NSURLSession*)session didBecomeInvalidWithError:(NSError*)error {
+  @synchronized(self) {
+    if (_session == session) _session = nil;
+  }
+}
+
 - (void)URLSession:(NSURLSession*)session
                           task:(NSURLSessionTask*)task
     willPerformHTTPRedirection:(NSHTTPURLResponse*)response
@@ -204,6 +229,52 @@ using ScopedSecTrustRef = santa::ScopedCFTypeRef<SecTrustRef>;
 
 #pragma mark Private Helpers for URLSession:didReceiveChallenge:completionHandler:
 
+///
+///  Returns the client credential found for a previous challenge if the client certificate
+///  settings, and the issuers the server asked for, haven't changed and it hasn't expired.
+///  Otherwise the credential is looked up again. Finding a credential can mean searching the whole
+///  keychain, which isn't worth doing for every connection to the same server.
+///
+- (NSURLCredential*)cachedClientCredentialForProtectionSpace:
+    (NSURLProtectionSpace*)protectionSpace {
+  NSArray* key = @[
+    self.clientCertFile ?: [NSNull null],
+    self.clientCertPassword ?: [NSNull null],
+    self.clientCertCommonName ?: [NSNull null],
+    self.clientCertIssuerCn ?: [NSNull null],
+    protectionSpace.distinguishedNames ?: [NSNull null],
+  ];
+
+  @synchronized(self) {
+    if (_cachedClientCredential && [_cachedClientCredentialKey isEqual:key] &&
+        [_cachedClientCredentialExpiry timeIntervalSinceNow] > 0) {
+      return _cachedClientCredential;
+    }
+  }
+
+  NSURLCredential* cred = [self clientCredentialForProtectionSpace:protectionSpace];
+  if (!cred) return nil;
+
+  NSDate* expiry = [NSDate dateWithTimeIntervalSinceNow:kClientCredentialCacheLifetime];
+  NSDate* validUntil = self.clientCertificate.validUntil;
+  if (validUntil) expiry = [expiry earlierDate:validUntil];
+
+  @synchronized(self) {
+    _cachedClientCredential = cred;
+    _cachedClientCredentialKey = key;
+    _cachedClientCredentialExpiry = expiry;
+  }
+  return cred;
+}
+
+- (void)clearCachedClientCredential {
+  @synchronized(self) {
+    _cachedClientCredential = nil;
+    _cachedClientCredentialKey = nil;
+    _cachedClientCredentialExpiry = nil;
+  }
+}
+
 ///
 ///  Handles the process of locating a valid client certificate for authentication.
 ///  Operates in one of four modes, depending on the configuration in config.plist
@@ -58,4 +58,19 @@
   XCTAssertEqualObjects(got, want, @"");
 }
 
+- (void)testSessionIsReused {
+  MOLAuthenticatingURLSession* s = [[MOLAuthenticatingURLSession alloc] init];
+  NSURLSession* session = s.session;
+  XCTAssertNotNil(session);
+  XCTAssertEqual(s.session, session);
+  XCTAssertEqual(session.delegate, s);
+
+  // Other instances get their own session
+  MOLAuthenticatingURLSession* s2 = [[MOLAuthenticatingURLSession alloc] init];
+  XCTAssertNotEqual(s2.session, session);
+
+  [session invalidateAndCancel];
+  [s2.session invalidateAndCancel];
+}
+
 @end
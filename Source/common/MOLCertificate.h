@@ -18,6 +18,8 @@
 /** An Objective-C wrapper around `SecCertificateRef` objects provided by the Security framework.
 
   Accessors are read-only properties and access to each property is cached for future use.
+  Properties are only decoded when first accessed, and accessors are safe to call from any
+  thread.
 
   `MOLCertificate` objects can be passed over an XPC connection freely, though the receiving
   end will not benefit from any previously cached properties and the underlying SecCertificateRef
@@ -51,6 +53,25 @@
 */
 - (instancetype)initWithCertificateDataPEM:(NSString*)certData;
 
+/**
+  Returns the process-wide `MOLCertificate` for the certificate, creating it if there isn't
+  one yet. Certificate chains mostly share the same few intermediates and roots, which are then
+  only decoded and held once, however many chains they appear in.
+
+  @param certRef A valid `SecCertificateRef`. If an equal certificate is already interned, its
+      `certRef` is used instead.
+*/
++ (instancetype)internedCertificateWithSecCertificateRef:(SecCertificateRef)certRef;
+
+/**
+  Returns the process-wide `MOLCertificate` for the certificate data, creating it if there isn't
+  one yet. The data is not parsed if the certificate is already interned.
+
+  @param certData DER-encoded certificate data.
+  @return The interned `MOLCertificate` or `nil` if the input is not a DER-encoded certificate.
+*/
++ (instancetype)internedCertificateWithCertificateDataDER:(NSData*)certData;
+
 /**
   Returns an array of `MOLCertificate's` for all of the certificates in `pemData`.
 
@@ -60,7 +81,7 @@
 + (NSArray*)certificatesFromPEM:(NSString*)pemData;
 
 /**
-  Returns an array of `MOLCertificate's` for each SecCertificateRef in `array`.
+  Returns an array of interned `MOLCertificate's` for each SecCertificateRef in `array`.
 
   @param array NSArray of SecCertificateRef's.
   @return An array of `MOLCertificate` objects for each SecCertificateRef in `array`.
@@ -18,19 +18,39 @@
 #import <CommonCrypto/CommonDigest.h>
 #import <Foundation/Foundation.h>
 #import <Security/Security.h>
+#include <os/lock.h>
 
 @interface MOLCertificate ()
-///  A container for cached property values.
-@property NSMutableDictionary* memoizedData;
-
 ///  Re-declare the certRef property as readwrite.
 @property(readwrite) SecCertificateRef certRef;
 @end
 
-@implementation MOLCertificate
+@implementation MOLCertificate {
+  ///  A container for cached property values, guarded by _memoLock.
+  NSMutableDictionary* _memoizedData;
+  os_unfair_lock _memoLock;
+}
 
 static NSString* const kCertDataKey = @"certData";
 
+/**
+  Interned certificates, keyed by the SHA-256 of their DER encoding. Values are weak so that
+  certificates nothing else refers to are still freed.
+*/
+static NSMapTable<NSString*, MOLCertificate*>* gInternedCerts;
+static os_unfair_lock gInternedCertsLock = OS_UNFAIR_LOCK_INIT;
+
+static NSString* SHA256ForData(NSData* data) {
+  unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256([data bytes], (CC_LONG)[data length], digest);
+
+  NSMutableString* hexDigest = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+  for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+    [hexDigest appendFormat:@"%02x", digest[i]];
+  }
+  return hexDigest;
+}
+
 #pragma mark Init/Dealloc
 
 - (instancetype)initWithSecCertificateRef:(SecCertificateRef)certRef {
@@ -39,10 +59,64 @@ static NSString* const kCertDataKey = @"certData";
   if (self) {
     _certRef = certRef;
     CFRetain(_certRef);
+    _memoizedData = [NSMutableDictionary dictionary];
+    _memoLock = OS_UNFAIR_LOCK_INIT;
   }
   return self;
 }
 
+#pragma mark Interning
+
+/**
+  Returns the interned certificate with the given DER encoding, creating it with the block if
+  there isn't one. The block is called without holding the lock.
+*/
++ (instancetype)internedCertificateWithCertificateData:(NSData*)certData
+                                                create:(MOLCertificate* (^)(void))create {
+  if (!certData.length) return nil;
+  certData = [certData copy];
+  NSString* sha256 = SHA256ForData(certData);
+
+  os_unfair_lock_lock(&gInternedCertsLock);
+  MOLCertificate* cert = [gInternedCerts objectForKey:sha256];
+  os_unfair_lock_unlock(&gInternedCertsLock);
+  if (cert) return cert;
+
+  MOLCertificate* newCert = create();
+  if (!newCert) return nil;
+  [newCert memoizeValue:certData forKey:NSStringFromSelector(@selector(certData))];
+  [newCert memoizeValue:sha256 forKey:NSStringFromSelector(@selector(SHA256))];
+
+  // Another thread may have interned the same certificate in the meantime.
+  os_unfair_lock_lock(&gInternedCertsLock);
+  if (!gInternedCerts) gInternedCerts = [NSMapTable strongToWeakObjectsMapTable];
+  cert = [gInternedCerts objectForKey:sha256];
+  if (!cert) {
+    [gInternedCerts setObject:newCert forKey:sha256];
+    cert = newCert;
+  }
+  os_unfair_lock_unlock(&gInternedCertsLock);
+  return cert;
+}
+
++ (instancetype)internedCertificateWithSecCertificateRef:(SecCertificateRef)certRef {
+  if (!certRef) return nil;
+  NSData* certData = CFBridgingRelease(SecCertificateCopyData(certRef));
+  return [self internedCertificateWithCertificateData:certData
+                                               create:^{
+                                                 return [[MOLCertificate alloc]
+                                                     initWithSecCertificateRef:certRef];
+                                               }];
+}
+
++ (instancetype)internedCertificateWithCertificateDataDER:(NSData*)certData {
+  return [self internedCertificateWithCertificateData:certData
+                                               create:^{
+                                                 return [[MOLCertificate alloc]
+                                                     initWithCertificateDataDER:certData];
+                                               }];
+}
+
 - (instancetype)initWithCertificateDataDER:(NSData*)certData {
   SecCertificateRef cert = SecCertificateCreateWithData(NULL, (__bridge CFDataRef)certData);
 
@@ -116,7 +190,7 @@ static NSString* const kCertDataKey = @"certData";
   for (id object in array) {
     if (CFGetTypeID((__bridge CFTypeRef)object) == SecCertificateGetTypeID()) {
       SecCertificateRef cert = (__bridge SecCertificateRef)object;
-      MOLCertificate* molCert = [[MOLCertificate alloc] initWithSecCertificateRef:cert];
+      MOLCertificate* molCert = [MOLCertificate internedCertificateWithSecCertificateRef:cert];
       if (molCert) [newArray addObject:molCert];
     }
   }
@@ -164,69 +238,89 @@ static NSString* const kCertDataKey = @"certData";
 - (instancetype)initWithCoder:(NSCoder*)decoder {
   NSData* certData = [decoder decodeObjectOfClass:[NSData class] forKey:kCertDataKey];
   if ([certData length] == 0) return nil;
-  SecCertificateRef cert = SecCertificateCreateWithData(NULL, (__bridge CFDataRef)certData);
-  self = [self initWithSecCertificateRef:cert];
-  if (cert) CFRelease(cert);
-  return self;
+  // Certificates arriving over XPC are mostly the same few intermediates and roots, so the
+  // interned certificate is returned in place of a new one.
+  return [MOLCertificate
+      internedCertificateWithCertificateData:certData
+                                      create:^MOLCertificate* {
+                                        SecCertificateRef cert = SecCertificateCreateWithData(
+                                            NULL, (__bridge CFDataRef)certData);
+                                        MOLCertificate* c =
+                                            [[MOLCertificate alloc] initWithSecCertificateRef:cert];
+                                        if (cert) CFRelease(cert);
+                                        return c;
+                                      }];
 }
 
 #pragma mark Private Accessors
 
+///  Caches a value for the property with the given name, unless one is already cached.
+- (void)memoizeValue:(id)value forKey:(NSString*)key {
+  os_unfair_lock_lock(&_memoLock);
+  if (!_memoizedData[key]) _memoizedData[key] = value ?: [NSNull null];
+  os_unfair_lock_unlock(&_memoLock);
+}
+
 /**
   For a given selector, caches the value that selector would return on subsequent invocations,
   using the provided block to get the value on the first invocation.
 
-  Assumes the selector's value will never change.
+  Assumes the selector's value will never change. Certificates are shared between threads, so
+  the cache is guarded by a lock. The block is called without holding the lock, as it may use
+  other memoized values; if two threads race, both compute the value and the first is kept.
 */
 - (id)memoizedSelector:(SEL)selector forBlock:(id (^)(void))block {
   NSString* selName = NSStringFromSelector(selector);
 
-  if (!self.memoizedData) {
-    self.memoizedData = [NSMutableDictionary dictionary];
-  }
+  os_unfair_lock_lock(&_memoLock);
+  id val = _memoizedData[selName];
+  os_unfair_lock_unlock(&_memoLock);
 
-  if (!self.memoizedData[selName]) {
-    id val = block();
-    if (val) {
-      self.memoizedData[selName] = val;
-    } else {
-      self.memoizedData[selName] = [NSNull null];
-    }
+  if (!val) {
+    [self memoizeValue:block() forKey:selName];
+    os_unfair_lock_lock(&_memoLock);
+    val = _memoizedData[selName];
+    os_unfair_lock_unlock(&_memoLock);
   }
 
   // Return the value if there is one, or nil if the value is NSNull
-  return self.memoizedData[selName] != [NSNull null] ? self.memoizedData[selName] : nil;
+  return val != [NSNull null] ? val : nil;
 }
 
-- (NSDictionary*)allCertificateValues {
-  return
-      [self memoizedSelector:_cmd
-                    forBlock:^id {
-                      return CFBridgingRelease(SecCertificateCopyValues(self.certRef, NULL, NULL));
-                    }];
+/**
+  Returns the decoded value of a single field of the certificate. Only the requested field is
+  decoded, as decoding all of them, including every extension, is much more expensive when
+  most callers only read a name or two.
+
+  @param key The OID of the field, e.g. `kSecOIDX509V1SubjectName`.
+*/
+- (NSDictionary*)certificateValueForKey:(NSString*)key {
+  NSDictionary* values = CFBridgingRelease(
+      SecCertificateCopyValues(self.certRef, (__bridge CFArrayRef) @[ key ], NULL));
+  return values[key];
 }
 
 - (NSDictionary*)x509SubjectName {
-  return [self
-      memoizedSelector:_cmd
-              forBlock:^id {
-                return [self allCertificateValues][(__bridge NSString*)kSecOIDX509V1SubjectName];
-              }];
+  return [self memoizedSelector:_cmd
+                       forBlock:^id {
+                         return [self
+                             certificateValueForKey:(__bridge NSString*)kSecOIDX509V1SubjectName];
+                       }];
 }
 
 - (NSDictionary*)x509IssuerName {
-  return [self
-      memoizedSelector:_cmd
-              forBlock:^id {
-                return [self allCertificateValues][(__bridge NSString*)kSecOIDX509V1IssuerName];
-              }];
+  return [self memoizedSelector:_cmd
+                       forBlock:^id {
+                         return [self
+                             certificateValueForKey:(__bridge NSString*)kSecOIDX509V1IssuerName];
+                       }];
 }
 
 - (NSDictionary*)x509SubjectAltName {
   return [self memoizedSelector:_cmd
                        forBlock:^id {
-                         return
-                             [self allCertificateValues][(__bridge NSString*)kSecOIDSubjectAltName];
+                         return [self
+                             certificateValueForKey:(__bridge NSString*)kSecOIDSubjectAltName];
                        }];
 }
 
@@ -277,25 +371,6 @@ static NSString* const kCertDataKey = @"certData";
   }
 }
 
-/**
-  Retrieve the specified date from the certificate's values and convert from a reference date
-  to an NSDate object.
-
-  @param key The identifier for the date: e.g. `kSecOIDX509V1ValiditityNotBefore`
-  @return An `NSDate` representing the date and time the certificate is valid from or expires.
-*/
-- (NSDate*)dateForX509Key:(NSString*)key {
-  NSDictionary* curCertVal = [self allCertificateValues][key];
-  NSNumber* value = curCertVal[(__bridge NSString*)kSecPropertyKeyValue];
-
-  NSTimeInterval interval = [value doubleValue];
-  if (interval) {
-    return [NSDate dateWithTimeIntervalSinceReferenceDate:interval];
-  }
-
-  return nil;
-}
-
 #pragma mark Public Accessors
 
 - (NSString*)SHA1 {
@@ -319,32 +394,17 @@ static NSString* const kCertDataKey = @"certData";
 }
 
 - (NSString*)SHA256 {
-  return [self
-      memoizedSelector:_cmd
-              forBlock:^id {
-                unsigned char SHA256Digest[CC_SHA256_DIGEST_LENGTH];
-                CC_SHA256([self.certData bytes], (CC_LONG)[self.certData length], SHA256Digest);
-                NSString* const SHA256FormatString =
-                    @"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x"
-                     "%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x";
-
-                return [[NSString alloc]
-                    initWithFormat:SHA256FormatString, SHA256Digest[0], SHA256Digest[1],
-                                   SHA256Digest[2], SHA256Digest[3], SHA256Digest[4],
-                                   SHA256Digest[5], SHA256Digest[6], SHA256Digest[7],
-                                   SHA256Digest[8], SHA256Digest[9], SHA256Digest[10],
-                                   SHA256Digest[11], SHA256Digest[12], SHA256Digest[13],
-                                   SHA256Digest[14], SHA256Digest[15], SHA256Digest[16],
-                                   SHA256Digest[17], SHA256Digest[18], SHA256Digest[19],
-                                   SHA256Digest[20], SHA256Digest[21], SHA256Digest[22],
-                                   SHA256Digest[23], SHA256Digest[24], SHA256Digest[25],
-                                   SHA256Digest[26], SHA256Digest[27], SHA256Digest[28],
-                                   SHA256Digest[29], SHA256Digest[30], SHA256Digest[31]];
-              }];
+  return [self memoizedSelector:_cmd
+                       forBlock:^id {
+                         return SHA256ForData(self.certData);
+                       }];
 }
 
 - (NSData*)certData {
-  return CFBridgingRelease(SecCertificateCopyData(self.certRef));
+  return [self memoizedSelector:_cmd
+                       forBlock:^id {
+                         return CFBridgingRelease(SecCertificateCopyData(self.certRef));
+                       }];
 }
 
 - (NSString*)commonName {
@@ -389,19 +449,19 @@ static NSString* const kCertDataKey = @"certData";
 }
 
 - (NSDate*)validFrom {
-  return [self
-      memoizedSelector:_cmd
-              forBlock:^id {
-                return [self dateForX509Key:(__bridge NSString*)kSecOIDX509V1ValidityNotBefore];
-              }];
+  return [self memoizedSelector:_cmd
+                       forBlock:^id {
+                         return CFBridgingRelease(
+                             SecCertificateCopyNotValidBeforeDate(self.certRef));
+                       }];
 }
 
 - (NSDate*)validUntil {
-  return [self
-      memoizedSelector:_cmd
-              forBlock:^id {
-                return [self dateForX509Key:(__bridge NSString*)kSecOIDX509V1ValidityNotAfter];
-              }];
+  return [self memoizedSelector:_cmd
+                       forBlock:^id {
+                         return CFBridgingRelease(
+                             SecCertificateCopyNotValidAfterDate(self.certRef));
+                       }];
 }
 
 - (NSString*)issuerCommonName {
@@ -448,8 +508,8 @@ static NSString* const kCertDataKey = @"certData";
   return
       [[self memoizedSelector:_cmd
                      forBlock:^id {
-                       NSDictionary* dict =
-                           [self allCertificateValues][(__bridge NSString*)kSecOIDBasicConstraints];
+                       NSDictionary* dict = [self
+                           certificateValueForKey:(__bridge NSString*)kSecOIDBasicConstraints];
                        return [self x509ValueForLabel:@"Certificate Authority" fromDictionary:dict];
                      }] isEqual:@"Yes"];
 }
@@ -459,7 +519,7 @@ static NSString* const kCertDataKey = @"certData";
       memoizedSelector:_cmd
               forBlock:^id {
                 NSDictionary* dict =
-                    [self allCertificateValues][(__bridge NSString*)kSecOIDX509V1SerialNumber];
+                    [self certificateValueForKey:(__bridge NSString*)kSecOIDX509V1SerialNumber];
                 return dict[(__bridge NSString*)kSecPropertyKeyValue];
               }];
 }
@@ -205,6 +205,53 @@
   XCTAssertEqualObjects(sut1, sut2);
 }
 
+- (void)testInterning {
+  MOLCertificate* sut1 =
+      [MOLCertificate internedCertificateWithCertificateDataDER:self.testDataDER1];
+  MOLCertificate* sut2 =
+      [MOLCertificate internedCertificateWithCertificateDataDER:[self.testDataDER1 mutableCopy]];
+  XCTAssertNotNil(sut1);
+  XCTAssertEqual(sut1, sut2);
+  XCTAssertEqualObjects(sut1.certData, self.testDataDER1);
+  XCTAssertEqualObjects(sut1.commonName, @"Google Internet Authority G2");
+
+  MOLCertificate* other = [[MOLCertificate alloc] initWithCertificateDataDER:self.testDataDER1];
+  XCTAssertNotEqual(other, sut1);
+  XCTAssertEqual([MOLCertificate internedCertificateWithSecCertificateRef:other.certRef], sut1);
+  XCTAssertEqual([MOLCertificate certificatesFromArray:@[ (__bridge id)other.certRef ]][0], sut1);
+
+  MOLCertificate* sut3 =
+      [MOLCertificate internedCertificateWithCertificateDataDER:self.testDataDER2];
+  XCTAssertNotNil(sut3);
+  XCTAssertNotEqual(sut3, sut1);
+
+  XCTAssertNil([MOLCertificate internedCertificateWithCertificateDataDER:[NSData data]]);
+  XCTAssertNil([MOLCertificate
+      internedCertificateWithCertificateDataDER:[@"not a cert"
+                                                    dataUsingEncoding:NSUTF8StringEncoding]]);
+}
+
+- (void)testConcurrentAccess {
+  MOLCertificate* sut = [[MOLCertificate alloc] initWithCertificateDataPEM:self.testDataPEM1];
+  NSMutableArray* commonNames = [NSMutableArray array];
+  NSLock* lock = [[NSLock alloc] init];
+
+  dispatch_apply(64, DISPATCH_APPLY_AUTO, ^(size_t i) {
+    NSString* cn = sut.commonName;
+    XCTAssertNotNil(sut.SHA256);
+    XCTAssertNotNil(sut.validUntil);
+    XCTAssertEqualObjects(sut.orgName, @"Google Inc");
+    [lock lock];
+    [commonNames addObject:cn];
+    [lock unlock];
+  });
+
+  XCTAssertEqual(commonNames.count, 64);
+  for (NSString* cn in commonNames) {
+    XCTAssertEqualObjects(cn, @"Google Internet Authority G2");
+  }
+}
+
 - (void)testDescription {
   MOLCertificate* sut = [[MOLCertificate alloc] initWithCertificateDataPEM:self.testDataPEM1];
 
@@ -0,0 +1,141 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_MPSCRINGBUFFER_H
+#define SANTA_COMMON_MPSCRINGBUFFER_H
+
+#import <Foundation/Foundation.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "Source/common/SNTLogging.h"
+
+namespace santa {
+
+// A bounded, lock-free ring buffer with any number of producers and a single
+// consumer.
+//
+// Unlike RingBuffer, which evicts the oldest value to make room, Enqueue fails
+// when the buffer is full and leaves the new value with the caller to decide
+// what to do with it. The capacity is rounded up to a power of two, and is at
+// least two.
+//
+// Enqueue may be called from any thread. Dequeue must only be called from one
+// thread at a time.
+template <typename T>
+class MPSCRingBuffer {
+ public:
+  MPSCRingBuffer(size_t capacity) {
+    if (capacity == 0) {
+      LOGE(@"MPSCRingBuffer capacity must be greater than 0");
+      std::abort();
+    }
+
+    // Cell sequence numbers can't distinguish a full cell from a free one on
+    // the next lap with a single cell, so at least two are needed.
+    capacity_ = std::bit_ceil(std::max<size_t>(capacity, 2));
+    mask_ = capacity_ - 1;
+    cells_ = std::make_unique<Cell[]>(capacity_);
+    for (size_t i = 0; i < capacity_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPSCRingBuffer(const MPSCRingBuffer& other) = delete;
+  MPSCRingBuffer& operator=(const MPSCRingBuffer& other) = delete;
+
+  inline size_t Capacity() const { return capacity_; }
+
+  // Approximate number of values in the buffer. Exact when no other thread is
+  // enqueuing or dequeuing.
+  inline size_t Size() const {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  inline bool Empty() const { return Size() == 0; }
+
+  // Adds val to the buffer and returns true, or returns false without
+  // modifying val if the buffer is full.
+  bool Enqueue(T&& val) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        // The cell is free for this position, try to claim it.
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The cell still holds the value from the previous lap.
+        return false;
+      } else {
+        // Another producer claimed this position first.
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->value.emplace(std::move(val));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Removes and returns the oldest value, or std::nullopt if the buffer is
+  // empty or the oldest value is still being added.
+  std::optional<T> Dequeue() {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Cell& cell = cells_[pos & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+      return std::nullopt;
+    }
+
+    std::optional<T> value = std::move(cell.value);
+    cell.value.reset();
+    cell.sequence.store(pos + capacity_, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_relaxed);
+    return value;
+  }
+
+ private:
+  // Each cell's sequence number tells producers and the consumer whose turn it
+  // is: a producer may fill the cell for position p when it equals p, and the
+  // consumer may empty it once it equals p + 1.
+  struct alignas(64) Cell {
+    std::atomic<size_t> sequence;
+    std::optional<T> value;
+  };
+
+  size_t capacity_;
+  size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  // Producers and the consumer update different ends of the buffer, so keep
+  // them on separate cache lines.
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) std::atomic<size_t> head_{0};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_MPSCRINGBUFFER_H
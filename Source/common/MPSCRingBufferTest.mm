@@ -0,0 +1,121 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/MPSCRingBuffer.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using santa::MPSCRingBuffer;
+
+@interface MPSCRingBufferTest : XCTestCase
+@end
+
+@implementation MPSCRingBufferTest
+
+- (void)testBasic {
+  MPSCRingBuffer<int> rb(4);
+  XCTAssertEqual(rb.Capacity(), 4);
+  XCTAssertTrue(rb.Empty());
+  XCTAssertFalse(rb.Dequeue().has_value());
+
+  XCTAssertTrue(rb.Enqueue(1));
+  XCTAssertTrue(rb.Enqueue(2));
+  XCTAssertEqual(rb.Size(), 2);
+
+  std::optional<int> res = rb.Dequeue();
+  XCTAssertTrue(res.has_value());
+  XCTAssertEqual(res.value(), 1);
+  res = rb.Dequeue();
+  XCTAssertTrue(res.has_value());
+  XCTAssertEqual(res.value(), 2);
+
+  XCTAssertTrue(rb.Empty());
+  XCTAssertFalse(rb.Dequeue().has_value());
+}
+
+- (void)testCapacityRoundsUp {
+  MPSCRingBuffer<int> rb(5);
+  XCTAssertEqual(rb.Capacity(), 8);
+
+  MPSCRingBuffer<int> one(1);
+  XCTAssertEqual(one.Capacity(), 2);
+  XCTAssertTrue(one.Enqueue(1));
+  XCTAssertTrue(one.Enqueue(2));
+  XCTAssertFalse(one.Enqueue(3));
+}
+
+- (void)testFullRejectsWithoutConsuming {
+  MPSCRingBuffer<std::unique_ptr<int>> rb(2);
+  XCTAssertTrue(rb.Enqueue(std::make_unique<int>(1)));
+  XCTAssertTrue(rb.Enqueue(std::make_unique<int>(2)));
+
+  // The rejected value is left with the caller.
+  auto val = std::make_unique<int>(3);
+  XCTAssertFalse(rb.Enqueue(std::move(val)));
+  XCTAssertNotEqual(val, nullptr);
+  XCTAssertEqual(*val, 3);
+
+  // Making room allows it to be added, and order is preserved across laps.
+  XCTAssertEqual(*rb.Dequeue().value(), 1);
+  XCTAssertTrue(rb.Enqueue(std::move(val)));
+  XCTAssertEqual(*rb.Dequeue().value(), 2);
+  XCTAssertEqual(*rb.Dequeue().value(), 3);
+  XCTAssertFalse(rb.Dequeue().has_value());
+}
+
+- (void)testConcurrentProducers {
+  static constexpr int kProducers = 4;
+  static constexpr int kPerProducer = 10000;
+  MPSCRingBuffer<int> rb(64);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&rb, p] {
+      for (int i = 0; i < kPerProducer; ++i) {
+        while (!rb.Enqueue(p * kPerProducer + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Every value arrives exactly once, and each producer's values arrive in the
+  // order they were added.
+  std::vector<int> next(kProducers, 0);
+  int received = 0;
+  while (received < kProducers * kPerProducer) {
+    std::optional<int> val = rb.Dequeue();
+    if (!val.has_value()) {
+      std::this_thread::yield();
+      continue;
+    }
+    int producer = *val / kPerProducer;
+    XCTAssertEqual(*val % kPerProducer, next[producer]);
+    next[producer]++;
+    received++;
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+  XCTAssertTrue(rb.Empty());
+}
+
+@end
@@ -0,0 +1,91 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_MEMORYATTRIBUTION_H
+#define SANTA_COMMON_MEMORYATTRIBUTION_H
+
+#import <Foundation/Foundation.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#import "Source/common/SNTMetricSet.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Attributes santad's memory to the subsystems holding it, so that a large
+// footprint can be traced to e.g. the caches or the process tree.
+//
+// Each subsystem registers a function estimating the bytes it holds, and
+// several registrations may share a subsystem name, in which case they are
+// summed. Estimates only cover the data structures each subsystem knows the
+// size of, so alongside them the process's physical footprint and the bytes
+// in use in each malloc zone are reported for comparison.
+class MemoryAttribution {
+ public:
+  struct ZoneUsage {
+    std::string name;
+    uint64_t bytes_in_use;
+    uint64_t bytes_allocated;
+    uint64_t blocks_in_use;
+  };
+
+  // The attribution used by santad.
+  static MemoryAttribution& Shared();
+
+  MemoryAttribution() = default;
+
+  MemoryAttribution(const MemoryAttribution&) = delete;
+  MemoryAttribution& operator=(const MemoryAttribution&) = delete;
+
+  // Track the bytes held by a subsystem. bytes_fn is called each time usage is
+  // collected, and may return std::nullopt once whatever it measures no longer
+  // exists, in which case it is no longer called.
+  void Register(NSString* subsystem, std::function<std::optional<uint64_t>()> bytes_fn);
+
+  // The bytes held by each subsystem, in the order they were first registered.
+  std::vector<std::pair<NSString*, uint64_t>> CollectSubsystems();
+
+  // The process's physical footprint, as shown by Activity Monitor, or
+  // std::nullopt if it couldn't be read.
+  static std::optional<uint64_t> PhysicalFootprint();
+
+  // Usage of each of the process's malloc zones.
+  static std::vector<ZoneUsage> CollectZones();
+
+  // Export the /santa/memory/subsystem_bytes gauge, using the subsystem name as
+  // the "Subsystem" field value, the /santa/memory/footprint_bytes gauge and
+  // the /santa/memory/malloc_zone_bytes gauge, by "Zone" and "State".
+  void RegisterMetrics(SNTMetricSet* metric_set);
+
+ private:
+  struct Entry {
+    NSString* subsystem;
+    std::function<std::optional<uint64_t>()> bytes_fn;
+  };
+
+  absl::Mutex mtx_;
+  std::vector<std::shared_ptr<Entry>> entries_ ABSL_GUARDED_BY(mtx_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_MEMORYATTRIBUTION_H
@@ -0,0 +1,145 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/MemoryAttribution.h"
+
+#include <mach/mach.h>
+#include <malloc/malloc.h>
+
+#include <algorithm>
+
+#include "Source/common/String.h"
+
+namespace santa {
+
+MemoryAttribution& MemoryAttribution::Shared() {
+  static MemoryAttribution* attribution = new MemoryAttribution();
+  return *attribution;
+}
+
+void MemoryAttribution::Register(NSString* subsystem,
+                                 std::function<std::optional<uint64_t>()> bytes_fn) {
+  auto entry = std::make_shared<Entry>(Entry{
+      .subsystem = [subsystem copy],
+      .bytes_fn = std::move(bytes_fn),
+  });
+
+  absl::MutexLock lock(mtx_);
+  entries_.push_back(std::move(entry));
+}
+
+std::vector<std::pair<NSString*, uint64_t>> MemoryAttribution::CollectSubsystems() {
+  std::vector<std::shared_ptr<Entry>> entries;
+  {
+    absl::MutexLock lock(mtx_);
+    entries = entries_;
+  }
+
+  // Called without the lock held, so a subsystem may register more entries.
+  std::vector<std::pair<NSString*, uint64_t>> subsystems;
+  std::vector<std::shared_ptr<Entry>> gone;
+  for (const auto& entry : entries) {
+    std::optional<uint64_t> bytes = entry->bytes_fn();
+    if (!bytes.has_value()) {
+      gone.push_back(entry);
+      continue;
+    }
+
+    auto it = std::find_if(subsystems.begin(), subsystems.end(), [&entry](const auto& subsystem) {
+      return [subsystem.first isEqualToString:entry->subsystem];
+    });
+    if (it == subsystems.end()) {
+      subsystems.emplace_back(entry->subsystem, *bytes);
+    } else {
+      it->second += *bytes;
+    }
+  }
+
+  if (!gone.empty()) {
+    absl::MutexLock lock(mtx_);
+    std::erase_if(entries_, [&gone](const auto& entry) {
+      return std::find(gone.begin(), gone.end(), entry) != gone.end();
+    });
+  }
+
+  return subsystems;
+}
+
+std::optional<uint64_t> MemoryAttribution::PhysicalFootprint() {
+  task_vm_info_data_t info;
+  mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+  if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+    return std::nullopt;
+  }
+  return info.phys_footprint;
+}
+
+std::vector<MemoryAttribution::ZoneUsage> MemoryAttribution::CollectZones() {
+  vm_address_t* addresses = nullptr;
+  unsigned int count = 0;
+  if (malloc_get_all_zones(mach_task_self(), nullptr, &addresses, &count) != KERN_SUCCESS) {
+    return {};
+  }
+
+  std::vector<ZoneUsage> zones;
+  zones.reserve(count);
+  for (unsigned int i = 0; i < count; i++) {
+    malloc_zone_t* zone = reinterpret_cast<malloc_zone_t*>(addresses[i]);
+    malloc_statistics_t stats = {};
+    malloc_zone_statistics(zone, &stats);
+
+    const char* name = malloc_get_zone_name(zone);
+    zones.push_back(ZoneUsage{
+        .name = name ? name : "unnamed",
+        .bytes_in_use = stats.size_in_use,
+        .bytes_allocated = stats.size_allocated,
+        .blocks_in_use = stats.blocks_in_use,
+    });
+  }
+  return zones;
+}
+
+void MemoryAttribution::RegisterMetrics(SNTMetricSet* metric_set) {
+  SNTMetricInt64Gauge* subsystem_gauge =
+      [metric_set int64GaugeWithName:@"/santa/memory/subsystem_bytes"
+                          fieldNames:@[ @"Subsystem" ]
+                            helpText:@"Approximate bytes held by each subsystem"];
+  SNTMetricInt64Gauge* footprint_gauge =
+      [metric_set int64GaugeWithName:@"/santa/memory/footprint_bytes"
+                          fieldNames:@[]
+                            helpText:@"Physical footprint of the process in bytes"];
+  SNTMetricInt64Gauge* zone_gauge =
+      [metric_set int64GaugeWithName:@"/santa/memory/malloc_zone_bytes"
+                          fieldNames:@[ @"Zone", @"State" ]
+                            helpText:@"Bytes of each malloc zone that are in use by allocations, "
+                                     @"or allocated from the system"];
+
+  [metric_set registerCallback:^{
+    for (const auto& [subsystem, bytes] : CollectSubsystems()) {
+      [subsystem_gauge set:(long long)bytes forFieldValues:@[ subsystem ]];
+    }
+
+    if (std::optional<uint64_t> footprint = PhysicalFootprint()) {
+      [footprint_gauge set:(long long)*footprint forFieldValues:@[]];
+    }
+
+    for (const ZoneUsage& zone : CollectZones()) {
+      NSString* name = StringToNSString(zone.name);
+      [zone_gauge set:(long long)zone.bytes_in_use forFieldValues:@[ name, @"InUse" ]];
+      [zone_gauge set:(long long)zone.bytes_allocated forFieldValues:@[ name, @"Allocated" ]];
+    }
+  }];
+}
+
+}  // namespace santa
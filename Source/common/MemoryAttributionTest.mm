@@ -0,0 +1,94 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/MemoryAttribution.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <cstdint>
+#include <optional>
+
+#import "Source/common/SNTMetricSet.h"
+
+using santa::MemoryAttribution;
+
+@interface MemoryAttributionTest : XCTestCase
+@end
+
+@implementation MemoryAttributionTest
+
+- (void)testSubsystemsAreSummedInRegistrationOrder {
+  MemoryAttribution memory;
+  memory.Register(@"b", [] { return std::optional<uint64_t>(10); });
+  memory.Register(@"a", [] { return std::optional<uint64_t>(5); });
+  memory.Register(@"b", [] { return std::optional<uint64_t>(7); });
+
+  auto subsystems = memory.CollectSubsystems();
+  XCTAssertEqual(subsystems.size(), 2);
+  XCTAssertEqualObjects(subsystems[0].first, @"b");
+  XCTAssertEqual(subsystems[0].second, 17);
+  XCTAssertEqualObjects(subsystems[1].first, @"a");
+  XCTAssertEqual(subsystems[1].second, 5);
+}
+
+- (void)testExpiredEntriesAreForgotten {
+  MemoryAttribution memory;
+  int calls = 0;
+  memory.Register(@"gone", [&calls]() -> std::optional<uint64_t> {
+    calls++;
+    return std::nullopt;
+  });
+  memory.Register(@"kept", [] { return std::optional<uint64_t>(1); });
+
+  auto subsystems = memory.CollectSubsystems();
+  XCTAssertEqual(subsystems.size(), 1);
+  XCTAssertEqualObjects(subsystems[0].first, @"kept");
+
+  memory.CollectSubsystems();
+  XCTAssertEqual(calls, 1);
+}
+
+- (void)testProcessUsage {
+  std::optional<uint64_t> footprint = MemoryAttribution::PhysicalFootprint();
+  XCTAssertTrue(footprint.has_value());
+  XCTAssertGreaterThan(*footprint, 0);
+
+  bool found_default = false;
+  for (const auto& zone : MemoryAttribution::CollectZones()) {
+    XCTAssertLessThanOrEqual(zone.bytes_in_use, zone.bytes_allocated);
+    if (zone.name == "DefaultMallocZone") {
+      found_default = true;
+      XCTAssertGreaterThan(zone.bytes_in_use, 0);
+    }
+  }
+  XCTAssertTrue(found_default);
+}
+
+- (void)testMetrics {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
+  MemoryAttribution memory;
+  memory.Register(@"test", [] { return std::optional<uint64_t>(1234); });
+  memory.RegisterMetrics(metricSet);
+
+  [metricSet export];
+
+  SNTMetricInt64Gauge* subsystemBytes =
+      [metricSet int64GaugeWithName:@"/santa/memory/subsystem_bytes"
+                         fieldNames:@[ @"Subsystem" ]
+                           helpText:@"Approximate bytes held by each subsystem"];
+  XCTAssertEqual([subsystemBytes getGaugeValueForFieldValues:@[ @"test" ]], 1234);
+}
+
+@end
@@ -0,0 +1,30 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/// Category on NSData providing the option of getting zstd compressed data.
+///
+/// A dictionary, as produced by `zstd --train`, improves the compression of
+/// small payloads that share a lot of content. Data compressed with a
+/// dictionary must be decompressed with the same one.
+@interface NSData (Zstd)
+
+- (NSData*)zstdCompressed;
+- (NSData*)zstdCompressedWithDictionary:(NSData*)dictionary;
+
+- (NSData*)zstdDecompressed;
+- (NSData*)zstdDecompressedWithDictionary:(NSData*)dictionary;
+
+@end
@@ -0,0 +1,100 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/common/NSData+Zstd.h"
+
+#include <memory>
+
+#include "zstd.h"
+
+static constexpr int kCompressionLevel = 3;
+
+@implementation NSData (Zstd)
+
+- (NSData*)zstdCompressed {
+  return [self zstdCompressedWithDictionary:nil];
+}
+
+- (NSData*)zstdCompressedWithDictionary:(NSData*)dictionary {
+  if (![self length]) return nil;
+
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+  if (!cctx) return nil;
+  if (ZSTD_isError(
+          ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, kCompressionLevel))) {
+    return nil;
+  }
+  if (dictionary.length &&
+      ZSTD_isError(ZSTD_CCtx_loadDictionary(cctx.get(), dictionary.bytes, dictionary.length))) {
+    return nil;
+  }
+
+  NSMutableData* data = [NSMutableData dataWithLength:ZSTD_compressBound([self length])];
+  size_t size =
+      ZSTD_compress2(cctx.get(), [data mutableBytes], [data length], [self bytes], [self length]);
+  if (ZSTD_isError(size)) return nil;
+
+  data.length = size;
+  return data;
+}
+
+- (NSData*)zstdDecompressed {
+  return [self zstdDecompressedWithDictionary:nil];
+}
+
+- (NSData*)zstdDecompressedWithDictionary:(NSData*)dictionary {
+  if (![self length]) return nil;
+
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+  if (!dctx) return nil;
+  if (dictionary.length &&
+      ZSTD_isError(ZSTD_DCtx_loadDictionary(dctx.get(), dictionary.bytes, dictionary.length))) {
+    return nil;
+  }
+
+  // Frames don't have to record their decompressed size, so the output grows
+  // as needed.
+  NSMutableData* data = [NSMutableData dataWithLength:ZSTD_DStreamOutSize()];
+  ZSTD_inBuffer in = {[self bytes], [self length], 0};
+  ZSTD_outBuffer out = {[data mutableBytes], [data length], 0};
+  size_t status = 0;
+  while (in.pos < in.size) {
+    if (out.pos == out.size) {
+      data.length += ZSTD_DStreamOutSize();
+      out.dst = [data mutableBytes];
+      out.size = [data length];
+    }
+    status = ZSTD_decompressStream(dctx.get(), &out, &in);
+    if (ZSTD_isError(status)) return nil;
+  }
+
+  // Flush output held back once all input has been consumed.
+  while (status != 0) {
+    if (out.pos == out.size) {
+      data.length += ZSTD_DStreamOutSize();
+      out.dst = [data mutableBytes];
+      out.size = [data length];
+    }
+    size_t pos = out.pos;
+    status = ZSTD_decompressStream(dctx.get(), &out, &in);
+    if (ZSTD_isError(status)) return nil;
+    // The last frame is truncated.
+    if (out.pos == pos && out.pos < out.size) return nil;
+  }
+
+  data.length = out.pos;
+  return data;
+}
+
+@end
@@ -0,0 +1,73 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "Source/common/NSData+Zstd.h"
+
+@interface NSDataZstdTest : XCTestCase
+@end
+
+@implementation NSDataZstdTest
+
+- (NSData*)dataFromFixture:(NSString*)file {
+  NSString* path = [[NSBundle bundleForClass:[self class]] pathForResource:file ofType:nil];
+  XCTAssertNotNil(path, @"failed to load testdata: %@", file);
+  return [NSData dataWithContentsOfFile:path];
+}
+
+- (void)testRoundTrip {
+  NSData* sut = [self dataFromFixture:@"compression_test_uncompressed.json"];
+
+  NSData* compressed = [sut zstdCompressed];
+  XCTAssertNotNil(compressed);
+  XCTAssertLessThan(compressed.length, sut.length);
+  XCTAssertEqualObjects([compressed zstdDecompressed], sut);
+}
+
+- (void)testLargeRoundTrip {
+  // Bigger than a single streaming output buffer
+  NSMutableData* sut = [NSMutableData data];
+  NSData* fixture = [self dataFromFixture:@"compression_test_uncompressed.json"];
+  while (sut.length < 1024 * 1024) {
+    [sut appendData:fixture];
+  }
+
+  XCTAssertEqualObjects([[sut zstdCompressed] zstdDecompressed], sut);
+}
+
+- (void)testDictionaryRoundTrip {
+  NSData* dictionary = [self dataFromFixture:@"compression_test_uncompressed.json"];
+  NSData* sut = [@"{\"machine_id\":\"abc\"}" dataUsingEncoding:NSUTF8StringEncoding];
+  NSMutableData* payload = [dictionary mutableCopy];
+  [payload appendData:sut];
+
+  NSData* compressed = [payload zstdCompressedWithDictionary:dictionary];
+  XCTAssertLessThan(compressed.length, [payload zstdCompressed].length);
+  XCTAssertEqualObjects([compressed zstdDecompressedWithDictionary:dictionary], payload);
+  XCTAssertNotEqualObjects([compressed zstdDecompressed], payload);
+}
+
+- (void)testInvalidData {
+  XCTAssertNil([[NSData data] zstdCompressed]);
+  XCTAssertNil([[NSData data] zstdDecompressed]);
+  XCTAssertNil([[@"not zstd" dataUsingEncoding:NSUTF8StringEncoding] zstdDecompressed]);
+
+  NSData* compressed =
+      [[self dataFromFixture:@"compression_test_uncompressed.json"] zstdCompressed];
+  XCTAssertNil([[compressed subdataWithRange:NSMakeRange(0, compressed.length / 2)]
+      zstdDecompressed]);
+}
+
+@end
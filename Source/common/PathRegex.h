@@ -0,0 +1,53 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_PATHREGEX_H
+#define SANTA_COMMON_PATHREGEX_H
+
+#import <Foundation/Foundation.h>
+
+#include <memory>
+#include <string_view>
+
+#include "re2/re2.h"
+
+namespace santa {
+
+// A compiled regex for matching paths without converting them to NSString.
+//
+// Patterns from the config are written for NSRegularExpression (ICU syntax).
+// RE2 accepts most of the ICU syntax that makes sense for paths, but not all
+// of it (e.g. backreferences and lookaround), so callers must keep using the
+// NSRegularExpression when Create returns nullptr.
+class PathRegex {
+ public:
+  static std::unique_ptr<PathRegex> Create(std::string_view pattern);
+  static std::unique_ptr<PathRegex> Create(NSRegularExpression* regex);
+
+  explicit PathRegex(std::string_view pattern);
+
+  PathRegex(const PathRegex& other) = delete;
+  PathRegex& operator=(const PathRegex& other) = delete;
+
+  // Returns true if the regex matches anywhere in path, like
+  // -[NSRegularExpression rangeOfFirstMatchInString:options:range:].
+  bool Matches(std::string_view path) const;
+
+ private:
+  re2::RE2 re_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_PATHREGEX_H
@@ -0,0 +1,63 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/PathRegex.h"
+
+#include <memory>
+#include <string_view>
+
+#import "Source/common/SNTLogging.h"
+#include "re2/re2.h"
+
+namespace santa {
+
+namespace {
+
+re2::RE2::Options PathRegexOptions() {
+  re2::RE2::Options options;
+  // Patterns RE2 can't handle are expected and fall back to NSRegularExpression, so don't log them
+  // as errors.
+  options.set_log_errors(false);
+  return options;
+}
+
+}  // namespace
+
+std::unique_ptr<PathRegex> PathRegex::Create(std::string_view pattern) {
+  auto regex = std::make_unique<PathRegex>(pattern);
+  if (!regex->re_.ok()) {
+    LOGD(@"Unable to compile path regex with RE2, falling back to NSRegularExpression: %s",
+         regex->re_.error().c_str());
+    return nullptr;
+  }
+  return regex;
+}
+
+std::unique_ptr<PathRegex> PathRegex::Create(NSRegularExpression* regex) {
+  // Options passed to NSRegularExpression itself have no RE2 equivalent here. The config only ever
+  // uses inline flags, but don't guess if that changes.
+  if (!regex || regex.options != 0) {
+    return nullptr;
+  }
+  NSString* pattern = regex.pattern;
+  return Create(std::string_view(pattern.UTF8String ?: ""));
+}
+
+PathRegex::PathRegex(std::string_view pattern) : re_(pattern, PathRegexOptions()) {}
+
+bool PathRegex::Matches(std::string_view path) const {
+  return re2::RE2::PartialMatch(path, re_);
+}
+
+}  // namespace santa
@@ -0,0 +1,82 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/PathRegex.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string_view>
+
+using santa::PathRegex;
+
+@interface PathRegexTest : XCTestCase
+@end
+
+@implementation PathRegexTest
+
+- (void)testMatches {
+  std::unique_ptr<PathRegex> re = PathRegex::Create("^/foo/(bar|baz)/.*\\.txt");
+  XCTAssertNotEqual(re, nullptr);
+
+  XCTAssertTrue(re->Matches("/foo/bar/a.txt"));
+  XCTAssertTrue(re->Matches("/foo/baz/b/c.txt.bak"));
+  XCTAssertFalse(re->Matches("/foo/qux/a.txt"));
+  XCTAssertFalse(re->Matches("/x/foo/bar/a.txt"));
+
+  // Paths aren't necessarily NUL terminated.
+  std::string_view path("/foo/bar/a.txtXXXX", 14);
+  XCTAssertTrue(re->Matches(path));
+}
+
+- (void)testMatchesAnywhereWhenUnanchored {
+  std::unique_ptr<PathRegex> re = PathRegex::Create("/node_modules/");
+  XCTAssertNotEqual(re, nullptr);
+  XCTAssertTrue(re->Matches("/Users/me/src/node_modules/left-pad/index.js"));
+  XCTAssertFalse(re->Matches("/Users/me/src/index.js"));
+}
+
+- (void)testInlineFlags {
+  std::unique_ptr<PathRegex> re = PathRegex::Create("(?i)^/Users/.*/Desktop/");
+  XCTAssertNotEqual(re, nullptr);
+  XCTAssertTrue(re->Matches("/users/me/desktop/file"));
+}
+
+- (void)testUnsupportedPatterns {
+  // Lookaround and backreferences are valid ICU but not RE2.
+  XCTAssertEqual(PathRegex::Create("^/foo/(?!bar)"), nullptr);
+  XCTAssertEqual(PathRegex::Create("^/(a)/\\1"), nullptr);
+  XCTAssertEqual(PathRegex::Create("^/foo/("), nullptr);
+}
+
+- (void)testCreateFromNSRegularExpression {
+  XCTAssertEqual(PathRegex::Create((NSRegularExpression*)nil), nullptr);
+
+  NSRegularExpression* nsre = [NSRegularExpression regularExpressionWithPattern:@"^/foo/.*"
+                                                                        options:0
+                                                                          error:NULL];
+  std::unique_ptr<PathRegex> re = PathRegex::Create(nsre);
+  XCTAssertNotEqual(re, nullptr);
+  XCTAssertTrue(re->Matches("/foo/bar"));
+  XCTAssertFalse(re->Matches("/bar/foo"));
+
+  // Options set on the NSRegularExpression aren't translated.
+  nsre = [NSRegularExpression regularExpressionWithPattern:@"^/foo/.*"
+                                                   options:NSRegularExpressionCaseInsensitive
+                                                     error:NULL];
+  XCTAssertEqual(PathRegex::Create(nsre), nullptr);
+}
+
+@end
@@ -39,6 +39,9 @@ class PowerMonitor : public PassKey<PowerMonitor> {
  public:
   static std::unique_ptr<PowerMonitor> Create(PowerEventBlock callback);
 
+  // Returns true unless the system is currently running on battery power.
+  static bool IsOnExternalPower();
+
   PowerMonitor(PassKey, PowerEventBlock callback, io_connect_t connect,
                IONotificationPortRef notify_port, io_object_t notifier, dispatch_queue_t queue);
 
@@ -15,6 +15,8 @@
 #include "Source/common/PowerMonitor.h"
 
 #include <IOKit/IOMessage.h>
+#include <IOKit/ps/IOPSKeys.h>
+#include <IOKit/ps/IOPowerSources.h>
 #include <IOKit/pwr_mgt/IOPMLib.h>
 
 #import "Source/common/SNTLogging.h"
@@ -56,6 +58,20 @@ std::unique_ptr<PowerMonitor> PowerMonitor::Create(PowerEventBlock callback) {
   return monitor;
 }
 
+bool PowerMonitor::IsOnExternalPower() {
+  CFTypeRef info = IOPSCopyPowerSourcesInfo();
+  if (!info) {
+    return true;
+  }
+
+  // Systems without a battery don't report a providing power source.
+  CFStringRef type = IOPSGetProvidingPowerSourceType(info);
+  bool external =
+      !type || CFStringCompare(type, CFSTR(kIOPSBatteryPowerValue), 0) != kCFCompareEqualTo;
+  CFRelease(info);
+  return external;
+}
+
 PowerMonitor::PowerMonitor(PassKey, PowerEventBlock callback, io_connect_t connect,
                            IONotificationPortRef notify_port, io_object_t notifier,
                            dispatch_queue_t queue)
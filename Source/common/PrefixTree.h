@@ -18,7 +18,13 @@
 
 #include <sys/syslimits.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #import "Source/common/SNTLogging.h"
 #include "absl/synchronization/mutex.h"
@@ -37,6 +43,7 @@ class PrefixTree {
   // Forward declaration
   enum class NodeType;
   class TreeNode;
+  struct Children;
 
  public:
   PrefixTree(uint32_t max_depth = PATH_MAX)
@@ -56,12 +63,13 @@ class PrefixTree {
 
   bool HasPrefix(const char* input) {
     absl::ReaderMutexLock lock(lock_);
-    return HasPrefixLocked(input);
+    return MatchLocked(input, true) != nullptr;
   }
 
   std::optional<ValueT> LookupLongestMatchingPrefix(const std::string& input) {
     absl::ReaderMutexLock lock(lock_);
-    return LookupLongestMatchingPrefixLocked(input);
+    TreeNode* match = MatchLocked(input.c_str(), false);
+    return match ? std::make_optional<ValueT>(match->value_) : std::nullopt;
   }
 
   /// Returns true if the tree contains any prefix or literal
@@ -72,7 +80,7 @@ class PrefixTree {
     }
 
     absl::ReaderMutexLock lock(lock_);
-    return ContainsLocked(input);
+    return MatchLocked(input, true) != nullptr;
   }
 
   void Reset() {
@@ -82,151 +90,132 @@ class PrefixTree {
     node_count_ = 0;
   }
 
+  /// Returns the number of nodes in the tree, not counting the root. Since
+  /// runs of bytes without branches are compressed into a single node, this
+  /// is at most twice the number of inserted strings.
   uint32_t NodeCount() {
     absl::ReaderMutexLock lock(lock_);
     return node_count_;
   }
 
+  /// Returns the approximate number of bytes allocated for the tree's nodes,
+  /// their child tables and any prefixes too long to be stored inline.
+  size_t MemoryUsageBytes() {
+    absl::ReaderMutexLock lock(lock_);
+    return MemoryUsageLocked(root_);
+  }
+
 #if SANTA_PREFIX_TREE_DEBUG
   void Print() {
-    std::vector<char> buf(max_depth_ + 1);
+    std::string path;
+    path.reserve(max_depth_);
 
     absl::ReaderMutexLock lock(lock_);
-    PrintLocked(root_, buf.data(), 0);
+    PrintNode(root_, path);
   }
 #endif
 
  private:
   ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_)
   bool InsertLocked(const char* input, ValueT value, NodeType node_type) {
+    size_t len = strlen(input);
+
+    // Empty strings are not supported
+    if (len == 0) {
+      return false;
+    }
+
+    if (len > max_depth_) {
+      DEBUG_LOG(@"Attempted to add a string that exceeded max depth: %zu", len);
+      return false;
+    }
+
     const char* p = input;
+    const char* end = input + len;
     TreeNode* node = root_;
 
-    while (*p) {
-      uint8_t cur_byte = (uint8_t)*p;
-
-      TreeNode* child_node = node->children_[cur_byte];
-      if (!child_node) {
-        // Current node doesn't exist...
-        // Create the rest of the nodes in the tree for the given string
-
-        // Keep a pointer to where this new branch starts from. If the
-        // input length exceeds max_depth, the new branch will need to
-        // be pruned.
-        TreeNode* branch_start_node = node;
-        uint8_t branch_start_byte = (uint8_t)*p;
-
-        do {
-          TreeNode* new_node = new TreeNode();
-          node->children_[cur_byte] = new_node;
-          node = new_node;
-          node_count_++;
-
-          // Check current depth...
-          if (p - input >= max_depth_) {
-            // Attempted to add a string that exceeded max depth
-            // Prune tree from start of this new branch
-            PruneLocked(branch_start_node->children_[branch_start_byte]);
-            branch_start_node->children_[branch_start_byte] = nullptr;
-
-            return false;
-          }
-
-          // Disabling clang format due to local/remote version differences.
-          // clang-format off
-          cur_byte = (uint8_t)*++p;
-          // clang-format on
-        } while (*p);
-
-        node->node_type_ = node_type;
-        node->value_ = value;
-
+    while (true) {
+      uint8_t cur_byte = (uint8_t)*p++;
+
+      TreeNode** child_slot = FindChild(node, cur_byte);
+      if (!child_slot) {
+        // No edge exists for the current byte. The rest of the input becomes
+        // the compressed prefix of a single new node.
+        TreeNode* new_node = new TreeNode(std::string_view(p, end - p));
+        new_node->node_type_ = node_type;
+        new_node->value_ = value;
+        AddChild(node, cur_byte, new_node);
+        node_count_++;
         return true;
-      } else if (*(p + 1) == '\0') {
-        // Current node exists and we're at the end of our input...
-        // Note: The current node's data will be overwritten
+      }
 
-        // Only increment node count if the previous node type wasn't already a
-        // prefix or literal type (in which case it was already counted)
-        if (child_node->node_type_ == NodeType::kInner) {
-          node_count_++;
-        }
+      TreeNode* child_node = *child_slot;
+      size_t matched =
+          CommonPrefixLength(child_node->prefix_, std::string_view(p, end - p));
+
+      if (matched < child_node->prefix_.size()) {
+        // The input ends or diverges partway through the child's compressed
+        // prefix. Split the child so that a node exists at that point.
+        TreeNode* split_node =
+            new TreeNode(std::string_view(child_node->prefix_).substr(0, matched));
+        uint8_t split_byte = (uint8_t)child_node->prefix_[matched];
+        child_node->prefix_.erase(0, matched + 1);
+        AddChild(split_node, split_byte, child_node);
+        *child_slot = split_node;
+        node_count_++;
+
+        child_node = split_node;
+      }
+
+      p += matched;
 
+      if (p == end) {
+        // Current node exists and we're at the end of our input...
+        // Note: The current node's data will be overwritten
         child_node->node_type_ = node_type;
         child_node->value_ = value;
         return true;
       }
 
       node = child_node;
-      p++;
     }
-
-    // Should only get here when input is an empty string
-    return false;
   }
 
+  /// Walks the tree along the input and returns the deepest node that
+  /// matches it, or the first one if `stop_at_first_match` is set. A prefix
+  /// node matches any input it leads, a literal node only matches exactly.
   ABSL_SHARED_LOCKS_REQUIRED(lock_)
-  bool HasPrefixLocked(const char* input) {
+  TreeNode* MatchLocked(const char* input, bool stop_at_first_match) {
     TreeNode* node = root_;
+    TreeNode* match = nullptr;
     const char* p = input;
 
     while (*p) {
-      node = node->children_[(uint8_t)*p++];
-
-      if (!node) {
+      TreeNode** child_slot = FindChild(node, (uint8_t)*p++);
+      if (!child_slot) {
         break;
       }
 
-      if (node->node_type_ == NodeType::kPrefix ||
-          (*p == '\0' && node->node_type_ == NodeType::kLiteral)) {
-        return true;
-      }
-    }
-
-    return false;
-  }
-
-  ABSL_SHARED_LOCKS_REQUIRED(lock_)
-  std::optional<ValueT> LookupLongestMatchingPrefixLocked(const std::string& input) {
-    TreeNode* node = root_;
-    TreeNode* match = nullptr;
-    const char* p = input.c_str();
-
-    while (*p) {
-      node = node->children_[(uint8_t)*p++];
+      node = *child_slot;
 
-      if (!node) {
+      // The whole compressed prefix must match to reach the node. Prefixes
+      // never contain a NUL, so this stops at the end of a shorter input.
+      size_t prefix_len = node->prefix_.size();
+      if (prefix_len && strncmp(p, node->prefix_.data(), prefix_len) != 0) {
         break;
       }
+      p += prefix_len;
 
       if (node->node_type_ == NodeType::kPrefix ||
           (*p == '\0' && node->node_type_ == NodeType::kLiteral)) {
         match = node;
+        if (stop_at_first_match) {
+          break;
+        }
       }
     }
 
-    return match ? std::make_optional<ValueT>(match->value_) : std::nullopt;
-  }
-
-  ABSL_SHARED_LOCKS_REQUIRED(lock_)
-  bool ContainsLocked(const char* input) {
-    TreeNode* node = root_;
-    const char* p = input;
-
-    while (*p) {
-      node = node->children_[(uint8_t)*p++];
-
-      if (!node) {
-        break;
-      }
-
-      if (node->node_type_ == NodeType::kPrefix ||
-          (*p == '\0' && node->node_type_ == NodeType::kLiteral)) {
-        return true;
-      }
-    }
-
-    return false;
+    return match;
   }
 
   ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_)
@@ -238,53 +227,160 @@ class PrefixTree {
     // For deep trees, a recursive approach will generate too many stack frames.
     // Since the depth of the tree is configurable, err on the side of caution
     // and use a "stack" to walk the tree in a non-recursive manner.
-    TreeNode** stack = new TreeNode*[node_count_ + 1];
-    if (!stack) {
-      LOGE(@"Unable to prune tree!");
-      return;
-    }
-
-    uint32_t count = 0;
+    std::vector<TreeNode*> stack;
 
     // Seed the "stack" with a starting node.
-    stack[count++] = target;
+    stack.push_back(target);
 
     // Start at the target node and walk the tree to find and delete all the
     // sub-nodes.
-    while (count) {
-      TreeNode* node = stack[--count];
+    while (!stack.empty()) {
+      TreeNode* node = stack.back();
+      stack.pop_back();
 
-      for (int i = 0; i < 256; ++i) {
-        if (!node->children_[i]) {
-          continue;
-        }
-        stack[count++] = node->children_[i];
-      }
+      ForEachChild(node, [&stack](uint8_t, TreeNode* child) {
+        stack.push_back(child);
+      });
 
       delete node;
-      --node_count_;
     }
-
-    delete[] stack;
   }
 
 #if SANTA_PREFIX_TREE_DEBUG
-  ABSL_SHARED_LOCKS_REQUIRED(lock_)
-  void PrintLocked(TreeNode* node, char* buf, uint32_t depth) {
-    for (size_t i = 0; i < 256; i++) {
-      TreeNode* cur_node = node->children_[i];
-      if (cur_node) {
-        buf[depth] = i;
-        if (cur_node->node_type_ != NodeType::kInner) {
-          printf("\t%s (type: %s)\n", buf,
-                 cur_node->node_type_ == NodeType::kPrefix ? "prefix" : "literal");
+  static void PrintNode(TreeNode* node, std::string& path) {
+    ForEachChild(node, [&path](uint8_t byte, TreeNode* child) {
+      size_t len = path.size();
+      path.push_back(byte);
+      path.append(child->prefix_);
+      if (child->node_type_ != NodeType::kInner) {
+        printf("\t%s (type: %s)\n", path.c_str(),
+               child->node_type_ == NodeType::kPrefix ? "prefix" : "literal");
+      }
+      PrintNode(child, path);
+      path.resize(len);
+    });
+  }
+#endif
+
+  static size_t CommonPrefixLength(std::string_view a, std::string_view b) {
+    size_t len = std::min(a.size(), b.size());
+    size_t i = 0;
+    while (i < len && a[i] == b[i]) {
+      i++;
+    }
+    return i;
+  }
+
+  static TreeNode** FindChild(TreeNode* node, uint8_t byte) {
+    Children* children = node->children_;
+    if (!children) {
+      return nullptr;
+    }
+
+    switch (children->kind_) {
+      case NodeKind::kNode4: return static_cast<Node4*>(children)->Find(byte);
+      case NodeKind::kNode16: return static_cast<Node16*>(children)->Find(byte);
+      case NodeKind::kNode48: return static_cast<Node48*>(children)->Find(byte);
+      case NodeKind::kNode256: return static_cast<Node256*>(children)->Find(byte);
+    }
+
+    return nullptr;
+  }
+
+  /// Adds a child for a byte that the node doesn't have a child for yet,
+  /// growing the node's children into the next larger kind when full.
+  static void AddChild(TreeNode* node, uint8_t byte, TreeNode* child) {
+    if (!node->children_) {
+      node->children_ = new Node4();
+    }
+
+    Children* children = node->children_;
+    switch (children->kind_) {
+      case NodeKind::kNode4:
+        if (children->count_ == Node4::kCapacity) {
+          node->children_ = Grow<Node4, Node16>(children);
+          return AddChild(node, byte, child);
+        }
+        static_cast<Node4*>(children)->Add(byte, child);
+        return;
+      case NodeKind::kNode16:
+        if (children->count_ == Node16::kCapacity) {
+          node->children_ = Grow<Node16, Node48>(children);
+          return AddChild(node, byte, child);
         }
-        PrintLocked(cur_node, buf, depth + 1);
-        buf[depth] = '\0';
+        static_cast<Node16*>(children)->Add(byte, child);
+        return;
+      case NodeKind::kNode48:
+        if (children->count_ == Node48::kCapacity) {
+          node->children_ = Grow<Node48, Node256>(children);
+          return AddChild(node, byte, child);
+        }
+        static_cast<Node48*>(children)->Add(byte, child);
+        return;
+      case NodeKind::kNode256:
+        static_cast<Node256*>(children)->Add(byte, child);
+        return;
+    }
+  }
+
+  /// Calls `f(byte, child)` for each child of the node in byte order.
+  template <typename F>
+  static void ForEachChild(TreeNode* node, F f) {
+    Children* children = node->children_;
+    if (!children) {
+      return;
+    }
+
+    switch (children->kind_) {
+      case NodeKind::kNode4: static_cast<Node4*>(children)->ForEach(f); return;
+      case NodeKind::kNode16: static_cast<Node16*>(children)->ForEach(f); return;
+      case NodeKind::kNode48: static_cast<Node48*>(children)->ForEach(f); return;
+      case NodeKind::kNode256: static_cast<Node256*>(children)->ForEach(f); return;
+    }
+  }
+
+  static size_t MemoryUsageLocked(TreeNode* node) {
+    size_t bytes = sizeof(TreeNode);
+    if (node->prefix_.capacity() > std::string().capacity()) {
+      bytes += node->prefix_.capacity() + 1;
+    }
+
+    if (Children* children = node->children_) {
+      switch (children->kind_) {
+        case NodeKind::kNode4: bytes += sizeof(Node4); break;
+        case NodeKind::kNode16: bytes += sizeof(Node16); break;
+        case NodeKind::kNode48: bytes += sizeof(Node48); break;
+        case NodeKind::kNode256: bytes += sizeof(Node256); break;
       }
     }
+
+    ForEachChild(node, [&bytes](uint8_t, TreeNode* child) {
+      bytes += MemoryUsageLocked(child);
+    });
+    return bytes;
+  }
+
+  template <typename From, typename To>
+  static Children* Grow(Children* from) {
+    To* to = new To();
+    auto add = [to](uint8_t byte, TreeNode* child) { to->Add(byte, child); };
+    static_cast<From*>(from)->ForEach(add);
+    delete static_cast<From*>(from);
+    return to;
+  }
+
+  static void DeleteChildren(Children* children) {
+    if (!children) {
+      return;
+    }
+
+    switch (children->kind_) {
+      case NodeKind::kNode4: delete static_cast<Node4*>(children); return;
+      case NodeKind::kNode16: delete static_cast<Node16*>(children); return;
+      case NodeKind::kNode48: delete static_cast<Node48*>(children); return;
+      case NodeKind::kNode256: delete static_cast<Node256*>(children); return;
+    }
   }
-#endif
 
   enum class NodeType {
     kInner = 0,
@@ -293,31 +389,143 @@ class PrefixTree {
   };
 
   ///
-  ///  TreeNode is a wrapper class that represents one byte.
-  ///  1 node can represent a whole ASCII character.
-  ///  For example a pointer to the 'A' node will be stored at children[0x41].
-  ///  It takes 1-4 nodes to represent a UTF-8 encoded Unicode character.
+  ///  The children of a node are stored in one of four layouts depending on
+  ///  how many there are, as in an adaptive radix tree:
+  ///    - Node4/Node16: sorted parallel arrays of key bytes and children.
+  ///    - Node48: a 256 entry byte-indexed table of slots into 48 children.
+  ///    - Node256: a full byte-indexed array of children.
   ///
-  ///  The path for "/🤘" would look like this:
-  ///      children[0x2f] -> children[0xf0] -> children[0x9f] -> children[0xa4]
-  ///      -> children[0x98]
+  ///  Most nodes in a tree of paths have a single child, so they only pay for
+  ///  a Node4 instead of 256 pointers.
   ///
-  ///  The path for "/dev" is:
-  ///      children[0x2f] -> children[0x64] -> children[0x65] -> children[0x76]
+  enum class NodeKind : uint8_t {
+    kNode4,
+    kNode16,
+    kNode48,
+    kNode256,
+  };
+
+  struct Children {
+    explicit Children(NodeKind kind) : kind_(kind), count_(0) {}
+    const NodeKind kind_;
+    uint16_t count_;
+  };
+
+  template <NodeKind Kind, uint16_t N>
+  struct SortedChildren : Children {
+    static constexpr uint16_t kCapacity = N;
+
+    SortedChildren() : Children(Kind) {}
+
+    TreeNode** Find(uint8_t byte) {
+      for (uint16_t i = 0; i < this->count_; i++) {
+        if (keys_[i] == byte) {
+          return &children_[i];
+        }
+      }
+      return nullptr;
+    }
+
+    void Add(uint8_t byte, TreeNode* child) {
+      uint16_t i = this->count_++;
+      for (; i > 0 && keys_[i - 1] > byte; i--) {
+        keys_[i] = keys_[i - 1];
+        children_[i] = children_[i - 1];
+      }
+      keys_[i] = byte;
+      children_[i] = child;
+    }
+
+    template <typename F>
+    void ForEach(F& f) {
+      for (uint16_t i = 0; i < this->count_; i++) {
+        f(keys_[i], children_[i]);
+      }
+    }
+
+    uint8_t keys_[N];
+    TreeNode* children_[N];
+  };
+
+  using Node4 = SortedChildren<NodeKind::kNode4, 4>;
+  using Node16 = SortedChildren<NodeKind::kNode16, 16>;
+
+  struct Node48 : Children {
+    static constexpr uint16_t kCapacity = 48;
+
+    Node48() : Children(NodeKind::kNode48), index_() {}
+
+    TreeNode** Find(uint8_t byte) {
+      return index_[byte] ? &children_[index_[byte] - 1] : nullptr;
+    }
+
+    void Add(uint8_t byte, TreeNode* child) {
+      children_[this->count_] = child;
+      index_[byte] = ++this->count_;
+    }
+
+    template <typename F>
+    void ForEach(F& f) {
+      for (int i = 0; i < 256; i++) {
+        if (index_[i]) {
+          f((uint8_t)i, children_[index_[i] - 1]);
+        }
+      }
+    }
+
+    // Slot of the child for each byte plus one, or 0 if there is none.
+    uint8_t index_[256];
+    TreeNode* children_[kCapacity];
+  };
+
+  struct Node256 : Children {
+    Node256() : Children(NodeKind::kNode256), children_() {}
+
+    TreeNode** Find(uint8_t byte) {
+      return children_[byte] ? &children_[byte] : nullptr;
+    }
+
+    void Add(uint8_t byte, TreeNode* child) {
+      children_[byte] = child;
+      this->count_++;
+    }
+
+    template <typename F>
+    void ForEach(F& f) {
+      for (int i = 0; i < 256; i++) {
+        if (children_[i]) {
+          f((uint8_t)i, children_[i]);
+        }
+      }
+    }
+
+    TreeNode* children_[256];
+  };
+
   ///
-  ///  Lookups of children are O(1).
+  ///  TreeNode represents a byte string in the tree, split into the byte
+  ///  that selects it in its parent's children and a compressed prefix of
+  ///  bytes that follow it but don't branch. UTF-8 encoded characters take
+  ///  1-4 bytes, and paths are treated as plain byte strings.
   ///
-  ///  Having the nodes represented by a smaller width, such as a nibble (1/2
-  ///  byte), would drastically decrease the memory footprint but would double
-  ///  required dereferences.
+  ///  Inserting "/dev/null" and "/dev/zero" into an empty tree results in:
+  ///      root -> '/' "dev/" -> 'n' "ull"
+  ///                         -> 'z' "ero"
   ///
-  ///  TODO(bur): Potentially convert this into a full on radix tree.
+  ///  Lookups cost one child search and one prefix comparison per node
+  ///  instead of one dereference per byte.
   ///
   class TreeNode {
    public:
-    TreeNode() : children_(), node_type_(NodeType::kInner) {}
-    ~TreeNode() = default;
-    TreeNode* children_[256];
+    explicit TreeNode(std::string_view prefix = {})
+        : prefix_(prefix), children_(nullptr), node_type_(NodeType::kInner) {}
+    ~TreeNode() { DeleteChildren(children_); }
+
+    TreeNode(const TreeNode&) = delete;
+    TreeNode& operator=(const TreeNode&) = delete;
+
+    std::string prefix_;
+    Children* children_;
     PrefixTree::NodeType node_type_;
     ValueT value_;
   };
@@ -143,27 +143,35 @@ using santa::Unit;
 
   XCTAssertEqual(tree.NodeCount(), 0);
 
-  // Start with a small string
+  // Start with a small string, which is compressed into a single node
   XCTAssertTrue(tree.InsertPrefix("asdf", 0));
-  XCTAssertEqual(tree.NodeCount(), 4);
+  XCTAssertEqual(tree.NodeCount(), 1);
 
   // Add a couple more characters to the existing string
   XCTAssertTrue(tree.InsertPrefix("asdfgh", 0));
-  XCTAssertEqual(tree.NodeCount(), 6);
+  XCTAssertEqual(tree.NodeCount(), 2);
 
   // Inserting a string that exceeds max depth doesn't increase node count
   XCTAssertFalse(tree.InsertPrefix(std::string(maxDepth + 10, 'A').c_str(), 0));
-  XCTAssertEqual(tree.NodeCount(), 6);
+  XCTAssertEqual(tree.NodeCount(), 2);
+
+  // A string of exactly max depth is allowed
+  XCTAssertTrue(tree.InsertPrefix(std::string(maxDepth, 'A').c_str(), 0));
+  XCTAssertEqual(tree.NodeCount(), 3);
 
   // Add a new string that is a prefix of an existing string
-  // This should increment the count by one since a new terminal node exists
+  // This should increment the count by one since the existing node is split
   XCTAssertTrue(tree.InsertPrefix("as", 0));
-  XCTAssertEqual(tree.NodeCount(), 7);
+  XCTAssertEqual(tree.NodeCount(), 4);
 
   // Re-inserting onto an existing node shouldn't modify the count
   tree.InsertLiteral("as", 0);
   tree.InsertPrefix("as", 0);
-  XCTAssertEqual(tree.NodeCount(), 7);
+  XCTAssertEqual(tree.NodeCount(), 4);
+
+  // Diverging partway through a node splits it and adds a new one
+  XCTAssertTrue(tree.InsertPrefix("asxy", 0));
+  XCTAssertEqual(tree.NodeCount(), 5);
 }
 
 - (void)testReset {
@@ -178,7 +186,7 @@ using santa::Unit;
 
   XCTAssertTrue(tree.HasPrefix("asdf"));
   XCTAssertTrue(tree.HasPrefix("qwerty"));
-  XCTAssertEqual(tree.NodeCount(), 10);
+  XCTAssertEqual(tree.NodeCount(), 2);
 
   tree.Reset();
   XCTAssertFalse(tree.HasPrefix("asdf"));
@@ -186,6 +194,71 @@ using santa::Unit;
   XCTAssertEqual(tree.NodeCount(), 0);
 }
 
+- (void)testMemoryUsage {
+  PrefixTree<int> tree;
+  size_t empty = tree.MemoryUsageBytes();
+
+  XCTAssertTrue(tree.InsertPrefix("/usr/local/bin/", 1));
+  size_t one = tree.MemoryUsageBytes();
+  XCTAssertGreaterThan(one, empty);
+
+  for (int i = 0; i < 100; i++) {
+    XCTAssertTrue(tree.InsertPrefix([NSString stringWithFormat:@"/opt/%d/", i].UTF8String, i));
+  }
+  XCTAssertGreaterThan(tree.MemoryUsageBytes(), one);
+
+  tree.Reset();
+  XCTAssertEqual(tree.MemoryUsageBytes(), empty);
+}
+
+- (void)testSplitNodes {
+  PrefixTree<int> tree;
+
+  XCTAssertTrue(tree.InsertPrefix("/usr/local/bin/", 1));
+  XCTAssertTrue(tree.InsertLiteral("/usr/lib", 2));
+  XCTAssertTrue(tree.InsertPrefix("/usr/", 3));
+
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/usr/local/bin/foo").value_or(0), 1);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/usr/lib").value_or(0), 2);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/usr/lib/foo").value_or(0), 3);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/usr/local/foo").value_or(0), 3);
+
+  // Inputs that end or diverge partway through a compressed node don't match it
+  XCTAssertFalse(tree.HasPrefix("/us"));
+  XCTAssertFalse(tree.HasPrefix("/usx/lib"));
+  XCTAssertFalse(tree.Contains("/usr"));
+  XCTAssertFalse(tree.LookupLongestMatchingPrefix("/usr").has_value());
+
+  // Split nodes are regular nodes once inserted into
+  XCTAssertTrue(tree.InsertLiteral("/usr/l", 4));
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/usr/l").value_or(0), 4);
+  XCTAssertEqual(tree.LookupLongestMatchingPrefix("/usr/li").value_or(0), 3);
+}
+
+- (void)testWideNodes {
+  PrefixTree<int> tree;
+
+  // Every byte value as a child of the same node, enough to grow the node
+  // through all of its layouts.
+  for (int i = 1; i < 256; i++) {
+    char s[] = {'/', (char)i, '/', '\0'};
+    XCTAssertTrue(tree.InsertPrefix(s, i));
+
+    for (int j = 1; j <= i; j += 17) {
+      char t[] = {'/', (char)j, '/', 'x', '\0'};
+      XCTAssertEqual(tree.LookupLongestMatchingPrefix(t).value_or(0), j);
+    }
+  }
+
+  for (int i = 1; i < 256; i++) {
+    char s[] = {'/', (char)i, '/', 'x', '\0'};
+    XCTAssertEqual(tree.LookupLongestMatchingPrefix(s).value_or(0), i);
+  }
+
+  XCTAssertFalse(tree.HasPrefix("/a"));
+  XCTAssertEqual(tree.NodeCount(), 256);
+}
+
 - (void)testComplexValues {
   class Foo {
    public:
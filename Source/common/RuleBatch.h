@@ -0,0 +1,45 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_RULEBATCH_H
+#define SANTA_COMMON_RULEBATCH_H
+
+#import <Foundation/Foundation.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTRule.h"
+#include "Source/common/rule_batch.pb.h"
+
+namespace santa {
+
+using ExecutionRuleBatch = ::santa::rulebatch::ExecutionRuleBatch;
+
+/// Returns the identifier normalized for the rule type in the same way as by
+/// SNTRule, or std::nullopt if the identifier is not valid for the type.
+std::optional<std::string> NormalizeRuleIdentifier(std::string_view identifier, SNTRuleType type);
+
+/// Validates and normalizes a batch rule in place, returning false for any rule
+/// that SNTRule would reject.
+bool NormalizeBatchRule(ExecutionRuleBatch::Rule& rule);
+
+/// Materializes a batch rule, for the few places that need an SNTRule.
+SNTRule* _Nullable RuleFromBatchRule(const ExecutionRuleBatch::Rule& rule);
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_RULEBATCH_H
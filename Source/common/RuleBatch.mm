@@ -0,0 +1,129 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/RuleBatch.h"
+
+#include <CommonCrypto/CommonCrypto.h>
+#include <Kernel/kern/cs_blobs.h>
+
+#include <algorithm>
+#include <cctype>
+
+#include "Source/common/String.h"
+
+namespace santa {
+
+namespace {
+
+constexpr size_t kExpectedTeamIDLength = 10;
+
+bool IsHex(std::string_view s) {
+  return std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isxdigit(c); });
+}
+
+bool IsAlnum(std::string_view s) {
+  return std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isalnum(c); });
+}
+
+std::string ToLower(std::string_view s) {
+  std::string out(s);
+  std::transform(out.begin(), out.end(), out.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return out;
+}
+
+std::string ToUpper(std::string_view s) {
+  std::string out(s);
+  std::transform(out.begin(), out.end(), out.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  return out;
+}
+
+std::optional<std::string> NormalizeHash(std::string_view identifier, size_t length) {
+  if (identifier.size() != length || !IsHex(identifier)) {
+    return std::nullopt;
+  }
+  return ToLower(identifier);
+}
+
+}  // namespace
+
+std::optional<std::string> NormalizeRuleIdentifier(std::string_view identifier, SNTRuleType type) {
+  if (identifier.empty()) {
+    return std::nullopt;
+  }
+
+  switch (type) {
+    case SNTRuleTypeBinary: [[fallthrough]];
+    case SNTRuleTypeCertificate: return NormalizeHash(identifier, CC_SHA256_DIGEST_LENGTH * 2);
+    case SNTRuleTypeCDHash: return NormalizeHash(identifier, CS_CDHASH_LEN * 2);
+    case SNTRuleTypeTeamID:
+      if (identifier.size() != kExpectedTeamIDLength || !IsAlnum(identifier)) {
+        return std::nullopt;
+      }
+      return ToUpper(identifier);
+    case SNTRuleTypeSigningID: {
+      // `TeamID:SigningID`, where the signing ID may itself contain colons.
+      size_t colon = identifier.find(':');
+      if (colon == std::string_view::npos || colon + 1 == identifier.size()) {
+        return std::nullopt;
+      }
+      std::string_view teamID = identifier.substr(0, colon);
+      std::string_view signingID = identifier.substr(colon + 1);
+
+      std::string normalizedTeamID = ToLower(teamID);
+      if (normalizedTeamID != "platform") {
+        if (teamID.size() != kExpectedTeamIDLength || !IsAlnum(teamID)) {
+          return std::nullopt;
+        }
+        normalizedTeamID = ToUpper(teamID);
+      }
+      return normalizedTeamID + ":" + std::string(signingID);
+    }
+    default: return std::string(identifier);
+  }
+}
+
+bool NormalizeBatchRule(ExecutionRuleBatch::Rule& rule) {
+  std::optional<std::string> identifier =
+      NormalizeRuleIdentifier(rule.identifier(), static_cast<SNTRuleType>(rule.type()));
+  if (!identifier.has_value()) {
+    return false;
+  }
+  if (rule.state() == SNTRuleStateCEL && rule.cel_expr().empty()) {
+    return false;
+  }
+  if (rule.state() == SNTRuleStateSeatbelt && rule.seatbelt_policy().empty()) {
+    return false;
+  }
+
+  rule.set_identifier(*std::move(identifier));
+  return true;
+}
+
+SNTRule* RuleFromBatchRule(const ExecutionRuleBatch::Rule& rule) {
+  auto optionalString = [](const std::string& s) -> NSString* {
+    return s.empty() ? nil : StringToNSString(s);
+  };
+  return [[SNTRule alloc] initWithIdentifier:StringToNSString(rule.identifier())
+                                       state:static_cast<SNTRuleState>(rule.state())
+                                        type:static_cast<SNTRuleType>(rule.type())
+                                   customMsg:optionalString(rule.custom_msg())
+                                   customURL:optionalString(rule.custom_url())
+                                     celExpr:optionalString(rule.cel_expr())
+                              seatbeltPolicy:optionalString(rule.seatbelt_policy())
+                                      ruleId:rule.rule_id()];
+}
+
+}  // namespace santa
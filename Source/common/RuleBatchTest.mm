@@ -0,0 +1,114 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/RuleBatch.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTRule.h"
+#include "Source/common/String.h"
+
+using santa::ExecutionRuleBatch;
+using santa::NormalizeBatchRule;
+using santa::NormalizeRuleIdentifier;
+using santa::RuleFromBatchRule;
+
+@interface RuleBatchTest : XCTestCase
+@end
+
+@implementation RuleBatchTest
+
+- (void)testNormalizeRuleIdentifierMatchesSNTRule {
+  std::vector<std::pair<std::string, SNTRuleType>> cases = {
+      {"B7C1E3FD640C5F211C89B02C2C6122F78CE322AA5C56EB0BB54BC422A8F8B670", SNTRuleTypeBinary},
+      {"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b670", SNTRuleTypeBinary},
+      {"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b67", SNTRuleTypeBinary},
+      {"z7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b670", SNTRuleTypeBinary},
+      {"7846698E47EF41BE80B83FB9E2B98FA6DC46C9188B068BFF323C302955A00142",
+       SNTRuleTypeCertificate},
+      {"DBE8C39801F93E05FC7BC53A02AF5B4D3CFC670A", SNTRuleTypeCDHash},
+      {"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670", SNTRuleTypeCDHash},
+      {"abcdefghij", SNTRuleTypeTeamID},
+      {"ABCDEFGHI", SNTRuleTypeTeamID},
+      {"ABCDEFGH-J", SNTRuleTypeTeamID},
+      {"abcdefghij:com.example.App", SNTRuleTypeSigningID},
+      {"Platform:com.apple.yes", SNTRuleTypeSigningID},
+      {"ABCDEFGHIJ:com:with:colons", SNTRuleTypeSigningID},
+      {"ABCDEFGHIJ::", SNTRuleTypeSigningID},
+      {"ABCDEFGHIJ:", SNTRuleTypeSigningID},
+      {"ABCDEFGHI:com.example.App", SNTRuleTypeSigningID},
+      {"com.example.App", SNTRuleTypeSigningID},
+      {"", SNTRuleTypeBinary},
+  };
+
+  for (const auto& [identifier, type] : cases) {
+    SNTRule* rule = [[SNTRule alloc] initWithIdentifier:santa::StringToNSString(identifier)
+                                                  state:SNTRuleStateBlock
+                                                   type:type];
+    std::optional<std::string> normalized = NormalizeRuleIdentifier(identifier, type);
+
+    XCTAssertEqual(normalized.has_value(), rule != nil, @"%s", identifier.c_str());
+    if (rule && normalized.has_value()) {
+      XCTAssertEqualObjects(santa::StringToNSString(*normalized), rule.identifier, @"%s",
+                            identifier.c_str());
+    }
+  }
+}
+
+- (void)testNormalizeBatchRule {
+  ExecutionRuleBatch::Rule rule;
+  rule.set_identifier("abcdefghij");
+  rule.set_state(SNTRuleStateCEL);
+  rule.set_type(SNTRuleTypeTeamID);
+
+  // CEL rules need an expression
+  XCTAssertFalse(NormalizeBatchRule(rule));
+
+  rule.set_cel_expr("true");
+  XCTAssertTrue(NormalizeBatchRule(rule));
+  XCTAssertEqual(rule.identifier(), "ABCDEFGHIJ");
+
+  // And seatbelt rules a policy
+  rule.set_state(SNTRuleStateSeatbelt);
+  XCTAssertFalse(NormalizeBatchRule(rule));
+  rule.set_seatbelt_policy("(version 1)");
+  XCTAssertTrue(NormalizeBatchRule(rule));
+}
+
+- (void)testRuleFromBatchRule {
+  ExecutionRuleBatch::Rule batchRule;
+  batchRule.set_identifier("ABCDEFGHIJ");
+  batchRule.set_state(SNTRuleStateBlock);
+  batchRule.set_type(SNTRuleTypeTeamID);
+  batchRule.set_custom_msg("Banned team ID");
+  batchRule.set_rule_id(7);
+
+  SNTRule* rule = RuleFromBatchRule(batchRule);
+  XCTAssertEqualObjects(rule.identifier, @"ABCDEFGHIJ");
+  XCTAssertEqual(rule.state, SNTRuleStateBlock);
+  XCTAssertEqual(rule.type, SNTRuleTypeTeamID);
+  XCTAssertEqualObjects(rule.customMsg, @"Banned team ID");
+  XCTAssertNil(rule.customURL);
+  XCTAssertNil(rule.celExpr);
+  XCTAssertEqual(rule.ruleId, 7);
+}
+
+@end
@@ -15,6 +15,7 @@
 
 #import <EndpointSecurity/EndpointSecurity.h>
 #import <Foundation/Foundation.h>
+#include <sys/stat.h>
 
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SantaVnode.h"
@@ -24,7 +25,10 @@
 ///
 ///  Store information about executions from decision making for later logging.
 ///
-@interface SNTCachedDecision : NSObject <NSCopying>
+///  NB: vnodeId is not encoded. Decoded decisions have a zero vnode and the
+///  caller must assign the vnode of the file the decision is restored for.
+///
+@interface SNTCachedDecision : NSObject <NSCopying, NSSecureCoding>
 
 - (instancetype)init;
 - (instancetype)initWithEndpointSecurityFile:(const es_file_t*)esFile;
@@ -37,6 +41,23 @@
 /// stale state from the prior run.
 - (instancetype)initWithCachedIdentity:(SNTCachedDecision*)previous;
 
+/// Records the version of the file that the identity fields were computed for,
+/// so that they can later be served without recomputing them. Not encoded.
+- (void)recordFileVersion:(const struct stat*)sb;
+
+/// Whether a file version was recorded and the given stat describes the same
+/// version, i.e. the vnode, size, modification and change times all match.
+- (BOOL)matchesFileVersion:(const struct stat*)sb;
+
+/// Sets the entitlements from a code signature without copying or filtering
+/// them yet. The first time entitlements, rawEntitlements or
+/// entitlementsFiltered is read, rawEntitlements is deep copied from
+/// entitlements and entitlements is set to the result of filter, if given.
+/// Most decisions are never logged or uploaded, so most of this work is never
+/// done. The filter may be called on any thread.
+- (void)setEntitlementsFromSignature:(NSDictionary*)entitlements
+                              filter:(NSDictionary* (^)(NSDictionary* entitlements))filter;
+
 @property SantaVnode vnodeId;
 @property SNTEventState decision;
 @property SNTClientMode decisionClientMode;
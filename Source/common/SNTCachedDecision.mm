@@ -16,7 +16,26 @@
 
 #import "Source/common/SNTCachedDecision.h"
 
-@implementation SNTCachedDecision
+#include <os/lock.h>
+
+#include "Source/common/CoderMacros.h"
+#include "Source/common/FileVersion.h"
+#import "Source/common/MOLCertificate.h"
+#import "Source/common/SNTDeepCopy.h"
+
+@implementation SNTCachedDecision {
+  // Guards the entitlements fields, which are resolved on first read.
+  os_unfair_lock _entitlementsLock;
+  NSDictionary* _entitlements;
+  NSDictionary* _rawEntitlements;
+  BOOL _entitlementsFiltered;
+  NSDictionary* _pendingEntitlements;
+  NSDictionary* (^_pendingEntitlementsFilter)(NSDictionary*);
+
+  // The version of the file the identity fields were computed for.
+  BOOL _hasFileVersion;
+  struct stat _fileVersion;
+}
 
 - (instancetype)init {
   return [self initWithVnode:(SantaVnode){}];
@@ -31,6 +50,7 @@
   if (self) {
     _vnodeId = vnode;
     _cacheable = YES;
+    _entitlementsLock = OS_UNFAIR_LOCK_INIT;
   }
   return self;
 }
@@ -46,11 +66,10 @@
     _certSHA256 = previous.certSHA256;
     _certCommonName = previous.certCommonName;
     _certChain = previous.certChain;
-    _entitlements = previous.entitlements;
-    _rawEntitlements = previous.rawEntitlements;
-    _entitlementsFiltered = previous.entitlementsFiltered;
+    [self copyEntitlementsFrom:previous];
     _secureSigningTime = previous.secureSigningTime;
     _signingTime = previous.signingTime;
+    [self copyFileVersionFrom:previous];
   }
   return self;
 }
@@ -68,9 +87,7 @@
   copy.signingID = _signingID;
   copy.rawSigningID = _rawSigningID;
   copy.cdhash = _cdhash;
-  copy.entitlements = _entitlements;
-  copy.rawEntitlements = _rawEntitlements;
-  copy.entitlementsFiltered = _entitlementsFiltered;
+  [copy copyEntitlementsFrom:self];
   copy.platformBinary = _platformBinary;
   copy.codesigningFlags = _codesigningFlags;
   copy.signingStatus = _signingStatus;
@@ -89,7 +106,208 @@
   copy.silentTouchID = _silentTouchID;
   copy.touchIDCooldownMinutes = _touchIDCooldownMinutes;
   copy.auditReturn = _auditReturn;
+  [copy copyFileVersionFrom:self];
   return copy;
 }
 
+#pragma mark File Version
+
+- (void)recordFileVersion:(const struct stat*)sb {
+  _hasFileVersion = YES;
+  _fileVersion = *sb;
+}
+
+- (BOOL)matchesFileVersion:(const struct stat*)sb {
+  return _hasFileVersion && _vnodeId == SantaVnode::VnodeForFile(*sb) &&
+         santa::SameFileVersion(_fileVersion, *sb);
+}
+
+- (void)copyFileVersionFrom:(SNTCachedDecision*)other {
+  _hasFileVersion = other->_hasFileVersion;
+  _fileVersion = other->_fileVersion;
+}
+
+#pragma mark Entitlements
+
+- (void)setEntitlementsFromSignature:(NSDictionary*)entitlements
+                              filter:(NSDictionary* (^)(NSDictionary* entitlements))filter {
+  os_unfair_lock_lock(&_entitlementsLock);
+  _pendingEntitlements = entitlements;
+  _pendingEntitlementsFilter = entitlements ? filter : nil;
+  _entitlements = nil;
+  _rawEntitlements = nil;
+  _entitlementsFiltered = NO;
+  os_unfair_lock_unlock(&_entitlementsLock);
+}
+
+// Must be called with _entitlementsLock held.
+- (void)resolveEntitlements {
+  if (!_pendingEntitlements) return;
+
+  NSDictionary* entitlements = _pendingEntitlements;
+  NSDictionary* (^filter)(NSDictionary*) = _pendingEntitlementsFilter;
+  _pendingEntitlements = nil;
+  _pendingEntitlementsFilter = nil;
+
+  _rawEntitlements = [entitlements sntDeepCopy];
+  if (filter) {
+    // Filtered entitlements share values with the private copy.
+    _entitlements = filter(_rawEntitlements);
+    _entitlementsFiltered = (_entitlements.count != entitlements.count);
+  } else {
+    _entitlements = _rawEntitlements;
+    _entitlementsFiltered = NO;
+  }
+}
+
+// Copies unresolved entitlements as they are, so copies stay lazy.
+- (void)copyEntitlementsFrom:(SNTCachedDecision*)other {
+  os_unfair_lock_lock(&other->_entitlementsLock);
+  NSDictionary* entitlements = other->_entitlements;
+  NSDictionary* rawEntitlements = other->_rawEntitlements;
+  BOOL entitlementsFiltered = other->_entitlementsFiltered;
+  NSDictionary* pendingEntitlements = other->_pendingEntitlements;
+  NSDictionary* (^pendingEntitlementsFilter)(NSDictionary*) = other->_pendingEntitlementsFilter;
+  os_unfair_lock_unlock(&other->_entitlementsLock);
+
+  os_unfair_lock_lock(&_entitlementsLock);
+  _entitlements = entitlements;
+  _rawEntitlements = rawEntitlements;
+  _entitlementsFiltered = entitlementsFiltered;
+  _pendingEntitlements = pendingEntitlements;
+  _pendingEntitlementsFilter = pendingEntitlementsFilter;
+  os_unfair_lock_unlock(&_entitlementsLock);
+}
+
+- (NSDictionary*)entitlements {
+  os_unfair_lock_lock(&_entitlementsLock);
+  [self resolveEntitlements];
+  NSDictionary* entitlements = _entitlements;
+  os_unfair_lock_unlock(&_entitlementsLock);
+  return entitlements;
+}
+
+- (void)setEntitlements:(NSDictionary*)entitlements {
+  os_unfair_lock_lock(&_entitlementsLock);
+  [self resolveEntitlements];
+  _entitlements = entitlements;
+  os_unfair_lock_unlock(&_entitlementsLock);
+}
+
+- (NSDictionary*)rawEntitlements {
+  os_unfair_lock_lock(&_entitlementsLock);
+  [self resolveEntitlements];
+  NSDictionary* rawEntitlements = _rawEntitlements;
+  os_unfair_lock_unlock(&_entitlementsLock);
+  return rawEntitlements;
+}
+
+- (void)setRawEntitlements:(NSDictionary*)rawEntitlements {
+  os_unfair_lock_lock(&_entitlementsLock);
+  [self resolveEntitlements];
+  _rawEntitlements = rawEntitlements;
+  os_unfair_lock_unlock(&_entitlementsLock);
+}
+
+- (BOOL)entitlementsFiltered {
+  os_unfair_lock_lock(&_entitlementsLock);
+  [self resolveEntitlements];
+  BOOL entitlementsFiltered = _entitlementsFiltered;
+  os_unfair_lock_unlock(&_entitlementsLock);
+  return entitlementsFiltered;
+}
+
+- (void)setEntitlementsFiltered:(BOOL)entitlementsFiltered {
+  os_unfair_lock_lock(&_entitlementsLock);
+  [self resolveEntitlements];
+  _entitlementsFiltered = entitlementsFiltered;
+  os_unfair_lock_unlock(&_entitlementsLock);
+}
+
+#pragma mark NSSecureCoding
+
++ (BOOL)supportsSecureCoding {
+  return YES;
+}
+
+- (void)encodeWithCoder:(NSCoder*)coder {
+  ENCODE_BOXABLE(coder, decision);
+  ENCODE_BOXABLE(coder, decisionClientMode);
+  ENCODE(coder, decisionExtra);
+  ENCODE(coder, sha256);
+
+  ENCODE(coder, certSHA256);
+  ENCODE(coder, certCommonName);
+  ENCODE(coder, certChain);
+  ENCODE(coder, teamID);
+  ENCODE(coder, signingID);
+  ENCODE(coder, rawSigningID);
+  ENCODE(coder, cdhash);
+  ENCODE(coder, entitlements);
+  ENCODE(coder, rawEntitlements);
+  ENCODE_BOXABLE(coder, entitlementsFiltered);
+  ENCODE_BOXABLE(coder, platformBinary);
+  ENCODE_BOXABLE(coder, codesigningFlags);
+  ENCODE_BOXABLE(coder, signingStatus);
+  ENCODE(coder, secureSigningTime);
+  ENCODE(coder, signingTime);
+
+  ENCODE(coder, quarantineURL);
+
+  ENCODE(coder, customMsg);
+  ENCODE(coder, customURL);
+  ENCODE_BOXABLE(coder, silentBlockGUI);
+  ENCODE_BOXABLE(coder, silentBlockTTY);
+  ENCODE_BOXABLE(coder, seatbeltRequired);
+  ENCODE_BOXABLE(coder, staticRule);
+  ENCODE_BOXABLE(coder, ruleId);
+  ENCODE_BOXABLE(coder, cacheable);
+  ENCODE_BOXABLE(coder, holdAndAsk);
+  ENCODE_BOXABLE(coder, silentTouchID);
+  ENCODE(coder, touchIDCooldownMinutes);
+  ENCODE_BOXABLE(coder, auditReturn);
+}
+
+- (instancetype)initWithCoder:(NSCoder*)decoder {
+  self = [self init];
+  if (self) {
+    DECODE_SELECTOR(decoder, decision, NSNumber, unsignedLongLongValue);
+    DECODE_SELECTOR(decoder, decisionClientMode, NSNumber, integerValue);
+    DECODE(decoder, decisionExtra, NSString);
+    DECODE(decoder, sha256, NSString);
+
+    DECODE(decoder, certSHA256, NSString);
+    DECODE(decoder, certCommonName, NSString);
+    DECODE_ARRAY(decoder, certChain, MOLCertificate);
+    DECODE(decoder, teamID, NSString);
+    DECODE(decoder, signingID, NSString);
+    DECODE(decoder, rawSigningID, NSString);
+    DECODE(decoder, cdhash, NSString);
+    DECODE_DICT(decoder, entitlements);
+    DECODE_DICT(decoder, rawEntitlements);
+    DECODE_SELECTOR(decoder, entitlementsFiltered, NSNumber, boolValue);
+    DECODE_SELECTOR(decoder, platformBinary, NSNumber, boolValue);
+    DECODE_SELECTOR(decoder, codesigningFlags, NSNumber, unsignedIntValue);
+    DECODE_SELECTOR(decoder, signingStatus, NSNumber, integerValue);
+    DECODE(decoder, secureSigningTime, NSDate);
+    DECODE(decoder, signingTime, NSDate);
+
+    DECODE(decoder, quarantineURL, NSString);
+
+    DECODE(decoder, customMsg, NSString);
+    DECODE(decoder, customURL, NSString);
+    DECODE_SELECTOR(decoder, silentBlockGUI, NSNumber, boolValue);
+    DECODE_SELECTOR(decoder, silentBlockTTY, NSNumber, boolValue);
+    DECODE_SELECTOR(decoder, seatbeltRequired, NSNumber, boolValue);
+    DECODE_SELECTOR(decoder, staticRule, NSNumber, boolValue);
+    DECODE_SELECTOR(decoder, ruleId, NSNumber, longLongValue);
+    DECODE_SELECTOR(decoder, cacheable, NSNumber, boolValue);
+    DECODE_SELECTOR(decoder, holdAndAsk, NSNumber, boolValue);
+    DECODE_SELECTOR(decoder, silentTouchID, NSNumber, boolValue);
+    DECODE(decoder, touchIDCooldownMinutes, NSNumber);
+    DECODE_SELECTOR(decoder, auditReturn, NSNumber, boolValue);
+  }
+  return self;
+}
+
 @end
@@ -33,4 +33,111 @@
   XCTAssertEqual(sb.st_dev, cd.vnodeId.fsid);
 }
 
+- (void)testSecureCodingRoundTrip {
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] initWithVnode:{.fsid = 1, .fileid = 2}];
+  cd.decision = SNTEventStateAllowSigningID;
+  cd.decisionClientMode = SNTClientModeLockdown;
+  cd.sha256 = @"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+  cd.teamID = @"EQHXZ8M8AV";
+  cd.signingID = @"EQHXZ8M8AV:com.google.Chrome";
+  cd.entitlements = @{@"com.apple.security.get-task-allow" : @YES};
+  cd.codesigningFlags = 0x2000;
+  cd.signingStatus = SNTSigningStatusProduction;
+  cd.staticRule = YES;
+  cd.ruleId = 42;
+  cd.cacheable = NO;
+
+  NSError* err;
+  NSData* data = [NSKeyedArchiver archivedDataWithRootObject:cd
+                                       requiringSecureCoding:YES
+                                                       error:&err];
+  XCTAssertNotNil(data, @"%@", err);
+
+  SNTCachedDecision* decoded = [NSKeyedUnarchiver unarchivedObjectOfClass:[SNTCachedDecision class]
+                                                                 fromData:data
+                                                                    error:&err];
+  XCTAssertNotNil(decoded, @"%@", err);
+
+  XCTAssertEqual(decoded.decision, cd.decision);
+  XCTAssertEqual(decoded.decisionClientMode, cd.decisionClientMode);
+  XCTAssertEqualObjects(decoded.sha256, cd.sha256);
+  XCTAssertEqualObjects(decoded.teamID, cd.teamID);
+  XCTAssertEqualObjects(decoded.signingID, cd.signingID);
+  XCTAssertEqualObjects(decoded.entitlements, cd.entitlements);
+  XCTAssertEqual(decoded.codesigningFlags, cd.codesigningFlags);
+  XCTAssertEqual(decoded.signingStatus, cd.signingStatus);
+  XCTAssertTrue(decoded.staticRule);
+  XCTAssertEqual(decoded.ruleId, 42);
+  XCTAssertFalse(decoded.cacheable);
+
+  // The vnode is not part of the encoded state.
+  XCTAssertEqual(decoded.vnodeId.fsid, 0);
+  XCTAssertEqual(decoded.vnodeId.fileid, 0);
+}
+
+- (void)testEntitlementsFromSignatureResolvedOnFirstRead {
+  NSDictionary* entitlements = @{
+    @"com.apple.security.get-task-allow" : @YES,
+    @"com.apple.security.app-sandbox" : @YES,
+  };
+  NSString* sandbox = @"com.apple.security.app-sandbox";
+  __block int filterCalls = 0;
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  [cd setEntitlementsFromSignature:entitlements
+                            filter:^NSDictionary*(NSDictionary* e) {
+                              filterCalls++;
+                              return @{sandbox : e[sandbox]};
+                            }];
+
+  // Copies stay unresolved.
+  SNTCachedDecision* copy = [cd copy];
+  SNTCachedDecision* seeded = [[SNTCachedDecision alloc] initWithCachedIdentity:cd];
+  XCTAssertEqual(filterCalls, 0);
+
+  XCTAssertEqualObjects(cd.rawEntitlements, entitlements);
+  XCTAssertEqualObjects(cd.entitlements, @{sandbox : @YES});
+  XCTAssertTrue(cd.entitlementsFiltered);
+  XCTAssertEqual(filterCalls, 1);
+
+  XCTAssertEqualObjects(copy.entitlements, cd.entitlements);
+  XCTAssertEqualObjects(seeded.rawEntitlements, entitlements);
+  XCTAssertEqual(filterCalls, 3);
+
+  // Without a filter the raw entitlements are used as is.
+  [cd setEntitlementsFromSignature:entitlements filter:nil];
+  XCTAssertEqualObjects(cd.entitlements, entitlements);
+  XCTAssertFalse(cd.entitlementsFiltered);
+}
+
+- (void)testMatchesFileVersion {
+  struct stat sb = MakeStat();
+  sb.st_size = 1024;
+  sb.st_mtimespec = {.tv_sec = 100, .tv_nsec = 1};
+  sb.st_ctimespec = {.tv_sec = 200, .tv_nsec = 2};
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] initWithVnode:SantaVnode::VnodeForFile(sb)];
+  XCTAssertFalse([cd matchesFileVersion:&sb]);
+
+  [cd recordFileVersion:&sb];
+  XCTAssertTrue([cd matchesFileVersion:&sb]);
+  XCTAssertTrue([[cd copy] matchesFileVersion:&sb]);
+
+  struct stat changed = sb;
+  changed.st_size++;
+  XCTAssertFalse([cd matchesFileVersion:&changed]);
+
+  changed = sb;
+  changed.st_mtimespec.tv_nsec++;
+  XCTAssertFalse([cd matchesFileVersion:&changed]);
+
+  changed = sb;
+  changed.st_ctimespec.tv_sec++;
+  XCTAssertFalse([cd matchesFileVersion:&changed]);
+
+  changed = sb;
+  changed.st_ino++;
+  XCTAssertFalse([cd matchesFileVersion:&changed]);
+}
+
 @end
@@ -152,6 +152,15 @@ typedef NS_ENUM(NSInteger, SNTEventLogType) {
   SNTEventLogTypeProtobufStreamZstd,
   SNTEventLogTypeJSON,
   SNTEventLogTypeNull,
+  SNTEventLogTypeProtobufColumnar,
+  SNTEventLogTypeUnifiedLog,
+};
+
+// How hard santad works to get spool files and stored events onto stable storage.
+typedef NS_ENUM(NSInteger, SNTWriteDurability) {
+  SNTWriteDurabilityNone,
+  SNTWriteDurabilityBatch,
+  SNTWriteDurabilityStrict,
 };
 
 // The return status of a sync.
@@ -174,6 +183,7 @@ typedef NS_ENUM(NSInteger, SNTSyncContentEncoding) {
   SNTSyncContentEncodingNone,
   SNTSyncContentEncodingDeflate,
   SNTSyncContentEncodingGzip,
+  SNTSyncContentEncodingZstd,
 };
 
 typedef NS_ENUM(NSInteger, SNTMetricFormatType) {
@@ -181,6 +191,7 @@ typedef NS_ENUM(NSInteger, SNTMetricFormatType) {
   SNTMetricFormatTypeRawJSON,
   SNTMetricFormatTypeMonarchJSON,
   SNTMetricFormatTypeProto,
+  SNTMetricFormatTypePrometheus,
 };
 
 typedef NS_ENUM(NSInteger, SNTOverrideFileAccessAction) {
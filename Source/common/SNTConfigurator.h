@@ -209,6 +209,8 @@
 ///
 ///  Defines how event logs are stored. Options are:
 ///    SNTEventLogTypeSyslog "syslog": Sent to ASL or ULS (if built with the 10.12 SDK or later).
+///    SNTEventLogTypeUnifiedLog "unifiedlog": Similar to "syslog", but the highest volume events
+///      are sent to ULS as structured entries which are only formatted when read.
 ///    SNTEventLogTypeFilelog "file": Sent to a file on disk. Use eventLogPath to specify a path.
 ///    SNTEventLogTypeNull "null": Logs nothing
 ///    SNTEventLogTypeProtobuf "protobuf": Sent to a file on disk, using a maildir-like
@@ -221,6 +223,9 @@
 ///      output is compressed as gzip.
 ///    SNTEventLogTypeProtobufStreamZstd "protobufstreamzstd": Similar to "protobufstream", but
 ///      output is compressed as zstd.
+///    SNTEventLogTypeProtobufColumnar "protobufcolumnar": Similar to "protobuf", but each spool
+///      file is a ColumnarLogBatch, which groups events by type and stores each top-level
+///      SantaMessage field as a separate column.
 ///    Defaults to SNTEventLogTypeFilelog.
 ///    For mobileconfigs use EventLogType as the key and syslog or filelog strings as the value.
 ///
@@ -250,6 +255,70 @@
 ///
 @property(nullable, readonly, nonatomic) NSArray<NSString*>* telemetry;
 
+///
+///  Dictionary mapping telemetry event names, as used in the Telemetry key, to a sample rate N.
+///  Only one of every N events of that type is logged. Events not in the dictionary, or with a
+///  rate of 1, are all logged. Has no effect on events listed in TelemetryAggregatedEvents.
+///
+///  @note: This property is KVO compliant.
+///
+@property(nullable, readonly, nonatomic) NSDictionary<NSString*, NSNumber*>* telemetrySampleRates;
+
+///
+///  Array of telemetry event names, as used in the Telemetry key, that are not logged
+///  individually. Instead, events of these types are counted per instigating executable and a
+///  summary with the count and most common target paths is logged once per aggregation window.
+///
+///  @note: This property is KVO compliant.
+///
+@property(nullable, readonly, nonatomic) NSArray<NSString*>* telemetryAggregatedEvents;
+
+///
+///  The length of the window over which TelemetryAggregatedEvents are summarized.
+///  Defaults to 60, clamped to between 10 and 3600.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger telemetryAggregationWindowSec;
+
+///
+///  When set, low priority events are dropped once this many events are waiting to be written to
+///  the event log. The share of these events that is logged falls as the backlog grows, until none
+///  are logged at twice the threshold. Defaults to 0, which disables load shedding.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger telemetryLoadSheddingThreshold;
+
+///
+///  Array of telemetry event names, as used in the Telemetry key, that are dropped first when the
+///  event log falls behind. Defaults to Fork, Exit, Close and Link. Execution and FileAccess events
+///  are never dropped.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(nullable, readonly, nonatomic) NSArray<NSString*>* telemetryLoadSheddingEvents;
+
+///
+///  When set, network flows are merged by process, remote endpoint and protocol, and logged once
+///  per window of this many seconds instead of as they are reported. Only supported by the
+///  protobuf log formats. Defaults to 0, which disables aggregation. Other values are clamped to
+///  between 10 and 3600.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger networkFlowAggregationWindowSec;
+
+///
+///  When set, santanetd is offered a shared memory ring of this many flow records to report network
+///  flows through, instead of sending them over XPC. Flow decisions are still sent over XPC. Only
+///  supported by the protobuf log formats. Defaults to 0, which disables the ring. Other values are
+///  clamped to between 1024 and 65536, and rounded up to a power of two.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger networkFlowRingCapacity;
+
 ///
 ///  If eventLogType is set to protobuf, spoolDirectory will provide the base path used for
 ///  saving logs using a maildir-like format.
@@ -286,6 +355,142 @@
 ///
 @property(readonly, nonatomic) float spoolDirectoryEventMaxFlushTimeSec;
 
+///
+///  If eventLogType is set to protobuf, spoolDirectoryShardCount sets the number of independent
+///  spool writers events are spread across. Each writer has its own queue, batch and spool files,
+///  which lets busy hosts with many cores write telemetry in parallel. Events logged from the same
+///  thread always go to the same writer. The spoolDirectorySizeThresholdMB limit applies to all
+///  writers combined, while spoolDirectoryFileSizeThresholdKB applies to each writer's files.
+///  Defaults to 1, clamped to at most 16.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger spoolDirectoryShardCount;
+
+///
+///  If eventLogType is set to protobufstreamzstd, spoolDirectoryZstdDictionaryPath is the path to a
+///  zstd dictionary (e.g. created with `zstd --train`) used when compressing spool files. This
+///  improves the compression ratio of telemetry considerably, but whatever consumes the spool
+///  files must decompress them with the same dictionary.
+///  Defaults to nil (no dictionary).
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(nullable, readonly, nonatomic) NSString* spoolDirectoryZstdDictionaryPath;
+
+///
+///  If eventLogType is set to protobufstreamzstd and this is set, runs of small spool files are
+///  merged and recompressed at this zstd level before they're exported. Merging reduces the number
+///  of files and bytes uploaded, at the cost of CPU time on the export path.
+///  Defaults to 0 (disabled). Values above the highest zstd level are clamped to it.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger spoolDirectoryCompactionZstdLevel;
+
+///
+///  How hard santad works to get completed spool files and stored events onto stable storage, as
+///  one of "none", "batch" or "strict". On APFS only F_FULLFSYNC flushes the drive's own cache,
+///  and it's expensive, so it's only used in the modes that ask for it.
+///
+///  none: spool files are left in the page cache and stored events use SQLite's default syncing,
+///  which doesn't flush the drive's cache. A power loss can lose recent telemetry and events.
+///
+///  batch: each completed spool file is flushed with F_FULLFSYNC before it's moved into the spool
+///  directory, and each commit of stored events, which are already written in groups, is flushed
+///  with F_FULLFSYNC. A spool file that survives a power loss is complete.
+///
+///  strict: as batch, and the spool directory is flushed after each file is moved into it, and the
+///  event database also flushes its journal's directory, so completed files and commits survive a
+///  power loss.
+///
+///  Defaults to none.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) SNTWriteDurability writeDurability;
+
+///
+///  If set, events are handed from the Endpoint Security threads to a queue of this many
+///  entries and serialized and written to the event log on a dedicated queue, rather than on the
+///  thread that handled the event. This reduces the time spent handling each event when logging
+///  is slow. Values are rounded up to a power of two and clamped to at most 65536.
+///  Defaults to 0 (disabled).
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger eventLogQueueSize;
+
+///
+///  If eventLogQueueSize is set and the queue is full, events are dropped when this is YES.
+///  Otherwise they are serialized and written on the thread that handled the event, as if the
+///  queue were disabled.
+///  Defaults to NO.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) BOOL eventLogQueueDropWhenFull;
+
+///
+///  If eventLogType is one of the protobuf or JSON types, this limits the number of bytes of
+///  arguments logged for each execution. Arguments are logged in order until the limit is reached;
+///  the argument crossing it is cut short and the rest are dropped, and the event is marked as
+///  truncated.
+///  Defaults to 0 (no limit).
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) uint32_t execArgsMaxBytes;
+
+///
+///  The same as execArgsMaxBytes, for the environment variables logged for each execution.
+///  Defaults to 0 (no limit).
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) uint32_t execEnvsMaxBytes;
+
+///
+///  If execEnvsMaxBytes is set and an execution's environment exceeds it, log a hash of the
+///  whole environment in place of the environment variables that fit. Executions with identical
+///  environments, such as the many processes started by a build, then have identical hashes.
+///  Defaults to NO.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) BOOL hashTruncatedExecEnvs;
+
+///
+///  If true, santad periodically persists allowed execution decisions for binaries on the root
+///  volume and restores them at startup so the caches begin warm after a restart. The snapshot
+///  is discarded if the rules, client mode, path regexes or Santa version have changed.
+///  Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableCacheSnapshot;
+
+///
+///  If enableCacheSnapshot is true, this defines how often the snapshot is written.
+///  Defaults to 600 (10 minutes). Minimum allowed value is 60.
+///
+@property(readonly, nonatomic) uint32_t cacheSnapshotIntervalSec;
+
+///
+///  If true, santad hashes Mach-O executables in the background as soon as they are closed after
+///  being written, so that the first execution of a freshly built or downloaded binary does not
+///  have to compute its SHA-256 inside the EndpointSecurity deadline. Hashing is rate limited and
+///  runs at utility QoS. Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enablePrehashing;
+
+///
+///  If true, santad only computes the SHA-256 of an executable when something needs it: a binary
+///  rule exists, an event for the execution will be stored, or transitive rules or all event
+///  upload are enabled. Otherwise decisions for binaries whose CDHash is enforced by the kernel
+///  are made from their CDHash and signing details alone, and their execution logs omit the
+///  SHA-256. Defaults to false.
+///
+@property(readonly, nonatomic) BOOL enableLazyBinaryHashing;
+
 ///
 ///  If true, Santa will attempt to periodically export telemetry to configured location.
 ///  Defaults to false.
@@ -333,6 +538,35 @@
 ///
 @property(readonly) uint32_t telemetryExportMaxFilesPerBatch;
 
+///
+///  When set, telemetry files are exported this many seconds after a spool file is closed instead
+///  of waiting for the next TelemetryExportIntervalSec. Files closed in the meantime are exported
+///  in the same batch. The export interval still applies as a fallback.
+///  Defaults to 0 (disabled). Maximum allowed value is 300.
+///
+///  @note: This property is KVO compliant.
+///
+@property(readonly) uint32_t telemetryExportStreamingDelaySec;
+
+///
+///  The number of telemetry batches that may be exported at the same time when there is a
+///  backlog. Batches are still exported oldest-first. Only one batch at a time is exported while
+///  on battery power or on an expensive or constrained network.
+///  Defaults to 1. Maximum allowed value is 8.
+///
+///  @note: This property is KVO compliant.
+///
+@property(readonly) uint32_t telemetryExportMaxConcurrentBatches;
+
+///
+///  Limits the average rate at which telemetry is exported, in kilobytes per second. Exports are
+///  paused between batches to stay under the limit.
+///  Defaults to 0 (unlimited).
+///
+///  @note: This property is KVO compliant.
+///
+@property(readonly) uint32_t telemetryExportMaxKBPerSec;
+
 ///
 ///  CEL expressions used to filter telemetry events during export.
 ///
@@ -1069,6 +1303,13 @@ extern NSString* _Nonnull const kStateTempAdminTargetUIDKey;
 ///
 @property(readonly, nonatomic) BOOL enableCleanSyncEventUpload;
 
+///
+///  The number of event upload requests a sync may have in flight at once. Batches are still
+///  read from the database in order, and each one is removed only once the server accepts it.
+///  Clamped to between 1 and 8. Defaults to 1.
+///
+@property(readonly, nonatomic) NSUInteger syncEventUploadConcurrency;
+
 ///
 ///  If true, events will be uploaded for all executions, even those that are allowed.
 ///  Use with caution, this generates a lot of events. Defaults to false.
@@ -1086,6 +1327,25 @@ extern NSString* _Nonnull const kStateTempAdminTargetUIDKey;
 ///
 @property(readonly, nonatomic) BOOL ignoreOtherEndpointSecurityClients;
 
+///
+///  If set, Endpoint Security messages are handed to this many shared worker threads through
+///  per-client queues, and AUTH deadlines are enforced by a single shared timer, instead of
+///  dispatching each message and its deadline individually. Clamped to at most 64.
+///  Defaults to 0 (disabled).
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger batchedEventDispatchWorkers;
+
+///
+///  The number of Endpoint Security clients that AUTH events are spread over. Processes are
+///  assigned to a client by pid, so execs that are slow to evaluate only hold up those assigned
+///  to the same client. Clamped to between 1 and 8. Defaults to 1.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger authorizerShardCount;
+
 ///
 ///  If true, compressed requests from "santactl sync" will set "Content-Encoding" to "zlib"
 ///  instead of the new default "deflate". If syncing with Upvote deployed at commit 0b4477d
@@ -1096,10 +1356,17 @@ extern NSString* _Nonnull const kStateTempAdminTargetUIDKey;
 
 ///
 /// If set, "santactl sync" will use the supplied "Content-Encoding", possible
-/// settings include "gzip", "deflate", "none". If empty defaults to "deflate".
+/// settings include "gzip", "deflate", "zstd", "none". If empty defaults to "deflate".
 ///
 @property(readonly, nonatomic) SNTSyncContentEncoding syncClientContentEncoding;
 
+///
+/// If set, the path of a zstd dictionary, as produced by `zstd --train`, used to compress
+/// requests when syncClientContentEncoding is "zstd". The sync server must decompress
+/// requests with the same dictionary.
+///
+@property(nullable, readonly, nonatomic) NSString* syncClientContentEncodingDictionary;
+
 ///
 ///  Contains the FCM project name.
 ///
@@ -1157,6 +1424,19 @@ extern NSString* _Nonnull const kStateTempAdminTargetUIDKey;
 ///
 @property(readonly, nonatomic) NSUInteger metricExportTimeout;
 
+///
+/// If YES, metrics exported over HTTP only include values that changed since
+/// the last successful export, with a full export at least once an hour.
+/// Defaults to NO.
+///
+@property(readonly, nonatomic) BOOL enableMetricDeltaExport;
+
+///
+/// If YES, metrics exported over HTTP are gzip compressed and sent with a
+/// Content-Encoding: gzip header. Defaults to NO.
+///
+@property(readonly, nonatomic) BOOL enableMetricExportCompression;
+
 ///
 /// List of prefix strings for which individual entitlement keys with a matching
 /// prefix should not be logged.
@@ -15,7 +15,10 @@
 
 #import "Source/common/SNTConfigurator.h"
 
+#include <os/lock.h>
 #include <sys/stat.h>
+#include <atomic>
+#include <memory>
 #include <set>
 #include <string>
 
@@ -71,7 +74,33 @@ static SNTRemovableMediaAction ActionFromString(NSString* action) {
   return SNTRemovableMediaActionAllow;
 }
 
-@interface SNTConfigurator ()
+namespace {
+
+// The settings consulted while handling ES events, resolved from the sync and
+// config state. A new snapshot is built whenever that state changes so the
+// hot-path accessors don't have to walk the state dictionaries.
+struct ConfigSnapshot {
+  SNTClientMode clientMode = SNTClientModeMonitor;
+  bool failClosed = false;
+  bool enableTransitiveRules = false;
+  bool enableLazyBinaryHashing = false;
+  bool enableBadSignatureProtection = false;
+  bool enablePageZeroProtection = true;
+  bool enablePrehashing = false;
+  NSRegularExpression* allowedPathRegex;
+  NSRegularExpression* blockedPathRegex;
+  NSRegularExpression* fileChangesRegex;
+};
+
+}  // namespace
+
+@interface SNTConfigurator () {
+  // Guards syncState, configState and inTemporaryMonitorMode.
+  os_unfair_lock _stateLock;
+  // Serializes snapshot rebuilds so an older one is never published last.
+  os_unfair_lock _snapshotLock;
+  std::shared_ptr<const ConfigSnapshot> _configSnapshot;
+}
 @property(readonly, nonatomic) NSUserDefaults* defaults;
 
 /// Keys and expected value types.
@@ -105,6 +134,10 @@ typedef BOOL (^StateFileAccessAuthorizer)(void);
 
 @implementation SNTConfigurator
 
+@synthesize syncState = _syncState;
+@synthesize configState = _configState;
+@synthesize inTemporaryMonitorMode = _inTemporaryMonitorMode;
+
 /// The hard-coded path to the sync state file.
 NSString* const kSyncStateFilePath = @"/var/db/santa/sync-state.plist";
 
@@ -135,6 +168,7 @@ static NSString* const kSyncEnableProtoTransfer = @"SyncEnableProtoTransfer";
 static NSString* const kSyncProxyConfigKey = @"SyncProxyConfiguration";
 static NSString* const kSyncExtraHeadersKey = @"SyncExtraHeaders";
 static NSString* const kSyncEnableCleanSyncEventUpload = @"SyncEnableCleanSyncEventUpload";
+static NSString* const kSyncEventUploadConcurrency = @"SyncEventUploadConcurrency";
 static NSString* const kClientAuthCertificateFileKey = @"ClientAuthCertificateFile";
 static NSString* const kClientAuthCertificatePasswordKey = @"ClientAuthCertificatePassword";
 static NSString* const kClientAuthCertificateCNKey = @"ClientAuthCertificateCN";
@@ -191,6 +225,15 @@ static NSString* const kSpoolDirectory = @"SpoolDirectory";
 static NSString* const kSpoolDirectoryFileSizeThresholdKB = @"SpoolDirectoryFileSizeThresholdKB";
 static NSString* const kSpoolDirectorySizeThresholdMB = @"SpoolDirectorySizeThresholdMB";
 static NSString* const kSpoolDirectoryEventMaxFlushTimeSec = @"SpoolDirectoryEventMaxFlushTimeSec";
+static NSString* const kSpoolDirectoryShardCount = @"SpoolDirectoryShardCount";
+static NSString* const kSpoolDirectoryZstdDictionaryPath = @"SpoolDirectoryZstdDictionaryPath";
+static NSString* const kSpoolDirectoryCompactionZstdLevel = @"SpoolDirectoryCompactionZstdLevel";
+static NSString* const kWriteDurability = @"WriteDurability";
+static NSString* const kEventLogQueueSize = @"EventLogQueueSize";
+static NSString* const kEventLogQueueDropWhenFull = @"EventLogQueueDropWhenFull";
+static NSString* const kExecArgsMaxBytes = @"ExecArgsMaxBytes";
+static NSString* const kExecEnvsMaxBytes = @"ExecEnvsMaxBytes";
+static NSString* const kHashTruncatedExecEnvs = @"HashTruncatedExecEnvs";
 
 static NSString* const kFileAccessPolicy = @"FileAccessPolicy";
 static NSString* const kFileAccessPolicyPlist = @"FileAccessPolicyPlist";
@@ -199,19 +242,38 @@ static NSString* const kFileAccessPolicyUpdateIntervalSec = @"FileAccessPolicyUp
 static NSString* const kFileAccessGlobalLogsPerSec = @"FileAccessGlobalLogsPerSec";
 static NSString* const kFileAccessGlobalWindowSizeSec = @"FileAccessGlobalWindowSizeSec";
 
+static NSString* const kEnableCacheSnapshot = @"EnableCacheSnapshot";
+static NSString* const kCacheSnapshotIntervalSec = @"CacheSnapshotIntervalSec";
+static NSString* const kEnablePrehashing = @"EnablePrehashing";
+static NSString* const kEnableLazyBinaryHashing = @"EnableLazyBinaryHashing";
+
 static NSString* const kEnableTelemetryExport = @"EnableTelemetryExport";
 static NSString* const kTelemetryExportIntervalSec = @"TelemetryExportIntervalSec";
 static NSString* const kTelemetryExportTimeoutSec = @"TelemetryExportTimeoutSec";
 static NSString* const kTelemetryExportBatchThresholdSizeMB =
     @"TelemetryExportBatchThresholdSizeMB";
 static NSString* const kTelemetryExportMaxFilesPerBatch = @"TelemetryExportMaxFilesPerBatch";
+static NSString* const kTelemetryExportStreamingDelaySec = @"TelemetryExportStreamingDelaySec";
+static NSString* const kTelemetryExportMaxConcurrentBatches =
+    @"TelemetryExportMaxConcurrentBatches";
+static NSString* const kTelemetryExportMaxKBPerSec = @"TelemetryExportMaxKBPerSec";
 
 static NSString* const kEnableMachineIDDecoration = @"EnableMachineIDDecoration";
 
 static NSString* const kIgnoreOtherEndpointSecurityClients = @"IgnoreOtherEndpointSecurityClients";
+static NSString* const kBatchedEventDispatchWorkers = @"BatchedEventDispatchWorkers";
+static NSString* const kAuthorizerShardCount = @"AuthorizerShardCount";
 static NSString* const kTelemetryKey = @"Telemetry";
+static NSString* const kTelemetrySampleRatesKey = @"TelemetrySampleRates";
+static NSString* const kTelemetryAggregatedEventsKey = @"TelemetryAggregatedEvents";
+static NSString* const kTelemetryAggregationWindowSec = @"TelemetryAggregationWindowSec";
+static NSString* const kTelemetryLoadSheddingThreshold = @"TelemetryLoadSheddingThreshold";
+static NSString* const kTelemetryLoadSheddingEventsKey = @"TelemetryLoadSheddingEvents";
+static NSString* const kNetworkFlowAggregationWindowSec = @"NetworkFlowAggregationWindowSec";
+static NSString* const kNetworkFlowRingCapacity = @"NetworkFlowRingCapacity";
 
 static NSString* const kClientContentEncoding = @"SyncClientContentEncoding";
+static NSString* const kClientContentEncodingDictionary = @"SyncClientContentEncodingDictionary";
 
 static NSString* const kFCMProject = @"FCMProject";
 static NSString* const kFCMEntity = @"FCMEntity";
@@ -234,6 +296,8 @@ static NSString* const kMetricURL = @"MetricURL";
 static NSString* const kMetricExportInterval = @"MetricExportInterval";
 static NSString* const kMetricExportTimeout = @"MetricExportTimeout";
 static NSString* const kMetricExtraLabels = @"MetricExtraLabels";
+static NSString* const kEnableMetricDeltaExport = @"EnableMetricDeltaExport";
+static NSString* const kEnableMetricExportCompression = @"EnableMetricExportCompression";
 
 static NSString* const kEnabledProcessAnnotations = @"EnabledProcessAnnotations";
 static NSString* const kAllowedSantaCommandsKey = @"AllowedSantaCommands";
@@ -387,6 +451,7 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kSyncBaseURLKey : string,
       kSyncEnableProtoTransfer : number,
       kSyncEnableCleanSyncEventUpload : number,
+      kSyncEventUploadConcurrency : number,
       kSyncProxyConfigKey : dictionary,
       kSyncExtraHeadersKey : dictionary,
       kClientAuthCertificateFileKey : string,
@@ -394,6 +459,7 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kClientAuthCertificateCNKey : string,
       kClientAuthCertificateIssuerKey : string,
       kClientContentEncoding : string,
+      kClientContentEncodingDictionary : string,
       kServerAuthRootsDataKey : data,
       kServerAuthRootsFileKey : string,
       kMachineOwnerKey : string,
@@ -410,19 +476,37 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kSpoolDirectoryFileSizeThresholdKB : number,
       kSpoolDirectorySizeThresholdMB : number,
       kSpoolDirectoryEventMaxFlushTimeSec : number,
+      kSpoolDirectoryShardCount : number,
+      kSpoolDirectoryZstdDictionaryPath : string,
+      kSpoolDirectoryCompactionZstdLevel : number,
+      kWriteDurability : string,
+      kEventLogQueueSize : number,
+      kEventLogQueueDropWhenFull : number,
+      kExecArgsMaxBytes : number,
+      kExecEnvsMaxBytes : number,
+      kHashTruncatedExecEnvs : number,
       kFileAccessPolicy : dictionary,
       kFileAccessPolicyPlist : string,
       kFileAccessBlockMessage : string,
       kFileAccessPolicyUpdateIntervalSec : number,
       kFileAccessGlobalWindowSizeSec : number,
       kFileAccessGlobalLogsPerSec : number,
+      kEnableCacheSnapshot : number,
+      kCacheSnapshotIntervalSec : number,
+      kEnablePrehashing : number,
+      kEnableLazyBinaryHashing : number,
       kEnableTelemetryExport : number,
       kTelemetryExportIntervalSec : number,
       kTelemetryExportTimeoutSec : number,
       kTelemetryExportBatchThresholdSizeMB : number,
       kTelemetryExportMaxFilesPerBatch : number,
+      kTelemetryExportStreamingDelaySec : number,
+      kTelemetryExportMaxConcurrentBatches : number,
+      kTelemetryExportMaxKBPerSec : number,
       kEnableMachineIDDecoration : number,
       kIgnoreOtherEndpointSecurityClients : number,
+      kBatchedEventDispatchWorkers : number,
+      kAuthorizerShardCount : number,
       kFCMProject : string,
       kFCMEntity : string,
       kFCMAPIKey : string,
@@ -434,6 +518,8 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kMetricExportInterval : number,
       kMetricExportTimeout : number,
       kMetricExtraLabels : dictionary,
+      kEnableMetricDeltaExport : number,
+      kEnableMetricExportCompression : number,
       kEnableAllEventUploadKey : number,
       kDisableUnknownEventUploadKey : number,
       kOverrideFileAccessActionKey : string,
@@ -443,6 +529,13 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
       kTelemetryFilterExpressionsKey : array,
       kBinaryUploadFilterExpressionsKey : array,
       kTelemetryKey : array,
+      kTelemetrySampleRatesKey : dictionary,
+      kTelemetryAggregatedEventsKey : array,
+      kTelemetryAggregationWindowSec : number,
+      kTelemetryLoadSheddingThreshold : number,
+      kTelemetryLoadSheddingEventsKey : array,
+      kNetworkFlowAggregationWindowSec : number,
+      kNetworkFlowRingCapacity : number,
       kBrandingCompanyName : string,
       kBrandingCompanyLogo : string,
       kBrandingCompanyLogoDark : string,
@@ -462,6 +555,8 @@ static NSString* const kPushTokenChainKey = @"PushTokenChain";
     _configState = [self readForcedConfig];
 
     _syncState = [self readSyncStateFromDisk] ?: [NSMutableDictionary dictionary];
+    [self rebuildConfigSnapshot];
+
     if ([self migrateDeprecatedSyncStateKeys]) {
       // Save the updated sync state if any keys were migrated.
       [self saveSyncStateToDisk];
@@ -505,6 +600,7 @@ static SNTConfigurator* sharedConfigurator = nil;
   if (self) {
     _configState = [config mutableCopy];
     _syncState = [config mutableCopy];
+    [self rebuildConfigSnapshot];
   }
   return self;
 }
@@ -589,6 +685,10 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
++ (NSSet*)keyPathsForValuesAffectingSyncEventUploadConcurrency {
+  return [self configStateSet];
+}
+
 + (NSSet*)keyPathsForValuesAffectingEnablePageZeroProtection {
   return [self configStateSet];
 }
@@ -745,6 +845,42 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
++ (NSSet*)keyPathsForValuesAffectingSpoolDirectoryShardCount {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingSpoolDirectoryZstdDictionaryPath {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingSpoolDirectoryCompactionZstdLevel {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingWriteDurability {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEventLogQueueSize {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingEventLogQueueDropWhenFull {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingExecArgsMaxBytes {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingExecEnvsMaxBytes {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingHashTruncatedExecEnvs {
+  return [self configStateSet];
+}
+
 + (NSSet*)keyPathsForValuesAffectingFileAccessPolicy {
   return [self configStateSet];
 }
@@ -789,6 +925,14 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
++ (NSSet*)keyPathsForValuesAffectingBatchedEventDispatchWorkers {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingAuthorizerShardCount {
+  return [self configStateSet];
+}
+
 + (NSSet*)keyPathsForValuesAffectingDnsUpstreamTimeoutSecs {
   return [self configStateSet];
 }
@@ -897,6 +1041,22 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
++ (NSSet*)keyPathsForValuesAffectingTelemetrySampleRates {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingTelemetryAggregatedEvents {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingTelemetryLoadSheddingThreshold {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingTelemetryLoadSheddingEvents {
+  return [self configStateSet];
+}
+
 + (NSSet*)keyPathsForValuesAffectingEnableTelemetryExport {
   return [self configStateSet];
 }
@@ -917,6 +1077,18 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
++ (NSSet*)keyPathsForValuesAffectingTelemetryExportStreamingDelaySec {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingTelemetryExportMaxConcurrentBatches {
+  return [self configStateSet];
+}
+
++ (NSSet*)keyPathsForValuesAffectingTelemetryExportMaxKBPerSec {
+  return [self configStateSet];
+}
+
 + (NSSet*)keyPathsForValuesAffectingExportMetrics {
   return [self configStateSet];
 }
@@ -953,24 +1125,122 @@ static SNTConfigurator* sharedConfigurator = nil;
   return [self configStateSet];
 }
 
-#pragma mark Public Interface
+#pragma mark Config Snapshot
 
-- (SNTClientMode)clientMode {
-  if ([self inTemporaryMonitorMode]) {
-    return SNTClientModeMonitor;
-  }
+- (NSDictionary*)syncState {
+  os_unfair_lock_lock(&_stateLock);
+  NSDictionary* syncState = _syncState;
+  os_unfair_lock_unlock(&_stateLock);
+  return syncState;
+}
 
-  SNTClientMode cm = static_cast<SNTClientMode>([self.syncState[kClientModeKey] integerValue]);
-  if (cm == SNTClientModeMonitor || cm == SNTClientModeLockdown || cm == SNTClientModeStandalone) {
-    return cm;
-  }
+- (void)setSyncState:(NSDictionary*)syncState {
+  os_unfair_lock_lock(&_stateLock);
+  _syncState = syncState;
+  os_unfair_lock_unlock(&_stateLock);
+  [self rebuildConfigSnapshot];
+}
 
-  cm = static_cast<SNTClientMode>([self.configState[kClientModeKey] integerValue]);
-  if (cm == SNTClientModeMonitor || cm == SNTClientModeLockdown || cm == SNTClientModeStandalone) {
-    return cm;
-  }
+- (NSMutableDictionary*)configState {
+  os_unfair_lock_lock(&_stateLock);
+  NSMutableDictionary* configState = _configState;
+  os_unfair_lock_unlock(&_stateLock);
+  return configState;
+}
+
+- (void)setConfigState:(NSMutableDictionary*)configState {
+  os_unfair_lock_lock(&_stateLock);
+  _configState = configState;
+  os_unfair_lock_unlock(&_stateLock);
+  [self rebuildConfigSnapshot];
+}
 
-  return SNTClientModeMonitor;
+- (BOOL)inTemporaryMonitorMode {
+  os_unfair_lock_lock(&_stateLock);
+  BOOL inTemporaryMonitorMode = _inTemporaryMonitorMode;
+  os_unfair_lock_unlock(&_stateLock);
+  return inTemporaryMonitorMode;
+}
+
+- (void)setInTemporaryMonitorMode:(BOOL)inTemporaryMonitorMode {
+  os_unfair_lock_lock(&_stateLock);
+  _inTemporaryMonitorMode = inTemporaryMonitorMode;
+  os_unfair_lock_unlock(&_stateLock);
+  [self rebuildConfigSnapshot];
+}
+
+- (std::shared_ptr<const ConfigSnapshot>)configSnapshot {
+  return std::atomic_load_explicit(&_configSnapshot, std::memory_order_acquire);
+}
+
+///
+///  Resolve the hot-path settings from the current state and publish them.
+///  Called after every change to syncState, configState or
+///  inTemporaryMonitorMode, before KVO observers are notified.
+///
+- (void)rebuildConfigSnapshot {
+  os_unfair_lock_lock(&_snapshotLock);
+
+  os_unfair_lock_lock(&_stateLock);
+  NSDictionary* syncState = _syncState;
+  NSDictionary* configState = _configState;
+  BOOL inTemporaryMonitorMode = _inTemporaryMonitorMode;
+  os_unfair_lock_unlock(&_stateLock);
+
+  auto snapshot = std::make_shared<ConfigSnapshot>();
+
+  auto validMode = [](SNTClientMode cm) {
+    return cm == SNTClientModeMonitor || cm == SNTClientModeLockdown ||
+           cm == SNTClientModeStandalone;
+  };
+  SNTClientMode syncMode = static_cast<SNTClientMode>([syncState[kClientModeKey] integerValue]);
+  SNTClientMode configMode =
+      static_cast<SNTClientMode>([configState[kClientModeKey] integerValue]);
+  if (inTemporaryMonitorMode) {
+    snapshot->clientMode = SNTClientModeMonitor;
+  } else if (validMode(syncMode)) {
+    snapshot->clientMode = syncMode;
+  } else if (validMode(configMode)) {
+    snapshot->clientMode = configMode;
+  }
+
+  snapshot->failClosed = [configState[kFailClosedKey] boolValue] &&
+                         (snapshot->clientMode == SNTClientModeLockdown ||
+                          snapshot->clientMode == SNTClientModeStandalone);
+
+  NSNumber* n = syncState[kEnableTransitiveRulesKey]
+                    ?: syncState[kEnableTransitiveRulesKeyDeprecated]
+                    ?: configState[kEnableTransitiveRulesKeyDeprecated]
+                    ?: configState[kEnableTransitiveRulesKey];
+  snapshot->enableTransitiveRules = [n boolValue];
+
+  snapshot->enableLazyBinaryHashing = [configState[kEnableLazyBinaryHashing] boolValue];
+  snapshot->enableBadSignatureProtection =
+      [configState[kEnableBadSignatureProtectionKey] boolValue];
+  n = configState[kEnablePageZeroProtectionKey];
+  snapshot->enablePageZeroProtection = n ? [n boolValue] : true;
+  snapshot->enablePrehashing = [configState[kEnablePrehashing] boolValue];
+
+  snapshot->allowedPathRegex = syncState[kAllowedPathRegexKey]
+                                   ?: syncState[kAllowedPathRegexKeyDeprecated]
+                                   ?: configState[kAllowedPathRegexKey]
+                                   ?: configState[kAllowedPathRegexKeyDeprecated];
+  snapshot->blockedPathRegex = syncState[kBlockedPathRegexKey]
+                                   ?: syncState[kBlockedPathRegexKeyDeprecated]
+                                   ?: configState[kBlockedPathRegexKey]
+                                   ?: configState[kBlockedPathRegexKeyDeprecated];
+  snapshot->fileChangesRegex = configState[kFileChangesRegexKey];
+
+  std::atomic_store_explicit(&_configSnapshot, std::shared_ptr<const ConfigSnapshot>(snapshot),
+                             std::memory_order_release);
+
+  os_unfair_lock_unlock(&_snapshotLock);
+}
+
+#pragma mark Public Interface
+
+- (SNTClientMode)clientMode {
+  return [self configSnapshot]->clientMode;
 }
 
 - (void)setSyncServerClientMode:(SNTClientMode)newMode {
@@ -1016,23 +1286,11 @@ static SNTConfigurator* sharedConfigurator = nil;
 }
 
 - (BOOL)failClosed {
-  NSNumber* n = self.configState[kFailClosedKey];
-  BOOL runningInLockdownClientMode =
-      self.clientMode == SNTClientModeLockdown || self.clientMode == SNTClientModeStandalone;
-  return [n boolValue] && runningInLockdownClientMode;
+  return [self configSnapshot]->failClosed;
 }
 
 - (BOOL)enableTransitiveRules {
-  NSNumber* n = self.syncState[kEnableTransitiveRulesKey];
-  if (n) return [n boolValue];
-
-  n = self.syncState[kEnableTransitiveRulesKeyDeprecated];
-  if (n) return [n boolValue];
-
-  n = self.configState[kEnableTransitiveRulesKeyDeprecated];
-  if (n) return [n boolValue];
-
-  return [self.configState[kEnableTransitiveRulesKey] boolValue];
+  return [self configSnapshot]->enableTransitiveRules;
 }
 
 - (void)setEnableTransitiveRules:(BOOL)enabled {
@@ -1104,16 +1362,7 @@ static SNTConfigurator* sharedConfigurator = nil;
 }
 
 - (NSRegularExpression*)allowedPathRegex {
-  NSRegularExpression* r = self.syncState[kAllowedPathRegexKey];
-  if (r) return r;
-
-  r = self.syncState[kAllowedPathRegexKeyDeprecated];
-  if (r) return r;
-
-  r = self.configState[kAllowedPathRegexKey];
-  if (r) return r;
-
-  return self.configState[kAllowedPathRegexKeyDeprecated];
+  return [self configSnapshot]->allowedPathRegex;
 }
 
 - (void)setSyncServerAllowedPathRegex:(NSRegularExpression*)re {
@@ -1121,16 +1370,7 @@ static SNTConfigurator* sharedConfigurator = nil;
 }
 
 - (NSRegularExpression*)blockedPathRegex {
-  NSRegularExpression* r = self.syncState[kBlockedPathRegexKey];
-  if (r) return r;
-
-  r = self.syncState[kBlockedPathRegexKeyDeprecated];
-  if (r) return r;
-
-  r = self.configState[kBlockedPathRegexKey];
-  if (r) return r;
-
-  return self.configState[kBlockedPathRegexKeyDeprecated];
+  return [self configSnapshot]->blockedPathRegex;
 }
 
 - (void)setSyncServerBlockedPathRegex:(NSRegularExpression*)re {
@@ -1138,7 +1378,7 @@ static SNTConfigurator* sharedConfigurator = nil;
 }
 
 - (NSRegularExpression*)fileChangesRegex {
-  return self.configState[kFileChangesRegexKey];
+  return [self configSnapshot]->fileChangesRegex;
 }
 
 - (NSArray*)fileChangesPrefixFilters {
@@ -1216,13 +1456,11 @@ static SNTConfigurator* sharedConfigurator = nil;
 }
 
 - (BOOL)enablePageZeroProtection {
-  NSNumber* number = self.configState[kEnablePageZeroProtectionKey];
-  return number ? [number boolValue] : YES;
+  return [self configSnapshot]->enablePageZeroProtection;
 }
 
 - (BOOL)enableBadSignatureProtection {
-  NSNumber* number = self.configState[kEnableBadSignatureProtectionKey];
-  return number ? [number boolValue] : NO;
+  return [self configSnapshot]->enableBadSignatureProtection;
 }
 
 - (BOOL)enableAntiTamperProcessSuspendResume {
@@ -1388,6 +1626,8 @@ static SNTConfigurator* sharedConfigurator = nil;
     return SNTSyncContentEncodingDeflate;
   } else if ([contentEncoding isEqualToString:@"gzip"]) {
     return SNTSyncContentEncodingGzip;
+  } else if ([contentEncoding isEqualToString:@"zstd"]) {
+    return SNTSyncContentEncodingZstd;
   } else if ([contentEncoding isEqualToString:@"none"]) {
     return SNTSyncContentEncodingNone;
   } else {
@@ -1396,6 +1636,10 @@ static SNTConfigurator* sharedConfigurator = nil;
   }
 }
 
+- (NSString*)syncClientContentEncodingDictionary {
+  return self.configState[kClientContentEncodingDictionary];
+}
+
 - (NSData*)syncServerAuthRootsData {
   return self.configState[kServerAuthRootsDataKey];
 }
@@ -1519,8 +1763,12 @@ static SNTConfigurator* sharedConfigurator = nil;
     return SNTEventLogTypeProtobufStreamGzip;
   } else if ([logType isEqualToString:@"protobufstreamzstd"]) {
     return SNTEventLogTypeProtobufStreamZstd;
+  } else if ([logType isEqualToString:@"protobufcolumnar"]) {
+    return SNTEventLogTypeProtobufColumnar;
   } else if ([logType isEqualToString:@"syslog"]) {
     return SNTEventLogTypeSyslog;
+  } else if ([logType isEqualToString:@"unifiedlog"]) {
+    return SNTEventLogTypeUnifiedLog;
   } else if ([logType isEqualToString:@"null"]) {
     return SNTEventLogTypeNull;
   } else if ([logType isEqualToString:@"json"]) {
@@ -1562,6 +1810,51 @@ static SNTConfigurator* sharedConfigurator = nil;
              : 15.0;
 }
 
+- (NSUInteger)spoolDirectoryShardCount {
+  NSUInteger count = [self.configState[kSpoolDirectoryShardCount] unsignedIntegerValue];
+  return MAX(1, MIN(count, 16));
+}
+
+- (NSString*)spoolDirectoryZstdDictionaryPath {
+  return self.configState[kSpoolDirectoryZstdDictionaryPath];
+}
+
+- (NSUInteger)spoolDirectoryCompactionZstdLevel {
+  return [self.configState[kSpoolDirectoryCompactionZstdLevel] unsignedIntegerValue];
+}
+
+- (SNTWriteDurability)writeDurability {
+  NSString* durability = [self.configState[kWriteDurability] lowercaseString];
+  if ([durability isEqualToString:@"batch"]) {
+    return SNTWriteDurabilityBatch;
+  } else if ([durability isEqualToString:@"strict"]) {
+    return SNTWriteDurabilityStrict;
+  } else {
+    return SNTWriteDurabilityNone;
+  }
+}
+
+- (NSUInteger)eventLogQueueSize {
+  NSUInteger size = [self.configState[kEventLogQueueSize] unsignedIntegerValue];
+  return MIN(size, 65536);
+}
+
+- (BOOL)eventLogQueueDropWhenFull {
+  return [self.configState[kEventLogQueueDropWhenFull] boolValue];
+}
+
+- (uint32_t)execArgsMaxBytes {
+  return [self.configState[kExecArgsMaxBytes] unsignedIntValue];
+}
+
+- (uint32_t)execEnvsMaxBytes {
+  return [self.configState[kExecEnvsMaxBytes] unsignedIntValue];
+}
+
+- (BOOL)hashTruncatedExecEnvs {
+  return [self.configState[kHashTruncatedExecEnvs] boolValue];
+}
+
 - (NSDictionary*)fileAccessPolicy {
   return self.configState[kFileAccessPolicy];
 }
@@ -1597,6 +1890,24 @@ static SNTConfigurator* sharedConfigurator = nil;
              : 15;
 }
 
+- (BOOL)enableCacheSnapshot {
+  return [self.configState[kEnableCacheSnapshot] boolValue];
+}
+
+- (uint32_t)cacheSnapshotIntervalSec {
+  return self.configState[kCacheSnapshotIntervalSec]
+             ? [self.configState[kCacheSnapshotIntervalSec] unsignedIntValue]
+             : 60 * 10;
+}
+
+- (BOOL)enablePrehashing {
+  return [self configSnapshot]->enablePrehashing;
+}
+
+- (BOOL)enableLazyBinaryHashing {
+  return [self configSnapshot]->enableLazyBinaryHashing;
+}
+
 - (BOOL)enableTelemetryExport {
   return [self.configState[kEnableTelemetryExport] boolValue];
 }
@@ -1625,6 +1936,20 @@ static SNTConfigurator* sharedConfigurator = nil;
              : 50;
 }
 
+- (uint32_t)telemetryExportStreamingDelaySec {
+  return [self.configState[kTelemetryExportStreamingDelaySec] unsignedIntValue];
+}
+
+- (uint32_t)telemetryExportMaxConcurrentBatches {
+  return self.configState[kTelemetryExportMaxConcurrentBatches]
+             ? [self.configState[kTelemetryExportMaxConcurrentBatches] unsignedIntValue]
+             : 1;
+}
+
+- (uint32_t)telemetryExportMaxKBPerSec {
+  return [self.configState[kTelemetryExportMaxKBPerSec] unsignedIntValue];
+}
+
 - (BOOL)enableMachineIDDecoration {
   NSNumber* number = self.configState[kEnableMachineIDDecoration];
   return number ? [number boolValue] : NO;
@@ -1635,6 +1960,11 @@ static SNTConfigurator* sharedConfigurator = nil;
   return number ? [number boolValue] : NO;
 }
 
+- (NSUInteger)syncEventUploadConcurrency {
+  NSUInteger concurrency = [self.configState[kSyncEventUploadConcurrency] unsignedIntegerValue];
+  return MIN(MAX(concurrency, 1), 8);
+}
+
 - (BOOL)enableAllEventUpload {
   NSNumber* n = self.syncState[kEnableAllEventUploadKey];
   if (n) return [n boolValue];
@@ -1679,11 +2009,89 @@ static SNTConfigurator* sharedConfigurator = nil;
   return events;
 }
 
+- (NSDictionary<NSString*, NSNumber*>*)telemetrySampleRates {
+  NSDictionary* configuredRates = self.configState[kTelemetrySampleRatesKey];
+  if (!configuredRates) {
+    return nil;
+  }
+
+  NSMutableDictionary* rates = [[NSMutableDictionary alloc] initWithCapacity:configuredRates.count];
+  [configuredRates enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL* stop) {
+    if ([key isKindOfClass:[NSString class]] && [value isKindOfClass:[NSNumber class]] &&
+        [value unsignedIntValue] > 0) {
+      rates[key] = value;
+    }
+  }];
+
+  return rates;
+}
+
+- (NSArray<NSString*>*)telemetryAggregatedEvents {
+  NSArray* configuredEvents = self.configState[kTelemetryAggregatedEventsKey];
+  if (!configuredEvents) {
+    return nil;
+  }
+
+  NSMutableArray* events = [[NSMutableArray alloc] initWithCapacity:configuredEvents.count];
+  for (id event in configuredEvents) {
+    if ([event isKindOfClass:[NSString class]]) {
+      [events addObject:event];
+    }
+  }
+
+  return events;
+}
+
+- (NSUInteger)telemetryAggregationWindowSec {
+  NSNumber* number = self.configState[kTelemetryAggregationWindowSec];
+  return number ? MAX(10, MIN([number unsignedIntegerValue], 3600)) : 60;
+}
+
+- (NSUInteger)telemetryLoadSheddingThreshold {
+  return [self.configState[kTelemetryLoadSheddingThreshold] unsignedIntegerValue];
+}
+
+- (NSArray<NSString*>*)telemetryLoadSheddingEvents {
+  NSArray* configuredEvents = self.configState[kTelemetryLoadSheddingEventsKey];
+  if (!configuredEvents) {
+    return nil;
+  }
+
+  NSMutableArray* events = [[NSMutableArray alloc] initWithCapacity:configuredEvents.count];
+  for (id event in configuredEvents) {
+    if ([event isKindOfClass:[NSString class]]) {
+      [events addObject:event];
+    }
+  }
+
+  return events;
+}
+
+- (NSUInteger)networkFlowAggregationWindowSec {
+  NSUInteger value = [self.configState[kNetworkFlowAggregationWindowSec] unsignedIntegerValue];
+  return value ? MAX(10, MIN(value, 3600)) : 0;
+}
+
+- (NSUInteger)networkFlowRingCapacity {
+  NSUInteger value = [self.configState[kNetworkFlowRingCapacity] unsignedIntegerValue];
+  return value ? MAX(1024, MIN(value, 65536)) : 0;
+}
+
 - (BOOL)ignoreOtherEndpointSecurityClients {
   NSNumber* number = self.configState[kIgnoreOtherEndpointSecurityClients];
   return number ? [number boolValue] : NO;
 }
 
+- (NSUInteger)batchedEventDispatchWorkers {
+  NSUInteger workers = [self.configState[kBatchedEventDispatchWorkers] unsignedIntegerValue];
+  return MIN(workers, 64);
+}
+
+- (NSUInteger)authorizerShardCount {
+  NSUInteger shards = [self.configState[kAuthorizerShardCount] unsignedIntegerValue];
+  return MAX(MIN(shards, 8), 1);
+}
+
 - (NSTimeInterval)dnsUpstreamTimeoutSecs {
   NSNumber* v = self.configState[kDNSUpstreamTimeoutSecondsKey];
   return v ? v.doubleValue : 0;  // 0 == unset
@@ -1924,6 +2332,8 @@ static SNTConfigurator* sharedConfigurator = nil;
     return SNTMetricFormatTypeRawJSON;
   } else if ([normalized isEqualToString:@"monarchjson"]) {
     return SNTMetricFormatTypeMonarchJSON;
+  } else if ([normalized isEqualToString:@"prometheus"]) {
+    return SNTMetricFormatTypePrometheus;
   } else if ([normalized isEqualToString:@"proto"]) {
     return SNTMetricFormatTypeProto;
   } else if (normalized.length == 0 && santa::IsDomainPinned([self syncBaseURL])) {
@@ -1964,6 +2374,14 @@ static SNTConfigurator* sharedConfigurator = nil;
   return self.configState[kMetricExtraLabels];
 }
 
+- (BOOL)enableMetricDeltaExport {
+  return [self.configState[kEnableMetricDeltaExport] boolValue];
+}
+
+- (BOOL)enableMetricExportCompression {
+  return [self.configState[kEnableMetricExportCompression] boolValue];
+}
+
 - (NSArray<NSString*>*)enabledProcessAnnotations {
   NSArray<NSString*>* annotations = self.configState[kEnabledProcessAnnotations];
   for (id annotation in annotations) {
@@ -605,6 +605,48 @@ typedef BOOL (^StateFileAccessAuthorizer)(void);
   }
 }
 
+// The hot-path accessors are served from a snapshot, which must be rebuilt
+// whenever any of the state it is resolved from is replaced.
+- (void)testConfigSnapshotFollowsStateChanges {
+  SNTConfigurator* cfg = [[SNTConfigurator alloc] init];
+
+  cfg.configState = [@{
+    @"ClientMode" : @(SNTClientModeLockdown),
+    @"FailClosed" : @YES,
+    @"EnablePageZeroProtection" : @NO,
+    @"FileChangesRegex" : [NSRegularExpression regularExpressionWithPattern:@"^/tmp"
+                                                                    options:0
+                                                                      error:NULL],
+  } mutableCopy];
+  XCTAssertEqual(cfg.clientMode, SNTClientModeLockdown);
+  XCTAssertTrue(cfg.failClosed);
+  XCTAssertFalse(cfg.enablePageZeroProtection);
+  XCTAssertEqualObjects(cfg.fileChangesRegex.pattern, @"^/tmp");
+  XCTAssertNil(cfg.allowedPathRegex);
+
+  // Sync state takes precedence over config state
+  cfg.syncState = [@{
+    @"ClientMode" : @(SNTClientModeMonitor),
+    @"AllowedPathRegex" : [NSRegularExpression regularExpressionWithPattern:@"^/opt"
+                                                                    options:0
+                                                                      error:NULL],
+  } mutableCopy];
+  XCTAssertEqual(cfg.clientMode, SNTClientModeMonitor);
+  XCTAssertFalse(cfg.failClosed);
+  XCTAssertEqualObjects(cfg.allowedPathRegex.pattern, @"^/opt");
+
+  cfg.syncState = [NSMutableDictionary dictionary];
+  XCTAssertEqual(cfg.clientMode, SNTClientModeLockdown);
+  XCTAssertTrue(cfg.failClosed);
+
+  [cfg setInTemporaryMonitorMode:YES];
+  XCTAssertEqual(cfg.clientMode, SNTClientModeMonitor);
+  XCTAssertFalse(cfg.failClosed);
+
+  [cfg setInTemporaryMonitorMode:NO];
+  XCTAssertEqual(cfg.clientMode, SNTClientModeLockdown);
+}
+
 - (void)testDNSUpstreamTimeoutSecsForcedConfig {
   SNTConfigurator* sut = [[SNTConfigurator alloc] init];
   // Unset -> 0, the "use built-in default" sentinel. The default + [1,60]s clamp live downstream
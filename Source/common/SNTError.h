@@ -48,6 +48,7 @@ typedef NS_ENUM(NSInteger, SNTErrorCode) {
   SNTErrorCodeEmptyRuleArray = 510,
   SNTErrorCodeInsertOrReplaceRuleFailed = 511,
   SNTErrorCodeRemoveRuleFailed = 512,
+  SNTErrorCodeStagedUpdateInvalid = 513,
 
   // TMM errors
   SNTErrorCodeTMMNoPolicy = 610,
@@ -86,6 +86,28 @@
 ///
 - (NSString*)SHA256;
 
+///
+///  Seeds the memoized SHA-256 with a value computed earlier for this exact version of the file,
+///  so that the next call to SHA256 does not need to read the file. Has no effect if the SHA-256
+///  was already computed.
+///
+- (void)setPrecomputedSHA256:(NSString*)sha256;
+
+///
+///  Starts computing the SHA-256 on a background queue so that it proceeds while the caller does
+///  other work with the file, such as validating its code signature. The next call to SHA256 waits
+///  for it to finish. Has no effect if the SHA-256 is already known or being computed.
+///
+- (void)beginComputingSHA256;
+
+///
+///  Fills in the stat of the open file, which is the one that is read for hashing even if the path
+///  has since been replaced.
+///
+///  @return NO if the file could not be stat'd.
+///
+- (BOOL)statOpenFile:(struct stat*)fileStat;
+
 ///
 ///  @return The architectures included in this binary (e.g. x86_64, ppc).
 ///
@@ -25,8 +25,11 @@
 #include <sys/stat.h>
 #include <sys/xattr.h>
 
+#include <memory>
+
 #import "Source/common/AccountLookup.h"
 #import "Source/common/CertificateHelpers.h"
+#include "Source/common/ExecTrace.h"
 #import "Source/common/MOLCodesignChecker.h"
 #import "Source/common/SNTError.h"
 #import "Source/common/SNTLogging.h"
@@ -56,6 +59,7 @@
 @property SantaVnode vnode;
 @property NSString* fileOwnerHomeDir;
 @property NSString* sha256Storage;
+@property dispatch_block_t sha256Block;
 
 // Cached properties
 @property NSBundle* bundleRef;
@@ -159,11 +163,22 @@
 - (void)hashSHA1:(NSString**)sha1 SHA256:(NSString**)sha256 {
   const int MAX_CHUNK_SIZE = 256 * 1024;  // 256 KB
   const size_t chunkSize = _fileSize > MAX_CHUNK_SIZE ? MAX_CHUNK_SIZE : _fileSize;
-  char* chunk = static_cast<char*>(malloc(chunkSize));
+
+  // Past a few chunks, the next chunk is read while the previous one is hashed, with each digest
+  // updated on its own thread. Reads stay on pread() rather than a mapping of the file so that a
+  // file truncated while hashing fails the read instead of faulting.
+  const NSUInteger PIPELINE_THRESHOLD = 4 * MAX_CHUNK_SIZE;
+  const BOOL pipelined = _fileSize > PIPELINE_THRESHOLD;
+  char* chunks[2] = {static_cast<char*>(malloc(chunkSize)),
+                     pipelined ? static_cast<char*>(malloc(chunkSize)) : NULL};
+  dispatch_group_t group = pipelined ? dispatch_group_create() : nil;
+  dispatch_queue_t queue = dispatch_get_global_queue(qos_class_self(), 0);
 
   @try {
     CC_SHA1_CTX c1;
     CC_SHA256_CTX c256;
+    CC_SHA1_CTX* c1Ptr = &c1;
+    CC_SHA256_CTX* c256Ptr = &c256;
 
     if (sha1) CC_SHA1_Init(&c1);
     if (sha256) CC_SHA256_Init(&c256);
@@ -177,12 +192,35 @@
     radv.ra_count = (int)_fileSize < MAX_ADVISORY_READ ? (int)_fileSize : MAX_ADVISORY_READ;
     fcntl(fd, F_RDADVISE, &radv);
     ssize_t bytesRead;
+    int current = 0;
 
+    santa::ExecTrace* trace = santa::ExecTrace::Current();
     for (uint64_t offset = 0; offset < _fileSize;) {
+      char* chunk = chunks[current];
       bytesRead = pread(fd, chunk, chunkSize, offset);
+      if (trace && bytesRead > 0) {
+        trace->AddHashBytesRead(bytesRead);
+      }
       if (bytesRead > 0) {
-        if (sha1) CC_SHA1_Update(&c1, chunk, (CC_LONG)bytesRead);
-        if (sha256) CC_SHA256_Update(&c256, chunk, (CC_LONG)bytesRead);
+        if (pipelined) {
+          // The other chunk is free again once the previous updates finish.
+          dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+          CC_LONG length = (CC_LONG)bytesRead;
+          if (sha1) {
+            dispatch_group_async(group, queue, ^{
+              CC_SHA1_Update(c1Ptr, chunk, length);
+            });
+          }
+          if (sha256) {
+            dispatch_group_async(group, queue, ^{
+              CC_SHA256_Update(c256Ptr, chunk, length);
+            });
+          }
+          current ^= 1;
+        } else {
+          if (sha1) CC_SHA1_Update(&c1, chunk, (CC_LONG)bytesRead);
+          if (sha256) CC_SHA256_Update(&c256, chunk, (CC_LONG)bytesRead);
+        }
         offset += bytesRead;
       } else if (bytesRead == -1 && errno == EINTR) {
         continue;
@@ -190,6 +228,7 @@
         return;
       }
     }
+    if (pipelined) dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
 
     // We turn off Read Ahead that we turned on
     fcntl(fd, F_RDAHEAD, 0);
@@ -220,7 +259,10 @@
                          digest[29], digest[30], digest[31]];
     }
   } @finally {
-    free(chunk);
+    // Updates may still be reading a chunk if a read failed part way.
+    if (pipelined) dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    free(chunks[0]);
+    free(chunks[1]);
   }
 }
 
@@ -231,6 +273,13 @@
 }
 
 - (NSString*)SHA256 {
+  santa::ExecTrace::Span span(santa::ExecTraceStage::kHash);
+  if (self.sha256Block) {
+    // Waiting on the block also raises the background hash to this thread's QoS.
+    dispatch_block_wait(self.sha256Block, DISPATCH_TIME_FOREVER);
+    self.sha256Block = nil;
+  }
+
   // Memoize the value
   if (!self.sha256Storage) {
     NSString* sha256;
@@ -240,6 +289,36 @@
   return self.sha256Storage;
 }
 
+- (void)setPrecomputedSHA256:(NSString*)sha256 {
+  if (!self.sha256Storage) {
+    self.sha256Storage = [sha256 copy];
+  }
+}
+
+- (void)beginComputingSHA256 {
+  if (self.sha256Storage || self.sha256Block) {
+    return;
+  }
+
+  // Bytes read in the background still count towards the exec being traced, if any. The time
+  // spent is only counted if SHA256 has to wait for it.
+  santa::ExecTrace* current = santa::ExecTrace::Current();
+  std::shared_ptr<santa::ExecTrace> trace = current ? current->weak_from_this().lock() : nullptr;
+
+  // pread() doesn't move the file offset, so this can run alongside other reads of the file.
+  self.sha256Block = dispatch_block_create(DISPATCH_BLOCK_ASSIGN_CURRENT, ^{
+    santa::ExecTrace::ScopedCurrent scopedTrace(trace.get());
+    NSString* sha256;
+    [self hashSHA1:NULL SHA256:&sha256];
+    [self setPrecomputedSHA256:sha256];
+  });
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), self.sha256Block);
+}
+
+- (BOOL)statOpenFile:(struct stat*)fileStat {
+  return fstat(self.fileHandle.fileDescriptor, fileStat) == 0;
+}
+
 #pragma mark File Type Info
 
 - (NSArray*)architectures {
@@ -798,6 +877,7 @@
 ///
 - (MOLCodesignChecker*)codesignCheckerWithError:(NSError**)error {
   if (!self.cachedCodesignChecker && !self.codesignCheckerError) {
+    santa::ExecTrace::Span span(santa::ExecTraceStage::kCodesign);
     NSError* e;
     self.cachedCodesignChecker = [[MOLCodesignChecker alloc] initWithBinaryPath:self.path error:&e];
     self.codesignCheckerError = e;
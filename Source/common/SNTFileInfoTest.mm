@@ -78,6 +78,44 @@
                         @"5e089b65a1e7a4696d84a34510710b6993d1de21250c41daaec63d9981083eba");
 }
 
+- (void)testSHA256ComputedInBackground {
+  NSString* path = [[NSBundle bundleForClass:[self class]] pathForResource:@"missing_pagezero"
+                                                                    ofType:@""];
+  SNTFileInfo* sut = [[SNTFileInfo alloc] initWithPath:path];
+
+  [sut beginComputingSHA256];
+  // Reading other parts of the file while hashing must not affect the hash.
+  XCTAssertTrue(sut.isMachO);
+  [sut beginComputingSHA256];
+
+  XCTAssertEqualObjects(sut.SHA256,
+                        @"5e089b65a1e7a4696d84a34510710b6993d1de21250c41daaec63d9981083eba");
+}
+
+- (void)testHashLargeFile {
+  // Large enough for the pipelined hashing path, and not a multiple of the chunk size.
+  NSMutableData* data = [NSMutableData dataWithLength:3000000];
+  uint8_t* bytes = static_cast<uint8_t*>(data.mutableBytes);
+  for (NSUInteger i = 0; i < data.length; i++) {
+    bytes[i] = i % 251;
+  }
+
+  NSString* path = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"SNTFileInfo-%@",
+                                                                NSUUID.UUID.UUIDString]];
+  XCTAssertTrue([data writeToFile:path atomically:NO]);
+  SNTFileInfo* sut = [[SNTFileInfo alloc] initWithPath:path];
+
+  NSString *sha1, *sha256;
+  [sut hashSHA1:&sha1 SHA256:&sha256];
+  XCTAssertEqualObjects(sha1, @"4aff3cc3812c535c3026504a756e78332356dd3e");
+  XCTAssertEqualObjects(sha256,
+                        @"4d3870d4655ed773027a713ea136507d22e076248e0e9cc920a996039653b76f");
+  XCTAssertEqualObjects(sut.SHA256, sha256);
+
+  [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
 - (void)testExecutable {
   SNTFileInfo* sut = [[SNTFileInfo alloc] initWithPath:@"/sbin/launchd"];
 
@@ -15,6 +15,12 @@
 #import <Foundation/Foundation.h>
 #import "SNTCommonEnums.h"
 
+#ifdef __cplusplus
+#include <memory>
+
+#include "Source/common/ShardedCounter.h"
+#endif
+
 /**
  * Provides an abstraction for various metric systems that will be exported to
  * monitoring systems via the MetricService. This is used to store internal
@@ -59,6 +65,17 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType);
 - (void)incrementBy:(long long)step forFieldValues:(NSArray<NSString*>*)fieldValues;
 - (void)incrementForFieldValues:(NSArray<NSString*>*)fieldValues;
 - (long long)getCountForFieldValues:(NSArray<NSString*>*)fieldValues;
+
+#ifdef __cplusplus
+/**
+ * Returns the count for the given field values, pre-bound so that it can be
+ * incremented from hot paths without messaging the counter or looking up the
+ * field values again. Increments through the returned counter are included in
+ * exports and in getCountForFieldValues:.
+ */
+- (std::shared_ptr<santa::ShardedCounter>)shardedCounterForFieldValues:
+    (NSArray<NSString*>*)fieldValues;
+#endif
 @end
 
 @interface SNTMetricInt64Gauge : SNTMetric
@@ -41,6 +41,13 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
  *  It is intended to only be used by SNTMetrics;
  */
 @interface SNTMetricValue : NSObject
+/**
+ * Counter values are kept in a ShardedCounter, so that adding to them is
+ * lock-free. Their last update timestamp is only refreshed when the value is
+ * read for export and has changed since the previous read.
+ */
+- (instancetype)initWithShardedCounter;
+
 /** Increment the counter by the step value, updating timestamps appropriately. */
 - (void)addInt64:(long long)step;
 
@@ -64,6 +71,7 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 - (void)clearLastUpdateTimestamp;
 
 /** Getters */
+- (std::shared_ptr<santa::ShardedCounter>)shardedCounter;
 - (long long)getInt64Value;
 - (double)getDoubleValue;
 - (NSString*)getStringValue;
@@ -87,6 +95,12 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 
   /** The last time that the counter value was changed. */
   NSDate* _lastUpdate;
+
+  /** Holds the int64 value for counters, if set. */
+  std::shared_ptr<santa::ShardedCounter> _shardedCounter;
+
+  /** The sharded counter's value when its last update timestamp was refreshed. */
+  long long _lastSeenCount;
 }
 
 - (instancetype)init {
@@ -98,7 +112,24 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
   return self;
 }
 
+- (instancetype)initWithShardedCounter {
+  self = [self init];
+  if (self) {
+    _shardedCounter = std::make_shared<santa::ShardedCounter>();
+  }
+  return self;
+}
+
+- (std::shared_ptr<santa::ShardedCounter>)shardedCounter {
+  return _shardedCounter;
+}
+
 - (void)addInt64:(long long)step {
+  if (_shardedCounter) {
+    _shardedCounter->Add(step);
+    return;
+  }
+
   @synchronized(self) {
     _int64Value += step;
     _lastUpdate = [NSDate date];
@@ -113,6 +144,10 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 }
 
 - (long long)getInt64Value {
+  if (_shardedCounter) {
+    return _shardedCounter->Sum();
+  }
+
   @synchronized(self) {
     return _int64Value;
   }
@@ -166,6 +201,13 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 - (NSDate*)getLastUpdatedTimestamp {
   NSDate* updated = nil;
   @synchronized(self) {
+    if (_shardedCounter) {
+      long long count = _shardedCounter->Sum();
+      if (count != _lastSeenCount) {
+        _lastSeenCount = count;
+        _lastUpdate = [NSDate date];
+      }
+    }
     updated = [_lastUpdate copy];
   }
   return updated;
@@ -234,7 +276,8 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
     if (!metricValue) {
       // Deep copy to prevent mutations to the keys we store in the dictionary.
       fieldValues = [fieldValues copy];
-      metricValue = [[SNTMetricValue alloc] init];
+      metricValue = _type == SNTMetricTypeCounter ? [[SNTMetricValue alloc] initWithShardedCounter]
+                                                  : [[SNTMetricValue alloc] init];
       _metricsForFieldValues[fieldValues] = metricValue;
     }
   }
@@ -325,6 +368,11 @@ NSString* SNTMetricMakeStringFromMetricType(SNTMetricType metricType) {
 
   return [metricValue getInt64Value];
 }
+
+- (std::shared_ptr<santa::ShardedCounter>)shardedCounterForFieldValues:
+    (NSArray<NSString*>*)fieldValues {
+  return [[self metricValueForFieldValues:fieldValues] shardedCounter];
+}
 @end
 
 @implementation SNTMetricInt64Gauge
@@ -637,6 +685,7 @@ NSString* SNTMetricStringFromMetricFormatType(SNTMetricFormatType format) {
     case SNTMetricFormatTypeRawJSON: return @"rawjson";
     case SNTMetricFormatTypeMonarchJSON: return @"monarchjson";
     case SNTMetricFormatTypeProto: return @"proto";
+    case SNTMetricFormatTypePrometheus: return @"prometheus";
     default: return @"Unknown Metric Format";
   }
 }
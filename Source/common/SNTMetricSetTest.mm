@@ -91,6 +91,33 @@
   XCTAssertEqualObjects([c export], expected);
 }
 
+- (void)testShardedCounterForFieldValues {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
+  SNTMetricCounter* c =
+      [metricSet counterWithName:@"/santa/events"
+                      fieldNames:@[ @"rule_type" ]
+                        helpText:@"Count of exec events broken out by rule type."];
+
+  std::shared_ptr<santa::ShardedCounter> bound = [c shardedCounterForFieldValues:@[ @"binary" ]];
+  XCTAssertTrue(bound);
+  XCTAssertEqual(bound, [c shardedCounterForFieldValues:@[ @"binary" ]]);
+
+  bound->Increment();
+  [c incrementBy:2 forFieldValues:@[ @"binary" ]];
+  bound->Add(3);
+  XCTAssertEqual(6, [c getCountForFieldValues:@[ @"binary" ]]);
+  XCTAssertEqual(0, [c getCountForFieldValues:@[ @"certificate" ]]);
+
+  NSDictionary* exported = [c export];
+  NSArray* values = exported[@"fields"][@"rule_type"];
+  NSUInteger binaryIndex =
+      [values indexOfObjectPassingTest:^BOOL(id obj, NSUInteger idx, BOOL* stop) {
+        return [obj[@"value"] isEqualToString:@"binary"];
+      }];
+  XCTAssertNotEqual(binaryIndex, NSNotFound);
+  XCTAssertEqualObjects(values[binaryIndex][@"data"], @6);
+}
+
 - (void)testAddingMetricWithSameSchema {
   SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
   SNTMetricCounter* a = [metricSet counterWithName:@"/santa/counter"
@@ -0,0 +1,108 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_SNTSIGNINGINFOCACHE_H
+#define SANTA_COMMON_SNTSIGNINGINFOCACHE_H
+
+#import <Foundation/Foundation.h>
+
+#include "Source/common/SantaCacheStats.h"
+
+@class MOLCertificate;
+@class MOLCodesignChecker;
+
+NS_ASSUME_NONNULL_BEGIN
+
+///
+///  The parts of a valid code signature that Santa makes decisions on.
+///
+///  Everything here is covered by the CodeDirectory, or by the signature over it, so it is the
+///  same for every binary with the same CDHash and is never changed once created.
+///
+@interface SNTSigningInfo : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+///
+///  Copies the signing info out of a checker that validated without error.
+///
+- (instancetype)initWithCodesignChecker:(MOLCodesignChecker*)csc;
+
+///
+///  Creates signing info from fields read out of a signature the kernel has already validated.
+///  The certificates are only loaded, by calling certificatesLoader once, the first time they
+///  are needed.
+///
+- (instancetype)initWithCDHash:(NSString*)cdhash
+                     signingID:(nullable NSString*)signingID
+                        teamID:(nullable NSString*)teamID
+                platformBinary:(BOOL)platformBinary
+                signatureFlags:(uint32_t)signatureFlags
+                  entitlements:(nullable NSDictionary*)entitlements
+                   signingTime:(nullable NSDate*)signingTime
+             secureSigningTime:(nullable NSDate*)secureSigningTime
+            certificatesLoader:(NSArray<MOLCertificate*>* (^)(void))certificatesLoader;
+
+@property(readonly, nullable) NSString* cdhash;
+@property(readonly) NSArray<MOLCertificate*>* certificates;
+@property(readonly, nullable) MOLCertificate* leafCertificate;
+@property(readonly, nullable) NSString* teamID;
+@property(readonly, nullable) NSString* signingID;
+@property(readonly) BOOL platformBinary;
+@property(readonly) uint32_t signatureFlags;
+@property(readonly, nullable) NSDictionary* entitlements;
+@property(readonly, nullable) NSDate* signingTime;
+@property(readonly, nullable) NSDate* secureSigningTime;
+
+@end
+
+///
+///  A process-wide, bounded cache of signing info.
+///
+///  Validating a code signature and parsing its certificates is slow, and many binaries are
+///  signed with the same certificates. Signing info is looked up by CDHash so a signature is only
+///  validated once, and the certificate chains are shared by every signature with the same leaf
+///  certificate.
+///
+///  Callers must only look up CDHashes the kernel has validated for the binary being evaluated,
+///  e.g. from an es_process_t whose pages are strictly enforced.
+///
+@interface SNTSigningInfoCache : NSObject
+
++ (instancetype)sharedCache;
+
+///
+///  Returns the signing info for a lowercase hex CDHash, or nil if it isn't cached.
+///
+- (nullable SNTSigningInfo*)signingInfoForCDHash:(nullable NSString*)cdhash;
+
+///
+///  Caches the signing info from a checker that validated without error. Returns the cached info,
+///  or nil if the checker has no CDHash.
+///
+- (nullable SNTSigningInfo*)addCodesignChecker:(MOLCodesignChecker*)csc;
+
+///
+///  Caches signing info that was created from a kernel-validated signature. Returns nil, without
+///  caching anything, if it has no CDHash.
+///
+- (nullable SNTSigningInfo*)addSigningInfo:(SNTSigningInfo*)signingInfo;
+
+- (SantaCacheStats)cacheStats;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif  // SANTA_COMMON_SNTSIGNINGINFOCACHE_H
@@ -0,0 +1,163 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/common/SNTSigningInfoCache.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#import "Source/common/MOLCertificate.h"
+#import "Source/common/MOLCodesignChecker.h"
+#include "Source/common/SantaCache.h"
+
+// One entry per distinct signature seen, e.g. every tool in a toolchain.
+static constexpr uint64_t kMaxSigningInfos = 4096;
+// Far fewer distinct certificate chains than signatures.
+static constexpr uint64_t kMaxCertificateChains = 512;
+
+@implementation SNTSigningInfo {
+  NSArray<MOLCertificate*>* _certificates;
+  NSArray<MOLCertificate*>* (^_certificatesLoader)(void);
+  std::once_flag _certificatesOnce;
+}
+
+- (instancetype)initWithCodesignChecker:(MOLCodesignChecker*)csc {
+  return [self initWithCodesignChecker:csc certificates:csc.certificates ?: @[]];
+}
+
+- (instancetype)initWithCodesignChecker:(MOLCodesignChecker*)csc
+                           certificates:(NSArray<MOLCertificate*>*)certificates {
+  self = [super init];
+  if (self) {
+    _cdhash = [csc.cdhash copy];
+    _certificates = certificates;
+    _teamID = [csc.teamID copy];
+    _signingID = [csc.signingID copy];
+    _platformBinary = csc.platformBinary;
+    _signatureFlags = csc.signatureFlags;
+    _entitlements = [csc.entitlements copy];
+    _signingTime = csc.signingTime;
+    _secureSigningTime = csc.secureSigningTime;
+  }
+  return self;
+}
+
+- (instancetype)initWithCDHash:(NSString*)cdhash
+                     signingID:(NSString*)signingID
+                        teamID:(NSString*)teamID
+                platformBinary:(BOOL)platformBinary
+                signatureFlags:(uint32_t)signatureFlags
+                  entitlements:(NSDictionary*)entitlements
+                   signingTime:(NSDate*)signingTime
+             secureSigningTime:(NSDate*)secureSigningTime
+            certificatesLoader:(NSArray<MOLCertificate*>* (^)(void))certificatesLoader {
+  self = [super init];
+  if (self) {
+    _cdhash = [cdhash copy];
+    _certificatesLoader = certificatesLoader;
+    _teamID = [teamID copy];
+    _signingID = [signingID copy];
+    _platformBinary = platformBinary;
+    _signatureFlags = signatureFlags;
+    _entitlements = [entitlements copy];
+    _signingTime = signingTime;
+    _secureSigningTime = secureSigningTime;
+  }
+  return self;
+}
+
+- (NSArray<MOLCertificate*>*)certificates {
+  std::call_once(_certificatesOnce, [self] {
+    if (_certificatesLoader) {
+      _certificates = _certificatesLoader() ?: @[];
+      _certificatesLoader = nil;
+    }
+  });
+  return _certificates;
+}
+
+- (MOLCertificate*)leafCertificate {
+  return self.certificates.firstObject;
+}
+
+@end
+
+@implementation SNTSigningInfoCache {
+  std::unique_ptr<SantaCache<std::string, SNTSigningInfo*>> _signingInfos;
+  // Keyed by the SHA-256 of the leaf certificate.
+  std::unique_ptr<SantaCache<std::string, NSArray<MOLCertificate*>*>> _certificateChains;
+}
+
++ (instancetype)sharedCache {
+  static SNTSigningInfoCache* cache;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    cache = [[SNTSigningInfoCache alloc] init];
+  });
+  return cache;
+}
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _signingInfos = std::make_unique<SantaCache<std::string, SNTSigningInfo*>>(
+        kMaxSigningInfos, 4, SantaCacheEvictionPolicy::kClock);
+    _certificateChains = std::make_unique<SantaCache<std::string, NSArray<MOLCertificate*>*>>(
+        kMaxCertificateChains, 4, SantaCacheEvictionPolicy::kClock);
+  }
+  return self;
+}
+
+- (SNTSigningInfo*)signingInfoForCDHash:(NSString*)cdhash {
+  if (!cdhash.length) return nil;
+  return _signingInfos->get(cdhash.UTF8String);
+}
+
+- (SNTSigningInfo*)addCodesignChecker:(MOLCodesignChecker*)csc {
+  NSString* cdhash = csc.cdhash;
+  if (!cdhash.length) return nil;
+
+  NSArray<MOLCertificate*>* certificates = csc.certificates ?: @[];
+  NSString* leafSHA256 = csc.leafCertificate.SHA256;
+  if (leafSHA256.length) {
+    std::string key = leafSHA256.UTF8String;
+    NSArray<MOLCertificate*>* cached = _certificateChains->get(key);
+    // The leaf is the same, but the intermediates could differ, e.g. after a reissue.
+    if (cached && [cached isEqualToArray:certificates]) {
+      certificates = cached;
+    } else {
+      _certificateChains->set(key, certificates);
+    }
+  }
+
+  SNTSigningInfo* info = [[SNTSigningInfo alloc] initWithCodesignChecker:csc
+                                                            certificates:certificates];
+  _signingInfos->set(cdhash.UTF8String, info);
+  return info;
+}
+
+- (SNTSigningInfo*)addSigningInfo:(SNTSigningInfo*)signingInfo {
+  NSString* cdhash = signingInfo.cdhash;
+  if (!cdhash.length) return nil;
+
+  _signingInfos->set(cdhash.UTF8String, signingInfo);
+  return signingInfo;
+}
+
+- (SantaCacheStats)cacheStats {
+  return _signingInfos->stats();
+}
+
+@end
@@ -0,0 +1,92 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/common/SNTSigningInfoCache.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#import "Source/common/MOLCertificate.h"
+#import "Source/common/MOLCodesignChecker.h"
+
+@interface SNTSigningInfoCacheTest : XCTestCase
+@end
+
+@implementation SNTSigningInfoCacheTest
+
+- (void)testAddAndLookup {
+  SNTSigningInfoCache* cache = [[SNTSigningInfoCache alloc] init];
+  MOLCodesignChecker* csc = [[MOLCodesignChecker alloc] initWithBinaryPath:@"/sbin/launchd"];
+  XCTAssertNotNil(csc);
+
+  XCTAssertNil([cache signingInfoForCDHash:csc.cdhash]);
+
+  SNTSigningInfo* info = [cache addCodesignChecker:csc];
+  XCTAssertNotNil(info);
+  XCTAssertEqualObjects(info.cdhash, csc.cdhash);
+  XCTAssertEqualObjects(info.leafCertificate, csc.leafCertificate);
+  XCTAssertEqualObjects(info.certificates, csc.certificates);
+  XCTAssertEqualObjects(info.signingID, csc.signingID);
+  XCTAssertEqualObjects(info.teamID, csc.teamID);
+  XCTAssertEqual(info.platformBinary, csc.platformBinary);
+  XCTAssertEqual(info.signatureFlags, csc.signatureFlags);
+  XCTAssertEqualObjects(info.entitlements, csc.entitlements);
+
+  XCTAssertEqual([cache signingInfoForCDHash:csc.cdhash], info);
+  XCTAssertNil([cache signingInfoForCDHash:@""]);
+  XCTAssertNil([cache signingInfoForCDHash:@"0000000000000000000000000000000000000000"]);
+}
+
+- (void)testCertificateChainsShared {
+  SNTSigningInfoCache* cache = [[SNTSigningInfoCache alloc] init];
+  MOLCodesignChecker* launchd = [[MOLCodesignChecker alloc] initWithBinaryPath:@"/sbin/launchd"];
+  MOLCodesignChecker* yes = [[MOLCodesignChecker alloc] initWithBinaryPath:@"/usr/bin/yes"];
+  XCTAssertEqualObjects(launchd.leafCertificate, yes.leafCertificate);
+  XCTAssertNotEqualObjects(launchd.cdhash, yes.cdhash);
+
+  SNTSigningInfo* launchdInfo = [cache addCodesignChecker:launchd];
+  SNTSigningInfo* yesInfo = [cache addCodesignChecker:yes];
+
+  // Both binaries are signed by the same chain, so the same objects are used for both.
+  XCTAssertEqual(launchdInfo.certificates, yesInfo.certificates);
+  XCTAssertEqualObjects(yesInfo.signingID, yes.signingID);
+}
+
+- (void)testCertificatesLoadedLazily {
+  SNTSigningInfoCache* cache = [[SNTSigningInfoCache alloc] init];
+  MOLCodesignChecker* csc = [[MOLCodesignChecker alloc] initWithBinaryPath:@"/sbin/launchd"];
+  __block int loads = 0;
+
+  SNTSigningInfo* info = [[SNTSigningInfo alloc] initWithCDHash:csc.cdhash
+                                                      signingID:csc.signingID
+                                                         teamID:csc.teamID
+                                                 platformBinary:csc.platformBinary
+                                                 signatureFlags:csc.signatureFlags
+                                                   entitlements:csc.entitlements
+                                                    signingTime:csc.signingTime
+                                              secureSigningTime:csc.secureSigningTime
+                                             certificatesLoader:^NSArray<MOLCertificate*>* {
+                                               loads++;
+                                               return csc.certificates;
+                                             }];
+  XCTAssertEqual([cache addSigningInfo:info], info);
+  XCTAssertEqual([cache signingInfoForCDHash:csc.cdhash], info);
+  XCTAssertEqual(loads, 0);
+
+  XCTAssertEqualObjects(info.leafCertificate, csc.leafCertificate);
+  XCTAssertEqualObjects(info.certificates, csc.certificates);
+  XCTAssertEqual(loads, 1);
+}
+
+@end
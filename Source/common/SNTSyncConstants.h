@@ -171,3 +171,8 @@ extern const NSUInteger kDefaultPushNotificationsGlobalRuleSyncDeadline;
 ///  response to a tag push notification that does not specify its own jitter.
 ///
 extern const NSUInteger kDefaultPushNotificationTagSyncJitterSeconds;
+
+///
+///  The longest (in seconds) a Retry-After from the sync server will hold off syncing.
+///
+extern const NSUInteger kMaxServerRetryAfterSeconds;
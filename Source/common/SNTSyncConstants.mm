@@ -159,3 +159,4 @@ const NSUInteger kDefaultFullSyncInterval = 600;
 const NSUInteger kDefaultPushNotificationsFullSyncInterval = 14400;
 const NSUInteger kDefaultPushNotificationsGlobalRuleSyncDeadline = 600;
 const NSUInteger kDefaultPushNotificationTagSyncJitterSeconds = 180;
+const NSUInteger kMaxServerRetryAfterSeconds = 3600;
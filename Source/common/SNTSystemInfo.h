@@ -15,6 +15,16 @@
 
 #import <Foundation/Foundation.h>
 
+///
+///  The kind of storage a volume lives on, as reported by the device characteristics of the
+///  physical device under it.
+///
+typedef NS_ENUM(NSInteger, SNTStorageMedium) {
+  SNTStorageMediumUnknown,
+  SNTStorageMediumSolidState,
+  SNTStorageMediumRotational,
+};
+
 ///
 ///  Simple class for fetching system information
 ///
@@ -84,4 +94,16 @@
 ///
 + (NSString*)santanetdBundledVersion;
 
+///
+///  @return The medium of the device holding the volume the path is on, or
+///      SNTStorageMediumUnknown if it can't be found, e.g. for network volumes.
+///
++ (SNTStorageMedium)storageMediumForPath:(NSString*)path;
+
+///
+///  @return YES if the device holding the volume the path is on is attached externally, e.g. over
+///      USB or Thunderbolt.
+///
++ (BOOL)isExternalStorageForPath:(NSString*)path;
+
 @end
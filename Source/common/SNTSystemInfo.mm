@@ -18,6 +18,11 @@
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTFileInfo.h"
 
+#include <IOKit/IOBSD.h>
+#include <IOKit/IOKitLib.h>
+#include <IOKit/storage/IOStorageDeviceCharacteristics.h>
+#include <IOKit/storage/IOStorageProtocolCharacteristics.h>
+#include <sys/mount.h>
 #include <sys/sysctl.h>
 
 @implementation SNTSystemInfo
@@ -120,8 +125,50 @@
   return [netdInfo bundleVersion];
 }
 
++ (SNTStorageMedium)storageMediumForPath:(NSString*)path {
+  NSDictionary* characteristics =
+      [SNTSystemInfo _storageProperty:@kIOPropertyDeviceCharacteristicsKey forPath:path];
+  NSString* mediumType = characteristics[@kIOPropertyMediumTypeKey];
+  if ([mediumType isEqualToString:@kIOPropertyMediumTypeSolidStateKey]) {
+    return SNTStorageMediumSolidState;
+  } else if ([mediumType isEqualToString:@kIOPropertyMediumTypeRotationalKey]) {
+    return SNTStorageMediumRotational;
+  }
+  return SNTStorageMediumUnknown;
+}
+
++ (BOOL)isExternalStorageForPath:(NSString*)path {
+  NSDictionary* characteristics =
+      [SNTSystemInfo _storageProperty:@kIOPropertyProtocolCharacteristicsKey forPath:path];
+  return [characteristics[@kIOPropertyPhysicalInterconnectLocationKey]
+      isEqualToString:@kIOPropertyExternalKey];
+}
+
 #pragma mark - Internal
 
+// Find a property of the storage device holding the volume the path is on. The property is searched
+// for in the parents of the volume's media, which for APFS includes the physical store under the
+// container.
++ (NSDictionary*)_storageProperty:(NSString*)key forPath:(NSString*)path {
+  struct statfs sfs;
+  if (statfs(path.fileSystemRepresentation, &sfs) != 0) return nil;
+
+  const char* bsdName = sfs.f_mntfromname;
+  if (strncmp(bsdName, "/dev/", 5) != 0) return nil;
+  bsdName += 5;
+
+  io_service_t media = IOServiceGetMatchingService(
+      kIOMainPortDefault, IOBSDNameMatching(kIOMainPortDefault, 0, bsdName));
+  if (!media) return nil;
+
+  id property = CFBridgingRelease(IORegistryEntrySearchCFProperty(
+      media, kIOServicePlane, (__bridge CFStringRef)key, kCFAllocatorDefault,
+      kIORegistryIterateRecursively | kIORegistryIterateParents));
+  IOObjectRelease(media);
+
+  return [property isKindOfClass:[NSDictionary class]] ? property : nil;
+}
+
 + (NSDictionary*)_systemVersionDictionary {
   return [NSDictionary
       dictionaryWithContentsOfFile:@"/System/Library/CoreServices/SystemVersion.plist"];
@@ -47,6 +47,11 @@ typedef void (^SNTBundleHashBlock)(NSString*, NSArray<SNTStoredExecutionEvent*>*
 ///  @param reply A SNTBundleHashBlock to be executed upon completion or cancellation.
 ///
 ///  @note If there is a current NSProgress when called this method will report back its progress.
+///      Progress is reported to the listener at most every 100ms.
+///
+///  @note Hashing for a listener runs at user-initiated QoS. Invalidating the listener, e.g. when
+///      the dialog waiting on it is closed, lets hashing finish at background QoS so the results
+///      are cached for the next request. Cancelling the NSProgress stops hashing.
 ///
 - (void)hashBundleBinariesForEvent:(SNTStoredExecutionEvent*)event
                           listener:(NSXPCListenerEndpoint*)listener
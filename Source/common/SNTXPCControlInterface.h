@@ -37,6 +37,10 @@
 ///  Cache ops
 ///
 - (void)flushCache:(void (^)(BOOL))reply;
+///  Remove only the entries for the given vnodes, passed as packed SantaVnode structs.
+- (void)flushCacheForVnodeIDs:(NSData*)vnodeIDs reply:(void (^)(uint64_t removed))reply;
+///  Remove only the entries for files on the given device.
+- (void)flushCacheForDevice:(uint64_t)fsid reply:(void (^)(uint64_t removed))reply;
 
 ///
 ///  Database ops
@@ -52,11 +56,52 @@ typedef NS_ENUM(NSInteger, SNTRuleAddSource) {
                           ruleCleanup:(SNTRuleCleanup)cleanupType
                                source:(SNTRuleAddSource)source
                                 reply:(void (^)(BOOL, NSArray<NSError*>* error))reply;
-- (void)databaseEventsPending:(void (^)(NSArray<SNTStoredEvent*>* events))reply;
+
+///
+///  Staged rule updates add rules in chunks that are applied in a single transaction when the
+///  update is committed, with the same semantics as databaseRuleAddExecutionRules:... Only one
+///  staged update exists at a time; beginning a new one discards any uncommitted one.
+///
+- (void)databaseRuleBeginStagedUpdateFromSource:(SNTRuleAddSource)source
+                                          reply:(void (^)(NSString* updateID,
+                                                          NSError* error))reply;
+- (void)databaseRuleStageExecutionRules:(NSArray<SNTRule*>*)executionRules
+                        fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+                       networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                                signals:(NSArray<SNTSignal*>*)signals
+                               updateID:(NSString*)updateID
+                                  reply:(void (^)(BOOL, NSArray<NSError*>* error))reply;
+///  Stage a serialized santa::rulebatch::ExecutionRuleBatch. Large rule sets are sent this way so
+///  neither process creates an SNTRule for every rule.
+- (void)databaseRuleStageExecutionRuleBatch:(NSData*)batch
+                                   updateID:(NSString*)updateID
+                                      reply:(void (^)(BOOL, NSArray<NSError*>* error))reply;
+- (void)databaseRuleCommitStagedUpdate:(NSString*)updateID
+                           ruleCleanup:(SNTRuleCleanup)cleanupType
+                                 reply:(void (^)(BOOL, NSArray<NSError*>* error))reply;
+- (void)databaseRuleAbortStagedUpdate:(NSString*)updateID;
+///  Pending events are fetched a page at a time, in order of their index. Pass nil to fetch the
+///  first page, then the index of the last event of each page to fetch the next one.
+///
+///  Pages are encoded by santa::EncodeStoredEventBatch, which sends each certificate of their
+///  signing chains only once. Pages with events that have no protobuf encoding are sent as events
+///  instead, and encodedEvents is nil.
+- (void)databaseEventsPendingAfterIndex:(NSNumber*)index
+                                  limit:(NSUInteger)limit
+                                  reply:(void (^)(NSData* encodedEvents,
+                                                  NSArray<SNTStoredEvent*>* events))reply;
 - (void)databaseRemoveEventsWithIDs:(NSArray*)ids;
 - (void)databaseSignalReportsPending:(void (^)(NSArray<SNTStoredSignalReport*>* reports))reply;
 - (void)databaseRemoveSignalReportsWithIDs:(NSArray*)ids;
 - (void)retrieveAllExecutionRules:(void (^)(NSArray<SNTRule*>* rules, NSError* error))reply;
+///
+///  Stream all exportable execution rules as JSON, in the form read by santactl rule --import, to
+///  the given file handle. The rules are written as they are read from the database rather than
+///  collected and sent back over XPC, so large databases can be exported cheaply. Replies with the
+///  number of rules written.
+///
+- (void)exportExecutionRulesToFileHandle:(NSFileHandle*)fileHandle
+                                   reply:(void (^)(NSUInteger count, NSError* error))reply;
 - (void)retrieveAllFileAccessRules:
     (void (^)(NSDictionary<NSString*, NSDictionary*>* fileAccessRules, NSError* error))reply;
 
@@ -82,6 +127,34 @@ typedef NS_ENUM(NSInteger, SNTRuleAddSource) {
 ///
 - (void)uploadBinary:(NSData*)serializedRequest reply:(void (^)(NSData* serializedResponse))reply;
 
+///
+///  Exec tracing ops
+///
+///  Start timing each stage of authorizing matching execs, replacing any tracing already in
+///  progress. A nil pid or empty pathPrefix matches all execs, and 1 in every sampleRate matching
+///  execs is traced. Tracing stops by itself after durationSeconds. Finished traces are kept until
+///  fetched with execTraces:, and are also written to the telemetry log when exportTraces is YES.
+///
+- (void)enableExecTracingForPID:(NSNumber*)pid
+                     pathPrefix:(NSString*)pathPrefix
+                     sampleRate:(uint32_t)sampleRate
+                durationSeconds:(uint32_t)durationSeconds
+                   exportTraces:(BOOL)exportTraces
+                          reply:(void (^)(void))reply;
+- (void)disableExecTracing:(void (^)(void))reply;
+///  Returns the traces finished since the last call, oldest first, and whether tracing is still
+///  enabled.
+- (void)execTraces:(void (^)(NSArray<NSDictionary*>* traces, BOOL enabled))reply;
+
+///
+///  Memory diagnostics ops
+///
+///  Summarize santad's live malloc heap by zone, block size and Objective-C class, along with the
+///  bytes attributed to each subsystem. Allocation in santad is paused while each zone is walked,
+///  so samples are limited to one a minute and error is set when one is requested too soon.
+///
+- (void)heapSample:(void (^)(NSDictionary* sample, NSError* error))reply;
+
 ///
 /// Control Ops
 ///
@@ -57,8 +57,8 @@ static NSString* const kSantanetdExtensionBundleID = @"com.northpolesec.santa.ne
 
 + (void)initializeControlInterface:(NSXPCInterface*)r {
   [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTStoredEvent class], nil]
-        forSelector:@selector(databaseEventsPending:)
-      argumentIndex:0
+        forSelector:@selector(databaseEventsPendingAfterIndex:limit:reply:)
+      argumentIndex:1
             ofReply:YES];
 
   [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTStoredSignalReport class], nil]
@@ -101,6 +101,51 @@ static NSString* const kSantanetdExtensionBundleID = @"com.northpolesec.santa.ne
       argumentIndex:1
             ofReply:YES];
 
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTRule class], nil]
+        forSelector:@selector
+        (databaseRuleStageExecutionRules:
+                       fileAccessRules:networkFlowRules:signals:updateID:reply:)
+      argumentIndex:0
+            ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTFileAccessRule class], nil]
+        forSelector:@selector
+        (databaseRuleStageExecutionRules:
+                       fileAccessRules:networkFlowRules:signals:updateID:reply:)
+      argumentIndex:1
+            ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTNetworkFlowRule class], nil]
+        forSelector:@selector
+        (databaseRuleStageExecutionRules:
+                       fileAccessRules:networkFlowRules:signals:updateID:reply:)
+      argumentIndex:2
+            ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTSignal class], nil]
+        forSelector:@selector
+        (databaseRuleStageExecutionRules:
+                       fileAccessRules:networkFlowRules:signals:updateID:reply:)
+      argumentIndex:3
+            ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [NSError class], nil]
+        forSelector:@selector
+        (databaseRuleStageExecutionRules:
+                       fileAccessRules:networkFlowRules:signals:updateID:reply:)
+      argumentIndex:1
+            ofReply:YES];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [NSError class], nil]
+        forSelector:@selector(databaseRuleStageExecutionRuleBatch:updateID:reply:)
+      argumentIndex:1
+            ofReply:YES];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [NSError class], nil]
+        forSelector:@selector(databaseRuleCommitStagedUpdate:ruleCleanup:reply:)
+      argumentIndex:1
+            ofReply:YES];
+
   [r setClasses:[NSSet setWithObjects:[NSArray class], [SNTRule class], nil]
         forSelector:@selector(retrieveAllExecutionRules:)
       argumentIndex:0
@@ -125,10 +170,16 @@ static NSString* const kSantanetdExtensionBundleID = @"com.northpolesec.santa.ne
             ofReply:NO];
 
   [r setClasses:[NSSet setWithObjects:[SNTNetworkExtensionSettings class], [NSArray class],
-                                      [SNTNetworkFlowRule class], [NSData class], nil]
+                                      [SNTNetworkFlowRule class], [NSData class],
+                                      [NSFileHandle class], nil]
         forSelector:@selector(registerNetworkExtensionWithProtocolVersion:reply:)
       argumentIndex:0
             ofReply:YES];
+
+  [r setXPCType:XPC_TYPE_ENDPOINT
+        forSelector:@selector(fastPathEndpoint:)
+      argumentIndex:0
+            ofReply:YES];
 }
 
 + (NSXPCInterface*)controlInterface {
@@ -0,0 +1,92 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#include <xpc/xpc.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+///
+///  A lightweight libxpc channel for a few frequent calls with simple argument and reply types.
+///
+///  Messages are plain XPC dictionaries, so there is no proxy creation, class allowlist validation
+///  or archiving on either side. The channel is an anonymous listener whose endpoint is only handed
+///  out over an already validated NSXPC connection (see fastPathEndpoint: in
+///  SNTUnprivilegedDaemonControlXPC), so it needs no peer validation of its own.
+///
+///  Only operations whose NSXPC equivalent is in the unprivileged interface belong here.
+///
+
+/// Operation identifiers, stored under kSNTXPCFastPathOperationKey. The values are shared between
+/// santactl and santad, so only append to this.
+typedef NS_ENUM(uint64_t, SNTXPCFastPathOperation) {
+  SNTXPCFastPathOperationUnknown = 0,
+  /// Reply: kSNTXPCFastPathRootCacheCountKey, kSNTXPCFastPathNonRootCacheCountKey
+  SNTXPCFastPathOperationCacheCounts = 1,
+  /// Reply: kSNTXPCFastPathRuleCountsKey, a packed struct RuleCounts
+  SNTXPCFastPathOperationRuleCounts = 2,
+  /// Reply: kSNTXPCFastPathCountKey
+  SNTXPCFastPathOperationEventCount = 3,
+  /// Reply: kSNTXPCFastPathCountKey
+  SNTXPCFastPathOperationStaticRuleCount = 4,
+  /// Request: kSNTXPCFastPathVnodeIDsKey, packed SantaVnode structs.
+  /// Reply: kSNTXPCFastPathActionsKey and kSNTXPCFastPathDecisionsKey, packed int64_t values in
+  /// the same order as the request.
+  SNTXPCFastPathOperationCheckCache = 5,
+};
+
+extern const char* const kSNTXPCFastPathOperationKey;
+extern const char* const kSNTXPCFastPathErrorKey;
+extern const char* const kSNTXPCFastPathRootCacheCountKey;
+extern const char* const kSNTXPCFastPathNonRootCacheCountKey;
+extern const char* const kSNTXPCFastPathRuleCountsKey;
+extern const char* const kSNTXPCFastPathCountKey;
+extern const char* const kSNTXPCFastPathVnodeIDsKey;
+extern const char* const kSNTXPCFastPathActionsKey;
+extern const char* const kSNTXPCFastPathDecisionsKey;
+
+///  Fills in the reply for a request. Called on a concurrent queue.
+typedef void (^SNTXPCFastPathHandler)(xpc_object_t request, xpc_object_t reply);
+
+@interface SNTXPCFastPathServer : NSObject
+
+- (instancetype)init NS_DESIGNATED_INITIALIZER;
+
+///  Handlers must all be set before the server is resumed.
+- (void)setHandler:(SNTXPCFastPathHandler)handler forOperation:(SNTXPCFastPathOperation)operation;
+
+///  Start accepting connections.
+- (void)resume;
+
+///  An endpoint to pass to clients. A new endpoint is created on each call.
+- (xpc_endpoint_t)endpoint;
+
+@end
+
+@interface SNTXPCFastPathClient : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithEndpoint:(xpc_endpoint_t)endpoint NS_DESIGNATED_INITIALIZER;
+
+///  Send a request and wait for its reply. The builder, if given, adds the operation's arguments
+///  to the request. Returns nil if the connection failed or the server has no handler for the
+///  operation.
+- (nullable xpc_object_t)sendOperation:(SNTXPCFastPathOperation)operation
+                               request:(nullable void (^)(xpc_object_t request))builder;
+
+- (void)invalidate;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,143 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/common/SNTXPCFastPath.h"
+
+#import "Source/common/SNTLogging.h"
+
+const char* const kSNTXPCFastPathOperationKey = "op";
+const char* const kSNTXPCFastPathErrorKey = "error";
+const char* const kSNTXPCFastPathRootCacheCountKey = "root_cache_count";
+const char* const kSNTXPCFastPathNonRootCacheCountKey = "non_root_cache_count";
+const char* const kSNTXPCFastPathRuleCountsKey = "rule_counts";
+const char* const kSNTXPCFastPathCountKey = "count";
+const char* const kSNTXPCFastPathVnodeIDsKey = "vnode_ids";
+const char* const kSNTXPCFastPathActionsKey = "actions";
+const char* const kSNTXPCFastPathDecisionsKey = "decisions";
+
+@implementation SNTXPCFastPathServer {
+  xpc_connection_t _listener;
+  dispatch_queue_t _queue;
+  NSMutableDictionary<NSNumber*, SNTXPCFastPathHandler>* _pendingHandlers;
+  NSDictionary<NSNumber*, SNTXPCFastPathHandler>* _handlers;
+}
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _queue = dispatch_queue_create_with_target(
+        "com.northpolesec.santa.xpc.fastpath", DISPATCH_QUEUE_CONCURRENT_WITH_AUTORELEASE_POOL,
+        dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0));
+    _listener = xpc_connection_create(NULL, _queue);
+    _pendingHandlers = [NSMutableDictionary dictionary];
+  }
+  return self;
+}
+
+- (void)setHandler:(SNTXPCFastPathHandler)handler forOperation:(SNTXPCFastPathOperation)operation {
+  _pendingHandlers[@(operation)] = [handler copy];
+}
+
+- (void)resume {
+  // Handlers are read concurrently once connections are accepted, so freeze them.
+  _handlers = [_pendingHandlers copy];
+  _pendingHandlers = nil;
+
+  NSDictionary<NSNumber*, SNTXPCFastPathHandler>* handlers = _handlers;
+  dispatch_queue_t queue = _queue;
+  xpc_connection_set_event_handler(_listener, ^(xpc_object_t peer) {
+    if (xpc_get_type(peer) != XPC_TYPE_CONNECTION) {
+      return;
+    }
+
+    xpc_connection_set_target_queue(peer, queue);
+    xpc_connection_set_event_handler(peer, ^(xpc_object_t request) {
+      if (xpc_get_type(request) != XPC_TYPE_DICTIONARY) {
+        // Errors are the peer going away, the connection cleans up after itself.
+        return;
+      }
+
+      xpc_object_t reply = xpc_dictionary_create_reply(request);
+      if (!reply) {
+        return;
+      }
+
+      uint64_t operation = xpc_dictionary_get_uint64(request, kSNTXPCFastPathOperationKey);
+      SNTXPCFastPathHandler handler = handlers[@(operation)];
+      if (handler) {
+        handler(request, reply);
+      } else {
+        xpc_dictionary_set_bool(reply, kSNTXPCFastPathErrorKey, true);
+      }
+
+      xpc_connection_t remote = xpc_dictionary_get_remote_connection(request);
+      if (remote) {
+        xpc_connection_send_message(remote, reply);
+      }
+    });
+    xpc_connection_resume(peer);
+  });
+  xpc_connection_resume(_listener);
+}
+
+- (xpc_endpoint_t)endpoint {
+  return xpc_endpoint_create(_listener);
+}
+
+- (void)dealloc {
+  xpc_connection_cancel(_listener);
+}
+
+@end
+
+@implementation SNTXPCFastPathClient {
+  xpc_connection_t _connection;
+}
+
+- (instancetype)initWithEndpoint:(xpc_endpoint_t)endpoint {
+  self = [super init];
+  if (self) {
+    _connection = xpc_connection_create_from_endpoint(endpoint);
+    xpc_connection_set_event_handler(_connection, ^(xpc_object_t event) {
+      // Replies are received synchronously, only connection errors arrive here.
+      if (event == XPC_ERROR_CONNECTION_INVALID) {
+        LOGD(@"XPC fast path connection invalidated");
+      }
+    });
+    xpc_connection_resume(_connection);
+  }
+  return self;
+}
+
+- (xpc_object_t)sendOperation:(SNTXPCFastPathOperation)operation
+                      request:(void (^)(xpc_object_t request))builder {
+  xpc_object_t request = xpc_dictionary_create(NULL, NULL, 0);
+  xpc_dictionary_set_uint64(request, kSNTXPCFastPathOperationKey, operation);
+  if (builder) {
+    builder(request);
+  }
+
+  xpc_object_t reply = xpc_connection_send_message_with_reply_sync(_connection, request);
+  if (xpc_get_type(reply) != XPC_TYPE_DICTIONARY ||
+      xpc_dictionary_get_bool(reply, kSNTXPCFastPathErrorKey)) {
+    return nil;
+  }
+  return reply;
+}
+
+- (void)invalidate {
+  xpc_connection_cancel(_connection);
+}
+
+@end
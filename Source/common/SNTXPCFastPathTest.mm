@@ -0,0 +1,87 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/common/SNTXPCFastPath.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <xpc/xpc.h>
+
+#include <cstdint>
+
+@interface SNTXPCFastPathTest : XCTestCase
+@end
+
+@implementation SNTXPCFastPathTest
+
+- (void)testRoundTrip {
+  SNTXPCFastPathServer* server = [[SNTXPCFastPathServer alloc] init];
+  [server
+        setHandler:^(xpc_object_t request, xpc_object_t reply) {
+          xpc_dictionary_set_uint64(reply, kSNTXPCFastPathRootCacheCountKey, 1);
+          xpc_dictionary_set_uint64(reply, kSNTXPCFastPathNonRootCacheCountKey, 2);
+        }
+      forOperation:SNTXPCFastPathOperationCacheCounts];
+  [server
+        setHandler:^(xpc_object_t request, xpc_object_t reply) {
+          size_t length = 0;
+          const int64_t* values = static_cast<const int64_t*>(
+              xpc_dictionary_get_data(request, kSNTXPCFastPathVnodeIDsKey, &length));
+          int64_t sum = 0;
+          for (size_t i = 0; values && i < length / sizeof(int64_t); i++) {
+            sum += values[i];
+          }
+          xpc_dictionary_set_int64(reply, kSNTXPCFastPathCountKey, sum);
+        }
+      forOperation:SNTXPCFastPathOperationCheckCache];
+  [server resume];
+
+  SNTXPCFastPathClient* client = [[SNTXPCFastPathClient alloc] initWithEndpoint:[server endpoint]];
+
+  xpc_object_t reply = [client sendOperation:SNTXPCFastPathOperationCacheCounts request:nil];
+  XCTAssertNotNil(reply);
+  XCTAssertEqual(xpc_dictionary_get_uint64(reply, kSNTXPCFastPathRootCacheCountKey), 1);
+  XCTAssertEqual(xpc_dictionary_get_uint64(reply, kSNTXPCFastPathNonRootCacheCountKey), 2);
+
+  reply = [client sendOperation:SNTXPCFastPathOperationCheckCache
+                        request:^(xpc_object_t request) {
+                          int64_t values[] = {1, 2, 3};
+                          xpc_dictionary_set_data(request, kSNTXPCFastPathVnodeIDsKey, values,
+                                                  sizeof(values));
+                        }];
+  XCTAssertNotNil(reply);
+  XCTAssertEqual(xpc_dictionary_get_int64(reply, kSNTXPCFastPathCountKey), 6);
+
+  // Operations without a handler fail
+  XCTAssertNil([client sendOperation:SNTXPCFastPathOperationEventCount request:nil]);
+
+  [client invalidate];
+}
+
+- (void)testInvalidatedClientFails {
+  SNTXPCFastPathServer* server = [[SNTXPCFastPathServer alloc] init];
+  [server
+        setHandler:^(xpc_object_t request, xpc_object_t reply) {
+        }
+      forOperation:SNTXPCFastPathOperationEventCount];
+  [server resume];
+
+  SNTXPCFastPathClient* client = [[SNTXPCFastPathClient alloc] initWithEndpoint:[server endpoint]];
+  XCTAssertNotNil([client sendOperation:SNTXPCFastPathOperationEventCount request:nil]);
+
+  [client invalidate];
+  XCTAssertNil([client sendOperation:SNTXPCFastPathOperationEventCount request:nil]);
+}
+
+@end
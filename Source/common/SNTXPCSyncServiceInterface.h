@@ -32,6 +32,10 @@
 @protocol SNTSyncServiceXPC
 - (void)postEventsToSyncServer:(NSArray<SNTStoredEvent*>*)events reply:(void (^)(BOOL))reply;
 
+// The same as postEventsToSyncServer:reply: for events encoded by santa::EncodeStoredEventBatch,
+// which sends each certificate of their signing chains only once.
+- (void)postEncodedEventsToSyncServer:(NSData*)encodedEvents reply:(void (^)(BOOL))reply;
+
 // Upload signal reports out of band. Only supported in sync v2; if v2 is not enabled the reply
 // is NO and the reports are left pending in the database for the next sync.
 - (void)uploadSignalReportsToSyncServer:(NSArray<SNTStoredSignalReport*>*)reports
@@ -14,6 +14,7 @@
 /// limitations under the License.
 
 #import <Foundation/Foundation.h>
+#include <xpc/xpc.h>
 
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/SNTCommonEnums.h"
@@ -21,6 +22,7 @@
 #import "Source/common/SantaVnode.h"
 #import "Source/common/faa/WatchItems.h"
 
+@class SNTCachedDecision;
 @class SNTRule;
 @class SNTSandboxExecRequest;
 @class SNTStoredExecutionEvent;
@@ -49,6 +51,31 @@ struct RuleCounts {
 ///
 - (void)cacheCounts:(void (^)(uint64_t rootCache, uint64_t nonRootCache))reply;
 - (void)checkCacheForVnodeID:(SantaVnode)vnodeID withReply:(void (^)(SNTAction))reply;
+///  Batch version of checkCacheForVnodeID:withReply:. vnodeIDs holds packed SantaVnode structs.
+///  Replies, in the same order, with the cached SNTAction for each vnode and the SNTEventState of
+///  its entry in the decision cache, or 0 if it has none.
+- (void)checkCacheForVnodeIDs:(NSData*)vnodeIDs
+                    withReply:(void (^)(NSArray<NSNumber*>* actions,
+                                        NSArray<NSNumber*>* decisions))reply;
+///  Replies with the SHA-256 and code signing identity that santad computed when it last evaluated
+///  the open file, or nil if it has none for this version of the file. The version is read from
+///  the file handle, so callers can only learn about files they were able to open. Only the
+///  identity fields of the reply are set.
+- (void)cachedIdentityForFileHandle:(NSFileHandle*)fileHandle
+                              reply:(void (^)(SNTCachedDecision*))reply;
+///  Batch lookup of the SHA-256s santad already computed, while evaluating execs or by prehashing.
+///  As with cachedIdentityForFileHandle:reply:, file versions are read from the open file handles.
+///  Replies, in the same order, with the SHA-256 of each file, or an empty string if santad has
+///  none for its current version.
+- (void)knownSHA256sForFileHandles:(NSArray<NSFileHandle*>*)fileHandles
+                             reply:(void (^)(NSArray<NSString*>* sha256s))reply;
+
+///
+///  Fast path ops
+///
+///  Replies with the endpoint of the daemon's libxpc channel for frequent simple calls. See
+///  SNTXPCFastPath.h.
+- (void)fastPathEndpoint:(void (^)(xpc_endpoint_t endpoint))reply;
 
 ///
 ///  Database ops
@@ -28,6 +28,16 @@
         forSelector:@selector(syncBundleEvent:relatedEvents:)
       argumentIndex:1
             ofReply:NO];
+
+  [r setClasses:[NSSet setWithObjects:[NSArray class], [NSFileHandle class], nil]
+        forSelector:@selector(knownSHA256sForFileHandles:reply:)
+      argumentIndex:0
+            ofReply:NO];
+
+  [r setXPCType:XPC_TYPE_ENDPOINT
+        forSelector:@selector(fastPathEndpoint:)
+      argumentIndex:0
+            ofReply:YES];
 }
 
 + (NSXPCInterface*)controlInterface {
@@ -21,6 +21,7 @@
 #include <stdint.h>
 #include <sys/cdefs.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <cstdio>
@@ -30,6 +31,7 @@
 #include <utility>
 
 #include "Source/common/BranchPrediction.h"
+#include "Source/common/SantaCacheStats.h"
 #include "absl/hash/hash.h"
 
 /**
@@ -38,8 +40,11 @@
   The type used for keys must overload the == operator and a specialization of
   SantaCacheHasher must exist for it.
 
-  Enforces a maximum size by clearing all entries if a new value
-  is added that would go over the maximum size declared at creation.
+  Enforces a maximum size declared at creation. By default all entries are
+  cleared if a new value is added that would go over the maximum size. Caches
+  created with SantaCacheEvictionPolicy::kClock instead evict a small batch
+  of entries that haven't been read recently, so a busy cache doesn't see a
+  burst of misses each time it fills.
 
   The number of buckets is calculated as `maximum_size` / `per_bucket`
   rounded up to the next power of 2. Locking is done per-bucket using
@@ -52,12 +57,16 @@ class SantaCache {
     Initialize a newly created cache.
 
     @param maximum_size The maximum number of entries in this cache. Once this
-        number is reached all the entries will be purged.
+        number is reached entries are evicted according to eviction_policy.
     @param per_bucket The target number of entries in each bucket when cache is
     full. A higher number will result in better performance but higher memory
     usage. Cannot be higher than 64 to try and ensure buckets don't overflow.
+    @param eviction_policy How to make room when the cache is full.
   */
-  SantaCache(uint64_t maximum_size = 10000, uint8_t per_bucket = 5) {
+  SantaCache(uint64_t maximum_size = 10000, uint8_t per_bucket = 5,
+             SantaCacheEvictionPolicy eviction_policy =
+                 SantaCacheEvictionPolicy::kClearAll)
+      : eviction_policy_(eviction_policy) {
     if (unlikely(per_bucket > maximum_size)) per_bucket = (uint8_t)maximum_size;
     if (unlikely(per_bucket < 1)) per_bucket = 1;
     if (unlikely(per_bucket > 64)) per_bucket = 64;
@@ -91,12 +100,15 @@ class SantaCache {
     while (entry != nullptr) {
       if (entry->key == key) {
         ValueT val = entry->value;
+        entry->referenced = true;
         unlock(bucket);
+        hits_.increment();
         return val;
       }
       entry = entry->next;
     }
     unlock(bucket);
+    misses_.increment();
     return zero_;
   }
 
@@ -289,6 +301,7 @@ class SantaCache {
   void clear(ClearBlockT clear_block) {
     static_assert(std::is_invocable_r_v<void, ClearBlockT&, KeyT&, ValueT&>,
                   "clear_block must be callable as void(KeyT&, ValueT&)");
+    instrumentation_.record_clear();
     for (uint32_t i = 0; i < bucket_count_; ++i) {
       struct bucket* bucket = &buckets_[i];
       // We grab the lock so nothing can use this bucket while we're erasing it.
@@ -329,6 +342,65 @@ class SantaCache {
     return count_.load(std::memory_order_relaxed);
   }
 
+  /**
+    Return the hit/miss counts for get() and the number of entries evicted to
+    make room for new ones.
+  */
+  SantaCacheStats stats() const {
+    SantaCacheStats stats{
+        .hits = hits_.load(),
+        .misses = misses_.load(),
+        .evictions = evictions_.load(),
+    };
+    instrumentation_.fill(stats);
+    return stats;
+  }
+
+  /**
+    Return the maximum number of entries the cache will hold.
+  */
+  inline uint64_t max_size() const {
+    return max_size_.load(std::memory_order_relaxed);
+  }
+
+  /**
+    Change the maximum number of entries, e.g. in response to memory pressure.
+    The bucket count is fixed at creation, so growing past the initial size
+    lengthens the per-bucket chains rather than adding buckets. If the cache
+    holds more than the new maximum, entries are evicted according to the
+    eviction policy until it fits.
+  */
+  void set_max_size(uint64_t maximum_size) {
+    if (unlikely(maximum_size < 1)) maximum_size = 1;
+    lock(&clear_bucket_);
+    max_size_.store(maximum_size, std::memory_order_relaxed);
+    if (eviction_policy_ == SantaCacheEvictionPolicy::kClock) {
+      while (count_.load(std::memory_order_relaxed) > maximum_size &&
+             evict_batch() > 0) {
+      }
+    } else if (count_.load(std::memory_order_relaxed) > maximum_size) {
+      uint64_t evicted = 0;
+      clear([&evicted](KeyT&, ValueT&) { ++evicted; });
+      evictions_.increment(evicted);
+    }
+    unlock(&clear_bucket_);
+  }
+
+  /**
+    Return the current size of the cache along with its stats().
+  */
+  SantaCacheUsage usage() const {
+    uint64_t entries = count();
+    return SantaCacheUsage{
+        .entries = entries,
+        .max_entries = max_size(),
+        .bytes = sizeof(*this) + bucket_count_ * sizeof(struct bucket) +
+                 entries * sizeof(struct entry),
+        .stats = stats(),
+        .bucket_lengths = bucket_lengths(),
+    };
+  }
+
   /**
     Fill in the per_bucket_counts array with the number of entries in each
     bucket.
@@ -377,6 +449,9 @@ class SantaCache {
     KeyT key;
     ValueT value = {};
     struct entry* next = nullptr;
+    // Set on lookup, cleared by the CLOCK hand. Only written under the bucket
+    // lock.
+    bool referenced = false;
   };
 
   struct bucket {
@@ -464,12 +539,21 @@ class SantaCache {
 
       // Check that adding this new item won't take the cache
       // over its maximum size.
-      if (count_.load(std::memory_order_relaxed) + 1 > max_size_) {
+      if (count_.load(std::memory_order_relaxed) + 1 >
+          max_size_.load(std::memory_order_relaxed)) {
         unlock(bucket);
         lock(&clear_bucket_);
-        // Check again in case clear has already run while waiting for lock
-        if (count_.load(std::memory_order_relaxed) + 1 > max_size_) {
-          clear();
+        // Check again in case another thread already made room while
+        // waiting for lock
+        if (count_.load(std::memory_order_relaxed) + 1 >
+            max_size_.load(std::memory_order_relaxed)) {
+          if (eviction_policy_ == SantaCacheEvictionPolicy::kClock) {
+            evict_batch();
+          } else {
+            uint64_t evicted = 0;
+            clear([&evicted](KeyT&, ValueT&) { ++evicted; });
+            evictions_.increment(evicted);
+          }
         }
         unlock(&clear_bucket_);
         // Bucket was unlocked during the clear path. Another thread may have
@@ -487,17 +571,84 @@ class SantaCache {
       new_entry->next = bucket->head;
       bucket->head = new_entry;
       count_.fetch_add(1, std::memory_order_relaxed);
+      instrumentation_.record_insert();
 
       unlock(bucket);
       return true;
     }
   }
 
+  /**
+    Advance the CLOCK hand until a batch of entries has been evicted. Entries
+    read since the hand last passed them get a second chance. Must be called
+    with clear_bucket_ held, which also protects clock_hand_.
+  */
+  uint64_t evict_batch() {
+    const uint64_t target =
+        (max_size_.load(std::memory_order_relaxed) >> 6) ?: 1;
+    uint64_t evicted = 0;
+
+    // Two full revolutions always suffice since the first clears every
+    // reference bit.
+    for (uint64_t visited = 0;
+         evicted < target && visited < 2ull * bucket_count_; ++visited) {
+      struct bucket* bucket = &buckets_[clock_hand_];
+      clock_hand_ = (clock_hand_ + 1) & (bucket_count_ - 1);
+
+      lock(bucket);
+      struct entry* entry = bucket->head;
+      struct entry* prev = nullptr;
+      while (entry != nullptr) {
+        struct entry* next = entry->next;
+        if (entry->referenced) {
+          entry->referenced = false;
+          prev = entry;
+        } else {
+          if (prev) {
+            prev->next = next;
+          } else {
+            bucket->head = next;
+          }
+          delete entry;
+          count_.fetch_sub(1, std::memory_order_relaxed);
+          ++evicted;
+        }
+        entry = next;
+      }
+      unlock(bucket);
+    }
+
+    evictions_.increment(evicted);
+    return evicted;
+  }
+
+  /**
+    Count buckets by the number of entries they hold. Only done with
+    kSantaCacheInstrumentation since it takes every bucket lock.
+  */
+  SantaCacheBucketLengths bucket_lengths() const {
+    SantaCacheBucketLengths lengths = {};
+    if constexpr (kSantaCacheInstrumentation) {
+      for (uint32_t i = 0; i < bucket_count_; ++i) {
+        struct bucket* bucket = &buckets_[i];
+        lock(bucket);
+        size_t length = 0;
+        for (struct entry* entry = bucket->head; entry != nullptr;
+             entry = entry->next) {
+          ++length;
+        }
+        unlock(bucket);
+        ++lengths[std::min(length, kSantaCacheBucketLengths - 1)];
+      }
+    }
+    return lengths;
+  }
+
   /**
     Lock a bucket using os_unfair_lock for kernel-mediated priority inheritance.
   */
   inline void lock(struct bucket* bucket) const {
-    os_unfair_lock_lock(&bucket->lock);
+    instrumentation_.lock(&bucket->lock);
   }
 
   /**
@@ -518,11 +669,23 @@ class SantaCache {
   // Silicon, 64-byte lines fetched in adjacent pairs on x86_64).
   char count_padding_[128];
 
-  uint64_t max_size_;
+  // Written under clear_bucket_ by set_max_size().
+  std::atomic<uint64_t> max_size_;
   uint32_t bucket_count_;
 
   struct bucket* buckets_;
 
+  const SantaCacheEvictionPolicy eviction_policy_;
+
+  // Next bucket the CLOCK hand will visit. Guarded by clear_bucket_.
+  uint32_t clock_hand_ = 0;
+
+  // Mutable so that const lookups can record hits and misses.
+  mutable SantaCacheCounter hits_;
+  mutable SantaCacheCounter misses_;
+  SantaCacheCounter evictions_;
+  [[no_unique_address]] mutable SantaCacheInstrumentation instrumentation_;
+
   /**
     Holder for a 'zero' entry for the current type
   */
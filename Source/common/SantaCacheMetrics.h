@@ -0,0 +1,40 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_SANTACACHEMETRICS_H
+#define SANTA_COMMON_SANTACACHEMETRICS_H
+
+#import <Foundation/Foundation.h>
+
+#include <functional>
+#include <optional>
+
+#import "Source/common/SNTMetricSet.h"
+#include "Source/common/SantaCacheStats.h"
+
+namespace santa {
+
+/// Export a cache's hit, miss and eviction counts as the /santa/cache/hits,
+/// /santa/cache/misses and /santa/cache/evictions counters, using cache_name
+/// as the "Cache" field value.
+///
+/// stats_fn is called each time metrics are exported. It may return
+/// std::nullopt once the cache no longer exists, in which case nothing is
+/// recorded.
+void RegisterCacheMetrics(SNTMetricSet* metric_set, NSString* cache_name,
+                          std::function<std::optional<SantaCacheStats>()> stats_fn);
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_SANTACACHEMETRICS_H
@@ -0,0 +1,80 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/SantaCacheMetrics.h"
+
+#include <memory>
+
+namespace santa {
+
+void RegisterCacheMetrics(SNTMetricSet* metric_set, NSString* cache_name,
+                          std::function<std::optional<SantaCacheStats>()> stats_fn) {
+  SNTMetricCounter* hits = [metric_set counterWithName:@"/santa/cache/hits"
+                                            fieldNames:@[ @"Cache" ]
+                                              helpText:@"Count of cache lookups that hit"];
+  SNTMetricCounter* misses = [metric_set counterWithName:@"/santa/cache/misses"
+                                              fieldNames:@[ @"Cache" ]
+                                                helpText:@"Count of cache lookups that missed"];
+  SNTMetricCounter* evictions =
+      [metric_set counterWithName:@"/santa/cache/evictions"
+                       fieldNames:@[ @"Cache" ]
+                         helpText:@"Count of cache entries evicted to make room for new entries"];
+
+  SNTMetricCounter* inserts = nil;
+  SNTMetricCounter* clears = nil;
+  SNTMetricCounter* lock_waits = nil;
+  SNTMetricCounter* lock_wait_ns = nil;
+  if (kSantaCacheInstrumentation) {
+    inserts = [metric_set counterWithName:@"/santa/cache/inserts"
+                               fieldNames:@[ @"Cache" ]
+                                 helpText:@"Count of entries inserted into the cache"];
+    clears = [metric_set counterWithName:@"/santa/cache/clears"
+                              fieldNames:@[ @"Cache" ]
+                                helpText:@"Count of times every cache entry was removed"];
+    lock_waits = [metric_set counterWithName:@"/santa/cache/lock_waits"
+                                  fieldNames:@[ @"Cache" ]
+                                    helpText:@"Count of cache lock acquisitions that had to wait"];
+    lock_wait_ns = [metric_set counterWithName:@"/santa/cache/lock_wait_ns"
+                                    fieldNames:@[ @"Cache" ]
+                                      helpText:@"Nanoseconds spent waiting for cache locks"];
+  }
+
+  // The caches keep cumulative totals while the metric counters are
+  // incremented, so only the change since the previous export is recorded.
+  auto last = std::make_shared<SantaCacheStats>();
+  NSArray<NSString*>* fields = @[ [cache_name copy] ];
+
+  [metric_set registerCallback:^{
+    std::optional<SantaCacheStats> current = stats_fn();
+    if (!current.has_value()) {
+      return;
+    }
+
+    [hits incrementBy:(long long)(current->hits - last->hits) forFieldValues:fields];
+    [misses incrementBy:(long long)(current->misses - last->misses) forFieldValues:fields];
+    [evictions incrementBy:(long long)(current->evictions - last->evictions)
+            forFieldValues:fields];
+    if (kSantaCacheInstrumentation) {
+      [inserts incrementBy:(long long)(current->inserts - last->inserts) forFieldValues:fields];
+      [clears incrementBy:(long long)(current->clears - last->clears) forFieldValues:fields];
+      [lock_waits incrementBy:(long long)(current->lock_waits - last->lock_waits)
+               forFieldValues:fields];
+      [lock_wait_ns incrementBy:(long long)(current->lock_wait_ns - last->lock_wait_ns)
+                 forFieldValues:fields];
+    }
+    *last = *current;
+  }];
+}
+
+}  // namespace santa
@@ -0,0 +1,76 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/SantaCacheMetrics.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+
+#import "Source/common/SNTMetricSet.h"
+#include "Source/common/SantaCache.h"
+
+@interface SantaCacheMetricsTest : XCTestCase
+@end
+
+@implementation SantaCacheMetricsTest
+
+- (void)testCountersTrackCacheStats {
+  SNTMetricSet* metricSet = [[SNTMetricSet alloc] init];
+  auto cache = std::make_shared<SantaCache<uint64_t, uint64_t>>(5);
+  std::weak_ptr<SantaCache<uint64_t, uint64_t>> weakCache = cache;
+
+  santa::RegisterCacheMetrics(metricSet, @"test",
+                              [weakCache]() -> std::optional<SantaCacheStats> {
+                                auto c = weakCache.lock();
+                                if (!c) return std::nullopt;
+                                return c->stats();
+                              });
+
+  for (uint64_t i = 1; i <= 6; ++i) {
+    cache->set(i, i);
+  }
+  cache->get(6);
+  cache->get(1);
+
+  [metricSet export];
+
+  SNTMetricCounter* hits = [metricSet counterWithName:@"/santa/cache/hits"
+                                           fieldNames:@[ @"Cache" ]
+                                             helpText:@"Count of cache lookups that hit"];
+  SNTMetricCounter* misses = [metricSet counterWithName:@"/santa/cache/misses"
+                                             fieldNames:@[ @"Cache" ]
+                                               helpText:@"Count of cache lookups that missed"];
+  SNTMetricCounter* evictions = [metricSet
+      counterWithName:@"/santa/cache/evictions"
+           fieldNames:@[ @"Cache" ]
+             helpText:@"Count of cache entries evicted to make room for new entries"];
+
+  XCTAssertEqual([hits getCountForFieldValues:@[ @"test" ]], 1);
+  XCTAssertEqual([misses getCountForFieldValues:@[ @"test" ]], 1);
+  XCTAssertEqual([evictions getCountForFieldValues:@[ @"test" ]], 5);
+
+  // A second export only records what changed since the first.
+  cache->get(6);
+  [metricSet export];
+  XCTAssertEqual([hits getCountForFieldValues:@[ @"test" ]], 2);
+  XCTAssertEqual([misses getCountForFieldValues:@[ @"test" ]], 1);
+
+  // Once the cache is gone nothing more is recorded.
+  cache.reset();
+  [metricSet export];
+  XCTAssertEqual([hits getCountForFieldValues:@[ @"test" ]], 2);
+}
+
+@end
@@ -0,0 +1,179 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_SANTACACHESTATS_H
+#define SANTA_COMMON_SANTACACHESTATS_H
+
+#include <os/lock.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+  What a cache does when an insert would take it over its maximum size.
+*/
+enum class SantaCacheEvictionPolicy {
+  // Purge every entry. Cheap, but every following lookup misses.
+  kClearAll,
+  // Sweep a small batch of entries with a CLOCK hand, sparing entries that
+  // were read since the hand last passed them.
+  kClock,
+};
+
+/**
+  Building with --define=SANTA_CACHE_INSTRUMENTATION=1 defines
+  SANTA_CACHE_INSTRUMENTATION, which has caches also count inserts, clears and
+  lock contention and report their bucket lengths. Otherwise these stay zero
+  and cost nothing.
+*/
+#ifdef SANTA_CACHE_INSTRUMENTATION
+inline constexpr bool kSantaCacheInstrumentation = true;
+#else
+inline constexpr bool kSantaCacheInstrumentation = false;
+#endif
+
+/**
+  Point-in-time counters for a cache instance. All values are cumulative over
+  the lifetime of the cache.
+*/
+struct SantaCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  // Entries removed to make room for new ones, including full clears.
+  uint64_t evictions = 0;
+
+  // Only counted with kSantaCacheInstrumentation.
+  uint64_t inserts = 0;
+  // Full clears, whether explicit or to make room.
+  uint64_t clears = 0;
+  // Bucket lock acquisitions that had to wait, and the total time spent
+  // waiting.
+  uint64_t lock_waits = 0;
+  uint64_t lock_wait_ns = 0;
+};
+
+/**
+  The number of buckets of each length, with the last element counting all
+  buckets at least that long.
+*/
+inline constexpr size_t kSantaCacheBucketLengths = 9;
+using SantaCacheBucketLengths = std::array<uint64_t, kSantaCacheBucketLengths>;
+
+/**
+  Point-in-time size of a cache instance.
+*/
+struct SantaCacheUsage {
+  uint64_t entries = 0;
+  uint64_t max_entries = 0;
+  // Approximate bytes held by the cache itself, not counting memory that
+  // values reference (e.g. Objective-C objects).
+  uint64_t bytes = 0;
+  SantaCacheStats stats;
+  // Only filled in with kSantaCacheInstrumentation.
+  SantaCacheBucketLengths bucket_lengths = {};
+};
+
+/**
+  A relaxed counter split across several cache lines so that threads bumping
+  it on the lookup path don't all contend on the same line. Reads sum the
+  stripes and are only approximately consistent with concurrent increments.
+*/
+class SantaCacheCounter {
+ public:
+  inline void increment(uint64_t n = 1) {
+    stripes_[stripe()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  inline uint64_t load() const {
+    uint64_t total = 0;
+    for (const auto& s : stripes_) {
+      total += s.value.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+ private:
+  static constexpr uint32_t kStripes = 8;
+
+  // 128 bytes covers the coherence granule on both Apple Silicon and x86_64.
+  // See SantaCache for why explicit padding is used rather than alignas.
+  struct stripe_t {
+    std::atomic<uint64_t> value = 0;
+    char padding[128 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  static inline uint32_t stripe() {
+    static std::atomic<uint32_t> next_stripe = 0;
+    static thread_local uint32_t stripe =
+        next_stripe.fetch_add(1, std::memory_order_relaxed) % kStripes;
+    return stripe;
+  }
+
+  stripe_t stripes_[kStripes];
+};
+
+/**
+  The counters only kept with kSantaCacheInstrumentation. They use
+  SantaCacheCounter so that each thread mostly touches its own stripe.
+*/
+template <bool Enabled>
+class SantaCacheInstrumentationCounters;
+
+template <>
+class SantaCacheInstrumentationCounters<false> {
+ public:
+  inline void record_insert() {}
+  inline void record_clear() {}
+  inline void lock(os_unfair_lock* lock) { os_unfair_lock_lock(lock); }
+  inline void fill(SantaCacheStats&) const {}
+};
+
+template <>
+class SantaCacheInstrumentationCounters<true> {
+ public:
+  inline void record_insert() { inserts_.increment(); }
+  inline void record_clear() { clears_.increment(); }
+
+  /**
+    Take the lock, timing how long it takes to acquire if it is contended.
+  */
+  inline void lock(os_unfair_lock* lock) {
+    if (os_unfair_lock_trylock(lock)) return;
+    uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    os_unfair_lock_lock(lock);
+    lock_waits_.increment();
+    lock_wait_ns_.increment(clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - start);
+  }
+
+  inline void fill(SantaCacheStats& stats) const {
+    stats.inserts = inserts_.load();
+    stats.clears = clears_.load();
+    stats.lock_waits = lock_waits_.load();
+    stats.lock_wait_ns = lock_wait_ns_.load();
+  }
+
+ private:
+  SantaCacheCounter inserts_;
+  SantaCacheCounter clears_;
+  SantaCacheCounter lock_waits_;
+  SantaCacheCounter lock_wait_ns_;
+};
+
+using SantaCacheInstrumentation =
+    SantaCacheInstrumentationCounters<kSantaCacheInstrumentation>;
+
+#endif  // SANTA_COMMON_SANTACACHESTATS_H
@@ -1093,4 +1093,113 @@ struct S {
   delete sut;
 }
 
+- (void)testClockEvictionKeepsRecentlyReadEntries {
+  auto sut = SantaCache<uint64_t, uint64_t>(100, 5, SantaCacheEvictionPolicy::kClock);
+
+  for (uint64_t i = 1; i <= 100; ++i) {
+    sut.set(i, i);
+  }
+  for (uint64_t i = 1; i <= 10; ++i) {
+    XCTAssertEqual(sut.get(i), i);
+  }
+
+  // Going over the limit evicts a small batch instead of purging everything.
+  XCTAssertTrue(sut.set(101, 101));
+  XCTAssertGreaterThan(sut.count(), 90);
+  XCTAssertLessThanOrEqual(sut.count(), 100);
+  XCTAssertEqual(sut.get(101), 101);
+
+  // Entries read before the eviction got a second chance.
+  for (uint64_t i = 1; i <= 10; ++i) {
+    XCTAssertEqual(sut.get(i), i);
+  }
+
+  SantaCacheStats stats = sut.stats();
+  XCTAssertEqual(stats.hits, 21);
+  XCTAssertEqual(stats.misses, 0);
+  XCTAssertEqual(stats.evictions, 101 - sut.count());
+}
+
+- (void)testStatsClearAll {
+  auto sut = SantaCache<uint64_t, uint64_t>(5);
+
+  for (uint64_t i = 1; i <= 6; ++i) {
+    sut.set(i, i);
+  }
+  XCTAssertEqual(sut.get(6), 6);
+  XCTAssertEqual(sut.get(1), 0);
+
+  SantaCacheStats stats = sut.stats();
+  XCTAssertEqual(stats.hits, 1);
+  XCTAssertEqual(stats.misses, 1);
+  XCTAssertEqual(stats.evictions, 5);
+
+  // Explicit clears are not evictions.
+  sut.clear();
+  XCTAssertEqual(sut.stats().evictions, 5);
+}
+
+- (void)testInstrumentation {
+  auto sut = SantaCache<uint64_t, uint64_t>(5);
+  for (uint64_t i = 1; i <= 6; ++i) {
+    sut.set(i, i);
+  }
+  sut.clear();
+
+  SantaCacheStats stats = sut.stats();
+  SantaCacheUsage usage = sut.usage();
+  uint64_t buckets = 0;
+  for (uint64_t count : usage.bucket_lengths) {
+    buckets += count;
+  }
+
+  if (kSantaCacheInstrumentation) {
+    XCTAssertEqual(stats.inserts, 6);
+    // Once to make room for the sixth entry, once explicitly.
+    XCTAssertEqual(stats.clears, 2);
+    XCTAssertEqual(usage.bucket_lengths[0], buckets);
+    XCTAssertGreaterThan(buckets, 0);
+  } else {
+    XCTAssertEqual(stats.inserts, 0);
+    XCTAssertEqual(stats.clears, 0);
+    XCTAssertEqual(stats.lock_waits, 0);
+    XCTAssertEqual(buckets, 0);
+  }
+}
+
+- (void)testSetMaxSize {
+  auto sut = SantaCache<uint64_t, uint64_t>(100, 5, SantaCacheEvictionPolicy::kClock);
+  for (uint64_t i = 1; i <= 100; ++i) {
+    sut.set(i, i);
+  }
+  XCTAssertEqual(sut.get(1), 1);
+
+  // Shrinking evicts entries that weren't read first.
+  sut.set_max_size(20);
+  XCTAssertEqual(sut.max_size(), 20);
+  XCTAssertLessThanOrEqual(sut.count(), 20);
+  XCTAssertEqual(sut.get(1), 1);
+  XCTAssertEqual(sut.stats().evictions, 100 - sut.count());
+
+  // Growing past the initial size keeps every entry.
+  sut.set_max_size(200);
+  for (uint64_t i = 1; i <= 200; ++i) {
+    sut.set(i, i);
+  }
+  XCTAssertEqual(sut.count(), 200);
+
+  SantaCacheUsage usage = sut.usage();
+  XCTAssertEqual(usage.entries, 200);
+  XCTAssertEqual(usage.max_entries, 200);
+  XCTAssertGreaterThan(usage.bytes, 0);
+
+  auto clearAll = SantaCache<uint64_t, uint64_t>(10);
+  for (uint64_t i = 1; i <= 10; ++i) {
+    clearAll.set(i, i);
+  }
+  clearAll.set_max_size(5);
+  XCTAssertEqual(clearAll.count(), 0);
+  XCTAssertEqual(clearAll.stats().evictions, 10);
+}
+
 @end
@@ -0,0 +1,531 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_SANTAFLATCACHE_H
+#define SANTA_COMMON_SANTAFLATCACHE_H
+
+#include <os/lock.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Source/common/BranchPrediction.h"
+#include "Source/common/SantaCacheStats.h"
+#include "absl/hash/hash.h"
+
+/**
+  A concurrent open-addressing hash table with inline key/value storage.
+
+  This offers the same interface as SantaCache but stores entries in flat
+  arrays instead of heap-allocated linked lists, so lookups don't chase
+  pointers and inserts never call the allocator. It is intended for small,
+  trivially destructible key and value types (e.g. SantaVnode -> bool).
+
+  The table is split into power-of-two shards, each guarded by an
+  os_unfair_lock. Within a shard, slots are probed in groups of 8 using a
+  byte of control metadata per slot, in the style of Abseil's Swiss tables:
+  the top bit marks empty/deleted slots and the low 7 bits of a full slot hold
+  part of the key's hash, so most probes compare a single 64-bit word rather
+  than keys.
+
+  As with SantaCache, all entries are purged if an insert would take the
+  cache over its maximum size. Shards are sized with headroom for uneven
+  hashing; a shard that still fills before the cache as a whole does is
+  cleared on its own.
+*/
+template <typename KeyT, typename ValueT, class Hasher = absl::Hash<KeyT>>
+class SantaFlatCache {
+  static_assert(std::is_trivially_destructible_v<KeyT>,
+                "SantaFlatCache keys must be trivially destructible");
+  static_assert(std::is_trivially_destructible_v<ValueT>,
+                "SantaFlatCache values must be trivially destructible");
+
+ public:
+  /**
+    Initialize a newly created cache. All storage is allocated up front.
+
+    @param maximum_size The maximum number of entries in this cache. Once this
+        number is reached all the entries will be purged.
+  */
+  SantaFlatCache(uint64_t maximum_size = 10000)
+      : max_size_(maximum_size ?: 1) {
+    uint64_t shard_count = std::clamp<uint64_t>(
+        max_size_ / kEntriesPerShardTarget, 1, kMaxShards);
+    shard_bits_ = 63 - __builtin_clzll(shard_count);
+    shard_count_ = 1u << shard_bits_;
+
+    // Leave 25% headroom for uneven hashing across shards and then size the
+    // shard so it stays under the maximum load factor.
+    uint64_t per_shard = (max_size_ + shard_count_ - 1) / shard_count_;
+    per_shard += per_shard / 4;
+    uint64_t capacity =
+        std::max<uint64_t>((per_shard * 8 + 6) / 7, kGroupSize);
+    capacity = 1ull << (64 - __builtin_clzll(capacity - 1));
+
+    shards_ = std::make_unique<shard[]>(shard_count_);
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      shards_[i].init((uint32_t)capacity);
+    }
+  }
+
+  SantaFlatCache(const SantaFlatCache&) = delete;
+  SantaFlatCache& operator=(const SantaFlatCache&) = delete;
+
+  /**
+    Get an element from the cache. Returns zero_ if item doesn't exist.
+  */
+  ValueT get(const KeyT& key) const {
+    uint64_t h = Hasher{}(key);
+    shard* s = &shards_[shard_index(h)];
+    lock(s);
+    int64_t idx = s->find(key, h >> (7 + shard_bits_), h2(h));
+    ValueT val = (idx >= 0) ? s->slots[idx].value : zero_;
+    unlock(s);
+    if (idx >= 0) {
+      hits_.increment();
+    } else {
+      misses_.increment();
+    }
+    return val;
+  }
+
+  /**
+    Set an element in the cache.
+
+    @note If the cache is full when this is called, this will
+        empty the cache before inserting the new value.
+
+    @return true if the value was set.
+  */
+  bool set(const KeyT& key, const ValueT& value) {
+    return set(key, value, NoOpUpdate{}, false, {}, false);
+  }
+
+  /**
+    Set an element in the cache only if the existing value is equal to
+    previous_value. This allows set to become a CAS operation.
+
+    @return true if the value was set
+  */
+  bool set(const KeyT& key, const ValueT& value, const ValueT& previous_value) {
+    return set(key, value, NoOpUpdate{}, false, previous_value, true);
+  }
+
+  /**
+    Update an element in the cache under lock. If the element doesn't yet
+    exist, it will be first created and value initialized before the
+    update_block is called.
+  */
+  template <typename UpdateBlockT>
+  bool update(const KeyT& key, UpdateBlockT update_block) {
+    static_assert(std::is_invocable_r_v<void, UpdateBlockT&, ValueT&>,
+                  "update_block must be callable as void(ValueT&)");
+    return set(key, zero_, update_block, true, {}, false);
+  }
+
+  /**
+    An alias for `set(key, zero_)`
+  */
+  inline void remove(const KeyT& key) { set(key, zero_); }
+
+  /**
+    Check if a given key exists in the cache. If a contains_block is provided,
+    it is called with the value under lock to allow further filtering.
+  */
+  template <typename ContainsBlockT>
+  bool contains(const KeyT& key, ContainsBlockT contains_block) const {
+    static_assert(std::is_invocable_r_v<bool, ContainsBlockT&, const ValueT&>,
+                  "contains_block must be callable as bool(const ValueT&)");
+    uint64_t h = Hasher{}(key);
+    shard* s = &shards_[shard_index(h)];
+    lock(s);
+    int64_t idx = s->find(key, h >> (7 + shard_bits_), h2(h));
+    bool result = (idx >= 0) && contains_block(s->slots[idx].value);
+    unlock(s);
+    return result;
+  }
+
+  /**
+    Check if a given key exists in the cache.
+  */
+  bool contains(const KeyT& key) const {
+    return contains(key, [](const ValueT&) { return true; });
+  }
+
+  /**
+    Iterate all key and value pairs in the cache. All shards are locked for
+    the duration.
+  */
+  template <typename ForeachBlockT>
+  void foreach(ForeachBlockT foreach_block) {
+    static_assert(std::is_invocable_r_v<void, ForeachBlockT&, KeyT&, ValueT&>,
+                  "foreach_block must be callable as void(KeyT&, ValueT&)");
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      lock(&shards_[i]);
+    }
+
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      shard* s = &shards_[i];
+      for (uint32_t j = 0; j < s->capacity; ++j) {
+        if (is_full(s->ctrl[j])) {
+          foreach_block(s->slots[j].key, s->slots[j].value);
+        }
+      }
+    }
+
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      unlock(&shards_[i]);
+    }
+  }
+
+  /**
+    Remove entries matching a predicate. Shards are locked one at a time.
+
+    @warning The predicate MUST NOT call methods on this same cache instance.
+
+    @return The number of entries removed.
+  */
+  template <typename PredicateT>
+  uint64_t remove_if(PredicateT predicate) {
+    static_assert(
+        std::is_invocable_r_v<bool, PredicateT&, const KeyT&, ValueT&>,
+        "predicate must be callable as bool(const KeyT&, ValueT&)");
+    uint64_t removed = 0;
+
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      shard* s = &shards_[i];
+      lock(s);
+      for (uint32_t j = 0; j < s->capacity; ++j) {
+        if (is_full(s->ctrl[j]) &&
+            predicate(s->slots[j].key, s->slots[j].value)) {
+          s->erase(j);
+          count_.fetch_sub(1, std::memory_order_relaxed);
+          ++removed;
+        }
+      }
+      unlock(s);
+    }
+
+    return removed;
+  }
+
+  /**
+    Remove all entries.
+
+    @param clear_block Called for all key and value pairs just prior to
+        deletion.
+  */
+  template <typename ClearBlockT>
+  void clear(ClearBlockT clear_block) {
+    static_assert(std::is_invocable_r_v<void, ClearBlockT&, KeyT&, ValueT&>,
+                  "clear_block must be callable as void(KeyT&, ValueT&)");
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      shard* s = &shards_[i];
+      lock(s);
+      for (uint32_t j = 0; j < s->capacity; ++j) {
+        if (is_full(s->ctrl[j])) {
+          clear_block(s->slots[j].key, s->slots[j].value);
+        }
+      }
+      s->reset();
+    }
+
+    // All shard locks are held so no concurrent set() can observe a stale
+    // count and trigger a redundant clear.
+    count_.store(0, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < shard_count_; ++i) {
+      unlock(&shards_[i]);
+    }
+  }
+
+  /**
+    Remove all entries.
+  */
+  void clear() {
+    clear([](KeyT&, ValueT&) {});
+  }
+
+  /**
+    Return number of entries currently in cache.
+  */
+  inline uint64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  /**
+    Return the hit/miss counts for get() and the number of entries evicted to
+    make room for new ones.
+  */
+  SantaCacheStats stats() const {
+    return SantaCacheStats{
+        .hits = hits_.load(),
+        .misses = misses_.load(),
+        .evictions = evictions_.load(),
+    };
+  }
+
+ private:
+  static constexpr uint32_t kGroupSize = 8;
+  static constexpr uint64_t kEntriesPerShardTarget = 256;
+  static constexpr uint64_t kMaxShards = 64;
+
+  static constexpr uint8_t kEmpty = 0x80;
+  static constexpr uint8_t kDeleted = 0xFE;
+
+  static constexpr uint64_t kLsbs = 0x0101010101010101ull;
+  static constexpr uint64_t kMsbs = 0x8080808080808080ull;
+
+  static inline bool is_full(uint8_t ctrl) { return (ctrl & 0x80) == 0; }
+
+  struct slot {
+    KeyT key;
+    ValueT value;
+  };
+
+  struct shard {
+    os_unfair_lock lock = OS_UNFAIR_LOCK_INIT;
+    uint32_t capacity = 0;
+    // Number of full slots.
+    uint32_t size = 0;
+    // Number of deleted slots. These still lengthen probe sequences and are
+    // reclaimed by rehashing in place.
+    uint32_t tombstones = 0;
+    std::unique_ptr<uint8_t[]> ctrl;
+    std::unique_ptr<slot[]> slots;
+
+    void init(uint32_t cap) {
+      capacity = cap;
+      ctrl = std::make_unique<uint8_t[]>(cap);
+      slots = std::make_unique<slot[]>(cap);
+      reset();
+    }
+
+    void reset() {
+      memset(ctrl.get(), kEmpty, capacity);
+      size = 0;
+      tombstones = 0;
+    }
+
+    inline uint32_t group_mask() const { return (capacity / kGroupSize) - 1; }
+
+    inline uint64_t load_group(uint32_t group) const {
+      uint64_t word;
+      memcpy(&word, &ctrl[group * kGroupSize], sizeof(word));
+      return word;
+    }
+
+    // Bitmask with the high bit of each byte set where ctrl == h2. May have
+    // false positives, which the key comparison filters out.
+    static inline uint64_t match(uint64_t word, uint8_t h2) {
+      uint64_t x = word ^ (kLsbs * h2);
+      return (x - kLsbs) & ~x & kMsbs;
+    }
+
+    static inline uint64_t match_empty(uint64_t word) {
+      return word & (~word << 6) & kMsbs;
+    }
+
+    static inline uint64_t match_empty_or_deleted(uint64_t word) {
+      return word & (~word << 7) & kMsbs;
+    }
+
+    static inline uint32_t lowest_byte(uint64_t mask) {
+      // Control words are loaded in native (little-endian) order.
+      return (uint32_t)__builtin_ctzll(mask) >> 3;
+    }
+
+    int64_t find(const KeyT& key, uint64_t h1, uint8_t h2) const {
+      uint32_t mask = group_mask();
+      uint32_t group = (uint32_t)h1 & mask;
+      for (uint32_t probe = 0; probe <= mask; ++probe) {
+        uint64_t word = load_group(group);
+        for (uint64_t m = match(word, h2); m; m &= m - 1) {
+          uint32_t idx = group * kGroupSize + lowest_byte(m);
+          // Recheck the tag since borrows in match() can flag the byte after
+          // a true match, which may be a deleted slot holding a stale key.
+          if (ctrl[idx] == h2 && slots[idx].key == key) return idx;
+        }
+        if (match_empty(word)) return -1;
+        group = (group + probe + 1) & mask;
+      }
+      return -1;
+    }
+
+    // Returns the first empty or deleted slot along the probe sequence.
+    uint32_t find_insert_slot(uint64_t h1) const {
+      uint32_t mask = group_mask();
+      uint32_t group = (uint32_t)h1 & mask;
+      for (uint32_t probe = 0;; ++probe) {
+        uint64_t m = match_empty_or_deleted(load_group(group));
+        if (m) return group * kGroupSize + lowest_byte(m);
+        group = (group + probe + 1) & mask;
+      }
+    }
+
+    void erase(uint32_t idx) {
+      ctrl[idx] = kDeleted;
+      --size;
+      ++tombstones;
+    }
+
+    inline bool needs_room() const {
+      return (uint64_t)(size + tombstones + 1) * 8 > (uint64_t)capacity * 7;
+    }
+  };
+
+  struct NoOpUpdate {
+    void operator()(ValueT&) const {}
+  };
+
+  template <typename UpdateBlockT>
+  bool set(const KeyT& key, const ValueT& value, UpdateBlockT update_block,
+           bool update_only, const ValueT& previous_value,
+           bool has_prev_value) {
+    uint64_t h = Hasher{}(key);
+    shard* s = &shards_[shard_index(h)];
+    uint64_t h1 = h >> (7 + shard_bits_);
+    uint8_t tag = h2(h);
+
+    while (true) {
+      lock(s);
+
+      int64_t idx = s->find(key, h1, tag);
+      if (idx >= 0) {
+        ValueT& existing = s->slots[idx].value;
+        if (update_only) {
+          update_block(existing);
+        } else {
+          if (has_prev_value && previous_value != existing) {
+            unlock(s);
+            return false;
+          }
+          if (value == zero_) {
+            s->erase((uint32_t)idx);
+            count_.fetch_sub(1, std::memory_order_relaxed);
+          } else {
+            existing = value;
+          }
+        }
+        unlock(s);
+        return true;
+      }
+
+      if (!update_only &&
+          (value == zero_ || (has_prev_value && previous_value != zero_))) {
+        unlock(s);
+        return false;
+      }
+
+      if (count_.load(std::memory_order_relaxed) + 1 > max_size_) {
+        unlock(s);
+        os_unfair_lock_lock(&clear_lock_);
+        if (count_.load(std::memory_order_relaxed) + 1 > max_size_) {
+          uint64_t evicted = 0;
+          clear([&evicted](KeyT&, ValueT&) { ++evicted; });
+          evictions_.increment(evicted);
+        }
+        os_unfair_lock_unlock(&clear_lock_);
+        continue;
+      }
+
+      if (unlikely(s->needs_room())) {
+        make_room(s);
+      }
+
+      uint32_t target = s->find_insert_slot(h1);
+      if (s->ctrl[target] == kDeleted) --s->tombstones;
+      s->ctrl[target] = tag;
+      s->slots[target].key = key;
+      if (update_only) {
+        s->slots[target].value = zero_;
+        update_block(s->slots[target].value);
+      } else {
+        s->slots[target].value = value;
+      }
+      ++s->size;
+      count_.fetch_add(1, std::memory_order_relaxed);
+
+      unlock(s);
+      return true;
+    }
+  }
+
+  /**
+    Called with the shard locked when an insert would exceed the shard's
+    maximum load. Tombstones are reclaimed by rehashing in place if that frees
+    enough space; otherwise the shard is cleared.
+  */
+  void make_room(shard* s) {
+    if (s->tombstones > s->capacity / 8) {
+      std::vector<slot> live;
+      live.reserve(s->size);
+      for (uint32_t j = 0; j < s->capacity; ++j) {
+        if (is_full(s->ctrl[j])) live.push_back(s->slots[j]);
+      }
+      s->reset();
+      for (const slot& e : live) {
+        uint64_t h = Hasher{}(e.key);
+        uint32_t target = s->find_insert_slot(h >> (7 + shard_bits_));
+        s->ctrl[target] = h2(h);
+        s->slots[target] = e;
+        ++s->size;
+      }
+      return;
+    }
+
+    uint32_t evicted = s->size;
+    s->reset();
+    count_.fetch_sub(evicted, std::memory_order_relaxed);
+    evictions_.increment(evicted);
+  }
+
+  inline uint32_t shard_index(uint64_t h) const {
+    return (uint32_t)(h >> 7) & (shard_count_ - 1);
+  }
+
+  static inline uint8_t h2(uint64_t h) { return (uint8_t)(h & 0x7F); }
+
+  inline void lock(shard* s) const { os_unfair_lock_lock(&s->lock); }
+
+  inline void unlock(shard* s) const { os_unfair_lock_unlock(&s->lock); }
+
+  std::atomic<uint64_t> count_ = 0;
+
+  // See SantaCache for why explicit padding is used here instead of alignas.
+  char count_padding_[128];
+
+  const uint64_t max_size_;
+  uint32_t shard_bits_;
+  uint32_t shard_count_;
+  std::unique_ptr<shard[]> shards_;
+
+  const ValueT zero_ = {};
+
+  os_unfair_lock clear_lock_ = OS_UNFAIR_LOCK_INIT;
+
+  // Mutable so that const lookups can record hits and misses.
+  mutable SantaCacheCounter hits_;
+  mutable SantaCacheCounter misses_;
+  SantaCacheCounter evictions_;
+};
+
+#endif  // SANTA_COMMON_SANTAFLATCACHE_H
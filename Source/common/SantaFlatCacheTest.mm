@@ -0,0 +1,158 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/SantaFlatCache.h"
+
+#import <XCTest/XCTest.h>
+
+#include <map>
+#include <utility>
+
+@interface SantaFlatCacheTest : XCTestCase
+@end
+
+@implementation SantaFlatCacheTest
+
+- (void)setUp {
+  self.continueAfterFailure = NO;
+}
+
+- (void)testSetAndGet {
+  auto sut = SantaFlatCache<uint64_t, uint64_t>();
+
+  sut.set(72057611258548992llu, 10000192);
+  XCTAssertEqual(sut.get(72057611258548992llu), 10000192);
+  XCTAssertEqual(sut.get(1), 0);
+  XCTAssertEqual(sut.count(), 1);
+}
+
+- (void)testRemove {
+  auto sut = SantaFlatCache<uint64_t, uint64_t>();
+
+  sut.set(0xDEADBEEF, 42);
+  sut.remove(0xDEADBEEF);
+
+  XCTAssertEqual(sut.get(0xDEADBEEF), 0);
+  XCTAssertEqual(sut.count(), 0);
+}
+
+- (void)testCompareAndSwap {
+  auto sut = SantaFlatCache<uint64_t, uint64_t>();
+
+  XCTAssertFalse(sut.set(1, 42, 7));
+  XCTAssertTrue(sut.set(1, 42, 0));
+  XCTAssertFalse(sut.set(1, 43, 7));
+  XCTAssertEqual(sut.get(1), 42);
+  XCTAssertTrue(sut.set(1, 43, 42));
+  XCTAssertEqual(sut.get(1), 43);
+}
+
+- (void)testUpdate {
+  auto sut = SantaFlatCache<uint64_t, uint64_t>();
+
+  sut.update(5, [](uint64_t& val) { val += 2; });
+  sut.update(5, [](uint64_t& val) { val *= 10; });
+  XCTAssertEqual(sut.get(5), 20);
+}
+
+- (void)testPairKeys {
+  auto sut = SantaFlatCache<std::pair<pid_t, int>, bool>();
+
+  sut.set({1, 2}, true);
+  XCTAssertTrue(sut.get({1, 2}));
+  XCTAssertFalse(sut.get({2, 1}));
+  XCTAssertTrue(sut.contains({1, 2}));
+}
+
+- (void)testCacheResetAtLimit {
+  auto sut = SantaFlatCache<uint64_t, uint64_t>(5);
+
+  for (uint64_t i = 1; i <= 5; ++i) {
+    sut.set(i, 42);
+  }
+  XCTAssertEqual(sut.get(3), 42);
+  sut.set(6, 42);
+  XCTAssertEqual(sut.get(3), 0);
+  XCTAssertEqual(sut.get(6), 42);
+  XCTAssertEqual(sut.count(), 1);
+  XCTAssertEqual(sut.stats().evictions, 5);
+}
+
+- (void)testMatchesReferenceMapUnderChurn {
+  // Heavy set/remove churn exercises tombstone reuse and in-place rehashing.
+  auto sut = SantaFlatCache<uint64_t, uint64_t>(100000);
+  std::map<uint64_t, uint64_t> reference;
+
+  for (uint32_t i = 0; i < 200000; ++i) {
+    uint64_t key = arc4random_uniform(20000);
+    switch (arc4random_uniform(3)) {
+      case 0: {
+        uint64_t val = arc4random_uniform(1000) + 1;
+        sut.set(key, val);
+        reference[key] = val;
+        break;
+      }
+      case 1:
+        sut.remove(key);
+        reference.erase(key);
+        break;
+      default: {
+        auto it = reference.find(key);
+        XCTAssertEqual(sut.get(key), it == reference.end() ? 0 : it->second);
+        break;
+      }
+    }
+  }
+
+  XCTAssertEqual(sut.count(), reference.size());
+
+  uint64_t seen = 0;
+  sut.foreach([&](uint64_t& k, uint64_t& v) {
+    XCTAssertEqual(reference[k], v);
+    ++seen;
+  });
+  XCTAssertEqual(seen, reference.size());
+}
+
+- (void)testRemoveIf {
+  auto sut = SantaFlatCache<uint64_t, uint64_t>();
+  for (uint64_t i = 1; i <= 100; ++i) {
+    sut.set(i, i);
+  }
+
+  uint64_t removed = sut.remove_if([](const uint64_t& k, uint64_t&) { return k % 2 == 0; });
+  XCTAssertEqual(removed, 50);
+  XCTAssertEqual(sut.count(), 50);
+  XCTAssertEqual(sut.get(2), 0);
+  XCTAssertEqual(sut.get(3), 3);
+}
+
+- (void)testThreading {
+  auto sut = new SantaFlatCache<uint64_t, uint64_t>(20000);
+
+  dispatch_apply(4, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t t) {
+    for (uint64_t i = t * 5000; i < (t + 1) * 5000; ++i) {
+      sut->set(i, i + 1);
+    }
+  });
+
+  for (uint64_t i = 0; i < 20000; ++i) {
+    XCTAssertEqual(sut->get(i), i + 1);
+  }
+  XCTAssertEqual(sut->count(), 20000);
+
+  delete sut;
+}
+
+@end
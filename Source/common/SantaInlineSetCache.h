@@ -0,0 +1,173 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_SANTAINLINESETCACHE_H
+#define SANTA_COMMON_SANTAINLINESETCACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "Source/common/SantaSeqlockCache.h"
+#include "Source/common/SantaSetCache.h"
+#include "absl/hash/hash.h"
+
+namespace santa {
+
+/// A SantaSetCache variant for small, trivially copyable values. The first
+/// kInlineCapacity values for each key are stored inline in a
+/// SantaSeqlockCache, so membership checks take no locks and adding a value
+/// doesn't allocate. Only keys that outgrow the inline capacity spill the
+/// rest of their values into a heap-backed SantaSetCache.
+///
+/// Like SantaSetCache, once a key's set reaches per_entry_capacity the
+/// values past the inline capacity are cleared to make room.
+template <typename KeyT, typename ValueT, size_t kInlineCapacity = 8,
+          class Hasher = absl::Hash<KeyT>>
+class SantaInlineSetCache {
+  static_assert(std::is_trivially_copyable_v<ValueT>,
+                "SantaInlineSetCache values must be trivially copyable");
+  static_assert(kInlineCapacity > 0 && kInlineCapacity <= UINT8_MAX,
+                "kInlineCapacity must fit in a uint8_t");
+
+ public:
+  SantaInlineSetCache(size_t capacity, size_t per_entry_capacity)
+      : inline_(capacity, 4, SantaCacheEvictionPolicy::kClock),
+        overflow_(capacity, per_entry_capacity > kInlineCapacity
+                                ? per_entry_capacity - kInlineCapacity
+                                : 1),
+        inline_limit_(
+            (uint8_t)std::clamp<size_t>(per_entry_capacity, 1, kInlineCapacity)),
+        spills_(per_entry_capacity > kInlineCapacity) {}
+
+  // Not copyable
+  SantaInlineSetCache(const SantaInlineSetCache& other) = delete;
+  SantaInlineSetCache& operator=(const SantaInlineSetCache& other) = delete;
+
+  // Moves could be safe to implement, but not currently needed.
+  SantaInlineSetCache(SantaInlineSetCache&& other) = delete;
+  SantaInlineSetCache& operator=(SantaInlineSetCache&& rhs) = delete;
+
+  /// Check if the set at the given key contained the given value.
+  bool Contains(const KeyT& key, const ValueT& val) const {
+    bool overflowed = false;
+    if (inline_.contains(key, [&val, &overflowed](const InlineSet& set) {
+          overflowed = set.overflowed;
+          return set.Contains(val);
+        })) {
+      return true;
+    }
+    return overflowed && overflow_.Contains(key, val);
+  }
+
+  /// Adds the value to the set contained at given key. The set is created if
+  /// one didn't previously exist. Return true if the new value was inserted,
+  /// or false if the set already contained the value.
+  bool Set(const KeyT& key, const ValueT& val) {
+    bool did_set = false;
+    bool spill = false;
+    bool first_spill = false;
+    inline_.update(key, [&](InlineSet& set) {
+      if (set.Contains(val)) {
+        return;
+      }
+      if (set.size < inline_limit_) {
+        set.values[set.size++] = val;
+        did_set = true;
+        return;
+      }
+      if (!spills_) {
+        // The whole set fits inline, so make room the way SantaSetCache
+        // does, by starting the set over.
+        set.values[0] = val;
+        set.size = 1;
+        did_set = true;
+        return;
+      }
+      spill = true;
+      first_spill = !set.overflowed;
+      set.overflowed = true;
+    });
+
+    if (!spill) {
+      return did_set;
+    }
+
+    // Values left over from before this key's inline set was last evicted
+    // may still be in the overflow cache.
+    if (first_spill) {
+      overflow_.Remove(key);
+    }
+    return overflow_.Set(key, val);
+  }
+
+  /// Remove the outer cache entry.
+  void Remove(const KeyT& key) {
+    inline_.remove(key);
+    overflow_.Remove(key);
+  }
+
+  /// Clear the whole cache.
+  void Clear() {
+    inline_.clear();
+    overflow_.Clear();
+  }
+
+  /// Size of the cache
+  size_t Size() const { return inline_.count(); }
+
+  /// Size of the underlying set in the cache at the given key
+  size_t Size(const KeyT& key) const {
+    InlineSet set = inline_.get(key);
+    return set.size + (set.overflowed ? overflow_.Size(key) : 0);
+  }
+
+  /// Stats and size of the inline cache
+  SantaCacheStats Stats() const { return inline_.stats(); }
+  SantaCacheUsage Usage() const { return inline_.usage(); }
+
+ private:
+  struct InlineSet {
+    ValueT values[kInlineCapacity];
+    uint8_t size = 0;
+    // Whether there are more values in overflow_.
+    bool overflowed = false;
+
+    bool Contains(const ValueT& val) const {
+      for (uint8_t i = 0; i < size; ++i) {
+        if (values[i] == val) return true;
+      }
+      return false;
+    }
+
+    // SantaSeqlockCache treats a set equal to the default value as absent.
+    bool operator==(const InlineSet& rhs) const {
+      if (size != rhs.size || overflowed != rhs.overflowed) return false;
+      for (uint8_t i = 0; i < size; ++i) {
+        if (!(values[i] == rhs.values[i])) return false;
+      }
+      return true;
+    }
+  };
+
+  SantaSeqlockCache<KeyT, InlineSet, Hasher> inline_;
+  SantaSetCache<KeyT, ValueT, Hasher> overflow_;
+  const uint8_t inline_limit_;
+  const bool spills_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_SANTAINLINESETCACHE_H
@@ -0,0 +1,117 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/SantaInlineSetCache.h"
+
+#import <XCTest/XCTest.h>
+
+#include <thread>
+#include <vector>
+
+using santa::SantaInlineSetCache;
+
+// Test aliases
+using IntInlineSetCache = SantaInlineSetCache<int, int, 4>;
+
+@interface SantaInlineSetCacheTest : XCTestCase
+@end
+
+@implementation SantaInlineSetCacheTest
+
+- (void)testBasic {
+  IntInlineSetCache cache(16, 16);
+
+  XCTAssertTrue(cache.Set(1, 1));
+  XCTAssertFalse(cache.Set(1, 1));
+  XCTAssertTrue(cache.Set(1, 2));
+  XCTAssertTrue(cache.Set(2, 1));
+
+  XCTAssertTrue(cache.Contains(1, 1));
+  XCTAssertTrue(cache.Contains(1, 2));
+  XCTAssertFalse(cache.Contains(1, 3));
+  XCTAssertFalse(cache.Contains(3, 1));
+  XCTAssertEqual(cache.Size(), 2);
+  XCTAssertEqual(cache.Size(1), 2);
+
+  cache.Remove(1);
+  XCTAssertFalse(cache.Contains(1, 1));
+  XCTAssertEqual(cache.Size(), 1);
+
+  cache.Clear();
+  XCTAssertFalse(cache.Contains(2, 1));
+  XCTAssertEqual(cache.Size(), 0);
+}
+
+- (void)testSpillsPastInlineCapacity {
+  IntInlineSetCache cache(16, 6);
+
+  for (int i = 0; i < 6; i++) {
+    XCTAssertTrue(cache.Set(1, i));
+  }
+  XCTAssertFalse(cache.Set(1, 5));
+  XCTAssertEqual(cache.Size(1), 6);
+  for (int i = 0; i < 6; i++) {
+    XCTAssertTrue(cache.Contains(1, i));
+  }
+
+  // Overflowing the spilled values clears them, but keeps the inline ones.
+  XCTAssertTrue(cache.Set(1, 6));
+  XCTAssertEqual(cache.Size(1), 5);
+  XCTAssertTrue(cache.Contains(1, 0));
+  XCTAssertTrue(cache.Contains(1, 6));
+  XCTAssertFalse(cache.Contains(1, 4));
+
+  // Removing the key forgets the spilled values too.
+  cache.Remove(1);
+  XCTAssertEqual(cache.Size(1), 0);
+  XCTAssertFalse(cache.Contains(1, 6));
+}
+
+- (void)testSmallPerEntryCapacity {
+  IntInlineSetCache cache(16, 2);
+
+  XCTAssertTrue(cache.Set(1, 1));
+  XCTAssertTrue(cache.Set(1, 2));
+
+  // Like SantaSetCache, going over capacity starts the set over.
+  XCTAssertTrue(cache.Set(1, 3));
+  XCTAssertEqual(cache.Size(1), 1);
+  XCTAssertFalse(cache.Contains(1, 1));
+  XCTAssertTrue(cache.Contains(1, 3));
+}
+
+- (void)testConcurrentReadersAndWriters {
+  IntInlineSetCache cache(1024, 4);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&cache, t] {
+      for (int i = 0; i < 10000; i++) {
+        cache.Set(t, i % 4);
+        // Other threads only touch their own keys, so the value written
+        // above can't have been displaced.
+        XCTAssertTrue(cache.Contains(t, i % 4));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int t = 0; t < 4; t++) {
+    XCTAssertEqual(cache.Size(t), 4);
+  }
+}
+
+@end
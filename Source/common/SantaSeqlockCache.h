@@ -0,0 +1,655 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_SANTASEQLOCKCACHE_H
+#define SANTA_COMMON_SANTASEQLOCKCACHE_H
+
+#include <os/lock.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#include "Source/common/BranchPrediction.h"
+#include "Source/common/SantaCacheStats.h"
+#include "absl/hash/hash.h"
+
+/**
+  A read-mostly concurrent hash table with lock-free lookups.
+
+  This is a variant of SantaCache for hot lookup paths where reads vastly
+  outnumber writes. Each bucket stores a fixed number of entries inline and is
+  protected by a sequence lock: writers serialize on a per-bucket
+  os_unfair_lock and bump the bucket sequence number around every mutation,
+  while readers take no locks and instead retry if the sequence number changed
+  (or was odd) while they were copying the entry out.
+
+  Because readers may observe a partially written entry before discarding it,
+  both KeyT and ValueT must be trivially copyable. Values that hold
+  references (e.g. Objective-C objects) must continue to use SantaCache.
+
+  Semantics match SantaCache with two differences:
+    - Callbacks passed to `contains` receive a consistent snapshot of the value
+      rather than being called under lock.
+    - If a bucket's inline slots are exhausted before the cache reaches its
+      maximum size, inserting a new key evicts an existing entry from that
+      bucket in round-robin order. Buckets are sized so this is rare.
+*/
+template <typename KeyT, typename ValueT, class Hasher = absl::Hash<KeyT>>
+class SantaSeqlockCache {
+  static_assert(std::is_trivially_copyable_v<KeyT>,
+                "SantaSeqlockCache keys must be trivially copyable");
+  static_assert(std::is_trivially_copyable_v<ValueT>,
+                "SantaSeqlockCache values must be trivially copyable");
+
+ public:
+  /// The number of inline entries available in each bucket.
+  static constexpr uint8_t kSlotsPerBucket = 8;
+
+  /**
+    Initialize a newly created cache.
+
+    @param maximum_size The maximum number of entries in this cache. Once this
+        number is reached entries are evicted according to eviction_policy.
+    @param per_bucket The target number of entries in each bucket when cache is
+        full. Cannot be higher than kSlotsPerBucket so that buckets have some
+        headroom before they overflow.
+    @param eviction_policy How to make room when the cache is full.
+  */
+  SantaSeqlockCache(uint64_t maximum_size = 10000, uint8_t per_bucket = 4,
+                    SantaCacheEvictionPolicy eviction_policy =
+                        SantaCacheEvictionPolicy::kClearAll)
+      : eviction_policy_(eviction_policy) {
+    if (unlikely(per_bucket > maximum_size)) per_bucket = (uint8_t)maximum_size;
+    if (unlikely(per_bucket < 1)) per_bucket = 1;
+    if (unlikely(per_bucket > kSlotsPerBucket)) per_bucket = kSlotsPerBucket;
+    max_size_ = maximum_size;
+    bucket_count_ =
+        (1 << (32 -
+               __builtin_clz((((uint32_t)max_size_ / per_bucket) - 1) ?: 1)));
+    // hash() relies on bucket_count_ being a power of two.
+    assert(bucket_count_ > 0 && (bucket_count_ & (bucket_count_ - 1)) == 0);
+    buckets_ = (struct bucket*)calloc(bucket_count_, sizeof(struct bucket));
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      buckets_[i].lock = OS_UNFAIR_LOCK_INIT;
+    }
+  }
+
+  ~SantaSeqlockCache() { free(buckets_); }
+
+  SantaSeqlockCache(const SantaSeqlockCache&) = delete;
+  SantaSeqlockCache& operator=(const SantaSeqlockCache&) = delete;
+
+  /**
+    Get an element from the cache without taking any locks. Returns zero_ if
+    item doesn't exist.
+  */
+  ValueT get(const KeyT& key) const {
+    ValueT val = zero_;
+    struct bucket* bucket = &buckets_[hash(key)];
+    int8_t slot = read(bucket, key, &val);
+    if (slot >= 0) {
+      mark_referenced(bucket, slot);
+      hits_.increment();
+    } else {
+      misses_.increment();
+    }
+    return val;
+  }
+
+  /**
+    Set an element in the cache.
+
+    @note If the cache is full when this is called, entries are evicted
+        according to the cache's eviction policy before inserting.
+
+    @return true if the value was set.
+  */
+  bool set(const KeyT& key, const ValueT& value) {
+    return set(key, value, NoOpUpdate{}, false, {}, false);
+  }
+
+  /**
+    Set an element in the cache only if the existing value is equal to
+    previous_value. This allows set to become a CAS operation.
+
+    @return true if the value was set
+  */
+  bool set(const KeyT& key, const ValueT& value, const ValueT& previous_value) {
+    return set(key, value, NoOpUpdate{}, false, previous_value, true);
+  }
+
+  /**
+    Update an element in the cache under the bucket's writer lock. If the
+    element doesn't yet exist, it will be first created and value initialized
+    before the update_block is called.
+  */
+  template <typename UpdateBlockT>
+  bool update(const KeyT& key, UpdateBlockT update_block) {
+    static_assert(std::is_invocable_r_v<void, UpdateBlockT&, ValueT&>,
+                  "update_block must be callable as void(ValueT&)");
+    return set(key, zero_, update_block, true, {}, false);
+  }
+
+  /**
+    An alias for `set(key, zero_)`
+  */
+  inline void remove(const KeyT& key) { set(key, zero_); }
+
+  /**
+    Check if a given key exists in the cache. If it does, contains_block is
+    called with a consistent snapshot of the value to allow further filtering.
+  */
+  template <typename ContainsBlockT>
+  bool contains(const KeyT& key, ContainsBlockT contains_block) const {
+    static_assert(std::is_invocable_r_v<bool, ContainsBlockT&, const ValueT&>,
+                  "contains_block must be callable as bool(const ValueT&)");
+    ValueT val;
+    if (read(&buckets_[hash(key)], key, &val) < 0) return false;
+    return contains_block(val);
+  }
+
+  /**
+    Check if a given key exists in the cache.
+  */
+  bool contains(const KeyT& key) const {
+    return contains(key, [](const ValueT&) { return true; });
+  }
+
+  /**
+    Iterate all key and value pairs in the cache. All bucket writer locks are
+    held for the duration; readers are not blocked.
+  */
+  template <typename ForeachBlockT>
+  void foreach(ForeachBlockT foreach_block) {
+    static_assert(std::is_invocable_r_v<void, ForeachBlockT&, KeyT&, ValueT&>,
+                  "foreach_block must be callable as void(KeyT&, ValueT&)");
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      lock(&buckets_[i]);
+    }
+
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      struct bucket* bucket = &buckets_[i];
+      for (uint8_t s = 0; s < kSlotsPerBucket; ++s) {
+        if (!(bucket->occupied & (1u << s))) continue;
+        // Hand out copies so the callback cannot mutate entries outside of a
+        // write section.
+        KeyT k = bucket->slots[s].key;
+        ValueT v = bucket->slots[s].value;
+        foreach_block(k, v);
+      }
+    }
+
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      unlock(&buckets_[i]);
+    }
+  }
+
+  /**
+    Remove entries matching a predicate. Buckets are locked one at a time.
+
+    @warning The predicate MUST NOT call mutating methods on this same cache
+        instance.
+
+    @return The number of entries removed.
+  */
+  template <typename PredicateT>
+  uint64_t remove_if(PredicateT predicate) {
+    static_assert(
+        std::is_invocable_r_v<bool, PredicateT&, const KeyT&, ValueT&>,
+        "predicate must be callable as bool(const KeyT&, ValueT&)");
+    uint64_t removed = 0;
+
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      struct bucket* bucket = &buckets_[i];
+      lock(bucket);
+      begin_write(bucket);
+      for (uint8_t s = 0; s < kSlotsPerBucket; ++s) {
+        if (!(bucket->occupied & (1u << s))) continue;
+        if (predicate(bucket->slots[s].key, bucket->slots[s].value)) {
+          bucket->occupied &= ~(1u << s);
+          count_.fetch_sub(1, std::memory_order_relaxed);
+          ++removed;
+        }
+      }
+      end_write(bucket);
+      unlock(bucket);
+    }
+
+    return removed;
+  }
+
+  /**
+    Remove all entries.
+
+    @param clear_block Called for all key and value pairs just prior to
+        deletion.
+  */
+  template <typename ClearBlockT>
+  void clear(ClearBlockT clear_block) {
+    static_assert(std::is_invocable_r_v<void, ClearBlockT&, KeyT&, ValueT&>,
+                  "clear_block must be callable as void(KeyT&, ValueT&)");
+    instrumentation_.record_clear();
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      struct bucket* bucket = &buckets_[i];
+      lock(bucket);
+      begin_write(bucket);
+      for (uint8_t s = 0; s < kSlotsPerBucket; ++s) {
+        if (bucket->occupied & (1u << s)) {
+          clear_block(bucket->slots[s].key, bucket->slots[s].value);
+        }
+      }
+      bucket->occupied = 0;
+      end_write(bucket);
+    }
+
+    // All bucket locks are held so no concurrent set() can observe a stale
+    // count and trigger a redundant clear.
+    count_.store(0, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+      unlock(&buckets_[i]);
+    }
+  }
+
+  /**
+    Remove all entries.
+  */
+  void clear() {
+    clear([](KeyT&, ValueT&) {});
+  }
+
+  /**
+    Return number of entries currently in cache.
+  */
+  inline uint64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  /**
+    Return the hit/miss counts for get() and the number of entries evicted to
+    make room for new ones. Bucket overflow replacements count as evictions.
+  */
+  SantaCacheStats stats() const {
+    SantaCacheStats stats{
+        .hits = hits_.load(),
+        .misses = misses_.load(),
+        .evictions = evictions_.load(),
+    };
+    instrumentation_.fill(stats);
+    return stats;
+  }
+
+  /**
+    Return the maximum number of entries the cache will hold.
+  */
+  inline uint64_t max_size() const {
+    return max_size_.load(std::memory_order_relaxed);
+  }
+
+  /**
+    Change the maximum number of entries, e.g. in response to memory pressure.
+    The bucket count is fixed at creation, so the maximum is capped at the
+    number of inline slots. If the cache holds more than the new maximum,
+    entries are evicted according to the eviction policy until it fits.
+  */
+  void set_max_size(uint64_t maximum_size) {
+    if (unlikely(maximum_size < 1)) maximum_size = 1;
+    maximum_size = std::min<uint64_t>(
+        maximum_size, (uint64_t)bucket_count_ * kSlotsPerBucket);
+    os_unfair_lock_lock(&clear_lock_);
+    max_size_.store(maximum_size, std::memory_order_relaxed);
+    if (eviction_policy_ == SantaCacheEvictionPolicy::kClock) {
+      while (count_.load(std::memory_order_relaxed) > maximum_size &&
+             evict_batch() > 0) {
+      }
+    } else if (count_.load(std::memory_order_relaxed) > maximum_size) {
+      uint64_t evicted = 0;
+      clear([&evicted](KeyT&, ValueT&) { ++evicted; });
+      evictions_.increment(evicted);
+    }
+    os_unfair_lock_unlock(&clear_lock_);
+  }
+
+  /**
+    Return the current size of the cache along with its stats(). Entries are
+    stored inline, so the size doesn't depend on the number of entries.
+  */
+  SantaCacheUsage usage() const {
+    return SantaCacheUsage{
+        .entries = count(),
+        .max_entries = max_size(),
+        .bytes = sizeof(*this) + bucket_count_ * sizeof(struct bucket),
+        .stats = stats(),
+        .bucket_lengths = bucket_lengths(),
+    };
+  }
+
+  /**
+    Fill in the per_bucket_counts array with the number of entries in each
+    bucket. See SantaCache::bucket_counts for the paging semantics.
+  */
+  void bucket_counts(uint16_t* per_bucket_counts, uint16_t* array_size,
+                     uint64_t* start_bucket) {
+    if (per_bucket_counts == nullptr || array_size == nullptr ||
+        start_bucket == nullptr)
+      return;
+
+    uint64_t start = *start_bucket;
+    if (start >= bucket_count_) {
+      *start_bucket = 0;
+      return;
+    }
+
+    uint16_t size = *array_size;
+    if (start + size > bucket_count_) size = (uint16_t)(bucket_count_ - start);
+
+    for (uint16_t i = 0; i < size; ++i) {
+      struct bucket* bucket = &buckets_[start++];
+      lock(bucket);
+      per_bucket_counts[i] = (uint16_t)__builtin_popcount(bucket->occupied);
+      unlock(bucket);
+    }
+
+    *array_size = size;
+    *start_bucket = (start >= bucket_count_) ? 0 : start;
+  }
+
+ private:
+  struct slot {
+    KeyT key;
+    ValueT value;
+  };
+
+  struct bucket {
+    // Odd while a writer is mutating the bucket.
+    std::atomic<uint32_t> seq;
+    os_unfair_lock lock;
+    uint8_t occupied;
+    uint8_t next_victim;
+    // Set by readers on lookup, cleared by the CLOCK hand. This lives outside
+    // the sequence-locked data since readers write it.
+    std::atomic<uint8_t> referenced;
+    struct slot slots[kSlotsPerBucket];
+  };
+
+  static_assert(kSlotsPerBucket <= 8, "occupied bitmask is a uint8_t");
+
+  struct NoOpUpdate {
+    void operator()(ValueT&) const {}
+  };
+
+  /**
+    Lock-free lookup. Copies the value for key into out and returns the slot
+    the key was found in within a consistent snapshot of the bucket, or -1.
+  */
+  int8_t read(const struct bucket* bucket, const KeyT& key, ValueT* out) const {
+    while (true) {
+      uint32_t seq = bucket->seq.load(std::memory_order_acquire);
+      if (unlikely(seq & 1)) {
+        // A writer is mid-update. Writers hold the section for a handful of
+        // stores so spinning is cheaper than yielding.
+        continue;
+      }
+
+      int8_t found = -1;
+      uint8_t occupied = bucket->occupied;
+      struct slot snapshot;
+      for (uint8_t s = 0; s < kSlotsPerBucket; ++s) {
+        if (!(occupied & (1u << s))) continue;
+        memcpy((void*)&snapshot, (const void*)&bucket->slots[s],
+               sizeof(snapshot));
+        if (snapshot.key == key) {
+          found = s;
+          break;
+        }
+      }
+
+      // Order the data reads above before the validating sequence read.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (likely(bucket->seq.load(std::memory_order_relaxed) == seq)) {
+        if (found >= 0) *out = snapshot.value;
+        return found;
+      }
+    }
+  }
+
+  template <typename UpdateBlockT>
+  bool set(const KeyT& key, const ValueT& value, UpdateBlockT update_block,
+           bool update_only, const ValueT& previous_value,
+           bool has_prev_value) {
+    struct bucket* bucket = &buckets_[hash(key)];
+
+    while (true) {
+      lock(bucket);
+
+      int8_t found_slot = -1;
+      for (uint8_t s = 0; s < kSlotsPerBucket; ++s) {
+        if ((bucket->occupied & (1u << s)) && bucket->slots[s].key == key) {
+          found_slot = s;
+          break;
+        }
+      }
+
+      if (found_slot >= 0) {
+        struct slot* slot = &bucket->slots[found_slot];
+        if (!update_only && has_prev_value && previous_value != slot->value) {
+          unlock(bucket);
+          return false;
+        }
+
+        begin_write(bucket);
+        if (update_only) {
+          update_block(slot->value);
+        } else if (value == zero_) {
+          bucket->occupied &= ~(1u << found_slot);
+          count_.fetch_sub(1, std::memory_order_relaxed);
+        } else {
+          slot->value = value;
+        }
+        end_write(bucket);
+
+        unlock(bucket);
+        return true;
+      }
+
+      // If value is zero_, we're clearing but there's nothing to clear.
+      // Alternatively, if has_prev_value is true and is not zero_ we don't
+      // want to set a value.
+      if (!update_only &&
+          (value == zero_ || (has_prev_value && previous_value != zero_))) {
+        unlock(bucket);
+        return false;
+      }
+
+      if (count_.load(std::memory_order_relaxed) + 1 >
+          max_size_.load(std::memory_order_relaxed)) {
+        unlock(bucket);
+        os_unfair_lock_lock(&clear_lock_);
+        if (count_.load(std::memory_order_relaxed) + 1 >
+            max_size_.load(std::memory_order_relaxed)) {
+          if (eviction_policy_ == SantaCacheEvictionPolicy::kClock) {
+            evict_batch();
+          } else {
+            uint64_t evicted = 0;
+            clear([&evicted](KeyT&, ValueT&) { ++evicted; });
+            evictions_.increment(evicted);
+          }
+        }
+        os_unfair_lock_unlock(&clear_lock_);
+        // Bucket was unlocked during the clear path. Another thread may have
+        // inserted the same key, so retry the lookup from scratch.
+        continue;
+      }
+
+      uint8_t free_slots = (uint8_t)~bucket->occupied;
+      uint8_t target;
+      bool evicting = (free_slots == 0);
+      if (likely(!evicting)) {
+        target = (uint8_t)__builtin_ctz(free_slots);
+      } else {
+        target = bucket->next_victim;
+        bucket->next_victim = (uint8_t)((target + 1) % kSlotsPerBucket);
+      }
+
+      ValueT new_value = zero_;
+      if (update_only) {
+        update_block(new_value);
+      } else {
+        new_value = value;
+      }
+
+      begin_write(bucket);
+      bucket->slots[target].key = key;
+      bucket->slots[target].value = new_value;
+      bucket->occupied |= (uint8_t)(1u << target);
+      end_write(bucket);
+      bucket->referenced.fetch_and((uint8_t)~(1u << target),
+                                   std::memory_order_relaxed);
+
+      if (likely(!evicting)) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        evictions_.increment();
+      }
+      instrumentation_.record_insert();
+
+      unlock(bucket);
+      return true;
+    }
+  }
+
+  /**
+    Record a read of the given slot for the CLOCK hand. The bit is checked
+    first so that repeated hits don't keep dirtying the bucket's cache line.
+  */
+  inline void mark_referenced(struct bucket* bucket, int8_t slot) const {
+    if (eviction_policy_ != SantaCacheEvictionPolicy::kClock) return;
+    uint8_t bit = (uint8_t)(1u << slot);
+    if (!(bucket->referenced.load(std::memory_order_relaxed) & bit)) {
+      bucket->referenced.fetch_or(bit, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+    Advance the CLOCK hand until a batch of entries has been evicted. Entries
+    read since the hand last passed them get a second chance. Must be called
+    with clear_lock_ held, which also protects clock_hand_.
+  */
+  uint64_t evict_batch() {
+    const uint64_t target =
+        (max_size_.load(std::memory_order_relaxed) >> 6) ?: 1;
+    uint64_t evicted = 0;
+
+    // Two full revolutions always suffice since the first clears every
+    // reference bit.
+    for (uint64_t visited = 0;
+         evicted < target && visited < 2ull * bucket_count_; ++visited) {
+      struct bucket* bucket = &buckets_[clock_hand_];
+      clock_hand_ = (clock_hand_ + 1) & (bucket_count_ - 1);
+
+      lock(bucket);
+      uint8_t referenced =
+          bucket->referenced.exchange(0, std::memory_order_relaxed);
+      uint8_t victims = bucket->occupied & (uint8_t)~referenced;
+      if (victims) {
+        begin_write(bucket);
+        bucket->occupied &= (uint8_t)~victims;
+        end_write(bucket);
+        uint8_t n = (uint8_t)__builtin_popcount(victims);
+        count_.fetch_sub(n, std::memory_order_relaxed);
+        evicted += n;
+      }
+      unlock(bucket);
+    }
+
+    evictions_.increment(evicted);
+    return evicted;
+  }
+
+  /**
+    Count buckets by the number of entries they hold. Only done with
+    kSantaCacheInstrumentation since it takes every bucket lock.
+  */
+  SantaCacheBucketLengths bucket_lengths() const {
+    SantaCacheBucketLengths lengths = {};
+    if constexpr (kSantaCacheInstrumentation) {
+      for (uint32_t i = 0; i < bucket_count_; ++i) {
+        struct bucket* bucket = &buckets_[i];
+        lock(bucket);
+        size_t length = (size_t)__builtin_popcount(bucket->occupied);
+        unlock(bucket);
+        ++lengths[std::min(length, kSantaCacheBucketLengths - 1)];
+      }
+    }
+    return lengths;
+  }
+
+  inline void begin_write(struct bucket* bucket) {
+    uint32_t seq = bucket->seq.load(std::memory_order_relaxed);
+    bucket->seq.store(seq + 1, std::memory_order_relaxed);
+    // Readers that observe any of the following data writes must also
+    // observe the odd sequence number.
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  inline void end_write(struct bucket* bucket) {
+    uint32_t seq = bucket->seq.load(std::memory_order_relaxed);
+    bucket->seq.store(seq + 1, std::memory_order_release);
+  }
+
+  inline void lock(struct bucket* bucket) const {
+    instrumentation_.lock(&bucket->lock);
+  }
+
+  inline void unlock(struct bucket* bucket) const {
+    os_unfair_lock_unlock(&bucket->lock);
+  }
+
+  std::atomic<uint64_t> count_ = 0;
+
+  // See SantaCache for why explicit padding is used here instead of alignas.
+  char count_padding_[128];
+
+  // Written under clear_lock_ by set_max_size().
+  std::atomic<uint64_t> max_size_;
+  uint32_t bucket_count_;
+
+  struct bucket* buckets_;
+
+  const ValueT zero_ = {};
+
+  const SantaCacheEvictionPolicy eviction_policy_;
+
+  os_unfair_lock clear_lock_ = OS_UNFAIR_LOCK_INIT;
+
+  // Next bucket the CLOCK hand will visit. Guarded by clear_lock_.
+  uint32_t clock_hand_ = 0;
+
+  // Mutable so that const lookups can record hits and misses.
+  mutable SantaCacheCounter hits_;
+  mutable SantaCacheCounter misses_;
+  SantaCacheCounter evictions_;
+  [[no_unique_address]] mutable SantaCacheInstrumentation instrumentation_;
+
+  inline uint64_t hash(const KeyT& input) const {
+    return Hasher{}(input) & (bucket_count_ - 1);
+  }
+};
+
+#endif  // SANTA_COMMON_SANTASEQLOCKCACHE_H
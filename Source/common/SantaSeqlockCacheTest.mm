@@ -0,0 +1,231 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/SantaSeqlockCache.h"
+
+#import <XCTest/XCTest.h>
+
+#include <atomic>
+
+// A value type wide enough that a torn read would be observable.
+struct PairValue {
+  uint64_t a = 0;
+  uint64_t b = 0;
+
+  bool operator==(const PairValue& rhs) const { return a == rhs.a && b == rhs.b; }
+};
+
+// Forces all keys into a single bucket.
+struct ZeroHasher {
+  size_t operator()(uint64_t) const { return 0; }
+};
+
+@interface SantaSeqlockCacheTest : XCTestCase
+@end
+
+@implementation SantaSeqlockCacheTest
+
+- (void)setUp {
+  self.continueAfterFailure = NO;
+}
+
+- (void)testSetAndGet {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>();
+
+  sut.set(72057611258548992llu, 10000192);
+  XCTAssertEqual(sut.get(72057611258548992llu), 10000192);
+  XCTAssertEqual(sut.get(1), 0);
+  XCTAssertEqual(sut.count(), 1);
+}
+
+- (void)testRemove {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>();
+
+  sut.set(0xDEADBEEF, 42);
+  sut.remove(0xDEADBEEF);
+
+  XCTAssertEqual(sut.get(0xDEADBEEF), 0);
+  XCTAssertEqual(sut.count(), 0);
+}
+
+- (void)testCompareAndSwap {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>();
+
+  // Setting with a non-zero previous value when nothing exists fails.
+  XCTAssertFalse(sut.set(1, 42, 7));
+  XCTAssertTrue(sut.set(1, 42, 0));
+  XCTAssertFalse(sut.set(1, 43, 7));
+  XCTAssertEqual(sut.get(1), 42);
+  XCTAssertTrue(sut.set(1, 43, 42));
+  XCTAssertEqual(sut.get(1), 43);
+}
+
+- (void)testUpdate {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>();
+
+  sut.update(5, [](uint64_t& val) { val += 2; });
+  sut.update(5, [](uint64_t& val) { val *= 10; });
+  XCTAssertEqual(sut.get(5), 20);
+}
+
+- (void)testContains {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>();
+
+  sut.set(5, 10);
+  XCTAssertTrue(sut.contains(5));
+  XCTAssertFalse(sut.contains(6));
+  XCTAssertTrue(sut.contains(5, [](const uint64_t& v) { return v == 10; }));
+  XCTAssertFalse(sut.contains(5, [](const uint64_t& v) { return v == 11; }));
+}
+
+- (void)testCacheResetAtLimit {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>(5);
+
+  for (uint64_t i = 1; i <= 5; ++i) {
+    sut.set(i, 42);
+  }
+  XCTAssertEqual(sut.get(3), 42);
+  sut.set(6, 42);
+  XCTAssertEqual(sut.get(3), 0);
+  XCTAssertEqual(sut.get(6), 42);
+  XCTAssertEqual(sut.count(), 1);
+}
+
+- (void)testBucketOverflowEvictsWithinBucket {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t, ZeroHasher>(100);
+  constexpr uint64_t slots = SantaSeqlockCache<uint64_t, uint64_t>::kSlotsPerBucket;
+
+  // Every key lands in the same bucket, so inserts past the inline capacity
+  // replace the oldest entries rather than growing the bucket.
+  for (uint64_t i = 1; i <= 20; ++i) {
+    XCTAssertTrue(sut.set(i, i));
+  }
+
+  XCTAssertEqual(sut.count(), slots);
+  XCTAssertEqual(sut.get(1), 0);
+  XCTAssertEqual(sut.get(12), 0);
+  for (uint64_t i = 13; i <= 20; ++i) {
+    XCTAssertEqual(sut.get(i), i);
+  }
+}
+
+- (void)testRemoveIf {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>();
+  for (uint64_t i = 1; i <= 100; ++i) {
+    sut.set(i, i);
+  }
+
+  uint64_t removed = sut.remove_if([](const uint64_t& k, uint64_t&) { return k % 2 == 0; });
+  XCTAssertEqual(removed, 50);
+  XCTAssertEqual(sut.count(), 50);
+  XCTAssertEqual(sut.get(2), 0);
+  XCTAssertEqual(sut.get(3), 3);
+}
+
+- (void)testClearBlock {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>();
+  for (uint64_t i = 1; i <= 10; ++i) {
+    sut.set(i, i);
+  }
+
+  uint64_t sum = 0;
+  sut.clear([&](uint64_t&, uint64_t& v) { sum += v; });
+  XCTAssertEqual(sum, 55);
+  XCTAssertEqual(sut.count(), 0);
+  XCTAssertEqual(sut.get(1), 0);
+}
+
+- (void)testConcurrentReadersNeverSeeTornValues {
+  auto sut = new SantaSeqlockCache<uint64_t, PairValue>(1000);
+  auto stop = new std::atomic<bool>{false};
+  auto torn = new std::atomic<uint64_t>{0};
+
+  dispatch_group_t group = dispatch_group_create();
+
+  for (int r = 0; r < 4; ++r) {
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+      while (!stop->load()) {
+        for (uint64_t k = 0; k < 64; ++k) {
+          PairValue v = sut->get(k);
+          if (v.a != v.b) torn->fetch_add(1);
+        }
+      }
+    });
+  }
+
+  dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    for (uint64_t i = 1; i < 200000; ++i) {
+      sut->set(i % 64, PairValue{i, i});
+    }
+    stop->store(true);
+  });
+
+  if (dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 30 * NSEC_PER_SEC))) {
+    XCTFail("Timed out waiting for readers and writers");
+  }
+
+  XCTAssertEqual(torn->load(), 0);
+  delete sut;
+  delete stop;
+  delete torn;
+}
+
+- (void)testClockEvictionKeepsRecentlyReadEntries {
+  // A low per-bucket target keeps inline bucket overflow out of the picture.
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>(100, 2, SantaCacheEvictionPolicy::kClock);
+
+  for (uint64_t i = 1; i <= 100; ++i) {
+    sut.set(i, i);
+  }
+  for (uint64_t i = 1; i <= 10; ++i) {
+    XCTAssertEqual(sut.get(i), i);
+  }
+
+  // Going over the limit evicts a small batch instead of purging everything.
+  XCTAssertTrue(sut.set(101, 101));
+  XCTAssertGreaterThan(sut.count(), 90);
+  XCTAssertLessThanOrEqual(sut.count(), 100);
+  XCTAssertEqual(sut.get(101), 101);
+
+  // Entries read before the eviction got a second chance.
+  for (uint64_t i = 1; i <= 10; ++i) {
+    XCTAssertEqual(sut.get(i), i);
+  }
+
+  SantaCacheStats stats = sut.stats();
+  XCTAssertEqual(stats.hits, 21);
+  XCTAssertEqual(stats.misses, 0);
+  XCTAssertEqual(stats.evictions, 101 - sut.count());
+}
+
+- (void)testStatsClearAll {
+  auto sut = SantaSeqlockCache<uint64_t, uint64_t>(5);
+
+  for (uint64_t i = 1; i <= 6; ++i) {
+    sut.set(i, i);
+  }
+  XCTAssertEqual(sut.get(6), 6);
+  XCTAssertEqual(sut.get(1), 0);
+
+  SantaCacheStats stats = sut.stats();
+  XCTAssertEqual(stats.hits, 1);
+  XCTAssertEqual(stats.misses, 1);
+  XCTAssertEqual(stats.evictions, 5);
+
+  // Explicit clears are not evictions.
+  sut.clear();
+  XCTAssertEqual(sut.stats().evictions, 5);
+}
+
+@end
@@ -111,6 +111,10 @@ class SantaSetCache {
   /// Size of the cache
   size_t Size() const { return cache_.count(); }
 
+  /// Stats and size of the outer cache
+  SantaCacheStats Stats() const { return cache_.stats(); }
+  SantaCacheUsage Usage() const { return cache_.usage(); }
+
   /// Size of the underlying set in the cache at the given key
   size_t Size(const KeyT& key) const {
     SharedValueSet set = cache_.get(key);
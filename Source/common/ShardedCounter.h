@@ -0,0 +1,80 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_SHARDEDCOUNTER_H
+#define SANTA_COMMON_SHARDEDCOUNTER_H
+
+#include <pthread.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace santa {
+
+// A counter for hot paths, split into shards that each sit on their own cache
+// line.
+//
+// Adding is a single relaxed atomic add to the shard for the CPU the thread is
+// running on, so threads on different CPUs don't contend on the same cache
+// line. Migrating between CPUs mid-add only costs a little contention. Reads
+// sum all shards and are only as consistent as a relaxed load of each.
+class ShardedCounter {
+ public:
+  ShardedCounter() = default;
+
+  ShardedCounter(const ShardedCounter&) = delete;
+  ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+  void Add(int64_t value) {
+    shards_[CurrentShard()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void Increment() { Add(1); }
+
+  int64_t Sum() const {
+    int64_t sum = 0;
+    for (const Shard& shard : shards_) {
+      sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+ private:
+  static constexpr size_t kShards = 16;
+
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value = 0;
+  };
+
+  static size_t CurrentShard() {
+    size_t cpu;
+    if (pthread_cpu_number_np(&cpu) == 0) {
+      return cpu % kShards;
+    }
+
+    // Fall back to spreading threads over the shards in the order they first
+    // add to any counter.
+    static std::atomic<size_t> next_shard = 0;
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+  }
+
+  std::array<Shard, kShards> shards_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_SHARDEDCOUNTER_H
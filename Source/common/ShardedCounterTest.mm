@@ -0,0 +1,62 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/ShardedCounter.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <thread>
+#include <vector>
+
+using santa::ShardedCounter;
+
+@interface ShardedCounterTest : XCTestCase
+@end
+
+@implementation ShardedCounterTest
+
+- (void)testAddAndSum {
+  ShardedCounter counter;
+  XCTAssertEqual(counter.Sum(), 0);
+
+  counter.Increment();
+  counter.Add(41);
+  XCTAssertEqual(counter.Sum(), 42);
+
+  counter.Add(-2);
+  XCTAssertEqual(counter.Sum(), 40);
+}
+
+- (void)testConcurrentAdds {
+  ShardedCounter counter;
+  const int kThreads = 8;
+  const int kAddsPerThread = 100000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&counter] {
+      for (int i = 0; i < kAddsPerThread; i++) {
+        counter.Increment();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  XCTAssertEqual(counter.Sum(), kThreads * kAddsPerThread);
+}
+
+@end
@@ -0,0 +1,92 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_SINGLEFLIGHT_H
+#define SANTA_COMMON_SINGLEFLIGHT_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+namespace santa {
+
+// Tracks work that is in progress so that callers wanting the same result can
+// wait for it to be produced instead of polling for it. The result itself is
+// published elsewhere, e.g. to a cache, and re-read by waiters once they wake.
+//
+// A flight is begun by whoever claimed the work and ended once its result has
+// been published. Ending a flight wakes all of its waiters; it is not an error
+// to end a flight that was never begun.
+template <typename KeyT>
+class SingleFlight {
+ public:
+  SingleFlight() = default;
+
+  SingleFlight(const SingleFlight&) = delete;
+  SingleFlight& operator=(const SingleFlight&) = delete;
+
+  // Returns false if a flight for the key is already in progress.
+  bool Begin(const KeyT& key) {
+    absl::MutexLock lock(&mu_);
+    return flights_.try_emplace(key, std::make_shared<absl::Notification>()).second;
+  }
+
+  void End(const KeyT& key) {
+    std::shared_ptr<absl::Notification> flight;
+    {
+      absl::MutexLock lock(&mu_);
+      auto it = flights_.find(key);
+      if (it == flights_.end()) {
+        return;
+      }
+      flight = std::move(it->second);
+      flights_.erase(it);
+    }
+    flight->Notify();
+  }
+
+  // Waits up to `timeout` for the flight for the key to end. Returns false if
+  // it didn't end in time or no flight was in progress, in which case callers
+  // can't rely on being woken and should fall back to polling for the result.
+  bool Wait(const KeyT& key, absl::Duration timeout) {
+    std::shared_ptr<absl::Notification> flight;
+    {
+      absl::MutexLock lock(&mu_);
+      auto it = flights_.find(key);
+      if (it == flights_.end()) {
+        return false;
+      }
+      flight = it->second;
+    }
+    return flight->WaitForNotificationWithTimeout(timeout);
+  }
+
+  size_t InFlight() {
+    absl::MutexLock lock(&mu_);
+    return flights_.size();
+  }
+
+ private:
+  absl::Mutex mu_;
+  absl::flat_hash_map<KeyT, std::shared_ptr<absl::Notification>> flights_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_SINGLEFLIGHT_H
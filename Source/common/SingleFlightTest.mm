@@ -0,0 +1,84 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/SingleFlight.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "absl/time/time.h"
+
+using santa::SingleFlight;
+
+@interface SingleFlightTest : XCTestCase
+@end
+
+@implementation SingleFlightTest
+
+- (void)testBeginOnlyOncePerKey {
+  SingleFlight<int> flights;
+  XCTAssertTrue(flights.Begin(1));
+  XCTAssertFalse(flights.Begin(1));
+  XCTAssertTrue(flights.Begin(2));
+  XCTAssertEqual(flights.InFlight(), 2);
+
+  flights.End(1);
+  XCTAssertEqual(flights.InFlight(), 1);
+  XCTAssertTrue(flights.Begin(1));
+
+  // Ending a flight that isn't in progress is a no-op
+  flights.End(3);
+  XCTAssertEqual(flights.InFlight(), 2);
+}
+
+- (void)testWaitWithoutFlight {
+  SingleFlight<int> flights;
+  XCTAssertFalse(flights.Wait(1, absl::Seconds(5)));
+
+  XCTAssertTrue(flights.Begin(1));
+  XCTAssertFalse(flights.Wait(1, absl::Milliseconds(1)));
+}
+
+- (void)testEndWakesAllWaiters {
+  SingleFlight<int> flights;
+  XCTAssertTrue(flights.Begin(1));
+
+  const int kWaiters = 4;
+  std::atomic<int> woken = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kWaiters; i++) {
+    threads.emplace_back([&flights, &woken] {
+      if (flights.Wait(1, absl::Seconds(10))) {
+        woken++;
+      }
+    });
+  }
+
+  // Give the waiters time to start waiting before the flight ends
+  usleep(100000);
+  flights.End(1);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  XCTAssertEqual(woken, kWaiters);
+  XCTAssertEqual(flights.InFlight(), 0);
+}
+
+@end
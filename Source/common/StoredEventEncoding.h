@@ -0,0 +1,44 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_STOREDEVENTENCODING_H
+#define SANTA_COMMON_STOREDEVENTENCODING_H
+
+#import <Foundation/Foundation.h>
+
+#import "Source/common/SNTStoredEvent.h"
+
+namespace santa {
+
+/// Encodes the event as a santa::storedevent::StoredEvent. Returns nil for
+/// event types without a protobuf encoding, which have to be archived instead.
+NSData* _Nullable EncodeStoredEvent(SNTStoredEvent* _Nonnull event);
+
+/// Decodes an event encoded by EncodeStoredEvent, or returns nil if the data
+/// is not a valid encoding.
+SNTStoredEvent* _Nullable DecodeStoredEvent(NSData* _Nonnull data);
+
+/// Encodes the events as a santa::storedevent::StoredEventBatch, holding each
+/// certificate of their signing chains once. Returns nil if any of the events
+/// has no protobuf encoding.
+NSData* _Nullable EncodeStoredEventBatch(NSArray<SNTStoredEvent*>* _Nonnull events);
+
+/// Decodes events encoded by EncodeStoredEventBatch, in order, or returns nil if
+/// the data is not a valid encoding. Events whose signing chains share a
+/// certificate share its MOLCertificate.
+NSArray<SNTStoredEvent*>* _Nullable DecodeStoredEventBatch(NSData* _Nonnull data);
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_STOREDEVENTENCODING_H
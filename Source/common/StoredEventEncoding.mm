@@ -0,0 +1,388 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/StoredEventEncoding.h"
+
+#include <string>
+
+#import "Source/common/MOLCertificate.h"
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTStoredExecutionEvent.h"
+#import "Source/common/SNTStoredFileAccessEvent.h"
+#import "Source/common/SNTStoredProcess.h"
+#include "Source/common/String.h"
+#include "Source/common/stored_event.pb.h"
+
+namespace pbse = ::santa::storedevent;
+
+// Sets an optional field from a nullable property, leaving it unset for nil.
+#define SET_STRING(msg, field, value)                \
+  do {                                               \
+    if (NSString* v = (value)) {                     \
+      (msg)->set_##field(NSStringToUTF8String(v));   \
+    }                                                \
+  } while (0)
+#define SET_DATE(msg, field, value)                          \
+  do {                                                       \
+    if (NSDate* v = (value)) {                               \
+      (msg)->set_##field(v.timeIntervalSinceReferenceDate);  \
+    }                                                        \
+  } while (0)
+#define SET_NUMBER(msg, field, value, selector) \
+  do {                                         \
+    if (NSNumber* v = (value)) {               \
+      (msg)->set_##field([v selector]);        \
+    }                                          \
+  } while (0)
+
+// The nullable property for an optional field, nil if the field is unset.
+#define GET_STRING(msg, field) ((msg).has_##field() ? StringToNSString((msg).field()) : nil)
+#define GET_DATE(msg, field) \
+  ((msg).has_##field() ? [NSDate dateWithTimeIntervalSinceReferenceDate:(msg).field()] : nil)
+#define GET_NUMBER(msg, field) ((msg).has_##field() ? @((msg).field()) : nil)
+
+namespace santa {
+
+namespace {
+
+// The certificates of a StoredEventBatch while its events are encoded. Events
+// encoded on their own hold their signing chains in full instead.
+class CertificateTable {
+ public:
+  explicit CertificateTable(pbse::StoredEventBatch* batch) : batch_(batch) {}
+
+  // Adds the certificate to the batch, unless it is already there, and returns
+  // its SHA-256. Returns nil if the certificate has no DER encoding.
+  NSString* Add(MOLCertificate* cert) {
+    NSData* der = cert.certData;
+    NSString* sha256 = cert.SHA256;
+    if (!der || !sha256) return nil;
+
+    if (![seen_ containsObject:sha256]) {
+      [seen_ addObject:sha256];
+      pbse::Certificate* pb = batch_->add_certificates();
+      pb->set_sha256(NSStringToUTF8String(sha256));
+      pb->set_der(der.bytes, der.length);
+    }
+    return sha256;
+  }
+
+ private:
+  pbse::StoredEventBatch* batch_;
+  NSMutableSet<NSString*>* seen_ = [NSMutableSet set];
+};
+
+// Certificates of a decoded StoredEventBatch, keyed by SHA-256.
+using CertificateMap = NSDictionary<NSString*, MOLCertificate*>;
+
+void EncodeSigningChain(NSArray<MOLCertificate*>* chain, CertificateTable* certs,
+                        google::protobuf::RepeatedPtrField<std::string>* out,
+                        google::protobuf::RepeatedPtrField<std::string>* sha256_out) {
+  for (MOLCertificate* cert in chain) {
+    if (certs) {
+      NSString* sha256 = certs->Add(cert);
+      if (sha256) sha256_out->Add(NSStringToUTF8String(sha256));
+    } else {
+      NSData* der = cert.certData;
+      if (der) out->Add(std::string(static_cast<const char*>(der.bytes), der.length));
+    }
+  }
+}
+
+NSArray<MOLCertificate*>* DecodeSigningChain(
+    const google::protobuf::RepeatedPtrField<std::string>& chain,
+    const google::protobuf::RepeatedPtrField<std::string>& sha256s, CertificateMap* certs) {
+  if (chain.empty() && sha256s.empty()) return nil;
+
+  NSMutableArray<MOLCertificate*>* out =
+      [NSMutableArray arrayWithCapacity:chain.size() + sha256s.size()];
+  for (const std::string& der : chain) {
+    MOLCertificate* cert = [MOLCertificate
+        internedCertificateWithCertificateDataDER:[NSData dataWithBytes:der.data()
+                                                                length:der.size()]];
+    if (cert) [out addObject:cert];
+  }
+  for (const std::string& sha256 : sha256s) {
+    MOLCertificate* cert = certs[StringToNSString(sha256)];
+    if (cert) [out addObject:cert];
+  }
+  return out;
+}
+
+void EncodeStrings(NSArray* strings, google::protobuf::RepeatedPtrField<std::string>* out) {
+  for (id s in strings) {
+    if ([s isKindOfClass:[NSString class]]) out->Add(NSStringToUTF8String(s));
+  }
+}
+
+NSArray<NSString*>* DecodeStrings(const google::protobuf::RepeatedPtrField<std::string>& strings) {
+  if (strings.empty()) return nil;
+
+  NSMutableArray<NSString*>* out = [NSMutableArray arrayWithCapacity:strings.size()];
+  for (const std::string& s : strings) {
+    [out addObject:StringToNSString(s)];
+  }
+  return out;
+}
+
+void EncodeProcess(SNTStoredProcess* process, CertificateTable* certs, pbse::Process* pb) {
+  SET_STRING(pb, file_path, process.filePath);
+  SET_STRING(pb, cdhash, process.cdhash);
+  SET_STRING(pb, file_sha256, process.fileSHA256);
+  SET_STRING(pb, signing_id, process.signingID);
+  EncodeSigningChain(process.signingChain, certs, pb->mutable_signing_chain(),
+                     pb->mutable_signing_chain_sha256());
+  SET_STRING(pb, team_id, process.teamID);
+  SET_NUMBER(pb, pid, process.pid, intValue);
+  SET_STRING(pb, executing_user, process.executingUser);
+  if (process.parent) EncodeProcess(process.parent, certs, pb->mutable_parent());
+}
+
+SNTStoredProcess* DecodeProcess(const pbse::Process& pb, CertificateMap* certs) {
+  SNTStoredProcess* process = [[SNTStoredProcess alloc] init];
+  process.filePath = GET_STRING(pb, file_path);
+  process.cdhash = GET_STRING(pb, cdhash);
+  process.fileSHA256 = GET_STRING(pb, file_sha256);
+  process.signingID = GET_STRING(pb, signing_id);
+  process.signingChain = DecodeSigningChain(pb.signing_chain(), pb.signing_chain_sha256(), certs);
+  process.teamID = GET_STRING(pb, team_id);
+  process.pid = GET_NUMBER(pb, pid);
+  process.executingUser = GET_STRING(pb, executing_user);
+  if (pb.has_parent()) process.parent = DecodeProcess(pb.parent(), certs);
+  return process;
+}
+
+void EncodeExecutionEvent(SNTStoredExecutionEvent* event, CertificateTable* certs,
+                          pbse::ExecutionEvent* pb) {
+  SET_STRING(pb, file_sha256, event.fileSHA256);
+  SET_STRING(pb, file_path, event.filePath);
+
+  pb->set_needs_bundle_hash(event.needsBundleHash);
+  SET_STRING(pb, file_bundle_hash, event.fileBundleHash);
+  SET_NUMBER(pb, file_bundle_hash_milliseconds, event.fileBundleHashMilliseconds, doubleValue);
+  SET_NUMBER(pb, file_bundle_binary_count, event.fileBundleBinaryCount, longLongValue);
+  SET_STRING(pb, file_bundle_name, event.fileBundleName);
+  SET_STRING(pb, file_bundle_path, event.fileBundlePath);
+  SET_STRING(pb, file_bundle_executable_rel_path, event.fileBundleExecutableRelPath);
+  SET_STRING(pb, file_bundle_id, event.fileBundleID);
+  SET_STRING(pb, file_bundle_version, event.fileBundleVersion);
+  SET_STRING(pb, file_bundle_version_string, event.fileBundleVersionString);
+
+  EncodeSigningChain(event.signingChain, certs, pb->mutable_signing_chain(),
+                     pb->mutable_signing_chain_sha256());
+  SET_STRING(pb, team_id, event.teamID);
+  SET_STRING(pb, signing_id, event.signingID);
+  SET_STRING(pb, cdhash, event.cdhash);
+  pb->set_codesigning_flags(event.codesigningFlags);
+  pb->set_signing_status(event.signingStatus);
+  if (event.entitlements) {
+    NSData* entitlements =
+        [NSPropertyListSerialization dataWithPropertyList:event.entitlements
+                                                   format:NSPropertyListBinaryFormat_v1_0
+                                                  options:0
+                                                    error:nil];
+    if (entitlements) {
+      pb->set_entitlements(entitlements.bytes, entitlements.length);
+    }
+  }
+  pb->set_entitlements_filtered(event.entitlementsFiltered);
+  SET_DATE(pb, secure_signing_time, event.secureSigningTime);
+  SET_DATE(pb, signing_time, event.signingTime);
+
+  SET_STRING(pb, executing_user, event.executingUser);
+  pb->set_decision(event.decision);
+  pb->set_audit_return(event.auditReturn);
+  pb->set_hold_and_ask(event.holdAndAsk);
+  pb->set_silent_touch_id(event.silentTouchID);
+  pb->set_seatbelt_required(event.seatbeltRequired);
+  pb->set_static_rule(event.staticRule);
+  pb->set_rule_id(event.ruleId);
+  SET_NUMBER(pb, pid, event.pid, intValue);
+  SET_NUMBER(pb, ppid, event.ppid, intValue);
+  SET_STRING(pb, parent_name, event.parentName);
+
+  EncodeStrings(event.loggedInUsers, pb->mutable_logged_in_users());
+  EncodeStrings(event.currentSessions, pb->mutable_current_sessions());
+
+  SET_STRING(pb, quarantine_data_url, event.quarantineDataURL);
+  SET_STRING(pb, quarantine_referer_url, event.quarantineRefererURL);
+  SET_DATE(pb, quarantine_timestamp, event.quarantineTimestamp);
+  SET_STRING(pb, quarantine_agent_bundle_id, event.quarantineAgentBundleID);
+}
+
+SNTStoredExecutionEvent* DecodeExecutionEvent(const pbse::ExecutionEvent& pb,
+                                              CertificateMap* certs) {
+  SNTStoredExecutionEvent* event = [[SNTStoredExecutionEvent alloc] init];
+  event.fileSHA256 = GET_STRING(pb, file_sha256);
+  event.filePath = GET_STRING(pb, file_path);
+
+  event.needsBundleHash = pb.needs_bundle_hash();
+  event.fileBundleHash = GET_STRING(pb, file_bundle_hash);
+  event.fileBundleHashMilliseconds = GET_NUMBER(pb, file_bundle_hash_milliseconds);
+  event.fileBundleBinaryCount = GET_NUMBER(pb, file_bundle_binary_count);
+  event.fileBundleName = GET_STRING(pb, file_bundle_name);
+  event.fileBundlePath = GET_STRING(pb, file_bundle_path);
+  event.fileBundleExecutableRelPath = GET_STRING(pb, file_bundle_executable_rel_path);
+  event.fileBundleID = GET_STRING(pb, file_bundle_id);
+  event.fileBundleVersion = GET_STRING(pb, file_bundle_version);
+  event.fileBundleVersionString = GET_STRING(pb, file_bundle_version_string);
+
+  event.signingChain = DecodeSigningChain(pb.signing_chain(), pb.signing_chain_sha256(), certs);
+  event.teamID = GET_STRING(pb, team_id);
+  event.signingID = GET_STRING(pb, signing_id);
+  event.cdhash = GET_STRING(pb, cdhash);
+  event.codesigningFlags = pb.codesigning_flags();
+  event.signingStatus = static_cast<SNTSigningStatus>(pb.signing_status());
+  if (pb.has_entitlements()) {
+    NSData* data = [NSData dataWithBytesNoCopy:(void*)pb.entitlements().data()
+                                        length:pb.entitlements().size()
+                                  freeWhenDone:NO];
+    id entitlements = [NSPropertyListSerialization propertyListWithData:data
+                                                                options:NSPropertyListImmutable
+                                                                 format:NULL
+                                                                  error:nil];
+    if ([entitlements isKindOfClass:[NSDictionary class]]) {
+      event.entitlements = entitlements;
+    }
+  }
+  event.entitlementsFiltered = pb.entitlements_filtered();
+  event.secureSigningTime = GET_DATE(pb, secure_signing_time);
+  event.signingTime = GET_DATE(pb, signing_time);
+
+  event.executingUser = GET_STRING(pb, executing_user);
+  event.decision = static_cast<SNTEventState>(pb.decision());
+  event.auditReturn = pb.audit_return();
+  event.holdAndAsk = pb.hold_and_ask();
+  event.silentTouchID = pb.silent_touch_id();
+  event.seatbeltRequired = pb.seatbelt_required();
+  event.staticRule = pb.static_rule();
+  event.ruleId = pb.rule_id();
+  event.pid = GET_NUMBER(pb, pid);
+  event.ppid = GET_NUMBER(pb, ppid);
+  event.parentName = GET_STRING(pb, parent_name);
+
+  event.loggedInUsers = DecodeStrings(pb.logged_in_users());
+  event.currentSessions = DecodeStrings(pb.current_sessions());
+
+  event.quarantineDataURL = GET_STRING(pb, quarantine_data_url);
+  event.quarantineRefererURL = GET_STRING(pb, quarantine_referer_url);
+  event.quarantineTimestamp = GET_DATE(pb, quarantine_timestamp);
+  event.quarantineAgentBundleID = GET_STRING(pb, quarantine_agent_bundle_id);
+  return event;
+}
+
+void EncodeFileAccessEvent(SNTStoredFileAccessEvent* event, CertificateTable* certs,
+                           pbse::FileAccessEvent* pb) {
+  SET_STRING(pb, rule_version, event.ruleVersion);
+  SET_STRING(pb, rule_name, event.ruleName);
+  SET_STRING(pb, accessed_path, event.accessedPath);
+  if (event.process) EncodeProcess(event.process, certs, pb->mutable_process());
+  pb->set_decision(static_cast<int32_t>(event.decision));
+  pb->set_rule_id(event.ruleId);
+}
+
+SNTStoredFileAccessEvent* DecodeFileAccessEvent(const pbse::FileAccessEvent& pb,
+                                                CertificateMap* certs) {
+  SNTStoredFileAccessEvent* event = [[SNTStoredFileAccessEvent alloc] init];
+  event.ruleVersion = GET_STRING(pb, rule_version);
+  event.ruleName = GET_STRING(pb, rule_name);
+  event.accessedPath = GET_STRING(pb, accessed_path);
+  event.process = pb.has_process() ? DecodeProcess(pb.process(), certs) : nil;
+  event.decision = static_cast<FileAccessPolicyDecision>(pb.decision());
+  event.ruleId = pb.rule_id();
+  return event;
+}
+
+bool EncodeEvent(SNTStoredEvent* event, CertificateTable* certs, pbse::StoredEvent* pb) {
+  pb->set_idx([event.idx longLongValue]);
+  pb->set_occurrence_date(event.occurrenceDate.timeIntervalSinceReferenceDate);
+
+  // Only exact classes are encoded, so subclasses with properties of their own
+  // are never silently truncated.
+  if ([event class] == [SNTStoredExecutionEvent class]) {
+    EncodeExecutionEvent((SNTStoredExecutionEvent*)event, certs, pb->mutable_execution());
+  } else if ([event class] == [SNTStoredFileAccessEvent class]) {
+    EncodeFileAccessEvent((SNTStoredFileAccessEvent*)event, certs, pb->mutable_file_access());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+SNTStoredEvent* DecodeEvent(const pbse::StoredEvent& pb, CertificateMap* certs) {
+  SNTStoredEvent* event;
+  switch (pb.event_case()) {
+    case pbse::StoredEvent::kExecution: event = DecodeExecutionEvent(pb.execution(), certs); break;
+    case pbse::StoredEvent::kFileAccess:
+      event = DecodeFileAccessEvent(pb.file_access(), certs);
+      break;
+    default: return nil;
+  }
+  event.idx = @(pb.idx());
+  event.occurrenceDate = [NSDate dateWithTimeIntervalSinceReferenceDate:pb.occurrence_date()];
+  return event;
+}
+
+NSData* Serialize(const google::protobuf::MessageLite& pb) {
+  std::string data;
+  if (!pb.SerializeToString(&data)) return nil;
+  return [NSData dataWithBytes:data.data() length:data.size()];
+}
+
+}  // namespace
+
+NSData* EncodeStoredEvent(SNTStoredEvent* event) {
+  pbse::StoredEvent pb;
+  if (!EncodeEvent(event, nullptr, &pb)) return nil;
+  return Serialize(pb);
+}
+
+SNTStoredEvent* DecodeStoredEvent(NSData* data) {
+  pbse::StoredEvent pb;
+  if (!pb.ParseFromArray(data.bytes, static_cast<int>(data.length))) return nil;
+  return DecodeEvent(pb, nil);
+}
+
+NSData* EncodeStoredEventBatch(NSArray<SNTStoredEvent*>* events) {
+  pbse::StoredEventBatch pb;
+  CertificateTable certs(&pb);
+  for (SNTStoredEvent* event in events) {
+    if (!EncodeEvent(event, &certs, pb.add_events())) return nil;
+  }
+  return Serialize(pb);
+}
+
+NSArray<SNTStoredEvent*>* DecodeStoredEventBatch(NSData* data) {
+  pbse::StoredEventBatch pb;
+  if (!pb.ParseFromArray(data.bytes, static_cast<int>(data.length))) return nil;
+
+  NSMutableDictionary<NSString*, MOLCertificate*>* certs =
+      [NSMutableDictionary dictionaryWithCapacity:pb.certificates_size()];
+  for (const pbse::Certificate& c : pb.certificates()) {
+    MOLCertificate* cert = [MOLCertificate
+        internedCertificateWithCertificateDataDER:[NSData dataWithBytes:c.der().data()
+                                                                length:c.der().size()]];
+    if (cert) certs[StringToNSString(c.sha256())] = cert;
+  }
+
+  NSMutableArray<SNTStoredEvent*>* out = [NSMutableArray arrayWithCapacity:pb.events_size()];
+  for (const pbse::StoredEvent& e : pb.events()) {
+    SNTStoredEvent* event = DecodeEvent(e, certs);
+    if (!event) return nil;
+    [out addObject:event];
+  }
+  return out;
+}
+
+}  // namespace santa
@@ -0,0 +1,206 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/StoredEventEncoding.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#import "Source/common/MOLCertificate.h"
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTFileInfo.h"
+#import "Source/common/SNTStoredExecutionEvent.h"
+#import "Source/common/SNTStoredFileAccessEvent.h"
+#import "Source/common/SNTStoredProcess.h"
+#import "Source/common/SNTStoredTemporaryMonitorModeAuditEvent.h"
+
+using santa::DecodeStoredEvent;
+using santa::DecodeStoredEventBatch;
+using santa::EncodeStoredEvent;
+using santa::EncodeStoredEventBatch;
+
+@interface StoredEventEncodingTest : XCTestCase
+@end
+
+@implementation StoredEventEncodingTest
+
+- (void)testExecutionEventRoundTrip {
+  SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:@"/usr/bin/yes"];
+  SNTStoredExecutionEvent* event = [[SNTStoredExecutionEvent alloc] initWithFileInfo:fi];
+  XCTAssertGreaterThan(event.signingChain.count, 0);
+
+  event.idx = @(-42);
+  event.occurrenceDate = [NSDate dateWithTimeIntervalSinceReferenceDate:1000.5];
+  event.needsBundleHash = YES;
+  event.fileBundleHashMilliseconds = @(12.5);
+  event.fileBundleBinaryCount = @(3);
+  event.fileBundleID = @"com.example.yes";
+  event.entitlements = @{@"com.apple.security.get-task-allow" : @YES, @"list" : @[ @"a", @"b" ]};
+  event.entitlementsFiltered = YES;
+  event.signingTime = [NSDate dateWithTimeIntervalSinceReferenceDate:2000];
+  event.executingUser = @"nobody";
+  event.decision = SNTEventStateBlockBinary;
+  event.holdAndAsk = YES;
+  event.ruleId = 1234567890123;
+  event.pid = @(100);
+  event.ppid = @(1);
+  event.parentName = @"launchd";
+  event.loggedInUsers = @[ @"alice", @"bob" ];
+  event.currentSessions = @[ @"alice@console" ];
+  event.quarantineDataURL = @"https://example.com/yes";
+  event.quarantineTimestamp = [NSDate dateWithTimeIntervalSinceReferenceDate:3000];
+
+  NSData* data = EncodeStoredEvent(event);
+  XCTAssertNotNil(data);
+  XCTAssertLessThan(data.length, [NSKeyedArchiver archivedDataWithRootObject:event
+                                                       requiringSecureCoding:YES
+                                                                       error:nil]
+                                     .length);
+
+  SNTStoredExecutionEvent* got = (SNTStoredExecutionEvent*)DecodeStoredEvent(data);
+  XCTAssertTrue([got isKindOfClass:[SNTStoredExecutionEvent class]]);
+  XCTAssertEqualObjects(got.idx, event.idx);
+  XCTAssertEqualObjects(got.occurrenceDate, event.occurrenceDate);
+  XCTAssertEqualObjects(got.fileSHA256, event.fileSHA256);
+  XCTAssertEqualObjects(got.filePath, event.filePath);
+  XCTAssertTrue(got.needsBundleHash);
+  XCTAssertEqualObjects(got.fileBundleHashMilliseconds, @(12.5));
+  XCTAssertEqualObjects(got.fileBundleBinaryCount, @(3));
+  XCTAssertEqualObjects(got.fileBundleID, @"com.example.yes");
+  XCTAssertNil(got.fileBundleName);
+  XCTAssertEqual(got.signingChain.count, event.signingChain.count);
+  XCTAssertEqualObjects(got.signingChain.firstObject.SHA256, event.signingChain.firstObject.SHA256);
+  XCTAssertEqualObjects(got.teamID, event.teamID);
+  XCTAssertEqualObjects(got.signingID, event.signingID);
+  XCTAssertEqualObjects(got.cdhash, event.cdhash);
+  XCTAssertEqual(got.codesigningFlags, event.codesigningFlags);
+  XCTAssertEqual(got.signingStatus, SNTSigningStatusProduction);
+  XCTAssertEqualObjects(got.entitlements, event.entitlements);
+  XCTAssertTrue(got.entitlementsFiltered);
+  XCTAssertNil(got.secureSigningTime);
+  XCTAssertEqualObjects(got.signingTime, event.signingTime);
+  XCTAssertEqualObjects(got.executingUser, @"nobody");
+  XCTAssertEqual(got.decision, SNTEventStateBlockBinary);
+  XCTAssertFalse(got.auditReturn);
+  XCTAssertTrue(got.holdAndAsk);
+  XCTAssertEqual(got.ruleId, 1234567890123);
+  XCTAssertEqualObjects(got.pid, @(100));
+  XCTAssertEqualObjects(got.ppid, @(1));
+  XCTAssertEqualObjects(got.parentName, @"launchd");
+  XCTAssertEqualObjects(got.loggedInUsers, event.loggedInUsers);
+  XCTAssertEqualObjects(got.currentSessions, event.currentSessions);
+  XCTAssertEqualObjects(got.quarantineDataURL, event.quarantineDataURL);
+  XCTAssertNil(got.quarantineRefererURL);
+  XCTAssertEqualObjects(got.quarantineTimestamp, event.quarantineTimestamp);
+}
+
+- (void)testFileAccessEventRoundTrip {
+  SNTStoredFileAccessEvent* event = [[SNTStoredFileAccessEvent alloc] init];
+  event.ruleVersion = @"v1";
+  event.ruleName = @"protect_keys";
+  event.accessedPath = @"/etc/keys";
+  event.decision = FileAccessPolicyDecision::kDenied;
+  event.ruleId = 7;
+  event.process.filePath = @"/usr/bin/cat";
+  event.process.pid = @(200);
+  event.process.parent = [[SNTStoredProcess alloc] init];
+  event.process.parent.filePath = @"/bin/zsh";
+  event.process.parent.executingUser = @"root";
+
+  SNTStoredFileAccessEvent* got = (SNTStoredFileAccessEvent*)DecodeStoredEvent(
+      EncodeStoredEvent(event));
+  XCTAssertTrue([got isKindOfClass:[SNTStoredFileAccessEvent class]]);
+  XCTAssertEqualObjects(got.idx, event.idx);
+  XCTAssertEqualObjects(got.occurrenceDate, event.occurrenceDate);
+  XCTAssertEqualObjects(got.ruleVersion, @"v1");
+  XCTAssertEqualObjects(got.ruleName, @"protect_keys");
+  XCTAssertEqualObjects(got.accessedPath, @"/etc/keys");
+  XCTAssertEqual(got.decision, FileAccessPolicyDecision::kDenied);
+  XCTAssertEqual(got.ruleId, 7);
+  XCTAssertEqualObjects(got.process.filePath, @"/usr/bin/cat");
+  XCTAssertEqualObjects(got.process.pid, @(200));
+  XCTAssertNil(got.process.signingChain);
+  XCTAssertEqualObjects(got.process.parent.filePath, @"/bin/zsh");
+  XCTAssertEqualObjects(got.process.parent.executingUser, @"root");
+  XCTAssertNil(got.process.parent.parent);
+}
+
+- (void)testBatchRoundTrip {
+  SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:@"/usr/bin/yes"];
+  NSMutableArray<SNTStoredEvent*>* events = [NSMutableArray array];
+  for (int i = 0; i < 10; i++) {
+    SNTStoredExecutionEvent* event = [[SNTStoredExecutionEvent alloc] initWithFileInfo:fi];
+    event.idx = @(i);
+    [events addObject:event];
+  }
+  SNTStoredFileAccessEvent* faa = [[SNTStoredFileAccessEvent alloc] init];
+  faa.idx = @(10);
+  faa.process.signingChain = ((SNTStoredExecutionEvent*)events[0]).signingChain;
+  [events addObject:faa];
+
+  NSData* data = EncodeStoredEventBatch(events);
+  XCTAssertNotNil(data);
+
+  // Each certificate is only held once, so the batch is much smaller than the
+  // events encoded one at a time.
+  NSUInteger unbatched = 0;
+  for (SNTStoredEvent* event in events) {
+    unbatched += EncodeStoredEvent(event).length;
+  }
+  XCTAssertLessThan(data.length, unbatched / 2);
+
+  NSArray<SNTStoredEvent*>* got = DecodeStoredEventBatch(data);
+  XCTAssertEqual(got.count, events.count);
+  NSArray<MOLCertificate*>* chain = ((SNTStoredExecutionEvent*)events[0]).signingChain;
+  for (int i = 0; i < 10; i++) {
+    SNTStoredExecutionEvent* event = (SNTStoredExecutionEvent*)got[i];
+    XCTAssertTrue([event isKindOfClass:[SNTStoredExecutionEvent class]]);
+    XCTAssertEqualObjects(event.idx, @(i));
+    XCTAssertEqualObjects(event.fileSHA256, fi.SHA256);
+    XCTAssertEqualObjects(event.signingChain, chain);
+    // Decoded events share the certificates of the batch.
+    XCTAssertEqual(event.signingChain[0], ((SNTStoredExecutionEvent*)got[0]).signingChain[0]);
+  }
+  SNTStoredFileAccessEvent* gotFAA = (SNTStoredFileAccessEvent*)got[10];
+  XCTAssertTrue([gotFAA isKindOfClass:[SNTStoredFileAccessEvent class]]);
+  XCTAssertEqualObjects(gotFAA.process.signingChain, chain);
+
+  XCTAssertEqualObjects(DecodeStoredEventBatch(EncodeStoredEventBatch(@[])), @[]);
+}
+
+- (void)testBatchWithUnsupportedEventsIsNotEncoded {
+  SNTStoredTemporaryMonitorModeLeaveAuditEvent* event =
+      [[SNTStoredTemporaryMonitorModeLeaveAuditEvent alloc]
+          initWithUUID:@"uuid"
+                reason:SNTTemporaryMonitorModeLeaveReasonCancelled];
+  XCTAssertNil(EncodeStoredEventBatch(@[ [[SNTStoredFileAccessEvent alloc] init], event ]));
+}
+
+- (void)testUnsupportedEventsAreNotEncoded {
+  SNTStoredTemporaryMonitorModeLeaveAuditEvent* event =
+      [[SNTStoredTemporaryMonitorModeLeaveAuditEvent alloc]
+          initWithUUID:@"uuid"
+                reason:SNTTemporaryMonitorModeLeaveReasonCancelled];
+  XCTAssertNil(EncodeStoredEvent(event));
+}
+
+- (void)testInvalidDataIsNotDecoded {
+  XCTAssertNil(DecodeStoredEvent([NSData data]));
+
+  const uint8_t garbage[] = {0xff, 0xff, 0xff, 0xff};
+  XCTAssertNil(DecodeStoredEvent([NSData dataWithBytes:garbage length:sizeof(garbage)]));
+  XCTAssertNil(DecodeStoredEventBatch([NSData dataWithBytes:garbage length:sizeof(garbage)]));
+}
+
+@end
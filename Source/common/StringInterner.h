@@ -0,0 +1,96 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_STRINGINTERNER_H
+#define SANTA_COMMON_STRINGINTERNER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Shares a single copy of strings that are seen over and over, such as user
+// and group names, so that every holder of an equal string points at the same
+// allocation. Interned strings must not be modified.
+//
+// Memory is bounded by the number of strings kept. Once the limit is reached,
+// strings that haven't been seen before are still returned but aren't kept.
+// Interned strings live as long as the interner.
+class StringInterner {
+ public:
+  static constexpr size_t kDefaultMaxStrings = 4096;
+
+  explicit StringInterner(size_t max_strings = kDefaultMaxStrings) : max_strings_(max_strings) {}
+
+  StringInterner(const StringInterner&) = delete;
+  StringInterner& operator=(const StringInterner&) = delete;
+
+  // The interner shared by the whole process.
+  static StringInterner& Shared() {
+    static StringInterner* interner = new StringInterner();
+    return *interner;
+  }
+
+  std::shared_ptr<std::string> Intern(std::string_view str) {
+    absl::MutexLock lock(&lock_);
+    auto it = strings_.find(str);
+    if (it != strings_.end()) {
+      return *it;
+    }
+
+    auto interned = std::make_shared<std::string>(str);
+    if (strings_.size() < max_strings_) {
+      strings_.insert(interned);
+    }
+    return interned;
+  }
+
+  size_t Size() {
+    absl::MutexLock lock(&lock_);
+    return strings_.size();
+  }
+
+ private:
+  // Lets strings be looked up by std::string_view without copying them.
+  struct Hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const { return absl::Hash<std::string_view>{}(str); }
+    size_t operator()(const std::shared_ptr<std::string>& str) const { return (*this)(*str); }
+  };
+
+  struct Eq {
+    using is_transparent = void;
+    static std::string_view View(std::string_view str) { return str; }
+    static std::string_view View(const std::shared_ptr<std::string>& str) { return *str; }
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+      return View(a) == View(b);
+    }
+  };
+
+  const size_t max_strings_;
+  absl::Mutex lock_;
+  absl::flat_hash_set<std::shared_ptr<std::string>, Hash, Eq> strings_ ABSL_GUARDED_BY(lock_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_STRINGINTERNER_H
@@ -0,0 +1,90 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/StringInterner.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using santa::StringInterner;
+
+@interface StringInternerTest : XCTestCase
+@end
+
+@implementation StringInternerTest
+
+- (void)testEqualStringsShareStorage {
+  StringInterner interner;
+  std::string staff = "staff";
+
+  std::shared_ptr<std::string> a = interner.Intern("staff");
+  std::shared_ptr<std::string> b = interner.Intern(staff);
+  std::shared_ptr<std::string> c = interner.Intern("wheel");
+
+  XCTAssertEqual(a.get(), b.get());
+  XCTAssertNotEqual(a.get(), c.get());
+  XCTAssertEqual(*a, "staff");
+  XCTAssertEqual(*c, "wheel");
+  XCTAssertEqual(interner.Size(), 2);
+
+  // The empty string is interned like any other
+  XCTAssertEqual(interner.Intern("").get(), interner.Intern("").get());
+}
+
+- (void)testBounded {
+  StringInterner interner(2);
+  std::shared_ptr<std::string> a = interner.Intern("a");
+  interner.Intern("b");
+
+  // Once full, new strings are returned without being kept...
+  std::shared_ptr<std::string> c1 = interner.Intern("c");
+  std::shared_ptr<std::string> c2 = interner.Intern("c");
+  XCTAssertEqual(*c1, "c");
+  XCTAssertNotEqual(c1.get(), c2.get());
+  XCTAssertEqual(interner.Size(), 2);
+
+  // ...while strings already kept are still shared
+  XCTAssertEqual(interner.Intern("a").get(), a.get());
+}
+
+- (void)testConcurrentIntern {
+  StringInterner interner;
+  const int kThreads = 8;
+  std::vector<std::vector<std::shared_ptr<std::string>>> results(kThreads);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&interner, &results, t] {
+      for (int i = 0; i < 100; i++) {
+        results[t].push_back(interner.Intern("user" + std::to_string(i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  XCTAssertEqual(interner.Size(), 100);
+  for (int t = 1; t < kThreads; t++) {
+    for (int i = 0; i < 100; i++) {
+      XCTAssertEqual(results[t][i].get(), results[0][i].get());
+    }
+  }
+}
+
+@end
@@ -18,6 +18,7 @@
 #import <EndpointSecurity/ESTypes.h>
 #import <Foundation/Foundation.h>
 
+#include <string_view>
 #include <type_traits>
 
 namespace santa {
@@ -84,9 +85,22 @@ inline TelemetryEvent operator~(TelemetryEvent rhs) {
 // If `Telemetry` is not set, `everything` (all events) are assumed.
 TelemetryEvent TelemetryConfigToBitmask(NSArray<NSString*>* telemetry);
 
+// Events that are never dropped to shed load, whatever the configuration.
+TelemetryEvent UnsheddableTelemetryEvents();
+
+// Create a `TelemetryEvent` bitmask of the events that may be dropped when the
+// event log falls behind, based on the `TelemetryLoadSheddingEvents`
+// configuration value. If it is not set, fork, exit, close and link events are
+// shed. Unsheddable events are never included.
+TelemetryEvent TelemetryLoadSheddingConfigToBitmask(NSArray<NSString*>* events);
+
 // Returns the appropriate `TelemetryEvent` enum value for a given ES event
 TelemetryEvent ESEventToTelemetryEvent(es_event_type_t event);
 
+// Returns the lowercase `Telemetry` configuration name of a single event, or
+// an empty string if the value isn't exactly one event.
+std::string_view TelemetryEventToName(TelemetryEvent event);
+
 }  // namespace santa
 
 #endif  // SANTA_COMMON_TELEMETRYEVENTMAP_H
@@ -24,8 +24,8 @@
 
 namespace santa {
 
-static inline TelemetryEvent EventNameToMask(std::string_view event) {
-  static absl::flat_hash_map<std::string_view, TelemetryEvent> event_name_to_mask = {
+static const absl::flat_hash_map<std::string_view, TelemetryEvent>& EventNameMap() {
+  static const absl::flat_hash_map<std::string_view, TelemetryEvent> event_name_to_mask = {
       {"execution", TelemetryEvent::kExecution},
       {"fork", TelemetryEvent::kFork},
       {"exit", TelemetryEvent::kExit},
@@ -58,7 +58,11 @@ static inline TelemetryEvent EventNameToMask(std::string_view event) {
       {"none", TelemetryEvent::kNone},
       {"everything", TelemetryEvent::kEverything},
   };
+  return event_name_to_mask;
+}
 
+static inline TelemetryEvent EventNameToMask(std::string_view event) {
+  const auto& event_name_to_mask = EventNameMap();
   auto search = event_name_to_mask.find(event);
   if (search != event_name_to_mask.end()) {
     return search->second;
@@ -67,6 +71,19 @@ static inline TelemetryEvent EventNameToMask(std::string_view event) {
   }
 }
 
+std::string_view TelemetryEventToName(TelemetryEvent event) {
+  if (event == TelemetryEvent::kNone || event == TelemetryEvent::kEverything) {
+    return "";
+  }
+
+  for (const auto& [name, mask] : EventNameMap()) {
+    if (mask == event) {
+      return name;
+    }
+  }
+  return "";
+}
+
 TelemetryEvent TelemetryConfigToBitmask(NSArray<NSString*>* telemetry) {
   TelemetryEvent mask = TelemetryEvent::kNone;
 
@@ -81,6 +98,17 @@ TelemetryEvent TelemetryConfigToBitmask(NSArray<NSString*>* telemetry) {
   return mask;
 }
 
+TelemetryEvent UnsheddableTelemetryEvents() {
+  return TelemetryEvent::kExecution | TelemetryEvent::kFileAccess;
+}
+
+TelemetryEvent TelemetryLoadSheddingConfigToBitmask(NSArray<NSString*>* events) {
+  TelemetryEvent mask = events ? TelemetryConfigToBitmask(events)
+                               : TelemetryEvent::kFork | TelemetryEvent::kExit |
+                                     TelemetryEvent::kClose | TelemetryEvent::kLink;
+  return mask & ~UnsheddableTelemetryEvents();
+}
+
 TelemetryEvent ESEventToTelemetryEvent(es_event_type_t event) {
   switch (event) {
     case ES_EVENT_TYPE_NOTIFY_CLONE: return TelemetryEvent::kClone;
@@ -19,6 +19,7 @@
 #import <XCTest/XCTest.h>
 
 #include <map>
+#include <string>
 #include <string_view>
 
 #include "Source/common/Platform.h"
@@ -26,6 +27,8 @@
 using santa::ESEventToTelemetryEvent;
 using santa::TelemetryConfigToBitmask;
 using santa::TelemetryEvent;
+using santa::TelemetryEventToName;
+using santa::TelemetryLoadSheddingConfigToBitmask;
 
 @interface TelemetryEventMapTest : XCTestCase
 @end
@@ -85,6 +88,21 @@ using santa::TelemetryEvent;
   XCTAssertEqual(TelemetryConfigToBitmask(nil), TelemetryEvent::kEverything);
 }
 
+- (void)testTelemetryLoadSheddingConfigToBitmask {
+  XCTAssertEqual(TelemetryLoadSheddingConfigToBitmask(nil),
+                 TelemetryEvent::kFork | TelemetryEvent::kExit | TelemetryEvent::kClose |
+                     TelemetryEvent::kLink);
+  XCTAssertEqual(TelemetryLoadSheddingConfigToBitmask(@[]), TelemetryEvent::kNone);
+  XCTAssertEqual(TelemetryLoadSheddingConfigToBitmask(@[ @"rename", @"Unlink" ]),
+                 TelemetryEvent::kRename | TelemetryEvent::kUnlink);
+
+  // Executions and file access events are never shed
+  XCTAssertEqual(TelemetryLoadSheddingConfigToBitmask(@[ @"execution", @"fileaccess", @"fork" ]),
+                 TelemetryEvent::kFork);
+  XCTAssertEqual(TelemetryLoadSheddingConfigToBitmask(@[ @"everything" ]),
+                 ~santa::UnsheddableTelemetryEvents());
+}
+
 - (void)testESEventToTelemetryEvent {
   std::map<es_event_type_t, TelemetryEvent> esEventToTelemetryEvent = {
       {ES_EVENT_TYPE_NOTIFY_CLONE, TelemetryEvent::kClone},
@@ -136,4 +154,22 @@ using santa::TelemetryEvent;
   }
 }
 
+- (void)testTelemetryEventToName {
+  XCTAssertTrue(TelemetryEventToName(TelemetryEvent::kFork) == "fork");
+  XCTAssertTrue(TelemetryEventToName(TelemetryEvent::kCodesigningInvalidated) ==
+                "codesigninginvalidated");
+  XCTAssertTrue(TelemetryEventToName(TelemetryEvent::kNone) == "");
+  XCTAssertTrue(TelemetryEventToName(TelemetryEvent::kEverything) == "");
+  XCTAssertTrue(TelemetryEventToName(TelemetryEvent::kFork | TelemetryEvent::kExit) == "");
+
+  // Every name maps back to the same event
+  for (uint64_t bit = 1; bit <= static_cast<uint64_t>(TelemetryEvent::kProcSuspendResume);
+       bit <<= 1) {
+    TelemetryEvent event = static_cast<TelemetryEvent>(bit);
+    std::string_view name = TelemetryEventToName(event);
+    XCTAssertFalse(name.empty());
+    XCTAssertEqual(TelemetryConfigToBitmask(@[ @(std::string(name).c_str()) ]), event);
+  }
+}
+
 @end
@@ -18,8 +18,10 @@
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
 #include <sys/qos.h>
+#include <time.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -51,16 +53,28 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
     kWaitOneCycle,
   };
 
+  enum class Leeway {
+    // Default: the timer may fire up to 10% of its interval (at most a minute)
+    // late, and deadlines are rounded up to a multiple of that leeway. This lets
+    // the system coalesce the wakeups of all periodic timers, e.g. timers with
+    // the same interval always fire together.
+    kCoalesce,
+    // The timer fires as close to its deadline as possible. Use for deadlines
+    // that users can observe.
+    kStrict,
+  };
+
   Timer(uint32_t minimum_interval, uint32_t maximum_interval, OnStart startup_option,
         std::string backing_config_var,
         RescheduleMode reschedule_mode = RescheduleMode::kLeadingEdge,
-        dispatch_qos_class_t qos_class = QOS_CLASS_UTILITY)
+        dispatch_qos_class_t qos_class = QOS_CLASS_UTILITY, Leeway leeway = Leeway::kCoalesce)
       : interval_seconds_(minimum_interval),
         minimum_interval_(minimum_interval),
         maximum_interval_(maximum_interval),
         startup_option_(startup_option),
         backing_config_var_(std::move(backing_config_var)),
-        reschedule_mode_(reschedule_mode) {
+        reschedule_mode_(reschedule_mode),
+        leeway_(leeway) {
     static_assert(
         requires(T t) {
           { t.OnTimer() } -> std::same_as<bool>;
@@ -217,8 +231,39 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
   }
 
  private:
+  static constexpr uint64_t kLeewayPercent = 10;
+  static constexpr uint64_t kMaxLeewayNS = 60 * NSEC_PER_SEC;
+
   inline bool StartTimerSerialized() { return StartTimerSerialized(startup_option_); }
 
+  uint64_t LeewayNSSerialized() const {
+    if (leeway_ == Leeway::kStrict) {
+      return 0;
+    }
+    return std::min(interval_seconds_ * NSEC_PER_SEC * kLeewayPercent / 100, kMaxLeewayNS);
+  }
+
+  // The wall clock deadline one interval from now, rounded up to a multiple of
+  // the leeway so timers sharing a leeway share their deadlines.
+  dispatch_time_t NextDeadlineSerialized() const {
+    uint64_t leeway_ns = LeewayNSSerialized();
+    if (leeway_ns == 0) {
+      return dispatch_time(DISPATCH_WALLTIME_NOW, interval_seconds_ * NSEC_PER_SEC);
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t deadline_ns = static_cast<uint64_t>(now.tv_sec) * NSEC_PER_SEC +
+                           static_cast<uint64_t>(now.tv_nsec) + interval_seconds_ * NSEC_PER_SEC;
+    deadline_ns = (deadline_ns + leeway_ns - 1) / leeway_ns * leeway_ns;
+
+    struct timespec deadline = {
+        .tv_sec = static_cast<time_t>(deadline_ns / NSEC_PER_SEC),
+        .tv_nsec = static_cast<long>(deadline_ns % NSEC_PER_SEC),
+    };
+    return dispatch_walltime(&deadline, 0);
+  }
+
   bool StartTimerSerialized(OnStart on_start) {
     if (timer_source_) {
       return false;  // No-op if already running
@@ -254,15 +299,17 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
     if (on_start == OnStart::kFireImmediately) {
       start_time = dispatch_time(DISPATCH_WALLTIME_NOW, 0);
     } else {
-      start_time = dispatch_time(DISPATCH_WALLTIME_NOW, interval_seconds_ * NSEC_PER_SEC);
+      start_time = NextDeadlineSerialized();
     }
 
+    uint64_t leeway_ns = LeewayNSSerialized();
     if (reschedule_mode_ == RescheduleMode::kTrailingEdge) {
       // For trailing edge scheduling, set up a one-time timer
-      dispatch_source_set_timer(timer_source_, start_time, DISPATCH_TIME_FOREVER, 0);
+      dispatch_source_set_timer(timer_source_, start_time, DISPATCH_TIME_FOREVER, leeway_ns);
     } else {
       // For leading edge scheduling, set up repeating timer
-      dispatch_source_set_timer(timer_source_, start_time, interval_seconds_ * NSEC_PER_SEC, 0);
+      dispatch_source_set_timer(timer_source_, start_time, interval_seconds_ * NSEC_PER_SEC,
+                                leeway_ns);
     }
   }
 
@@ -297,6 +344,7 @@ class Timer : public std::enable_shared_from_this<Timer<T>> {
   OnStart startup_option_;
   std::string backing_config_var_;
   RescheduleMode reschedule_mode_;
+  Leeway leeway_;
   char queue_key_;
 };
 
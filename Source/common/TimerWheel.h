@@ -0,0 +1,263 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_TIMERWHEEL_H
+#define SANTA_COMMON_TIMERWHEEL_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace santa {
+
+/// A hierarchical timer wheel tracking values that expire at a given tick.
+///
+/// Scheduling and cancelling are O(1). Time only moves forward through
+/// Advance(), which returns everything that expired along the way. Ticks are
+/// in whatever unit the caller chooses, e.g. milliseconds of mach time.
+///
+/// Each of the four levels has 64 slots, with a slot on one level spanning all
+/// 64 slots of the level below it. A timer is placed on the lowest level that
+/// can hold its expiry and moved down as time approaches it, so Advance() does
+/// a bounded amount of work per expired timer and skips over empty stretches
+/// of time using per-level occupancy bitmaps. Timers further out than the top
+/// level can represent (2^24 ticks) wait in an overflow list.
+///
+/// This class is not thread safe.
+template <typename T>
+class TimerWheel {
+ public:
+  using Id = uint64_t;
+
+  explicit TimerWheel(uint64_t now) : now_(now) {
+    for (auto& level : heads_) {
+      level.fill(kNil);
+    }
+  }
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /// Schedule value to expire at the given tick. Expiries that are not after
+  /// the current tick are returned by the next call to Advance() that moves
+  /// time forward.
+  Id Schedule(uint64_t expiry, T value) {
+    uint32_t index = AllocateNode();
+    Node& node = nodes_[index];
+    node.expiry = std::max(expiry, now_ + 1);
+    node.value.emplace(std::move(value));
+    Place(index);
+    size_++;
+    return (static_cast<uint64_t>(node.generation) << 32) | index;
+  }
+
+  /// Returns true if the timer was cancelled, or false if it already expired
+  /// or was cancelled before.
+  bool Cancel(Id id) {
+    uint32_t index = static_cast<uint32_t>(id);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+    if (index >= nodes_.size() || nodes_[index].generation != generation ||
+        !nodes_[index].value.has_value()) {
+      return false;
+    }
+
+    Unlink(index);
+    FreeNode(index);
+    size_--;
+    return true;
+  }
+
+  /// Move time forward to now, appending the values of all timers that expire
+  /// at or before it to expired in the order they expire. Timers expiring in
+  /// the same tick are returned in no particular order.
+  void Advance(uint64_t now, std::vector<T>& expired) {
+    while (now_ < now) {
+      std::optional<uint64_t> next = NextEventTick();
+      if (!next.has_value() || *next > now) {
+        now_ = now;
+        break;
+      }
+      now_ = *next;
+
+      // Higher levels first, so their timers can be moved down through the
+      // levels below them within the same tick.
+      if ((now_ & kLevelMask[kLevels]) == 0) {
+        Cascade(kLevels, 0, expired);
+      }
+      for (size_t level = kLevels - 1; level >= 1; level--) {
+        if ((now_ & kLevelMask[level]) == 0) {
+          Cascade(level, SlotFor(now_, level), expired);
+        }
+      }
+      Cascade(0, SlotFor(now_, 0), expired);
+    }
+  }
+
+  /// The next tick at which Advance() has work to do, which is no later than
+  /// the earliest expiry, or std::nullopt if there are no timers. Advancing
+  /// to it may only move timers between levels without any expiring.
+  std::optional<uint64_t> NextEventTick() const {
+    for (size_t level = 0; level < kLevels; level++) {
+      uint64_t cur = SlotFor(now_, level);
+      // Timers on a level are always in slots after the current one.
+      uint64_t later = cur == kSlots - 1 ? 0 : occupied_[level] & (~0ULL << (cur + 1));
+      if (later) {
+        uint64_t block_start = now_ & ~kLevelMask[level + 1];
+        return block_start +
+               (static_cast<uint64_t>(std::countr_zero(later)) << (kBits * level));
+      }
+    }
+    if (heads_[kLevels][0] != kNil) {
+      return (now_ & ~kLevelMask[kLevels]) + kLevelMask[kLevels] + 1;
+    }
+    return std::nullopt;
+  }
+
+  uint64_t Now() const { return now_; }
+  size_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+
+ private:
+  static constexpr size_t kBits = 6;
+  static constexpr size_t kSlots = 1 << kBits;
+  static constexpr size_t kLevels = 4;
+  static constexpr uint32_t kNil = UINT32_MAX;
+
+  // kLevelMask[l] covers the ticks within one slot of level l, i.e. the low
+  // kBits * l bits.
+  static constexpr std::array<uint64_t, kLevels + 1> kLevelMask = {
+      0,
+      (1ULL << kBits) - 1,
+      (1ULL << (2 * kBits)) - 1,
+      (1ULL << (3 * kBits)) - 1,
+      (1ULL << (4 * kBits)) - 1,
+  };
+
+  struct Node {
+    uint64_t expiry = 0;
+    std::optional<T> value;
+    uint32_t prev = kNil;
+    uint32_t next = kNil;
+    uint32_t generation = 0;
+    uint8_t level = 0;
+    uint8_t slot = 0;
+  };
+
+  static uint64_t SlotFor(uint64_t tick, size_t level) {
+    return (tick >> (kBits * level)) & (kSlots - 1);
+  }
+
+  // Put a node whose expiry is after now_ on the lowest level where it shares
+  // the current slot of the level above, or in the overflow list.
+  void Place(uint32_t index) {
+    uint64_t expiry = nodes_[index].expiry;
+    for (size_t level = 0; level < kLevels; level++) {
+      if ((expiry & ~kLevelMask[level + 1]) == (now_ & ~kLevelMask[level + 1])) {
+        Link(level, SlotFor(expiry, level), index);
+        return;
+      }
+    }
+    Link(kLevels, 0, index);
+  }
+
+  void Link(size_t level, uint64_t slot, uint32_t index) {
+    Node& node = nodes_[index];
+    uint32_t& head = heads_[level][slot];
+    node.level = static_cast<uint8_t>(level);
+    node.slot = static_cast<uint8_t>(slot);
+    node.prev = kNil;
+    node.next = head;
+    if (head != kNil) {
+      nodes_[head].prev = index;
+    }
+    head = index;
+    if (level < kLevels) {
+      occupied_[level] |= 1ULL << slot;
+    }
+  }
+
+  void Unlink(uint32_t index) {
+    Node& node = nodes_[index];
+    uint32_t& head = heads_[node.level][node.slot];
+    if (node.prev != kNil) {
+      nodes_[node.prev].next = node.next;
+    } else {
+      head = node.next;
+    }
+    if (node.next != kNil) {
+      nodes_[node.next].prev = node.prev;
+    }
+    if (head == kNil && node.level < kLevels) {
+      occupied_[node.level] &= ~(1ULL << node.slot);
+    }
+  }
+
+  // Empty a slot, returning the timers that have expired and placing the rest
+  // on lower levels.
+  void Cascade(size_t level, uint64_t slot, std::vector<T>& expired) {
+    uint32_t index = heads_[level][slot];
+    heads_[level][slot] = kNil;
+    if (level < kLevels) {
+      occupied_[level] &= ~(1ULL << slot);
+    }
+
+    while (index != kNil) {
+      uint32_t next = nodes_[index].next;
+      if (nodes_[index].expiry <= now_) {
+        expired.push_back(std::move(*nodes_[index].value));
+        FreeNode(index);
+        size_--;
+      } else {
+        Place(index);
+      }
+      index = next;
+    }
+  }
+
+  uint32_t AllocateNode() {
+    if (free_ != kNil) {
+      uint32_t index = free_;
+      free_ = nodes_[index].next;
+      return index;
+    }
+    nodes_.emplace_back();
+    return static_cast<uint32_t>(nodes_.size() - 1);
+  }
+
+  void FreeNode(uint32_t index) {
+    Node& node = nodes_[index];
+    node.value.reset();
+    // Invalidates outstanding ids for this node.
+    node.generation++;
+    node.next = free_;
+    free_ = index;
+  }
+
+  uint64_t now_;
+  size_t size_ = 0;
+  std::vector<Node> nodes_;
+  uint32_t free_ = kNil;
+  // One extra level, with a single slot, holds the overflow list.
+  std::array<std::array<uint32_t, kSlots>, kLevels + 1> heads_;
+  std::array<uint64_t, kLevels> occupied_ = {};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_TIMERWHEEL_H
@@ -0,0 +1,177 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/TimerWheel.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <random>
+#include <vector>
+
+using santa::TimerWheel;
+
+@interface TimerWheelTest : XCTestCase
+@end
+
+@implementation TimerWheelTest
+
+- (void)testExpiresInOrder {
+  TimerWheel<int> wheel(1000);
+  XCTAssertTrue(wheel.Empty());
+  XCTAssertFalse(wheel.NextEventTick().has_value());
+
+  // Spread across the first few levels
+  wheel.Schedule(1000 + 5000, 3);
+  wheel.Schedule(1000 + 10, 0);
+  wheel.Schedule(1000 + 300, 2);
+  wheel.Schedule(1000 + 70, 1);
+  XCTAssertEqual(wheel.Size(), 4);
+
+  std::vector<int> expired;
+  wheel.Advance(1009, expired);
+  XCTAssertTrue(expired.empty());
+  XCTAssertEqual(wheel.Now(), 1009);
+
+  wheel.Advance(1300, expired);
+  XCTAssertTrue((expired == std::vector<int>{0, 1, 2}));
+  XCTAssertEqual(wheel.Size(), 1);
+
+  expired.clear();
+  wheel.Advance(1000 + 5000, expired);
+  XCTAssertTrue((expired == std::vector<int>{3}));
+  XCTAssertTrue(wheel.Empty());
+}
+
+- (void)testPastExpiryFiresOnNextTick {
+  TimerWheel<int> wheel(50);
+  wheel.Schedule(10, 1);
+  wheel.Schedule(50, 2);
+  XCTAssertEqual(wheel.NextEventTick().value(), 51);
+
+  std::vector<int> expired;
+  wheel.Advance(50, expired);
+  XCTAssertTrue(expired.empty());
+
+  wheel.Advance(51, expired);
+  std::sort(expired.begin(), expired.end());
+  XCTAssertTrue((expired == std::vector<int>{1, 2}));
+}
+
+- (void)testCancel {
+  TimerWheel<int> wheel(0);
+  TimerWheel<int>::Id a = wheel.Schedule(100, 1);
+  TimerWheel<int>::Id b = wheel.Schedule(100, 2);
+
+  XCTAssertTrue(wheel.Cancel(a));
+  XCTAssertFalse(wheel.Cancel(a));
+  XCTAssertEqual(wheel.Size(), 1);
+
+  std::vector<int> expired;
+  wheel.Advance(100, expired);
+  XCTAssertTrue((expired == std::vector<int>{2}));
+  XCTAssertFalse(wheel.Cancel(b));
+
+  // A reused node must not be cancelled through a stale id
+  TimerWheel<int>::Id c = wheel.Schedule(200, 3);
+  XCTAssertFalse(wheel.Cancel(a));
+  XCTAssertFalse(wheel.Cancel(b));
+  XCTAssertTrue(wheel.Cancel(c));
+  XCTAssertTrue(wheel.Empty());
+}
+
+- (void)testOverflow {
+  // Start just short of a boundary of the top level
+  const uint64_t start = (1ULL << 24) - 3;
+  TimerWheel<int> wheel(start);
+  wheel.Schedule(start + (1ULL << 26), 2);
+  wheel.Schedule(start + 5, 1);
+
+  std::vector<int> expired;
+  wheel.Advance(start + (1ULL << 26) - 1, expired);
+  XCTAssertTrue((expired == std::vector<int>{1}));
+
+  wheel.Advance(start + (1ULL << 26), expired);
+  XCTAssertTrue((expired == std::vector<int>{1, 2}));
+}
+
+- (void)testNextEventTickSkipsEmptyTime {
+  TimerWheel<int> wheel(0);
+  wheel.Schedule(1'000'000, 1);
+
+  // Only a handful of stops are needed to cover a million ticks
+  std::vector<int> expired;
+  int stops = 0;
+  while (std::optional<uint64_t> next = wheel.NextEventTick()) {
+    XCTAssertLessThanOrEqual(*next, 1'000'000);
+    wheel.Advance(*next, expired);
+    stops++;
+  }
+  XCTAssertTrue((expired == std::vector<int>{1}));
+  XCTAssertLessThanOrEqual(stops, 4);
+}
+
+- (void)testMatchesReference {
+  std::mt19937_64 rng(1);
+  TimerWheel<uint64_t> wheel(12345);
+  std::multimap<uint64_t, uint64_t> reference;
+  std::map<uint64_t, TimerWheel<uint64_t>::Id> ids;
+  uint64_t now = 12345;
+
+  for (uint64_t step = 0; step < 20000; step++) {
+    switch (rng() % 3) {
+      case 0: {
+        uint64_t expiry = now + 1 + rng() % (1ULL << (rng() % 27));
+        ids[step] = wheel.Schedule(expiry, step);
+        reference.emplace(expiry, step);
+        break;
+      }
+      case 1: {
+        if (ids.empty()) break;
+        auto it = ids.begin();
+        std::advance(it, rng() % ids.size());
+        auto ref = std::find_if(reference.begin(), reference.end(),
+                                [&](const auto& kv) { return kv.second == it->first; });
+        XCTAssertEqual(wheel.Cancel(it->second), ref != reference.end());
+        if (ref != reference.end()) {
+          reference.erase(ref);
+        }
+        ids.erase(it);
+        break;
+      }
+      default: {
+        now += rng() % (1ULL << (rng() % 25));
+        std::vector<uint64_t> expired;
+        wheel.Advance(now, expired);
+
+        std::vector<uint64_t> want;
+        while (!reference.empty() && reference.begin()->first <= now) {
+          want.push_back(reference.begin()->second);
+          reference.erase(reference.begin());
+        }
+        std::sort(expired.begin(), expired.end());
+        std::sort(want.begin(), want.end());
+        XCTAssertTrue(expired == want);
+        break;
+      }
+    }
+    XCTAssertEqual(wheel.Size(), reference.size());
+  }
+}
+
+@end
@@ -16,9 +16,12 @@
 #define SANTA_COMMON_CEL_ACTIVATION_H
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
+#include <set>
+#include <string>
 #include <type_traits>
 #include <vector>
 
@@ -26,6 +29,7 @@
 #include "Source/common/cel/CELProtoTraits.h"
 #include "Source/common/cel/RelativeTimeFunction.h"
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 
 // CEL headers have warnings and our config turns them into errors.
@@ -40,6 +44,21 @@
 namespace santa {
 namespace cel {
 
+// The activation variables, and the fields of those variables, that a compiled
+// expression reads. Found by walking the checked AST at compile time so that
+// values no expression looks at are never built.
+struct ReferencedFields {
+  std::set<std::string> variables;
+  // target.entitlements is read, or target is used as a whole message.
+  bool targetEntitlements = false;
+
+  ReferencedFields& operator|=(const ReferencedFields& other) {
+    variables.insert(other.variables.begin(), other.variables.end());
+    targetEntitlements |= other.targetEntitlements;
+    return *this;
+  }
+};
+
 // SantaActivation is a CEL activation that provides lookups of values from the
 // ExecutionContext message, and easy access to variables for return values.
 template <bool IsV2>
@@ -65,6 +84,24 @@ class Activation : public ::google::api::expr::runtime::BaseActivation {
         fds_(fds) {};
   ~Activation() = default;
 
+  // Defers filling in target.entitlements until target is first looked up,
+  // since encoding every entitlement is costly and most expressions don't
+  // read them. Only used by CELv2.
+  void SetLazyEntitlements(std::map<std::string, std::string> (^entitlements)()) {
+    entitlements_ = entitlements;
+  }
+
+  // Restricts what is materialized to the fields the expressions about to be
+  // evaluated reference. Without this, everything is materialized on use.
+  // Must be called before evaluation starts.
+  void SetReferencedFields(const ReferencedFields& fields) { referencedFields_ = fields; }
+
+  // Keeps the values built by FindValue in arena and hands them back on later
+  // lookups through the same arena, so evaluating several expressions against
+  // this activation converts each variable (e.g. the args list) only once.
+  // arena must outlive every evaluation that uses this activation.
+  void ShareValuesInArena(google::protobuf::Arena* arena) { sharedValueArena_ = arena; }
+
   std::optional<::google::api::expr::runtime::CelValue> FindValue(
       absl::string_view name, google::protobuf::Arena* arena) const override;
 
@@ -93,6 +130,13 @@ class Activation : public ::google::api::expr::runtime::BaseActivation {
   Memoizer<std::string> path_;
   Memoizer<std::vector<AncestorT>> ancestors_;
   Memoizer<std::vector<FileDescriptorT>> fds_;
+  std::function<std::map<std::string, std::string>()> entitlements_;
+  std::optional<ReferencedFields> referencedFields_;
+  // Whether the lazy parts of target have been filled in. Mutable so it can be
+  // updated from the const evaluation path.
+  mutable bool targetMaterialized_ = false;
+  google::protobuf::Arena* sharedValueArena_ = nullptr;
+  mutable absl::flat_hash_map<std::string, ::google::api::expr::runtime::CelValue> sharedValues_;
 
   // Set during evaluation when a relative-time function (today()) is used, which
   // makes the result non-cacheable. Mutable so it can be updated from the const
@@ -103,6 +147,9 @@ class Activation : public ::google::api::expr::runtime::BaseActivation {
 
   bool IsResultCacheable() const;
 
+  std::optional<::google::api::expr::runtime::CelValue> LookupValue(
+      absl::string_view name, google::protobuf::Arena* arena) const;
+
   static ::cel::Type CELType(google::protobuf::FieldDescriptor::CppType type,
                              const google::protobuf::Descriptor* messageType);
 
@@ -122,6 +122,23 @@ cel_runtime::CelValue Activation<IsV2>::CELValue(const std::map<K, V>& v,
 template <bool IsV2>
 std::optional<cel_runtime::CelValue> Activation<IsV2>::FindValue(
     absl::string_view name, google::protobuf::Arena* arena) const {
+  if (arena == nullptr || arena != sharedValueArena_) {
+    return LookupValue(name, arena);
+  }
+
+  if (auto it = sharedValues_.find(name); it != sharedValues_.end()) {
+    return it->second;
+  }
+  std::optional<cel_runtime::CelValue> value = LookupValue(name, arena);
+  if (value.has_value()) {
+    sharedValues_.emplace(name, *value);
+  }
+  return value;
+}
+
+template <bool IsV2>
+std::optional<cel_runtime::CelValue> Activation<IsV2>::LookupValue(
+    absl::string_view name, google::protobuf::Arena* arena) const {
   // Handle the ReturnValue values.
   auto retDescriptor = Traits::ReturnValue_descriptor();
   auto retValue = retDescriptor->FindValueByName(name);
@@ -148,6 +165,18 @@ std::optional<cel_runtime::CelValue> Activation<IsV2>::FindValue(
 
   // Handle the fields from the CELContext message.
   if (name == "target" && file_ != nullptr) {
+    if constexpr (IsV2) {
+      if (!targetMaterialized_) {
+        targetMaterialized_ = true;
+        if (entitlements_ &&
+            (!referencedFields_.has_value() || referencedFields_->targetEntitlements)) {
+          auto* entitlements = file_->mutable_entitlements();
+          for (auto& [key, value] : entitlements_()) {
+            (*entitlements)[key] = std::move(value);
+          }
+        }
+      }
+    }
     return cel_runtime::CelProtoWrapper::CreateMessage(file_.get(), arena);
   } else if (name == "args") {
     return CELValue(args_(), arena);
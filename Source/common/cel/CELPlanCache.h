@@ -16,6 +16,7 @@
 #define SANTA_COMMON_CEL_CELPLANCACHE_H
 
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "Source/common/SantaCache.h"
@@ -29,6 +30,21 @@
 namespace santa {
 namespace cel {
 
+// The outcome of a cacheable evaluation. An evaluation is only cacheable when
+// the expression read nothing but target, which is derived entirely from the
+// binary, so plans key these by the binary's SHA-256.
+struct CachedCELResult {
+  int value;
+  std::optional<uint64_t> touchIDCooldownMinutes;
+
+  bool operator==(const CachedCELResult&) const = default;
+};
+
+// Bounds the results kept for any one plan.
+static constexpr uint64_t kCELResultCacheMaxSize = 256;
+
+using CELResultCache = SantaCache<std::string, std::optional<CachedCELResult>>;
+
 // A compiled CEL plan bundled with the arena it references. The arena holds
 // constant-folding data the CelExpression points into, so it MUST outlive the
 // expression: arena is declared FIRST so it is destroyed LAST (members destruct
@@ -37,11 +53,19 @@ namespace cel {
 struct CompiledCELPlan {
   std::unique_ptr<google::protobuf::Arena> arena;
   std::unique_ptr<::google::api::expr::runtime::CelExpression> expression;
+  // What the expression reads, so the activation can skip building the rest.
+  ReferencedFields referencedFields;
+  // Results of cacheable evaluations of this plan. Mutable as the plan is
+  // otherwise immutable and shared; SantaCache does its own locking. The
+  // results go away with the plan, and a changed rule expression compiles to
+  // a different plan, so they never outlive the rule they came from.
+  mutable CELResultCache results{kCELResultCacheMaxSize};
 
   CompiledCELPlan(
       std::unique_ptr<google::protobuf::Arena> a,
-      std::unique_ptr<::google::api::expr::runtime::CelExpression> e)
-      : arena(std::move(a)), expression(std::move(e)) {}
+      std::unique_ptr<::google::api::expr::runtime::CelExpression> e,
+      ReferencedFields f)
+      : arena(std::move(a)), expression(std::move(e)), referencedFields(std::move(f)) {}
 };
 
 // The cache value type is the WHOLE bundle, never a bare
@@ -52,17 +76,21 @@ struct CompiledCELPlan {
 using PlanPtr = std::shared_ptr<const CompiledCELPlan>;
 
 // Caches compiled CEL plans for ONE evaluator, keyed by expression text.
-// Lazy: compiles on first miss, reuses thereafter. Bounded: SantaCache drains
-// all entries when full (LRU is planned separately). No invalidation is needed
-// or wired — a plan is a pure function of (text, evaluator) and the evaluator
-// is fixed for the process lifetime, so a cached plan is never stale.
+// Compiles on first miss, reuses thereafter; plans can also be compiled ahead
+// of time (see SNTPolicyProcessor's precompileCELRules). Bounded: when full,
+// SantaCache's clock policy evicts plans that haven't been used recently, so
+// a rule set slightly larger than the cap doesn't recompile every plan. No
+// invalidation is needed or wired — a plan is a pure function of (text,
+// evaluator) and the evaluator is fixed for the process lifetime, so a cached
+// plan is never stale.
 template <bool IsV2>
 class CELPlanCache {
  public:
   // evaluator must outlive this cache (owned by the caller, e.g.
-  // SNTPolicyProcessor). maxSize is the entry cap (see kCELPlanCacheMaxSize).
+  // SNTPolicyProcessor). maxSize is the entry cap (see kCELPlanCacheMinSize).
   CELPlanCache(Evaluator<IsV2>* evaluator, uint64_t maxSize)
-      : evaluator_(evaluator), cache_(maxSize) {}
+      : evaluator_(evaluator),
+        cache_(maxSize, /*per_bucket=*/5, SantaCacheEvictionPolicy::kClock) {}
 
   CELPlanCache(const CELPlanCache&) = delete;
   CELPlanCache& operator=(const CELPlanCache&) = delete;
@@ -80,17 +108,22 @@ class CELPlanCache {
       return hit;
     }
     auto arena = std::make_unique<google::protobuf::Arena>();
+    ReferencedFields fields;
     absl::StatusOr<std::unique_ptr<::google::api::expr::runtime::CelExpression>>
-        compiled = evaluator_->Compile(expr, arena.get());
+        compiled = evaluator_->Compile(expr, arena.get(), &fields);
     if (!compiled.ok()) {
       return compiled.status();
     }
     PlanPtr plan = std::make_shared<const CompiledCELPlan>(
-        std::move(arena), std::move(compiled).value());
+        std::move(arena), std::move(compiled).value(), std::move(fields));
     cache_.set(expr, plan);
     return plan;
   }
 
+  // Changes the entry cap, e.g. to fit the current number of CEL rules.
+  // Shrinking evicts plans that haven't been used recently until it fits.
+  void SetMaxSize(uint64_t maxSize) { cache_.set_max_size(maxSize); }
+
   void Clear() { cache_.clear(); }
   uint64_t Size() const { return cache_.count(); }
 
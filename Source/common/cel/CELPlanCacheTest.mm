@@ -131,8 +131,8 @@ std::unique_ptr<santa::cel::Activation<true>> MakeActivationWithTeamID(const std
   XCTAssertTrue(result.ok());
 }
 
-// Exceeding the cap drains the cache (SantaCache drains all on overflow), so
-// Size never exceeds the cap.
+// Exceeding the cap evicts plans that haven't been used recently, so Size
+// never exceeds the cap.
 - (void)testDrainWhenFull {
   CELPlanCache<true> cache(_ev.get(), /*maxSize=*/4);
   for (int i = 0; i < 20; i++) {
@@ -143,6 +143,32 @@ std::unique_ptr<santa::cel::Activation<true>> MakeActivationWithTeamID(const std
   }
 }
 
+// Shrinking the cap evicts down to it, and plans already handed out stay
+// usable. Growing it lets more plans stay cached.
+- (void)testSetMaxSize {
+  CELPlanCache<true> cache(_ev.get(), /*maxSize=*/64);
+  auto held = cache.GetOrCompile("target.team_id == 'HELD'");
+  XCTAssertTrue(held.ok());
+  for (int i = 0; i < 31; i++) {
+    XCTAssertTrue(cache.GetOrCompile("target.team_id == 'ID" + std::to_string(i) + "'").ok());
+  }
+  XCTAssertEqual(cache.Size(), (uint64_t)32);
+
+  cache.SetMaxSize(8);
+  XCTAssertLessThanOrEqual(cache.Size(), (uint64_t)8);
+
+  auto act = MakeActivationWithTeamID("HELD");
+  google::protobuf::Arena evalArena;
+  auto result = _ev->Evaluate((*held)->expression.get(), *act, &evalArena);
+  XCTAssertTrue(result.ok());
+
+  cache.SetMaxSize(128);
+  for (int i = 0; i < 100; i++) {
+    XCTAssertTrue(cache.GetOrCompile("target.team_id == 'ID" + std::to_string(i) + "'").ok());
+  }
+  XCTAssertGreaterThanOrEqual(cache.Size(), (uint64_t)100);
+}
+
 // Concurrent GetOrCompile over a small shared set of expressions from many
 // threads: exercises concurrent reads, the benign compile-on-miss race, and
 // concurrent eviction. The cap (8) is kept below the 10-distinct-key working
@@ -172,4 +198,95 @@ std::unique_ptr<santa::cel::Activation<true>> MakeActivationWithTeamID(const std
   XCTAssertEqual(failures.load(), 0);
 }
 
+// The plan records which activation variables the expression reads, and only
+// sets targetEntitlements when the entitlements (or the whole target) are used.
+- (void)testPlanRecordsReferencedFields {
+  CELPlanCache<true> cache(_ev.get(), 128);
+
+  auto teamID = cache.GetOrCompile("target.team_id == 'EQHXZ8M8AV' ? ALLOWLIST : BLOCKLIST");
+  XCTAssertTrue(teamID.ok());
+  const santa::cel::ReferencedFields& teamIDFields = (*teamID)->referencedFields;
+  XCTAssertEqual(teamIDFields.variables.count("target"), 1);
+  XCTAssertEqual(teamIDFields.variables.count("args"), 0);
+  XCTAssertFalse(teamIDFields.targetEntitlements);
+
+  auto ents = cache.GetOrCompile(
+      "args.exists(a, a == '--foo') && 'com.apple.security.get-task-allow' in "
+      "target.entitlements ? BLOCKLIST : ALLOWLIST");
+  XCTAssertTrue(ents.ok());
+  const santa::cel::ReferencedFields& entsFields = (*ents)->referencedFields;
+  XCTAssertEqual(entsFields.variables.count("args"), 1);
+  XCTAssertEqual(entsFields.variables.count("envs"), 0);
+  XCTAssertTrue(entsFields.targetEntitlements);
+
+  santa::cel::ReferencedFields combined = teamIDFields;
+  combined |= entsFields;
+  XCTAssertEqual(combined.variables.count("args"), 1);
+  XCTAssertTrue(combined.targetEntitlements);
+}
+
+// Lazy entitlements are only built when a referenced plan needs them.
+- (void)testLazyEntitlementsSkippedWhenUnreferenced {
+  CELPlanCache<true> cache(_ev.get(), 128);
+  auto plan = cache.GetOrCompile("'a' in target.entitlements ? BLOCKLIST : ALLOWLIST");
+  XCTAssertTrue(plan.ok());
+  auto unrelated = cache.GetOrCompile("target.team_id == 'T' ? BLOCKLIST : ALLOWLIST");
+  XCTAssertTrue(unrelated.ok());
+
+  __block int calls = 0;
+  auto entitlements = ^std::map<std::string, std::string>() {
+    calls++;
+    return {{"a", "true"}};
+  };
+
+  auto act = MakeActivationWithTeamID("T");
+  act->SetLazyEntitlements(entitlements);
+  act->SetReferencedFields((*unrelated)->referencedFields);
+  google::protobuf::Arena evalArena;
+  auto result = _ev->Evaluate((*unrelated)->expression.get(), *act, &evalArena);
+  XCTAssertTrue(result.ok());
+  XCTAssertEqual(result->value, santa::cel::CELProtoTraits<true>::ReturnValue::BLOCKLIST);
+  XCTAssertEqual(calls, 0);
+
+  act = MakeActivationWithTeamID("T");
+  act->SetLazyEntitlements(entitlements);
+  act->SetReferencedFields((*plan)->referencedFields);
+  result = _ev->Evaluate((*plan)->expression.get(), *act, &evalArena);
+  XCTAssertTrue(result.ok());
+  XCTAssertEqual(result->value, santa::cel::CELProtoTraits<true>::ReturnValue::BLOCKLIST);
+  XCTAssertEqual(calls, 1);
+}
+
+// With a shared arena, each variable is converted once and reused by every
+// expression evaluated against the activation.
+- (void)testSharedValuesReusedAcrossEvaluations {
+  auto act = MakeActivationWithTeamID("T");
+  google::protobuf::Arena arena;
+
+  auto first = act->FindValue("args", &arena);
+  auto second = act->FindValue("args", &arena);
+  XCTAssertTrue(first.has_value() && second.has_value());
+  XCTAssertNotEqual(first->ListOrDie(), second->ListOrDie());
+
+  act->ShareValuesInArena(&arena);
+  first = act->FindValue("args", &arena);
+  second = act->FindValue("args", &arena);
+  XCTAssertTrue(first.has_value() && second.has_value());
+  XCTAssertEqual(first->ListOrDie(), second->ListOrDie());
+
+  // Lookups through any other arena are not shared.
+  google::protobuf::Arena other;
+  auto third = act->FindValue("args", &other);
+  XCTAssertTrue(third.has_value());
+  XCTAssertNotEqual(first->ListOrDie(), third->ListOrDie());
+
+  auto plan = _ev->Compile("target.team_id == 'T' ? BLOCKLIST : ALLOWLIST", &arena);
+  XCTAssertTrue(plan.ok());
+  for (int i = 0; i < 3; i++) {
+    auto result = _ev->Evaluate(plan->get(), *act, &arena);
+    XCTAssertTrue(result.ok());
+    XCTAssertEqual(result->value, santa::cel::CELProtoTraits<true>::ReturnValue::BLOCKLIST);
+  }
+}
+
 @end
@@ -81,9 +81,11 @@ class Evaluator {
 
   // Compile a CEL expression from a string into an expression plan
   // ready for evaluation. The caller-provided arena is used for constant
-  // folding and must outlive the returned expression plan.
+  // folding and must outlive the returned expression plan. If referencedFields
+  // is non-null it is set to the activation fields the expression reads.
   absl::StatusOr<std::unique_ptr<::google::api::expr::runtime::CelExpression>>
-  Compile(absl::string_view cel_expr, google::protobuf::Arena* arena);
+  Compile(absl::string_view cel_expr, google::protobuf::Arena* arena,
+          ReferencedFields* referencedFields = nullptr);
 
   // Evaluate an expression plan with a SantaActivation object. The
   // caller-provided arena is used for evaluation temporaries.
@@ -14,6 +14,9 @@
 
 #include "Source/common/cel/Evaluator.h"
 
+#include <string>
+#include <vector>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "cel/expr/checked.pb.h"
@@ -107,9 +110,76 @@ absl::StatusOr<std::unique_ptr<Evaluator<IsV2>>> Evaluator<IsV2>::Create(bool al
   return std::make_unique<Evaluator<IsV2>>(std::move(*compiler), std::move(arena));
 }
 
+// Walks the checked AST collecting the activation variables it reads.
+// Comprehension variables that shadow an activation variable are counted as
+// the activation variable, which only makes the result more conservative.
+static ReferencedFields FindReferencedFields(const ::cel::expr::CheckedExpr& checked) {
+  ReferencedFields fields;
+  std::vector<const ::cel::expr::Expr*> pending = {&checked.expr()};
+  while (!pending.empty()) {
+    const ::cel::expr::Expr* e = pending.back();
+    pending.pop_back();
+
+    switch (e->expr_kind_case()) {
+      case ::cel::expr::Expr::kIdentExpr:
+        fields.variables.insert(e->ident_expr().name());
+        // Anything other than a field selection may read the whole message.
+        if (e->ident_expr().name() == "target") {
+          fields.targetEntitlements = true;
+        }
+        break;
+      case ::cel::expr::Expr::kSelectExpr: {
+        const ::cel::expr::Expr_Select& select = e->select_expr();
+        if (select.operand().has_ident_expr()) {
+          const std::string& name = select.operand().ident_expr().name();
+          fields.variables.insert(name);
+          if (name == "target" && select.field() == "entitlements") {
+            fields.targetEntitlements = true;
+          }
+        } else {
+          pending.push_back(&select.operand());
+        }
+        break;
+      }
+      case ::cel::expr::Expr::kCallExpr:
+        if (e->call_expr().has_target()) {
+          pending.push_back(&e->call_expr().target());
+        }
+        for (const auto& arg : e->call_expr().args()) {
+          pending.push_back(&arg);
+        }
+        break;
+      case ::cel::expr::Expr::kListExpr:
+        for (const auto& element : e->list_expr().elements()) {
+          pending.push_back(&element);
+        }
+        break;
+      case ::cel::expr::Expr::kStructExpr:
+        for (const auto& entry : e->struct_expr().entries()) {
+          if (entry.has_map_key()) {
+            pending.push_back(&entry.map_key());
+          }
+          pending.push_back(&entry.value());
+        }
+        break;
+      case ::cel::expr::Expr::kComprehensionExpr: {
+        const ::cel::expr::Expr_Comprehension& c = e->comprehension_expr();
+        pending.push_back(&c.iter_range());
+        pending.push_back(&c.accu_init());
+        pending.push_back(&c.loop_condition());
+        pending.push_back(&c.loop_step());
+        pending.push_back(&c.result());
+        break;
+      }
+      default: break;
+    }
+  }
+  return fields;
+}
+
 template <bool IsV2>
 absl::StatusOr<std::unique_ptr<::cel_runtime::CelExpression>> Evaluator<IsV2>::Compile(
-    absl::string_view expr, google::protobuf::Arena* arena) {
+    absl::string_view expr, google::protobuf::Arena* arena, ReferencedFields* referencedFields) {
   if (!compiler_) {
     return absl::InvalidArgumentError("Evaluator not properly initialized");
   }
@@ -129,6 +199,10 @@ absl::StatusOr<std::unique_ptr<::cel_runtime::CelExpression>> Evaluator<IsV2>::C
     return status;
   }
 
+  if (referencedFields) {
+    *referencedFields = FindReferencedFields(cel_expr);
+  }
+
   // Setup a default environment for building expressions.
   cel_runtime::InterpreterOptions options;
   options.constant_folding = true;
@@ -0,0 +1,110 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_ES_BATCHEDDISPATCHER_H
+#define SANTA_COMMON_ES_BATCHEDDISPATCHER_H
+
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "Source/common/MPSCRingBuffer.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Runs work from any number of queues on a fixed pool of workers.
+//
+// Each queue is a bounded lock-free ring, so handing off work only costs a
+// push, plus waking a worker if one is idle. Workers take one item from each
+// non-empty queue in turn, so a busy queue can't starve the others, and keep
+// going until every queue is empty. Work from the same queue may run
+// concurrently on different workers.
+//
+// Queues stay registered for the lifetime of the dispatcher.
+class BatchedDispatcher {
+ public:
+  using Work = absl::AnyInvocable<void()>;
+
+  class Queue {
+   public:
+    explicit Queue(size_t capacity) : ring_(capacity) {}
+
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+
+    size_t Size() const { return ring_.Size(); }
+
+   private:
+    friend class BatchedDispatcher;
+
+    // The ring only supports one consumer at a time, which workers take turns
+    // being. Returns std::nullopt if the ring is empty or another worker is
+    // currently dequeuing.
+    std::optional<Work> TryDequeue() {
+      if (consuming_.exchange(true, std::memory_order_acquire)) {
+        return std::nullopt;
+      }
+      std::optional<Work> work = ring_.Dequeue();
+      consuming_.store(false, std::memory_order_release);
+      return work;
+    }
+
+    MPSCRingBuffer<Work> ring_;
+    std::atomic<bool> consuming_{false};
+  };
+
+  BatchedDispatcher(const char* label, dispatch_qos_class_t qos, size_t num_workers);
+
+  BatchedDispatcher(const BatchedDispatcher&) = delete;
+  BatchedDispatcher& operator=(const BatchedDispatcher&) = delete;
+
+  // Create a queue holding up to capacity pending items, rounded up to a
+  // power of two.
+  std::shared_ptr<Queue> CreateQueue(size_t capacity);
+
+  // Adds work to the queue and returns true, or returns false without
+  // modifying work if the queue is full.
+  bool Dispatch(Queue& queue, Work&& work);
+
+  size_t NumWorkers() const { return workers_.size(); }
+
+ private:
+  struct Worker {
+    dispatch_queue_t q;
+    std::atomic<bool> scheduled{false};
+  };
+
+  void WakeWorker();
+  void Run(Worker& worker);
+  void DrainQueues();
+  bool AnyPending() const;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_worker_{0};
+
+  absl::Mutex queues_mtx_;
+  // Published snapshot of the registered queues. Replaced wholesale under
+  // queues_mtx_ so workers can walk it without locking.
+  std::shared_ptr<const std::vector<std::shared_ptr<Queue>>> queues_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_ES_BATCHEDDISPATCHER_H
@@ -0,0 +1,115 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/es/BatchedDispatcher.h"
+
+#import <Foundation/Foundation.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace santa {
+
+BatchedDispatcher::BatchedDispatcher(const char* label, dispatch_qos_class_t qos,
+                                     size_t num_workers)
+    : queues_(std::make_shared<const std::vector<std::shared_ptr<Queue>>>()) {
+  dispatch_queue_attr_t attr =
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, qos, 0);
+  for (size_t i = 0; i < std::max<size_t>(num_workers, 1); i++) {
+    auto worker = std::make_unique<Worker>();
+    worker->q = dispatch_queue_create(label, attr);
+    workers_.push_back(std::move(worker));
+  }
+}
+
+std::shared_ptr<BatchedDispatcher::Queue> BatchedDispatcher::CreateQueue(size_t capacity) {
+  auto queue = std::make_shared<Queue>(capacity);
+
+  absl::MutexLock lock(queues_mtx_);
+  auto queues = std::make_shared<std::vector<std::shared_ptr<Queue>>>(
+      *std::atomic_load_explicit(&queues_, std::memory_order_relaxed));
+  queues->push_back(queue);
+  std::shared_ptr<const std::vector<std::shared_ptr<Queue>>> published = std::move(queues);
+  std::atomic_store_explicit(&queues_, std::move(published), std::memory_order_release);
+  return queue;
+}
+
+bool BatchedDispatcher::Dispatch(Queue& queue, Work&& work) {
+  if (!queue.ring_.Enqueue(std::move(work))) {
+    return false;
+  }
+
+  WakeWorker();
+  return true;
+}
+
+void BatchedDispatcher::WakeWorker() {
+  // Pairs with the fence in Run, so that either an idle worker is seen here or
+  // the worker going idle sees the new work.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // Start from a different worker each time to spread wakeups around. If
+  // every worker is already scheduled, each drains all queues again before
+  // going idle, so the new work is picked up without waking anyone.
+  size_t start = next_worker_.fetch_add(1, std::memory_order_relaxed);
+  for (size_t i = 0; i < workers_.size(); i++) {
+    Worker& worker = *workers_[(start + i) % workers_.size()];
+    if (worker.scheduled.load(std::memory_order_relaxed) || worker.scheduled.exchange(true)) {
+      continue;
+    }
+
+    Worker* w = &worker;
+    dispatch_async(worker.q, ^{
+      Run(*w);
+    });
+    return;
+  }
+}
+
+void BatchedDispatcher::Run(Worker& worker) {
+  for (;;) {
+    DrainQueues();
+    worker.scheduled.store(false);
+    // Work may have been added after the queues were seen empty but before the
+    // flag was cleared, in which case the producer may not have woken anyone.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!AnyPending() || worker.scheduled.exchange(true)) {
+      return;
+    }
+  }
+}
+
+void BatchedDispatcher::DrainQueues() {
+  auto queues = std::atomic_load_explicit(&queues_, std::memory_order_acquire);
+  bool ran;
+  do {
+    ran = false;
+    for (const auto& queue : *queues) {
+      if (std::optional<Work> work = queue->TryDequeue()) {
+        @autoreleasepool {
+          (*work)();
+        }
+        ran = true;
+      }
+    }
+  } while (ran);
+}
+
+bool BatchedDispatcher::AnyPending() const {
+  auto queues = std::atomic_load_explicit(&queues_, std::memory_order_acquire);
+  return std::any_of(queues->begin(), queues->end(),
+                     [](const auto& queue) { return queue->Size() > 0; });
+}
+
+}  // namespace santa
@@ -0,0 +1,138 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/es/BatchedDispatcher.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using santa::BatchedDispatcher;
+
+@interface BatchedDispatcherTest : XCTestCase
+@end
+
+@implementation BatchedDispatcherTest
+
+- (void)testRunsAllWork {
+  BatchedDispatcher dispatcher("test", QOS_CLASS_UTILITY, 4);
+  XCTAssertEqual(dispatcher.NumWorkers(), 4);
+
+  std::vector<std::shared_ptr<BatchedDispatcher::Queue>> queues;
+  for (int i = 0; i < 3; i++) {
+    queues.push_back(dispatcher.CreateQueue(64));
+  }
+
+  const int kItemsPerQueue = 1000;
+  auto count = std::make_shared<std::atomic<int>>(0);
+  dispatch_group_t group = dispatch_group_create();
+  BatchedDispatcher* d = &dispatcher;
+
+  // Each queue is fed from its own thread, like an ES client handler queue
+  dispatch_apply(queues.size(), dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t i) {
+    for (int j = 0; j < kItemsPerQueue; j++) {
+      dispatch_group_enter(group);
+      BatchedDispatcher::Work work = [count, group] {
+        count->fetch_add(1);
+        dispatch_group_leave(group);
+      };
+      while (!d->Dispatch(*queues[i], std::move(work))) {
+        // The queue is full, let the workers catch up
+        usleep(100);
+      }
+    }
+  });
+
+  XCTAssertEqual(
+      dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+  XCTAssertEqual(count->load(), 3 * kItemsPerQueue);
+}
+
+- (void)testFullQueueReturnsWork {
+  BatchedDispatcher dispatcher("test", QOS_CLASS_UTILITY, 1);
+  auto queue = dispatcher.CreateQueue(2);
+
+  dispatch_semaphore_t started = dispatch_semaphore_create(0);
+  dispatch_semaphore_t unblock = dispatch_semaphore_create(0);
+  dispatch_group_t group = dispatch_group_create();
+
+  // Occupy the only worker
+  dispatch_group_enter(group);
+  XCTAssertTrue(dispatcher.Dispatch(*queue, [started, unblock, group] {
+    dispatch_semaphore_signal(started);
+    dispatch_semaphore_wait(unblock, DISPATCH_TIME_FOREVER);
+    dispatch_group_leave(group);
+  }));
+  XCTAssertEqual(
+      dispatch_semaphore_wait(started, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+
+  for (int i = 0; i < 2; i++) {
+    dispatch_group_enter(group);
+    XCTAssertTrue(dispatcher.Dispatch(*queue, [group] {
+      dispatch_group_leave(group);
+    }));
+  }
+  XCTAssertEqual(queue->Size(), 2);
+
+  bool ran = false;
+  BatchedDispatcher::Work overflow = [&ran] {
+    ran = true;
+  };
+  XCTAssertFalse(dispatcher.Dispatch(*queue, std::move(overflow)));
+
+  // The rejected work is left with the caller
+  overflow();
+  XCTAssertTrue(ran);
+
+  dispatch_semaphore_signal(unblock);
+  XCTAssertEqual(
+      dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+}
+
+- (void)testQueueWorkRunsConcurrently {
+  BatchedDispatcher dispatcher("test", QOS_CLASS_UTILITY, 2);
+  auto queue = dispatcher.CreateQueue(8);
+
+  // Each item waits for the other to start, which only succeeds if both run
+  // on different workers at the same time.
+  dispatch_semaphore_t first = dispatch_semaphore_create(0);
+  dispatch_semaphore_t second = dispatch_semaphore_create(0);
+  auto succeeded = std::make_shared<std::atomic<int>>(0);
+  dispatch_group_t group = dispatch_group_create();
+
+  auto rendezvous = [&](dispatch_semaphore_t mine, dispatch_semaphore_t theirs) {
+    dispatch_group_enter(group);
+    XCTAssertTrue(dispatcher.Dispatch(*queue, [mine, theirs, succeeded, group] {
+      dispatch_semaphore_signal(mine);
+      if (dispatch_semaphore_wait(theirs, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)) ==
+          0) {
+        succeeded->fetch_add(1);
+      }
+      dispatch_group_leave(group);
+    }));
+  };
+  rendezvous(first, second);
+  rendezvous(second, first);
+
+  XCTAssertEqual(
+      dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+  XCTAssertEqual(succeeded->load(), 2);
+}
+
+@end
@@ -0,0 +1,78 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_ES_DEADLINETIMER_H
+#define SANTA_COMMON_ES_DEADLINETIMER_H
+
+#include <dispatch/dispatch.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Source/common/TimerWheel.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Runs callbacks once their mach_time deadlines pass, using a single dispatch
+// timer for all of them instead of a dispatch_after per callback.
+//
+// Deadlines are kept in a timer wheel with millisecond ticks, so scheduling
+// and cancelling are constant time however many are pending. Callbacks are
+// run up to a millisecond late, and run one at a time on the timer's serial
+// queue, so they should be brief. A callback is either run or cancelled, never
+// both.
+class DeadlineTimer {
+ public:
+  using Callback = absl::AnyInvocable<void()>;
+  using Handle = TimerWheel<Callback>::Id;
+
+  explicit DeadlineTimer(dispatch_qos_class_t qos);
+
+  // Cancels the timer and waits for any running callback to finish. Pending
+  // callbacks are destroyed without running. Must not be called from a
+  // callback.
+  ~DeadlineTimer();
+
+  DeadlineTimer(const DeadlineTimer&) = delete;
+  DeadlineTimer& operator=(const DeadlineTimer&) = delete;
+
+  // Schedule the callback to run as soon as possible after deadline, which is
+  // in mach_absolute_time units.
+  Handle Schedule(uint64_t deadline, Callback callback);
+
+  // Returns true if the callback was cancelled before it started running, or
+  // false if it has already run or is running.
+  bool Cancel(Handle handle);
+
+  size_t Pending() const;
+
+ private:
+  void ArmLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mtx_);
+  void Fire();
+
+  dispatch_queue_t q_;
+  dispatch_source_t timer_source_;
+
+  mutable absl::Mutex mtx_;
+  TimerWheel<Callback> wheel_ ABSL_GUARDED_BY(mtx_);
+  // Tick the timer source is currently set for, or UINT64_MAX if unset.
+  uint64_t armed_tick_ ABSL_GUARDED_BY(mtx_) = UINT64_MAX;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_ES_DEADLINETIMER_H
@@ -0,0 +1,117 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/es/DeadlineTimer.h"
+
+#include <mach/mach_time.h>
+
+#include <optional>
+#include <vector>
+
+#include "Source/common/SystemResources.h"
+
+namespace santa {
+
+// Deadline callbacks answer ES messages before the kernel gives up on them, so
+// they may only be a little late.
+static constexpr uint64_t kTimerLeewayNs = 1 * NSEC_PER_MSEC;
+
+// Resolution of the timer wheel.
+static constexpr uint64_t kTickNs = 1 * NSEC_PER_MSEC;
+
+// Ticks are rounded down for the current time and up for deadlines, so a
+// callback never runs before its deadline.
+static uint64_t CurrentTick() {
+  return MachTimeToNanos(mach_absolute_time()) / kTickNs;
+}
+
+static uint64_t DeadlineTick(uint64_t deadline) {
+  return (MachTimeToNanos(deadline) + kTickNs - 1) / kTickNs;
+}
+
+DeadlineTimer::DeadlineTimer(dispatch_qos_class_t qos) : wheel_(CurrentTick()) {
+  q_ = dispatch_queue_create(
+      "com.northpolesec.santa.daemon.deadline_timer",
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL, qos, 0));
+  timer_source_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q_);
+  dispatch_source_set_timer(timer_source_, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER,
+                            kTimerLeewayNs);
+  dispatch_source_set_event_handler(timer_source_, ^{
+    Fire();
+  });
+  dispatch_resume(timer_source_);
+}
+
+DeadlineTimer::~DeadlineTimer() {
+  dispatch_source_cancel(timer_source_);
+  // Cancellation doesn't interrupt a running event handler, wait for it.
+  dispatch_sync(q_, ^{
+                });
+}
+
+DeadlineTimer::Handle DeadlineTimer::Schedule(uint64_t deadline, Callback callback) {
+  absl::MutexLock lock(mtx_);
+  Handle handle = wheel_.Schedule(DeadlineTick(deadline), std::move(callback));
+  ArmLocked();
+  return handle;
+}
+
+bool DeadlineTimer::Cancel(Handle handle) {
+  absl::MutexLock lock(mtx_);
+  // The timer isn't re-armed for a later deadline here. If this was the first
+  // callback, the timer fires early once and re-arms itself then.
+  return wheel_.Cancel(handle);
+}
+
+size_t DeadlineTimer::Pending() const {
+  absl::ReaderMutexLock lock(mtx_);
+  return wheel_.Size();
+}
+
+void DeadlineTimer::ArmLocked() {
+  // This may be earlier than the first deadline when the wheel has to move
+  // timers closer to expiring first, which costs an extra wakeup on the way to
+  // deadlines more than 64 ticks out.
+  std::optional<uint64_t> tick = wheel_.NextEventTick();
+  if (!tick.has_value() || *tick >= armed_tick_) {
+    return;
+  }
+
+  uint64_t now = MachTimeToNanos(mach_absolute_time());
+  uint64_t target = *tick * kTickNs;
+  int64_t ns = target > now ? (int64_t)(target - now) : 0;
+  dispatch_source_set_timer(timer_source_, dispatch_time(DISPATCH_TIME_NOW, ns),
+                            DISPATCH_TIME_FOREVER, kTimerLeewayNs);
+  armed_tick_ = *tick;
+}
+
+void DeadlineTimer::Fire() {
+  std::vector<Callback> expired;
+  {
+    absl::MutexLock lock(mtx_);
+    wheel_.Advance(CurrentTick(), expired);
+
+    // The timer is one-shot, so it must be armed again for what remains.
+    armed_tick_ = UINT64_MAX;
+    ArmLocked();
+  }
+
+  for (auto& callback : expired) {
+    @autoreleasepool {
+      callback();
+    }
+  }
+}
+
+}  // namespace santa
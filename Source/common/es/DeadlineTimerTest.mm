@@ -0,0 +1,102 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/es/DeadlineTimer.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+#include <mach/mach_time.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Source/common/SystemResources.h"
+
+using santa::DeadlineTimer;
+
+static uint64_t MachTimeFromNow(uint64_t ns) {
+  return AddNanosecondsToMachTime(ns, mach_absolute_time());
+}
+
+@interface DeadlineTimerTest : XCTestCase
+@end
+
+@implementation DeadlineTimerTest
+
+- (void)testCallbacksRunInDeadlineOrder {
+  DeadlineTimer timer(QOS_CLASS_USER_INTERACTIVE);
+
+  auto order = std::make_shared<std::vector<int>>();
+  auto mtx = std::make_shared<std::mutex>();
+  dispatch_group_t group = dispatch_group_create();
+
+  // Scheduled out of order, and the earliest deadline is added last so the
+  // timer has to be moved earlier.
+  for (int i : {3, 1, 2, 0}) {
+    dispatch_group_enter(group);
+    timer.Schedule(MachTimeFromNow((50 + 50 * i) * NSEC_PER_MSEC), [order, mtx, group, i] {
+      std::lock_guard<std::mutex> lock(*mtx);
+      order->push_back(i);
+      dispatch_group_leave(group);
+    });
+  }
+  XCTAssertEqual(timer.Pending(), 4);
+
+  XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+                 0);
+  XCTAssertEqual(timer.Pending(), 0);
+  XCTAssertTrue((*order == std::vector<int>{0, 1, 2, 3}));
+}
+
+- (void)testCancel {
+  DeadlineTimer timer(QOS_CLASS_USER_INTERACTIVE);
+
+  auto cancelledRan = std::make_shared<bool>(false);
+  DeadlineTimer::Handle cancelled =
+      timer.Schedule(MachTimeFromNow(50 * NSEC_PER_MSEC), [cancelledRan] {
+        *cancelledRan = true;
+      });
+
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  DeadlineTimer::Handle kept = timer.Schedule(MachTimeFromNow(100 * NSEC_PER_MSEC), [sema] {
+    dispatch_semaphore_signal(sema);
+  });
+
+  XCTAssertTrue(timer.Cancel(cancelled));
+  XCTAssertFalse(timer.Cancel(cancelled));
+  XCTAssertEqual(timer.Pending(), 1);
+
+  XCTAssertEqual(dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+                 0);
+  XCTAssertFalse(*cancelledRan);
+
+  // Too late to cancel once the callback has run
+  XCTAssertFalse(timer.Cancel(kept));
+}
+
+- (void)testPastDeadlineRunsPromptly {
+  DeadlineTimer timer(QOS_CLASS_USER_INTERACTIVE);
+
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  timer.Schedule(mach_absolute_time() - 1, [sema] {
+    dispatch_semaphore_signal(sema);
+  });
+
+  XCTAssertEqual(dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 1 * NSEC_PER_SEC)),
+                 0);
+}
+
+@end
@@ -36,6 +36,15 @@ enum class EventDisposition {
   kDropped,
 };
 
+enum class EventLatencyStage {
+  // Time from a message being handed off until its handler starts.
+  kQueued = 0,
+  // Time the handler spends processing a message.
+  kHandler,
+  // Time left before the deadline when an AUTH message is responded to.
+  kDeadlineSlack,
+};
+
 class ESMetricsObserver {
  public:
   virtual ~ESMetricsObserver() = default;
@@ -44,6 +53,10 @@ class ESMetricsObserver {
   virtual void SetEventMetrics(Processor processor,
                                EventDisposition disposition, int64_t nanos,
                                es_event_type_t event_type) = 0;
+  // Called from any thread, so must be cheap and non-blocking.
+  virtual void RecordEventLatency(Processor processor,
+                                  es_event_type_t event_type,
+                                  EventLatencyStage stage, int64_t nanos) = 0;
 };
 
 }  // namespace santa
@@ -35,6 +35,7 @@ class EndpointSecurityAPI : public std::enable_shared_from_this<EndpointSecurity
   virtual Client NewClient(void (^message_handler)(es_client_t*, Message));
 
   virtual bool Subscribe(const Client& client, const std::set<es_event_type_t>&);
+  virtual bool Unsubscribe(const Client& client, const std::set<es_event_type_t>&);
   virtual bool UnsubscribeAll(const Client& client);
 
   virtual bool UnmuteAllPaths(const Client& client);
@@ -51,10 +52,22 @@ class EndpointSecurityAPI : public std::enable_shared_from_this<EndpointSecurity
   virtual bool UnmuteTargetPath(const Client& client, std::string_view path,
                                 santa::WatchItemPathType path_type);
 
+  // Apply a set of target path mutes in one call. Every path is attempted even
+  // if some fail, and the result is false if any of them failed. ES has no
+  // batched mute call, so one is made per path.
+  virtual bool MuteTargetPaths(const Client& client, const santa::SetPairPathAndType& paths);
+  virtual bool MuteTargetPathsEvents(const Client& client, const santa::SetPairPathAndType& paths,
+                                     const std::set<es_event_type_t>& events);
+  virtual bool UnmuteTargetPaths(const Client& client, const santa::SetPairPathAndType& paths);
+
   virtual bool IsProcessMutingInverted(const Client& client);
   virtual bool InvertProcessMuting(const Client& client);
   virtual bool MuteProcess(const Client& client, const audit_token_t* tok);
   virtual bool UnmuteProcess(const Client& client, const audit_token_t* tok);
+  virtual bool MuteProcessEvents(const Client& client, const audit_token_t* tok,
+                                 const std::set<es_event_type_t>& events);
+  virtual bool UnmuteProcessEvents(const Client& client, const audit_token_t* tok,
+                                   const std::set<es_event_type_t>& events);
 
   virtual void RetainMessage(const es_message_t* msg);
   virtual void ReleaseMessage(const es_message_t* msg);
@@ -50,6 +50,12 @@ bool EndpointSecurityAPI::Subscribe(const Client& client,
   return es_subscribe(client.Get(), subs.data(), (uint32_t)subs.size()) == ES_RETURN_SUCCESS;
 }
 
+bool EndpointSecurityAPI::Unsubscribe(const Client& client,
+                                      const std::set<es_event_type_t>& event_types) {
+  std::vector<es_event_type_t> subs(event_types.begin(), event_types.end());
+  return es_unsubscribe(client.Get(), subs.data(), (uint32_t)subs.size()) == ES_RETURN_SUCCESS;
+}
+
 bool EndpointSecurityAPI::UnsubscribeAll(const Client& client) {
   return es_unsubscribe_all(client.Get()) == ES_RETURN_SUCCESS;
 }
@@ -94,6 +100,20 @@ bool EndpointSecurityAPI::UnmuteProcess(const Client& client, const audit_token_
   return es_unmute_process(client.Get(), tok) == ES_RETURN_SUCCESS;
 }
 
+bool EndpointSecurityAPI::MuteProcessEvents(const Client& client, const audit_token_t* tok,
+                                            const std::set<es_event_type_t>& events) {
+  std::vector<es_event_type_t> event_vec(events.begin(), events.end());
+  return es_mute_process_events(client.Get(), tok, event_vec.data(), event_vec.size()) ==
+         ES_RETURN_SUCCESS;
+}
+
+bool EndpointSecurityAPI::UnmuteProcessEvents(const Client& client, const audit_token_t* tok,
+                                              const std::set<es_event_type_t>& events) {
+  std::vector<es_event_type_t> event_vec(events.begin(), events.end());
+  return es_unmute_process_events(client.Get(), tok, event_vec.data(), event_vec.size()) ==
+         ES_RETURN_SUCCESS;
+}
+
 bool EndpointSecurityAPI::MuteTargetPath(const Client& client, std::string_view path,
                                          WatchItemPathType path_type) {
   return es_mute_path(client.Get(), path.data(),
@@ -121,6 +141,33 @@ bool EndpointSecurityAPI::UnmuteTargetPath(const Client& client, std::string_vie
                             : ES_MUTE_PATH_TYPE_TARGET_LITERAL) == ES_RETURN_SUCCESS;
 }
 
+bool EndpointSecurityAPI::MuteTargetPaths(const Client& client, const SetPairPathAndType& paths) {
+  bool result = true;
+  for (const auto& [path, path_type] : paths) {
+    result = MuteTargetPath(client, path, path_type) && result;
+  }
+  return result;
+}
+
+bool EndpointSecurityAPI::MuteTargetPathsEvents(const Client& client,
+                                                const SetPairPathAndType& paths,
+                                                const std::set<es_event_type_t>& events) {
+  bool result = true;
+  for (const auto& [path, path_type] : paths) {
+    result = MuteTargetPathEvents(client, path, path_type, events) && result;
+  }
+  return result;
+}
+
+bool EndpointSecurityAPI::UnmuteTargetPaths(const Client& client,
+                                            const SetPairPathAndType& paths) {
+  bool result = true;
+  for (const auto& [path, path_type] : paths) {
+    result = UnmuteTargetPath(client, path, path_type) && result;
+  }
+  return result;
+}
+
 bool EndpointSecurityAPI::RespondAuthResult(const Client& client, const Message& msg,
                                             es_auth_result_t result, bool cache) {
   return es_respond_auth_result(client.Get(), &(*msg), result, cache) == ES_RESPOND_RESULT_SUCCESS;
@@ -23,6 +23,8 @@
 #include <EndpointSecurity/EndpointSecurity.h>
 #include <time.h>
 
+#include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <variant>
@@ -30,10 +32,52 @@
 #include "Source/common/Platform.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/common/es/Message.h"
-#include "Source/common/processtree/process_tree.pb.h"
+#include "Source/common/processtree/exported_annotations.h"
 
 namespace santa {
 
+// A user or group name that is only looked up the first time it is accessed,
+// so that the lookup happens when (and if) the event is serialized rather than
+// on the thread handling the ES message. Not thread safe, like the rest of the
+// enriched types.
+class LazyName {
+ public:
+  using Name = std::optional<std::shared_ptr<std::string>>;
+
+  LazyName() : resolved_(true) {}
+
+  // Wraps an already known name.
+  LazyName(Name&& name) : name_(std::move(name)), resolved_(true) {}
+
+  explicit LazyName(std::function<Name()> resolve)
+      : resolve_(std::move(resolve)), resolved_(false) {}
+
+  LazyName(LazyName&& other)
+      : resolve_(std::move(other.resolve_)),
+        name_(std::move(other.name_)),
+        resolved_(other.resolved_) {
+    other.resolved_ = true;
+  }
+
+  LazyName& operator=(LazyName&& other) = delete;
+  LazyName(const LazyName& other) = delete;
+  LazyName& operator=(const LazyName& other) = delete;
+
+  const Name& get() const {
+    if (!resolved_) {
+      name_ = resolve_();
+      resolve_ = nullptr;
+      resolved_ = true;
+    }
+    return name_;
+  }
+
+ private:
+  mutable std::function<Name()> resolve_;
+  mutable Name name_;
+  mutable bool resolved_;
+};
+
 class EnrichedFile {
  public:
   EnrichedFile()
@@ -46,6 +90,12 @@ class EnrichedFile {
         group_(std::move(group)),
         hash_(std::move(hash)) {}
 
+  EnrichedFile(LazyName&& user, LazyName&& group,
+               std::optional<std::shared_ptr<std::string>>&& hash)
+      : user_(std::move(user)),
+        group_(std::move(group)),
+        hash_(std::move(hash)) {}
+
   EnrichedFile(EnrichedFile&& other)
       : user_(std::move(other.user_)),
         group_(std::move(other.group_)),
@@ -58,15 +108,15 @@ class EnrichedFile {
   EnrichedFile& operator=(const EnrichedFile& other) = delete;
 
   const std::optional<std::shared_ptr<std::string>>& user() const {
-    return user_;
+    return user_.get();
   }
   const std::optional<std::shared_ptr<std::string>>& group() const {
-    return group_;
+    return group_.get();
   }
 
  private:
-  std::optional<std::shared_ptr<std::string>> user_;
-  std::optional<std::shared_ptr<std::string>> group_;
+  LazyName user_;
+  LazyName group_;
   std::optional<std::shared_ptr<std::string>> hash_;
 };
 
@@ -77,7 +127,7 @@ class EnrichedProcess {
         effective_group_(std::nullopt),
         real_user_(std::nullopt),
         real_group_(std::nullopt),
-        annotations_(std::nullopt) {}
+        annotations_(nullptr) {}
 
   EnrichedProcess(
       std::optional<std::shared_ptr<std::string>>&& effective_user,
@@ -85,7 +135,20 @@ class EnrichedProcess {
       std::optional<std::shared_ptr<std::string>>&& real_user,
       std::optional<std::shared_ptr<std::string>>&& real_group,
       EnrichedFile&& executable,
-      std::optional<santa::pb::v1::process_tree::Annotations>&& annotations)
+      std::shared_ptr<const santa::santad::process_tree::ExportedAnnotations>
+          annotations)
+      : effective_user_(std::move(effective_user)),
+        effective_group_(std::move(effective_group)),
+        real_user_(std::move(real_user)),
+        real_group_(std::move(real_group)),
+        executable_(std::move(executable)),
+        annotations_(std::move(annotations)) {}
+
+  EnrichedProcess(
+      LazyName&& effective_user, LazyName&& effective_group,
+      LazyName&& real_user, LazyName&& real_group, EnrichedFile&& executable,
+      std::shared_ptr<const santa::santad::process_tree::ExportedAnnotations>
+          annotations)
       : effective_user_(std::move(effective_user)),
         effective_group_(std::move(effective_group)),
         real_user_(std::move(real_user)),
@@ -108,30 +171,34 @@ class EnrichedProcess {
   EnrichedProcess& operator=(const EnrichedProcess& other) = delete;
 
   const std::optional<std::shared_ptr<std::string>>& effective_user() const {
-    return effective_user_;
+    return effective_user_.get();
   }
   const std::optional<std::shared_ptr<std::string>>& effective_group() const {
-    return effective_group_;
+    return effective_group_.get();
   }
   const std::optional<std::shared_ptr<std::string>>& real_user() const {
-    return real_user_;
+    return real_user_.get();
   }
   const std::optional<std::shared_ptr<std::string>>& real_group() const {
-    return real_group_;
+    return real_group_.get();
   }
   const EnrichedFile& executable() const { return executable_; }
-  const std::optional<santa::pb::v1::process_tree::Annotations>& annotations()
-      const {
+  // Shared with the process tree, and with every other event from the
+  // process. nullptr if the process has no annotations.
+  const std::shared_ptr<
+      const santa::santad::process_tree::ExportedAnnotations>&
+  annotations() const {
     return annotations_;
   }
 
  private:
-  std::optional<std::shared_ptr<std::string>> effective_user_;
-  std::optional<std::shared_ptr<std::string>> effective_group_;
-  std::optional<std::shared_ptr<std::string>> real_user_;
-  std::optional<std::shared_ptr<std::string>> real_group_;
+  LazyName effective_user_;
+  LazyName effective_group_;
+  LazyName real_user_;
+  LazyName real_group_;
   EnrichedFile executable_;
-  std::optional<santa::pb::v1::process_tree::Annotations> annotations_;
+  std::shared_ptr<const santa::santad::process_tree::ExportedAnnotations>
+      annotations_;
 };
 
 class EnrichedEventType {
@@ -16,11 +16,12 @@
 #ifndef SANTA_COMMON_ES_ENRICHER_H
 #define SANTA_COMMON_ES_ENRICHER_H
 
+#include <cstdint>
 #include <memory>
 #include <string_view>
 
-#include "Source/common/SantaCache.h"
 #include "Source/common/es/EnrichedTypes.h"
+#include "Source/common/es/NameResolver.h"
 #include "Source/common/processtree/process_tree.h"
 
 namespace santa {
@@ -63,10 +64,13 @@ class Enricher {
       EnrichOptions options = EnrichOptions::kDefault);
 
  private:
-  SantaCache<uid_t, std::optional<std::shared_ptr<std::string>>>
-      username_cache_;
-  SantaCache<gid_t, std::optional<std::shared_ptr<std::string>>>
-      groupname_cache_;
+  // Returns names that are only looked up when first accessed. The caches are
+  // shared with the returned objects, since they may outlive the Enricher.
+  LazyName LazyUsernameForUID(uid_t uid, EnrichOptions options);
+  LazyName LazyGroupnameForGID(gid_t gid, EnrichOptions options);
+
+  std::shared_ptr<NameResolver> username_cache_;
+  std::shared_ptr<NameResolver> groupname_cache_;
   std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree_;
 };
 
@@ -34,7 +34,9 @@
 namespace santa {
 
 Enricher::Enricher(std::shared_ptr<::santa::santad::process_tree::ProcessTree> pt)
-    : username_cache_(256), groupname_cache_(256), process_tree_(std::move(pt)) {}
+    : username_cache_(NameResolver::Create(account::UsernameForUID, {})),
+      groupname_cache_(NameResolver::Create(account::GroupNameForGID, {})),
+      process_tree_(std::move(pt)) {}
 
 std::unique_ptr<EnrichedMessage> Enricher::Enrich(Message&& es_msg) {
   // TODO(mlw): Consider potential design patterns that could help reduce memory usage under load
@@ -208,15 +210,18 @@ std::optional<EnrichedProcess> Enricher::Enrich(const es_process_t* es_proc,
 }
 
 EnrichedProcess Enricher::Enrich(const es_process_t& es_proc, EnrichOptions options) {
+  // Annotations depend on the current state of the process tree so must be captured now, but
+  // names are looked up lazily since they often go unused (e.g. by the Empty serializer).
+  // Annotations are shared with the tree rather than merged again for every event.
   return EnrichedProcess(
-      UsernameForUID(audit_token_to_euid(es_proc.audit_token), options),
-      UsernameForGID(audit_token_to_egid(es_proc.audit_token), options),
-      UsernameForUID(audit_token_to_ruid(es_proc.audit_token), options),
-      UsernameForGID(audit_token_to_rgid(es_proc.audit_token), options),
+      LazyUsernameForUID(audit_token_to_euid(es_proc.audit_token), options),
+      LazyGroupnameForGID(audit_token_to_egid(es_proc.audit_token), options),
+      LazyUsernameForUID(audit_token_to_ruid(es_proc.audit_token), options),
+      LazyGroupnameForGID(audit_token_to_rgid(es_proc.audit_token), options),
       Enrich(*es_proc.executable, options),
       process_tree_ ? process_tree_->ExportAnnotations(
                           santa::santad::process_tree::PidFromAuditToken(es_proc.audit_token))
-                    : std::nullopt);
+                    : nullptr);
 }
 
 std::optional<EnrichedFile> Enricher::Enrich(const es_file_t* es_file, EnrichOptions options) {
@@ -226,48 +231,30 @@ std::optional<EnrichedFile> Enricher::Enrich(const es_file_t* es_file, EnrichOpt
 EnrichedFile Enricher::Enrich(const es_file_t& es_file, EnrichOptions options) {
   // TODO(mlw): Consider having the enricher perform file hashing. This will
   // make more sense if we start including hashes in more event types.
-  return EnrichedFile(UsernameForUID(es_file.stat.st_uid, options),
-                      UsernameForGID(es_file.stat.st_gid, options), std::nullopt);
+  return EnrichedFile(LazyUsernameForUID(es_file.stat.st_uid, options),
+                      LazyGroupnameForGID(es_file.stat.st_gid, options), std::nullopt);
 }
 
 std::optional<std::shared_ptr<std::string>> Enricher::UsernameForUID(uid_t uid,
                                                                      EnrichOptions options) {
-  std::optional<std::shared_ptr<std::string>> username = username_cache_.get(uid);
-
-  if (username.has_value()) {
-    return username;
-  } else if (options == EnrichOptions::kLocalOnly) {
-    // If `kLocalOnly` option is set, do not attempt a lookup
-    return std::nullopt;
-  } else {
-    std::optional<std::string> name = account::UsernameForUID(uid);
-    username =
-        name.has_value() ? std::make_optional(std::make_shared<std::string>(*name)) : std::nullopt;
-
-    username_cache_.set(uid, username);
-
-    return username;
-  }
+  return username_cache_->Resolve(uid, options != EnrichOptions::kLocalOnly);
 }
 
 std::optional<std::shared_ptr<std::string>> Enricher::UsernameForGID(gid_t gid,
                                                                      EnrichOptions options) {
-  std::optional<std::shared_ptr<std::string>> groupname = groupname_cache_.get(gid);
-
-  if (groupname.has_value()) {
-    return groupname;
-  } else if (options == EnrichOptions::kLocalOnly) {
-    // If `kLocalOnly` option is set, do not attempt a lookup
-    return std::nullopt;
-  } else {
-    std::optional<std::string> name = account::GroupNameForGID(gid);
-    groupname =
-        name.has_value() ? std::make_optional(std::make_shared<std::string>(*name)) : std::nullopt;
+  return groupname_cache_->Resolve(gid, options != EnrichOptions::kLocalOnly);
+}
 
-    groupname_cache_.set(gid, groupname);
+LazyName Enricher::LazyUsernameForUID(uid_t uid, EnrichOptions options) {
+  return LazyName([cache = username_cache_, uid, options] {
+    return cache->Resolve(uid, options != EnrichOptions::kLocalOnly);
+  });
+}
 
-    return groupname;
-  }
+LazyName Enricher::LazyGroupnameForGID(gid_t gid, EnrichOptions options) {
+  return LazyName([cache = groupname_cache_, gid, options] {
+    return cache->Resolve(gid, options != EnrichOptions::kLocalOnly);
+  });
 }
 
 std::optional<uid_t> Enricher::UIDForUsername(std::string_view username, EnrichOptions options) {
@@ -16,10 +16,17 @@
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
 
+#include <memory>
+#include <optional>
+#include <string>
+
 #include "Source/common/TestUtils.h"
+#include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Enricher.h"
 
+using santa::EnrichedFile;
 using santa::Enricher;
+using santa::LazyName;
 
 @interface EnricherTest : XCTestCase
 @end
@@ -47,4 +54,45 @@ using santa::Enricher;
   XCTAssertFalse(invalidGroup.has_value());
 }
 
+- (void)testLazyNameResolvesOnce {
+  int calls = 0;
+  LazyName name([&calls]() -> LazyName::Name {
+    calls++;
+    return std::make_shared<std::string>("foo");
+  });
+  XCTAssertEqual(calls, 0);
+
+  XCTAssertCppStringEqual(*name.get().value(), "foo");
+  XCTAssertCppStringEqual(*name.get().value(), "foo");
+  XCTAssertEqual(calls, 1);
+
+  // Moving an unresolved name carries the resolver with it.
+  LazyName unresolved([&calls]() -> LazyName::Name {
+    calls++;
+    return std::nullopt;
+  });
+  LazyName moved(std::move(unresolved));
+  XCTAssertFalse(moved.get().has_value());
+  XCTAssertEqual(calls, 2);
+}
+
+- (void)testEnrichedFileNamesOutliveEnricher {
+  struct stat sb = MakeStat();
+  sb.st_uid = NOBODY_UID;
+  sb.st_gid = NOGROUP_GID;
+  es_file_t file = MakeESFile("foo", sb);
+
+  std::optional<EnrichedFile> enrichedFile;
+  {
+    Enricher enricher;
+    enrichedFile.emplace(enricher.Enrich(file));
+  }
+
+  // Names are resolved on first access, after the enricher is gone.
+  XCTAssertTrue(enrichedFile->user().has_value());
+  XCTAssertCppStringEqual(*enrichedFile->user().value(), "nobody");
+  XCTAssertTrue(enrichedFile->group().has_value());
+  XCTAssertCppStringEqual(*enrichedFile->group().value(), "nogroup");
+}
+
 @end
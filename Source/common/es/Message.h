@@ -29,6 +29,11 @@ namespace santa {
 
 class EndpointSecurityAPI;
 
+// A handle to a retained es_message_t. The message is retained with ES once,
+// when the first handle is constructed, and released once the last copy of it
+// is destroyed. Copies share an intrusively refcounted holder, so handing a
+// message to another block or queue only costs an atomic increment. Prefer
+// moving handles where possible, which costs nothing.
 class Message {
  public:
   // Small structure to hold event target information.
@@ -76,7 +81,7 @@ class Message {
   // Used for things like es_exec_arg_count.
   // We should ideally rework this to somehow present these functions as methods
   // on the Message, however this would be a bit of a bigger lift.
-  std::shared_ptr<EndpointSecurityAPI> ESAPI() const { return esapi_; }
+  std::shared_ptr<EndpointSecurityAPI> ESAPI() const;
 
   std::string ParentProcessName() const;
   std::string ParentProcessPath() const;
@@ -93,11 +98,22 @@ class Message {
   }
 
  private:
+  // Shared by all copies of a handle. Holders are pooled.
+  struct Holder;
+  class HolderPool;
+
+  static HolderPool& Pool();
+
+  static Holder* AcquireHolder(std::shared_ptr<EndpointSecurityAPI> esapi,
+                               const es_message_t* es_msg);
+  static void Unref(Holder* holder);
+
   std::string GetProcessName(pid_t pid) const;
   std::string GetProcessPath(audit_token_t* tok) const;
   void PopulatePathTargets();
 
-  std::shared_ptr<EndpointSecurityAPI> esapi_;
+  Holder* holder_;
+  // Cached from the holder so accessing the message needs no indirection.
   const es_message_t* es_msg_;
   std::optional<santa::santad::process_tree::ProcessToken> process_token_;
   std::vector<PathTarget> path_targets_;
@@ -20,10 +20,65 @@
 #include <sys/param.h>
 #include <sys/stat.h>
 
+#include <atomic>
+#include <cstdint>
+
 #include "Source/common/es/EndpointSecurityAPI.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 
 namespace santa {
 
+struct Message::Holder {
+  std::atomic<uint32_t> refs;
+  std::shared_ptr<EndpointSecurityAPI> esapi;
+  const es_message_t* es_msg;
+  Holder* next_free;
+};
+
+// Every event needs a holder, so released holders are kept for reuse rather
+// than freed. The pool only needs to cover the messages in flight at once.
+class Message::HolderPool {
+ public:
+  static constexpr size_t kMaxPooledHolders = 256;
+
+  Holder* Get() {
+    {
+      absl::MutexLock lock(&mtx_);
+      if (free_list_) {
+        Holder* holder = free_list_;
+        free_list_ = holder->next_free;
+        num_free_--;
+        return holder;
+      }
+    }
+    return new Holder();
+  }
+
+  void Put(Holder* holder) {
+    {
+      absl::MutexLock lock(&mtx_);
+      if (num_free_ < kMaxPooledHolders) {
+        holder->next_free = free_list_;
+        free_list_ = holder;
+        num_free_++;
+        return;
+      }
+    }
+    delete holder;
+  }
+
+ private:
+  absl::Mutex mtx_;
+  Holder* free_list_ ABSL_GUARDED_BY(mtx_) = nullptr;
+  size_t num_free_ ABSL_GUARDED_BY(mtx_) = 0;
+};
+
+Message::HolderPool& Message::Pool() {
+  static HolderPool* pool = new HolderPool();
+  return *pool;
+}
+
 // Simple path: string_view directly into the retained es_message_t data.
 static inline void PushBackPathTarget(std::vector<Message::PathTarget>& vec,
                                       const es_file_t* esFile, bool isReadable = false) {
@@ -42,32 +97,58 @@ static inline void PushBackPathTarget(std::vector<Message::PathTarget>& vec, con
   vec.push_back({std::move(full_path), false, nullptr, dir->path_truncated});
 }
 
-Message::Message(std::shared_ptr<EndpointSecurityAPI> esapi, const es_message_t* es_msg)
-    : esapi_(std::move(esapi)), es_msg_(es_msg), process_token_(std::nullopt) {
-  esapi_->RetainMessage(es_msg);
+Message::Holder* Message::AcquireHolder(std::shared_ptr<EndpointSecurityAPI> esapi,
+                                        const es_message_t* es_msg) {
+  esapi->RetainMessage(es_msg);
+
+  Holder* holder = Pool().Get();
+  holder->refs.store(1, std::memory_order_relaxed);
+  holder->esapi = std::move(esapi);
+  holder->es_msg = es_msg;
+  holder->next_free = nullptr;
+  return holder;
 }
 
-Message::~Message() {
-  if (es_msg_) {
-    esapi_->ReleaseMessage(es_msg_);
+void Message::Unref(Holder* holder) {
+  if (!holder || holder->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
   }
+
+  holder->esapi->ReleaseMessage(holder->es_msg);
+  holder->esapi.reset();
+  holder->es_msg = nullptr;
+  Pool().Put(holder);
 }
 
-Message::Message(Message&& other) {
-  esapi_ = std::move(other.esapi_);
-  es_msg_ = other.es_msg_;
-  path_targets_ = std::move(other.path_targets_);
+Message::Message(std::shared_ptr<EndpointSecurityAPI> esapi, const es_message_t* es_msg)
+    : holder_(AcquireHolder(std::move(esapi), es_msg)),
+      es_msg_(es_msg),
+      process_token_(std::nullopt) {}
+
+Message::~Message() {
+  Unref(holder_);
+}
+
+Message::Message(Message&& other)
+    : holder_(other.holder_),
+      es_msg_(other.es_msg_),
+      process_token_(std::move(other.process_token_)),
+      path_targets_(std::move(other.path_targets_)) {
+  other.holder_ = nullptr;
   other.es_msg_ = nullptr;
-  process_token_ = std::move(other.process_token_);
   other.process_token_ = std::nullopt;
 }
 
-Message::Message(const Message& other) {
-  esapi_ = other.esapi_;
-  es_msg_ = other.es_msg_;
-  esapi_->RetainMessage(es_msg_);
-  path_targets_ = other.path_targets_;
-  process_token_ = other.process_token_;
+Message::Message(const Message& other)
+    : holder_(other.holder_),
+      es_msg_(other.es_msg_),
+      process_token_(other.process_token_),
+      path_targets_(other.path_targets_) {
+  holder_->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::shared_ptr<EndpointSecurityAPI> Message::ESAPI() const {
+  return holder_->esapi;
 }
 
 void Message::SetProcessToken(santa::santad::process_tree::ProcessToken tok) {
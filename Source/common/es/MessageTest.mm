@@ -21,6 +21,8 @@
 #include <libproc.h>
 #include <stdlib.h>
 
+#include <optional>
+
 #include "Source/common/AuditUtilities.h"
 #include "Source/common/TestUtils.h"
 #include "Source/common/es/Message.h"
@@ -96,8 +98,8 @@ std::string GetProcessPath(pid_t pid) {
 
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   EXPECT_CALL(*mockESApi, ReleaseMessage(testing::_))
-      .Times(2)
-      .After(EXPECT_CALL(*mockESApi, RetainMessage(testing::_)).Times(2));
+      .Times(1)
+      .After(EXPECT_CALL(*mockESApi, RetainMessage(testing::_)).Times(1));
 
   {
     Message msg1(mockESApi, &esMsg);
@@ -106,12 +108,38 @@ std::string GetProcessPath(pid_t pid) {
     // Both messages should now point to the same `es_message_t`
     XCTAssertEqual(msg1.operator->(), &esMsg);
     XCTAssertEqual(msg2.operator->(), &esMsg);
+    XCTAssertEqual(msg2.ESAPI(), mockESApi);
   }
 
   // Ensure the retain/release mocks were called the expected number of times
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
+- (void)testReleasedOnceAfterLastCopy {
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_EXIT, &proc);
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  EXPECT_CALL(*mockESApi, RetainMessage(&esMsg)).Times(1);
+
+  {
+    std::optional<Message> copy;
+    {
+      Message msg(mockESApi, &esMsg);
+      Message moved(std::move(msg));
+      copy.emplace(moved);
+    }
+
+    // The original handles are gone, but a copy still holds the message
+    XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+    EXPECT_CALL(*mockESApi, ReleaseMessage(&esMsg)).Times(1);
+    XCTAssertEqual(copy->operator->(), &esMsg);
+  }
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
 - (void)testGetParentProcessName {
   // Construct a message where the parent pid is ourself
   es_file_t procFile = MakeESFile("foo");
@@ -36,6 +36,7 @@ class MockEndpointSecurityAPI : public santa::EndpointSecurityAPI {
   MOCK_METHOD(santa::Client, NewClient, (void (^message_handler)(es_client_t*, santa::Message)));
 
   MOCK_METHOD(bool, Subscribe, (const santa::Client&, const std::set<es_event_type_t>&));
+  MOCK_METHOD(bool, Unsubscribe, (const santa::Client&, const std::set<es_event_type_t>&));
   MOCK_METHOD(bool, UnsubscribeAll, (const Client& client));
 
   MOCK_METHOD(bool, UnmuteAllPaths, (const Client& client));
@@ -66,6 +67,12 @@ class MockEndpointSecurityAPI : public santa::EndpointSecurityAPI {
                bool cache));
 
   MOCK_METHOD(bool, MuteProcess, (const santa::Client&, const audit_token_t* tok));
+  MOCK_METHOD(bool, MuteProcessEvents,
+              (const santa::Client&, const audit_token_t* tok,
+               const std::set<es_event_type_t>& events));
+  MOCK_METHOD(bool, UnmuteProcessEvents,
+              (const santa::Client&, const audit_token_t* tok,
+               const std::set<es_event_type_t>& events));
 
   MOCK_METHOD(bool, ClearCache, (const santa::Client&));
 
@@ -0,0 +1,100 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_ES_NAMERESOLVER_H
+#define SANTA_COMMON_ES_NAMERESOLVER_H
+
+#include <dispatch/dispatch.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Caches the names of user and group ids, looking them up off the calling
+// thread so that a slow directory service can't stall event processing.
+//
+// Resolved names are kept for positive_ttl_ns, and ids that don't resolve are
+// remembered for negative_ttl_ns. Once an entry expires, its old value keeps
+// being returned while it's looked up again in the background. An id that
+// isn't cached at all is looked up in the background, and the caller waits at
+// most miss_wait_ns for the result before getting std::nullopt. The late
+// result is still cached for the next caller.
+//
+// Lookups run one at a time, and each id is only looked up once at a time.
+class NameResolver : public std::enable_shared_from_this<NameResolver> {
+ public:
+  using Name = std::optional<std::shared_ptr<std::string>>;
+  using LookupFunc = std::function<std::optional<std::string>(uint32_t)>;
+
+  struct Options {
+    uint64_t positive_ttl_ns = 10 * 60 * NSEC_PER_SEC;
+    uint64_t negative_ttl_ns = 60 * NSEC_PER_SEC;
+    uint64_t miss_wait_ns = 25 * NSEC_PER_MSEC;
+    size_t max_entries = 256;
+  };
+
+  static std::shared_ptr<NameResolver> Create(LookupFunc lookup, Options options);
+
+  virtual ~NameResolver() = default;
+
+  NameResolver(const NameResolver&) = delete;
+  NameResolver& operator=(const NameResolver&) = delete;
+
+  // When allow_lookup is false, only cached names are returned and no lookups
+  // are started, even for expired entries.
+  Name Resolve(uint32_t id, bool allow_lookup);
+
+  size_t Size();
+
+ protected:
+  NameResolver(LookupFunc lookup, Options options);
+
+  // Monotonic time in nanoseconds. Overridden by tests.
+  virtual uint64_t NowNanos();
+
+  // Wait for all lookups started so far to finish.
+  void WaitForPendingLookups();
+
+ private:
+  struct Entry {
+    Name name;
+    uint64_t expires_ns;
+  };
+
+  void StartLookupLocked(uint32_t id) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void RunLookup(uint32_t id);
+  void EvictLocked(uint64_t now) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  LookupFunc lookup_;
+  const Options options_;
+  dispatch_queue_t q_;
+
+  absl::Mutex lock_;
+  absl::flat_hash_map<uint32_t, Entry> entries_ ABSL_GUARDED_BY(lock_);
+  absl::flat_hash_set<uint32_t> in_flight_ ABSL_GUARDED_BY(lock_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_ES_NAMERESOLVER_H
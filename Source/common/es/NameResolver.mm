@@ -0,0 +1,134 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/es/NameResolver.h"
+
+#include <utility>
+
+#include "Source/common/StringInterner.h"
+#include "Source/common/SystemResources.h"
+#include "absl/time/time.h"
+
+namespace santa {
+
+std::shared_ptr<NameResolver> NameResolver::Create(LookupFunc lookup, Options options) {
+  return std::shared_ptr<NameResolver>(new NameResolver(std::move(lookup), std::move(options)));
+}
+
+NameResolver::NameResolver(LookupFunc lookup, Options options)
+    : lookup_(std::move(lookup)), options_(std::move(options)) {
+  q_ = dispatch_queue_create(
+      "com.northpolesec.santa.name_resolver",
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+}
+
+uint64_t NameResolver::NowNanos() {
+  return GetCurrentUptime();
+}
+
+NameResolver::Name NameResolver::Resolve(uint32_t id, bool allow_lookup) {
+  absl::MutexLock lock(&lock_);
+
+  auto it = entries_.find(id);
+  if (it != entries_.end()) {
+    if (allow_lookup && NowNanos() >= it->second.expires_ns) {
+      StartLookupLocked(id);
+    }
+    return it->second.name;
+  }
+
+  if (!allow_lookup) {
+    return std::nullopt;
+  }
+
+  StartLookupLocked(id);
+
+  struct WaitArgs {
+    NameResolver* resolver;
+    uint32_t id;
+  } args{this, id};
+  bool (*resolved)(WaitArgs*) = [](WaitArgs* args) {
+    return args->resolver->entries_.contains(args->id);
+  };
+  lock_.AwaitWithTimeout(absl::Condition(resolved, &args),
+                         absl::Nanoseconds(options_.miss_wait_ns));
+
+  it = entries_.find(id);
+  return it != entries_.end() ? it->second.name : std::nullopt;
+}
+
+size_t NameResolver::Size() {
+  absl::MutexLock lock(&lock_);
+  return entries_.size();
+}
+
+void NameResolver::WaitForPendingLookups() {
+  dispatch_sync(q_, ^{
+         });
+}
+
+void NameResolver::StartLookupLocked(uint32_t id) {
+  if (!in_flight_.insert(id).second) {
+    return;
+  }
+
+  std::weak_ptr<NameResolver> weak_self = weak_from_this();
+  dispatch_async(q_, ^{
+    if (std::shared_ptr<NameResolver> self = weak_self.lock()) {
+      self->RunLookup(id);
+    }
+  });
+}
+
+void NameResolver::RunLookup(uint32_t id) {
+  std::optional<std::string> found = lookup_(id);
+
+  absl::MutexLock lock(&lock_);
+  in_flight_.erase(id);
+  uint64_t now = NowNanos();
+
+  auto it = entries_.find(id);
+  if (found.has_value()) {
+    // Names are interned so that entries for many ids, and messages holding
+    // them after they've left the cache, share one copy of each name.
+    Entry entry{StringInterner::Shared().Intern(*found), now + options_.positive_ttl_ns};
+    if (it != entries_.end()) {
+      it->second = std::move(entry);
+      return;
+    }
+    if (entries_.size() >= options_.max_entries) {
+      EvictLocked(now);
+    }
+    entries_.emplace(id, std::move(entry));
+  } else if (it != entries_.end()) {
+    // A name that no longer resolves is more often a directory service outage
+    // than a deleted account, so keep the last known name but check it again
+    // sooner.
+    it->second.expires_ns = now + options_.negative_ttl_ns;
+  } else {
+    if (entries_.size() >= options_.max_entries) {
+      EvictLocked(now);
+    }
+    entries_.emplace(id, Entry{std::nullopt, now + options_.negative_ttl_ns});
+  }
+}
+
+void NameResolver::EvictLocked(uint64_t now) {
+  absl::erase_if(entries_, [now](const auto& kv) { return now >= kv.second.expires_ns; });
+  while (!entries_.empty() && entries_.size() >= options_.max_entries) {
+    entries_.erase(entries_.begin());
+  }
+}
+
+}  // namespace santa
@@ -0,0 +1,177 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/es/NameResolver.h"
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "Source/common/SystemResources.h"
+
+using santa::NameResolver;
+
+namespace santa {
+
+class NameResolverPeer : public NameResolver {
+ public:
+  NameResolverPeer(LookupFunc lookup, Options options)
+      : NameResolver(std::move(lookup), std::move(options)) {}
+
+  uint64_t NowNanos() override { return now_; }
+  void Advance(uint64_t ns) { now_ += ns; }
+
+  using NameResolver::WaitForPendingLookups;
+
+ private:
+  std::atomic<uint64_t> now_ = 1;
+};
+
+}  // namespace santa
+
+using santa::NameResolverPeer;
+
+static NameResolver::Options TestOptions() {
+  NameResolver::Options options;
+  options.positive_ttl_ns = 100;
+  options.negative_ttl_ns = 10;
+  options.miss_wait_ns = 5 * NSEC_PER_SEC;
+  return options;
+}
+
+@interface NameResolverTest : XCTestCase
+@end
+
+@implementation NameResolverTest
+
+- (void)testResolvedNamesAreCached {
+  std::atomic<int> calls = 0;
+  auto resolver = std::make_shared<NameResolverPeer>(
+      [&calls](uint32_t id) -> std::optional<std::string> {
+        calls++;
+        return "user" + std::to_string(id);
+      },
+      TestOptions());
+
+  XCTAssertEqual(*resolver->Resolve(501, true).value(), "user501");
+  XCTAssertEqual(*resolver->Resolve(501, true).value(), "user501");
+  XCTAssertEqual(calls, 1);
+  XCTAssertEqual(resolver->Size(), 1);
+}
+
+- (void)testNegativeCaching {
+  std::atomic<int> calls = 0;
+  auto resolver = std::make_shared<NameResolverPeer>(
+      [&calls](uint32_t) -> std::optional<std::string> {
+        calls++;
+        return std::nullopt;
+      },
+      TestOptions());
+
+  XCTAssertFalse(resolver->Resolve(1234, true).has_value());
+  XCTAssertFalse(resolver->Resolve(1234, true).has_value());
+  XCTAssertEqual(calls, 1);
+
+  // Ids that don't resolve are retried once the negative TTL passes
+  resolver->Advance(10);
+  XCTAssertFalse(resolver->Resolve(1234, true).has_value());
+  resolver->WaitForPendingLookups();
+  XCTAssertEqual(calls, 2);
+}
+
+- (void)testStaleWhileRevalidate {
+  std::atomic<int> calls = 0;
+  std::atomic<bool> resolves = true;
+  auto resolver = std::make_shared<NameResolverPeer>(
+      [&calls, &resolves](uint32_t) -> std::optional<std::string> {
+        if (!resolves) {
+          return std::nullopt;
+        }
+        return ++calls == 1 ? "old" : "new";
+      },
+      TestOptions());
+
+  XCTAssertEqual(*resolver->Resolve(501, true).value(), "old");
+
+  // Expired names are returned while they're looked up again
+  resolver->Advance(100);
+  XCTAssertEqual(*resolver->Resolve(501, true).value(), "old");
+  resolver->WaitForPendingLookups();
+  XCTAssertEqual(*resolver->Resolve(501, true).value(), "new");
+
+  // A name that stops resolving keeps its last known value
+  resolves = false;
+  resolver->Advance(100);
+  XCTAssertEqual(*resolver->Resolve(501, true).value(), "new");
+  resolver->WaitForPendingLookups();
+  XCTAssertEqual(*resolver->Resolve(501, true).value(), "new");
+}
+
+- (void)testSlowLookupsDoNotBlock {
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  NameResolver::Options options = TestOptions();
+  options.miss_wait_ns = 10 * NSEC_PER_MSEC;
+  auto resolver = std::make_shared<NameResolverPeer>(
+      [sema](uint32_t) -> std::optional<std::string> {
+        dispatch_semaphore_wait(sema, DISPATCH_TIME_FOREVER);
+        return "slow";
+      },
+      options);
+
+  uint64_t start = GetCurrentUptime();
+  XCTAssertFalse(resolver->Resolve(501, true).has_value());
+  XCTAssertLessThan(GetCurrentUptime() - start, NSEC_PER_SEC);
+
+  // The late result is cached for the next caller
+  dispatch_semaphore_signal(sema);
+  resolver->WaitForPendingLookups();
+  XCTAssertEqual(*resolver->Resolve(501, true).value(), "slow");
+}
+
+- (void)testNoLookupsWhenNotAllowed {
+  std::atomic<int> calls = 0;
+  auto resolver = std::make_shared<NameResolverPeer>(
+      [&calls](uint32_t) -> std::optional<std::string> {
+        calls++;
+        return "user";
+      },
+      TestOptions());
+
+  XCTAssertFalse(resolver->Resolve(501, false).has_value());
+  XCTAssertEqual(calls, 0);
+
+  XCTAssertEqual(*resolver->Resolve(501, true).value(), "user");
+  resolver->Advance(100);
+  XCTAssertEqual(*resolver->Resolve(501, false).value(), "user");
+  resolver->WaitForPendingLookups();
+  XCTAssertEqual(calls, 1);
+}
+
+- (void)testBounded {
+  NameResolver::Options options = TestOptions();
+  options.max_entries = 2;
+  auto resolver = std::make_shared<NameResolverPeer>(
+      [](uint32_t id) -> std::optional<std::string> { return std::to_string(id); }, options);
+
+  for (uint32_t id = 0; id < 10; id++) {
+    XCTAssertEqual(*resolver->Resolve(id, true).value(), std::to_string(id));
+    XCTAssertLessThanOrEqual(resolver->Size(), 2);
+  }
+}
+
+@end
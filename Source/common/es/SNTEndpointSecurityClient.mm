@@ -28,6 +28,7 @@
 #include <set>
 #include <string>
 #include <string_view>
+#include <variant>
 
 #include "Source/common/AuditUtilities.h"
 #include "Source/common/BranchPrediction.h"
@@ -35,20 +36,104 @@
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
 #include "Source/common/SystemResources.h"
+#include "Source/common/es/BatchedDispatcher.h"
 #include "Source/common/es/Client.h"
+#include "Source/common/es/DeadlineTimer.h"
 #include "Source/common/es/ESMetricsObserver.h"
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
 #include "Source/common/faa/WatchItemPolicy.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 
+using santa::BatchedDispatcher;
 using santa::Client;
+using santa::DeadlineTimer;
 using santa::EndpointSecurityAPI;
 using santa::EnrichedMessage;
 using santa::ESMetricsObserver;
 using santa::EventDisposition;
+using santa::EventLatencyStage;
 using santa::Message;
 using santa::Processor;
 
+// Number of messages each client may have waiting for a batched dispatch worker
+// before falling back to dispatching them individually.
+static constexpr size_t kBatchedDispatchQueueCapacity = 1024;
+
+// An AUTH message dispatched in batched mode is answered either by its handler
+// or, if the handler runs out of budget, by the shared deadline timer. Whoever
+// claims it first wins; the mutex is held while the deadline response is sent,
+// so a late handler waits for it to complete like the unbatched path does.
+struct PendingAuth {
+  explicit PendingAuth(const Message& msg) : deadline_msg(msg) {}
+
+  absl::Mutex mtx;
+  bool claimed ABSL_GUARDED_BY(mtx) = false;
+  // Copy of the message for the deadline response, released once claimed.
+  std::optional<Message> deadline_msg ABSL_GUARDED_BY(mtx);
+};
+
+// Deadlines of AUTH messages from all clients are enforced by one timer. It
+// lives for the lifetime of the process.
+static DeadlineTimer* SharedDeadlineTimer() {
+  static DeadlineTimer* deadlineTimer = new DeadlineTimer(QOS_CLASS_USER_INTERACTIVE);
+  return deadlineTimer;
+}
+
+// Workers are shared by all clients. All members are nullptr when batched
+// dispatch is disabled.
+struct BatchedDispatch {
+  BatchedDispatcher* auth;
+  BatchedDispatcher* notify;
+};
+
+// The worker count is only read by the first caller.
+static const BatchedDispatch& SharedBatchedDispatch(NSUInteger numWorkers) {
+  static BatchedDispatch batchedDispatch;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    if (numWorkers == 0) {
+      return;
+    }
+    // These live for the lifetime of the process.
+    batchedDispatch = {
+        .auth = new BatchedDispatcher("com.northpolesec.santa.daemon.auth_worker",
+                                      QOS_CLASS_USER_INTERACTIVE, numWorkers),
+        .notify = new BatchedDispatcher("com.northpolesec.santa.daemon.notify_worker",
+                                        QOS_CLASS_UTILITY, numWorkers),
+    };
+  });
+  return batchedDispatch;
+}
+
+// Runs a handler for a message that was handed off at enqueueTime, recording how
+// long it waited to start and how long it ran.
+template <typename F>
+static void RunTimedHandler(ESMetricsObserver* metrics, Processor processor,
+                            es_event_type_t eventType, int64_t enqueueTime, F&& handler) {
+  if (!metrics) {
+    handler();
+    return;
+  }
+
+  int64_t handlerStart = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  metrics->RecordEventLatency(processor, eventType, EventLatencyStage::kQueued,
+                              handlerStart - enqueueTime);
+  handler();
+  metrics->RecordEventLatency(processor, eventType, EventLatencyStage::kHandler,
+                              clock_gettime_nsec_np(CLOCK_MONOTONIC) - handlerStart);
+}
+
+// Runs work on the queue, for when a batched dispatch queue is full.
+static void DispatchWork(dispatch_queue_t q, BatchedDispatcher::Work work) {
+  auto* heapWork = new BatchedDispatcher::Work(std::move(work));
+  dispatch_async(q, ^{
+    (*heapWork)();
+    delete heapWork;
+  });
+}
+
 @interface SNTEndpointSecurityClient ()
 @property(nonatomic) double defaultBudget;
 @property(nonatomic) int64_t minAllowedHeadroom;
@@ -61,8 +146,13 @@ using santa::Processor;
   std::shared_ptr<ESMetricsObserver> _metrics;
   Client _esClient;
   dispatch_queue_t _authQueue;
+  dispatch_queue_t _backgroundAuthQueue;
   dispatch_queue_t _notifyQueue;
   Processor _processor;
+  BatchedDispatch _batchedDispatch;
+  DeadlineTimer* _deadlineTimer;
+  std::shared_ptr<BatchedDispatcher::Queue> _authDispatchQueue;
+  std::shared_ptr<BatchedDispatcher::Queue> _notifyDispatchQueue;
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
@@ -89,10 +179,22 @@ using santa::Processor;
         dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT_WITH_AUTORELEASE_POOL,
                                                 QOS_CLASS_USER_INTERACTIVE, 0));
 
+    _backgroundAuthQueue = dispatch_queue_create(
+        "com.northpolesec.santa.daemon.background_auth_queue",
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT_WITH_AUTORELEASE_POOL,
+                                                QOS_CLASS_USER_INITIATED, 0));
+
     _notifyQueue = dispatch_queue_create(
         "com.northpolesec.santa.daemon.notify_queue",
         dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT_WITH_AUTORELEASE_POOL,
                                                 QOS_CLASS_UTILITY, 0));
+
+    _deadlineTimer = SharedDeadlineTimer();
+    _batchedDispatch = SharedBatchedDispatch([_configurator batchedEventDispatchWorkers]);
+    if (_batchedDispatch.auth) {
+      _authDispatchQueue = _batchedDispatch.auth->CreateQueue(kBatchedDispatchQueueCapacity);
+      _notifyDispatchQueue = _batchedDispatch.notify->CreateQueue(kBatchedDispatchQueueCapacity);
+    }
   }
   return self;
 }
@@ -209,6 +311,10 @@ using santa::Processor;
   return [self subscribe:events] && [self clearCache];
 }
 
+- (bool)unsubscribe:(const std::set<es_event_type_t>&)events {
+  return _esApi->Unsubscribe(_esClient, events);
+}
+
 - (bool)unsubscribeAll {
   return _esApi->UnsubscribeAll(_esClient);
 }
@@ -239,38 +345,47 @@ using santa::Processor;
   return _esApi->MuteProcess(_esClient, tok);
 }
 
+- (bool)muteProcess:(const audit_token_t*)tok forEvents:(const std::set<es_event_type_t>&)events {
+  return _esApi->MuteProcessEvents(_esClient, tok, events);
+}
+
+- (bool)unmuteProcess:(const audit_token_t*)tok forEvents:(const std::set<es_event_type_t>&)events {
+  return _esApi->UnmuteProcessEvents(_esClient, tok, events);
+}
+
 - (bool)muteTargetPaths:(const santa::SetPairPathAndType&)paths {
-  bool result = true;
-  for (const auto& PairPathAndType : paths) {
-    result =
-        _esApi->MuteTargetPath(_esClient, PairPathAndType.first, PairPathAndType.second) && result;
+  if (paths.empty()) {
+    return true;
   }
-  return result;
+  return _esApi->MuteTargetPaths(_esClient, paths);
 }
 
 - (bool)muteTargetPaths:(const santa::SetPairPathAndType&)paths
               forEvents:(const std::set<es_event_type_t>&)events {
-  bool result = true;
-  for (const auto& PairPathAndType : paths) {
-    result = _esApi->MuteTargetPathEvents(_esClient, PairPathAndType.first, PairPathAndType.second,
-                                          events) &&
-             result;
+  if (paths.empty()) {
+    return true;
   }
-  return result;
+  return _esApi->MuteTargetPathsEvents(_esClient, paths, events);
 }
 
 - (bool)unmuteTargetPaths:(const santa::SetPairPathAndType&)paths {
-  bool result = true;
-  for (const auto& PairPathAndType : paths) {
-    result = _esApi->UnmuteTargetPath(_esClient, PairPathAndType.first, PairPathAndType.second) &&
-             result;
+  if (paths.empty()) {
+    return true;
   }
-  return result;
+  return _esApi->UnmuteTargetPaths(_esClient, paths);
 }
 
 - (bool)respondToMessage:(const Message&)msg
           withAuthResult:(es_auth_result_t)result
                cacheable:(bool)cacheable {
+  if (_metrics) {
+    uint64_t now = mach_absolute_time();
+    int64_t slack = msg->deadline >= now ? (int64_t)MachTimeToNanos(msg->deadline - now)
+                                         : -(int64_t)MachTimeToNanos(now - msg->deadline);
+    _metrics->RecordEventLatency(_processor, msg->event_type, EventLatencyStage::kDeadlineSlack,
+                                 slack);
+  }
+
   if (msg->event_type == ES_EVENT_TYPE_AUTH_OPEN) {
     return _esApi->RespondFlagsResult(
         // For now, Santa is only concerned about allowing all access or no
@@ -285,6 +400,23 @@ using santa::Processor;
 
 - (void)processEnrichedMessage:(std::unique_ptr<EnrichedMessage>)msg
                        handler:(void (^)(std::unique_ptr<EnrichedMessage>))messageHandler {
+  int64_t enqueueTime = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  es_event_type_t eventType =
+      std::visit([](const auto& event) { return event->event_type; }, msg->GetEnrichedMessage());
+
+  if (_notifyDispatchQueue) {
+    BatchedDispatcher::Work work = [self, msg = std::move(msg), messageHandler, eventType,
+                                    enqueueTime]() mutable {
+      RunTimedHandler(self->_metrics.get(), self->_processor, eventType, enqueueTime, [&] {
+        messageHandler(std::move(msg));
+      });
+    };
+    if (!_batchedDispatch.notify->Dispatch(*_notifyDispatchQueue, std::move(work))) {
+      DispatchWork(_notifyQueue, std::move(work));
+    }
+    return;
+  }
+
   // Ownership is handed off to the dispatched block via a raw pointer and
   // re-wrapped on the worker thread. The obvious `__block std::unique_ptr<>`
   // pattern is avoided because it shares the captured object across threads
@@ -293,14 +425,34 @@ using santa::Processor;
   // path that releases but does not reach the dispatch_async leaks.
   EnrichedMessage* rawMsg = msg.release();
   dispatch_async(_notifyQueue, ^{
-    messageHandler(std::unique_ptr<EnrichedMessage>(rawMsg));
+    RunTimedHandler(self->_metrics.get(), self->_processor, eventType, enqueueTime, [&] {
+      messageHandler(std::unique_ptr<EnrichedMessage>(rawMsg));
+    });
   });
 }
 
 - (void)asynchronouslyProcess:(Message)msg handler:(void (^)(Message&&))messageHandler {
+  int64_t enqueueTime = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  es_event_type_t eventType = msg->event_type;
+
+  if (_notifyDispatchQueue) {
+    BatchedDispatcher::Work work = [self, msg = std::move(msg), messageHandler, eventType,
+                                    enqueueTime]() mutable {
+      RunTimedHandler(self->_metrics.get(), self->_processor, eventType, enqueueTime, [&] {
+        messageHandler(std::move(msg));
+      });
+    };
+    if (!_batchedDispatch.notify->Dispatch(*_notifyDispatchQueue, std::move(work))) {
+      DispatchWork(_notifyQueue, std::move(work));
+    }
+    return;
+  }
+
   __block Message msgTmp = std::move(msg);
   dispatch_async(_notifyQueue, ^{
-    messageHandler(std::move(msgTmp));
+    RunTimedHandler(self->_metrics.get(), self->_processor, eventType, enqueueTime, ^{
+      messageHandler(std::move(msgTmp));
+    });
   });
 }
 
@@ -322,7 +474,28 @@ using santa::Processor;
   return nanosUntilDeadline - headroom;
 }
 
+- (void)respondToExpiredDeadlineForMessage:(const Message&)msg {
+  es_auth_result_t authResult;
+  if (self.configurator.failClosed) {
+    authResult = ES_AUTH_RESULT_DENY;
+  } else {
+    authResult = ES_AUTH_RESULT_ALLOW;
+  }
+
+  bool res = [self respondToMessage:msg withAuthResult:authResult cacheable:false];
+
+  LOGE(@"SNTEndpointSecurityClient: deadline reached: pid=%d, event type: %d, result: %@, ret=%d",
+       audit_token_to_pid(msg->process->audit_token), msg->event_type,
+       (authResult == ES_AUTH_RESULT_DENY ? @"denied" : @"allowed"), res);
+}
+
 - (void)processMessage:(Message&&)msg handler:(void (^)(Message))messageHandler {
+  [self processMessage:std::move(msg) userFacing:true handler:messageHandler];
+}
+
+- (void)processMessage:(Message&&)msg
+            userFacing:(bool)userFacing
+               handler:(void (^)(Message))messageHandler {
   if (unlikely(msg->action_type != ES_ACTION_TYPE_AUTH)) {
     // This is a programming error
     LOGE(@"Attempting to process non-AUTH message");
@@ -330,6 +503,14 @@ using santa::Processor;
                 format:@"Unexpected event type received: %d", msg->event_type];
   }
 
+  if (_authDispatchQueue) {
+    [self processMessageBatched:std::move(msg) handler:messageHandler];
+    return;
+  }
+
+  int64_t enqueueTime = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  es_event_type_t eventType = msg->event_type;
+
   dispatch_semaphore_t processingSema = dispatch_semaphore_create(0);
   // Add 1 to the processing semaphore. We're not creating it with a starting
   // value of 1 because that requires that the semaphore is not deallocated
@@ -345,45 +526,81 @@ using santa::Processor;
   // race (see below) instead of keeping the Message (and its underlying
   // es_message_t) alive until the budget elapses.
   auto deadlineMsgHolder = std::make_shared<std::optional<Message>>(msg);
-  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, processingBudget), self->_authQueue, ^(void) {
-    if (dispatch_semaphore_wait(processingSema, DISPATCH_TIME_NOW) != 0) {
-      // Handler has already responded, nothing to do. The handler also released
-      // the message copy, so the holder may already be empty.
-      return;
-    }
-
-    // We won the race, so the handler has not reset the holder.
-    Message deadlineMsg = std::move(**deadlineMsgHolder);
-
-    es_auth_result_t authResult;
-    if (self.configurator.failClosed) {
-      authResult = ES_AUTH_RESULT_DENY;
-    } else {
-      authResult = ES_AUTH_RESULT_ALLOW;
-    }
-
-    bool res = [self respondToMessage:deadlineMsg withAuthResult:authResult cacheable:false];
-
-    LOGE(@"SNTEndpointSecurityClient: deadline reached: pid=%d, event type: %d, result: %@, ret=%d",
-         audit_token_to_pid(deadlineMsg->process->audit_token), deadlineMsg->event_type,
-         (authResult == ES_AUTH_RESULT_DENY ? @"denied" : @"allowed"), res);
-    dispatch_semaphore_signal(deadlineExpiredSema);
-  });
+  DeadlineTimer* deadlineTimer = _deadlineTimer;
+  DeadlineTimer::Handle deadlineHandle = deadlineTimer->Schedule(
+      AddNanosecondsToMachTime((uint64_t)std::max<int64_t>(processingBudget, 0),
+                               mach_absolute_time()),
+      [self, processingSema, deadlineExpiredSema, deadlineMsgHolder] {
+        if (dispatch_semaphore_wait(processingSema, DISPATCH_TIME_NOW) != 0) {
+          // Handler has already responded, nothing to do. The handler also
+          // released the message copy, so the holder may already be empty.
+          return;
+        }
+
+        // We won the race, so the handler has not reset the holder.
+        Message deadlineMsg = std::move(**deadlineMsgHolder);
+        [self respondToExpiredDeadlineForMessage:deadlineMsg];
+        dispatch_semaphore_signal(deadlineExpiredSema);
+      });
 
   // Move the original msg into the client handler block
   __block Message tmpMsg = std::move(msg);
-  dispatch_async(self->_authQueue, ^{
-    messageHandler(std::move(tmpMsg));
+  dispatch_async(userFacing ? self->_authQueue : self->_backgroundAuthQueue, ^{
+    RunTimedHandler(self->_metrics.get(), self->_processor, eventType, enqueueTime, ^{
+      messageHandler(std::move(tmpMsg));
+    });
     if (dispatch_semaphore_wait(processingSema, DISPATCH_TIME_NOW) != 0) {
       // Deadline expired, wait for deadline block to finish.
       dispatch_semaphore_wait(deadlineExpiredSema, DISPATCH_TIME_FOREVER);
     } else {
-      // We won the race against the deadline block, which will now no-op. Release
-      // our copy of the message immediately rather than holding it (and the
-      // underlying es_message_t) alive until the deadline block fires.
+      // We won the race against the deadline callback. Remove it from the timer
+      // and release our copy of the message immediately rather than holding it
+      // (and the underlying es_message_t) alive until the deadline passes.
+      deadlineTimer->Cancel(deadlineHandle);
       deadlineMsgHolder->reset();
     }
   });
 }
 
+// Same as the unbatched path above, but the handler runs on the shared auth
+// workers and the deadline is enforced under a per-message lock, so no
+// semaphores are needed.
+- (void)processMessageBatched:(Message&&)msg handler:(void (^)(Message))messageHandler {
+  int64_t enqueueTime = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+  es_event_type_t eventType = msg->event_type;
+  int64_t processingBudget = [self computeBudgetForDeadline:msg->deadline
+                                                currentTime:mach_absolute_time()];
+
+  auto pending = std::make_shared<PendingAuth>(msg);
+  DeadlineTimer* deadlineTimer = _deadlineTimer;
+  DeadlineTimer::Handle deadlineHandle = deadlineTimer->Schedule(
+      AddNanosecondsToMachTime((uint64_t)std::max<int64_t>(processingBudget, 0),
+                               mach_absolute_time()),
+      [self, pending] {
+        absl::MutexLock lock(pending->mtx);
+        if (pending->claimed) {
+          return;
+        }
+        pending->claimed = true;
+        [self respondToExpiredDeadlineForMessage:*pending->deadline_msg];
+        pending->deadline_msg.reset();
+      });
+
+  BatchedDispatcher::Work work = [self, msg = std::move(msg), messageHandler, eventType,
+                                  enqueueTime, deadlineTimer, deadlineHandle, pending]() mutable {
+    RunTimedHandler(self->_metrics.get(), self->_processor, eventType, enqueueTime, [&] {
+      messageHandler(std::move(msg));
+    });
+    deadlineTimer->Cancel(deadlineHandle);
+    // If the deadline callback already claimed the message, this waits for its
+    // response to be sent.
+    absl::MutexLock lock(pending->mtx);
+    pending->claimed = true;
+    pending->deadline_msg.reset();
+  };
+  if (!_batchedDispatch.auth->Dispatch(*_authDispatchQueue, std::move(work))) {
+    DispatchWork(_authQueue, std::move(work));
+  }
+}
+
 @end
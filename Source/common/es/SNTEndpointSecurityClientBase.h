@@ -47,6 +47,7 @@
 /// subscribing mitigates this posibility.
 - (bool)subscribeAndClearCache:(const std::set<es_event_type_t>&)events;
 
+- (bool)unsubscribe:(const std::set<es_event_type_t>&)events;
 - (bool)unsubscribeAll;
 - (bool)unmuteAllTargetPaths;
 - (bool)enableTargetPathWatching;
@@ -58,6 +59,8 @@
 - (bool)enableProcessWatching;
 - (bool)muteProcess:(const audit_token_t*)tok;
 - (bool)unmuteProcess:(const audit_token_t*)tok;
+- (bool)muteProcess:(const audit_token_t*)tok forEvents:(const std::set<es_event_type_t>&)events;
+- (bool)unmuteProcess:(const audit_token_t*)tok forEvents:(const std::set<es_event_type_t>&)events;
 
 /// Responds to the Message with the given auth result
 ///
@@ -81,6 +84,13 @@
 
 - (void)processMessage:(santa::Message&&)msg handler:(void (^)(santa::Message))messageHandler;
 
+/// Same as processMessage:handler:, but messages that aren't user facing are handled at a lower
+/// QoS, so they yield to those that are when many are in flight. Batched dispatch has only one
+/// class of workers, so there both are handled alike.
+- (void)processMessage:(santa::Message&&)msg
+            userFacing:(bool)userFacing
+               handler:(void (^)(santa::Message))messageHandler;
+
 - (bool)clearCache;
 
 - (bool)handleContextMessage:(santa::Message&)esMsg;
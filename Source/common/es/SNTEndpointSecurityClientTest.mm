@@ -432,7 +432,7 @@ using santa::WatchItemPathType;
     auto enrichedMsg = std::make_unique<EnrichedMessage>(EnrichedClose(
         Message(mockESApi, &esMsg),
         EnrichedProcess(std::nullopt, std::nullopt, std::nullopt, std::nullopt,
-                        EnrichedFile(std::nullopt, std::nullopt, std::nullopt), std::nullopt),
+                        EnrichedFile(std::nullopt, std::nullopt, std::nullopt), nullptr),
         EnrichedFile(std::nullopt, std::nullopt, std::nullopt)));
 
     [client processEnrichedMessage:std::move(enrichedMsg)
@@ -19,19 +19,22 @@
 #include <CommonCrypto/CommonDigest.h>
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
+#include <sys/stat.h>
 
 #include <array>
 #include <memory>
 #include <optional>
 #include <set>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include "Source/common/FlatPrefixTree.h"
 #include "Source/common/PassKey.h"
-#include "Source/common/PrefixTree.h"
 #include "Source/common/Timer.h"
 #include "Source/common/faa/WatchItemPolicy.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 
 extern NSString* const kWatchItemConfigKeyVersion;
@@ -79,6 +82,23 @@ struct WatchItemsState;
 using CheckPolicyBlock = bool (^)(std::shared_ptr<ProcessWatchItemPolicy>);
 using IterateProcessPoliciesBlock = void (^)(CheckPolicyBlock);
 
+// The attributes of a process used to narrow down which process policies it
+// could match. The cdhash is the raw bytes, and is empty if the process isn't
+// signed.
+struct ProcessPolicyLookupKeys {
+  std::string_view binary_path;
+  std::string_view signing_id;
+  std::string_view team_id;
+  std::string_view cdhash;
+  bool is_signed;
+  bool is_platform_binary;
+};
+
+// Like IterateProcessPoliciesBlock, but only the policies with a process entry
+// the given process could match are passed to the CheckPolicyBlock.
+using IterateCandidateProcessPoliciesBlock = void (^)(const ProcessPolicyLookupKeys&,
+                                                      CheckPolicyBlock);
+
 // The nesting is required so as to not tightly couple WatchItems with how
 // external callers might structure their data. In the past,
 // FAAPolicyProcessor types were used directly to make the code easier to read
@@ -90,10 +110,16 @@ using LookupPolicyBlock =
 using IterateTargetsBlock = void (^)(LookupPolicyBlock);
 using FindPoliciesForTargetsBlock = void (^)(IterateTargetsBlock);
 
+// Batched lookup of the policies for a set of paths, e.g. all targets of a
+// single event. Policies are returned in the same order as the paths.
+using PolicyLookupResults = std::vector<std::optional<std::shared_ptr<WatchItemPolicyBase>>>;
+using FindPoliciesForPathsBlock = PolicyLookupResults (^)(const std::vector<std::string_view>&);
+
 class DataWatchItems {
  public:
-  DataWatchItems()
-      : tree_(std::make_unique<santa::PrefixTree<std::shared_ptr<DataWatchItemPolicy>>>()) {}
+  using PolicyTree = santa::FlatPrefixTree<std::shared_ptr<DataWatchItemPolicy>>;
+
+  DataWatchItems() : tree_(std::make_shared<const PolicyTree>()) {}
 
   DataWatchItems(DataWatchItems&& other) = default;
   DataWatchItems& operator=(DataWatchItems&& rhs) = default;
@@ -111,13 +137,26 @@ class DataWatchItems {
     std::swap(first.paths_, second.paths_);
   }
 
+  // The paths matching each policy, found by expanding the policy paths' globs
+  // against the filesystem.
+  struct Expansion {
+    std::vector<std::pair<std::string, std::shared_ptr<DataWatchItemPolicy>>> matches;
+    SetPairPathAndType paths;
+  };
+
+  static Expansion Expand(const SetSharedDataWatchItemPolicy& data_policies);
+
   bool Build(SetSharedDataWatchItemPolicy data_policies);
+  bool Build(Expansion expansion);
   size_t Count() const { return paths_.size(); }
+  const SetPairPathAndType& Paths() const { return paths_; }
 
-  void FindPolicies(IterateTargetsBlock iterateTargetsBlock) const;
+  // The tree is immutable once built and may outlive this object, allowing
+  // lookups to be performed on a snapshot without holding any locks.
+  std::shared_ptr<const PolicyTree> Tree() const { return tree_; }
 
  private:
-  std::unique_ptr<santa::PrefixTree<std::shared_ptr<DataWatchItemPolicy>>> tree_;
+  std::shared_ptr<const PolicyTree> tree_;
   SetPairPathAndType paths_;
 };
 
@@ -140,8 +179,38 @@ class ProcessWatchItems {
   size_t Count() const { return policies_.size(); }
   void IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock);
 
+  // Iterate the policies that have a process entry the process could match,
+  // in the same order as IterateProcessPolicies. Policies are found through
+  // indexes of the process entries built by Build, so only a few are checked
+  // regardless of how many policies there are. The CheckPolicyBlock must still
+  // check the policy's processes.
+  void IterateCandidateProcessPolicies(const ProcessPolicyLookupKeys& keys,
+                                       CheckPolicyBlock checkPolicyBlock);
+
  private:
+  // Indexes into ordered_policies_
+  using PolicyIndexes = std::vector<size_t>;
+  using PolicyIndexMap = absl::flat_hash_map<std::string, PolicyIndexes>;
+
+  void IndexProcess(const WatchItemProcess& proc, size_t policy_index);
+
   SetSharedProcessWatchItemPolicy policies_;
+
+  // Policies in iteration order, so candidates are visited in the same order
+  // as a full iteration would.
+  std::vector<std::shared_ptr<ProcessWatchItemPolicy>> ordered_policies_;
+
+  // Each process entry is indexed by its most selective attribute that's known
+  // without reading the process' executable.
+  PolicyIndexMap by_cdhash_;
+  PolicyIndexMap by_signing_id_;
+  PolicyIndexMap by_team_id_;
+  PolicyIndexMap by_binary_path_;
+  // Entries that only require a platform binary, or that have no attributes
+  // other than a certificate hash. The certificate hash requires reading the
+  // executable's signature, so it can't be used as a lookup key.
+  PolicyIndexes platform_binary_;
+  PolicyIndexes unindexed_;
 };
 
 class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
@@ -169,7 +238,7 @@ class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
   WatchItems(PassKey, DataSource data_source, NSString* config_path, NSDictionary* config,
              dispatch_queue_t q, void (^periodic_task_complete_f)(void) = nullptr);
 
-  ~WatchItems() = default;
+  ~WatchItems();
 
   bool OnTimer();
 
@@ -181,11 +250,17 @@ class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
   void SetConfig(NSDictionary* config);
 
   void FindPoliciesForTargets(IterateTargetsBlock iterateTargetsBlock);
+  PolicyLookupResults FindPoliciesForPaths(const std::vector<std::string_view>& paths);
 
   void IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock);
+  void IterateCandidateProcessPolicies(const ProcessPolicyLookupKeys& keys,
+                                       CheckPolicyBlock checkPolicyBlock);
 
   std::optional<WatchItemsState> State();
 
+  // Bytes allocated for the current data policy tree, e.g. for metrics.
+  size_t DataPolicyTreeBytes();
+
   std::pair<NSString*, NSString*> EventDetailLinkInfo(
       const std::shared_ptr<WatchItemPolicyBase>& watch_item);
 
@@ -202,8 +277,32 @@ class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
                                                     NSDictionary* config,
                                                     uint32_t reapply_config_frequency_secs);
 
+  // The last version of the config file that was read. It's reused until the
+  // file is replaced, modified or has different contents.
+  struct ConfigFileSnapshot {
+    NSString* path;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+    std::array<uint8_t, CC_SHA256_DIGEST_LENGTH> digest;
+    NSDictionary* config;
+  };
+
   NSDictionary* ReadConfig();
   NSDictionary* ReadConfigLocked() ABSL_SHARED_LOCKS_REQUIRED(lock_);
+  NSDictionary* ReadConfigFile(NSString* path);
+  bool IsCurrentState(NSDictionary* config, const SetPairPathAndType& paths);
+
+  // Watch the config file, and the directory it's in so that a file replaced
+  // by a rename is noticed, so changes are applied without waiting for the
+  // next timer tick. The watch is re-armed when the config path changes, or
+  // when force is set.
+  void UpdateConfigFileWatch(bool force);
+  void StopConfigFileWatchLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  dispatch_source_t CreateConfigWatchSource(const char* path, unsigned long mask, bool is_dir);
+  void OnConfigFileEvent(bool rearm);
   void ReloadConfig(NSDictionary* new_config);
   void UpdateCurrentState(DataWatchItems new_data_watch_items,
                           ProcessWatchItems new_proc_watch_items, NSDictionary* new_config,
@@ -218,6 +317,9 @@ class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
   absl::Mutex lock_;
 
   DataWatchItems data_watch_items_ ABSL_GUARDED_BY(lock_);
+  // Snapshot of the current data_watch_items_ tree for lock-free lookups.
+  // Only accessed atomically, and only replaced while lock_ is held.
+  std::shared_ptr<const DataWatchItems::PolicyTree> data_policy_tree_;
   ProcessWatchItems proc_watch_items_ ABSL_GUARDED_BY(lock_);
   NSDictionary* current_config_ ABSL_GUARDED_BY(lock_);
   NSTimeInterval last_update_time_ ABSL_GUARDED_BY(lock_);
@@ -225,6 +327,27 @@ class WatchItems : public Timer<WatchItems>, public PassKey<WatchItems> {
   DataWatchItemsUpdatedBlock data_watch_items_updated_callback_ ABSL_GUARDED_BY(lock_);
   ProcWatchItemsUpdatedBlock proc_watch_items_updated_callback_ ABSL_GUARDED_BY(lock_);
   bool periodic_task_started_ = false;
+
+  // Serializes reloads. The results of the last parse are reused as long as
+  // the config is the same object.
+  absl::Mutex reload_lock_;
+  NSDictionary* parsed_config_ ABSL_GUARDED_BY(reload_lock_);
+  SetSharedDataWatchItemPolicy parsed_data_policies_ ABSL_GUARDED_BY(reload_lock_);
+  SetSharedProcessWatchItemPolicy parsed_proc_policies_ ABSL_GUARDED_BY(reload_lock_);
+  uint64_t parsed_rules_loaded_ ABSL_GUARDED_BY(reload_lock_) = 0;
+
+  absl::Mutex config_file_lock_;
+  ConfigFileSnapshot config_file_ ABSL_GUARDED_BY(config_file_lock_) = {};
+
+  // Config file change notifications are handled on config_watch_q_. The
+  // pending flags are only accessed on that queue.
+  dispatch_queue_t config_watch_q_;
+  NSString* watched_config_path_ ABSL_GUARDED_BY(lock_);
+  dispatch_source_t config_file_source_ ABSL_GUARDED_BY(lock_);
+  dispatch_source_t config_dir_source_ ABSL_GUARDED_BY(lock_);
+  bool config_reload_pending_ = false;
+  bool config_rearm_pending_ = false;
+
   NSString* policy_event_detail_url_ ABSL_GUARDED_BY(lock_);
   NSString* policy_event_detail_text_ ABSL_GUARDED_BY(lock_);
   uint64_t rules_loaded_ ABSL_GUARDED_BY(lock_);
@@ -18,9 +18,12 @@
 #include <CommonCrypto/CommonDigest.h>
 #include <Kernel/kern/cs_blobs.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <sys/syslimits.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdlib>
 #include <iterator>
@@ -28,12 +31,12 @@
 #include <optional>
 #include <set>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
 
 #import "Source/common/Glob.h"
-#import "Source/common/PrefixTree.h"
 #import "Source/common/SNTError.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/String.h"
@@ -90,6 +93,10 @@ static NSString* const kValidRuleNamePattern = @"^[A-Za-z0-9._:-]+\\z";
 static constexpr uint32_t kMinReapplyConfigFrequencySecs = 15;
 static constexpr uint32_t kMaxReapplyConfigFrequencySecs = 3600;
 
+// How long to wait after the config file changes before reloading it, so that
+// a burst of writes results in a single reload.
+static constexpr int64_t kConfigFileSettleNS = 100 * NSEC_PER_MSEC;
+
 // Semi-arbitrary max custom message length. The goal is to protect against
 // potential unbounded lengths, but no real reason this cannot be higher.
 static constexpr NSUInteger kWatchItemConfigOptionCustomMessageMaxLength = 2048;
@@ -716,40 +723,96 @@ SetPairPathAndType DataWatchItems::operator-(const DataWatchItems& other) const
   return diff;
 }
 
-bool DataWatchItems::Build(SetSharedDataWatchItemPolicy data_policies) {
+DataWatchItems::Expansion DataWatchItems::Expand(
+    const SetSharedDataWatchItemPolicy& data_policies) {
+  Expansion expansion;
+
   for (const std::shared_ptr<DataWatchItemPolicy>& item : data_policies) {
     std::vector<std::string> matches = FindMatches(@(item->path.c_str()));
 
-    for (const auto& match : matches) {
-      if (item->path_type == WatchItemPathType::kPrefix) {
-        tree_->InsertPrefix(match.c_str(), item);
-      } else {
-        tree_->InsertLiteral(match.c_str(), item);
-      }
-
-      paths_.insert({match.c_str(), item->path_type});
+    for (auto& match : matches) {
+      expansion.paths.insert({match.c_str(), item->path_type});
+      expansion.matches.emplace_back(std::move(match), item);
     }
   }
 
-  return true;
+  return expansion;
 }
 
-void DataWatchItems::FindPolicies(IterateTargetsBlock iterateTargetsBlock) const {
-  iterateTargetsBlock(
-      ^std::optional<std::shared_ptr<WatchItemPolicyBase>>(const std::string& path) {
-        return tree_->LookupLongestMatchingPrefix(path);
-      });
+bool DataWatchItems::Build(SetSharedDataWatchItemPolicy data_policies) {
+  return Build(Expand(data_policies));
+}
+
+bool DataWatchItems::Build(Expansion expansion) {
+  PolicyTree::Builder builder;
+
+  for (const auto& [match, item] : expansion.matches) {
+    if (item->path_type == WatchItemPathType::kPrefix) {
+      builder.InsertPrefix(match, item);
+    } else {
+      builder.InsertLiteral(match, item);
+    }
+  }
+
+  paths_ = std::move(expansion.paths);
+  tree_ = std::make_shared<const PolicyTree>(std::move(builder).Build());
+
+  return true;
 }
 
 #pragma mark ProcessWatchItems
 
 bool ProcessWatchItems::Build(SetSharedProcessWatchItemPolicy proc_policies) {
   policies_ = std::move(proc_policies);
+
+  ordered_policies_.clear();
+  by_cdhash_.clear();
+  by_signing_id_.clear();
+  by_team_id_.clear();
+  by_binary_path_.clear();
+  platform_binary_.clear();
+  unindexed_.clear();
+
+  ordered_policies_.reserve(policies_.size());
+  for (const auto& p : policies_) {
+    size_t policy_index = ordered_policies_.size();
+    ordered_policies_.push_back(p);
+    for (const WatchItemProcess& proc : p->processes) {
+      IndexProcess(proc, policy_index);
+    }
+  }
+
   return true;
 }
 
+// A process must match every attribute of an entry, so the entry only needs to
+// be found through one of them. Certificate hashes are never used since they
+// can't be known without reading the executable.
+void ProcessWatchItems::IndexProcess(const WatchItemProcess& proc, size_t policy_index) {
+  PolicyIndexes* indexes;
+  if (proc.cdhash.size() == CS_CDHASH_LEN) {
+    indexes = &by_cdhash_[std::string(proc.cdhash.begin(), proc.cdhash.end())];
+  } else if (!proc.signing_id.empty() && proc.signing_id_wildcard_pos == std::string::npos) {
+    indexes = &by_signing_id_[proc.signing_id];
+  } else if (!proc.team_id.empty()) {
+    indexes = &by_team_id_[proc.team_id];
+  } else if (!proc.binary_path.empty()) {
+    indexes = &by_binary_path_[proc.binary_path];
+  } else if (proc.platform_binary) {
+    indexes = &platform_binary_;
+  } else {
+    indexes = &unindexed_;
+  }
+
+  // Policies are indexed in order, so a policy with several entries under the
+  // same key is only added once.
+  if (indexes->empty() || indexes->back() != policy_index) {
+    indexes->push_back(policy_index);
+  }
+}
+
 void ProcessWatchItems::IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock) {
-  for (const auto& p : policies_) {
+  for (const auto& p : ordered_policies_) {
     bool stop = checkPolicyBlock(p);
     if (stop) {
       break;
@@ -757,6 +820,41 @@ void ProcessWatchItems::IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock
   }
 }
 
+void ProcessWatchItems::IterateCandidateProcessPolicies(const ProcessPolicyLookupKeys& keys,
+                                                        CheckPolicyBlock checkPolicyBlock) {
+  PolicyIndexes candidates;
+  auto add_candidates = [&candidates](const PolicyIndexMap& map, std::string_view key) {
+    if (key.empty()) return;
+    if (auto it = map.find(key); it != map.end()) {
+      candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    }
+  };
+
+  // Entries with code signing attributes can only match signed processes.
+  if (keys.is_signed) {
+    add_candidates(by_cdhash_, keys.cdhash);
+    add_candidates(by_signing_id_, keys.signing_id);
+    add_candidates(by_team_id_, keys.team_id);
+  }
+  add_candidates(by_binary_path_, keys.binary_path);
+
+  // The platform binary requirement is only checked for signed processes.
+  if (keys.is_platform_binary || !keys.is_signed) {
+    candidates.insert(candidates.end(), platform_binary_.begin(), platform_binary_.end());
+  }
+  candidates.insert(candidates.end(), unindexed_.begin(), unindexed_.end());
+
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+  for (size_t policy_index : candidates) {
+    bool stop = checkPolicyBlock(ordered_policies_[policy_index]);
+    if (stop) {
+      break;
+    }
+  }
+}
+
 #pragma mark WatchItems
 
 std::shared_ptr<WatchItems> WatchItems::CreateFromPath(NSString* config_path,
@@ -803,7 +901,16 @@ WatchItems::WatchItems(PassKey, DataSource data_source, NSString* config_path, N
       config_path_(config_path),
       embedded_config_(config),
       q_(q),
-      periodic_task_complete_f_(periodic_task_complete_f) {}
+      periodic_task_complete_f_(periodic_task_complete_f),
+      data_policy_tree_(data_watch_items_.Tree()) {
+  config_watch_q_ = dispatch_queue_create("com.northpolesec.santa.daemon.watch_items.config_watch",
+                                          DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+}
+
+WatchItems::~WatchItems() {
+  absl::MutexLock lock(lock_);
+  StopConfigFileWatchLocked();
+}
 
 bool WatchItems::IsValidRule(NSString* name, NSDictionary* rule, NSError** error,
                              NSString* policyVersion) {
@@ -878,6 +985,8 @@ void WatchItems::UpdateCurrentState(DataWatchItems new_data_watch_items,
     SetPairPathAndType paths_to_stop_watching = data_watch_items_ - new_data_watch_items;
 
     std::swap(data_watch_items_, new_data_watch_items);
+    std::atomic_store_explicit(&data_policy_tree_, data_watch_items_.Tree(),
+                               std::memory_order_release);
     std::swap(proc_watch_items_, new_proc_watch_items);
     current_config_ = new_config;
     if (new_config) {
@@ -924,26 +1033,52 @@ void WatchItems::UpdateCurrentState(DataWatchItems new_data_watch_items,
 }
 
 void WatchItems::ReloadConfig(NSDictionary* new_config) {
-  DataWatchItems new_data_watch_items;
-  ProcessWatchItems new_proc_watch_items;
-  uint64_t rules_loaded = 0;
+  absl::MutexLock reload_lock(reload_lock_);
 
-  if (new_config) {
+  // The config read on each reload tick is the same object as long as it
+  // hasn't changed, in which case its rules don't need to be parsed again.
+  bool config_unchanged = (new_config == parsed_config_);
+  if (!config_unchanged) {
     SetSharedDataWatchItemPolicy new_data_policies;
     SetSharedProcessWatchItemPolicy new_proc_policies;
-    NSError* err;
-    if (!ParseConfig(new_config, &new_data_policies, &new_proc_policies, &rules_loaded, &err)) {
-      LOGE(@"Failed to parse watch item config: %@",
-           err ? err.localizedDescription : @"Unknown failure");
-      return;
+    uint64_t rules_loaded = 0;
+
+    if (new_config) {
+      NSError* err;
+      if (!ParseConfig(new_config, &new_data_policies, &new_proc_policies, &rules_loaded, &err)) {
+        LOGE(@"Failed to parse watch item config: %@",
+             err ? err.localizedDescription : @"Unknown failure");
+        return;
+      }
     }
 
-    new_data_watch_items.Build(std::move(new_data_policies));
-    new_proc_watch_items.Build(std::move(new_proc_policies));
+    parsed_config_ = new_config;
+    parsed_data_policies_ = std::move(new_data_policies);
+    parsed_proc_policies_ = std::move(new_proc_policies);
+    parsed_rules_loaded_ = rules_loaded;
   }
 
+  // Globs are always expanded again since matching paths may have been created
+  // or removed. If they match the same paths as before, the current policy tree
+  // is kept.
+  DataWatchItems::Expansion expansion = DataWatchItems::Expand(parsed_data_policies_);
+  if (config_unchanged && IsCurrentState(new_config, expansion.paths)) {
+    LOGD(@"No changes to set of watched paths.");
+    return;
+  }
+
+  DataWatchItems new_data_watch_items;
+  new_data_watch_items.Build(std::move(expansion));
+  ProcessWatchItems new_proc_watch_items;
+  new_proc_watch_items.Build(parsed_proc_policies_);
+
   UpdateCurrentState(std::move(new_data_watch_items), std::move(new_proc_watch_items), new_config,
-                     rules_loaded);
+                     parsed_rules_loaded_);
+}
+
+bool WatchItems::IsCurrentState(NSDictionary* config, const SetPairPathAndType& paths) {
+  absl::ReaderMutexLock lock(lock_);
+  return current_config_ == config && data_watch_items_.Paths() == paths;
 }
 
 NSDictionary* WatchItems::ReadConfig() {
@@ -953,13 +1088,67 @@ NSDictionary* WatchItems::ReadConfig() {
 
 NSDictionary* WatchItems::ReadConfigLocked() {
   if (config_path_) {
-    return [NSDictionary dictionaryWithContentsOfFile:config_path_];
+    return ReadConfigFile(config_path_);
   } else {
     return nil;
   }
 }
 
+// Returns the last config read from the path if the file hasn't been replaced
+// or modified, or if its contents are the same, so unchanged configs are
+// neither parsed as a plist nor as rules again.
+NSDictionary* WatchItems::ReadConfigFile(NSString* path) {
+  absl::MutexLock lock(config_file_lock_);
+
+  struct stat sb;
+  if (stat(path.fileSystemRepresentation, &sb) != 0) {
+    config_file_ = {};
+    return nil;
+  }
+
+  bool same_path = config_file_.config && [config_file_.path isEqualToString:path];
+  if (same_path && config_file_.dev == sb.st_dev && config_file_.ino == sb.st_ino &&
+      config_file_.size == sb.st_size &&
+      config_file_.mtime.tv_sec == sb.st_mtimespec.tv_sec &&
+      config_file_.mtime.tv_nsec == sb.st_mtimespec.tv_nsec &&
+      config_file_.ctime.tv_sec == sb.st_ctimespec.tv_sec &&
+      config_file_.ctime.tv_nsec == sb.st_ctimespec.tv_nsec) {
+    return config_file_.config;
+  }
+
+  NSData* data = [NSData dataWithContentsOfFile:path];
+  if (!data) {
+    config_file_ = {};
+    return nil;
+  }
+
+  std::array<uint8_t, CC_SHA256_DIGEST_LENGTH> digest;
+  CC_SHA256(data.bytes, (CC_LONG)data.length, digest.data());
+
+  if (!same_path || config_file_.digest != digest) {
+    id plist = [NSPropertyListSerialization propertyListWithData:data
+                                                         options:NSPropertyListImmutable
+                                                          format:nil
+                                                           error:nil];
+    config_file_.path = [path copy];
+    config_file_.digest = digest;
+    config_file_.config = [plist isKindOfClass:[NSDictionary class]] ? plist : nil;
+  }
+
+  config_file_.dev = sb.st_dev;
+  config_file_.ino = sb.st_ino;
+  config_file_.size = sb.st_size;
+  config_file_.mtime = sb.st_mtimespec;
+  config_file_.ctime = sb.st_ctimespec;
+
+  return config_file_.config;
+}
+
 bool WatchItems::OnTimer() {
+  // Changes to the config file are normally applied as soon as they happen.
+  // The timer still reloads in case a change was missed, and to expand globs
+  // against the current filesystem.
+  UpdateConfigFileWatch(false);
   ReloadConfig(embedded_config_ ?: ReadConfig());
 
   if (periodic_task_complete_f_) {
@@ -969,9 +1158,140 @@ bool WatchItems::OnTimer() {
   return true;
 }
 
+void WatchItems::UpdateConfigFileWatch(bool force) {
+  absl::MutexLock lock(lock_);
+
+  NSString* path = (data_source_ == DataSource::kDetachedConfig) ? config_path_ : nil;
+  if (!force && config_file_source_ &&
+      (path == watched_config_path_ || [path isEqualToString:watched_config_path_])) {
+    return;
+  }
+
+  StopConfigFileWatchLocked();
+  if (!path) {
+    return;
+  }
+
+  watched_config_path_ = [path copy];
+
+  // Editors and config management commonly replace the file by renaming a new
+  // one over it, which only shows up as a change to the directory.
+  NSString* dir = path.stringByDeletingLastPathComponent;
+  config_dir_source_ = CreateConfigWatchSource(dir.length ? dir.fileSystemRepresentation : ".",
+                                               DISPATCH_VNODE_WRITE, true);
+
+  // The file may not exist yet, in which case the directory watch notices
+  // when it is created.
+  config_file_source_ = CreateConfigWatchSource(
+      path.fileSystemRepresentation,
+      DISPATCH_VNODE_WRITE | DISPATCH_VNODE_EXTEND | DISPATCH_VNODE_ATTRIB |
+          DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME | DISPATCH_VNODE_REVOKE,
+      false);
+}
+
+void WatchItems::StopConfigFileWatchLocked() {
+  if (config_file_source_) {
+    dispatch_source_cancel(config_file_source_);
+    config_file_source_ = nullptr;
+  }
+  if (config_dir_source_) {
+    dispatch_source_cancel(config_dir_source_);
+    config_dir_source_ = nullptr;
+  }
+  watched_config_path_ = nil;
+}
+
+dispatch_source_t WatchItems::CreateConfigWatchSource(const char* path, unsigned long mask,
+                                                      bool is_dir) {
+  int fd = open(path, O_EVTONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  dispatch_source_t source =
+      dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, fd, mask, config_watch_q_);
+  if (!source) {
+    close(fd);
+    return nullptr;
+  }
+
+  std::weak_ptr<WatchItems> weak_self = weak_from_base<WatchItems>();
+  dispatch_source_set_event_handler(source, ^{
+    std::shared_ptr<WatchItems> strong_self = weak_self.lock();
+    if (!strong_self) {
+      return;
+    }
+
+    // A directory change or the file going away means the watched file may
+    // have been replaced by another one.
+    unsigned long events = dispatch_source_get_data(source);
+    bool replaced =
+        events & (DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME | DISPATCH_VNODE_REVOKE);
+    strong_self->OnConfigFileEvent(is_dir || replaced);
+  });
+  dispatch_source_set_cancel_handler(source, ^{
+    close(fd);
+  });
+  dispatch_resume(source);
+
+  return source;
+}
+
+void WatchItems::OnConfigFileEvent(bool rearm) {
+  config_rearm_pending_ |= rearm;
+
+  // Writes usually come in bursts. Let them settle and reload once.
+  if (config_reload_pending_) {
+    return;
+  }
+  config_reload_pending_ = true;
+
+  std::weak_ptr<WatchItems> weak_self = weak_from_base<WatchItems>();
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kConfigFileSettleNS), config_watch_q_, ^{
+    std::shared_ptr<WatchItems> strong_self = weak_self.lock();
+    if (!strong_self) {
+      return;
+    }
+
+    strong_self->config_reload_pending_ = false;
+    if (strong_self->config_rearm_pending_) {
+      strong_self->config_rearm_pending_ = false;
+      strong_self->UpdateConfigFileWatch(true);
+    }
+
+    NSDictionary* config;
+    {
+      // The config may have been switched away from the file since the event
+      absl::ReaderMutexLock lock(strong_self->lock_);
+      if (strong_self->data_source_ != DataSource::kDetachedConfig) {
+        return;
+      }
+      config = strong_self->ReadConfigLocked();
+    }
+
+    LOGD(@"File access policy file changed, reloading");
+    strong_self->ReloadConfig(config);
+  });
+}
+
 void WatchItems::FindPoliciesForTargets(IterateTargetsBlock iterateTargetsBlock) {
-  absl::ReaderMutexLock lock(lock_);
-  data_watch_items_.FindPolicies(iterateTargetsBlock);
+  // Lookups use the tree that was current when they started and don't contend
+  // with config reloads.
+  std::shared_ptr<const DataWatchItems::PolicyTree> tree =
+      std::atomic_load_explicit(&data_policy_tree_, std::memory_order_acquire);
+  iterateTargetsBlock(
+      ^std::optional<std::shared_ptr<WatchItemPolicyBase>>(const std::string& path) {
+        return tree->LookupLongestMatchingPrefix(path);
+      });
+}
+
+PolicyLookupResults WatchItems::FindPoliciesForPaths(const std::vector<std::string_view>& paths) {
+  std::shared_ptr<const DataWatchItems::PolicyTree> tree =
+      std::atomic_load_explicit(&data_policy_tree_, std::memory_order_acquire);
+  std::vector<std::optional<std::shared_ptr<DataWatchItemPolicy>>> policies =
+      tree->LookupLongestMatchingPrefixes(paths);
+  return PolicyLookupResults(std::make_move_iterator(policies.begin()),
+                             std::make_move_iterator(policies.end()));
 }
 
 void WatchItems::IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock) {
@@ -979,12 +1299,19 @@ void WatchItems::IterateProcessPolicies(CheckPolicyBlock checkPolicyBlock) {
   proc_watch_items_.IterateProcessPolicies(checkPolicyBlock);
 }
 
+void WatchItems::IterateCandidateProcessPolicies(const ProcessPolicyLookupKeys& keys,
+                                                 CheckPolicyBlock checkPolicyBlock) {
+  absl::ReaderMutexLock lock(lock_);
+  proc_watch_items_.IterateCandidateProcessPolicies(keys, checkPolicyBlock);
+}
+
 void WatchItems::SetDBRules(NSDictionary* rules) {
   {
     absl::MutexLock lock(lock_);
     config_path_ = nil;
     embedded_config_ = @{kWatchItemConfigKeyWatchItems : rules};
     data_source_ = DataSource::kDatabase;
+    StopConfigFileWatchLocked();
   }
   ReloadConfig(embedded_config_);
 }
@@ -1000,6 +1327,7 @@ void WatchItems::SetConfigPath(NSString* config_path) {
     data_source_ = DataSource::kDetachedConfig;
     config = ReadConfigLocked();
   }
+  UpdateConfigFileWatch(false);
   ReloadConfig(config);
 }
 
@@ -1009,10 +1337,17 @@ void WatchItems::SetConfig(NSDictionary* config) {
     config_path_ = nil;
     embedded_config_ = config;
     data_source_ = DataSource::kEmbeddedConfig;
+    StopConfigFileWatchLocked();
   }
   ReloadConfig(embedded_config_);
 }
 
+size_t WatchItems::DataPolicyTreeBytes() {
+  std::shared_ptr<const DataWatchItems::PolicyTree> tree =
+      std::atomic_load_explicit(&data_policy_tree_, std::memory_order_acquire);
+  return tree->MemoryUsageBytes();
+}
+
 std::optional<WatchItemsState> WatchItems::State() {
   absl::ReaderMutexLock lock(lock_);
 
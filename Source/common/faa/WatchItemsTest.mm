@@ -26,6 +26,7 @@
 #include <map>
 #include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <variant>
 #include <vector>
@@ -86,6 +87,7 @@ class WatchItemsPeer : public WatchItems {
                    periodic_task_complete_f) {}
 
   using WatchItems::ForceSetIntervalForTestingUnsafe;
+  using WatchItems::ReadConfig;
   using WatchItems::ReloadConfig;
   using WatchItems::SetConfig;
   using WatchItems::SetConfigPath;
@@ -309,6 +311,37 @@ BlockGenResult CreatePolicyBlockGen() {
   }
 }
 
+- (void)testReadConfigReusesUnchangedFile {
+  NSString* configPath = [self.testDir stringByAppendingPathComponent:@"config.plist"];
+  NSDictionary* config = WrapWatchItemsConfig(
+      @{@"rule" : @{kWatchItemConfigKeyPaths : @[ MakeTestDirPath(@"a", self.testDir) ]}});
+  XCTAssertTrue([config writeToFile:configPath atomically:YES]);
+
+  auto watchItems = std::make_shared<WatchItemsPeer>(configPath, nullptr);
+
+  NSDictionary* first = watchItems->ReadConfig();
+  XCTAssertEqualObjects(first, config);
+
+  // An untouched file isn't read again
+  XCTAssertEqual(watchItems->ReadConfig(), first);
+
+  // Replacing the file with the same contents keeps the parsed config
+  XCTAssertTrue([config writeToFile:configPath atomically:YES]);
+  XCTAssertEqual(watchItems->ReadConfig(), first);
+
+  // New contents are picked up
+  NSDictionary* newConfig = WrapWatchItemsConfig(
+      @{@"rule" : @{kWatchItemConfigKeyPaths : @[ MakeTestDirPath(@"b", self.testDir) ]}});
+  XCTAssertTrue([newConfig writeToFile:configPath atomically:YES]);
+  NSDictionary* second = watchItems->ReadConfig();
+  XCTAssertNotEqual(second, first);
+  XCTAssertEqualObjects(second, newConfig);
+
+  // A missing file has no config
+  XCTAssertTrue([self.fileMgr removeItemAtPath:configPath error:nil]);
+  XCTAssertNil(watchItems->ReadConfig());
+}
+
 - (void)testPeriodicTask {
   // Ensure watch item policy memory is properly handled
   [self createTestDirStructure:@[ @"f1", @"f2", @"weird1" ]];
@@ -372,6 +405,43 @@ BlockGenResult CreatePolicyBlockGen() {
   XCTAssertTrue(targetPolicies[0].has_value());
 }
 
+- (void)testConfigFileChangesAppliedBeforeNextTick {
+  [self createTestDirStructure:@[ @"f1" ]];
+
+  NSString* configPath = [self.testDir stringByAppendingPathComponent:@"config.plist"];
+  NSDictionary* fFiles = @{kWatchItemConfigKeyPaths : @[ MakeTestDirPath(@"f1", self.testDir) ]};
+  XCTAssertTrue([WrapWatchItemsConfig(@{}) writeToFile:configPath atomically:YES]);
+
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  auto watchItems = std::make_shared<WatchItemsPeer>(configPath, self.q, ^{
+    dispatch_semaphore_signal(sema);
+  });
+
+  // Only the first tick runs during the test
+  watchItems->ForceSetIntervalForTestingUnsafe(600);
+  watchItems->StartTimer();
+  XCTAssertSemaTrue(sema, 5, "Periodic task did not complete within expected window");
+
+  auto [targetPolicies, blockGen] = CreatePolicyBlockGen();
+  std::string f1Path = MakePathTarget("f1", self.testDir);
+  watchItems->FindPoliciesForTargets(blockGen({f1Path}));
+  XCTAssertFalse(targetPolicies[0].has_value());
+
+  // Replacing the file is noticed without waiting for the timer
+  XCTAssertTrue([WrapWatchItemsConfig(@{@"f_files" : fFiles}) writeToFile:configPath
+                                                              atomically:YES]);
+
+  bool found = false;
+  for (int i = 0; i < 50 && !found; i++) {
+    usleep(100 * USEC_PER_MSEC);
+    watchItems->FindPoliciesForTargets(blockGen({f1Path}));
+    found = targetPolicies[0].has_value();
+  }
+  XCTAssertTrue(found);
+
+  watchItems->StopTimer();
+}
+
 - (void)testPolicyLookup {
   // Test multiple, more comprehensive policies before/after config reload
   // Note: This test doesn't use glob chars, so no need to create FS artifacts since
@@ -454,6 +524,21 @@ BlockGenResult CreatePolicyBlockGen() {
       XCTAssertCStringEqual(targetPolicies[0].value_or(MakeBadPolicy())->name.c_str(),
                             kv.second.data());
     }
+
+    // Batched lookups return the same policies in the order of the given paths
+    std::string fooPath = MakePathTarget("/foo");
+    std::string barTxtPath = MakePathTarget("/foo/bar.txt");
+    std::string barTxtTmpPath = MakePathTarget("/foo/bar.txt.tmp");
+    std::string missingPath = MakePathTarget("/does/not/exist");
+    santa::PolicyLookupResults policies =
+        watchItems->FindPoliciesForPaths({barTxtTmpPath, missingPath, barTxtPath, fooPath});
+    XCTAssertEqual(policies.size(), 4);
+    XCTAssertCStringEqual(policies[0].value_or(MakeBadPolicy())->name.c_str(), "foo_subdir");
+    XCTAssertFalse(policies[1].has_value());
+    XCTAssertCStringEqual(policies[2].value_or(MakeBadPolicy())->name.c_str(), "bar_txt");
+    XCTAssertCStringEqual(policies[3].value_or(MakeBadPolicy())->name.c_str(), "foo_subdir");
+
+    XCTAssertEqual(watchItems->FindPoliciesForPaths({}).size(), 0);
   }
 
   // Add a catch-all policy that should only affect the previously non-matching path
@@ -1449,6 +1534,14 @@ BlockGenResult CreatePolicyBlockGen() {
   matches = FindMatches(MakeTestDirPath(@"/tmp/*/apps/*"));
   XCTAssertEqual(matches.size(), 0);
 
+  // Streamed matches are the same ones, in no particular order
+  std::vector<std::string> streamed;
+  FindMatches(MakeTestDirPath(@"/tmp/*/app/*/plugins/*"),
+              [&streamed](const std::string& match) { streamed.push_back(match); });
+  std::sort(streamed.begin(), streamed.end());
+  XCTAssertEqual(streamed.size(), 4);
+  XCTAssertTrue(streamed == FindMatches(MakeTestDirPath(@"/tmp/*/app/*/plugins/*")));
+
   matches = FindMatches(MakeTestDirPath(@"/*"));
   XCTAssertEqual(matches.size(), 1);
   XCTAssertCppStringEndsWith(matches[0], "/tmp");
@@ -1578,4 +1671,116 @@ BlockGenResult CreatePolicyBlockGen() {
   XCTAssertEqual(pathTypePairs2_1.count({"/z", WatchItemPathType::kPrefix}), 1);
 }
 
+- (void)testProcessWatchItemsCandidatePolicies {
+  std::shared_ptr<ProcessWatchItemPolicy> (^MakeProcPolicy)(std::string, WatchItemProcess) =
+      ^std::shared_ptr<ProcessWatchItemPolicy>(std::string name, WatchItemProcess proc) {
+    return std::make_shared<ProcessWatchItemPolicy>(
+        name, "v1", SetPairPathAndType{PairPathAndType{"/p", WatchItemPathType::kLiteral}}, true,
+        true, santa::WatchItemRuleType::kProcessesWithAllowedPaths, false, false, "", nil, nil,
+        SetWatchItemProcess{proc});
+  };
+
+  std::vector<uint8_t> cdhash(CS_CDHASH_LEN, 0xAA);
+  SetSharedProcessWatchItemPolicy policies{
+      MakeProcPolicy("cdhash", WatchItemProcess("", "", "", cdhash, "", false)),
+      MakeProcPolicy("sid", WatchItemProcess("", "com.example.sid", "ABCDEF1234", {}, "", false)),
+      MakeProcPolicy("tid", WatchItemProcess("", "com.example.*", "ABCDEF1234", {}, "", false)),
+      MakeProcPolicy("path", WatchItemProcess("/bin/foo", "", "", {}, "", false)),
+      MakeProcPolicy("platform", WatchItemProcess("", "", "", {}, "", true)),
+      MakeProcPolicy("cert", WatchItemProcess("", "", "", {}, "abc", false)),
+      MakeProcPolicy("other_tid", WatchItemProcess("", "", "ZZZZZZZZZZ", {}, "", false)),
+  };
+
+  santa::ProcessWatchItems watchItems;
+  watchItems.Build(policies);
+
+  // Blocks can't copy the watch items
+  santa::ProcessWatchItems* items = &watchItems;
+  std::vector<std::string> (^Candidates)(santa::ProcessPolicyLookupKeys) =
+      ^(santa::ProcessPolicyLookupKeys keys) {
+        __block std::vector<std::string> names;
+        items->IterateCandidateProcessPolicies(
+            keys, ^bool(std::shared_ptr<ProcessWatchItemPolicy> policy) {
+              names.push_back(policy->name);
+              return false;
+            });
+        std::sort(names.begin(), names.end());
+        return names;
+      };
+
+  std::string cdhashKey(cdhash.begin(), cdhash.end());
+  std::string otherCdhash(CS_CDHASH_LEN, '\x01');
+
+  // A signed process with the indexed signing ID, team ID and cdhash
+  XCTAssertTrue((Candidates({
+                    .binary_path = "/bin/bar",
+                    .signing_id = "com.example.sid",
+                    .team_id = "ABCDEF1234",
+                    .cdhash = cdhashKey,
+                    .is_signed = true,
+                    .is_platform_binary = false,
+                }) == std::vector<std::string>{"cdhash", "cert", "sid", "tid"}));
+
+  // A signed platform binary at the indexed path
+  XCTAssertTrue((Candidates({
+                    .binary_path = "/bin/foo",
+                    .signing_id = "com.apple.foo",
+                    .team_id = "",
+                    .cdhash = otherCdhash,
+                    .is_signed = true,
+                    .is_platform_binary = true,
+                }) == std::vector<std::string>{"cert", "path", "platform"}));
+
+  // Unsigned processes aren't candidates for code signing attributes, even if
+  // they happen to have them.
+  XCTAssertTrue((Candidates({
+                    .binary_path = "/bin/foo",
+                    .signing_id = "com.example.sid",
+                    .team_id = "ABCDEF1234",
+                    .cdhash = "",
+                    .is_signed = false,
+                    .is_platform_binary = false,
+                }) == std::vector<std::string>{"cert", "path", "platform"}));
+
+  // Candidates are visited in the same order as a full iteration
+  __block std::vector<std::string> allOrder;
+  watchItems.IterateProcessPolicies(^bool(std::shared_ptr<ProcessWatchItemPolicy> policy) {
+    allOrder.push_back(policy->name);
+    return false;
+  });
+  __block std::vector<std::string> candidateOrder;
+  watchItems.IterateCandidateProcessPolicies(
+      {
+          .binary_path = "/bin/foo",
+          .signing_id = "com.example.sid",
+          .team_id = "ABCDEF1234",
+          .cdhash = cdhashKey,
+          .is_signed = true,
+          .is_platform_binary = true,
+      },
+      ^bool(std::shared_ptr<ProcessWatchItemPolicy> policy) {
+        candidateOrder.push_back(policy->name);
+        return false;
+      });
+  allOrder.erase(std::remove(allOrder.begin(), allOrder.end(), "other_tid"), allOrder.end());
+  XCTAssertTrue(candidateOrder == allOrder);
+
+  // Stopping iteration early is honored
+  __block int visited = 0;
+  watchItems.IterateCandidateProcessPolicies(
+      {
+          .binary_path = "/bin/foo",
+          .signing_id = "",
+          .team_id = "",
+          .cdhash = "",
+          .is_signed = false,
+          .is_platform_binary = false,
+      },
+      ^bool(std::shared_ptr<ProcessWatchItemPolicy> policy) {
+        visited++;
+        return true;
+      });
+  XCTAssertEqual(visited, 1);
+}
+
 @end
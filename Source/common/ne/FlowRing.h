@@ -0,0 +1,204 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_NE_FLOWRING_H
+#define SANTA_COMMON_NE_FLOWRING_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <optional>
+#include <type_traits>
+
+namespace santa {
+
+/// A network flow report in the fixed layout carried by FlowRing, one record
+/// per flow per santanetd reporting window. Integers are in host byte order,
+/// addresses in network byte order. Enumerations use the values of the
+/// corresponding santa.proto NetworkActivity.Flow enums.
+///
+/// Flows with fields that don't fit a record, such as a remote hostname or a
+/// matched rule name, are reported over XPC instead.
+struct FlowRecord {
+  // Reporting window, in nanoseconds since the epoch
+  uint64_t window_start_ns;
+  uint64_t window_end_ns;
+
+  // Cumulative byte counts
+  uint64_t bytes_inbound;
+  uint64_t bytes_outbound;
+
+  // Nanoseconds since the epoch, or 0 if the flow didn't start or close
+  // during the window
+  uint64_t start_time_ns;
+  uint64_t close_time_ns;
+
+  // Together with flow_id, uniquely identifies the flow
+  uint64_t flow_hash;
+  // Winning rule id, or 0 if no rule matched
+  int64_t rule_id;
+  // The flow identifier UUID
+  uint8_t flow_id[16];
+
+  // IPv4 addresses use the first 4 bytes
+  uint8_t remote_address[16];
+  uint8_t local_address[16];
+
+  int32_t pid;
+  int32_t pidversion;
+  uint16_t remote_port;
+  uint16_t local_port;
+  uint8_t protocol;
+  uint8_t socket_family;
+  uint8_t direction;
+  uint8_t decision;
+};
+
+static_assert(sizeof(FlowRecord) == 128);
+static_assert(std::is_trivially_copyable_v<FlowRecord>);
+
+/// A single producer, single consumer ring of FlowRecords laid out in a
+/// caller-provided memory region, so it can be shared between processes.
+///
+/// The producer (santanetd) only writes the records and the head index, and
+/// the consumer (santad) only writes the tail index. Neither side trusts the
+/// other's index: records are copied out before being handed to the consumer,
+/// and an inconsistent head skips everything published so far rather than
+/// reading outside the ring. When the ring is full, the producer drops the
+/// record and counts it.
+class FlowRing {
+ public:
+  static constexpr uint32_t kMagic = 0x534e4652;  // "SNFR"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr uint32_t kMinCapacity = 64;
+  static constexpr uint32_t kMaxCapacity = 1 << 20;
+
+  /// The size of the region needed for a ring of the given capacity.
+  static size_t RegionSize(uint32_t capacity) {
+    return sizeof(Header) + static_cast<size_t>(capacity) * sizeof(FlowRecord);
+  }
+
+  /// Lay out an empty ring in region, which must be at least RegionSize()
+  /// bytes and suitably aligned, e.g. page aligned. Capacity must be a power of
+  /// two between kMinCapacity and kMaxCapacity.
+  static std::optional<FlowRing> Create(void* region, size_t size, uint32_t capacity) {
+    if (!ValidCapacity(capacity) || size < RegionSize(capacity)) {
+      return std::nullopt;
+    }
+
+    Header* header = new (region) Header();
+    header->magic = kMagic;
+    header->version = kVersion;
+    header->record_size = sizeof(FlowRecord);
+    header->capacity = capacity;
+    return FlowRing(header, capacity);
+  }
+
+  /// Attach to a ring laid out by Create, e.g. in another process.
+  static std::optional<FlowRing> Attach(void* region, size_t size) {
+    if (size < sizeof(Header)) {
+      return std::nullopt;
+    }
+
+    Header* header = static_cast<Header*>(region);
+    uint32_t capacity = header->capacity;
+    if (header->magic != kMagic || header->version != kVersion ||
+        header->record_size != sizeof(FlowRecord) || !ValidCapacity(capacity) ||
+        size < RegionSize(capacity)) {
+      return std::nullopt;
+    }
+    return FlowRing(header, capacity);
+  }
+
+  /// Producer only. Returns false, counting the record as dropped, if the ring
+  /// is full.
+  bool TryPush(const FlowRecord& record) {
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    if (head - tail >= capacity_) {
+      header_->dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    std::memcpy(&Records()[head & (capacity_ - 1)], &record, sizeof(FlowRecord));
+    header_->head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Consumer only. Calls f with a copy of each published record, oldest
+  /// first, up to max records. Returns the number of records consumed.
+  template <typename F>
+  size_t Drain(F&& f, size_t max = std::numeric_limits<size_t>::max()) {
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (head - tail > capacity_) {
+      header_->tail.store(head, std::memory_order_release);
+      return 0;
+    }
+
+    size_t count = static_cast<size_t>(std::min<uint64_t>(head - tail, max));
+    for (size_t i = 0; i < count; i++) {
+      FlowRecord record;
+      std::memcpy(&record, &Records()[(tail + i) & (capacity_ - 1)], sizeof(FlowRecord));
+      f(record);
+    }
+    header_->tail.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  /// The number of records the producer has dropped because the ring was full.
+  uint64_t Dropped() const { return header_->dropped.load(std::memory_order_relaxed); }
+
+  uint32_t Capacity() const { return capacity_; }
+
+ private:
+  static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+  // Producer and consumer indexes are on separate cache lines
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t capacity;
+    alignas(64) std::atomic<uint64_t> head = 0;
+    std::atomic<uint64_t> dropped = 0;
+    alignas(64) std::atomic<uint64_t> tail = 0;
+  };
+
+  static_assert(sizeof(Header) % alignof(FlowRecord) == 0);
+
+  static bool ValidCapacity(uint32_t capacity) {
+    return capacity >= kMinCapacity && capacity <= kMaxCapacity && std::has_single_bit(capacity);
+  }
+
+  FlowRing(Header* header, uint32_t capacity) : header_(header), capacity_(capacity) {}
+
+  FlowRecord* Records() const {
+    return reinterpret_cast<FlowRecord*>(reinterpret_cast<uint8_t*>(header_) + sizeof(Header));
+  }
+
+  Header* header_;
+  // Read once when created or attached, since the other side could change the
+  // copy in the header.
+  uint32_t capacity_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_NE_FLOWRING_H
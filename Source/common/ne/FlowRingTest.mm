@@ -0,0 +1,147 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/ne/FlowRing.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using santa::FlowRecord;
+using santa::FlowRing;
+
+// Cache line aligned, like the page aligned shared mappings rings live in
+class Region {
+ public:
+  explicit Region(size_t size) : lines_((size + sizeof(Line) - 1) / sizeof(Line)), size_(size) {}
+
+  uint8_t* data() { return lines_.front().bytes; }
+  size_t size() const { return size_; }
+
+ private:
+  struct alignas(64) Line {
+    uint8_t bytes[64];
+  };
+
+  std::vector<Line> lines_;
+  size_t size_;
+};
+
+static FlowRecord MakeRecord(int32_t pid) {
+  FlowRecord record = {};
+  record.pid = pid;
+  return record;
+}
+
+@interface FlowRingTest : XCTestCase
+@end
+
+@implementation FlowRingTest
+
+- (void)testCreateValidatesCapacity {
+  Region region(FlowRing::RegionSize(128));
+  XCTAssertFalse(FlowRing::Create(region.data(), region.size(), 100).has_value());
+  XCTAssertFalse(FlowRing::Create(region.data(), region.size(), 32).has_value());
+  XCTAssertFalse(FlowRing::Create(region.data(), region.size(), 256).has_value());
+  XCTAssertTrue(FlowRing::Create(region.data(), region.size(), 128).has_value());
+}
+
+- (void)testAttachValidatesHeader {
+  Region region(FlowRing::RegionSize(64));
+  XCTAssertFalse(FlowRing::Attach(region.data(), region.size()).has_value());
+
+  XCTAssertTrue(FlowRing::Create(region.data(), region.size(), 64).has_value());
+  XCTAssertTrue(FlowRing::Attach(region.data(), region.size()).has_value());
+
+  // A region too small for the advertised capacity is rejected
+  XCTAssertFalse(FlowRing::Attach(region.data(), region.size() - 1).has_value());
+}
+
+- (void)testPushAndDrain {
+  Region region(FlowRing::RegionSize(64));
+  FlowRing producer = *FlowRing::Create(region.data(), region.size(), 64);
+  FlowRing consumer = *FlowRing::Attach(region.data(), region.size());
+
+  for (int32_t i = 0; i < 64; i++) {
+    XCTAssertTrue(producer.TryPush(MakeRecord(i)));
+  }
+
+  // Full rings drop records
+  XCTAssertFalse(producer.TryPush(MakeRecord(64)));
+  XCTAssertEqual(consumer.Dropped(), 1);
+
+  std::vector<int32_t> pids;
+  XCTAssertEqual(consumer.Drain([&pids](const FlowRecord& r) { pids.push_back(r.pid); }, 10), 10);
+  XCTAssertEqual(consumer.Drain([&pids](const FlowRecord& r) { pids.push_back(r.pid); }), 54);
+  XCTAssertEqual(pids.size(), 64);
+  for (int32_t i = 0; i < 64; i++) {
+    XCTAssertEqual(pids[i], i);
+  }
+
+  XCTAssertTrue(producer.TryPush(MakeRecord(100)));
+  pids.clear();
+  XCTAssertEqual(consumer.Drain([&pids](const FlowRecord& r) { pids.push_back(r.pid); }), 1);
+  XCTAssertEqual(pids[0], 100);
+}
+
+- (void)testCorruptHeadIsSkipped {
+  Region region(FlowRing::RegionSize(64));
+  FlowRing producer = *FlowRing::Create(region.data(), region.size(), 64);
+  FlowRing consumer = *FlowRing::Attach(region.data(), region.size());
+
+  // Publish further ahead than the ring could hold. The head index starts the
+  // header's second cache line.
+  uint64_t bogus_head = 1000;
+  std::memcpy(region.data() + 64, &bogus_head, sizeof(bogus_head));
+
+  int calls = 0;
+  XCTAssertEqual(consumer.Drain([&calls](const FlowRecord&) { calls++; }), 0);
+  XCTAssertEqual(calls, 0);
+
+  // Back in sync from there
+  XCTAssertTrue(producer.TryPush(MakeRecord(1)));
+  XCTAssertEqual(consumer.Drain([&calls](const FlowRecord&) { calls++; }), 1);
+  XCTAssertEqual(calls, 1);
+}
+
+- (void)testConcurrentProducerAndConsumer {
+  Region region(FlowRing::RegionSize(64));
+  FlowRing producer = *FlowRing::Create(region.data(), region.size(), 64);
+  FlowRing consumer = *FlowRing::Attach(region.data(), region.size());
+  const int32_t kRecords = 100000;
+
+  std::thread thread([&producer] {
+    for (int32_t i = 0; i < kRecords;) {
+      if (producer.TryPush(MakeRecord(i))) {
+        i++;
+      }
+    }
+  });
+
+  int32_t next = 0;
+  bool in_order = true;
+  while (next < kRecords) {
+    consumer.Drain([&](const FlowRecord& r) { in_order &= (r.pid == next++); });
+  }
+  thread.join();
+
+  XCTAssertTrue(in_order);
+  XCTAssertEqual(next, kRecords);
+}
+
+@end
@@ -47,6 +47,18 @@ typedef NS_ENUM(NSInteger, SNTNetworkFlowDefaultAction) {
 /// network-flow rules.
 @property(readonly, copy) NSArray<SNTNetworkFlowRule*>* networkFlowRules;
 
+/// Identifies the ruleset in networkFlowRules, as computed by santad's rule table. Lets santanetd
+/// key the index it builds from the rules by version, skipping a rebuild when it already holds
+/// that version and swapping the new index in whole when it doesn't. Nil when networkFlowRules is
+/// nil or the sender predates ruleset versioning. Transport-only, like networkFlowRules.
+@property(readonly, copy) NSString* networkFlowRulesHash;
+
+/// A shared memory FlowRing (see Source/common/ne/FlowRing.h) santanetd may report flows through
+/// instead of over XPC. Only set in the registration reply, and only when santad has the ring
+/// enabled. NSFileHandle can only be encoded by NSXPCCoder, so this is not carried by other
+/// archivers. Transport-only, like networkFlowRules.
+@property(readonly) NSFileHandle* networkFlowRing;
+
 /// Defaults flowDefaultAction to Unspecified and dnsUpstreamTimeoutSecs to 30s.
 - (instancetype)initWithEnable:(BOOL)enable;
 
@@ -76,4 +88,12 @@ typedef NS_ENUM(NSInteger, SNTNetworkFlowDefaultAction) {
 /// settings delta.
 - (instancetype)settingsByAttachingNetworkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules;
 
+/// As settingsByAttachingNetworkFlowRules:, also setting networkFlowRulesHash.
+- (instancetype)settingsByAttachingNetworkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                               networkFlowRulesHash:(NSString*)networkFlowRulesHash;
+
+/// Returns a copy of the receiver, including its networkFlowRules and networkFlowRulesHash, with
+/// networkFlowRing set to the given handle.
+- (instancetype)settingsByAttachingNetworkFlowRing:(NSFileHandle*)networkFlowRing;
+
 @end
@@ -48,6 +48,8 @@ NSTimeInterval NormalizeDNSUpstreamTimeout(NSTimeInterval v) {
 @property(readwrite) SNTNetworkFlowDefaultAction flowDefaultAction;
 @property(readwrite) NSTimeInterval dnsUpstreamTimeoutSecs;
 @property(readwrite, copy) NSArray<SNTNetworkFlowRule*>* networkFlowRules;
+@property(readwrite, copy) NSString* networkFlowRulesHash;
+@property(readwrite) NSFileHandle* networkFlowRing;
 @end
 
 @implementation SNTNetworkExtensionSettings
@@ -103,6 +105,22 @@ NSTimeInterval NormalizeDNSUpstreamTimeout(NSTimeInterval v) {
                                             networkFlowRules:networkFlowRules];
 }
 
+- (instancetype)settingsByAttachingNetworkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                               networkFlowRulesHash:(NSString*)networkFlowRulesHash {
+  SNTNetworkExtensionSettings* settings =
+      [self settingsByAttachingNetworkFlowRules:networkFlowRules];
+  settings.networkFlowRulesHash = networkFlowRulesHash;
+  return settings;
+}
+
+- (instancetype)settingsByAttachingNetworkFlowRing:(NSFileHandle*)networkFlowRing {
+  SNTNetworkExtensionSettings* settings =
+      [self settingsByAttachingNetworkFlowRules:self.networkFlowRules
+                           networkFlowRulesHash:self.networkFlowRulesHash];
+  settings.networkFlowRing = networkFlowRing;
+  return settings;
+}
+
 - (BOOL)isEqual:(id)other {
   if (self == other) {
     return YES;
@@ -111,10 +129,11 @@ NSTimeInterval NormalizeDNSUpstreamTimeout(NSTimeInterval v) {
     return NO;
   }
   SNTNetworkExtensionSettings* o = other;
-  // networkFlowRules is intentionally excluded. It's a transport-only field, and
-  // SNTNetworkExtensionQueue's reconcileNetworkExtensionConfig tracks the rules delta separately
-  // via a cached hash (scalars compared by value here; rules by hash). Including rules here would
-  // defeat that fast-path and force materializing/deep-comparing the full ruleset every reconcile.
+  // networkFlowRules, networkFlowRulesHash and networkFlowRing are intentionally excluded. They're
+  // transport-only, and SNTNetworkExtensionQueue's reconcileNetworkExtensionConfig tracks the rules
+  // delta separately via a cached hash (scalars compared by value here; rules by hash). Including
+  // rules here would defeat that fast-path and force materializing/deep-comparing the full ruleset
+  // every reconcile.
   return self.enable == o.enable && self.flowDefaultAction == o.flowDefaultAction &&
          self.dnsUpstreamTimeoutSecs == o.dnsUpstreamTimeoutSecs;
 }
@@ -137,6 +156,8 @@ NSTimeInterval NormalizeDNSUpstreamTimeout(NSTimeInterval v) {
   ENCODE_BOXABLE(coder, flowDefaultAction);
   ENCODE_BOXABLE(coder, dnsUpstreamTimeoutSecs);
   ENCODE(coder, networkFlowRules);
+  ENCODE(coder, networkFlowRulesHash);
+  ENCODE(coder, networkFlowRing);
 }
 
 - (instancetype)initWithCoder:(NSCoder*)decoder {
@@ -146,6 +167,8 @@ NSTimeInterval NormalizeDNSUpstreamTimeout(NSTimeInterval v) {
     DECODE_SELECTOR(decoder, flowDefaultAction, NSNumber, integerValue);
     DECODE_SELECTOR(decoder, dnsUpstreamTimeoutSecs, NSNumber, doubleValue);
     DECODE_ARRAY(decoder, networkFlowRules, SNTNetworkFlowRule);
+    DECODE(decoder, networkFlowRulesHash, NSString);
+    DECODE(decoder, networkFlowRing, NSFileHandle);
     // Missing key decodes to 0 -> NormalizeDNSUpstreamTimeout turns it into the default.
     _dnsUpstreamTimeoutSecs = NormalizeDNSUpstreamTimeout(_dnsUpstreamTimeoutSecs);
   }
@@ -392,6 +392,52 @@
   XCTAssertEqualObjects(attached, base);
 }
 
+- (void)testSettingsByAttachingNetworkFlowRulesHash {
+  NSData* blob = [@"rule" dataUsingEncoding:NSUTF8StringEncoding];
+  SNTNetworkExtensionSettings* base =
+      [[SNTNetworkExtensionSettings alloc] initWithEnable:YES
+                                        flowDefaultAction:SNTNetworkFlowDefaultActionDeny];
+  XCTAssertNil([base settingsByAttachingNetworkFlowRules:@[]].networkFlowRulesHash);
+
+  SNTNetworkExtensionSettings* attached = [base
+      settingsByAttachingNetworkFlowRules:@[ [[SNTNetworkFlowRule alloc] initAddRuleWithName:@"r"
+                                                                                      ruleId:1
+                                                                                   protoBlob:blob] ]
+                     networkFlowRulesHash:@"h1"];
+  XCTAssertEqual(attached.networkFlowRules.count, 1u);
+  XCTAssertEqualObjects(attached.networkFlowRulesHash, @"h1");
+  // Transport-only, like the rules it identifies.
+  XCTAssertEqualObjects(attached, base);
+
+  NSData* data = [NSKeyedArchiver archivedDataWithRootObject:attached
+                                       requiringSecureCoding:YES
+                                                       error:nil];
+  SNTNetworkExtensionSettings* decoded =
+      [NSKeyedUnarchiver unarchivedObjectOfClass:[SNTNetworkExtensionSettings class]
+                                        fromData:data
+                                           error:nil];
+  XCTAssertEqualObjects(decoded.networkFlowRulesHash, @"h1");
+  XCTAssertEqual(decoded.networkFlowRules.count, 1u);
+}
+
+- (void)testSettingsByAttachingNetworkFlowRing {
+  NSData* blob = [@"rule" dataUsingEncoding:NSUTF8StringEncoding];
+  SNTNetworkExtensionSettings* base = [[[SNTNetworkExtensionSettings alloc] initWithEnable:YES]
+      settingsByAttachingNetworkFlowRules:@[ [[SNTNetworkFlowRule alloc] initAddRuleWithName:@"r"
+                                                                                      ruleId:1
+                                                                                   protoBlob:blob] ]
+                     networkFlowRulesHash:@"h1"];
+  XCTAssertNil(base.networkFlowRing);
+
+  NSFileHandle* handle = [NSFileHandle fileHandleWithNullDevice];
+  SNTNetworkExtensionSettings* attached = [base settingsByAttachingNetworkFlowRing:handle];
+  XCTAssertEqual(attached.networkFlowRing, handle);
+  // The ruleset is carried over, unlike settingsByAttachingNetworkFlowRules:
+  XCTAssertEqual(attached.networkFlowRules.count, 1u);
+  XCTAssertEqualObjects(attached.networkFlowRulesHash, @"h1");
+  XCTAssertEqualObjects(attached, base);
+}
+
 - (void)testEncodingStaysReadableByDeployedDecoder {
   // A frozen older decoder — reads only `enable`, allowed-class set excludes
   // NSArray/SNTNetworkFlowRule — must still decode a current archive that also carries a
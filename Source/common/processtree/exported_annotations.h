@@ -0,0 +1,39 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_PROCESSTREE_EXPORTED_ANNOTATIONS_H
+#define SANTA_COMMON_PROCESSTREE_EXPORTED_ANNOTATIONS_H
+
+#include <string>
+#include <utility>
+
+#include "Source/common/processtree/process_tree.pb.h"
+
+namespace santa::santad::process_tree {
+
+// The merged proto form of all annotations on a process, along with its wire
+// encoding. Both are built once when the process is annotated and then shared
+// by every event from the process, so binary serializers can copy the encoded
+// bytes instead of the message.
+struct ExportedAnnotations {
+  explicit ExportedAnnotations(::santa::pb::v1::process_tree::Annotations p)
+      : proto(std::move(p)), serialized(proto.SerializeAsString()) {}
+
+  const ::santa::pb::v1::process_tree::Annotations proto;
+  const std::string serialized;
+};
+
+}  // namespace santa::santad::process_tree
+
+#endif  // SANTA_COMMON_PROCESSTREE_EXPORTED_ANNOTATIONS_H
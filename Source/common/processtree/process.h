@@ -28,7 +28,10 @@
 #include <vector>
 
 #include "Source/common/processtree/annotations/annotator.h"
-#include "absl/container/flat_hash_map.h"
+#include "Source/common/processtree/exported_annotations.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/synchronization/mutex.h"
 
 namespace santa::santad::process_tree {
 
@@ -153,8 +156,21 @@ class Process {
   // annotation storage and the parent relation in memory on the process right
   // now.
   friend class ProcessTree;
-  absl::flat_hash_map<std::type_index, std::shared_ptr<const Annotator>>
+  // At most one annotation per annotator type, and there are only a handful
+  // of annotators, so they are stored inline and searched linearly.
+  absl::InlinedVector<
+      std::pair<std::type_index, std::shared_ptr<const Annotator>>, 2>
       annotations_;
+  // The merged proto form of annotations_ and its encoding, rebuilt whenever
+  // an annotation is added so that every event from the process can share it.
+  std::shared_ptr<const ExportedAnnotations> exported_annotations_;
+  // Values built from the RootSlice of this process by
+  // ProcessTree::CachedFromRootSlice, at most one per type. Since neither the
+  // process nor its ancestors change, they never need to be invalidated.
+  mutable absl::Mutex root_slice_values_mtx_;
+  mutable absl::InlinedVector<
+      std::pair<std::type_index, std::shared_ptr<const void>>, 1>
+      root_slice_values_ ABSL_GUARDED_BY(root_slice_values_mtx_);
   std::shared_ptr<const Process> parent_;
   std::atomic<int> refcnt_;
   // If the process is tombstoned, the event removing it from the tree has been
@@ -0,0 +1,97 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/processtree/process_slab.h"
+
+#include <algorithm>
+#include <new>
+
+namespace santa::santad::process_tree {
+
+namespace {
+
+size_t RoundUpSlotSize(size_t size) {
+  // Every slot must be able to hold a free list link and stay aligned for any
+  // object placed in it.
+  constexpr size_t kAlign = alignof(std::max_align_t);
+  size = std::max(size, sizeof(void*));
+  return (size + kAlign - 1) / kAlign * kAlign;
+}
+
+}  // namespace
+
+SlabPool::SlabPool(size_t slot_size, size_t slots_per_slab)
+    : slot_size_(RoundUpSlotSize(slot_size)),
+      slots_per_slab_(std::max<size_t>(slots_per_slab, 1)) {}
+
+void* SlabPool::Allocate(size_t size, size_t alignment) {
+  if (!Fits(size, alignment)) {
+    {
+      absl::MutexLock lock(mtx_);
+      oversized_in_use_++;
+    }
+    return ::operator new(size, std::align_val_t(alignment));
+  }
+
+  absl::MutexLock lock(mtx_);
+  if (!free_list_) {
+    // operator new[] aligns to __STDCPP_DEFAULT_NEW_ALIGNMENT__, which is at
+    // least alignof(std::max_align_t), and slot sizes are multiples of it.
+    auto slab = std::make_unique<std::byte[]>(slot_size_ * slots_per_slab_);
+    for (size_t i = slots_per_slab_; i > 0; i--) {
+      auto* slot =
+          reinterpret_cast<FreeSlot*>(slab.get() + (i - 1) * slot_size_);
+      slot->next = free_list_;
+      free_list_ = slot;
+    }
+    slots_free_ += slots_per_slab_;
+    slabs_.push_back(std::move(slab));
+  }
+
+  FreeSlot* slot = free_list_;
+  free_list_ = slot->next;
+  slots_free_--;
+  slots_in_use_++;
+  return slot;
+}
+
+void SlabPool::Deallocate(void* p, size_t size, size_t alignment) {
+  if (!Fits(size, alignment)) {
+    ::operator delete(p, std::align_val_t(alignment));
+    absl::MutexLock lock(mtx_);
+    oversized_in_use_--;
+    return;
+  }
+
+  absl::MutexLock lock(mtx_);
+  auto* slot = static_cast<FreeSlot*>(p);
+  slot->next = free_list_;
+  free_list_ = slot;
+  slots_free_++;
+  slots_in_use_--;
+}
+
+SlabPool::Stats SlabPool::GetStats() const {
+  absl::ReaderMutexLock lock(mtx_);
+  return Stats{
+      .slot_size = slot_size_,
+      .slabs = slabs_.size(),
+      .slots_in_use = slots_in_use_,
+      .slots_free = slots_free_,
+      .oversized_in_use = oversized_in_use_,
+      .bytes_reserved = slabs_.size() * slots_per_slab_ * slot_size_,
+  };
+}
+
+}  // namespace santa::santad::process_tree
@@ -0,0 +1,116 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_PROCESSTREE_PROCESS_SLAB_H
+#define SANTA_COMMON_PROCESSTREE_PROCESS_SLAB_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa::santad::process_tree {
+
+// Hands out fixed-size slots carved from larger slabs, recycling freed slots
+// instead of returning them to malloc. Slabs are only released when the pool
+// is destroyed, so the pool holds on to its high-water mark.
+//
+// Requests larger than the slot size, or with stricter than default
+// alignment, fall back to operator new and are counted separately.
+class SlabPool {
+ public:
+  struct Stats {
+    size_t slot_size;
+    size_t slabs;
+    size_t slots_in_use;
+    size_t slots_free;
+    size_t oversized_in_use;
+    size_t bytes_reserved;
+  };
+
+  SlabPool(size_t slot_size, size_t slots_per_slab);
+
+  SlabPool(const SlabPool&) = delete;
+  SlabPool& operator=(const SlabPool&) = delete;
+  SlabPool(SlabPool&&) = delete;
+  SlabPool& operator=(SlabPool&&) = delete;
+
+  void* Allocate(size_t size, size_t alignment);
+  void Deallocate(void* p, size_t size, size_t alignment);
+
+  Stats GetStats() const;
+
+ private:
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  bool Fits(size_t size, size_t alignment) const {
+    return size <= slot_size_ && alignment <= alignof(std::max_align_t);
+  }
+
+  const size_t slot_size_;
+  const size_t slots_per_slab_;
+
+  mutable absl::Mutex mtx_;
+  std::vector<std::unique_ptr<std::byte[]>> slabs_ ABSL_GUARDED_BY(mtx_);
+  FreeSlot* free_list_ ABSL_GUARDED_BY(mtx_) = nullptr;
+  size_t slots_in_use_ ABSL_GUARDED_BY(mtx_) = 0;
+  size_t slots_free_ ABSL_GUARDED_BY(mtx_) = 0;
+  size_t oversized_in_use_ ABSL_GUARDED_BY(mtx_) = 0;
+};
+
+// Standard allocator backed by a SlabPool, for use with std::allocate_shared
+// so that an object and its shared_ptr control block share a single slot.
+// Each copy keeps the pool alive, so objects may outlive whoever created
+// the pool.
+template <typename T>
+class SlabAllocator {
+ public:
+  using value_type = T;
+
+  explicit SlabAllocator(std::shared_ptr<SlabPool> pool)
+      : pool_(std::move(pool)) {}
+
+  template <typename U>
+  SlabAllocator(const SlabAllocator<U>& other) : pool_(other.pool_) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(pool_->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    pool_->Deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  friend bool operator==(const SlabAllocator& lhs, const SlabAllocator& rhs) {
+    return lhs.pool_ == rhs.pool_;
+  }
+  friend bool operator!=(const SlabAllocator& lhs, const SlabAllocator& rhs) {
+    return !(lhs == rhs);
+  }
+
+ private:
+  template <typename U>
+  friend class SlabAllocator;
+
+  std::shared_ptr<SlabPool> pool_;
+};
+
+}  // namespace santa::santad::process_tree
+
+#endif  // SANTA_COMMON_PROCESSTREE_PROCESS_SLAB_H
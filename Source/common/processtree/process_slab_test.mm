@@ -0,0 +1,89 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/processtree/process_slab.h"
+
+#import <XCTest/XCTest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using santa::santad::process_tree::SlabAllocator;
+using santa::santad::process_tree::SlabPool;
+
+@interface ProcessSlabTest : XCTestCase
+@end
+
+@implementation ProcessSlabTest
+
+- (void)testSlotsAreRecycled {
+  auto pool = std::make_shared<SlabPool>(24, 4);
+  XCTAssertEqual(pool->GetStats().slot_size % alignof(std::max_align_t), 0);
+  XCTAssertEqual(pool->GetStats().slabs, 0);
+
+  std::vector<void*> slots;
+  for (int i = 0; i < 5; i++) {
+    slots.push_back(pool->Allocate(24, alignof(uint64_t)));
+  }
+
+  SlabPool::Stats stats = pool->GetStats();
+  XCTAssertEqual(stats.slabs, 2);
+  XCTAssertEqual(stats.slots_in_use, 5);
+  XCTAssertEqual(stats.slots_free, 3);
+  XCTAssertEqual(stats.bytes_reserved, 8 * stats.slot_size);
+
+  void* last = slots.back();
+  pool->Deallocate(last, 24, alignof(uint64_t));
+  XCTAssertEqual(pool->Allocate(24, alignof(uint64_t)), last);
+
+  for (void* slot : slots) {
+    pool->Deallocate(slot, 24, alignof(uint64_t));
+  }
+
+  // Slabs are kept for reuse
+  stats = pool->GetStats();
+  XCTAssertEqual(stats.slabs, 2);
+  XCTAssertEqual(stats.slots_in_use, 0);
+  XCTAssertEqual(stats.slots_free, 8);
+}
+
+- (void)testOversizedFallsBackToHeap {
+  auto pool = std::make_shared<SlabPool>(16, 4);
+
+  void* p = pool->Allocate(1024, alignof(uint64_t));
+  XCTAssertEqual(pool->GetStats().oversized_in_use, 1);
+  XCTAssertEqual(pool->GetStats().slabs, 0);
+
+  pool->Deallocate(p, 1024, alignof(uint64_t));
+  XCTAssertEqual(pool->GetStats().oversized_in_use, 0);
+}
+
+- (void)testAllocateSharedOutlivesPoolOwner {
+  auto pool = std::make_shared<SlabPool>(128, 4);
+  std::shared_ptr<int> value = std::allocate_shared<int>(SlabAllocator<int>(pool), 123);
+  XCTAssertEqual(pool->GetStats().slots_in_use, 1);
+
+  // The allocator copy in the control block keeps the pool alive
+  std::weak_ptr<SlabPool> weakPool = pool;
+  pool.reset();
+  XCTAssertFalse(weakPool.expired());
+  XCTAssertEqual(*value, 123);
+
+  value.reset();
+  XCTAssertTrue(weakPool.expired());
+}
+
+@end
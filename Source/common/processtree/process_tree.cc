@@ -52,10 +52,39 @@ uint64_t MachTicksFromNanos(uint64_t nanos) {
 }
 }  // namespace
 
+// Shards are always locked in index order, so two forks locking the same pair
+// of shards from opposite ends can't deadlock.
+class ABSL_SCOPED_LOCKABLE ProcessTree::ShardPairLock {
+ public:
+  ShardPairLock(ProcessTree& tree, size_t a, size_t b)
+      ABSL_EXCLUSIVE_LOCK_FUNCTION(tree.shards_[a].mtx, tree.shards_[b].mtx)
+      : first_(&tree.shards_[std::min(a, b)].mtx),
+        second_(a == b ? nullptr : &tree.shards_[std::max(a, b)].mtx) {
+    first_->Lock();
+    if (second_) {
+      second_->Lock();
+    }
+  }
+
+  ~ShardPairLock() ABSL_UNLOCK_FUNCTION() {
+    if (second_) {
+      second_->Unlock();
+    }
+    first_->Unlock();
+  }
+
+  ShardPairLock(const ShardPairLock&) = delete;
+  ShardPairLock& operator=(const ShardPairLock&) = delete;
+
+ private:
+  absl::Mutex* first_;
+  absl::Mutex* second_;
+};
+
 void ProcessTree::BackfillInsertChildren(
     absl::flat_hash_map<pid_t, std::vector<BackfilledProcess>>& parent_map,
     std::shared_ptr<Process> parent, const BackfilledProcess& backfilled_proc) {
-  auto proc = std::make_shared<Process>(
+  auto proc = NewProcess(
       backfilled_proc.pid, backfilled_proc.cred,
       // Re-use shared pointers from parent if value equivalent
       (parent && *(backfilled_proc.program) == *(parent->program_))
@@ -63,8 +92,9 @@ void ProcessTree::BackfillInsertChildren(
           : backfilled_proc.program,
       parent);
   {
-    absl::MutexLock lock(mtx_);
-    map_.emplace(backfilled_proc.pid, proc);
+    Shard& shard = ShardFor(backfilled_proc.pid);
+    absl::MutexLock lock(shard.mtx);
+    shard.map.emplace(backfilled_proc.pid, proc);
   }
 
   // The only case where we should not have a parent is the root processes
@@ -88,26 +118,36 @@ void ProcessTree::HandleFork(uint64_t timestamp,
                              const Pid new_pid) {
   // Allocate the child OUTSIDE the write lock (as HandleExec does): the caller
   // supplies the parent handle, so no lock-held lookup is needed to build it.
-  auto child = std::make_shared<Process>(new_pid, parent->effective_cred_,
-                                         parent->program_, parent);
+  auto child =
+      NewProcess(new_pid, parent->effective_cred_, parent->program_, parent);
   {
     // Dedup and the map insert are one critical section: if we released the
-    // lock between them, another client could see this event as a duplicate
-    // (skip it) and then read the tree before the child was inserted.
-    absl::MutexLock lock(mtx_);
-    if (!StepLocked({timestamp, EventKind::kFork, parent->pid_, new_pid})) {
+    // locks between them, another client could see this event as a duplicate
+    // (skip it) and then read the tree before the child was inserted. The fork
+    // is deduplicated in the parent's shard and the child is inserted into its
+    // own, so both are held.
+    const size_t parent_index = ShardIndex(parent->pid_.pid);
+    const size_t child_index = ShardIndex(new_pid.pid);
+    ShardPairLock lock(*this, parent_index, child_index);
+    Shard& parent_shard = shards_[parent_index];
+    Shard& child_shard = shards_[child_index];
+    if (!StepLocked(parent_shard,
+                    {timestamp, EventKind::kFork, parent->pid_, new_pid})) {
       return;
     }
-    // Test seam (no-op in production): the claim just succeeded and mtx_ is
-    // still held; fire here, BEFORE the insert, so the concurrency test can
-    // verify a reader blocks at this boundary — i.e. claim and insert are a
-    // single lock hold.
+    // Test seam (no-op in production): the claim just succeeded and the shard
+    // locks are still held; fire here, BEFORE the insert, so the concurrency
+    // test can verify a reader blocks at this boundary — i.e. claim and insert
+    // are a single lock hold.
     if (on_event_claimed_for_test_) {
       on_event_claimed_for_test_();
     }
-    map_.emplace(new_pid, child);
+    child_shard.map.emplace(new_pid, child);
     // Reap AFTER applying, so a late event can never reap the actor it needs.
-    DrainRemovals();
+    DrainRemovals(parent_shard);
+    if (child_index != parent_index) {
+      DrainRemovals(child_shard);
+    }
   }
   // Annotators run outside the lock (they re-enter the tree). Annotation
   // propagation is therefore NOT atomic with the structural insert above; that
@@ -127,21 +167,23 @@ void ProcessTree::HandleExec(uint64_t timestamp, const Process& p,
   // once per exec. StepLocked is the authoritative dedup gate: an
   // exact-duplicate delivery is rejected, while distinct deliveries that share
   // a pid but carry a different mach_time both pass and the later one is a
-  // first-wins map_.emplace no-op. Callers building the Program eagerly can
+  // first-wins map.emplace no-op. Callers building the Program eagerly can
   // skip known duplicates up front via GetExecActor (see InformFromESEvent).
 
-  // Allocate the new process OUTSIDE the write lock to keep the shared tree
-  // lock short on the serial ES handler path; prog is moved in, not copied.
-  auto new_proc = std::make_shared<Process>(
+  // Allocate the new process OUTSIDE the write lock to keep the shard lock
+  // short on the serial ES handler path; prog is moved in, not copied.
+  auto new_proc = NewProcess(
       new_pid, c, std::make_shared<const Program>(std::move(prog)), p.parent_);
   {
-    absl::MutexLock lock(mtx_);
-    if (!StepLocked({timestamp, EventKind::kExec, p.pid_, new_pid})) {
+    // Both images share the pid, and so the shard.
+    Shard& shard = ShardFor(p.pid_);
+    absl::MutexLock lock(shard.mtx);
+    if (!StepLocked(shard, {timestamp, EventKind::kExec, p.pid_, new_pid})) {
       return;
     }
-    remove_at_.push({timestamp, p.pid_});
-    map_.emplace(new_proc->pid_, new_proc);
-    DrainRemovals();
+    shard.remove_at.push({timestamp, p.pid_});
+    shard.map.emplace(new_proc->pid_, new_proc);
+    DrainRemovals(shard);
   }
   for (const auto& annotator : annotators_) {
     annotator->AnnotateExec(*this, p, *new_proc);
@@ -149,26 +191,36 @@ void ProcessTree::HandleExec(uint64_t timestamp, const Process& p,
 }
 
 void ProcessTree::HandleExit(uint64_t timestamp, const Process& p) {
-  absl::MutexLock lock(mtx_);
-  if (!StepLocked({timestamp, EventKind::kExit, p.pid_, Pid{}})) {
+  Shard& shard = ShardFor(p.pid_);
+  absl::MutexLock lock(shard.mtx);
+  if (!StepLocked(shard, {timestamp, EventKind::kExit, p.pid_, Pid{}})) {
     return;
   }
-  remove_at_.push({timestamp, p.pid_});
-  DrainRemovals();
+  shard.remove_at.push({timestamp, p.pid_});
+  DrainRemovals(shard);
 }
 
 ProcessTree::ExecActor ProcessTree::GetExecActor(uint64_t timestamp,
                                                  const Pid actor,
                                                  const Pid target) const {
-  absl::ReaderMutexLock lock(mtx_);
-  if (seen_.contains({timestamp, EventKind::kExec, actor, target})) {
+  // The exec is deduplicated in the actor's shard, which is also where the
+  // actor lives.
+  const Shard& shard = ShardFor(actor);
+  absl::ReaderMutexLock lock(shard.mtx);
+  if (shard.seen.contains({timestamp, EventKind::kExec, actor, target})) {
     return {std::nullopt, /*already_seen=*/true};
   }
-  return {GetLocked(actor), /*already_seen=*/false};
+  return {GetLocked(shard, actor), /*already_seen=*/false};
 }
 
-bool ProcessTree::StepLocked(const EventKey& key) {
-  latest_ts_ = std::max(latest_ts_, key.mach_time);
+bool ProcessTree::StepLocked(Shard& shard, const EventKey& key) {
+  // Only ever advances. The shard lock doesn't cover latest_ts_, but relaxed
+  // is enough since it is only used to compute the reap cutoff.
+  uint64_t latest = latest_ts_.load(std::memory_order_relaxed);
+  while (latest < key.mach_time &&
+         !latest_ts_.compare_exchange_weak(latest, key.mach_time,
+                                           std::memory_order_relaxed)) {
+  }
 
   // Dedup on the event's identity: the same kernel event is delivered to every
   // tree-aware client, and each informs the tree, so apply it exactly once. A
@@ -177,31 +229,32 @@ bool ProcessTree::StepLocked(const EventKey& key) {
   // events under load); only an exact duplicate is skipped. The key carries the
   // event's identity, not just mach_time, so two distinct events sharing a
   // coarse mach_time stamp are not mistaken for one and dropped.
-  if (seen_.contains(key)) {
+  if (shard.seen.contains(key)) {
     return false;
   }
-  seen_.insert(key);
-  seen_order_.push_back(key);
-  if (seen_order_.size() > kSeenCap) {
-    // seen_/seen_order_ are bounded ONLY here — DrainRemovals never touches
-    // them. So the dedup window is exactly the last kSeenCap events: steady
-    // state is kSeenCap and this evicts on every insert after warmup. A client
-    // lagging more than kSeenCap events behind the newest event finds its
-    // duplicates already evicted and re-applies them. That is self-healing in
-    // the common case (map_.emplace is first-wins, and a laggard replays a
-    // whole lifecycle so re-created nodes are re-reaped by its own replayed
-    // exec/exit), with one accepted edge: if a fork duplicate has aged out
-    // while its matching exec duplicate has not, the re-inserted pre-exec node
-    // never gets a removal scheduled and leaks (pidversion-distinct, bounded;
-    // NOT wrong ancestry). The proper fix is the deferred delivery watermark;
-    // kSeenCap (16384) is sized so lag beyond it is rare under real load.
-    seen_.erase(seen_order_.front());
-    seen_order_.pop_front();
+  shard.seen.insert(key);
+  shard.seen_order.push_back(key);
+  if (shard.seen_order.size() > kSeenCapPerShard) {
+    // seen/seen_order are bounded ONLY here — DrainRemovals never touches
+    // them. So the dedup window is exactly the last kSeenCapPerShard events of
+    // the shard: steady state is kSeenCapPerShard and this evicts on every
+    // insert after warmup. A client lagging more than that many of the shard's
+    // events behind the newest finds its duplicates already evicted and
+    // re-applies them. That is self-healing in the common case (map.emplace is
+    // first-wins, and a laggard replays a whole lifecycle so re-created nodes
+    // are re-reaped by its own replayed exec/exit), with one accepted edge: if
+    // a fork duplicate has aged out while its matching exec duplicate has not,
+    // the re-inserted pre-exec node never gets a removal scheduled and leaks
+    // (pidversion-distinct, bounded; NOT wrong ancestry). The proper fix is the
+    // deferred delivery watermark; kSeenCapPerShard (4096, across
+    // kNumShards shards) is sized so lag beyond it is rare under real load.
+    shard.seen.erase(shard.seen_order.front());
+    shard.seen_order.pop_front();
   }
   return true;
 }
 
-void ProcessTree::DrainRemovals() {
+void ProcessTree::DrainRemovals(Shard& shard) {
   // Reap deferred removals once `grace` mach_time ticks have elapsed past the
   // scheduling event (measured against the newest timestamp seen). The grace
   // must comfortably exceed worst-case cross-thread/-client delivery reordering
@@ -209,31 +262,35 @@ void ProcessTree::DrainRemovals() {
   static const uint64_t kDefaultGrace = MachTicksFromNanos(5 * NSEC_PER_SEC);
   const uint64_t grace =
       removal_grace_ticks_ ? removal_grace_ticks_ : kDefaultGrace;
-  const uint64_t cutoff = latest_ts_ > grace ? latest_ts_ - grace : 0;
+  const uint64_t latest = latest_ts_.load(std::memory_order_relaxed);
+  const uint64_t cutoff = latest > grace ? latest - grace : 0;
 
-  // remove_at_ is a min-heap on the scheduling timestamp, so the earliest
+  // remove_at is a min-heap on the scheduling timestamp, so the earliest
   // deadline is always on top. Reap only the entries that have expired and stop
   // at the first that has not — every deeper entry is newer. This is O(K log R)
-  // in the number reaped, not O(R) in the number pending.
-  while (!remove_at_.empty() && remove_at_.top().first < cutoff) {
-    const struct Pid pid = remove_at_.top().second;
-    remove_at_.pop();
-    if (auto target = GetLocked(pid);
+  // in the number reaped, not O(R) in the number pending. Each shard is only
+  // reaped by events that lock it, so an idle shard keeps its expired entries
+  // until its next event.
+  while (!shard.remove_at.empty() && shard.remove_at.top().first < cutoff) {
+    const struct Pid pid = shard.remove_at.top().second;
+    shard.remove_at.pop();
+    if (auto target = GetLocked(shard, pid);
         target && (*target)->refcnt_.load(std::memory_order_relaxed) > 0) {
       (*target)->tombstoned_ = true;
     } else {
-      map_.erase(pid);
+      shard.map.erase(pid);
     }
   }
 }
 
 void ProcessTree::RetainProcess(const PidList& pids) {
-  // Reader lock suffices: we only need the map to be stable for lookup.
+  // Reader lock suffices: we only need the shard's map to be stable for lookup.
   // relaxed is safe because the increment has no dependent memory operations —
   // we are only bumping a counter.
-  absl::ReaderMutexLock lock(mtx_);
   for (const struct Pid& p : pids) {
-    auto proc = GetLocked(p);
+    const Shard& shard = ShardFor(p);
+    absl::ReaderMutexLock lock(shard.mtx);
+    auto proc = GetLocked(shard, p);
     if (proc) {
       (*proc)->refcnt_.fetch_add(1, std::memory_order_relaxed);
     }
@@ -245,15 +302,14 @@ void ProcessTree::ReleaseProcess(const PidList& pids) {
   // is stable here (written only in DrainRemovals under the exclusive lock).
   // Only the rare erase of a tombstoned process needs the exclusive lock.
   PidList to_erase;
-  {
-    absl::ReaderMutexLock lock(mtx_);
-    for (const struct Pid& p : pids) {
-      auto proc = GetLocked(p);
-      if (proc &&
-          (*proc)->refcnt_.fetch_sub(1, std::memory_order_relaxed) == 1 &&
-          (*proc)->tombstoned_) {
-        to_erase.push_back(p);
-      }
+  for (const struct Pid& p : pids) {
+    const Shard& shard = ShardFor(p);
+    absl::ReaderMutexLock lock(shard.mtx);
+    auto proc = GetLocked(shard, p);
+    if (proc &&
+        (*proc)->refcnt_.fetch_sub(1, std::memory_order_relaxed) == 1 &&
+        (*proc)->tombstoned_) {
+      to_erase.push_back(p);
     }
   }
   if (to_erase.empty()) {
@@ -263,15 +319,16 @@ void ProcessTree::ReleaseProcess(const PidList& pids) {
     on_release_collected_for_test_();
   }
 
-  absl::MutexLock lock(mtx_);
   for (const struct Pid& p : to_erase) {
+    Shard& shard = ShardFor(p);
+    absl::MutexLock lock(shard.mtx);
     // Re-verify: between the two lock holds the process may have been
     // retained again, already erased by a concurrent releaser, or erased
     // and a fresh process re-inserted under the same pid.
-    auto proc = GetLocked(p);
+    auto proc = GetLocked(shard, p);
     if (proc && (*proc)->refcnt_.load(std::memory_order_relaxed) == 0 &&
         (*proc)->tombstoned_) {
-      map_.erase(p);
+      shard.map.erase(p);
     }
   }
 }
@@ -284,22 +341,38 @@ Annotation get/set
 
 void ProcessTree::AnnotateProcess(const Process& p,
                                   std::shared_ptr<const Annotator> a) {
-  absl::MutexLock lock(mtx_);
+  Shard& shard = ShardFor(p.pid_);
+  absl::MutexLock lock(shard.mtx);
   const Annotator& x = *a;
-  map_[p.pid_]->annotations_.emplace(std::type_index(typeid(x)), std::move(a));
-}
+  const std::type_index type(typeid(x));
+  Process& proc = *shard.map[p.pid_];
+  // The first annotation of each type wins.
+  for (const auto& [annotation_type, _] : proc.annotations_) {
+    if (annotation_type == type) {
+      return;
+    }
+  }
+  proc.annotations_.emplace_back(type, std::move(a));
 
-std::optional<::santa::pb::v1::process_tree::Annotations>
-ProcessTree::ExportAnnotations(const Pid p) {
-  auto proc = Get(p);
-  if (!proc || (*proc)->annotations_.empty()) {
-    return std::nullopt;
+  // Processes are annotated a handful of times, but their annotations are
+  // exported for every event, so merge and encode them once here.
+  ::santa::pb::v1::process_tree::Annotations merged;
+  for (const auto& [_, annotation] : proc.annotations_) {
+    if (auto x = annotation->Proto(); x) merged.MergeFrom(*x);
   }
-  ::santa::pb::v1::process_tree::Annotations a;
-  for (const auto& [_, annotation] : (*proc)->annotations_) {
-    if (auto x = annotation->Proto(); x) a.MergeFrom(*x);
+  proc.exported_annotations_ =
+      std::make_shared<const ExportedAnnotations>(std::move(merged));
+}
+
+std::shared_ptr<const ExportedAnnotations> ProcessTree::ExportAnnotations(
+    const Pid p) const {
+  const Shard& shard = ShardFor(p);
+  absl::ReaderMutexLock lock(shard.mtx);
+  auto proc = GetLocked(shard, p);
+  if (!proc) {
+    return nullptr;
   }
-  return a;
+  return (*proc)->exported_annotations_;
 }
 
 /*
@@ -321,10 +394,10 @@ std::vector<std::shared_ptr<const Process>> ProcessTree::RootSlice(
 void ProcessTree::Iterate(
     std::function<void(std::shared_ptr<const Process> p)> f) const {
   std::vector<std::shared_ptr<const Process>> procs;
-  {
-    absl::ReaderMutexLock lock(mtx_);
-    procs.reserve(map_.size());
-    for (auto& [_, proc] : map_) {
+  for (const Shard& shard : shards_) {
+    absl::ReaderMutexLock lock(shard.mtx);
+    procs.reserve(procs.size() + shard.map.size());
+    for (auto& [_, proc] : shard.map) {
       procs.push_back(proc);
     }
   }
@@ -336,14 +409,15 @@ void ProcessTree::Iterate(
 
 std::optional<std::shared_ptr<const Process>> ProcessTree::Get(
     const Pid target) const {
-  absl::ReaderMutexLock lock(mtx_);
-  return GetLocked(target);
+  const Shard& shard = ShardFor(target);
+  absl::ReaderMutexLock lock(shard.mtx);
+  return GetLocked(shard, target);
 }
 
 std::optional<std::shared_ptr<Process>> ProcessTree::GetLocked(
-    const Pid target) const {
-  auto it = map_.find(target);
-  if (it == map_.end()) {
+    const Shard& shard, const Pid target) {
+  auto it = shard.map.find(target);
+  if (it == shard.map.end()) {
     return std::nullopt;
   }
   return it->second;
@@ -353,22 +427,38 @@ std::shared_ptr<const Process> ProcessTree::GetParent(const Process& p) const {
   return p.parent_;
 }
 
+ProcessTree::MemoryUsage ProcessTree::GetMemoryUsage() const {
+  MemoryUsage usage{};
+  for (const Shard& shard : shards_) {
+    absl::ReaderMutexLock lock(shard.mtx);
+    usage.processes += shard.map.size();
+    usage.pending_removals += shard.remove_at.size();
+    usage.seen_events += shard.seen.size();
+  }
+  usage.process_slab = process_pool_->GetStats();
+  return usage;
+}
+
 #if SANTA_PROCESS_TREE_DEBUG
 void ProcessTree::DebugDump(std::ostream& stream) const {
-  absl::ReaderMutexLock lock(mtx_);
-  stream << map_.size() << " processes" << std::endl;
-  DebugDumpLocked(stream, 0, 0);
+  std::vector<std::shared_ptr<const Process>> procs;
+  Iterate([&procs](std::shared_ptr<const Process> p) {
+    procs.push_back(std::move(p));
+  });
+  stream << procs.size() << " processes" << std::endl;
+  DebugDumpChildren(stream, procs, 0, 0);
 }
 
-void ProcessTree::DebugDumpLocked(std::ostream& stream, int depth,
-                                  pid_t ppid) const
-    ABSL_SHARED_LOCKS_REQUIRED(mtx_) {
-  for (auto& [_, process] : map_) {
+void ProcessTree::DebugDumpChildren(
+    std::ostream& stream,
+    const std::vector<std::shared_ptr<const Process>>& procs, int depth,
+    pid_t ppid) {
+  for (const auto& process : procs) {
     if ((ppid == 0 && !process->parent_) ||
         (process->parent_ && process->parent_->pid_.pid == ppid)) {
       stream << std::string(2 * depth, ' ') << process->pid_.pid
              << process->program_->executable << std::endl;
-      DebugDumpLocked(stream, depth + 1, process->pid_.pid);
+      DebugDumpChildren(stream, procs, depth + 1, process->pid_.pid);
     }
   }
 }
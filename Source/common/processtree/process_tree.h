@@ -16,15 +16,21 @@
 #ifndef SANTA_COMMON_PROCESSTREE_PROCESSTREE_H
 #define SANTA_COMMON_PROCESSTREE_PROCESSTREE_H
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
 #include <queue>
+#include <typeindex>
 #include <typeinfo>
+#include <utility>
 #include <vector>
 
 #include "Source/common/processtree/process.h"
+#include "Source/common/processtree/process_slab.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/container/inlined_vector.h"
@@ -48,6 +54,8 @@ class ProcessTree {
   explicit ProcessTree(std::vector<std::unique_ptr<Annotator>>&& annotators,
                        uint64_t removal_grace_ticks = 0)
       : annotators_(std::move(annotators)),
+        process_pool_(
+            std::make_shared<SlabPool>(kProcessSlotSize, kProcessesPerSlab)),
         removal_grace_ticks_(removal_grace_ticks) {}
   ProcessTree(const ProcessTree&) = delete;
   ProcessTree& operator=(const ProcessTree&) = delete;
@@ -117,9 +125,12 @@ class ProcessTree {
   template <typename T>
   std::optional<std::shared_ptr<const T>> GetAnnotation(const Process& p) const;
 
-  // Get the fully merged proto form of all annotations on the given process.
-  std::optional<::santa::pb::v1::process_tree::Annotations> ExportAnnotations(
-      struct Pid p);
+  // Get the fully merged proto form of all annotations on the given process,
+  // and its encoding, or nullptr if it has none. They are shared by all
+  // callers and are replaced, not modified, when the process is annotated
+  // again.
+  std::shared_ptr<const ExportedAnnotations> ExportAnnotations(
+      struct Pid p) const;
 
   // Atomically get the slice of Processes going from the given process "up"
   // to the root. The root process has no parent. N.B. There may be more than
@@ -128,8 +139,16 @@ class ProcessTree {
   std::vector<std::shared_ptr<const Process>> RootSlice(
       std::shared_ptr<const Process> p) const;
 
+  // Get a value of type T built by build(RootSlice(p)). The value is only
+  // built the first time it is requested for each process, then shared by
+  // every later caller, e.g. by all the children a shell execs.
+  template <typename T, typename F>
+  std::shared_ptr<const T> CachedFromRootSlice(std::shared_ptr<const Process> p,
+                                               F&& build) const;
+
   // Call f for all processes in the tree. The list of processes is captured
-  // before invoking f, so it is safe to mutate the tree in f.
+  // before invoking f, so it is safe to mutate the tree in f. The list is
+  // captured one shard at a time, so it is not an atomic snapshot of the tree.
   void Iterate(std::function<void(std::shared_ptr<const Process>)> f) const;
 
   // Get the Process for the given pid in the tree if it exists.
@@ -138,6 +157,19 @@ class ProcessTree {
   // Traverse the tree from the given Process to its parent.
   std::shared_ptr<const Process> GetParent(const Process& p) const;
 
+  struct MemoryUsage {
+    // Processes in the tree, including exited ones awaiting removal.
+    size_t processes;
+    size_t pending_removals;
+    size_t seen_events;
+    // Slots hold the tree's Processes along with any still referenced by
+    // clients after their removal.
+    SlabPool::Stats process_slab;
+  };
+
+  // Summarize the memory held by the tree, e.g. for metrics.
+  MemoryUsage GetMemoryUsage() const;
+
 #if SANTA_PROCESS_TREE_DEBUG
   // Dump the tree in a human readable form to the given ostream.
   void DebugDump(std::ostream& stream) const;
@@ -145,6 +177,79 @@ class ProcessTree {
 
  private:
   friend class ProcessTreeTestPeer;
+
+  // Processes are spread over shards by pid, each with its own lock, so that
+  // events and lookups for unrelated processes don't contend. An exec keeps
+  // the pid, so both images of a process live in the same shard.
+  static constexpr size_t kNumShards = 16;
+
+  // Pending removals: pids to erase from a shard's map, each paired with the
+  // mach_time of the exit/exec event that scheduled it. An entry is reaped
+  // once removal_grace_ticks_ have elapsed past that timestamp (measured
+  // against latest_ts_), so a reordered straggler cannot reference a process
+  // after it is reaped. Held as a MIN-heap on the timestamp so DrainRemovals
+  // reaps only the entries that have expired (smallest timestamps) rather than
+  // scanning every pending one — ES delivers events out of order, so
+  // timestamps are not appended monotonically and the earliest deadline is not
+  // necessarily the oldest insertion. See DrainRemovals().
+  struct ReapEarliestFirst {
+    bool operator()(const std::pair<uint64_t, struct Pid>& a,
+                    const std::pair<uint64_t, struct Pid>& b) const {
+      return a.first > b.first;  // priority_queue is a max-heap; invert for min
+    }
+  };
+
+  // Dedup of processed events. The same kernel event is delivered to every
+  // tree-aware client; each informs the tree, so an event must be applied
+  // exactly once. seen answers "already applied?" in O(1); seen_order ages
+  // entries out in insertion order once seen exceeds kSeenCapPerShard. Unlike
+  // the previous fixed rolling window, an out-of-order novel event is NEVER
+  // dropped. Keyed on the full EventKey so distinct events sharing a coarse
+  // mach_time stamp do not collide (see EventKey). Every delivery of an event
+  // has the same actor, so events are deduplicated in the actor's shard.
+  //
+  // The cap is per shard. All forks of a busy parent land in its shard, so
+  // the cap is not simply the old global window divided by the shard count.
+  static constexpr size_t kSeenCapPerShard = 4096;
+
+  struct Shard {
+    mutable absl::Mutex mtx;
+    absl::flat_hash_map<const struct Pid, std::shared_ptr<Process>> map
+        ABSL_GUARDED_BY(mtx);
+    std::priority_queue<std::pair<uint64_t, struct Pid>,
+                        std::vector<std::pair<uint64_t, struct Pid>>,
+                        ReapEarliestFirst>
+        remove_at ABSL_GUARDED_BY(mtx);
+    absl::flat_hash_set<struct EventKey> seen ABSL_GUARDED_BY(mtx);
+    std::deque<struct EventKey> seen_order ABSL_GUARDED_BY(mtx);
+  };
+
+  // Exclusively locks the shards of two pids, which may be the same shard.
+  class ShardPairLock;
+
+  static size_t ShardIndex(pid_t pid) {
+    return static_cast<uint32_t>(pid) % kNumShards;
+  }
+  Shard& ShardFor(const struct Pid& pid) {
+    return shards_[ShardIndex(pid.pid)];
+  }
+  const Shard& ShardFor(const struct Pid& pid) const {
+    return shards_[ShardIndex(pid.pid)];
+  }
+
+  // Processes churn constantly, so they are allocated from a slab pool, with
+  // each shared_ptr control block in the same slot as its Process. The slot
+  // leaves room for the control block; anything larger falls back to the heap
+  // and shows up as oversized in the pool stats.
+  static constexpr size_t kProcessSlotSize = sizeof(Process) + 64;
+  static constexpr size_t kProcessesPerSlab = 256;
+
+  template <typename... Args>
+  std::shared_ptr<Process> NewProcess(Args&&... args) const {
+    return std::allocate_shared<Process>(SlabAllocator<Process>(process_pool_),
+                                         std::forward<Args>(args)...);
+  }
+
   void BackfillInsertChildren(
       absl::flat_hash_map<pid_t, std::vector<BackfilledProcess>>& parent_map,
       std::shared_ptr<Process> parent,
@@ -158,64 +263,43 @@ class ProcessTree {
   // mach_time) so two distinct events sharing a coarse mach_time stamp are not
   // mistaken for one.
   //
-  // MUST be called with mtx_ held, and the caller MUST perform the resulting
-  // map_/remove_at_ mutation before releasing mtx_. Dedup and mutation are one
-  // atomic step on purpose: the same kernel event is delivered to multiple
-  // clients, and once one client records it as seen, another client will skip
-  // it as a duplicate — so the tree mutation must already be visible when that
-  // skip happens, or the second client (and its subsequent causal reads) would
-  // observe a missing node. "Applied" here means the tree *structure* (the
-  // map_ entry and parent_ chain that CEL ancestry walks); annotation
-  // propagation runs outside the lock and is NOT part of this atomicity
-  // guarantee (see HandleFork/HandleExec).
-  bool StepLocked(const struct EventKey& key)
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mtx_);
-
-  // Reap deferred removals whose grace has elapsed. Caller must hold mtx_.
-  void DrainRemovals() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mtx_);
-
-  std::optional<std::shared_ptr<Process>> GetLocked(struct Pid target) const
-      ABSL_SHARED_LOCKS_REQUIRED(mtx_);
-
-  void DebugDumpLocked(std::ostream& stream, int depth, pid_t ppid) const;
+  // `shard` MUST be the shard of key.actor and its mtx MUST be held, along
+  // with the mtx of every shard the caller mutates, and the caller MUST perform
+  // the resulting map/remove_at mutations before releasing them. Dedup and
+  // mutation are one atomic step on purpose: the same kernel event is
+  // delivered to multiple clients, and once one client records it as seen,
+  // another client will skip it as a duplicate — so the tree mutation must
+  // already be visible when that skip happens, or the second client (and its
+  // subsequent causal reads) would observe a missing node. "Applied" here
+  // means the tree *structure* (the map entry and parent_ chain that CEL
+  // ancestry walks); annotation propagation runs outside the lock and is NOT
+  // part of this atomicity guarantee (see HandleFork/HandleExec).
+  bool StepLocked(Shard& shard, const struct EventKey& key)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mtx);
+
+  // Reap the shard's deferred removals whose grace has elapsed. Caller must
+  // hold the shard's mtx.
+  void DrainRemovals(Shard& shard) ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mtx);
+
+  static std::optional<std::shared_ptr<Process>> GetLocked(
+      const Shard& shard, struct Pid target)
+      ABSL_SHARED_LOCKS_REQUIRED(shard.mtx);
+
+#if SANTA_PROCESS_TREE_DEBUG
+  static void DebugDumpChildren(
+      std::ostream& stream,
+      const std::vector<std::shared_ptr<const Process>>& procs, int depth,
+      pid_t ppid);
+#endif
 
   std::vector<std::unique_ptr<Annotator>> annotators_;
+  std::shared_ptr<SlabPool> process_pool_;
 
-  mutable absl::Mutex mtx_;
-  absl::flat_hash_map<const struct Pid, std::shared_ptr<Process>> map_
-      ABSL_GUARDED_BY(mtx_);
-  // Pending removals: pids to erase from map_, each paired with the mach_time
-  // of the exit/exec event that scheduled it. An entry is reaped once
-  // removal_grace_ticks_ have elapsed past that timestamp (measured against
-  // latest_ts_), so a reordered straggler cannot reference a process after it
-  // is reaped. Held as a MIN-heap on the timestamp so DrainRemovals reaps only
-  // the entries that have expired (smallest timestamps) rather than scanning
-  // every pending one — ES delivers events out of order, so timestamps are not
-  // appended monotonically and the earliest deadline is not necessarily the
-  // oldest insertion. See DrainRemovals().
-  struct ReapEarliestFirst {
-    bool operator()(const std::pair<uint64_t, struct Pid>& a,
-                    const std::pair<uint64_t, struct Pid>& b) const {
-      return a.first > b.first;  // priority_queue is a max-heap; invert for min
-    }
-  };
-  std::priority_queue<std::pair<uint64_t, struct Pid>,
-                      std::vector<std::pair<uint64_t, struct Pid>>,
-                      ReapEarliestFirst>
-      remove_at_ ABSL_GUARDED_BY(mtx_);
+  std::array<Shard, kNumShards> shards_;
 
-  // Dedup of processed events. The same kernel event is delivered to every
-  // tree-aware client; each informs the tree, so an event must be applied
-  // exactly once. seen_ answers "already applied?" in O(1); seen_order_ ages
-  // entries out in insertion order once seen_ exceeds kSeenCap. Unlike the
-  // previous fixed rolling window, an out-of-order novel event is NEVER
-  // dropped. Keyed on the full EventKey so distinct events sharing a coarse
-  // mach_time stamp do not collide (see EventKey).
-  static constexpr size_t kSeenCap = 16384;
-  absl::flat_hash_set<struct EventKey> seen_ ABSL_GUARDED_BY(mtx_);
-  std::deque<struct EventKey> seen_order_ ABSL_GUARDED_BY(mtx_);
   // Newest event timestamp seen (monotone); drives the removal grace cutoff.
-  uint64_t latest_ts_ ABSL_GUARDED_BY(mtx_) = 0;
+  // Advanced by every shard, so it is atomic rather than guarded.
+  std::atomic<uint64_t> latest_ts_{0};
   // Mach-time ticks an exited process is retained after its removal is
   // scheduled. 0 => production default (~5 s), computed lazily in
   // DrainRemovals. Injectable so tests can exercise reaping with small
@@ -224,9 +308,9 @@ class ProcessTree {
 
   // Test-only seam (empty in production): invoked by HandleFork at the
   // claim->apply boundary — after StepLocked reports the event novel and while
-  // mtx_ is still held, just before the map insert. Lets the concurrency
-  // regression test interpose there. Set via ProcessTreeTestPeer (a friend).
-  // The per-event null check is negligible.
+  // the shard locks are still held, just before the map insert. Lets the
+  // concurrency regression test interpose there. Set via ProcessTreeTestPeer
+  // (a friend). The per-event null check is negligible.
   std::function<void()> on_event_claimed_for_test_;
 
   // Test-only seam (empty in production): invoked by ReleaseProcess between
@@ -238,11 +322,39 @@ class ProcessTree {
 template <typename T>
 std::optional<std::shared_ptr<const T>> ProcessTree::GetAnnotation(
     const Process& p) const {
-  auto it = p.annotations_.find(std::type_index(typeid(T)));
-  if (it == p.annotations_.end()) {
-    return std::nullopt;
+  const std::type_index type(typeid(T));
+  for (const auto& [annotation_type, annotation] : p.annotations_) {
+    if (annotation_type == type) {
+      return std::dynamic_pointer_cast<const T>(annotation);
+    }
+  }
+  return std::nullopt;
+}
+
+template <typename T, typename F>
+std::shared_ptr<const T> ProcessTree::CachedFromRootSlice(
+    std::shared_ptr<const Process> p, F&& build) const {
+  const std::type_index type(typeid(T));
+  {
+    absl::ReaderMutexLock lock(p->root_slice_values_mtx_);
+    for (const auto& [value_type, value] : p->root_slice_values_) {
+      if (value_type == type) {
+        return std::static_pointer_cast<const T>(value);
+      }
+    }
+  }
+
+  // Built without the lock held. If another thread built the value first,
+  // its value wins so that every caller shares the same one.
+  auto built = std::make_shared<const T>(build(RootSlice(p)));
+  absl::MutexLock lock(p->root_slice_values_mtx_);
+  for (const auto& [value_type, value] : p->root_slice_values_) {
+    if (value_type == type) {
+      return std::static_pointer_cast<const T>(value);
+    }
   }
-  return std::dynamic_pointer_cast<const T>(it->second);
+  p->root_slice_values_.emplace_back(type, built);
+  return built;
 }
 
 // Create a new tree, ensuring the provided annotations are valid and that
@@ -271,6 +271,39 @@ using namespace santa::santad::process_tree;
   shell = *self.tree->Get(shell_exec_pid);
   annotation = self.tree->GetAnnotation<TestAnnotator>(*shell);
   XCTAssertTrue(annotation.has_value());
+
+  // Exported annotations are merged once and shared with every caller.
+  auto exported = self.tree->ExportAnnotations(shell_exec_pid);
+  XCTAssertTrue(exported != nullptr);
+  XCTAssertEqual(exported.get(), self.tree->ExportAnnotations(shell_exec_pid).get());
+  XCTAssertTrue(exported->serialized == exported->proto.SerializeAsString());
+  XCTAssertTrue(self.tree->ExportAnnotations(self.initProc->pid_) == nullptr);
+}
+
+- (void)testCachedFromRootSlice {
+  uint64_t event_id = 1;
+  // PID 1.1: fork() -> PID 2.2
+  const struct Pid child_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, self.initProc, child_pid);
+  auto child = *self.tree->Get(child_pid);
+
+  int builds = 0;
+  auto depth = [&builds](const std::vector<std::shared_ptr<const Process>>& slice) {
+    builds++;
+    return slice.size();
+  };
+
+  auto child_depth = self.tree->CachedFromRootSlice<size_t>(child, depth);
+  XCTAssertEqual(*child_depth, 2);
+  XCTAssertEqual(builds, 1);
+
+  // Later callers share the value built by the first one...
+  XCTAssertEqual(self.tree->CachedFromRootSlice<size_t>(child, depth).get(), child_depth.get());
+  XCTAssertEqual(builds, 1);
+
+  // ...and each process has its own.
+  XCTAssertEqual(*self.tree->CachedFromRootSlice<size_t>(self.initProc, depth), 1);
+  XCTAssertEqual(builds, 2);
 }
 
 - (void)testCleanup {
@@ -596,7 +629,7 @@ using namespace santa::santad::process_tree;
 // skips it as a duplicate. If the claim and the map insert were separate lock
 // holds, the winning client could pause between them while the skipping client
 // (or any reader) observed a missing node. Here the producer pauses INSIDE the
-// critical section (holding mtx_) right after claiming a fork; a reader must
+// critical section (holding the shard locks) right after claiming a fork; a reader must
 // block until the insert is visible, so it can never see the child as absent.
 - (void)testConcurrentClaimIsAtomicWithApply {
   std::vector<std::unique_ptr<Annotator>> annotators{};
@@ -613,7 +646,7 @@ using namespace santa::santad::process_tree;
 
   bool hookFired = false;
   tree->SetOnEventClaimedForTest([&] {
-    // Runs on the producer thread, holding mtx_, just after the claim.
+    // Runs on the producer thread, holding the shard locks, just after the claim.
     if (hookFired) return;  // interpose only on the first claim
     hookFired = true;
     {
@@ -622,10 +655,10 @@ using namespace santa::santad::process_tree;
     }
     cv.notify_all();
     std::unique_lock<std::mutex> lk(m);
-    cv.wait(lk, [&] { return release; });  // hold mtx_ until released
+    cv.wait(lk, [&] { return release; });  // hold the locks until released
   });
 
-  // Producer claims the fork and pauses inside the critical section (mtx_ held).
+  // Producer claims the fork and pauses inside the critical section (locks held).
   std::thread producer([&] { tree->HandleFork(1, init, child_pid); });
   {
     std::unique_lock<std::mutex> lk(m);
@@ -640,7 +673,7 @@ using namespace santa::santad::process_tree;
     }
   }
 
-  // Reader tries to read the child while the producer holds mtx_. With atomic
+  // Reader tries to read the child while the producer holds the locks. With atomic
   // claim+apply the reader MUST block until the insert becomes visible.
   std::thread reader([&] {
     bool present = tree->Get(child_pid).has_value();
@@ -667,4 +700,56 @@ using namespace santa::santad::process_tree;
   XCTAssertTrue(readerSawChild.load());  // never saw "absent"
 }
 
+// Forks lock both the parent's and the child's shards. Concurrent forks that
+// cross the same pair of shards in opposite directions must not deadlock and
+// must all be applied.
+- (void)testConcurrentCrossShardForks {
+  std::vector<std::unique_ptr<Annotator>> annotators{};
+  auto tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+  auto init = tree->InsertInit();
+  tree->HandleFork(1, init, {.pid = 2, .pidversion = 2});
+  tree->HandleFork(2, init, {.pid = 3, .pidversion = 3});
+  auto parentA = *tree->Get({.pid = 2, .pidversion = 2});
+  auto parentB = *tree->Get({.pid = 3, .pidversion = 3});
+
+  const int kForks = 1000;
+  std::thread a([&] {
+    for (int i = 0; i < kForks; i++) {
+      tree->HandleFork(100 + 2 * i, parentA, {.pid = 3, .pidversion = (uint64_t)(100 + i)});
+    }
+  });
+  std::thread b([&] {
+    for (int i = 0; i < kForks; i++) {
+      tree->HandleFork(101 + 2 * i, parentB, {.pid = 2, .pidversion = (uint64_t)(100 + i)});
+    }
+  });
+  a.join();
+  b.join();
+
+  XCTAssertTrue(tree->Get({.pid = 3, .pidversion = (uint64_t)(100 + kForks - 1)}).has_value());
+  XCTAssertTrue(tree->Get({.pid = 2, .pidversion = (uint64_t)(100 + kForks - 1)}).has_value());
+}
+
+- (void)testMemoryUsage {
+  std::vector<std::unique_ptr<Annotator>> annotators{};
+  auto tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators),
+                                                    /*removal_grace_ticks=*/10);
+  auto init = tree->InsertInit();
+
+  for (int i = 0; i < 100; i++) {
+    const struct Pid pid = {.pid = 100 + i, .pidversion = 1};
+    tree->HandleFork(100 + 2 * i, init, pid);
+    tree->HandleExit(101 + 2 * i, **tree->Get(pid));
+  }
+
+  // Exited processes are reaped as time advances past their grace period, and
+  // their slab slots are recycled for later forks.
+  ProcessTree::MemoryUsage usage = tree->GetMemoryUsage();
+  XCTAssertLessThan(usage.processes, 100);
+  XCTAssertEqual(usage.seen_events, 200);
+  XCTAssertEqual(usage.process_slab.slabs, 1);
+  XCTAssertEqual(usage.process_slab.oversized_in_use, 0);
+  XCTAssertEqual(usage.process_slab.slots_in_use, usage.processes - 1);  // init
+}
+
 @end
@@ -29,15 +29,16 @@ class ProcessTreeTestPeer : public ProcessTree {
 };
 
 std::shared_ptr<const Process> ProcessTreeTestPeer::InsertInit() {
-  absl::MutexLock lock(mtx_);
   struct Pid initpid = {
       .pid = 1,
       .pidversion = 1,
   };
+  Shard& shard = ShardFor(initpid);
+  absl::MutexLock lock(shard.mtx);
   auto proc = std::make_shared<Process>(
       initpid, (Cred){.uid = 0, .gid = 0},
       std::make_shared<Program>((Program){.executable = "/init", .arguments = {"/init"}}), nullptr);
-  map_.emplace(initpid, proc);
+  shard.map.emplace(initpid, proc);
   return proc;
 }
 
@@ -0,0 +1,100 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_VERIFYINGHASHER_CODEDIRECTORYCACHE_H
+#define SANTA_COMMON_VERIFYINGHASHER_CODEDIRECTORYCACHE_H
+
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+#include <Kernel/kern/cs_blobs.h>
+__END_DECLS
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "Source/common/SantaCache.h"
+#include "Source/common/verifyinghasher/CodeSignatureParser.h"
+
+namespace santa {
+
+// Bounded cache of parsed CodeDirectory metadata, keyed by cdhash, so that
+// binaries sharing a signature (hard links, copies, clones) skip
+// ParseCodeSignature after the first one is verified.
+//
+// An entry records where in the CS blob the picked CodeDirectory and its
+// slot table were found, rather than pointers into a particular blob. A hit
+// is only taken after hashing the CodeDirectory at the recorded offset in
+// the new blob and getting the same cdhash back: every cached field is
+// derived from those bytes, so the rebuilt ParsedCodeDirectory is exactly
+// what parsing the new blob would have produced. That is the same one hash
+// ParseCodeSignature computes, minus the SuperBlob walk and validation.
+//
+// Only CodeDirectories whose cdhash the caller already trusts (e.g. the one
+// the kernel validated for an exec) should be inserted.
+class CodeDirectoryCache {
+ public:
+  static constexpr uint64_t kDefaultMaxSize = 1024;
+
+  explicit CodeDirectoryCache(uint64_t max_size = kDefaultMaxSize);
+
+  CodeDirectoryCache(const CodeDirectoryCache&) = delete;
+  CodeDirectoryCache& operator=(const CodeDirectoryCache&) = delete;
+
+  // The cache used by VerifyingHasher callers in santad.
+  static CodeDirectoryCache& Shared();
+
+  // Rebuilds `out` over `blob` from the entry for `cdhash`, returning true
+  // on a hit. Returns false, leaving `out` untouched, if there is no entry or
+  // `blob` doesn't hold the cached CodeDirectory at the recorded offset.
+  // `slice_size` is re-validated against the CD's codeLimit, as the same
+  // signature can be embedded in a slice of a different size.
+  bool Lookup(std::span<const uint8_t> cdhash, std::span<const uint8_t> blob,
+              uint64_t slice_size, ParsedCodeDirectory& out) const;
+
+  // Remembers `parsed`, which must have been parsed from `blob`.
+  void Insert(const ParsedCodeDirectory& parsed,
+              std::span<const uint8_t> blob);
+
+  uint64_t Size() const { return cache_.count(); }
+  void Clear() { cache_.clear(); }
+
+ private:
+  using Key = std::array<uint8_t, CS_CDHASH_LEN>;
+
+  struct Entry {
+    uint64_t cs_blob_size = 0;
+    // Offsets into the CS blob.
+    size_t cd_offset = 0;
+    size_t cd_length = 0;
+    size_t slot_hashes_offset = 0;
+    uint8_t hash_type = 0;
+    uint8_t hash_size = 0;
+    uint32_t page_size = 0;
+    uint64_t code_limit = 0;
+    uint32_t page_count = 0;
+    std::string identifier;
+    std::string team_id;
+  };
+
+  mutable SantaCache<Key, std::shared_ptr<const Entry>> cache_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_VERIFYINGHASHER_CODEDIRECTORYCACHE_H
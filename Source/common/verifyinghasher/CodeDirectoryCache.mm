@@ -0,0 +1,115 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/verifyinghasher/CodeDirectoryCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace santa {
+
+namespace {
+
+// Offset of `part` within `whole`, if it lies entirely inside it.
+bool OffsetWithin(std::span<const uint8_t> whole, std::span<const uint8_t> part,
+                  size_t& offset) {
+  const uint8_t* lo = whole.data();
+  const uint8_t* hi = lo + whole.size();
+  if (part.data() < lo || part.data() > hi ||
+      part.size() > static_cast<size_t>(hi - part.data())) {
+    return false;
+  }
+  offset = static_cast<size_t>(part.data() - lo);
+  return true;
+}
+
+}  // namespace
+
+CodeDirectoryCache::CodeDirectoryCache(uint64_t max_size)
+    : cache_(max_size, 4, SantaCacheEvictionPolicy::kClock) {}
+
+CodeDirectoryCache& CodeDirectoryCache::Shared() {
+  static CodeDirectoryCache* cache = new CodeDirectoryCache();
+  return *cache;
+}
+
+bool CodeDirectoryCache::Lookup(std::span<const uint8_t> cdhash,
+                                std::span<const uint8_t> blob,
+                                uint64_t slice_size,
+                                ParsedCodeDirectory& out) const {
+  if (cdhash.size() != CS_CDHASH_LEN) return false;
+  Key key;
+  std::copy(cdhash.begin(), cdhash.end(), key.begin());
+  std::shared_ptr<const Entry> entry = cache_.get(key);
+  if (!entry || blob.size() != entry->cs_blob_size) return false;
+
+  // Bounds were valid in the blob the entry came from, which was the same
+  // size, but don't rely on that.
+  const size_t slots_bytes =
+      static_cast<size_t>(entry->page_count) * entry->hash_size;
+  if (entry->cd_offset > blob.size() ||
+      entry->cd_length > blob.size() - entry->cd_offset ||
+      entry->slot_hashes_offset > blob.size() ||
+      slots_bytes > blob.size() - entry->slot_hashes_offset ||
+      entry->code_limit > slice_size) {
+    return false;
+  }
+
+  std::span<const uint8_t> cd_bytes =
+      blob.subspan(entry->cd_offset, entry->cd_length);
+  uint8_t computed[CS_CDHASH_LEN];
+  if (!ComputeCdHash(entry->hash_type, cd_bytes, computed) ||
+      std::memcmp(computed, key.data(), CS_CDHASH_LEN) != 0) {
+    return false;
+  }
+
+  ParsedCodeDirectory parsed;
+  parsed.hash_type = entry->hash_type;
+  parsed.hash_size = entry->hash_size;
+  parsed.page_size = entry->page_size;
+  parsed.code_limit = entry->code_limit;
+  parsed.page_count = entry->page_count;
+  parsed.slot_hashes = blob.subspan(entry->slot_hashes_offset, slots_bytes);
+  parsed.cd_bytes = cd_bytes;
+  std::memcpy(parsed.cdhash, computed, CS_CDHASH_LEN);
+  parsed.identifier = entry->identifier;
+  parsed.team_id = entry->team_id;
+  out = std::move(parsed);
+  return true;
+}
+
+void CodeDirectoryCache::Insert(const ParsedCodeDirectory& parsed,
+                                std::span<const uint8_t> blob) {
+  auto entry = std::make_shared<Entry>();
+  if (!OffsetWithin(blob, parsed.cd_bytes, entry->cd_offset) ||
+      !OffsetWithin(blob, parsed.slot_hashes, entry->slot_hashes_offset)) {
+    return;
+  }
+  entry->cs_blob_size = blob.size();
+  entry->cd_length = parsed.cd_bytes.size();
+  entry->hash_type = parsed.hash_type;
+  entry->hash_size = parsed.hash_size;
+  entry->page_size = parsed.page_size;
+  entry->code_limit = parsed.code_limit;
+  entry->page_count = parsed.page_count;
+  entry->identifier = parsed.identifier;
+  entry->team_id = parsed.team_id;
+
+  Key key;
+  std::memcpy(key.data(), parsed.cdhash, CS_CDHASH_LEN);
+  cache_.set(key, std::move(entry));
+}
+
+}  // namespace santa
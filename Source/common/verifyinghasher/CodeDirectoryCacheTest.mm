@@ -0,0 +1,203 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/verifyinghasher/CodeDirectoryCache.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Source/common/verifyinghasher/CodeSignatureParser.h"
+#include "Source/common/verifyinghasher/MemoryFileReader.h"
+#include "Source/common/verifyinghasher/VerifyingHasherCore.h"
+
+using santa::ArchSelector;
+using santa::CodeDirectoryCache;
+using santa::MemoryFileReader;
+using santa::ParsedCodeDirectory;
+using santa::VerifyingHasherCore;
+
+namespace {
+
+constexpr ArchSelector kArm64 = {CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL};
+
+std::span<const uint8_t> CDHashOf(const ParsedCodeDirectory& parsed) {
+  return std::span<const uint8_t>(parsed.cdhash, CS_CDHASH_LEN);
+}
+
+}  // namespace
+
+@interface CodeDirectoryCacheTest : XCTestCase
+@end
+
+@implementation CodeDirectoryCacheTest {
+  std::vector<uint8_t> _file;
+  // The arm64 slice's CS blob and slice size, as VerifyingHasherCore finds them.
+  std::vector<uint8_t> _blob;
+  uint64_t _sliceSize;
+}
+
+- (void)setUp {
+  NSBundle* bundle = [NSBundle bundleForClass:[self class]];
+  NSString* path = [bundle.resourcePath stringByAppendingPathComponent:@"testdata/hw_universal"];
+  NSData* data = [NSData dataWithContentsOfFile:path];
+  XCTAssertNotNil(data, @"hw_universal not bundled at %@", path);
+  const uint8_t* bytes = static_cast<const uint8_t*>(data.bytes);
+  _file.assign(bytes, bytes + data.length);
+
+  MemoryFileReader r(_file);
+  VerifyingHasherCore core(r, kArm64);
+  XCTAssertEqual(core.Run(), VerifyingHasherCore::Status::kOk);
+  const auto begin = _file.begin() + static_cast<ptrdiff_t>(core.Slice().cs_blob_offset);
+  _blob.assign(begin, begin + static_cast<ptrdiff_t>(core.Slice().cs_blob_size));
+  _sliceSize = core.Slice().slice_size;
+}
+
+- (ParsedCodeDirectory)parse:(const std::vector<uint8_t>&)blob {
+  ParsedCodeDirectory parsed;
+  std::string err;
+  XCTAssertTrue(santa::ParseCodeSignature(blob, _sliceSize, parsed, err), @"%s", err.c_str());
+  return parsed;
+}
+
+- (void)testLookupRebuildsParsedCDOverNewBlob {
+  CodeDirectoryCache cache;
+  ParsedCodeDirectory parsed = [self parse:_blob];
+  cache.Insert(parsed, _blob);
+  XCTAssertEqual(cache.Size(), 1);
+
+  // A copy stands in for the same signature read from another file.
+  std::vector<uint8_t> copy = _blob;
+  ParsedCodeDirectory got;
+  XCTAssertTrue(cache.Lookup(CDHashOf(parsed), copy, _sliceSize, got));
+
+  XCTAssertEqual(got.hash_type, parsed.hash_type);
+  XCTAssertEqual(got.hash_size, parsed.hash_size);
+  XCTAssertEqual(got.page_size, parsed.page_size);
+  XCTAssertEqual(got.code_limit, parsed.code_limit);
+  XCTAssertEqual(got.page_count, parsed.page_count);
+  XCTAssertEqual(0, std::memcmp(got.cdhash, parsed.cdhash, CS_CDHASH_LEN));
+  XCTAssertTrue(got.identifier == parsed.identifier);
+  XCTAssertTrue(got.team_id == parsed.team_id);
+
+  // The views point into the new blob, at the same places.
+  XCTAssertEqual(got.cd_bytes.data() - copy.data(), parsed.cd_bytes.data() - _blob.data());
+  XCTAssertEqual(got.cd_bytes.size(), parsed.cd_bytes.size());
+  XCTAssertEqual(got.slot_hashes.data() - copy.data(), parsed.slot_hashes.data() - _blob.data());
+  XCTAssertTrue(std::equal(got.slot_hashes.begin(), got.slot_hashes.end(),
+                           parsed.slot_hashes.begin(), parsed.slot_hashes.end()));
+}
+
+- (void)testLookupMissesUnknownCDHash {
+  CodeDirectoryCache cache;
+  ParsedCodeDirectory parsed = [self parse:_blob];
+  cache.Insert(parsed, _blob);
+
+  uint8_t other[CS_CDHASH_LEN];
+  std::memcpy(other, parsed.cdhash, CS_CDHASH_LEN);
+  other[0] ^= 0xff;
+  ParsedCodeDirectory got;
+  XCTAssertFalse(cache.Lookup(std::span<const uint8_t>(other, CS_CDHASH_LEN), _blob, _sliceSize,
+                              got));
+  XCTAssertFalse(cache.Lookup({}, _blob, _sliceSize, got));
+}
+
+- (void)testLookupMissesWhenCDBytesDiffer {
+  CodeDirectoryCache cache;
+  ParsedCodeDirectory parsed = [self parse:_blob];
+  cache.Insert(parsed, _blob);
+
+  // Corrupt the last byte of the cached CD's slot table in a copy.
+  std::vector<uint8_t> tampered = _blob;
+  const size_t slots_end =
+      static_cast<size_t>(parsed.slot_hashes.data() - _blob.data()) + parsed.slot_hashes.size();
+  tampered[slots_end - 1] ^= 0x01;
+
+  ParsedCodeDirectory got;
+  got.page_size = 12345;
+  XCTAssertFalse(cache.Lookup(CDHashOf(parsed), tampered, _sliceSize, got));
+  // A miss leaves the output untouched.
+  XCTAssertEqual(got.page_size, 12345);
+
+  // A blob of a different size never matches.
+  std::vector<uint8_t> grown = _blob;
+  grown.push_back(0);
+  XCTAssertFalse(cache.Lookup(CDHashOf(parsed), grown, _sliceSize, got));
+}
+
+- (void)testLookupRevalidatesCodeLimitAgainstSlice {
+  CodeDirectoryCache cache;
+  ParsedCodeDirectory parsed = [self parse:_blob];
+  cache.Insert(parsed, _blob);
+
+  ParsedCodeDirectory got;
+  XCTAssertFalse(cache.Lookup(CDHashOf(parsed), _blob, parsed.code_limit - 1, got));
+  XCTAssertTrue(cache.Lookup(CDHashOf(parsed), _blob, parsed.code_limit, got));
+}
+
+- (void)testInsertIgnoresViewsOutsideBlob {
+  CodeDirectoryCache cache;
+  ParsedCodeDirectory parsed = [self parse:_blob];
+  std::vector<uint8_t> unrelated(_blob.size());
+  cache.Insert(parsed, unrelated);
+  XCTAssertEqual(cache.Size(), 0);
+}
+
+- (void)testCoreTakesExpectedCDFromCache {
+  CodeDirectoryCache cache;
+  ParsedCodeDirectory parsed = [self parse:_blob];
+  std::span<const uint8_t> cdhash = CDHashOf(parsed);
+
+  // A mismatched expectation parses as usual and caches nothing.
+  uint8_t wrong[CS_CDHASH_LEN] = {};
+  {
+    MemoryFileReader r(_file);
+    VerifyingHasherCore core(r, kArm64,
+                             VerifyingHasherCore::Options{
+                                 .cd_cache = &cache,
+                                 .expected_cdhash = std::span<const uint8_t>(wrong, CS_CDHASH_LEN),
+                             });
+    XCTAssertEqual(core.Run(), VerifyingHasherCore::Status::kOk);
+    XCTAssertFalse(core.ParsedCDFromCache());
+    XCTAssertEqual(cache.Size(), 0);
+  }
+
+  std::vector<uint8_t> digests[2];
+  for (int run = 0; run < 2; run++) {
+    MemoryFileReader r(_file);
+    VerifyingHasherCore core(r, kArm64,
+                             VerifyingHasherCore::Options{
+                                 .cd_cache = &cache,
+                                 .expected_cdhash = cdhash,
+                             });
+    XCTAssertEqual(core.Run(), VerifyingHasherCore::Status::kOk);
+    // The first run parses and fills the cache, the second hits it.
+    XCTAssertEqual(core.ParsedCDFromCache(), run == 1);
+    XCTAssertEqual(core.Mismatches().value_or(1), 0);
+    XCTAssertTrue(std::equal(core.CDHash().begin(), core.CDHash().end(), cdhash.begin(),
+                             cdhash.end()));
+    XCTAssertTrue(core.ParsedCD().identifier == parsed.identifier);
+    digests[run].assign(core.FullFileDigest().begin(), core.FullFileDigest().end());
+  }
+  XCTAssertTrue(digests[0] == digests[1]);
+  XCTAssertEqual(cache.Size(), 1);
+}
+
+@end
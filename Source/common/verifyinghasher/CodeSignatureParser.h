@@ -65,6 +65,12 @@ struct ParsedCodeDirectory {
 bool ParseCodeSignature(std::span<const uint8_t> blob, uint64_t slice_size,
                         ParsedCodeDirectory& out, std::string& err);
 
+// Computes the 20-byte truncated cdhash of a CodeDirectory blob using
+// `hash_type`, as ParseCodeSignature does for the CD it picks. Returns false
+// for an unsupported hash type.
+bool ComputeCdHash(uint8_t hash_type, std::span<const uint8_t> cd_bytes,
+                   uint8_t (&cdhash)[CS_CDHASH_LEN]);
+
 }  // namespace santa
 
 #endif  // SANTA_COMMON_VERIFYINGHASHER_CODESIGNATUREPARSER_H
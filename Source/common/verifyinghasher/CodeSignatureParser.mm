@@ -86,6 +86,40 @@ uint8_t HashSizeFor(uint8_t hash_type) {
 
 }  // namespace
 
+bool ComputeCdHash(uint8_t hash_type, std::span<const uint8_t> cd_bytes,
+                   uint8_t (&cdhash)[CS_CDHASH_LEN]) {
+  uint8_t full[CC_SHA384_DIGEST_LENGTH];  // largest supported
+  switch (hash_type) {
+    case CS_HASHTYPE_SHA1: {
+      Sha1Traits::Ctx c;
+      Sha1Traits::Init(&c);
+      Sha1Traits::Update(&c, cd_bytes.data(), cd_bytes.size());
+      Sha1Traits::Final(full, &c);
+      break;
+    }
+    case CS_HASHTYPE_SHA256:
+    case CS_HASHTYPE_SHA256_TRUNCATED: {
+      Sha256Traits::Ctx c;
+      Sha256Traits::Init(&c);
+      Sha256Traits::Update(&c, cd_bytes.data(), cd_bytes.size());
+      Sha256Traits::Final(full, &c);
+      break;
+    }
+    case CS_HASHTYPE_SHA384: {
+      Sha384Traits::Ctx c;
+      Sha384Traits::Init(&c);
+      Sha384Traits::Update(&c, cd_bytes.data(), cd_bytes.size());
+      Sha384Traits::Final(full, &c);
+      break;
+    }
+    default: return false;
+  }
+  static_assert(CS_CDHASH_LEN <= CC_SHA1_DIGEST_LENGTH,
+                "all supported hash digests must be at least CS_CDHASH_LEN");
+  std::memcpy(cdhash, full, CS_CDHASH_LEN);
+  return true;
+}
+
 bool ParseCodeSignature(std::span<const uint8_t> blob, uint64_t slice_size,
                         ParsedCodeDirectory& out, std::string& err) {
   // All-or-nothing semantics: accumulate every field into `tmp`, commit
@@ -376,41 +410,12 @@ bool ParseCodeSignature(std::span<const uint8_t> blob, uint64_t slice_size,
 
   // Compute the cdhash of the picked CD: H_picked(cd_blob[0, blob_len)),
   // truncated to CS_CDHASH_LEN. Matches xnu's cs_cd_hash.
-  {
-    uint8_t full[CC_SHA384_DIGEST_LENGTH];  // largest supported
-    switch (tmp.hash_type) {
-      case CS_HASHTYPE_SHA1: {
-        Sha1Traits::Ctx c;
-        Sha1Traits::Init(&c);
-        Sha1Traits::Update(&c, picked->blob_base, picked->blob_len);
-        Sha1Traits::Final(full, &c);
-        break;
-      }
-      case CS_HASHTYPE_SHA256:
-      case CS_HASHTYPE_SHA256_TRUNCATED: {
-        Sha256Traits::Ctx c;
-        Sha256Traits::Init(&c);
-        Sha256Traits::Update(&c, picked->blob_base, picked->blob_len);
-        Sha256Traits::Final(full, &c);
-        break;
-      }
-      case CS_HASHTYPE_SHA384: {
-        Sha384Traits::Ctx c;
-        Sha384Traits::Init(&c);
-        Sha384Traits::Update(&c, picked->blob_base, picked->blob_len);
-        Sha384Traits::Final(full, &c);
-        break;
-      }
-      default:
-        // Unreachable: HashRank()==0 candidates were rejected at the
-        // candidate-selection stage. Defensive abort here would mask
-        // a real bug; treat as malformed.
-        err = "cdhash: unsupported hashType slipped through";
-        return false;
-    }
-    static_assert(CS_CDHASH_LEN <= CC_SHA1_DIGEST_LENGTH,
-                  "all supported hash digests must be at least CS_CDHASH_LEN");
-    std::memcpy(tmp.cdhash, full, CS_CDHASH_LEN);
+  if (!ComputeCdHash(tmp.hash_type, tmp.cd_bytes, tmp.cdhash)) {
+    // Unreachable: HashRank()==0 candidates were rejected at the
+    // candidate-selection stage. Defensive abort here would mask
+    // a real bug; treat as malformed.
+    err = "cdhash: unsupported hashType slipped through";
+    return false;
   }
 
   // Read the null-terminated identifier string at cd_blob_base + identOffset.
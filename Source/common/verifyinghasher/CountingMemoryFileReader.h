@@ -55,6 +55,14 @@ class CountingMemoryFileReader : public FileReader {
     }
     return m;
   }
+  // Whether any byte in [lo, hi) was read.
+  bool AnyReadInRange(size_t lo, size_t hi) const {
+    hi = std::min(hi, reads_.size());
+    for (size_t i = lo; i < hi; ++i) {
+      if (reads_[i] != 0) return true;
+    }
+    return false;
+  }
 
  private:
   std::vector<uint8_t> data_;
@@ -37,6 +37,11 @@ class FileReader {
   virtual ssize_t Pread(void* buf, size_t len, off_t off) = 0;
   // Total file size in bytes. Constant for the lifetime of the reader.
   virtual off_t Size() const = 0;
+  // Hint that the next reads will walk [off, off + len) sequentially.
+  // Purely advisory: implementations may prefetch or advise the kernel, but
+  // must still serve any Pread correctly. A new hint replaces the previous
+  // one.
+  virtual void WillRead(off_t off, size_t len) {}
 };
 
 // Production reader: wraps a borrowed file descriptor. Does NOT take
@@ -46,6 +51,8 @@ class FdFileReader : public FileReader {
   explicit FdFileReader(int fd, off_t size);
   ssize_t Pread(void* buf, size_t len, off_t off) override;
   off_t Size() const override { return size_; }
+  // Issues F_RDADVISE for the range. Does not change any fd state.
+  void WillRead(off_t off, size_t len) override;
 
  private:
   int fd_;
@@ -14,9 +14,12 @@
 
 #include "Source/common/verifyinghasher/FileReader.h"
 
+#include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 
 namespace santa {
 
@@ -41,4 +44,14 @@ ssize_t FdFileReader::Pread(void* buf, size_t len, off_t off) {
   return total;
 }
 
+void FdFileReader::WillRead(off_t off, size_t len) {
+  if (len == 0) return;
+  struct radvisory ra = {
+      .ra_offset = off,
+      .ra_count = static_cast<int>(std::min<size_t>(len, INT_MAX)),
+  };
+  // Best-effort: a failure here only costs readahead.
+  (void)fcntl(fd_, F_RDADVISE, &ra);
+}
+
 }  // namespace santa
@@ -25,6 +25,8 @@ __END_DECLS
 #include <cstddef>
 #include <cstdint>
 
+#include "Source/common/verifyinghasher/Sha256Hw.h"
+
 namespace santa {
 
 // Per-CS-hashType traits. Each struct fully describes how to verify pages
@@ -75,6 +77,24 @@ struct Sha256Algo {
   static constexpr size_t kDigestSize = CC_SHA256_DIGEST_LENGTH;  // 32
 };
 
+// SHA-256 on the CPU's SHA-2 instructions, see Sha256Hw.h. Only use where
+// Sha256Hw::Available(). Adds HashMulti/kLanes, which PageVerifierT uses to
+// hash several equal-length pages at once; see HashLanes() below.
+struct Sha256HwAlgo {
+  using Ctx = Sha256Hw::Ctx;
+  static constexpr size_t kDigestSize = Sha256Hw::kDigestSize;  // 32
+  static constexpr size_t kLanes = Sha256Hw::kLanes;
+  static void Init(Ctx* c) { Sha256Hw::Init(c); }
+  static void Update(Ctx* c, const void* d, size_t n) {
+    Sha256Hw::Update(c, d, n);
+  }
+  static void Final(unsigned char* m, Ctx* c) { Sha256Hw::Final(m, c); }
+  static void HashMulti(const uint8_t* const* messages, size_t count,
+                        size_t len, unsigned char (*digests)[kDigestSize]) {
+    Sha256Hw::HashMulti(messages, count, len, digests);
+  }
+};
+
 }  // namespace detail
 
 struct Sha1Traits {
@@ -105,6 +125,20 @@ struct Sha256TruncatedTraits : detail::Sha256Algo {
   static constexpr uint8_t kCsHashType = CS_HASHTYPE_SHA256_TRUNCATED;
 };
 
+// Same storage layout as Sha256Traits / Sha256TruncatedTraits, hashed with
+// detail::Sha256HwAlgo.
+struct Sha256HwTraits : detail::Sha256HwAlgo {
+  static constexpr size_t kSlotStride = CS_SHA256_LEN;   // 32
+  static constexpr size_t kCompareSize = CS_SHA256_LEN;  // 32
+  static constexpr uint8_t kCsHashType = CS_HASHTYPE_SHA256;
+};
+
+struct Sha256TruncatedHwTraits : detail::Sha256HwAlgo {
+  static constexpr size_t kSlotStride = CS_SHA256_TRUNCATED_LEN;   // 20
+  static constexpr size_t kCompareSize = CS_SHA256_TRUNCATED_LEN;  // 20
+  static constexpr uint8_t kCsHashType = CS_HASHTYPE_SHA256_TRUNCATED;
+};
+
 struct Sha384Traits {
   using Ctx = CC_SHA512_CTX;  // Apple uses CC_SHA512_CTX for SHA-384
   static constexpr int Init(Ctx* c) { return CC_SHA384_Init(c); }
@@ -149,6 +183,17 @@ struct NoopHashTraits {
   static void Final(unsigned char*, Ctx*) {}
 };
 
+// Number of equal-length messages Traits::HashMulti hashes together, or 1
+// for traits that can only hash one message at a time.
+template <typename Traits>
+constexpr size_t HashLanes() {
+  if constexpr (requires { Traits::kLanes; }) {
+    return Traits::kLanes;
+  } else {
+    return 1;
+  }
+}
+
 #undef VERIFYINGHASHER_CC_UPDATE_LOOP
 
 }  // namespace santa
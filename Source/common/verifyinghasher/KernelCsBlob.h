@@ -27,8 +27,9 @@
 
 namespace santa {
 
-// Extracts signing times (developer-controlled + RFC-3161 TSA) and
-// entitlement blob bytes from a kernel-resident code-signing SuperBlob.
+// Extracts signing times (developer-controlled + RFC-3161 TSA), the CMS
+// certificate chain and entitlement blob bytes from a kernel-resident
+// code-signing SuperBlob.
 //
 // TRUST CONTRACT — read before consuming Result:
 // KernelCsBlob does NOT cryptographically verify the CMS signer. It parses
@@ -48,6 +49,8 @@ namespace santa {
 //   - the intended consumer (BinaryAttestation) additionally gates on
 //     CS_VALID and a VH.cdhash == ES.cdhash cross-check before trusting any
 //     field here.
+// The same applies to `certificate_der`: the certificates are surfaced as
+// carried in the CMS message, with no trust evaluation of the chain.
 // `secure_signing_time` is the exception: the TSA token IS trust-evaluated
 // (via CMSDecoderCopySignerTimestampWithPolicy) before it is surfaced.
 //
@@ -68,6 +71,10 @@ class KernelCsBlob {
     std::optional<CFAbsoluteTime> secure_signing_time;
     std::optional<std::vector<uint8_t>> entitlement_der;
     std::optional<std::vector<uint8_t>> entitlement_xml;
+    // DER certificates from the CMS message, signer first and the rest in
+    // message order (intermediates, then the root, for codesign output).
+    // Empty unless status is kOk.
+    std::vector<std::vector<uint8_t>> certificate_der;
     std::string last_error;
   };
 
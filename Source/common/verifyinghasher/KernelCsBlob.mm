@@ -15,6 +15,7 @@
 #include "Source/common/verifyinghasher/KernelCsBlob.h"
 
 #include <Security/CMSDecoder.h>
+#include <Security/SecCertificate.h>
 #include <Security/SecPolicy.h>
 #include <bsm/libbsm.h>  // audit_token_to_pid
 #include <errno.h>
@@ -124,6 +125,37 @@ std::span<const uint8_t> FindSlotPayload(std::span<const uint8_t> cs_blob, uint3
   return {};
 }
 
+void AppendCertificateDER(SecCertificateRef cert, std::vector<std::vector<uint8_t>>& out) {
+  auto der = ScopedCFTypeRef<CFDataRef>::Assume(SecCertificateCopyData(cert));
+  if (!der) return;
+  const uint8_t* bytes = CFDataGetBytePtr(der.Unsafe());
+  out.emplace_back(bytes, bytes + CFDataGetLength(der.Unsafe()));
+}
+
+// Signer certificate first, so callers can treat element 0 as the leaf the
+// way MOLCodesignChecker's chain is ordered. Failing to read certificates
+// leaves the chain empty rather than failing the extraction.
+std::vector<std::vector<uint8_t>> CopyCertificateChain(CMSDecoderRef decoder) {
+  std::vector<std::vector<uint8_t>> chain;
+  ScopedCFTypeRef<SecCertificateRef> signer;
+  if (CMSDecoderCopySignerCert(decoder, /*signerIndex=*/0, signer.InitializeInto()) ==
+          errSecSuccess &&
+      signer) {
+    AppendCertificateDER(signer.Unsafe(), chain);
+  }
+
+  ScopedCFTypeRef<CFArrayRef> all;
+  if (CMSDecoderCopyAllCerts(decoder, all.InitializeInto()) != errSecSuccess || !all) {
+    return chain;
+  }
+  for (CFIndex i = 0; i < CFArrayGetCount(all.Unsafe()); ++i) {
+    auto cert = (SecCertificateRef)CFArrayGetValueAtIndex(all.Unsafe(), i);
+    if (signer && CFEqual(cert, signer.Unsafe())) continue;
+    AppendCertificateDER(cert, chain);
+  }
+  return chain;
+}
+
 }  // namespace
 
 KernelCsBlob::Result KernelCsBlob::ParseBytes(std::span<const uint8_t> kernel_cs_blob,
@@ -276,6 +308,7 @@ KernelCsBlob::Result KernelCsBlob::ParseBytes(std::span<const uint8_t> kernel_cs
     // TSA, succeed with secure_signing_time = nullopt.)
   }
 
+  r.certificate_der = CopyCertificateChain(cms_decoder.Unsafe());
   r.status = Status::kOk;
   return r;
 }
@@ -20,6 +20,7 @@ __BEGIN_DECLS
 #include <Kernel/kern/cs_blobs.h>
 __END_DECLS
 
+#import <Security/Security.h>
 #import <XCTest/XCTest.h>
 
 #include <fcntl.h>
@@ -376,6 +377,29 @@ std::vector<uint8_t> ExtractCdBytes(std::span<const uint8_t> cs_blob) {
   XCTAssertEqual(r.status, santa::KernelCsBlob::Status::kNoCmsSignature);
   XCTAssertFalse(r.signing_time.has_value());
   XCTAssertFalse(r.secure_signing_time.has_value());
+  XCTAssertTrue(r.certificate_der.empty());
+}
+
+- (void)testParseBytesExtractsCertificateChainSignerFirst {
+  auto cs_blob = Slurp([self fixturePath:@"santactl_2026.4.csblob"].UTF8String);
+  XCTAssertFalse(cs_blob.empty());
+  auto cd_bytes = ExtractCdBytes(cs_blob);
+
+  auto r = santa::KernelCsBlob::ParseBytes(cs_blob, cd_bytes);
+
+  XCTAssertEqual(r.status, santa::KernelCsBlob::Status::kOk);
+  // Developer ID leaf, Developer ID CA and Apple Root CA.
+  XCTAssertEqual(r.certificate_der.size(), 3);
+  if (r.certificate_der.empty()) return;
+
+  NSData* leafDER = [NSData dataWithBytes:r.certificate_der[0].data()
+                                   length:r.certificate_der[0].size()];
+  SecCertificateRef leaf = SecCertificateCreateWithData(NULL, (__bridge CFDataRef)leafDER);
+  XCTAssertNotEqual(leaf, nullptr);
+  if (!leaf) return;
+  NSString* summary = CFBridgingRelease(SecCertificateCopySubjectSummary(leaf));
+  XCTAssertTrue([summary hasPrefix:@"Developer ID Application"], @"leaf was %@", summary);
+  CFRelease(leaf);
 }
 
 - (void)testParseBytesExtractsSecureSigningTimeFromNotarizedBinary {
@@ -89,22 +89,9 @@ class PageVerifierT {
       input_end = UINT64_MAX;
     }
     uint64_t b = std::min<uint64_t>(input_end, signed_hi_);
-    if (a < b) {
-      // Contract: a (file offset of the next byte to consume) must equal
-      // the next-expected offset = signed_lo_ + cur_slot_*page_size_
-      // + cur_page_bytes_. Compute as `a - signed_lo_` vs.
-      // `cur_slot_*page_size_ + cur_page_bytes_` so the comparand stays
-      // well below total_file_size, and wrap each step in os_*_overflow
-      // so the check doesn't silently rely on C2/H3 keeping the multiply
-      // small.
-      uint64_t slot_offset, already;
-      if (os_mul_overflow(static_cast<uint64_t>(cur_slot_),
-                          static_cast<uint64_t>(page_size_), &slot_offset) ||
-          os_add_overflow(slot_offset, cur_page_bytes_, &already) ||
-          (a - signed_lo_) != already) {
-        stream_corrupt_ = true;
-        return;
-      }
+    if (a < b && !AtExpectedOffset(a)) {
+      stream_corrupt_ = true;
+      return;
     }
     if constexpr (std::is_same_v<HashTraits, NoopHashTraits>) {
       // Bulk-advance the page counter by the in-region byte count.
@@ -175,6 +162,83 @@ class PageVerifierT {
     }
   }
 
+  // Same contract and end state as Update(), but the pages that lie wholly
+  // inside the chunk are hashed concurrently. `parallel_for(count, fn)` must
+  // call fn(i) exactly once for every i in [0, count), from any threads, and
+  // return only once all calls have finished. A page left open by the
+  // previous chunk, or cut off by the end of this one, is hashed serially
+  // through ctx_ as Update() would, so chunks need not be page-aligned.
+  // Results are tallied in slot order afterwards, so Mismatches() and
+  // MismatchedSlots() are identical to a serial run over the same bytes.
+  // For traits with HashMulti, each fn(i) hashes a group of HashLanes()
+  // consecutive pages together rather than a single page.
+  template <typename ParallelFor>
+  void UpdateParallel(const uint8_t* data, size_t len, uint64_t chunk_off,
+                      ParallelFor&& parallel_for) {
+    if constexpr (std::is_same_v<HashTraits, NoopHashTraits>) {
+      // Nothing to parallelize; the bulk advance is already O(1).
+      Update(data, len, chunk_off);
+    } else {
+      if (stream_corrupt_) return;
+      uint64_t input_end;
+      if (os_add_overflow(chunk_off, static_cast<uint64_t>(len), &input_end)) {
+        input_end = UINT64_MAX;
+      }
+      const uint64_t a = std::max<uint64_t>(chunk_off, signed_lo_);
+      const uint64_t b = std::min<uint64_t>(input_end, signed_hi_);
+      if (a >= b) return;
+      if (!AtExpectedOffset(a)) {
+        stream_corrupt_ = true;
+        return;
+      }
+
+      // Finish the page the previous chunk left open, if any.
+      uint64_t p = a;
+      if (cur_page_bytes_ != 0) {
+        p = std::min<uint64_t>(b, a + ExpectedPageLen(cur_slot_) -
+                                      cur_page_bytes_);
+        Update(data + (a - chunk_off), static_cast<size_t>(p - a), a);
+      }
+
+      // Pages wholly inside [p, b). Only the last page of the signed region
+      // may be short, and it is whole iff the chunk reaches signed_hi_.
+      uint64_t count = (b - p) / page_size_;
+      if (b == signed_hi_ && p + count * page_size_ < b) ++count;
+      if (count > 0) {
+        const uint32_t first_slot = cur_slot_;
+        const uint8_t* pages = data + (p - chunk_off);
+        page_results_.resize(count);
+        // Each index is a group of up to kLanes consecutive pages, handed to
+        // HashMulti together when the traits support it.
+        const size_t groups =
+            (static_cast<size_t>(count) + kLanes - 1) / kLanes;
+        parallel_for(groups, [&](size_t g) {
+          const size_t first = g * kLanes;
+          HashPageGroup(pages, first_slot, first,
+                        std::min<size_t>(kLanes, count - first));
+        });
+        for (uint64_t i = 0; i < count; ++i) {
+          if (page_results_[i]) {
+            ++mismatches_;
+            if (mismatched_slots_.size() < kMaxRecordedMismatches) {
+              mismatched_slots_.push_back(first_slot +
+                                          static_cast<uint32_t>(i));
+            }
+          }
+        }
+        cur_slot_ += static_cast<uint32_t>(count);
+        p = std::min<uint64_t>(b, p + count * page_size_);
+        // ctx_ was not touched above: cur_page_bytes_ is zero here, so ctx_
+        // is still freshly initialized for the next page.
+      }
+
+      // Start the page cut off by the end of the chunk.
+      if (p < b) {
+        Update(data + (p - chunk_off), static_cast<size_t>(b - p), p);
+      }
+    }
+  }
+
   uint32_t Mismatches() const { return mismatches_; }
   std::span<const uint32_t> MismatchedSlots() const {
     return mismatched_slots_;
@@ -190,6 +254,64 @@ class PageVerifierT {
   }
 
  private:
+  static constexpr size_t kLanes = HashLanes<HashTraits>();
+
+  // Hashes pages [first, first + n) of the run of whole pages at `pages`,
+  // whose first page is slot `first_slot`, and records which mismatched in
+  // page_results_. Safe to call for disjoint groups concurrently.
+  void HashPageGroup(const uint8_t* pages, uint32_t first_slot, size_t first,
+                     size_t n) {
+    unsigned char digests[kLanes][HashTraits::kDigestSize];
+    size_t hashed = 0;
+    if constexpr (kLanes > 1) {
+      // HashMulti takes equal-length messages, and only the last page of the
+      // signed region may be short, so at most the last one is left out.
+      size_t same_len = n;
+      if (ExpectedPageLen(first_slot + static_cast<uint32_t>(first + n - 1)) !=
+          page_size_) {
+        --same_len;
+      }
+      const uint8_t* messages[kLanes];
+      for (size_t i = 0; i < same_len; ++i) {
+        messages[i] = pages + (first + i) * page_size_;
+      }
+      HashTraits::HashMulti(messages, same_len, page_size_, digests);
+      hashed = same_len;
+    }
+    for (size_t i = hashed; i < n; ++i) {
+      const uint32_t slot = first_slot + static_cast<uint32_t>(first + i);
+      typename HashTraits::Ctx ctx;
+      HashTraits::Init(&ctx);
+      HashTraits::Update(&ctx, pages + (first + i) * page_size_,
+                         ExpectedPageLen(slot));
+      HashTraits::Final(digests[i], &ctx);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      const uint32_t slot = first_slot + static_cast<uint32_t>(first + i);
+      const uint8_t* expected =
+          slot_hashes_.data() +
+          static_cast<size_t>(slot) * HashTraits::kSlotStride;
+      page_results_[first + i] =
+          std::memcmp(digests[i], expected, HashTraits::kCompareSize) != 0;
+    }
+  }
+
+  // Contract: a (file offset of the next byte to consume) must equal
+  // the next-expected offset = signed_lo_ + cur_slot_*page_size_
+  // + cur_page_bytes_. Compute as `a - signed_lo_` vs.
+  // `cur_slot_*page_size_ + cur_page_bytes_` so the comparand stays
+  // well below total_file_size, and wrap each step in os_*_overflow
+  // so the check doesn't silently rely on C2/H3 keeping the multiply
+  // small.
+  bool AtExpectedOffset(uint64_t a) const {
+    uint64_t slot_offset, already;
+    return !os_mul_overflow(static_cast<uint64_t>(cur_slot_),
+                            static_cast<uint64_t>(page_size_), &slot_offset) &&
+           !os_add_overflow(slot_offset, cur_page_bytes_, &already) &&
+           (a - signed_lo_) == already;
+  }
+
   uint64_t ExpectedPageLen(uint32_t slot) const {
     const uint64_t code_len = signed_hi_ - signed_lo_;
     const uint64_t remaining =
@@ -216,6 +338,9 @@ class PageVerifierT {
   uint32_t mismatches_ = 0;
   bool stream_corrupt_ = false;
   std::vector<uint32_t> mismatched_slots_;
+  // Per-page scratch for UpdateParallel(); one byte per page so concurrent
+  // writers never share a bit.
+  std::vector<uint8_t> page_results_;
 };
 
 }  // namespace santa
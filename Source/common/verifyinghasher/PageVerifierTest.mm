@@ -28,6 +28,8 @@
 using santa::NoopHashTraits;
 using santa::PageVerifierT;
 using santa::Sha1Traits;
+using santa::Sha256HwTraits;
+using santa::Sha256TruncatedHwTraits;
 using santa::Sha256Traits;
 using santa::Sha256TruncatedTraits;
 using santa::Sha384Traits;
@@ -114,6 +116,11 @@ bool RunOneTraitsBody() {
   XCTAssertTrue(RunOneTraitsBody<Sha256TruncatedTraits>());
 }
 
+- (void)testRunOneTraitsSha256Hw {
+  XCTAssertTrue(RunOneTraitsBody<Sha256HwTraits>());
+  XCTAssertTrue(RunOneTraitsBody<Sha256TruncatedHwTraits>());
+}
+
 // Regression test for the SHA-256-TRUNCATED slot-stride bug: PageVerifier
 // must walk slot_hashes at stride 20 (not 32) and compare 20 bytes. With the
 // stride-20 packed slot table that the parser produces, advance-by-32 reads
@@ -237,4 +244,97 @@ bool RunOneTraitsBody() {
   XCTAssertTrue(pv.Complete());
 }
 
+// UpdateParallel must reach the same end state as Update for any chunking:
+// leading/trailing partial pages, chunks smaller than a page, and a short
+// last page. The ParallelFor runs indices in reverse to catch any
+// dependence on call order.
+- (void)testUpdateParallelMatchesUpdate {
+  std::mt19937 rng(0xFEED);
+  std::vector<uint8_t> bytes(123 * 1024);
+  for (auto& b : bytes)
+    b = static_cast<uint8_t>(rng());
+  constexpr uint32_t kPage = 4096;
+  const uint64_t lo = 1024, hi = bytes.size();
+  auto slots = ComputeSlots<Sha256Traits>(bytes, lo, hi, kPage);
+  bytes[lo + 2 * kPage + 7] ^= 0xFF;
+  bytes[lo + 9 * kPage] ^= 0xFF;
+  bytes[hi - 1] ^= 0xFF;
+
+  PageVerifierT<Sha256Traits> serial(lo, hi, kPage, slots);
+  serial.Update(bytes.data(), bytes.size(), 0);
+  XCTAssertEqual(serial.Mismatches(), 3u);
+
+  auto reverse_for = [](size_t count, const auto& fn) {
+    for (size_t i = count; i > 0; --i)
+      fn(i - 1);
+  };
+  for (size_t chunk : {100u, 4096u, 10000u, 65536u, 200000u}) {
+    PageVerifierT<Sha256Traits> pv(lo, hi, kPage, slots);
+    for (uint64_t off = 0; off < bytes.size(); off += chunk) {
+      size_t n = std::min<size_t>(chunk, bytes.size() - off);
+      pv.UpdateParallel(bytes.data() + off, n, off, reverse_for);
+    }
+    XCTAssertFalse(pv.StreamCorrupt(), @"chunk=%zu", chunk);
+    XCTAssertTrue(pv.Complete(), @"chunk=%zu", chunk);
+    XCTAssertEqual(pv.Mismatches(), serial.Mismatches(), @"chunk=%zu", chunk);
+    XCTAssertTrue(std::equal(pv.MismatchedSlots().begin(), pv.MismatchedSlots().end(),
+                             serial.MismatchedSlots().begin(), serial.MismatchedSlots().end()),
+                  @"chunk=%zu", chunk);
+  }
+}
+
+// Under Sha256HwTraits pages are hashed in groups through HashMulti. Slots
+// are computed with CommonCrypto so the two backends are checked against
+// each other, with odd and even page counts so a group is sometimes cut
+// short by the short last page.
+- (void)testUpdateParallelHwTraits {
+  constexpr uint32_t kPage = 4096;
+  for (size_t size : {123u * 1024, 124u * 1024, 128u * 1024 + 1024}) {
+    std::mt19937 rng(0xBEEF);
+    std::vector<uint8_t> bytes(size);
+    for (auto& b : bytes)
+      b = static_cast<uint8_t>(rng());
+    const uint64_t lo = 1024, hi = bytes.size();
+    auto slots = ComputeSlots<Sha256Traits>(bytes, lo, hi, kPage);
+    bytes[lo + 3 * kPage + 1] ^= 0xFF;
+    bytes[lo + 4 * kPage + 2] ^= 0xFF;
+    bytes[hi - 1] ^= 0xFF;
+
+    PageVerifierT<Sha256Traits> serial(lo, hi, kPage, slots);
+    serial.Update(bytes.data(), bytes.size(), 0);
+    XCTAssertEqual(serial.Mismatches(), 3u);
+
+    auto reverse_for = [](size_t count, const auto& fn) {
+      for (size_t i = count; i > 0; --i)
+        fn(i - 1);
+    };
+    for (size_t chunk : {4096u, 10000u, 200000u}) {
+      PageVerifierT<Sha256HwTraits> pv(lo, hi, kPage, slots);
+      for (uint64_t off = 0; off < bytes.size(); off += chunk) {
+        size_t n = std::min<size_t>(chunk, bytes.size() - off);
+        pv.UpdateParallel(bytes.data() + off, n, off, reverse_for);
+      }
+      XCTAssertFalse(pv.StreamCorrupt(), @"size=%zu chunk=%zu", size, chunk);
+      XCTAssertTrue(pv.Complete(), @"size=%zu chunk=%zu", size, chunk);
+      XCTAssertTrue(std::equal(pv.MismatchedSlots().begin(), pv.MismatchedSlots().end(),
+                               serial.MismatchedSlots().begin(), serial.MismatchedSlots().end()),
+                    @"size=%zu chunk=%zu", size, chunk);
+    }
+  }
+}
+
+- (void)testUpdateParallelGapDetected {
+  std::vector<uint8_t> bytes(8 * 4096);
+  auto slots = ComputeSlots<Sha256Traits>(bytes, 0, bytes.size(), 4096);
+  auto serial_for = [](size_t count, const auto& fn) {
+    for (size_t i = 0; i < count; ++i)
+      fn(i);
+  };
+  PageVerifierT<Sha256Traits> pv(0, bytes.size(), 4096, slots);
+  pv.UpdateParallel(bytes.data(), 4096, 0, serial_for);
+  XCTAssertFalse(pv.StreamCorrupt());
+  pv.UpdateParallel(bytes.data() + 8192, 8192, 8192, serial_for);  // gap: missing [4096, 8192)
+  XCTAssertTrue(pv.StreamCorrupt());
+}
+
 @end
@@ -0,0 +1,93 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_VERIFYINGHASHER_READAHEADFILEREADER_H
+#define SANTA_COMMON_VERIFYINGHASHER_READAHEADFILEREADER_H
+
+#include <dispatch/dispatch.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "Source/common/verifyinghasher/FileReader.h"
+#include "Source/common/verifyinghasher/UninitBuffer.h"
+
+namespace santa {
+
+// FileReader adaptor that overlaps reads with the caller's processing.
+// Within the range most recently passed to WillRead(), up to `depth` reads
+// of `buf_size` bytes are kept in flight on a background serial queue, and
+// Pread calls that continue the range sequentially are served from those
+// buffers. Anything else drains the pipeline and falls through to the
+// wrapped reader synchronously.
+//
+// Single observation: only hinted bytes are prefetched, each exactly once,
+// and a hit hands out bytes that were read once and never re-read. A caller
+// that issues a WillRead() and then reads inside the range out of order
+// would cause bytes to be read twice, so VerifyingHasherCore only hints
+// ranges it then consumes front to back.
+//
+// The wrapped reader is only ever called from one thread at a time: the
+// pipeline is drained before any synchronous fall-through read. Not
+// thread-safe itself; like every FileReader it has a single caller.
+class ReadAheadFileReader : public FileReader {
+ public:
+  ReadAheadFileReader(FileReader& inner, size_t buf_size, size_t depth);
+  ~ReadAheadFileReader() override;
+
+  ReadAheadFileReader(const ReadAheadFileReader&) = delete;
+  ReadAheadFileReader& operator=(const ReadAheadFileReader&) = delete;
+
+  // A hit may return fewer than `len` bytes only at the end of the hinted
+  // range or at a short read from the wrapped reader.
+  ssize_t Pread(void* buf, size_t len, off_t off) override;
+  off_t Size() const override { return inner_.Size(); }
+  // Drains any previous pipeline, forwards the hint to the wrapped reader
+  // and starts prefetching from `off`.
+  void WillRead(off_t off, size_t len) override;
+
+ private:
+  struct Slot {
+    UninitBuffer buf;
+    off_t off = 0;
+    size_t want = 0;
+    ssize_t n = 0;
+    int err = 0;
+    // Set once `done` has been waited on for the current read.
+    bool ready = false;
+    dispatch_semaphore_t done;
+  };
+
+  void Issue(Slot& slot);
+  void Drain();
+
+  FileReader& inner_;
+  const size_t buf_size_;
+  dispatch_queue_t queue_;
+  std::vector<Slot> slots_;
+  // Slot at the front of the pipeline and how much of it has been consumed.
+  size_t head_ = 0;
+  size_t head_pos_ = 0;
+  size_t in_flight_ = 0;
+  // The part of the hinted range not yet issued.
+  off_t next_issue_ = 0;
+  off_t end_ = 0;
+  // Offset a Pread must start at to be served from the pipeline.
+  off_t next_read_ = -1;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_VERIFYINGHASHER_READAHEADFILEREADER_H
@@ -0,0 +1,135 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/verifyinghasher/ReadAheadFileReader.h"
+
+#include <pthread/qos.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace santa {
+
+ReadAheadFileReader::ReadAheadFileReader(FileReader& inner, size_t buf_size, size_t depth)
+    : inner_(inner), buf_size_(std::max<size_t>(buf_size, 1)), slots_(std::max<size_t>(depth, 1)) {
+  // Reads are on the caller's critical path, so run them at its QoS.
+  queue_ = dispatch_queue_create(
+      "com.northpolesec.santa.verifyinghasher.readahead",
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, qos_class_self(), 0));
+  for (Slot& slot : slots_) {
+    slot.buf.Allocate(buf_size_);
+    slot.done = dispatch_semaphore_create(0);
+  }
+}
+
+ReadAheadFileReader::~ReadAheadFileReader() {
+  // Background reads reference the slots.
+  Drain();
+}
+
+void ReadAheadFileReader::Issue(Slot& slot) {
+  slot.off = next_issue_;
+  slot.want =
+      static_cast<size_t>(std::min<off_t>(static_cast<off_t>(buf_size_), end_ - next_issue_));
+  next_issue_ += static_cast<off_t>(slot.want);
+  slot.ready = false;
+  ++in_flight_;
+
+  FileReader* inner = &inner_;
+  Slot* s = &slot;
+  dispatch_async(queue_, ^{
+    s->n = inner->Pread(s->buf.data(), s->want, s->off);
+    s->err = s->n < 0 ? errno : 0;
+    dispatch_semaphore_signal(s->done);
+  });
+}
+
+void ReadAheadFileReader::Drain() {
+  for (size_t i = 0; i < in_flight_; ++i) {
+    Slot& slot = slots_[(head_ + i) % slots_.size()];
+    if (!slot.ready) {
+      dispatch_semaphore_wait(slot.done, DISPATCH_TIME_FOREVER);
+      slot.ready = true;
+    }
+  }
+  head_ = 0;
+  head_pos_ = 0;
+  in_flight_ = 0;
+  next_issue_ = 0;
+  end_ = 0;
+  next_read_ = -1;
+}
+
+void ReadAheadFileReader::WillRead(off_t off, size_t len) {
+  Drain();
+  inner_.WillRead(off, len);
+  if (off < 0 || len == 0) return;
+  next_issue_ = off;
+  end_ = std::min<off_t>(off + static_cast<off_t>(len), inner_.Size());
+  next_read_ = off;
+  for (Slot& slot : slots_) {
+    if (next_issue_ >= end_) break;
+    Issue(slot);
+  }
+}
+
+ssize_t ReadAheadFileReader::Pread(void* buf, size_t len, off_t off) {
+  if (in_flight_ == 0 || off != next_read_) {
+    Drain();
+    return inner_.Pread(buf, len, off);
+  }
+
+  auto* p = static_cast<uint8_t*>(buf);
+  size_t total = 0;
+  while (total < len && in_flight_ > 0) {
+    Slot& slot = slots_[head_];
+    if (!slot.ready) {
+      dispatch_semaphore_wait(slot.done, DISPATCH_TIME_FOREVER);
+      slot.ready = true;
+    }
+    if (slot.n < 0) {
+      // Surface the error at the offset it happened, but not past bytes
+      // already handed out by this call.
+      const int err = slot.err;
+      Drain();
+      if (total > 0) return static_cast<ssize_t>(total);
+      errno = err;
+      return -1;
+    }
+
+    const size_t k = std::min(len - total, static_cast<size_t>(slot.n) - head_pos_);
+    std::memcpy(p + total, slot.buf.data() + head_pos_, k);
+    total += k;
+    head_pos_ += k;
+    next_read_ += static_cast<off_t>(k);
+    if (head_pos_ < static_cast<size_t>(slot.n)) break;
+
+    // Slot fully consumed. Retire it and reuse it for the next read.
+    const bool short_read = static_cast<size_t>(slot.n) < slot.want;
+    head_pos_ = 0;
+    head_ = (head_ + 1) % slots_.size();
+    --in_flight_;
+    if (short_read) {
+      // Later slots start past a hole; the caller sees the short read and
+      // decides what to do (at EOF the remaining slots would be empty).
+      Drain();
+      break;
+    }
+    if (next_issue_ < end_) Issue(slot);
+  }
+  return static_cast<ssize_t>(total);
+}
+
+}  // namespace santa
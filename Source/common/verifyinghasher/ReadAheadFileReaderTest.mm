@@ -0,0 +1,128 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/verifyinghasher/ReadAheadFileReader.h"
+
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Source/common/verifyinghasher/CountingMemoryFileReader.h"
+#include "Source/common/verifyinghasher/MemoryFileReader.h"
+
+using santa::CountingMemoryFileReader;
+using santa::MemoryFileReader;
+using santa::ReadAheadFileReader;
+
+namespace {
+
+std::vector<uint8_t> Pattern(size_t n) {
+  std::vector<uint8_t> v(n);
+  for (size_t i = 0; i < n; ++i)
+    v[i] = static_cast<uint8_t>(i * 31 + 7);
+  return v;
+}
+
+}  // namespace
+
+@interface ReadAheadFileReaderTest : XCTestCase
+@end
+
+@implementation ReadAheadFileReaderTest
+
+- (void)testSequentialReadsServedOnce {
+  // Reads of 1000 bytes against 4096-byte slots straddle slot boundaries
+  // and end on a partial slot.
+  const auto data = Pattern(100000);
+  CountingMemoryFileReader inner(data);
+  ReadAheadFileReader r(inner, 4096, 3);
+  XCTAssertEqual(r.Size(), static_cast<off_t>(data.size()));
+
+  r.WillRead(500, data.size() - 500);
+  std::vector<uint8_t> out(data.size() - 500);
+  size_t got = 0;
+  while (got < out.size()) {
+    size_t want = std::min<size_t>(1000, out.size() - got);
+    ssize_t n = r.Pread(out.data() + got, want, static_cast<off_t>(500 + got));
+    XCTAssertGreaterThan(n, 0);
+    XCTAssertLessThanOrEqual(n, static_cast<ssize_t>(want));
+    got += static_cast<size_t>(n);
+  }
+  XCTAssertEqual(0, std::memcmp(out.data(), data.data() + 500, out.size()));
+  XCTAssertEqual(inner.MaxReadsAnyByte(), 1u);
+}
+
+- (void)testLargeReadSpansSlots {
+  const auto data = Pattern(50000);
+  CountingMemoryFileReader inner(data);
+  ReadAheadFileReader r(inner, 4096, 2);
+  r.WillRead(0, data.size());
+
+  // A single read larger than all slots combined is filled across slots as
+  // they complete and are reissued.
+  std::vector<uint8_t> out(data.size());
+  XCTAssertEqual(r.Pread(out.data(), out.size(), 0), static_cast<ssize_t>(out.size()));
+  XCTAssertEqual(0, std::memcmp(out.data(), data.data(), out.size()));
+  XCTAssertEqual(inner.MaxReadsAnyByte(), 1u);
+}
+
+- (void)testOutOfRangeReadFallsThrough {
+  const auto data = Pattern(20000);
+  MemoryFileReader inner(data);
+  ReadAheadFileReader r(inner, 4096, 2);
+
+  // No hint: every read goes straight to the wrapped reader.
+  uint8_t buf[16];
+  XCTAssertEqual(r.Pread(buf, sizeof(buf), 100), 16);
+  XCTAssertEqual(buf[0], data[100]);
+
+  // A read that doesn't continue the hinted range drains the pipeline and
+  // is still served correctly.
+  r.WillRead(0, 8192);
+  XCTAssertEqual(r.Pread(buf, sizeof(buf), 15000), 16);
+  XCTAssertEqual(buf[0], data[15000]);
+  XCTAssertEqual(r.Pread(buf, sizeof(buf), 0), 16);
+  XCTAssertEqual(buf[0], data[0]);
+}
+
+- (void)testHintPastEofIsClamped {
+  const auto data = Pattern(10000);
+  CountingMemoryFileReader inner(data);
+  ReadAheadFileReader r(inner, 4096, 4);
+  r.WillRead(8000, 1u << 20);
+
+  uint8_t buf[4096];
+  XCTAssertEqual(r.Pread(buf, sizeof(buf), 8000), 2000);
+  XCTAssertEqual(r.Pread(buf, sizeof(buf), 10000), 0);
+  XCTAssertEqual(inner.MaxReadsAnyByte(), 1u);
+}
+
+- (void)testErrorIsSurfaced {
+  const auto data = Pattern(20000);
+  MemoryFileReader inner(data);
+  ReadAheadFileReader r(inner, 4096, 2);
+  inner.ScheduleErrorOnNextPread();
+  r.WillRead(0, data.size());
+
+  uint8_t buf[4096];
+  errno = 0;
+  XCTAssertEqual(r.Pread(buf, sizeof(buf), 0), -1);
+  XCTAssertEqual(errno, EIO);
+}
+
+@end
@@ -0,0 +1,79 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_VERIFYINGHASHER_SHA256HW_H
+#define SANTA_COMMON_VERIFYINGHASHER_SHA256HW_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The SHA-2 instructions are part of the arm64 baseline on every Apple
+// Silicon Mac, so the hardware path is selected at compile time there. Only
+// some Intel Macs have SHA-NI, so x86_64 checks the CPU once at runtime.
+#if defined(__aarch64__) && defined(__ARM_FEATURE_SHA2)
+#define SANTA_SHA256HW_ARM64 1
+#elif defined(__x86_64__)
+#define SANTA_SHA256HW_X86 1
+#endif
+
+namespace santa {
+
+// SHA-256 computed directly with the ARMv8 SHA-2 crypto extensions or
+// SHA-NI, rather than through CommonCrypto.
+//
+// The point of going around CommonCrypto is HashMulti(): code signing page
+// hashes are independent messages of the same length, and the SHA-256
+// round instructions have a latency of several cycles, so compressing two
+// pages with interleaved rounds keeps the crypto unit busy where a single
+// page would stall on each round's result.
+//
+// On CPUs without either extension a portable implementation keeps the
+// results correct, but it is much slower than CommonCrypto, so callers
+// should only pick this backend when Available() is true.
+class Sha256Hw {
+ public:
+  static constexpr size_t kBlockSize = 64;
+  static constexpr size_t kDigestSize = 32;
+  // Messages hashed together by HashMulti(). Two streams cover most of the
+  // round latency; more only add register pressure.
+  static constexpr size_t kLanes = 2;
+
+  struct Ctx {
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t buffer[kBlockSize];
+  };
+
+#if defined(SANTA_SHA256HW_ARM64)
+  static constexpr bool Available() { return true; }
+#elif defined(SANTA_SHA256HW_X86)
+  static bool Available();
+#else
+  static constexpr bool Available() { return false; }
+#endif
+
+  static void Init(Ctx* ctx);
+  static void Update(Ctx* ctx, const void* data, size_t len);
+  static void Final(unsigned char* digest, Ctx* ctx);
+
+  // Hash `count` messages that are all `len` bytes long, writing one
+  // kDigestSize digest per message to `digests`. Messages are compressed
+  // kLanes at a time.
+  static void HashMulti(const uint8_t* const* messages, size_t count,
+                        size_t len, unsigned char (*digests)[kDigestSize]);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_VERIFYINGHASHER_SHA256HW_H
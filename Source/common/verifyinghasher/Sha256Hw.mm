@@ -0,0 +1,359 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/verifyinghasher/Sha256Hw.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(SANTA_SHA256HW_ARM64)
+#include <arm_neon.h>
+#elif defined(SANTA_SHA256HW_X86)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace santa {
+
+namespace {
+
+alignas(16) constexpr uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr uint32_t kInitialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+uint32_t LoadBigEndian32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+void StoreBigEndian32(uint32_t v, uint8_t* p) {
+  p[0] = static_cast<uint8_t>(v >> 24);
+  p[1] = static_cast<uint8_t>(v >> 16);
+  p[2] = static_cast<uint8_t>(v >> 8);
+  p[3] = static_cast<uint8_t>(v);
+}
+
+// Reference implementation of the compression function, FIPS 180-4 6.2.2.
+// Only used on CPUs without SHA-2 instructions.
+template <size_t N>
+void CompressPortable(uint32_t* const* states, const uint8_t* const* blocks, size_t nblocks) {
+  for (size_t lane = 0; lane < N; ++lane) {
+    uint32_t* s = states[lane];
+    const uint8_t* p = blocks[lane];
+    for (size_t i = 0; i < nblocks; ++i, p += Sha256Hw::kBlockSize) {
+      uint32_t w[64];
+      for (int t = 0; t < 16; ++t) {
+        w[t] = LoadBigEndian32(p + 4 * t);
+      }
+      for (int t = 16; t < 64; ++t) {
+        uint32_t s0 = std::rotr(w[t - 15], 7) ^ std::rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+        uint32_t s1 = std::rotr(w[t - 2], 17) ^ std::rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+        w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+      }
+
+      uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+      for (int t = 0; t < 64; ++t) {
+        uint32_t t1 = h + (std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25)) +
+                      ((e & f) ^ (~e & g)) + kRoundConstants[t] + w[t];
+        uint32_t t2 = (std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+      }
+      s[0] += a;
+      s[1] += b;
+      s[2] += c;
+      s[3] += d;
+      s[4] += e;
+      s[5] += f;
+      s[6] += g;
+      s[7] += h;
+    }
+  }
+}
+
+// The hardware implementations below compress N blocks at a time, one per
+// lane. Each lane's rounds depend only on that lane's previous round, so
+// issuing the lanes' instructions back to back lets them overlap.
+//
+// Both run the 64 rounds as 16 groups of four, keeping the message schedule
+// in a rolling window of four vectors: group j (j >= 4) is derived from
+// groups j-4 through j-1, which are at indices j, j+1, j+2 and j+3 mod 4.
+
+#if defined(SANTA_SHA256HW_ARM64)
+
+template <size_t N>
+void Compress(uint32_t* const* states, const uint8_t* const* blocks, size_t nblocks) {
+  uint32x4_t abcd[N], efgh[N];
+  const uint8_t* p[N];
+  for (size_t lane = 0; lane < N; ++lane) {
+    abcd[lane] = vld1q_u32(states[lane]);
+    efgh[lane] = vld1q_u32(states[lane] + 4);
+    p[lane] = blocks[lane];
+  }
+
+  for (size_t b = 0; b < nblocks; ++b) {
+    uint32x4_t abcd_save[N], efgh_save[N];
+    uint32x4_t w[N][4];
+    for (size_t lane = 0; lane < N; ++lane) {
+      abcd_save[lane] = abcd[lane];
+      efgh_save[lane] = efgh[lane];
+    }
+
+    for (int j = 0; j < 16; ++j) {
+      const uint32x4_t k = vld1q_u32(&kRoundConstants[4 * j]);
+      for (size_t lane = 0; lane < N; ++lane) {
+        if (j < 4) {
+          w[lane][j] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p[lane] + 16 * j)));
+        } else {
+          w[lane][j & 3] =
+              vsha256su1q_u32(vsha256su0q_u32(w[lane][j & 3], w[lane][(j + 1) & 3]),
+                              w[lane][(j + 2) & 3], w[lane][(j + 3) & 3]);
+        }
+        const uint32x4_t msg = vaddq_u32(w[lane][j & 3], k);
+        const uint32x4_t prev_abcd = abcd[lane];
+        abcd[lane] = vsha256hq_u32(abcd[lane], efgh[lane], msg);
+        efgh[lane] = vsha256h2q_u32(efgh[lane], prev_abcd, msg);
+      }
+    }
+
+    for (size_t lane = 0; lane < N; ++lane) {
+      abcd[lane] = vaddq_u32(abcd[lane], abcd_save[lane]);
+      efgh[lane] = vaddq_u32(efgh[lane], efgh_save[lane]);
+      p[lane] += Sha256Hw::kBlockSize;
+    }
+  }
+
+  for (size_t lane = 0; lane < N; ++lane) {
+    vst1q_u32(states[lane], abcd[lane]);
+    vst1q_u32(states[lane] + 4, efgh[lane]);
+  }
+}
+
+#elif defined(SANTA_SHA256HW_X86)
+
+// SHA-NI keeps the state as ABEF and CDGH rather than ABCD and EFGH, so it
+// is shuffled on the way in and out.
+template <size_t N>
+__attribute__((target("sha,sse4.1"))) void CompressShaNi(uint32_t* const* states,
+                                                         const uint8_t* const* blocks,
+                                                         size_t nblocks) {
+  const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i abef[N], cdgh[N];
+  const uint8_t* p[N];
+  for (size_t lane = 0; lane < N; ++lane) {
+    __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(states[lane]));
+    __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i*>(states[lane] + 4));
+    __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+    abef[lane] = _mm_alignr_epi8(cdab, efgh, 8);
+    cdgh[lane] = _mm_blend_epi16(efgh, cdab, 0xF0);
+    p[lane] = blocks[lane];
+  }
+
+  for (size_t b = 0; b < nblocks; ++b) {
+    __m128i abef_save[N], cdgh_save[N];
+    __m128i w[N][4];
+    for (size_t lane = 0; lane < N; ++lane) {
+      abef_save[lane] = abef[lane];
+      cdgh_save[lane] = cdgh[lane];
+    }
+
+    for (int j = 0; j < 16; ++j) {
+      const __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(&kRoundConstants[4 * j]));
+      for (size_t lane = 0; lane < N; ++lane) {
+        if (j < 4) {
+          w[lane][j] = _mm_shuffle_epi8(
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(p[lane] + 16 * j)), byte_swap);
+        } else {
+          w[lane][j & 3] = _mm_sha256msg2_epu32(
+              _mm_add_epi32(_mm_sha256msg1_epu32(w[lane][j & 3], w[lane][(j + 1) & 3]),
+                            _mm_alignr_epi8(w[lane][(j + 3) & 3], w[lane][(j + 2) & 3], 4)),
+              w[lane][(j + 3) & 3]);
+        }
+        const __m128i msg = _mm_add_epi32(w[lane][j & 3], k);
+        cdgh[lane] = _mm_sha256rnds2_epu32(cdgh[lane], abef[lane], msg);
+        abef[lane] = _mm_sha256rnds2_epu32(abef[lane], cdgh[lane], _mm_shuffle_epi32(msg, 0x0E));
+      }
+    }
+
+    for (size_t lane = 0; lane < N; ++lane) {
+      abef[lane] = _mm_add_epi32(abef[lane], abef_save[lane]);
+      cdgh[lane] = _mm_add_epi32(cdgh[lane], cdgh_save[lane]);
+      p[lane] += Sha256Hw::kBlockSize;
+    }
+  }
+
+  for (size_t lane = 0; lane < N; ++lane) {
+    __m128i feba = _mm_shuffle_epi32(abef[lane], 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh[lane], 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(states[lane]), _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(states[lane] + 4), _mm_alignr_epi8(dchg, feba, 8));
+  }
+}
+
+template <size_t N>
+void Compress(uint32_t* const* states, const uint8_t* const* blocks, size_t nblocks) {
+  if (Sha256Hw::Available()) {
+    CompressShaNi<N>(states, blocks, nblocks);
+  } else {
+    CompressPortable<N>(states, blocks, nblocks);
+  }
+}
+
+#else
+
+template <size_t N>
+void Compress(uint32_t* const* states, const uint8_t* const* blocks, size_t nblocks) {
+  CompressPortable<N>(states, blocks, nblocks);
+}
+
+#endif
+
+// Pads the last `tail_len` (< kBlockSize) bytes of a `total_len` byte
+// message into `out`, returning the number of blocks written (1 or 2).
+size_t PadTail(const uint8_t* tail, size_t tail_len, uint64_t total_len,
+               uint8_t out[2 * Sha256Hw::kBlockSize]) {
+  const size_t nblocks = tail_len + 1 + sizeof(uint64_t) <= Sha256Hw::kBlockSize ? 1 : 2;
+  const size_t padded_len = nblocks * Sha256Hw::kBlockSize;
+  std::memcpy(out, tail, tail_len);
+  out[tail_len] = 0x80;
+  std::memset(out + tail_len + 1, 0, padded_len - tail_len - 1 - sizeof(uint64_t));
+  const uint64_t bits = total_len * 8;
+  StoreBigEndian32(static_cast<uint32_t>(bits >> 32), out + padded_len - 8);
+  StoreBigEndian32(static_cast<uint32_t>(bits), out + padded_len - 4);
+  return nblocks;
+}
+
+void StoreDigest(const uint32_t state[8], unsigned char* digest) {
+  for (int i = 0; i < 8; ++i) {
+    StoreBigEndian32(state[i], digest + 4 * i);
+  }
+}
+
+// All N messages have the same length, so they have the same number of
+// whole blocks and the same number of padding blocks.
+template <size_t N>
+void HashLanes(const uint8_t* const* messages, size_t len,
+               unsigned char (*digests)[Sha256Hw::kDigestSize]) {
+  uint32_t state[N][8];
+  uint32_t* states[N];
+  for (size_t lane = 0; lane < N; ++lane) {
+    std::memcpy(state[lane], kInitialState, sizeof(kInitialState));
+    states[lane] = state[lane];
+  }
+
+  const size_t whole_blocks = len / Sha256Hw::kBlockSize;
+  Compress<N>(states, messages, whole_blocks);
+
+  uint8_t tails[N][2 * Sha256Hw::kBlockSize];
+  const uint8_t* tail_blocks[N];
+  size_t tail_nblocks = 0;
+  for (size_t lane = 0; lane < N; ++lane) {
+    tail_nblocks = PadTail(messages[lane] + whole_blocks * Sha256Hw::kBlockSize,
+                           len % Sha256Hw::kBlockSize, len, tails[lane]);
+    tail_blocks[lane] = tails[lane];
+  }
+  Compress<N>(states, tail_blocks, tail_nblocks);
+
+  for (size_t lane = 0; lane < N; ++lane) {
+    StoreDigest(state[lane], digests[lane]);
+  }
+}
+
+}  // namespace
+
+#if defined(SANTA_SHA256HW_X86)
+bool Sha256Hw::Available() {
+  static const bool available = [] {
+    unsigned int eax, ebx, ecx, edx;
+    // SSSE3 and SSE4.1 are leaf 1 ECX bits 9 and 19, SHA is leaf 7 EBX bit 29.
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    const bool sse = (ecx & (1u << 9)) && (ecx & (1u << 19));
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return sse && (ebx & (1u << 29));
+  }();
+  return available;
+}
+#endif
+
+void Sha256Hw::Init(Ctx* ctx) {
+  std::memcpy(ctx->state, kInitialState, sizeof(kInitialState));
+  ctx->length = 0;
+}
+
+void Sha256Hw::Update(Ctx* ctx, const void* data, size_t len) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  uint32_t* state = ctx->state;
+  size_t buffered = ctx->length % kBlockSize;
+  ctx->length += len;
+
+  if (buffered > 0) {
+    const size_t take = std::min(len, kBlockSize - buffered);
+    std::memcpy(ctx->buffer + buffered, p, take);
+    p += take;
+    len -= take;
+    if (buffered + take < kBlockSize) return;
+    const uint8_t* block = ctx->buffer;
+    Compress<1>(&state, &block, 1);
+  }
+
+  const size_t nblocks = len / kBlockSize;
+  if (nblocks > 0) {
+    Compress<1>(&state, &p, nblocks);
+    p += nblocks * kBlockSize;
+    len -= nblocks * kBlockSize;
+  }
+  std::memcpy(ctx->buffer, p, len);
+}
+
+void Sha256Hw::Final(unsigned char* digest, Ctx* ctx) {
+  uint8_t tail[2 * kBlockSize];
+  const size_t nblocks = PadTail(ctx->buffer, ctx->length % kBlockSize, ctx->length, tail);
+  const uint8_t* blocks = tail;
+  uint32_t* state = ctx->state;
+  Compress<1>(&state, &blocks, nblocks);
+  StoreDigest(ctx->state, digest);
+}
+
+void Sha256Hw::HashMulti(const uint8_t* const* messages, size_t count, size_t len,
+                         unsigned char (*digests)[kDigestSize]) {
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    HashLanes<kLanes>(messages + i, len, digests + i);
+  }
+  for (; i < count; ++i) {
+    HashLanes<1>(messages + i, len, digests + i);
+  }
+}
+
+}  // namespace santa
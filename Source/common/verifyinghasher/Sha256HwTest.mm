@@ -0,0 +1,111 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/verifyinghasher/Sha256Hw.h"
+
+#include <CommonCrypto/CommonDigest.h>
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using santa::Sha256Hw;
+
+namespace {
+
+std::vector<uint8_t> TestBytes(size_t n) {
+  std::vector<uint8_t> bytes(n);
+  for (size_t i = 0; i < n; ++i) {
+    bytes[i] = static_cast<uint8_t>((i * 2654435761u) >> 13);
+  }
+  return bytes;
+}
+
+void CommonCryptoDigest(const uint8_t* data, size_t len, unsigned char* out) {
+  CC_SHA256(data, static_cast<CC_LONG>(len), out);
+}
+
+}  // namespace
+
+@interface Sha256HwTest : XCTestCase
+@end
+
+@implementation Sha256HwTest
+
+- (void)testKnownVector {
+  // SHA-256("abc") = ba7816bf...
+  static const uint8_t kExpected[32] = {
+      0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40,
+      0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17,
+      0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+  };
+  Sha256Hw::Ctx ctx;
+  Sha256Hw::Init(&ctx);
+  Sha256Hw::Update(&ctx, "abc", 3);
+  unsigned char out[32];
+  Sha256Hw::Final(out, &ctx);
+  XCTAssertEqual(std::memcmp(out, kExpected, 32), 0);
+}
+
+#if defined(__aarch64__)
+- (void)testAvailableOnArm64 {
+  XCTAssertTrue(Sha256Hw::Available());
+}
+#endif
+
+// Lengths around the padding boundaries (55/56 bytes into a block) and page
+// sizes, fed in odd-sized pieces so Update buffers partial blocks.
+- (void)testMatchesCommonCrypto {
+  std::vector<uint8_t> bytes = TestBytes(70000);
+  for (size_t len : {0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 4096, 16384, 65537}) {
+    unsigned char want[32];
+    CommonCryptoDigest(bytes.data(), len, want);
+
+    Sha256Hw::Ctx ctx;
+    Sha256Hw::Init(&ctx);
+    for (size_t off = 0; off < len; off += 37) {
+      Sha256Hw::Update(&ctx, bytes.data() + off, std::min<size_t>(37, len - off));
+    }
+    unsigned char got[32];
+    Sha256Hw::Final(got, &ctx);
+    XCTAssertEqual(std::memcmp(got, want, 32), 0, @"len=%zu", len);
+  }
+}
+
+// HashMulti must produce the same digests as hashing each message alone,
+// including when the count isn't a multiple of kLanes.
+- (void)testHashMultiMatchesSingle {
+  constexpr size_t kMessages = 2 * Sha256Hw::kLanes + 1;
+  std::vector<uint8_t> bytes = TestBytes(kMessages * 16384);
+  for (size_t len : {0, 55, 100, 4096, 16384}) {
+    const uint8_t* messages[kMessages];
+    for (size_t i = 0; i < kMessages; ++i) {
+      messages[i] = bytes.data() + i * len;
+    }
+    for (size_t count = 1; count <= kMessages; ++count) {
+      unsigned char digests[kMessages][Sha256Hw::kDigestSize];
+      Sha256Hw::HashMulti(messages, count, len, digests);
+      for (size_t i = 0; i < count; ++i) {
+        unsigned char want[32];
+        CommonCryptoDigest(messages[i], len, want);
+        XCTAssertEqual(std::memcmp(digests[i], want, 32), 0, @"len=%zu count=%zu i=%zu", len,
+                       count, i);
+      }
+    }
+  }
+}
+
+@end
@@ -25,8 +25,8 @@ namespace santa {
 
 // Owning byte buffer with no value-init on allocation. Avoids the
 // std::vector<uint8_t>::resize() zero-fill on buffers that get fully
-// overwritten by pread/memcpy before being read. Used by VerifyingHasherCore
-// for chunk_buf_ and cs_blob_buf_.
+// overwritten by pread/memcpy before being read. Backs the UninitBufferPool
+// that VerifyingHasherCore borrows chunk_buf_ and cs_blob_buf_ from.
 //
 // Move-only (std::unique_ptr<uint8_t[]>). Allocate() is "once per buffer"
 // — calling it on a populated buffer is a usage bug and the assert traps
@@ -0,0 +1,136 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_COMMON_VERIFYINGHASHER_UNINITBUFFERPOOL_H
+#define SANTA_COMMON_VERIFYINGHASHER_UNINITBUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+
+#include "Source/common/verifyinghasher/UninitBuffer.h"
+
+namespace santa {
+
+// A buffer borrowed from the calling thread's UninitBufferPool. Behaves like an
+// UninitBuffer of the requested size, but the backing allocation may be
+// larger and is handed back to the pool of whichever thread destroys the
+// PooledBuffer instead of being freed. Contents are unspecified on Borrow().
+class PooledBuffer {
+ public:
+  PooledBuffer() = default;
+  ~PooledBuffer() { Release(); }
+
+  PooledBuffer(PooledBuffer&& other) noexcept
+      : buf_(std::exchange(other.buf_, UninitBuffer())),
+        size_(std::exchange(other.size_, 0)) {}
+  PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+      Release();
+      buf_ = std::exchange(other.buf_, UninitBuffer());
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  PooledBuffer(const PooledBuffer&) = delete;
+  PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+  uint8_t* data() { return buf_.data(); }
+  const uint8_t* data() const { return buf_.data(); }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  std::span<const uint8_t> view() const { return {buf_.data(), size_}; }
+
+  // Size of the backing allocation, >= size().
+  size_t capacity() const { return buf_.size(); }
+
+ private:
+  friend class UninitBufferPool;
+
+  PooledBuffer(UninitBuffer buf, size_t size)
+      : buf_(std::move(buf)), size_(size) {}
+
+  void Release();
+
+  UninitBuffer buf_;
+  size_t size_ = 0;
+};
+
+// Per-thread free list of UninitBuffers. VerifyingHasherCore borrows its
+// chunk and CS blob buffers from here so that back-to-back runs on the same
+// thread (e.g. a busy exec queue) reuse allocations instead of mapping and
+// unmapping a fresh 1 MiB chunk buffer each time.
+//
+// There is no locking: each thread only touches its own free list. A
+// PooledBuffer destroyed on another thread joins that thread's list, and one
+// destroyed while its thread is exiting is simply freed.
+class UninitBufferPool {
+ public:
+  // Buffers retained per thread. When full, a returned buffer replaces the
+  // smallest retained one if it is larger, so the pool converges on the
+  // sizes that are actually used.
+  static constexpr size_t kMaxBuffers = 4;
+  // Larger buffers, e.g. an unusually big CS blob, are freed on return
+  // rather than pinned for the thread's lifetime.
+  static constexpr size_t kMaxBufferSize = 4u << 20;
+
+  // Returns an n-byte buffer, reusing the smallest retained allocation that
+  // is large enough, or allocating one of exactly n bytes.
+  static PooledBuffer Borrow(size_t n);
+
+  // Number of buffers currently retained by the calling thread's pool.
+  static size_t RetainedCount();
+
+ private:
+  friend class PooledBuffer;
+
+  static void Return(UninitBuffer buf);
+};
+
+inline void PooledBuffer::Release() {
+  // UninitBuffer's defaulted move leaves the source's size behind, so the
+  // buffer is always exchanged for an empty one rather than moved from.
+  if (!buf_.empty()) {
+    UninitBufferPool::Return(std::exchange(buf_, UninitBuffer()));
+  }
+  size_ = 0;
+}
+
+// Read-only view into a PooledBuffer that keeps the buffer alive. Copies
+// share the buffer, which goes back to a pool once the last copy is gone.
+class PooledBytes {
+ public:
+  PooledBytes(std::shared_ptr<const PooledBuffer> owner,
+              std::span<const uint8_t> bytes)
+      : owner_(std::move(owner)), bytes_(bytes) {}
+
+  const uint8_t* data() const { return bytes_.data(); }
+  size_t size() const { return bytes_.size(); }
+  bool empty() const { return bytes_.empty(); }
+  auto begin() const { return bytes_.begin(); }
+  auto end() const { return bytes_.end(); }
+  std::span<const uint8_t> view() const { return bytes_; }
+  operator std::span<const uint8_t>() const { return bytes_; }
+
+ private:
+  std::shared_ptr<const PooledBuffer> owner_;
+  std::span<const uint8_t> bytes_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_COMMON_VERIFYINGHASHER_UNINITBUFFERPOOL_H
@@ -0,0 +1,93 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/verifyinghasher/UninitBufferPool.h"
+
+#include <array>
+#include <utility>
+
+namespace santa {
+
+namespace {
+
+// Set once the calling thread's pool has been destroyed at thread exit.
+// Trivially destructible, so it remains readable after the pool is gone.
+thread_local bool t_pool_destroyed = false;
+
+struct ThreadPool {
+  std::array<UninitBuffer, UninitBufferPool::kMaxBuffers> buffers;
+  size_t count = 0;
+
+  ~ThreadPool() { t_pool_destroyed = true; }
+};
+
+ThreadPool& LocalPool() {
+  thread_local ThreadPool pool;
+  return pool;
+}
+
+}  // namespace
+
+PooledBuffer UninitBufferPool::Borrow(size_t n) {
+  if (!t_pool_destroyed) {
+    ThreadPool& pool = LocalPool();
+    size_t best = pool.count;
+    for (size_t i = 0; i < pool.count; i++) {
+      if (pool.buffers[i].size() >= n &&
+          (best == pool.count ||
+           pool.buffers[i].size() < pool.buffers[best].size())) {
+        best = i;
+      }
+    }
+    if (best != pool.count) {
+      UninitBuffer buf = std::exchange(pool.buffers[best], UninitBuffer());
+      pool.count--;
+      if (best != pool.count) {
+        pool.buffers[best] =
+            std::exchange(pool.buffers[pool.count], UninitBuffer());
+      }
+      return PooledBuffer(std::move(buf), n);
+    }
+  }
+
+  UninitBuffer buf;
+  buf.Allocate(n);
+  return PooledBuffer(std::move(buf), n);
+}
+
+void UninitBufferPool::Return(UninitBuffer buf) {
+  if (buf.size() > kMaxBufferSize) return;
+
+  if (t_pool_destroyed) return;
+  ThreadPool& pool = LocalPool();
+
+  if (pool.count < kMaxBuffers) {
+    pool.buffers[pool.count++] = std::move(buf);
+    return;
+  }
+
+  size_t smallest = 0;
+  for (size_t i = 1; i < pool.count; i++) {
+    if (pool.buffers[i].size() < pool.buffers[smallest].size()) smallest = i;
+  }
+  if (pool.buffers[smallest].size() < buf.size()) {
+    pool.buffers[smallest] = std::move(buf);
+  }
+}
+
+size_t UninitBufferPool::RetainedCount() {
+  return t_pool_destroyed ? 0 : LocalPool().count;
+}
+
+}  // namespace santa
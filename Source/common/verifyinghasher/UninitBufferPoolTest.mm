@@ -0,0 +1,167 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/common/verifyinghasher/UninitBufferPool.h"
+
+#import <XCTest/XCTest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using santa::UninitBufferPool;
+using santa::PooledBuffer;
+using santa::PooledBytes;
+
+// Pools are per thread, so each test runs on a thread of its own to start
+// from an empty pool regardless of what ran before it.
+static void OnFreshThread(const std::function<void()>& body) {
+  std::thread(body).join();
+}
+
+@interface UninitBufferPoolTest : XCTestCase
+@end
+
+@implementation UninitBufferPoolTest
+
+- (void)testReturnedBufferIsReused {
+  OnFreshThread([&] {
+    const uint8_t* first;
+    {
+      PooledBuffer buf = UninitBufferPool::Borrow(4096);
+      XCTAssertEqual(buf.size(), 4096u);
+      std::memset(buf.data(), 0xab, buf.size());
+      first = buf.data();
+    }
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 1u);
+
+    PooledBuffer again = UninitBufferPool::Borrow(1024);
+    XCTAssertEqual(again.data(), first);
+    // The logical size is what was asked for, not the allocation's.
+    XCTAssertEqual(again.size(), 1024u);
+    XCTAssertEqual(again.view().size(), 1024u);
+    XCTAssertEqual(again.capacity(), 4096u);
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 0u);
+  });
+}
+
+- (void)testSmallBufferIsNotReusedForLargerRequest {
+  OnFreshThread([&] {
+    { PooledBuffer small = UninitBufferPool::Borrow(16); }
+    PooledBuffer big = UninitBufferPool::Borrow(4096);
+    XCTAssertEqual(big.capacity(), 4096u);
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 1u);
+  });
+}
+
+- (void)testBestFitIsBorrowed {
+  OnFreshThread([&] {
+    {
+      PooledBuffer a = UninitBufferPool::Borrow(8192);
+      PooledBuffer b = UninitBufferPool::Borrow(2048);
+      PooledBuffer c = UninitBufferPool::Borrow(4096);
+    }
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 3u);
+    PooledBuffer buf = UninitBufferPool::Borrow(3000);
+    XCTAssertEqual(buf.capacity(), 4096u);
+  });
+}
+
+- (void)testRetentionIsBounded {
+  OnFreshThread([&] {
+    {
+      std::vector<PooledBuffer> bufs;
+      for (size_t i = 0; i < UninitBufferPool::kMaxBuffers + 2; i++) {
+        bufs.push_back(UninitBufferPool::Borrow(1024 * (i + 1)));
+      }
+    }
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), UninitBufferPool::kMaxBuffers);
+
+    // The largest buffers were kept.
+    PooledBuffer buf = UninitBufferPool::Borrow((UninitBufferPool::kMaxBuffers + 2) * 1024);
+    XCTAssertEqual(buf.capacity(), (UninitBufferPool::kMaxBuffers + 2) * 1024);
+  });
+}
+
+- (void)testOversizedBufferIsFreed {
+  OnFreshThread([&] {
+    { PooledBuffer buf = UninitBufferPool::Borrow(UninitBufferPool::kMaxBufferSize + 1); }
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 0u);
+  });
+}
+
+- (void)testMoveReturnsOnlyOnce {
+  OnFreshThread([&] {
+    {
+      PooledBuffer a = UninitBufferPool::Borrow(64);
+      PooledBuffer b = std::move(a);
+      XCTAssertTrue(a.empty());
+      XCTAssertEqual(b.size(), 64u);
+
+      PooledBuffer c = UninitBufferPool::Borrow(128);
+      // Assigning over a live buffer returns the one it held.
+      c = std::move(b);
+      XCTAssertEqual(UninitBufferPool::RetainedCount(), 1u);
+      XCTAssertEqual(c.size(), 64u);
+    }
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 2u);
+  });
+}
+
+- (void)testPooledBytesKeepsBufferAlive {
+  OnFreshThread([&] {
+    std::optional<PooledBytes> bytes;
+    {
+      PooledBuffer buf = UninitBufferPool::Borrow(32);
+      for (size_t i = 0; i < buf.size(); i++) {
+        buf.data()[i] = static_cast<uint8_t>(i);
+      }
+      auto owner = std::make_shared<const PooledBuffer>(std::move(buf));
+      bytes.emplace(owner, owner->view().subspan(8, 8));
+    }
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 0u);
+    XCTAssertEqual(bytes->size(), 8u);
+    XCTAssertEqual(bytes->data()[0], 8);
+
+    PooledBytes copy = *bytes;
+    bytes.reset();
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 0u);
+    std::span<const uint8_t> view = copy;
+    XCTAssertEqual(view[7], 15);
+
+    copy = PooledBytes(nullptr, {});
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 1u);
+  });
+}
+
+- (void)testBufferReturnedOnOtherThreadJoinsThatPool {
+  OnFreshThread([&] {
+    PooledBuffer buf = UninitBufferPool::Borrow(256);
+    size_t otherCount = 0;
+    std::thread t([&buf, &otherCount] {
+      PooledBuffer moved = std::move(buf);
+      moved = PooledBuffer();
+      otherCount = UninitBufferPool::RetainedCount();
+    });
+    t.join();
+    XCTAssertEqual(otherCount, 1u);
+    XCTAssertEqual(UninitBufferPool::RetainedCount(), 0u);
+  });
+}
+
+@end
@@ -34,6 +34,9 @@ __END_DECLS
 #include <string_view>
 #include <vector>
 
+#include "Source/common/verifyinghasher/CodeDirectoryCache.h"
+#include "Source/common/verifyinghasher/UninitBufferPool.h"
+
 namespace santa {
 
 // Public facade for FD-based code-signature verification with full-file
@@ -98,7 +101,15 @@ class VerifyingHasher {
     // nullopt-on-I/O-error both make a Status-ignoring caller fail loudly
     // (no .value()) instead of silently consuming an unverified or
     // unfinalized digest.
+    //
+    // Under RunOptions.slice_only only the picked slice is read, so this is
+    // engaged only when that slice is the whole file (a thin Mach-O).
     std::optional<std::array<uint8_t, CC_SHA256_DIGEST_LENGTH>> sha256;
+    // 32-byte SHA-256 of the picked slice's bytes. Engaged only under
+    // RunOptions.slice_only, for the same statuses as sha256, except that a
+    // Run() that failed before locating the slice (e.g. the Unsigned path's
+    // kNoSignature) has none.
+    std::optional<std::array<uint8_t, CC_SHA256_DIGEST_LENGTH>> slice_sha256;
 
     // CD-resident fields surfaced from the parsed CodeDirectory for
     // BinaryAttestation consumption. Populated only when Run() reaches
@@ -109,11 +120,11 @@ class VerifyingHasher {
     std::optional<std::array<uint8_t, CS_CDHASH_LEN>> cdhash;
     std::optional<std::string> signing_id;
     std::optional<std::string> team_id;
-    // Owning copy of the picked CodeDirectory blob bytes (header + ids +
-    // slot hash table). Used by BinaryAttestation as CMSDecoder's
-    // detached content. Owning rather than view because Core's
-    // cs_blob_buf_ does not outlive Run().
-    std::optional<std::vector<uint8_t>> cd_bytes;
+    // The picked CodeDirectory blob bytes (header + ids + slot hash
+    // table). Used by BinaryAttestation as CMSDecoder's detached content.
+    // A view into Core's pooled CS blob buffer, which this Result keeps
+    // alive in place of Core, so the bytes are never copied.
+    std::optional<PooledBytes> cd_bytes;
     // Total embedded code-signature blob size (LC_CODE_SIGNATURE.datasize).
     // Used by KernelCsBlob::Fetch as a one-syscall sizing hint.
     std::optional<size_t> cs_blob_size;
@@ -126,6 +137,25 @@ class VerifyingHasher {
     // see Core's documentation for the full contract. No-op on the Unsigned
     // path — an unsigned slice has no page hashes to skip.
     bool skip_page_hash = false;
+    // Hash pages on a worker pool while the full-file SHA-256 streams on a
+    // separate core. Threaded through to
+    // VerifyingHasherCore::Options::parallel_page_hash; results are identical
+    // to the serial path, only wall-clock time on large binaries changes.
+    bool parallel_page_hash = false;
+    // Reads kept in flight ahead of hashing. Threaded through to
+    // VerifyingHasherCore::Options::read_ahead_depth; 0 reads synchronously.
+    size_t read_ahead_depth = 0;
+    // Hash only the slice for cputype/cpusubtype, leaving the other
+    // architectures of a universal binary unread. Threaded through to
+    // VerifyingHasherCore::Options::slice_only; the digest is reported in
+    // Result.slice_sha256 rather than Result.sha256. Only suitable for
+    // callers that identify the binary by its cdhash rather than the
+    // SHA-256 of the file.
+    bool slice_only = false;
+    // Cache of parsed CodeDirectories to consult for, and fill with,
+    // Expected.signed_check->cdhash. Threaded through to
+    // VerifyingHasherCore::Options::cd_cache; unused on the Unsigned path.
+    CodeDirectoryCache* cd_cache = nullptr;
   };
 
   static Result Run(int fd, cpu_type_t cputype, cpu_subtype_t cpusubtype,
@@ -63,6 +63,13 @@ VerifyingHasher::Result VerifyingHasher::Run(int fd, cpu_type_t cputype, cpu_sub
   ArchSelector want{cputype, cpusubtype};
   VerifyingHasherCore::Options core_opts;
   core_opts.skip_page_hash = opts.skip_page_hash;
+  core_opts.parallel_page_hash = opts.parallel_page_hash;
+  core_opts.read_ahead_depth = opts.read_ahead_depth;
+  core_opts.slice_only = opts.slice_only;
+  if (exp.signed_check.has_value()) {
+    core_opts.cd_cache = opts.cd_cache;
+    core_opts.expected_cdhash = exp.signed_check->cdhash;
+  }
   VerifyingHasherCore core(reader, want, core_opts);
 
   auto core_status = core.Run();
@@ -70,7 +77,15 @@ VerifyingHasher::Result VerifyingHasher::Run(int fd, cpu_type_t cputype, cpu_sub
   if (auto d = core.FullFileDigest(); d.size() == CC_SHA256_DIGEST_LENGTH) {
     std::array<uint8_t, CC_SHA256_DIGEST_LENGTH> buf;
     std::copy(d.begin(), d.end(), buf.begin());
-    r.sha256 = buf;
+    if (!opts.slice_only) {
+      r.sha256 = buf;
+    } else {
+      r.slice_sha256 = buf;
+      const SliceInfo& slice = core.Slice();
+      if (slice.slice_offset == 0 && slice.slice_size == slice.total_file_size) {
+        r.sha256 = buf;
+      }
+    }
   }
 
   // Unsigned path. The stat tuple was already verified at facade entry;
@@ -122,9 +137,7 @@ VerifyingHasher::Result VerifyingHasher::Run(int fd, cpu_type_t cputype, cpu_sub
     }
     if (!parsed.identifier.empty()) r.signing_id = parsed.identifier;
     if (!parsed.team_id.empty()) r.team_id = parsed.team_id;
-    if (!parsed.cd_bytes.empty()) {
-      r.cd_bytes = std::vector<uint8_t>(parsed.cd_bytes.begin(), parsed.cd_bytes.end());
-    }
+    r.cd_bytes = core.TakeCDBytes();
     r.cs_blob_size = static_cast<size_t>(core.Slice().cs_blob_size);
   }
   return r;
@@ -19,16 +19,20 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <span>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "Source/common/verifyinghasher/UninitBufferPool.h"
+#include "Source/common/verifyinghasher/CodeDirectoryCache.h"
 #include "Source/common/verifyinghasher/CodeSignatureParser.h"
 #include "Source/common/verifyinghasher/FileReader.h"
 #include "Source/common/verifyinghasher/HeaderParser.h"
-#include "Source/common/verifyinghasher/UninitBuffer.h"
+#include "Source/common/verifyinghasher/PageVerifier.h"
+#include "Source/common/verifyinghasher/ReadAheadFileReader.h"
 
 namespace santa {
 
@@ -53,14 +57,47 @@ class VerifyingHasherCore {
     // Status::kPagesMismatched is structurally unreachable. See
     // HashTraits.h::NoopHashTraits and PageHashSkipped() below.
     bool skip_page_hash = false;
+    // If true, the signed region is streamed with page hashes computed on a
+    // worker pool while the full-file SHA-256 runs concurrently on another
+    // core, and the next chunk is pread into a second buf_size buffer while
+    // the current one is being hashed. Every byte is still pread exactly
+    // once; both hashes consume the same buffer. Only engaged when at least
+    // parallel_min_bytes of the signed region remain after phase 1, since
+    // the dispatch overhead outweighs the gain on small binaries. Results
+    // are identical to the serial path. No effect under skip_page_hash.
+    bool parallel_page_hash = false;
+    size_t parallel_min_bytes = 16u << 20;
+    // Number of reads kept in flight ahead of hashing, each of
+    // read_ahead_buf_size bytes (0 = buf_size). 0 disables read-ahead and
+    // every pread is issued synchronously on the calling thread. Only the
+    // ranges that are consumed sequentially (the signed region after
+    // phase 1 and the tail after the CS blob) are read ahead, so each byte
+    // is still read exactly once. See ReadAheadFileReader.h.
+    size_t read_ahead_depth = 0;
+    size_t read_ahead_buf_size = 0;
+    // If true, the digest covers only the picked slice, [slice_offset,
+    // slice_offset + slice_size), and the bytes of other architectures in a
+    // fat file are never read. FullFileDigest() then returns this slice
+    // digest, and is empty unless phase 1 located the slice. Page hashes,
+    // cdhash and the CD fields are unaffected. For a thin Mach-O the slice
+    // is the whole file, so the digest is the same either way.
+    bool slice_only = false;
+    // If set along with expected_cdhash, the picked CodeDirectory is taken
+    // from this cache instead of parsing the CS blob when the blob holds
+    // the cached CD for expected_cdhash, and a freshly parsed CD is added to
+    // it when its cdhash equals expected_cdhash. Not owned; must outlive the
+    // Core. Results are identical either way.
+    CodeDirectoryCache* cd_cache = nullptr;
+    std::span<const uint8_t> expected_cdhash;
   };
 
   VerifyingHasherCore(FileReader& reader, ArchSelector want);
   VerifyingHasherCore(FileReader& reader, ArchSelector want, Options opts);
   Status Run();
 
-  // 32-byte SHA-256 of the full file. Empty span if Status == kIoError
-  // (digest could not be finalized due to incomplete reads).
+  // 32-byte SHA-256 of the full file, or of the picked slice under
+  // Options.slice_only. Empty span if Status == kIoError (digest could not
+  // be finalized due to incomplete reads).
   std::span<const uint8_t> FullFileDigest() const;
 
   // 20-byte truncated cdhash of the picked CodeDirectory, computed
@@ -82,26 +119,54 @@ class VerifyingHasherCore {
   std::optional<uint32_t> Mismatches() const;
   // Returns Options.skip_page_hash. Reflects caller intent, not outcome.
   bool PageHashSkipped() const { return opts_.skip_page_hash; }
+  // Returns Options.slice_only. Reflects caller intent, not outcome.
+  bool SliceOnly() const { return opts_.slice_only; }
+  // Whether ParsedCD() came from Options.cd_cache rather than a parse.
+  bool ParsedCDFromCache() const { return parsed_cd_from_cache_; }
   // Up to kMaxRecordedMismatches slot indices, for diagnostic logging.
   // Empty span under Options.skip_page_hash (no per-page work is performed).
   std::span<const uint32_t> MismatchedSlots() const;
 
+  // Hands the CS blob buffer to the caller as a view of the picked
+  // CodeDirectory's bytes, so they can outlive this Core without a copy.
+  // nullopt unless ParsedCD() is valid. ParsedCD()'s spans point into the
+  // same buffer and stay valid only while the returned view (or a copy of
+  // it) is alive. Subsequent calls return nullopt.
+  std::optional<PooledBytes> TakeCDBytes();
+
   std::string_view LastError() const { return last_error_; }
 
  private:
   template <typename HashTraits>
   Status RunStreamingPhases();
 
+  // Phase 3 under Options.parallel_page_hash: streams [cursor_, cs_lo)
+  // into full_ctx_ and `pv`.
+  template <typename HashTraits>
+  Status StreamSignedRegionParallel(PageVerifierT<HashTraits>& pv, uint64_t cs_lo);
+  // Classifies a phase-3 pread result. kOk iff 0 < n <= want.
+  Status CheckStreamingRead(ssize_t n, size_t want);
+
   Status RunHeaderPhase();
   Status RunCsBlobPhase();
   void FinalizeDigestDrainingToEof();
+  // File offset the digest runs up to: EOF, or the end of the picked slice
+  // under Options.slice_only. Only meaningful once slice_ is known there.
+  uint64_t DigestEnd() const;
 
+  // Declared before reader_, which refers to it when read-ahead is enabled.
+  std::unique_ptr<ReadAheadFileReader> read_ahead_;
   FileReader& reader_;
   ArchSelector want_;
   Options opts_;
 
-  UninitBuffer chunk_buf_;
-  UninitBuffer cs_blob_buf_;
+  // Borrowed from the calling thread's UninitBufferPool, so back-to-back
+  // runs on one thread reuse the same allocations.
+  PooledBuffer chunk_buf_;
+  PooledBuffer cs_blob_buf_;
+  // Second chunk buffer for the parallel path's read-ahead. Borrowed only
+  // when that path engages.
+  PooledBuffer next_chunk_buf_;
   // Phase-1 chunks' bytes that lie inside the chosen slice — i.e., file
   // offsets >= slice_offset, accumulated until HeaderParser reaches kReady.
   // Bounded by slice_header_size + sizeofcmds (sizeofcmds is capped at
@@ -119,6 +184,7 @@ class VerifyingHasherCore {
   uint8_t full_digest_[CC_SHA256_DIGEST_LENGTH] = {};
   bool digest_finalized_ = false;
   bool cdhash_populated_ = false;
+  bool parsed_cd_from_cache_ = false;
 
   SliceInfo slice_;
   ParsedCodeDirectory parsed_cd_;
@@ -14,7 +14,9 @@
 
 #include "Source/common/verifyinghasher/VerifyingHasherCore.h"
 
+#include <dispatch/dispatch.h>
 #include <os/overflow.h>
+#include <pthread/qos.h>
 #include <sys/cdefs.h>
 
 __BEGIN_DECLS
@@ -24,19 +26,58 @@ __END_DECLS
 #include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 #include "Source/common/verifyinghasher/HashTraits.h"
-#include "Source/common/verifyinghasher/PageVerifier.h"
+#include "Source/common/verifyinghasher/Sha256Hw.h"
 
 namespace santa {
 
+namespace {
+
+// Pages hashed per dispatch_apply iteration. A 4 KiB page hashes in a couple
+// of microseconds, which is on the order of the cost of handing out an
+// iteration, so pages are dealt out in batches. With Sha256HwTraits each
+// index is a pair of pages, which only makes the batches coarser.
+constexpr size_t kPagesPerApplyIteration = 32;
+
+// ParallelFor for PageVerifierT::UpdateParallel, backed by dispatch_apply.
+struct DispatchParallelFor {
+  template <typename Fn>
+  void operator()(size_t count, const Fn& fn) const {
+    const Fn* f = &fn;
+    const size_t iterations = (count + kPagesPerApplyIteration - 1) / kPagesPerApplyIteration;
+    dispatch_apply(iterations, DISPATCH_APPLY_AUTO, ^(size_t it) {
+      const size_t end = std::min(count, (it + 1) * kPagesPerApplyIteration);
+      for (size_t i = it * kPagesPerApplyIteration; i < end; ++i) {
+        (*f)(i);
+      }
+    });
+  }
+};
+
+std::unique_ptr<ReadAheadFileReader> MakeReadAhead(FileReader& reader,
+                                                   const VerifyingHasherCore::Options& opts) {
+  if (opts.read_ahead_depth == 0) return nullptr;
+  size_t buf_size = opts.read_ahead_buf_size ? opts.read_ahead_buf_size : opts.buf_size;
+  if (buf_size == 0) buf_size = 1u << 20;
+  return std::make_unique<ReadAheadFileReader>(reader, buf_size, opts.read_ahead_depth);
+}
+
+}  // namespace
+
 VerifyingHasherCore::VerifyingHasherCore(FileReader& reader, ArchSelector want)
     : VerifyingHasherCore(reader, want, Options{}) {}
 
 VerifyingHasherCore::VerifyingHasherCore(FileReader& reader, ArchSelector want, Options opts)
-    : reader_(reader), want_(want), opts_(opts) {
+    : read_ahead_(MakeReadAhead(reader, opts)),
+      reader_(read_ahead_ ? *read_ahead_ : reader),
+      want_(want),
+      opts_(opts) {
   if (opts_.buf_size == 0) opts_.buf_size = 1u << 20;
-  chunk_buf_.Allocate(opts_.buf_size);
+  chunk_buf_ = UninitBufferPool::Borrow(opts_.buf_size);
   Sha256Traits::Init(&full_ctx_);
 }
 
@@ -62,6 +103,14 @@ std::span<const uint32_t> VerifyingHasherCore::MismatchedSlots() const {
   return mismatched_slots_;
 }
 
+std::optional<PooledBytes> VerifyingHasherCore::TakeCDBytes() {
+  if (cs_blob_buf_.empty() || parsed_cd_.cd_bytes.empty()) return std::nullopt;
+  // Moving the buffer leaves its bytes in place, so parsed_cd_'s spans
+  // follow it into the shared owner.
+  auto owner = std::make_shared<const PooledBuffer>(std::move(cs_blob_buf_));
+  return PooledBytes(std::move(owner), parsed_cd_.cd_bytes);
+}
+
 std::optional<uint32_t> VerifyingHasherCore::Mismatches() const {
   if (opts_.skip_page_hash) return std::nullopt;
   return mismatches_;
@@ -112,7 +161,11 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunHeaderPhase() {
       return hp.LastError().find("not a Mach-O") != std::string_view::npos ? Status::kNotMachO
                                                                            : Status::kNoSignature;
     }
-    Sha256Traits::Update(&full_ctx_, chunk_buf_.data(), static_cast<size_t>(n));
+    // Under slice_only nothing is hashed until the slice's bounds are
+    // known; its bytes are buffered below and hashed once phase 1 is done.
+    if (!opts_.slice_only) {
+      Sha256Traits::Update(&full_ctx_, chunk_buf_.data(), static_cast<size_t>(n));
+    }
     hp.Update(chunk_buf_.data(), static_cast<size_t>(n), chunk_off);
     cursor_ = chunk_off + static_cast<uint64_t>(n);
     // Buffer only bytes inside the chosen slice (i.e., from slice_offset
@@ -127,6 +180,10 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunHeaderPhase() {
         const uint8_t* src = chunk_buf_.data() + (lo - chunk_off);
         header_phase_buf_.insert(header_phase_buf_.end(), src, src + (hi - lo));
       }
+      // Under slice_only, skip straight to the slice. HeaderParser ignores
+      // everything before the offset it wants next, which is now inside the
+      // slice, so the gap (typically another architecture) is never read.
+      if (opts_.slice_only && cursor_ < *slice_off) cursor_ = *slice_off;
     }
   }
   if (hp.status() == HeaderParser::Status::kError) {
@@ -140,6 +197,13 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunHeaderPhase() {
     return Status::kMalformedSignature;
   }
   slice_ = hp.Slice();
+  if (opts_.slice_only) {
+    // header_phase_buf_ holds [slice_offset, cursor_), which may run past
+    // the end of the slice when phase 1 read into the next one.
+    const size_t in_slice = static_cast<size_t>(
+        std::min<uint64_t>(header_phase_buf_.size(), slice_.slice_size));
+    Sha256Traits::Update(&full_ctx_, header_phase_buf_.data(), in_slice);
+  }
   return Status::kOk;
 }
 
@@ -149,7 +213,7 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunCsBlobPhase() {
   // header_phase_buf_[0] corresponds to file offset slice_offset.
   const uint64_t buf_base = slice_.slice_offset;
 
-  cs_blob_buf_.Allocate(slice_.cs_blob_size);
+  cs_blob_buf_ = UninitBufferPool::Borrow(slice_.cs_blob_size);
 
   if (cs_hi <= cursor_) {
     // Full overlap: phase 1 already read past the CS blob.
@@ -176,15 +240,95 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunCsBlobPhase() {
     }
   }
 
+  CodeDirectoryCache* cache = opts_.cd_cache;
+  if (cache && !opts_.expected_cdhash.empty() &&
+      cache->Lookup(opts_.expected_cdhash, cs_blob_buf_.view(), slice_.slice_size, parsed_cd_)) {
+    parsed_cd_from_cache_ = true;
+    cdhash_populated_ = true;
+    return Status::kOk;
+  }
+
   std::string err;
   if (!ParseCodeSignature(cs_blob_buf_.view(), slice_.slice_size, parsed_cd_, err)) {
     last_error_ = std::move(err);
     return Status::kMalformedSignature;
   }
   cdhash_populated_ = true;
+  // Only cache the CD the caller expected, so the cache fills with
+  // signatures that were actually validated rather than every one parsed.
+  if (cache && opts_.expected_cdhash.size() == CS_CDHASH_LEN &&
+      std::memcmp(parsed_cd_.cdhash, opts_.expected_cdhash.data(), CS_CDHASH_LEN) == 0) {
+    cache->Insert(parsed_cd_, cs_blob_buf_.view());
+  }
+  return Status::kOk;
+}
+
+VerifyingHasherCore::Status VerifyingHasherCore::CheckStreamingRead(ssize_t n, size_t want) {
+  if (n < 0) {
+    last_error_ = "pread failed in streaming phase";
+    return Status::kIoError;
+  }
+  if (n == 0) {
+    last_error_ = "unexpected EOF in streaming phase";
+    return Status::kIoError;
+  }
+  if (static_cast<size_t>(n) > want) {
+    // Reader violated its len contract — pread(2) caps at len, so this
+    // can only happen with a misbehaving custom FileReader. Defense-
+    // in-depth against silently feeding bytes past cs_lo into pv.
+    last_error_ = "reader served past requested length in streaming phase";
+    return Status::kIoError;
+  }
   return Status::kOk;
 }
 
+template <typename HashTraits>
+VerifyingHasherCore::Status VerifyingHasherCore::StreamSignedRegionParallel(
+    PageVerifierT<HashTraits>& pv, uint64_t cs_lo) {
+  if (next_chunk_buf_.empty()) next_chunk_buf_ = UninitBufferPool::Borrow(chunk_buf_.size());
+  uint8_t* cur = chunk_buf_.data();
+  uint8_t* next = next_chunk_buf_.data();
+
+  size_t want = std::min<size_t>(chunk_buf_.size(), cs_lo - cursor_);
+  ssize_t n = reader_.Pread(cur, want, static_cast<off_t>(cursor_));
+  if (Status s = CheckStreamingRead(n, want); s != Status::kOk) return s;
+
+  // Workers inherit the caller's QoS so an AUTH EXEC isn't demoted.
+  dispatch_queue_t queue = dispatch_get_global_queue(qos_class_self(), 0);
+  dispatch_group_t group = dispatch_group_create();
+  CC_SHA256_CTX* full_ctx = &full_ctx_;
+  PageVerifierT<HashTraits>* verifier = &pv;
+
+  while (true) {
+    // `cur` holds [cursor_, cursor_ + n). Hash it on two workers while this
+    // thread reads the following chunk into `next`. Neither buffer is
+    // touched by more than one side until the group is drained below.
+    const uint8_t* data = cur;
+    const size_t len = static_cast<size_t>(n);
+    const uint64_t off = cursor_;
+    dispatch_group_async(group, queue, ^{
+      Sha256Traits::Update(full_ctx, data, len);
+    });
+    dispatch_group_async(group, queue, ^{
+      verifier->UpdateParallel(data, len, off, DispatchParallelFor{});
+    });
+    cursor_ += len;
+
+    ssize_t next_n = 0;
+    size_t next_want = 0;
+    if (cursor_ < cs_lo) {
+      next_want = std::min<size_t>(next_chunk_buf_.size(), cs_lo - cursor_);
+      next_n = reader_.Pread(next, next_want, static_cast<off_t>(cursor_));
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    if (cursor_ >= cs_lo) return Status::kOk;
+    if (Status s = CheckStreamingRead(next_n, next_want); s != Status::kOk) return s;
+    std::swap(cur, next);
+    n = next_n;
+  }
+}
+
 template <typename HashTraits>
 VerifyingHasherCore::Status VerifyingHasherCore::RunStreamingPhases() {
   const uint64_t signed_lo = slice_.slice_offset;
@@ -208,24 +352,17 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunStreamingPhases() {
 
   // Phase 3: stream from cursor_ up to cs_blob_offset (no-op if
   // phase 1 already overshot).
+  if (cursor_ < cs_lo) reader_.WillRead(static_cast<off_t>(cursor_), cs_lo - cursor_);
+  if constexpr (!std::is_same_v<HashTraits, NoopHashTraits>) {
+    if (opts_.parallel_page_hash && cursor_ < cs_lo &&
+        cs_lo - cursor_ >= opts_.parallel_min_bytes) {
+      if (Status s = StreamSignedRegionParallel(pv, cs_lo); s != Status::kOk) return s;
+    }
+  }
   while (cursor_ < cs_lo) {
     size_t want = std::min<size_t>(chunk_buf_.size(), cs_lo - cursor_);
     ssize_t n = reader_.Pread(chunk_buf_.data(), want, static_cast<off_t>(cursor_));
-    if (n < 0) {
-      last_error_ = "pread failed in streaming phase";
-      return Status::kIoError;
-    }
-    if (n == 0) {
-      last_error_ = "unexpected EOF in streaming phase";
-      return Status::kIoError;
-    }
-    if (static_cast<size_t>(n) > want) {
-      // Reader violated its len contract — pread(2) caps at len, so this
-      // can only happen with a misbehaving custom FileReader. Defense-
-      // in-depth against silently feeding bytes past cs_lo into pv.
-      last_error_ = "reader served past requested length in streaming phase";
-      return Status::kIoError;
-    }
+    if (Status s = CheckStreamingRead(n, want); s != Status::kOk) return s;
     Sha256Traits::Update(&full_ctx_, chunk_buf_.data(), static_cast<size_t>(n));
     pv.Update(chunk_buf_.data(), static_cast<size_t>(n), cursor_);
     cursor_ += static_cast<uint64_t>(n);
@@ -242,8 +379,10 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunStreamingPhases() {
     cursor_ = cs_hi;
   }
 
-  // Phase 5: tail to EOF (no-op if phase 1 already reached EOF).
-  const uint64_t total = static_cast<uint64_t>(reader_.Size());
+  // Phase 5: tail to EOF, or to the end of the slice under slice_only
+  // (no-op if phase 1 already got there).
+  const uint64_t total = DigestEnd();
+  if (cursor_ < total) reader_.WillRead(static_cast<off_t>(cursor_), total - cursor_);
   while (cursor_ < total) {
     size_t want = std::min<size_t>(chunk_buf_.size(), total - cursor_);
     ssize_t n = reader_.Pread(chunk_buf_.data(), want, static_cast<off_t>(cursor_));
@@ -296,13 +435,18 @@ VerifyingHasherCore::Status VerifyingHasherCore::RunStreamingPhases() {
   return mismatches_ == 0 ? Status::kOk : Status::kPagesMismatched;
 }
 
+uint64_t VerifyingHasherCore::DigestEnd() const {
+  if (opts_.slice_only) return slice_.slice_offset + slice_.slice_size;
+  return static_cast<uint64_t>(reader_.Size());
+}
+
 void VerifyingHasherCore::FinalizeDigestDrainingToEof() {
   // Best-effort digest finalization on a non-IoError failure path. If a
   // pread fails mid-drain we stop, finalize whatever we have, and the
   // returned digest may not match shasum on that file. Spec only promises
   // "populated unless kIoError" — not "byte-correct on every error path".
   if (digest_finalized_) return;
-  const uint64_t total = static_cast<uint64_t>(reader_.Size());
+  const uint64_t total = DigestEnd();
   const uint64_t cs_lo = slice_.cs_blob_offset;
   const uint64_t cs_hi = cs_lo + slice_.cs_blob_size;
   const bool have_cs_blob = !cs_blob_buf_.empty();
@@ -344,7 +488,8 @@ void VerifyingHasherCore::FinalizeDigestDrainingToEof() {
 
 VerifyingHasherCore::Status VerifyingHasherCore::Run() {
   if (Status s = RunHeaderPhase(); s != Status::kOk) {
-    if (s != Status::kIoError) FinalizeDigestDrainingToEof();
+    // Under slice_only there is no slice to finalize a digest over.
+    if (s != Status::kIoError && !opts_.slice_only) FinalizeDigestDrainingToEof();
     return s;
   }
   if (Status s = RunCsBlobPhase(); s != Status::kOk) {
@@ -372,8 +517,15 @@ VerifyingHasherCore::Status VerifyingHasherCore::Run() {
   }
   switch (parsed_cd_.hash_type) {
     case CS_HASHTYPE_SHA1: return RunStreamingPhases<Sha1Traits>();
-    case CS_HASHTYPE_SHA256: return RunStreamingPhases<Sha256Traits>();
-    case CS_HASHTYPE_SHA256_TRUNCATED: return RunStreamingPhases<Sha256TruncatedTraits>();
+    // Page hashes go through the SHA-2 instructions directly where the CPU
+    // has them, so UpdateParallel can hash pages in pairs. Available() is a
+    // constant true on arm64, leaving the CommonCrypto fallback dead there.
+    case CS_HASHTYPE_SHA256:
+      return Sha256Hw::Available() ? RunStreamingPhases<Sha256HwTraits>()
+                                   : RunStreamingPhases<Sha256Traits>();
+    case CS_HASHTYPE_SHA256_TRUNCATED:
+      return Sha256Hw::Available() ? RunStreamingPhases<Sha256TruncatedHwTraits>()
+                                   : RunStreamingPhases<Sha256TruncatedTraits>();
     case CS_HASHTYPE_SHA384: return RunStreamingPhases<Sha384Traits>();
     default:
       last_error_ = "unsupported CD hashType";
@@ -30,10 +30,12 @@ __END_DECLS
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <optional>
 #include <span>
 #include <string>
 #include <vector>
@@ -47,6 +49,7 @@ using santa::ArchSelector;
 using santa::CountingMemoryFileReader;
 using santa::FdFileReader;
 using santa::MemoryFileReader;
+using santa::SliceInfo;
 using santa::VerifyingHasherCore;
 
 namespace {
@@ -723,6 +726,92 @@ class OverservingMemoryFileReader : public santa::FileReader {
   [self checkHwUniversalForArch:CPU_TYPE_X86_64 subtype:CPU_SUBTYPE_X86_64_ALL];
 }
 
+- (void)checkSliceOnlyForArch:(cpu_type_t)cputype subtype:(cpu_subtype_t)cpusubtype {
+  NSBundle* bundle = [NSBundle bundleForClass:[self class]];
+  NSString* path = [bundle.resourcePath stringByAppendingPathComponent:@"testdata/hw_universal"];
+  auto bytes = Slurp(path.UTF8String);
+  if (bytes.empty()) {
+    XCTFail(@"hw_universal not bundled at %@", path);
+    return;
+  }
+
+  MemoryFileReader full_reader(bytes);
+  VerifyingHasherCore full(full_reader, ArchSelector{cputype, cpusubtype});
+  XCTAssertEqual(full.Run(), VerifyingHasherCore::Status::kOk);
+
+  // A buffer smaller than the fat header's page, so any read of the other
+  // slice would show up below.
+  const size_t kBufSize = 4096;
+  CountingMemoryFileReader r(bytes);
+  VerifyingHasherCore v(r, ArchSelector{cputype, cpusubtype},
+                        VerifyingHasherCore::Options{.buf_size = kBufSize, .slice_only = true});
+  XCTAssertEqual(v.Run(), VerifyingHasherCore::Status::kOk, @"Run: %s",
+                 std::string(v.LastError()).c_str());
+  XCTAssertTrue(v.SliceOnly());
+
+  const SliceInfo& slice = v.Slice();
+  const size_t lo = static_cast<size_t>(slice.slice_offset);
+  const size_t hi = static_cast<size_t>(slice.slice_offset + slice.slice_size);
+  XCTAssertLessThan(hi - lo, bytes.size());
+
+  uint8_t expected[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256(bytes.data() + lo, static_cast<CC_LONG>(hi - lo), expected);
+  XCTAssertEqual(HexLower(v.FullFileDigest()), HexLower(std::span<const uint8_t>(expected)));
+  XCTAssertNotEqual(HexLower(v.FullFileDigest()), HexLower(full.FullFileDigest()));
+
+  // The slice is verified exactly as it is when the whole file is read.
+  XCTAssertEqual(HexLower(v.CDHash()), HexLower(full.CDHash()));
+  XCTAssertTrue(v.Mismatches() == full.Mismatches());
+
+  // Past the fat header, nothing outside the slice was read.
+  XCTAssertFalse(r.AnyReadInRange(kBufSize, lo));
+  XCTAssertFalse(r.AnyReadInRange(hi, bytes.size()));
+  XCTAssertLessThanOrEqual(r.MaxReadsAnyByte(), 1u);
+}
+
+- (void)testSliceOnlyHwUniversalArm64 {
+  [self checkSliceOnlyForArch:CPU_TYPE_ARM64 subtype:CPU_SUBTYPE_ARM64_ALL];
+}
+
+- (void)testSliceOnlyHwUniversalX86_64 {
+  [self checkSliceOnlyForArch:CPU_TYPE_X86_64 subtype:CPU_SUBTYPE_X86_64_ALL];
+}
+
+- (void)testSliceOnlyThinMatchesFullFile {
+  NSBundle* bundle = [NSBundle bundleForClass:[self class]];
+  NSString* path = [bundle.resourcePath stringByAppendingPathComponent:@"testdata/hw_universal"];
+  auto bytes = Slurp(path.UTF8String);
+  if (bytes.empty()) {
+    XCTFail(@"hw_universal not bundled at %@", path);
+    return;
+  }
+  const ArchSelector arm64{CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL};
+  MemoryFileReader fat_reader(bytes);
+  VerifyingHasherCore fat(fat_reader, arm64);
+  XCTAssertEqual(fat.Run(), VerifyingHasherCore::Status::kOk);
+
+  // A fat slice is itself a thin Mach-O, whose one slice is the whole file.
+  const auto begin = bytes.begin() + static_cast<ptrdiff_t>(fat.Slice().slice_offset);
+  std::vector<uint8_t> thin(begin, begin + static_cast<ptrdiff_t>(fat.Slice().slice_size));
+
+  MemoryFileReader full_reader(thin);
+  VerifyingHasherCore full(full_reader, arm64);
+  XCTAssertEqual(full.Run(), VerifyingHasherCore::Status::kOk);
+
+  MemoryFileReader r(thin);
+  VerifyingHasherCore v(r, arm64, VerifyingHasherCore::Options{.slice_only = true});
+  XCTAssertEqual(v.Run(), VerifyingHasherCore::Status::kOk);
+  XCTAssertEqual(HexLower(v.FullFileDigest()), HexLower(full.FullFileDigest()));
+}
+
+- (void)testSliceOnlyHasNoDigestWithoutSlice {
+  std::vector<uint8_t> bytes(8192, 0x41);
+  MemoryFileReader r(bytes);
+  VerifyingHasherCore v(r, kHostArch, VerifyingHasherCore::Options{.slice_only = true});
+  XCTAssertEqual(v.Run(), VerifyingHasherCore::Status::kNotMachO);
+  XCTAssertTrue(v.FullFileDigest().empty());
+}
+
 - (void)testPageHashSkippedReflectsOption {
   auto bytes = Slurp("/usr/bin/yes");
   XCTAssertFalse(bytes.empty());
@@ -846,4 +935,107 @@ class OverservingMemoryFileReader : public santa::FileReader {
   XCTAssertFalse(v.Mismatches().has_value());
 }
 
+- (void)testParallelPageHashMatchesSerial {
+  // The parallel path must be observably identical to the serial one:
+  // same status, digest and cdhash. A 64 KiB buffer gives many chunks over
+  // the signed region, most of which start and end mid-page.
+  auto bytes = Slurp("/usr/bin/yes");
+  XCTAssertFalse(bytes.empty());
+
+  MemoryFileReader serial_reader(bytes);
+  VerifyingHasherCore serial(serial_reader, kHostArch, VerifyingHasherCore::Options{});
+  XCTAssertEqual(serial.Run(), VerifyingHasherCore::Status::kOk);
+
+  for (size_t buf_size : {4096u, 65536u - 100u, 1u << 20}) {
+    MemoryFileReader r(bytes);
+    VerifyingHasherCore v(r, kHostArch,
+                          VerifyingHasherCore::Options{.buf_size = buf_size,
+                                                       .parallel_page_hash = true,
+                                                       .parallel_min_bytes = 0});
+    XCTAssertEqual(v.Run(), VerifyingHasherCore::Status::kOk, @"buf_size=%zu: %s", buf_size,
+                   std::string(v.LastError()).c_str());
+    XCTAssertEqual(HexLower(v.FullFileDigest()), HexLower(serial.FullFileDigest()));
+    XCTAssertEqual(HexLower(v.CDHash()), HexLower(serial.CDHash()));
+    XCTAssertEqual(v.Mismatches(), std::optional<uint32_t>(0));
+  }
+}
+
+- (void)testParallelPageHashDetectsTamper {
+  auto bytes = Slurp("/usr/bin/yes");
+  XCTAssertFalse(bytes.empty());
+  // Two flips in different pages, so slot ordering is exercised as well.
+  bytes[3 * bytes.size() / 4] ^= 0xFF;
+  bytes[3 * bytes.size() / 4 + 3 * 16384] ^= 0xFF;
+
+  MemoryFileReader serial_reader(bytes);
+  VerifyingHasherCore serial(serial_reader, kHostArch);
+  XCTAssertEqual(serial.Run(), VerifyingHasherCore::Status::kPagesMismatched);
+
+  MemoryFileReader r(bytes);
+  VerifyingHasherCore v(r, kHostArch,
+                        VerifyingHasherCore::Options{.buf_size = 65536,
+                                                     .parallel_page_hash = true,
+                                                     .parallel_min_bytes = 0});
+  XCTAssertEqual(v.Run(), VerifyingHasherCore::Status::kPagesMismatched);
+  XCTAssertEqual(v.Mismatches(), serial.Mismatches());
+  XCTAssertTrue(std::equal(v.MismatchedSlots().begin(), v.MismatchedSlots().end(),
+                           serial.MismatchedSlots().begin(), serial.MismatchedSlots().end()));
+  XCTAssertEqual(HexLower(v.FullFileDigest()), HexLower(serial.FullFileDigest()));
+}
+
+- (void)testParallelPageHashSinglePassInvariant {
+  auto bytes = Slurp("/usr/bin/yes");
+  XCTAssertFalse(bytes.empty());
+  CountingMemoryFileReader r(bytes);
+  VerifyingHasherCore v(r, kHostArch,
+                        VerifyingHasherCore::Options{.buf_size = 16384,
+                                                     .parallel_page_hash = true,
+                                                     .parallel_min_bytes = 0});
+  XCTAssertEqual(v.Run(), VerifyingHasherCore::Status::kOk);
+  const uint32_t mx = r.MaxReadsAnyByte();
+  XCTAssertLessThanOrEqual(mx, 1u, @"parallel SP invariant violated: max reads = %u", mx);
+}
+
+- (void)testParallelPageHashPreservesIoError {
+  // Cut the backing data 3/4 of the way in, inside the arm64e signed
+  // region, so the EOF surfaces from the parallel read-ahead.
+  auto bytes = Slurp("/usr/bin/yes");
+  XCTAssertFalse(bytes.empty());
+  const off_t real_size = static_cast<off_t>(bytes.size());
+  bytes.resize(3 * bytes.size() / 4);
+
+  TruncatedMemoryFileReader r(std::move(bytes), real_size);
+  VerifyingHasherCore v(r, kHostArch,
+                        VerifyingHasherCore::Options{.buf_size = 65536,
+                                                     .parallel_page_hash = true,
+                                                     .parallel_min_bytes = 0});
+  XCTAssertEqual(v.Run(), VerifyingHasherCore::Status::kIoError);
+  XCTAssertTrue(v.FullFileDigest().empty());
+}
+
+- (void)testReadAheadMatchesSynchronousReads {
+  auto bytes = Slurp("/usr/bin/yes");
+  XCTAssertFalse(bytes.empty());
+
+  MemoryFileReader sync_reader(bytes);
+  VerifyingHasherCore sync(sync_reader, kHostArch);
+  XCTAssertEqual(sync.Run(), VerifyingHasherCore::Status::kOk);
+
+  for (bool parallel : {false, true}) {
+    CountingMemoryFileReader r(bytes);
+    VerifyingHasherCore v(r, kHostArch,
+                          VerifyingHasherCore::Options{.buf_size = 16384,
+                                                       .parallel_page_hash = parallel,
+                                                       .parallel_min_bytes = 0,
+                                                       .read_ahead_depth = 4,
+                                                       .read_ahead_buf_size = 10000});
+    XCTAssertEqual(v.Run(), VerifyingHasherCore::Status::kOk, @"parallel=%d: %s", parallel,
+                   std::string(v.LastError()).c_str());
+    XCTAssertEqual(HexLower(v.FullFileDigest()), HexLower(sync.FullFileDigest()));
+    XCTAssertEqual(HexLower(v.CDHash()), HexLower(sync.CDHash()));
+    const uint32_t mx = r.MaxReadsAnyByte();
+    XCTAssertLessThanOrEqual(mx, 1u, @"read-ahead SP invariant violated: max reads = %u", mx);
+  }
+}
+
 @end
@@ -558,6 +558,29 @@ std::vector<uint8_t> Slurp(const char* path) {
   XCTAssertEqual(0, std::memcmp(r.sha256->data(), reference_sha.data(), 32));
 }
 
+- (void)testFacadeSliceOnlyReportsSliceDigest {
+  // slice_only on a fat binary still drives kMatchCDHash, but reports the
+  // digest of the arm64 slice alone, leaving the full-file sha256 unset.
+  auto cdhash = [self hwUniversalArm64CdHash];
+  santa::ScopedFile sf([self openHwUniversalFd]);
+  VerifyingHasher::Expected exp{
+      .stat = [self actualStatForFd:sf.UnsafeFD()],
+      .signed_check =
+          VerifyingHasher::Expected::Signed{
+              .cdhash = std::span<const uint8_t>(cdhash.data(), cdhash.size()),
+              .signing_id = kHwUniversalSigningID,
+              .team_id = kHwUniversalTeamID,
+          },
+  };
+  auto r = VerifyingHasher::Run(sf.UnsafeFD(), CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL, exp,
+                                VerifyingHasher::RunOptions{.slice_only = true});
+  XCTAssertEqual(r.status, VerifyingHasher::Status::kMatchCDHash);
+  XCTAssertFalse(r.sha256.has_value());
+  XCTAssertTrue(r.slice_sha256.has_value());
+  XCTAssertTrue(r.cd_bytes.has_value());
+  XCTAssertTrue(r.signing_id.has_value());
+}
+
 - (void)testFacadeSkipPageHashBypassesTampered {
   // Write a tampered hw_universal into a temp file (mkstemp-backed,
   // unlinked at creation), open it, and exercise the facade with skip
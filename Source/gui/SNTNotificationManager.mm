@@ -54,6 +54,13 @@
 ///  The queue of pending notifications
 @property(readonly) NSMutableArray* pendingNotifications;
 
+///  The queueDedupeHash of each pending or throttled notification, for quickly collapsing
+///  duplicates
+@property(readonly) NSMutableSet<NSString*>* pendingDedupeHashes;
+
+///  Messages dropped because the queue was full, since it was last empty
+@property NSUInteger throttledMessageCount;
+
 // A serial queue for holding hashBundleBinaries requests
 @property dispatch_queue_t hashBundleBinariesQueue;
 
@@ -67,10 +74,17 @@
 
 static NSString* const silencedNotificationsKey = @"SilencedNotifications";
 
+// During mass blocks, queueing a window per message keeps the main thread busy and the pending
+// windows in memory. Past this many pending messages, new ones are summarized in a single
+// notification instead.
+static const NSUInteger kMaxPendingNotifications = 20;
+static NSString* const throttledNotificationIdentifier = @"throttledBlockNotification";
+
 - (instancetype)init {
   self = [super init];
   if (self) {
     _pendingNotifications = [[NSMutableArray alloc] init];
+    _pendingDedupeHashes = [[NSMutableSet alloc] init];
     _hashBundleBinariesQueue = dispatch_queue_create("com.northpolesec.santagui.hashbundlebinaries",
                                                      DISPATCH_QUEUE_SERIAL);
   }
@@ -85,8 +99,15 @@ static NSString* const silencedNotificationsKey = @"SilencedNotifications";
 
   [self.currentWindowController.bundleListener invalidate];
   [self.pendingNotifications removeObject:self.currentWindowController];
+  NSString* dedupeHash = [self.currentWindowController queueDedupeHash];
+  if (dedupeHash) [self.pendingDedupeHashes removeObject:dedupeHash];
   self.currentWindowController = nil;
-  if (self.pendingNotifications.count) [self showQueuedWindow];
+  if (self.pendingNotifications.count) {
+    [self showQueuedWindow];
+  } else {
+    [self.pendingDedupeHashes removeAllObjects];
+    self.throttledMessageCount = 0;
+  }
 }
 
 - (void)updateSilenceDate:(NSDate*)date forHash:(NSString*)hash {
@@ -102,10 +123,36 @@ static NSString* const silencedNotificationsKey = @"SilencedNotifications";
 }
 
 - (BOOL)notificationAlreadyQueued:(SNTMessageWindowController*)pendingMsg {
-  for (SNTMessageWindowController* msg in self.pendingNotifications) {
-    if ([[msg queueDedupeHash] isEqual:[pendingMsg queueDedupeHash]]) return YES;
+  NSString* dedupeHash = [pendingMsg queueDedupeHash];
+  return dedupeHash && [self.pendingDedupeHashes containsObject:dedupeHash];
+}
+
+- (void)discardMessage:(SNTMessageWindowController*)pendingMsg {
+  // Make sure we clear the reply block so we don't leak memory.
+  if ([pendingMsg isKindOfClass:[SNTBinaryMessageWindowController class]]) {
+    SNTBinaryMessageWindowController* bmwc = (SNTBinaryMessageWindowController*)pendingMsg;
+    bmwc.replyBlock(NO);
   }
-  return NO;
+}
+
+// Coalesce messages that didn't fit in the queue into one notification, replaced each time.
+- (void)postThrottledNotification {
+  UNUserNotificationCenter* un = [UNUserNotificationCenter currentNotificationCenter];
+
+  UNMutableNotificationContent* content = [[UNMutableNotificationContent alloc] init];
+  content.title = @"Santa";
+  content.body = [NSString
+      stringWithFormat:NSLocalizedString(@"%lu more blocked events were not shown",
+                                         @"Notification message shown when too many events were "
+                                         @"blocked to show a window for each"),
+                       self.throttledMessageCount];
+
+  UNNotificationRequest* req =
+      [UNNotificationRequest requestWithIdentifier:throttledNotificationIdentifier
+                                           content:content
+                                           trigger:nil];
+
+  [un addNotificationRequest:req withCompletionHandler:nil];
 }
 
 - (void)queueMessage:(SNTMessageWindowController*)pendingMsg enableSilences:(BOOL)enableSilences {
@@ -118,11 +165,7 @@ static NSString* const silencedNotificationsKey = @"SilencedNotifications";
 
   dispatch_async(dispatch_get_main_queue(), ^{
     if ([self notificationAlreadyQueued:pendingMsg]) {
-      // Make sure we clear the reply block so we don't leak memory.
-      if ([pendingMsg isKindOfClass:[SNTBinaryMessageWindowController class]]) {
-        SNTBinaryMessageWindowController* bmwc = (SNTBinaryMessageWindowController*)pendingMsg;
-        bmwc.replyBlock(NO);
-      }
+      [self discardMessage:pendingMsg];
       return;
     }
 
@@ -145,8 +188,21 @@ static NSString* const silencedNotificationsKey = @"SilencedNotifications";
       }
     }
 
+    NSString* dedupeHash = [pendingMsg queueDedupeHash];
+    if (self.pendingNotifications.count >= kMaxPendingNotifications) {
+      // Identical messages are collapsed onto this one until the queue empties.
+      if (dedupeHash) [self.pendingDedupeHashes addObject:dedupeHash];
+      [self discardMessage:pendingMsg];
+      if (self.throttledMessageCount++ == 0) {
+        LOGW(@"Notification queue is full, summarizing further notifications");
+      }
+      [self postThrottledNotification];
+      return;
+    }
+
     pendingMsg.delegate = self;
     [self.pendingNotifications addObject:pendingMsg];
+    if (dedupeHash) [self.pendingDedupeHashes addObject:dedupeHash];
 
     if (!self.currentWindowController) {
       [self showQueuedWindow];
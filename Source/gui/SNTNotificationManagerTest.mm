@@ -31,6 +31,21 @@
 - (void)hashBundleBinariesForEvent:(SNTStoredEvent*)event
                     withController:(SNTBinaryMessageWindowController*)controller;
 - (void)queueMessage:(SNTMessageWindowController*)pendingMsg enableSilences:(BOOL)enableSilences;
+- (void)showQueuedWindow;
+- (void)postThrottledNotification;
+@property(readonly) NSMutableArray* pendingNotifications;
+@property NSUInteger throttledMessageCount;
+@end
+
+// Uses a caller-provided key for both silencing and queue de-dup.
+@interface FixedHashController : SNTMessageWindowController
+@property NSString* hashKey;
+@end
+
+@implementation FixedHashController
+- (NSString*)messageHash {
+  return self.hashKey;
+}
 @end
 
 // Overrides only messageHash, to confirm the base queueDedupeHash defaults to it.
@@ -189,6 +204,36 @@
   XCTAssertEqualObjects([controller queueDedupeHash], @"passthrough-key");
 }
 
+// During mass blocks only a bounded number of windows are queued, duplicates collapse onto the
+// queued window and everything else is summarized in a single notification.
+- (void)testQueueIsCappedDuringMassBlocks {
+  SNTNotificationManager* mgr = [[SNTNotificationManager alloc] init];
+  id mgrMock = OCMPartialMock(mgr);
+  OCMStub([mgrMock showQueuedWindow]).andDo(nil);
+  OCMStub([mgrMock postThrottledNotification]).andDo(nil);
+
+  for (int i = 0; i < 30; i++) {
+    FixedHashController* controller = [[FixedHashController alloc] init];
+    controller.hashKey = [NSString stringWithFormat:@"key-%d", i];
+    [mgr queueMessage:controller enableSilences:NO];
+
+    FixedHashController* duplicate = [[FixedHashController alloc] init];
+    duplicate.hashKey = controller.hashKey;
+    [mgr queueMessage:duplicate enableSilences:NO];
+  }
+
+  XCTestExpectation* drained = [self expectationWithDescription:@"main queue drained"];
+  dispatch_async(dispatch_get_main_queue(), ^{
+    [drained fulfill];
+  });
+  [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+  XCTAssertEqual(mgr.pendingNotifications.count, 20);
+  XCTAssertEqual(mgr.throttledMessageCount, 10);
+  OCMVerify(times(10), [mgrMock postThrottledNotification]);
+  [mgrMock stopMocking];
+}
+
 #pragma mark Timed-mode push threading
 
 // Regression tests for the status-menu main-thread-assert crash.
@@ -0,0 +1,59 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#include <sys/stat.h>
+
+///
+///  A persistent cache of the SHA-256 of each binary found the last time a bundle was scanned,
+///  so that rescanning a bundle only hashes the binaries that changed.
+///
+///  A binary is identified by the device, inode, size, modification time and change time of the
+///  file that was hashed. The change time can't be set from user space and moves with any write,
+///  so a file can't be modified without invalidating its entry.
+///
+///  Any other set of files that is scanned together can be cached the same way under a key that
+///  isn't a bundle path.
+///
+///  This class is thread-safe.
+///
+@interface SNTBundleHashCache : NSObject
+
+///
+///  Load the cache from the given path. A missing or unreadable file leaves the cache empty.
+///
+- (instancetype)initWithPath:(NSString*)path;
+
+///
+///  @return The SHA-256 recorded for the file the last time the bundle was scanned, if the file
+///          hasn't changed since.
+///
+- (NSString*)SHA256ForFile:(const struct stat*)fileStat inBundle:(NSString*)bundlePath;
+
+///
+///  Record the SHA-256 of a binary found while scanning a bundle. Recorded hashes are used by
+///  later scans once -finishScanOfBundle: is called.
+///
+- (void)setSHA256:(NSString*)sha256
+          forFile:(const struct stat*)fileStat
+         inBundle:(NSString*)bundlePath;
+
+///
+///  Replace the bundle's entries with the ones recorded since the last call, dropping binaries that
+///  weren't found again, and write the cache to disk.
+///
+- (void)finishScanOfBundle:(NSString*)bundlePath;
+
+@end
@@ -0,0 +1,136 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/santabundleservice/SNTBundleHashCache.h"
+
+#import "Source/common/SNTLogging.h"
+
+// Once more bundles than this are cached, the ones scanned longest ago are dropped.
+static const NSUInteger kMaxBundles = 32;
+
+static NSString* const kLastScanKey = @"LastScan";
+static NSString* const kBinariesKey = @"Binaries";
+static NSString* const kVersionKey = @"Version";
+static NSString* const kSHA256Key = @"SHA256";
+
+// The device and inode stay the same for the life of a file.
+static NSString* FileKey(const struct stat* fileStat) {
+  return [NSString stringWithFormat:@"%d:%llu", fileStat->st_dev, (uint64_t)fileStat->st_ino];
+}
+
+// Everything that must be unchanged for a cached hash to be reused.
+static NSArray<NSNumber*>* FileVersion(const struct stat* fileStat) {
+  return @[
+    @(fileStat->st_size),
+    @(fileStat->st_mtimespec.tv_sec),
+    @(fileStat->st_mtimespec.tv_nsec),
+    @(fileStat->st_ctimespec.tv_sec),
+    @(fileStat->st_ctimespec.tv_nsec),
+  ];
+}
+
+@interface SNTBundleHashCache ()
+@property(readonly) NSString* path;
+// Bundle path -> {LastScan : NSDate, Binaries : {file key -> {Version : NSArray, SHA256 : hash}}}
+@property(readonly) NSMutableDictionary<NSString*, NSDictionary*>* bundles;
+// Binaries recorded by scans that haven't finished, by bundle path.
+@property(readonly) NSMutableDictionary<NSString*, NSMutableDictionary*>* pending;
+@end
+
+@implementation SNTBundleHashCache
+
+- (instancetype)initWithPath:(NSString*)path {
+  self = [super init];
+  if (self) {
+    _path = [path copy];
+    _bundles = [NSMutableDictionary dictionary];
+    _pending = [NSMutableDictionary dictionary];
+
+    NSData* data = [NSData dataWithContentsOfFile:path];
+    NSDictionary* plist = data ? [NSPropertyListSerialization
+                                     propertyListWithData:data
+                                                  options:NSPropertyListImmutable
+                                                   format:NULL
+                                                    error:NULL]
+                               : nil;
+    if ([plist isKindOfClass:[NSDictionary class]]) {
+      [plist enumerateKeysAndObjectsUsingBlock:^(id bundlePath, id bundle, BOOL* stop) {
+        if ([bundlePath isKindOfClass:[NSString class]] &&
+            [bundle isKindOfClass:[NSDictionary class]] &&
+            [bundle[kLastScanKey] isKindOfClass:[NSDate class]] &&
+            [bundle[kBinariesKey] isKindOfClass:[NSDictionary class]]) {
+          self->_bundles[bundlePath] = bundle;
+        }
+      }];
+    }
+  }
+  return self;
+}
+
+- (NSString*)SHA256ForFile:(const struct stat*)fileStat inBundle:(NSString*)bundlePath {
+  NSDictionary* entry;
+  @synchronized(self) {
+    entry = self.bundles[bundlePath][kBinariesKey][FileKey(fileStat)];
+  }
+  if (![entry isKindOfClass:[NSDictionary class]]) return nil;
+  if (![entry[kVersionKey] isEqual:FileVersion(fileStat)]) return nil;
+
+  NSString* sha256 = entry[kSHA256Key];
+  if (![sha256 isKindOfClass:[NSString class]] || sha256.length != 64) return nil;
+  return sha256;
+}
+
+- (void)setSHA256:(NSString*)sha256
+          forFile:(const struct stat*)fileStat
+         inBundle:(NSString*)bundlePath {
+  if (!sha256.length) return;
+
+  NSDictionary* entry = @{kVersionKey : FileVersion(fileStat), kSHA256Key : sha256};
+  @synchronized(self) {
+    NSMutableDictionary* binaries = self.pending[bundlePath];
+    if (!binaries) {
+      binaries = [NSMutableDictionary dictionary];
+      self.pending[bundlePath] = binaries;
+    }
+    binaries[FileKey(fileStat)] = entry;
+  }
+}
+
+- (void)finishScanOfBundle:(NSString*)bundlePath {
+  @synchronized(self) {
+    NSDictionary* binaries = [self.pending[bundlePath] copy] ?: @{};
+    [self.pending removeObjectForKey:bundlePath];
+    self.bundles[bundlePath] = @{kLastScanKey : [NSDate date], kBinariesKey : binaries};
+
+    if (self.bundles.count > kMaxBundles) {
+      NSArray* oldestFirst = [self.bundles keysSortedByValueUsingComparator:^(id a, id b) {
+        return [a[kLastScanKey] compare:b[kLastScanKey]];
+      }];
+      [self.bundles removeObjectsForKeys:[oldestFirst subarrayWithRange:NSMakeRange(
+                                                        0, self.bundles.count - kMaxBundles)]];
+    }
+
+    // Written while locked so that concurrent scans can't write older copies over newer ones.
+    NSError* error;
+    NSData* data = [NSPropertyListSerialization dataWithPropertyList:self.bundles
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0
+                                                               error:&error];
+    if (!data || ![data writeToFile:self.path options:NSDataWritingAtomic error:&error]) {
+      LOGW(@"Unable to write bundle hash cache to %@: %@", self.path, error.localizedDescription);
+    }
+  }
+}
+
+@end
@@ -0,0 +1,121 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/santabundleservice/SNTBundleHashCache.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <sys/stat.h>
+
+static NSString* const kBundle = @"/Applications/Example.app";
+static NSString* const kSHA256 =
+    @"5e089b65a1e7a4696d84a34510710b6993d1de21250c41daaec63d9981083eba";
+
+@interface SNTBundleHashCacheTest : XCTestCase
+@property NSString* tempDir;
+@property NSString* cachePath;
+@property NSString* binaryPath;
+@end
+
+@implementation SNTBundleHashCacheTest
+
+- (void)setUp {
+  self.tempDir = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"SNTBundleHashCacheTest-%@",
+                                                                NSUUID.UUID.UUIDString]];
+  XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath:self.tempDir
+                                          withIntermediateDirectories:YES
+                                                           attributes:nil
+                                                                error:NULL]);
+  self.cachePath = [self.tempDir stringByAppendingPathComponent:@"cache.plist"];
+  self.binaryPath = [self.tempDir stringByAppendingPathComponent:@"binary"];
+  XCTAssertTrue([@"contents" writeToFile:self.binaryPath
+                              atomically:NO
+                                encoding:NSUTF8StringEncoding
+                                   error:NULL]);
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.tempDir error:NULL];
+}
+
+- (struct stat)statBinary {
+  struct stat fileStat;
+  XCTAssertEqual(stat(self.binaryPath.fileSystemRepresentation, &fileStat), 0);
+  return fileStat;
+}
+
+- (void)testHashesPersistAcrossInstances {
+  struct stat fileStat = [self statBinary];
+
+  SNTBundleHashCache* cache = [[SNTBundleHashCache alloc] initWithPath:self.cachePath];
+  XCTAssertNil([cache SHA256ForFile:&fileStat inBundle:kBundle]);
+
+  // Recorded hashes are only used once the scan finishes.
+  [cache setSHA256:kSHA256 forFile:&fileStat inBundle:kBundle];
+  XCTAssertNil([cache SHA256ForFile:&fileStat inBundle:kBundle]);
+  [cache finishScanOfBundle:kBundle];
+  XCTAssertEqualObjects([cache SHA256ForFile:&fileStat inBundle:kBundle], kSHA256);
+
+  cache = [[SNTBundleHashCache alloc] initWithPath:self.cachePath];
+  XCTAssertEqualObjects([cache SHA256ForFile:&fileStat inBundle:kBundle], kSHA256);
+  XCTAssertNil([cache SHA256ForFile:&fileStat inBundle:@"/Applications/Other.app"]);
+}
+
+- (void)testChangedFilesAreNotReused {
+  struct stat fileStat = [self statBinary];
+  SNTBundleHashCache* cache = [[SNTBundleHashCache alloc] initWithPath:self.cachePath];
+  [cache setSHA256:kSHA256 forFile:&fileStat inBundle:kBundle];
+  [cache finishScanOfBundle:kBundle];
+
+  // Resetting the modification time still moves the change time.
+  struct stat changed = fileStat;
+  changed.st_ctimespec.tv_nsec += 1;
+  XCTAssertNil([cache SHA256ForFile:&changed inBundle:kBundle]);
+
+  changed = fileStat;
+  changed.st_size += 1;
+  XCTAssertNil([cache SHA256ForFile:&changed inBundle:kBundle]);
+
+  changed = fileStat;
+  changed.st_ino += 1;
+  XCTAssertNil([cache SHA256ForFile:&changed inBundle:kBundle]);
+}
+
+- (void)testRescanDropsMissingBinaries {
+  struct stat fileStat = [self statBinary];
+  SNTBundleHashCache* cache = [[SNTBundleHashCache alloc] initWithPath:self.cachePath];
+  [cache setSHA256:kSHA256 forFile:&fileStat inBundle:kBundle];
+  [cache finishScanOfBundle:kBundle];
+
+  [cache finishScanOfBundle:kBundle];
+  XCTAssertNil([cache SHA256ForFile:&fileStat inBundle:kBundle]);
+}
+
+- (void)testCorruptCacheIsIgnored {
+  XCTAssertTrue([@"not a plist" writeToFile:self.cachePath
+                                 atomically:NO
+                                   encoding:NSUTF8StringEncoding
+                                      error:NULL]);
+  struct stat fileStat = [self statBinary];
+
+  SNTBundleHashCache* cache = [[SNTBundleHashCache alloc] initWithPath:self.cachePath];
+  XCTAssertNil([cache SHA256ForFile:&fileStat inBundle:kBundle]);
+  [cache setSHA256:kSHA256 forFile:&fileStat inBundle:kBundle];
+  [cache finishScanOfBundle:kBundle];
+  XCTAssertEqualObjects([cache SHA256ForFile:&fileStat inBundle:kBundle], kSHA256);
+}
+
+@end
@@ -0,0 +1,76 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#include <sys/qos.h>
+
+///
+///  A single bundle scan. The job decides the QoS its work runs at, when it should stop, and how
+///  often progress is reported to the client.
+///
+///  A job started for a dialog that's on screen runs at user-initiated QoS. Once the dialog goes
+///  away the job can be demoted to background QoS, so it still finishes and fills the bundle hash
+///  cache for the next scan, without competing with what the user is doing.
+///
+///  This class is thread-safe.
+///
+@interface SNTBundleHashJob : NSObject
+
+///
+///  @param progress The progress of the scan, if the client asked for it. Cancelling the progress
+///      cancels the job.
+///  @param foreground Whether a user is waiting on the result.
+///
+- (instancetype)initWithProgress:(NSProgress*)progress foreground:(BOOL)foreground;
+
+@property(readonly) NSProgress* progress;
+@property(readonly) qos_class_t qos;
+@property(readonly, getter=isCancelled) BOOL cancelled;
+
+///
+///  The most iterations of -apply:block: that run at once, or 0 to let dispatch decide. Limiting
+///  concurrency keeps slow storage from thrashing between files.
+///
+@property size_t maxConcurrency;
+
+///
+///  Stop the job. Iterations that haven't started yet are skipped.
+///
+- (void)cancel;
+
+///
+///  Run the job's remaining work at background QoS.
+///
+- (void)demote;
+
+///
+///  Call block once for each index in [0, iterations) concurrently, at the job's current QoS.
+///  Indexes are started in ascending order. Returns once all iterations are done, or skipped
+///  because the job was cancelled.
+///
+- (void)apply:(size_t)iterations block:(void (^)(size_t i))block;
+
+///
+///  Call report periodically until -stopReportingProgress is called. Progress is reported from a
+///  timer so that workers only need to bump counters, rather than message the client per file.
+///
+- (void)startReportingProgress:(void (^)(void))report;
+
+///
+///  Stop the timer and report one last time, after any in-flight report.
+///
+- (void)stopReportingProgress;
+
+@end
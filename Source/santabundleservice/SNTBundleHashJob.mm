@@ -0,0 +1,114 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/santabundleservice/SNTBundleHashJob.h"
+
+#include <atomic>
+#include <memory>
+
+// How often the client is told about scan progress.
+static const uint64_t kProgressIntervalNS = 100 * NSEC_PER_MSEC;
+
+// The QoS is re-checked between batches of iterations, so a demotion takes
+// effect quickly without wrapping every file in its own block.
+static const size_t kIterationsPerBatch = 256;
+
+@interface SNTBundleHashJob ()
+@property(readwrite) NSProgress* progress;
+@property dispatch_queue_t progressQueue;
+@property dispatch_source_t progressTimer;
+@property(copy) void (^report)(void);
+@end
+
+@implementation SNTBundleHashJob {
+  std::atomic<qos_class_t> _qos;
+  std::atomic<bool> _cancelled;
+}
+
+- (instancetype)initWithProgress:(NSProgress*)progress foreground:(BOOL)foreground {
+  self = [super init];
+  if (self) {
+    _progress = progress;
+    _qos = foreground ? QOS_CLASS_USER_INITIATED : QOS_CLASS_BACKGROUND;
+    _cancelled = false;
+    _progressQueue = dispatch_queue_create("com.northpolesec.santa.bundleservice.progress",
+                                           DISPATCH_QUEUE_SERIAL);
+  }
+  return self;
+}
+
+- (qos_class_t)qos {
+  return _qos.load(std::memory_order_relaxed);
+}
+
+- (BOOL)isCancelled {
+  return _cancelled.load(std::memory_order_relaxed) || self.progress.isCancelled;
+}
+
+- (void)cancel {
+  _cancelled.store(true, std::memory_order_relaxed);
+  [self.progress cancel];
+}
+
+- (void)demote {
+  _qos.store(QOS_CLASS_BACKGROUND, std::memory_order_relaxed);
+}
+
+- (void)apply:(size_t)iterations block:(void (^)(size_t i))block {
+  for (size_t start = 0; start < iterations && !self.isCancelled; start += kIterationsPerBatch) {
+    size_t count = MIN(kIterationsPerBatch, iterations - start);
+    size_t workers = self.maxConcurrency ? MIN(self.maxConcurrency, count) : count;
+
+    // Each worker takes the next index until the batch is done, so with
+    // limited concurrency the files are still visited in order.
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+
+    // Invoking a block created with an enforced QoS runs it at that QoS, and
+    // dispatch_apply's workers inherit it from the calling thread.
+    dispatch_block_t batch = dispatch_block_create_with_qos_class(
+        DISPATCH_BLOCK_ENFORCE_QOS_CLASS, self.qos, 0, ^{
+          dispatch_apply(workers, DISPATCH_APPLY_AUTO, ^(size_t) {
+            size_t i;
+            while ((i = next->fetch_add(1, std::memory_order_relaxed)) < count) {
+              if (self.isCancelled) return;
+              block(start + i);
+            }
+          });
+        });
+    batch();
+  }
+}
+
+- (void)startReportingProgress:(void (^)(void))report {
+  self.report = report;
+  self.progressTimer =
+      dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.progressQueue);
+  dispatch_source_set_timer(self.progressTimer,
+                            dispatch_time(DISPATCH_TIME_NOW, kProgressIntervalNS),
+                            kProgressIntervalNS, kProgressIntervalNS / 10);
+  dispatch_source_set_event_handler(self.progressTimer, report);
+  dispatch_resume(self.progressTimer);
+}
+
+- (void)stopReportingProgress {
+  if (!self.progressTimer) return;
+  dispatch_source_cancel(self.progressTimer);
+  self.progressTimer = nil;
+
+  // Runs after any in-flight timer update, so the final counts are sent last.
+  dispatch_sync(self.progressQueue, self.report);
+  self.report = nil;
+}
+
+@end
@@ -0,0 +1,139 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/santabundleservice/SNTBundleHashJob.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+@interface SNTBundleHashJobTest : XCTestCase
+@end
+
+@implementation SNTBundleHashJobTest
+
+- (void)testApplyVisitsEveryIndexOnce {
+  SNTBundleHashJob* job = [[SNTBundleHashJob alloc] initWithProgress:nil foreground:YES];
+
+  // Spans several batches, the last of which is partial.
+  const size_t kIterations = 1000;
+  auto visits = std::make_shared<std::vector<std::atomic<int>>>(kIterations);
+  [job apply:kIterations
+       block:^(size_t i) {
+         visits->at(i).fetch_add(1);
+       }];
+
+  for (size_t i = 0; i < kIterations; i++) {
+    XCTAssertEqual(visits->at(i).load(), 1);
+  }
+}
+
+- (void)testMaxConcurrency {
+  SNTBundleHashJob* job = [[SNTBundleHashJob alloc] initWithProgress:nil foreground:YES];
+  job.maxConcurrency = 2;
+
+  auto running = std::make_shared<std::atomic<int>>(0);
+  auto maxRunning = std::make_shared<std::atomic<int>>(0);
+  [job apply:600
+       block:^(size_t i) {
+         int now = running->fetch_add(1) + 1;
+         int seen = maxRunning->load();
+         while (now > seen && !maxRunning->compare_exchange_weak(seen, now)) {
+         }
+         usleep(10);
+         running->fetch_sub(1);
+       }];
+
+  XCTAssertGreaterThan(maxRunning->load(), 0);
+  XCTAssertLessThanOrEqual(maxRunning->load(), 2);
+
+  // A single worker visits the indexes in order.
+  job.maxConcurrency = 1;
+  auto order = std::make_shared<std::vector<size_t>>();
+  [job apply:600
+       block:^(size_t i) {
+         order->push_back(i);
+       }];
+
+  XCTAssertEqual(order->size(), 600);
+  for (size_t i = 0; i < order->size(); i++) {
+    XCTAssertEqual(order->at(i), i);
+  }
+}
+
+- (void)testCancelSkipsRemainingIterations {
+  SNTBundleHashJob* job = [[SNTBundleHashJob alloc] initWithProgress:nil foreground:YES];
+
+  auto count = std::make_shared<std::atomic<size_t>>(0);
+  [job apply:10000
+       block:^(size_t i) {
+         if (count->fetch_add(1) == 0) [job cancel];
+       }];
+
+  XCTAssertTrue(job.isCancelled);
+  XCTAssertLessThan(count->load(), 10000);
+}
+
+- (void)testCancellingProgressCancelsJob {
+  NSProgress* progress = [NSProgress progressWithTotalUnitCount:100];
+  SNTBundleHashJob* job = [[SNTBundleHashJob alloc] initWithProgress:progress foreground:YES];
+
+  XCTAssertFalse(job.isCancelled);
+  [progress cancel];
+  XCTAssertTrue(job.isCancelled);
+
+  // Cancelling the job cancels its progress.
+  progress = [NSProgress progressWithTotalUnitCount:100];
+  job = [[SNTBundleHashJob alloc] initWithProgress:progress foreground:YES];
+  [job cancel];
+  XCTAssertTrue(progress.isCancelled);
+}
+
+- (void)testDemote {
+  SNTBundleHashJob* job = [[SNTBundleHashJob alloc] initWithProgress:nil foreground:YES];
+  XCTAssertEqual(job.qos, QOS_CLASS_USER_INITIATED);
+
+  [job demote];
+  XCTAssertEqual(job.qos, QOS_CLASS_BACKGROUND);
+
+  job = [[SNTBundleHashJob alloc] initWithProgress:nil foreground:NO];
+  XCTAssertEqual(job.qos, QOS_CLASS_BACKGROUND);
+}
+
+- (void)testStopReportingProgressReportsFinalCounts {
+  SNTBundleHashJob* job = [[SNTBundleHashJob alloc] initWithProgress:nil foreground:YES];
+
+  auto done = std::make_shared<std::atomic<size_t>>(0);
+  auto reported = std::make_shared<std::atomic<size_t>>(0);
+  [job startReportingProgress:^{
+    reported->store(done->load());
+  }];
+
+  [job apply:500
+       block:^(size_t i) {
+         done->fetch_add(1);
+       }];
+  [job stopReportingProgress];
+
+  XCTAssertEqual(reported->load(), 500);
+
+  // Stopping twice is harmless.
+  [job stopReportingProgress];
+}
+
+@end
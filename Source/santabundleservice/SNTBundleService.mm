@@ -16,10 +16,19 @@
 #import "Source/santabundleservice/SNTBundleService.h"
 
 #import <CommonCrypto/CommonDigest.h>
+#include <fcntl.h>
+#include <fts.h>
+#include <mach-o/fat.h>
+#include <mach-o/loader.h>
 #import <pthread/pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#import <algorithm>
 #import <atomic>
 #import <memory>
+#import <string>
+#import <utility>
 #import <vector>
 
 #include "Source/common/Glob.h"
@@ -28,11 +37,73 @@
 #import "Source/common/SNTFileInfo.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
+#import "Source/common/SNTSystemInfo.h"
+#import "Source/common/SNTXPCControlInterface.h"
 #import "Source/common/SNTXPCNotifierInterface.h"
+#import "Source/common/SantaVnode.h"
 #import "Source/common/SigningIDHelpers.h"
+#import "Source/santabundleservice/SNTBundleHashCache.h"
+#import "Source/santabundleservice/SNTBundleHashJob.h"
+
+static NSString* const kBundleHashCachePath = @"/var/db/santa/bundle-hash-cache.plist";
+static NSString* const kPathScanKeyPrefix = @"path:";
+
+// Jobs that nobody is waiting on any more are given up on after this long.
+static const uint64_t kJobTimeoutNS = 600 * NSEC_PER_SEC;
+
+// How many files are read at once on storage that's slow to seek between them. Internal solid state
+// storage is left to dispatch.
+static const size_t kRotationalConcurrency = 2;
+static const size_t kExternalConcurrency = 4;
+
+// Known SHA-256s are asked for from santad in batches of this many files, and binaries are hashed
+// here if santad doesn't reply in time. Each batch's file handles are duplicated into santad until
+// it replies, so batches are kept well under its descriptor limit.
+static const NSUInteger kKnownSHA256BatchSize = 64;
+static const uint64_t kKnownSHA256TimeoutNS = 5 * NSEC_PER_SEC;
+
+struct FoundFile {
+  std::string path;
+  ino_t ino;
+};
+
+// Only Mach-O files can be executables. Checking the magic number first avoids
+// building an SNTFileInfo for the many resources in a large bundle.
+static BOOL HasMachOMagic(const char* path) {
+  // Non-blocking so that a FIFO in the bundle can't stall the scan.
+  int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) return NO;
+
+  uint32_t magic = 0;
+  ssize_t bytesRead = pread(fd, &magic, sizeof(magic), 0);
+  close(fd);
+  if (bytesRead != sizeof(magic)) return NO;
+
+  switch (magic) {
+    case MH_MAGIC:
+    case MH_CIGAM:
+    case MH_MAGIC_64:
+    case MH_CIGAM_64:
+    case FAT_MAGIC:
+    case FAT_CIGAM: return YES;
+    default: return NO;
+  }
+}
+
+// The offset on the device of the start of the file, or UINT64_MAX if it can't be found.
+static uint64_t DeviceOffset(const char* path) {
+  int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) return UINT64_MAX;
+
+  struct log2phys l2p = {};
+  int ret = fcntl(fd, F_LOG2PHYS, &l2p);
+  close(fd);
+  return ret == 0 ? (uint64_t)l2p.l2p_devoffset : UINT64_MAX;
+}
 
 @interface SNTBundleService ()
 @property(nonatomic) dispatch_queue_t queue;
+@property(nonatomic) SNTBundleHashCache* hashCache;
 @end
 
 @implementation SNTBundleService
@@ -41,6 +112,7 @@
   self = [super init];
   if (self) {
     _queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
+    _hashCache = [[SNTBundleHashCache alloc] initWithPath:kBundleHashCachePath];
   }
   return self;
 }
@@ -57,6 +129,12 @@
 
   dispatch_semaphore_t sema = dispatch_semaphore_create(0);
 
+  // A listener is only passed by SantaGUI, for a dialog that's on screen. The dialog closing
+  // invalidates the listener, after which the job keeps going in the background so that the hashes
+  // it finds are cached for the next time the bundle is blocked.
+  SNTBundleHashJob* job = [[SNTBundleHashJob alloc] initWithProgress:progress
+                                                          foreground:(listener != nil)];
+
   // Connect back to the client.
   MOLXPCConnection* clientListener;
   if (listener) {
@@ -64,12 +142,12 @@
     clientListener.remoteInterface =
         [NSXPCInterface interfaceWithProtocol:@protocol(SNTBundleServiceProgressXPC)];
     clientListener.invalidationHandler = ^{
-      [progress cancel];
+      [job demote];
     };
     [clientListener resume];
   }
 
-  dispatch_async(self.queue, ^{
+  dispatch_async(dispatch_get_global_queue(job.qos, 0), ^{
     // Use the highest bundle we can find.
     SNTFileInfo* b = [[SNTFileInfo alloc] initWithPath:event.fileBundlePath];
     b.useAncestorBundle = YES;
@@ -96,7 +174,7 @@
     }
 
     NSDictionary* relatedEvents = [self findRelatedBinaries:event
-                                                   progress:progress
+                                                        job:job
                                              clientListener:clientListener];
     NSString* bundleHash = [self calculateBundleHashFromSHA256Hashes:relatedEvents.allKeys
                                                             progress:progress];
@@ -109,8 +187,8 @@
   // Master timeout of 10 min. Don't block the calling thread. NSProgress updates will be coming
   // in over this thread.
   dispatch_async(self.queue, ^{
-    if (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 600 * NSEC_PER_SEC))) {
-      [progress cancel];
+    if (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, kJobTimeoutNS))) {
+      [job cancel];
     }
   });
 }
@@ -121,97 +199,204 @@
   dispatch_async(self.queue, ^{
     NSMutableArray<SNTStoredExecutionEvent*>* allEvents = [NSMutableArray array];
 
-    std::vector<std::string> matches = santa::FindMatches(path);
-    for (const auto& match : matches) {
-      @autoreleasepool {
-        NSString* matchPath = @(match.c_str());
-        SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:matchPath];
-        if (!fi) continue;
-
-        SNTStoredExecutionEvent* se = [[SNTStoredExecutionEvent alloc] initWithFileInfo:fi];
-        if (!se) continue;
-        se.decision = SNTEventStateBundleBinary;
-
-        BOOL includePrimaryEvent = YES;
-        if (enableBundles && fi.bundle) {
-          se.fileBundlePath = fi.bundlePath;
-
-          // Use the highest bundle we can find.
-          SNTFileInfo* b = [[SNTFileInfo alloc] initWithPath:se.fileBundlePath];
-          b.useAncestorBundle = YES;
-          se.fileBundlePath = b.bundlePath;
-
-          if (se.fileBundlePath) {
-            se.fileBundleID = b.bundleIdentifier;
-            se.fileBundleName = b.bundleName;
-            se.fileBundleVersion = b.bundleVersion;
-            se.fileBundleVersionString = b.bundleShortVersionString;
-
-            if (b.bundle.executablePath.length > b.bundlePath.length) {
-              se.fileBundleExecutableRelPath =
-                  [b.bundle.executablePath substringFromIndex:b.bundlePath.length + 1];
+    // Hashes of the files matched by the path are cached like those of a bundle, under a key that
+    // can't collide with a bundle path.
+    NSString* scanKey = [kPathScanKeyPrefix stringByAppendingString:path];
+
+    // Matches are hashed on their own queue as they are found, while the rest of the path is
+    // still being expanded.
+    dispatch_queue_t eventQueue =
+        dispatch_queue_create("com.northpolesec.santa.bundleservice.path_events",
+                              DISPATCH_QUEUE_SERIAL);
+
+    santa::FindMatches(path, [&](const std::string& match) {
+      NSString* matchPath = @(match.c_str());
+      dispatch_async(eventQueue, ^{
+        @autoreleasepool {
+          SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:matchPath];
+          if (!fi) return;
+
+          SNTStoredExecutionEvent* se = [self eventForFileInfo:fi scanKey:scanKey];
+          if (!se) return;
+          se.decision = SNTEventStateBundleBinary;
+
+          BOOL includePrimaryEvent = YES;
+          if (enableBundles && fi.bundle) {
+            se.fileBundlePath = fi.bundlePath;
+
+            // Use the highest bundle we can find.
+            SNTFileInfo* b = [[SNTFileInfo alloc] initWithPath:se.fileBundlePath];
+            b.useAncestorBundle = YES;
+            se.fileBundlePath = b.bundlePath;
+
+            if (se.fileBundlePath) {
+              se.fileBundleID = b.bundleIdentifier;
+              se.fileBundleName = b.bundleName;
+              se.fileBundleVersion = b.bundleVersion;
+              se.fileBundleVersionString = b.bundleShortVersionString;
+
+              if (b.bundle.executablePath.length > b.bundlePath.length) {
+                se.fileBundleExecutableRelPath =
+                    [b.bundle.executablePath substringFromIndex:b.bundlePath.length + 1];
+              }
+
+              NSDate* startTime = [NSDate date];
+              SNTBundleHashJob* job = [[SNTBundleHashJob alloc] initWithProgress:nil
+                                                                      foreground:NO];
+              NSDictionary* relatedEvents = [self findRelatedBinaries:se
+                                                                  job:job
+                                                       clientListener:nil];
+              NSString* bundleHash = [self calculateBundleHashFromSHA256Hashes:relatedEvents.allKeys
+                                                                      progress:nil];
+              NSNumber* ms = [NSNumber numberWithDouble:[startTime timeIntervalSinceNow] * -1000.0];
+
+              NSNumber* bundleCount = @(relatedEvents.count);
+              for (SNTStoredExecutionEvent* e in relatedEvents.allValues) {
+                e.fileBundleHash = bundleHash;
+                e.fileBundleHashMilliseconds = ms;
+                e.fileBundleBinaryCount = bundleCount;
+              }
+              if (relatedEvents[se.fileSHA256]) {
+                includePrimaryEvent = NO;
+              } else {
+                se.fileBundleHash = bundleHash;
+                se.fileBundleHashMilliseconds = ms;
+                se.fileBundleBinaryCount = bundleCount;
+              }
+              [allEvents addObjectsFromArray:relatedEvents.allValues];
             }
+          }
 
-            NSDate* startTime = [NSDate date];
-            NSDictionary* relatedEvents = [self findRelatedBinaries:se
-                                                           progress:nil
-                                                     clientListener:nil];
-            NSString* bundleHash = [self calculateBundleHashFromSHA256Hashes:relatedEvents.allKeys
-                                                                    progress:nil];
-            NSNumber* ms = [NSNumber numberWithDouble:[startTime timeIntervalSinceNow] * -1000.0];
-
-            NSNumber* bundleCount = @(relatedEvents.count);
-            for (SNTStoredExecutionEvent* e in relatedEvents.allValues) {
-              e.fileBundleHash = bundleHash;
-              e.fileBundleHashMilliseconds = ms;
-              e.fileBundleBinaryCount = bundleCount;
-            }
-            if (relatedEvents[se.fileSHA256]) {
-              includePrimaryEvent = NO;
-            } else {
-              se.fileBundleHash = bundleHash;
-              se.fileBundleHashMilliseconds = ms;
-              se.fileBundleBinaryCount = bundleCount;
-            }
-            [allEvents addObjectsFromArray:relatedEvents.allValues];
+          if (includePrimaryEvent) {
+            [allEvents addObject:se];
           }
         }
+      });
+    });
 
-        if (includePrimaryEvent) {
-          [allEvents addObject:se];
-        }
-      }
-    }
+    // Wait for the matches still being hashed.
+    dispatch_sync(eventQueue, ^{
+                  });
 
+    [self.hashCache finishScanOfBundle:scanKey];
     reply(allEvents);
   });
 }
 
 #pragma mark Internal Methods
 
+// Create an event for the file, reusing its SHA-256 from the last scan with the same key if the
+// file hasn't changed since, and recording it for the next one.
+- (SNTStoredExecutionEvent*)eventForFileInfo:(SNTFileInfo*)fi scanKey:(NSString*)scanKey {
+  struct stat fileStat;
+  BOOL haveStat = [fi statOpenFile:&fileStat];
+  if (haveStat) {
+    NSString* sha256 = [self.hashCache SHA256ForFile:&fileStat inBundle:scanKey];
+    if (sha256) [fi setPrecomputedSHA256:sha256];
+  }
+
+  SNTStoredExecutionEvent* se = [[SNTStoredExecutionEvent alloc] initWithFileInfo:fi];
+  if (haveStat) {
+    [self.hashCache setSHA256:se.fileSHA256 forFile:&fileStat inBundle:scanKey];
+  }
+  return se;
+}
+
+// Asks santad for the SHA-256s it already computed for these versions of the binaries, while
+// evaluating their execs or by prehashing, so that only the rest need to be read and hashed.
+- (void)loadKnownSHA256sForBinaries:(NSArray<SNTFileInfo*>*)fileInfos {
+  if (!fileInfos.count) return;
+
+  MOLXPCConnection* daemonConn = [SNTXPCControlInterface configuredConnection];
+  [daemonConn resume];
+
+  for (NSUInteger start = 0; start < fileInfos.count; start += kKnownSHA256BatchSize) {
+    NSUInteger end = MIN(start + kKnownSHA256BatchSize, fileInfos.count);
+    NSMutableArray<NSFileHandle*>* fileHandles = [NSMutableArray arrayWithCapacity:end - start];
+    std::vector<SNTFileInfo*> versionFileInfos;
+    versionFileInfos.reserve(end - start);
+    for (NSUInteger i = start; i < end; i++) {
+      if (!fileInfos[i].fileHandle) continue;
+      [fileHandles addObject:fileInfos[i].fileHandle];
+      versionFileInfos.push_back(fileInfos[i]);
+    }
+    if (!fileHandles.count) continue;
+
+    dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+    __block NSArray<NSString*>* sha256s;
+    id<SNTDaemonControlXPC> rop = [daemonConn remoteObjectProxy];
+    [rop knownSHA256sForFileHandles:fileHandles
+                              reply:^(NSArray<NSString*>* reply) {
+                                sha256s = reply;
+                                dispatch_semaphore_signal(sema);
+                              }];
+    if (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, kKnownSHA256TimeoutNS))) {
+      LOGD(@"Timed out looking up known SHA-256s, hashing the remaining binaries");
+      break;
+    }
+    if (sha256s.count != versionFileInfos.size()) continue;
+
+    for (size_t i = 0; i < versionFileInfos.size(); i++) {
+      if (sha256s[i].length) [versionFileInfos[i] setPrecomputedSHA256:sha256s[i]];
+    }
+  }
+
+  [daemonConn invalidate];
+}
+
 /**
-  Find binaries within a bundle given the bundle's event. It will run until a timeout occurs,
-  or until the NSProgress is cancelled. Search is done within the bundle concurrently.
+  Find binaries within a bundle given the bundle's event. It will run until the job is cancelled,
+  either by a timeout or by its NSProgress. Search is done within the bundle concurrently.
 
   @param event The SNTStoredExecutionEvent to begin searching.
+  @param job The job the search is done for.
   @return An NSDictionary object with keys of fileSHA256 and values of SNTStoredExecutionEvent
   objects.
 */
 - (NSDictionary*)findRelatedBinaries:(SNTStoredExecutionEvent*)event
-                            progress:(NSProgress*)progress
+                                 job:(SNTBundleHashJob*)job
                       clientListener:(MOLXPCConnection*)clientListener {
-  // Find all files and folders within the fileBundlePath
+  NSProgress* progress = job.progress;
+
+  SNTStorageMedium medium = [SNTSystemInfo storageMediumForPath:event.fileBundlePath];
+  if (medium == SNTStorageMediumRotational) {
+    job.maxConcurrency = kRotationalConcurrency;
+  } else if (medium == SNTStorageMediumUnknown ||
+             [SNTSystemInfo isExternalStorageForPath:event.fileBundlePath]) {
+    job.maxConcurrency = kExternalConcurrency;
+  }
+
+  // Find all files within the fileBundlePath. Like subpathsOfDirectoryAtPath:, symlinks are listed
+  // but not traversed. Directories can never be binaries so they're left out.
   NSFileManager* fm = [NSFileManager defaultManager];
-  NSArray* subpaths = [fm subpathsOfDirectoryAtPath:event.fileBundlePath error:NULL];
+  __block auto paths = std::make_shared<std::vector<FoundFile>>();
+  char* roots[] = {const_cast<char*>(event.fileBundlePath.fileSystemRepresentation), NULL};
+  FTS* fts = fts_open(roots, FTS_PHYSICAL | FTS_NOCHDIR, NULL);
+  if (fts) {
+    FTSENT* entry;
+    while ((entry = fts_read(fts)) && !job.isCancelled) {
+      if (entry->fts_info == FTS_F || entry->fts_info == FTS_SL ||
+          entry->fts_info == FTS_SLNONE) {
+        paths->push_back({std::string(entry->fts_path, entry->fts_pathlen),
+                          entry->fts_statp->st_ino});
+      }
+    }
+    fts_close(fts);
+  }
+
+  // Files are mostly laid out in the order they were created, which inode numbers follow, so
+  // visiting them in inode order reads the bundle with far fewer seeks than directory order.
+  std::sort(paths->begin(), paths->end(),
+            [](const FoundFile& a, const FoundFile& b) { return a.ino < b.ino; });
 
   // This array is used to store pointers to executable SNTFileInfo objects. There will be one block
-  // dispatched per file in dirEnum. These blocks will write pointers to this array concurrently.
+  // dispatched per file found. These blocks will write pointers to this array concurrently.
   // No locks are used since every file has a slot.
   //
   // Xcode.app has roughly 500k files, 8bytes per pointer is ~4MB for this array. This size to space
   // ratio seems appropriate as Xcode.app is in the upper bounds of bundle size.
   // Using a shared pointer to make block capture easy.
-  __block auto fis = std::make_shared<std::vector<SNTFileInfo*>>(subpaths.count);
+  __block auto fis = std::make_shared<std::vector<SNTFileInfo*>>(paths->size());
 
   // Counts used as additional progress information in SantaGUI
   __block auto binaryCount = std::make_shared<std::atomic<int64_t>>(0);
@@ -221,97 +406,130 @@
   NSProgress* p;
   if (progress) {
     [progress becomeCurrentWithPendingUnitCount:80];
-    p = [NSProgress progressWithTotalUnitCount:subpaths.count * 100];
+    p = [NSProgress progressWithTotalUnitCount:paths->size()];
+
+    [job startReportingProgress:^{
+      p.completedUnitCount = completedUnits->load(std::memory_order_relaxed);
+      [[clientListener remoteObjectProxy]
+          updateCountsForEvent:event
+                   binaryCount:binaryCount->load(std::memory_order_relaxed)
+                     fileCount:completedUnits->load(std::memory_order_relaxed)
+                   hashedCount:0];
+    }];
   }
 
-  // Dispatch a block for every file in dirEnum.
-  dispatch_apply(subpaths.count, self.queue, ^(size_t i) {
-    @autoreleasepool {
-      if (progress.isCancelled) return;
-
-      dispatch_sync(dispatch_get_main_queue(), ^{
-        // Update the UI for every 1% of work completed.
-        completedUnits->fetch_add(1);
-        if ((((double)completedUnits->load() / subpaths.count) -
-             ((double)p.completedUnitCount / subpaths.count)) > 0.01) {
-          p.completedUnitCount = completedUnits->load();
-          [[clientListener remoteObjectProxy] updateCountsForEvent:event
-                                                       binaryCount:binaryCount->load()
-                                                         fileCount:i
-                                                       hashedCount:0];
-        }
-      });
+  // Dispatch a block for every file found.
+  [job apply:paths->size()
+       block:^(size_t i) {
+         @autoreleasepool {
+           completedUnits->fetch_add(1, std::memory_order_relaxed);
 
-      NSString* subpath = subpaths[i];
+           const std::string& path = paths->at(i).path;
+           if (!HasMachOMagic(path.c_str())) return;
 
-      NSString* file =
-          [event.fileBundlePath stringByAppendingPathComponent:subpath].stringByStandardizingPath;
-      SNTFileInfo* fi = [[SNTFileInfo alloc] initWithResolvedPath:file error:NULL];
-      if (!fi.isExecutable) return;
+           NSString* file =
+               [fm stringWithFileSystemRepresentation:path.c_str() length:path.length()]
+                   .stringByStandardizingPath;
+           SNTFileInfo* fi = [[SNTFileInfo alloc] initWithResolvedPath:file error:NULL];
+           if (!fi.isExecutable) return;
 
-      fis->at(i) = fi;
-      binaryCount->fetch_add(1);
-    }
-  });
+           fis->at(i) = fi;
+           binaryCount->fetch_add(1, std::memory_order_relaxed);
+         }
+       }];
 
+  [job stopReportingProgress];
   [progress resignCurrent];
 
   NSMutableArray* fileInfos = [NSMutableArray arrayWithCapacity:binaryCount->load()];
-  for (NSUInteger i = 0; i < subpaths.count; i++) {
-    if (fis->at(i)) [fileInfos addObject:fis->at(i)];
+  for (SNTFileInfo* fi : *fis) {
+    if (fi) [fileInfos addObject:fi];
+  }
+
+  // Binaries are read in full to be hashed. On a spinning disk, follow the order of their first
+  // extents.
+  if (medium == SNTStorageMediumRotational && fileInfos.count > 1) {
+    std::vector<std::pair<uint64_t, SNTFileInfo*>> byOffset;
+    byOffset.reserve(fileInfos.count);
+    for (SNTFileInfo* fi in fileInfos) {
+      byOffset.emplace_back(DeviceOffset(fi.path.fileSystemRepresentation), fi);
+    }
+    std::stable_sort(byOffset.begin(), byOffset.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    [fileInfos removeAllObjects];
+    for (const auto& [offset, fi] : byOffset) {
+      [fileInfos addObject:fi];
+    }
   }
 
+  if (job.isCancelled) return nil;
+  [self loadKnownSHA256sForBinaries:fileInfos];
+
   return [self generateEventsFromBinaries:fileInfos
                             blockingEvent:event
-                                 progress:progress
+                                      job:job
                            clientListener:clientListener];
 }
 
 - (NSDictionary*)generateEventsFromBinaries:(NSArray*)fis
                               blockingEvent:(SNTStoredExecutionEvent*)event
-                                   progress:(NSProgress*)progress
+                                        job:(SNTBundleHashJob*)job
                              clientListener:(MOLXPCConnection*)clientListener {
-  if (progress.isCancelled) return nil;
+  if (job.isCancelled) return nil;
 
-  NSMutableDictionary* relatedEvents = [NSMutableDictionary dictionaryWithCapacity:fis.count];
+  NSProgress* progress = job.progress;
+
+  // Every binary has a slot, like in -findRelatedBinaries:, so the workers don't need a lock.
+  __block auto events = std::make_shared<std::vector<SNTStoredExecutionEvent*>>(fis.count);
+  __block auto hashedCount = std::make_shared<std::atomic<int64_t>>(0);
 
   // Account for 15% of the work
   NSProgress* p;
   if (progress) {
     [progress becomeCurrentWithPendingUnitCount:15];
-    p = [NSProgress progressWithTotalUnitCount:fis.count * 100];
+    p = [NSProgress progressWithTotalUnitCount:fis.count];
+
+    [job startReportingProgress:^{
+      p.completedUnitCount = hashedCount->load(std::memory_order_relaxed);
+      [[clientListener remoteObjectProxy]
+          updateCountsForEvent:event
+                   binaryCount:fis.count
+                     fileCount:0
+                   hashedCount:hashedCount->load(std::memory_order_relaxed)];
+    }];
   }
 
-  dispatch_apply(fis.count, self.queue, ^(size_t i) {
-    @autoreleasepool {
-      if (progress.isCancelled) return;
-
-      SNTFileInfo* fi = fis[i];
-
-      SNTStoredExecutionEvent* se = [[SNTStoredExecutionEvent alloc] initWithFileInfo:fi];
-      se.decision = SNTEventStateBundleBinary;
-      se.fileBundlePath = event.fileBundlePath;
-      se.fileBundleExecutableRelPath = event.fileBundleExecutableRelPath;
-      se.fileBundleID = event.fileBundleID;
-      se.fileBundleName = event.fileBundleName;
-      se.fileBundleVersion = event.fileBundleVersion;
-      se.fileBundleVersionString = event.fileBundleVersionString;
-
-      dispatch_sync(dispatch_get_main_queue(), ^{
-        relatedEvents[se.fileSHA256] = se;
-        p.completedUnitCount++;
-        if (progress) {
-          [[clientListener remoteObjectProxy] updateCountsForEvent:event
-                                                       binaryCount:fis.count
-                                                         fileCount:0
-                                                       hashedCount:i];
-        }
-      });
-    }
-  });
-
+  [job apply:fis.count
+       block:^(size_t i) {
+         @autoreleasepool {
+           SNTFileInfo* fi = fis[i];
+
+           SNTStoredExecutionEvent* se = [self eventForFileInfo:fi scanKey:event.fileBundlePath];
+           se.decision = SNTEventStateBundleBinary;
+           se.fileBundlePath = event.fileBundlePath;
+           se.fileBundleExecutableRelPath = event.fileBundleExecutableRelPath;
+           se.fileBundleID = event.fileBundleID;
+           se.fileBundleName = event.fileBundleName;
+           se.fileBundleVersion = event.fileBundleVersion;
+           se.fileBundleVersionString = event.fileBundleVersionString;
+
+           events->at(i) = se;
+           hashedCount->fetch_add(1, std::memory_order_relaxed);
+         }
+       }];
+
+  [job stopReportingProgress];
   [progress resignCurrent];
 
+  if (job.isCancelled) return nil;
+
+  NSMutableDictionary* relatedEvents = [NSMutableDictionary dictionaryWithCapacity:fis.count];
+  for (SNTStoredExecutionEvent* se : *events) {
+    if (se.fileSHA256) relatedEvents[se.fileSHA256] = se;
+  }
+
+  [self.hashCache finishScanOfBundle:event.fileBundlePath];
+
   return relatedEvents;
 }
 
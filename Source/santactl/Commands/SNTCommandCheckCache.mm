@@ -45,7 +45,10 @@ REGISTER_COMMAND_NAME(@"checkcache")
 }
 
 + (NSString*)longHelpText {
-  return @"Prints the authorization status of a file in the cache.\n"
+  return @"Prints the authorization status of files in the cache.\n"
+         @"\n"
+         @"Usage: santactl checkcache path [path ...]\n"
+         @"  All paths are checked in a single request to the daemon.\n"
          @"\n"
          @"IMPORTANT: This command is intended for development purposes only.\n";
 }
@@ -55,24 +58,41 @@ REGISTER_COMMAND_NAME(@"checkcache")
 }
 
 - (void)runWithArguments:(NSArray*)arguments {
-  SantaVnode vnodeID = [self vnodeIDForFile:arguments.firstObject];
+  if (arguments.count == 0) {
+    [self printErrorUsageAndExit:@"At least one path is required"];
+  }
+
+  NSMutableData* vnodeIDs = [NSMutableData dataWithCapacity:arguments.count * sizeof(SantaVnode)];
+  for (NSString* path in arguments) {
+    SantaVnode vnodeID = [self vnodeIDForFile:path];
+    [vnodeIDs appendBytes:&vnodeID length:sizeof(vnodeID)];
+  }
+
   [[self.daemonConn synchronousRemoteObjectProxy]
-      checkCacheForVnodeID:vnodeID
-                 withReply:^(SNTAction action) {
-                   if (action == SNTActionRespondAllow) {
-                     TEE_LOGI(@"File exists in [allowlist] cache");
-                     exit(0);
-                   } else if (action == SNTActionRespondDeny) {
-                     TEE_LOGI(@"File exists in [blocklist] cache");
-                     exit(0);
-                   } else if (action == SNTActionRespondAllowCompiler) {
-                     TEE_LOGI(@"File exists in [allowlist compiler] cache");
-                     exit(0);
-                   } else if (action == SNTActionUnset) {
-                     TEE_LOGI(@"File does not exist in cache");
-                     exit(0);
-                   }
-                 }];
+      checkCacheForVnodeIDs:vnodeIDs
+                  withReply:^(NSArray<NSNumber*>* actions, NSArray<NSNumber*>* decisions) {
+                    for (NSUInteger i = 0; i < arguments.count && i < actions.count; i++) {
+                      NSString* prefix =
+                          arguments.count > 1 ? [NSString stringWithFormat:@"%@: ", arguments[i]]
+                                              : @"";
+                      NSString* decision =
+                          decisions[i].integerValue ? @" (decision cached)" : @"";
+                      TEE_LOGI(@"%@%@%@", prefix,
+                               [self descriptionForAction:(SNTAction)actions[i].integerValue],
+                               decision);
+                    }
+                    exit(0);
+                  }];
+}
+
+- (NSString*)descriptionForAction:(SNTAction)action {
+  switch (action) {
+    case SNTActionRespondAllow: return @"File exists in [allowlist] cache";
+    case SNTActionRespondDeny: return @"File exists in [blocklist] cache";
+    case SNTActionRespondAllowCompiler: return @"File exists in [allowlist compiler] cache";
+    case SNTActionUnset: return @"File does not exist in cache";
+    default: return @"File exists in cache, pending decision";
+  }
 }
 
 - (SantaVnode)vnodeIDForFile:(NSString*)path {
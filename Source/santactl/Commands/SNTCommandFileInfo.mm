@@ -79,6 +79,14 @@ static NSString* const kBundleHashes = @"Bundle Hashes";
 // Message displayed when daemon communication fails
 static NSString* const kCommunicationErrorMsg = @"Could not communicate with daemon";
 
+// Files inspected at the same time, per path argument. See -recurseAtPath: for why the default is
+// low, and why it is capped below the number of in-flight daemon messages that start being dropped.
+static const NSUInteger kDefaultJobs = 2;
+static const NSInteger kMaxJobs = 32;
+
+// How far the directory enumeration may run ahead of each job when searching recursively.
+static const NSUInteger kQueuedFilesPerJob = 64;
+
 // Used by longHelpText to display a list of valid keys passed in as an array.
 NSString* formattedStringForKeyArray(NSArray<NSString*>* array) {
   NSMutableString* result = [[NSMutableString alloc] init];
@@ -97,7 +105,9 @@ NSString* formattedStringForKeyArray(NSArray<NSString*>* array) {
 @property(nonatomic) BOOL enableEntitlements;
 @property(nonatomic) BOOL filterInclusive;
 @property(nonatomic) BOOL enableVerify;
+@property(nonatomic) BOOL noCache;
 @property(nonatomic) NSNumber* certIndex;
+@property(nonatomic) NSUInteger jobs;
 @property(nonatomic, copy) NSArray<NSString*>* outputKeyList;
 @property(nonatomic, copy) NSDictionary<NSString*, NSRegularExpression*>* outputFilters;
 
@@ -110,6 +120,12 @@ NSString* formattedStringForKeyArray(NSArray<NSString*>* array) {
 // Flag used to avoid multiple attempts to connect to daemon
 @property(nonatomic) BOOL daemonUnavailable;
 
+// Whether any of the requested keys can be served from the identity santad cached for the file
+@property(nonatomic) BOOL useCachedIdentities;
+
+// The identities santad had cached for the files being inspected, guarded by @synchronized
+@property(nonatomic) NSMapTable<SNTFileInfo*, SNTCachedDecision*>* cachedIdentities;
+
 // Common date formatter
 @property(nonatomic) NSISO8601DateFormatter* dateFormatter;
 
@@ -159,6 +175,9 @@ typedef id (^SNTAttributeBlock)(SNTCommandFileInfo*, SNTFileInfo*);
 @property(nonatomic) dispatch_queue_t printQueue;
 @property(nonatomic) dispatch_group_t printGroup;
 
+// The identity santad had cached for the file, if it was loaded.
+- (SNTCachedDecision*)cachedIdentityForFile:(SNTFileInfo*)fileInfo;
+
 @end
 
 @implementation SNTCommandFileInfo
@@ -189,6 +208,7 @@ REGISTER_COMMAND_NAME(@"fileinfo")
           @"Usage: santactl fileinfo [options] [file-paths]\n"
           @"    --recursive (-r): Search directories recursively.\n"
           @"                      Incompatible with --bundleinfo.\n"
+          @"    --jobs (-j): The number of files to inspect at the same time. Defaults to 2.\n"
           @"    --json: Output in JSON format.\n"
           @"    --key: Search and return this one piece of information.\n"
           @"           You may specify multiple keys by repeating this flag.\n"
@@ -218,6 +238,9 @@ REGISTER_COMMAND_NAME(@"fileinfo")
           @"    --bundleinfo: If the file is part of a bundle, will also display bundle\n"
           @"                  hash information and hashes of all bundle executables.\n"
           @"                  Incompatible with --recursive and --cert-index.\n"
+          @"    --no-cache: Always hash the file and check its code signature, instead of\n"
+          @"                using the values santad computed when the same version of the\n"
+          @"                file was last executed.\n"
           @"\n"
           @"Examples: santactl fileinfo --cert-index 1 --key SHA-256 --json /usr/bin/yes\n"
           @"          santactl fileinfo --key SHA-256 --json /usr/bin/yes\n"
@@ -301,8 +324,10 @@ REGISTER_COMMAND_NAME(@"fileinfo")
       kSigningTime : self.signingTime,
     };
 
+    _cachedIdentities = [NSMapTable weakToStrongObjectsMapTable];
     _printQueue =
         dispatch_queue_create("com.northpolesec.santactl.print_queue", DISPATCH_QUEUE_SERIAL);
+    _jobs = kDefaultJobs;
   }
   return self;
 }
@@ -480,35 +505,58 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
   });
 }
 
-- (SNTAttributeBlock)rule {
-  return ^id(SNTCommandFileInfo* cmd, SNTFileInfo* fileInfo) {
-    // If we previously were unable to connect, don't try again.
-    if (cmd.daemonUnavailable) return kCommunicationErrorMsg;
-    ResumeDaemonConnection(cmd);
-    dispatch_semaphore_t sema = dispatch_semaphore_create(0);
-
+// The identifiers to look up rules for the file with. They come from the identity santad cached
+// for the file when there is one, as those are what santad evaluated it with.
+static SNTRuleIdentifiers* LookupIdentifiers(SNTCommandFileInfo* cmd, SNTFileInfo* fileInfo,
+                                             SNTSigningStatus* signingStatus,
+                                             BOOL* platformBinary) {
+  struct RuleIdentifiers identifiers;
+  if (SNTCachedDecision* identity = [cmd cachedIdentityForFile:fileInfo]) {
+    *signingStatus = identity.signingStatus;
+    if (platformBinary) *platformBinary = identity.platformBinary;
+    identifiers = {
+        .cdhash = identity.cdhash,
+        .binarySHA256 = fileInfo.SHA256,
+        .signingID = identity.signingID,
+        .certificateSHA256 = identity.certSHA256,
+        .teamID = identity.teamID,
+    };
+  } else {
     NSError* err;
     MOLCodesignChecker* csc = [fileInfo codesignCheckerWithError:&err];
-    SNTSigningStatus signingStatus = SigningStatus(csc, err);
-
-    struct RuleIdentifiers identifiers = {
+    *signingStatus = SigningStatus(csc, err);
+    if (platformBinary) *platformBinary = csc.platformBinary;
+    identifiers = {
         .cdhash = csc.cdhash,
         .binarySHA256 = fileInfo.SHA256,
         .signingID = FormatSigningID(csc),
         .certificateSHA256 = err ? nil : csc.leafCertificate.SHA256,
         .teamID = csc.teamID,
     };
+  }
+
+  // If the binary is signed with a dev cert, see if a rule would've
+  // matched if it were prod signed.
+  return *signingStatus == SNTSigningStatusDevelopment
+             ? [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:identifiers]
+             : [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:identifiers
+                                                  andSigningStatus:*signingStatus];
+}
+
+- (SNTAttributeBlock)rule {
+  return ^id(SNTCommandFileInfo* cmd, SNTFileInfo* fileInfo) {
+    // If we previously were unable to connect, don't try again.
+    if (cmd.daemonUnavailable) return kCommunicationErrorMsg;
+    ResumeDaemonConnection(cmd);
+    dispatch_semaphore_t sema = dispatch_semaphore_create(0);
 
-    // If the binary is signed with a dev cert, see if a rule would've
-    // matched if it were prod signed.
+    SNTSigningStatus signingStatus;
+    BOOL platformBinary;
     SNTRuleIdentifiers* lookupIdentifiers =
-        signingStatus == SNTSigningStatusDevelopment
-            ? [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:identifiers]
-            : [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:identifiers
-                                                 andSigningStatus:signingStatus];
+        LookupIdentifiers(cmd, fileInfo, &signingStatus, &platformBinary);
 
     __block NSString* output =
-        csc.platformBinary
+        platformBinary
             ? (cmd.prettyOutput ? @"\033[32mPlatform Binary\033[0m" : @"Platform Binary")
             : @"None";
     id<SNTDaemonControlXPC> rop = [cmd.daemonConn remoteObjectProxy];
@@ -542,23 +590,9 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
     ResumeDaemonConnection(cmd);
     dispatch_semaphore_t sema = dispatch_semaphore_create(0);
 
-    NSError* err;
-    MOLCodesignChecker* csc = [fileInfo codesignCheckerWithError:&err];
-    SNTSigningStatus signingStatus = SigningStatus(csc, err);
-
-    struct RuleIdentifiers identifiers = {
-        .cdhash = csc.cdhash,
-        .binarySHA256 = fileInfo.SHA256,
-        .signingID = FormatSigningID(csc),
-        .certificateSHA256 = err ? nil : csc.leafCertificate.SHA256,
-        .teamID = csc.teamID,
-    };
-
+    SNTSigningStatus signingStatus;
     SNTRuleIdentifiers* lookupIdentifiers =
-        signingStatus == SNTSigningStatusDevelopment
-            ? [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:identifiers]
-            : [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:identifiers
-                                                 andSigningStatus:signingStatus];
+        LookupIdentifiers(cmd, fileInfo, &signingStatus, NULL);
 
     __block NSString* output;
     id<SNTDaemonControlXPC> rop = [cmd.daemonConn remoteObjectProxy];
@@ -649,6 +683,9 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
 
 - (SNTAttributeBlock)teamID {
   return ^id(SNTCommandFileInfo* cmd, SNTFileInfo* fileInfo) {
+    if (SNTCachedDecision* identity = [cmd cachedIdentityForFile:fileInfo]) {
+      return identity.teamID;
+    }
     MOLCodesignChecker* csc = [fileInfo codesignCheckerWithError:NULL];
     return csc.teamID;
   };
@@ -656,6 +693,9 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
 
 - (SNTAttributeBlock)signingID {
   return ^id(SNTCommandFileInfo* cmd, SNTFileInfo* fileInfo) {
+    if (SNTCachedDecision* identity = [cmd cachedIdentityForFile:fileInfo]) {
+      return identity.signingID;
+    }
     MOLCodesignChecker* csc = [fileInfo codesignCheckerWithError:NULL];
 
     return FormatSigningID(csc);
@@ -664,6 +704,9 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
 
 - (SNTAttributeBlock)cdhash {
   return ^id(SNTCommandFileInfo* cmd, SNTFileInfo* fileInfo) {
+    // santad only records the CDHash when the kernel enforces it.
+    SNTCachedDecision* identity = [cmd cachedIdentityForFile:fileInfo];
+    if (identity.cdhash) return identity.cdhash;
     MOLCodesignChecker* csc = [fileInfo codesignCheckerWithError:NULL];
     return csc.cdhash;
   };
@@ -705,6 +748,14 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
       self.outputKeyList = [[self class] fileInfoKeys];
     }
   }
+
+  if (!self.noCache && !self.certIndex) {
+    NSSet* identityKeys =
+        [NSSet setWithArray:@[ kSHA256, kTeamID, kSigningID, kCDHash, kRule, kDecision ]];
+    self.useCachedIdentities =
+        [identityKeys intersectsSet:[NSSet setWithArray:self.outputKeyList]] ||
+        [identityKeys intersectsSet:[NSSet setWithArray:self.outputFilters.allKeys]];
+  }
   // Figure out max field width from list of keys
   self.maxKeyWidth = 0;
   for (NSString* key in self.outputKeyList) {
@@ -764,13 +815,14 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
   NSOperationQueue* operationQueue = [[NSOperationQueue alloc] init];
   operationQueue.qualityOfService = NSQualityOfServiceUserInitiated;
 
-  // Limit the number of concurrent operations to 2. By default it is unlimited. Querying for the
-  // `Rule` results in an XPC message to the santa daemon. On an M1 Max we are
+  // Limit the number of concurrent operations to --jobs, 2 by default. Otherwise it is unlimited.
+  // Querying for the `Rule` results in an XPC message to the santa daemon. On an M1 Max we are
   // seeing issues with dropped XPC messages when there are 64 or more in-flight messages. The
   // number of in-flight requests to the santa daemon to will be capped to
   // `maxConcurrentOperationCount`.
   //
-  // Why 2? We are seeing diminishing wall-time improvements for anything over 2 Qs.
+  // Why 2? We are seeing diminishing wall-time improvements for anything over 2 Qs when querying
+  // the daemon. Keys that only read the file, e.g. SHA-256, scale further with --jobs.
   //
   // 1 Q
   // bazel run //Source/santactl -- fileinfo --recursive --key Path --key Rule /usr/libexec/
@@ -787,18 +839,32 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
   // 8 Qs
   // bazel run //Source/santactl -- fileinfo --recursive --key Path --key Rule /usr/libexec/
   // 1.25s user 1.26s system 75% cpu 3.304 total
-  operationQueue.maxConcurrentOperationCount = 2;
+  operationQueue.maxConcurrentOperationCount = self.jobs;
 
   if (isDir && self.recursive) {
+    // Only enumerate a little ahead of the workers, so a large tree isn't queued up in memory
+    // before its first files are printed.
+    dispatch_semaphore_t queueSlots = dispatch_semaphore_create(self.jobs * kQueuedFilesPerJob);
+
     NSDirectoryEnumerator* dirEnum = [fm enumeratorAtPath:path];
     NSString* file = [dirEnum nextObject];
     while (file) {
       @autoreleasepool {
         NSString* filepath = [path stringByAppendingPathComponent:file];
-        BOOL exists = [fm fileExistsAtPath:filepath isDirectory:&isDir];
-        if (!(exists && isDir)) {  // don't display anything for a directory path
+        // The enumerator has already read the type. Only symlinks need another look, as they're
+        // skipped if they point at a directory.
+        NSString* fileType = dirEnum.fileAttributes.fileType;
+        if ([fileType isEqualToString:NSFileTypeSymbolicLink]) {
+          BOOL exists = [fm fileExistsAtPath:filepath isDirectory:&isDir];
+          if (!exists) isDir = NO;
+        } else {
+          isDir = [fileType isEqualToString:NSFileTypeDirectory];
+        }
+        if (!isDir) {  // don't display anything for a directory path
+          dispatch_semaphore_wait(queueSlots, DISPATCH_TIME_FOREVER);
           [operationQueue addOperationWithBlock:^{
             [self printInfoForFile:filepath];
+            dispatch_semaphore_signal(queueSlots);
           }];
         }
         file = [dirEnum nextObject];
@@ -817,6 +883,39 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
   [operationQueue waitUntilAllOperationsAreFinished];
 }
 
+// Asks santad for the identity it computed when it last evaluated this version of the file, so the
+// file doesn't need to be hashed or have its code signature checked again.
+- (void)loadCachedIdentityForFile:(SNTFileInfo*)fileInfo {
+  if (!self.useCachedIdentities || self.daemonUnavailable || !fileInfo.fileHandle) return;
+
+  ResumeDaemonConnection(self);
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  __block SNTCachedDecision* identity;
+  id<SNTDaemonControlXPC> rop = [self.daemonConn remoteObjectProxy];
+  [rop cachedIdentityForFileHandle:fileInfo.fileHandle
+                             reply:^(SNTCachedDecision* cd) {
+                               identity = cd;
+                               dispatch_semaphore_signal(sema);
+                             }];
+
+  if (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC))) {
+    self.daemonUnavailable = YES;
+    return;
+  }
+  if (!identity) return;
+
+  if (identity.sha256) [fileInfo setPrecomputedSHA256:identity.sha256];
+  @synchronized(self.cachedIdentities) {
+    [self.cachedIdentities setObject:identity forKey:fileInfo];
+  }
+}
+
+- (SNTCachedDecision*)cachedIdentityForFile:(SNTFileInfo*)fileInfo {
+  @synchronized(self.cachedIdentities) {
+    return [self.cachedIdentities objectForKey:fileInfo];
+  }
+}
+
 - (BOOL)shouldOutputValueToDictionary:(NSMutableDictionary*)outputDict
                           valueForKey:(NSString* (^)(NSString* key))valueForKey {
   if (self.outputFilters.count == 0) return YES;
@@ -886,6 +985,8 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
       outputDict[key] = cert[key];
     }
   } else {
+    [self loadCachedIdentityForFile:fileInfo];
+
     // Check if we should skip over this item based on outputFilters. We do this before collecting
     // output info because there's a chance that we can bail out early if a filter doesn't match.
     // However we also don't want to recompute info, so we save any values that we plan to show.
@@ -1080,6 +1181,21 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
         [self printErrorUsageAndExit:@"\n--recursive is incompatible with --bundleinfo"];
       }
       self.recursive = YES;
+    } else if ([arg caseInsensitiveCompare:@"--jobs"] == NSOrderedSame ||
+               [arg caseInsensitiveCompare:@"-j"] == NSOrderedSame) {
+      i += 1;  // advance to next argument and grab the number of jobs
+      if (i >= nargs || [arguments[i] hasPrefix:@"--"]) {
+        [self printErrorUsageAndExit:@"\n--jobs requires an argument"];
+      }
+      NSInteger jobs = 0;
+      NSScanner* scanner = [NSScanner scannerWithString:arguments[i]];
+      if (![scanner scanInteger:&jobs] || !scanner.atEnd || jobs < 1 || jobs > kMaxJobs) {
+        [self printErrorUsageAndExit:
+                  [NSString stringWithFormat:@"\n\"%@\" is an invalid argument for --jobs, it "
+                                             @"must be between 1 and %ld\n",
+                                             arguments[i], (long)kMaxJobs]];
+      }
+      self.jobs = jobs;
     } else if ([arg caseInsensitiveCompare:@"--bundleinfo"] == NSOrderedSame ||
                [arg caseInsensitiveCompare:@"-b"] == NSOrderedSame) {
       if (self.recursive || self.certIndex) {
@@ -1091,6 +1207,8 @@ static void ResumeDaemonConnection(SNTCommandFileInfo* cmd) {
       self.enableEntitlements = YES;
     } else if ([arg caseInsensitiveCompare:@"--verify"] == NSOrderedSame) {
       self.enableVerify = YES;
+    } else if ([arg caseInsensitiveCompare:@"--no-cache"] == NSOrderedSame) {
+      self.noCache = YES;
     } else if ([arg caseInsensitiveCompare:@"--filter-inclusive"] == NSOrderedSame) {
       self.filterInclusive = YES;
     } else if ([arg caseInsensitiveCompare:@"--localtz"] == NSOrderedSame) {
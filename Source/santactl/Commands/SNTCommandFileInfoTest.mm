@@ -26,7 +26,9 @@ typedef id (^SNTAttributeBlock)(SNTCommandFileInfo*, SNTFileInfo*);
 @property(nonatomic) BOOL recursive;
 @property(nonatomic) BOOL jsonOutput;
 @property(nonatomic) BOOL filterInclusive;
+@property(nonatomic) BOOL noCache;
 @property(nonatomic) NSNumber* certIndex;
+@property(nonatomic) NSUInteger jobs;
 @property(nonatomic, copy) NSArray<NSString*>* outputKeyList;
 @property(nonatomic) NSDictionary<NSString*, SNTAttributeBlock>* propertyMap;
 + (NSArray*)fileInfoKeys;
@@ -77,6 +79,14 @@ typedef id (^SNTAttributeBlock)(SNTCommandFileInfo*, SNTFileInfo*);
   XCTAssertTrue([filePaths containsObject:@"/usr/bin/yes"]);
 }
 
+- (void)testParseArgumentsJobs {
+  XCTAssertEqual(self.cfi.jobs, 2);
+  NSArray* filePaths = [self.cfi parseArguments:@[ @"-r", @"--jobs", @"8", @"/usr/bin" ]];
+  XCTAssertEqual(self.cfi.jobs, 8);
+  XCTAssertTrue(self.cfi.recursive);
+  XCTAssertEqualObjects(filePaths, @[ @"/usr/bin" ]);
+}
+
 - (void)testParseArgumentsJSONFalse {
   NSArray* filePaths = [self.cfi parseArguments:@[ @"/usr/bin/yes" ]];
   XCTAssertFalse(self.cfi.jsonOutput);
@@ -258,4 +268,11 @@ typedef id (^SNTAttributeBlock)(SNTCommandFileInfo*, SNTFileInfo*);
   XCTAssertTrue([filePaths containsObject:@"/usr/bin/yes"]);
 }
 
+- (void)testParseArgumentsNoCache {
+  XCTAssertFalse(self.cfi.noCache);
+  NSArray* filePaths = [self.cfi parseArguments:@[ @"--no-cache", @"/usr/bin/yes" ]];
+  XCTAssertTrue(self.cfi.noCache);
+  XCTAssertEqualObjects(filePaths, @[ @"/usr/bin/yes" ]);
+}
+
 @end
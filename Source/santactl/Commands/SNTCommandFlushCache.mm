@@ -15,6 +15,10 @@
 
 #import <Foundation/Foundation.h>
 
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
 #import "Source/common/MOLXPCConnection.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTXPCControlInterface.h"
@@ -42,6 +46,11 @@ REGISTER_COMMAND_NAME(@"flushcache")
 
 + (NSString*)longHelpText {
   return @"Flushes the authorization caches.\n"
+         @"\n"
+         @"Usage: santactl flushcache [--volume path | path ...]\n"
+         @"  With no arguments all entries are flushed.\n"
+         @"  path: Flush only the entries for these files, in a single request.\n"
+         @"  --volume path: Flush only the entries for files on the volume containing path.\n"
          @"\n"
          @"IMPORTANT: This command is intended for development purposes only.\n";
 }
@@ -51,7 +60,37 @@ REGISTER_COMMAND_NAME(@"flushcache")
 }
 
 - (void)runWithArguments:(NSArray*)arguments {
-  [[self.daemonConn remoteObjectProxy] flushCache:^(BOOL success) {
+  id<SNTDaemonControlXPC> rop = [self.daemonConn remoteObjectProxy];
+  void (^removedReply)(uint64_t) = ^(uint64_t removed) {
+    TEE_LOGI(@"Flushed %llu cache entries", removed);
+    exit(0);
+  };
+
+  if ([arguments.firstObject isEqualToString:@"--volume"]) {
+    struct stat sb;
+    if (arguments.count != 2 || stat([arguments[1] fileSystemRepresentation], &sb) != 0) {
+      [self printErrorUsageAndExit:@"--volume requires an existing path"];
+    }
+    [rop flushCacheForDevice:sb.st_dev reply:removedReply];
+    return;
+  }
+
+  if (arguments.count > 0) {
+    NSMutableData* vnodeIDs = [NSMutableData dataWithCapacity:arguments.count * sizeof(SantaVnode)];
+    for (NSString* path in arguments) {
+      struct stat sb;
+      if (stat(path.fileSystemRepresentation, &sb) != 0) {
+        TEE_LOGE(@"Skipping %@: %s", path, strerror(errno));
+        continue;
+      }
+      SantaVnode vnodeID = SantaVnode::VnodeForFile(sb);
+      [vnodeIDs appendBytes:&vnodeID length:sizeof(vnodeID)];
+    }
+    [rop flushCacheForVnodeIDs:vnodeIDs reply:removedReply];
+    return;
+  }
+
+  [rop flushCache:^(BOOL success) {
     if (success) {
       TEE_LOGI(@"Cache flush requested");
       exit(0);
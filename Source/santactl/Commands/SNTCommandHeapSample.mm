@@ -0,0 +1,149 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#include <stdlib.h>
+
+#import "Source/common/MOLXPCConnection.h"
+#import "Source/common/SNTLogging.h"
+#import "Source/common/SNTXPCControlInterface.h"
+#import "Source/santactl/SNTCommand.h"
+#import "Source/santactl/SNTCommandController.h"
+
+// The number of classes printed in the summary.
+static const NSUInteger kSummaryClasses = 20;
+
+@interface SNTCommandHeapSample : SNTCommand <SNTCommandProtocol>
+@property NSString* outputPath;
+@property BOOL jsonOutput;
+@end
+
+@implementation SNTCommandHeapSample
+
+REGISTER_COMMAND_NAME(@"heapsample")
+
++ (BOOL)requiresRoot {
+  return YES;
+}
+
++ (BOOL)requiresDaemonConn {
+  return YES;
+}
+
++ (NSString*)shortHelpText {
+  return @"Summarize the memory used by santad.";
+}
+
++ (NSString*)longHelpText {
+  return @"Usage: santactl heapsample [options]\n"
+         @"  Options:\n"
+         @"    --json: Print the full sample as JSON.\n"
+         @"    --output {path}: Write the full sample as JSON to this path.\n"
+         @"\n"
+         @"Counts the blocks in use in each of santad's malloc zones by size, and the\n"
+         @"instances of each Objective-C class, along with santad's estimates of the memory\n"
+         @"held by each of its subsystems. Each zone is locked while it is counted, which\n"
+         @"can briefly delay santad, so at most one sample is taken per minute.\n";
+}
+
+- (void)runWithArguments:(NSArray*)arguments {
+  for (NSUInteger i = 0; i < arguments.count; ++i) {
+    NSString* arg = arguments[i];
+
+    if ([arg caseInsensitiveCompare:@"--json"] == NSOrderedSame) {
+      self.jsonOutput = YES;
+    } else if ([arg caseInsensitiveCompare:@"--output"] == NSOrderedSame) {
+      if (++i >= arguments.count) {
+        [self printErrorUsageAndExit:@"\n--output requires an argument"];
+      }
+      self.outputPath = arguments[i];
+    } else {
+      [self printErrorUsageAndExit:[@"Unknown argument: " stringByAppendingString:arg]];
+    }
+  }
+
+  __block NSDictionary* sample;
+  __block NSError* error;
+  [[self.daemonConn synchronousRemoteObjectProxy] heapSample:^(NSDictionary* s, NSError* e) {
+    sample = s;
+    error = e;
+  }];
+
+  if (!sample) {
+    TEE_LOGE(@"Failed to take a heap sample: %@",
+             error.localizedDescription ?: @"No response from santad");
+    exit(EXIT_FAILURE);
+  }
+
+  if (self.outputPath || self.jsonOutput) {
+    NSData* data = [NSJSONSerialization dataWithJSONObject:sample
+                                                   options:NSJSONWritingPrettyPrinted |
+                                                           NSJSONWritingSortedKeys
+                                                     error:&error];
+    if (!data) {
+      TEE_LOGE(@"Failed to serialize the heap sample: %@", error.localizedDescription);
+      exit(EXIT_FAILURE);
+    }
+
+    if (self.outputPath) {
+      if (![data writeToFile:self.outputPath options:NSDataWritingAtomic error:&error]) {
+        TEE_LOGE(@"Failed to write the heap sample to %@: %@", self.outputPath,
+                 error.localizedDescription);
+        exit(EXIT_FAILURE);
+      }
+      TEE_LOGI(@"Wrote the heap sample to %@", self.outputPath);
+    }
+    if (self.jsonOutput) {
+      printf("%s\n", [[[NSString alloc] initWithData:data
+                                            encoding:NSUTF8StringEncoding] UTF8String]);
+    }
+    exit(EXIT_SUCCESS);
+  }
+
+  [self printSummary:sample];
+  exit(EXIT_SUCCESS);
+}
+
+- (void)printSummary:(NSDictionary*)sample {
+  printf("%-32s | %.1f MB\n", "Footprint", [sample[@"footprint_bytes"] doubleValue] / 1e6);
+  printf("%-32s | %.3f ms\n", "Sample duration",
+         [sample[@"duration_ns"] doubleValue] / NSEC_PER_MSEC);
+
+  printf("\nSubsystems\n");
+  NSDictionary<NSString*, NSNumber*>* subsystems = sample[@"subsystems"];
+  NSArray<NSString*>* names =
+      [subsystems keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber* a, NSNumber* b) {
+        return [b compare:a];
+      }];
+  for (NSString* name in names) {
+    printf("  %-30s | %.1f KB\n", name.UTF8String, [subsystems[name] doubleValue] / 1e3);
+  }
+
+  printf("\nMalloc zones\n");
+  for (NSDictionary* zone in sample[@"zones"]) {
+    printf("  %-30s | %.1f KB in %llu blocks\n", [zone[@"name"] UTF8String],
+           [zone[@"bytes"] doubleValue] / 1e3, [zone[@"blocks"] unsignedLongLongValue]);
+  }
+
+  printf("\nClasses\n");
+  NSArray<NSDictionary*>* classes = sample[@"classes"];
+  for (NSUInteger i = 0; i < MIN(classes.count, kSummaryClasses); i++) {
+    printf("  %-30s | %.1f KB in %llu instances\n", [classes[i][@"name"] UTF8String],
+           [classes[i][@"bytes"] doubleValue] / 1e3,
+           [classes[i][@"instances"] unsignedLongLongValue]);
+  }
+}
+
+@end
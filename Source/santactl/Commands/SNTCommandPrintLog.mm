@@ -17,14 +17,19 @@
 #include <google/protobuf/json/json.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <zlib.h>
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <vector>
 
-#import "Source/common/NSData+Zlib.h"
 #include "Source/common/SNTLogging.h"
 #import "Source/common/SNTXxhash.h"
 #include "Source/common/ScopedFile.h"
@@ -37,22 +42,239 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "google/protobuf/any.pb.h"
+#include "google/protobuf/descriptor.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/message.h"
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd.h"
 
 using JsonPrintOptions = google::protobuf::json::PrintOptions;
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+using google::protobuf::io::FileInputStream;
+using google::protobuf::io::ZeroCopyInputStream;
 using google::protobuf::json::MessageToJsonString;
 using santa::ScopedFile;
 using santa::fsspool::binaryproto::LogBatch;
 namespace pbv1 = ::santa::pb::v1;
 
-// Semi-arbitrary max compressed file size that will be operated upon.
-// The current implementation decompresses in memory. This variable
-// is used to keep memory requirements semi-reasonable.
-static constexpr size_t kMaxCompressedSize = 1024 * 1024 * 250;
+// Size of the buffer holding decompressed data between reads.
+static constexpr size_t kDecompressedBufferSize = 256 * 1024;
+
+// Nested messages deeper than this aren't searched for paths.
+static constexpr int kMaxPathSearchDepth = 8;
+
+// Exposes a compressed file as a stream of decompressed data, one buffer at a
+// time, so files of any size can be read without holding them in memory.
+class DecompressingInputStream : public ZeroCopyInputStream {
+ public:
+  ~DecompressingInputStream() override = default;
+
+  bool Next(const void** data, int* size) override {
+    if (backed_up_ == 0) {
+      if (!status_.ok()) {
+        return false;
+      }
+
+      absl::StatusOr<size_t> filled = Fill(buffer_.data(), buffer_.size());
+      if (!filled.ok()) {
+        status_ = filled.status();
+        return false;
+      }
+      if (*filled == 0) {
+        return false;
+      }
+
+      buffer_used_ = *filled;
+      backed_up_ = buffer_used_;
+    }
+
+    *data = buffer_.data() + buffer_used_ - backed_up_;
+    *size = static_cast<int>(backed_up_);
+    byte_count_ += backed_up_;
+    backed_up_ = 0;
+    return true;
+  }
+
+  void BackUp(int count) override {
+    backed_up_ += count;
+    byte_count_ -= count;
+  }
+
+  bool Skip(int count) override {
+    const void* data;
+    int size;
+    while (count > 0) {
+      if (!Next(&data, &size)) {
+        return false;
+      }
+      if (size > count) {
+        BackUp(size - count);
+        return true;
+      }
+      count -= size;
+    }
+    return true;
+  }
+
+  int64_t ByteCount() const override { return byte_count_; }
+
+  // The first error hit while reading or decompressing, if any. Reaching the
+  // end of a truncated stream is an error.
+  const absl::Status& status() const { return status_; }
+
+ protected:
+  explicit DecompressingInputStream(int fd)
+      : file_input_(fd), buffer_(kDecompressedBufferSize) {}
+
+  // Decompress up to size bytes into buf, returning the number of bytes
+  // written, or 0 at the end of the stream.
+  virtual absl::StatusOr<size_t> Fill(uint8_t* buf, size_t size) = 0;
+
+  // Get the next chunk of compressed data. Returns false at the end of the
+  // file, setting status on read errors.
+  bool NextInput(const void** data, int* size, absl::Status* status) {
+    if (file_input_.Next(data, size)) {
+      return true;
+    }
+    if (file_input_.GetErrno() != 0) {
+      *status = absl::ErrnoToStatus(file_input_.GetErrno(), "Failed to read compressed file");
+    }
+    return false;
+  }
+
+ private:
+  FileInputStream file_input_;
+  std::vector<uint8_t> buffer_;
+  size_t buffer_used_ = 0;
+  size_t backed_up_ = 0;
+  int64_t byte_count_ = 0;
+  absl::Status status_;
+};
+
+class ZstdInputStream : public DecompressingInputStream {
+ public:
+  explicit ZstdInputStream(int fd) : DecompressingInputStream(fd), dstream_(ZSTD_createDStream()) {}
+
+  ~ZstdInputStream() override { ZSTD_freeDStream(dstream_); }
+
+ protected:
+  absl::StatusOr<size_t> Fill(uint8_t* buf, size_t size) override {
+    if (!dstream_) {
+      return absl::ResourceExhaustedError("Failed to create zstd stream");
+    }
+
+    ZSTD_outBuffer output = {buf, size, 0};
+    while (output.pos == 0) {
+      // A full output buffer may leave decompressed data inside the stream,
+      // which must be drained before more input is read.
+      if (input_.pos == input_.size && !flush_pending_) {
+        const void* data;
+        int data_size;
+        absl::Status status;
+        if (!NextInput(&data, &data_size, &status)) {
+          if (!status.ok()) {
+            return status;
+          }
+          if (!frame_complete_) {
+            return absl::DataLossError("Truncated zstd file");
+          }
+          return 0;
+        }
+        input_ = {data, static_cast<size_t>(data_size), 0};
+      }
+
+      size_t ret = ZSTD_decompressStream(dstream_, &output, &input_);
+      if (ZSTD_isError(ret)) {
+        return absl::InternalError(absl::StrFormat("Failed to decompress zstd file: %d: %s",
+                                                   ZSTD_getErrorCode(ret), ZSTD_getErrorName(ret)));
+      }
+      frame_complete_ = (ret == 0);
+      flush_pending_ = (output.pos == output.size);
+    }
+
+    return output.pos;
+  }
+
+ private:
+  ZSTD_DStream* dstream_;
+  ZSTD_inBuffer input_ = {nullptr, 0, 0};
+  bool frame_complete_ = false;
+  bool flush_pending_ = false;
+};
+
+class GzipInputStream : public DecompressingInputStream {
+ public:
+  explicit GzipInputStream(int fd) : DecompressingInputStream(fd) {
+    memset(&zstream_, 0, sizeof(zstream_));
+    // Add 16 to windowBits to only accept the gzip format
+    init_status_ = inflateInit2(&zstream_, MAX_WBITS + 16);
+  }
+
+  ~GzipInputStream() override {
+    if (init_status_ == Z_OK) {
+      inflateEnd(&zstream_);
+    }
+  }
+
+ protected:
+  absl::StatusOr<size_t> Fill(uint8_t* buf, size_t size) override {
+    if (init_status_ != Z_OK) {
+      return absl::InternalError(absl::StrFormat("Failed to initialize zlib: %d", init_status_));
+    }
+
+    zstream_.next_out = buf;
+    zstream_.avail_out = static_cast<uInt>(size);
+    while (zstream_.avail_out == size) {
+      if (zstream_.avail_in == 0 && !flush_pending_) {
+        const void* data;
+        int data_size;
+        absl::Status status;
+        if (!NextInput(&data, &data_size, &status)) {
+          if (!status.ok()) {
+            return status;
+          }
+          if (!stream_end_) {
+            return absl::DataLossError("Truncated gzip file");
+          }
+          return 0;
+        }
+        zstream_.next_in = (Bytef*)data;
+        zstream_.avail_in = static_cast<uInt>(data_size);
+      }
+
+      // A gzip file may hold several members back to back
+      if (stream_end_) {
+        if (zstream_.avail_in == 0) {
+          continue;
+        }
+        inflateReset(&zstream_);
+        stream_end_ = false;
+      }
+
+      int ret = inflate(&zstream_, Z_NO_FLUSH);
+      if (ret == Z_STREAM_END) {
+        stream_end_ = true;
+      } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        return absl::InternalError(absl::StrFormat("Failed to decompress gzip file: %d: %s", ret,
+                                                   zstream_.msg ? zstream_.msg : "unknown"));
+      }
+      flush_pending_ = !stream_end_ && zstream_.avail_out == 0;
+    }
+
+    return size - zstream_.avail_out;
+  }
+
+ private:
+  z_stream zstream_;
+  int init_status_;
+  bool stream_end_ = false;
+  bool flush_pending_ = false;
+};
 
 class MessageSource {
  public:
@@ -111,26 +333,38 @@ class AnyMessageSource : public MessageSource {
 class StreamMessageSource : public MessageSource {
  public:
   static std::unique_ptr<StreamMessageSource> Create(ScopedFile scoped_file) {
-    auto file_input =
-        std::make_unique<google::protobuf::io::FileInputStream>(scoped_file.UnsafeFD());
-    auto coded_input = std::make_unique<google::protobuf::io::CodedInputStream>(file_input.get());
+    auto input = std::make_unique<FileInputStream>(scoped_file.UnsafeFD());
+    return std::unique_ptr<StreamMessageSource>(
+        new StreamMessageSource(std::move(scoped_file), std::move(input), nullptr));
+  }
 
-    return std::unique_ptr<StreamMessageSource>(new StreamMessageSource(
-        std::move(scoped_file), std::move(file_input), std::move(coded_input)));
+  // Read records from a compressed file as it is decompressed.
+  template <typename T>
+  static std::unique_ptr<StreamMessageSource> CreateDecompressing(ScopedFile scoped_file) {
+    auto input = std::make_unique<T>(scoped_file.UnsafeFD());
+    DecompressingInputStream* decompressor = input.get();
+    return std::unique_ptr<StreamMessageSource>(
+        new StreamMessageSource(std::move(scoped_file), std::move(input), decompressor));
   }
 
-  StreamMessageSource(ScopedFile scoped_file,
-                      std::unique_ptr<google::protobuf::io::FileInputStream> file_input,
-                      std::unique_ptr<google::protobuf::io::CodedInputStream> coded_input)
+  StreamMessageSource(ScopedFile scoped_file, std::unique_ptr<ZeroCopyInputStream> input,
+                      DecompressingInputStream* decompressor)
       : MessageSource(std::move(scoped_file)),
-        file_input_(std::move(file_input)),
-        coded_input_(std::move(coded_input)) {}
+        input_(std::move(input)),
+        decompressor_(decompressor) {}
 
   absl::StatusOr<::pbv1::SantaMessage> Next() override {
+    // A CodedInputStream is created per record so that files whose contents
+    // are larger than its total bytes limit can still be read entirely.
+    google::protobuf::io::CodedInputStream coded_input(input_.get());
+
     // Check the magic value
     // Failing to read the first value indicates we're at the end of a file.
     uint32_t magic;
-    if (!coded_input_->ReadLittleEndian32(&magic)) {
+    if (!coded_input.ReadLittleEndian32(&magic)) {
+      if (absl::Status status = DecompressorStatus(); !status.ok()) {
+        return status;
+      }
       return absl::OutOfRangeError("No more data");
     }
     if (magic != ::fsspool::kStreamBatcherMagic) {
@@ -139,25 +373,25 @@ class StreamMessageSource : public MessageSource {
 
     // Check the hash
     uint64_t expected_hash;
-    if (!coded_input_->ReadRaw(&expected_hash, sizeof(expected_hash))) {
-      return absl::InternalError("Failed to parse hash data");
+    if (!coded_input.ReadRaw(&expected_hash, sizeof(expected_hash))) {
+      return ReadError("Failed to parse hash data");
     }
 
     // Read the length
     uint32_t message_length;
-    if (!coded_input_->ReadVarint32(&message_length)) {
-      return absl::InternalError("Failed to parse message length");
+    if (!coded_input.ReadVarint32(&message_length)) {
+      return ReadError("Failed to parse message length");
     }
 
     // Read the raw message data
-    std::vector<uint8_t> msg_buf(message_length);
-    if (!coded_input_->ReadRaw(msg_buf.data(), message_length)) {
-      return absl::InternalError("Failed to read message into buffer");
+    msg_buf_.resize(message_length);
+    if (!coded_input.ReadRaw(msg_buf_.data(), message_length)) {
+      return ReadError("Failed to read message into buffer");
     }
 
     if (expected_hash != 0) {
       santa::Xxhash64 xxhash;
-      xxhash.Update(msg_buf.data(), msg_buf.size());
+      xxhash.Update(msg_buf_.data(), msg_buf_.size());
       __block uint64_t got_hash;
       xxhash.Digest(^(const uint8_t* buf, size_t size) {
         got_hash = *(uint64_t*)buf;
@@ -169,7 +403,7 @@ class StreamMessageSource : public MessageSource {
     }
 
     ::pbv1::SantaMessage santa_msg;
-    if (!santa_msg.ParseFromArray(msg_buf.data(), (int)msg_buf.size())) {
+    if (!santa_msg.ParseFromArray(msg_buf_.data(), (int)msg_buf_.size())) {
       return absl::InternalError("Failed to parse message data");
     }
 
@@ -177,137 +411,261 @@ class StreamMessageSource : public MessageSource {
   }
 
  private:
-  std::unique_ptr<google::protobuf::io::FileInputStream> file_input_;
-  std::unique_ptr<google::protobuf::io::CodedInputStream> coded_input_;
+  absl::Status DecompressorStatus() const {
+    return decompressor_ ? decompressor_->status() : absl::OkStatus();
+  }
+
+  // Prefer reporting a decompression failure over the framing error it caused
+  absl::Status ReadError(const char* msg) const {
+    absl::Status status = DecompressorStatus();
+    return status.ok() ? absl::InternalError(msg) : status;
+  }
+
+  std::unique_ptr<ZeroCopyInputStream> input_;
+  // Aliases input_ when reading a compressed file, otherwise nullptr.
+  DecompressingInputStream* decompressor_;
+  // Reused across records to avoid an allocation per message.
+  std::vector<uint8_t> msg_buf_;
 };
 
-absl::Status CanProcessFile(const ScopedFile& scoped_file) {
-  struct stat sb;
-  if (fstat(scoped_file.UnsafeFD(), &sb) != 0) {
-    return absl::ErrnoToStatus(errno, "Unable to stat file");
+absl::StatusOr<std::unique_ptr<MessageSource>> MessageSource::Create(NSString* path) {
+  // Open the file
+  int fd = open(path.UTF8String, O_RDONLY);
+  if (fd < 0) {
+    return absl::InvalidArgumentError("Failed to open file");
   }
 
-  if (sb.st_size > kMaxCompressedSize) {
-    return absl::OutOfRangeError(absl::StrFormat(
-        "Compressed file too large. Please decompress first. (Max allowed compressed size: %zu",
-        kMaxCompressedSize));
+  // Ensure the file gets closed appropriately
+  ScopedFile scoped_file(fd);
+
+  // Read the first 4 bytes to check for the stream protobuf magic number
+  uint32_t magic_number = 0;
+  errno = 0;
+  ssize_t bytes_read = read(fd, &magic_number, sizeof(magic_number));
+
+  // Note: Allow "parsing" of empty files so it isn't treated as an error
+  if (bytes_read != 0 && bytes_read != sizeof(magic_number)) {
+    return absl::InvalidArgumentError("Failed to determine file type");
+  }
+
+  // Reset file position back to the beginning
+  if (lseek(fd, 0, SEEK_SET) != 0) {
+    return absl::InternalError("Failed to reset file position for reading");
   }
 
-  return absl::OkStatus();
+  // Determine which derived class to instantiate based on magic number
+  if (magic_number == ::fsspool::kStreamBatcherMagic) {
+    return StreamMessageSource::Create(std::move(scoped_file));
+  } else if (magic_number == 0xfd2fb528) {
+    return StreamMessageSource::CreateDecompressing<ZstdInputStream>(std::move(scoped_file));
+  } else if ((magic_number & 0xffff) == 0x8b1f) {
+    return StreamMessageSource::CreateDecompressing<GzipInputStream>(std::move(scoped_file));
+  } else if ((magic_number & 0xff) == 0x0a) {
+    return AnyMessageSource::Create(std::move(scoped_file));
+  } else {
+    return absl::InvalidArgumentError("Unsupported file type");
+  }
 }
 
-absl::StatusOr<std::unique_ptr<MessageSource>> CreateStreamSource(NSData* buffer) {
-  auto temp_file = santa::ScopedFile::CreateTemporary();
-  if (!temp_file.ok()) {
-    return temp_file.status();
+// Returns the set singular message field with the given name, or nullptr.
+static const Message* GetSubMessage(const Message& msg, const char* name) {
+  const FieldDescriptor* field = msg.GetDescriptor()->FindFieldByName(name);
+  if (!field || field->is_repeated() || field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+    return nullptr;
   }
 
-  NSFileHandle* temp_handle = temp_file->Writer();
-  NSError* err;
-  if (![temp_handle writeData:buffer error:&err]) {
-    return absl::InternalError(absl::StrFormat("Failed to write decompressed data to temp file: %s",
-                                               err.localizedDescription.UTF8String));
+  const Reflection* reflection = msg.GetReflection();
+  if (!reflection->HasField(msg, field)) {
+    return nullptr;
   }
+  return &reflection->GetMessage(msg, field);
+}
 
-  // Reset back to the beginning for reading
-  [temp_handle seekToFileOffset:0];
+static std::optional<int32_t> InstigatorPid(const Message& event) {
+  const Message* instigator = GetSubMessage(event, "instigator");
+  const Message* id = instigator ? GetSubMessage(*instigator, "id") : nullptr;
+  if (!id) {
+    return std::nullopt;
+  }
 
-  return StreamMessageSource::Create(std::move(*temp_file));
+  const FieldDescriptor* pid = id->GetDescriptor()->FindFieldByName("pid");
+  if (!pid || pid->cpp_type() != FieldDescriptor::CPPTYPE_INT32) {
+    return std::nullopt;
+  }
+  return id->GetReflection()->GetInt32(*id, pid);
 }
 
-absl::StatusOr<std::unique_ptr<MessageSource>> HandleGzipFileSource(ScopedFile scoped_file) {
-  if (absl::Status status = CanProcessFile(scoped_file); !status.ok()) {
-    return status;
+static bool IsPathField(const FieldDescriptor* field) {
+  if (field->type() != FieldDescriptor::TYPE_STRING) {
+    return false;
   }
+  std::string_view name = field->name();
+  return name == "path" || name.ends_with("_path");
+}
 
-  NSFileHandle* handle = scoped_file.Reader();
-  NSError* err;
-  NSData* compressed = [handle readDataToEndOfFileAndReturnError:&err];
-  if (err) {
-    return absl::InternalError(
-        absl::StrFormat("Failed to read compressed file: %s", err.localizedDescription.UTF8String));
+// Returns true if any path within the message, at any depth, starts with prefix.
+static bool HasPathWithPrefix(const Message& msg, const std::string& prefix, int depth) {
+  if (depth > kMaxPathSearchDepth) {
+    return false;
   }
 
-  NSData* decompressed = [compressed gzipDecompressed];
-  if (!decompressed) {
-    return absl::InternalError("Failed to decompress file");
+  const Reflection* reflection = msg.GetReflection();
+  std::vector<const FieldDescriptor*> fields;
+  reflection->ListFields(msg, &fields);
+
+  for (const FieldDescriptor* field : fields) {
+    if (IsPathField(field)) {
+      if (field->is_repeated()) {
+        for (int i = 0; i < reflection->FieldSize(msg, field); i++) {
+          if (reflection->GetRepeatedString(msg, field, i).starts_with(prefix)) {
+            return true;
+          }
+        }
+      } else if (reflection->GetString(msg, field).starts_with(prefix)) {
+        return true;
+      }
+    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      if (field->is_repeated()) {
+        for (int i = 0; i < reflection->FieldSize(msg, field); i++) {
+          if (HasPathWithPrefix(reflection->GetRepeatedMessage(msg, field, i), prefix,
+                                depth + 1)) {
+            return true;
+          }
+        }
+      } else if (HasPathWithPrefix(reflection->GetMessage(msg, field), prefix, depth + 1)) {
+        return true;
+      }
+    }
   }
 
-  return CreateStreamSource(decompressed);
+  return false;
 }
 
-absl::StatusOr<std::unique_ptr<MessageSource>> HandleZstdFileSource(ScopedFile scoped_file) {
-  if (absl::Status status = CanProcessFile(scoped_file); !status.ok()) {
-    return status;
+// Returns the SantaMessage event case for the name of a field in its `event`
+// oneof, e.g. "execution", or 0 if there is no such event type.
+static int EventCaseForName(NSString* name) {
+  const Descriptor* descriptor = ::pbv1::SantaMessage::descriptor();
+  const FieldDescriptor* field = descriptor->FindFieldByName(name.lowercaseString.UTF8String);
+  if (!field || field->containing_oneof() != descriptor->FindOneofByName("event")) {
+    return 0;
   }
+  return field->number();
+}
 
-  NSFileHandle* handle = scoped_file.Reader();
-  NSError* err;
-  NSData* compressed = [handle readDataToEndOfFileAndReturnError:&err];
-  if (err) {
-    return absl::InternalError(
-        absl::StrFormat("Failed to read compressed file: %s", err.localizedDescription.UTF8String));
-  }
+// Filters applied to each message before it is converted to JSON, which is by
+// far the most expensive part of printing a message.
+struct MessageFilter {
+  std::set<int> event_cases;
+  std::optional<int32_t> pid;
+  std::optional<std::string> path_prefix;
 
-  uint64_t max_size = ZSTD_decompressBound(compressed.bytes, compressed.length);
-  if (max_size == ZSTD_CONTENTSIZE_ERROR) {
-    return absl::OutOfRangeError("Failed to calculate decompressed size");
-  }
+  bool Matches(const ::pbv1::SantaMessage& msg) const {
+    if (!event_cases.empty() && !event_cases.contains(msg.event_case())) {
+      return false;
+    }
+    if (!pid.has_value() && !path_prefix.has_value()) {
+      return true;
+    }
 
-  NSMutableData* decompressed = [[NSMutableData alloc] initWithCapacity:max_size];
-  decompressed.length = max_size;
+    const FieldDescriptor* field =
+        ::pbv1::SantaMessage::descriptor()->FindFieldByNumber(msg.event_case());
+    if (!field) {
+      return false;
+    }
+    const Message& event = msg.GetReflection()->GetMessage(msg, field);
 
-  size_t bytes_decompressed =
-      ZSTD_decompress(decompressed.mutableBytes, max_size, compressed.bytes, compressed.length);
-  if (ZSTD_isError(bytes_decompressed)) {
-    return absl::InternalError(absl::StrFormat("Failed to decompress zstd file: %d: %s",
-                                               ZSTD_getErrorCode(bytes_decompressed),
-                                               ZSTD_getErrorName(bytes_decompressed)));
+    if (pid.has_value() && InstigatorPid(event) != pid) {
+      return false;
+    }
+    if (path_prefix.has_value() && !HasPathWithPrefix(event, *path_prefix, 0)) {
+      return false;
+    }
+    return true;
   }
+};
 
-  // Clamp the length now that we know the true size
-  decompressed.length = bytes_decompressed;
+struct DecodedMessage {
+  int64_t seconds;
+  int32_t nanos;
+  std::string json;
+};
 
-  return CreateStreamSource(decompressed);
-}
+struct DecodedFile {
+  bool opened = false;
+  std::vector<DecodedMessage> messages;
+  // Logged once the file's messages are printed so output stays in order.
+  std::vector<std::string> errors;
+};
 
-absl::StatusOr<std::unique_ptr<MessageSource>> MessageSource::Create(NSString* path) {
-  // Open the file
-  int fd = open(path.UTF8String, O_RDONLY);
-  if (fd < 0) {
-    return absl::InvalidArgumentError("Failed to open file");
+static DecodedFile DecodeFile(NSString* path, const MessageFilter& filter,
+                              const JsonPrintOptions& options) {
+  DecodedFile decoded;
+
+  auto source = MessageSource::Create(path);
+  if (!source.ok() || !*source) {
+    decoded.errors.push_back(absl::StrFormat(
+        "%s: %s", path.UTF8String,
+        source.ok() ? "Failed to parse log batch" : source.status().ToString()));
+    return decoded;
   }
+  decoded.opened = true;
+
+  while (true) {
+    auto message = (*source)->Next();
+    if (!message.ok()) {
+      // Check if we've reached the end of the source, or some other error
+      if (!absl::IsOutOfRange(message.status())) {
+        decoded.errors.push_back(absl::StrFormat("%s: Error reading message: %s", path.UTF8String,
+                                                 message.status().ToString()));
+      }
+      break;
+    }
 
-  // Ensure the file gets closed appropriately
-  ScopedFile scoped_file(fd);
+    if (!filter.Matches(*message)) {
+      continue;
+    }
 
-  // Read the first 4 bytes to check for the stream protobuf magic number
-  uint32_t magic_number = 0;
-  errno = 0;
-  ssize_t bytes_read = read(fd, &magic_number, sizeof(magic_number));
+    DecodedMessage decoded_message = {
+        .seconds = message->event_time().seconds(),
+        .nanos = message->event_time().nanos(),
+    };
+    if (!MessageToJsonString(*message, &decoded_message.json, options).ok()) {
+      decoded.errors.push_back(
+          absl::StrFormat("Unable to convert message to JSON in file: '%s'", path.UTF8String));
+      continue;
+    }
+    decoded.messages.push_back(std::move(decoded_message));
+  }
 
-  // Note: Allow "parsing" of empty files so it isn't treated as an error
-  if (bytes_read != 0 && bytes_read != sizeof(magic_number)) {
-    return absl::InvalidArgumentError("Failed to determine file type");
+  return decoded;
+}
+
+static void LogErrors(const DecodedFile& decoded) {
+  for (const std::string& error : decoded.errors) {
+    TEE_LOGE(@"%s", error.c_str());
   }
+}
 
-  // Reset file position back to the beginning
-  if (lseek(fd, 0, SEEK_SET) != 0) {
-    return absl::InternalError("Failed to reset file position for reading");
+// Directories, such as a spool directory, are expanded to the regular files
+// within them, sorted by path.
+static void AppendLogFiles(NSString* path, NSMutableArray<NSString*>* paths) {
+  NSFileManager* fm = [NSFileManager defaultManager];
+  BOOL isDir = NO;
+  if (![fm fileExistsAtPath:path isDirectory:&isDir] || !isDir) {
+    // Errors opening the path are reported when it is decoded
+    [paths addObject:path];
+    return;
   }
 
-  // Determine which derived class to instantiate based on magic number
-  if (magic_number == ::fsspool::kStreamBatcherMagic) {
-    return StreamMessageSource::Create(std::move(scoped_file));
-  } else if (magic_number == 0xfd2fb528) {
-    return HandleZstdFileSource(std::move(scoped_file));
-  } else if ((magic_number & 0xffff) == 0x8b1f) {
-    return HandleGzipFileSource(std::move(scoped_file));
-  } else if ((magic_number & 0xff) == 0x0a) {
-    return AnyMessageSource::Create(std::move(scoped_file));
-  } else {
-    return absl::InvalidArgumentError("Unsupported file type");
+  NSMutableArray<NSString*>* files = [NSMutableArray array];
+  NSDirectoryEnumerator* dirEnum = [fm enumeratorAtPath:path];
+  for (NSString* file in dirEnum) {
+    if ([dirEnum.fileAttributes.fileType isEqualToString:NSFileTypeRegular]) {
+      [files addObject:[path stringByAppendingPathComponent:file]];
+    }
   }
+  [files sortUsingSelector:@selector(compare:)];
+  [paths addObjectsFromArray:files];
 }
 
 @interface SNTCommandPrintLog : SNTCommand <SNTCommandProtocol>
@@ -331,8 +689,9 @@ REGISTER_COMMAND_NAME(@"printlog")
 
 + (NSString*)longHelpText {
   return @"Prints the contents of serialized Santa protobuf logs as JSON.\n"
-         @"Multiple paths can be provided. The output is a list of all the \n"
-         @"SantaMessage entries per-file. E.g.: \n"
+         @"Multiple paths can be provided. Directories, such as a spool\n"
+         @"directory, are expanded to the files within them. The output is a\n"
+         @"list of all the SantaMessage entries per-file. E.g.: \n"
          @"  [\n"
          @"    [\n"
          @"      ... file 1 contents ...\n"
@@ -340,7 +699,17 @@ REGISTER_COMMAND_NAME(@"printlog")
          @"    [\n"
          @"      ... file N contents ...\n"
          @"    ]\n"
-         @"  ]";
+         @"  ]\n"
+         @"\n"
+         @"Options:\n"
+         @"  --type {event}: Only print events of the given type, e.g.\n"
+         @"                  execution or file_access. May be repeated.\n"
+         @"  --pid {pid}: Only print events whose instigator has the given pid.\n"
+         @"  --path-prefix {prefix}: Only print events with a path starting\n"
+         @"                          with the given prefix.\n"
+         @"  --merge: Print a single list of the entries from all files,\n"
+         @"           sorted by event time. All matching entries are held in\n"
+         @"           memory, so consider filtering large spools.";
 }
 
 - (void)runWithArguments:(NSArray*)arguments {
@@ -350,12 +719,94 @@ REGISTER_COMMAND_NAME(@"printlog")
   options.preserve_proto_field_names = true;
   options.add_whitespace = true;
 
+  MessageFilter filter;
+  BOOL merge = NO;
+  NSMutableArray<NSString*>* paths = [NSMutableArray array];
+
+  // Parse arguments
+  for (NSUInteger i = 0; i < arguments.count; ++i) {
+    NSString* arg = arguments[i];
+
+    if ([arg isEqualToString:@"--type"]) {
+      if (++i >= arguments.count) {
+        [self printErrorUsageAndExit:@"--type requires an argument"];
+      }
+      int eventCase = EventCaseForName(arguments[i]);
+      if (eventCase == 0) {
+        [self printErrorUsageAndExit:[NSString stringWithFormat:@"Unknown event type: %@",
+                                                                arguments[i]]];
+      }
+      filter.event_cases.insert(eventCase);
+    } else if ([arg isEqualToString:@"--pid"]) {
+      if (++i >= arguments.count) {
+        [self printErrorUsageAndExit:@"--pid requires an argument"];
+      }
+      NSScanner* scanner = [NSScanner scannerWithString:arguments[i]];
+      int pid;
+      if (![scanner scanInt:&pid] || !scanner.isAtEnd) {
+        [self printErrorUsageAndExit:[@"Invalid pid: " stringByAppendingString:arguments[i]]];
+      }
+      filter.pid = pid;
+    } else if ([arg isEqualToString:@"--path-prefix"]) {
+      if (++i >= arguments.count) {
+        [self printErrorUsageAndExit:@"--path-prefix requires an argument"];
+      }
+      filter.path_prefix = std::string([arguments[i] UTF8String]);
+    } else if ([arg isEqualToString:@"--merge"]) {
+      merge = YES;
+    } else {
+      AppendLogFiles(arg, paths);
+    }
+  }
+
+  if (merge) {
+    [self printMergedPaths:paths filter:filter options:options];
+  } else {
+    [self printPaths:paths filter:filter options:options];
+  }
+
+  exit(EXIT_SUCCESS);
+}
+
+// Decode files in parallel, printing each as soon as it and all the files
+// before it are done. The number of decoded files waiting to be printed is
+// bounded so memory use doesn't grow with the number of files.
+- (void)printPaths:(NSArray<NSString*>*)paths
+            filter:(const MessageFilter&)filter
+           options:(const JsonPrintOptions&)options {
+  NSUInteger count = paths.count;
+  std::vector<DecodedFile> decoded(count);
+  DecodedFile* results = decoded.data();
+  const MessageFilter* filterPtr = &filter;
+  const JsonPrintOptions* optionsPtr = &options;
+
+  NSMutableArray<dispatch_semaphore_t>* done = [NSMutableArray arrayWithCapacity:count];
+  for (NSUInteger i = 0; i < count; i++) {
+    [done addObject:dispatch_semaphore_create(0)];
+  }
+
+  dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+  dispatch_semaphore_t window =
+      dispatch_semaphore_create([[NSProcessInfo processInfo] activeProcessorCount]);
+  dispatch_async(queue, ^{
+    for (NSUInteger i = 0; i < count; i++) {
+      dispatch_semaphore_wait(window, DISPATCH_TIME_FOREVER);
+      dispatch_async(queue, ^{
+        results[i] = DecodeFile(paths[i], *filterPtr, *optionsPtr);
+        dispatch_semaphore_signal(done[i]);
+      });
+    }
+  });
+
   bool printed_opening_brace = false;
 
-  for (NSString* path in arguments) {
-    auto source = MessageSource::Create(path);
-    if (!source.ok()) {
-      TEE_LOGE(@"%@: %s", path, source.status().ToString().c_str());
+  for (NSUInteger i = 0; i < count; i++) {
+    dispatch_semaphore_wait(done[i], DISPATCH_TIME_FOREVER);
+    DecodedFile file = std::move(results[i]);
+    dispatch_semaphore_signal(window);
+
+    if (!file.opened) {
+      LogErrors(file);
       continue;
     }
 
@@ -370,40 +821,58 @@ REGISTER_COMMAND_NAME(@"printlog")
     // Print the opening inner JSON array
     std::cout << "\n[\n";
 
-    bool first_message = true;
-    while (true) {
-      auto message = (*source)->Next();
-      if (!message.ok()) {
-        // Check if we've reached the end of the source, or some other error
-        if (!absl::IsOutOfRange(message.status())) {
-          TEE_LOGE(@"%@: Error reading message: %s", path, message.status().ToString().c_str());
-        }
-        break;
-      }
-
+    for (size_t j = 0; j < file.messages.size(); j++) {
       // Print the comma between records
-      if (first_message) {
-        first_message = false;
-      } else {
+      if (j > 0) {
         std::cout << ",\n";
       }
-
-      std::string json;
-      if (!MessageToJsonString(*message, &json, options).ok()) {
-        TEE_LOGE(@"Unable to convert message to JSON in file: '%@'\n", path);
-      }
-      std::cout << json;
+      std::cout << file.messages[j].json;
     }
 
     std::cout << "]" << std::flush;
+    LogErrors(file);
   }
 
   if (printed_opening_brace) {
     // Print the closing outer JSON array
     std::cout << "\n]\n";
   }
+}
 
-  exit(EXIT_SUCCESS);
+- (void)printMergedPaths:(NSArray<NSString*>*)paths
+                  filter:(const MessageFilter&)filter
+                 options:(const JsonPrintOptions&)options {
+  std::vector<DecodedFile> decoded(paths.count);
+  DecodedFile* results = decoded.data();
+  const MessageFilter* filterPtr = &filter;
+  const JsonPrintOptions* optionsPtr = &options;
+
+  dispatch_apply(paths.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t i) {
+    results[i] = DecodeFile(paths[i], *filterPtr, *optionsPtr);
+  });
+
+  std::vector<const DecodedMessage*> messages;
+  for (const DecodedFile& file : decoded) {
+    LogErrors(file);
+    for (const DecodedMessage& message : file.messages) {
+      messages.push_back(&message);
+    }
+  }
+
+  // Stable so that messages with the same time keep their order in the files
+  std::stable_sort(
+      messages.begin(), messages.end(), [](const DecodedMessage* lhs, const DecodedMessage* rhs) {
+        return std::tie(lhs->seconds, lhs->nanos) < std::tie(rhs->seconds, rhs->nanos);
+      });
+
+  std::cout << "[\n";
+  for (size_t i = 0; i < messages.size(); i++) {
+    if (i > 0) {
+      std::cout << ",\n";
+    }
+    std::cout << messages[i]->json;
+  }
+  std::cout << "\n]\n" << std::flush;
 }
 
 @end
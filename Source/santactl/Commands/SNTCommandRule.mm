@@ -538,49 +538,34 @@ REGISTER_COMMAND_NAME(@"rule")
 }
 
 - (void)exportExecutionRulesToJSONFile:(NSString*)jsonFilePath {
-  // Get the rules from the daemon and then write them to the file.
-  id<SNTDaemonControlXPC> rop = [self.daemonConn synchronousRemoteObjectProxy];
-  [rop retrieveAllExecutionRules:^(NSArray<SNTRule*>* rules, NSError* error) {
-    if (error) {
-      TEE_LOGE(@"Failed to get rules: %@\n", error.localizedDescription);
-      exit(1);
-    }
-
-    if (rules.count == 0) {
-      TEE_LOGI(@"No rules to export.");
-      exit(1);
-    }
-    // Convert Rules to an NSDictionary.
-    NSMutableArray* rulesAsDicts = [[NSMutableArray alloc] init];
-
-    for (SNTRule* rule in rules) {
-      // Omit transitive and remove rules as they're not relevant.
-      if (rule.state == SNTRuleStateAllowTransitive || rule.state == SNTRuleStateRemove) {
-        continue;
-      }
-
-      [rulesAsDicts addObject:[rule dictionaryRepresentation]];
-    }
-
-    NSOutputStream* outputStream = [[NSOutputStream alloc] initToFileAtPath:jsonFilePath append:NO];
-    [outputStream open];
+  // The daemon writes the rules straight to the file, so they never cross XPC as objects.
+  // File will look like the following JSON:
+  // {"rules": [{"policy": "ALLOWLIST", "identifier": hash, "rule_type: "BINARY"},}]}
+  if (![[NSFileManager defaultManager] createFileAtPath:jsonFilePath contents:nil attributes:nil]) {
+    TEE_LOGE(@"Failed to create %@", jsonFilePath);
+    exit(1);
+  }
+  NSFileHandle* fileHandle = [NSFileHandle fileHandleForWritingAtPath:jsonFilePath];
+  if (!fileHandle) {
+    TEE_LOGE(@"Failed to open %@", jsonFilePath);
+    exit(1);
+  }
 
-    // Write the rules to the file.
-    // File should look like the following JSON:
-    // {"rules": [{"policy": "ALLOWLIST", "identifier": hash, "rule_type: "BINARY"},}]}
-    NSData* jsonData = [NSJSONSerialization dataWithJSONObject:@{@"rules" : rulesAsDicts}
-                                                       options:NSJSONWritingPrettyPrinted
-                                                         error:&error];
-    // Print error
-    if (error) {
-      TEE_LOGE(@"Failed to jsonify rules: %@", error.localizedDescription);
-      exit(1);
-    }
-    // Write jsonData to the file
-    [outputStream write:static_cast<const uint8_t*>(jsonData.bytes) maxLength:jsonData.length];
-    [outputStream close];
-    exit(0);
-  }];
+  id<SNTDaemonControlXPC> rop = [self.daemonConn synchronousRemoteObjectProxy];
+  [rop exportExecutionRulesToFileHandle:fileHandle
+                                  reply:^(NSUInteger count, NSError* error) {
+                                    if (error) {
+                                      TEE_LOGE(@"Failed to export rules: %@\n",
+                                               error.localizedDescription);
+                                    } else if (count == 0) {
+                                      TEE_LOGI(@"No rules to export.");
+                                    } else {
+                                      exit(0);
+                                    }
+                                    [[NSFileManager defaultManager] removeItemAtPath:jsonFilePath
+                                                                               error:NULL];
+                                    exit(1);
+                                  }];
 }
 
 #ifdef DEBUG
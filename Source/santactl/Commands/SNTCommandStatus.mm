@@ -14,11 +14,13 @@
 /// limitations under the License.
 
 #import <Foundation/Foundation.h>
+#include <string.h>
 
 #import "Source/common/MOLXPCConnection.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTXPCControlInterface.h"
+#import "Source/common/SNTXPCFastPath.h"
 #include "Source/common/faa/WatchItems.h"
 #import "Source/santactl/SNTCommand.h"
 #import "Source/santactl/SNTCommandController.h"
@@ -119,12 +121,23 @@ REGISTER_COMMAND_NAME(@"status")
 
   SNTConfigurator* configurator = [SNTConfigurator configurator];
 
+  // The counters are fetched over the fast path when the daemon provides one, falling back to the
+  // NSXPC interface otherwise.
+  SNTXPCFastPathClient* fastPath = self.daemonFastPath;
+  xpc_object_t fastPathReply;
+
   // Cache status
   __block uint64_t rootCacheCount = -1, nonRootCacheCount = -1;
-  [rop cacheCounts:^(uint64_t rootCache, uint64_t nonRootCache) {
-    rootCacheCount = rootCache;
-    nonRootCacheCount = nonRootCache;
-  }];
+  if ((fastPathReply = [fastPath sendOperation:SNTXPCFastPathOperationCacheCounts request:nil])) {
+    rootCacheCount = xpc_dictionary_get_uint64(fastPathReply, kSNTXPCFastPathRootCacheCountKey);
+    nonRootCacheCount =
+        xpc_dictionary_get_uint64(fastPathReply, kSNTXPCFastPathNonRootCacheCountKey);
+  } else {
+    [rop cacheCounts:^(uint64_t rootCache, uint64_t nonRootCache) {
+      rootCacheCount = rootCache;
+      nonRootCacheCount = nonRootCache;
+    }];
+  }
 
   // Database counts
   __block struct RuleCounts ruleCounts = {
@@ -139,20 +152,39 @@ REGISTER_COMMAND_NAME(@"status")
       .networkFlow = -1,
       .signals = -1,
   };
-  [rop databaseRuleCounts:^(struct RuleCounts counts) {
-    ruleCounts = counts;
-  }];
+  size_t ruleCountsLength = 0;
+  const void* packedRuleCounts = nullptr;
+  if ((fastPathReply = [fastPath sendOperation:SNTXPCFastPathOperationRuleCounts request:nil])) {
+    packedRuleCounts =
+        xpc_dictionary_get_data(fastPathReply, kSNTXPCFastPathRuleCountsKey, &ruleCountsLength);
+  }
+  if (packedRuleCounts && ruleCountsLength == sizeof(ruleCounts)) {
+    memcpy(&ruleCounts, packedRuleCounts, sizeof(ruleCounts));
+  } else {
+    [rop databaseRuleCounts:^(struct RuleCounts counts) {
+      ruleCounts = counts;
+    }];
+  }
 
   __block int64_t eventCount = -1;
-  [rop databaseEventCount:^(int64_t count) {
-    eventCount = count;
-  }];
+  if ((fastPathReply = [fastPath sendOperation:SNTXPCFastPathOperationEventCount request:nil])) {
+    eventCount = xpc_dictionary_get_int64(fastPathReply, kSNTXPCFastPathCountKey);
+  } else {
+    [rop databaseEventCount:^(int64_t count) {
+      eventCount = count;
+    }];
+  }
 
   // Static rule count
   __block int64_t staticRuleCount = -1;
-  [rop staticRuleCount:^(int64_t count) {
-    staticRuleCount = count;
-  }];
+  if ((fastPathReply = [fastPath sendOperation:SNTXPCFastPathOperationStaticRuleCount
+                                       request:nil])) {
+    staticRuleCount = xpc_dictionary_get_int64(fastPathReply, kSNTXPCFastPathCountKey);
+  } else {
+    [rop staticRuleCount:^(int64_t count) {
+      staticRuleCount = count;
+    }];
+  }
 
   // Rules hash
   __block NSString* executionRulesHash;
@@ -0,0 +1,230 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#import "Source/common/MOLXPCConnection.h"
+#import "Source/common/SNTLogging.h"
+#import "Source/common/SNTXPCControlInterface.h"
+#import "Source/santactl/SNTCommand.h"
+#import "Source/santactl/SNTCommandController.h"
+
+static const NSInteger kDefaultDurationSecs = 300;
+static const NSInteger kMaxDurationSecs = 3600;
+
+@interface SNTCommandTrace : SNTCommand <SNTCommandProtocol>
+@property NSNumber* pid;
+@property NSString* pathPrefix;
+@property NSInteger sampleRate;
+@property NSInteger durationSecs;
+@property BOOL exportTraces;
+@property BOOL jsonOutput;
+@end
+
+@implementation SNTCommandTrace
+
+REGISTER_COMMAND_NAME(@"trace")
+
++ (BOOL)requiresRoot {
+  return YES;
+}
+
++ (BOOL)requiresDaemonConn {
+  return YES;
+}
+
++ (NSString*)shortHelpText {
+  return @"Time the stages of authorizing executions.";
+}
+
++ (NSString*)longHelpText {
+  return [NSString
+      stringWithFormat:
+          @"Usage: santactl trace [options]\n"
+          @"  One of:\n"
+          @"    --enable: Start tracing executions, replacing any tracing in progress.\n"
+          @"      --pid {pid}: Only trace executions by this pid.\n"
+          @"      --path {prefix}: Only trace executions of paths starting with this prefix.\n"
+          @"      --sample-rate {N}: Trace 1 in every N matching executions. Defaults to 1.\n"
+          @"      --duration {seconds}: Stop tracing after this many seconds, at most %ld.\n"
+          @"                            Defaults to %ld.\n"
+          @"      --export: Also write finished traces to the telemetry log.\n"
+          @"    --disable: Stop tracing.\n"
+          @"    --show: Print the traces finished since they were last shown.\n"
+          @"      --json: Print traces as JSON.\n"
+          @"\n"
+          @"Each trace records the time spent in each stage of the decision, e.g. waiting to\n"
+          @"be handled, reading the file, validating the code signature, hashing, looking up\n"
+          @"rules and evaluating CEL. Traced executions are also marked with signposts in the\n"
+          @"com.northpolesec.santa.daemon subsystem for use with Instruments.\n",
+          (long)kMaxDurationSecs, (long)kDefaultDurationSecs];
+}
+
+- (NSInteger)integerArgument:(NSArray*)arguments
+                     atIndex:(NSUInteger)i
+                     forFlag:(NSString*)flag
+                         min:(NSInteger)min
+                         max:(NSInteger)max {
+  if (i >= arguments.count || [arguments[i] hasPrefix:@"--"]) {
+    [self printErrorUsageAndExit:[NSString stringWithFormat:@"\n%@ requires an argument", flag]];
+  }
+  NSInteger value = 0;
+  NSScanner* scanner = [NSScanner scannerWithString:arguments[i]];
+  if (![scanner scanInteger:&value] || !scanner.atEnd || value < min || value > max) {
+    [self printErrorUsageAndExit:[NSString stringWithFormat:@"\n\"%@\" is an invalid argument "
+                                                            @"for %@, it must be between %ld "
+                                                            @"and %ld\n",
+                                                            arguments[i], flag, (long)min,
+                                                            (long)max]];
+  }
+  return value;
+}
+
+- (void)runWithArguments:(NSArray*)arguments {
+  if (!arguments.count) {
+    [self printErrorUsageAndExit:@"No arguments"];
+  }
+
+  enum class TraceOperation {
+    kUnknown,
+    kEnable,
+    kDisable,
+    kShow,
+  };
+
+  TraceOperation operation = TraceOperation::kUnknown;
+  self.sampleRate = 1;
+  self.durationSecs = kDefaultDurationSecs;
+
+  // Parse arguments
+  for (NSUInteger i = 0; i < arguments.count; ++i) {
+    NSString* arg = arguments[i];
+
+    if ([arg caseInsensitiveCompare:@"--enable"] == NSOrderedSame) {
+      operation = TraceOperation::kEnable;
+    } else if ([arg caseInsensitiveCompare:@"--disable"] == NSOrderedSame) {
+      operation = TraceOperation::kDisable;
+    } else if ([arg caseInsensitiveCompare:@"--show"] == NSOrderedSame) {
+      operation = TraceOperation::kShow;
+    } else if ([arg caseInsensitiveCompare:@"--pid"] == NSOrderedSame) {
+      self.pid = @([self integerArgument:arguments atIndex:++i forFlag:arg min:0 max:INT_MAX]);
+    } else if ([arg caseInsensitiveCompare:@"--path"] == NSOrderedSame) {
+      if (++i >= arguments.count) {
+        [self printErrorUsageAndExit:@"\n--path requires an argument"];
+      }
+      self.pathPrefix = arguments[i];
+    } else if ([arg caseInsensitiveCompare:@"--sample-rate"] == NSOrderedSame) {
+      self.sampleRate = [self integerArgument:arguments
+                                      atIndex:++i
+                                      forFlag:arg
+                                          min:1
+                                          max:UINT32_MAX];
+    } else if ([arg caseInsensitiveCompare:@"--duration"] == NSOrderedSame) {
+      self.durationSecs = [self integerArgument:arguments
+                                        atIndex:++i
+                                        forFlag:arg
+                                            min:1
+                                            max:kMaxDurationSecs];
+    } else if ([arg caseInsensitiveCompare:@"--export"] == NSOrderedSame) {
+      self.exportTraces = YES;
+    } else if ([arg caseInsensitiveCompare:@"--json"] == NSOrderedSame) {
+      self.jsonOutput = YES;
+    } else {
+      [self printErrorUsageAndExit:[@"Unknown argument: " stringByAppendingString:arg]];
+    }
+  }
+
+  id<SNTDaemonControlXPC> rop = [self.daemonConn synchronousRemoteObjectProxy];
+  switch (operation) {
+    case TraceOperation::kEnable: {
+      [rop enableExecTracingForPID:self.pid
+                        pathPrefix:self.pathPrefix
+                        sampleRate:static_cast<uint32_t>(self.sampleRate)
+                   durationSeconds:static_cast<uint32_t>(self.durationSecs)
+                      exportTraces:self.exportTraces
+                             reply:^{
+                               TEE_LOGI(@"Exec tracing enabled for %ld seconds",
+                                        (long)self.durationSecs);
+                             }];
+      exit(EXIT_SUCCESS);
+    }
+    case TraceOperation::kDisable: {
+      [rop disableExecTracing:^{
+        TEE_LOGI(@"Exec tracing disabled");
+      }];
+      exit(EXIT_SUCCESS);
+    }
+    case TraceOperation::kShow: {
+      [rop execTraces:^(NSArray<NSDictionary*>* traces, BOOL enabled) {
+        [self printTraces:traces enabled:enabled];
+      }];
+      exit(EXIT_SUCCESS);
+    }
+    default: [self printErrorUsageAndExit:@"No operation provided"];
+  }
+
+  exit(EXIT_FAILURE);
+}
+
+- (void)printTraces:(NSArray<NSDictionary*>*)traces enabled:(BOOL)enabled {
+  if (self.jsonOutput) {
+    NSISO8601DateFormatter* formatter = [[NSISO8601DateFormatter alloc] init];
+    NSMutableArray* jsonTraces = [NSMutableArray arrayWithCapacity:traces.count];
+    for (NSDictionary* trace in traces) {
+      NSMutableDictionary* jsonTrace = [trace mutableCopy];
+      if ([trace[@"start_time"] isKindOfClass:[NSDate class]]) {
+        jsonTrace[@"start_time"] = [formatter stringFromDate:trace[@"start_time"]];
+      }
+      [jsonTraces addObject:jsonTrace];
+    }
+
+    NSData* data = [NSJSONSerialization dataWithJSONObject:jsonTraces
+                                                   options:NSJSONWritingPrettyPrinted |
+                                                           NSJSONWritingSortedKeys
+                                                     error:nil];
+    printf("%s\n", [[[NSString alloc] initWithData:data
+                                          encoding:NSUTF8StringEncoding] UTF8String]);
+    return;
+  }
+
+  if (!traces.count) {
+    printf("No traces%s\n", enabled ? "" : ", and tracing is not enabled");
+    return;
+  }
+
+  for (NSDictionary* trace in traces) {
+    printf("[%llu] pid %d: %s\n", [trace[@"id"] unsignedLongLongValue], [trace[@"pid"] intValue],
+           [trace[@"path"] UTF8String]);
+    printf("  %-20s | %s\n", "Result",
+           [trace[@"result"] length] ? [trace[@"result"] UTF8String] : "none");
+    printf("  %-20s | %.3f ms\n", "Total", [trace[@"total_ns"] doubleValue] / NSEC_PER_MSEC);
+    printf("  %-20s | %llu\n", "Hash bytes read",
+           [trace[@"hash_bytes_read"] unsignedLongLongValue]);
+
+    NSDictionary<NSString*, NSNumber*>* stages = trace[@"stages"];
+    NSArray<NSString*>* names =
+        [stages keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber* a, NSNumber* b) {
+          return [b compare:a];
+        }];
+    for (NSString* name in names) {
+      printf("  %-20s | %.3f ms\n", name.UTF8String, [stages[name] doubleValue] / NSEC_PER_MSEC);
+    }
+  }
+}
+
+@end
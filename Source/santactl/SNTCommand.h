@@ -16,6 +16,7 @@
 #import <Foundation/Foundation.h>
 
 @class MOLXPCConnection;
+@class SNTXPCFastPathClient;
 
 @protocol SNTCommandProtocol <NSObject>
 
@@ -71,6 +72,10 @@
 
 @property(nonatomic, readonly) MOLXPCConnection* daemonConn;
 
+///  The libxpc fast path to santad, fetched over daemonConn on first use. Nil if there is no
+///  daemon connection or the daemon didn't provide an endpoint.
+@property(nonatomic, readonly) SNTXPCFastPathClient* daemonFastPath;
+
 ///  Designated initializer
 - (instancetype)initWithDaemonConnection:(MOLXPCConnection*)daemonConn;
 
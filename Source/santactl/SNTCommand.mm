@@ -15,9 +15,16 @@
 
 #import "Source/santactl/SNTCommand.h"
 
+#import "Source/common/MOLXPCConnection.h"
 #import "Source/common/SNTLogging.h"
+#import "Source/common/SNTXPCControlInterface.h"
+#import "Source/common/SNTXPCFastPath.h"
 
-@implementation SNTCommand
+@implementation SNTCommand {
+  BOOL _daemonFastPathFetched;
+}
+
+@synthesize daemonFastPath = _daemonFastPath;
 
 + (void)runWithArguments:(NSArray*)arguments daemonConnection:(MOLXPCConnection*)daemonConn {
   id cmd = [[self alloc] initWithDaemonConnection:daemonConn];
@@ -32,6 +39,20 @@
   return self;
 }
 
+- (SNTXPCFastPathClient*)daemonFastPath {
+  if (!_daemonFastPathFetched && self.daemonConn) {
+    _daemonFastPathFetched = YES;
+    __block xpc_endpoint_t endpoint;
+    [[self.daemonConn synchronousRemoteObjectProxy] fastPathEndpoint:^(xpc_endpoint_t e) {
+      endpoint = e;
+    }];
+    if (endpoint) {
+      _daemonFastPath = [[SNTXPCFastPathClient alloc] initWithEndpoint:endpoint];
+    }
+  }
+  return _daemonFastPath;
+}
+
 - (void)runWithArguments:(NSArray*)arguments {
   // This method must be overridden.
   [self doesNotRecognizeSelector:_cmd];
@@ -47,9 +47,16 @@ class AdminGroupMembership {
   // Returns true if `uid` is currently a member of the admin group.
   virtual bool IsMember(uid_t uid) = 0;
 
+  // Like IsMember, but for status queries that must not block on directory
+  // services: the answer may be cached, and stale until a background refresh
+  // catches up with a change. Never use it to decide whether to change
+  // membership. Defaults to IsMember.
+  virtual bool IsMemberCached(uid_t uid) { return IsMember(uid); }
+
   // Adds `uid` to the admin group and commits. A committed add is authoritative;
   // a post-commit verification mismatch (opendirectoryd cache latency) is logged,
-  // not failed. Returns true on a committed change; populates `error` on failure.
+  // not failed, so verification may finish after this returns. Returns true on
+  // a committed change; populates `error` on failure.
   // Failure to resolve the user identity itself (account no longer exists)
   // populates SNTErrorCodeTAMNoConsoleUser; every other failure, including
   // group resolution, uses SNTErrorCodeTAMMembershipChangeFailed. Restore
@@ -76,7 +83,9 @@ class AdminGroupMembership {
   virtual NSString* UsernameForUID(uid_t uid) = 0;
 };
 
-// Returns the in-process CoreServices-backed implementation.
+// Returns the in-process CoreServices-backed implementation. IsMemberCached
+// answers from an AdminMembershipCache, invalidated when opendirectoryd posts a
+// cache invalidation and after each membership change.
 std::unique_ptr<AdminGroupMembership> CreateAdminGroupMembership();
 
 }  // namespace santa
@@ -17,10 +17,12 @@
 #import <Collaboration/Collaboration.h>
 #import <CoreServices/CoreServices.h>
 
+#include <notify.h>
 #include <unistd.h>
 
 #import "Source/common/SNTError.h"
 #import "Source/common/SNTLogging.h"
+#include "Source/santad/AdminMembershipCache.h"
 
 namespace santa {
 
@@ -54,6 +56,13 @@ CBIdentity* UserIdentityForUID(uid_t uid) {
 // absorb opendirectoryd membership-cache latency before failing closed.
 static constexpr useconds_t kVerifyRetryDelayUSec = 200 * 1000;  // 200ms
 
+// opendirectoryd posts these when its caches are invalidated, including after
+// any change to group membership, whoever made it.
+static const char* const kDirectoryInvalidationNotifications[] = {
+    "com.apple.system.DirectoryService.InvalidateCache",
+    "com.apple.system.DirectoryService.InvalidateCache.group",
+};
+
 // Re-reads live membership and returns whether it matches `expected`. A failed
 // identity resolution counts as not matching.
 bool VerifyMembership(uid_t uid, bool expected) {
@@ -61,17 +70,46 @@ bool VerifyMembership(uid_t uid, bool expected) {
   return fresh && ([fresh isMemberOfGroup:AdminGroupIdentity()] == expected);
 }
 
+bool LiveIsMember(uid_t uid) {
+  CBIdentity* user = UserIdentityForUID(uid);
+  CBGroupIdentity* group = AdminGroupIdentity();
+  if (!user || !group) {
+    return false;
+  }
+  return [user isMemberOfGroup:group];
+}
+
 class AdminGroupMembershipImpl : public AdminGroupMembership {
  public:
-  bool IsMember(uid_t uid) override {
-    CBIdentity* user = UserIdentityForUID(uid);
-    CBGroupIdentity* group = AdminGroupIdentity();
-    if (!user || !group) {
-      return false;
+  AdminGroupMembershipImpl() : cache_(AdminMembershipCache::Create(LiveIsMember)) {
+    // The handlers hold the cache weakly, and are cancelled with this object.
+    std::weak_ptr<AdminMembershipCache> weak_cache = cache_;
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+    for (const char* name : kDirectoryInvalidationNotifications) {
+      int token;
+      uint32_t status = notify_register_dispatch(name, &token, queue, ^(int) {
+        if (std::shared_ptr<AdminMembershipCache> cache = weak_cache.lock()) {
+          cache->Invalidate();
+        }
+      });
+      if (status == NOTIFY_STATUS_OK) {
+        notify_tokens_.push_back(token);
+      } else {
+        LOGW(@"Unable to register for %s notifications: %u", name, status);
+      }
     }
-    return [user isMemberOfGroup:group];
   }
 
+  ~AdminGroupMembershipImpl() override {
+    for (int token : notify_tokens_) {
+      notify_cancel(token);
+    }
+  }
+
+  bool IsMember(uid_t uid) override { return LiveIsMember(uid); }
+
+  bool IsMemberCached(uid_t uid) override { return cache_->IsMember(uid); }
+
   bool AddMember(uid_t uid, NSError** error) override {
     return ChangeMembership(uid, /*add=*/true, error);
   }
@@ -152,6 +190,8 @@ class AdminGroupMembershipImpl : public AdminGroupMembership {
                        format:@"CSIdentityCommit failed: %@", bridged.localizedDescription];
       return false;
     }
+    // Don't wait for opendirectoryd's notification to refresh status queries.
+    cache_->Invalidate();
 
     // Re-read membership to verify the commit took effect. opendirectoryd caches
     // membership with a short TTL, so a single fresh read can lag the commit.
@@ -163,12 +203,17 @@ class AdminGroupMembershipImpl : public AdminGroupMembership {
     // which defeats the feature: a committed remove whose verification still shows
     // membership is retried once, and if it still shows membership it is reported as
     // a failure so the caller does not record a clean revocation.
+    //
+    // As a mismatch on add is only logged, it is verified in the background
+    // rather than keeping the caller waiting on a directory read.
     if (add) {
-      if (!VerifyMembership(uid, /*expected=*/true)) {
-        LOGW(@"Admin group add committed but verification read still shows "
-             @"non-member (uid=%u) — treating commit as authoritative",
-             uid);
-      }
+      dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        if (!VerifyMembership(uid, /*expected=*/true)) {
+          LOGW(@"Admin group add committed but verification read still shows "
+               @"non-member (uid=%u) — treating commit as authoritative",
+               uid);
+        }
+      });
       return true;
     }
 
@@ -187,6 +232,9 @@ class AdminGroupMembershipImpl : public AdminGroupMembership {
                             uid];
     return false;
   }
+
+  std::shared_ptr<AdminMembershipCache> cache_;
+  std::vector<int> notify_tokens_;
 };
 
 }  // namespace
@@ -0,0 +1,90 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_ADMINMEMBERSHIPCACHE_H
+#define SANTA_SANTAD_ADMINMEMBERSHIPCACHE_H
+
+#include <dispatch/dispatch.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "Source/common/PassKey.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace santa {
+
+// Caches admin group membership for status queries, e.g. whether the GUI
+// offers Temporary Admin Mode, so they don't block on directory services. On
+// directory-bound machines a membership lookup can take hundreds of
+// milliseconds.
+//
+// Only the first query for a uid waits for a lookup. After Invalidate, or once
+// an entry is older than the maximum age, the cached answer is still returned
+// while a fresh one is looked up on a background queue. Answers may therefore
+// be stale and must never be used to decide whether to change membership.
+class AdminMembershipCache : public std::enable_shared_from_this<AdminMembershipCache>,
+                             public PassKey<AdminMembershipCache> {
+ public:
+  using Lookup = std::function<bool(uid_t)>;
+
+  static constexpr absl::Duration kDefaultMaxAge = absl::Minutes(5);
+
+  static std::shared_ptr<AdminMembershipCache> Create(Lookup lookup,
+                                                      absl::Duration max_age = kDefaultMaxAge);
+
+  AdminMembershipCache(PassKey, Lookup lookup, absl::Duration max_age);
+
+  // Returns whether uid is a member of the admin group, as of the last lookup.
+  bool IsMember(uid_t uid);
+
+  // Marks every entry stale and refreshes them in the background. Called when
+  // the directory reports a change and after membership is changed.
+  void Invalidate();
+
+  // Waits for refreshes that have already been started. For tests.
+  void WaitForRefreshes();
+
+ private:
+  struct Entry {
+    bool is_member;
+    absl::Time fetched;
+    // The value of generation_ when the lookup started.
+    uint64_t generation;
+    bool refreshing;
+  };
+
+  bool IsStaleLocked(const Entry& entry) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void RefreshLocked(uid_t uid, Entry& entry) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void FinishRefresh(uid_t uid, uint64_t generation, bool is_member) ABSL_LOCKS_EXCLUDED(lock_);
+
+  Lookup lookup_;
+  absl::Duration max_age_;
+  dispatch_queue_t refresh_queue_;
+
+  absl::Mutex lock_;
+  absl::flat_hash_map<uid_t, Entry> entries_ ABSL_GUARDED_BY(lock_);
+  // Incremented by Invalidate, so lookups that started before it don't mark
+  // their entries fresh.
+  uint64_t generation_ ABSL_GUARDED_BY(lock_) = 0;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_ADMINMEMBERSHIPCACHE_H
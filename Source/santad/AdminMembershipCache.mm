@@ -0,0 +1,99 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/AdminMembershipCache.h"
+
+#include <utility>
+
+namespace santa {
+
+std::shared_ptr<AdminMembershipCache> AdminMembershipCache::Create(Lookup lookup,
+                                                                   absl::Duration max_age) {
+  return std::make_shared<AdminMembershipCache>(PassKey(), std::move(lookup), max_age);
+}
+
+AdminMembershipCache::AdminMembershipCache(PassKey, Lookup lookup, absl::Duration max_age)
+    : lookup_(std::move(lookup)),
+      max_age_(max_age),
+      refresh_queue_(dispatch_queue_create(
+          "com.northpolesec.santa.daemon.admin_membership_cache",
+          dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0))) {}
+
+bool AdminMembershipCache::IsMember(uid_t uid) {
+  uint64_t generation;
+  {
+    absl::MutexLock lock(lock_);
+    auto it = entries_.find(uid);
+    if (it != entries_.end()) {
+      if (IsStaleLocked(it->second)) {
+        RefreshLocked(uid, it->second);
+      }
+      return it->second.is_member;
+    }
+    generation = generation_;
+  }
+
+  // Nothing to answer with yet, so the first query for a uid has to wait.
+  bool is_member = lookup_(uid);
+
+  absl::MutexLock lock(lock_);
+  entries_.try_emplace(uid, Entry{is_member, absl::Now(), generation, false});
+  return is_member;
+}
+
+void AdminMembershipCache::Invalidate() {
+  absl::MutexLock lock(lock_);
+  generation_++;
+  for (auto& [uid, entry] : entries_) {
+    RefreshLocked(uid, entry);
+  }
+}
+
+void AdminMembershipCache::WaitForRefreshes() {
+  dispatch_sync(refresh_queue_, ^{
+                });
+}
+
+bool AdminMembershipCache::IsStaleLocked(const Entry& entry) {
+  return entry.generation != generation_ || absl::Now() - entry.fetched > max_age_;
+}
+
+void AdminMembershipCache::RefreshLocked(uid_t uid, Entry& entry) {
+  if (entry.refreshing) {
+    return;
+  }
+  entry.refreshing = true;
+
+  uint64_t generation = generation_;
+  std::weak_ptr<AdminMembershipCache> weak_self = weak_from_this();
+  dispatch_async(refresh_queue_, ^{
+    std::shared_ptr<AdminMembershipCache> self = weak_self.lock();
+    if (!self) {
+      return;
+    }
+    self->FinishRefresh(uid, generation, self->lookup_(uid));
+  });
+}
+
+void AdminMembershipCache::FinishRefresh(uid_t uid, uint64_t generation, bool is_member) {
+  absl::MutexLock lock(lock_);
+  Entry& entry = entries_[uid];
+  entry = Entry{is_member, absl::Now(), generation, false};
+  // The directory changed again during the lookup.
+  if (IsStaleLocked(entry)) {
+    RefreshLocked(uid, entry);
+  }
+}
+
+}  // namespace santa
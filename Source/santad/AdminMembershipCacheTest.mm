@@ -0,0 +1,110 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/AdminMembershipCache.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <atomic>
+#include <memory>
+
+#include "absl/time/time.h"
+
+using santa::AdminMembershipCache;
+
+@interface AdminMembershipCacheTest : XCTestCase
+@end
+
+@implementation AdminMembershipCacheTest {
+  std::shared_ptr<std::atomic<bool>> _isAdmin;
+  std::shared_ptr<std::atomic<int>> _lookups;
+}
+
+- (void)setUp {
+  _isAdmin = std::make_shared<std::atomic<bool>>(false);
+  _lookups = std::make_shared<std::atomic<int>>(0);
+}
+
+- (std::shared_ptr<AdminMembershipCache>)cacheWithMaxAge:(absl::Duration)maxAge {
+  auto isAdmin = _isAdmin;
+  auto lookups = _lookups;
+  return AdminMembershipCache::Create(
+      [isAdmin, lookups](uid_t uid) {
+        (*lookups)++;
+        return uid == 501 && isAdmin->load();
+      },
+      maxAge);
+}
+
+- (void)testAnswersAreCached {
+  auto cache = [self cacheWithMaxAge:absl::Hours(1)];
+  _isAdmin->store(true);
+
+  XCTAssertTrue(cache->IsMember(501));
+  XCTAssertFalse(cache->IsMember(502));
+  XCTAssertEqual(_lookups->load(), 2);
+
+  // Changes aren't seen until the cache is invalidated.
+  _isAdmin->store(false);
+  XCTAssertTrue(cache->IsMember(501));
+  cache->WaitForRefreshes();
+  XCTAssertEqual(_lookups->load(), 2);
+}
+
+- (void)testInvalidateRefreshesInBackground {
+  auto cache = [self cacheWithMaxAge:absl::Hours(1)];
+  _isAdmin->store(true);
+  XCTAssertTrue(cache->IsMember(501));
+
+  _isAdmin->store(false);
+  cache->Invalidate();
+  cache->WaitForRefreshes();
+  XCTAssertEqual(_lookups->load(), 2);
+  XCTAssertFalse(cache->IsMember(501));
+  cache->WaitForRefreshes();
+  XCTAssertEqual(_lookups->load(), 2);
+}
+
+- (void)testExpiredEntriesAreServedWhileRefreshing {
+  auto cache = [self cacheWithMaxAge:absl::ZeroDuration()];
+  _isAdmin->store(true);
+  XCTAssertTrue(cache->IsMember(501));
+
+  // The expired answer is returned without waiting for the lookup.
+  _isAdmin->store(false);
+  XCTAssertTrue(cache->IsMember(501));
+  cache->WaitForRefreshes();
+  XCTAssertEqual(_lookups->load(), 2);
+  XCTAssertFalse(cache->IsMember(501));
+}
+
+- (void)testInvalidateDuringRefreshRefreshesAgain {
+  auto cache = [self cacheWithMaxAge:absl::Hours(1)];
+  XCTAssertFalse(cache->IsMember(501));
+
+  // The second invalidation may land while the first refresh is looking up,
+  // in which case its answer must not be kept as fresh.
+  cache->Invalidate();
+  _isAdmin->store(true);
+  cache->Invalidate();
+
+  // A refresh that was overtaken schedules another one as it finishes.
+  for (int i = 0; i < 3; i++) {
+    cache->WaitForRefreshes();
+  }
+  XCTAssertTrue(cache->IsMember(501));
+}
+
+@end
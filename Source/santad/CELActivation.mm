@@ -37,23 +37,13 @@ std::vector<typename santa::cel::CELProtoTraits<IsV2>::AncestorT> Ancestors(
     const std::shared_ptr<santa::santad::process_tree::ProcessTree>& processTree,
     const santa::Message& esMsg);
 
-template <>
-std::vector<santa::cel::CELProtoTraits<true>::AncestorT> Ancestors<true>(
-    const std::shared_ptr<santa::santad::process_tree::ProcessTree>& processTree,
-    const santa::Message& esMsg) {
-  if (!processTree) return {};
-
-  using Traits = santa::cel::CELProtoTraits<true>;
-  using AncestorT = typename Traits::AncestorT;
-
-  auto pid = santa::santad::process_tree::PidFromAuditToken(esMsg->process->parent_audit_token);
-  auto proc = processTree->Get(pid);
-  if (!proc) {
-    return {};
-  }
+std::vector<santa::cel::CELProtoTraits<true>::AncestorT> ConvertAncestors(
+    const std::vector<std::shared_ptr<const santa::santad::process_tree::Process>>& slice) {
+  using AncestorT = santa::cel::CELProtoTraits<true>::AncestorT;
 
-  std::vector<santa::cel::CELProtoTraits<true>::AncestorT> ancestors;
-  for (const auto& p : processTree->RootSlice(*proc)) {
+  std::vector<AncestorT> ancestors;
+  ancestors.reserve(slice.size());
+  for (const auto& p : slice) {
     if (!p->program_) {
       continue;
     }
@@ -82,6 +72,26 @@ std::vector<santa::cel::CELProtoTraits<true>::AncestorT> Ancestors<true>(
   return ancestors;
 }
 
+template <>
+std::vector<santa::cel::CELProtoTraits<true>::AncestorT> Ancestors<true>(
+    const std::shared_ptr<santa::santad::process_tree::ProcessTree>& processTree,
+    const santa::Message& esMsg) {
+  if (!processTree) return {};
+
+  using Traits = santa::cel::CELProtoTraits<true>;
+  using AncestorT = typename Traits::AncestorT;
+
+  auto pid = santa::santad::process_tree::PidFromAuditToken(esMsg->process->parent_audit_token);
+  auto proc = processTree->Get(pid);
+  if (!proc) {
+    return {};
+  }
+
+  // Every process a shell execs has the same ancestors, so they are only
+  // converted once per parent process.
+  return *processTree->CachedFromRootSlice<std::vector<AncestorT>>(*proc, ConvertAncestors);
+}
+
 template <>
 std::vector<santa::cel::CELProtoTraits<false>::AncestorT> Ancestors<false>(
     const std::shared_ptr<santa::santad::process_tree::ProcessTree>& processTree,
@@ -145,32 +155,7 @@ ActivationCallbackBlock CreateCELActivationBlock(
         f->set_team_id(santa::NSStringToUTF8String(teamID));
       }
 
-      if constexpr (IsV2) {
-        if (entitlementsDict) {
-          auto* entitlements = f->mutable_entitlements();
-          [entitlementsDict
-              enumerateKeysAndObjectsUsingBlock:^(NSString* key, id value, BOOL* stop) {
-                NSError* err;
-                NSData* jsonData;
-                @try {
-                  jsonData = [NSJSONSerialization dataWithJSONObject:value
-                                                             options:NSJSONWritingFragmentsAllowed
-                                                               error:&err];
-                } @catch (NSException*) {
-                }
-                if (!jsonData) {
-                  // Skip entitlements that can't be serialized to JSON.
-                  return;
-                }
-                NSString* jsonStr = [[NSString alloc] initWithData:jsonData
-                                                          encoding:NSUTF8StringEncoding];
-                (*entitlements)[santa::NSStringToUTF8String(key)] =
-                    santa::NSStringToUTF8String(jsonStr);
-              }];
-        }
-      }
-
-      return std::make_unique<santa::cel::Activation<IsV2>>(
+      auto activation = std::make_unique<santa::cel::Activation<IsV2>>(
           std::move(f),
           ^std::vector<std::string>() {
             return esApi->ExecArgs(&esMsg->event.exec);
@@ -211,6 +196,39 @@ ActivationCallbackBlock CreateCELActivationBlock(
               return {};
             }
           });
+
+      if constexpr (IsV2) {
+        if (entitlementsDict) {
+          // Encoding every entitlement as JSON is costly, so it is only done
+          // once an expression that reads target.entitlements is evaluated.
+          activation->SetLazyEntitlements(^std::map<std::string, std::string>() {
+            __block std::map<std::string, std::string> entitlements;
+            [entitlementsDict
+                enumerateKeysAndObjectsUsingBlock:^(NSString* key, id value, BOOL* stop) {
+                  NSError* err;
+                  NSData* jsonData;
+                  @try {
+                    jsonData =
+                        [NSJSONSerialization dataWithJSONObject:value
+                                                        options:NSJSONWritingFragmentsAllowed
+                                                          error:&err];
+                  } @catch (NSException*) {
+                  }
+                  if (!jsonData) {
+                    // Skip entitlements that can't be serialized to JSON.
+                    return;
+                  }
+                  NSString* jsonStr = [[NSString alloc] initWithData:jsonData
+                                                            encoding:NSUTF8StringEncoding];
+                  entitlements[santa::NSStringToUTF8String(key)] =
+                      santa::NSStringToUTF8String(jsonStr);
+                }];
+            return entitlements;
+          });
+        }
+      }
+
+      return activation;
     };
 
     if (useV2) {
@@ -0,0 +1,101 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_CACHESNAPSHOT_H
+#define SANTA_SANTAD_CACHESNAPSHOT_H
+
+#import <Foundation/Foundation.h>
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#import "Source/common/SantaVnode.h"
+#include "Source/common/Timer.h"
+#include "Source/santad/EventProviders/AuthResultCache.h"
+
+@class SNTConfigurator;
+@class SNTDecisionCache;
+@class SNTRuleTable;
+
+namespace santa {
+
+// Persists allowed entries of the root volume AuthResultCache, along with
+// their cached decisions, so that a restarted daemon does not have to hash and
+// evaluate every binary again.
+//
+// The snapshot is a flat file: a fixed size header, an array of fixed size
+// records and a trailing blob of archived SNTCachedDecision objects. The
+// header carries a digest of the policy that produced the entries. A snapshot
+// whose digest does not match the current policy is discarded, as is every
+// record whose file no longer matches the recorded size, mtime and ctime.
+class CacheSnapshot : public Timer<CacheSnapshot> {
+ public:
+  static constexpr uint32_t kMinIntervalSecs = 60;
+  static constexpr uint32_t kMaxIntervalSecs = 24 * 60 * 60;
+  static constexpr size_t kMaxEntries = 10000;
+
+  // Returns the digest of the current policy, or nil if it can't be computed.
+  using PolicyDigestBlock = NSData* (^)(void);
+
+  // Looks up the current stat info for the given vnode.
+  using StatFunc = std::function<bool(SantaVnode, struct stat*)>;
+
+  static std::shared_ptr<CacheSnapshot> Create(NSString* path,
+                                               std::shared_ptr<AuthResultCache> auth_result_cache,
+                                               SNTDecisionCache* decision_cache,
+                                               PolicyDigestBlock policy_digest);
+
+  CacheSnapshot(NSString* path, std::shared_ptr<AuthResultCache> auth_result_cache,
+                SNTDecisionCache* decision_cache, PolicyDigestBlock policy_digest,
+                StatFunc stat_func);
+
+  CacheSnapshot(const CacheSnapshot&) = delete;
+  CacheSnapshot& operator=(const CacheSnapshot&) = delete;
+
+  // Writes the current cache contents. Returns the number of entries written,
+  // or -1 on failure.
+  int64_t Write();
+
+  // Validates the snapshot on disk and restores its entries into the caches.
+  // Records are revalidated concurrently, so the StatFunc must be safe to
+  // call from multiple threads. Returns the number of entries restored. Must
+  // be called before the Authorizer client is enabled so restored entries
+  // never race new decisions.
+  size_t Load();
+
+  // Timer<CacheSnapshot> callback.
+  bool OnTimer();
+
+  // Digest of the inputs that affect execution decisions: the execution rule
+  // set, the static rules, CEL fallback rules, path regexes, client mode and
+  // the Santa version.
+  static NSData* PolicyDigest(SNTConfigurator* configurator, SNTRuleTable* rule_table);
+
+  // Stats the vnode through the volfs path /.vol/<fsid>/<fileid>.
+  static bool StatVnode(SantaVnode vnode, struct stat* sb);
+
+ private:
+  NSString* path_;
+  std::shared_ptr<AuthResultCache> auth_result_cache_;
+  SNTDecisionCache* decision_cache_;
+  PolicyDigestBlock policy_digest_;
+  StatFunc stat_func_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_CACHESNAPSHOT_H
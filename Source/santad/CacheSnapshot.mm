@@ -0,0 +1,351 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/CacheSnapshot.h"
+
+#include <CommonCrypto/CommonDigest.h>
+#include <dispatch/dispatch.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <vector>
+
+#import "Source/common/SNTCELFallbackRule.h"
+#import "Source/common/SNTCachedDecision.h"
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTConfigurator.h"
+#import "Source/common/SNTLogging.h"
+#import "Source/common/SNTSystemInfo.h"
+#import "Source/santad/DataLayer/SNTRuleTable.h"
+#import "Source/santad/SNTDecisionCache.h"
+
+namespace {
+
+constexpr uint32_t kSnapshotMagic = 0x534E5453;  // 'SNTS'
+constexpr uint32_t kSnapshotVersion = 1;
+
+// Upper bound on the size of a snapshot that will be loaded. A full snapshot
+// of kMaxEntries decisions is well under this.
+constexpr off_t kMaxSnapshotBytes = 64 * 1024 * 1024;
+
+struct SnapshotHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint8_t policy_digest[CC_SHA256_DIGEST_LENGTH];
+  uint32_t record_count;
+  uint32_t reserved;
+};
+
+struct SnapshotRecord {
+  uint64_t fsid;
+  uint64_t fileid;
+  int64_t size;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  int64_t ctime_sec;
+  int64_t ctime_nsec;
+  uint32_t action;
+  uint32_t decision_len;
+  uint64_t decision_offset;
+};
+
+static_assert(sizeof(SnapshotHeader) == 48);
+static_assert(sizeof(SnapshotRecord) == 72);
+
+bool FileMatchesRecord(const struct stat& sb, const SnapshotRecord& rec) {
+  return static_cast<uint64_t>(sb.st_ino) == rec.fileid && sb.st_size == rec.size &&
+         sb.st_mtimespec.tv_sec == rec.mtime_sec && sb.st_mtimespec.tv_nsec == rec.mtime_nsec &&
+         sb.st_ctimespec.tv_sec == rec.ctime_sec && sb.st_ctimespec.tv_nsec == rec.ctime_nsec;
+}
+
+// Only decisions that are safe to reuse without a fresh evaluation are
+// persisted. Anything that requires user interaction or opted out of caching
+// must be evaluated again.
+bool ShouldPersistDecision(SNTCachedDecision* cd) {
+  return cd && (cd.decision & SNTEventStateAllow) && cd.cacheable && !cd.holdAndAsk &&
+         cd.sha256.length > 0;
+}
+
+}  // namespace
+
+namespace santa {
+
+std::shared_ptr<CacheSnapshot> CacheSnapshot::Create(
+    NSString* path, std::shared_ptr<AuthResultCache> auth_result_cache,
+    SNTDecisionCache* decision_cache, PolicyDigestBlock policy_digest) {
+  return std::make_shared<CacheSnapshot>(path, std::move(auth_result_cache), decision_cache,
+                                         policy_digest, &CacheSnapshot::StatVnode);
+}
+
+CacheSnapshot::CacheSnapshot(NSString* path, std::shared_ptr<AuthResultCache> auth_result_cache,
+                             SNTDecisionCache* decision_cache, PolicyDigestBlock policy_digest,
+                             StatFunc stat_func)
+    : Timer<CacheSnapshot>(kMinIntervalSecs, kMaxIntervalSecs, Timer::OnStart::kWaitOneCycle,
+                           "CacheSnapshotIntervalSec"),
+      path_(path),
+      auth_result_cache_(std::move(auth_result_cache)),
+      decision_cache_(decision_cache),
+      policy_digest_(policy_digest),
+      stat_func_(std::move(stat_func)) {}
+
+bool CacheSnapshot::OnTimer() {
+  Write();
+  return true;
+}
+
+bool CacheSnapshot::StatVnode(SantaVnode vnode, struct stat* sb) {
+  char path[64];
+  snprintf(path, sizeof(path), "/.vol/%lld/%llu", static_cast<long long>(vnode.fsid),
+           static_cast<unsigned long long>(vnode.fileid));
+  return stat(path, sb) == 0 && sb->st_dev == vnode.fsid;
+}
+
+NSData* CacheSnapshot::PolicyDigest(SNTConfigurator* configurator, SNTRuleTable* rule_table) {
+  NSString* rulesHash = [rule_table hashOfHashes].executionRulesHash;
+  if (!rulesHash) {
+    return nil;
+  }
+
+  CC_SHA256_CTX ctx;
+  CC_SHA256_Init(&ctx);
+
+  auto update = [&ctx](NSString* str) {
+    NSData* data = [(str ?: @"") dataUsingEncoding:NSUTF8StringEncoding];
+    uint64_t len = data.length;
+    CC_SHA256_Update(&ctx, &len, sizeof(len));
+    CC_SHA256_Update(&ctx, data.bytes, (CC_LONG)data.length);
+  };
+
+  update([SNTSystemInfo santaFullVersion]);
+  update(rulesHash);
+  update([@(configurator.clientMode) stringValue]);
+  update(configurator.allowedPathRegex.pattern);
+  update(configurator.blockedPathRegex.pattern);
+
+  NSArray* staticRules = configurator.staticRules;
+  if (staticRules && [NSJSONSerialization isValidJSONObject:staticRules]) {
+    NSData* json = [NSJSONSerialization dataWithJSONObject:staticRules
+                                                   options:NSJSONWritingSortedKeys
+                                                     error:nil];
+    update([[NSString alloc] initWithData:json encoding:NSUTF8StringEncoding]);
+  } else {
+    update(nil);
+  }
+
+  for (SNTCELFallbackRule* rule in configurator.celFallbackRules) {
+    update(rule.celExpr);
+  }
+
+  NSMutableData* digest = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256_Final(static_cast<unsigned char*>(digest.mutableBytes), &ctx);
+  return digest;
+}
+
+int64_t CacheSnapshot::Write() {
+  NSData* digest = policy_digest_();
+  if (digest.length != CC_SHA256_DIGEST_LENGTH) {
+    LOGW(@"Unable to compute policy digest, not writing cache snapshot");
+    return -1;
+  }
+
+  std::vector<SnapshotRecord> records;
+  NSMutableData* blobs = [NSMutableData data];
+
+  for (const auto& [vnode, action] : auth_result_cache_->RootAllowEntries()) {
+    if (records.size() >= kMaxEntries) {
+      break;
+    }
+
+    SNTCachedDecision* cd = [decision_cache_ cachedDecisionForVnode:vnode];
+    if (!ShouldPersistDecision(cd)) {
+      continue;
+    }
+
+    struct stat sb;
+    if (!stat_func_(vnode, &sb)) {
+      continue;
+    }
+
+    NSData* archived = [NSKeyedArchiver archivedDataWithRootObject:cd
+                                             requiringSecureCoding:YES
+                                                             error:nil];
+    if (!archived) {
+      continue;
+    }
+
+    records.push_back({
+        .fsid = static_cast<uint64_t>(vnode.fsid),
+        .fileid = static_cast<uint64_t>(vnode.fileid),
+        .size = sb.st_size,
+        .mtime_sec = sb.st_mtimespec.tv_sec,
+        .mtime_nsec = sb.st_mtimespec.tv_nsec,
+        .ctime_sec = sb.st_ctimespec.tv_sec,
+        .ctime_nsec = sb.st_ctimespec.tv_nsec,
+        .action = static_cast<uint32_t>(action),
+        .decision_len = static_cast<uint32_t>(archived.length),
+        .decision_offset = blobs.length,
+    });
+    [blobs appendData:archived];
+  }
+
+  SnapshotHeader header = {
+      .magic = kSnapshotMagic,
+      .version = kSnapshotVersion,
+      .record_count = static_cast<uint32_t>(records.size()),
+  };
+  memcpy(header.policy_digest, digest.bytes, CC_SHA256_DIGEST_LENGTH);
+
+  // Blob offsets are stored relative to the start of the blob region, which
+  // immediately follows the record array.
+  NSMutableData* out = [NSMutableData dataWithCapacity:sizeof(header) +
+                                                       records.size() * sizeof(SnapshotRecord) +
+                                                       blobs.length];
+  [out appendBytes:&header length:sizeof(header)];
+  [out appendBytes:records.data() length:records.size() * sizeof(SnapshotRecord)];
+  [out appendData:blobs];
+
+  // Write to a temporary file and rename so a crash mid-write never leaves a
+  // truncated snapshot in place.
+  NSString* tmpPath = [path_ stringByAppendingString:@".tmp"];
+  int fd = open(tmpPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    LOGW(@"Unable to create cache snapshot %@: %s", tmpPath, strerror(errno));
+    return -1;
+  }
+
+  bool ok = write(fd, out.bytes, out.length) == static_cast<ssize_t>(out.length) && fsync(fd) == 0;
+  close(fd);
+
+  if (!ok || rename(tmpPath.fileSystemRepresentation, path_.fileSystemRepresentation) != 0) {
+    LOGW(@"Unable to write cache snapshot %@: %s", path_, strerror(errno));
+    unlink(tmpPath.fileSystemRepresentation);
+    return -1;
+  }
+
+  LOGD(@"Wrote %zu entries to cache snapshot", records.size());
+  return static_cast<int64_t>(records.size());
+}
+
+size_t CacheSnapshot::Load() {
+  int fd = open(path_.fileSystemRepresentation, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (fd < 0) {
+    return 0;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode) || sb.st_uid != geteuid() ||
+      (sb.st_mode & (S_IWGRP | S_IWOTH)) || sb.st_size < (off_t)sizeof(SnapshotHeader) ||
+      sb.st_size > kMaxSnapshotBytes) {
+    LOGW(@"Ignoring invalid cache snapshot %@", path_);
+    close(fd);
+    return 0;
+  }
+
+  size_t file_size = static_cast<size_t>(sb.st_size);
+  void* map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return 0;
+  }
+
+  const uint8_t* base = static_cast<const uint8_t*>(map);
+  SnapshotHeader header;
+  memcpy(&header, base, sizeof(header));
+
+  NSData* digest = policy_digest_();
+  size_t records_end = sizeof(header) + (size_t)header.record_count * sizeof(SnapshotRecord);
+
+  if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion ||
+      header.record_count > kMaxEntries || records_end > file_size ||
+      digest.length != CC_SHA256_DIGEST_LENGTH ||
+      memcmp(header.policy_digest, digest.bytes, CC_SHA256_DIGEST_LENGTH) != 0) {
+    LOGI(@"Cache snapshot does not match the current policy, discarding");
+    munmap(map, file_size);
+    unlink(path_.fileSystemRepresentation);
+    return 0;
+  }
+
+  size_t blobs_len = file_size - records_end;
+
+  // Revalidating a record takes a stat and unarchiving its decision, which
+  // doesn't depend on any other record, so records are checked in parallel.
+  // Only inserting the survivors into the caches is serial.
+  std::vector<SNTCachedDecision*> decisions(header.record_count);
+  std::vector<SnapshotRecord> records(header.record_count);
+  memcpy(records.data(), base + sizeof(header), header.record_count * sizeof(SnapshotRecord));
+  auto* decisions_ptr = &decisions;
+  const SnapshotRecord* records_ptr = records.data();
+  const uint8_t* blobs = base + records_end;
+
+  dispatch_apply(header.record_count, DISPATCH_APPLY_AUTO, ^(size_t i) {
+    const SnapshotRecord& rec = records_ptr[i];
+    if (rec.decision_offset > blobs_len || rec.decision_len > blobs_len - rec.decision_offset) {
+      return;
+    }
+
+    SantaVnode vnode = {
+        .fsid = static_cast<dev_t>(rec.fsid),
+        .fileid = static_cast<ino_t>(rec.fileid),
+    };
+
+    struct stat file_sb;
+    if (!stat_func_(vnode, &file_sb) || !FileMatchesRecord(file_sb, rec)) {
+      return;
+    }
+
+    @autoreleasepool {
+      NSData* archived = [NSData dataWithBytesNoCopy:(void*)(blobs + rec.decision_offset)
+                                              length:rec.decision_len
+                                        freeWhenDone:NO];
+      SNTCachedDecision* cd = [NSKeyedUnarchiver unarchivedObjectOfClass:[SNTCachedDecision class]
+                                                                fromData:archived
+                                                                   error:nil];
+      if (!ShouldPersistDecision(cd)) {
+        return;
+      }
+      cd.vnodeId = vnode;
+      (*decisions_ptr)[i] = cd;
+    }
+  });
+
+  size_t restored = 0;
+  for (uint32_t i = 0; i < header.record_count; ++i) {
+    SNTCachedDecision* cd = decisions[i];
+    if (!cd) {
+      continue;
+    }
+    SantaVnode vnode = cd.vnodeId;
+
+    // Never replace state the daemon has already computed since startup.
+    if ([decision_cache_ cachedDecisionForVnode:vnode]) {
+      continue;
+    }
+    [decision_cache_ cacheDecision:cd];
+
+    if (auth_result_cache_->RestoreToCache(vnode, static_cast<SNTAction>(records[i].action))) {
+      ++restored;
+    } else {
+      [decision_cache_ forgetCachedDecisionForVnode:vnode];
+    }
+  }
+
+  munmap(map, file_size);
+
+  LOGI(@"Restored %zu of %u entries from cache snapshot", restored, header.record_count);
+  return restored;
+}
+
+}  // namespace santa
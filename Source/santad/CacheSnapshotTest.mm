@@ -0,0 +1,240 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/CacheSnapshot.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <memory>
+#include <utility>
+
+#import "Source/common/SNTCachedDecision.h"
+#import "Source/common/SNTCommonEnums.h"
+#include "Source/common/TestUtils.h"
+#include "Source/common/es/MockEndpointSecurityAPI.h"
+#include "Source/santad/EventProviders/AuthResultCache.h"
+#import "Source/santad/SNTDecisionCache.h"
+
+using santa::AuthResultCache;
+using santa::CacheSnapshot;
+
+static dev_t RootDevno() {
+  struct stat sb;
+  stat("/", &sb);
+  return sb.st_dev;
+}
+
+static es_file_t MakeRootFile(ino_t ino, struct stat* out_sb) {
+  struct stat sb = MakeStat(0);
+  sb.st_dev = RootDevno();
+  sb.st_ino = ino;
+  *out_sb = sb;
+  return MakeESFile("foo", sb);
+}
+
+static SNTCachedDecision* MakeDecision(SantaVnode vnode, SNTEventState state) {
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] initWithVnode:vnode];
+  cd.decision = state;
+  cd.sha256 = @"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+  return cd;
+}
+
+@interface CacheSnapshotTest : XCTestCase
+@property NSString* path;
+@property NSData* digest;
+@end
+
+@implementation CacheSnapshotTest {
+  std::map<ino_t, struct stat> _files;
+}
+
+- (void)setUp {
+  self.path = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"snapshot-%@",
+                                                                [NSUUID UUID].UUIDString]];
+  self.digest = [NSMutableData dataWithLength:32];
+  _files.clear();
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+}
+
+- (std::shared_ptr<CacheSnapshot>)snapshotWithCache:(std::shared_ptr<AuthResultCache>)cache {
+  __weak CacheSnapshotTest* weakSelf = self;
+  auto files = &_files;
+  return std::make_shared<CacheSnapshot>(
+      self.path, cache, [SNTDecisionCache sharedCache],
+      ^{
+        return weakSelf.digest;
+      },
+      [files](SantaVnode vnode, struct stat* sb) {
+        auto it = files->find(vnode.fileid);
+        if (it == files->end()) return false;
+        *sb = it->second;
+        return true;
+      });
+}
+
+- (void)testRoundTrip {
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+
+  struct stat allowSB, denySB, noDecisionSB;
+  es_file_t allowFile = MakeRootFile(9001, &allowSB);
+  es_file_t denyFile = MakeRootFile(9002, &denySB);
+  es_file_t noDecisionFile = MakeRootFile(9003, &noDecisionSB);
+  _files[9001] = allowSB;
+  _files[9002] = denySB;
+  _files[9003] = noDecisionSB;
+
+  SantaVnode allowVnode = SantaVnode::VnodeForFile(allowSB);
+  [dc cacheDecision:MakeDecision(allowVnode, SNTEventStateAllowBinary)];
+  cache->AddToCache(&allowFile, SNTActionRequestBinary);
+  cache->AddToCache(&allowFile, SNTActionRespondAllow);
+
+  [dc cacheDecision:MakeDecision(SantaVnode::VnodeForFile(denySB), SNTEventStateBlockBinary)];
+  cache->AddToCache(&denyFile, SNTActionRequestBinary);
+  cache->AddToCache(&denyFile, SNTActionRespondDeny);
+
+  cache->AddToCache(&noDecisionFile, SNTActionRequestBinary);
+  cache->AddToCache(&noDecisionFile, SNTActionRespondAllow);
+
+  // Only the allowed entry with a decision is persisted.
+  XCTAssertEqual([self snapshotWithCache:cache]->Write(), 1);
+
+  // Simulate a restart.
+  [dc forgetCachedDecisionForVnode:allowVnode];
+  std::shared_ptr<AuthResultCache> newCache = AuthResultCache::Create(esapi, nil);
+
+  XCTAssertEqual([self snapshotWithCache:newCache]->Load(), 1);
+  XCTAssertEqual(newCache->CheckCache(allowVnode).action, SNTActionRespondAllow);
+
+  SNTCachedDecision* restored = [dc cachedDecisionForVnode:allowVnode];
+  XCTAssertEqual(restored.decision, SNTEventStateAllowBinary);
+  XCTAssertEqual(restored.vnodeId.fileid, allowVnode.fileid);
+
+  [dc forgetCachedDecisionForVnode:allowVnode];
+}
+
+- (void)testModifiedFilesAreNotRestored {
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+
+  struct stat sb;
+  es_file_t file = MakeRootFile(9101, &sb);
+  _files[9101] = sb;
+  SantaVnode vnode = SantaVnode::VnodeForFile(sb);
+
+  [dc cacheDecision:MakeDecision(vnode, SNTEventStateAllowBinary)];
+  cache->AddToCache(&file, SNTActionRequestBinary);
+  cache->AddToCache(&file, SNTActionRespondAllow);
+  XCTAssertEqual([self snapshotWithCache:cache]->Write(), 1);
+  [dc forgetCachedDecisionForVnode:vnode];
+
+  // The file was modified while the daemon wasn't running.
+  _files[9101].st_mtimespec.tv_sec += 1;
+
+  std::shared_ptr<AuthResultCache> newCache = AuthResultCache::Create(esapi, nil);
+  XCTAssertEqual([self snapshotWithCache:newCache]->Load(), 0);
+  XCTAssertEqual(newCache->CheckCache(vnode).action, SNTActionUnset);
+  XCTAssertNil([dc cachedDecisionForVnode:vnode]);
+}
+
+- (void)testManyEntriesRestored {
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+
+  // Enough records to be revalidated across several threads, every third of
+  // which was modified while the daemon wasn't running.
+  const ino_t kFirstIno = 9200;
+  const ino_t kNumFiles = 300;
+  for (ino_t ino = kFirstIno; ino < kFirstIno + kNumFiles; ino++) {
+    struct stat sb;
+    es_file_t file = MakeRootFile(ino, &sb);
+    _files[ino] = sb;
+    [dc cacheDecision:MakeDecision(SantaVnode::VnodeForFile(sb), SNTEventStateAllowBinary)];
+    cache->AddToCache(&file, SNTActionRequestBinary);
+    cache->AddToCache(&file, SNTActionRespondAllow);
+  }
+  XCTAssertEqual([self snapshotWithCache:cache]->Write(), kNumFiles);
+
+  for (ino_t ino = kFirstIno; ino < kFirstIno + kNumFiles; ino++) {
+    [dc forgetCachedDecisionForVnode:SantaVnode::VnodeForFile(_files[ino])];
+    if (ino % 3 == 0) {
+      _files[ino].st_ctimespec.tv_sec += 1;
+    }
+  }
+
+  std::shared_ptr<AuthResultCache> newCache = AuthResultCache::Create(esapi, nil);
+  XCTAssertEqual([self snapshotWithCache:newCache]->Load(), kNumFiles - kNumFiles / 3);
+
+  for (ino_t ino = kFirstIno; ino < kFirstIno + kNumFiles; ino++) {
+    SantaVnode vnode = SantaVnode::VnodeForFile(_files[ino]);
+    SNTCachedDecision* cd = [dc cachedDecisionForVnode:vnode];
+    if (ino % 3 == 0) {
+      XCTAssertNil(cd);
+      XCTAssertEqual(newCache->CheckCache(vnode).action, SNTActionUnset);
+    } else {
+      XCTAssertEqual(cd.vnodeId.fileid, ino);
+      XCTAssertEqual(newCache->CheckCache(vnode).action, SNTActionRespondAllow);
+    }
+    [dc forgetCachedDecisionForVnode:vnode];
+  }
+}
+
+- (void)testPolicyChangeDiscardsSnapshot {
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+
+  struct stat sb;
+  es_file_t file = MakeRootFile(9201, &sb);
+  _files[9201] = sb;
+  SantaVnode vnode = SantaVnode::VnodeForFile(sb);
+
+  [dc cacheDecision:MakeDecision(vnode, SNTEventStateAllowBinary)];
+  cache->AddToCache(&file, SNTActionRequestBinary);
+  cache->AddToCache(&file, SNTActionRespondAllow);
+  XCTAssertEqual([self snapshotWithCache:cache]->Write(), 1);
+  [dc forgetCachedDecisionForVnode:vnode];
+
+  NSMutableData* newDigest = [NSMutableData dataWithLength:32];
+  ((uint8_t*)newDigest.mutableBytes)[0] = 1;
+  self.digest = newDigest;
+
+  std::shared_ptr<AuthResultCache> newCache = AuthResultCache::Create(esapi, nil);
+  XCTAssertEqual([self snapshotWithCache:newCache]->Load(), 0);
+  XCTAssertEqual(newCache->CheckCache(vnode).action, SNTActionUnset);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.path]);
+}
+
+- (void)testCorruptSnapshotIsIgnored {
+  NSData* garbage = [@"not a snapshot, just some bytes of garbage that are long enough"
+      dataUsingEncoding:NSUTF8StringEncoding];
+  [garbage writeToFile:self.path atomically:YES];
+  chmod(self.path.fileSystemRepresentation, 0600);
+
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+  XCTAssertEqual([self snapshotWithCache:cache]->Load(), 0);
+}
+
+@end
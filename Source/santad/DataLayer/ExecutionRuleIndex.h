@@ -0,0 +1,112 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_DATALAYER_EXECUTIONRULEINDEX_H
+#define SANTA_SANTAD_DATALAYER_EXECUTIONRULEINDEX_H
+
+#import <Foundation/Foundation.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTRuleIdentifiers.h"
+
+@class SNTRule;
+
+namespace santa {
+
+// An immutable in-memory copy of the execution_rules table, used to resolve
+// execution rules without going through SQLite. Static rules are compiled
+// into their own index the same way.
+//
+// The bulk of the rules live in a base set of per-type hash tables that is
+// built once from the database. Small incremental changes (e.g. new
+// transitive rules) are layered on top as an overlay so that they can be
+// applied without copying the base tables. The owner is expected to rebuild
+// the base from the database once the overlay grows past a few thousand
+// entries.
+//
+// Instances are never modified after construction and are safe to use from
+// any thread.
+class ExecutionRuleIndex {
+ public:
+  struct Tables;
+  struct Overlay;
+
+  class Builder {
+   public:
+    explicit Builder(size_t expected_rules);
+    ~Builder();
+
+    Builder(const Builder&) = delete;
+    Builder& operator=(const Builder&) = delete;
+
+    // Adds a rule as read from the database. Later rules with the same
+    // identifier and type replace earlier ones.
+    void Add(SNTRule* rule);
+
+    std::shared_ptr<const ExecutionRuleIndex> Build();
+
+   private:
+    std::unique_ptr<Tables> tables_;
+  };
+
+  ExecutionRuleIndex(std::shared_ptr<const Tables> tables,
+                     std::shared_ptr<const Overlay> overlay);
+  ~ExecutionRuleIndex();
+
+  ExecutionRuleIndex(const ExecutionRuleIndex&) = delete;
+  ExecutionRuleIndex& operator=(const ExecutionRuleIndex&) = delete;
+
+  // Returns a new index sharing this index's base tables with the given rules
+  // applied on top. Rules in the SNTRuleStateRemove state remove any existing
+  // rule with the same identifier and type.
+  std::shared_ptr<const ExecutionRuleIndex> WithChanges(NSArray<SNTRule*>* rules) const;
+
+  // Returns the highest priority rule matching the given identifiers, using
+  // the same precedence as the database query: CDHash > Binary > Signing ID >
+  // Certificate > Team ID. A new SNTRule is returned for every call so callers
+  // are free to modify it, except for static rules, which are returned as the
+  // instance that was added.
+  SNTRule* Lookup(const struct RuleIdentifiers& identifiers) const;
+
+  // Returns the rule with exactly this identifier and type, if any.
+  SNTRule* Find(NSString* identifier, SNTRuleType type) const;
+
+  // Returns true if the index holds a rule of the given type.
+  bool HasRulesOfType(SNTRuleType type) const;
+
+  // Number of rules in the index, including changes in the overlay. Counts
+  // are kept up to date as rules are added and changed, so these are cheap
+  // enough to answer status queries without going to the database.
+  int64_t Count() const;
+  int64_t CountOfType(SNTRuleType type) const;
+  int64_t CountInState(SNTRuleState state) const;
+
+  // Number of rules in the base tables.
+  size_t BaseSize() const;
+
+  // Number of changes layered on top of the base tables.
+  size_t OverlaySize() const;
+
+ private:
+  std::shared_ptr<const Tables> tables_;
+  std::shared_ptr<const Overlay> overlay_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_DATALAYER_EXECUTIONRULEINDEX_H
@@ -0,0 +1,359 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/DataLayer/ExecutionRuleIndex.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "Source/common/Digest.h"
+#import "Source/common/SNTRule.h"
+#include "Source/common/String.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace santa {
+
+namespace {
+
+constexpr size_t kNumRuleTypes = 5;
+
+// Rule states are small and dense, so they're counted in a fixed array. States
+// outside it aren't counted.
+constexpr size_t kNumCountedStates = 16;
+
+// Optional rule fields. Almost all synced rules have none of these set, so
+// they're kept out of line to keep the per-rule entry small. Static rules keep
+// the rule itself, as only it carries the static flag.
+struct Details {
+  NSString* custom_msg;
+  NSString* custom_url;
+  NSString* comment;
+  NSString* cel_expr;
+  NSString* seatbelt_policy;
+  SNTRule* static_rule;
+};
+
+struct Entry {
+  int32_t state;
+  int32_t timestamp;
+  int64_t rule_id;
+  std::shared_ptr<const Details> details;
+};
+
+Entry EntryForRule(SNTRule* rule) {
+  Entry entry{
+      .state = static_cast<int32_t>(rule.state),
+      .timestamp = static_cast<int32_t>(rule.timestamp),
+      .rule_id = rule.ruleId,
+  };
+  if (rule.customMsg || rule.customURL || rule.comment || rule.celExpr || rule.seatbeltPolicy ||
+      rule.staticRule) {
+    entry.details = std::make_shared<const Details>(Details{
+        .custom_msg = rule.customMsg,
+        .custom_url = rule.customURL,
+        .comment = rule.comment,
+        .cel_expr = rule.celExpr,
+        .seatbelt_policy = rule.seatbeltPolicy,
+        .static_rule = rule.staticRule ? rule : nil,
+    });
+  }
+  return entry;
+}
+
+SNTRule* RuleForEntry(NSString* identifier, SNTRuleType type, const Entry& entry) {
+  const Details* details = entry.details.get();
+  if (details && details->static_rule) {
+    return details->static_rule;
+  }
+  return [[SNTRule alloc] initWithIdentifier:identifier
+                                       state:static_cast<SNTRuleState>(entry.state)
+                                        type:type
+                                   customMsg:details ? details->custom_msg : nil
+                                   customURL:details ? details->custom_url : nil
+                                   timestamp:entry.timestamp
+                                     comment:details ? details->comment : nil
+                                     celExpr:details ? details->cel_expr : nil
+                              seatbeltPolicy:details ? details->seatbelt_policy : nil
+                                      ruleId:entry.rule_id
+                                       error:nil];
+}
+
+// Maps each rule type to a dense slot, or -1 for unknown types.
+int TypeSlot(SNTRuleType type) {
+  switch (type) {
+    case SNTRuleTypeCDHash: return 0;
+    case SNTRuleTypeBinary: return 1;
+    case SNTRuleTypeSigningID: return 2;
+    case SNTRuleTypeCertificate: return 3;
+    case SNTRuleTypeTeamID: return 4;
+    default: return -1;
+  }
+}
+
+template <typename Map, typename Key>
+std::optional<int32_t> InsertInto(Map& map, Key key, Entry entry) {
+  auto [it, inserted] = map.try_emplace(std::move(key), std::move(entry));
+  if (inserted) return std::nullopt;
+  int32_t previous = it->second.state;
+  it->second = std::move(entry);
+  return previous;
+}
+
+// Rule counts by type slot and by state.
+struct Counts {
+  std::array<int64_t, kNumRuleTypes> types = {};
+  std::array<int64_t, kNumCountedStates> states = {};
+
+  void Add(int slot, int32_t state, int64_t n) {
+    types[slot] += n;
+    if (state >= 0 && static_cast<size_t>(state) < kNumCountedStates) {
+      states[state] += n;
+    }
+  }
+};
+
+// Hash based identifiers are stored as binary digests to roughly halve their
+// size. Only lowercase hex of the exact expected length is converted, so that
+// matching stays an exact string comparison as it is in the database.
+template <size_t N>
+class HashTable {
+ public:
+  const Entry* Find(std::string_view identifier) const {
+    if (std::optional<Digest<N>> key = Digest<N>::FromHex(identifier)) {
+      auto it = canonical_.find(*key);
+      return it == canonical_.end() ? nullptr : &it->second;
+    }
+    auto it = other_.find(identifier);
+    return it == other_.end() ? nullptr : &it->second;
+  }
+
+  // Returns the state of the entry that was replaced, if any.
+  std::optional<int32_t> Insert(std::string_view identifier, Entry entry) {
+    if (std::optional<Digest<N>> key = Digest<N>::FromHex(identifier)) {
+      return InsertInto(canonical_, *key, std::move(entry));
+    }
+    return InsertInto(other_, std::string(identifier), std::move(entry));
+  }
+
+  void Reserve(size_t n) { canonical_.reserve(n); }
+
+  size_t size() const { return canonical_.size() + other_.size(); }
+
+ private:
+  absl::flat_hash_map<Digest<N>, Entry> canonical_;
+  absl::flat_hash_map<std::string, Entry> other_;
+};
+
+class StringTable {
+ public:
+  const Entry* Find(std::string_view identifier) const {
+    auto it = map_.find(identifier);
+    return it == map_.end() ? nullptr : &it->second;
+  }
+
+  std::optional<int32_t> Insert(std::string_view identifier, Entry entry) {
+    return InsertInto(map_, std::string(identifier), std::move(entry));
+  }
+
+  void Reserve(size_t n) { map_.reserve(n); }
+
+  size_t size() const { return map_.size(); }
+
+ private:
+  absl::flat_hash_map<std::string, Entry> map_;
+};
+
+}  // namespace
+
+struct ExecutionRuleIndex::Tables {
+  HashTable<CDHashDigest::kSize> cdhash;
+  HashTable<SHA256Digest::kSize> binary;
+  StringTable signing_id;
+  HashTable<SHA256Digest::kSize> certificate;
+  StringTable team_id;
+  Counts counts;
+
+  const Entry* Find(std::string_view identifier, int slot) const {
+    switch (slot) {
+      case 0: return cdhash.Find(identifier);
+      case 1: return binary.Find(identifier);
+      case 2: return signing_id.Find(identifier);
+      case 3: return certificate.Find(identifier);
+      case 4: return team_id.Find(identifier);
+      default: return nullptr;
+    }
+  }
+
+  void Insert(std::string_view identifier, int slot, Entry entry) {
+    int32_t state = entry.state;
+    std::optional<int32_t> previous;
+    switch (slot) {
+      case 0: previous = cdhash.Insert(identifier, std::move(entry)); break;
+      case 1: previous = binary.Insert(identifier, std::move(entry)); break;
+      case 2: previous = signing_id.Insert(identifier, std::move(entry)); break;
+      case 3: previous = certificate.Insert(identifier, std::move(entry)); break;
+      case 4: previous = team_id.Insert(identifier, std::move(entry)); break;
+      default: return;
+    }
+    if (previous) counts.Add(slot, *previous, -1);
+    counts.Add(slot, state, 1);
+  }
+
+  size_t size(int slot) const {
+    switch (slot) {
+      case 0: return cdhash.size();
+      case 1: return binary.size();
+      case 2: return signing_id.size();
+      case 3: return certificate.size();
+      case 4: return team_id.size();
+      default: return 0;
+    }
+  }
+
+  size_t size() const {
+    return cdhash.size() + binary.size() + signing_id.size() + certificate.size() + team_id.size();
+  }
+};
+
+// Changes made since the base tables were built, indexed by type slot. An
+// empty optional records a removed rule. The counts are the net change they
+// make to the base tables' counts.
+struct ExecutionRuleIndex::Overlay {
+  std::array<absl::flat_hash_map<std::string, std::optional<Entry>>, kNumRuleTypes> changes;
+  Counts counts;
+
+  size_t size() const {
+    size_t n = 0;
+    for (const auto& m : changes) {
+      n += m.size();
+    }
+    return n;
+  }
+};
+
+ExecutionRuleIndex::Builder::Builder(size_t expected_rules)
+    : tables_(std::make_unique<Tables>()) {
+  // Nearly all large rule sets are dominated by binary rules.
+  tables_->binary.Reserve(expected_rules);
+}
+
+ExecutionRuleIndex::Builder::~Builder() = default;
+
+void ExecutionRuleIndex::Builder::Add(SNTRule* rule) {
+  if (!rule || rule.identifier.length == 0) return;
+  tables_->Insert(NSStringToUTF8StringView(rule.identifier), TypeSlot(rule.type),
+                  EntryForRule(rule));
+}
+
+std::shared_ptr<const ExecutionRuleIndex> ExecutionRuleIndex::Builder::Build() {
+  auto index = std::make_shared<const ExecutionRuleIndex>(std::move(tables_), nullptr);
+  tables_ = std::make_unique<Tables>();
+  return index;
+}
+
+ExecutionRuleIndex::ExecutionRuleIndex(std::shared_ptr<const Tables> tables,
+                                       std::shared_ptr<const Overlay> overlay)
+    : tables_(std::move(tables)), overlay_(std::move(overlay)) {}
+
+ExecutionRuleIndex::~ExecutionRuleIndex() = default;
+
+std::shared_ptr<const ExecutionRuleIndex> ExecutionRuleIndex::WithChanges(
+    NSArray<SNTRule*>* rules) const {
+  auto overlay = overlay_ ? std::make_shared<Overlay>(*overlay_) : std::make_shared<Overlay>();
+  for (SNTRule* rule in rules) {
+    int slot = TypeSlot(rule.type);
+    if (slot < 0 || rule.identifier.length == 0) continue;
+
+    std::string_view key = NSStringToUTF8StringView(rule.identifier);
+    auto& changes = overlay->changes[slot];
+    auto it = changes.find(key);
+    const Entry* previous = it != changes.end() ? (it->second ? &*it->second : nullptr)
+                                                : tables_->Find(key, slot);
+    if (previous) overlay->counts.Add(slot, previous->state, -1);
+
+    std::optional<Entry> entry;
+    if (rule.state != SNTRuleStateRemove) {
+      entry = EntryForRule(rule);
+      overlay->counts.Add(slot, entry->state, 1);
+    }
+    if (it != changes.end()) {
+      it->second = std::move(entry);
+    } else {
+      changes.emplace(std::string(key), std::move(entry));
+    }
+  }
+  return std::make_shared<const ExecutionRuleIndex>(tables_, std::move(overlay));
+}
+
+SNTRule* ExecutionRuleIndex::Find(NSString* identifier, SNTRuleType type) const {
+  int slot = TypeSlot(type);
+  if (slot < 0 || identifier.length == 0) return nil;
+
+  std::string_view key = NSStringToUTF8StringView(identifier);
+  if (overlay_) {
+    const auto& changes = overlay_->changes[slot];
+    if (auto it = changes.find(key); it != changes.end()) {
+      return it->second ? RuleForEntry(identifier, type, *it->second) : nil;
+    }
+  }
+
+  const Entry* entry = tables_->Find(key, slot);
+  return entry ? RuleForEntry(identifier, type, *entry) : nil;
+}
+
+SNTRule* ExecutionRuleIndex::Lookup(const struct RuleIdentifiers& identifiers) const {
+  SNTRule* rule;
+  if ((rule = Find(identifiers.cdhash, SNTRuleTypeCDHash))) return rule;
+  if ((rule = Find(identifiers.binarySHA256, SNTRuleTypeBinary))) return rule;
+  if ((rule = Find(identifiers.signingID, SNTRuleTypeSigningID))) return rule;
+  if ((rule = Find(identifiers.certificateSHA256, SNTRuleTypeCertificate))) return rule;
+  return Find(identifiers.teamID, SNTRuleTypeTeamID);
+}
+
+bool ExecutionRuleIndex::HasRulesOfType(SNTRuleType type) const {
+  return CountOfType(type) > 0;
+}
+
+int64_t ExecutionRuleIndex::Count() const {
+  int64_t count = 0;
+  for (size_t slot = 0; slot < kNumRuleTypes; slot++) {
+    count += tables_->counts.types[slot] + (overlay_ ? overlay_->counts.types[slot] : 0);
+  }
+  return count;
+}
+
+int64_t ExecutionRuleIndex::CountOfType(SNTRuleType type) const {
+  int slot = TypeSlot(type);
+  if (slot < 0) return 0;
+  return tables_->counts.types[slot] + (overlay_ ? overlay_->counts.types[slot] : 0);
+}
+
+int64_t ExecutionRuleIndex::CountInState(SNTRuleState state) const {
+  if (state < 0 || static_cast<size_t>(state) >= kNumCountedStates) return 0;
+  return tables_->counts.states[state] + (overlay_ ? overlay_->counts.states[state] : 0);
+}
+
+size_t ExecutionRuleIndex::BaseSize() const {
+  return tables_->size();
+}
+
+size_t ExecutionRuleIndex::OverlaySize() const {
+  return overlay_ ? overlay_->size() : 0;
+}
+
+}  // namespace santa
@@ -0,0 +1,211 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/DataLayer/ExecutionRuleIndex.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <memory>
+
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTRule.h"
+#import "Source/common/SNTRuleIdentifiers.h"
+
+using santa::ExecutionRuleIndex;
+
+static NSString* const kCDHash = @"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670a";
+static NSString* const kBinary = @"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b670";
+static NSString* const kCert = @"7ae80b9ab38af0c63a9a81765f434d9a7cd8f720eb6037ef303de39d779bc258";
+static NSString* const kSigningID = @"ABCDEFGHIJ:signingID";
+static NSString* const kTeamID = @"ABCDEFGHIJ";
+
+static SNTRule* MakeRule(NSString* identifier, SNTRuleType type, SNTRuleState state) {
+  return [[SNTRule alloc] initWithIdentifier:identifier state:state type:type];
+}
+
+static std::shared_ptr<const ExecutionRuleIndex> MakeIndex(NSArray<SNTRule*>* rules) {
+  ExecutionRuleIndex::Builder builder(rules.count);
+  for (SNTRule* rule in rules) {
+    builder.Add(rule);
+  }
+  return builder.Build();
+}
+
+@interface ExecutionRuleIndexTest : XCTestCase
+@end
+
+@implementation ExecutionRuleIndexTest
+
+- (void)testLookupPrecedence {
+  auto index = MakeIndex(@[
+    MakeRule(kTeamID, SNTRuleTypeTeamID, SNTRuleStateBlock),
+    MakeRule(kCert, SNTRuleTypeCertificate, SNTRuleStateAllow),
+    MakeRule(kSigningID, SNTRuleTypeSigningID, SNTRuleStateBlock),
+    MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateAllow),
+    MakeRule(kCDHash, SNTRuleTypeCDHash, SNTRuleStateBlock),
+  ]);
+  XCTAssertEqual(index->BaseSize(), 5);
+
+  struct RuleIdentifiers ids = {
+      .cdhash = kCDHash,
+      .binarySHA256 = kBinary,
+      .signingID = kSigningID,
+      .certificateSHA256 = kCert,
+      .teamID = kTeamID,
+  };
+  XCTAssertEqual(index->Lookup(ids).type, SNTRuleTypeCDHash);
+  ids.cdhash = nil;
+  XCTAssertEqual(index->Lookup(ids).type, SNTRuleTypeBinary);
+  ids.binarySHA256 = @"unknown";
+  XCTAssertEqual(index->Lookup(ids).type, SNTRuleTypeSigningID);
+  ids.signingID = nil;
+  XCTAssertEqual(index->Lookup(ids).type, SNTRuleTypeCertificate);
+  ids.certificateSHA256 = nil;
+  XCTAssertEqual(index->Lookup(ids).type, SNTRuleTypeTeamID);
+  ids.teamID = nil;
+  XCTAssertNil(index->Lookup(ids));
+
+  // Identifiers only match rules of their own type.
+  XCTAssertNil(index->Find(kTeamID, SNTRuleTypeSigningID));
+  XCTAssertNil(index->Find(kBinary, SNTRuleTypeCertificate));
+}
+
+- (void)testRuleFieldsRoundTrip {
+  SNTRule* rule = [[SNTRule alloc] initWithIdentifier:kSigningID
+                                                state:SNTRuleStateBlock
+                                                 type:SNTRuleTypeSigningID
+                                            customMsg:@"msg"
+                                            customURL:@"https://example.com"
+                                            timestamp:1234
+                                              comment:@"comment"
+                                              celExpr:nil
+                                       seatbeltPolicy:nil
+                                               ruleId:42
+                                                error:nil];
+  auto index = MakeIndex(@[ rule, MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateAllow) ]);
+
+  SNTRule* found = index->Find(kSigningID, SNTRuleTypeSigningID);
+  XCTAssertEqualObjects(found.identifier, kSigningID);
+  XCTAssertEqual(found.state, SNTRuleStateBlock);
+  XCTAssertEqualObjects(found.customMsg, @"msg");
+  XCTAssertEqualObjects(found.customURL, @"https://example.com");
+  XCTAssertEqualObjects(found.comment, @"comment");
+  XCTAssertEqual(found.timestamp, 1234);
+  XCTAssertEqual(found.ruleId, 42);
+
+  // Every lookup returns a distinct object.
+  XCTAssertNotEqual(found, index->Find(kSigningID, SNTRuleTypeSigningID));
+
+  found = index->Find(kBinary, SNTRuleTypeBinary);
+  XCTAssertEqual(found.state, SNTRuleStateAllow);
+  XCTAssertNil(found.customMsg);
+}
+
+- (void)testHashIdentifiersMatchExactly {
+  auto index = MakeIndex(@[ MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateAllow) ]);
+
+  XCTAssertNotNil(index->Find(kBinary, SNTRuleTypeBinary));
+  // Uppercase and truncated identifiers never matched in the database either.
+  XCTAssertNil(index->Find(kBinary.uppercaseString, SNTRuleTypeBinary));
+  XCTAssertNil(index->Find([kBinary substringToIndex:40], SNTRuleTypeBinary));
+  XCTAssertNil(index->Find(@"", SNTRuleTypeBinary));
+  XCTAssertNil(index->Find(nil, SNTRuleTypeBinary));
+}
+
+- (void)testOverlayChanges {
+  auto base = MakeIndex(@[
+    MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateBlock),
+    MakeRule(kTeamID, SNTRuleTypeTeamID, SNTRuleStateBlock),
+  ]);
+
+  auto changed = base->WithChanges(@[
+    MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateRemove),
+    MakeRule(kTeamID, SNTRuleTypeTeamID, SNTRuleStateAllow),
+    MakeRule(kCert, SNTRuleTypeCertificate, SNTRuleStateAllow),
+  ]);
+  XCTAssertEqual(changed->BaseSize(), 2);
+  XCTAssertEqual(changed->OverlaySize(), 3);
+
+  XCTAssertNil(changed->Find(kBinary, SNTRuleTypeBinary));
+  XCTAssertEqual(changed->Find(kTeamID, SNTRuleTypeTeamID).state, SNTRuleStateAllow);
+  XCTAssertEqual(changed->Find(kCert, SNTRuleTypeCertificate).state, SNTRuleStateAllow);
+
+  // A removed higher priority rule falls through to lower priority types.
+  struct RuleIdentifiers ids = {.binarySHA256 = kBinary, .teamID = kTeamID};
+  XCTAssertEqual(changed->Lookup(ids).type, SNTRuleTypeTeamID);
+
+  // Re-adding a removed rule shadows the removal.
+  auto readded = changed->WithChanges(@[ MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateAllow) ]);
+  XCTAssertEqual(readded->OverlaySize(), 3);
+  XCTAssertEqual(readded->Lookup(ids).type, SNTRuleTypeBinary);
+
+  // The original index is unchanged.
+  XCTAssertEqual(base->OverlaySize(), 0);
+  XCTAssertEqual(base->Find(kBinary, SNTRuleTypeBinary).state, SNTRuleStateBlock);
+  XCTAssertNil(base->Find(kCert, SNTRuleTypeCertificate));
+}
+
+- (void)testHasRulesOfType {
+  auto base = MakeIndex(@[ MakeRule(kTeamID, SNTRuleTypeTeamID, SNTRuleStateAllow) ]);
+  XCTAssertTrue(base->HasRulesOfType(SNTRuleTypeTeamID));
+  XCTAssertFalse(base->HasRulesOfType(SNTRuleTypeBinary));
+
+  // Removals alone don't add rules of a type.
+  auto removed = base->WithChanges(@[ MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateRemove) ]);
+  XCTAssertFalse(removed->HasRulesOfType(SNTRuleTypeBinary));
+
+  auto added = removed->WithChanges(@[ MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateBlock) ]);
+  XCTAssertTrue(added->HasRulesOfType(SNTRuleTypeBinary));
+  XCTAssertFalse(base->HasRulesOfType(SNTRuleTypeBinary));
+}
+
+- (void)testCounts {
+  auto base = MakeIndex(@[
+    MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateAllowTransitive),
+    MakeRule(kCert, SNTRuleTypeCertificate, SNTRuleStateAllowCompiler),
+    MakeRule(kTeamID, SNTRuleTypeTeamID, SNTRuleStateAllow),
+    MakeRule(kTeamID, SNTRuleTypeTeamID, SNTRuleStateBlock),
+  ]);
+  XCTAssertEqual(base->Count(), 3);
+  XCTAssertEqual(base->CountOfType(SNTRuleTypeTeamID), 1);
+  XCTAssertEqual(base->CountInState(SNTRuleStateAllow), 0);
+  XCTAssertEqual(base->CountInState(SNTRuleStateBlock), 1);
+  XCTAssertEqual(base->CountInState(SNTRuleStateAllowTransitive), 1);
+
+  // Changes replace or remove existing rules rather than adding to the counts.
+  auto changed = base->WithChanges(@[
+    MakeRule(kBinary, SNTRuleTypeBinary, SNTRuleStateBlock),
+    MakeRule(kCert, SNTRuleTypeCertificate, SNTRuleStateRemove),
+    MakeRule(kCert, SNTRuleTypeCertificate, SNTRuleStateRemove),
+    MakeRule(kCDHash, SNTRuleTypeCDHash, SNTRuleStateRemove),
+    MakeRule(kSigningID, SNTRuleTypeSigningID, SNTRuleStateAllow),
+  ]);
+  XCTAssertEqual(changed->Count(), 3);
+  XCTAssertEqual(changed->CountOfType(SNTRuleTypeCertificate), 0);
+  XCTAssertEqual(changed->CountOfType(SNTRuleTypeCDHash), 0);
+  XCTAssertEqual(changed->CountOfType(SNTRuleTypeSigningID), 1);
+  XCTAssertEqual(changed->CountInState(SNTRuleStateBlock), 2);
+  XCTAssertEqual(changed->CountInState(SNTRuleStateAllowTransitive), 0);
+  XCTAssertEqual(changed->CountInState(SNTRuleStateAllowCompiler), 0);
+
+  auto readded = changed->WithChanges(@[
+    MakeRule(kCert, SNTRuleTypeCertificate, SNTRuleStateAllowCompiler),
+  ]);
+  XCTAssertEqual(readded->Count(), 4);
+  XCTAssertEqual(readded->CountInState(SNTRuleStateAllowCompiler), 1);
+  XCTAssertEqual(base->Count(), 3);
+}
+
+@end
@@ -19,6 +19,30 @@
 // classes that use this one from also having to import FMDB stuff.
 #import <fmdb/FMDB.h>
 
+#import "Source/common/SNTCommonEnums.h"
+
+///
+///  Size and query planner statistics for a database, as reported by SQLite.
+///
+typedef struct {
+  uint64_t pageCount;
+  uint64_t freelistCount;
+  uint64_t pageSize;
+  // Number of indexes with statistics in sqlite_stat1 for the query planner.
+  uint64_t analyzedIndexCount;
+} SNTDatabaseStats;
+
+///
+///  Result of a full database integrity check.
+///
+typedef NS_ENUM(NSInteger, SNTDatabaseIntegrity) {
+  SNTDatabaseIntegrityOK,
+  // The check failed, but passed after reindexing and vacuuming the database.
+  SNTDatabaseIntegrityRepaired,
+  // The check still failed after the repair attempt.
+  SNTDatabaseIntegrityCorrupted,
+};
+
 @interface SNTDatabaseTable : NSObject
 
 ///
@@ -41,9 +65,49 @@
 - (void)inDatabase:(void (^)(FMDatabase* db))block;
 - (void)inTransaction:(void (^)(FMDatabase* db, BOOL* rollback))block;
 
+///
+///  Like inDatabase:, for blocks that only read from tables in the main database. Once concurrent
+///  reads are enabled the block runs on one of a pool of read-only connections, in parallel with
+///  other readers and with any transaction on the database queue, and sees the last committed
+///  state. Until then this is the same as inDatabase:.
+///
+- (void)inReadOnlyDatabase:(void (^)(FMDatabase* db))block;
+
+///
+///  Switch a file-backed database to WAL journaling so that inReadOnlyDatabase: can use up to
+///  maxReaders read-only connections. Statements are cached on the read-only connections. Returns
+///  NO, leaving reads on the database queue, for in-memory databases or if WAL couldn't be enabled.
+///
+- (BOOL)enableConcurrentReadsWithMaxReaders:(NSUInteger)maxReaders;
+
+///
+///  Set how commits are flushed to stable storage. With SNTWriteDurabilityNone SQLite's defaults
+///  are used: commits are synced with fsync(), which on APFS doesn't flush the drive's cache.
+///  SNTWriteDurabilityBatch flushes each commit with F_FULLFSYNC, so callers should group writes
+///  into transactions. SNTWriteDurabilityStrict also flushes the directory once a rollback journal
+///  is deleted, and flushes WAL checkpoints with F_FULLFSYNC.
+///
+- (void)setWriteDurability:(SNTWriteDurability)durability;
+
 ///  Vacuum the database
 - (void)vacuum;
 
+///
+///  Routine maintenance that is cheap enough to run periodically: refresh the query planner's
+///  statistics with PRAGMA optimize, return free pages to the file system with an incremental
+///  vacuum and checkpoint the WAL when concurrent reads are enabled. Returns the database stats
+///  once maintenance completes.
+///
+- (SNTDatabaseStats)performMaintenance;
+
+///
+///  Run a full integrity check, which on a large database can take much longer than the quick
+///  check run when the table is opened. If it fails the database is reindexed and vacuumed and
+///  checked again. If that fails too, the next time the table is opened the full check runs
+///  instead of the quick one, and the database is replaced if it still fails.
+///
+- (SNTDatabaseIntegrity)checkIntegrity;
+
 ///
 ///  Current supported version of the table schema. This should be overriden in
 ///  subclasses.
@@ -15,13 +15,21 @@
 
 #import "Source/santad/DataLayer/SNTDatabaseTable.h"
 
+#include <fcntl.h>
 #include <sqlite3.h>
 #include <stdint.h>
+#include <string.h>
+#include <unistd.h>
 
 #import "Source/common/SNTLogging.h"
 
 @interface SNTDatabaseTable ()
 @property FMDatabaseQueue* dbQ;
+// Read-only connections used by inReadOnlyDatabase:, and a semaphore limiting how many are in use
+// at once. FMDatabasePool hands out nil instead of waiting once its own limit is reached, so the
+// pool itself is left unbounded. Both are nil until concurrent reads are enabled.
+@property(atomic) FMDatabasePool* readerPool;
+@property(atomic) dispatch_semaphore_t readerSema;
 @end
 
 @implementation SNTDatabaseTable
@@ -47,15 +55,25 @@
       } else if ([db userVersion] > [self currentSupportedVersion]) {
         LOGW(@"Database version newer than supported. Deleting. (%@)", [db databasePath]);
         [self closeDeleteReopenDatabase:db];
-      } else if ([self isDatabaseCorrupted:db]) {
-        LOGW(@"Corrupted database detected. Attempting repairs. (%@)", [db databasePath]);
-        [db executeUpdate:@"REINDEX;"];
-        [db executeUpdate:@"VACUUM;"];
-        if ([self isDatabaseCorrupted:db]) {
-          LOGW(@"Unable to recover corrupted database. Deleting. (%@)", [db databasePath]);
-          [self closeDeleteReopenDatabase:db];
-        } else {
-          LOGW(@"Repairs successful. (%@)", [db databasePath]);
+      } else {
+        // A full check is only needed at startup if the last one, run in the
+        // background by checkIntegrity, found corruption it couldn't repair.
+        NSString* markerPath = [self integrityMarkerPathForDatabase:db];
+        BOOL fullCheck =
+            markerPath && [[NSFileManager defaultManager] fileExistsAtPath:markerPath];
+        if ([self isDatabaseCorrupted:db fullCheck:fullCheck]) {
+          LOGW(@"Corrupted database detected. Attempting repairs. (%@)", [db databasePath]);
+          [db executeUpdate:@"REINDEX;"];
+          [db executeUpdate:@"VACUUM;"];
+          if ([self isDatabaseCorrupted:db fullCheck:fullCheck]) {
+            LOGW(@"Unable to recover corrupted database. Deleting. (%@)", [db databasePath]);
+            [self closeDeleteReopenDatabase:db];
+          } else {
+            LOGW(@"Repairs successful. (%@)", [db databasePath]);
+          }
+        }
+        if (fullCheck) {
+          [[NSFileManager defaultManager] removeItemAtPath:markerPath error:NULL];
         }
       }
     }];
@@ -73,19 +91,104 @@
   return nil;
 }
 
-- (BOOL)isDatabaseCorrupted:(FMDatabase*)db {
-  BOOL corrupted = YES;
+// Unless fullCheck is set, only the checks that stay fast on large databases
+// are run: the file header and the root page of every table and index are
+// sanity checked, then quick_check verifies the structure of every page. What
+// quick_check skips, matching each index against its table, is most of the
+// cost of a full integrity_check, which checkIntegrity runs in the background.
+- (BOOL)isDatabaseCorrupted:(FMDatabase*)db fullCheck:(BOOL)fullCheck {
+  if (fullCheck) {
+    return ![self database:db passesCheck:@"integrity_check"];
+  }
+  return ![self hasValidHeader:db] || ![self hasValidRootPages:db] ||
+         ![self database:db passesCheck:@"quick_check"];
+}
 
-  FMResultSet* rs = [db executeQuery:@"PRAGMA integrity_check"];
+- (BOOL)database:(FMDatabase*)db passesCheck:(NSString*)check {
+  BOOL ok = NO;
+  FMResultSet* rs = [db executeQuery:[NSString stringWithFormat:@"PRAGMA %@", check]];
   if ([rs next]) {
-    NSString* result = [rs stringForColumnIndex:0];
-    if ([result isEqualToString:@"ok"]) {
-      corrupted = NO;
-    }
+    ok = [[rs stringForColumnIndex:0] isEqualToString:@"ok"];
   }
+  [rs close];
+  return ok;
+}
+
+// Checks the magic string and page size in the file header. SQLite only
+// reads the header when it first needs a page, so this catches a file that
+// isn't a database before anything else reads from it.
+- (BOOL)hasValidHeader:(FMDatabase*)db {
+  NSString* path = [db databasePath];
+  if (path.length == 0) return YES;  // in-memory
 
+  int fd = open(path.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return YES;  // nothing has been written yet
+  uint8_t header[100];
+  ssize_t bytesRead = pread(fd, header, sizeof(header), 0);
+  close(fd);
+
+  if (bytesRead == 0) return YES;
+  if (bytesRead != sizeof(header)) return NO;
+  if (memcmp(header, "SQLite format 3", 16) != 0) return NO;
+
+  // Stored big-endian, with 1 standing for 65536.
+  uint32_t pageSize = (uint32_t)header[16] << 8 | header[17];
+  if (pageSize == 1) pageSize = 65536;
+  return pageSize == (uint32_t)[db longForQuery:@"PRAGMA page_size"];
+}
+
+// Checks that the root page of every table and index lies within the file.
+- (BOOL)hasValidRootPages:(FMDatabase*)db {
+  long long pageCount = [db longForQuery:@"PRAGMA page_count"];
+  // Views, triggers and virtual tables have no root page.
+  FMResultSet* rs = [db executeQuery:@"SELECT rootpage FROM sqlite_master WHERE rootpage > 0"];
+  if (!rs) return NO;
+
+  BOOL valid = YES;
+  while (valid && [rs next]) {
+    long long rootPage = [rs longLongIntForColumnIndex:0];
+    valid = rootPage >= 2 && rootPage <= pageCount;
+  }
   [rs close];
-  return corrupted;
+  return valid;
+}
+
+- (NSString*)integrityMarkerPathForDatabase:(FMDatabase*)db {
+  NSString* path = [db databasePath];
+  return path.length ? [path stringByAppendingString:@".integrity_check_failed"] : nil;
+}
+
+- (SNTDatabaseIntegrity)checkIntegrity {
+  // On a read-only connection, once concurrent reads are enabled, so the scan
+  // doesn't hold up writers.
+  __block BOOL ok = NO;
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
+    ok = [self database:db passesCheck:@"integrity_check"];
+  }];
+  if (ok) return SNTDatabaseIntegrityOK;
+
+  __block BOOL repaired = NO;
+  [self.dbQ inDatabase:^(FMDatabase* db) {
+    LOGW(@"Database integrity check failed. Attempting repairs. (%@)", [db databasePath]);
+    [db executeUpdate:@"REINDEX;"];
+    [db executeUpdate:@"VACUUM;"];
+    repaired = [self database:db passesCheck:@"integrity_check"];
+    if (repaired) {
+      LOGW(@"Repairs successful. (%@)", [db databasePath]);
+      return;
+    }
+
+    // The database can't be replaced while it is in use, so leave a marker
+    // for the next startup to run the full check and, if it still fails,
+    // replace it then.
+    LOGE(@"Unable to repair corrupted database, it will be checked again at startup. (%@)",
+         [db databasePath]);
+    NSString* markerPath = [self integrityMarkerPathForDatabase:db];
+    if (markerPath) {
+      [[NSFileManager defaultManager] createFileAtPath:markerPath contents:nil attributes:nil];
+    }
+  }];
+  return repaired ? SNTDatabaseIntegrityRepaired : SNTDatabaseIntegrityCorrupted;
 }
 
 - (void)closeDeleteReopenDatabase:(FMDatabase*)db {
@@ -141,10 +244,108 @@
   [self.dbQ inTransaction:block];
 }
 
+- (void)inReadOnlyDatabase:(void (^)(FMDatabase* db))block {
+  FMDatabasePool* pool = self.readerPool;
+  dispatch_semaphore_t sema = self.readerSema;
+  if (!pool) {
+    [self.dbQ inDatabase:block];
+    return;
+  }
+
+  dispatch_semaphore_wait(sema, DISPATCH_TIME_FOREVER);
+  [pool inDatabase:block];
+  dispatch_semaphore_signal(sema);
+}
+
+- (BOOL)enableConcurrentReadsWithMaxReaders:(NSUInteger)maxReaders {
+  NSString* path = self.dbQ.path;
+  if (maxReaders == 0 || path.length == 0 || [path isEqualToString:@":memory:"]) {
+    return NO;
+  }
+
+  __block BOOL wal = NO;
+  [self.dbQ inDatabase:^(FMDatabase* db) {
+    // WAL readers can't share a database held in exclusive locking mode. Changing the journal
+    // mode accesses the database, releasing any exclusive lock.
+    [[db executeQuery:@"PRAGMA locking_mode = NORMAL;"] close];
+    FMResultSet* rs = [db executeQuery:@"PRAGMA journal_mode = WAL;"];
+    if ([rs next]) {
+      wal = [[rs stringForColumnIndex:0] isEqualToString:@"wal"];
+    }
+    [rs close];
+  }];
+
+  if (!wal) {
+    LOGW(@"Unable to enable WAL journaling, reads will not run concurrently. (%@)", path);
+    return NO;
+  }
+
+  FMDatabasePool* pool = [[FMDatabasePool alloc] initWithPath:path flags:SQLITE_OPEN_READONLY];
+  pool.delegate = self;
+  self.readerSema = dispatch_semaphore_create((long)maxReaders);
+  self.readerPool = pool;
+  return YES;
+}
+
+- (void)setWriteDurability:(SNTWriteDurability)durability {
+  NSString* pragmas;
+  switch (durability) {
+    case SNTWriteDurabilityBatch:
+      pragmas = @"PRAGMA synchronous = FULL; PRAGMA fullfsync = ON; "
+                @"PRAGMA checkpoint_fullfsync = OFF;";
+      break;
+    case SNTWriteDurabilityStrict:
+      pragmas = @"PRAGMA synchronous = EXTRA; PRAGMA fullfsync = ON; "
+                @"PRAGMA checkpoint_fullfsync = ON;";
+      break;
+    default:
+      pragmas = @"PRAGMA synchronous = FULL; PRAGMA fullfsync = OFF; "
+                @"PRAGMA checkpoint_fullfsync = OFF;";
+      break;
+  }
+
+  [self.dbQ inDatabase:^(FMDatabase* db) {
+    [db executeStatements:pragmas];
+  }];
+}
+
+- (void)databasePool:(FMDatabasePool*)pool didAddDatabase:(FMDatabase*)database {
+  database.shouldCacheStatements = YES;
+#ifndef DEBUG
+  database.logsErrors = NO;
+#endif
+}
+
 - (void)vacuum {
   [self.dbQ inDatabase:^(FMDatabase* db) {
+    // Changing auto_vacuum on an existing database only takes effect with the next VACUUM. Once
+    // it has, performMaintenance can release free pages without rebuilding the whole database.
+    [db executeStatements:@"PRAGMA auto_vacuum = INCREMENTAL;"];
     [db executeUpdate:@"VACUUM"];
   }];
 }
 
+- (SNTDatabaseStats)performMaintenance {
+  BOOL wal = self.readerPool != nil;
+  __block SNTDatabaseStats stats = {};
+  [self.dbQ inDatabase:^(FMDatabase* db) {
+    // Bound the rows ANALYZE reads per index so optimize stays cheap on large tables.
+    [db executeStatements:@"PRAGMA analysis_limit = 400; PRAGMA optimize; "
+                          @"PRAGMA incremental_vacuum;"];
+    if (wal) {
+      // Fails without blocking writers if a reader is still using the WAL; the next run retries.
+      [db executeStatements:@"PRAGMA wal_checkpoint(TRUNCATE);"];
+    }
+
+    stats.pageCount = (uint64_t)[db longForQuery:@"PRAGMA page_count"];
+    stats.freelistCount = (uint64_t)[db longForQuery:@"PRAGMA freelist_count"];
+    stats.pageSize = (uint64_t)[db longForQuery:@"PRAGMA page_size"];
+    if ([db tableExists:@"sqlite_stat1"]) {
+      stats.analyzedIndexCount =
+          (uint64_t)[db longForQuery:@"SELECT COUNT(DISTINCT idx) FROM sqlite_stat1"];
+    }
+  }];
+  return stats;
+}
+
 @end
@@ -48,6 +48,17 @@
 ///
 - (NSArray*)pendingEvents;
 
+///
+///  Retrieves a page of events in the database, in order of their index. Pages are fetched by
+///  passing the index of the last event of the previous page, so callers can work through a large
+///  number of events without loading all of them at once.
+///
+///  @param index Only events with a greater index are returned, or all events when nil.
+///  @param limit The maximum number of events to return.
+///  @return NSArray of SNTStoredEvent's, holding fewer than limit events only if there are no more.
+///
+- (NSArray<SNTStoredEvent*>*)pendingEventsAfterIndex:(NSNumber*)index limit:(NSUInteger)limit;
+
 ///
 ///  Retrieves number of events in database without fetching every event.
 ///
@@ -16,6 +16,7 @@
 #import "Source/santad/DataLayer/SNTEventTable.h"
 
 #include <memory>
+#include <vector>
 
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/SNTLogging.h"
@@ -26,14 +27,29 @@
 #import "Source/common/SNTStoredTemporaryAdminModeAuditEvent.h"
 #import "Source/common/SNTStoredTemporaryMonitorModeAuditEvent.h"
 #include "Source/common/SantaCache.h"
+#include "Source/common/StoredEventEncoding.h"
 #include "Source/common/String.h"
 
-static const uint32_t kEventTableCurrentVersion = 6;
+static const uint32_t kEventTableCurrentVersion = 7;
 // 4 hour cache
 static const NSTimeInterval kUnactionableEventCacheTimeSeconds = (60 * 60 * 4);
 // Deduplicate repeated firings of the same signal to at most one per name per 10 minutes.
 static const NSTimeInterval kSignalReportDedupWindowSeconds = (60 * 10);
 
+// Values of the events table format column, describing how eventdata is encoded.
+static const int kEventFormatKeyedArchive = 0;
+static const int kEventFormatStoredEventProto = 1;
+
+namespace {
+
+struct EncodedEvent {
+  SNTStoredEvent* event;
+  NSData* data;
+  int format;
+};
+
+}  // namespace
+
 @interface SNTEventTable ()
 // This property is only set once, safe to be nonatomic
 @property(nonatomic) NSTimeInterval unactionableEventCacheTimeSeconds;
@@ -115,6 +131,31 @@ static const NSTimeInterval kSignalReportDedupWindowSeconds = (60 * 10);
     newVersion = 6;
   }
 
+  if (version < 7) {
+    // Execution and file access events are stored as a StoredEvent protobuf,
+    // which is much smaller and cheaper to decode than a keyed archive. Other
+    // event types are still archived, so each row records its format.
+    [db executeUpdate:@"ALTER TABLE events ADD COLUMN 'format' INTEGER NOT NULL DEFAULT 0"];
+
+    NSMutableDictionary<NSNumber*, NSData*>* migrated = [NSMutableDictionary dictionary];
+    FMResultSet* rs = [db executeQuery:@"SELECT idx, eventdata FROM events"];
+    while ([rs next]) {
+      SNTStoredEvent* event = [self eventFromData:[rs dataNoCopyForColumn:@"eventdata"]
+                                           format:kEventFormatKeyedArchive];
+      NSData* data = event ? santa::EncodeStoredEvent(event) : nil;
+      if (data) migrated[@([rs longLongIntForColumn:@"idx"])] = data;
+    }
+    [rs close];
+
+    // Rows that can't be converted are left archived, and rows that fail to
+    // unarchive are deleted when they are next read.
+    [migrated enumerateKeysAndObjectsUsingBlock:^(NSNumber* idx, NSData* data, BOOL* stop) {
+      [db executeUpdate:@"UPDATE events SET eventdata=?, format=? WHERE idx=?", data,
+                        @(kEventFormatStoredEventProto), idx];
+    }];
+    newVersion = 7;
+  }
+
   return newVersion;
 }
 
@@ -145,7 +186,8 @@ static const NSTimeInterval kSignalReportDedupWindowSeconds = (60 * 10);
 }
 
 - (BOOL)addStoredEvents:(NSArray<SNTStoredEvent*>*)events {
-  NSMutableDictionary* eventsData = [NSMutableDictionary dictionaryWithCapacity:events.count];
+  std::vector<EncodedEvent> encoded;
+  encoded.reserve(events.count);
   for (SNTStoredEvent* event in events) {
     if (![self isValidStoredEvent:event]) {
       continue;
@@ -155,24 +197,28 @@ static const NSTimeInterval kSignalReportDedupWindowSeconds = (60 * 10);
       continue;
     }
 
-    NSData* eventData = [NSKeyedArchiver archivedDataWithRootObject:event
-                                              requiringSecureCoding:YES
-                                                              error:nil];
+    int format = kEventFormatStoredEventProto;
+    NSData* eventData = santa::EncodeStoredEvent(event);
+    if (!eventData) {
+      format = kEventFormatKeyedArchive;
+      eventData = [NSKeyedArchiver archivedDataWithRootObject:event
+                                        requiringSecureCoding:YES
+                                                        error:nil];
+    }
     if (eventData) {
-      eventsData[eventData] = event;
+      encoded.push_back({event, eventData, format});
     }
   }
 
   __block BOOL success = NO;
   [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
-    [eventsData
-        enumerateKeysAndObjectsUsingBlock:^(NSData* eventData, SNTStoredEvent* event, BOOL* stop) {
-          success = [db executeUpdate:@"INSERT INTO 'events' (idx, uniqueid, eventdata) "
-                                      @"VALUES (?, ?, ?) "
-                                      @"ON CONFLICT(uniqueid) DO NOTHING",
-                                      event.idx, [event uniqueID], eventData];
-          if (!success) *stop = YES;
-        }];
+    for (const EncodedEvent& e : encoded) {
+      success = [db executeUpdate:@"INSERT INTO 'events' (idx, uniqueid, eventdata, format) "
+                                  @"VALUES (?, ?, ?, ?) "
+                                  @"ON CONFLICT(uniqueid) DO NOTHING",
+                                  e.event.idx, [e.event uniqueID], e.data, @(e.format)];
+      if (!success) break;
+    }
   }];
 
   return success;
@@ -221,10 +267,58 @@ static const NSTimeInterval kSignalReportDedupWindowSeconds = (60 * 10);
   return pendingEvents;
 }
 
+- (NSArray<SNTStoredEvent*>*)pendingEventsAfterIndex:(NSNumber*)index limit:(NSUInteger)limit {
+  NSMutableArray<SNTStoredEvent*>* pendingEvents = [[NSMutableArray alloc] init];
+
+  [self inDatabase:^(FMDatabase* db) {
+    int64_t lastIdx = index ? [index longLongValue] : INT64_MIN;
+
+    // Rows that fail to decode are deleted rather than returned, so keep
+    // reading until the page is full or there are no more rows.
+    while (pendingEvents.count < limit) {
+      NSUInteger wanted = limit - pendingEvents.count;
+      NSUInteger rows = 0;
+      FMResultSet* rs =
+          [db executeQuery:@"SELECT idx, eventdata, format FROM events WHERE idx > ? "
+                           @"ORDER BY idx LIMIT ?",
+                           @(lastIdx), @(wanted)];
+      while ([rs next]) {
+        rows++;
+        lastIdx = [rs longLongIntForColumnIndex:0];
+        SNTStoredEvent* event = [self eventFromResultSet:rs];
+        if (event) {
+          [pendingEvents addObject:event];
+        } else {
+          [db executeUpdate:@"DELETE FROM events WHERE idx=?", @(lastIdx)];
+        }
+      }
+      [rs close];
+
+      if (rows < wanted) break;
+    }
+  }];
+
+  return pendingEvents;
+}
+
 - (SNTStoredEvent*)eventFromResultSet:(FMResultSet*)rs {
-  NSData* eventData = [rs dataNoCopyForColumn:@"eventdata"];
+  return [self eventFromData:[rs dataNoCopyForColumn:@"eventdata"]
+                      format:[rs intForColumn:@"format"]];
+}
+
+- (SNTStoredEvent*)eventFromData:(NSData*)eventData format:(int)format {
   if (!eventData) return nil;
 
+  if (format == kEventFormatStoredEventProto) {
+    SNTStoredEvent* event = santa::DecodeStoredEvent(eventData);
+    if (event && [self isValidStoredEvent:event]) {
+      return event;
+    } else {
+      LOGW(@"Unable to decode stored event");
+      return nil;
+    }
+  }
+
   static NSSet* allowedClasses =
       [NSSet setWithObjects:[SNTStoredExecutionEvent class], [SNTStoredFileAccessEvent class],
                             [SNTStoredTemporaryMonitorModeAuditEvent class],
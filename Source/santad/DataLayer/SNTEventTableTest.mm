@@ -129,6 +129,28 @@ NSString* GenerateRandomHexStringWithSHA256Length() {
   XCTAssertEqual(self.sut.pendingEventsCount, 2);
 }
 
+- (void)testWriteDurability {
+  void (^assertPragmas)(long, long, long) = ^(long synchronous, long fullfsync,
+                                              long checkpointFullfsync) {
+    [self.dbq inDatabase:^(FMDatabase* db) {
+      XCTAssertEqual([db longForQuery:@"PRAGMA synchronous"], synchronous);
+      XCTAssertEqual([db longForQuery:@"PRAGMA fullfsync"], fullfsync);
+      XCTAssertEqual([db longForQuery:@"PRAGMA checkpoint_fullfsync"], checkpointFullfsync);
+    }];
+  };
+
+  // 2 is FULL and 3 is EXTRA
+  [self.sut setWriteDurability:SNTWriteDurabilityStrict];
+  assertPragmas(3, 1, 1);
+  [self.sut setWriteDurability:SNTWriteDurabilityBatch];
+  assertPragmas(2, 1, 0);
+  [self.sut setWriteDurability:SNTWriteDurabilityNone];
+  assertPragmas(2, 0, 0);
+
+  XCTAssert([self.sut addStoredEvent:[self createTestEvent]]);
+  XCTAssertEqual(self.sut.pendingEventsCount, 1);
+}
+
 - (void)testUniqueIndexActionable {
   XCTAssertEqual(self.sut.pendingEventsCount, 0);
 
@@ -388,6 +410,40 @@ NSString* GenerateRandomHexStringWithSHA256Length() {
   }];
 }
 
+- (void)testPendingEventsAfterIndex {
+  for (int i = 0; i < 25; ++i) {
+    [self.sut addStoredEvent:[self createTestEvent]];
+  }
+
+  // Rows that fail to decode are deleted, and don't leave a page short.
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    for (int i = 0; i < 5; ++i) {
+      [db executeUpdate:@"INSERT INTO events (idx, uniqueid, eventdata) VALUES (?, ?, ?)",
+                        @(arc4random()), [[NSUUID UUID] UUIDString],
+                        [@"bad" dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+  }];
+  XCTAssertEqual(self.sut.pendingEventsCount, 30);
+
+  NSMutableArray<SNTStoredEvent*>* events = [NSMutableArray array];
+  NSMutableArray<NSNumber*>* pageSizes = [NSMutableArray array];
+  NSNumber* lastIdx;
+  while (YES) {
+    NSArray<SNTStoredEvent*>* page = [self.sut pendingEventsAfterIndex:lastIdx limit:10];
+    [pageSizes addObject:@(page.count)];
+    if (page.count == 0) break;
+    for (SNTStoredEvent* event in page) {
+      if (lastIdx) XCTAssertGreaterThan([event.idx longLongValue], [lastIdx longLongValue]);
+      lastIdx = event.idx;
+    }
+    [events addObjectsFromArray:page];
+  }
+
+  XCTAssertEqualObjects(pageSizes, (@[ @10, @10, @5, @0 ]));
+  XCTAssertEqual(self.sut.pendingEventsCount, 25);
+  XCTAssertEqualObjects([NSSet setWithArray:events], [NSSet setWithArray:[self.sut pendingEvents]]);
+}
+
 - (NSData*)dataFromFixture:(NSString*)file {
   NSString* path = [[NSBundle bundleForClass:[self class]] pathForResource:file ofType:nil];
   XCTAssertNotNil(path, @"failed to load testdata: %@", file);
@@ -485,9 +541,102 @@ NSString* GenerateRandomHexStringWithSHA256Length() {
   OCMExpect([mockResultSet dataNoCopyForColumn:@"eventdata"])
       .andReturn(newStoredFileAccessEventData);
 
+  // All fixtures are keyed archives.
+  OCMStub([mockResultSet intForColumn:@"format"]).andReturn(0);
+
   XCTAssertNil([self.sut eventFromResultSet:mockResultSet]);
   XCTAssertNotNil([self.sut eventFromResultSet:mockResultSet]);
   XCTAssertNotNil([self.sut eventFromResultSet:mockResultSet]);
 }
 
+- (NSDictionary<NSString*, NSNumber*>*)eventFormatsByUniqueID {
+  NSMutableDictionary<NSString*, NSNumber*>* formats = [NSMutableDictionary dictionary];
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    FMResultSet* rs = [db executeQuery:@"SELECT uniqueid, format FROM events"];
+    while ([rs next]) {
+      formats[[rs stringForColumn:@"uniqueid"]] = @([rs intForColumn:@"format"]);
+    }
+    [rs close];
+  }];
+  return formats;
+}
+
+- (void)testEventFormats {
+  SNTStoredExecutionEvent* exec = [self createTestEvent];
+  SNTStoredFileAccessEvent* faa = [self createTestFileAccessEvent];
+  SNTStoredTemporaryMonitorModeLeaveAuditEvent* audit =
+      [self createTestTemporaryMonitorModeLeaveAuditEvent];
+  XCTAssert([self.sut addStoredEvents:@[ exec, faa, audit ]]);
+
+  // Audit events have no protobuf encoding and are still archived
+  XCTAssertEqualObjects([self eventFormatsByUniqueID], (@{
+                          [exec uniqueID] : @1,
+                          [faa uniqueID] : @1,
+                          [audit uniqueID] : @0,
+                        }));
+
+  NSArray<SNTStoredEvent*>* events = [self.sut pendingEventsAfterIndex:nil limit:10];
+  XCTAssertEqual(events.count, 3);
+  for (SNTStoredEvent* event in events) {
+    if ([event isKindOfClass:[SNTStoredExecutionEvent class]]) {
+      SNTStoredExecutionEvent* got = (SNTStoredExecutionEvent*)event;
+      XCTAssertEqualObjects(got.idx, exec.idx);
+      XCTAssertEqualObjects(got.fileSHA256, exec.fileSHA256);
+      XCTAssertEqual(got.signingChain.count, exec.signingChain.count);
+      XCTAssertEqualObjects(got.currentSessions, exec.currentSessions);
+    } else if ([event isKindOfClass:[SNTStoredFileAccessEvent class]]) {
+      SNTStoredFileAccessEvent* got = (SNTStoredFileAccessEvent*)event;
+      XCTAssertEqualObjects(got.idx, faa.idx);
+      XCTAssertEqualObjects(got.process.fileSHA256, faa.process.fileSHA256);
+      XCTAssertEqualObjects(got.process.parent.pid, @(4567));
+    } else {
+      XCTAssertTrue([event isKindOfClass:[SNTStoredTemporaryMonitorModeLeaveAuditEvent class]]);
+      XCTAssertEqualObjects(event.idx, audit.idx);
+    }
+  }
+}
+
+- (void)testMigrateArchivedEvents {
+  SNTStoredExecutionEvent* exec = [self createTestEvent];
+  SNTStoredTemporaryMonitorModeLeaveAuditEvent* audit =
+      [self createTestTemporaryMonitorModeLeaveAuditEvent];
+
+  // Recreate the table as it was at version 6, holding only archived events
+  self.dbq = [[FMDatabaseQueue alloc] init];
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    [db executeUpdate:@"CREATE TABLE 'events' ('idx' INTEGER PRIMARY KEY, "
+                      @"'uniqueid' TEXT NOT NULL, 'eventdata' BLOB)"];
+    [db executeUpdate:@"CREATE UNIQUE INDEX uniqueid ON events (uniqueid)"];
+    [db executeUpdate:@"CREATE TABLE 'signal_reports' ('idx' INTEGER PRIMARY KEY, "
+                      @"'report_data' BLOB NOT NULL)"];
+    for (SNTStoredEvent* event in @[ exec, audit ]) {
+      NSData* data = [NSKeyedArchiver archivedDataWithRootObject:event
+                                           requiringSecureCoding:YES
+                                                           error:nil];
+      [db executeUpdate:@"INSERT INTO events (idx, uniqueid, eventdata) VALUES (?, ?, ?)",
+                        event.idx, [event uniqueID], data];
+    }
+    [db setUserVersion:6];
+  }];
+
+  self.sut = [[SNTEventTable alloc] initWithDatabaseQueue:self.dbq];
+  XCTAssertEqual([self.sut currentVersion], 7);
+  XCTAssertEqualObjects([self eventFormatsByUniqueID], (@{
+                          [exec uniqueID] : @1,
+                          [audit uniqueID] : @0,
+                        }));
+
+  NSArray<SNTStoredEvent*>* events = [self.sut pendingEvents];
+  XCTAssertEqual(events.count, 2);
+  for (SNTStoredEvent* event in events) {
+    if ([event isKindOfClass:[SNTStoredExecutionEvent class]]) {
+      SNTStoredExecutionEvent* got = (SNTStoredExecutionEvent*)event;
+      XCTAssertEqualObjects(got.idx, exec.idx);
+      XCTAssertEqualObjects(got.occurrenceDate, exec.occurrenceDate);
+      XCTAssertEqualObjects(got.fileSHA256, exec.fileSHA256);
+      XCTAssertEqual(got.decision, SNTEventStateBlockBinary);
+    }
+  }
+}
+
 @end
@@ -44,6 +44,19 @@
          networkFlowRulesHash:(NSString*)networkFlowRulesHash;
 @end
 
+///  Statistics for the in-memory filter consulted before execution rule lookups.
+struct SNTRuleFilterStats {
+  uint64_t sizeBytes;
+  uint64_t entries;
+  double estimatedFalsePositiveRate;
+  // Lookups answered by the filter without querying the database.
+  uint64_t skippedLookups;
+  // Lookups that passed the filter and matched a rule.
+  uint64_t matchedLookups;
+  // Lookups that passed the filter but matched no rule.
+  uint64_t falsePositiveLookups;
+};
+
 ///
 ///  Responsible for managing the rule tables.
 ///
@@ -64,6 +77,12 @@
 ///
 - (int64_t)binaryRuleCount;
 
+///
+///  @return YES if any binary rule might exist. Unlike binaryRuleCount this is answered from
+///          memory when the rule index is loaded, so it is cheap enough to call for every exec.
+///
+- (BOOL)hasBinaryRules;
+
 ///
 ///  @return Number of compiler rules in the database
 ///
@@ -94,6 +113,11 @@
 ///
 - (int64_t)cdhashRuleCount;
 
+///
+/// @return Number of CEL and CELv2 rules in the database
+///
+- (int64_t)celRuleCount;
+
 ///
 /// @return Number of network flow rules in the database
 ///
@@ -131,6 +155,91 @@
               ruleCleanup:(SNTRuleCleanup)cleanupType
                    errors:(NSArray<NSError*>**)errors;
 
+///
+///  Same as `addExecutionRules:fileAccessRules:networkFlowRules:signals:ruleCleanup:errors:`,
+///  also reporting whether cached decisions should be flushed now that the rules were applied.
+///
+///  @param flushDecisionCache If not NULL, set to whether the applied rules may make a cached
+///         decision stale. When the cleanup replaces the execution rules, the rules before and
+///         after the update are compared, so an update that changed nothing or only added allow
+///         rules reports NO. Other cleanups always report YES. Updates without a cleanup report
+///         NO, and should be checked beforehand with `addedRulesShouldFlushDecisionCache:`.
+///
+- (BOOL)addExecutionRules:(NSArray<SNTRule*>*)executionRules
+          fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+         networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                  signals:(NSArray<SNTSignal*>*)signals
+              ruleCleanup:(SNTRuleCleanup)cleanupType
+       flushDecisionCache:(BOOL*)flushDecisionCache
+                   errors:(NSArray<NSError*>**)errors;
+
+///
+///  Begin a staged rule update. Rules staged for the update are held in a temporary table and only
+///  applied when the update is committed, so a large rule set can be added in chunks without
+///  holding all of it in memory, while still being applied in a single transaction.
+///
+///  Only one staged update exists at a time; beginning a new one discards any uncommitted one.
+///
+///  @return An ID for the update, or nil if staging failed.
+///
+- (NSString*)beginStagedRuleUpdate;
+
+///
+///  Stage rules for a staged rule update. Rules are not validated until the update is committed.
+///
+///  @param updateID The ID returned by `beginStagedRuleUpdate`.
+///  @param errors When returning NO, will be filled with an array of errors.
+///  @return YES if the rules were staged, NO if the update does not exist or staging failed.
+///
+- (BOOL)stageExecutionRules:(NSArray<SNTRule*>*)executionRules
+            fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+           networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                    signals:(NSArray<SNTSignal*>*)signals
+                   updateID:(NSString*)updateID
+                     errors:(NSArray<NSError*>**)errors;
+
+///
+///  Stage a serialized santa::rulebatch::ExecutionRuleBatch for a staged rule update. The batch is
+///  applied in the order it was staged relative to other staged execution rules, and its rules are
+///  written straight from the protobuf rather than through an SNTRule each.
+///
+///  @param updateID The ID returned by `beginStagedRuleUpdate`.
+///  @param errors When returning NO, will be filled with an array of errors.
+///  @return YES if the batch was staged, NO if the update does not exist or staging failed.
+///
+- (BOOL)stageExecutionRuleBatch:(NSData*)batch
+                       updateID:(NSString*)updateID
+                         errors:(NSArray<NSError*>**)errors;
+
+///
+///  Apply all rules staged for a staged rule update, in the order they were staged, with the same
+///  semantics as `addExecutionRules:fileAccessRules:networkFlowRules:signals:ruleCleanup:errors:`.
+///  The update is discarded afterwards, whether or not it was applied.
+///
+///  @param updateID The ID returned by `beginStagedRuleUpdate`.
+///  @param ruleCleanup Rule cleanup type to perform (e.g. all, none, non-transitive).
+///  @param errors When returning NO, will be filled with an array of errors.
+///  @return YES if adding all rules passed, NO if any were rejected.
+///
+- (BOOL)commitStagedRuleUpdate:(NSString*)updateID
+                   ruleCleanup:(SNTRuleCleanup)cleanupType
+                        errors:(NSArray<NSError*>**)errors;
+
+///
+///  Same as `commitStagedRuleUpdate:ruleCleanup:errors:`, also reporting whether cached decisions
+///  should be flushed in `flushDecisionCache`, as the variant of `addExecutionRules:` taking it
+///  does.
+///
+- (BOOL)commitStagedRuleUpdate:(NSString*)updateID
+                   ruleCleanup:(SNTRuleCleanup)cleanupType
+            flushDecisionCache:(BOOL*)flushDecisionCache
+                        errors:(NSArray<NSError*>**)errors;
+
+///
+///  Discard a staged rule update without applying it.
+///
+- (void)abortStagedRuleUpdate:(NSString*)updateID;
+
 ///
 /// Wrapper for `addExecutionRules:fileAccessRules:networkFlowRules:signals:ruleCleanup:errors:`
 /// when there are no file access, network flow, or signal rules to add. Used by legacy code paths
@@ -150,6 +259,12 @@
 ///  @return YES if kernel cache should be flushed after adding the new rules.
 - (BOOL)addedRulesShouldFlushDecisionCache:(NSArray*)rules;
 
+///
+///  Same as `addedRulesShouldFlushDecisionCache:`, for the rules in a serialized
+///  santa::rulebatch::ExecutionRuleBatch. Returns YES if the batch cannot be parsed.
+///
+- (BOOL)addedRuleBatchShouldFlushDecisionCache:(NSData*)batch;
+
 ///
 ///  Update timestamp for given rule to the current time.
 ///
@@ -165,6 +280,20 @@
 ///
 - (NSArray<SNTRule*>*)retrieveAllExecutionRules;
 
+///
+///  Enumerate execution rules one at a time, for streaming an export of a large database without
+///  holding every rule in memory. Rules in any of the excluded states are filtered out by the
+///  query. Set stop to YES to end the enumeration early.
+///
+- (void)enumerateExecutionRulesExcludingStates:(NSArray<NSNumber*>*)excludedStates
+                                    usingBlock:(void (^)(SNTRule* rule, BOOL* stop))block;
+
+///
+///  Enumerate the CEL and CELv2 rules, e.g. to compile their expressions ahead of time. Set stop
+///  to YES to end the enumeration early.
+///
+- (void)enumerateCELRulesUsingBlock:(void (^)(SNTRule* rule, BOOL* stop))block;
+
 ///
 ///  Retrieve all file access rules from the database for export.
 ///
@@ -200,6 +329,12 @@
 ///
 @property(readonly) NSDictionary<NSString*, SNTRule*>* cachedStaticRules;
 
+///
+///  Statistics for the filter that lets execution rule lookups which cannot match any rule skip
+///  the database.
+///
+- (struct SNTRuleFilterStats)executionRuleFilterStats;
+
 ///
 ///  Retrieve a hash of all the non-transitive rules in the database.
 ///
@@ -211,6 +346,13 @@
 ///
 @property(readonly, nonatomic) NSDictionary<NSString*, SNTCachedDecision*>* criticalSystemBinaries;
 
+///
+///  The same decisions as criticalSystemBinaries, keyed by the CDHash of each binary. Only valid
+///  for matching a process whose CDHash the kernel strictly enforces.
+///
+@property(readonly, nonatomic)
+    NSDictionary<NSString*, SNTCachedDecision*>* criticalSystemBinariesByCDHash;
+
 ///
 /// If set, this callback is called when file access rule content is changed via
 /// addExecutionRules:fileAccessRules:ruleCleanup:error: with the latest rule count.
@@ -224,4 +366,11 @@
 ///
 @property(copy) void (^signalRulesChangedCallback)(int64_t signalRuleCount);
 
+///
+/// If set, this callback is called after a rule change that inserted any CEL rules, with the latest
+/// number of CEL and CELv2 rules. Rules are only compiled to validate them when added, so
+/// this lets the plans that evaluate them be compiled before the rules first match.
+///
+@property(copy) void (^celRulesChangedCallback)(int64_t celRuleCount);
+
 @end
@@ -16,11 +16,21 @@
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 
 #import <EndpointSecurity/EndpointSecurity.h>
+#include <sqlite3.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Source/common/BloomFilter.h"
 #import "Source/common/CertificateHelpers.h"
+#include "Source/common/ExecTrace.h"
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/MOLCodesignChecker.h"
 #import "Source/common/Platform.h"
+#include "Source/common/RuleBatch.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
@@ -34,6 +44,8 @@
 #import "Source/common/SigningIDHelpers.h"
 #include "Source/common/String.h"
 #include "Source/common/cel/Evaluator.h"
+#include "Source/santad/DataLayer/ExecutionRuleIndex.h"
+#include "absl/hash/hash.h"
 
 static const uint32_t kRuleTableCurrentVersion = 15;
 
@@ -42,6 +54,145 @@ static const int64_t kTransitiveRuleCullingThreshold = 500000;
 // Consider transitive rules out of date if they haven't been used in six months.
 static const NSUInteger kTransitiveRuleExpirationSeconds = 6 * 30 * 24 * 3600;
 
+// Sizing of the execution rule filter. The filter is rebuilt with headroom for
+// another 50% of rules whenever it fills up or rules are bulk-removed.
+static const size_t kRuleFilterMinimumCapacity = 4096;
+static const double kRuleFilterFalsePositiveRate = 0.01;
+
+// Incremental changes are layered over the in-memory rule index until there
+// are this many of them, at which point the index is rebuilt from the database.
+static const size_t kRuleIndexMaxOverlaySize = 4096;
+
+// Staged rules are read back from the staging table this many at a time when a
+// staged update is committed, to bound the number of decoded rules in memory.
+static const int kStagedRuleBatchSize = 1000;
+
+// The kind of rule held in each row of the staged_rules table.
+enum class StagedRuleKind : int {
+  kExecutionRule = 1,
+  kFileAccessRule = 2,
+  kNetworkFlowRule = 3,
+  kSignal = 4,
+  // A serialized santa::rulebatch::ExecutionRuleBatch.
+  kExecutionRuleBatch = 5,
+};
+
+// Applies rule changes to the database within a rule update transaction.
+// Execution rules that were written are added to appliedRules, unless
+// rebuildIndexes is set, in which case the in-memory indexes are rebuilt from
+// the database instead.
+typedef BOOL (^SNTRuleChangesBlock)(FMDatabase* db, NSMutableArray<SNTRule*>* appliedRules,
+                                    BOOL* rebuildIndexes, NSMutableArray<NSError*>* errors);
+
+// Statements for writing execution rules. During a bulk load, rules are instead
+// appended to execution_rules_load, which has no indexes; removals are appended
+// as rows in the remove state and everything is resolved once loading is done.
+static const char* const kInsertExecutionRuleSQL =
+    "INSERT OR REPLACE INTO execution_rules "
+    "(identifier, state, type, custommsg, customurl, timestamp, comment, cel_expr, "
+    "seatbelt_policy, rule_id) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+static const char* const kBulkLoadExecutionRuleSQL =
+    "INSERT INTO execution_rules_load "
+    "(identifier, state, type, custommsg, customurl, timestamp, comment, cel_expr, "
+    "seatbelt_policy, rule_id) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+static const char* const kRemoveExecutionRuleSQL =
+    "DELETE FROM execution_rules WHERE identifier=? AND type=?";
+
+// Whether the cleanup deletes the execution rules, other than transitive
+// rules, before the update's rules are added.
+static bool CleanupReplacesExecutionRules(SNTRuleCleanup cleanupType) {
+  return cleanupType == SNTRuleCleanupAll || cleanupType == SNTRuleCleanupNonTransitive ||
+         cleanupType == SNTRuleCleanupExecutionRules;
+}
+
+static uint64_t RuleFilterHash(std::string_view identifier, SNTRuleType type) {
+  return absl::HashOf(identifier, static_cast<int>(type));
+}
+
+static uint64_t RuleFilterHash(NSString* identifier, SNTRuleType type) {
+  return RuleFilterHash(santa::NSStringToUTF8StringView(identifier), type);
+}
+
+static bool RuleFilterMayContain(const santa::BloomFilter& filter,
+                                 const struct RuleIdentifiers& identifiers) {
+  auto mayContain = [&filter](NSString* identifier, SNTRuleType type) {
+    return identifier.length > 0 && filter.MayContain(RuleFilterHash(identifier, type));
+  };
+  return mayContain(identifiers.cdhash, SNTRuleTypeCDHash) ||
+         mayContain(identifiers.binarySHA256, SNTRuleTypeBinary) ||
+         mayContain(identifiers.signingID, SNTRuleTypeSigningID) ||
+         mayContain(identifiers.certificateSHA256, SNTRuleTypeCertificate) ||
+         mayContain(identifiers.teamID, SNTRuleTypeTeamID);
+}
+
+// A statement prepared once and run repeatedly on the connection of an
+// FMDatabase, so the rules of a batch can be bound straight from its strings
+// without going through FMDB's NSString/NSNumber arguments.
+class PreparedStatement {
+ public:
+  PreparedStatement(FMDatabase* db, const char* sql) {
+    if (sqlite3_prepare_v2(static_cast<sqlite3*>(db.sqliteHandle), sql, -1, &stmt_, nullptr) !=
+        SQLITE_OK) {
+      stmt_ = nullptr;
+    }
+  }
+
+  ~PreparedStatement() { sqlite3_finalize(stmt_); }
+
+  PreparedStatement(const PreparedStatement&) = delete;
+  PreparedStatement& operator=(const PreparedStatement&) = delete;
+
+  explicit operator bool() const { return stmt_ != nullptr; }
+
+  // Empty strings are bound as NULL, as nil properties of an SNTRule are. The
+  // value must outlive the next run of the statement.
+  void BindText(int index, const std::string& value) {
+    if (value.empty()) {
+      sqlite3_bind_null(stmt_, index);
+    } else {
+      sqlite3_bind_text(stmt_, index, value.data(), static_cast<int>(value.size()), SQLITE_STATIC);
+    }
+  }
+
+  // nil is bound as NULL. The string must outlive the next run of the statement.
+  void BindText(int index, NSString* value) {
+    if (!value) {
+      sqlite3_bind_null(stmt_, index);
+    } else {
+      std::string_view view = santa::NSStringToUTF8StringView(value);
+      sqlite3_bind_text(stmt_, index, view.data(), static_cast<int>(view.size()), SQLITE_STATIC);
+    }
+  }
+
+  void BindNull(int index) { sqlite3_bind_null(stmt_, index); }
+
+  void BindInt64(int index, int64_t value) { sqlite3_bind_int64(stmt_, index, value); }
+
+  // Runs the statement to completion, returning whether it succeeded, and
+  // resets it for the next set of values.
+  bool Execute() {
+    int rc = sqlite3_step(stmt_);
+    Reset();
+    return rc == SQLITE_DONE;
+  }
+
+  // Runs a query returning a single integer, such as a count, returning 0 if
+  // there are no rows.
+  int64_t QueryInt64() {
+    int64_t value = sqlite3_step(stmt_) == SQLITE_ROW ? sqlite3_column_int64(stmt_, 0) : 0;
+    Reset();
+    return value;
+  }
+
+ private:
+  void Reset() {
+    sqlite3_reset(stmt_);
+    sqlite3_clear_bindings(stmt_);
+  }
+
+  sqlite3_stmt* stmt_ = nullptr;
+};
+
 static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   // Create a temporary ES client in order to grab the default set of muted paths.
   // TODO(mlw): Reorganize this code so that a temporary ES client doesn't need to be created
@@ -77,11 +228,30 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   std::unique_ptr<santa::cel::Evaluator<false>> _celEvaluator;
   std::unique_ptr<santa::cel::Evaluator<true>> _celV2Evaluator;
   dispatch_once_t _criticalSystemBinariesToken;
+  // Filter over the (identifier, type) pairs of all execution rules, used to
+  // skip the database entirely for lookups that cannot match. Entries are
+  // added before the rule is committed so the filter never yields a false
+  // negative; removed rules linger as false positives until the next rebuild.
+  // Swapped atomically on rebuild, which only happens on the database queue.
+  std::shared_ptr<santa::BloomFilter> _ruleFilter;
+  std::atomic<uint64_t> _ruleFilterSkipped;
+  std::atomic<uint64_t> _ruleFilterMatched;
+  std::atomic<uint64_t> _ruleFilterFalsePositives;
+  // In-memory copy of the execution_rules table used to resolve lookups
+  // without SQLite. The database remains the store of record; the index is
+  // only replaced on the database queue, after the corresponding changes have
+  // been written. Lookups fall back to the database while it is unset.
+  std::shared_ptr<const santa::ExecutionRuleIndex> _ruleIndex;
+  // The static rules from cachedStaticRules indexed like the execution rules,
+  // so lookups don't hash an NSString per identifier. Replaced whenever the
+  // static rules are updated and unset while there are none.
+  std::shared_ptr<const santa::ExecutionRuleIndex> _staticRuleIndex;
 }
 @property MOLCodesignChecker* santadCSInfo;
 @property MOLCodesignChecker* launchdCSInfo;
 @property NSDate* lastTransitiveRuleCulling;
 @property NSDictionary* criticalSystemBinaries;
+@property NSDictionary* criticalSystemBinariesByCDHash;
 @property(readonly) NSArray* criticalSystemBinaryPaths;
 @property(readwrite) NSDictionary<NSString*, SNTRule*>* cachedStaticRules;
 // Cached digest of each rule sub-table. Read/write ONLY inside an inDatabase:/inTransaction:
@@ -93,6 +263,20 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 @property(atomic) NSString* cachedFileAccessRulesHash;
 @property(atomic) NSString* cachedNetworkFlowRulesHash;
 @property(atomic) NSString* cachedSignalRulesHash;
+// The last network-flow ruleset snapshot, under the same rules as the hash caches and cleared
+// with cachedNetworkFlowRulesHash. Registrations and reconciles push the full ruleset to
+// santanetd, so an unchanged ruleset is handed out again rather than re-read and re-copied.
+@property(atomic) SNTNetworkFlowRulesSnapshot* cachedNetworkFlowRulesSnapshot;
+// Identifies the staged rule update whose rules are held in the temporary
+// staged_rules table. Like the hash caches, only accessed on the database queue.
+@property NSString* stagedUpdateID;
+// Set while execution rules are bulk loaded into execution_rules_load. Only
+// accessed on the database queue.
+@property BOOL bulkLoadingExecutionRules;
+// Set when a transaction inserts a CEL rule, so celRulesChangedCallback is only
+// called for changes that can need new plans. Only accessed on the database
+// queue.
+@property BOOL insertedCELRules;
 @end
 
 @implementation SNTRuleTableRulesHash
@@ -181,6 +365,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (void)setupSystemCriticalBinaries {
   NSMutableDictionary* bins = [NSMutableDictionary dictionary];
+  NSMutableDictionary* binsByCDHash = [NSMutableDictionary dictionary];
   for (NSString* path in [SNTRuleTable criticalSystemBinaryPaths]) {
     SNTFileInfo* binInfo = [[SNTFileInfo alloc] initWithPath:path];
     if (!binInfo.SHA256) {
@@ -227,9 +412,13 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
     cd.certCommonName = csInfo.leafCertificate.commonName;
 
     bins[cd.signingID] = cd;
+    if (cd.cdhash.length) {
+      binsByCDHash[cd.cdhash] = cd;
+    }
   }
 
   self.criticalSystemBinaries = bins;
+  self.criticalSystemBinariesByCDHash = binsByCDHash;
 }
 
 - (NSDictionary<NSString*, SNTCachedDecision*>*)criticalSystemBinaries {
@@ -242,12 +431,20 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   return _criticalSystemBinaries;
 }
 
+- (NSDictionary<NSString*, SNTCachedDecision*>*)criticalSystemBinariesByCDHash {
+  dispatch_once(&_criticalSystemBinariesToken, ^{
+    [self setupSystemCriticalBinaries];
+  });
+  return _criticalSystemBinariesByCDHash;
+}
+
 - (uint32_t)currentSupportedVersion {
   return kRuleTableCurrentVersion;
 }
 
 - (uint32_t)initializeDatabase:(FMDatabase*)db fromVersion:(uint32_t)version {
-  // Lock this database from other processes
+  // Lock this database from other processes. This is relaxed if santad enables concurrent reads,
+  // after which tamper resistance alone keeps other processes out of the database and its WAL.
   [[db executeQuery:@"PRAGMA locking_mode = EXCLUSIVE;"] close];
 
   uint32_t newVersion = 0;
@@ -410,22 +607,101 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   // Prime the cached static rules.
   [self updateStaticRules:[[SNTConfigurator configurator] staticRules]];
 
+  [self rebuildExecutionRuleIndexesInDB:db];
+
   return newVersion;
 }
 
+#pragma mark Rule Filter and Index
+
+- (std::shared_ptr<santa::BloomFilter>)executionRuleFilter {
+  return std::atomic_load_explicit(&_ruleFilter, std::memory_order_acquire);
+}
+
+- (std::shared_ptr<const santa::ExecutionRuleIndex>)executionRuleIndex {
+  return std::atomic_load_explicit(&_ruleIndex, std::memory_order_acquire);
+}
+
+- (std::shared_ptr<const santa::ExecutionRuleIndex>)staticRuleIndex {
+  return std::atomic_load_explicit(&_staticRuleIndex, std::memory_order_acquire);
+}
+
+- (void)rebuildExecutionRuleIndexesInDB:(FMDatabase*)db {
+  size_t count = static_cast<size_t>([db longForQuery:@"SELECT COUNT(*) FROM execution_rules"]);
+  auto filter = std::make_shared<santa::BloomFilter>(
+      std::max(count + count / 2, kRuleFilterMinimumCapacity), kRuleFilterFalsePositiveRate);
+  santa::ExecutionRuleIndex::Builder builder(count);
+
+  FMResultSet* rs = [db executeQuery:@"SELECT * FROM execution_rules"];
+  if (!rs) {
+    // Without a complete filter and index lookups must always consult the database.
+    std::atomic_store_explicit(&_ruleIndex, std::shared_ptr<const santa::ExecutionRuleIndex>(),
+                               std::memory_order_release);
+    std::atomic_store_explicit(&_ruleFilter, std::shared_ptr<santa::BloomFilter>(),
+                               std::memory_order_release);
+    return;
+  }
+  while ([rs next]) {
+    @autoreleasepool {
+      filter->Add(RuleFilterHash([rs stringForColumn:@"identifier"],
+                                 static_cast<SNTRuleType>([rs intForColumn:@"type"])));
+      builder.Add([self executionRuleFromResultSet:rs]);
+    }
+  }
+  [rs close];
+
+  std::atomic_store_explicit(&_ruleIndex, builder.Build(), std::memory_order_release);
+  std::atomic_store_explicit(&_ruleFilter, std::move(filter), std::memory_order_release);
+}
+
+// Publishes rules that were just written to the database to the index.
+- (void)updateExecutionRuleIndexWithRules:(NSArray<SNTRule*>*)rules inDB:(FMDatabase*)db {
+  if (rules.count == 0) return;
+
+  std::shared_ptr<const santa::ExecutionRuleIndex> index = [self executionRuleIndex];
+  if (!index || index->OverlaySize() + rules.count > kRuleIndexMaxOverlaySize) {
+    [self rebuildExecutionRuleIndexesInDB:db];
+  } else {
+    std::atomic_store_explicit(&_ruleIndex, index->WithChanges(rules), std::memory_order_release);
+  }
+}
+
+- (struct SNTRuleFilterStats)executionRuleFilterStats {
+  struct SNTRuleFilterStats stats = {
+      .skippedLookups = _ruleFilterSkipped.load(std::memory_order_relaxed),
+      .matchedLookups = _ruleFilterMatched.load(std::memory_order_relaxed),
+      .falsePositiveLookups = _ruleFilterFalsePositives.load(std::memory_order_relaxed),
+  };
+  if (auto filter = [self executionRuleFilter]) {
+    stats.sizeBytes = filter->SizeBytes();
+    stats.entries = filter->Count();
+    stats.estimatedFalsePositiveRate = filter->EstimatedFalsePositiveRate();
+  }
+  return stats;
+}
+
 #pragma mark Entry Counts
 
+// Execution rule counts are answered from the rule index when it's loaded. Its counts are
+// updated with every change published to it, so they match the database without a query.
+
 - (int64_t)executionRuleCount {
+  if (std::shared_ptr<const santa::ExecutionRuleIndex> index = [self executionRuleIndex]) {
+    return index->Count();
+  }
   __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [db longForQuery:@"SELECT COUNT(*) FROM execution_rules"];
   }];
   return count;
 }
 
 - (int64_t)ruleCountForRuleType:(SNTRuleType)ruleType {
+  if (std::shared_ptr<const santa::ExecutionRuleIndex> index = [self executionRuleIndex]) {
+    return index->CountOfType(ruleType);
+  }
   __block int64_t count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [db longForQuery:@"SELECT COUNT(*) FROM execution_rules WHERE type=?", @(ruleType)];
   }];
   return count;
@@ -435,26 +711,38 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   return [self ruleCountForRuleType:SNTRuleTypeBinary];
 }
 
+- (BOOL)hasBinaryRules {
+  if (std::shared_ptr<const santa::ExecutionRuleIndex> index = [self staticRuleIndex]) {
+    if (index->HasRulesOfType(SNTRuleTypeBinary)) return YES;
+  }
+
+  if (std::shared_ptr<const santa::ExecutionRuleIndex> index = [self executionRuleIndex]) {
+    return index->HasRulesOfType(SNTRuleTypeBinary);
+  }
+  return [self binaryRuleCount] > 0;
+}
+
 - (int64_t)certificateRuleCount {
   return [self ruleCountForRuleType:SNTRuleTypeCertificate];
 }
 
-- (int64_t)compilerRuleCount {
-  __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
-    count = [db longForQuery:@"SELECT COUNT(*) FROM execution_rules WHERE state=?",
-                             @(SNTRuleStateAllowCompiler)];
+- (int64_t)ruleCountForRuleState:(SNTRuleState)ruleState {
+  if (std::shared_ptr<const santa::ExecutionRuleIndex> index = [self executionRuleIndex]) {
+    return index->CountInState(ruleState);
+  }
+  __block int64_t count = 0;
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
+    count = [db longForQuery:@"SELECT COUNT(*) FROM execution_rules WHERE state=?", @(ruleState)];
   }];
   return count;
 }
 
+- (int64_t)compilerRuleCount {
+  return [self ruleCountForRuleState:SNTRuleStateAllowCompiler];
+}
+
 - (int64_t)transitiveRuleCount {
-  __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
-    count = [db longForQuery:@"SELECT COUNT(*) FROM execution_rules WHERE state=?",
-                             @(SNTRuleStateAllowTransitive)];
-  }];
-  return count;
+  return [self ruleCountForRuleState:SNTRuleStateAllowTransitive];
 }
 
 - (int64_t)teamIDRuleCount {
@@ -469,13 +757,23 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   return [self ruleCountForRuleType:SNTRuleTypeCDHash];
 }
 
+- (int64_t)celRuleCount {
+  return [self ruleCountForRuleState:SNTRuleStateCEL] +
+         [self ruleCountForRuleState:SNTRuleStateCELv2];
+}
+
+- (int64_t)celRuleCountSerialized:(FMDatabase*)db {
+  return [db longForQuery:@"SELECT COUNT(*) FROM execution_rules WHERE state IN (?, ?)",
+                          @(SNTRuleStateCEL), @(SNTRuleStateCELv2)];
+}
+
 - (int64_t)fileAccessRuleCountSerialized:(FMDatabase*)db {
   return [db longForQuery:@"SELECT COUNT(*) FROM file_access_rules"];
 }
 
 - (int64_t)fileAccessRuleCount {
   __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [self fileAccessRuleCountSerialized:db];
   }];
   return count;
@@ -487,7 +785,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (int64_t)signalRuleCount {
   __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [self signalRuleCountSerialized:db];
   }];
   return count;
@@ -495,7 +793,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (int64_t)networkFlowRuleCount {
   __block NSUInteger count = 0;
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     count = [db longForQuery:@"SELECT COUNT(*) FROM network_flow_rules"];
   }];
   return count;
@@ -538,40 +836,46 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 }
 
 - (SNTRule*)executionRuleForIdentifiers:(struct RuleIdentifiers)identifiers {
-  __block SNTRule* rule;
+  santa::ExecTrace::Span span(santa::ExecTraceStage::kRuleLookup);
+  SNTRule* rule;
+
+  // Look for a static rule that matches. The index checks identifiers in the
+  // same order as given by the SQL query for the rules database.
+  std::shared_ptr<const santa::ExecutionRuleIndex> staticIndex = [self staticRuleIndex];
+  if (staticIndex && (rule = staticIndex->Lookup(identifiers))) {
+    return rule;
+  }
 
-  // Look for a static rule that matches.
-  NSDictionary* staticRules = self.cachedStaticRules;
-  if (staticRules.count) {
-    // IMPORTANT: The order static rules are checked here should be the same
-    // order as given by the SQL query for the rules database.
-    rule = staticRules[identifiers.cdhash];
-    if (rule.type == SNTRuleTypeCDHash) {
-      return rule;
-    }
+  // Most executions match no explicit rule. Skip the database when no
+  // identifier can possibly match.
+  std::shared_ptr<santa::BloomFilter> filter = [self executionRuleFilter];
+  if (filter && !RuleFilterMayContain(*filter, identifiers)) {
+    _ruleFilterSkipped.fetch_add(1, std::memory_order_relaxed);
+    return nil;
+  }
 
-    rule = staticRules[identifiers.binarySHA256];
-    if (rule.type == SNTRuleTypeBinary) {
-      return rule;
-    }
+  // Resolve the rule from the in-memory index when available.
+  std::shared_ptr<const santa::ExecutionRuleIndex> index = [self executionRuleIndex];
+  if (index) {
+    rule = index->Lookup(identifiers);
+  } else {
+    rule = [self databaseExecutionRuleForIdentifiers:identifiers];
+  }
 
-    rule = staticRules[identifiers.signingID];
-    if (rule.type == SNTRuleTypeSigningID) {
-      return rule;
-    }
+  if (filter && rule) {
+    _ruleFilterMatched.fetch_add(1, std::memory_order_relaxed);
+  } else if (filter) {
+    _ruleFilterFalsePositives.fetch_add(1, std::memory_order_relaxed);
+  }
 
-    rule = staticRules[identifiers.certificateSHA256];
-    if (rule.type == SNTRuleTypeCertificate) {
-      return rule;
-    }
+  return rule;
+}
 
-    rule = staticRules[identifiers.teamID];
-    if (rule.type == SNTRuleTypeTeamID) {
-      return rule;
-    }
-  }
+- (SNTRule*)databaseExecutionRuleForIdentifiers:(struct RuleIdentifiers)identifiers {
+  santa::ExecTrace::Span span(santa::ExecTraceStage::kSQLite);
+  __block SNTRule* rule;
 
-  // Now query the database.
+  // Query the database.
   //
   // The intended order of precedence is CDHash > Binaries > Signing IDs > Certificates > Team IDs.
   // The UNION ALL structure lets SQLite evaluate each sub-select independently (potentially
@@ -580,7 +884,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   //
   // There is a test for this in SNTRuleTableTests in case SQLite behavior changes in the future.
   //
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     FMResultSet* rs =
         [db executeQuery:@"SELECT * FROM ("
                          @"  SELECT * FROM execution_rules WHERE identifier=? AND type=500 "
@@ -696,9 +1000,38 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   return YES;
 }
 
+// Returns an error if the CEL expression of a rule in the given state does not compile.
+- (NSError*)errorForCELExpression:(std::string_view)expr state:(SNTRuleState)state {
+  google::protobuf::Arena arena;
+  absl::StatusOr<std::unique_ptr<::google::api::expr::runtime::CelExpression>> celExpr;
+  if (state == SNTRuleStateCEL && _celEvaluator != nullptr) {
+    celExpr = _celEvaluator->Compile(expr, &arena);
+  } else if (state == SNTRuleStateCELv2 && _celV2Evaluator != nullptr) {
+    celExpr = _celV2Evaluator->Compile(expr, &arena);
+  }
+  if (celExpr.ok()) return nil;
+  return [SNTError createErrorWithCode:SNTErrorCodeRuleInvalidCELExpression
+                               message:@"Rule array contained rule with invalid CEL expression"
+                                detail:santa::StringToNSString(celExpr.status().message())];
+}
+
 - (BOOL)addExecutionRules:(NSArray<SNTRule*>*)executionRules
                      toDB:(FMDatabase*)db
+             appliedRules:(NSMutableArray<SNTRule*>*)appliedRules
                    errors:(NSMutableArray<NSError*>*)errors {
+  std::shared_ptr<santa::BloomFilter> filter = [self executionRuleFilter];
+
+  BOOL bulkLoad = self.bulkLoadingExecutionRules;
+  PreparedStatement removeRule(db, kRemoveExecutionRuleSQL);
+  PreparedStatement insertRule(db, bulkLoad ? kBulkLoadExecutionRuleSQL : kInsertExecutionRuleSQL);
+  if (!removeRule || !insertRule) {
+    [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                            message:@"A database error occurred while preparing "
+                                                    @"to insert rules"
+                                             detail:[db lastErrorMessage]]];
+    return NO;
+  }
+
   for (SNTRule* rule in executionRules) {
     if (![rule isKindOfClass:[SNTRule class]] || rule.identifier.length == 0 ||
         rule.state == SNTRuleStateUnknown || rule.type == SNTRuleTypeUnknown) {
@@ -711,26 +1044,111 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
     }
 
     if (rule.state == SNTRuleStateCEL || rule.state == SNTRuleStateCELv2) {
-      google::protobuf::Arena arena;
-      absl::StatusOr<std::unique_ptr<::google::api::expr::runtime::CelExpression>> celExpr;
-      if (rule.state == SNTRuleStateCEL && _celEvaluator != nullptr) {
-        celExpr = _celEvaluator->Compile(santa::NSStringToUTF8StringView(rule.celExpr), &arena);
-      } else if (rule.state == SNTRuleStateCELv2 && _celV2Evaluator != nullptr) {
-        celExpr = _celV2Evaluator->Compile(santa::NSStringToUTF8StringView(rule.celExpr), &arena);
+      NSError* celError = [self errorForCELExpression:santa::NSStringToUTF8StringView(rule.celExpr)
+                                                state:rule.state];
+      if (celError) {
+        [errors addObject:celError];
+        continue;
       }
-      if (!celExpr.ok()) {
-        [errors addObject:
-                    [SNTError
-                        createErrorWithCode:SNTErrorCodeRuleInvalidCELExpression
-                                    message:@"Rule array contained rule with invalid CEL expression"
-                                     detail:santa::StringToNSString(celExpr.status().message())]];
+      self.insertedCELRules = YES;
+    }
+
+    if (rule.state == SNTRuleStateRemove && !bulkLoad) {
+      removeRule.BindText(1, rule.identifier);
+      removeRule.BindInt64(2, rule.type);
+      if (!removeRule.Execute()) {
+        [errors addObject:[SNTError
+                              createErrorWithCode:SNTErrorCodeRemoveRuleFailed
+                                          message:@"A database error occurred while deleting a rule"
+                                           detail:[db lastErrorMessage]]];
+        return NO;
+      }
+      [appliedRules addObject:rule];
+    } else {
+      // Publish to the filter before the rule can be committed so concurrent
+      // lookups never skip a rule that is visible in the database.
+      if (filter && rule.state != SNTRuleStateRemove) {
+        filter->Add(RuleFilterHash(rule.identifier, rule.type));
+      }
+
+      insertRule.BindText(1, rule.identifier);
+      insertRule.BindInt64(2, rule.state);
+      insertRule.BindInt64(3, rule.type);
+      insertRule.BindText(4, rule.customMsg);
+      insertRule.BindText(5, rule.customURL);
+      insertRule.BindInt64(6, rule.timestamp);
+      insertRule.BindText(7, rule.comment);
+      insertRule.BindText(8, rule.celExpr);
+      insertRule.BindText(9, rule.seatbeltPolicy);
+      insertRule.BindInt64(10, rule.ruleId);
+      if (!insertRule.Execute()) {
+        [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                                message:@"A database error occurred while "
+                                                        @"inserting/replacing a rule"
+                                                 detail:[db lastErrorMessage]]];
+        return NO;
+      }
+      [appliedRules addObject:rule];
+    }
+  }
+
+  return YES;
+}
+
+// Same as addExecutionRules:toDB:appliedRules:errors:, for the rules of a batch.
+// Applied rules are only materialized while the in-memory index can still be
+// updated incrementally; a larger batch sets rebuildIndexes instead.
+- (BOOL)addExecutionRuleBatch:(const santa::ExecutionRuleBatch&)batch
+                         toDB:(FMDatabase*)db
+                 appliedRules:(NSMutableArray<SNTRule*>*)appliedRules
+               rebuildIndexes:(BOOL*)rebuildIndexes
+                       errors:(NSMutableArray<NSError*>*)errors {
+  std::shared_ptr<santa::BloomFilter> filter = [self executionRuleFilter];
+
+  BOOL bulkLoad = self.bulkLoadingExecutionRules;
+  PreparedStatement removeRule(db, kRemoveExecutionRuleSQL);
+  PreparedStatement insertRule(db, bulkLoad ? kBulkLoadExecutionRuleSQL : kInsertExecutionRuleSQL);
+  if (!removeRule || !insertRule) {
+    [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                            message:@"A database error occurred while preparing "
+                                                    @"to insert rules"
+                                             detail:[db lastErrorMessage]]];
+    return NO;
+  }
+
+  if (!*rebuildIndexes && appliedRules.count + static_cast<NSUInteger>(batch.rules_size()) >
+                                 kRuleIndexMaxOverlaySize) {
+    *rebuildIndexes = YES;
+    [appliedRules removeAllObjects];
+  }
+
+  // Transitive rules start out as last used now, as when created through SNTRule.
+  int64_t now = static_cast<int64_t>([[NSDate date] timeIntervalSinceReferenceDate]);
+
+  for (const santa::ExecutionRuleBatch::Rule& rule : batch.rules()) {
+    SNTRuleState state = static_cast<SNTRuleState>(rule.state());
+    SNTRuleType type = static_cast<SNTRuleType>(rule.type());
+    if (rule.identifier().empty() || state == SNTRuleStateUnknown || type == SNTRuleTypeUnknown) {
+      [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeRuleInvalid
+                                              message:@"Execution rule batch contained invalid "
+                                                      @"entry"
+                                               detail:santa::StringToNSString(rule.identifier())]];
+      return NO;
+    }
+
+    if (state == SNTRuleStateCEL || state == SNTRuleStateCELv2) {
+      NSError* celError = [self errorForCELExpression:rule.cel_expr() state:state];
+      if (celError) {
+        [errors addObject:celError];
         continue;
       }
+      self.insertedCELRules = YES;
     }
 
-    if (rule.state == SNTRuleStateRemove) {
-      if (![db executeUpdate:@"DELETE FROM execution_rules WHERE identifier=? AND type=?",
-                             rule.identifier, @(rule.type)]) {
+    if (state == SNTRuleStateRemove && !bulkLoad) {
+      removeRule.BindText(1, rule.identifier());
+      removeRule.BindInt64(2, type);
+      if (!removeRule.Execute()) {
         [errors addObject:[SNTError
                               createErrorWithCode:SNTErrorCodeRemoveRuleFailed
                                           message:@"A database error occurred while deleting a rule"
@@ -738,13 +1156,22 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
         return NO;
       }
     } else {
-      if (![db executeUpdate:@"INSERT OR REPLACE INTO execution_rules "
-                             @"(identifier, state, type, custommsg, customurl, timestamp, "
-                             @"comment, cel_expr, seatbelt_policy, rule_id) "
-                             @"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);",
-                             rule.identifier, @(rule.state), @(rule.type), rule.customMsg,
-                             rule.customURL, @(rule.timestamp), rule.comment, rule.celExpr,
-                             rule.seatbeltPolicy, @(rule.ruleId)]) {
+      // As for unbatched rules, publish to the filter before the rule can be committed.
+      if (filter && state != SNTRuleStateRemove) {
+        filter->Add(RuleFilterHash(rule.identifier(), type));
+      }
+
+      insertRule.BindText(1, rule.identifier());
+      insertRule.BindInt64(2, state);
+      insertRule.BindInt64(3, type);
+      insertRule.BindText(4, rule.custom_msg());
+      insertRule.BindText(5, rule.custom_url());
+      insertRule.BindInt64(6, state == SNTRuleStateAllowTransitive ? now : 0);
+      insertRule.BindNull(7);
+      insertRule.BindText(8, rule.cel_expr());
+      insertRule.BindText(9, rule.seatbelt_policy());
+      insertRule.BindInt64(10, rule.rule_id());
+      if (!insertRule.Execute()) {
         [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
                                                 message:@"A database error occurred while "
                                                         @"inserting/replacing a rule"
@@ -752,6 +1179,17 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
         return NO;
       }
     }
+
+    if (!*rebuildIndexes) {
+      if (SNTRule* appliedRule = santa::RuleFromBatchRule(rule)) {
+        [appliedRules addObject:appliedRule];
+      } else {
+        // Not expected for a rule that passed the checks above, but the index
+        // must not miss it.
+        *rebuildIndexes = YES;
+        [appliedRules removeAllObjects];
+      }
+    }
   }
 
   return YES;
@@ -774,6 +1212,22 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
                   signals:(NSArray<SNTSignal*>*)signals
               ruleCleanup:(SNTRuleCleanup)cleanupType
                    errors:(NSArray<NSError*>**)errors {
+  return [self addExecutionRules:executionRules
+                 fileAccessRules:fileAccessRules
+                networkFlowRules:networkFlowRules
+                         signals:signals
+                     ruleCleanup:cleanupType
+              flushDecisionCache:NULL
+                          errors:errors];
+}
+
+- (BOOL)addExecutionRules:(NSArray<SNTRule*>*)executionRules
+          fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+         networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                  signals:(NSArray<SNTSignal*>*)signals
+              ruleCleanup:(SNTRuleCleanup)cleanupType
+       flushDecisionCache:(BOOL*)flushDecisionCache
+                   errors:(NSArray<NSError*>**)errors {
   // Only accept all-empty rule arrays if the cleanup-type is not none.
   if (executionRules.count == 0 && fileAccessRules.count == 0 && networkFlowRules.count == 0 &&
       signals.count == 0 && cleanupType == SNTRuleCleanupNone) {
@@ -785,6 +1239,36 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
     return NO;
   }
 
+  return [self applyRuleChangesWithCleanup:cleanupType
+                        flushDecisionCache:flushDecisionCache
+                                    errors:errors
+                                usingBlock:^BOOL(FMDatabase* db,
+                                                 NSMutableArray<SNTRule*>* appliedRules,
+                                                 BOOL* rebuildIndexes,
+                                                 NSMutableArray<NSError*>* blockErrors) {
+                                  return [self addExecutionRules:executionRules
+                                                            toDB:db
+                                                    appliedRules:appliedRules
+                                                          errors:blockErrors] &&
+                                         [self addFileAccessRules:fileAccessRules
+                                                             toDB:db
+                                                           errors:blockErrors] &&
+                                         [self addNetworkFlowRules:networkFlowRules
+                                                              toDB:db
+                                                            errors:blockErrors] &&
+                                         [self addSignals:signals toDB:db errors:blockErrors];
+                                }];
+}
+
+// Performs the cleanup and then applies the changes made by block within a
+// single transaction, publishing the results to the in-memory indexes and the
+// rules changed callbacks.
+- (BOOL)applyRuleChangesWithCleanup:(SNTRuleCleanup)cleanupType
+                 flushDecisionCache:(BOOL*)flushDecisionCache
+                             errors:(NSArray<NSError*>**)errors
+                         usingBlock:(SNTRuleChangesBlock)block {
+  bool compareExecutionRules = CleanupReplacesExecutionRules(cleanupType);
+  __block BOOL executionRulesShouldFlush = NO;
   __block BOOL failed = NO;
   __block NSMutableArray<NSError*>* blockErrors = [NSMutableArray array];
   __block NSString* faaRulesHashBefore;
@@ -793,13 +1277,33 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   __block NSString* signalRulesHashBefore;
   __block NSString* signalRulesHashAfter;
   __block int64_t signalRuleCount = 0;
+  __block BOOL celRulesInserted = NO;
+  __block int64_t celRuleCount = 0;
+  NSMutableArray<SNTRule*>* appliedRules = [NSMutableArray array];
 
   [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
+    self.insertedCELRules = NO;
     faaRulesHashBefore = [self fileAccessRulesHashSerialized:db];
     signalRulesHashBefore = [self signalRulesHashSerialized:db];
+    if (compareExecutionRules && ![self snapshotExecutionRulesInDB:db]) {
+      [blockErrors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                                   message:@"A database error occurred while "
+                                                           @"preparing to replace rules"
+                                                    detail:[db lastErrorMessage]]];
+      *rollback = failed = YES;
+      return;
+    }
     switch (cleanupType) {
       case SNTRuleCleanupAll:
-        [db executeUpdate:@"DELETE FROM execution_rules"];
+        // Execution rules are replaced by a bulk load instead.
+        if (![self beginBulkLoadInDB:db]) {
+          [blockErrors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                                       message:@"A database error occurred while "
+                                                               @"preparing to replace all rules"
+                                                        detail:[db lastErrorMessage]]];
+          *rollback = failed = YES;
+          return;
+        }
         [db executeUpdate:@"DELETE FROM file_access_rules"];
         [db executeUpdate:@"DELETE FROM network_flow_rules"];
         [db executeUpdate:@"DELETE FROM signal_rules"];
@@ -824,22 +1328,19 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
         break;
     }
 
-    if (![self addExecutionRules:executionRules toDB:db errors:blockErrors]) {
-      *rollback = failed = YES;
-      return;
-    }
-
-    if (![self addFileAccessRules:fileAccessRules toDB:db errors:blockErrors]) {
-      *rollback = failed = YES;
-      return;
-    }
-
-    if (![self addNetworkFlowRules:networkFlowRules toDB:db errors:blockErrors]) {
-      *rollback = failed = YES;
-      return;
+    BOOL rebuildIndexes = NO;
+    BOOL applied = block(db, appliedRules, &rebuildIndexes, blockErrors);
+    if (self.bulkLoadingExecutionRules) {
+      self.bulkLoadingExecutionRules = NO;
+      if (applied && ![self finishBulkLoadInDB:db]) {
+        [blockErrors addObject:[SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                                     message:@"A database error occurred while "
+                                                             @"replacing all rules"
+                                                      detail:[db lastErrorMessage]]];
+        applied = NO;
+      }
     }
-
-    if (![self addSignals:signals toDB:db errors:blockErrors]) {
+    if (!applied) {
       *rollback = failed = YES;
       return;
     }
@@ -848,11 +1349,36 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
     self.cachedExecutionRulesHash = nil;
     self.cachedFileAccessRulesHash = nil;
     self.cachedNetworkFlowRulesHash = nil;
+    self.cachedNetworkFlowRulesSnapshot = nil;
 
     faaRulesHashAfter = [self fileAccessRulesHashSerialized:db];
     faaRuleCount = [self fileAccessRuleCountSerialized:db];
+
+    // Nothing below can fail the transaction, so publish the changes to the
+    // filter and index now. Doing so on the database queue keeps concurrent
+    // transactions from publishing out of order. Bulk removals rebuild both
+    // from the new state to drop removed rules and restore the filter's
+    // target false positive rate; until then the existing filter is a
+    // superset.
+    std::shared_ptr<santa::BloomFilter> filter = [self executionRuleFilter];
+    if (rebuildIndexes || compareExecutionRules ||
+        (filter && filter->Count() > filter->Capacity())) {
+      [self rebuildExecutionRuleIndexesInDB:db];
+    } else {
+      [self updateExecutionRuleIndexWithRules:appliedRules inDB:db];
+    }
+
+    if (compareExecutionRules) {
+      executionRulesShouldFlush = [self executionRulesChangedShouldFlushDecisionCacheInDB:db];
+    }
+
     signalRulesHashAfter = [self signalRulesHashSerialized:db];
     signalRuleCount = [self signalRuleCountSerialized:db];
+
+    celRulesInserted = self.insertedCELRules;
+    if (celRulesInserted) {
+      celRuleCount = [self celRuleCountSerialized:db];
+    }
   }];
 
   if (blockErrors.count > 0 && errors) {
@@ -868,10 +1394,413 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
       ![signalRulesHashBefore isEqualToString:signalRulesHashAfter]) {
     self.signalRulesChangedCallback(signalRuleCount);
   }
+  if (!failed && self.celRulesChangedCallback && celRulesInserted) {
+    self.celRulesChangedCallback(celRuleCount);
+  }
+
+  if (flushDecisionCache) {
+    if (failed || cleanupType == SNTRuleCleanupNone) {
+      *flushDecisionCache = NO;
+    } else if (compareExecutionRules) {
+      *flushDecisionCache = executionRulesShouldFlush ||
+                            ![faaRulesHashBefore isEqualToString:faaRulesHashAfter];
+    } else {
+      *flushDecisionCache = YES;
+    }
+  }
 
   return !failed;
 }
 
+#pragma mark Bulk Loading
+
+// Updates that replace all rules load the new execution rules into a table
+// without indexes rather than deleting every rule and maintaining the unique
+// index across each insert. Once loaded, the rules are resolved, indexed in one
+// pass and the table is swapped in for execution_rules, all within the update
+// transaction. As with any other update, the in-memory index is then rebuilt
+// from the new table and published before the transaction commits, so lookups
+// answered from it see the new rules from that point on.
+- (BOOL)beginBulkLoadInDB:(FMDatabase*)db {
+  // Must match the execution_rules schema from initializeDatabase:fromVersion:.
+  self.bulkLoadingExecutionRules =
+      [db executeUpdate:@"DROP TABLE IF EXISTS execution_rules_load"] &&
+      [db executeUpdate:@"CREATE TABLE execution_rules_load ("
+                        @"'identifier' TEXT NOT NULL, "
+                        @"'state' INTEGER NOT NULL, "
+                        @"'type' INTEGER NOT NULL, "
+                        @"'custommsg' TEXT, "
+                        @"'timestamp' INTEGER, "
+                        @"'customurl' TEXT, "
+                        @"'comment' TEXT, "
+                        @"'cel_expr' TEXT, "
+                        @"'rule_id' INTEGER DEFAULT 0, "
+                        @"'seatbelt_policy' TEXT)"];
+  return self.bulkLoadingExecutionRules;
+}
+
+- (BOOL)finishBulkLoadInDB:(FMDatabase*)db {
+  // As with INSERT OR REPLACE, the last row loaded for a rule wins, and rules
+  // last loaded as removals are dropped. Rows are appended in rowid order.
+  return [db executeUpdate:@"DELETE FROM execution_rules_load WHERE rowid NOT IN "
+                           @"(SELECT MAX(rowid) FROM execution_rules_load "
+                           @"GROUP BY identifier, type)"] &&
+         [db executeUpdate:@"DELETE FROM execution_rules_load WHERE state=?",
+                           @(SNTRuleStateRemove)] &&
+         [db executeUpdate:@"DROP TABLE execution_rules"] &&
+         [db executeUpdate:@"ALTER TABLE execution_rules_load RENAME TO execution_rules"] &&
+         [db executeUpdate:@"CREATE UNIQUE INDEX execution_rules_unique ON execution_rules "
+                           @"('identifier', type)"];
+}
+
+#pragma mark Rule Change Comparison
+
+// Without knowing which rules a cleanup removed, cached decisions would have
+// to be flushed after every update that replaces the execution rules. Instead,
+// the columns that decisions depend on are copied aside before the cleanup and
+// compared with the resulting rules once the update has been applied.
+- (BOOL)snapshotExecutionRulesInDB:(FMDatabase*)db {
+  return [db executeUpdate:@"DROP TABLE IF EXISTS temp.execution_rules_before"] &&
+         [db executeUpdate:@"CREATE TEMP TABLE execution_rules_before AS "
+                           @"SELECT identifier, type, state, cel_expr, seatbelt_policy "
+                           @"FROM execution_rules"];
+}
+
+// Only allow decisions are cached by ES, and denials cached in userspace
+// expire quickly, so caches only need to be flushed when a rule that may have
+// allowed an execution was changed or removed, or a rule other than a plain
+// allow rule was added or changed. As with addedRulesShouldFlushDecisionCache:,
+// this includes an allow rule replacing a compiler rule.
+- (BOOL)executionRulesChangedShouldFlushDecisionCacheInDB:(FMDatabase*)db {
+  FMResultSet* rs =
+      [db executeQuery:@"SELECT 1 FROM ("
+                       @"SELECT identifier, type, state, cel_expr, seatbelt_policy "
+                       @"FROM execution_rules EXCEPT SELECT * FROM temp.execution_rules_before"
+                       @") WHERE state != ? "
+                       @"UNION ALL SELECT 1 FROM ("
+                       @"SELECT * FROM temp.execution_rules_before EXCEPT "
+                       @"SELECT identifier, type, state, cel_expr, seatbelt_policy "
+                       @"FROM execution_rules"
+                       @") WHERE state NOT IN (?, ?, ?, ?) LIMIT 1",
+                       @(SNTRuleStateAllow), @(SNTRuleStateBlock), @(SNTRuleStateSilentBlock),
+                       @(SNTRuleStateSilentBlockGUI), @(SNTRuleStateSilentBlockTTY)];
+  // Act conservatively if the rules could not be compared.
+  BOOL changed = !rs || [rs next] || [db hadError];
+  [rs close];
+  [db executeUpdate:@"DROP TABLE IF EXISTS temp.execution_rules_before"];
+  return changed;
+}
+
+#pragma mark Staged Rule Updates
+
+- (NSString*)beginStagedRuleUpdate {
+  NSString* updateID = [[NSUUID UUID] UUIDString];
+  __block BOOL created = NO;
+  [self inDatabase:^(FMDatabase* db) {
+    // Any update that was never committed is superseded by this one.
+    [db executeUpdate:@"DROP TABLE IF EXISTS temp.staged_rules"];
+    created = [db executeUpdate:@"CREATE TEMP TABLE staged_rules ("
+                                @"seq INTEGER PRIMARY KEY, "
+                                @"kind INTEGER NOT NULL, "
+                                @"data BLOB NOT NULL)"];
+    self.stagedUpdateID = created ? updateID : nil;
+  }];
+  if (!created) {
+    LOGE(@"Failed to create the staged rules table");
+    return nil;
+  }
+  return updateID;
+}
+
+- (BOOL)stageExecutionRules:(NSArray<SNTRule*>*)executionRules
+            fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+           networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                    signals:(NSArray<SNTSignal*>*)signals
+                   updateID:(NSString*)updateID
+                     errors:(NSArray<NSError*>**)errors {
+  __block NSError* error;
+  [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
+    if (![self.stagedUpdateID isEqualToString:updateID]) {
+      error = [SNTError createErrorWithCode:SNTErrorCodeStagedUpdateInvalid
+                                     format:@"No staged rule update with ID %@", updateID];
+      return;
+    }
+
+    BOOL (^stage)(NSArray*, StagedRuleKind) = ^BOOL(NSArray* rules, StagedRuleKind kind) {
+      for (id rule in rules) {
+        @autoreleasepool {
+          NSError* archiveError;
+          NSData* data = [NSKeyedArchiver archivedDataWithRootObject:rule
+                                               requiringSecureCoding:YES
+                                                               error:&archiveError];
+          if (!data) {
+            error = [SNTError createErrorWithCode:SNTErrorCodeRuleInvalid
+                                          message:@"Failed to stage a rule"
+                                           detail:archiveError.localizedDescription];
+            return NO;
+          }
+          if (![db executeUpdate:@"INSERT INTO staged_rules (kind, data) VALUES (?, ?)",
+                                 @(static_cast<int>(kind)), data]) {
+            error = [SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                          message:@"A database error occurred while staging "
+                                                  @"a rule"
+                                           detail:[db lastErrorMessage]];
+            return NO;
+          }
+        }
+      }
+      return YES;
+    };
+
+    if (!stage(executionRules, StagedRuleKind::kExecutionRule) ||
+        !stage(fileAccessRules, StagedRuleKind::kFileAccessRule) ||
+        !stage(networkFlowRules, StagedRuleKind::kNetworkFlowRule) ||
+        !stage(signals, StagedRuleKind::kSignal)) {
+      *rollback = YES;
+    }
+  }];
+
+  if (error) {
+    if (errors) *errors = @[ error ];
+    return NO;
+  }
+  return YES;
+}
+
+- (BOOL)stageExecutionRuleBatch:(NSData*)batch
+                       updateID:(NSString*)updateID
+                         errors:(NSArray<NSError*>**)errors {
+  __block NSError* error;
+  [self inDatabase:^(FMDatabase* db) {
+    if (![self.stagedUpdateID isEqualToString:updateID]) {
+      error = [SNTError createErrorWithCode:SNTErrorCodeStagedUpdateInvalid
+                                     format:@"No staged rule update with ID %@", updateID];
+      return;
+    }
+    // The batch is only parsed when the update is committed.
+    if (![db executeUpdate:@"INSERT INTO staged_rules (kind, data) VALUES (?, ?)",
+                           @(static_cast<int>(StagedRuleKind::kExecutionRuleBatch)), batch]) {
+      error = [SNTError createErrorWithCode:SNTErrorCodeInsertOrReplaceRuleFailed
+                                    message:@"A database error occurred while staging a rule batch"
+                                     detail:[db lastErrorMessage]];
+    }
+  }];
+
+  if (error) {
+    if (errors) *errors = @[ error ];
+    return NO;
+  }
+  return YES;
+}
+
+// Reads back the staged rules of one kind in batches, in the order they were
+// staged, passing each batch to block. If batchBlock is set, staged rule
+// batches are passed to it in the same order.
+- (BOOL)enumerateStagedRulesOfKind:(StagedRuleKind)kind
+                             class:(Class)cls
+                              inDB:(FMDatabase*)db
+                            errors:(NSMutableArray<NSError*>*)errors
+                        usingBlock:(BOOL (^)(NSArray* rules))block
+                        batchBlock:(BOOL (^)(NSData* batch))batchBlock {
+  int batchKind = static_cast<int>(batchBlock ? StagedRuleKind::kExecutionRuleBatch : kind);
+  int64_t lastSeq = 0;
+  while (true) {
+    @autoreleasepool {
+      NSMutableArray* rules = [NSMutableArray arrayWithCapacity:kStagedRuleBatchSize];
+      FMResultSet* rs = [db executeQuery:@"SELECT seq, kind, data FROM staged_rules "
+                                         @"WHERE kind IN (?, ?) AND seq > ? ORDER BY seq LIMIT ?",
+                                         @(static_cast<int>(kind)), @(batchKind), @(lastSeq),
+                                         @(kStagedRuleBatchSize)];
+      if (!rs) {
+        [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeStagedUpdateInvalid
+                                                message:@"A database error occurred while "
+                                                        @"reading staged rules"
+                                                 detail:[db lastErrorMessage]]];
+        return NO;
+      }
+      int rows = 0;
+      while ([rs next]) {
+        rows++;
+        lastSeq = [rs longLongIntForColumn:@"seq"];
+        if (batchBlock && [rs intForColumn:@"kind"] == batchKind) {
+          // Rules staged ahead of the batch are applied first to keep the staged order.
+          BOOL applied =
+              (rules.count == 0 || block(rules)) && batchBlock([rs dataForColumn:@"data"]);
+          [rules removeAllObjects];
+          if (!applied) {
+            [rs close];
+            return NO;
+          }
+          continue;
+        }
+
+        NSError* unarchiveError;
+        id rule = [NSKeyedUnarchiver unarchivedObjectOfClass:cls
+                                                    fromData:[rs dataForColumn:@"data"]
+                                                       error:&unarchiveError];
+        if (!rule) {
+          [rs close];
+          [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeRuleInvalid
+                                                  message:@"Failed to read a staged rule"
+                                                   detail:unarchiveError.localizedDescription]];
+          return NO;
+        }
+        [rules addObject:rule];
+      }
+      [rs close];
+
+      if (rules.count > 0 && !block(rules)) return NO;
+      if (rows < kStagedRuleBatchSize) return YES;
+    }
+  }
+}
+
+- (BOOL)addExecutionRuleBatchData:(NSData*)data
+                              toDB:(FMDatabase*)db
+                      appliedRules:(NSMutableArray<SNTRule*>*)appliedRules
+                    rebuildIndexes:(BOOL*)rebuildIndexes
+                            errors:(NSMutableArray<NSError*>*)errors {
+  santa::ExecutionRuleBatch batch;
+  if (!batch.ParseFromArray(data.bytes, static_cast<int>(data.length))) {
+    [errors addObject:[SNTError createErrorWithCode:SNTErrorCodeRuleInvalid
+                                             format:@"Failed to read a staged rule batch"]];
+    return NO;
+  }
+  return [self addExecutionRuleBatch:batch
+                                toDB:db
+                        appliedRules:appliedRules
+                      rebuildIndexes:rebuildIndexes
+                              errors:errors];
+}
+
+// Applies all staged rules, in the same order as for an unstaged update.
+- (BOOL)applyStagedRulesToDB:(FMDatabase*)db
+                appliedRules:(NSMutableArray<SNTRule*>*)appliedRules
+              rebuildIndexes:(BOOL*)rebuildIndexes
+                      errors:(NSMutableArray<NSError*>*)errors {
+  BOOL ok = [self enumerateStagedRulesOfKind:StagedRuleKind::kExecutionRule
+                                       class:[SNTRule class]
+                                        inDB:db
+                                      errors:errors
+                                  usingBlock:^BOOL(NSArray* rules) {
+                                    if (![self addExecutionRules:rules
+                                                            toDB:db
+                                                    appliedRules:appliedRules
+                                                          errors:errors]) {
+                                      return NO;
+                                    }
+                                    // Past this many changes the index rebuilds itself anyway,
+                                    // so stop holding on to the applied rules.
+                                    if (appliedRules.count > kRuleIndexMaxOverlaySize) {
+                                      *rebuildIndexes = YES;
+                                      [appliedRules removeAllObjects];
+                                    }
+                                    return YES;
+                                  }
+                                  batchBlock:^BOOL(NSData* batch) {
+                                    return [self addExecutionRuleBatchData:batch
+                                                                      toDB:db
+                                                              appliedRules:appliedRules
+                                                            rebuildIndexes:rebuildIndexes
+                                                                    errors:errors];
+                                  }];
+  ok = ok && [self enumerateStagedRulesOfKind:StagedRuleKind::kFileAccessRule
+                                        class:[SNTFileAccessRule class]
+                                         inDB:db
+                                       errors:errors
+                                   usingBlock:^BOOL(NSArray* rules) {
+                                     return [self addFileAccessRules:rules toDB:db errors:errors];
+                                   }
+                                   batchBlock:nil];
+  ok = ok && [self enumerateStagedRulesOfKind:StagedRuleKind::kNetworkFlowRule
+                                        class:[SNTNetworkFlowRule class]
+                                         inDB:db
+                                       errors:errors
+                                   usingBlock:^BOOL(NSArray* rules) {
+                                     return [self addNetworkFlowRules:rules toDB:db errors:errors];
+                                   }
+                                   batchBlock:nil];
+  ok = ok && [self enumerateStagedRulesOfKind:StagedRuleKind::kSignal
+                                        class:[SNTSignal class]
+                                         inDB:db
+                                       errors:errors
+                                   usingBlock:^BOOL(NSArray* rules) {
+                                     return [self addSignals:rules toDB:db errors:errors];
+                                   }
+                                   batchBlock:nil];
+  return ok;
+}
+
+- (BOOL)commitStagedRuleUpdate:(NSString*)updateID
+                   ruleCleanup:(SNTRuleCleanup)cleanupType
+                        errors:(NSArray<NSError*>**)errors {
+  return [self commitStagedRuleUpdate:updateID
+                          ruleCleanup:cleanupType
+                   flushDecisionCache:NULL
+                               errors:errors];
+}
+
+- (BOOL)commitStagedRuleUpdate:(NSString*)updateID
+                   ruleCleanup:(SNTRuleCleanup)cleanupType
+            flushDecisionCache:(BOOL*)flushDecisionCache
+                        errors:(NSArray<NSError*>**)errors {
+  if (flushDecisionCache) *flushDecisionCache = NO;
+
+  __block BOOL valid = NO;
+  __block int64_t stagedCount = 0;
+  [self inDatabase:^(FMDatabase* db) {
+    valid = [self.stagedUpdateID isEqualToString:updateID];
+    if (valid) {
+      stagedCount = [db longForQuery:@"SELECT COUNT(*) FROM staged_rules"];
+    }
+  }];
+
+  if (!valid) {
+    if (errors) {
+      *errors = @[ [SNTError createErrorWithCode:SNTErrorCodeStagedUpdateInvalid
+                                          format:@"No staged rule update with ID %@", updateID] ];
+    }
+    return NO;
+  }
+
+  BOOL result;
+  if (stagedCount == 0 && cleanupType == SNTRuleCleanupNone) {
+    // Only accept an empty update if the cleanup-type is not none, as for
+    // unstaged updates.
+    if (errors) {
+      *errors = @[ [SNTError createErrorWithCode:SNTErrorCodeEmptyRuleArray
+                                          format:@"Empty execution, file access, network flow, and "
+                                                 @"signal rule arrays"] ];
+    }
+    result = NO;
+  } else {
+    result = [self applyRuleChangesWithCleanup:cleanupType
+                            flushDecisionCache:flushDecisionCache
+                                        errors:errors
+                                    usingBlock:^BOOL(FMDatabase* db,
+                                                     NSMutableArray<SNTRule*>* appliedRules,
+                                                     BOOL* rebuildIndexes,
+                                                     NSMutableArray<NSError*>* blockErrors) {
+                                      return [self applyStagedRulesToDB:db
+                                                           appliedRules:appliedRules
+                                                         rebuildIndexes:rebuildIndexes
+                                                                 errors:blockErrors];
+                                    }];
+  }
+
+  // A staged update can only be committed once, whether or not it applied.
+  [self abortStagedRuleUpdate:updateID];
+  return result;
+}
+
+- (void)abortStagedRuleUpdate:(NSString*)updateID {
+  [self inDatabase:^(FMDatabase* db) {
+    if (![self.stagedUpdateID isEqualToString:updateID]) return;
+    [db executeUpdate:@"DROP TABLE IF EXISTS temp.staged_rules"];
+    self.stagedUpdateID = nil;
+  }];
+}
+
 - (BOOL)addSignals:(NSArray<SNTSignal*>*)signals
               toDB:(FMDatabase*)db
             errors:(NSMutableArray<NSError*>*)errors {
@@ -915,7 +1844,7 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (NSArray<SNTSignal*>*)retrieveAllSignals {
   NSMutableArray<SNTSignal*>* signals = [NSMutableArray array];
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     FMResultSet* rs = [db executeQuery:@"SELECT name, rule_data FROM signal_rules"];
     while ([rs next]) {
       SNTSignal* signal = [[SNTSignal alloc] initAddRuleWithName:[rs stringForColumnIndex:0]
@@ -993,6 +1922,70 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
   return flushDecisionCache;
 }
 
+- (BOOL)addedRuleBatchShouldFlushDecisionCache:(NSData*)data {
+  santa::ExecutionRuleBatch batch;
+  if (!batch.ParseFromArray(data.bytes, static_cast<int>(data.length))) {
+    // The batch will fail to apply, but act conservatively.
+    return YES;
+  }
+
+  // Same checks as addedRulesShouldFlushDecisionCache:.
+  uint64_t nonAllowRuleCount = 0;
+  for (const santa::ExecutionRuleBatch::Rule& rule : batch.rules()) {
+    if (rule.state() == SNTRuleStateRemove) {
+      return YES;
+    }
+    if (rule.state() != SNTRuleStateAllow) {
+      nonAllowRuleCount++;
+      if (nonAllowRuleCount >= 1000) return YES;
+    }
+  }
+
+  // Blocks capture C++ objects by copy, so only capture a pointer to the batch.
+  const santa::ExecutionRuleBatch* rules = &batch;
+  __block BOOL flushDecisionCache = NO;
+
+  [self inTransaction:^(FMDatabase* db, BOOL* rollback) {
+    PreparedStatement existingRule(
+        db, "SELECT COUNT(*) FROM execution_rules WHERE identifier=? AND type=? AND "
+            "state=? AND (cel_expr IS NULL OR cel_expr=?) LIMIT 1");
+    PreparedStatement compilerRule(
+        db, "SELECT COUNT(*) FROM execution_rules WHERE identifier=? AND type IN (?, ?, ?)"
+            " AND state=? LIMIT 1");
+    if (!existingRule || !compilerRule) {
+      flushDecisionCache = YES;
+      return;
+    }
+
+    for (const santa::ExecutionRuleBatch::Rule& rule : rules->rules()) {
+      if (rule.state() != SNTRuleStateAllow) {
+        existingRule.BindText(1, rule.identifier());
+        existingRule.BindInt64(2, rule.type());
+        existingRule.BindInt64(3, rule.state());
+        existingRule.BindText(4, rule.cel_expr());
+        if (existingRule.QueryInt64() == 0) {
+          flushDecisionCache = YES;
+          return;
+        }
+      } else {
+        if (rule.type() == SNTRuleTypeCertificate || rule.type() == SNTRuleTypeTeamID) continue;
+
+        compilerRule.BindText(1, rule.identifier());
+        compilerRule.BindInt64(2, SNTRuleTypeCDHash);
+        compilerRule.BindInt64(3, SNTRuleTypeBinary);
+        compilerRule.BindInt64(4, SNTRuleTypeSigningID);
+        compilerRule.BindInt64(5, SNTRuleStateAllowCompiler);
+        if (compilerRule.QueryInt64() > 0) {
+          flushDecisionCache = YES;
+          return;
+        }
+      }
+    }
+  }];
+
+  return flushDecisionCache;
+}
+
 // Updates the timestamp to current time for the given rule.
 - (void)resetTimestampForExecutionRule:(SNTRule*)rule {
   if (!rule) return;
@@ -1001,6 +1994,17 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
     if (![db executeUpdate:@"UPDATE execution_rules SET timestamp=? WHERE identifier=? AND type=?",
                            @(rule.timestamp), rule.identifier, @(rule.type)]) {
       LOGE(@"Could not update timestamp for rule with sha256=%@", rule.identifier);
+      return;
+    }
+    if ([db changes] == 0) return;
+
+    FMResultSet* rs =
+        [db executeQuery:@"SELECT * FROM execution_rules WHERE identifier=? AND type=?",
+                         rule.identifier, @(rule.type)];
+    SNTRule* updatedRule = [rs next] ? [self executionRuleFromResultSet:rs] : nil;
+    [rs close];
+    if (updatedRule) {
+      [self updateExecutionRuleIndexWithRules:@[ updatedRule ] inDB:db];
     }
   }];
 }
@@ -1022,6 +2026,8 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
     if (![db executeUpdate:@"DELETE FROM execution_rules WHERE state=? AND timestamp < ?",
                            @(SNTRuleStateAllowTransitive), @(outdatedTimestamp)]) {
       LOGE(@"Could not remove outdated transitive rules");
+    } else if ([db changes] > 0) {
+      [self rebuildExecutionRuleIndexesInDB:db];
     }
   }];
 
@@ -1033,19 +2039,50 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 // Retrieve all rules from the Database
 - (NSArray<SNTRule*>*)retrieveAllExecutionRules {
   NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
-  [self inDatabase:^(FMDatabase* db) {
-    FMResultSet* rs = [db executeQuery:@"SELECT * FROM execution_rules"];
-    while ([rs next]) {
-      [rules addObject:[self executionRuleFromResultSet:rs]];
+  [self enumerateExecutionRulesExcludingStates:nil
+                                    usingBlock:^(SNTRule* rule, BOOL* stop) {
+                                      [rules addObject:rule];
+                                    }];
+  return rules;
+}
+
+- (void)enumerateExecutionRulesExcludingStates:(NSArray<NSNumber*>*)excludedStates
+                                    usingBlock:(void (^)(SNTRule* rule, BOOL* stop))block {
+  NSString* query = @"SELECT * FROM execution_rules";
+  if (excludedStates.count) {
+    query = [query stringByAppendingFormat:@" WHERE state NOT IN (%@)",
+                                           [excludedStates componentsJoinedByString:@","]];
+  }
+
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
+    FMResultSet* rs = [db executeQuery:query];
+    BOOL stop = NO;
+    while (!stop && [rs next]) {
+      @autoreleasepool {
+        block([self executionRuleFromResultSet:rs], &stop);
+      }
+    }
+    [rs close];
+  }];
+}
+
+- (void)enumerateCELRulesUsingBlock:(void (^)(SNTRule* rule, BOOL* stop))block {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
+    FMResultSet* rs = [db executeQuery:@"SELECT * FROM execution_rules WHERE state IN (?, ?)",
+                                       @(SNTRuleStateCEL), @(SNTRuleStateCELv2)];
+    BOOL stop = NO;
+    while (!stop && [rs next]) {
+      @autoreleasepool {
+        block([self executionRuleFromResultSet:rs], &stop);
+      }
     }
     [rs close];
   }];
-  return rules;
 }
 
 - (NSDictionary<NSString*, NSDictionary*>*)retrieveAllFileAccessRules {
   NSMutableDictionary<NSString*, NSDictionary*>* faaRules = [NSMutableDictionary dictionary];
-  [self inDatabase:^(FMDatabase* db) {
+  [self inReadOnlyDatabase:^(FMDatabase* db) {
     FMResultSet* rs = [db executeQuery:@"SELECT * FROM file_access_rules"];
     while ([rs next]) {
       NSDictionary* rule = [self fileAccessRuleFromResultSet:rs];
@@ -1109,12 +2146,20 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 }
 
 - (SNTNetworkFlowRulesSnapshot*)retrieveAllNetworkFlowRulesSnapshot {
-  NSMutableArray<SNTNetworkFlowRule*>* rules = [NSMutableArray array];
-  __block NSString* digest;
+  __block SNTNetworkFlowRulesSnapshot* snapshot;
   [self inDatabase:^(FMDatabase* db) {
-    digest = [self networkFlowRulesHashSerializedInDB:db collectInto:rules];
+    snapshot = self.cachedNetworkFlowRulesSnapshot;
+    if (snapshot) {
+      return;
+    }
+
+    NSMutableArray<SNTNetworkFlowRule*>* rules = [NSMutableArray array];
+    NSString* digest = [self networkFlowRulesHashSerializedInDB:db collectInto:rules];
+    snapshot = [[SNTNetworkFlowRulesSnapshot alloc] initWithRules:rules
+                                             networkFlowRulesHash:digest];
+    self.cachedNetworkFlowRulesSnapshot = snapshot;
   }];
-  return [[SNTNetworkFlowRulesSnapshot alloc] initWithRules:rules networkFlowRulesHash:digest];
+  return snapshot;
 }
 
 - (NSString*)networkFlowRulesHash {
@@ -1129,6 +2174,9 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
 - (void)updateStaticRules:(NSArray<NSDictionary*>*)staticRules {
   if (![staticRules isKindOfClass:[NSArray class]]) {
+    std::atomic_store_explicit(&_staticRuleIndex,
+                               std::shared_ptr<const santa::ExecutionRuleIndex>(),
+                               std::memory_order_release);
     self.cachedStaticRules = nil;
     return;
   }
@@ -1156,6 +2204,16 @@ static void addPathsFromDefaultMuteSet(NSMutableSet* criticalPaths) {
 
     rules[r.identifier] = r;
   }
+
+  std::shared_ptr<const santa::ExecutionRuleIndex> index;
+  if (rules.count) {
+    santa::ExecutionRuleIndex::Builder builder(rules.count);
+    for (SNTRule* rule in rules.allValues) {
+      builder.Add(rule);
+    }
+    index = builder.Build();
+  }
+  std::atomic_store_explicit(&_staticRuleIndex, std::move(index), std::memory_order_release);
   self.cachedStaticRules = [rules copy];
 }
 
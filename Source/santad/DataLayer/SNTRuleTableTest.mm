@@ -21,6 +21,7 @@
 
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/MOLCodesignChecker.h"
+#include "Source/common/RuleBatch.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
@@ -30,10 +31,26 @@
 #import "Source/common/SNTRule.h"
 #import "Source/common/SNTRuleIdentifiers.h"
 #import "Source/common/SigningIDHelpers.h"
+#include "Source/common/String.h"
 #import "Source/common/TestUtils.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 
 /// This test case actually tests SNTRuleTable and SNTRule
+static NSData* SerializedRuleBatch(const santa::ExecutionRuleBatch& batch) {
+  std::string bytes = batch.SerializeAsString();
+  return [NSData dataWithBytes:bytes.data() length:bytes.size()];
+}
+
+static santa::ExecutionRuleBatch::Rule* AddBatchRule(santa::ExecutionRuleBatch& batch,
+                                                     const std::string& identifier,
+                                                     SNTRuleState state, SNTRuleType type) {
+  santa::ExecutionRuleBatch::Rule* rule = batch.add_rules();
+  rule->set_identifier(identifier);
+  rule->set_state(state);
+  rule->set_type(type);
+  return rule;
+}
+
 @interface SNTRuleTableTest : XCTestCase
 @property SNTRuleTable* sut;
 @property FMDatabaseQueue* dbq;
@@ -49,6 +66,10 @@
 @property(readwrite) NSString* celExpr;
 @end
 
+@interface SNTRuleTable (Testing)
+- (SNTRule*)databaseExecutionRuleForIdentifiers:(struct RuleIdentifiers)identifiers;
+@end
+
 @implementation SNTRuleTableTest
 
 - (void)setUp {
@@ -264,6 +285,366 @@
   XCTAssertEqual(errors.count, 0);
 }
 
+- (void)testCELRulesChangedCallback {
+  __block int callbackCount = 0;
+  __block int64_t lastCount = -1;
+  self.sut.celRulesChangedCallback = ^(int64_t count) {
+    callbackCount++;
+    lastCount = count;
+  };
+
+  // Rules without CEL expressions don't need plans compiled.
+  XCTAssertTrue([self.sut addExecutionRules:@[ [self _exampleBinaryRule] ]
+                                ruleCleanup:SNTRuleCleanupNone
+                                     errors:nil]);
+  XCTAssertEqual(callbackCount, 0);
+
+  SNTRule* r = [[SNTRule alloc] init];
+  r.identifier = @"7ae80b9ab38af0c63a9a81765f434d9a7cd8f720eb6037ef303de39d779bc258";
+  r.type = SNTRuleTypeCertificate;
+  r.state = SNTRuleStateCELv2;
+  r.celExpr = @"args.size() == 1";
+  XCTAssertTrue([self.sut addExecutionRules:@[ r ] ruleCleanup:SNTRuleCleanupNone errors:nil]);
+  XCTAssertEqual(callbackCount, 1);
+  XCTAssertEqual(lastCount, 1);
+  XCTAssertEqual([self.sut celRuleCount], 1);
+
+  // A rule whose expression is rejected isn't inserted.
+  SNTRule* invalid = [[SNTRule alloc] init];
+  invalid.identifier = @"ABCDEFGHIJ";
+  invalid.type = SNTRuleTypeTeamID;
+  invalid.state = SNTRuleStateCEL;
+  invalid.celExpr = @"this is an invalid expression";
+  XCTAssertTrue([self.sut addExecutionRules:@[ invalid ]
+                                ruleCleanup:SNTRuleCleanupNone
+                                     errors:nil]);
+  XCTAssertEqual(callbackCount, 1);
+
+  __block NSMutableArray<NSString*>* exprs = [NSMutableArray array];
+  [self.sut enumerateCELRulesUsingBlock:^(SNTRule* rule, BOOL* stop) {
+    [exprs addObject:rule.celExpr];
+  }];
+  XCTAssertEqualObjects(exprs, @[ r.celExpr ]);
+}
+
+- (void)testCleanAllBulkLoad {
+  [self.sut addExecutionRules:@[ [self _exampleBinaryRule], [self _exampleCertRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+
+  SNTRule* first = [self _exampleTeamIDRule];
+  first.customMsg = @"first";
+  SNTRule* second = [self _exampleTeamIDRule];
+  second.customMsg = @"second";
+  SNTRule* removeCert = [self _exampleCertRule];
+  removeCert.state = SNTRuleStateRemove;
+  SNTRule* removeBinary = [self _exampleBinaryRule];
+  removeBinary.state = SNTRuleStateRemove;
+
+  // The last change to each rule wins, as for any other update
+  NSArray<NSError*>* errors;
+  XCTAssertTrue([self.sut addExecutionRules:@[
+    first, second, [self _exampleCertRule], removeCert, removeBinary, [self _exampleBinaryRule]
+  ]
+                                ruleCleanup:SNTRuleCleanupAll
+                                     errors:&errors]);
+  XCTAssertNil(errors);
+  XCTAssertEqual(self.sut.executionRuleCount, 2);
+  XCTAssertEqual(self.sut.teamIDRuleCount, 1);
+  XCTAssertEqual(self.sut.certificateRuleCount, 0);
+  XCTAssertEqual(self.sut.binaryRuleCount, 1);
+
+  struct RuleIdentifiers identifiers = {.teamID = first.identifier};
+  XCTAssertEqualObjects([self.sut executionRuleForIdentifiers:identifiers].customMsg, @"second");
+  XCTAssertEqualObjects([self.sut databaseExecutionRuleForIdentifiers:identifiers].customMsg,
+                        @"second");
+
+  // The swapped in table is indexed and the load table is gone
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    XCTAssertEqual([db longForQuery:@"SELECT COUNT(*) FROM sqlite_master WHERE type='index' "
+                                    @"AND name='execution_rules_unique'"],
+                   1);
+    XCTAssertFalse([db tableExists:@"execution_rules_load"]);
+  }];
+
+  SNTRule* third = [self _exampleTeamIDRule];
+  third.customMsg = @"third";
+  XCTAssertTrue([self.sut addExecutionRules:@[ third ] ruleCleanup:SNTRuleCleanupNone errors:nil]);
+  XCTAssertEqual(self.sut.teamIDRuleCount, 1);
+  XCTAssertEqualObjects([self.sut databaseExecutionRuleForIdentifiers:identifiers].customMsg,
+                        @"third");
+}
+
+- (void)testCleanAllBulkLoadInvalidRuleRollsBack {
+  [self.sut addExecutionRules:@[ [self _exampleBinaryRule], [self _exampleCertRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+
+  SNTRule* invalid = [self _exampleTeamIDRule];
+  invalid.state = SNTRuleStateUnknown;
+  NSArray<NSError*>* errors;
+  XCTAssertFalse([self.sut addExecutionRules:@[ [self _exampleTeamIDRule], invalid ]
+                                 ruleCleanup:SNTRuleCleanupAll
+                                      errors:&errors]);
+  XCTAssertEqual(errors.firstObject.code, SNTErrorCodeRuleInvalid);
+
+  XCTAssertEqual(self.sut.executionRuleCount, 2);
+  XCTAssertEqual(self.sut.teamIDRuleCount, 0);
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    XCTAssertFalse([db tableExists:@"execution_rules_load"]);
+  }];
+}
+
+- (void)testStagedRuleUpdate {
+  NSString* updateID = [self.sut beginStagedRuleUpdate];
+  XCTAssertNotNil(updateID);
+
+  NSArray<NSError*>* errors;
+  XCTAssertTrue([self.sut stageExecutionRules:@[ [self _exampleBinaryRule] ]
+                              fileAccessRules:nil
+                             networkFlowRules:nil
+                                      signals:nil
+                                     updateID:updateID
+                                       errors:&errors]);
+  XCTAssertTrue([self.sut
+      stageExecutionRules:@[ [self _exampleCertRule] ]
+          fileAccessRules:@[ [self _exampleFileAccessAddRuleWithName:@"my_first_rule"] ]
+         networkFlowRules:nil
+                  signals:nil
+                 updateID:updateID
+                   errors:&errors]);
+
+  // Nothing is applied until the update is committed
+  XCTAssertEqual(self.sut.executionRuleCount, 0);
+  XCTAssertEqual(self.sut.fileAccessRuleCount, 0);
+
+  XCTAssertTrue([self.sut commitStagedRuleUpdate:updateID
+                                     ruleCleanup:SNTRuleCleanupNone
+                                          errors:&errors]);
+  XCTAssertNil(errors);
+  XCTAssertEqual(self.sut.binaryRuleCount, 1);
+  XCTAssertEqual(self.sut.certificateRuleCount, 1);
+  XCTAssertEqual(self.sut.fileAccessRuleCount, 1);
+
+  // An update can only be committed once
+  XCTAssertFalse([self.sut commitStagedRuleUpdate:updateID
+                                      ruleCleanup:SNTRuleCleanupAll
+                                           errors:&errors]);
+  XCTAssertEqual(errors.firstObject.code, SNTErrorCodeStagedUpdateInvalid);
+  XCTAssertEqual(self.sut.executionRuleCount, 2);
+}
+
+- (void)testStagedRuleUpdateInvalidRuleRollsBack {
+  NSString* updateID = [self.sut beginStagedRuleUpdate];
+
+  SNTRule* invalid = [self _exampleCertRule];
+  invalid.state = SNTRuleStateUnknown;
+
+  NSArray<NSError*>* errors;
+  XCTAssertTrue([self.sut stageExecutionRules:@[ [self _exampleBinaryRule] ]
+                              fileAccessRules:nil
+                             networkFlowRules:nil
+                                      signals:nil
+                                     updateID:updateID
+                                       errors:&errors]);
+  XCTAssertTrue([self.sut stageExecutionRules:@[ invalid ]
+                              fileAccessRules:nil
+                             networkFlowRules:nil
+                                      signals:nil
+                                     updateID:updateID
+                                       errors:&errors]);
+
+  XCTAssertFalse([self.sut commitStagedRuleUpdate:updateID
+                                      ruleCleanup:SNTRuleCleanupNone
+                                           errors:&errors]);
+  XCTAssertEqual(errors.firstObject.code, SNTErrorCodeRuleInvalid);
+  XCTAssertEqual(self.sut.executionRuleCount, 0);
+}
+
+- (void)testBeginStagedRuleUpdateDiscardsPrevious {
+  NSString* first = [self.sut beginStagedRuleUpdate];
+  NSArray<NSError*>* errors;
+  XCTAssertTrue([self.sut stageExecutionRules:@[ [self _exampleBinaryRule] ]
+                              fileAccessRules:nil
+                             networkFlowRules:nil
+                                      signals:nil
+                                     updateID:first
+                                       errors:&errors]);
+
+  NSString* second = [self.sut beginStagedRuleUpdate];
+  XCTAssertNotEqualObjects(first, second);
+  XCTAssertFalse([self.sut stageExecutionRules:@[ [self _exampleCertRule] ]
+                               fileAccessRules:nil
+                              networkFlowRules:nil
+                                       signals:nil
+                                      updateID:first
+                                        errors:&errors]);
+  XCTAssertEqual(errors.firstObject.code, SNTErrorCodeStagedUpdateInvalid);
+
+  // The rules staged for the first update are gone
+  XCTAssertFalse([self.sut commitStagedRuleUpdate:second
+                                      ruleCleanup:SNTRuleCleanupNone
+                                           errors:&errors]);
+  XCTAssertEqual(errors.firstObject.code, SNTErrorCodeEmptyRuleArray);
+  XCTAssertEqual(self.sut.executionRuleCount, 0);
+}
+
+- (void)testStagedRuleUpdateManyRules {
+  NSString* updateID = [self.sut beginStagedRuleUpdate];
+
+  // Enough rules for several read batches and an index rebuild
+  const int kRuleCount = 5000;
+  for (int chunk = 0; chunk < kRuleCount / 500; chunk++) {
+    NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+    for (int i = chunk * 500; i < (chunk + 1) * 500; i++) {
+      SNTRule* r = [self _exampleBinaryRule];
+      r.identifier = [NSString stringWithFormat:@"%064x", i];
+      [rules addObject:r];
+    }
+    XCTAssertTrue([self.sut stageExecutionRules:rules
+                                fileAccessRules:nil
+                               networkFlowRules:nil
+                                        signals:nil
+                                       updateID:updateID
+                                         errors:nil]);
+  }
+
+  XCTAssertTrue([self.sut commitStagedRuleUpdate:updateID
+                                     ruleCleanup:SNTRuleCleanupNone
+                                          errors:nil]);
+  XCTAssertEqual(self.sut.binaryRuleCount, kRuleCount);
+
+  SNTRule* r = [self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                             .binarySHA256 = [NSString stringWithFormat:@"%064x", kRuleCount - 1],
+                         }];
+  XCTAssertNotNil(r);
+  XCTAssertEqual(r.state, SNTRuleStateBlock);
+}
+
+- (void)testStagedRuleBatch {
+  NSString* updateID = [self.sut beginStagedRuleUpdate];
+  SNTRule* binaryRule = [self _exampleBinaryRule];
+  XCTAssertTrue([self.sut stageExecutionRules:@[ binaryRule ]
+                              fileAccessRules:nil
+                             networkFlowRules:nil
+                                      signals:nil
+                                     updateID:updateID
+                                       errors:nil]);
+
+  // Batches are applied in order with individually staged rules, so this removes the rule above
+  santa::ExecutionRuleBatch batch;
+  AddBatchRule(batch, santa::NSStringToUTF8String(binaryRule.identifier), SNTRuleStateRemove,
+               SNTRuleTypeBinary);
+  AddBatchRule(batch, "7ae80b9ab38af0c63a9a81765f434d9a7cd8f720eb6037ef303de39d779bc258",
+               SNTRuleStateBlock, SNTRuleTypeCertificate)
+      ->set_custom_msg("Blocked by batch");
+  AddBatchRule(batch, "ABCDEFGHIJ", SNTRuleStateAllow, SNTRuleTypeTeamID)->set_rule_id(42);
+
+  NSArray<NSError*>* errors;
+  XCTAssertTrue([self.sut stageExecutionRuleBatch:SerializedRuleBatch(batch)
+                                         updateID:updateID
+                                           errors:&errors]);
+  XCTAssertEqual(self.sut.executionRuleCount, 0);
+
+  XCTAssertTrue([self.sut commitStagedRuleUpdate:updateID
+                                     ruleCleanup:SNTRuleCleanupNone
+                                          errors:&errors]);
+  XCTAssertNil(errors);
+  XCTAssertEqual(self.sut.binaryRuleCount, 0);
+  XCTAssertEqual(self.sut.certificateRuleCount, 1);
+  XCTAssertEqual(self.sut.teamIDRuleCount, 1);
+
+  SNTRule* r = [self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                             .certificateSHA256 = [self _exampleCertRule].identifier,
+                         }];
+  XCTAssertEqual(r.state, SNTRuleStateBlock);
+  XCTAssertEqualObjects(r.customMsg, @"Blocked by batch");
+  XCTAssertNil(r.customURL);
+
+  r = [self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){.teamID = @"ABCDEFGHIJ"}];
+  XCTAssertEqual(r.state, SNTRuleStateAllow);
+  XCTAssertEqual(r.ruleId, 42);
+}
+
+- (void)testStagedRuleBatchInvalidRuleRollsBack {
+  NSString* updateID = [self.sut beginStagedRuleUpdate];
+
+  santa::ExecutionRuleBatch batch;
+  AddBatchRule(batch, "ABCDEFGHIJ", SNTRuleStateAllow, SNTRuleTypeTeamID);
+  AddBatchRule(batch, "KLMNOPQRST", SNTRuleStateUnknown, SNTRuleTypeTeamID);
+  XCTAssertTrue([self.sut stageExecutionRuleBatch:SerializedRuleBatch(batch)
+                                         updateID:updateID
+                                           errors:nil]);
+
+  NSArray<NSError*>* errors;
+  XCTAssertFalse([self.sut commitStagedRuleUpdate:updateID
+                                      ruleCleanup:SNTRuleCleanupNone
+                                           errors:&errors]);
+  XCTAssertEqual(errors.firstObject.code, SNTErrorCodeRuleInvalid);
+  XCTAssertEqual(self.sut.executionRuleCount, 0);
+
+  // A batch that cannot be parsed is rejected on commit too
+  updateID = [self.sut beginStagedRuleUpdate];
+  NSData* garbage = [@"not a batch" dataUsingEncoding:NSUTF8StringEncoding];
+  XCTAssertTrue([self.sut stageExecutionRuleBatch:garbage updateID:updateID errors:nil]);
+  XCTAssertFalse([self.sut commitStagedRuleUpdate:updateID
+                                      ruleCleanup:SNTRuleCleanupNone
+                                           errors:&errors]);
+  XCTAssertEqual(self.sut.executionRuleCount, 0);
+
+  // Batches can only be staged for an update in progress
+  XCTAssertFalse([self.sut stageExecutionRuleBatch:SerializedRuleBatch(batch)
+                                          updateID:updateID
+                                            errors:&errors]);
+  XCTAssertEqual(errors.firstObject.code, SNTErrorCodeStagedUpdateInvalid);
+}
+
+- (void)testStagedRuleBatchManyRules {
+  NSString* updateID = [self.sut beginStagedRuleUpdate];
+
+  // Large enough to skip materializing rules for the index and rebuild it instead
+  const int kRuleCount = 5000;
+  santa::ExecutionRuleBatch batch;
+  for (int i = 0; i < kRuleCount; i++) {
+    AddBatchRule(batch, santa::NSStringToUTF8String([NSString stringWithFormat:@"%064x", i]),
+                 SNTRuleStateBlock, SNTRuleTypeBinary);
+  }
+  XCTAssertTrue([self.sut stageExecutionRuleBatch:SerializedRuleBatch(batch)
+                                         updateID:updateID
+                                           errors:nil]);
+  XCTAssertTrue([self.sut commitStagedRuleUpdate:updateID
+                                     ruleCleanup:SNTRuleCleanupNone
+                                          errors:nil]);
+  XCTAssertEqual(self.sut.binaryRuleCount, kRuleCount);
+
+  SNTRule* r = [self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                             .binarySHA256 = [NSString stringWithFormat:@"%064x", kRuleCount - 1],
+                         }];
+  XCTAssertEqual(r.state, SNTRuleStateBlock);
+}
+
+- (void)testAddedRuleBatchShouldFlushDecisionCache {
+  santa::ExecutionRuleBatch batch;
+  AddBatchRule(batch, "ABCDEFGHIJ", SNTRuleStateAllow, SNTRuleTypeTeamID);
+  XCTAssertFalse([self.sut addedRuleBatchShouldFlushDecisionCache:SerializedRuleBatch(batch)]);
+
+  // A new block rule requires a flush, but not once it is already in the database
+  AddBatchRule(batch, "KLMNOPQRST", SNTRuleStateBlock, SNTRuleTypeTeamID);
+  XCTAssertTrue([self.sut addedRuleBatchShouldFlushDecisionCache:SerializedRuleBatch(batch)]);
+  [self.sut addExecutionRules:@[ [[SNTRule alloc] initWithIdentifier:@"KLMNOPQRST"
+                                                               state:SNTRuleStateBlock
+                                                                type:SNTRuleTypeTeamID] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  XCTAssertFalse([self.sut addedRuleBatchShouldFlushDecisionCache:SerializedRuleBatch(batch)]);
+
+  AddBatchRule(batch, "KLMNOPQRST", SNTRuleStateRemove, SNTRuleTypeTeamID);
+  XCTAssertTrue([self.sut addedRuleBatchShouldFlushDecisionCache:SerializedRuleBatch(batch)]);
+
+  NSData* garbage = [@"not a batch" dataUsingEncoding:NSUTF8StringEncoding];
+  XCTAssertTrue([self.sut addedRuleBatchShouldFlushDecisionCache:garbage]);
+}
+
 - (void)testAddRemoveFetchFileAccessRule {
   // Add some file access rules
   NSArray<NSError*>* errors;
@@ -591,6 +972,191 @@
   XCTAssertEqual(r.type, SNTRuleTypeTeamID, @"Implicit rule ordering failed (TeamID)");
 }
 
+- (void)testStaticRulesTakePrecedence {
+  [self.sut addExecutionRules:@[ [self _exampleBinaryRule], [self _exampleTeamIDRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+
+  [self.sut updateStaticRules:@[
+    @{
+      @"identifier" : @"ABCDEFGHIJ",
+      @"policy" : @"ALLOWLIST",
+      @"rule_type" : @"TEAMID",
+    },
+  ]];
+  XCTAssertEqual(self.sut.cachedStaticRules.count, 1);
+
+  // Any matching static rule beats the database rules, even of a higher precedence type
+  struct RuleIdentifiers ids = {
+      .binarySHA256 = [self _exampleBinaryRule].identifier,
+      .teamID = @"ABCDEFGHIJ",
+  };
+  SNTRule* r = [self.sut executionRuleForIdentifiers:ids];
+  XCTAssertEqual(r.type, SNTRuleTypeTeamID);
+  XCTAssertEqual(r.state, SNTRuleStateAllow);
+  XCTAssertTrue(r.staticRule);
+  XCTAssertEqual(r, [self.sut executionRuleForIdentifiers:ids]);
+
+  [self.sut updateStaticRules:@[ @{
+    @"identifier" : [self _exampleBinaryRule].identifier,
+    @"policy" : @"ALLOWLIST",
+    @"rule_type" : @"BINARY",
+  } ]];
+  r = [self.sut executionRuleForIdentifiers:ids];
+  XCTAssertEqual(r.type, SNTRuleTypeBinary);
+  XCTAssertEqual(r.state, SNTRuleStateAllow);
+  XCTAssertTrue(r.staticRule);
+
+  // Without static rules, the database rules apply again
+  [self.sut updateStaticRules:nil];
+  XCTAssertNil(self.sut.cachedStaticRules);
+  r = [self.sut executionRuleForIdentifiers:ids];
+  XCTAssertEqual(r.type, SNTRuleTypeBinary);
+  XCTAssertEqual(r.state, SNTRuleStateBlock);
+  XCTAssertFalse(r.staticRule);
+}
+
+- (void)testRuleFilterSkipsLookupsThatCannotMatch {
+  [self.sut addExecutionRules:@[ [self _exampleBinaryRule], [self _exampleTeamIDRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+
+  // The identifier exists, but as a different rule type.
+  SNTRule* r = [self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                                                         .signingID = @"ABCDEFGHIJ",
+                                                     }];
+  XCTAssertNil(r);
+
+  r = [self.sut executionRuleForIdentifiers:(struct RuleIdentifiers){
+                                                .binarySHA256 = @"deadbeef",
+                                                .teamID = @"ABCDEFGHIJ",
+                                            }];
+  XCTAssertEqual(r.type, SNTRuleTypeTeamID);
+
+  struct SNTRuleFilterStats stats = [self.sut executionRuleFilterStats];
+  XCTAssertGreaterThan(stats.sizeBytes, 0);
+  XCTAssertEqual(stats.matchedLookups, 1);
+  XCTAssertEqual(stats.skippedLookups + stats.falsePositiveLookups, 1);
+}
+
+- (void)testRuleFilterTracksAddedAndRemovedRules {
+  NSString* sha = @"b7c1e3fd640c5f211c89b02c2c6122f78ce322aa5c56eb0bb54bc422a8f8b670";
+  struct RuleIdentifiers ids = {.binarySHA256 = sha};
+
+  XCTAssertNil([self.sut executionRuleForIdentifiers:ids]);
+
+  // Rules added after the filter was built must be found.
+  [self.sut addExecutionRules:@[ [self _exampleBinaryRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  XCTAssertNotNil([self.sut executionRuleForIdentifiers:ids]);
+
+  // A clean sync rebuilds the filter without the removed rule.
+  [self.sut addExecutionRules:@[ [self _exampleCertRule] ]
+                  ruleCleanup:SNTRuleCleanupAll
+                       errors:nil];
+  XCTAssertNil([self.sut executionRuleForIdentifiers:ids]);
+  XCTAssertEqual([self.sut executionRuleFilterStats].entries, 1);
+
+  // Adding many rules grows the filter past its initial capacity.
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  for (int i = 0; i < 5000; ++i) {
+    SNTRule* rule = [self _exampleBinaryRule];
+    rule.identifier = [NSString stringWithFormat:@"%064x", i];
+    [rules addObject:rule];
+  }
+  [self.sut addExecutionRules:rules ruleCleanup:SNTRuleCleanupNone errors:nil];
+  XCTAssertEqual([self.sut executionRuleFilterStats].entries, 5001);
+
+  struct RuleIdentifiers lastIds = {.binarySHA256 = rules.lastObject.identifier};
+  XCTAssertNotNil([self.sut executionRuleForIdentifiers:lastIds]);
+}
+
+- (void)assertIndexMatchesDatabaseForIdentifiers:(struct RuleIdentifiers)ids {
+  SNTRule* fromIndex = [self.sut executionRuleForIdentifiers:ids];
+  SNTRule* fromDB = [self.sut databaseExecutionRuleForIdentifiers:ids];
+  if (!fromDB) {
+    XCTAssertNil(fromIndex);
+    return;
+  }
+  XCTAssertEqualObjects(fromIndex.identifier, fromDB.identifier);
+  XCTAssertEqual(fromIndex.type, fromDB.type);
+  XCTAssertEqual(fromIndex.state, fromDB.state);
+  XCTAssertEqualObjects(fromIndex.customMsg, fromDB.customMsg);
+  XCTAssertEqual(fromIndex.timestamp, fromDB.timestamp);
+}
+
+- (void)testRuleIndexMatchesDatabase {
+  SNTRule* transitiveRule = [self _exampleTransitiveRule];
+  [self.sut addExecutionRules:@[
+    [self _exampleCertRule],
+    [self _exampleBinaryRule],
+    [self _exampleTeamIDRule],
+    [self _exampleSigningIDRuleIsPlatform:NO],
+    [self _exampleCDHashRule],
+    transitiveRule,
+  ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  [self.sut updateStaticRules:nil];
+
+  NSArray<NSString*>* cdhashes = @[ @"unknown", [self _exampleCDHashRule].identifier ];
+  NSArray<NSString*>* binaries =
+      @[ @"unknown", [self _exampleBinaryRule].identifier, transitiveRule.identifier ];
+  NSArray<NSString*>* signingIDs = @[ @"unknown", @"ABCDEFGHIJ:signingID" ];
+  NSArray<NSString*>* certs = @[ @"unknown", [self _exampleCertRule].identifier ];
+  NSArray<NSString*>* teamIDs = @[ @"unknown", @"ABCDEFGHIJ" ];
+
+  void (^checkAll)(void) = ^{
+    for (NSString* cdhash in cdhashes) {
+      for (NSString* binary in binaries) {
+        for (NSString* signingID in signingIDs) {
+          for (NSString* cert in certs) {
+            for (NSString* teamID in teamIDs) {
+              [self assertIndexMatchesDatabaseForIdentifiers:(struct RuleIdentifiers){
+                                                                 .cdhash = cdhash,
+                                                                 .binarySHA256 = binary,
+                                                                 .signingID = signingID,
+                                                                 .certificateSHA256 = cert,
+                                                                 .teamID = teamID,
+                                                             }];
+            }
+          }
+        }
+      }
+    }
+  };
+  checkAll();
+
+  // Incremental removals and updates must be reflected before the index is rebuilt.
+  SNTRule* removeRule = [self _exampleBinaryRule];
+  removeRule.state = SNTRuleStateRemove;
+  SNTRule* updatedTeamIDRule = [self _exampleTeamIDRule];
+  updatedTeamIDRule.state = SNTRuleStateAllow;
+  updatedTeamIDRule.customMsg = nil;
+  [self.sut addExecutionRules:@[ removeRule, updatedTeamIDRule ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+  checkAll();
+
+  SNTRule* fetched = [self.sut
+      executionRuleForIdentifiers:(struct RuleIdentifiers){.binarySHA256 =
+                                                               transitiveRule.identifier}];
+  [fetched resetTimestamp];
+  NSUInteger staleTimestamp = fetched.timestamp - 3600;
+  [self.dbq inDatabase:^(FMDatabase* db) {
+    [db executeUpdate:@"UPDATE execution_rules SET timestamp=? WHERE identifier=?",
+                      @(staleTimestamp), transitiveRule.identifier];
+  }];
+  [self.sut resetTimestampForExecutionRule:fetched];
+  checkAll();
+
+  fetched = [self.sut
+      executionRuleForIdentifiers:(struct RuleIdentifiers){.binarySHA256 =
+                                                               transitiveRule.identifier}];
+  XCTAssertNotEqual(fetched.timestamp, staleTimestamp);
+}
+
 - (void)testBadDatabase {
   NSString* dbPath = [NSTemporaryDirectory() stringByAppendingString:@"sntruletabletest_baddb.db"];
   [@"some text" writeToFile:dbPath atomically:YES encoding:NSUTF8StringEncoding error:NULL];
@@ -604,6 +1170,71 @@
   [[NSFileManager defaultManager] removeItemAtPath:dbPath error:NULL];
 }
 
+- (void)testFullIntegrityCheckAfterFailedBackgroundCheck {
+  NSString* dbPath =
+      [NSTemporaryDirectory() stringByAppendingString:@"sntruletabletest_integrity.db"];
+  NSString* markerPath = [dbPath stringByAppendingString:@".integrity_check_failed"];
+  [[NSFileManager defaultManager] removeItemAtPath:dbPath error:NULL];
+
+  SNTRuleTable* sut =
+      [[SNTRuleTable alloc] initWithDatabaseQueue:[[FMDatabaseQueue alloc] initWithPath:dbPath]];
+  [sut addExecutionRules:@[ [self _exampleBinaryRule] ] ruleCleanup:SNTRuleCleanupNone errors:nil];
+  XCTAssertEqual([sut checkIntegrity], SNTDatabaseIntegrityOK);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:markerPath]);
+  sut = nil;
+
+  // A healthy database passes the full check run at startup and keeps its rules.
+  [[NSFileManager defaultManager] createFileAtPath:markerPath contents:nil attributes:nil];
+  sut = [[SNTRuleTable alloc] initWithDatabaseQueue:[[FMDatabaseQueue alloc] initWithPath:dbPath]];
+  XCTAssertEqual(sut.executionRuleCount, 1);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:markerPath]);
+
+  [[NSFileManager defaultManager] removeItemAtPath:dbPath error:NULL];
+}
+
+- (void)testConcurrentReadsDoNotWaitForTransactions {
+  NSString* dbPath = [NSTemporaryDirectory() stringByAppendingString:@"sntruletabletest_wal.db"];
+  NSArray<NSString*>* dbFiles = @[
+    dbPath, [dbPath stringByAppendingString:@"-wal"], [dbPath stringByAppendingString:@"-shm"]
+  ];
+  for (NSString* path in dbFiles) {
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+  }
+
+  // In-memory databases can't be shared between connections
+  XCTAssertFalse([self.sut enableConcurrentReadsWithMaxReaders:4]);
+
+  FMDatabaseQueue* dbq = [[FMDatabaseQueue alloc] initWithPath:dbPath];
+  SNTRuleTable* sut = [[SNTRuleTable alloc] initWithDatabaseQueue:dbq];
+  XCTAssertTrue([sut enableConcurrentReadsWithMaxReaders:4]);
+
+  [sut addExecutionRules:@[ [self _exampleBinaryRule] ] ruleCleanup:SNTRuleCleanupNone errors:nil];
+  XCTAssertEqual(sut.executionRuleCount, 1);
+
+  // Reads see the last committed state instead of waiting for the open transaction
+  [sut inTransaction:^(FMDatabase* db, BOOL* rollback) {
+    [db executeUpdate:@"DELETE FROM execution_rules"];
+
+    __block int64_t count = -1;
+    dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+      count = sut.executionRuleCount;
+      dispatch_semaphore_signal(sema);
+    });
+    XCTAssertSemaTrue(sema, 5, "Read waited for the open transaction");
+    XCTAssertEqual(count, 1);
+
+    *rollback = YES;
+  }];
+
+  XCTAssertEqual(sut.executionRuleCount, 1);
+
+  [dbq close];
+  for (NSString* path in dbFiles) {
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+  }
+}
+
 - (void)testRetrieveAllRulesWithEmptyDatabase {
   NSArray<SNTRule*>* rules = [self.sut retrieveAllExecutionRules];
   XCTAssertEqual(rules.count, 0);
@@ -629,6 +1260,32 @@
   XCTAssertEqualObjects(rules[4], [self _exampleCDHashRule]);
 }
 
+- (void)testEnumerateRulesExcludingStates {
+  [self.sut addExecutionRules:@[
+    [self _exampleCertRule],
+    [self _exampleBinaryRule],
+    [self _exampleTransitiveRule],
+  ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:nil];
+
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  [self.sut enumerateExecutionRulesExcludingStates:@[ @(SNTRuleStateAllowTransitive) ]
+                                        usingBlock:^(SNTRule* rule, BOOL* stop) {
+                                          [rules addObject:rule];
+                                        }];
+  XCTAssertEqual(rules.count, 2);
+  XCTAssertFalse([rules containsObject:[self _exampleTransitiveRule]]);
+
+  __block NSUInteger seen = 0;
+  [self.sut enumerateExecutionRulesExcludingStates:nil
+                                        usingBlock:^(SNTRule* rule, BOOL* stop) {
+                                          seen++;
+                                          *stop = YES;
+                                        }];
+  XCTAssertEqual(seen, 1);
+}
+
 - (void)testAddedRulesShouldFlushDecisionCacheWithNewBlockRule {
   // Ensure that a brand new block rule flushes the decision cache.
   NSArray<NSError*>* errors;
@@ -722,6 +1379,120 @@
   XCTAssertEqual(YES, [self.sut addedRulesShouldFlushDecisionCache:@[ r ]]);
 }
 
+- (BOOL)cleanSyncShouldFlushDecisionCache:(NSArray<SNTRule*>*)rules {
+  NSArray<NSError*>* errors;
+  BOOL flushDecisionCache = NO;
+  XCTAssertTrue([self.sut addExecutionRules:rules
+                            fileAccessRules:nil
+                           networkFlowRules:nil
+                                    signals:nil
+                                ruleCleanup:SNTRuleCleanupNonTransitive
+                         flushDecisionCache:&flushDecisionCache
+                                     errors:&errors]);
+  XCTAssertNil(errors);
+  return flushDecisionCache;
+}
+
+- (void)testCleanSyncShouldFlushDecisionCache {
+  SNTRule* block = [self _exampleBinaryRule];
+  SNTRule* allow = [self _exampleCertRule];
+  XCTAssertTrue([self cleanSyncShouldFlushDecisionCache:@[ block, allow ]]);
+
+  // Replacing the rules with the same rules changes nothing, regardless of order or of
+  // columns that decisions do not depend on.
+  block.customMsg = @"A new message";
+  XCTAssertFalse([self cleanSyncShouldFlushDecisionCache:@[ allow, block ]]);
+
+  // Adding an allow rule or removing a block rule cannot make a cached allow stale.
+  SNTRule* newAllow = [self _exampleTeamIDRule];
+  newAllow.state = SNTRuleStateAllow;
+  XCTAssertFalse([self cleanSyncShouldFlushDecisionCache:@[ block, allow, newAllow ]]);
+  XCTAssertFalse([self cleanSyncShouldFlushDecisionCache:@[ allow, newAllow ]]);
+
+  // Removing an allow rule, or adding or changing a non-allow rule, can.
+  XCTAssertTrue([self cleanSyncShouldFlushDecisionCache:@[ allow ]]);
+  XCTAssertTrue([self cleanSyncShouldFlushDecisionCache:@[ allow, block ]]);
+  SNTRule* cel = [self _exampleTeamIDRule];
+  cel.state = SNTRuleStateCEL;
+  cel.celExpr = @"args.size() == 1";
+  XCTAssertTrue([self cleanSyncShouldFlushDecisionCache:@[ allow, block, cel ]]);
+  XCTAssertFalse([self cleanSyncShouldFlushDecisionCache:@[ allow, block, cel ]]);
+  cel.celExpr = @"args.size() == 2";
+  XCTAssertTrue([self cleanSyncShouldFlushDecisionCache:@[ allow, block, cel ]]);
+
+  // An allow rule replacing a compiler rule.
+  SNTRule* compiler = [self _exampleCDHashRule];
+  compiler.state = SNTRuleStateAllowCompiler;
+  XCTAssertTrue([self cleanSyncShouldFlushDecisionCache:@[ compiler ]]);
+  compiler.state = SNTRuleStateAllow;
+  XCTAssertTrue([self cleanSyncShouldFlushDecisionCache:@[ compiler ]]);
+
+  // Transitive rules are kept by a non-transitive cleanup, but not by a full one.
+  NSArray<NSError*>* errors;
+  [self.sut addExecutionRules:@[ [self _exampleTransitiveRule] ]
+                  ruleCleanup:SNTRuleCleanupNone
+                       errors:&errors];
+  XCTAssertFalse([self cleanSyncShouldFlushDecisionCache:@[ compiler ]]);
+  BOOL flushDecisionCache = NO;
+  XCTAssertTrue([self.sut addExecutionRules:@[ compiler ]
+                            fileAccessRules:nil
+                           networkFlowRules:nil
+                                    signals:nil
+                                ruleCleanup:SNTRuleCleanupAll
+                         flushDecisionCache:&flushDecisionCache
+                                     errors:&errors]);
+  XCTAssertTrue(flushDecisionCache);
+}
+
+- (void)testCommitStagedRuleUpdateShouldFlushDecisionCache {
+  NSArray<NSError*>* errors;
+  NSArray<SNTRule*>* rules = @[ [self _exampleBinaryRule], [self _exampleCertRule] ];
+  XCTAssertTrue([self.sut addExecutionRules:rules ruleCleanup:SNTRuleCleanupNone errors:&errors]);
+
+  NSString* updateID = [self.sut beginStagedRuleUpdate];
+  XCTAssertTrue([self.sut stageExecutionRules:rules
+                              fileAccessRules:nil
+                             networkFlowRules:nil
+                                      signals:nil
+                                     updateID:updateID
+                                       errors:&errors]);
+  BOOL flushDecisionCache = YES;
+  XCTAssertTrue([self.sut commitStagedRuleUpdate:updateID
+                                     ruleCleanup:SNTRuleCleanupAll
+                              flushDecisionCache:&flushDecisionCache
+                                          errors:&errors]);
+  XCTAssertFalse(flushDecisionCache);
+  XCTAssertEqual(self.sut.executionRuleCount, 2);
+
+  // File access rules changing still flushes.
+  updateID = [self.sut beginStagedRuleUpdate];
+  XCTAssertTrue([self.sut stageExecutionRules:rules
+                              fileAccessRules:@[ [self _exampleFileAccessAddRuleWithName:@"a"] ]
+                             networkFlowRules:nil
+                                      signals:nil
+                                     updateID:updateID
+                                       errors:&errors]);
+  XCTAssertTrue([self.sut commitStagedRuleUpdate:updateID
+                                     ruleCleanup:SNTRuleCleanupAll
+                              flushDecisionCache:&flushDecisionCache
+                                          errors:&errors]);
+  XCTAssertTrue(flushDecisionCache);
+
+  // Updates without a cleanup are checked before they are applied.
+  updateID = [self.sut beginStagedRuleUpdate];
+  XCTAssertTrue([self.sut stageExecutionRules:@[ [self _exampleTeamIDRule] ]
+                              fileAccessRules:nil
+                             networkFlowRules:nil
+                                      signals:nil
+                                     updateID:updateID
+                                       errors:&errors]);
+  XCTAssertTrue([self.sut commitStagedRuleUpdate:updateID
+                                     ruleCleanup:SNTRuleCleanupNone
+                              flushDecisionCache:&flushDecisionCache
+                                          errors:&errors]);
+  XCTAssertFalse(flushDecisionCache);
+}
+
 - (void)testCriticalBinariesProduceFullSigningInformation {
   // Get the hash of the critical binary
   SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:@"/usr/libexec/trustd"];
@@ -881,6 +1652,25 @@
   XCTAssertEqualObjects(all.firstObject.protoBlob, [@"v2" dataUsingEncoding:NSUTF8StringEncoding]);
 }
 
+- (void)testNetworkFlowRulesSnapshotCachedUntilRulesChange {
+  SNTNetworkFlowRule* v1 = [self _exampleNetworkFlowAddRuleWithId:42 blob:@"v1"];
+  XCTAssertTrue([self _addNetworkFlowRules:@[ v1 ] ruleCleanup:SNTRuleCleanupNone errors:nil]);
+
+  // An unchanged ruleset is handed out again without being re-read
+  SNTNetworkFlowRulesSnapshot* first = [self.sut retrieveAllNetworkFlowRulesSnapshot];
+  XCTAssertEqual([self.sut retrieveAllNetworkFlowRulesSnapshot], first);
+  XCTAssertEqualObjects(first.networkFlowRulesHash, [self.sut networkFlowRulesHash]);
+
+  SNTNetworkFlowRule* v2 = [self _exampleNetworkFlowAddRuleWithId:42 blob:@"v2"];
+  XCTAssertTrue([self _addNetworkFlowRules:@[ v2 ] ruleCleanup:SNTRuleCleanupNone errors:nil]);
+
+  SNTNetworkFlowRulesSnapshot* second = [self.sut retrieveAllNetworkFlowRulesSnapshot];
+  XCTAssertNotEqual(second, first);
+  XCTAssertNotEqualObjects(second.networkFlowRulesHash, first.networkFlowRulesHash);
+  XCTAssertEqualObjects(second.rules.firstObject.protoBlob,
+                        [@"v2" dataUsingEncoding:NSUTF8StringEncoding]);
+}
+
 - (void)testRemoveNetworkFlowRule {
   SNTNetworkFlowRule* add = [self _exampleNetworkFlowAddRuleWithId:7 blob:@"x"];
   SNTNetworkFlowRule* remove = [[SNTNetworkFlowRule alloc] initRemoveRuleWithName:@"rule-7"];
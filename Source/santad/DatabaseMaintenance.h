@@ -0,0 +1,76 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_DATABASEMAINTENANCE_H
+#define SANTA_SANTAD_DATABASEMAINTENANCE_H
+
+#import <Foundation/Foundation.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#import "Source/common/SNTMetricSet.h"
+#include "Source/common/Timer.h"
+#import "Source/santad/DataLayer/SNTDatabaseTable.h"
+
+namespace santa {
+
+// Periodically runs SNTDatabaseTable maintenance on santad's databases and
+// exports their size and query planner statistics. The first time maintenance
+// runs after startup it also runs each database's full integrity check, which
+// is too slow to run before the databases are first used.
+//
+// Maintenance runs at background QoS, so the system defers it while it is
+// busy, and is skipped entirely while running on battery power.
+class DatabaseMaintenance : public Timer<DatabaseMaintenance> {
+ public:
+  static constexpr uint32_t kMinIntervalSecs = 60 * 60;
+  static constexpr uint32_t kMaxIntervalSecs = 7 * 24 * 60 * 60;
+  static constexpr uint32_t kDefaultIntervalSecs = 6 * 60 * 60;
+
+  // Returns whether maintenance may run now.
+  using CanRunFunc = std::function<bool()>;
+
+  // Databases are keyed by the name they are reported under in metrics.
+  static std::shared_ptr<DatabaseMaintenance> Create(
+      NSDictionary<NSString*, SNTDatabaseTable*>* databases, SNTMetricSet* metric_set);
+
+  DatabaseMaintenance(NSDictionary<NSString*, SNTDatabaseTable*>* databases,
+                      SNTMetricSet* metric_set, CanRunFunc can_run);
+
+  DatabaseMaintenance(const DatabaseMaintenance&) = delete;
+  DatabaseMaintenance& operator=(const DatabaseMaintenance&) = delete;
+
+  // Runs maintenance on every database now. Returns false, without touching
+  // the databases, if maintenance can't run now.
+  bool RunMaintenance();
+
+  // Timer<DatabaseMaintenance> callback.
+  bool OnTimer();
+
+ private:
+  NSDictionary<NSString*, SNTDatabaseTable*>* databases_;
+  CanRunFunc can_run_;
+  SNTMetricInt64Gauge* page_count_;
+  SNTMetricInt64Gauge* freelist_count_;
+  SNTMetricInt64Gauge* size_bytes_;
+  SNTMetricInt64Gauge* analyzed_indexes_;
+  SNTMetricCounter* integrity_checks_;
+  bool integrity_checked_ = false;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_DATABASEMAINTENANCE_H
@@ -0,0 +1,101 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/DatabaseMaintenance.h"
+
+#include <sys/qos.h>
+
+#include "Source/common/PowerMonitor.h"
+#import "Source/common/SNTLogging.h"
+
+namespace santa {
+
+namespace {
+
+NSString* IntegrityToString(SNTDatabaseIntegrity integrity) {
+  switch (integrity) {
+    case SNTDatabaseIntegrityOK: return @"OK";
+    case SNTDatabaseIntegrityRepaired: return @"Repaired";
+    case SNTDatabaseIntegrityCorrupted: return @"Corrupted";
+  }
+  return @"Unknown";
+}
+
+}  // namespace
+
+std::shared_ptr<DatabaseMaintenance> DatabaseMaintenance::Create(
+    NSDictionary<NSString*, SNTDatabaseTable*>* databases, SNTMetricSet* metric_set) {
+  return std::make_shared<DatabaseMaintenance>(databases, metric_set,
+                                               &PowerMonitor::IsOnExternalPower);
+}
+
+DatabaseMaintenance::DatabaseMaintenance(NSDictionary<NSString*, SNTDatabaseTable*>* databases,
+                                         SNTMetricSet* metric_set, CanRunFunc can_run)
+    : Timer<DatabaseMaintenance>(kMinIntervalSecs, kMaxIntervalSecs,
+                                 Timer::OnStart::kWaitOneCycle, "DatabaseMaintenance",
+                                 Timer::RescheduleMode::kTrailingEdge, QOS_CLASS_BACKGROUND),
+      databases_(databases),
+      can_run_(std::move(can_run)) {
+  page_count_ = [metric_set int64GaugeWithName:@"/santa/database/page_count"
+                                    fieldNames:@[ @"Database" ]
+                                      helpText:@"Number of pages in the database file"];
+  freelist_count_ = [metric_set int64GaugeWithName:@"/santa/database/freelist_count"
+                                        fieldNames:@[ @"Database" ]
+                                          helpText:@"Number of unused pages in the database file"];
+  size_bytes_ = [metric_set int64GaugeWithName:@"/santa/database/size_bytes"
+                                    fieldNames:@[ @"Database" ]
+                                      helpText:@"Size of the database file in bytes"];
+  analyzed_indexes_ =
+      [metric_set int64GaugeWithName:@"/santa/database/analyzed_indexes"
+                          fieldNames:@[ @"Database" ]
+                            helpText:@"Number of indexes with query planner statistics"];
+  integrity_checks_ = [metric_set counterWithName:@"/santa/database/integrity_checks"
+                                       fieldNames:@[ @"Database", @"Result" ]
+                                         helpText:@"Count of full database integrity checks by "
+                                                  @"result"];
+}
+
+bool DatabaseMaintenance::OnTimer() {
+  RunMaintenance();
+  return true;
+}
+
+bool DatabaseMaintenance::RunMaintenance() {
+  if (!can_run_()) {
+    LOGD(@"Skipping database maintenance while on battery power");
+    return false;
+  }
+
+  bool check_integrity = !integrity_checked_;
+  integrity_checked_ = true;
+
+  [databases_ enumerateKeysAndObjectsUsingBlock:^(NSString* name, SNTDatabaseTable* table,
+                                                  BOOL* stop) {
+    if (check_integrity) {
+      SNTDatabaseIntegrity integrity = [table checkIntegrity];
+      [integrity_checks_ incrementForFieldValues:@[ name, IntegrityToString(integrity) ]];
+    }
+
+    SNTDatabaseStats stats = [table performMaintenance];
+    [page_count_ set:(long long)stats.pageCount forFieldValues:@[ name ]];
+    [freelist_count_ set:(long long)stats.freelistCount forFieldValues:@[ name ]];
+    [size_bytes_ set:(long long)(stats.pageCount * stats.pageSize) forFieldValues:@[ name ]];
+    [analyzed_indexes_ set:(long long)stats.analyzedIndexCount forFieldValues:@[ name ]];
+    LOGD(@"Database maintenance complete for %@: %llu pages, %llu free", name, stats.pageCount,
+         stats.freelistCount);
+  }];
+  return true;
+}
+
+}  // namespace santa
@@ -0,0 +1,90 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/DatabaseMaintenance.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <memory>
+
+#import "Source/common/SNTMetricSet.h"
+#import "Source/santad/DataLayer/SNTEventTable.h"
+
+using santa::DatabaseMaintenance;
+
+@interface DatabaseMaintenanceTest : XCTestCase
+@property SNTEventTable* eventTable;
+@property SNTMetricSet* metricSet;
+@end
+
+@implementation DatabaseMaintenanceTest
+
+- (void)setUp {
+  self.eventTable = [[SNTEventTable alloc] initWithDatabaseQueue:[[FMDatabaseQueue alloc] init]];
+  self.metricSet = [[SNTMetricSet alloc] init];
+}
+
+- (long long)gaugeValue:(NSString*)name {
+  NSArray* values = [self.metricSet export][@"metrics"][name][@"fields"][@"Database"];
+  for (NSDictionary* value in values) {
+    if ([value[@"value"] isEqualToString:@"events"]) {
+      return [value[@"data"] longLongValue];
+    }
+  }
+  return 0;
+}
+
+- (void)testRunMaintenanceExportsStats {
+  auto maintenance = std::make_shared<DatabaseMaintenance>(@{@"events" : self.eventTable},
+                                                           self.metricSet, [] { return true; });
+  XCTAssertTrue(maintenance->RunMaintenance());
+
+  long long pages = [self gaugeValue:@"/santa/database/page_count"];
+  XCTAssertGreaterThan(pages, 0);
+  XCTAssertLessThanOrEqual([self gaugeValue:@"/santa/database/freelist_count"], pages);
+  XCTAssertGreaterThan([self gaugeValue:@"/santa/database/size_bytes"], pages);
+}
+
+- (long long)integrityChecksWithResult:(NSString*)result {
+  NSArray* values =
+      [self.metricSet export][@"metrics"][@"/santa/database/integrity_checks"][@"fields"]
+                             [@"Database,Result"];
+  for (NSDictionary* value in values) {
+    if ([value[@"value"] isEqualToString:[@"events," stringByAppendingString:result]]) {
+      return [value[@"data"] longLongValue];
+    }
+  }
+  return 0;
+}
+
+- (void)testFullIntegrityCheckRunsOnce {
+  auto maintenance = std::make_shared<DatabaseMaintenance>(@{@"events" : self.eventTable},
+                                                           self.metricSet, [] { return true; });
+  XCTAssertTrue(maintenance->RunMaintenance());
+  XCTAssertEqual([self integrityChecksWithResult:@"OK"], 1);
+
+  XCTAssertTrue(maintenance->RunMaintenance());
+  XCTAssertEqual([self integrityChecksWithResult:@"OK"], 1);
+  XCTAssertEqual([self integrityChecksWithResult:@"Corrupted"], 0);
+}
+
+- (void)testRunMaintenanceSkippedWhenNotAllowed {
+  auto maintenance = std::make_shared<DatabaseMaintenance>(@{@"events" : self.eventTable},
+                                                           self.metricSet, [] { return false; });
+  XCTAssertFalse(maintenance->RunMaintenance());
+  XCTAssertEqual([self gaugeValue:@"/santa/database/page_count"], 0);
+}
+
+@end
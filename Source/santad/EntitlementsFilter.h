@@ -18,11 +18,11 @@
 #import <Foundation/Foundation.h>
 
 #include <memory>
-#include <set>
 #include <string>
 
 #include "Source/common/PrefixTree.h"
 #include "Source/common/Unit.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/synchronization/mutex.h"
 
 namespace santa {
@@ -43,6 +43,9 @@ class EntitlementsFilter {
   EntitlementsFilter& operator=(EntitlementsFilter&& rhs) = delete;
 
   // Filter out given information based on current state of the filter configuration.
+  // The given entitlements must not be mutated afterwards. Nothing is copied:
+  // the result is either the given dictionary itself, or a new dictionary
+  // holding the same keys and values minus the filtered ones.
   NSDictionary* Filter(const char* teamID, NSDictionary* entitlements);
 
   // Update TeamID/Prefix filters based on configuration changes.
@@ -50,11 +53,24 @@ class EntitlementsFilter {
   void UpdatePrefixFilter(NSArray<NSString*>* filter);
 
  private:
-  void UpdateTeamIDFilterLocked(NSArray<NSString*>* filter) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
-  void UpdatePrefixFilterLocked(NSArray<NSString*>* filter) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  using TeamIDSet = absl::flat_hash_set<std::string>;
+  using PrefixSet = santa::PrefixTree<santa::Unit>;
 
-  std::set<std::string> teamid_filter_ ABSL_GUARDED_BY(lock_);
-  santa::PrefixTree<santa::Unit> prefix_filter_ ABSL_GUARDED_BY(lock_);
+  // Filters are never modified once published. Updates build new ones and
+  // swap them in, so filtering only holds the lock long enough to take a
+  // reference.
+  struct State {
+    std::shared_ptr<const TeamIDSet> teamids;
+    std::shared_ptr<PrefixSet> prefixes;
+  };
+
+  State CurrentState();
+
+  static std::shared_ptr<const TeamIDSet> MakeTeamIDFilter(NSArray<NSString*>* filter);
+  static std::shared_ptr<PrefixSet> MakePrefixFilter(NSArray<NSString*>* filter);
+  static bool HasFilteredPrefix(PrefixSet& prefixes, NSString* key);
+
+  State state_ ABSL_GUARDED_BY(lock_);
   absl::Mutex lock_;
 };
 
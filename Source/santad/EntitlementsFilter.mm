@@ -14,21 +14,45 @@
 
 #include "Source/santad/EntitlementsFilter.h"
 
+#include <string_view>
+#include <vector>
+
 #include "Source/common/PrefixTree.h"
-#import "Source/common/SNTDeepCopy.h"
 #include "Source/common/String.h"
 
 namespace santa {
 
+// Entitlement keys are reverse DNS names, nearly always short enough to be
+// converted without allocating.
+static constexpr size_t kMaxStackKeyLength = 256;
+
 std::unique_ptr<EntitlementsFilter> EntitlementsFilter::Create(NSArray<NSString*>* teamid_filter,
                                                                NSArray<NSString*>* prefix_filter) {
   return std::make_unique<EntitlementsFilter>(teamid_filter, prefix_filter);
 }
 
 EntitlementsFilter::EntitlementsFilter(NSArray<NSString*>* teamid_filter,
-                                       NSArray<NSString*>* prefix_filter) {
-  UpdateTeamIDFilterLocked(teamid_filter);
-  UpdatePrefixFilterLocked(prefix_filter);
+                                       NSArray<NSString*>* prefix_filter)
+    : state_{MakeTeamIDFilter(teamid_filter), MakePrefixFilter(prefix_filter)} {}
+
+EntitlementsFilter::State EntitlementsFilter::CurrentState() {
+  absl::ReaderMutexLock lock(lock_);
+  return state_;
+}
+
+bool EntitlementsFilter::HasFilteredPrefix(PrefixSet& prefixes, NSString* key) {
+  CFStringRef cf_key = (__bridge CFStringRef)key;
+  const char* utf8 = CFStringGetCStringPtr(cf_key, kCFStringEncodingUTF8);
+  if (utf8) {
+    return prefixes.HasPrefix(utf8);
+  }
+
+  char buf[kMaxStackKeyLength];
+  if (CFStringGetCString(cf_key, buf, sizeof(buf), kCFStringEncodingUTF8)) {
+    return prefixes.HasPrefix(buf);
+  }
+
+  return prefixes.HasPrefix(key.UTF8String);
 }
 
 NSDictionary* EntitlementsFilter::Filter(const char* teamID, NSDictionary* entitlements) {
@@ -36,58 +60,73 @@ NSDictionary* EntitlementsFilter::Filter(const char* teamID, NSDictionary* entit
     return nil;
   }
 
-  absl::ReaderMutexLock lock(lock_);
+  State state = CurrentState();
 
-  if (teamID && teamid_filter_.count(std::string(teamID)) > 0) {
+  if (teamID && state.teamids->contains(std::string_view(teamID))) {
     // Dropping entitlement logging for configured TeamID
     return nil;
   }
 
-  if (prefix_filter_.NodeCount() == 0) {
-    // No prefix filter exists, copying full entitlements
-    return [entitlements sntDeepCopy];
-  } else {
-    // Filtering entitlements based on prefixes
-    NSMutableDictionary* filtered = [NSMutableDictionary dictionary];
-
-    [entitlements enumerateKeysAndObjectsUsingBlock:^(NSString* key, id obj, BOOL* stop) {
-      if (!prefix_filter_.HasPrefix(key.UTF8String)) {
-        if ([obj isKindOfClass:[NSArray class]] || [obj isKindOfClass:[NSDictionary class]]) {
-          [filtered setObject:[obj sntDeepCopy] forKey:key];
-        } else {
-          [filtered setObject:[obj copy] forKey:key];
-        }
-      }
-    }];
-
-    return filtered.count > 0 ? filtered : nil;
+  if (state.prefixes->NodeCount() == 0) {
+    // No prefix filter exists, all entitlements are kept
+    return entitlements;
   }
+
+  // Filtering entitlements based on prefixes
+  __block std::vector<id> keys;
+  __block std::vector<id> objects;
+  keys.reserve(entitlements.count);
+  objects.reserve(entitlements.count);
+
+  [entitlements enumerateKeysAndObjectsUsingBlock:^(NSString* key, id obj, BOOL* stop) {
+    if (!HasFilteredPrefix(*state.prefixes, key)) {
+      keys.push_back(key);
+      objects.push_back(obj);
+    }
+  }];
+
+  if (keys.empty()) {
+    return nil;
+  } else if (keys.size() == entitlements.count) {
+    return entitlements;
+  }
+
+  return [NSDictionary dictionaryWithObjects:objects.data() forKeys:keys.data() count:keys.size()];
 }
 
 void EntitlementsFilter::UpdateTeamIDFilter(NSArray<NSString*>* filter) {
+  std::shared_ptr<const TeamIDSet> teamids = MakeTeamIDFilter(filter);
   absl::MutexLock lock(lock_);
-  UpdateTeamIDFilterLocked(filter);
+  state_.teamids = std::move(teamids);
 }
 
-void EntitlementsFilter::UpdateTeamIDFilterLocked(NSArray<NSString*>* filter) {
-  teamid_filter_.clear();
+std::shared_ptr<const EntitlementsFilter::TeamIDSet> EntitlementsFilter::MakeTeamIDFilter(
+    NSArray<NSString*>* filter) {
+  auto teamids = std::make_shared<TeamIDSet>();
+  teamids->reserve(filter.count);
 
   for (NSString* prefix in filter) {
-    teamid_filter_.insert(NSStringToUTF8String(prefix));
+    teamids->insert(NSStringToUTF8String(prefix));
   }
+
+  return teamids;
 }
 
 void EntitlementsFilter::UpdatePrefixFilter(NSArray<NSString*>* filter) {
+  std::shared_ptr<PrefixSet> prefixes = MakePrefixFilter(filter);
   absl::MutexLock lock(lock_);
-  UpdatePrefixFilterLocked(filter);
+  state_.prefixes = std::move(prefixes);
 }
 
-void EntitlementsFilter::UpdatePrefixFilterLocked(NSArray<NSString*>* filter) {
-  prefix_filter_.Reset();
+std::shared_ptr<EntitlementsFilter::PrefixSet> EntitlementsFilter::MakePrefixFilter(
+    NSArray<NSString*>* filter) {
+  auto prefixes = std::make_shared<PrefixSet>();
 
   for (NSString* item in filter) {
-    prefix_filter_.InsertPrefix(item.UTF8String, Unit{});
+    prefixes->InsertPrefix(item.UTF8String, Unit{});
   }
+
+  return prefixes;
 }
 
 }  // namespace santa
@@ -39,7 +39,7 @@ using santa::EntitlementsFilter;
   XCTAssertEqual(result.count, 0, @"Result should be empty");
 }
 
-- (void)testFilterNoFiltersReturnsDeepCopy {
+- (void)testFilterNoFiltersReturnsEntitlements {
   std::unique_ptr<EntitlementsFilter> filter = EntitlementsFilter::Create(@[], @[]);
 
   NSDictionary* entitlements = @{
@@ -54,11 +54,8 @@ using santa::EntitlementsFilter;
   XCTAssertEqualObjects(result[@"com.apple.security.app-sandbox"], @YES);
   XCTAssertEqualObjects(result[@"com.apple.security.network.client"], @YES);
 
-  // Verify it's a deep copy - modifying result shouldn't affect original
-  NSMutableDictionary* mutableResult = [result mutableCopy];
-  mutableResult[@"com.apple.security.app-sandbox"] = @NO;
-  XCTAssertEqualObjects(entitlements[@"com.apple.security.app-sandbox"], @YES,
-                        @"Original should be unchanged");
+  // Nothing was filtered, so nothing is copied
+  XCTAssertEqual(result, entitlements);
 }
 
 #pragma mark - TeamID Filtering Tests
@@ -137,6 +134,23 @@ using santa::EntitlementsFilter;
   XCTAssertEqual(result.count, 2);
   XCTAssertEqualObjects(result[@"com.myapp.custom"], @YES);
   XCTAssertEqualObjects(result[@"keychain-access-groups"], (@[ @"group1" ]));
+
+  // Kept values are shared with the original entitlements
+  XCTAssertEqual(result[@"keychain-access-groups"], entitlements[@"keychain-access-groups"]);
+}
+
+- (void)testFilterNoMatchingPrefixesReturnsEntitlements {
+  std::unique_ptr<EntitlementsFilter> filter = EntitlementsFilter::Create(@[], @[ @"com.apple." ]);
+
+  NSString* longKey = [@"com.myapp." stringByPaddingToLength:300
+                                                   withString:@"x"
+                                              startingAtIndex:0];
+  NSDictionary* entitlements = @{
+    @"com.myapp.custom" : @YES,
+    longKey : @YES,
+  };
+
+  XCTAssertEqual(filter->Filter("TEAMID123", entitlements), entitlements);
 }
 
 - (void)testFilterAllEntitlementsExcludedReturnsNil {
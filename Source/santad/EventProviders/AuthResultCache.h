@@ -20,14 +20,25 @@
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
 #include <sys/stat.h>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTMetricSet.h"
 #include "Source/common/SantaCache.h"
+#include "Source/common/SantaCacheStats.h"
+#include "Source/common/SantaSeqlockCache.h"
 #import "Source/common/SantaVnode.h"
+#include "Source/common/SingleFlight.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
 #import "Source/common/es/SNTEndpointSecurityClientBase.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 
 @class SNTCachedDecision;
 
@@ -84,20 +95,98 @@ class AuthResultCache {
   virtual bool AddToCache(const es_file_t* es_file, SNTAction decision,
                           SNTCachedDecision* cd = nil);
   virtual void RemoveFromCache(const es_file_t* es_file);
+
+  // Waits up to `timeout` for the evaluation of the file claimed by adding
+  // SNTActionRequestBinary to end, i.e. for its decision to be added. Returns
+  // false if it didn't end in time or no evaluation was in progress, in which
+  // case callers should poll the cache instead.
+  virtual bool WaitForEvaluation(const es_file_t* es_file, absl::Duration timeout);
   virtual CachedAuthResult CheckCache(const es_file_t* es_file);
   virtual CachedAuthResult CheckCache(SantaVnode vnode_id);
 
   virtual void FlushCache(FlushCacheMode mode, FlushCacheReason reason);
 
+  // Removes only the entries for files on the given device, e.g. when it is
+  // unmounted, and returns how many were removed. The ES cache is left alone,
+  // as with non-root flushes. Devices that hold the root volume get a full
+  // flush of all caches instead.
+  virtual uint64_t FlushCacheForDevice(dev_t fsid, FlushCacheReason reason);
+
+  // Removes only the entries for files the given predicate reports as
+  // affected, e.g. those whose decision could depend on a changed rule, and
+  // returns how many were removed. The ES cache is always cleared, as it may
+  // still hold allow decisions for affected files that were already evicted
+  // from the caches here.
+  virtual uint64_t FlushAffectedEntries(const std::function<bool(const SantaVnode&)>& affected,
+                                        FlushCacheReason reason);
+
+  // While a flush batch is open, e.g. while a sync applies several settings
+  // that each flush the caches, flushes requested with FlushCache are deferred
+  // and EndFlushBatch performs at most one flush covering all of them, counted
+  // once for each distinct reason. Entries removed by FlushAffectedEntries and
+  // FlushCacheForDevice are still removed right away, but the ES cache is only
+  // cleared once the batch ends. Batches may nest; nothing is flushed until
+  // the outermost one ends.
+  virtual void BeginFlushBatch();
+  virtual void EndFlushBatch();
+
   virtual NSArray<NSNumber*>* CacheCounts();
 
+  // Returns the allowed entries from the root volume cache. Used to persist
+  // the cache across daemon restarts.
+  virtual std::vector<std::pair<SantaVnode, SNTAction>> RootAllowEntries();
+
+  // Inserts a previously persisted allow entry. Existing entries are never
+  // overwritten and actions other than SNTActionRespondAllow and
+  // SNTActionRespondAllowCompiler are rejected.
+  virtual bool RestoreToCache(SantaVnode vnode_id, SNTAction decision);
+
+  // Returns the root and non-root cache stats, respectively.
+  virtual std::pair<SantaCacheStats, SantaCacheStats> CacheStats();
+
+  // Returns the root and non-root cache sizes, respectively.
+  virtual std::pair<SantaCacheUsage, SantaCacheUsage> CacheUsage();
+
+  // Change the maximum number of entries in the root or non-root cache,
+  // evicting entries if it is over the new maximum.
+  virtual void SetMaxRootCacheSize(uint64_t max_size);
+  virtual void SetMaxNonRootCacheSize(uint64_t max_size);
+
   virtual void SetESClient(id<SNTEndpointSecurityClientBase> client);
 
  private:
-  virtual SantaCache<SantaVnode, CachedAuthResult>* CacheForVnodeID(SantaVnode vnode_id);
-
-  SantaCache<SantaVnode, CachedAuthResult>* root_cache_;
-  SantaCache<SantaVnode, CachedAuthResult>* nonroot_cache_;
+  // The portion of a CachedAuthResult held in the lock-free caches consulted on
+  // every AUTH_EXEC. The SNTCachedDecision reference prevents CachedAuthResult
+  // itself from being stored there, so decisions for
+  // SNTActionRespondAllowNoCache entries are kept in no_cache_decisions_.
+  struct CachedAuthState {
+    SNTAction action = SNTActionUnset;
+    uint64_t timestamp = 0;
+
+    bool operator==(const CachedAuthState& rhs) const {
+      return action == rhs.action && timestamp == rhs.timestamp;
+    }
+  };
+
+  using AuthStateCache = SantaSeqlockCache<SantaVnode, CachedAuthState>;
+
+  virtual AuthStateCache* CacheForVnodeID(SantaVnode vnode_id);
+  void FlushLocalCaches(FlushCacheMode mode);
+  void ClearESCache();
+  // Clears the ES cache now, or once the open flush batch ends.
+  void ClearESCacheOrDefer();
+
+  AuthStateCache* root_cache_;
+  AuthStateCache* nonroot_cache_;
+  SantaCache<SantaVnode, SNTCachedDecision*> no_cache_decisions_;
+  SingleFlight<SantaVnode> evaluations_;
+
+  absl::Mutex flush_batch_mu_;
+  int flush_batch_depth_ ABSL_GUARDED_BY(flush_batch_mu_) = 0;
+  std::optional<FlushCacheMode> pending_flush_mode_ ABSL_GUARDED_BY(flush_batch_mu_);
+  // One bit per FlushCacheReason of a deferred flush.
+  uint32_t pending_flush_reasons_ ABSL_GUARDED_BY(flush_batch_mu_) = 0;
+  bool pending_es_clear_ ABSL_GUARDED_BY(flush_batch_mu_) = false;
 
   std::shared_ptr<santa::EndpointSecurityAPI> esapi_;
   SNTMetricCounter* flush_count_;
@@ -17,6 +17,9 @@
 
 #include <mach/clock_types.h>
 
+#include <optional>
+#include <utility>
+
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTLogging.h"
 #include "Source/common/SystemResources.h"
@@ -76,8 +79,10 @@ AuthResultCache::AuthResultCache(std::shared_ptr<EndpointSecurityAPI> esapi,
     : esapi_(esapi),
       flush_count_(flush_count),
       cache_deny_time_ns_(cache_deny_time_ms * NSEC_PER_MSEC) {
-  root_cache_ = new SantaCache<SantaVnode, CachedAuthResult>();
-  nonroot_cache_ = new SantaCache<SantaVnode, CachedAuthResult>();
+  // A full flush of these caches makes every subsequent exec take the slow
+  // path at once, so evict gradually when they fill instead.
+  root_cache_ = new AuthStateCache(10000, 4, SantaCacheEvictionPolicy::kClock);
+  nonroot_cache_ = new AuthStateCache(10000, 4, SantaCacheEvictionPolicy::kClock);
 
   struct stat sb;
   if (stat("/", &sb) == 0) {
@@ -98,43 +103,76 @@ AuthResultCache::~AuthResultCache() {
 bool AuthResultCache::AddToCache(const es_file_t* es_file, SNTAction decision,
                                  SNTCachedDecision* cd) {
   SantaVnode vnode_id = SantaVnode::VnodeForFile(es_file);
-  SantaCache<SantaVnode, CachedAuthResult>* cache = CacheForVnodeID(vnode_id);
-  CachedAuthResult requestBinary = {SNTActionRequestBinary, 0, nil};
+  AuthStateCache* cache = CacheForVnodeID(vnode_id);
+  CachedAuthState requestBinary = {SNTActionRequestBinary, 0};
 
+  bool added;
   switch (decision) {
     // SNTActionRequestBinary and SNTActionRespondHold are not terminal states and should not
     // contain a timestamp to allow for proper transitions out of the state.
-    case SNTActionRequestBinary: return cache->set(vnode_id, requestBinary, CachedAuthResult{});
+    case SNTActionRequestBinary:
+      // Only one caller can claim the evaluation of a file. The others wait for
+      // its decision, so the evaluation is tracked until it is replaced below.
+      if (!cache->set(vnode_id, requestBinary, CachedAuthState{})) {
+        return false;
+      }
+      evaluations_.Begin(vnode_id);
+      return true;
     case SNTActionRespondHold:
-      return cache->set(vnode_id, CachedAuthResult{SNTActionRespondHold, 0, nil}, requestBinary);
+      added = cache->set(vnode_id, CachedAuthState{SNTActionRespondHold, 0}, requestBinary);
+      break;
 
     case SNTActionRespondAllow: OS_FALLTHROUGH;
     case SNTActionRespondAllowCompiler: OS_FALLTHROUGH;
     case SNTActionRespondDeny:
-      return cache->set(vnode_id, CachedAuthResult{decision, GetCurrentUptime(), nil},
-                        requestBinary);
+      added = cache->set(vnode_id, CachedAuthState{decision, GetCurrentUptime()}, requestBinary);
+      break;
 
     case SNTActionRespondAllowNoCache: {
-      CachedAuthResult entry = {SNTActionRespondAllowNoCache, GetCurrentUptime(), [cd copy]};
-      return cache->set(vnode_id, entry, requestBinary);
+      // Publish the decision before the state so that readers observing the
+      // state can find it. A reader racing the two stores gets a nil decision
+      // and falls back to a full evaluation.
+      no_cache_decisions_.set(vnode_id, [cd copy]);
+      added = cache->set(vnode_id,
+                         CachedAuthState{SNTActionRespondAllowNoCache, GetCurrentUptime()},
+                         requestBinary);
+      if (!added) {
+        no_cache_decisions_.remove(vnode_id);
+      }
+      break;
     }
 
     // SNTActionHoldAllowed and SNTActionHoldDenied are used for transitions, however the
     // cached action is translated to SNTActionRespondAllow or SNTActionRespondDeny respectively.
     // We do not want to cache this result and later execs need to go through this path again.
     case SNTActionHoldAllowed: OS_FALLTHROUGH;
-    case SNTActionHoldDenied: cache->remove(vnode_id); return YES;
+    case SNTActionHoldDenied:
+      cache->remove(vnode_id);
+      no_cache_decisions_.remove(vnode_id);
+      added = true;
+      break;
 
     default:
       // This is a programming error. Bail.
       LOGE(@"Invalid cache value, exiting.");
       exit(EXIT_FAILURE);
   }
+
+  // Wake anyone waiting on the evaluation, even if the entry was flushed while
+  // it ran, so they can check the cache again.
+  evaluations_.End(vnode_id);
+  return added;
+}
+
+bool AuthResultCache::WaitForEvaluation(const es_file_t* es_file, absl::Duration timeout) {
+  return evaluations_.Wait(SantaVnode::VnodeForFile(es_file), timeout);
 }
 
 void AuthResultCache::RemoveFromCache(const es_file_t* es_file) {
   SantaVnode vnode_id = SantaVnode::VnodeForFile(es_file);
   CacheForVnodeID(vnode_id)->remove(vnode_id);
+  no_cache_decisions_.remove(vnode_id);
+  evaluations_.End(vnode_id);
 }
 
 CachedAuthResult AuthResultCache::CheckCache(const es_file_t* es_file) {
@@ -142,54 +180,189 @@ CachedAuthResult AuthResultCache::CheckCache(const es_file_t* es_file) {
 }
 
 CachedAuthResult AuthResultCache::CheckCache(SantaVnode vnode_id) {
-  SantaCache<SantaVnode, CachedAuthResult>* cache = CacheForVnodeID(vnode_id);
+  AuthStateCache* cache = CacheForVnodeID(vnode_id);
 
-  CachedAuthResult entry = cache->get(vnode_id);
-  if (entry == CachedAuthResult{}) {
+  CachedAuthState state = cache->get(vnode_id);
+  if (state == CachedAuthState{}) {
     return {};
   }
 
-  if (entry.action == SNTActionRespondDeny) {
-    uint64_t expiry_time = entry.timestamp + cache_deny_time_ns_;
+  if (state.action == SNTActionRespondDeny) {
+    uint64_t expiry_time = state.timestamp + cache_deny_time_ns_;
     if (expiry_time < GetCurrentUptime()) {
       cache->remove(vnode_id);
       return {};
     }
   }
 
+  CachedAuthResult entry = {state.action, state.timestamp, nil};
+  if (state.action == SNTActionRespondAllowNoCache) {
+    entry.cached_decision = no_cache_decisions_.get(vnode_id);
+  }
+
   return entry;
 }
 
-SantaCache<SantaVnode, CachedAuthResult>* AuthResultCache::CacheForVnodeID(SantaVnode vnode_id) {
+AuthResultCache::AuthStateCache* AuthResultCache::CacheForVnodeID(SantaVnode vnode_id) {
   return (vnode_id.fsid == root_devno_ || root_devno_ == 0) ? root_cache_ : nonroot_cache_;
 }
 
 void AuthResultCache::FlushCache(FlushCacheMode mode, FlushCacheReason reason) {
+  {
+    absl::MutexLock lock(&flush_batch_mu_);
+    if (flush_batch_depth_ > 0) {
+      if (mode == FlushCacheMode::kAllCaches || !pending_flush_mode_) {
+        pending_flush_mode_ = mode;
+      }
+      pending_flush_reasons_ |= 1u << static_cast<int>(reason);
+      return;
+    }
+  }
+
+  FlushLocalCaches(mode);
+  [flush_count_ incrementForFieldValues:@[ FlushCacheReasonToString(reason) ]];
+}
+
+void AuthResultCache::FlushLocalCaches(FlushCacheMode mode) {
   nonroot_cache_->clear();
   if (mode == FlushCacheMode::kAllCaches) {
     root_cache_->clear();
+    no_cache_decisions_.clear();
 
     // Clear the ES cache when all local caches are flushed. Assume the ES cache
     // doesn't need to be cleared when only flushing the non-root cache.
-    //
-    // Calling into ES should be done asynchronously since it could otherwise
-    // potentially deadlock.
-    auto shared_esapi = esapi_->shared_from_this();
-    id<SNTEndpointSecurityClientBase> client = es_client_;
-    if (client) {
-      dispatch_async(q_, ^{
-        [client clearCache];
-      });
+    ClearESCache();
+  } else {
+    no_cache_decisions_.remove_if([this](const SantaVnode& vnode_id, SNTCachedDecision*&) {
+      return CacheForVnodeID(vnode_id) == nonroot_cache_;
+    });
+  }
+}
+
+void AuthResultCache::BeginFlushBatch() {
+  absl::MutexLock lock(&flush_batch_mu_);
+  flush_batch_depth_++;
+}
+
+void AuthResultCache::EndFlushBatch() {
+  std::optional<FlushCacheMode> mode;
+  uint32_t reasons;
+  bool es_clear;
+  {
+    absl::MutexLock lock(&flush_batch_mu_);
+    if (flush_batch_depth_ == 0 || --flush_batch_depth_ > 0) {
+      return;
     }
+    mode = std::exchange(pending_flush_mode_, std::nullopt);
+    reasons = std::exchange(pending_flush_reasons_, 0);
+    es_clear = std::exchange(pending_es_clear_, false);
+  }
+
+  if (mode) {
+    FlushLocalCaches(*mode);
+  }
+  // A full flush has already cleared the ES cache.
+  if (es_clear && mode != FlushCacheMode::kAllCaches) {
+    ClearESCache();
+  }
+
+  for (int reason = 0; reasons != 0; reason++, reasons >>= 1) {
+    if (reasons & 1) {
+      [flush_count_ incrementForFieldValues:@[ FlushCacheReasonToString(
+                                                static_cast<FlushCacheReason>(reason)) ]];
+    }
+  }
+}
+
+uint64_t AuthResultCache::FlushCacheForDevice(dev_t fsid, FlushCacheReason reason) {
+  if (fsid == root_devno_ || root_devno_ == 0) {
+    uint64_t count = root_cache_->count() + nonroot_cache_->count();
+    FlushCache(FlushCacheMode::kAllCaches, reason);
+    return count;
   }
 
+  auto on_device = [fsid](const SantaVnode& vnode_id, auto&) { return vnode_id.fsid == fsid; };
+  uint64_t removed = nonroot_cache_->remove_if(on_device);
+  no_cache_decisions_.remove_if(on_device);
+
   [flush_count_ incrementForFieldValues:@[ FlushCacheReasonToString(reason) ]];
+  return removed;
+}
+
+uint64_t AuthResultCache::FlushAffectedEntries(
+    const std::function<bool(const SantaVnode&)>& affected, FlushCacheReason reason) {
+  auto is_affected = [&affected](const SantaVnode& vnode_id, auto&) { return affected(vnode_id); };
+  uint64_t removed = root_cache_->remove_if(is_affected) + nonroot_cache_->remove_if(is_affected);
+  no_cache_decisions_.remove_if(is_affected);
+
+  ClearESCacheOrDefer();
+
+  [flush_count_ incrementForFieldValues:@[ FlushCacheReasonToString(reason) ]];
+  return removed;
+}
+
+void AuthResultCache::ClearESCacheOrDefer() {
+  {
+    absl::MutexLock lock(&flush_batch_mu_);
+    if (flush_batch_depth_ > 0) {
+      pending_es_clear_ = true;
+      return;
+    }
+  }
+  ClearESCache();
+}
+
+void AuthResultCache::ClearESCache() {
+  // Calling into ES should be done asynchronously since it could otherwise
+  // potentially deadlock.
+  auto shared_esapi = esapi_->shared_from_this();
+  id<SNTEndpointSecurityClientBase> client = es_client_;
+  if (client) {
+    dispatch_async(q_, ^{
+      [client clearCache];
+    });
+  }
 }
 
 NSArray<NSNumber*>* AuthResultCache::CacheCounts() {
   return @[ @(root_cache_->count()), @(nonroot_cache_->count()) ];
 }
 
+std::vector<std::pair<SantaVnode, SNTAction>> AuthResultCache::RootAllowEntries() {
+  std::vector<std::pair<SantaVnode, SNTAction>> entries;
+  entries.reserve(root_cache_->count());
+  root_cache_->foreach([&entries](SantaVnode& vnode_id, CachedAuthState& state) {
+    if (state.action == SNTActionRespondAllow || state.action == SNTActionRespondAllowCompiler) {
+      entries.emplace_back(vnode_id, state.action);
+    }
+  });
+  return entries;
+}
+
+bool AuthResultCache::RestoreToCache(SantaVnode vnode_id, SNTAction decision) {
+  if (decision != SNTActionRespondAllow && decision != SNTActionRespondAllowCompiler) {
+    return false;
+  }
+  return CacheForVnodeID(vnode_id)->set(vnode_id, CachedAuthState{decision, GetCurrentUptime()},
+                                        CachedAuthState{});
+}
+
+std::pair<SantaCacheStats, SantaCacheStats> AuthResultCache::CacheStats() {
+  return {root_cache_->stats(), nonroot_cache_->stats()};
+}
+
+std::pair<SantaCacheUsage, SantaCacheUsage> AuthResultCache::CacheUsage() {
+  return {root_cache_->usage(), nonroot_cache_->usage()};
+}
+
+void AuthResultCache::SetMaxRootCacheSize(uint64_t max_size) {
+  root_cache_->set_max_size(max_size);
+}
+
+void AuthResultCache::SetMaxNonRootCacheSize(uint64_t max_size) {
+  nonroot_cache_->set_max_size(max_size);
+}
+
 void AuthResultCache::SetESClient(id<SNTEndpointSecurityClientBase> client) {
   es_client_ = client;
 }
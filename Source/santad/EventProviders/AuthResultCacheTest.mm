@@ -20,6 +20,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <memory>
 #include <vector>
@@ -31,6 +32,7 @@
 #include "Source/common/es/MockEndpointSecurityAPI.h"
 #import "Source/common/es/SNTEndpointSecurityClientBase.h"
 #include "Source/santad/EventProviders/AuthResultCache.h"
+#include "absl/time/time.h"
 
 using santa::AuthResultCache;
 using santa::FlushCacheMode;
@@ -169,6 +171,61 @@ static inline void AssertCacheCounts(std::shared_ptr<AuthResultCache> cache, uin
   AssertCacheCounts(cache, 0, 0);
 }
 
+- (void)testFlushBatch {
+  id<SNTEndpointSecurityClientBase> client =
+      OCMProtocolMock(@protocol(SNTEndpointSecurityClientBase));
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(mockESApi, nil);
+  cache->SetESClient(client);
+
+  es_file_t rootFile = MakeCacheableFile(RootDevno(), 111);
+  es_file_t nonrootFile = MakeCacheableFile(RootDevno() + 123, 111);
+
+  cache->AddToCache(&rootFile, SNTActionRequestBinary);
+  cache->AddToCache(&nonrootFile, SNTActionRequestBinary);
+
+  AssertCacheCounts(cache, 1, 1);
+
+  __block int clearCount = 0;
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  OCMStub([client clearCache])
+      .andDo(^(NSInvocation* invocation) {
+        clearCount++;
+        dispatch_semaphore_signal(sema);
+      })
+      .andReturn(true);
+
+  // Flushes are deferred until the outermost batch ends
+  cache->BeginFlushBatch();
+  cache->FlushCache(FlushCacheMode::kNonRootOnly, FlushCacheReason::kClientModeChanged);
+  cache->BeginFlushBatch();
+  cache->FlushCache(FlushCacheMode::kAllCaches, FlushCacheReason::kCELFallbackRulesChanged);
+  cache->EndFlushBatch();
+
+  AssertCacheCounts(cache, 1, 1);
+
+  cache->FlushCache(FlushCacheMode::kNonRootOnly, FlushCacheReason::kClientModeChanged);
+  cache->EndFlushBatch();
+
+  // The ES cache is cleared once for the whole batch
+  XCTAssertEqual(0,
+                 dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+                 "ClearCache wasn't called within expected time window");
+  XCTAssertNotEqual(0,
+                    dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC)));
+  XCTAssertEqual(clearCount, 1);
+
+  AssertCacheCounts(cache, 0, 0);
+
+  // Without a batch, flushes happen right away
+  cache->AddToCache(&nonrootFile, SNTActionRequestBinary);
+  cache->FlushCache(FlushCacheMode::kNonRootOnly, FlushCacheReason::kClientModeChanged);
+  AssertCacheCounts(cache, 0, 0);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
 - (void)testCacheStateMachine {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(mockESApi, nil);
@@ -292,6 +349,156 @@ static inline void AssertCacheCounts(std::shared_ptr<AuthResultCache> cache, uin
   XCTAssertNil(cache->CheckCache(&rootFile).cached_decision);
 }
 
+- (void)testWaitForEvaluation {
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+
+  es_file_t rootFile = MakeCacheableFile(RootDevno(), 111);
+
+  // There's nothing to wait for until an evaluation is claimed, and it can
+  // only be claimed once
+  XCTAssertFalse(cache->WaitForEvaluation(&rootFile, absl::ZeroDuration()));
+  XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRequestBinary));
+  XCTAssertFalse(cache->AddToCache(&rootFile, SNTActionRequestBinary));
+  XCTAssertFalse(cache->WaitForEvaluation(&rootFile, absl::Milliseconds(1)));
+
+  // Adding the decision wakes waiters
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  __block bool woken = false;
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    woken = cache->WaitForEvaluation(&rootFile, absl::Seconds(10));
+    dispatch_semaphore_signal(sema);
+  });
+
+  usleep(100000);
+  XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRespondAllow));
+  XCTAssertSemaTrue(sema, 5, "Waiter not woken within expected window");
+  XCTAssertTrue(woken);
+  XCTAssertEqual(cache->CheckCache(&rootFile).action, SNTActionRespondAllow);
+  XCTAssertFalse(cache->WaitForEvaluation(&rootFile, absl::ZeroDuration()));
+}
+
+- (void)testNonRootFlushKeepsRootDecisions {
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+
+  es_file_t rootFile = MakeCacheableFile(RootDevno(), 111);
+  es_file_t nonrootFile = MakeCacheableFile(RootDevno() + 123, 222);
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.sha256 = @"abc123";
+
+  XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRequestBinary));
+  XCTAssertTrue(cache->AddToCache(&rootFile, SNTActionRespondAllowNoCache, cd));
+  XCTAssertTrue(cache->AddToCache(&nonrootFile, SNTActionRequestBinary));
+  XCTAssertTrue(cache->AddToCache(&nonrootFile, SNTActionRespondAllowNoCache, cd));
+
+  cache->FlushCache(FlushCacheMode::kNonRootOnly, FlushCacheReason::kFilesystemUnmounted);
+
+  XCTAssertEqualObjects(cache->CheckCache(&rootFile).cached_decision.sha256, @"abc123");
+  XCTAssertEqual(cache->CheckCache(&nonrootFile).action, SNTActionUnset);
+  XCTAssertNil(cache->CheckCache(&nonrootFile).cached_decision);
+}
+
+- (void)testFlushCacheForDevice {
+  id<SNTEndpointSecurityClientBase> client =
+      OCMStrictProtocolMock(@protocol(SNTEndpointSecurityClientBase));
+
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+  cache->SetESClient(client);
+
+  es_file_t rootFile = MakeCacheableFile(RootDevno(), 111);
+  es_file_t usbFile1 = MakeCacheableFile(RootDevno() + 123, 222);
+  es_file_t usbFile2 = MakeCacheableFile(RootDevno() + 123, 333);
+  es_file_t dmgFile = MakeCacheableFile(RootDevno() + 456, 222);
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.sha256 = @"abc123";
+
+  for (es_file_t* file : {&rootFile, &usbFile1, &usbFile2, &dmgFile}) {
+    XCTAssertTrue(cache->AddToCache(file, SNTActionRequestBinary));
+  }
+  XCTAssertTrue(cache->AddToCache(&usbFile2, SNTActionRespondAllowNoCache, cd));
+  XCTAssertTrue(cache->AddToCache(&dmgFile, SNTActionRespondAllowNoCache, cd));
+  AssertCacheCounts(cache, 1, 3);
+
+  // Only entries on the unmounted device are removed, without clearing the ES
+  // cache (the strict mock fails on clearCache)
+  XCTAssertEqual(cache->FlushCacheForDevice(RootDevno() + 123,
+                                            FlushCacheReason::kFilesystemUnmounted),
+                 2);
+  AssertCacheCounts(cache, 1, 1);
+  XCTAssertEqual(cache->CheckCache(&usbFile1).action, SNTActionUnset);
+  XCTAssertEqual(cache->CheckCache(&usbFile2).action, SNTActionUnset);
+  XCTAssertEqualObjects(cache->CheckCache(&dmgFile).cached_decision.sha256, @"abc123");
+
+  // A device that held nothing removes nothing
+  XCTAssertEqual(cache->FlushCacheForDevice(RootDevno() + 789,
+                                            FlushCacheReason::kFilesystemUnmounted),
+                 0);
+  AssertCacheCounts(cache, 1, 1);
+
+  // The root device flushes everything
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  OCMExpect([client clearCache])
+      .andDo(^(NSInvocation* invocation) {
+        dispatch_semaphore_signal(sema);
+      })
+      .andReturn(true);
+
+  XCTAssertEqual(
+      cache->FlushCacheForDevice(RootDevno(), FlushCacheReason::kFilesystemUnmounted), 2);
+  XCTAssertSemaTrue(sema, 5, "ClearCache wasn't called within expected time window");
+  AssertCacheCounts(cache, 0, 0);
+}
+
+- (void)testFlushAffectedEntries {
+  id<SNTEndpointSecurityClientBase> client =
+      OCMStrictProtocolMock(@protocol(SNTEndpointSecurityClientBase));
+
+  auto esapi = std::make_shared<MockEndpointSecurityAPI>();
+  std::shared_ptr<AuthResultCache> cache = AuthResultCache::Create(esapi, nil);
+  cache->SetESClient(client);
+
+  es_file_t rootFile1 = MakeCacheableFile(RootDevno(), 111);
+  es_file_t rootFile2 = MakeCacheableFile(RootDevno(), 222);
+  es_file_t nonrootFile1 = MakeCacheableFile(RootDevno() + 123, 111);
+  es_file_t nonrootFile2 = MakeCacheableFile(RootDevno() + 123, 222);
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.sha256 = @"abc123";
+
+  for (es_file_t* file : {&rootFile1, &rootFile2, &nonrootFile1, &nonrootFile2}) {
+    XCTAssertTrue(cache->AddToCache(file, SNTActionRequestBinary));
+  }
+  XCTAssertTrue(cache->AddToCache(&rootFile1, SNTActionRespondAllow));
+  XCTAssertTrue(cache->AddToCache(&rootFile2, SNTActionRespondDeny));
+  XCTAssertTrue(cache->AddToCache(&nonrootFile1, SNTActionRespondAllowNoCache, cd));
+  XCTAssertTrue(cache->AddToCache(&nonrootFile2, SNTActionRespondAllowNoCache, cd));
+  AssertCacheCounts(cache, 2, 2);
+
+  // Only the affected entries are removed, but the ES cache is still cleared
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  OCMExpect([client clearCache])
+      .andDo(^(NSInvocation* invocation) {
+        dispatch_semaphore_signal(sema);
+      })
+      .andReturn(true);
+
+  XCTAssertEqual(cache->FlushAffectedEntries(
+                     [](const SantaVnode& vnode_id) { return vnode_id.fileid == 111; },
+                     FlushCacheReason::kRulesChanged),
+                 2);
+  XCTAssertSemaTrue(sema, 5, "ClearCache wasn't called within expected time window");
+  AssertCacheCounts(cache, 1, 1);
+
+  XCTAssertEqual(cache->CheckCache(&rootFile1).action, SNTActionUnset);
+  XCTAssertEqual(cache->CheckCache(&rootFile2).action, SNTActionRespondDeny);
+  XCTAssertEqual(cache->CheckCache(&nonrootFile1).action, SNTActionUnset);
+  XCTAssertEqualObjects(cache->CheckCache(&nonrootFile2).cached_decision.sha256, @"abc123");
+}
+
 - (void)testCacheExpiry {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   // Create a cache with a lowered cache expiry value
@@ -0,0 +1,94 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_EVENTPROVIDERS_FAAMUTEAUTOPILOT_H
+#define SANTA_SANTAD_EVENTPROVIDERS_FAAMUTEAUTOPILOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// Tracks target paths that FAA keeps evaluating to the same allowed result so
+// that the client can mute them in the kernel and stop receiving their events.
+//
+// A path becomes a mute candidate once it has been allowed a minimum number of
+// times within a window starting at its first observation. Any other result
+// for the path starts the count over. The number of paths that may be muted is
+// bounded. Muted paths are remembered so that when the policies change, only
+// the ones that are no longer allowed need to be unmuted.
+//
+// Observations are only a heuristic for which paths are hot. Callers must
+// still verify that no policy could produce a different result for a
+// candidate path before muting it.
+class FAAMuteAutopilot {
+ public:
+  FAAMuteAutopilot(size_t min_allowed_count, uint64_t window_ns,
+                   size_t max_tracked_paths, size_t max_muted_paths);
+
+  // Not copyable or movable
+  FAAMuteAutopilot(const FAAMuteAutopilot& other) = delete;
+  FAAMuteAutopilot& operator=(const FAAMuteAutopilot& other) = delete;
+
+  // Records an evaluation of the path that was allowed. Returns true if the
+  // path is now a mute candidate, at which point its observation is dropped.
+  bool RecordAllowed(std::string_view path, uint64_t cur_mach_time);
+
+  // Records an evaluation of the path that was not allowed.
+  void RecordNotAllowed(std::string_view path);
+
+  // Claims room for muting the path. Returns false if the maximum number of
+  // muted paths has been reached, or the path is already muted.
+  bool ReserveMute(std::string_view path);
+
+  // Forgets all observations, e.g. because the policies changed, and returns
+  // the paths that are currently muted.
+  std::vector<std::string> ResetObservations();
+
+  // Forgets that the given paths are muted.
+  void ForgetMuted(const std::vector<std::string>& paths);
+
+  // Forgets all observations and muted paths.
+  void Reset();
+
+  size_t MutedCount();
+
+ private:
+  struct Observation {
+    size_t allowed_count;
+    uint64_t window_end_mach_time;
+  };
+
+  const size_t min_allowed_count_;
+  const uint64_t window_ns_;
+  const size_t max_tracked_paths_;
+  const size_t max_muted_paths_;
+
+  absl::Mutex mtx_;
+  absl::flat_hash_map<std::string, Observation> observations_
+      ABSL_GUARDED_BY(mtx_);
+  absl::flat_hash_set<std::string> muted_ ABSL_GUARDED_BY(mtx_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_EVENTPROVIDERS_FAAMUTEAUTOPILOT_H
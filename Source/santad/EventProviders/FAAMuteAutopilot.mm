@@ -0,0 +1,95 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/EventProviders/FAAMuteAutopilot.h"
+
+#include "Source/common/SystemResources.h"
+
+namespace santa {
+
+FAAMuteAutopilot::FAAMuteAutopilot(size_t min_allowed_count, uint64_t window_ns,
+                                   size_t max_tracked_paths, size_t max_muted_paths)
+    : min_allowed_count_(min_allowed_count),
+      window_ns_(window_ns),
+      max_tracked_paths_(max_tracked_paths),
+      max_muted_paths_(max_muted_paths) {}
+
+bool FAAMuteAutopilot::RecordAllowed(std::string_view path, uint64_t cur_mach_time) {
+  absl::MutexLock lock(mtx_);
+
+  if (muted_.size() >= max_muted_paths_) {
+    return false;
+  }
+
+  auto it = observations_.find(path);
+  if (it == observations_.end()) {
+    // Simple bound on memory use. Hot paths will quickly be seen again.
+    if (observations_.size() >= max_tracked_paths_) {
+      observations_.clear();
+    }
+    it = observations_.emplace(path, Observation{0, 0}).first;
+  }
+
+  // Start a new window if this is the first observation or the last expired
+  if (cur_mach_time > it->second.window_end_mach_time) {
+    it->second = {0, AddNanosecondsToMachTime(window_ns_, cur_mach_time)};
+  }
+
+  if (++it->second.allowed_count < min_allowed_count_) {
+    return false;
+  }
+
+  observations_.erase(it);
+  return true;
+}
+
+void FAAMuteAutopilot::RecordNotAllowed(std::string_view path) {
+  absl::MutexLock lock(mtx_);
+  observations_.erase(path);
+}
+
+bool FAAMuteAutopilot::ReserveMute(std::string_view path) {
+  absl::MutexLock lock(mtx_);
+  if (muted_.size() >= max_muted_paths_) {
+    return false;
+  }
+
+  return muted_.emplace(path).second;
+}
+
+std::vector<std::string> FAAMuteAutopilot::ResetObservations() {
+  absl::MutexLock lock(mtx_);
+  observations_.clear();
+  return std::vector<std::string>(muted_.begin(), muted_.end());
+}
+
+void FAAMuteAutopilot::ForgetMuted(const std::vector<std::string>& paths) {
+  absl::MutexLock lock(mtx_);
+  for (const std::string& path : paths) {
+    muted_.erase(path);
+  }
+}
+
+void FAAMuteAutopilot::Reset() {
+  absl::MutexLock lock(mtx_);
+  observations_.clear();
+  muted_.clear();
+}
+
+size_t FAAMuteAutopilot::MutedCount() {
+  absl::MutexLock lock(mtx_);
+  return muted_.size();
+}
+
+}  // namespace santa
@@ -0,0 +1,124 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/EventProviders/FAAMuteAutopilot.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Source/common/SystemResources.h"
+
+using santa::FAAMuteAutopilot;
+
+@interface FAAMuteAutopilotTest : XCTestCase
+@end
+
+@implementation FAAMuteAutopilotTest
+
+- (void)testRecordAllowed {
+  FAAMuteAutopilot autopilot(3, 10 * NSEC_PER_SEC, 100, 100);
+  uint64_t now = 1000;
+
+  XCTAssertFalse(autopilot.RecordAllowed("/foo", now));
+  XCTAssertFalse(autopilot.RecordAllowed("/bar", now));
+  XCTAssertFalse(autopilot.RecordAllowed("/foo", now));
+  XCTAssertTrue(autopilot.RecordAllowed("/foo", now));
+
+  // The observation is dropped once the path becomes a candidate
+  XCTAssertFalse(autopilot.RecordAllowed("/foo", now));
+}
+
+- (void)testRecordNotAllowedStartsOver {
+  FAAMuteAutopilot autopilot(2, 10 * NSEC_PER_SEC, 100, 100);
+  uint64_t now = 1000;
+
+  XCTAssertFalse(autopilot.RecordAllowed("/foo", now));
+  autopilot.RecordNotAllowed("/foo");
+  XCTAssertFalse(autopilot.RecordAllowed("/foo", now));
+  XCTAssertTrue(autopilot.RecordAllowed("/foo", now));
+}
+
+- (void)testWindowExpires {
+  FAAMuteAutopilot autopilot(2, 1 * NSEC_PER_SEC, 100, 100);
+  uint64_t now = 1000;
+
+  XCTAssertFalse(autopilot.RecordAllowed("/foo", now));
+
+  // The second evaluation comes too late and starts a new window
+  now = AddNanosecondsToMachTime(2 * NSEC_PER_SEC, now);
+  XCTAssertFalse(autopilot.RecordAllowed("/foo", now));
+  XCTAssertTrue(autopilot.RecordAllowed("/foo", now));
+}
+
+- (void)testMaxTrackedPaths {
+  FAAMuteAutopilot autopilot(2, 10 * NSEC_PER_SEC, 2, 100);
+  uint64_t now = 1000;
+
+  XCTAssertFalse(autopilot.RecordAllowed("/a", now));
+  XCTAssertFalse(autopilot.RecordAllowed("/b", now));
+
+  // Tracking a third path forgets the others
+  XCTAssertFalse(autopilot.RecordAllowed("/c", now));
+  XCTAssertFalse(autopilot.RecordAllowed("/a", now));
+  XCTAssertTrue(autopilot.RecordAllowed("/c", now));
+}
+
+- (void)testMaxMutedPathsAndReset {
+  FAAMuteAutopilot autopilot(1, 10 * NSEC_PER_SEC, 100, 2);
+  uint64_t now = 1000;
+
+  XCTAssertTrue(autopilot.RecordAllowed("/a", now));
+  XCTAssertTrue(autopilot.ReserveMute("/a"));
+  XCTAssertFalse(autopilot.ReserveMute("/a"));
+  XCTAssertTrue(autopilot.RecordAllowed("/b", now));
+  XCTAssertTrue(autopilot.ReserveMute("/b"));
+  XCTAssertEqual(autopilot.MutedCount(), 2);
+
+  // No more candidates once the limit is reached
+  XCTAssertFalse(autopilot.RecordAllowed("/c", now));
+  XCTAssertFalse(autopilot.ReserveMute("/c"));
+
+  autopilot.Reset();
+  XCTAssertEqual(autopilot.MutedCount(), 0);
+  XCTAssertTrue(autopilot.RecordAllowed("/c", now));
+  XCTAssertTrue(autopilot.ReserveMute("/c"));
+}
+
+- (void)testResetObservationsKeepsMutedPaths {
+  FAAMuteAutopilot autopilot(2, 10 * NSEC_PER_SEC, 100, 2);
+  uint64_t now = 1000;
+
+  XCTAssertTrue(autopilot.ReserveMute("/a"));
+  XCTAssertTrue(autopilot.ReserveMute("/b"));
+  XCTAssertFalse(autopilot.RecordAllowed("/c", now));
+
+  std::vector<std::string> muted = autopilot.ResetObservations();
+  std::sort(muted.begin(), muted.end());
+  XCTAssertTrue(muted == (std::vector<std::string>{"/a", "/b"}));
+
+  // Observations were forgotten, but the limit still applies
+  XCTAssertFalse(autopilot.RecordAllowed("/c", now));
+  XCTAssertFalse(autopilot.ReserveMute("/c"));
+
+  // Unmuted paths free up room
+  autopilot.ForgetMuted({"/a"});
+  XCTAssertEqual(autopilot.MutedCount(), 1);
+  XCTAssertTrue(autopilot.ReserveMute("/c"));
+}
+
+@end
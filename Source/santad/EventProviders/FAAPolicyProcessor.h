@@ -22,6 +22,7 @@
 #include <memory>
 #include <optional>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #import "Source/common/SNTCachedDecision.h"
@@ -29,6 +30,7 @@
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTStoredFileAccessEvent.h"
 #include "Source/common/SantaCache.h"
+#include "Source/common/SantaInlineSetCache.h"
 #include "Source/common/SantaSetCache.h"
 #include "Source/common/SantaVnode.h"
 #include "Source/common/es/Enricher.h"
@@ -76,7 +78,27 @@ class FAAPolicyProcessor {
   using GenerateEventDetailLinkBlock =
       URLTextPair (^)(const std::shared_ptr<WatchItemPolicyBase>& watch_item);
 
-  using ReadsCacheKey = std::tuple<pid_t, int, FAAClientType>;
+  /// Identifies a process instance for a given FAA client. Trivially copyable
+  /// so the reads cache can be checked without taking locks.
+  struct ReadsCacheKey {
+    pid_t pid;
+    int pidversion;
+    FAAClientType client_type;
+
+    bool operator==(const ReadsCacheKey& rhs) const = default;
+
+    template <typename H>
+    friend H AbslHashValue(H h, const ReadsCacheKey& key) {
+      return H::combine(std::move(h), key.pid, key.pidversion, key.client_type);
+    }
+  };
+  /// A target file, identified by device, inode and a hash of the path it was
+  /// accessed through, the policy that applied to it, and whether the policy
+  /// matched the accessing process. Holding the policy keeps it from being
+  /// freed, so entries for policies replaced by a config reload can never
+  /// match a newer policy.
+  using PolicyMatchCacheEntry =
+      std::tuple<dev_t, ino_t, size_t, std::shared_ptr<WatchItemPolicyBase>, bool>;
   using StoreAccessEventBlock = void (^)(SNTStoredFileAccessEvent*, bool);
 
   // Friend classes that can call private methods requiring FAAClientType parameters
@@ -110,7 +132,8 @@ class FAAPolicyProcessor {
   std::shared_ptr<Metrics> metrics_;
   GenerateEventDetailLinkBlock generate_event_detail_link_block_;
   StoreAccessEventBlock store_access_event_block_;
-  santa::SantaSetCache<ReadsCacheKey, std::pair<dev_t, ino_t>> reads_cache_;
+  santa::SantaInlineSetCache<ReadsCacheKey, SantaVnode> reads_cache_;
+  santa::SantaSetCache<ReadsCacheKey, PolicyMatchCacheEntry> policy_match_cache_;
   santa::SantaSetCache<std::pair<pid_t, int>, std::pair<std::string, std::string>>
       tty_message_cache_;
   SantaCache<SantaVnode, NSString*> cert_hash_cache_;
@@ -130,6 +153,7 @@ class FAAPolicyProcessor {
   ///             1. For the current event type, ensure the policy allows reads and the current
   ///                target being evaluated is readable
   ///         4. Check if the policy applies to the current ES message (CheckIfPolicyMatchesBlock())
+  ///            The result is remembered per process and target (policy_match_cache_)
   ///         5. Invert results and/or set audit-only based on configured options
   ///     2. Apply override if configured
   ///     3. Log telemetry if denied/audit-only and not rate-limited (LogTelemetry())
@@ -146,6 +170,11 @@ class FAAPolicyProcessor {
   std::optional<FAAPolicyProcessor::ESResult> ImmediateResponse(const Message& msg,
                                                                 FAAClientType client_type);
 
+  /// Returns the remembered result of checking the policy in the entry against
+  /// the process, if any.
+  std::optional<bool> LookupPolicyMatch(const ReadsCacheKey& key,
+                                        PolicyMatchCacheEntry entry) const;
+
   /// Used by callers to inform when a process has exited and will no longer process events.
   void NotifyExit(const audit_token_t& tok, FAAClientType client_type);
 
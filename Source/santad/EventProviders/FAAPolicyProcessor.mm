@@ -16,30 +16,36 @@
 
 #include <bsm/libbsm.h>
 
+#include <tuple>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #include "Source/common/AccountLookup.h"
 #include "Source/common/AuditUtilities.h"
 #include "Source/common/BranchPrediction.h"
+#include "Source/common/CodeSigningIdentifierUtils.h"
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/MOLCodesignChecker.h"
 #import "Source/common/SNTBlockMessage.h"
 #import "Source/common/SNTFileInfo.h"
 #import "Source/common/SNTLogging.h"
+#import "Source/common/SNTSigningInfoCache.h"
 #import "Source/common/SNTStoredFileAccessEvent.h"
 #include "Source/common/String.h"
 #include "Source/common/es/EnrichedTypes.h"
+#include "absl/hash/hash.h"
 
 // Terminal value that will never match a valid cert hash.
 NSString* const kBadCertHash = @"BAD_CERT_HASH";
 
 namespace santa {
 
-// Semi-arbitrary values for the reads_cache_ and tty_message SantaSetCache
-// objects. The number of processes should be large enough to have room for
-// simultaneously running processes that might match FAA rules. The
-// per-process capacity should be large enough to help speed up consecutive
-// reads or deduplicate TTY messages.
+// Semi-arbitrary values for the reads_cache_, policy_match_cache_ and
+// tty_message set caches. The number of processes should be large
+// enough to have room for simultaneously running processes that might match
+// FAA rules. The per-process capacity should be large enough to help speed up
+// consecutive reads, repeated policy checks, or deduplicate TTY messages.
 static constexpr size_t kNumProcesses = 2048;
 static constexpr size_t kPerProcessSetCapacity = 128;
 
@@ -137,6 +143,7 @@ FAAPolicyProcessor::FAAPolicyProcessor(
       generate_event_detail_link_block_(generate_event_detail_link_block),
       store_access_event_block_(store_access_event_block),
       reads_cache_(kNumProcesses, kPerProcessSetCapacity),
+      policy_match_cache_(kNumProcesses, kPerProcessSetCapacity),
       tty_message_cache_(kNumProcesses, kPerProcessSetCapacity),
       rate_limiter_(
           RateLimiter::Create(metrics_, rate_limit_logs_per_sec, rate_limit_window_size_sec)) {
@@ -201,8 +208,12 @@ NSString* FAAPolicyProcessor::GetCertificateHash(const es_file_t* es_file) {
   //    (async path), or SNTFileInfo init failed (bad path / non-regular file).
   //    The "rehydrate produced no cert info" case is handled above to avoid a
   //    redundant codesign trip.
-  MOLCodesignChecker* csInfo =
-      [[MOLCodesignChecker alloc] initWithBinaryPath:@(es_file->path.data)];
+  NSError* csError;
+  MOLCodesignChecker* csInfo = [[MOLCodesignChecker alloc] initWithBinaryPath:@(es_file->path.data)
+                                                                         error:&csError];
+  if (csInfo && !csError) {
+    [[SNTSigningInfoCache sharedCache] addCodesignChecker:csInfo];
+  }
   NSString* result = csInfo.leafCertificate.SHA256;
   if (!result.length) {
     result = kBadCertHash;
@@ -277,7 +288,17 @@ bool FAAPolicyProcessor::PolicyMatchesProcess(const WatchItemProcess& policy_pro
 
     // Check if the instigating process has an allowed certificate hash
     if (!policy_proc.certificate_sha256.empty()) {
-      NSString* result = GetCertificateHash(es_proc->executable);
+      // A kernel-enforced cdhash pins the signed content, so signing info
+      // cached from an earlier validation of that content can be trusted.
+      NSString* result;
+      if (CdhashStrictlyEnforced(es_proc->codesigning_flags)) {
+        NSString* cdhash = StringToNSString(BufToHexString(es_proc->cdhash, CS_CDHASH_LEN));
+        result = [[SNTSigningInfoCache sharedCache] signingInfoForCDHash:cdhash]
+                     .leafCertificate.SHA256;
+      }
+      if (!result) {
+        result = GetCertificateHash(es_proc->executable);
+      }
       if (!result || policy_proc.certificate_sha256 != [result UTF8String]) {
         return false;
       }
@@ -400,7 +421,9 @@ FileAccessPolicyDecision FAAPolicyProcessor::ApplyPolicy(
 
 void FAAPolicyProcessor::LogTelemetry(const WatchItemPolicyBase& policy, const Message& msg,
                                       size_t target_index, FileAccessPolicyDecision decision) {
-  RateLimiter::Decision rate_limit_decision = rate_limiter_.Decide(msg->mach_time);
+  // Policies are limited independently so a single noisy policy can't starve
+  // telemetry from the rest.
+  RateLimiter::Decision rate_limit_decision = rate_limiter_.Decide(msg->mach_time, policy.name);
   if (likely(metrics_)) {
     metrics_->SetFileAccessEventMetrics(policy.version, policy.name,
                                         (rate_limit_decision == RateLimiter::Decision::kAllowed)
@@ -583,9 +606,37 @@ FAAPolicyProcessor::ESResult FAAPolicyProcessor::ProcessMessage(
 
   for (const TargetPolicyPair& target_policy_pair : target_policy_pairs) {
     const Message::PathTarget& path_target = msg.PathTargetAtIndex(target_policy_pair.first);
-    FileAccessPolicyDecision decision =
-        ProcessTargetAndPolicy(msg, target_policy_pair, check_if_policy_matches_block,
-                               file_access_denied_block, overrideAction);
+
+    // Remember whether the policy matched the process for this target so that
+    // repeated accesses of any type skip re-checking the policy's processes,
+    // which can involve signing checks. Everything else about the decision is
+    // still computed each time so that telemetry and notifications are
+    // unchanged. Only targets referring to the accessed file itself (as opposed
+    // to its parent directory) can be identified by their vnode.
+    CheckIfPolicyMatchesBlock check_block = check_if_policy_matches_block;
+    if (target_policy_pair.second.has_value() && !path_target.truncated &&
+        path_target.unsafe_file && std::holds_alternative<std::string_view>(path_target.path)) {
+      ReadsCacheKey process_key = MakeReadsCacheKey(msg->process->audit_token, client_type);
+      PolicyMatchCacheEntry entry = {
+          path_target.unsafe_file->stat.st_dev, path_target.unsafe_file->stat.st_ino,
+          absl::HashOf(path_target.Path()), *target_policy_pair.second, false};
+
+      check_block = ^bool(const WatchItemPolicyBase& policy, const Message::PathTarget& target,
+                          const Message& target_msg) {
+        if (std::optional<bool> cached_match = LookupPolicyMatch(process_key, entry)) {
+          return *cached_match;
+        }
+
+        bool matched = check_if_policy_matches_block(policy, target, target_msg);
+        PolicyMatchCacheEntry new_entry = entry;
+        std::get<bool>(new_entry) = matched;
+        policy_match_cache_.Set(process_key, std::move(new_entry));
+        return matched;
+      };
+    }
+
+    FileAccessPolicyDecision decision = ProcessTargetAndPolicy(
+        msg, target_policy_pair, check_block, file_access_denied_block, overrideAction);
     // Populate the reads_cache_ if:
     //   1. The policy applied
     //   2. The process wasn't invalid
@@ -598,8 +649,7 @@ FAAPolicyProcessor::ESResult FAAPolicyProcessor::ProcessMessage(
         path_target.is_readable && path_target.unsafe_file &&
         target_policy_pair.second.has_value() && (*target_policy_pair.second)->allow_read_access) {
       reads_cache_.Set(MakeReadsCacheKey(msg->process->audit_token, client_type),
-                       std::pair<dev_t, ino_t>({path_target.unsafe_file->stat.st_dev,
-                                                path_target.unsafe_file->stat.st_ino}));
+                       SantaVnode::VnodeForFile(path_target.unsafe_file->stat));
     }
 
     policy_result =
@@ -617,6 +667,21 @@ FAAPolicyProcessor::ESResult FAAPolicyProcessor::ProcessMessage(
   return {policy_result, cacheable};
 }
 
+std::optional<bool> FAAPolicyProcessor::LookupPolicyMatch(const ReadsCacheKey& key,
+                                                          PolicyMatchCacheEntry entry) const {
+  std::get<bool>(entry) = true;
+  if (policy_match_cache_.Contains(key, entry)) {
+    return true;
+  }
+
+  std::get<bool>(entry) = false;
+  if (policy_match_cache_.Contains(key, entry)) {
+    return false;
+  }
+
+  return std::nullopt;
+}
+
 std::optional<FAAPolicyProcessor::ESResult> FAAPolicyProcessor::ImmediateResponse(
     const Message& msg, FAAClientType client_type) {
   // Note: Some other events have readable targets, but only events where all
@@ -631,8 +696,7 @@ std::optional<FAAPolicyProcessor::ESResult> FAAPolicyProcessor::ImmediateRespons
       !(msg->event.open.fflag & kOpenFlagsIndicatingWrite) &&
       !msg->event.open.file->path_truncated &&
       reads_cache_.Contains(MakeReadsCacheKey(msg->process->audit_token, client_type),
-                            std::pair<dev_t, ino_t>{msg->event.open.file->stat.st_dev,
-                                                    msg->event.open.file->stat.st_ino})) {
+                            SantaVnode::VnodeForFile(msg->event.open.file))) {
     return std::make_optional<FAAPolicyProcessor::ESResult>({ES_AUTH_RESULT_ALLOW, false});
   }
   return std::nullopt;
@@ -640,6 +704,7 @@ std::optional<FAAPolicyProcessor::ESResult> FAAPolicyProcessor::ImmediateRespons
 
 void FAAPolicyProcessor::NotifyExit(const audit_token_t& tok, FAAClientType client_type) {
   reads_cache_.Remove(MakeReadsCacheKey(tok, client_type));
+  policy_match_cache_.Remove(MakeReadsCacheKey(tok, client_type));
   tty_message_cache_.Remove(PidPidversion(tok));
 }
 
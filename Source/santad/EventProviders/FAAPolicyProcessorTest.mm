@@ -34,6 +34,7 @@
 #include "Source/santad/EventProviders/MockFAAPolicyProcessor.h"
 #import "Source/santad/SNTDecisionCache.h"
 
+using santa::FAAClientType;
 using santa::FAAPolicyProcessor;
 using santa::Message;
 using santa::MockFAAPolicyProcessor;
@@ -548,6 +549,84 @@ static void ClearWatchItemPolicyProcess(WatchItemProcess& proc) {
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
+- (void)testProcessMessageMemoizesPolicyMatches {
+  es_file_t esFile = MakeESFile("/proc/instigator");
+  es_process_t esProc = MakeESProcess(&esFile, MakeAuditToken(12, 34));
+  esProc.codesigning_flags = CS_SIGNED | CS_VALID;
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_OPEN, &esProc);
+  es_file_t targetFile = MakeESFile("/foo/bar", MakeStat(100));
+  esMsg.event.open.file = &targetFile;
+  esMsg.event.open.fflag = FREAD;
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  MockFAAPolicyProcessor faaPolicyProcessor(self.dcMock, nullptr, nullptr, nullptr, nullptr, 0, 0,
+                                            nil, nil);
+
+  EXPECT_CALL(faaPolicyProcessor, PolicyAllowsReadsForTarget)
+      .WillRepeatedly(testing::Return(false));
+  EXPECT_CALL(faaPolicyProcessor, ApplyPolicy)
+      .WillRepeatedly(
+          [&faaPolicyProcessor](
+              const Message& msg, const Message::PathTarget& target,
+              const std::optional<std::shared_ptr<WatchItemPolicyBase>> optional_policy,
+              FAAPolicyProcessor::CheckIfPolicyMatchesBlock block) {
+            return faaPolicyProcessor.ApplyPolicyWrapper(msg, target, optional_policy, block);
+          });
+
+  __block int matcherCount = 0;
+  auto matcher =
+      ^bool(const santa::WatchItemPolicyBase&, const Message::PathTarget&, const Message&) {
+        matcherCount++;
+        return true;
+      };
+  SNTFileAccessDeniedBlock deniedBlock =
+      ^(SNTStoredFileAccessEvent*, NSString*, NSString*, NSString*) {
+      };
+
+  auto policy = std::make_shared<WatchItemPolicyBase>("foo_policy", "ver");
+
+  auto processMessage = [&](std::shared_ptr<WatchItemPolicyBase> targetPolicy) {
+    Message msg(mockESApi, &esMsg);
+    std::vector<Message::PathTarget> targets = msg.PathTargets();
+    XCTAssertEqual(targets.size(), 1);
+    return faaPolicyProcessor.ProcessMessageWrapper(msg, {{0, targetPolicy}}, matcher, deniedBlock,
+                                                    SNTOverrideFileAccessActionNone,
+                                                    FAAClientType::kData);
+  };
+
+  // The first access evaluates the policy, subsequent accesses of any type
+  // reuse the result.
+  XCTAssertEqual(processMessage(policy).auth_result, ES_AUTH_RESULT_ALLOW);
+  XCTAssertEqual(matcherCount, 1);
+
+  esMsg.event.open.fflag = FWRITE;
+  XCTAssertEqual(processMessage(policy).auth_result, ES_AUTH_RESULT_ALLOW);
+  XCTAssertEqual(matcherCount, 1);
+
+  // A different file is evaluated separately
+  es_file_t otherFile = MakeESFile("/foo/baz", MakeStat(200));
+  esMsg.event.open.file = &otherFile;
+  processMessage(policy);
+  XCTAssertEqual(matcherCount, 2);
+  esMsg.event.open.file = &targetFile;
+
+  // A new policy object, e.g. after a config reload, is evaluated again
+  auto newPolicy = std::make_shared<WatchItemPolicyBase>("foo_policy", "ver2");
+  processMessage(newPolicy);
+  XCTAssertEqual(matcherCount, 3);
+  processMessage(newPolicy);
+  XCTAssertEqual(matcherCount, 3);
+
+  // Remembered results are dropped when the process exits
+  faaPolicyProcessor.NotifyExitWrapper(esProc.audit_token, FAAClientType::kData);
+  processMessage(newPolicy);
+  XCTAssertEqual(matcherCount, 4);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
 - (void)testGetCertificateHash {
   // Note: MakeStat() produces a non-regular-file mode, so SNTFileInfo init
   // fails for these fixtures and step 3 (sync/async rehydrate) is bypassed.
@@ -18,9 +18,16 @@
 
 #import <Foundation/Foundation.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <string_view>
 
 #include "Source/santad/Metrics.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 
 // Forward declarations
 namespace santa {
@@ -29,47 +36,82 @@ class RateLimiterPeer;
 
 namespace santa {
 
-// Very basic rate limiting infrastructure.
-// Currently only handles X events per duration.
+// Token bucket rate limiting of X events per second, with bursts of up to
+// X * window size events.
 //
-// TODO(mlw): Support changing QPS via config
-// TODO(mlw): Support per-rule QPS
-// TODO(mlw): Consider adding sliding window support
+// Buckets are implemented with the generic cell rate algorithm: each bucket is
+// a single atomic "theoretical arrival time", and deciding is a compare and
+// swap on it, so concurrent decisions never serialize on a lock.
+//
+// Events can be limited by key, e.g. per policy, so that one noisy key can't
+// exhaust the budget of the others. Each key gets its own bucket, up to
+// max_keys buckets. Buckets that have fully refilled are discarded when room
+// is needed, and keys that still don't fit share the unkeyed bucket.
+//
+// The number of events rate limited is reported to metrics per key whenever a
+// bucket allows an event again, or when the bucket is discarded.
 class RateLimiter {
  public:
+  // Metrics key for the bucket shared by unkeyed events.
+  static constexpr std::string_view kSharedKey = "";
+  static constexpr size_t kDefaultMaxKeys = 256;
+
   // Factory
   static RateLimiter Create(std::shared_ptr<santa::Metrics> metrics,
                             uint32_t logs_per_sec, uint32_t window_size_sec);
 
   // Semi-arbitrary max window size limit of 1 hour
   RateLimiter(std::shared_ptr<santa::Metrics> metrics, uint32_t logs_per_sec,
-              uint32_t window_size_sec, uint32_t max_window_size = 3600);
+              uint32_t window_size_sec, uint32_t max_window_size = 3600,
+              size_t max_keys = kDefaultMaxKeys);
 
   enum class Decision {
     kRateLimited = 0,
     kAllowed,
   };
 
+  // Decide using the bucket shared by all unkeyed events.
   Decision Decide(uint64_t cur_mach_time);
 
+  // Decide using the bucket for the given key.
+  Decision Decide(uint64_t cur_mach_time, std::string_view key);
+
+  // Changes apply to all buckets, which start again full.
   void ModifySettings(uint32_t logs_per_sec, uint32_t window_size_sec);
 
   friend class santa::RateLimiterPeer;
 
  private:
-  void ModifySettingsSerialized(uint32_t logs_per_sec,
-                                uint32_t window_size_sec);
-  bool ShouldRateLimitSerialized();
-  size_t EventsRateLimitedSerialized();
-  void TryResetSerialized(uint64_t cur_mach_time);
+  struct Bucket {
+    explicit Bucket(std::string_view k) : key(k) {}
+
+    const std::string key;
+    // The time at which the bucket will be full again. Events are allowed
+    // while it is no more than the burst tolerance in the future.
+    std::atomic<uint64_t> tat_ns = 0;
+    // Events rate limited since the count was last reported.
+    std::atomic<int64_t> rate_limited = 0;
+  };
+
+  Decision Decide(Bucket& bucket, uint64_t now_ns);
+  std::shared_ptr<Bucket> BucketForKey(std::string_view key, uint64_t now_ns);
+  void ReportRateLimited(Bucket& bucket);
 
   std::shared_ptr<santa::Metrics> metrics_;
   const uint32_t max_window_size_;
-  size_t log_count_total_ = 0;
-  size_t max_log_count_total_;
-  uint64_t reset_mach_time_;
-  uint64_t reset_duration_ns_;
-  dispatch_queue_t q_;
+  const size_t max_keys_;
+
+  // Time it takes to earn one event. 0 when rate limiting is disabled.
+  std::atomic<uint64_t> emission_interval_ns_ = 0;
+  // How far ahead of now a bucket may be before events are rate limited,
+  // which is what allows bursts.
+  std::atomic<uint64_t> burst_tolerance_ns_ = 0;
+
+  Bucket shared_bucket_{kSharedKey};
+
+  absl::Mutex buckets_mtx_;
+  absl::flat_hash_map<std::string, std::shared_ptr<Bucket>> buckets_
+      ABSL_GUARDED_BY(buckets_mtx_);
 };
 
 }  // namespace santa
@@ -15,7 +15,7 @@
 
 #include "Source/santad/EventProviders/RateLimiter.h"
 
-#include <limits>
+#include <algorithm>
 
 #include "Source/common/BranchPrediction.h"
 #include "Source/common/SNTLogging.h"
@@ -29,16 +29,12 @@ RateLimiter RateLimiter::Create(std::shared_ptr<santa::Metrics> metrics, uint32_
 }
 
 RateLimiter::RateLimiter(std::shared_ptr<santa::Metrics> metrics, uint32_t logs_per_sec,
-                         uint32_t window_size_sec, uint32_t max_window_size)
-    : metrics_(std::move(metrics)), max_window_size_(max_window_size) {
-  q_ = dispatch_queue_create(
-      "com.northpolesec.santa.daemon.rate_limiter",
-      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL,
-                                              QOS_CLASS_USER_INTERACTIVE, 0));
-  ModifySettingsSerialized(logs_per_sec, window_size_sec);
+                         uint32_t window_size_sec, uint32_t max_window_size, size_t max_keys)
+    : metrics_(std::move(metrics)), max_window_size_(max_window_size), max_keys_(max_keys) {
+  ModifySettings(logs_per_sec, window_size_sec);
 }
 
-void RateLimiter::ModifySettingsSerialized(uint32_t logs_per_sec, uint32_t window_size_sec) {
+void RateLimiter::ModifySettings(uint32_t logs_per_sec, uint32_t window_size_sec) {
   if (window_size_sec > max_window_size_) {
     window_size_sec = max_window_size_;
     LOGW(@"Window size must be between 0 and %u. Clamped to: %u", max_window_size_,
@@ -47,61 +43,99 @@ void RateLimiter::ModifySettingsSerialized(uint32_t logs_per_sec, uint32_t windo
 
   if (logs_per_sec == 0 || window_size_sec == 0) {
     // If either setting is 0, rate limiting is disabled.
-    // Max out these values to ensure never to return RateLimiter::Decision::kRateLimited;
-    max_log_count_total_ = std::numeric_limits<decltype(max_log_count_total_)>::max();
-    reset_mach_time_ = std::numeric_limits<decltype(reset_mach_time_)>::max();
+    emission_interval_ns_.store(0, std::memory_order_relaxed);
+    burst_tolerance_ns_.store(0, std::memory_order_relaxed);
   } else {
-    max_log_count_total_ = logs_per_sec * window_size_sec;
-    reset_duration_ns_ = window_size_sec * NSEC_PER_SEC;
-    reset_mach_time_ = 0;
+    // A full bucket holds a window's worth of events. The first is allowed
+    // immediately, the rest within the tolerance.
+    uint64_t interval_ns = std::max<uint64_t>(NSEC_PER_SEC / logs_per_sec, 1);
+    uint64_t capacity = (uint64_t)logs_per_sec * window_size_sec;
+    burst_tolerance_ns_.store((capacity - 1) * interval_ns, std::memory_order_relaxed);
+    emission_interval_ns_.store(interval_ns, std::memory_order_relaxed);
   }
-}
 
-void RateLimiter::ModifySettings(uint32_t logs_per_sec, uint32_t window_size_sec) {
-  dispatch_sync(q_, ^{
-    ModifySettingsSerialized(logs_per_sec, window_size_sec);
-  });
+  shared_bucket_.tat_ns.store(0, std::memory_order_relaxed);
+  absl::MutexLock lock(buckets_mtx_);
+  for (auto& [key, bucket] : buckets_) {
+    bucket->tat_ns.store(0, std::memory_order_relaxed);
+  }
 }
 
-bool RateLimiter::ShouldRateLimitSerialized() {
-  return log_count_total_ > max_log_count_total_;
+void RateLimiter::ReportRateLimited(Bucket& bucket) {
+  if (unlikely(bucket.rate_limited.load(std::memory_order_relaxed) > 0)) {
+    int64_t count = bucket.rate_limited.exchange(0, std::memory_order_relaxed);
+    if (metrics_ && count > 0) {
+      metrics_->AddRateLimitingMetrics(bucket.key, count);
+    }
+  }
 }
 
-size_t RateLimiter::EventsRateLimitedSerialized() {
-  if (unlikely(ShouldRateLimitSerialized())) {
-    return log_count_total_ - max_log_count_total_;
-  } else {
-    return 0;
+RateLimiter::Decision RateLimiter::Decide(Bucket& bucket, uint64_t now_ns) {
+  uint64_t interval_ns = emission_interval_ns_.load(std::memory_order_relaxed);
+  if (interval_ns == 0) {
+    return Decision::kAllowed;
   }
+  uint64_t tolerance_ns = burst_tolerance_ns_.load(std::memory_order_relaxed);
+
+  uint64_t tat_ns = bucket.tat_ns.load(std::memory_order_relaxed);
+  while (true) {
+    uint64_t start_ns = std::max(tat_ns, now_ns);
+    if (unlikely(start_ns - now_ns > tolerance_ns)) {
+      bucket.rate_limited.fetch_add(1, std::memory_order_relaxed);
+      return Decision::kRateLimited;
+    }
+    if (bucket.tat_ns.compare_exchange_weak(tat_ns, start_ns + interval_ns,
+                                            std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  ReportRateLimited(bucket);
+  return Decision::kAllowed;
 }
 
-void RateLimiter::TryResetSerialized(uint64_t cur_mach_time) {
-  if (cur_mach_time > reset_mach_time_) {
-    if (metrics_) {
-      metrics_->AddRateLimitingMetrics(EventsRateLimitedSerialized());
+std::shared_ptr<RateLimiter::Bucket> RateLimiter::BucketForKey(std::string_view key,
+                                                                uint64_t now_ns) {
+  {
+    absl::ReaderMutexLock lock(buckets_mtx_);
+    if (auto it = buckets_.find(key); it != buckets_.end()) {
+      return it->second;
     }
-
-    log_count_total_ = 0;
-    reset_mach_time_ = AddNanosecondsToMachTime(reset_duration_ns_, cur_mach_time);
   }
-}
 
-RateLimiter::Decision RateLimiter::Decide(uint64_t cur_mach_time) {
-  __block RateLimiter::Decision decision;
+  absl::MutexLock lock(buckets_mtx_);
+  if (auto it = buckets_.find(key); it != buckets_.end()) {
+    return it->second;
+  }
 
-  dispatch_sync(q_, ^{
-    TryResetSerialized(cur_mach_time);
+  if (buckets_.size() >= max_keys_) {
+    // A bucket that has fully refilled behaves the same as a new one, so it
+    // can be dropped once its rate limited events have been reported.
+    absl::erase_if(buckets_, [this, now_ns](const auto& kv) {
+      if (kv.second->tat_ns.load(std::memory_order_relaxed) > now_ns) {
+        return false;
+      }
+      ReportRateLimited(*kv.second);
+      return true;
+    });
+    if (buckets_.size() >= max_keys_) {
+      return nullptr;
+    }
+  }
 
-    ++log_count_total_;
+  auto bucket = std::make_shared<Bucket>(key);
+  buckets_.emplace(bucket->key, bucket);
+  return bucket;
+}
 
-    if (unlikely(ShouldRateLimitSerialized())) {
-      decision = Decision::kRateLimited;
-    } else {
-      decision = RateLimiter::Decision::kAllowed;
-    }
-  });
+RateLimiter::Decision RateLimiter::Decide(uint64_t cur_mach_time) {
+  return Decide(shared_bucket_, MachTimeToNanos(cur_mach_time));
+}
 
-  return decision;
+RateLimiter::Decision RateLimiter::Decide(uint64_t cur_mach_time, std::string_view key) {
+  uint64_t now_ns = MachTimeToNanos(cur_mach_time);
+  std::shared_ptr<Bucket> bucket = BucketForKey(key, now_ns);
+  return Decide(bucket ? *bucket : shared_bucket_, now_ns);
 }
 
 }  // namespace santa
@@ -29,173 +29,170 @@ class RateLimiterPeer : public RateLimiter {
  public:
   using RateLimiter::RateLimiter;
 
-  using RateLimiter::EventsRateLimitedSerialized;
-  using RateLimiter::ShouldRateLimitSerialized;
-  using RateLimiter::TryResetSerialized;
-
-  using RateLimiter::log_count_total_;
-  using RateLimiter::max_log_count_total_;
-  using RateLimiter::reset_duration_ns_;
-  using RateLimiter::reset_mach_time_;
+  using RateLimiter::buckets_;
+  using RateLimiter::burst_tolerance_ns_;
+  using RateLimiter::emission_interval_ns_;
+  using RateLimiter::shared_bucket_;
+
+  size_t NumBuckets() {
+    absl::ReaderMutexLock lock(buckets_mtx_);
+    return buckets_.size();
+  }
+
+  int64_t RateLimited(std::string_view key) {
+    if (key == kSharedKey) {
+      return shared_bucket_.rate_limited.load();
+    }
+    absl::ReaderMutexLock lock(buckets_mtx_);
+    auto it = buckets_.find(key);
+    return it == buckets_.end() ? -1 : it->second->rate_limited.load();
+  }
 };
 
 }  // namespace santa
 
 using santa::RateLimiterPeer;
 
+static uint64_t SecondsToMachTime(double secs) {
+  return NanosToMachTime(secs * NSEC_PER_SEC);
+}
+
 @interface RateLimiterTest : XCTestCase
 @end
 
 @implementation RateLimiterTest
 
-- (void)testTryResetSerialized {
-  // Create an object supporting 1 QPS, and a reset duration of 2s
-  uint16_t maxQps = 1;
-  NSTimeInterval resetDuration = 2;
-  RateLimiterPeer rlp(nullptr, maxQps, resetDuration);
-
-  // Check the current reset_mach_time_ is 0 so that it gets
-  // set when the first decision is made
-  XCTAssertEqual(rlp.reset_mach_time_, 0);
-
-  // Define our current mach time and create the expected new reset duration floor
-  uint64_t curMachTime = 1;
-  uint64_t expectedMachTime = AddNanosecondsToMachTime(resetDuration, curMachTime);
-
-  // Set a higher log count to ensure it is reset
-  rlp.log_count_total_ = 123;
-
-  rlp.TryResetSerialized(curMachTime);
-
-  // Ensure values are reset appropriately
-  XCTAssertEqual(rlp.log_count_total_, 0);
-  XCTAssertGreaterThanOrEqual(rlp.reset_mach_time_, expectedMachTime);
+- (void)testBurst {
+  // Create an object supporting 2 QPS, and a window size of 4s
+  uint16_t maxQps = 2;
+  uint32_t windowSize = 4;
+  uint64_t allowedLogsPerWindow = maxQps * windowSize;
+  RateLimiterPeer rlp(nullptr, maxQps, windowSize);
 
-  // Setup values so that calling TryResetSerialized shouldn't reset anything
-  size_t expectedLogCount = 123;
-  expectedMachTime = 456;
-  rlp.log_count_total_ = expectedLogCount;
-  rlp.reset_mach_time_ = expectedMachTime;
-  curMachTime = rlp.reset_mach_time_;
+  uint64_t now = SecondsToMachTime(100);
 
-  rlp.TryResetSerialized(curMachTime);
+  // A full bucket allows a window's worth of events at once
+  for (uint64_t i = 0; i < allowedLogsPerWindow; i++) {
+    XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kAllowed);
+  }
 
-  // Ensure the values were not changed
-  XCTAssertEqual(rlp.log_count_total_, expectedLogCount);
-  XCTAssertGreaterThanOrEqual(rlp.reset_mach_time_, expectedMachTime);
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kRateLimited);
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kRateLimited);
+  XCTAssertEqual(rlp.RateLimited(RateLimiter::kSharedKey), 2);
 }
 
-- (void)testDecide {
-  // Create an object supporting 2 QPS, and a reset duration of 4s
+- (void)testRefill {
   uint16_t maxQps = 2;
-  NSTimeInterval resetDuration = 4;
-  uint64_t allowedLogsPerDuration = maxQps * resetDuration;
-  RateLimiterPeer rlp(nullptr, maxQps, resetDuration);
+  uint32_t windowSize = 4;
+  uint64_t allowedLogsPerWindow = maxQps * windowSize;
+  RateLimiterPeer rlp(nullptr, maxQps, windowSize);
 
-  // Check the current log count is initially 0
-  XCTAssertEqual(rlp.log_count_total_, 0);
+  uint64_t now = SecondsToMachTime(100);
+  for (uint64_t i = 0; i < allowedLogsPerWindow; i++) {
+    XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kAllowed);
+  }
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kRateLimited);
 
-  // Make the first decision
-  RateLimiter::Decision gotDecision;
+  // Over half a second later, one more event has been earned
+  now = SecondsToMachTime(100.6);
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kRateLimited);
 
-  for (uint64_t i = 0; i < (allowedLogsPerDuration); i++) {
-    gotDecision = rlp.Decide(0);
-    XCTAssertEqual(gotDecision, RateLimiter::Decision::kAllowed);
-  }
+  // The allowed event reported, and reset, the previous rate limited count
+  XCTAssertEqual(rlp.RateLimited(RateLimiter::kSharedKey), 1);
 
-  // Ensure the log count is the expected amount
-  XCTAssertEqual(rlp.log_count_total_, allowedLogsPerDuration);
-
-  // Make another decision and ensure the log count still increases and
-  // the decision is rate limited
-  gotDecision = rlp.Decide(0);
-  XCTAssertEqual(gotDecision, RateLimiter::Decision::kRateLimited);
-  XCTAssertEqual(rlp.log_count_total_, allowedLogsPerDuration + 1);
-
-  // Make another decision, though now with the cur mach time greater than
-  // the reset mach time. Then ensure values were appropriately reset.
-  uint64_t oldResetMachTime = rlp.reset_mach_time_;
-  gotDecision = rlp.Decide(rlp.reset_mach_time_ + 1);
-  XCTAssertEqual(gotDecision, RateLimiter::Decision::kAllowed);
-  XCTAssertEqual(rlp.log_count_total_, 1);
-  XCTAssertGreaterThan(rlp.reset_mach_time_, oldResetMachTime);
+  // After a full window the bucket is full again
+  now = SecondsToMachTime(100.6 + windowSize);
+  for (uint64_t i = 0; i < allowedLogsPerWindow; i++) {
+    XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kAllowed);
+  }
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kRateLimited);
 }
 
-- (void)testShouldRateLimitAndCounts {
-  // Create an object supporting 2 QPS, and a reset duration of 4s
-  uint16_t maxQps = 2;
-  NSTimeInterval resetDuration = 4;
-  uint64_t allowedLogsPerDuration = maxQps * resetDuration;
-  uint64_t logsOverQPS = 5;
-  RateLimiterPeer rlp(nullptr, maxQps, resetDuration);
-
-  // Initially no rate limiting should apply
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
+- (void)testKeysAreIndependent {
+  RateLimiterPeer rlp(nullptr, 1, 2);
+  uint64_t now = SecondsToMachTime(100);
 
-  // Simulate a smmaller volume of logs received than QPS
-  rlp.log_count_total_ = allowedLogsPerDuration - 1;
+  XCTAssertEqual(rlp.Decide(now, "foo"), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.Decide(now, "foo"), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.Decide(now, "foo"), RateLimiter::Decision::kRateLimited);
 
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
+  // Other keys, and unkeyed events, still have their full budget
+  XCTAssertEqual(rlp.Decide(now, "bar"), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.Decide(now, "bar"), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kAllowed);
 
-  // Simulate a larger volume of logs received than QPS
-  rlp.log_count_total_ = allowedLogsPerDuration + logsOverQPS;
+  XCTAssertEqual(rlp.NumBuckets(), 2);
+  XCTAssertEqual(rlp.RateLimited("foo"), 1);
+  XCTAssertEqual(rlp.RateLimited("bar"), 0);
+  XCTAssertEqual(rlp.RateLimited(RateLimiter::kSharedKey), 0);
+}
 
-  XCTAssertTrue(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), logsOverQPS);
+- (void)testMaxKeys {
+  RateLimiterPeer rlp(nullptr, 1, 1, 3600, 2);
+  uint64_t now = SecondsToMachTime(100);
+
+  XCTAssertEqual(rlp.Decide(now, "foo"), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.Decide(now, "bar"), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.NumBuckets(), 2);
+
+  // No room for another bucket, so the key shares the unkeyed bucket
+  XCTAssertEqual(rlp.Decide(now, "baz"), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.Decide(now, "baz"), RateLimiter::Decision::kRateLimited);
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kRateLimited);
+  XCTAssertEqual(rlp.NumBuckets(), 2);
+  XCTAssertEqual(rlp.RateLimited(RateLimiter::kSharedKey), 2);
+
+  // Once the existing buckets have refilled they make room for new keys
+  now = SecondsToMachTime(102);
+  XCTAssertEqual(rlp.Decide(now, "baz"), RateLimiter::Decision::kAllowed);
+  XCTAssertEqual(rlp.NumBuckets(), 1);
+  XCTAssertEqual(rlp.Decide(now, "baz"), RateLimiter::Decision::kRateLimited);
+  XCTAssertEqual(rlp.RateLimited("baz"), 1);
 }
 
 - (void)testModifySettings {
   RateLimiterPeer rlp(nullptr, 3, 10);
+  uint64_t now = SecondsToMachTime(100);
 
-  // Simulate a smmaller volume of logs received than QPS
-  auto oldMax = rlp.max_log_count_total_;
-  rlp.log_count_total_ = rlp.max_log_count_total_ - 1;
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
-
-  // Modifying settings resets mach time
-  rlp.ModifySettings(5, 20);
-
-  // Ensure the new max is smaller than the old max
-  XCTAssertGreaterThan(rlp.max_log_count_total_, oldMax);
-  XCTAssertEqual(rlp.reset_duration_ns_, 20 * NSEC_PER_SEC);
+  XCTAssertEqual(rlp.emission_interval_ns_.load(), NSEC_PER_SEC / 3);
+  XCTAssertEqual(rlp.burst_tolerance_ns_.load(), 29 * (NSEC_PER_SEC / 3));
 
-  // Simulate larger than the old max, nothing should be rate limited
-  rlp.log_count_total_ = oldMax + 1;
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
+  // Drain the buckets
+  for (int i = 0; i < 30; i++) {
+    XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kAllowed);
+    XCTAssertEqual(rlp.Decide(now, "foo"), RateLimiter::Decision::kAllowed);
+  }
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kRateLimited);
+  XCTAssertEqual(rlp.Decide(now, "foo"), RateLimiter::Decision::kRateLimited);
 
-  // Go over the new max
-  rlp.log_count_total_ = rlp.max_log_count_total_ + 20;
-  XCTAssertTrue(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 20);
+  // Modifying settings refills all buckets
+  rlp.ModifySettings(5, 20);
+  XCTAssertEqual(rlp.emission_interval_ns_.load(), NSEC_PER_SEC / 5);
+  for (int i = 0; i < 100; i++) {
+    XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kAllowed);
+    XCTAssertEqual(rlp.Decide(now, "foo"), RateLimiter::Decision::kAllowed);
+  }
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kRateLimited);
+  XCTAssertEqual(rlp.Decide(now, "foo"), RateLimiter::Decision::kRateLimited);
 
   // Test disabling rate limiting by setting logs per sec
   rlp.ModifySettings(0, 123);
-  XCTAssertEqual(rlp.max_log_count_total_,
-                 std::numeric_limits<decltype(rlp.max_log_count_total_)>::max());
-  XCTAssertEqual(rlp.reset_mach_time_, std::numeric_limits<decltype(rlp.reset_mach_time_)>::max());
-
-  rlp.log_count_total_ = std::numeric_limits<decltype(rlp.log_count_total_)>::max();
-  XCTAssertFalse(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 0);
+  XCTAssertEqual(rlp.emission_interval_ns_.load(), 0);
+  for (int i = 0; i < 1000; i++) {
+    XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kAllowed);
+    XCTAssertEqual(rlp.Decide(now, "foo"), RateLimiter::Decision::kAllowed);
+  }
 
   // Modify back to something more sensible, but trigger window size clamping
   rlp.ModifySettings(123, 4000);
-  XCTAssertEqual(rlp.max_log_count_total_, 123 * 3600);
-  XCTAssertEqual(rlp.reset_duration_ns_, 3600 * NSEC_PER_SEC);
-
-  rlp.log_count_total_ = rlp.max_log_count_total_ + 50;
-  XCTAssertTrue(rlp.ShouldRateLimitSerialized());
-  XCTAssertEqual(rlp.EventsRateLimitedSerialized(), 50);
+  XCTAssertEqual(rlp.emission_interval_ns_.load(), NSEC_PER_SEC / 123);
+  XCTAssertEqual(rlp.burst_tolerance_ns_.load(), (123 * 3600 - 1) * (NSEC_PER_SEC / 123));
 
   // Test disabling by zeroing the window size
   rlp.ModifySettings(123, 0);
-  XCTAssertEqual(rlp.max_log_count_total_,
-                 std::numeric_limits<decltype(rlp.max_log_count_total_)>::max());
-  XCTAssertEqual(rlp.reset_mach_time_, std::numeric_limits<decltype(rlp.reset_mach_time_)>::max());
+  XCTAssertEqual(rlp.emission_interval_ns_.load(), 0);
+  XCTAssertEqual(rlp.Decide(now), RateLimiter::Decision::kAllowed);
 }
 
 @end
@@ -0,0 +1,80 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_EVENTPROVIDERS_RECORDEREVENTFILTER_H
+#define SANTA_SANTAD_EVENTPROVIDERS_RECORDEREVENTFILTER_H
+
+#include <EndpointSecurity/ESTypes.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <set>
+
+#include "Source/common/TelemetryEventMap.h"
+
+namespace santa {
+
+// A per-event-type table deciding how much of the Recorder's handling a
+// NOTIFY event needs. It is compiled from the telemetry mask and the file
+// change config when either changes, so that the hot path is a single atomic
+// load instead of a series of config lookups.
+//
+// The set of event types that aren't dropped is also what the Recorder should
+// be subscribed to, so the kernel stops sending events that would only be
+// thrown away.
+class RecorderEventFilter {
+ public:
+  enum class Action : uint8_t {
+    // Never logged and not needed by Santa itself
+    kDrop = 0,
+    // Not logged, but required for cache invalidation, prehashing, compiler
+    // tracking, login window session handling or the process tree
+    kInternalOnly,
+    // May be logged
+    kProcess,
+  };
+
+  // Until the first Compile, every event type is processed.
+  RecorderEventFilter();
+
+  RecorderEventFilter(const RecorderEventFilter&) = delete;
+  RecorderEventFilter& operator=(const RecorderEventFilter&) = delete;
+
+  // Recompute the table for the given event types. Types outside of `events`
+  // are dropped. File change events are only logged when a FileChangesRegex
+  // is configured. Returns the subset of `events` that aren't dropped.
+  std::set<es_event_type_t> Compile(const std::set<es_event_type_t>& events,
+                                    TelemetryEvent telemetry_mask, bool file_changes_regex_set);
+
+  inline Action ActionForEvent(es_event_type_t event) const {
+    if (event >= ES_EVENT_TYPE_LAST) {
+      return Action::kDrop;
+    }
+    return static_cast<Action>(actions_[event].load(std::memory_order_relaxed));
+  }
+
+  // Event types the Recorder acts on whether or not they are logged.
+  static bool IsInternalEvent(es_event_type_t event);
+
+  // Event types only logged when they match FileChangesRegex.
+  static bool IsFileChangeEvent(es_event_type_t event);
+
+ private:
+  std::array<std::atomic<uint8_t>, ES_EVENT_TYPE_LAST> actions_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_EVENTPROVIDERS_RECORDEREVENTFILTER_H
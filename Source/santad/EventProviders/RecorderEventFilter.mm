@@ -0,0 +1,85 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/EventProviders/RecorderEventFilter.h"
+
+#include <os/base.h>
+
+namespace santa {
+
+RecorderEventFilter::RecorderEventFilter() {
+  for (auto& action : actions_) {
+    action.store(static_cast<uint8_t>(Action::kProcess), std::memory_order_relaxed);
+  }
+}
+
+bool RecorderEventFilter::IsInternalEvent(es_event_type_t event) {
+  switch (event) {
+    // Auth result cache invalidation, prehashing and compiler tracking
+    case ES_EVENT_TYPE_NOTIFY_CLOSE: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_RENAME: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_CLONE: OS_FALLTHROUGH;
+    // Process tree and compiler tracking. These would be added back to the
+    // subscription by the tree aware client anyway.
+    case ES_EVENT_TYPE_NOTIFY_EXEC: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_FORK: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_EXIT: OS_FALLTHROUGH;
+    // Login window session handling
+    case ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOCK: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOGOUT: return true;
+    default: return false;
+  }
+}
+
+bool RecorderEventFilter::IsFileChangeEvent(es_event_type_t event) {
+  switch (event) {
+    case ES_EVENT_TYPE_NOTIFY_CLONE: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_CLOSE: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_COPYFILE: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_LINK: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_RENAME: OS_FALLTHROUGH;
+    case ES_EVENT_TYPE_NOTIFY_UNLINK: return true;
+    default: return false;
+  }
+}
+
+std::set<es_event_type_t> RecorderEventFilter::Compile(const std::set<es_event_type_t>& events,
+                                                       TelemetryEvent telemetry_mask,
+                                                       bool file_changes_regex_set) {
+  std::set<es_event_type_t> wanted;
+  for (size_t i = 0; i < actions_.size(); i++) {
+    es_event_type_t event = static_cast<es_event_type_t>(i);
+    Action action = Action::kDrop;
+
+    if (events.count(event) > 0) {
+      TelemetryEvent telemetry = ESEventToTelemetryEvent(event);
+      bool logged = (telemetry & telemetry_mask) == telemetry &&
+                    (file_changes_regex_set || !IsFileChangeEvent(event));
+      if (logged) {
+        action = Action::kProcess;
+      } else if (IsInternalEvent(event)) {
+        action = Action::kInternalOnly;
+      }
+    }
+
+    if (action != Action::kDrop) {
+      wanted.insert(event);
+    }
+    actions_[i].store(static_cast<uint8_t>(action), std::memory_order_relaxed);
+  }
+  return wanted;
+}
+
+}  // namespace santa
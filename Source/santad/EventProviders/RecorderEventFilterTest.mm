@@ -0,0 +1,85 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/EventProviders/RecorderEventFilter.h"
+
+#include <EndpointSecurity/ESTypes.h>
+#import <XCTest/XCTest.h>
+
+#include <set>
+
+#include "Source/common/TelemetryEventMap.h"
+
+using santa::RecorderEventFilter;
+using santa::TelemetryEvent;
+
+using Action = RecorderEventFilter::Action;
+
+@interface RecorderEventFilterTest : XCTestCase
+@end
+
+@implementation RecorderEventFilterTest
+
+- (void)testEverythingProcessedBeforeCompile {
+  RecorderEventFilter filter;
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_EXEC), Action::kProcess);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_UNLINK), Action::kProcess);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_LAST), Action::kDrop);
+}
+
+- (void)testCompile {
+  std::set<es_event_type_t> events{
+      ES_EVENT_TYPE_NOTIFY_CLOSE,          ES_EVENT_TYPE_NOTIFY_EXEC,
+      ES_EVENT_TYPE_NOTIFY_FORK,           ES_EVENT_TYPE_NOTIFY_EXIT,
+      ES_EVENT_TYPE_NOTIFY_UNLINK,         ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOCK,
+      ES_EVENT_TYPE_NOTIFY_CS_INVALIDATED, ES_EVENT_TYPE_NOTIFY_OPENSSH_LOGIN,
+  };
+
+  RecorderEventFilter filter;
+
+  // Everything logged
+  XCTAssertTrue(filter.Compile(events, TelemetryEvent::kEverything, true) == events);
+  for (es_event_type_t event : events) {
+    XCTAssertEqual(filter.ActionForEvent(event), Action::kProcess);
+  }
+  // Types that weren't given are dropped
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_LINK), Action::kDrop);
+
+  // Without a FileChangesRegex, file changes are never logged, but those
+  // needed internally are still delivered.
+  std::set<es_event_type_t> want = events;
+  want.erase(ES_EVENT_TYPE_NOTIFY_UNLINK);
+  XCTAssertTrue(filter.Compile(events, TelemetryEvent::kEverything, false) == want);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_CLOSE), Action::kInternalOnly);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_UNLINK), Action::kDrop);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_EXEC), Action::kProcess);
+
+  // Only executions logged
+  want = {
+      ES_EVENT_TYPE_NOTIFY_CLOSE, ES_EVENT_TYPE_NOTIFY_EXEC,
+      ES_EVENT_TYPE_NOTIFY_FORK,  ES_EVENT_TYPE_NOTIFY_EXIT,
+      ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOCK,
+  };
+  XCTAssertTrue(filter.Compile(events, TelemetryEvent::kExecution, true) == want);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_EXEC), Action::kProcess);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_FORK), Action::kInternalOnly);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_CLOSE), Action::kInternalOnly);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOCK),
+                 Action::kInternalOnly);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_UNLINK), Action::kDrop);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_CS_INVALIDATED), Action::kDrop);
+  XCTAssertEqual(filter.ActionForEvent(ES_EVENT_TYPE_NOTIFY_OPENSSH_LOGIN), Action::kDrop);
+}
+
+@end
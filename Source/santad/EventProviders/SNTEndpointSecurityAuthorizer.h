@@ -47,6 +47,28 @@
                   processTree:
                       (std::shared_ptr<santa::santad::process_tree::ProcessTree>)processTree;
 
+/// Several authorizers can run side by side to spread AUTH delivery over more
+/// than one ES client, so a slow exec only holds up those in its own shard.
+/// Once sharding begins, each authorizes the processes whose pid falls in its
+/// shard and mutes AUTH events from all others. Lifecycle events are never
+/// muted, so every shard keeps the ordering guarantee above for the processes
+/// it authorizes.
+- (instancetype)initWithESAPI:(std::shared_ptr<santa::EndpointSecurityAPI>)esApi
+                      metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
+               execController:(SNTExecutionController*)execController
+           compilerController:(SNTCompilerController*)compilerController
+              authResultCache:(std::shared_ptr<santa::AuthResultCache>)authResultCache
+                    ttyWriter:(std::shared_ptr<santa::TTYWriter>)ttyWriter
+                  processTree:
+                      (std::shared_ptr<santa::santad::process_tree::ProcessTree>)processTree
+                   shardIndex:(uint32_t)shardIndex
+                   shardCount:(uint32_t)shardCount;
+
 - (void)registerAuthExecProbe:(id<SNTEndpointSecurityProbe>)watcher;
 
+/// Start leaving processes outside this shard to their own shards. Until then
+/// every shard authorizes every process, so this must only be called once all
+/// shards are enabled. Does nothing if there is only one shard.
+- (void)beginSharding;
+
 @end
@@ -16,33 +16,68 @@
 #import "Source/santad/EventProviders/SNTEndpointSecurityAuthorizer.h"
 
 #include <EndpointSecurity/ESTypes.h>
+#include <bsm/libbsm.h>
+#include <mach/mach_time.h>
 #include <os/base.h>
 #include <stdlib.h>
 
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <vector>
+
+#include "Source/common/AuditUtilities.h"
 #import "Source/common/BranchPrediction.h"
+#include "Source/common/ExecTrace.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTLogging.h"
+#include "Source/common/String.h"
+#include "Source/common/SystemResources.h"
 #include "Source/common/es/ESMetricsObserver.h"
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
 #include "Source/santad/EventProviders/AuthResultCache.h"
+#include "absl/time/time.h"
 
 using santa::AuthResultCache;
 using santa::EndpointSecurityAPI;
 using santa::EventDisposition;
+using santa::ExecTrace;
+using santa::ExecTracer;
+using santa::ExecTraceStage;
 using santa::Message;
 
+// Whether someone is likely waiting on the exec to start: it has a terminal, or
+// it's an app that launchd started for a user, e.g. from the Finder or Dock.
+static bool IsUserFacingExec(const Message& msg) {
+  const es_process_t* target = msg->event.exec.target;
+  if (santa::TTYWriter::CanWrite(target)) {
+    return true;
+  }
+
+  return msg->process->is_platform_binary && audit_token_to_euid(target->audit_token) != 0 &&
+         santa::StringTokenToStringView(msg->process->signing_id) == "com.apple.xpc.proxy" &&
+         santa::StringTokenToStringView(target->executable->path).find(".app/Contents/MacOS/") !=
+             std::string_view::npos;
+}
+
 @interface SNTEndpointSecurityAuthorizer ()
 @property SNTCompilerController* compilerController;
 @property SNTExecutionController* execController;
 @property NSMutableArray<id<SNTEndpointSecurityProbe>>* probes;
 @property BOOL enabled;
+@property uint32_t shardIndex;
+@property uint32_t shardCount;
 @end
 
 @implementation SNTEndpointSecurityAuthorizer {
   std::shared_ptr<AuthResultCache> _authResultCache;
   std::shared_ptr<santa::TTYWriter> _ttyWriter;
+  std::set<es_event_type_t> _authEvents;
+  std::atomic<bool> _shardingActive;
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
@@ -53,6 +88,27 @@ using santa::Message;
                     ttyWriter:(std::shared_ptr<santa::TTYWriter>)ttyWriter
                   processTree:
                       (std::shared_ptr<santa::santad::process_tree::ProcessTree>)processTree {
+  return [self initWithESAPI:std::move(esApi)
+                     metrics:std::move(metrics)
+              execController:execController
+          compilerController:compilerController
+             authResultCache:std::move(authResultCache)
+                   ttyWriter:std::move(ttyWriter)
+                 processTree:std::move(processTree)
+                  shardIndex:0
+                  shardCount:1];
+}
+
+- (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
+                      metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
+               execController:(SNTExecutionController*)execController
+           compilerController:(SNTCompilerController*)compilerController
+              authResultCache:(std::shared_ptr<AuthResultCache>)authResultCache
+                    ttyWriter:(std::shared_ptr<santa::TTYWriter>)ttyWriter
+                  processTree:
+                      (std::shared_ptr<santa::santad::process_tree::ProcessTree>)processTree
+                   shardIndex:(uint32_t)shardIndex
+                   shardCount:(uint32_t)shardCount {
   self = [super initWithESAPI:std::move(esApi)
                       metrics:std::move(metrics)
                     processor:santa::Processor::kAuthorizer
@@ -62,6 +118,13 @@ using santa::Message;
     _compilerController = compilerController;
     _authResultCache = authResultCache;
     _ttyWriter = std::move(ttyWriter);
+    _shardCount = MAX(shardCount, 1);
+    _shardIndex = shardIndex % _shardCount;
+    _shardingActive = false;
+    _authEvents = {
+        ES_EVENT_TYPE_AUTH_EXEC,
+        ES_EVENT_TYPE_AUTH_PROC_SUSPEND_RESUME,
+    };
 
     _probes = [NSMutableArray array];
 
@@ -71,11 +134,73 @@ using santa::Message;
 }
 
 - (NSString*)description {
+  if (self.shardCount > 1) {
+    return [NSString stringWithFormat:@"Authorizer %u/%u", self.shardIndex + 1, self.shardCount];
+  }
   return @"Authorizer";
 }
 
+- (bool)ownsProcess:(const audit_token_t&)tok {
+  return static_cast<uint32_t>(santa::Pid(tok)) % self.shardCount == self.shardIndex;
+}
+
+// Processes outside this shard have their AUTH events muted as soon as they
+// are seen, and unmuted once their audit token is stale, so the mutes are
+// bounded by the number of live processes. An exec keeps the pid, so the new
+// image stays in the same shard.
+- (void)updateShardMutesForMessage:(const Message&)esMsg {
+  switch (esMsg->event_type) {
+    case ES_EVENT_TYPE_NOTIFY_FORK:
+      if (![self ownsProcess:esMsg->event.fork.child->audit_token]) {
+        [self muteProcess:&esMsg->event.fork.child->audit_token forEvents:_authEvents];
+      }
+      break;
+    case ES_EVENT_TYPE_NOTIFY_EXEC:
+      if (![self ownsProcess:esMsg->process->audit_token]) {
+        [self unmuteProcess:&esMsg->process->audit_token forEvents:_authEvents];
+        [self muteProcess:&esMsg->event.exec.target->audit_token forEvents:_authEvents];
+      }
+      break;
+    case ES_EVENT_TYPE_NOTIFY_EXIT:
+      if (![self ownsProcess:esMsg->process->audit_token]) {
+        [self unmuteProcess:&esMsg->process->audit_token forEvents:_authEvents];
+      }
+      break;
+    default: break;
+  }
+}
+
+// Processes that were already running when sharding began.
+- (void)muteProcessesOutsideShard {
+  std::optional<std::vector<pid_t>> pids = GetPidList();
+  if (!pids) {
+    LOGW(@"%@: Unable to list processes, running ones will be authorized by every shard", self);
+    return;
+  }
+
+  for (pid_t pid : *pids) {
+    audit_token_t tok;
+    if (pid > 0 && static_cast<uint32_t>(pid) % self.shardCount != self.shardIndex &&
+        santa::AuditTokenForPid(pid, &tok)) {
+      [self muteProcess:&tok forEvents:_authEvents];
+    }
+  }
+}
+
+- (void)beginSharding {
+  if (self.shardCount == 1) {
+    return;
+  }
+
+  _shardingActive = true;
+  [self muteProcessesOutsideShard];
+}
+
 - (bool)handleContextMessage:(Message&)esMsg {
   bool addedOnly = [super handleContextMessage:esMsg];
+  if (_shardingActive) {
+    [self updateShardMutesForMessage:esMsg];
+  }
   // The tree-aware superclass vends process lifecycle events to keep the process
   // tree consistent. Now that this client observes exits, evict the exiting
   // process from the exec controller's sandboxed-seatbelt cache so it stays
@@ -97,6 +222,10 @@ using santa::Message;
   // DENY results. The caller may also prevent caching if it has reason to so.
   bool cacheable = (result == ES_AUTH_RESULT_ALLOW) && !forcePreventCache;
 
+  if (ExecTrace* trace = ExecTrace::Current()) {
+    trace->SetResult(result == ES_AUTH_RESULT_ALLOW ? "allow" : "deny");
+  }
+
   for (id<SNTEndpointSecurityProbe> probe in self.probes) {
     santa::ProbeInterest interest = [probe probeInterest:msg];
 
@@ -108,6 +237,40 @@ using santa::Message;
   return [self respondToMessage:msg withAuthResult:result cacheable:cacheable];
 }
 
+- (void)respondToMessage:(const Message&)msg withCachedAction:(SNTAction)action {
+  es_auth_result_t authResult = ES_AUTH_RESULT_DENY;
+
+  switch (action) {
+    case SNTActionRespondAllowCompiler:
+      [self.compilerController setProcess:msg->event.exec.target->audit_token isCompiler:true];
+      OS_FALLTHROUGH;
+    case SNTActionRespondAllow: authResult = ES_AUTH_RESULT_ALLOW; break;
+    default: break;
+  }
+
+  // Do not cache compiler processes so future instances get marked appropriately.
+  [self respondToMessage:msg
+          withAuthResult:authResult
+       forcePreventCache:(action == SNTActionRespondAllowCompiler)];
+}
+
+// Answers the exec on the ES delivery thread if the AuthResultCache already
+// holds a final decision for the binary. Anything else, including execs still
+// being evaluated elsewhere, may have to wait and is left to the workers.
+- (bool)respondFromCacheToExecMessage:(const Message&)msg {
+  if (!_authResultCache) {
+    return false;
+  }
+
+  SNTAction action = _authResultCache->CheckCache(msg->event.exec.target->executable).action;
+  if (!RESPONSE_VALID(action)) {
+    return false;
+  }
+
+  [self respondToMessage:msg withCachedAction:action];
+  return true;
+}
+
 - (void)processMessage:(Message)msg {
   if (msg->event_type == ES_EVENT_TYPE_AUTH_PROC_SUSPEND_RESUME) {
     [self.execController
@@ -122,36 +285,39 @@ using santa::Message;
     return;
   }
 
+  const es_process_t* targetProc = msg->event.exec.target;
+  std::shared_ptr<ExecTrace> trace = ExecTracer::Shared().BeginTrace(
+      audit_token_to_pid(targetProc->audit_token),
+      santa::StringTokenToStringView(targetProc->executable->path), msg->mach_time);
+  if (trace) {
+    ExecTrace::ScopedCurrent scopedTrace(trace.get());
+    [self processExecMessage:std::move(msg)];
+    ExecTracer::Shared().EndTrace(*trace);
+  } else {
+    [self processExecMessage:std::move(msg)];
+  }
+}
+
+- (void)processExecMessage:(Message)msg {
   const es_process_t* targetProc = msg->event.exec.target;
 
   SNTCachedDecision* cd = nil;
 
   while (true) {
-    santa::CachedAuthResult cacheEntry = self->_authResultCache->CheckCache(targetProc->executable);
+    santa::CachedAuthResult cacheEntry;
+    {
+      ExecTrace::Span span(ExecTraceStage::kAuthResultCache);
+      cacheEntry = self->_authResultCache->CheckCache(targetProc->executable);
+    }
     SNTAction returnAction = cacheEntry.action;
     if (RESPONSE_VALID(returnAction)) {
-      es_auth_result_t authResult = ES_AUTH_RESULT_DENY;
-
-      switch (returnAction) {
-        case SNTActionRespondAllowCompiler:
-          [self.compilerController setProcess:msg->event.exec.target->audit_token isCompiler:true];
-          OS_FALLTHROUGH;
-        case SNTActionRespondAllow: authResult = ES_AUTH_RESULT_ALLOW; break;
-        default: break;
-      }
-
-      // Do not cache compiler processes so future instances get marked appropriately.
-      [self respondToMessage:msg
-              withAuthResult:authResult
-           forcePreventCache:(returnAction == SNTActionRespondAllowCompiler)];
-
+      [self respondToMessage:msg withCachedAction:returnAction];
       return;
     } else if (returnAction == SNTActionRespondAllowNoCache) {
       // Cache hit — we have pre-computed identity data but need to re-evaluate policy.
       cd = cacheEntry.cached_decision;
       // Remove the entry so we can transition through RequestBinary for re-evaluation.
       self->_authResultCache->RemoveFromCache(targetProc->executable);
-      break;
     } else if (returnAction == SNTActionRespondHold) {
       _ttyWriter->Write(
           targetProc,
@@ -165,21 +331,34 @@ using santa::Message;
                                      @"---\n"
                                      @"\n",
                                      targetProc->executable->path.data]);
+      if (ExecTrace* trace = ExecTrace::Current()) {
+        trace->SetResult("deny");
+      }
       [self respondToMessage:msg withAuthResult:ES_AUTH_RESULT_DENY cacheable:false];
       return;
     } else if (returnAction == SNTActionRequestBinary) {
       // TODO(mlw): Add a metric here to observe how ofthen this happens in practice.
-      // TODO(mlw): Look into caching a `Deferred<value>` to better prevent
-      // raciness of multiple threads checking the cache simultaneously.
-      // Also mitigates need to poll.
-      usleep(5000);
-    } else {
+      // Another thread is evaluating the same binary. Wait for its decision for
+      // as long as this event can, falling back to polling if it can't be
+      // waited on, e.g. because it hasn't been tracked yet.
+      uint64_t now = mach_absolute_time();
+      absl::Duration timeout =
+          msg->deadline > now ? absl::Nanoseconds(MachTimeToNanos(msg->deadline - now))
+                              : absl::ZeroDuration();
+      if (!self->_authResultCache->WaitForEvaluation(targetProc->executable, timeout)) {
+        usleep(5000);
+      }
+      continue;
+    }
+
+    // Claim the evaluation. Threads that lose the race for the same binary
+    // wait for the winner's decision instead of evaluating it again.
+    if (self->_authResultCache->AddToCache(targetProc->executable, SNTActionRequestBinary)) {
       break;
     }
+    cd = nil;
   }
 
-  self->_authResultCache->AddToCache(targetProc->executable, SNTActionRequestBinary);
-
   [self.execController validateExecEvent:msg
                           cachedDecision:cd
                               postAction:^bool(SNTAction action, SNTCachedDecision* cd) {
@@ -189,6 +368,16 @@ using santa::Message;
 
 - (void)handleMessage:(Message&&)esMsg
     recordEventMetrics:(void (^)(EventDisposition))recordEventMetrics {
+  // A process can exec before its fork is seen and muted here. The shard that
+  // owns it never mutes it, so it also receives this event and makes the
+  // decision, and ES denies the event if any client does.
+  if (_shardingActive && ![self ownsProcess:esMsg->process->audit_token]) {
+    [self respondToMessage:esMsg withAuthResult:ES_AUTH_RESULT_ALLOW cacheable:false];
+    recordEventMetrics(EventDisposition::kDropped);
+    return;
+  }
+
+  bool userFacing = true;
   switch (esMsg->event_type) {
     case ES_EVENT_TYPE_AUTH_EXEC:
       if (![self.execController synchronousShouldProcessExecEvent:esMsg]) {
@@ -196,6 +385,11 @@ using santa::Message;
         recordEventMetrics(EventDisposition::kDropped);
         return;
       }
+      if ([self respondFromCacheToExecMessage:esMsg]) {
+        recordEventMetrics(EventDisposition::kProcessed);
+        return;
+      }
+      userFacing = IsUserFacingExec(esMsg);
       break;
     case ES_EVENT_TYPE_AUTH_PROC_SUSPEND_RESUME:
       if (esMsg->event.proc_suspend_resume.type != ES_PROC_SUSPEND_RESUME_TYPE_RESUME) {
@@ -212,6 +406,7 @@ using santa::Message;
   }
 
   [self processMessage:std::move(esMsg)
+            userFacing:userFacing
                handler:^(Message msg) {
                  [self processMessage:std::move(msg)];
                  recordEventMetrics(EventDisposition::kProcessed);
@@ -272,10 +467,7 @@ using santa::Message;
 
 - (void)enable {
   self.enabled = YES;
-  [super subscribeAndClearCache:{
-                                    ES_EVENT_TYPE_AUTH_EXEC,
-                                    ES_EVENT_TYPE_AUTH_PROC_SUSPEND_RESUME,
-  }];
+  [super subscribeAndClearCache:_authEvents];
 }
 
 - (void)registerAuthExecProbe:(id<SNTEndpointSecurityProbe>)probe {
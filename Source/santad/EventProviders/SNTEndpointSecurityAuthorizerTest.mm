@@ -14,6 +14,7 @@
 /// limitations under the License.
 
 #include <EndpointSecurity/ESTypes.h>
+#include <bsm/libbsm.h>
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
 #include <gmock/gmock.h>
@@ -174,6 +175,82 @@ class MockAuthResultCache : public AuthResultCache {
   XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
 }
 
+- (void)testShardedAuthorizerLeavesOtherShardsProcessesAlone {
+  // Shard 0 of 2 owns the even pids
+  es_file_t file = MakeESFile("foo");
+  es_process_t ownedProc = MakeESProcess(&file, MakeAuditToken(10, 1));
+  es_process_t ownedChild = MakeESProcess(&file, MakeAuditToken(12, 1));
+  es_process_t otherProc = MakeESProcess(&file, MakeAuditToken(11, 1));
+  es_process_t otherChild = MakeESProcess(&file, MakeAuditToken(13, 1));
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  SNTEndpointSecurityAuthorizer* authClient =
+      [[SNTEndpointSecurityAuthorizer alloc] initWithESAPI:mockESApi
+                                                   metrics:nullptr
+                                            execController:self.mockExecController
+                                        compilerController:nil
+                                           authResultCache:nullptr
+                                                 ttyWriter:nullptr
+                                               processTree:nullptr
+                                                shardIndex:0
+                                                shardCount:2];
+
+  // Forks aren't acted on until sharding begins
+  es_message_t forkMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_FORK, &ownedProc);
+  forkMsg.event.fork.child = &otherChild;
+  EXPECT_CALL(*mockESApi, MuteProcessEvents).Times(0);
+  {
+    Message msg(mockESApi, &forkMsg);
+    [authClient handleContextMessage:msg];
+  }
+  XCTAssertTrue(testing::Mock::VerifyAndClearExpectations(mockESApi.get()));
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  // Processes already running outside of the shard are muted when it begins
+  EXPECT_CALL(*mockESApi, MuteProcessEvents).WillRepeatedly(testing::Return(true));
+  [authClient beginSharding];
+  XCTAssertTrue(testing::Mock::VerifyAndClearExpectations(mockESApi.get()));
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  // Only children outside of the shard are muted, and only for AUTH events
+  std::set<es_event_type_t> authEvents{ES_EVENT_TYPE_AUTH_EXEC,
+                                       ES_EVENT_TYPE_AUTH_PROC_SUSPEND_RESUME};
+  auto isOtherChild = testing::Truly([](const audit_token_t* tok) {
+    return audit_token_to_pid(*tok) == 13;
+  });
+  EXPECT_CALL(*mockESApi, MuteProcessEvents(testing::_, isOtherChild, authEvents))
+      .WillOnce(testing::Return(true));
+  {
+    Message msg(mockESApi, &forkMsg);
+    [authClient handleContextMessage:msg];
+  }
+  forkMsg.event.fork.child = &ownedChild;
+  {
+    Message msg(mockESApi, &forkMsg);
+    [authClient handleContextMessage:msg];
+  }
+  XCTAssertTrue(testing::Mock::VerifyAndClearExpectations(mockESApi.get()));
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  // An exec by a process outside of the shard is left to its own shard
+  es_message_t execMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_EXEC, &otherProc, ActionType::Auth);
+  execMsg.event.exec.target = &otherChild;
+  EXPECT_CALL(*mockESApi, RespondAuthResult(testing::_, testing::_, ES_AUTH_RESULT_ALLOW, false))
+      .WillOnce(testing::Return(true));
+  __block int droppedCount = 0;
+  [authClient handleMessage:Message(mockESApi, &execMsg)
+         recordEventMetrics:^(EventDisposition d) {
+           XCTAssertEqual(d, EventDisposition::kDropped);
+           droppedCount++;
+         }];
+  XCTAssertEqual(droppedCount, 1);
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
 - (void)testHandleMessage {
 #ifdef THREAD_SANITIZER
   // TSAN and this test do not get along in multiple ways.
@@ -297,7 +374,9 @@ class MockAuthResultCache : public AuthResultCache {
           .ignoringNonObjectArgs()
           .andReturn(YES);
 
-      OCMExpect([mockAuthClient processMessage:Message(mockESApi, &esMsg) handler:OCMOCK_ANY])
+      OCMExpect([mockAuthClient processMessage:Message(mockESApi, &esMsg)
+                                    userFacing:false
+                                       handler:OCMOCK_ANY])
           .ignoringNonObjectArgs()
           .andDo(^(NSInvocation* invocation) {
             dispatch_semaphore_signal(semaMetrics);
@@ -317,6 +396,72 @@ class MockAuthResultCache : public AuthResultCache {
   }
 }
 
+- (void)testHandleMessageRespondsFromCacheWithoutQueueing {
+  es_file_t file = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&file);
+  es_file_t execFile = MakeESFile("bar");
+  es_process_t execProc = MakeESProcess(&execFile, MakeAuditToken(12, 23), MakeAuditToken(34, 45));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_EXEC, &proc, ActionType::Auth);
+  esMsg.event.exec.target = &execProc;
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  auto mockAuthCache = std::make_shared<MockAuthResultCache>(nullptr, nil);
+  EXPECT_CALL(*mockAuthCache, CheckCache)
+      .WillOnce(testing::Return(santa::CachedAuthResult{SNTActionRespondAllow}))
+      .WillOnce(testing::Return(santa::CachedAuthResult{SNTActionRequestBinary}));
+
+  SNTEndpointSecurityAuthorizer* authClient =
+      [[SNTEndpointSecurityAuthorizer alloc] initWithESAPI:mockESApi
+                                                   metrics:nullptr
+                                            execController:self.mockExecController
+                                        compilerController:nil
+                                           authResultCache:mockAuthCache
+                                                 ttyWriter:nullptr
+                                               processTree:nullptr];
+  id mockAuthClient = OCMPartialMock(authClient);
+
+  OCMStub([self.mockExecController synchronousShouldProcessExecEvent:Message(mockESApi, &esMsg)])
+      .ignoringNonObjectArgs()
+      .andReturn(YES);
+
+  // A final decision in the cache is answered before returning, without queueing
+  {
+    EXPECT_CALL(*mockESApi, RespondAuthResult(testing::_, testing::_, ES_AUTH_RESULT_ALLOW, true))
+        .WillOnce(testing::Return(true));
+
+    __block EventDisposition disposition = EventDisposition::kDropped;
+    [mockAuthClient handleMessage:Message(mockESApi, &esMsg)
+               recordEventMetrics:^(EventDisposition d) {
+                 disposition = d;
+               }];
+    XCTAssertEqual(disposition, EventDisposition::kProcessed);
+    XCTAssertTrue(testing::Mock::VerifyAndClearExpectations(mockESApi.get()));
+    mockESApi->SetExpectationsRetainReleaseMessage();
+  }
+
+  // Execs still being evaluated elsewhere are left to the workers
+  {
+    OCMExpect([mockAuthClient processMessage:Message(mockESApi, &esMsg)
+                                  userFacing:false
+                                     handler:OCMOCK_ANY])
+        .ignoringNonObjectArgs()
+        .andDo(nil);
+
+    [mockAuthClient handleMessage:Message(mockESApi, &esMsg)
+               recordEventMetrics:^(EventDisposition d){
+                   // This block intentionally left blank
+               }];
+    XCTAssertTrue(OCMVerifyAll(mockAuthClient));
+  }
+
+  [mockAuthClient stopMocking];
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockAuthCache.get());
+}
+
 - (void)testProcessMessageWaitThenAllow {
   // This test ensures that if there is an outstanding action for
   // an item, it will check the cache again until a result exists.
@@ -34,13 +34,13 @@
                                  SNTEndpointSecurityProbe>
 
 - (instancetype)initWithESAPI:(std::shared_ptr<santa::EndpointSecurityAPI>)esApi
-                        metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
-                         logger:(std::shared_ptr<santa::Logger>)logger
-                       enricher:(std::shared_ptr<santa::Enricher>)enricher
-             faaPolicyProcessor:
-                 (std::shared_ptr<santa::DataFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
-                      ttyWriter:(std::shared_ptr<santa::TTYWriter>)ttyWriter
-    findPoliciesForTargetsBlock:(santa::FindPoliciesForTargetsBlock)findPoliciesForTargetsBlock;
+                      metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
+                       logger:(std::shared_ptr<santa::Logger>)logger
+                     enricher:(std::shared_ptr<santa::Enricher>)enricher
+           faaPolicyProcessor:
+               (std::shared_ptr<santa::DataFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
+                    ttyWriter:(std::shared_ptr<santa::TTYWriter>)ttyWriter
+    findPoliciesForPathsBlock:(santa::FindPoliciesForPathsBlock)findPoliciesForPathsBlock;
 
 @property SNTFileAccessDeniedBlock fileAccessDeniedBlock;
 
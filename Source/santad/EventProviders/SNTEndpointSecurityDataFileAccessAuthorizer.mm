@@ -28,6 +28,7 @@
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <variant>
@@ -42,13 +43,13 @@
 
 using santa::EndpointSecurityAPI;
 using santa::FAAPolicyProcessor;
-using santa::FindPoliciesForTargetsBlock;
+using santa::FindPoliciesForPathsBlock;
 using santa::Message;
 
 @interface SNTEndpointSecurityDataFileAccessAuthorizer ()
 @property SNTConfigurator* configurator;
 @property bool isSubscribed;
-@property(copy) FindPoliciesForTargetsBlock findPoliciesForTargetsBlock;
+@property(copy) FindPoliciesForPathsBlock findPoliciesForPathsBlock;
 @end
 
 @implementation SNTEndpointSecurityDataFileAccessAuthorizer {
@@ -56,19 +57,19 @@ using santa::Message;
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<santa::EndpointSecurityAPI>)esApi
-                        metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
-                         logger:(std::shared_ptr<santa::Logger>)logger
-                       enricher:(std::shared_ptr<santa::Enricher>)enricher
-             faaPolicyProcessor:
-                 (std::shared_ptr<santa::DataFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
-                      ttyWriter:(std::shared_ptr<santa::TTYWriter>)ttyWriter
-    findPoliciesForTargetsBlock:(FindPoliciesForTargetsBlock)findPoliciesForTargetsBlock {
+                      metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
+                       logger:(std::shared_ptr<santa::Logger>)logger
+                     enricher:(std::shared_ptr<santa::Enricher>)enricher
+           faaPolicyProcessor:
+               (std::shared_ptr<santa::DataFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
+                    ttyWriter:(std::shared_ptr<santa::TTYWriter>)ttyWriter
+    findPoliciesForPathsBlock:(FindPoliciesForPathsBlock)findPoliciesForPathsBlock {
   self = [super initWithESAPI:std::move(esApi)
                       metrics:metrics
                     processor:santa::Processor::kDataFileAccessAuthorizer];
   if (self) {
     _faaPolicyProcessorProxy = std::move(faaPolicyProcessorProxy);
-    _findPoliciesForTargetsBlock = findPoliciesForTargetsBlock;
+    _findPoliciesForPathsBlock = findPoliciesForPathsBlock;
 
     _configurator = [SNTConfigurator configurator];
 
@@ -99,16 +100,22 @@ using santa::Message;
     return;
   }
 
-  __block std::vector<FAAPolicyProcessor::TargetPolicyPair> targetPolicyPairs;
-  __block auto pathTargets = msg.PathTargets();
+  // Look up the policies for all targets at once instead of one by one, since
+  // two-target events often share most of their paths.
+  const std::vector<Message::PathTarget> pathTargets = msg.PathTargets();
+  std::vector<std::string_view> paths;
+  paths.reserve(pathTargets.size());
+  for (const auto& target : pathTargets) {
+    paths.push_back(target.Path());
+  }
 
-  self.findPoliciesForTargetsBlock(^(santa::LookupPolicyBlock lookupPolicyBlock) {
-    size_t idx = 0;
-    for (const auto& target : pathTargets) {
-      targetPolicyPairs.emplace_back(idx, lookupPolicyBlock(target.Path().data()));
-      idx++;
-    }
-  });
+  santa::PolicyLookupResults policies = self.findPoliciesForPathsBlock(paths);
+
+  std::vector<FAAPolicyProcessor::TargetPolicyPair> targetPolicyPairs;
+  targetPolicyPairs.reserve(policies.size());
+  for (size_t idx = 0; idx < policies.size(); idx++) {
+    targetPolicyPairs.emplace_back(idx, std::move(policies[idx]));
+  }
 
   FAAPolicyProcessor::ESResult result = _faaPolicyProcessorProxy->ProcessMessage(
       msg, targetPolicyPairs,
@@ -104,7 +104,7 @@ void SetExpectationsForDataFileAccessAuthorizerInit(
                                                                 enricher:nullptr
                                                       faaPolicyProcessor:nil
                                                                ttyWriter:nullptr
-                                             findPoliciesForTargetsBlock:nil];
+                                               findPoliciesForPathsBlock:nil];
 
   EXPECT_CALL(*mockESApi, UnsubscribeAll);
   EXPECT_CALL(*mockESApi, UnmuteAllTargetPaths).WillOnce(testing::Return(true));
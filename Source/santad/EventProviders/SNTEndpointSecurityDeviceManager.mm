@@ -21,6 +21,8 @@
 
 #include <atomic>
 #include <memory>
+#include <optional>
+#include <string>
 
 #include <bsm/libbsm.h>
 #include <errno.h>
@@ -37,11 +39,14 @@
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTMetricSet.h"
 #import "Source/common/SNTProcessChain.h"
+#import "Source/common/SNTStrengthify.h"
 #include "Source/common/String.h"
 #include "Source/common/es/ESMetricsObserver.h"
 #include "Source/common/es/Message.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Utilities.h"
 #import "Source/santad/SNTDecisionCache.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 
 using santa::AuthResultCache;
 using santa::EndpointSecurityAPI;
@@ -65,10 +70,36 @@ static NSString* const kMetricStartupDiskOperationRemountSkipped = @"RemountSkip
 // Operations on device matching the configured startup pref wwere successful
 static NSString* const kMetricStartupDiskOperationSuccess = @"Success";
 
+// A single attach produces a burst of DiskArbitration callbacks as the disk
+// appears, is probed and is mounted. Appearances are logged once this long
+// after the first callback, with the latest description.
+static const int64_t kDiskAppearedCoalesceIntervalNS = 500 * NSEC_PER_MSEC;
+
+namespace {
+
+// What the device manager remembers about a disk between DiskArbitration
+// callbacks, keyed by BSD name.
+struct DiskState {
+  // The last description seen for the disk. Replaced whenever DiskArbitration
+  // reports that the description changed.
+  NSDictionary* description;
+  // Whether the disk is subject to the removable media policy, evaluated from
+  // the current description on first use.
+  std::optional<bool> should_operate;
+  // The description to log when the coalescing interval ends, if any.
+  NSDictionary* pending_log;
+  // The volume path of the last description that was logged.
+  id logged_volume_path;
+};
+
+}  // namespace
+
 @interface SNTEndpointSecurityDeviceManager ()
 
 - (void)logDiskAppeared:(NSDictionary*)props allowed:(bool)allowed;
 - (void)logDiskDisappeared:(NSDictionary*)props;
+- (void)recordDiskDescription:(NSDictionary*)props forDisk:(DADiskRef)disk appeared:(BOOL)appeared;
+- (void)forgetDisk:(DADiskRef)disk description:(NSDictionary*)props;
 - (DADissenterRef __nullable)handleEncryptedMountApproval:(DADiskRef)disk;
 - (void)handleEncryptedRemountCompletion:(DADiskRef)disk
                                dissenter:(DADissenterRef __nullable)dissenter;
@@ -107,18 +138,15 @@ void DiskAppearedCallback(DADiskRef disk, void* context) {
   if (![props[@"DAVolumeMountable"] boolValue]) return;
   SNTEndpointSecurityDeviceManager* dm = (__bridge SNTEndpointSecurityDeviceManager*)context;
 
-  [dm logDiskAppeared:props allowed:true];
+  [dm recordDiskDescription:props forDisk:disk appeared:YES];
 }
 
 void DiskDescriptionChangedCallback(DADiskRef disk, CFArrayRef keys, void* context) {
   NSDictionary* props = CFBridgingRelease(DADiskCopyDescription(disk));
   if (![props[@"DAVolumeMountable"] boolValue]) return;
+  SNTEndpointSecurityDeviceManager* dm = (__bridge SNTEndpointSecurityDeviceManager*)context;
 
-  if (props[@"DAVolumePath"]) {
-    SNTEndpointSecurityDeviceManager* dm = (__bridge SNTEndpointSecurityDeviceManager*)context;
-
-    [dm logDiskAppeared:props allowed:true];
-  }
+  [dm recordDiskDescription:props forDisk:disk appeared:NO];
 }
 
 void DiskDisappearedCallback(DADiskRef disk, void* context) {
@@ -132,7 +160,7 @@ void DiskDisappearedCallback(DADiskRef disk, void* context) {
     [dm.remountingDisks removeObject:@(bsdNameStr)];
   }
 
-  [dm logDiskDisappeared:props];
+  [dm forgetDisk:disk description:props];
 }
 
 void DiskUnmountCallback(DADiskRef disk, DADissenterRef dissenter, void* context) {
@@ -206,6 +234,9 @@ NS_ASSUME_NONNULL_BEGIN
   std::shared_ptr<AuthResultCache> _authResultCache;
   std::shared_ptr<santa::Enricher> _enricher;
   std::shared_ptr<Logger> _logger;
+
+  absl::Mutex _diskStatesMutex;
+  absl::flat_hash_map<std::string, DiskState> _diskStates ABSL_GUARDED_BY(_diskStatesMutex);
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
@@ -466,6 +497,122 @@ NS_ASSUME_NONNULL_BEGIN
   self->_logger->LogDiskDisappeared(props);
 }
 
+// Returns the description of the disk, and whether it is subject to the
+// removable media policy, from what was recorded by earlier DiskArbitration
+// callbacks where possible. Descriptions without the encryption status are
+// re-read since DiskArbitration populates it asynchronously.
+- (nullable NSDictionary*)descriptionForDisk:(DADiskRef)disk shouldOperate:(BOOL*)shouldOperate {
+  const char* bsdNameStr = DADiskGetBSDName(disk);
+  NSDictionary* diskInfo;
+
+  if (bsdNameStr) {
+    absl::ReaderMutexLock lock(&_diskStatesMutex);
+    auto it = _diskStates.find(bsdNameStr);
+    if (it != _diskStates.end() &&
+        it->second.description[(__bridge NSString*)kDADiskDescriptionMediaEncryptedKey]) {
+      diskInfo = it->second.description;
+      if (it->second.should_operate.has_value()) {
+        *shouldOperate = *it->second.should_operate;
+        return diskInfo;
+      }
+    }
+  }
+
+  if (!diskInfo) {
+    diskInfo = CFBridgingRelease(DADiskCopyDescription(disk));
+  }
+  *shouldOperate = [self shouldOperateOnDiskWithProperties:diskInfo];
+
+  if (bsdNameStr && diskInfo) {
+    absl::MutexLock lock(&_diskStatesMutex);
+    DiskState& state = _diskStates[bsdNameStr];
+    // Don't replace a description recorded by a callback in the meantime.
+    if (!state.description || state.description == diskInfo) {
+      state.description = diskInfo;
+      state.should_operate = *shouldOperate;
+    }
+  }
+
+  return diskInfo;
+}
+
+// Called on the disk queue when a disk appears or its description changes.
+// Appearances are logged once per coalescing interval, and description changes
+// are only logged when the disk is mounted at a new path.
+- (void)recordDiskDescription:(NSDictionary*)props forDisk:(DADiskRef)disk appeared:(BOOL)appeared {
+  const char* bsdNameStr = DADiskGetBSDName(disk);
+  id volumePath = props[@"DAVolumePath"];
+
+  if (!bsdNameStr) {
+    if (appeared || volumePath) {
+      [self logDiskAppeared:props allowed:true];
+    }
+    return;
+  }
+
+  std::string bsdName = bsdNameStr;
+  bool scheduleLog = false;
+  {
+    absl::MutexLock lock(&_diskStatesMutex);
+    DiskState& state = _diskStates[bsdName];
+    state.description = props;
+    state.should_operate = std::nullopt;
+
+    if (state.pending_log) {
+      state.pending_log = props;
+    } else if (appeared || (volumePath && ![volumePath isEqual:state.logged_volume_path])) {
+      state.pending_log = props;
+      scheduleLog = true;
+    } else if (!volumePath) {
+      state.logged_volume_path = nil;
+    }
+  }
+
+  if (scheduleLog) {
+    WEAKIFY(self);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kDiskAppearedCoalesceIntervalNS),
+                   self.diskQueue, ^{
+                     STRONGIFY(self);
+                     [self logPendingDiskAppeared:bsdName];
+                   });
+  }
+}
+
+- (void)logPendingDiskAppeared:(const std::string&)bsdName {
+  NSDictionary* props;
+  {
+    absl::MutexLock lock(&_diskStatesMutex);
+    auto it = _diskStates.find(bsdName);
+    if (it == _diskStates.end() || !it->second.pending_log) {
+      return;
+    }
+    props = it->second.pending_log;
+    it->second.pending_log = nil;
+    it->second.logged_volume_path = props[@"DAVolumePath"];
+  }
+
+  [self logDiskAppeared:props allowed:true];
+}
+
+// Called on the disk queue when a disk disappears. Any appearance still
+// waiting out the coalescing interval is logged first.
+- (void)forgetDisk:(DADiskRef)disk description:(NSDictionary*)props {
+  NSDictionary* pendingLog;
+  if (const char* bsdNameStr = DADiskGetBSDName(disk)) {
+    absl::MutexLock lock(&_diskStatesMutex);
+    auto it = _diskStates.find(bsdNameStr);
+    if (it != _diskStates.end()) {
+      pendingLog = it->second.pending_log;
+      _diskStates.erase(it);
+    }
+  }
+
+  if (pendingLog) {
+    [self logDiskAppeared:pendingLog allowed:true];
+  }
+  [self logDiskDisappeared:props];
+}
+
 - (NSString*)description {
   return @"Device Manager";
 }
@@ -473,10 +620,18 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)handleMessage:(Message&&)esMsg
     recordEventMetrics:(void (^)(EventDisposition))recordEventMetrics {
   // Process the unmount event first so that caches are flushed before any
-  // other potential early returns.
+  // other potential early returns. Only decisions for files on the departing
+  // volume are dropped, since a later volume may reuse its device number.
   if (esMsg->event_type == ES_EVENT_TYPE_NOTIFY_UNMOUNT) {
-    self->_authResultCache->FlushCache(FlushCacheMode::kNonRootOnly,
-                                       FlushCacheReason::kFilesystemUnmounted);
+    const struct statfs* sfs = esMsg->event.unmount.statfs;
+    if (sfs) {
+      dev_t fsid = static_cast<dev_t>(sfs->f_fsid.val[0]);
+      self->_authResultCache->FlushCacheForDevice(fsid, FlushCacheReason::kFilesystemUnmounted);
+      [[SNTDecisionCache sharedCache] forgetCachedDecisionsForDevice:fsid];
+    } else {
+      self->_authResultCache->FlushCache(FlushCacheMode::kNonRootOnly,
+                                         FlushCacheReason::kFilesystemUnmounted);
+    }
     recordEventMetrics(EventDisposition::kProcessed);
     return;
   }
@@ -565,8 +720,9 @@ NS_ASSUME_NONNULL_BEGIN
   DADiskRef disk = DADiskCreateFromBSDName(NULL, self.diskArbSession, eventStatFS->f_mntfromname);
   CFAutorelease(disk);
 
-  NSDictionary* diskInfo = CFBridgingRelease(DADiskCopyDescription(disk));
-  if (![self shouldOperateOnDiskWithProperties:diskInfo]) {
+  BOOL shouldOperate = NO;
+  NSDictionary* diskInfo = [self descriptionForDisk:disk shouldOperate:&shouldOperate];
+  if (!shouldOperate) {
     return ES_AUTH_RESULT_ALLOW;
   }
 
@@ -629,7 +785,7 @@ NS_ASSUME_NONNULL_BEGIN
                 isEncrypted:isEncrypted];
   } else {
     // Block — log the mount denial.
-    NSMutableDictionary* props = [CFBridgingRelease(DADiskCopyDescription(disk)) mutableCopy];
+    NSMutableDictionary* props = [diskInfo mutableCopy];
     props[santa::kMountFromNameKey] = event.mntfromname;
     [self logDiskAppeared:[props copy] allowed:false];
     storedUSBMountEvent =
@@ -674,8 +830,9 @@ NS_ASSUME_NONNULL_BEGIN
     return NULL;
   }
 
-  NSDictionary* diskInfo = CFBridgingRelease(DADiskCopyDescription(disk));
-  if (![self shouldOperateOnDiskWithProperties:diskInfo]) {
+  BOOL shouldOperate = NO;
+  NSDictionary* diskInfo = [self descriptionForDisk:disk shouldOperate:&shouldOperate];
+  if (!shouldOperate) {
     return NULL;
   }
 
@@ -53,6 +53,7 @@ class MockAuthResultCache : public AuthResultCache {
   using AuthResultCache::AuthResultCache;
 
   MOCK_METHOD(void, FlushCache, (FlushCacheMode mode, FlushCacheReason reason));
+  MOCK_METHOD(uint64_t, FlushCacheForDevice, (dev_t fsid, FlushCacheReason reason));
 };
 
 @interface SNTEndpointSecurityClient (Testing)
@@ -70,6 +71,8 @@ class MockAuthResultCache : public AuthResultCache {
 - (DADissenterRef __nullable)handleEncryptedMountApproval:(DADiskRef)disk;
 - (void)handleEncryptedRemountCompletion:(DADiskRef)disk
                                dissenter:(DADissenterRef __nullable)dissenter;
+- (NSDictionary*)descriptionForDisk:(DADiskRef)disk shouldOperate:(BOOL*)shouldOperate;
+- (void)recordDiskDescription:(NSDictionary*)props forDisk:(DADiskRef)disk appeared:(BOOL)appeared;
 @property(nonatomic, readonly) dispatch_queue_t diskQueue;
 @property(nonatomic) NSMutableSet<NSString*>* remountingDisks;
 @end
@@ -408,6 +411,9 @@ class MockAuthResultCache : public AuthResultCache {
   es_file_t file = MakeESFile("foo");
   es_process_t proc = MakeESProcess(&file);
   es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_UNMOUNT, &proc);
+  struct statfs fs = {};
+  fs.f_fsid.val[0] = 1234;
+  esMsg.event.unmount.statfs = &fs;
 
   dispatch_semaphore_t semaMetrics = dispatch_semaphore_create(0);
 
@@ -415,8 +421,11 @@ class MockAuthResultCache : public AuthResultCache {
   mockESApi->SetExpectationsESNewClient();
   mockESApi->SetExpectationsRetainReleaseMessage();
 
+  // Only the unmounted device is flushed
   auto mockAuthCache = std::make_shared<MockAuthResultCache>(nullptr, nil);
-  EXPECT_CALL(*mockAuthCache, FlushCache);
+  EXPECT_CALL(*mockAuthCache, FlushCacheForDevice(1234, FlushCacheReason::kFilesystemUnmounted))
+      .WillOnce(testing::Return(0));
+  EXPECT_CALL(*mockAuthCache, FlushCache).Times(0);
 
   SNTEndpointSecurityDeviceManager* deviceManager = [[SNTEndpointSecurityDeviceManager alloc]
                             initWithESAPI:mockESApi
@@ -1323,4 +1332,88 @@ class MockAuthResultCache : public AuthResultCache {
   if (mockDissenter) CFRelease(mockDissenter);
 }
 
+#pragma mark - Disk Description Cache Tests
+
+- (void)testDiskDescriptionIsCachedUntilChanged {
+  SNTEndpointSecurityDeviceManager* dm = [self createDeviceManagerForApprovalTests];
+  MockDADisk* mockDisk = [self createMockDiskWithEncrypted:NO];
+  DADiskRef disk = (__bridge DADiskRef)mockDisk;
+
+  BOOL shouldOperate = NO;
+  NSDictionary* first = [dm descriptionForDisk:disk shouldOperate:&shouldOperate];
+  XCTAssertEqualObjects(first, mockDisk.diskDescription);
+  XCTAssertTrue(shouldOperate);
+
+  // Changes that DiskArbitration hasn't reported yet aren't seen
+  NSMutableDictionary* internal = [mockDisk.diskDescription mutableCopy];
+  internal[(__bridge NSString*)kDADiskDescriptionDeviceInternalKey] = @YES;
+  mockDisk.diskDescription = internal;
+
+  XCTAssertEqual([dm descriptionForDisk:disk shouldOperate:&shouldOperate], first);
+  XCTAssertTrue(shouldOperate);
+
+  dispatch_sync(dm.diskQueue, ^{
+    [dm recordDiskDescription:internal forDisk:disk appeared:NO];
+  });
+
+  XCTAssertEqualObjects([dm descriptionForDisk:disk shouldOperate:&shouldOperate], internal);
+  XCTAssertFalse(shouldOperate);
+}
+
+- (void)testDiskAppearedLogsAreCoalesced {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+  auto mockEnricher = std::make_shared<santa::MockEnricher>();
+
+  SNTEndpointSecurityDeviceManager* dm = [[SNTEndpointSecurityDeviceManager alloc]
+                            initWithESAPI:mockESApi
+                                  metrics:nullptr
+                                   logger:nullptr
+                                 enricher:mockEnricher
+                          authResultCache:nullptr
+                     removableMediaAction:SNTRemovableMediaActionAllow
+               removableMediaRemountFlags:nil
+            encryptedRemovableMediaAction:SNTRemovableMediaActionAllow
+      encryptedRemovableMediaRemountFlags:nil
+                       startupPreferences:SNTDeviceManagerStartupPreferencesNone];
+
+  __block XCTestExpectation* logExp = [self expectationWithDescription:@"Appearance logged"];
+  __block NSDictionary* loggedProps;
+  id partialDM = OCMPartialMock(dm);
+  OCMStub([partialDM logDiskAppeared:OCMOCK_ANY allowed:OCMOCK_ANY])
+      .ignoringNonObjectArgs()
+      .andDo(^(NSInvocation* invocation) {
+        __unsafe_unretained NSDictionary* props;
+        [invocation getArgument:&props atIndex:2];
+        loggedProps = props;
+        [logExp fulfill];
+      });
+
+  MockDADisk* mockDisk = [self createMockDiskWithEncrypted:NO];
+  DADiskRef disk = (__bridge DADiskRef)mockDisk;
+  NSDictionary* mounted = mockDisk.diskDescription;
+  NSMutableDictionary* unmounted = [mounted mutableCopy];
+  [unmounted removeObjectForKey:@"DAVolumePath"];
+
+  // The disk appears, is mounted, then has an unrelated key updated
+  dispatch_sync(dm.diskQueue, ^{
+    [dm recordDiskDescription:unmounted forDisk:disk appeared:YES];
+    [dm recordDiskDescription:mounted forDisk:disk appeared:NO];
+    [dm recordDiskDescription:mounted forDisk:disk appeared:NO];
+  });
+
+  [self waitForExpectations:@[ logExp ] timeout:5.0];
+  XCTAssertEqualObjects(loggedProps, mounted);
+
+  // Further changes that don't move the volume aren't logged again
+  logExp = [self expectationWithDescription:@"Appearance not logged again"];
+  logExp.inverted = YES;
+  dispatch_sync(dm.diskQueue, ^{
+    [dm recordDiskDescription:mounted forDisk:disk appeared:NO];
+  });
+  [self waitForExpectations:@[ logExp ] timeout:1.0];
+
+  [partialDM stopMocking];
+}
+
 @end
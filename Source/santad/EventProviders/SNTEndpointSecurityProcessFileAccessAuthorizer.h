@@ -29,10 +29,12 @@
                                  SNTEndpointSecurityProbe>
 
 - (instancetype)initWithESAPI:(std::shared_ptr<santa::EndpointSecurityAPI>)esApi
-                        metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
-             faaPolicyProcessor:
-                 (std::shared_ptr<santa::ProcessFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
-    iterateProcessPoliciesBlock:(santa::IterateProcessPoliciesBlock)findProcessPoliciesBlock;
+                          metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
+               faaPolicyProcessor:
+                   (std::shared_ptr<santa::ProcessFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
+      iterateProcessPoliciesBlock:(santa::IterateProcessPoliciesBlock)findProcessPoliciesBlock
+    iterateCandidatePoliciesBlock:
+        (santa::IterateCandidateProcessPoliciesBlock)iterateCandidatePoliciesBlock;
 
 @property SNTFileAccessDeniedBlock fileAccessDeniedBlock;
 
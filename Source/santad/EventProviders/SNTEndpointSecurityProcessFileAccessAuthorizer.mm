@@ -16,9 +16,14 @@
 #include <EndpointSecurity/ESTypes.h>
 #include "Source/santad/EventProviders/FAAPolicyProcessor.h"
 
+#include <Kernel/kern/cs_blobs.h>
 #include <bsm/libbsm.h>
 
 #include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
 
 #include "Source/common/AuditUtilities.h"
 #import "Source/common/SNTLogging.h"
@@ -26,8 +31,10 @@
 #include "Source/common/SantaSetCache.h"
 #import "Source/common/es/SNTEndpointSecurityEventHandler.h"
 #include "Source/common/faa/WatchItemPolicy.h"
+#include "Source/santad/EventProviders/FAAMuteAutopilot.h"
 
 using santa::FAAPolicyProcessor;
+using santa::IterateCandidateProcessPoliciesBlock;
 using santa::IterateProcessPoliciesBlock;
 using santa::Message;
 using santa::PidPidversion;
@@ -36,30 +43,49 @@ using santa::ProcessWatchItemPolicy;
 using PidPidverPair = std::pair<pid_t, int>;
 using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchItemPolicy>>;
 
+// Target paths allowed this many times within the window become candidates for
+// muting AUTH_OPEN events in the kernel.
+static constexpr size_t kMuteAutopilotMinAllowedCount = 16;
+static constexpr uint64_t kMuteAutopilotWindowNs = 60 * NSEC_PER_SEC;
+static constexpr size_t kMuteAutopilotMaxTrackedPaths = 4096;
+static constexpr size_t kMuteAutopilotMaxMutedPaths = 1024;
+
 @interface SNTEndpointSecurityProcessFileAccessAuthorizer ()
 @property bool isSubscribed;
 @property(copy) IterateProcessPoliciesBlock iterateProcessPoliciesBlock;
+@property(copy) IterateCandidateProcessPoliciesBlock iterateCandidatePoliciesBlock;
 @property SNTConfigurator* configurator;
 @end
 
 @implementation SNTEndpointSecurityProcessFileAccessAuthorizer {
   std::unique_ptr<ProcessRuleCache> _procRuleCache;
   std::shared_ptr<santa::ProcessFAAPolicyProcessorProxy> _faaPolicyProcessorProxy;
+  std::unique_ptr<santa::FAAMuteAutopilot> _muteAutopilot;
+  // Serializes muting candidate paths with unmuting everything on policy changes.
+  dispatch_queue_t _muteQueue;
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<santa::EndpointSecurityAPI>)esApi
-                        metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
-             faaPolicyProcessor:
-                 (std::shared_ptr<santa::ProcessFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
-    iterateProcessPoliciesBlock:(IterateProcessPoliciesBlock)iterateProcessPoliciesBlock {
+                          metrics:(std::shared_ptr<santa::ESMetricsObserver>)metrics
+               faaPolicyProcessor:
+                   (std::shared_ptr<santa::ProcessFAAPolicyProcessorProxy>)faaPolicyProcessorProxy
+      iterateProcessPoliciesBlock:(IterateProcessPoliciesBlock)iterateProcessPoliciesBlock
+    iterateCandidatePoliciesBlock:
+        (IterateCandidateProcessPoliciesBlock)iterateCandidatePoliciesBlock {
   self = [super initWithESAPI:std::move(esApi)
                       metrics:std::move(metrics)
                     processor:santa::Processor::kProcessFileAccessAuthorizer];
   if (self) {
     _faaPolicyProcessorProxy = std::move(faaPolicyProcessorProxy);
     _iterateProcessPoliciesBlock = iterateProcessPoliciesBlock;
+    _iterateCandidatePoliciesBlock = iterateCandidatePoliciesBlock;
 
     _procRuleCache = std::make_unique<ProcessRuleCache>(2000);
+    _muteAutopilot = std::make_unique<santa::FAAMuteAutopilot>(
+        kMuteAutopilotMinAllowedCount, kMuteAutopilotWindowNs, kMuteAutopilotMaxTrackedPaths,
+        kMuteAutopilotMaxMutedPaths);
+    _muteQueue = dispatch_queue_create("com.northpolesec.santa.daemon.proc_faa_mute_queue",
+                                       DISPATCH_QUEUE_SERIAL);
     _configurator = [SNTConfigurator configurator];
 
     [self establishClientOrDie];
@@ -105,6 +131,60 @@ using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchI
       self.fileAccessDeniedBlock, overrideAction);
 
   [self respondToMessage:msg withAuthResult:result.auth_result cacheable:result.cacheable];
+
+  [self updateMuteAutopilot:msg result:result];
+}
+
+// Target path muting isn't inverted for this client, so paths that every
+// watched process is always allowed to open can be muted to stop the kernel
+// from delivering their events at all.
+- (void)updateMuteAutopilot:(const Message&)msg result:(FAAPolicyProcessor::ESResult)result {
+  // Processes with invalid signatures are denied regardless of the path.
+  if (msg->event_type != ES_EVENT_TYPE_AUTH_OPEN ||
+      [self.configurator enableBadSignatureProtection]) {
+    return;
+  }
+
+  const Message::PathTarget& target = msg.PathTargetAtIndex(0);
+  if (target.truncated || !std::holds_alternative<std::string_view>(target.path)) {
+    return;
+  }
+
+  // Only explicitly allowed decisions are cacheable
+  if (result.auth_result != ES_AUTH_RESULT_ALLOW || !result.cacheable) {
+    _muteAutopilot->RecordNotAllowed(target.Path());
+    return;
+  }
+
+  if (!_muteAutopilot->RecordAllowed(target.Path(), msg->mach_time)) {
+    return;
+  }
+
+  std::string path(target.Path());
+  dispatch_async(_muteQueue, ^{
+    if ([self isPathAllowedByAllPolicies:path] && _muteAutopilot->ReserveMute(path)) {
+      LOGD(@"Proc FAA muting AUTH_OPEN for allowed path: %s", path.c_str());
+      santa::SetPairPathAndType paths;
+      paths.emplace(path, santa::WatchItemPathType::kLiteral);
+      [self muteTargetPaths:paths forEvents:{ES_EVENT_TYPE_AUTH_OPEN}];
+    }
+  });
+}
+
+// Returns true if no process policy could deny or audit access to the path.
+- (bool)isPathAllowedByAllPolicies:(const std::string&)path {
+  __block bool allowed = true;
+  self.iterateProcessPoliciesBlock(^bool(std::shared_ptr<ProcessWatchItemPolicy> policy) {
+    bool listed = policy->tree->Contains(path.c_str());
+    if (listed != (policy->rule_type == santa::WatchItemRuleType::kProcessesWithAllowedPaths)) {
+      allowed = false;
+      return true;
+    }
+
+    return false;
+  });
+
+  return allowed;
 }
 
 - (void)handleMessage:(Message&&)esMsg
@@ -187,8 +267,25 @@ using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchI
 }
 
 - (std::shared_ptr<ProcessWatchItemPolicy>)findPolicyForProcess:(const es_process_t*)esProc {
+  bool isSigned = esProc->codesigning_flags & CS_SIGNED;
+  santa::ProcessPolicyLookupKeys keys = {
+      .binary_path = std::string_view(esProc->executable->path.data,
+                                      esProc->executable->path.length),
+      .signing_id = esProc->signing_id.data
+                        ? std::string_view(esProc->signing_id.data, esProc->signing_id.length)
+                        : std::string_view(),
+      .team_id = esProc->team_id.data
+                     ? std::string_view(esProc->team_id.data, esProc->team_id.length)
+                     : std::string_view(),
+      .cdhash = isSigned ? std::string_view(reinterpret_cast<const char*>(esProc->cdhash),
+                                            CS_CDHASH_LEN)
+                         : std::string_view(),
+      .is_signed = isSigned,
+      .is_platform_binary = esProc->is_platform_binary,
+  };
+
   __block std::shared_ptr<ProcessWatchItemPolicy> foundPolicy;
-  self.iterateProcessPoliciesBlock(^bool(std::shared_ptr<ProcessWatchItemPolicy> policy) {
+  self.iterateCandidatePoliciesBlock(keys, ^bool(std::shared_ptr<ProcessWatchItemPolicy> policy) {
     for (const santa::WatchItemProcess& policyProcess : policy->processes) {
       if ((*_faaPolicyProcessorProxy)->PolicyMatchesProcess(policyProcess, esProc)) {
         // Map the new process to the matched policy and begin
@@ -285,6 +382,27 @@ using ProcessRuleCache = SantaCache<PidPidverPair, std::shared_ptr<ProcessWatchI
 }
 
 - (void)processWatchItemsCount:(size_t)count {
+  // Policies changed, so previously muted paths might now be covered by them.
+  // Only those are unmuted, the rest keep their events suppressed.
+  dispatch_sync(_muteQueue, ^{
+    std::vector<std::string> stale;
+    for (std::string& path : _muteAutopilot->ResetObservations()) {
+      if (![self isPathAllowedByAllPolicies:path]) {
+        stale.push_back(std::move(path));
+      }
+    }
+
+    if (!stale.empty()) {
+      LOGD(@"Proc FAA unmuting %zu paths no longer allowed by all policies", stale.size());
+      santa::SetPairPathAndType paths;
+      for (const std::string& path : stale) {
+        paths.emplace(path, santa::WatchItemPathType::kLiteral);
+      }
+      [self unmuteTargetPaths:paths];
+      _muteAutopilot->ForgetMuted(stale);
+    }
+  });
+
   if (count > 0) {
     [self enable];
   } else {
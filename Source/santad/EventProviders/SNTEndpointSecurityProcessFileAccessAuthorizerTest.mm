@@ -30,6 +30,7 @@
 #include "Source/santad/EventProviders/MockFAAPolicyProcessor.h"
 
 using santa::CheckPolicyBlock;
+using santa::IterateCandidateProcessPoliciesBlock;
 using santa::IterateProcessPoliciesBlock;
 using santa::MockFAAPolicyProcessor;
 using santa::PairPathAndType;
@@ -78,9 +79,10 @@ void SetExpectationsForProcessFileAccessAuthorizerInit(
 
   SNTEndpointSecurityProcessFileAccessAuthorizer* procFAAClient =
       [[SNTEndpointSecurityProcessFileAccessAuthorizer alloc] initWithESAPI:mockESApi
-                                                                    metrics:nullptr
-                                                         faaPolicyProcessor:mockFAAProxy
-                                                iterateProcessPoliciesBlock:nil];
+                                                                      metrics:nullptr
+                                                           faaPolicyProcessor:mockFAAProxy
+                                                  iterateProcessPoliciesBlock:nil
+                                                iterateCandidatePoliciesBlock:nil];
 
   [procFAAClient enable];
 
@@ -124,12 +126,17 @@ void SetExpectationsForProcessFileAccessAuthorizerInit(
   IterateProcessPoliciesBlock iterPoliciesBlock = ^(CheckPolicyBlock block) {
     checkPolicyBlockResult = block(pwip);
   };
+  IterateCandidateProcessPoliciesBlock iterCandidatesBlock =
+      ^(const santa::ProcessPolicyLookupKeys& keys, CheckPolicyBlock block) {
+        checkPolicyBlockResult = block(pwip);
+      };
 
   SNTEndpointSecurityProcessFileAccessAuthorizer* procFAAClient =
       [[SNTEndpointSecurityProcessFileAccessAuthorizer alloc] initWithESAPI:mockESApi
-                                                                    metrics:nullptr
-                                                         faaPolicyProcessor:mockFAAProxy
-                                                iterateProcessPoliciesBlock:iterPoliciesBlock];
+                                                                      metrics:nullptr
+                                                           faaPolicyProcessor:mockFAAProxy
+                                                  iterateProcessPoliciesBlock:iterPoliciesBlock
+                                                iterateCandidatePoliciesBlock:iterCandidatesBlock];
 
   // Fake being conected so the probe runs
   procFAAClient.isSubscribed = true;
@@ -43,4 +43,12 @@
                   processTree:
                       (std::shared_ptr<santa::santad::process_tree::ProcessTree>)processTree;
 
+/// Path prefixes whose file change events are never logged: a fixed set of system paths followed
+/// by the configured FileChangesPrefixFilters.
++ (NSArray<NSString*>*)fileChangesPrefixFilters;
+
+/// Recompile the event filter from the current Telemetry and FileChangesRegex config, and update
+/// the ES subscription so that events which would only be dropped are no longer delivered.
+- (void)updateEventFilter;
+
 @end
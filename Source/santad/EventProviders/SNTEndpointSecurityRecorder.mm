@@ -20,6 +20,13 @@
 
 #include <EndpointSecurity/EndpointSecurity.h>
 
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "Source/common/PathRegex.h"
 #include "Source/common/Platform.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
@@ -28,9 +35,12 @@
 #include "Source/common/es/ESMetricsObserver.h"
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
+#include "Source/common/faa/WatchItemPolicy.h"
 #include "Source/common/processtree/process_tree.h"
 #include "Source/santad/EventProviders/AuthResultCache.h"
+#include "Source/santad/EventProviders/RecorderEventFilter.h"
 #import "Source/santad/SNTDecisionCache.h"
+#include "absl/synchronization/mutex.h"
 
 using santa::AuthResultCache;
 using santa::EndpointSecurityAPI;
@@ -39,8 +49,12 @@ using santa::Enricher;
 using santa::EventDisposition;
 using santa::Logger;
 using santa::Message;
+using santa::PathRegex;
 using santa::PrefixTree;
+using santa::RecorderEventFilter;
+using santa::TelemetryEvent;
 using santa::Unit;
+using santa::WatchItemPathType;
 using santa::santad::process_tree::ProcessTree;
 
 es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
@@ -67,6 +81,20 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
   std::shared_ptr<Enricher> _enricher;
   std::shared_ptr<Logger> _logger;
   std::shared_ptr<PrefixTree<Unit>> _prefixTree;
+
+  // FileChangesRegex compiled for matching paths in place, and the config value it was compiled
+  // from. The matcher is null if the regex couldn't be compiled with RE2.
+  absl::Mutex _fileChangesMatcherMutex;
+  NSRegularExpression* _fileChangesMatcherSource;
+  std::shared_ptr<PathRegex> _fileChangesMatcher;
+
+  RecorderEventFilter _eventFilter;
+
+  // Every event type the Recorder handles, and the subset of those currently subscribed to
+  // because the event filter doesn't drop them.
+  absl::Mutex _subscriptionMutex;
+  std::set<es_event_type_t> _allEvents;
+  std::set<es_event_type_t> _subscribedEvents;
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
@@ -100,8 +128,38 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
   return @"Recorder";
 }
 
++ (NSArray<NSString*>*)fileChangesPrefixFilters {
+  return [@[ @"/.", @"/dev/" ]
+      arrayByAddingObjectsFromArray:[[SNTConfigurator configurator] fileChangesPrefixFilters]];
+}
+
+// Returns the compiled form of the given FileChangesRegex, compiling it the first time a config
+// value is seen.
+- (std::shared_ptr<PathRegex>)fileChangesMatcherForRegex:(NSRegularExpression*)regex {
+  {
+    absl::ReaderMutexLock lock(&_fileChangesMatcherMutex);
+    if (_fileChangesMatcherSource == regex) {
+      return _fileChangesMatcher;
+    }
+  }
+
+  absl::MutexLock lock(&_fileChangesMatcherMutex);
+  if (_fileChangesMatcherSource != regex) {
+    _fileChangesMatcher = PathRegex::Create(regex);
+    _fileChangesMatcherSource = regex;
+  }
+  return _fileChangesMatcher;
+}
+
 - (void)handleMessage:(Message&&)esMsg
     recordEventMetrics:(void (^)(EventDisposition))recordEventMetrics {
+  RecorderEventFilter::Action action = _eventFilter.ActionForEvent(esMsg->event_type);
+  if (action == RecorderEventFilter::Action::kDrop) {
+    // Only seen until the unsubscribe from an event type that is no longer logged takes effect.
+    recordEventMetrics(EventDisposition::kDropped);
+    return;
+  }
+
   // Pre-enrichment processing
   switch (esMsg->event_type) {
     case ES_EVENT_TYPE_NOTIFY_CLOSE: {
@@ -119,6 +177,32 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
 
       self->_authResultCache->RemoveFromCache(esMsg->event.close.target);
 
+      if (esMsg->event.close.modified && self.configurator.enablePrehashing) {
+        [[SNTDecisionCache sharedCache]
+            prehashFileAsync:santa::StringTokenToStringView(esMsg->event.close.target->path)
+                        stat:esMsg->event.close.target->stat];
+      }
+
+      break;
+    }
+
+    case ES_EVENT_TYPE_NOTIFY_RENAME: {
+      // Binaries are commonly written to a temporary file and then moved into
+      // place, so hash them under their final path.
+      if (self.configurator.enablePrehashing) {
+        const es_event_rename_t& rename = esMsg->event.rename;
+        if (rename.destination_type == ES_DESTINATION_TYPE_EXISTING_FILE) {
+          std::string_view path =
+              santa::StringTokenToStringView(rename.destination.existing_file->path);
+          [[SNTDecisionCache sharedCache] prehashFileAsync:path stat:rename.source->stat];
+        } else {
+          std::string path(santa::StringTokenToStringView(rename.destination.new_path.dir->path));
+          path.append("/");
+          path.append(santa::StringTokenToStringView(rename.destination.new_path.filename));
+          [[SNTDecisionCache sharedCache] prehashFileAsync:path stat:rename.source->stat];
+        }
+      }
+
       break;
     }
 
@@ -145,7 +229,14 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
 
   // The logger will take care of this, but we check early so we
   // don't do any unnecessary work
-  if (!_logger->ShouldLog(santa::ESEventToTelemetryEvent(esMsg->event_type))) {
+  if (action == RecorderEventFilter::Action::kInternalOnly ||
+      !_logger->ShouldLog(santa::ESEventToTelemetryEvent(esMsg->event_type))) {
+    if (esMsg->event_type == ES_EVENT_TYPE_NOTIFY_EXEC) {
+      // The exec won't be logged, so nothing else will consume its decision.
+      const es_process_t* target = esMsg->event.exec.target;
+      [[SNTDecisionCache sharedCache] takeDecisionForExecOfProcess:target->audit_token
+                                                              file:target->executable->stat];
+    }
     recordEventMetrics(EventDisposition::kDropped);
     return;
   }
@@ -153,8 +244,10 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
   // For NOTIFY_EXEC with holdAndAsk pending, skip logging here.
   // The event will be logged after TouchID authentication completes.
   if (esMsg->event_type == ES_EVENT_TYPE_NOTIFY_EXEC) {
-    SNTCachedDecision* cd = [[SNTDecisionCache sharedCache]
-        cachedDecisionForFile:esMsg->event.exec.target->executable->stat];
+    const es_process_t* target = esMsg->event.exec.target;
+    SNTCachedDecision* cd =
+        [[SNTDecisionCache sharedCache] decisionForExecOfProcess:target->audit_token
+                                                            file:target->executable->stat];
     if (cd && cd.holdAndAsk) {
       return;
     }
@@ -181,23 +274,36 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
       if (!fileChangesRegex) {
         // Note: Do not record metrics in this case. These are not considered "drops"
         // because this is not a failure case.
-        // TODO(mlw): Consider changes to configuration that would allow muting paths
-        // to filter on the kernel side rather than in user space.
-        return;
-      }
-      NSString* targetPath = santa::StringTokenToNSString(targetFile->path);
-      if ([fileChangesRegex rangeOfFirstMatchInString:targetPath
-                                              options:0
-                                                range:NSMakeRange(0, targetPath.length)]
-              .location == NSNotFound) {
         return;
       }
 
+      // The prefix tree lookup works on the raw path, so check it before paying
+      // for the regex match.
       if (self->_prefixTree->HasPrefix(targetFile->path.data)) {
         recordEventMetrics(EventDisposition::kDropped);
         return;
       }
 
+      if (std::shared_ptr<PathRegex> matcher = [self fileChangesMatcherForRegex:fileChangesRegex]) {
+        if (!matcher->Matches(santa::StringTokenToStringView(targetFile->path))) {
+          return;
+        }
+      } else {
+        // The string is only used for the match, so have it borrow the path
+        // bytes from the message rather than copy them.
+        NSString* targetPath = [[NSString alloc] initWithBytesNoCopy:(void*)targetFile->path.data
+                                                              length:targetFile->path.length
+                                                            encoding:NSUTF8StringEncoding
+                                                        freeWhenDone:NO];
+        if (!targetPath ||
+            [fileChangesRegex rangeOfFirstMatchInString:targetPath
+                                                options:0
+                                                  range:NSMakeRange(0, targetPath.length)]
+                    .location == NSNotFound) {
+          return;
+        }
+      }
+
       break;
     }
 
@@ -205,7 +311,9 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
   }
 
   // Enrich the message inline with the ES handler block to capture enrichment
-  // data as close to the source event as possible.
+  // data as close to the source event as possible. Only the data that may
+  // change is captured here, user and group names are resolved when the
+  // message is serialized.
   std::unique_ptr<EnrichedMessage> enrichedMessage = _enricher->Enrich(std::move(esMsg));
 
   if (!enrichedMessage) {
@@ -266,7 +374,63 @@ es_file_t* GetTargetFileForPrefixTree(const es_message_t* msg) {
 #endif  // HAVE_MACOS_15_4
   // clang-format on
 
-  [super subscribe:events];
+  {
+    absl::MutexLock lock(&_subscriptionMutex);
+    _allEvents = std::move(events);
+    _subscribedEvents = [self compileEventFilter];
+    [super subscribe:_subscribedEvents];
+  }
+
+  // Events for paths under the ignored prefixes are dropped after the prefix tree lookup, so have
+  // ES drop them instead. This is limited to event types that are only ever logged, since the rest
+  // are still needed for cache invalidation and compiler tracking. ES only mutes an event if all
+  // of its target paths are muted, so events that could still be logged are delivered.
+  if (_prefixTree) {
+    santa::SetPairPathAndType prefixes;
+    for (NSString* filter in [SNTEndpointSecurityRecorder fileChangesPrefixFilters]) {
+      prefixes.insert({filter.fileSystemRepresentation, WatchItemPathType::kPrefix});
+    }
+    if (![self muteTargetPaths:prefixes
+                     forEvents:{ES_EVENT_TYPE_NOTIFY_COPYFILE, ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA,
+                                ES_EVENT_TYPE_NOTIFY_LINK, ES_EVENT_TYPE_NOTIFY_UNLINK}]) {
+      LOGW(@"Failed to mute ignored file change prefixes");
+    }
+  }
+}
+
+// Returns the event types that must remain subscribed with the current config. The caller must
+// hold _subscriptionMutex.
+- (std::set<es_event_type_t>)compileEventFilter {
+  TelemetryEvent mask = _logger ? _logger->TelemetryMask() : TelemetryEvent::kEverything;
+  bool fileChangesRegexSet = [[SNTConfigurator configurator] fileChangesRegex] != nil;
+  return _eventFilter.Compile(_allEvents, mask, fileChangesRegexSet);
+}
+
+- (void)updateEventFilter {
+  absl::MutexLock lock(&_subscriptionMutex);
+  if (_allEvents.empty()) {
+    // Not enabled yet, the filter is compiled when the client is enabled.
+    return;
+  }
+
+  std::set<es_event_type_t> wanted = [self compileEventFilter];
+
+  std::set<es_event_type_t> removed;
+  std::set_difference(_subscribedEvents.begin(), _subscribedEvents.end(), wanted.begin(),
+                      wanted.end(), std::inserter(removed, removed.end()));
+  bool added = !std::includes(_subscribedEvents.begin(), _subscribedEvents.end(), wanted.begin(),
+                              wanted.end());
+
+  // Subscribing to the whole set keeps the process lifecycle events subscribed as the Recorder's
+  // own, rather than as events added by the tree aware client that it would then filter out.
+  if (added && ![super subscribe:wanted]) {
+    LOGE(@"Recorder failed to subscribe to newly logged events");
+  }
+  if (!removed.empty() && ![self unsubscribe:removed]) {
+    LOGE(@"Recorder failed to unsubscribe from events that are no longer logged");
+  }
+
+  _subscribedEvents = std::move(wanted);
 }
 
 @end
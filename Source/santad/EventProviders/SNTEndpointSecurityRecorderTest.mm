@@ -449,6 +449,28 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
 
   [self handleMessageShouldLog:NO shouldRemoveFromCache:NO withBlock:testBlock];
 
+  // UNLINK, Prefix match is checked before fileChangesRegex, bail early
+  testBlock =
+      ^(es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
+        SNTEndpointSecurityRecorder* recorderClient, std::shared_ptr<PrefixTree<Unit>> prefixTree,
+        __autoreleasing dispatch_semaphore_t* sema,
+        __autoreleasing dispatch_semaphore_t* semaMetrics) {
+        esMsg->event_type = ES_EVENT_TYPE_NOTIFY_UNLINK;
+        esMsg->event.unlink.target = &targetFileMissesRegex;
+        prefixTree->InsertPrefix(esMsg->event.unlink.target->path.data, Unit{});
+        Message msg(mockESApi, esMsg);
+        OCMExpect([mockCC handleEvent:msg withLogger:nullptr]).ignoringNonObjectArgs();
+        XCTAssertNoThrow([recorderClient handleMessage:Message(mockESApi, esMsg)
+                                    recordEventMetrics:^(EventDisposition d) {
+                                      XCTAssertEqual(d, EventDisposition::kDropped);
+                                      dispatch_semaphore_signal(*semaMetrics);
+                                    }]);
+
+        XCTAssertSemaTrue(*semaMetrics, 5, "Metrics not recorded within expected window");
+      };
+
+  [self handleMessageShouldLog:NO shouldRemoveFromCache:NO withBlock:testBlock];
+
   // LINK, Prefix match, bail early
   testBlock = ^(
       es_message_t* esMsg, std::shared_ptr<MockEndpointSecurityAPI> mockESApi, id mockCC,
@@ -527,6 +549,57 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   XCTAssertTrue(OCMVerifyAll(self.mockConfigurator));
 }
 
+- (void)testUpdateEventFilterFollowsTelemetry {
+  std::set<es_event_type_t> allEvents = [self expectedSubscriptions];
+  std::set<es_event_type_t> internalEvents{
+      ES_EVENT_TYPE_NOTIFY_CLONE,           ES_EVENT_TYPE_NOTIFY_CLOSE,
+      ES_EVENT_TYPE_NOTIFY_RENAME,          ES_EVENT_TYPE_NOTIFY_EXEC,
+      ES_EVENT_TYPE_NOTIFY_FORK,            ES_EVENT_TYPE_NOTIFY_EXIT,
+      ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOCK, ES_EVENT_TYPE_NOTIFY_LW_SESSION_LOGOUT,
+  };
+  std::set<es_event_type_t> notLogged;
+  for (es_event_type_t event : allEvents) {
+    if (internalEvents.count(event) == 0) {
+      notLogged.insert(event);
+    }
+  }
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsESNewClient();
+  EXPECT_CALL(*mockESApi, MuteTargetPathEvents).WillRepeatedly(testing::Return(true));
+
+  auto mockLogger = std::make_shared<MockLogger>();
+
+  SNTEndpointSecurityRecorder* recorderClient =
+      [[SNTEndpointSecurityRecorder alloc] initWithESAPI:mockESApi
+                                                 metrics:nullptr
+                                                  logger:mockLogger
+                                                enricher:nullptr
+                                      compilerController:nil
+                               loginWindowSessionHandler:nil
+                                         authResultCache:nullptr
+                                              prefixTree:std::make_shared<PrefixTree<Unit>>()
+                                             processTree:nullptr];
+
+  EXPECT_CALL(*mockESApi, Subscribe(testing::_, allEvents)).WillOnce(testing::Return(true));
+  [recorderClient enable];
+
+  // Only the events needed internally remain subscribed once nothing they
+  // could be logged as is enabled.
+  mockLogger->SetTelemetryMask(TelemetryEvent::kNone);
+  EXPECT_CALL(*mockESApi, Unsubscribe(testing::_, notLogged)).WillOnce(testing::Return(true));
+  [recorderClient updateEventFilter];
+
+  // Nothing changes if the config didn't
+  [recorderClient updateEventFilter];
+
+  mockLogger->SetTelemetryMask(TelemetryEvent::kEverything);
+  EXPECT_CALL(*mockESApi, Subscribe(testing::_, allEvents)).WillOnce(testing::Return(true));
+  [recorderClient updateEventFilter];
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+}
+
 - (void)testGetTargetFileForPrefixTree {
   // Ensure `GetTargetFileForPrefixTree` returns expected field for each
   // subscribed event type in the `SNTEndpointSecurityRecorder`.
@@ -608,7 +681,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   OCMStub([mockDecisionCache sharedCache]).andReturn(mockDecisionCache);
   SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
   cd.holdAndAsk = YES;
-  OCMStub([mockDecisionCache cachedDecisionForFile:esMsg.event.exec.target->executable->stat])
+  OCMStub([mockDecisionCache decisionForExecOfProcess:esMsg.event.exec.target->audit_token
+                                                  file:esMsg.event.exec.target->executable->stat])
       .ignoringNonObjectArgs()
       .andReturn(cd);
 
@@ -682,7 +756,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   OCMStub([mockDecisionCache sharedCache]).andReturn(mockDecisionCache);
   SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
   cd.holdAndAsk = NO;
-  OCMStub([mockDecisionCache cachedDecisionForFile:esMsg.event.exec.target->executable->stat])
+  OCMStub([mockDecisionCache decisionForExecOfProcess:esMsg.event.exec.target->audit_token
+                                                  file:esMsg.event.exec.target->executable->stat])
       .ignoringNonObjectArgs()
       .andReturn(cd);
 
@@ -755,7 +830,8 @@ es_file_t targetFileMissesRegex = MakeESFile("/foo/misses");
   // Mock decision cache to return nil
   id mockDecisionCache = OCMClassMock([SNTDecisionCache class]);
   OCMStub([mockDecisionCache sharedCache]).andReturn(mockDecisionCache);
-  OCMStub([mockDecisionCache cachedDecisionForFile:esMsg.event.exec.target->executable->stat])
+  OCMStub([mockDecisionCache decisionForExecOfProcess:esMsg.event.exec.target->audit_token
+                                                  file:esMsg.event.exec.target->executable->stat])
       .ignoringNonObjectArgs()
       .andReturn(nil);
 
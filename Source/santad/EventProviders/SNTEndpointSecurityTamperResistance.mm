@@ -24,11 +24,15 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <string_view>
 #include <tuple>
 #include <unordered_set>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
-#include "absl/synchronization/mutex.h"
 
 #import "Source/common/Platform.h"
 #import "Source/common/SNTConfigurator.h"
@@ -69,6 +73,8 @@ struct TamperAuthResult {
 // modify these file paths.
 constexpr std::pair<std::string_view, WatchItemPathType> kProtectedFiles[] = {
     {"/private/var/db/santa/rules.db", WatchItemPathType::kLiteral},
+    {"/private/var/db/santa/rules.db-wal", WatchItemPathType::kLiteral},
+    {"/private/var/db/santa/rules.db-shm", WatchItemPathType::kLiteral},
     {"/private/var/db/santa/events.db", WatchItemPathType::kLiteral},
     {"/private/var/db/santa/sleigh_state.db", WatchItemPathType::kLiteral},
     {"/private/var/db/santa/sync-state.plist", WatchItemPathType::kLiteral},
@@ -79,6 +85,47 @@ constexpr std::pair<std::string_view, WatchItemPathType> kProtectedFiles[] = {
     {"/private/var/db/santa/staging", WatchItemPathType::kPrefix},
 };
 
+namespace {
+// kProtectedFiles compiled once for matching event targets against. Literal
+// paths are hashed, and paths shorter than every protected path are rejected
+// without comparing them to any.
+class ProtectedPathTable {
+ public:
+  static const ProtectedPathTable& Shared() {
+    static const ProtectedPathTable* table = new ProtectedPathTable();
+    return *table;
+  }
+
+  bool IsProtected(std::string_view path) const {
+    if (path.size() < min_length_) {
+      return false;
+    }
+    if (literals_.contains(path)) {
+      return true;
+    }
+    return std::any_of(prefixes_.begin(), prefixes_.end(),
+                       [path](std::string_view prefix) { return path.starts_with(prefix); });
+  }
+
+  bool IsLiteralProtected(std::string_view path) const { return literals_.contains(path); }
+
+ private:
+  ProtectedPathTable() {
+    for (const auto& [path, type] : kProtectedFiles) {
+      switch (type) {
+        case WatchItemPathType::kLiteral: literals_.insert(path); break;
+        case WatchItemPathType::kPrefix: prefixes_.push_back(path); break;
+      }
+      min_length_ = std::min(min_length_, path.size());
+    }
+  }
+
+  absl::flat_hash_set<std::string_view> literals_;
+  std::vector<std::string_view> prefixes_;
+  size_t min_length_ = std::numeric_limits<size_t>::max();
+};
+}  // namespace
+
 #if HAVE_MACOS_15_5
 // Platform-binary signing-IDs that Santa trusts to ask launchd to deliver
 // a signal to santad. Extended at runtime via the `AllowDelegatedSignals`
@@ -138,8 +185,8 @@ static NSString* TamperEventName(es_event_type_t type) {
 /// response can be cached; otherwise the response should not be cached because per-invocation
 /// argument inspection drives the outcome.
 TamperAuthResult ValidateLaunchctlExec(const Message& esMsg) {
-  es_string_token_t exec_path = esMsg->event.exec.target->executable->path;
-  if (strncmp(exec_path.data, "/bin/launchctl", exec_path.length) != 0) {
+  if (santa::StringTokenToStringView(esMsg->event.exec.target->executable->path) !=
+      "/bin/launchctl") {
     return TamperAuthResult::AllowCacheable();
   }
 
@@ -186,8 +233,9 @@ TamperAuthResult ValidateLaunchctlExec(const Message& esMsg) {
 
 @implementation SNTEndpointSecurityTamperResistance {
   std::shared_ptr<Logger> _logger;
-  absl::Mutex _antiSuspendMutex;
-  absl::flat_hash_set<std::string> _antiSuspendSigningIDs ABSL_GUARDED_BY(_antiSuspendMutex);
+  // Replaced whole when the configured signing IDs change, so the ES handler
+  // reads it without taking a lock.
+  std::shared_ptr<const absl::flat_hash_set<std::string>> _antiSuspendSigningIDs;
 }
 
 - (instancetype)initWithESAPI:(std::shared_ptr<EndpointSecurityAPI>)esApi
@@ -209,22 +257,22 @@ TamperAuthResult ValidateLaunchctlExec(const Message& esMsg) {
 }
 
 - (void)setAntiSuspendSigningIDs:(NSArray<NSString*>*)antiSuspendSigningIDs {
-  {
-    absl::WriterMutexLock lock(_antiSuspendMutex);
-    _antiSuspendSigningIDs.clear();
-    for (NSString* signingID in antiSuspendSigningIDs) {
-      _antiSuspendSigningIDs.insert(santa::NSStringToUTF8String(signingID));
-    }
+  auto signingIDs = std::make_shared<absl::flat_hash_set<std::string>>();
+  for (NSString* signingID in antiSuspendSigningIDs) {
+    signingIDs->insert(santa::NSStringToUTF8String(signingID));
   }
+  std::atomic_store_explicit(&_antiSuspendSigningIDs,
+                             std::shared_ptr<const absl::flat_hash_set<std::string>>(
+                                 std::move(signingIDs)),
+                             std::memory_order_release);
   [self muteAllProcessesForSuspendResumeIfNeeded];
 }
 
 - (void)muteAllProcessesForSuspendResumeIfNeeded {
   if (!self.enabled) return;
 
-  {
-    absl::ReaderMutexLock lock(_antiSuspendMutex);
-    if (_antiSuspendSigningIDs.empty()) return;
+  if (std::atomic_load_explicit(&_antiSuspendSigningIDs, std::memory_order_acquire)->empty()) {
+    return;
   }
 
   SetPairPathAndType allProcesses = {{"/", WatchItemPathType::kPrefix}};
@@ -311,21 +359,20 @@ TamperAuthResult ValidateLaunchctlExec(const Message& esMsg) {
                              esMsg->process->executable->path.data]);
       }
 
-      {
-        absl::ReaderMutexLock lock(_antiSuspendMutex);
-        if (!_antiSuspendSigningIDs.empty()) {
-          NSString* targetSigningID = FormatSigningID(
-              santa::StringTokenToNSString(target->signing_id),
-              santa::StringTokenToNSString(target->team_id), target->is_platform_binary);
-          if (targetSigningID &&
-              _antiSuspendSigningIDs.contains(santa::NSStringToUTF8String(targetSigningID))) {
-            return TamperAuthResult::Deny([NSString
-                stringWithFormat:@"Preventing attempt to suspend/resume %@ (type: %d. from "
-                                 @"PID %d, %s)",
-                                 targetSigningID, esMsg->event.proc_suspend_resume.type,
-                                 audit_token_to_pid(esMsg->process->audit_token),
-                                 esMsg->process->executable->path.data]);
-          }
+      std::shared_ptr<const absl::flat_hash_set<std::string>> antiSuspendSigningIDs =
+          std::atomic_load_explicit(&_antiSuspendSigningIDs, std::memory_order_acquire);
+      if (!antiSuspendSigningIDs->empty()) {
+        NSString* targetSigningID = FormatSigningID(
+            santa::StringTokenToNSString(target->signing_id),
+            santa::StringTokenToNSString(target->team_id), target->is_platform_binary);
+        if (targetSigningID &&
+            antiSuspendSigningIDs->contains(santa::NSStringToUTF8String(targetSigningID))) {
+          return TamperAuthResult::Deny([NSString
+              stringWithFormat:@"Preventing attempt to suspend/resume %@ (type: %d. from "
+                               @"PID %d, %s)",
+                               targetSigningID, esMsg->event.proc_suspend_resume.type,
+                               audit_token_to_pid(esMsg->process->audit_token),
+                               esMsg->process->executable->path.data]);
         }
       }
       return TamperAuthResult::AllowCacheable();
@@ -442,26 +489,11 @@ TamperAuthResult ValidateLaunchctlExec(const Message& esMsg) {
   // now they live as NSStrings. We should make them `std::string_view` types
   // in order to use them here efficiently, but will need to make the
   // `SNTDatabaseController` an ObjC++ file.
-  for (size_t i = 0; i < sizeof(kProtectedFiles) / sizeof(kProtectedFiles[0]); ++i) {
-    auto pf = kProtectedFiles[i];
-    switch (pf.second) {
-      case WatchItemPathType::kLiteral:
-        if (path == pf.first) return true;
-        break;
-      case WatchItemPathType::kPrefix:
-        if (path.rfind(pf.first, 0) == 0) return true;
-        break;
-    }
-  }
-  return false;
+  return ProtectedPathTable::Shared().IsProtected(path);
 }
 
 + (bool)isLiteralProtectedPath:(const std::string_view)path {
-  for (size_t i = 0; i < sizeof(kProtectedFiles) / sizeof(kProtectedFiles[0]); ++i) {
-    auto pf = kProtectedFiles[i];
-    if (pf.second == WatchItemPathType::kLiteral && path == pf.first) return true;
-  }
-  return false;
+  return ProtectedPathTable::Shared().IsLiteralProtected(path);
 }
 
 // Returns true when `path` in the context of `esMsg` should be denied as a tamper attempt.
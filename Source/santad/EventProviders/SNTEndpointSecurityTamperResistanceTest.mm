@@ -1096,6 +1096,19 @@ static constexpr std::string_view kBenignPath = "/some/other/path";
   XCTAssertTrue([SNTEndpointSecurityTamperResistance
       isProtectedPath:"/Library/LaunchDaemons/com.northpolesec.santa.syncservice.plist"]);
   XCTAssertFalse([SNTEndpointSecurityTamperResistance isProtectedPath:"/not/a/db/path"]);
+
+  // The rules database journals to files alongside it
+  XCTAssertTrue(
+      [SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa/rules.db-wal"]);
+  XCTAssertTrue(
+      [SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa/rules.db-shm"]);
+
+  // Literal entries only match exactly, and paths shorter than any entry never match
+  XCTAssertFalse(
+      [SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa/events.db-wal"]);
+  XCTAssertFalse([SNTEndpointSecurityTamperResistance isProtectedPath:"/private/var/db/santa"]);
+  XCTAssertFalse([SNTEndpointSecurityTamperResistance isProtectedPath:"/"]);
+  XCTAssertFalse([SNTEndpointSecurityTamperResistance isProtectedPath:""]);
 }
 
 - (void)testStagingDirectoryIsProtected {
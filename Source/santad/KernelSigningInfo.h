@@ -0,0 +1,51 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_KERNELSIGNINGINFO_H
+#define SANTA_SANTAD_KERNELSIGNINGINFO_H
+
+#import <Foundation/Foundation.h>
+
+#include "Source/common/es/Message.h"
+
+@class SNTFileInfo;
+@class SNTSigningInfo;
+
+namespace santa {
+
+// Build the signing info for the target of an AUTH_EXEC message from the code
+// signature the kernel validated, without Security.framework re-reading and
+// re-validating the file.
+//
+// The executable is read once, through fileInfo's descriptor, to verify its
+// page hashes against the kernel's cdhash and compute its SHA-256, which is
+// handed to fileInfo so the file isn't read again. The entitlements, signing
+// times and certificates come from the kernel's copy of the signature, and the
+// certificates are only parsed if they are used.
+//
+// With sliceOnly, only the slice being executed is read, which for a
+// universal binary skips the other architectures. The file's SHA-256 is then
+// only handed to fileInfo for a thin binary; otherwise fileInfo computes it if
+// it is ever asked for. Callers should only set it when the decision can be
+// made without the SHA-256.
+//
+// Returns nil, leaving the caller to fall back to MOLCodesignChecker, unless
+// the kernel strictly enforces the target's cdhash and the file matches it.
+SNTSigningInfo* _Nullable KernelSigningInfoForExec(const Message& esMsg,
+                                                   SNTFileInfo* _Nonnull fileInfo,
+                                                   bool sliceOnly);
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_KERNELSIGNINGINFO_H
@@ -0,0 +1,151 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/KernelSigningInfo.h"
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+#include <Kernel/kern/cs_blobs.h>
+__END_DECLS
+
+#include <libkern/OSByteOrder.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "Source/common/CodeSigningIdentifierUtils.h"
+#import "Source/common/MOLCertificate.h"
+#import "Source/common/SNTFileInfo.h"
+#import "Source/common/SNTSigningInfoCache.h"
+#include "Source/common/String.h"
+#include "Source/common/verifyinghasher/CodeDirectoryCache.h"
+#include "Source/common/verifyinghasher/KernelCsBlob.h"
+#include "Source/common/verifyinghasher/VerifyingHasher.h"
+
+namespace santa {
+
+namespace {
+
+// The static CodeDirectory flags, which is what Security.framework reports as
+// the signature flags.
+uint32_t CodeDirectoryFlags(std::span<const uint8_t> cd_bytes) {
+  if (cd_bytes.size() < offsetof(CS_CodeDirectory, flags) + sizeof(uint32_t)) {
+    return 0;
+  }
+  uint32_t flags;
+  std::memcpy(&flags, cd_bytes.data() + offsetof(CS_CodeDirectory, flags), sizeof(flags));
+  return OSSwapBigToHostInt32(flags);
+}
+
+NSDate* DateFromAbsoluteTime(const std::optional<CFAbsoluteTime>& t) {
+  return t.has_value() ? [NSDate dateWithTimeIntervalSinceReferenceDate:*t] : nil;
+}
+
+}  // namespace
+
+SNTSigningInfo* KernelSigningInfoForExec(const Message& esMsg, SNTFileInfo* fileInfo,
+                                         bool sliceOnly) {
+  const es_process_t* target = esMsg->event.exec.target;
+
+  // The architecture of the image being executed is only reported from
+  // message version 6.
+  if (esMsg->version < 6 || !CdhashStrictlyEnforced(target->codesigning_flags)) {
+    return nil;
+  }
+
+  const struct stat& st = target->executable->stat;
+  VerifyingHasher::Expected expected{
+      .stat = {.dev = st.st_dev, .ino = st.st_ino, .size = st.st_size, .mtime = st.st_mtimespec},
+      .signed_check =
+          VerifyingHasher::Expected::Signed{
+              .cdhash = std::span<const uint8_t>(target->cdhash, CS_CDHASH_LEN),
+              .signing_id = StringTokenToStringView(target->signing_id),
+              .team_id = StringTokenToStringView(target->team_id),
+          },
+  };
+  VerifyingHasher::Result result = VerifyingHasher::Run(
+      fileInfo.fileHandle.fileDescriptor, esMsg->event.exec.image_cputype,
+      esMsg->event.exec.image_cpusubtype, expected,
+      {.slice_only = sliceOnly, .cd_cache = &CodeDirectoryCache::Shared()});
+
+  // Only an exact cdhash match ties the file that was read to the signature
+  // the kernel validated.
+  if (result.status != VerifyingHasher::Status::kMatchCDHash || !result.cdhash.has_value() ||
+      !result.cd_bytes.has_value() ||
+      !(result.sha256.has_value() || result.slice_sha256.has_value())) {
+    return nil;
+  }
+  if (result.sha256.has_value()) {
+    [fileInfo setPrecomputedSHA256:StringToNSString(BufToHexString(result.sha256->data(),
+                                                                   result.sha256->size()))];
+  }
+
+  KernelCsBlob::Result blob =
+      KernelCsBlob::Fetch(target->audit_token, result.cs_blob_size.value_or(0), *result.cd_bytes);
+  if (blob.status != KernelCsBlob::Status::kOk &&
+      blob.status != KernelCsBlob::Status::kNoCmsSignature) {
+    return nil;
+  }
+
+  // Entitlements are only decoded from the XML slot, which codesign still
+  // writes alongside the DER one.
+  NSDictionary* entitlements;
+  if (blob.entitlement_xml.has_value()) {
+    NSData* xml = [NSData dataWithBytes:blob.entitlement_xml->data()
+                                 length:blob.entitlement_xml->size()];
+    entitlements = [NSPropertyListSerialization propertyListWithData:xml
+                                                             options:NSPropertyListImmutable
+                                                              format:NULL
+                                                               error:NULL];
+    if (![entitlements isKindOfClass:[NSDictionary class]]) {
+      return nil;
+    }
+  } else if (blob.entitlement_der.has_value()) {
+    return nil;
+  }
+
+  NSMutableArray<NSData*>* certificateData =
+      [NSMutableArray arrayWithCapacity:blob.certificate_der.size()];
+  for (const std::vector<uint8_t>& der : blob.certificate_der) {
+    [certificateData addObject:[NSData dataWithBytes:der.data() length:der.size()]];
+  }
+
+  return [[SNTSigningInfo alloc]
+          initWithCDHash:StringToNSString(BufToHexString(result.cdhash->data(), CS_CDHASH_LEN))
+               signingID:OptionalStringToNSString(result.signing_id)
+                  teamID:OptionalStringToNSString(result.team_id)
+          platformBinary:target->is_platform_binary
+          signatureFlags:CodeDirectoryFlags(*result.cd_bytes)
+            entitlements:entitlements
+             signingTime:DateFromAbsoluteTime(blob.signing_time)
+       secureSigningTime:DateFromAbsoluteTime(blob.secure_signing_time)
+      certificatesLoader:^NSArray<MOLCertificate*>* {
+        NSMutableArray<MOLCertificate*>* certificates =
+            [NSMutableArray arrayWithCapacity:certificateData.count];
+        for (NSData* der in certificateData) {
+          MOLCertificate* cert = [MOLCertificate internedCertificateWithCertificateDataDER:der];
+          if (!cert) return @[];
+          [certificates addObject:cert];
+        }
+        return certificates;
+      }];
+}
+
+}  // namespace santa
@@ -18,10 +18,16 @@
 #import <Foundation/Foundation.h>
 
 #import "Source/common/SNTKillCommand.h"
+#include "Source/common/processtree/process_tree.h"
 
 namespace santa {
 
-SNTKillResponse* KillingMachine(SNTKillRequest* request);
+// Kill the processes matching the request. When a process tree is given, the
+// code signing info it tracks is used to skip processes that can't match, and
+// csops is only used to verify the remaining candidates.
+SNTKillResponse* KillingMachine(
+    SNTKillRequest* request,
+    const santa::santad::process_tree::ProcessTree* process_tree = nullptr);
 
 }  // namespace santa
 
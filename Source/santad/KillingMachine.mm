@@ -20,8 +20,10 @@
 #include <sys/signal.h>
 
 #include <cerrno>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 #include "Source/common/AuditUtilities.h"
@@ -32,12 +34,23 @@
 #import "Source/common/SNTSystemInfo.h"
 #include "Source/common/String.h"
 #include "Source/common/SystemResources.h"
+#include "Source/common/processtree/process.h"
+#include "Source/common/processtree/process_tree.h"
 #include "absl/cleanup/cleanup.h"
+#include "absl/container/flat_hash_map.h"
 
 namespace santa {
 
+using santa::santad::process_tree::CodeSigningInfo;
+using santa::santad::process_tree::Process;
+using santa::santad::process_tree::ProcessTree;
+
 namespace {
 
+// Matches the code signing info recorded by the process tree. This only
+// narrows down candidates, the csops based matchers still have the final say.
+using CodeSigningMatcher = std::function<bool(const CodeSigningInfo&)>;
+
 // Base class for process matchers
 class ProcessMatcher {
  public:
@@ -110,6 +123,60 @@ std::unique_ptr<ProcessMatcher> MakeStatusFlagsMatcher(uint32_t mask,
   return std::make_unique<FlagsMatcher>(mask, std::move(csops_func));
 }
 
+std::optional<CodeSigningMatcher> MakeCodeSigningMatcher(SNTKillRequest* request) {
+  if ([request isKindOfClass:[SNTKillRequestCDHash class]]) {
+    std::vector<uint8_t> bytes = HexStringToBuf(((SNTKillRequestCDHash*)request).cdhash);
+    std::string cdhash(bytes.begin(), bytes.end());
+    return [cdhash](const CodeSigningInfo& cs) {
+      return cs.cdhash.size() == CS_CDHASH_LEN && cs.cdhash == cdhash;
+    };
+  } else if ([request isKindOfClass:[SNTKillRequestSigningID class]]) {
+    SNTKillRequestSigningID* signingIDRequest = (SNTKillRequestSigningID*)request;
+    std::string signingID = NSStringToUTF8String(signingIDRequest.signingID);
+    if ([signingIDRequest.teamID isEqualToString:kPlatformTeamID]) {
+      return [signingID](const CodeSigningInfo& cs) {
+        return cs.is_platform_binary && cs.signing_id == signingID;
+      };
+    }
+    std::string teamID = NSStringToUTF8String(signingIDRequest.teamID);
+    return [teamID, signingID](const CodeSigningInfo& cs) {
+      return cs.team_id == teamID && cs.signing_id == signingID;
+    };
+  } else if ([request isKindOfClass:[SNTKillRequestTeamID class]]) {
+    std::string teamID = NSStringToUTF8String(((SNTKillRequestTeamID*)request).teamID);
+    return [teamID](const CodeSigningInfo& cs) {
+      return cs.team_id == teamID;
+    };
+  }
+  return std::nullopt;
+}
+
+// Find which processes could match according to the process tree. Pids that
+// aren't in the result are unknown to the tree, or the tree has no code
+// signing info for them.
+absl::flat_hash_map<pid_t, bool> MatchProcessTree(const ProcessTree& tree,
+                                                  const CodeSigningMatcher& matcher) {
+  // A pid may briefly have entries for both images of an exec, the later one
+  // has the larger pidversion.
+  absl::flat_hash_map<pid_t, std::pair<uint64_t, bool>> latest;
+  tree.Iterate([&latest, &matcher](std::shared_ptr<const Process> p) {
+    if (!p->program_->code_signing) {
+      return;
+    }
+    auto [it, inserted] = latest.try_emplace(p->pid_.pid, p->pid_.pidversion, false);
+    if (inserted || p->pid_.pidversion > it->second.first) {
+      it->second = {p->pid_.pidversion, matcher(*p->program_->code_signing)};
+    }
+  });
+
+  absl::flat_hash_map<pid_t, bool> matches;
+  matches.reserve(latest.size());
+  for (const auto& [pid, entry] : latest) {
+    matches.emplace(pid, entry.second);
+  }
+  return matches;
+}
+
 SNTKilledProcessError LibprocSignalErrorToKilledProcessError(int error) {
   switch (error) {
     case 0: return SNTKilledProcessErrorNone;
@@ -226,9 +293,14 @@ bool TestStatusFlagsMatcher(pid_t pid, uint32_t mask, CSOpsFunc csops_func) {
   auto matcher = MakeStatusFlagsMatcher(mask, csops_func);
   return matcher->Matches(pid);
 }
+
+bool TestCodeSigningMatcher(SNTKillRequest* request, const CodeSigningInfo& cs) {
+  auto matcher = MakeCodeSigningMatcher(request);
+  return matcher && (*matcher)(cs);
+}
 #endif
 
-SNTKillResponse* KillingMachine(SNTKillRequest* request) {
+SNTKillResponse* KillingMachine(SNTKillRequest* request, const ProcessTree* process_tree) {
   NSMutableArray<SNTKilledProcess*>* killedProcs = [NSMutableArray array];
 
   if ([request isKindOfClass:[SNTKillRequestRunningProcess class]]) {
@@ -269,11 +341,24 @@ SNTKillResponse* KillingMachine(SNTKillRequest* request) {
       return [[SNTKillResponse alloc] initWithError:SNTKillResponseErrorInvalidRequest];
     }
 
+    absl::flat_hash_map<pid_t, bool> tree_matches;
+    if (process_tree) {
+      if (std::optional<CodeSigningMatcher> cs_matcher = MakeCodeSigningMatcher(request)) {
+        tree_matches = MatchProcessTree(*process_tree, *cs_matcher);
+      }
+    }
+
     for (pid_t pid : *pids) {
       if (pid == 0) {
         continue;
       }
 
+      // Processes the tree knows can't match are skipped without any csops
+      // calls. Everything else is checked against the running process.
+      if (auto it = tree_matches.find(pid); it != tree_matches.end() && !it->second) {
+        continue;
+      }
+
       SNTKilledProcess* killed = KillByMatchers(request, pid, matchers);
       if (killed) {
         [killedProcs addObject:killed];
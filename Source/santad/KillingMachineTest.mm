@@ -21,9 +21,14 @@
 
 #include <cstring>
 #include <functional>
+#include <string>
 #include <vector>
 
 #include "Source/common/CSOpsHelper.h"
+#import "Source/common/SNTKillCommand.h"
+#include "Source/common/processtree/process.h"
+
+using santa::santad::process_tree::CodeSigningInfo;
 
 // Forward declare test-only functions exposed by KillingMachine.mm
 namespace santa {
@@ -32,6 +37,7 @@ extern bool TestCDHashMatcher(pid_t pid, NSString* cdhash, CSOpsFunc csops_func)
 extern bool TestTeamIDMatcher(pid_t pid, NSString* teamID, CSOpsFunc csops_func);
 extern bool TestSigningIDMatcher(pid_t pid, NSString* signingID, CSOpsFunc csops_func);
 extern bool TestStatusFlagsMatcher(pid_t pid, uint32_t mask, CSOpsFunc csops_func);
+extern bool TestCodeSigningMatcher(SNTKillRequest* request, const CodeSigningInfo& cs);
 
 }  // namespace santa
 
@@ -179,4 +185,45 @@ extern bool TestStatusFlagsMatcher(pid_t pid, uint32_t mask, CSOpsFunc csops_fun
       }));
 }
 
+- (void)testCodeSigningMatcher {
+  CodeSigningInfo cs{
+      .signing_id = "com.example.app",
+      .team_id = "ABCDE12345",
+      .cdhash = std::string("\xde\xad\xbe\xef\xca\xfe\xba\xbe\x01\x23"
+                            "\x45\x67\x89\xab\xcd\xef\xfe\xdc\xba\x98",
+                            CS_CDHASH_LEN),
+      .is_platform_binary = false,
+  };
+  CodeSigningInfo platformCS{
+      .signing_id = "com.apple.ls",
+      .is_platform_binary = true,
+  };
+
+  SNTKillRequest* cdhash =
+      [[SNTKillRequestCDHash alloc] initWithUUID:@"uuid"
+                                          cdHash:@"deadbeefcafebabe0123456789abcdeffedcba98"];
+  XCTAssertTrue(santa::TestCodeSigningMatcher(cdhash, cs));
+  XCTAssertFalse(santa::TestCodeSigningMatcher(cdhash, platformCS));
+
+  SNTKillRequest* teamID = [[SNTKillRequestTeamID alloc] initWithUUID:@"uuid"
+                                                               teamID:@"ABCDE12345"];
+  XCTAssertTrue(santa::TestCodeSigningMatcher(teamID, cs));
+  XCTAssertFalse(santa::TestCodeSigningMatcher(teamID, platformCS));
+
+  SNTKillRequest* signingID =
+      [[SNTKillRequestSigningID alloc] initWithUUID:@"uuid"
+                                          signingID:@"ABCDE12345:com.example.app"];
+  XCTAssertTrue(santa::TestCodeSigningMatcher(signingID, cs));
+  XCTAssertFalse(santa::TestCodeSigningMatcher(signingID, platformCS));
+
+  SNTKillRequest* otherSigningID =
+      [[SNTKillRequestSigningID alloc] initWithUUID:@"uuid" signingID:@"ABCDE12345:com.example.b"];
+  XCTAssertFalse(santa::TestCodeSigningMatcher(otherSigningID, cs));
+
+  SNTKillRequest* platformSigningID =
+      [[SNTKillRequestSigningID alloc] initWithUUID:@"uuid" signingID:@"platform:com.apple.ls"];
+  XCTAssertTrue(santa::TestCodeSigningMatcher(platformSigningID, platformCS));
+  XCTAssertFalse(santa::TestCodeSigningMatcher(platformSigningID, cs));
+}
+
 @end
@@ -0,0 +1,147 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_LOGQUEUE_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_LOGQUEUE_H
+
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "Source/common/MPSCRingBuffer.h"
+
+namespace santa {
+
+struct LogQueueStats {
+  // Number of messages waiting to be consumed.
+  size_t depth;
+  size_t capacity;
+  // Cumulative number of messages that arrived while the queue was full and
+  // were dropped.
+  uint64_t dropped;
+  // Cumulative number of messages that arrived while the queue was full and
+  // were consumed on the producing thread instead.
+  uint64_t inlined;
+};
+
+// Hands messages from any number of producer threads to a single consumer
+// running on its own serial queue, so producers only pay for a lock-free push
+// instead of doing the consumer's work (e.g. serializing and writing
+// telemetry) themselves.
+//
+// Queued messages are consumed in the order they were enqueued. When the queue
+// is full, the FullPolicy decides whether new messages are dropped or consumed
+// synchronously on the producing thread, ahead of those still queued. Messages
+// that must not be dropped are always consumed on the producing thread.
+template <typename T>
+class LogQueue {
+ public:
+  enum class FullPolicy {
+    kDrop,
+    kConsumeInline,
+  };
+
+  LogQueue(size_t capacity, FullPolicy policy, std::function<void(T)> consume)
+      : ring_(capacity),
+        policy_(policy),
+        consume_(std::move(consume)),
+        q_(dispatch_queue_create("com.northpolesec.santa.daemon.log_queue",
+                                 DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL)) {}
+
+  // Waits for all enqueued messages to be consumed.
+  ~LogQueue() { Drain(); }
+
+  LogQueue(const LogQueue&) = delete;
+  LogQueue& operator=(const LogQueue&) = delete;
+
+  void Enqueue(T msg, bool droppable = true) {
+    if (!ring_.Enqueue(std::move(msg))) {
+      if (policy_ == FullPolicy::kDrop && droppable) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        inlined_.fetch_add(1, std::memory_order_relaxed);
+        consume_(std::move(msg));
+      }
+      return;
+    }
+
+    ScheduleConsumerIfNeeded();
+  }
+
+  // Blocks until every message enqueued before the call has been consumed.
+  void Drain() {
+    dispatch_sync(q_, ^{
+      ConsumeSerialized();
+    });
+  }
+
+  LogQueueStats Stats() const {
+    return LogQueueStats{
+        .depth = ring_.Size(),
+        .capacity = ring_.Capacity(),
+        .dropped = dropped_.load(std::memory_order_relaxed),
+        .inlined = inlined_.load(std::memory_order_relaxed),
+    };
+  }
+
+ private:
+  // Only one consume block is scheduled at a time. It runs until the queue is
+  // empty, so producers only need to schedule it when it isn't already
+  // running.
+  void ScheduleConsumerIfNeeded() {
+    // Pairs with the fence in the consume block, so that either the consumer
+    // sees this message or this producer sees the consumer has stopped.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (scheduled_.exchange(true)) {
+      return;
+    }
+
+    dispatch_async(q_, ^{
+      for (;;) {
+        ConsumeSerialized();
+        scheduled_.store(false);
+        // A producer may have enqueued after the queue was seen empty but
+        // before the flag was cleared, in which case it didn't schedule a new
+        // block. Check again so that message isn't stranded.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring_.Empty() || scheduled_.exchange(true)) {
+          return;
+        }
+      }
+    });
+  }
+
+  void ConsumeSerialized() {
+    while (std::optional<T> msg = ring_.Dequeue()) {
+      consume_(std::move(*msg));
+    }
+  }
+
+  MPSCRingBuffer<T> ring_;
+  const FullPolicy policy_;
+  std::function<void(T)> consume_;
+  dispatch_queue_t q_;
+  std::atomic<bool> scheduled_{false};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> inlined_{0};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_LOGQUEUE_H
@@ -0,0 +1,180 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/LogQueue.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using santa::LogQueue;
+using santa::LogQueueStats;
+
+@interface LogQueueTest : XCTestCase
+@end
+
+@implementation LogQueueTest
+
+- (void)testConsumesInOrder {
+  std::vector<int> consumed;
+  LogQueue<int> q(16, LogQueue<int>::FullPolicy::kDrop, [&consumed](int val) {
+    consumed.push_back(val);
+  });
+
+  for (int i = 0; i < 100; ++i) {
+    q.Enqueue(i);
+  }
+  q.Drain();
+
+  XCTAssertEqual(consumed.size(), 100);
+  for (int i = 0; i < (int)consumed.size(); ++i) {
+    XCTAssertEqual(consumed[i], i);
+  }
+
+  LogQueueStats stats = q.Stats();
+  XCTAssertEqual(stats.depth, 0);
+  XCTAssertEqual(stats.capacity, 16);
+}
+
+- (void)testConsumesOffProducerThread {
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  std::thread::id producer = std::this_thread::get_id();
+  std::thread::id consumer;
+  LogQueue<int> q(4, LogQueue<int>::FullPolicy::kDrop, [&consumer, sema](int val) {
+    consumer = std::this_thread::get_id();
+    dispatch_semaphore_signal(sema);
+  });
+
+  q.Enqueue(1);
+  XCTAssertEqual(
+      0, dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)),
+      "Queued value was not consumed");
+  XCTAssertTrue(consumer != producer);
+}
+
+- (void)testDropWhenFull {
+  // Hold up the consumer so the queue fills up.
+  dispatch_semaphore_t started = dispatch_semaphore_create(0);
+  dispatch_semaphore_t release = dispatch_semaphore_create(0);
+  std::vector<int> consumed;
+  LogQueue<int> q(4, LogQueue<int>::FullPolicy::kDrop, [&consumed, started, release](int val) {
+    if (val == 0) {
+      dispatch_semaphore_signal(started);
+      dispatch_semaphore_wait(release, DISPATCH_TIME_FOREVER);
+    }
+    consumed.push_back(val);
+  });
+
+  q.Enqueue(0);
+  XCTAssertEqual(
+      0, dispatch_semaphore_wait(started, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+
+  // The consumer holds 0, so four more fit and the rest are dropped.
+  for (int i = 1; i <= 6; ++i) {
+    q.Enqueue(i);
+  }
+
+  // Messages that must not be dropped are consumed right away instead.
+  q.Enqueue(7, false);
+
+  LogQueueStats stats = q.Stats();
+  XCTAssertEqual(stats.depth, 4);
+  XCTAssertEqual(stats.dropped, 2);
+  XCTAssertEqual(stats.inlined, 1);
+
+  dispatch_semaphore_signal(release);
+  q.Drain();
+
+  std::vector<int> want = {7, 0, 1, 2, 3, 4};
+  XCTAssertTrue(consumed == want);
+  XCTAssertEqual(q.Stats().depth, 0);
+}
+
+- (void)testConsumeInlineWhenFull {
+  dispatch_semaphore_t started = dispatch_semaphore_create(0);
+  dispatch_semaphore_t release = dispatch_semaphore_create(0);
+  std::mutex mtx;
+  std::vector<int> consumed;
+  LogQueue<int> q(2, LogQueue<int>::FullPolicy::kConsumeInline,
+                  [&mtx, &consumed, started, release](int val) {
+                    if (val == 0) {
+                      dispatch_semaphore_signal(started);
+                      dispatch_semaphore_wait(release, DISPATCH_TIME_FOREVER);
+                    }
+                    std::lock_guard<std::mutex> lock(mtx);
+                    consumed.push_back(val);
+                  });
+
+  q.Enqueue(0);
+  XCTAssertEqual(
+      0, dispatch_semaphore_wait(started, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)));
+
+  // Two values fit in the queue, the third is consumed right away on this
+  // thread, ahead of the queued values.
+  q.Enqueue(1);
+  q.Enqueue(2);
+  q.Enqueue(3);
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<int> want = {3};
+    XCTAssertTrue(consumed == want);
+  }
+
+  LogQueueStats stats = q.Stats();
+  XCTAssertEqual(stats.dropped, 0);
+  XCTAssertEqual(stats.inlined, 1);
+
+  dispatch_semaphore_signal(release);
+  q.Drain();
+
+  std::vector<int> want = {3, 0, 1, 2};
+  XCTAssertTrue(consumed == want);
+}
+
+- (void)testConcurrentProducers {
+  static constexpr int kProducers = 4;
+  static constexpr int kPerProducer = 5000;
+  std::atomic<int> received{0};
+  // Full-queue values are consumed inline on the producers' threads, so this
+  // may run concurrently with the queue's consumer.
+  LogQueue<int> q(64, LogQueue<int>::FullPolicy::kConsumeInline, [&received](int val) {
+    received.fetch_add(1, std::memory_order_relaxed);
+  });
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&q, p] {
+      for (int i = 0; i < kPerProducer; ++i) {
+        q.Enqueue(p * kPerProducer + i);
+      }
+    });
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  q.Drain();
+
+  // Every value is consumed exactly once, whether queued or inline.
+  XCTAssertEqual(received.load(), kProducers * kPerProducer);
+  XCTAssertEqual(q.Stats().depth, 0);
+  XCTAssertEqual(q.Stats().dropped, 0);
+}
+
+@end
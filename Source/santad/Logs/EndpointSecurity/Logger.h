@@ -17,20 +17,31 @@
 #define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_LOGGER_H
 
 #import <Foundation/Foundation.h>
+#import <Network/Network.h>
 
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <string_view>
+#include <utility>
+#include <vector>
 
+#include "Source/common/ExecTrace.h"
 #import "Source/common/SNTCommonEnums.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/common/Timer.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
+#include "Source/santad/Logs/EndpointSecurity/LogQueue.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
+#include "Source/santad/Logs/EndpointSecurity/NetworkFlowAggregator.h"
+#include "Source/santad/Logs/EndpointSecurity/TelemetryAggregator.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
 #import "Source/santad/SNTDecisionCache.h"
+#include "Source/santad/SignalPrefilter.h"
 #include "Source/santad/SleighLauncher.h"
 
 // Forward declarations
@@ -53,7 +64,15 @@ using GetExportConfigBlock = SNTExportConfiguration* (^)(void);
 // queue, so the block must be cheap and dispatch any real work elsewhere. The
 // fd lets the scan read the file even after the telemetry exporter unlinks the
 // path; the consumer owns the ScopedFile and closes it when the scan is done.
-using SpoolFileClosedBlock = void (^)(std::string, std::shared_ptr<santa::ScopedFile>);
+// The last argument is the prefilter under which no message in the file could
+// match a signal, or nullptr if the file may match and should be scanned.
+using SpoolFileClosedBlock = void (^)(std::string, std::shared_ptr<santa::ScopedFile>,
+                                      std::shared_ptr<const santa::SignalPrefilter>);
+
+// Returns the signal prefilter to check each new spool batch against, or
+// nullptr to treat every batch as one that may match. Runs on the spool's
+// serial queue once per batch.
+using SpoolPrefilterBlock = std::shared_ptr<const santa::SignalPrefilter> (^)(void);
 
 class Logger : public Timer<Logger> {
  public:
@@ -66,12 +85,14 @@ class Logger : public Timer<Logger> {
       std::shared_ptr<santa::EndpointSecurityAPI> esapi,
       std::unique_ptr<santa::SleighLauncher> sleigh_launcher,
       GetExportConfigBlock getExportConfigBlock, SpoolFileClosedBlock spoolFileClosed,
-      TelemetryEvent telemetry_mask, SNTEventLogType log_type, SNTDecisionCache* decision_cache,
-      NSString* event_log_path, NSString* spool_log_path, size_t spool_dir_size_threshold,
-      size_t spool_file_size_threshold, uint64_t spool_flush_timeout_ms,
-      uint32_t telemetry_export_seconds, uint32_t telemetry_export_timeout_seconds,
-      uint32_t telemetry_export_batch_threshold_size_mb,
-      uint32_t telemetry_export_max_files_per_batch);
+      SpoolPrefilterBlock spoolPrefilter, TelemetryEvent telemetry_mask, SNTEventLogType log_type,
+      SNTDecisionCache* decision_cache, NSString* event_log_path, NSString* spool_log_path,
+      size_t spool_dir_size_threshold, size_t spool_file_size_threshold,
+      uint64_t spool_flush_timeout_ms, uint32_t telemetry_export_seconds,
+      uint32_t telemetry_export_timeout_seconds, uint32_t telemetry_export_batch_threshold_size_mb,
+      uint32_t telemetry_export_max_files_per_batch, uint32_t spool_shard_count,
+      NSString* zstd_dictionary_path, uint32_t spool_compaction_zstd_level = 0,
+      SNTWriteDurability write_durability = SNTWriteDurabilityNone);
 
   Logger(std::unique_ptr<santa::SleighLauncher> sleigh_launcher,
          GetExportConfigBlock getExportConfigBlock, TelemetryEvent telemetry_mask,
@@ -80,7 +101,7 @@ class Logger : public Timer<Logger> {
          uint32_t telemetry_export_max_files_per_batch,
          std::shared_ptr<santa::Serializer> serializer, std::shared_ptr<santa::Writer> writer);
 
-  virtual ~Logger() = default;
+  virtual ~Logger();
 
   Logger(Logger&&) = default;
   Logger& operator=(Logger&& rhs) = default;
@@ -100,6 +121,15 @@ class Logger : public Timer<Logger> {
   void LogNetworkFlows(SNDProcessFlows* processFlows, struct timespec window_start,
                        struct timespec window_end);
 
+  /// Log flows already in their protobuf form, e.g. as read from a NetworkFlowRing. They are merged
+  /// into the current aggregation window when network flow aggregation is started.
+  void LogNetworkActivity(const ::santa::pb::v1::NetworkActivity::Process& process,
+                          struct timespec window_start, struct timespec window_end);
+
+  // Traces are only exported when explicitly requested, so they are logged
+  // regardless of the telemetry mask.
+  void LogExecTrace(const santa::ExecTrace::Summary& trace);
+
   virtual void LogFileAccess(const std::string& policy_version, const std::string& policy_name,
                              const santa::Message& msg,
                              const santa::EnrichedProcess& enriched_process, size_t target_index,
@@ -108,10 +138,49 @@ class Logger : public Timer<Logger> {
 
   void Flush();
 
+  /// Hand messages passed to Log() off to a queue consumed on a dedicated
+  /// serial queue, so that the calling thread doesn't serialize and write them.
+  /// Must be called before any messages are logged.
+  void StartLogQueue(size_t capacity,
+                     LogQueue<std::unique_ptr<santa::EnrichedMessage>>::FullPolicy policy);
+
+  /// Returns std::nullopt if the log queue was not started.
+  std::optional<LogQueueStats> GetLogQueueStats() const;
+
   void SetTelemetryMask(TelemetryEvent mask);
+  inline TelemetryEvent TelemetryMask() const { return telemetry_mask_; }
 
   inline bool ShouldLog(TelemetryEvent event) { return ((event & telemetry_mask_) == event); }
 
+  /// Only log one of every N events of a type, as configured by TelemetrySampleRates. Event types
+  /// not in the dictionary are all logged.
+  void SetTelemetrySampleRates(NSDictionary<NSString*, NSNumber*>* rates);
+
+  /// Count events of the given types towards per-executable summaries instead of logging them.
+  void SetTelemetryAggregatedEvents(TelemetryEvent mask);
+
+  /// Drop events of the given types once the number of events waiting to be
+  /// serialized or written reaches backlog_threshold. Executions and file
+  /// access events are never dropped. A threshold of 0 disables load shedding.
+  void SetLoadShedding(TelemetryEvent events, size_t backlog_threshold);
+
+  /// The cumulative number of events dropped by load shedding, per event type.
+  std::vector<std::pair<TelemetryEvent, uint64_t>> GetShedCounts() const;
+
+  /// Log the summaries of aggregated events every window_secs. Must be called at most once.
+  void StartEventAggregation(uint32_t window_secs);
+
+  /// Log the summaries of all events aggregated since the previous call.
+  void LogEventSummaries();
+
+  /// Merge network flows by process and remote endpoint, logging them every
+  /// window_secs instead of as they are reported. Must be called at most once,
+  /// before any flows are logged.
+  void StartNetworkFlowAggregation(uint32_t window_secs);
+
+  /// Log the network flows aggregated since the previous call.
+  void LogAggregatedNetworkFlows();
+
   void UpdateMachineIDLogging() const;
 
   bool OnTimer();
@@ -123,6 +192,21 @@ class Logger : public Timer<Logger> {
   void SetMaxFilesPerBatch(uint32_t val);
   void SetTelmetryExportTimeoutSecs(uint32_t val);
 
+  /// Export spool files shortly after they're closed instead of waiting for the next export
+  /// interval. Files closed within delay_secs of the first pending one are exported in the same
+  /// batch, and the export timer remains as a fallback. A delay of 0 disables streaming export.
+  /// Must be called once the logger is owned by a shared_ptr.
+  void SetStreamingExportDelaySecs(uint32_t delay_secs);
+
+  /// Export up to this many batches at once when catching up on a backlog. Batches are still
+  /// taken from the spool oldest-first. Only one batch at a time is exported while on battery
+  /// power or an expensive or constrained network.
+  void SetMaxConcurrentExports(uint32_t val);
+
+  /// Limit the average export rate. After each round of batches, further exports are deferred
+  /// until the round's bytes fit under the limit. A limit of 0 disables pacing.
+  void SetExportBandwidthLimitKBps(uint32_t val);
+
   friend class santa::LoggerPeer;
 
  private:
@@ -172,18 +256,44 @@ class Logger : public Timer<Logger> {
     dispatch_queue_t q_;
   };
 
+  // The number of events waiting in the log queue or in the writer.
+  size_t Backlog() const;
+
   void ExportTelemetrySerialized();
+  void ScheduleStreamingExport(std::weak_ptr<Logger> weak_self);
+  std::vector<std::string> NextExportBatch(uint32_t max_files, uint64_t max_bytes,
+                                           uint64_t* batch_bytes, bool* batch_full);
 
   std::unique_ptr<santa::SleighLauncher> sleigh_launcher_;
   GetExportConfigBlock get_export_config_block_;
   TelemetryEvent telemetry_mask_;
   std::shared_ptr<santa::Serializer> serializer_;
   std::shared_ptr<santa::Writer> writer_;
+  std::shared_ptr<LogQueue<std::unique_ptr<santa::EnrichedMessage>>> log_queue_;
+  std::shared_ptr<TelemetryAggregator> aggregator_;
+  dispatch_source_t aggregation_timer_;
+  std::shared_ptr<NetworkFlowAggregator> flow_aggregator_;
+  dispatch_source_t flow_aggregation_timer_;
   ExportTracker tracker_;
   std::unique_ptr<std::atomic_uint64_t> export_batch_threshold_size_bytes_;
   std::unique_ptr<std::atomic_uint32_t> export_max_files_per_batch_;
   std::unique_ptr<std::atomic_uint32_t> export_timeout_secs_;
   dispatch_queue_t export_queue_;
+  // Merged into each time a spool file is closed. Only set for spool writers.
+  dispatch_source_t spool_closed_source_;
+  dispatch_queue_t streaming_export_queue_;
+  std::unique_ptr<std::atomic_uint32_t> streaming_export_delay_secs_;
+  std::unique_ptr<std::atomic_bool> streaming_export_pending_;
+  std::unique_ptr<std::atomic_uint32_t> export_max_concurrent_;
+  std::unique_ptr<std::atomic_uint32_t> export_bandwidth_limit_kbps_;
+  // Returns true when exports should avoid using much power or bandwidth.
+  std::function<bool()> export_constrained_;
+  nw_path_monitor_t export_path_monitor_;
+  // Only accessed on the export queue.
+  std::chrono::steady_clock::time_point export_resume_time_;
+  // Batch limits are halved this many times after failed exports, so a flaky connection still
+  // makes progress in smaller batches. Only accessed on the export queue.
+  uint32_t export_batch_shrink_shift_ = 0;
 };
 
 }  // namespace santa
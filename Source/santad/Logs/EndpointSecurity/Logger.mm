@@ -16,29 +16,40 @@
 #include "Source/santad/Logs/EndpointSecurity/Logger.h"
 
 #import <Foundation/Foundation.h>
+#import <Network/Network.h>
+#include <dispatch/dispatch.h>
 #include <sys/stat.h>
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <memory>
+#include <optional>
+#include <string_view>
 #include <utility>
+#include <variant>
 
 #import "Source/common/SNTCommonEnums.h"
+#include "Source/common/PowerMonitor.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTExportConfiguration.h"
 #include "Source/common/SNTLogging.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/SNTSystemInfo.h"
+#include "Source/common/String.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/BasicString.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Empty.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/UnifiedLog.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Null.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/ShardedSpool.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Spool.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Syslog.h"
 #import "Source/santad/SNTDecisionCache.h"
@@ -51,76 +62,227 @@ namespace santa {
 static constexpr uint64_t kFlushBufferTimeoutMS = 10000;
 // Batch writes up to 128kb
 static constexpr size_t kBufferBatchSizeBytes = (1024 * 128);
-// Reserve an extra 4kb of buffer space to account for event overflow
-static constexpr size_t kMaxExpectedWriteSizeBytes = 4096;
 // Minimum/maximum allowable telemetry export frequency.
 // Semi-arbitrary. Goal is to protect against too much strain on the export path.
 static constexpr uint32_t kMinTelemetryExportIntervalSecs = 60;
 static constexpr uint32_t kMaxTelemetryExportIntervalSecs = 3600;
+// Longest a closed spool file waits to be streamed out.
+static constexpr uint32_t kMaxStreamingExportDelaySecs = 300;
+// Upper bound on Sleigh processes exporting at once.
+static constexpr uint32_t kMaxConcurrentExports = 8;
+// Most times the batch limits are halved after consecutive failed exports.
+static constexpr uint32_t kMaxExportBatchShrinkShift = 6;
+// Smallest batch size limit reached by shrinking.
+static constexpr uint64_t kMinShrunkBatchSizeBytes = 1024 * 1024;
+// Smallest size spool files are compacted to before export.
+static constexpr uint64_t kMinCompactedFileSizeBytes = 1024 * 1024;
+// Lowest zstd level used when the spool is backed up.
+static constexpr int kMinAdaptiveZstdLevel = 1;
+
+// The path acted on by an event, used to find the most common paths of
+// aggregated events. Empty for events without a file target.
+static std::string_view AggregationTargetPath(const es_message_t* msg) {
+  switch (msg->event_type) {
+    case ES_EVENT_TYPE_NOTIFY_CLONE: return StringTokenToStringView(msg->event.clone.source->path);
+    case ES_EVENT_TYPE_NOTIFY_CLOSE: return StringTokenToStringView(msg->event.close.target->path);
+    case ES_EVENT_TYPE_NOTIFY_COPYFILE:
+      return StringTokenToStringView(msg->event.copyfile.source->path);
+    case ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA:
+      return StringTokenToStringView(msg->event.exchangedata.file1->path);
+    case ES_EVENT_TYPE_NOTIFY_EXEC:
+      return StringTokenToStringView(msg->event.exec.target->executable->path);
+    case ES_EVENT_TYPE_NOTIFY_LINK: return StringTokenToStringView(msg->event.link.source->path);
+    case ES_EVENT_TYPE_NOTIFY_RENAME:
+      return StringTokenToStringView(msg->event.rename.source->path);
+    case ES_EVENT_TYPE_NOTIFY_UNLINK:
+      return StringTokenToStringView(msg->event.unlink.target->path);
+    default: return {};
+  }
+}
+
+static void WriteEventSummaries(TelemetryAggregator& aggregator, Serializer& serializer,
+                                Writer& writer) {
+  TelemetryAggregator::Window window = aggregator.Drain();
+  for (const EventSummary& summary : window.summaries) {
+    writer.Write(serializer.SerializeEventSummary(summary, window.start, window.end));
+  }
+}
+
+static void WriteNetworkActivity(NetworkFlowAggregator& aggregator, Serializer& serializer,
+                                 Writer& writer) {
+  if (std::optional<NetworkFlowAggregator::Window> window = aggregator.Drain()) {
+    writer.Write(serializer.SerializeNetworkActivity(*window));
+  }
+}
+
+// Creates a single spool, or a sharded spool when more than one shard is configured.
+template <::fsspool::BatcherInterface T>
+static std::shared_ptr<Writer> CreateSpool(T batcher, uint32_t shard_count,
+                                           NSString* spool_log_path,
+                                           size_t spool_dir_size_threshold,
+                                           size_t spool_file_size_threshold,
+                                           uint64_t spool_flush_timeout_ms,
+                                           SpoolFileClosedBlock spoolFileClosed,
+                                           SpoolPrefilterBlock spoolPrefilter,
+                                           ::fsspool::Durability durability,
+                                           SpoolFileMerger merger = nullptr) {
+  if (shard_count > 1) {
+    auto spool = ShardedSpool<T>::Create(batcher, shard_count, [spool_log_path UTF8String],
+                                         spool_dir_size_threshold, spool_file_size_threshold,
+                                         spool_flush_timeout_ms, spoolFileClosed, spoolPrefilter);
+    spool->SetMerger(std::move(merger));
+    spool->SetDurability(durability);
+    return spool;
+  }
+  auto spool = Spool<T>::Create(std::move(batcher), [spool_log_path UTF8String],
+                                spool_dir_size_threshold, spool_file_size_threshold,
+                                spool_flush_timeout_ms, spoolFileClosed, spoolPrefilter);
+  spool->SetMerger(std::move(merger));
+  spool->SetDurability(durability);
+  return spool;
+}
+
+static ::fsspool::Durability SpoolDurability(SNTWriteDurability durability) {
+  switch (durability) {
+    case SNTWriteDurabilityBatch: return ::fsspool::Durability::kBatch;
+    case SNTWriteDurabilityStrict: return ::fsspool::Durability::kStrict;
+    default: return ::fsspool::Durability::kNone;
+  }
+}
+
+static std::shared_ptr<const ::fsspool::ZstdDictionary> LoadZstdDictionary(NSString* path) {
+  if (!path) {
+    return nullptr;
+  }
+
+  auto dictionary = ::fsspool::ZstdDictionary::Load([path UTF8String]);
+  if (!dictionary.ok()) {
+    LOGW(@"Unable to load zstd dictionary, compressing without it: %s",
+         dictionary.status().ToString().c_str());
+    return nullptr;
+  }
+
+  return *dictionary;
+}
 
 // Translate configured log type to appropriate Serializer/Writer pairs
 std::unique_ptr<Logger> Logger::Create(
     std::shared_ptr<EndpointSecurityAPI> esapi,
     std::unique_ptr<santa::SleighLauncher> sleigh_launcher,
     GetExportConfigBlock getExportConfigBlock, SpoolFileClosedBlock spoolFileClosed,
-    TelemetryEvent telemetry_mask, SNTEventLogType log_type, SNTDecisionCache* decision_cache,
-    NSString* event_log_path, NSString* spool_log_path, size_t spool_dir_size_threshold,
-    size_t spool_file_size_threshold, uint64_t spool_flush_timeout_ms,
-    uint32_t telemetry_export_seconds, uint32_t telemetry_export_timeout_seconds,
-    uint32_t telemetry_export_batch_threshold_size_mb,
-    uint32_t telemetry_export_max_files_per_batch) {
+    SpoolPrefilterBlock spoolPrefilter, TelemetryEvent telemetry_mask, SNTEventLogType log_type,
+    SNTDecisionCache* decision_cache, NSString* event_log_path, NSString* spool_log_path,
+    size_t spool_dir_size_threshold, size_t spool_file_size_threshold,
+    uint64_t spool_flush_timeout_ms, uint32_t telemetry_export_seconds,
+    uint32_t telemetry_export_timeout_seconds, uint32_t telemetry_export_batch_threshold_size_mb,
+    uint32_t telemetry_export_max_files_per_batch, uint32_t spool_shard_count,
+    NSString* zstd_dictionary_path, uint32_t spool_compaction_zstd_level,
+    SNTWriteDurability write_durability) {
   std::shared_ptr<santa::Serializer> serializer;
   std::shared_ptr<santa::Writer> writer;
+  ::fsspool::Durability spool_durability = SpoolDurability(write_durability);
+
+  // Closed spool files are counted on a source whose handler is installed once streaming export
+  // is configured, so that spools created here can signal a logger that doesn't exist yet.
+  dispatch_queue_t streaming_export_queue =
+      dispatch_queue_create("com.northpolesec.santa.daemon.streaming_export",
+                            DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+  dispatch_source_t spool_closed_source =
+      dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, streaming_export_queue);
+  SpoolFileClosedBlock originalSpoolFileClosed = spoolFileClosed;
+  spoolFileClosed = ^(std::string path, std::shared_ptr<santa::ScopedFile> file,
+                      std::shared_ptr<const santa::SignalPrefilter> clean_under) {
+    if (originalSpoolFileClosed) {
+      originalSpoolFileClosed(std::move(path), std::move(file), std::move(clean_under));
+    }
+    dispatch_source_merge_data(spool_closed_source, 1);
+  };
 
   switch (log_type) {
     case SNTEventLogTypeFilelog:
       serializer = BasicString::Create(esapi, std::move(decision_cache));
-      writer = File::Create(event_log_path, kFlushBufferTimeoutMS, kBufferBatchSizeBytes,
-                            kMaxExpectedWriteSizeBytes);
+      writer = File::Create(event_log_path, kFlushBufferTimeoutMS, kBufferBatchSizeBytes);
       break;
     case SNTEventLogTypeSyslog:
       serializer = BasicString::Create(esapi, std::move(decision_cache), false);
       writer = Syslog::Create();
       break;
+    case SNTEventLogTypeUnifiedLog:
+      serializer = UnifiedLog::Create(esapi, std::move(decision_cache));
+      writer = Syslog::Create();
+      break;
     case SNTEventLogTypeNull:
       serializer = Empty::Create();
       writer = Null::Create();
       break;
     case SNTEventLogTypeProtobuf:
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
-      writer = Spool<::fsspool::AnyBatcher>::Create(
-          ::fsspool::AnyBatcher(), [spool_log_path UTF8String], spool_dir_size_threshold,
-          spool_file_size_threshold, spool_flush_timeout_ms, spoolFileClosed);
+      writer = CreateSpool(::fsspool::AnyBatcher(), spool_shard_count, spool_log_path,
+                           spool_dir_size_threshold, spool_file_size_threshold,
+                           spool_flush_timeout_ms, spoolFileClosed, spoolPrefilter,
+                           spool_durability);
       break;
     case SNTEventLogTypeProtobufStream:
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
-      writer = Spool<::fsspool::UncompressedStreamBatcher>::Create(
-          ::fsspool::UncompressedStreamBatcher(), [spool_log_path UTF8String],
-          spool_dir_size_threshold, spool_file_size_threshold, spool_flush_timeout_ms,
-          spoolFileClosed);
+      writer = CreateSpool(::fsspool::UncompressedStreamBatcher(), spool_shard_count,
+                           spool_log_path, spool_dir_size_threshold, spool_file_size_threshold,
+                           spool_flush_timeout_ms, spoolFileClosed, spoolPrefilter,
+                           spool_durability);
       break;
     case SNTEventLogTypeProtobufStreamGzip:
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
-      writer = Spool<::fsspool::GzipStreamBatcher>::Create(
+      writer = CreateSpool(
           ::fsspool::GzipStreamBatcher(^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
             return std::make_shared<google::protobuf::io::GzipOutputStream>(raw_stream);
           }),
-          [spool_log_path UTF8String], spool_dir_size_threshold, spool_file_size_threshold,
-          spool_flush_timeout_ms, spoolFileClosed);
+          spool_shard_count, spool_log_path, spool_dir_size_threshold, spool_file_size_threshold,
+          spool_flush_timeout_ms, spoolFileClosed, spoolPrefilter, spool_durability);
       break;
-    case SNTEventLogTypeProtobufStreamZstd:
+    case SNTEventLogTypeProtobufStreamZstd: {
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
-      writer = Spool<::fsspool::ZstdStreamBatcher>::Create(
+      std::shared_ptr<const ::fsspool::ZstdDictionary> dictionary =
+          LoadZstdDictionary(zstd_dictionary_path);
+      auto level =
+          std::make_shared<::fsspool::AdaptiveZstdLevel>(ZSTD_CLEVEL_DEFAULT, kMinAdaptiveZstdLevel);
+      // Spool files are compressed quickly so writes keep up. Before export, runs of small files
+      // can be merged and recompressed at a higher level.
+      SpoolFileMerger merger;
+      if (spool_compaction_zstd_level > 0) {
+        int compaction_level =
+            std::min(static_cast<int>(spool_compaction_zstd_level), ZSTD_maxCLevel());
+        merger = [dictionary, compaction_level](const std::vector<std::string>& input_paths,
+                                                int output_fd) {
+          return ::fsspool::RecompressZstdFiles(input_paths, output_fd, compaction_level,
+                                                dictionary);
+        };
+      }
+      writer = CreateSpool(
           ::fsspool::ZstdStreamBatcher(^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
-            return ::fsspool::ZstdOutputStream::Create(raw_stream);
+            return ::fsspool::ZstdOutputStream::Create(
+                raw_stream, level->Level(), ::fsspool::ZstdOutputStream::kDefaultBufferSize,
+                dictionary);
           }),
-          [spool_log_path UTF8String], spool_dir_size_threshold, spool_file_size_threshold,
-          spool_flush_timeout_ms, spoolFileClosed);
+          spool_shard_count, spool_log_path, spool_dir_size_threshold, spool_file_size_threshold,
+          spool_flush_timeout_ms, spoolFileClosed, spoolPrefilter, spool_durability,
+          std::move(merger));
+      // Weak, since the writer owns the level through its batcher.
+      std::weak_ptr<Writer> weak_writer = writer;
+      level->SetBacklogSource([weak_writer] {
+        std::shared_ptr<Writer> writer = weak_writer.lock();
+        return writer ? writer->PendingWrites() : 0;
+      });
+      break;
+    }
+    case SNTEventLogTypeProtobufColumnar:
+      serializer = Protobuf::Create(esapi, std::move(decision_cache));
+      writer = CreateSpool(::fsspool::ColumnarBatcher(), spool_shard_count, spool_log_path,
+                           spool_dir_size_threshold, spool_file_size_threshold,
+                           spool_flush_timeout_ms, spoolFileClosed, spoolPrefilter,
+                           spool_durability);
       break;
     case SNTEventLogTypeJSON:
       serializer = Protobuf::Create(esapi, std::move(decision_cache), true);
-      writer = File::Create(event_log_path, kFlushBufferTimeoutMS, kBufferBatchSizeBytes,
-                            kMaxExpectedWriteSizeBytes);
+      writer = File::Create(event_log_path, kFlushBufferTimeoutMS, kBufferBatchSizeBytes);
       break;
     default: LOGE(@"Invalid log type: %ld", log_type); return nullptr;
   }
@@ -132,6 +294,21 @@ std::unique_ptr<Logger> Logger::Create(
 
   logger->SetTimerInterval(telemetry_export_seconds);
 
+  logger->streaming_export_queue_ = streaming_export_queue;
+  logger->spool_closed_source_ = spool_closed_source;
+  dispatch_resume(spool_closed_source);
+
+  auto path_costly = std::make_shared<std::atomic_bool>(false);
+  logger->export_path_monitor_ = nw_path_monitor_create();
+  nw_path_monitor_set_queue(logger->export_path_monitor_, streaming_export_queue);
+  nw_path_monitor_set_update_handler(logger->export_path_monitor_, ^(nw_path_t path) {
+    path_costly->store(nw_path_is_expensive(path) || nw_path_is_constrained(path));
+  });
+  nw_path_monitor_start(logger->export_path_monitor_);
+  logger->export_constrained_ = [path_costly] {
+    return path_costly->load() || !PowerMonitor::IsOnExternalPower();
+  };
+
   return logger;
 }
 
@@ -149,10 +326,16 @@ Logger::Logger(std::unique_ptr<santa::SleighLauncher> sleigh_launcher,
       telemetry_mask_(telemetry_mask),
       serializer_(std::move(serializer)),
       writer_(std::move(writer)),
+      aggregator_(std::make_shared<TelemetryAggregator>()),
       tracker_(ExportTracker::Create()),
       export_batch_threshold_size_bytes_(std::make_unique<std::atomic_uint64_t>()),
       export_max_files_per_batch_(std::make_unique<std::atomic_uint32_t>()),
-      export_timeout_secs_(std::make_unique<std::atomic_uint32_t>()) {
+      export_timeout_secs_(std::make_unique<std::atomic_uint32_t>()),
+      streaming_export_delay_secs_(std::make_unique<std::atomic_uint32_t>(0)),
+      streaming_export_pending_(std::make_unique<std::atomic_bool>(false)),
+      export_max_concurrent_(std::make_unique<std::atomic_uint32_t>(1)),
+      export_bandwidth_limit_kbps_(std::make_unique<std::atomic_uint32_t>(0)),
+      export_constrained_([] { return false; }) {
   // Provide a default block instead of leaving nil
   if (get_export_config_block_ == nil) {
     get_export_config_block_ = ^SNTExportConfiguration*() {
@@ -213,10 +396,168 @@ void Logger::SetTelmetryExportTimeoutSecs(uint32_t val) {
   export_timeout_secs_->store(new_val, std::memory_order_relaxed);
 }
 
+void Logger::SetMaxConcurrentExports(uint32_t val) {
+  static constexpr uint32_t concurrent_min = 1;
+
+  uint32_t new_val = std::clamp(val, concurrent_min, kMaxConcurrentExports);
+  if (new_val != val) {
+    LOGW(@"Export max concurrent batches must be between %u and %u. Clamped to: %u",
+         concurrent_min, kMaxConcurrentExports, new_val);
+  }
+
+  export_max_concurrent_->store(new_val, std::memory_order_relaxed);
+}
+
+void Logger::SetExportBandwidthLimitKBps(uint32_t val) {
+  export_bandwidth_limit_kbps_->store(val, std::memory_order_relaxed);
+}
+
+void Logger::SetStreamingExportDelaySecs(uint32_t delay_secs) {
+  uint32_t new_val = std::min(delay_secs, kMaxStreamingExportDelaySecs);
+  if (new_val != delay_secs) {
+    LOGW(@"Streaming export delay must be at most %u seconds. Clamped to: %u",
+         kMaxStreamingExportDelaySecs, new_val);
+  }
+
+  streaming_export_delay_secs_->store(new_val, std::memory_order_relaxed);
+
+  if (!spool_closed_source_ || new_val == 0) {
+    return;
+  }
+
+  std::weak_ptr<Logger> weak_self = weak_from_base<Logger>();
+  dispatch_source_set_event_handler(spool_closed_source_, ^{
+    if (std::shared_ptr<Logger> strong_self = weak_self.lock()) {
+      strong_self->ScheduleStreamingExport(weak_self);
+    }
+  });
+}
+
+void Logger::ScheduleStreamingExport(std::weak_ptr<Logger> weak_self) {
+  uint32_t delay_secs = streaming_export_delay_secs_->load(std::memory_order_relaxed);
+  // Files closed while an export is already scheduled are picked up by it.
+  if (delay_secs == 0 || streaming_export_pending_->exchange(true)) {
+    return;
+  }
+
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, delay_secs * NSEC_PER_SEC),
+                 streaming_export_queue_, ^{
+                   std::shared_ptr<Logger> strong_self = weak_self.lock();
+                   if (!strong_self) {
+                     return;
+                   }
+
+                   // Cleared before exporting so that files closed during the export schedule
+                   // another one.
+                   strong_self->streaming_export_pending_->store(false);
+
+                   // The export timer is only running while telemetry export is enabled.
+                   if (strong_self->IsStarted()) {
+                     strong_self->ExportTelemetry();
+                   }
+                 });
+}
+
+Logger::~Logger() {
+  if (spool_closed_source_) {
+    dispatch_source_cancel(spool_closed_source_);
+  }
+  if (export_path_monitor_) {
+    nw_path_monitor_cancel(export_path_monitor_);
+  }
+  if (aggregation_timer_) {
+    dispatch_source_cancel(aggregation_timer_);
+  }
+  if (flow_aggregation_timer_) {
+    dispatch_source_cancel(flow_aggregation_timer_);
+  }
+}
+
 void Logger::SetTelemetryMask(TelemetryEvent mask) {
   telemetry_mask_ = mask;
 }
 
+void Logger::SetTelemetrySampleRates(NSDictionary<NSString*, NSNumber*>* rates) {
+  aggregator_->SetSampleRate(TelemetryEvent::kEverything, 1);
+  for (NSString* event_name in rates) {
+    aggregator_->SetSampleRate(TelemetryConfigToBitmask(@[ event_name ]),
+                               [rates[event_name] unsignedIntValue]);
+  }
+}
+
+void Logger::SetTelemetryAggregatedEvents(TelemetryEvent mask) {
+  aggregator_->SetAggregatedEvents(mask);
+}
+
+void Logger::SetLoadShedding(TelemetryEvent events, size_t backlog_threshold) {
+  aggregator_->SetLoadShedding(events, backlog_threshold);
+}
+
+std::vector<std::pair<TelemetryEvent, uint64_t>> Logger::GetShedCounts() const {
+  return aggregator_->ShedCounts();
+}
+
+void Logger::StartEventAggregation(uint32_t window_secs) {
+  dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.event_aggregation",
+                                             DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+  aggregation_timer_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
+
+  // Weak, so that a timer firing as the logger is destroyed doesn't extend
+  // the lifetime of its parts.
+  std::weak_ptr<TelemetryAggregator> weak_aggregator = aggregator_;
+  std::weak_ptr<Serializer> weak_serializer = serializer_;
+  std::weak_ptr<Writer> weak_writer = writer_;
+  dispatch_source_set_event_handler(aggregation_timer_, ^{
+    std::shared_ptr<TelemetryAggregator> aggregator = weak_aggregator.lock();
+    std::shared_ptr<Serializer> serializer = weak_serializer.lock();
+    std::shared_ptr<Writer> writer = weak_writer.lock();
+    if (aggregator && serializer && writer) {
+      WriteEventSummaries(*aggregator, *serializer, *writer);
+    }
+  });
+
+  uint64_t interval_ns = window_secs * NSEC_PER_SEC;
+  dispatch_source_set_timer(aggregation_timer_, dispatch_time(DISPATCH_TIME_NOW, interval_ns),
+                            interval_ns, interval_ns / 10);
+  dispatch_resume(aggregation_timer_);
+}
+
+void Logger::LogEventSummaries() {
+  WriteEventSummaries(*aggregator_, *serializer_, *writer_);
+}
+
+void Logger::StartNetworkFlowAggregation(uint32_t window_secs) {
+  flow_aggregator_ = std::make_shared<NetworkFlowAggregator>();
+
+  dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.flow_aggregation",
+                                             DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+  flow_aggregation_timer_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
+
+  std::weak_ptr<NetworkFlowAggregator> weak_aggregator = flow_aggregator_;
+  std::weak_ptr<Serializer> weak_serializer = serializer_;
+  std::weak_ptr<Writer> weak_writer = writer_;
+  dispatch_source_set_event_handler(flow_aggregation_timer_, ^{
+    std::shared_ptr<NetworkFlowAggregator> aggregator = weak_aggregator.lock();
+    std::shared_ptr<Serializer> serializer = weak_serializer.lock();
+    std::shared_ptr<Writer> writer = weak_writer.lock();
+    if (aggregator && serializer && writer) {
+      WriteNetworkActivity(*aggregator, *serializer, *writer);
+    }
+  });
+
+  uint64_t interval_ns = window_secs * NSEC_PER_SEC;
+  dispatch_source_set_timer(flow_aggregation_timer_,
+                            dispatch_time(DISPATCH_TIME_NOW, interval_ns), interval_ns,
+                            interval_ns / 10);
+  dispatch_resume(flow_aggregation_timer_);
+}
+
+void Logger::LogAggregatedNetworkFlows() {
+  if (flow_aggregator_) {
+    WriteNetworkActivity(*flow_aggregator_, *serializer_, *writer_);
+  }
+}
+
 bool Logger::OnTimer() {
   ExportTelemetry();
   return true;
@@ -228,6 +569,45 @@ void Logger::ExportTelemetry() {
   });
 }
 
+std::vector<std::string> Logger::NextExportBatch(uint32_t max_files, uint64_t max_bytes,
+                                                 uint64_t* batch_bytes, bool* batch_full) {
+  std::vector<std::string> files_to_export;
+  *batch_bytes = 0;
+  *batch_full = false;
+
+  while (std::optional<std::string> file_to_export = writer_->NextFileToExport()) {
+    NSString* path = @((*file_to_export).c_str());
+
+    struct stat sb;
+    if (stat(path.fileSystemRepresentation, &sb) != 0) {
+      LOGW(@"Failed to stat telemetry file to export: %@", path);
+      tracker_.AckCompleted(*file_to_export);
+      continue;
+    }
+
+    if (!S_ISREG(sb.st_mode)) {
+      LOGW(@"Telemetry file to export is not a regular file: %@", path);
+      tracker_.AckCompleted(*file_to_export);
+      continue;
+    }
+
+    // Track all files as initially unsuccessfully processed
+    // in case the export times out.
+    tracker_.Track(*file_to_export);
+
+    files_to_export.push_back(*file_to_export);
+    *batch_bytes += sb.st_size;
+
+    if (files_to_export.size() >= max_files || *batch_bytes >= max_bytes) {
+      // Current batch is full
+      *batch_full = true;
+      break;
+    }
+  }
+
+  return files_to_export;
+}
+
 void Logger::ExportTelemetrySerialized() {
   // Check if sleigh launcher is available
   if (!sleigh_launcher_) {
@@ -242,75 +622,164 @@ void Logger::ExportTelemetrySerialized() {
     return;
   }
 
+  if (std::chrono::steady_clock::now() < export_resume_time_) {
+    LOGD(@"Deferring telemetry export to stay under the bandwidth limit");
+    return;
+  }
+
   uint32_t max_files_per_batch = export_max_files_per_batch_->load(std::memory_order_relaxed);
   uint64_t max_batch_size_bytes =
       export_batch_threshold_size_bytes_->load(std::memory_order_relaxed);
+
+  // Merge small spool files so that a full batch isn't made of many tiny files.
+  uint64_t compacted_file_size =
+      std::max(max_batch_size_bytes / max_files_per_batch, kMinCompactedFileSizeBytes);
+  if (size_t merged = writer_->CompactSpool(compacted_file_size); merged > 0) {
+    LOGD(@"Compacted %zu telemetry files before export", merged);
+  }
+  uint32_t timeout_secs = export_timeout_secs_->load(std::memory_order_relaxed);
+  uint32_t bandwidth_limit_kbps = export_bandwidth_limit_kbps_->load(std::memory_order_relaxed);
   bool continue_processing = true;
 
   while (continue_processing) {
-    uint64_t total_bytes = 0;
-    std::vector<std::string> files_to_export;
+    uint32_t batch_max_files = std::max(max_files_per_batch >> export_batch_shrink_shift_, 1U);
+    uint64_t batch_max_bytes = std::max(max_batch_size_bytes >> export_batch_shrink_shift_,
+                                        std::min(max_batch_size_bytes, kMinShrunkBatchSizeBytes));
 
-    continue_processing = false;
+    // Batches are taken oldest-first, so the files the spool would evict next are always in the
+    // current round.
+    size_t max_batches =
+        export_constrained_() ? 1 : export_max_concurrent_->load(std::memory_order_relaxed);
+    std::vector<std::vector<std::string>> batches;
+    uint64_t round_bytes = 0;
 
-    while (std::optional<std::string> file_to_export = writer_->NextFileToExport()) {
-      NSString* path = @((*file_to_export).c_str());
-
-      struct stat sb;
-      if (stat(path.fileSystemRepresentation, &sb) != 0) {
-        LOGW(@"Failed to stat telemetry file to export: %@", path);
-        tracker_.AckCompleted(*file_to_export);
-        continue;
-      }
+    continue_processing = false;
 
-      if (!S_ISREG(sb.st_mode)) {
-        LOGW(@"Telemetry file to export is not a regular file: %@", path);
-        tracker_.AckCompleted(*file_to_export);
-        continue;
+    while (batches.size() < max_batches) {
+      uint64_t batch_bytes = 0;
+      bool batch_full = false;
+      std::vector<std::string> batch =
+          NextExportBatch(batch_max_files, batch_max_bytes, &batch_bytes, &batch_full);
+      if (batch.empty()) {
+        break;
       }
 
-      // Track all files as initially unsuccessfully processed
-      // in case the export times out.
-      tracker_.Track(*file_to_export);
-
-      files_to_export.push_back(*file_to_export);
-      total_bytes += sb.st_size;
-
-      if (files_to_export.size() >= max_files_per_batch || total_bytes >= max_batch_size_bytes) {
-        // Current batch is full
-        continue_processing = true;
+      batches.push_back(std::move(batch));
+      round_bytes += batch_bytes;
+      continue_processing = batch_full;
+      if (!batch_full) {
         break;
       }
     }
 
-    if (files_to_export.empty()) {
+    if (batches.empty()) {
       // Nothing left to process
       // Drain the tracker in case there were non-uploadable files encountered
       writer_->FilesExported(tracker_.Drain());
       break;
     }
 
-    // Launch sleigh
-    absl::Status result = sleigh_launcher_->LaunchTelemetryExport(
-        files_to_export, export_timeout_secs_->load(std::memory_order_relaxed));
-
-    if (result.ok()) {
-      LOGD(@"Successfully exported %zu telemetry files via sleigh", files_to_export.size());
-      for (const auto& file : files_to_export) {
-        tracker_.AckCompleted(file);
+    // Launch sleigh for each batch. With a single batch this runs inline.
+    auto round_start = std::chrono::steady_clock::now();
+    std::vector<absl::Status> results(batches.size());
+    const std::vector<std::string>* batches_ptr = batches.data();
+    absl::Status* results_ptr = results.data();
+    santa::SleighLauncher* sleigh_launcher = sleigh_launcher_.get();
+    dispatch_apply(batches.size(), DISPATCH_APPLY_AUTO, ^(size_t i) {
+      results_ptr[i] = sleigh_launcher->LaunchTelemetryExport(batches_ptr[i], timeout_secs);
+    });
+
+    bool round_failed = false;
+    for (size_t i = 0; i < batches.size(); i++) {
+      if (results[i].ok()) {
+        LOGD(@"Successfully exported %zu telemetry files via sleigh", batches[i].size());
+        for (const auto& file : batches[i]) {
+          tracker_.AckCompleted(file);
+        }
+      } else {
+        LOGE(@"Failed to export telemetry via sleigh: %s",
+             std::string(results[i].message()).c_str());
+        // Don't continue processing after a failure
+        continue_processing = false;
+        round_failed = true;
       }
-    } else {
-      LOGE(@"Failed to export telemetry via sleigh: %s", std::string(result.message()).c_str());
-      // Don't continue processing after a failure
-      continue_processing = false;
     }
 
+    // Files of successful batches are acknowledged now, so a retry only resends the failed ones.
     writer_->FilesExported(tracker_.Drain());
+
+    if (round_failed) {
+      if (export_batch_shrink_shift_ < kMaxExportBatchShrinkShift) {
+        export_batch_shrink_shift_++;
+        LOGW(@"Telemetry export failed, retrying with batches of at most %u files",
+             std::max(max_files_per_batch >> export_batch_shrink_shift_, 1U));
+      }
+    } else if (export_batch_shrink_shift_ > 0) {
+      export_batch_shrink_shift_--;
+    }
+
+    if (bandwidth_limit_kbps > 0) {
+      // Sleigh uploads each batch as fast as it can, so the limit is held on average by deferring
+      // the next round until this one's bytes would have been sent at the limit. The export timer
+      // or next closed spool file resumes the export.
+      uint64_t round_ms = round_bytes * 1000 / (bandwidth_limit_kbps * 1024ULL);
+      export_resume_time_ = round_start + std::chrono::milliseconds(round_ms);
+      if (continue_processing && std::chrono::steady_clock::now() < export_resume_time_) {
+        LOGD(@"Pausing telemetry export to stay under %u KB/s", bandwidth_limit_kbps);
+        break;
+      }
+    }
+  }
+}
+
+void Logger::StartLogQueue(size_t capacity,
+                           LogQueue<std::unique_ptr<EnrichedMessage>>::FullPolicy policy) {
+  std::shared_ptr<Serializer> serializer = serializer_;
+  std::shared_ptr<Writer> writer = writer_;
+  log_queue_ = std::make_shared<LogQueue<std::unique_ptr<EnrichedMessage>>>(
+      capacity, policy, [serializer, writer](std::unique_ptr<EnrichedMessage> msg) {
+        writer->Write(serializer->SerializeMessage(std::move(msg)));
+      });
+}
+
+std::optional<LogQueueStats> Logger::GetLogQueueStats() const {
+  if (!log_queue_) {
+    return std::nullopt;
   }
+  return log_queue_->Stats();
+}
+
+size_t Logger::Backlog() const {
+  size_t queued = log_queue_ ? log_queue_->Stats().depth : 0;
+  return std::max(queued, writer_->PendingWrites());
 }
 
 void Logger::Log(std::unique_ptr<EnrichedMessage> msg) {
-  if (ShouldLog(msg->GetTelemetryEvent())) {
+  TelemetryEvent event = msg->GetTelemetryEvent();
+  if (!ShouldLog(event)) {
+    return;
+  }
+
+  if (aggregator_->IsAggregated(event)) {
+    const es_message_t* es_msg = std::visit(
+        [](const auto& enriched) { return enriched.operator->(); }, msg->GetEnrichedMessage());
+    aggregator_->Aggregate(event, StringTokenToStringView(es_msg->process->executable->path),
+                           AggregationTargetPath(es_msg));
+    return;
+  }
+
+  if (!aggregator_->Sample(event)) {
+    return;
+  }
+
+  if (aggregator_->IsSheddable(event) && aggregator_->Shed(event, Backlog())) {
+    return;
+  }
+
+  if (log_queue_) {
+    log_queue_->Enqueue(std::move(msg),
+                        (event & UnsheddableTelemetryEvents()) == TelemetryEvent::kNone);
+  } else {
     writer_->Write(serializer_->SerializeMessage(std::move(msg)));
   }
 }
@@ -342,11 +811,32 @@ void Logger::LogDiskDisappeared(NSDictionary* props) {
   }
 }
 
+void Logger::LogExecTrace(const ExecTrace::Summary& trace) {
+  writer_->Write(serializer_->SerializeExecTrace(trace));
+}
+
 void Logger::LogNetworkFlows(SNDProcessFlows* processFlows, struct timespec window_start,
                              struct timespec window_end) {
+  if (flow_aggregator_ &&
+      serializer_->AggregateNetworkFlows(*flow_aggregator_, processFlows, window_start,
+                                         window_end)) {
+    return;
+  }
   writer_->Write(serializer_->SerializeNetworkFlows(processFlows, window_start, window_end));
 }
 
+void Logger::LogNetworkActivity(const ::santa::pb::v1::NetworkActivity::Process& process,
+                                struct timespec window_start, struct timespec window_end) {
+  if (flow_aggregator_ && flow_aggregator_->Add(process, window_start, window_end)) {
+    return;
+  }
+  writer_->Write(serializer_->SerializeNetworkActivity({
+      .start = window_start,
+      .end = window_end,
+      .processes = {process},
+  }));
+}
+
 void Logger::LogFileAccess(const std::string& policy_version, const std::string& policy_name,
                            const santa::Message& msg,
                            const santa::EnrichedProcess& enriched_process, size_t target_index,
@@ -360,6 +850,11 @@ void Logger::LogFileAccess(const std::string& policy_version, const std::string&
 }
 
 void Logger::Flush() {
+  if (log_queue_) {
+    log_queue_->Drain();
+  }
+  LogEventSummaries();
+  LogAggregatedNetworkFlows();
   writer_->Flush();
 }
 
@@ -27,20 +27,25 @@
 
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTExportConfiguration.h"
+#include "Source/common/santa.pb.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/common/TestUtils.h"
 #include "Source/common/es/EnrichedTypes.h"
 #include "Source/common/es/Message.h"
 #include "Source/common/es/MockEndpointSecurityAPI.h"
 #include "Source/santad/Logs/EndpointSecurity/Logger.h"
+#include "Source/santad/Logs/EndpointSecurity/NetworkFlowAggregator.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/BasicString.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Empty.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/UnifiedLog.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Null.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/ShardedSpool.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Spool.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Syslog.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
@@ -52,16 +57,24 @@ using santa::EnrichedClose;
 using santa::EnrichedFile;
 using santa::EnrichedMessage;
 using santa::EnrichedProcess;
+using santa::EventSummary;
 using santa::File;
 using santa::Logger;
 using santa::Message;
+using santa::NetworkFlowAggregator;
 using santa::Null;
 using santa::Protobuf;
+using santa::ShardedSpool;
 using santa::Spool;
 using santa::Syslog;
 using santa::TelemetryEvent;
+using santa::UnifiedLog;
+using testing::AllOf;
+using testing::Field;
+using testing::Invoke;
 using testing::Pair;
 using testing::Return;
+using testing::SizeIs;
 using testing::UnorderedElementsAre;
 using ExportLogType = ::santa::Logger::ExportLogType;
 
@@ -71,11 +84,13 @@ class LoggerPeer : public Logger {
  public:
   // Make base class constructors and members visible
   using Logger::export_batch_threshold_size_bytes_;
+  using Logger::export_max_concurrent_;
   using Logger::export_max_files_per_batch_;
   using Logger::export_timeout_secs_;
   using Logger::ExportTelemetrySerialized;
   using Logger::Logger;
   using Logger::serializer_;
+  using Logger::streaming_export_delay_secs_;
   using Logger::tracker_;
   using Logger::writer_;
 
@@ -102,6 +117,20 @@ class MockSerializer : public Empty {
   MOCK_METHOD(std::vector<uint8_t>, SerializeBundleHashingEvent, (SNTStoredExecutionEvent*));
   MOCK_METHOD(std::vector<uint8_t>, SerializeDiskAppeared, (NSDictionary*, bool));
   MOCK_METHOD(std::vector<uint8_t>, SerializeDiskDisappeared, (NSDictionary*));
+  MOCK_METHOD(std::vector<uint8_t>, SerializeEventSummary,
+              (const EventSummary&, struct timespec, struct timespec), (override));
+  MOCK_METHOD(std::vector<uint8_t>, SerializeExecTrace, (const santa::ExecTrace::Summary&),
+              (override));
+
+  MOCK_METHOD(std::vector<uint8_t>, SerializeNetworkFlows,
+              (SNDProcessFlows*, struct timespec, struct timespec, SNTCachedDecision*),
+              (override));
+  MOCK_METHOD(bool, AggregateNetworkFlows,
+              (NetworkFlowAggregator&, SNDProcessFlows*, struct timespec, struct timespec,
+               SNTCachedDecision*),
+              (override));
+  MOCK_METHOD(std::vector<uint8_t>, SerializeNetworkActivity,
+              (const NetworkFlowAggregator::Window&), (override));
 
   MOCK_METHOD(std::vector<uint8_t>, SerializeFileAccess,
               (const std::string& policy_version, const std::string& policy_name,
@@ -196,59 +225,81 @@ class MockSleighLauncher : public santa::SleighLauncher {
   // Ensure that the factory method creates expected serializers/writers pairs
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
 
-  XCTAssertEqual(nullptr, Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
+  XCTAssertEqual(nullptr, Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
                                          (SNTEventLogType)123, nil, @"/tmp/temppy", @"/tmp/spool",
-                                         1, 1, 1, 1, 1, 1, 1));
+                                         1, 1, 1, 1, 1, 1, 1, 1, nil));
 
-  LoggerPeer logger(Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
+  LoggerPeer logger(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
                                    SNTEventLogTypeFilelog, nil, @"/tmp/temppy", @"/tmp/spool", 1, 1,
-                                   1, 1, 1, 1, 1));
+                                   1, 1, 1, 1, 1, 1, nil));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<BasicString>(logger.serializer_));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<File>(logger.writer_));
 
-  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
                                      SNTEventLogTypeSyslog, nil, @"/tmp/temppy", @"/tmp/spool", 1,
-                                     1, 1, 1, 1, 1, 1));
+                                     1, 1, 1, 1, 1, 1, 1, nil));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<BasicString>(logger.serializer_));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Syslog>(logger.writer_));
 
-  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
+                                     SNTEventLogTypeUnifiedLog, nil, @"/tmp/temppy", @"/tmp/spool",
+                                     1, 1, 1, 1, 1, 1, 1, 1, nil));
+  XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<UnifiedLog>(logger.serializer_));
+  XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Syslog>(logger.writer_));
+
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
                                      SNTEventLogTypeNull, nil, @"/tmp/temppy", @"/tmp/spool", 1, 1,
-                                     1, 1, 1, 1, 1));
+                                     1, 1, 1, 1, 1, 1, nil));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Empty>(logger.serializer_));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Null>(logger.writer_));
 
-  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
                                      SNTEventLogTypeProtobuf, nil, @"/tmp/temppy", @"/tmp/spool", 1,
-                                     1, 1, 1, 1, 1, 1));
+                                     1, 1, 1, 1, 1, 1, 1, nil));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Protobuf>(logger.serializer_));
   XCTAssertNotEqual(nullptr,
                     std::dynamic_pointer_cast<Spool<::fsspool::AnyBatcher>>(logger.writer_));
 
-  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
                                      SNTEventLogTypeProtobufStream, nil, @"/tmp/temppy",
-                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1));
+                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1, 1, nil));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Protobuf>(logger.serializer_));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Spool<::fsspool::UncompressedStreamBatcher>>(
                                  logger.writer_));
 
-  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
                                      SNTEventLogTypeProtobufStreamGzip, nil, @"/tmp/temppy",
-                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1));
+                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1, 1, nil));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Protobuf>(logger.serializer_));
   XCTAssertNotEqual(nullptr,
                     std::dynamic_pointer_cast<Spool<::fsspool::GzipStreamBatcher>>(logger.writer_));
 
-  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
                                      SNTEventLogTypeProtobufStreamZstd, nil, @"/tmp/temppy",
-                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1));
+                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1, 1, nil));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Protobuf>(logger.serializer_));
   XCTAssertNotEqual(nullptr,
                     std::dynamic_pointer_cast<Spool<::fsspool::ZstdStreamBatcher>>(logger.writer_));
 
-  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
+                                     SNTEventLogTypeProtobufColumnar, nil, @"/tmp/temppy",
+                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1, 1, nil));
+  XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Protobuf>(logger.serializer_));
+  XCTAssertNotEqual(nullptr,
+                    std::dynamic_pointer_cast<Spool<::fsspool::ColumnarBatcher>>(logger.writer_));
+
+  // More than one spool shard creates a sharded spool.
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
+                                     SNTEventLogTypeProtobufStreamZstd, nil, @"/tmp/temppy",
+                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1, 4, nil));
+  auto sharded =
+      std::dynamic_pointer_cast<ShardedSpool<::fsspool::ZstdStreamBatcher>>(logger.writer_);
+  XCTAssertNotEqual(nullptr, sharded);
+  XCTAssertEqual(sharded->NumShards(), 4);
+
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
                                      SNTEventLogTypeJSON, nil, @"/tmp/temppy", @"/tmp/spool", 1, 1,
-                                     1, 1, 1, 1, 1));
+                                     1, 1, 1, 1, 1, 1, nil));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Protobuf>(logger.serializer_));
   XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<File>(logger.writer_));
 }
@@ -267,7 +318,7 @@ class MockSleighLauncher : public santa::SleighLauncher {
     auto enrichedMsg = std::make_unique<EnrichedMessage>(EnrichedClose(
         Message(mockESApi, &msg),
         EnrichedProcess(std::nullopt, std::nullopt, std::nullopt, std::nullopt,
-                        EnrichedFile(std::nullopt, std::nullopt, std::nullopt), std::nullopt),
+                        EnrichedFile(std::nullopt, std::nullopt, std::nullopt), nullptr),
         EnrichedFile(std::nullopt, std::nullopt, std::nullopt)));
 
     EXPECT_CALL(*mockSerializer, SerializeMessage(testing::A<const EnrichedClose&>())).Times(1);
@@ -282,6 +333,139 @@ class MockSleighLauncher : public santa::SleighLauncher {
   XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
 }
 
+- (void)testLogSampledAndAggregatedEvents {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  auto mockSerializer = std::make_shared<MockSerializer>();
+  auto mockWriter = std::make_shared<MockWriter>();
+
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  es_file_t procFile = MakeESFile("/usr/bin/make");
+  es_file_t targetFile = MakeESFile("/tmp/out");
+  es_process_t proc = MakeESProcess(&procFile);
+  es_message_t msg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  msg.event.close.target = &targetFile;
+
+  auto makeClose = [&] {
+    return std::make_unique<EnrichedMessage>(EnrichedClose(
+        Message(mockESApi, &msg),
+        EnrichedProcess(std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+                        EnrichedFile(std::nullopt, std::nullopt, std::nullopt), nullptr),
+        EnrichedFile(std::nullopt, std::nullopt, std::nullopt)));
+  };
+
+  Logger logger(nil, nil, TelemetryEvent::kEverything, 1, 1, 1, mockSerializer, mockWriter);
+
+  // Only one of every four events is logged
+  logger.SetTelemetrySampleRates(@{@"Close" : @4});
+  EXPECT_CALL(*mockSerializer, SerializeMessage(testing::A<const EnrichedClose&>())).Times(2);
+  EXPECT_CALL(*mockWriter, Write).Times(2);
+  for (int i = 0; i < 8; i++) {
+    logger.Log(makeClose());
+  }
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSerializer.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+
+  // Aggregated events are counted and only logged as a summary
+  logger.SetTelemetryAggregatedEvents(TelemetryEvent::kClose);
+  EXPECT_CALL(*mockSerializer, SerializeMessage(testing::A<const EnrichedClose&>())).Times(0);
+  EXPECT_CALL(*mockSerializer,
+              SerializeEventSummary(AllOf(Field(&EventSummary::executable_path, "/usr/bin/make"),
+                                          Field(&EventSummary::event, TelemetryEvent::kClose),
+                                          Field(&EventSummary::count, 3)),
+                                    testing::_, testing::_))
+      .Times(1);
+  EXPECT_CALL(*mockWriter, Write).Times(1);
+  for (int i = 0; i < 3; i++) {
+    logger.Log(makeClose());
+  }
+  logger.LogEventSummaries();
+
+  // Nothing is left over for the next window
+  logger.LogEventSummaries();
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockSerializer.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
+- (void)testLogNetworkFlowsAggregated {
+  auto mockSerializer = std::make_shared<MockSerializer>();
+  auto mockWriter = std::make_shared<MockWriter>();
+  Logger logger(nil, nil, TelemetryEvent::kEverything, 1, 1, 1, mockSerializer, mockWriter);
+
+  // Without aggregation, flows are logged as they are reported
+  EXPECT_CALL(*mockSerializer, AggregateNetworkFlows).Times(0);
+  EXPECT_CALL(*mockSerializer, SerializeNetworkFlows).Times(1);
+  EXPECT_CALL(*mockWriter, Write).Times(1);
+  logger.LogNetworkFlows(nil, {}, {});
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSerializer.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+
+  // Merged flows are only logged when drained, and flows the serializer could
+  // not merge are still logged as they are reported
+  logger.StartNetworkFlowAggregation(3600);
+  EXPECT_CALL(*mockSerializer, AggregateNetworkFlows)
+      .WillOnce(Invoke([](NetworkFlowAggregator& aggregator, SNDProcessFlows*,
+                          struct timespec window_start, struct timespec window_end,
+                          SNTCachedDecision*) {
+        ::santa::pb::v1::NetworkActivity::Process process;
+        process.add_flows()->set_remote_address("10.0.0.1");
+        return aggregator.Add(process, window_start, window_end);
+      }))
+      .WillOnce(Return(false));
+  EXPECT_CALL(*mockSerializer, SerializeNetworkFlows).Times(1);
+  EXPECT_CALL(*mockSerializer,
+              SerializeNetworkActivity(Field(&NetworkFlowAggregator::Window::processes, SizeIs(1))))
+      .Times(1);
+  EXPECT_CALL(*mockWriter, Write).Times(2);
+  EXPECT_CALL(*mockWriter, Flush).Times(1);
+  logger.LogNetworkFlows(nil, {}, {});
+  logger.LogNetworkFlows(nil, {}, {});
+  logger.Flush();
+
+  // Nothing is left over for the next window
+  logger.LogAggregatedNetworkFlows();
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSerializer.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
+- (void)testLogNetworkActivity {
+  auto mockSerializer = std::make_shared<MockSerializer>();
+  auto mockWriter = std::make_shared<MockWriter>();
+  Logger logger(nil, nil, TelemetryEvent::kEverything, 1, 1, 1, mockSerializer, mockWriter);
+
+  ::santa::pb::v1::NetworkActivity::Process process;
+  process.add_flows()->set_remote_address("10.0.0.1");
+
+  // Without aggregation, each process is logged on its own
+  EXPECT_CALL(*mockSerializer,
+              SerializeNetworkActivity(Field(&NetworkFlowAggregator::Window::processes, SizeIs(1))))
+      .Times(2);
+  EXPECT_CALL(*mockWriter, Write).Times(2);
+  logger.LogNetworkActivity(process, {}, {});
+  logger.LogNetworkActivity(process, {}, {});
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSerializer.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+
+  // With aggregation, they are merged and logged when drained
+  logger.StartNetworkFlowAggregation(3600);
+  EXPECT_CALL(*mockSerializer,
+              SerializeNetworkActivity(Field(&NetworkFlowAggregator::Window::processes, SizeIs(1))))
+      .Times(1);
+  EXPECT_CALL(*mockWriter, Write).Times(1);
+  logger.LogNetworkActivity(process, {}, {});
+  logger.LogNetworkActivity(process, {}, {});
+  logger.LogAggregatedNetworkFlows();
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSerializer.get());
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
 - (void)testLogAllowList {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   auto mockSerializer = std::make_shared<MockSerializer>();
@@ -360,7 +544,7 @@ class MockSleighLauncher : public santa::SleighLauncher {
       .LogFileAccess(
           "v1", "name", Message(mockESApi, &msg),
           EnrichedProcess(std::nullopt, std::nullopt, std::nullopt, std::nullopt,
-                          EnrichedFile(std::nullopt, std::nullopt, std::nullopt), std::nullopt),
+                          EnrichedFile(std::nullopt, std::nullopt, std::nullopt), nullptr),
           0, EnrichedFile(std::nullopt, std::nullopt, std::nullopt),
           FileAccessPolicyDecision::kDenied, 0);
 
@@ -370,8 +554,9 @@ class MockSleighLauncher : public santa::SleighLauncher {
 
 - (void)testExportTracker {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
-  LoggerPeer logger(Logger::Create(mockESApi, nil, nil, nil, TelemetryEvent::kEverything,
-                                   SNTEventLogTypeNull, nil, @"", @"", 1, 1, 1, 1, 1, 1, 1));
+  LoggerPeer logger(Logger::Create(mockESApi, nil, nil, nil, nil, TelemetryEvent::kEverything,
+                                   SNTEventLogTypeNull, nil, @"", @"", 1, 1, 1, 1, 1, 1, 1, 1,
+                                   nil));
 
   // Nothing in the map initially
   auto map = logger.tracker_.Drain();
@@ -493,6 +678,88 @@ class MockSleighLauncher : public santa::SleighLauncher {
   XCTBubbleMockVerifyAndClearExpectations(mockSleighPtr);
 }
 
+- (void)testExportConcurrentBatches {
+  auto mockWriter = std::make_shared<MockWriter>();
+  auto mockSleigh = std::make_unique<MockSleighLauncher>();
+  MockSleighLauncher* mockSleighPtr = mockSleigh.get();
+
+  // With one file per batch and up to 2 batches at once, f1 and f2 are exported in the
+  // first round and f3 in the second.
+  NSString* f1 = [self createTestFile:@"f1" contentSize:5 type:ExportLogType::kZstdStream];
+  NSString* f2 = [self createTestFile:@"f2" contentSize:10 type:ExportLogType::kZstdStream];
+  NSString* f3 = [self createTestFile:@"f3" contentSize:15 type:ExportLogType::kZstdStream];
+
+  EXPECT_CALL(*mockSleighPtr, LaunchTelemetryExport)
+      .Times(3)
+      .WillRepeatedly(Return(absl::OkStatus()));
+
+  LoggerPeer l(std::move(mockSleigh), self.exportConfigBlock, TelemetryEvent::kEverything, 5, 1, 1,
+               nullptr, mockWriter);
+  l.SetMaxConcurrentExports(2);
+
+  EXPECT_CALL(*mockWriter, NextFileToExport)
+      .WillOnce(Return(f1.UTF8String))
+      .WillOnce(Return(f2.UTF8String))
+      .WillOnce(Return(f3.UTF8String))
+      .WillOnce(Return(std::nullopt));
+
+  EXPECT_CALL(*mockWriter, FilesExported(UnorderedElementsAre(Pair(f3.UTF8String, true))))
+      .After(EXPECT_CALL(*mockWriter, FilesExported(UnorderedElementsAre(
+                                          Pair(f1.UTF8String, true), Pair(f2.UTF8String, true)))));
+
+  l.ExportTelemetrySerialized();
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSleighPtr);
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
+- (void)testExportFailureShrinksBatches {
+  auto mockWriter = std::make_shared<MockWriter>();
+  auto mockSleigh = std::make_unique<MockSleighLauncher>();
+  MockSleighLauncher* mockSleighPtr = mockSleigh.get();
+
+  NSString* f1 = [self createTestFile:@"f1" contentSize:5 type:ExportLogType::kZstdStream];
+  NSString* f2 = [self createTestFile:@"f2" contentSize:10 type:ExportLogType::kZstdStream];
+  NSString* f3 = [self createTestFile:@"f3" contentSize:15 type:ExportLogType::kZstdStream];
+  NSString* f4 = [self createTestFile:@"f4" contentSize:20 type:ExportLogType::kZstdStream];
+
+  // The first export of all 4 files fails. The retry sends half as many files, and once that
+  // succeeds the limit grows back for the rest.
+  EXPECT_CALL(*mockSleighPtr, LaunchTelemetryExport(SizeIs(2), testing::_))
+      .WillOnce(Return(absl::OkStatus()))
+      .WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(*mockSleighPtr, LaunchTelemetryExport(SizeIs(4), testing::_))
+      .WillOnce(Return(absl::InternalError("mock failure")));
+
+  LoggerPeer l(std::move(mockSleigh), self.exportConfigBlock, TelemetryEvent::kEverything, 5, 1, 4,
+               nullptr, mockWriter);
+
+  EXPECT_CALL(*mockWriter, NextFileToExport)
+      .WillOnce(Return(f1.UTF8String))
+      .WillOnce(Return(f2.UTF8String))
+      .WillOnce(Return(f3.UTF8String))
+      .WillOnce(Return(f4.UTF8String))
+      .WillOnce(Return(f1.UTF8String))
+      .WillOnce(Return(f2.UTF8String))
+      .WillOnce(Return(f3.UTF8String))
+      .WillOnce(Return(f4.UTF8String))
+      .WillOnce(Return(std::nullopt));
+
+  EXPECT_CALL(*mockWriter, FilesExported(UnorderedElementsAre(
+                               Pair(f1.UTF8String, false), Pair(f2.UTF8String, false),
+                               Pair(f3.UTF8String, false), Pair(f4.UTF8String, false))));
+  EXPECT_CALL(*mockWriter, FilesExported(UnorderedElementsAre(Pair(f1.UTF8String, true),
+                                                              Pair(f2.UTF8String, true))));
+  EXPECT_CALL(*mockWriter, FilesExported(UnorderedElementsAre(Pair(f3.UTF8String, true),
+                                                              Pair(f4.UTF8String, true))));
+
+  l.ExportTelemetrySerialized();
+  l.ExportTelemetrySerialized();
+
+  XCTBubbleMockVerifyAndClearExpectations(mockSleighPtr);
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
 - (void)testExportMaxOpenedFiles {
   auto mockWriter = std::make_shared<MockWriter>();
   auto mockSleigh = std::make_unique<MockSleighLauncher>();
@@ -665,6 +932,22 @@ class MockSleighLauncher : public santa::SleighLauncher {
   XCTAssertEqual(l.export_timeout_secs_->load(), 600);
   l.SetTelmetryExportTimeoutSecs(250);
   XCTAssertEqual(l.export_timeout_secs_->load(), 250);
+
+  // Streaming export delay must be at most 300 seconds
+  l.SetStreamingExportDelaySecs(1000);
+  XCTAssertEqual(l.streaming_export_delay_secs_->load(), 300);
+  l.SetStreamingExportDelaySecs(5);
+  XCTAssertEqual(l.streaming_export_delay_secs_->load(), 5);
+  l.SetStreamingExportDelaySecs(0);
+  XCTAssertEqual(l.streaming_export_delay_secs_->load(), 0);
+
+  // Max concurrent exports must be between 1 and 8
+  l.SetMaxConcurrentExports(0);
+  XCTAssertEqual(l.export_max_concurrent_->load(), 1);
+  l.SetMaxConcurrentExports(20);
+  XCTAssertEqual(l.export_max_concurrent_->load(), 8);
+  l.SetMaxConcurrentExports(4);
+  XCTAssertEqual(l.export_max_concurrent_->load(), 4);
 }
 
 @end
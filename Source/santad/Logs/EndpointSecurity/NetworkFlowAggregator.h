@@ -0,0 +1,92 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_NETWORKFLOWAGGREGATOR_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_NETWORKFLOWAGGREGATOR_H
+
+#include <time.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Source/common/santa.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+/// Merges the per-window network activity reported by santanetd across
+/// windows, so chatty processes log one record per remote endpoint for each
+/// aggregation window instead of one per flow for every santanetd window.
+///
+/// Flows are keyed by the process (pid and pidversion), the remote address
+/// and port, and the IP protocol. Byte counts reported for a flow are
+/// cumulative, so the most recent counts of each underlying flow are kept and
+/// summed when the table is drained.
+class NetworkFlowAggregator {
+ public:
+  /// Upper bound on the flows tracked between drains, counting every flow
+  /// merged into an entry.
+  static constexpr size_t kMaxFlows = 16384;
+
+  struct Window {
+    struct timespec start;
+    struct timespec end;
+    std::vector<::santa::pb::v1::NetworkActivity::Process> processes;
+  };
+
+  NetworkFlowAggregator() = default;
+
+  NetworkFlowAggregator(const NetworkFlowAggregator&) = delete;
+  NetworkFlowAggregator& operator=(const NetworkFlowAggregator&) = delete;
+
+  /// Merge the flows of a process observed between window_start and
+  /// window_end. Returns false, leaving the table unchanged, if the flows
+  /// would not fit, in which case the caller should log them as they are.
+  bool Add(const ::santa::pb::v1::NetworkActivity::Process& process,
+           struct timespec window_start, struct timespec window_end);
+
+  /// Returns everything merged since the previous call, ordered by process
+  /// and then remote endpoint, or std::nullopt if nothing was.
+  std::optional<Window> Drain();
+
+ private:
+  using ProcessKey = std::pair<int32_t, int32_t>;
+  using FlowKey = std::tuple<ProcessKey, std::string, uint32_t, int32_t>;
+
+  struct Flow {
+    // Endpoint, decision and timestamps of the merged flow. Byte counts are
+    // filled in when drained.
+    ::santa::pb::v1::NetworkActivity::Flow merged;
+    // Latest cumulative inbound and outbound byte counts of each flow merged
+    // into this one, by flow id and hash.
+    absl::flat_hash_map<std::pair<std::string, std::string>, std::pair<uint64_t, uint64_t>> bytes;
+  };
+
+  absl::Mutex mu_;
+  absl::flat_hash_map<ProcessKey, ::santa::pb::v1::ProcessInfo> processes_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<FlowKey, Flow> flows_ ABSL_GUARDED_BY(mu_);
+  size_t num_tracked_ ABSL_GUARDED_BY(mu_) = 0;
+  std::optional<struct timespec> window_start_ ABSL_GUARDED_BY(mu_);
+  struct timespec window_end_ ABSL_GUARDED_BY(mu_) = {};
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_NETWORKFLOWAGGREGATOR_H
@@ -0,0 +1,159 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/NetworkFlowAggregator.h"
+
+#include <algorithm>
+
+namespace pbv1 = ::santa::pb::v1;
+
+namespace santa {
+
+static bool TimespecLess(struct timespec a, struct timespec b) {
+  return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+static bool TimestampLess(const google::protobuf::Timestamp& a,
+                          const google::protobuf::Timestamp& b) {
+  return a.seconds() < b.seconds() || (a.seconds() == b.seconds() && a.nanos() < b.nanos());
+}
+
+bool NetworkFlowAggregator::Add(const pbv1::NetworkActivity::Process& process,
+                                struct timespec window_start, struct timespec window_end) {
+  ProcessKey process_key{process.process().id().pid(), process.process().id().pidversion()};
+
+  absl::MutexLock lock(mu_);
+
+  // Flows not already tracked each need a slot
+  size_t new_flows = 0;
+  for (const pbv1::NetworkActivity::Flow& flow : process.flows()) {
+    auto it = flows_.find(FlowKey{process_key, flow.remote_address(), flow.remote_port(),
+                                  flow.protocol()});
+    if (it == flows_.end() || !it->second.bytes.contains(std::make_pair(flow.id(), flow.hash()))) {
+      new_flows++;
+    }
+  }
+  if (num_tracked_ + new_flows > kMaxFlows) {
+    return false;
+  }
+
+  processes_[process_key] = process.process();
+
+  for (const pbv1::NetworkActivity::Flow& flow : process.flows()) {
+    auto [it, inserted] = flows_.try_emplace(
+        FlowKey{process_key, flow.remote_address(), flow.remote_port(), flow.protocol()});
+    Flow& entry = it->second;
+    pbv1::NetworkActivity::Flow& merged = entry.merged;
+
+    if (inserted) {
+      merged = flow;
+      merged.clear_id();
+      merged.clear_hash();
+    } else {
+      // Ephemeral local ports only identify individual flows
+      if (merged.local_port() != flow.local_port()) {
+        merged.clear_local_port();
+      }
+      if (flow.has_remote_hostname()) {
+        merged.set_remote_hostname(flow.remote_hostname());
+      }
+      if (flow.has_start_time() &&
+          (!merged.has_start_time() || TimestampLess(flow.start_time(), merged.start_time()))) {
+        *merged.mutable_start_time() = flow.start_time();
+      }
+      if (flow.has_close_time() &&
+          (!merged.has_close_time() || TimestampLess(merged.close_time(), flow.close_time()))) {
+        *merged.mutable_close_time() = flow.close_time();
+      }
+
+      // The most recent evaluation wins
+      if (flow.has_decision()) {
+        merged.set_decision(flow.decision());
+        merged.set_decision_tier(flow.decision_tier());
+        merged.set_rule_id(flow.rule_id());
+        merged.set_rule_name(flow.rule_name());
+      }
+    }
+
+    auto [bytes_it, bytes_inserted] = entry.bytes.insert_or_assign(
+        std::make_pair(flow.id(), flow.hash()),
+        std::make_pair(flow.bytes_inbound(), flow.bytes_outbound()));
+    if (bytes_inserted) {
+      num_tracked_++;
+    }
+  }
+
+  if (!window_start_.has_value() || TimespecLess(window_start, *window_start_)) {
+    window_start_ = window_start;
+  }
+  if (TimespecLess(window_end_, window_end)) {
+    window_end_ = window_end;
+  }
+
+  return true;
+}
+
+std::optional<NetworkFlowAggregator::Window> NetworkFlowAggregator::Drain() {
+  absl::flat_hash_map<ProcessKey, pbv1::ProcessInfo> processes;
+  absl::flat_hash_map<FlowKey, Flow> flows;
+  Window window;
+  {
+    absl::MutexLock lock(mu_);
+    if (!window_start_.has_value()) {
+      return std::nullopt;
+    }
+    std::swap(processes, processes_);
+    std::swap(flows, flows_);
+    window.start = *window_start_;
+    window.end = window_end_;
+    num_tracked_ = 0;
+    window_start_.reset();
+    window_end_ = {};
+  }
+
+  std::vector<std::pair<FlowKey, Flow*>> sorted;
+  sorted.reserve(flows.size());
+  for (auto& [key, flow] : flows) {
+    sorted.emplace_back(key, &flow);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  for (auto& [key, flow] : sorted) {
+    const ProcessKey& process_key = std::get<0>(key);
+    if (window.processes.empty() ||
+        std::make_pair(window.processes.back().process().id().pid(),
+                       window.processes.back().process().id().pidversion()) != process_key) {
+      pbv1::NetworkActivity::Process& process = window.processes.emplace_back();
+      *process.mutable_process() = std::move(processes[process_key]);
+    }
+
+    uint64_t bytes_inbound = 0;
+    uint64_t bytes_outbound = 0;
+    for (const auto& [id, bytes] : flow->bytes) {
+      bytes_inbound += bytes.first;
+      bytes_outbound += bytes.second;
+    }
+
+    pbv1::NetworkActivity::Flow* merged = window.processes.back().add_flows();
+    *merged = std::move(flow->merged);
+    merged->set_bytes_inbound(bytes_inbound);
+    merged->set_bytes_outbound(bytes_outbound);
+    merged->set_flow_count(static_cast<uint32_t>(flow->bytes.size()));
+  }
+
+  return window;
+}
+
+}  // namespace santa
@@ -0,0 +1,152 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/NetworkFlowAggregator.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "Source/common/santa.pb.h"
+
+namespace pbv1 = ::santa::pb::v1;
+using santa::NetworkFlowAggregator;
+
+static pbv1::NetworkActivity::Flow* AddFlow(pbv1::NetworkActivity::Process& process,
+                                            std::string id, std::string remote_address,
+                                            uint32_t remote_port, uint64_t bytes_inbound,
+                                            uint64_t bytes_outbound) {
+  pbv1::NetworkActivity::Flow* flow = process.add_flows();
+  flow->set_id(std::move(id));
+  flow->set_hash("hash");
+  flow->set_remote_address(std::move(remote_address));
+  flow->set_remote_port(remote_port);
+  flow->set_protocol(6);
+  flow->set_bytes_inbound(bytes_inbound);
+  flow->set_bytes_outbound(bytes_outbound);
+  return flow;
+}
+
+static pbv1::NetworkActivity::Process MakeProcess(int32_t pid) {
+  pbv1::NetworkActivity::Process process;
+  process.mutable_process()->mutable_id()->set_pid(pid);
+  process.mutable_process()->mutable_id()->set_pidversion(1);
+  return process;
+}
+
+@interface NetworkFlowAggregatorTest : XCTestCase
+@end
+
+@implementation NetworkFlowAggregatorTest
+
+- (void)testEmptyDrain {
+  NetworkFlowAggregator aggregator;
+  XCTAssertFalse(aggregator.Drain().has_value());
+}
+
+- (void)testMergesAcrossWindows {
+  NetworkFlowAggregator aggregator;
+
+  // Two flows to the same endpoint, with a second window updating the
+  // cumulative counts of the first
+  pbv1::NetworkActivity::Process first = MakeProcess(12);
+  AddFlow(first, "a", "10.0.0.1", 443, 100, 10)->set_local_port(50000);
+  AddFlow(first, "b", "10.0.0.1", 443, 200, 20)->set_local_port(50001);
+  AddFlow(first, "c", "10.0.0.2", 443, 5, 5);
+  XCTAssertTrue(aggregator.Add(first, {.tv_sec = 100}, {.tv_sec = 160}));
+
+  pbv1::NetworkActivity::Process second = MakeProcess(12);
+  pbv1::NetworkActivity::Flow* updated = AddFlow(second, "a", "10.0.0.1", 443, 150, 15);
+  updated->set_local_port(50000);
+  updated->set_decision(pbv1::NetworkActivity::Flow::DECISION_BLOCK);
+  updated->set_rule_id(7);
+  updated->mutable_close_time()->set_seconds(200);
+  XCTAssertTrue(aggregator.Add(second, {.tv_sec = 160}, {.tv_sec = 220}));
+
+  std::optional<NetworkFlowAggregator::Window> window = aggregator.Drain();
+  XCTAssertTrue(window.has_value());
+  XCTAssertEqual(window->start.tv_sec, 100);
+  XCTAssertEqual(window->end.tv_sec, 220);
+  XCTAssertEqual(window->processes.size(), 1);
+
+  const pbv1::NetworkActivity::Process& process = window->processes[0];
+  XCTAssertEqual(process.process().id().pid(), 12);
+  XCTAssertEqual(process.flows_size(), 2);
+
+  const pbv1::NetworkActivity::Flow& merged = process.flows(0);
+  XCTAssertEqualObjects(@(merged.remote_address().c_str()), @"10.0.0.1");
+  XCTAssertEqual(merged.bytes_inbound(), 350);
+  XCTAssertEqual(merged.bytes_outbound(), 35);
+  XCTAssertEqual(merged.flow_count(), 2);
+  XCTAssertFalse(merged.has_id());
+  XCTAssertFalse(merged.has_local_port());
+  XCTAssertEqual(merged.decision(), pbv1::NetworkActivity::Flow::DECISION_BLOCK);
+  XCTAssertEqual(merged.rule_id(), 7);
+  XCTAssertEqual(merged.close_time().seconds(), 200);
+
+  XCTAssertEqualObjects(@(process.flows(1).remote_address().c_str()), @"10.0.0.2");
+  XCTAssertEqual(process.flows(1).bytes_inbound(), 5);
+  XCTAssertEqual(process.flows(1).flow_count(), 1);
+
+  // Nothing is left over for the next window
+  XCTAssertFalse(aggregator.Drain().has_value());
+}
+
+- (void)testSeparatesProcessesAndProtocols {
+  NetworkFlowAggregator aggregator;
+
+  pbv1::NetworkActivity::Process a = MakeProcess(1);
+  AddFlow(a, "a", "10.0.0.1", 53, 1, 1);
+  AddFlow(a, "b", "10.0.0.1", 53, 1, 1)->set_protocol(17);
+  XCTAssertTrue(aggregator.Add(a, {}, {}));
+
+  pbv1::NetworkActivity::Process b = MakeProcess(2);
+  AddFlow(b, "a", "10.0.0.1", 53, 1, 1);
+  XCTAssertTrue(aggregator.Add(b, {}, {}));
+
+  std::optional<NetworkFlowAggregator::Window> window = aggregator.Drain();
+  XCTAssertTrue(window.has_value());
+  XCTAssertEqual(window->processes.size(), 2);
+  XCTAssertEqual(window->processes[0].process().id().pid(), 1);
+  XCTAssertEqual(window->processes[0].flows_size(), 2);
+  XCTAssertEqual(window->processes[1].process().id().pid(), 2);
+  XCTAssertEqual(window->processes[1].flows_size(), 1);
+}
+
+- (void)testRejectsFlowsOverLimit {
+  NetworkFlowAggregator aggregator;
+
+  pbv1::NetworkActivity::Process process = MakeProcess(1);
+  for (size_t i = 0; i < NetworkFlowAggregator::kMaxFlows; i++) {
+    AddFlow(process, std::to_string(i), "10.0.0.1", 443, 1, 1);
+  }
+  XCTAssertTrue(aggregator.Add(process, {}, {}));
+
+  // Updates to tracked flows still fit, new flows don't
+  XCTAssertTrue(aggregator.Add(process, {}, {}));
+  pbv1::NetworkActivity::Process extra = MakeProcess(1);
+  AddFlow(extra, "new", "10.0.0.1", 443, 1, 1);
+  XCTAssertFalse(aggregator.Add(extra, {}, {}));
+
+  std::optional<NetworkFlowAggregator::Window> window = aggregator.Drain();
+  XCTAssertTrue(window.has_value());
+  XCTAssertEqual(window->processes[0].flows(0).flow_count(), NetworkFlowAggregator::kMaxFlows);
+  XCTAssertTrue(aggregator.Add(extra, {}, {}));
+}
+
+@end
@@ -21,6 +21,7 @@
 
 #include <memory>
 #include <sstream>
+#include <string_view>
 #include <vector>
 
 #include "Source/common/Platform.h"
@@ -31,6 +32,11 @@
 
 namespace santa {
 
+// Names used for decisions and client modes in string formatted logs.
+std::string_view GetDecisionString(SNTEventState event_state);
+std::string_view GetReasonString(SNTEventState event_state);
+std::string_view GetModeString(SNTClientMode mode);
+
 class BasicString : public Serializer {
  public:
   static std::shared_ptr<BasicString> Create(std::shared_ptr<santa::EndpointSecurityAPI> esapi,
@@ -78,6 +84,10 @@ class BasicString : public Serializer {
 
   std::vector<uint8_t> SerializeNetworkFlows(SNDProcessFlows*, struct timespec, struct timespec,
                                              SNTCachedDecision*) override;
+  bool AggregateNetworkFlows(santa::NetworkFlowAggregator&, SNDProcessFlows*, struct timespec,
+                             struct timespec, SNTCachedDecision*) override;
+  std::vector<uint8_t> SerializeNetworkActivity(
+      const santa::NetworkFlowAggregator::Window&) override;
 
   std::vector<uint8_t> SerializeFileAccess(
       const std::string& policy_version, const std::string& policy_name, const santa::Message& msg,
@@ -93,8 +103,16 @@ class BasicString : public Serializer {
   std::vector<uint8_t> SerializeDiskAppeared(NSDictionary*, bool) override;
   std::vector<uint8_t> SerializeDiskDisappeared(NSDictionary*) override;
 
+  std::vector<uint8_t> SerializeEventSummary(const santa::EventSummary&, struct timespec,
+                                             struct timespec) override;
+
+  std::vector<uint8_t> SerializeExecTrace(const santa::ExecTrace::Summary&) override;
+
  private:
-  std::string CreateDefaultString();
+  // Returns this thread's line buffer, cleared and with the time and name
+  // prefix applied if enabled. The buffer is reused by the next message
+  // serialized on the thread, so it must be finalized before then.
+  std::string& CreateDefaultString();
   std::vector<uint8_t> FinalizeString(std::string& str);
 
   std::vector<uint8_t> SerializeMessageLaunchItemAdd(const santa::EnrichedLaunchItem&);
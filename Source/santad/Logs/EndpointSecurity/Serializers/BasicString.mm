@@ -29,17 +29,22 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <charconv>
 #include <format>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include "Source/common/AuditUtilities.h"
+#include "Source/common/BufferPool.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/String.h"
+#include "Source/common/TelemetryEventMap.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/SanitizableString.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Utilities.h"
 #import "Source/santad/SNTDecisionCache.h"
@@ -47,6 +52,26 @@
 
 namespace santa {
 
+// Lines are formatted into a per-thread buffer whose capacity is reused from
+// one message to the next. Buffers grown past this size by unusually long
+// lines are released rather than kept for the lifetime of the thread.
+static constexpr size_t kMaxRetainedLineCapacity = 64 * 1024;
+
+// Appends the decimal representation of value without creating a temporary string.
+template <typename T>
+static inline void AppendNumber(std::string& str, T value) {
+  char buf[std::numeric_limits<T>::digits10 + 3];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+  str.append(buf, end);
+}
+
+static inline void AppendPrefixedKey(std::string& str, std::string_view prefix,
+                                     std::string_view key) {
+  str.push_back('|');
+  str.append(prefix);
+  str.append(key);
+}
+
 static inline SanitizableString FilePath(const es_file_t* file) {
   return SanitizableString(file);
 }
@@ -65,7 +90,7 @@ static NSDateFormatter* GetDateFormatter() {
   return dateFormatter;
 }
 
-std::string GetDecisionString(SNTEventState event_state) {
+std::string_view GetDecisionString(SNTEventState event_state) {
   if (event_state & SNTEventStateAllowCompilerBinary ||
       event_state & SNTEventStateAllowCompilerCDHash ||
       event_state & SNTEventStateAllowCompilerSigningID) {
@@ -79,7 +104,7 @@ std::string GetDecisionString(SNTEventState event_state) {
   }
 }
 
-std::string GetReasonString(SNTEventState event_state) {
+std::string_view GetReasonString(SNTEventState event_state) {
   switch (event_state) {
     case SNTEventStateAllowBinary: return "BINARY";
     case SNTEventStateAllowLocalBinary: return "BINARY";
@@ -115,7 +140,7 @@ std::string GetReasonString(SNTEventState event_state) {
   return "UNKNOWN";
 }
 
-std::string GetModeString(SNTClientMode mode) {
+std::string_view GetModeString(SNTClientMode mode) {
   switch (mode) {
     case SNTClientModeMonitor: return "M";
     case SNTClientModeLockdown: return "L";
@@ -139,7 +164,7 @@ std::string GetAccessTypeString(es_event_type_t event_type) {
   }
 }
 
-static inline std::string GetBoolString(bool val) {
+static inline std::string_view GetBoolString(bool val) {
   return (val ? "true" : "false");
 }
 
@@ -156,61 +181,61 @@ std::string GetFileAccessPolicyDecisionString(FileAccessPolicyDecision decision)
 }
 
 static inline void AppendProcess(std::string& str, const es_process_t* es_proc,
-                                 const std::string prefix = "") {
+                                 std::string_view prefix = "") {
   char bname[MAXPATHLEN];
-  str.append("|" + prefix + "pid=");
-  str.append(std::to_string(Pid(es_proc->audit_token)));
-  str.append("|" + prefix + "ppid=");
-  str.append(std::to_string(es_proc->original_ppid));
-  str.append("|" + prefix + "process=");
+  AppendPrefixedKey(str, prefix, "pid=");
+  AppendNumber(str, Pid(es_proc->audit_token));
+  AppendPrefixedKey(str, prefix, "ppid=");
+  AppendNumber(str, es_proc->original_ppid);
+  AppendPrefixedKey(str, prefix, "process=");
   str.append(basename_r(FilePath(es_proc->executable).Sanitized().data(), bname) ?: "");
-  str.append("|" + prefix + "processpath=");
+  AppendPrefixedKey(str, prefix, "processpath=");
   str.append(FilePath(es_proc->executable).Sanitized());
 }
 
 static inline void AppendUserGroup(std::string& str, const audit_token_t& tok,
                                    const std::optional<std::shared_ptr<std::string>>& user,
                                    const std::optional<std::shared_ptr<std::string>>& group,
-                                   const std::string prefix = "") {
-  str.append("|" + prefix + "uid=");
-  str.append(std::to_string((int)RealUser(tok)));
-  str.append("|" + prefix + "user=");
+                                   std::string_view prefix = "") {
+  AppendPrefixedKey(str, prefix, "uid=");
+  AppendNumber(str, (int)RealUser(tok));
+  AppendPrefixedKey(str, prefix, "user=");
   str.append(user.has_value() ? user->get()->c_str() : "(null)");
-  str.append("|" + prefix + "gid=");
-  str.append(std::to_string((int)RealGroup(tok)));
-  str.append("|" + prefix + "group=");
+  AppendPrefixedKey(str, prefix, "gid=");
+  AppendNumber(str, (int)RealGroup(tok));
+  AppendPrefixedKey(str, prefix, "group=");
   str.append(group.has_value() ? group->get()->c_str() : "(null)");
 }
 
 static inline void AppendEventUser(std::string& str, const es_string_token_t& user,
-                                   std::optional<uid_t> uid, const std::string prefix = "event_") {
+                                   std::optional<uid_t> uid, std::string_view prefix = "event_") {
   if (user.length > 0) {
-    str.append("|" + prefix + "user=");
+    AppendPrefixedKey(str, prefix, "user=");
     str.append(user.data);
   }
 
   if (uid.has_value()) {
-    str.append("|" + prefix + "uid=");
-    str.append(std::to_string((int)uid.value()));
+    AppendPrefixedKey(str, prefix, "uid=");
+    AppendNumber(str, (int)uid.value());
   }
 }
 
 static inline void AppendInstigator(std::string& str, const es_process_t* es_proc,
                                     const EnrichedProcess& enriched_proc,
-                                    const std::string prefix = "") {
+                                    std::string_view prefix = "") {
   AppendProcess(str, es_proc, prefix);
   AppendUserGroup(str, es_proc->audit_token, enriched_proc.real_user(), enriched_proc.real_group(),
                   prefix);
 }
 
 static inline void AppendInstigator(std::string& str, const EnrichedEventType& event,
-                                    const std::string prefix = "") {
+                                    std::string_view prefix = "") {
   AppendInstigator(str, event->process, event.instigator(), prefix);
 }
 
 static inline void AppendEventUser(std::string& str,
                                    const std::optional<std::shared_ptr<std::string>>& user,
-                                   uid_t uid, const std::string prefix = "event_") {
+                                   uid_t uid, std::string_view prefix = "event_") {
   es_string_token_t user_token = {.length = user.has_value() ? user.value()->length() : 0,
                                   .data = user.has_value() ? user.value()->c_str() : NULL};
 
@@ -219,7 +244,7 @@ static inline void AppendEventUser(std::string& str,
 
 static inline void AppendGraphicalSession(std::string& str, es_graphical_session_id_t session_id) {
   str.append("|graphical_session_id=");
-  str.append(std::to_string(session_id));
+  AppendNumber(str, session_id);
 }
 
 static inline void AppendSocketAddress(std::string& str, es_address_type_t type,
@@ -239,7 +264,7 @@ static inline void AppendSocketAddress(std::string& str, es_address_type_t type,
   }
 }
 
-static inline std::string GetOpenSSHLoginResult(std::string& str,
+static inline std::string_view GetOpenSSHLoginResult(std::string& str,
                                                 es_openssh_login_result_type_t result) {
   switch (result) {
     case ES_OPENSSH_LOGIN_EXCEED_MAXTRIES: return "LOGIN_EXCEED_MAXTRIES";
@@ -279,8 +304,9 @@ BasicString::BasicString(std::shared_ptr<EndpointSecurityAPI> esapi,
                          SNTDecisionCache* decision_cache, bool prefix_time_name)
     : Serializer(std::move(decision_cache)), esapi_(esapi), prefix_time_name_(prefix_time_name) {}
 
-std::string BasicString::CreateDefaultString() {
-  std::string str;
+std::string& BasicString::CreateDefaultString() {
+  static thread_local std::string str;
+  str.clear();
   str.reserve(1024);
 
   if (prefix_time_name_) {
@@ -301,13 +327,18 @@ std::vector<uint8_t> BasicString::FinalizeString(std::string& str) {
   }
   str.append("\n");
 
-  std::vector<uint8_t> vec(str.length());
-  std::copy(str.begin(), str.end(), vec.begin());
+  std::vector<uint8_t> vec = BufferPool::Shared().Acquire(str.length());
+  vec.assign(str.begin(), str.end());
+
+  if (str.capacity() > kMaxRetainedLineCapacity) {
+    std::string().swap(str);
+  }
+
   return vec;
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedClose& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=WRITE|path=");
   str.append(FilePath(msg->event.close.target).Sanitized());
@@ -318,7 +349,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedClose& msg) {
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExchange& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=EXCHANGE|path=");
   str.append(FilePath(msg->event.exchangedata.file1).Sanitized());
@@ -331,7 +362,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExchange& msg)
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExec& msg, SNTCachedDecision* cd) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=EXEC|decision=");
   str.append(GetDecisionString(cd.decision));
@@ -370,11 +401,11 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExec& msg, SNTC
   }
 
   str.append("|pid=");
-  str.append(std::to_string(Pid(msg->event.exec.target->audit_token)));
+  AppendNumber(str, Pid(msg->event.exec.target->audit_token));
   str.append("|pidversion=");
-  str.append(std::to_string(Pidversion(msg->event.exec.target->audit_token)));
+  AppendNumber(str, Pidversion(msg->event.exec.target->audit_token));
   str.append("|ppid=");
-  str.append(std::to_string(msg->event.exec.target->original_ppid));
+  AppendNumber(str, msg->event.exec.target->original_ppid);
 
   AppendUserGroup(str, msg->event.exec.target->audit_token, msg.instigator().real_user(),
                   msg.instigator().real_group());
@@ -406,41 +437,41 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExec& msg, SNTC
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedExit& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=EXIT|pid=");
-  str.append(std::to_string(Pid(msg->process->audit_token)));
+  AppendNumber(str, Pid(msg->process->audit_token));
   str.append("|pidversion=");
-  str.append(std::to_string(Pidversion(msg->process->audit_token)));
+  AppendNumber(str, Pidversion(msg->process->audit_token));
   str.append("|ppid=");
-  str.append(std::to_string(msg->process->original_ppid));
+  AppendNumber(str, msg->process->original_ppid);
   str.append("|uid=");
-  str.append(std::to_string((int)RealUser(msg->process->audit_token)));
+  AppendNumber(str, (int)RealUser(msg->process->audit_token));
   str.append("|gid=");
-  str.append(std::to_string((int)RealGroup(msg->process->audit_token)));
+  AppendNumber(str, (int)RealGroup(msg->process->audit_token));
 
   return FinalizeString(str);
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedFork& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=FORK|pid=");
-  str.append(std::to_string(Pid(msg->event.fork.child->audit_token)));
+  AppendNumber(str, Pid(msg->event.fork.child->audit_token));
   str.append("|pidversion=");
-  str.append(std::to_string(Pidversion(msg->event.fork.child->audit_token)));
+  AppendNumber(str, Pidversion(msg->event.fork.child->audit_token));
   str.append("|ppid=");
-  str.append(std::to_string(msg->event.fork.child->original_ppid));
+  AppendNumber(str, msg->event.fork.child->original_ppid);
   str.append("|uid=");
-  str.append(std::to_string((int)RealUser(msg->event.fork.child->audit_token)));
+  AppendNumber(str, (int)RealUser(msg->event.fork.child->audit_token));
   str.append("|gid=");
-  str.append(std::to_string((int)RealGroup(msg->event.fork.child->audit_token)));
+  AppendNumber(str, (int)RealGroup(msg->event.fork.child->audit_token));
 
   return FinalizeString(str);
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLink& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=LINK|path=");
   str.append(FilePath(msg->event.link.source).Sanitized());
@@ -455,7 +486,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLink& msg) {
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedRename& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=RENAME|path=");
   str.append(FilePath(msg->event.rename.source).Sanitized());
@@ -479,7 +510,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedRename& msg) {
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedUnlink& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=DELETE|path=");
   str.append(FilePath(msg->event.unlink.target).Sanitized());
@@ -490,7 +521,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedUnlink& msg) {
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedCSInvalidated& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=CODESIGNING_INVALIDATED");
   AppendInstigator(str, msg);
@@ -500,7 +531,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedCSInvalidated&
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedClone& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=CLONE|source=");
   str.append(FilePath(msg->event.clone.source).Sanitized());
@@ -514,7 +545,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedClone& msg) {
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedCopyfile& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=COPYFILE|source=");
   str.append(FilePath(msg->event.copyfile.source).Sanitized());
@@ -528,7 +559,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedCopyfile& msg)
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedProcSuspendResume& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=PROC_SUSPEND_RESUME");
 
@@ -541,7 +572,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedProcSuspendResu
 
   if (msg->event.proc_suspend_resume.target) {
     str.append("|targetpid=");
-    str.append(std::to_string(Pid(msg->event.proc_suspend_resume.target->audit_token)));
+    AppendNumber(str, Pid(msg->event.proc_suspend_resume.target->audit_token));
     str.append("|targetpath=");
     str.append(FilePath(msg->event.proc_suspend_resume.target->executable).Sanitized());
   }
@@ -552,7 +583,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedProcSuspendResu
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginWindowSessionLogin& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=LOGIN_WINDOW_SESSION_LOGIN");
   AppendInstigator(str, msg);
@@ -563,7 +594,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginWindowSess
 };
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginWindowSessionLogout& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=LOGIN_WINDOW_SESSION_LOGOUT");
   AppendInstigator(str, msg);
@@ -574,7 +605,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginWindowSess
 };
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginWindowSessionLock& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=LOGIN_WINDOW_SESSION_LOCK");
   AppendInstigator(str, msg);
@@ -585,7 +616,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginWindowSess
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginWindowSessionUnlock& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=LOGIN_WINDOW_SESSION_UNLOCK");
   AppendInstigator(str, msg);
@@ -596,7 +627,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginWindowSess
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedScreenSharingAttach& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=SCREEN_SHARING_ATTACH|success=");
   str.append(msg->event.screensharing_attach->success ? "true" : "false");
@@ -635,7 +666,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedScreenSharingAt
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedScreenSharingDetach& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=SCREEN_SHARING_DETACH");
 
@@ -654,7 +685,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedScreenSharingDe
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedOpenSSHLogin& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=OPENSSH_LOGIN|success=");
   str.append(msg->event.openssh_login->success ? "true" : "false");
@@ -673,7 +704,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedOpenSSHLogin& m
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedOpenSSHLogout& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=OPENSSH_LOGOUT");
 
@@ -687,7 +718,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedOpenSSHLogout&
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginLogin& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=LOGIN|success=");
   str.append(msg->event.login_login->success ? "true" : "false");
@@ -706,7 +737,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginLogin& msg
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginLogout& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=LOGOUT");
 
@@ -719,23 +750,23 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLoginLogout& ms
 
 static void AppendEventInstigatorOrFallback(std::string& str,
                                             const EnrichedEventWithInstigator& event,
-                                            std::string prefix = "auth_") {
+                                            std::string_view prefix = "auth_") {
   if (event.EventInstigator() && event.EnrichedEventInstigator().has_value()) {
     AppendInstigator(str, event.EventInstigator(), event.EnrichedEventInstigator().value(), prefix);
   } else if (event->version >= 8) {
     if (event.EventInstigatorToken().has_value()) {
-      str.append("|" + prefix + "pid=");
-      str.append(std::to_string(Pid(event.EventInstigatorToken().value())));
+      AppendPrefixedKey(str, prefix, "pid=");
+      AppendNumber(str, Pid(event.EventInstigatorToken().value()));
     }
     if (event.EventInstigatorToken().has_value()) {
-      str.append("|" + prefix + "pidver=");
-      str.append(std::to_string(Pidversion(event.EventInstigatorToken().value())));
+      AppendPrefixedKey(str, prefix, "pidver=");
+      AppendNumber(str, Pidversion(event.EventInstigatorToken().value()));
     }
   }
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedAuthenticationOD& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=AUTHENTICATION_OD");
   str.append("|success=");
@@ -760,7 +791,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedAuthenticationO
   return FinalizeString(str);
 }
 
-std::string GetAuthenticationTouchIDModeString(es_touchid_mode_t mode) {
+std::string_view GetAuthenticationTouchIDModeString(es_touchid_mode_t mode) {
   switch (mode) {
     case ES_TOUCHID_MODE_VERIFICATION: return "VERIFICATION";
     case ES_TOUCHID_MODE_IDENTIFICATION: return "IDENTIFICATION";
@@ -769,7 +800,7 @@ std::string GetAuthenticationTouchIDModeString(es_touchid_mode_t mode) {
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedAuthenticationTouchID& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=AUTHENTICATION_TOUCHID");
   str.append("|success=");
@@ -790,7 +821,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedAuthenticationT
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedAuthenticationToken& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=AUTHENTICATION_TOKEN");
   str.append("|success=");
@@ -813,7 +844,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedAuthenticationT
   return FinalizeString(str);
 }
 
-std::string GetAuthenticationAutoUnlockTypeString(es_auto_unlock_type_t type) {
+std::string_view GetAuthenticationAutoUnlockTypeString(es_auto_unlock_type_t type) {
   switch (type) {
     case ES_AUTO_UNLOCK_MACHINE_UNLOCK: return "MACHINE_UNLOCK";
     case ES_AUTO_UNLOCK_AUTH_PROMPT: return "AUTH_PROMPT";
@@ -822,7 +853,7 @@ std::string GetAuthenticationAutoUnlockTypeString(es_auto_unlock_type_t type) {
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedAuthenticationAutoUnlock& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=AUTHENTICATION_AUTO_UNLOCK");
   str.append("|success=");
@@ -838,7 +869,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedAuthenticationA
   return FinalizeString(str);
 }
 
-std::string GetBTMLaunchItemTypeString(es_btm_item_type_t item_type) {
+std::string_view GetBTMLaunchItemTypeString(es_btm_item_type_t item_type) {
   switch (item_type) {
     case ES_BTM_ITEM_TYPE_USER_ITEM: return "USER_ITEM";
     case ES_BTM_ITEM_TYPE_APP: return "APP";
@@ -853,7 +884,7 @@ std::vector<uint8_t> BasicString::SerializeMessageLaunchItemAdd(const EnrichedLa
   assert(msg->event_type == ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_ADD);
   const es_event_btm_launch_item_add_t* btm = msg->event.btm_launch_item_add;
 
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=LAUNCH_ITEM_ADD|item_type=");
   str.append(GetBTMLaunchItemTypeString(btm->item->item_type));
@@ -892,7 +923,7 @@ std::vector<uint8_t> BasicString::SerializeMessageLaunchItemRemove(const Enriche
   assert(msg->event_type == ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_REMOVE);
   const es_event_btm_launch_item_remove_t* btm = msg->event.btm_launch_item_remove;
 
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=LAUNCH_ITEM_REMOVE|item_type=");
   str.append(GetBTMLaunchItemTypeString(btm->item->item_type));
@@ -932,7 +963,8 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedLaunchItem& msg
   }
 }
 
-static inline void AppendStringToken(std::string& str, std::string key, es_string_token_t val) {
+static inline void AppendStringToken(std::string& str, std::string_view key,
+                                     es_string_token_t val) {
   if (val.length > 0) {
     str.append(key);
     str.append(val.data);
@@ -941,7 +973,7 @@ static inline void AppendStringToken(std::string& str, std::string key, es_strin
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedXProtectDetected& msg) {
   const es_event_xp_malware_detected_t* xp = msg->event.xp_malware_detected;
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=XPROTECT_DETECTED");
 
@@ -957,7 +989,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedXProtectDetecte
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedXProtectRemediated& msg) {
   const es_event_xp_malware_remediated_t* xp = msg->event.xp_malware_remediated;
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=XPROTECT_REMEDIATED");
 
@@ -971,7 +1003,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedXProtectRemedia
   AppendStringToken(str, "|remediated_path=", xp->remediated_path);
   if (xp->remediated_process_audit_token) {
     str.append("|remediated_pid=");
-    str.append(std::to_string(Pid(*xp->remediated_process_audit_token)));
+    AppendNumber(str, Pid(*xp->remediated_process_audit_token));
   }
 
   return FinalizeString(str);
@@ -980,7 +1012,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedXProtectRemedia
 #if HAVE_MACOS_15
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedGatekeeperOverride& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
   es_event_gatekeeper_user_override_t* gk = msg->event.gatekeeper_user_override;
 
   str.append("action=GATEKEEPER_OVERRIDE|target=");
@@ -1021,7 +1053,7 @@ std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedGatekeeperOverr
 
 #if HAVE_MACOS_15_4
 
-std::string GetTCCIdentityTypeString(es_tcc_identity_type_t id_type) {
+std::string_view GetTCCIdentityTypeString(es_tcc_identity_type_t id_type) {
   switch (id_type) {
     case ES_TCC_IDENTITY_TYPE_BUNDLE_ID: return "BUNDLE_ID";
     case ES_TCC_IDENTITY_TYPE_EXECUTABLE_PATH: return "EXECUTABLE_PATH";
@@ -1031,7 +1063,7 @@ std::string GetTCCIdentityTypeString(es_tcc_identity_type_t id_type) {
   }
 }
 
-std::string GetTCCEventTypeString(es_tcc_event_type_t event_type) {
+std::string_view GetTCCEventTypeString(es_tcc_event_type_t event_type) {
   switch (event_type) {
     case ES_TCC_EVENT_TYPE_CREATE: return "CREATE";
     case ES_TCC_EVENT_TYPE_MODIFY: return "MODIFY";
@@ -1040,7 +1072,7 @@ std::string GetTCCEventTypeString(es_tcc_event_type_t event_type) {
   }
 }
 
-std::string GetTCCAuthorizationRightString(es_tcc_authorization_right_t auth_right) {
+std::string_view GetTCCAuthorizationRightString(es_tcc_authorization_right_t auth_right) {
   switch (auth_right) {
     case ES_TCC_AUTHORIZATION_RIGHT_DENIED: return "DENIED";
     case ES_TCC_AUTHORIZATION_RIGHT_UNKNOWN: return "UNKNOWN";
@@ -1053,7 +1085,7 @@ std::string GetTCCAuthorizationRightString(es_tcc_authorization_right_t auth_rig
   }
 }
 
-std::string GetTCCAuthorizationReasonString(es_tcc_authorization_reason_t auth_reason) {
+std::string_view GetTCCAuthorizationReasonString(es_tcc_authorization_reason_t auth_reason) {
   switch (auth_reason) {
     case ES_TCC_AUTHORIZATION_REASON_NONE: return "NONE";
     case ES_TCC_AUTHORIZATION_REASON_ERROR: return "ERROR";
@@ -1074,7 +1106,7 @@ std::string GetTCCAuthorizationReasonString(es_tcc_authorization_reason_t auth_r
 }
 
 std::vector<uint8_t> BasicString::SerializeMessage(const EnrichedTCCModification& msg) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=TCC_MODIFICATION");
 
@@ -1107,17 +1139,28 @@ std::vector<uint8_t> BasicString::SerializeNetworkFlows(SNDProcessFlows* process
                                                         struct timespec window_start,
                                                         struct timespec window_end,
                                                         SNTCachedDecision* cd) {
-  std::string line = CreateDefaultString();
+  std::string& line = CreateDefaultString();
   line += santanetd::FormatNetworkFlowsBasicString(processFlows, cd);
   return FinalizeString(line);
 }
 
+bool BasicString::AggregateNetworkFlows(NetworkFlowAggregator&, SNDProcessFlows*, struct timespec,
+                                        struct timespec, SNTCachedDecision*) {
+  // Flows are formatted by santanetd, which has no aggregated form
+  return false;
+}
+
+std::vector<uint8_t> BasicString::SerializeNetworkActivity(
+    const NetworkFlowAggregator::Window&) {
+  return {};
+}
+
 std::vector<uint8_t> BasicString::SerializeFileAccess(
     const std::string& policy_version, const std::string& policy_name, const Message& msg,
     const EnrichedProcess& enriched_process, size_t target_index,
     std::optional<santa::EnrichedFile> enriched_event_target, FileAccessPolicyDecision decision,
     std::string_view operation_id, int64_t rule_id) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=FILE_ACCESS|policy_version=");
   str.append(policy_version);
@@ -1147,12 +1190,12 @@ std::vector<uint8_t> BasicString::SerializeFileAccess(
 std::vector<uint8_t> BasicString::SerializeAllowlist(const Message& msg,
                                                      const std::string_view hash,
                                                      const std::string_view target_path) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=ALLOWLIST|pid=");
-  str.append(std::to_string(Pid(msg->process->audit_token)));
+  AppendNumber(str, Pid(msg->process->audit_token));
   str.append("|pidversion=");
-  str.append(std::to_string(Pidversion(msg->process->audit_token)));
+  AppendNumber(str, Pidversion(msg->process->audit_token));
   str.append("|path=");
   str.append(SanitizableString(target_path.data(), target_path.size()).Sanitized());
   str.append("|sha256=");
@@ -1162,7 +1205,7 @@ std::vector<uint8_t> BasicString::SerializeAllowlist(const Message& msg,
 }
 
 std::vector<uint8_t> BasicString::SerializeBundleHashingEvent(SNTStoredExecutionEvent* event) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=BUNDLE|sha256=");
   str.append([NonNull(event.fileSHA256) UTF8String]);
@@ -1197,7 +1240,7 @@ std::vector<uint8_t> BasicString::SerializeDiskAppeared(NSDictionary* props, boo
       stringFromDate:[NSDate dateWithTimeIntervalSinceReferenceDate:[props[@"DAAppearanceTime"]
                                                                         doubleValue]]];
 
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
   if (allowed) {
     str.append("action=DISKAPPEAR");
   } else {
@@ -1238,7 +1281,7 @@ std::vector<uint8_t> BasicString::SerializeDiskAppeared(NSDictionary* props, boo
 }
 
 std::vector<uint8_t> BasicString::SerializeDiskDisappeared(NSDictionary* props) {
-  std::string str = CreateDefaultString();
+  std::string& str = CreateDefaultString();
 
   str.append("action=DISKDISAPPEAR");
   str.append("|mount=");
@@ -1251,4 +1294,63 @@ std::vector<uint8_t> BasicString::SerializeDiskDisappeared(NSDictionary* props)
   return FinalizeString(str);
 }
 
+std::vector<uint8_t> BasicString::SerializeEventSummary(const EventSummary& summary,
+                                                        struct timespec window_start,
+                                                        struct timespec window_end) {
+  std::string& str = CreateDefaultString();
+
+  str.append("action=EVENT_SUMMARY|event=");
+  str.append(TelemetryEventToName(summary.event));
+  str.append("|path=");
+  str.append(
+      SanitizableString(summary.executable_path.data(), summary.executable_path.length())
+          .Sanitized());
+  str.append("|count=");
+  AppendNumber(str, summary.count);
+
+  if (!summary.top_paths.empty()) {
+    str.append("|top_paths=");
+    for (size_t i = 0; i < summary.top_paths.size(); i++) {
+      const auto& [path, count] = summary.top_paths[i];
+      if (i > 0) {
+        str.append(",");
+      }
+      str.append(SanitizableString(path.data(), path.length()).Sanitized());
+      str.append(":");
+      AppendNumber(str, count);
+    }
+  }
+
+  return FinalizeString(str);
+}
+
+std::vector<uint8_t> BasicString::SerializeExecTrace(const ExecTrace::Summary& trace) {
+  std::string& str = CreateDefaultString();
+
+  str.append("action=EXEC_TRACE|trace_id=");
+  AppendNumber(str, trace.id);
+  str.append("|pid=");
+  AppendNumber(str, trace.pid);
+  str.append("|path=");
+  str.append(SanitizableString(trace.path.data(), trace.path.length()).Sanitized());
+  str.append("|result=");
+  str.append(trace.result);
+  str.append("|total_ns=");
+  AppendNumber(str, trace.total_ns);
+  str.append("|hash_bytes_read=");
+  AppendNumber(str, trace.hash_bytes_read);
+
+  for (size_t i = 0; i < kExecTraceStageCount; i++) {
+    if (trace.stage_ns[i] == 0) {
+      continue;
+    }
+    str.append("|");
+    str.append(ExecTraceStageName(static_cast<ExecTraceStage>(i)));
+    str.append("_ns=");
+    AppendNumber(str, trace.stage_ns[i]);
+  }
+
+  return FinalizeString(str);
+}
+
 }  // namespace santa
@@ -44,19 +44,19 @@ using santa::Message;
 using santa::Serializer;
 
 namespace santa {
-extern std::string GetDecisionString(SNTEventState event_state);
-extern std::string GetReasonString(SNTEventState event_state);
-extern std::string GetModeString(SNTClientMode mode);
+extern std::string_view GetDecisionString(SNTEventState event_state);
+extern std::string_view GetReasonString(SNTEventState event_state);
+extern std::string_view GetModeString(SNTClientMode mode);
 extern std::string GetAccessTypeString(es_event_type_t event_type);
 extern std::string GetFileAccessPolicyDecisionString(FileAccessPolicyDecision decision);
-extern std::string GetAuthenticationTouchIDModeString(es_touchid_mode_t mode);
-extern std::string GetAuthenticationAutoUnlockTypeString(es_auto_unlock_type_t mode);
-extern std::string GetBTMLaunchItemTypeString(es_btm_item_type_t item_type);
+extern std::string_view GetAuthenticationTouchIDModeString(es_touchid_mode_t mode);
+extern std::string_view GetAuthenticationAutoUnlockTypeString(es_auto_unlock_type_t mode);
+extern std::string_view GetBTMLaunchItemTypeString(es_btm_item_type_t item_type);
 #if HAVE_MACOS_15_4
-extern std::string GetTCCIdentityTypeString(es_tcc_identity_type_t id_type);
-extern std::string GetTCCEventTypeString(es_tcc_event_type_t event_type);
-extern std::string GetTCCAuthorizationRightString(es_tcc_authorization_right_t auth_right);
-extern std::string GetTCCAuthorizationReasonString(es_tcc_authorization_reason_t auth_reason);
+extern std::string_view GetTCCIdentityTypeString(es_tcc_identity_type_t id_type);
+extern std::string_view GetTCCEventTypeString(es_tcc_event_type_t event_type);
+extern std::string_view GetTCCAuthorizationRightString(es_tcc_authorization_right_t auth_right);
+extern std::string_view GetTCCAuthorizationReasonString(es_tcc_authorization_reason_t auth_reason);
 #endif  // HAVE_MACOS_15_4
 }  // namespace santa
 
@@ -103,7 +103,7 @@ std::string BasicStringSerializeMessage(es_message_t* esMsg) {
 
   self.mockDecisionCache = OCMClassMock([SNTDecisionCache class]);
   OCMStub([self.mockDecisionCache sharedCache]).andReturn(self.mockDecisionCache);
-  OCMStub([self.mockDecisionCache resetTimestampForCachedDecision:{}])
+  OCMStub([self.mockDecisionCache takeDecisionForExecOfProcess:{} file:{}])
       .ignoringNonObjectArgs()
       .andReturn(self.testCachedDecision);
 }
@@ -129,6 +129,32 @@ std::string BasicStringSerializeMessage(es_message_t* esMsg) {
   XCTAssertCppStringEqual(got, want);
 }
 
+- (void)testSerializeMessagesReuseLineBuffer {
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+
+  // A line long enough that its buffer is released afterwards, followed by
+  // short lines that reuse a buffer, must not carry over any earlier content.
+  std::string longPath(70 * 1024, 'a');
+  es_file_t longFile = MakeESFile(longPath.c_str());
+  es_message_t longMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  longMsg.event.close.target = &longFile;
+
+  std::string got = BasicStringSerializeMessage(&longMsg);
+  XCTAssertCppStringBeginsWith(got, "action=WRITE|path=" + longPath + "|pid=12");
+
+  es_file_t file = MakeESFile("close_file");
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  esMsg.event.close.target = &file;
+  std::string want = "action=WRITE|path=close_file"
+                     "|pid=12|ppid=56|process=foo|processpath=foo"
+                     "|uid=-2|user=nobody|gid=-1|group=nogroup|machineid=my_id\n";
+
+  for (int i = 0; i < 2; i++) {
+    XCTAssertCppStringEqual(BasicStringSerializeMessage(&esMsg), want);
+  }
+}
+
 - (void)testSerializeMessageExchange {
   es_file_t procFile = MakeESFile("foo");
   es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
@@ -1428,6 +1454,46 @@ std::string BasicStringSerializeMessage(es_message_t* esMsg) {
   XCTAssertCppStringEqual(got, want);
 }
 
+- (void)testSerializeEventSummary {
+  santa::EventSummary summary{
+      .executable_path = "/usr/bin/make",
+      .event = santa::TelemetryEvent::kClose,
+      .count = 42,
+      .top_paths = {{"/tmp/a", 30}, {"/tmp/b", 12}},
+  };
+
+  std::vector<uint8_t> ret =
+      BasicString::Create(nullptr, nil, false)->SerializeEventSummary(summary, {}, {});
+  std::string got(ret.begin(), ret.end());
+
+  std::string want = "action=EVENT_SUMMARY|event=close|path=/usr/bin/make|count=42"
+                     "|top_paths=/tmp/a:30,/tmp/b:12|machineid=my_id\n";
+
+  XCTAssertCppStringEqual(got, want);
+}
+
+- (void)testSerializeExecTrace {
+  santa::ExecTrace::Summary trace{
+      .id = 7,
+      .pid = 123,
+      .path = "/usr/bin/make",
+      .result = "allow",
+      .total_ns = 5000,
+      .hash_bytes_read = 4096,
+  };
+  trace.stage_ns[static_cast<size_t>(santa::ExecTraceStage::kQueueWait)] = 100;
+  trace.stage_ns[static_cast<size_t>(santa::ExecTraceStage::kSQLite)] = 2000;
+
+  std::vector<uint8_t> ret = BasicString::Create(nullptr, nil, false)->SerializeExecTrace(trace);
+  std::string got(ret.begin(), ret.end());
+
+  std::string want = "action=EXEC_TRACE|trace_id=7|pid=123|path=/usr/bin/make|result=allow"
+                     "|total_ns=5000|hash_bytes_read=4096|queue_wait_ns=100|sqlite_ns=2000"
+                     "|machineid=my_id\n";
+
+  XCTAssertCppStringEqual(got, want);
+}
+
 - (void)testGetDecisionString {
   std::map<SNTEventState, std::string> stateToDecision = {
       {SNTEventStateUnknown, "UNKNOWN"},
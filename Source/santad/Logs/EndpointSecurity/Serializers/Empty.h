@@ -70,6 +70,10 @@ class Empty : public Serializer {
 
   std::vector<uint8_t> SerializeNetworkFlows(SNDProcessFlows*, struct timespec, struct timespec,
                                              SNTCachedDecision*) override;
+  bool AggregateNetworkFlows(santa::NetworkFlowAggregator&, SNDProcessFlows*, struct timespec,
+                             struct timespec, SNTCachedDecision*) override;
+  std::vector<uint8_t> SerializeNetworkActivity(
+      const santa::NetworkFlowAggregator::Window&) override;
 
   std::vector<uint8_t> SerializeFileAccess(
       const std::string& policy_version, const std::string& policy_name, const santa::Message& msg,
@@ -84,6 +88,11 @@ class Empty : public Serializer {
 
   std::vector<uint8_t> SerializeDiskAppeared(NSDictionary*, bool) override;
   std::vector<uint8_t> SerializeDiskDisappeared(NSDictionary*) override;
+
+  std::vector<uint8_t> SerializeEventSummary(const santa::EventSummary&, struct timespec,
+                                             struct timespec) override;
+
+  std::vector<uint8_t> SerializeExecTrace(const santa::ExecTrace::Summary&) override;
 };
 
 }  // namespace santa
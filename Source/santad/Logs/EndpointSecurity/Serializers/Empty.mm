@@ -160,6 +160,15 @@ std::vector<uint8_t> Empty::SerializeNetworkFlows(SNDProcessFlows*, struct times
   return {};
 }
 
+bool Empty::AggregateNetworkFlows(NetworkFlowAggregator&, SNDProcessFlows*, struct timespec,
+                                  struct timespec, SNTCachedDecision*) {
+  return false;
+}
+
+std::vector<uint8_t> Empty::SerializeNetworkActivity(const NetworkFlowAggregator::Window&) {
+  return {};
+}
+
 std::vector<uint8_t> Empty::SerializeFileAccess(
     const std::string& policy_version, const std::string& policy_name, const Message& msg,
     const EnrichedProcess& enriched_process, size_t target_index,
@@ -185,4 +194,13 @@ std::vector<uint8_t> Empty::SerializeDiskDisappeared(NSDictionary* props) {
   return {};
 }
 
+std::vector<uint8_t> Empty::SerializeEventSummary(const EventSummary&, struct timespec,
+                                                  struct timespec) {
+  return {};
+}
+
+std::vector<uint8_t> Empty::SerializeExecTrace(const ExecTrace::Summary&) {
+  return {};
+}
+
 }  // namespace santa
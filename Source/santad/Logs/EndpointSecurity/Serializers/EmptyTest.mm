@@ -48,6 +48,9 @@ using santa::Empty;
   XCTAssertEqual(e->SerializeBundleHashingEvent(nil).size(), 0);
   XCTAssertEqual(e->SerializeDiskAppeared(nil, true).size(), 0);
   XCTAssertEqual(e->SerializeDiskDisappeared(nil).size(), 0);
+  XCTAssertEqual(e->SerializeEventSummary({}, {}, {}).size(), 0);
+  XCTAssertEqual(e->SerializeNetworkActivity({}).size(), 0);
+  XCTAssertEqual(e->SerializeExecTrace({}).size(), 0);
 }
 
 @end
@@ -40,6 +40,15 @@ typedef uint8_t es_cdhash_t[20];
 
 namespace santa {
 
+// Cumulative counts of exec events whose arguments or environment were cut
+// short to fit the configured byte budgets.
+struct ExecCaptureStats {
+  uint64_t args_truncated;
+  uint64_t envs_truncated;
+  // Environments logged as a hash, not counted in envs_truncated.
+  uint64_t envs_hashed;
+};
+
 class Protobuf : public Serializer {
  public:
   static std::shared_ptr<Protobuf> Create(std::shared_ptr<santa::EndpointSecurityAPI> esapi,
@@ -86,6 +95,10 @@ class Protobuf : public Serializer {
 
   std::vector<uint8_t> SerializeNetworkFlows(SNDProcessFlows*, struct timespec, struct timespec,
                                              SNTCachedDecision*) override;
+  bool AggregateNetworkFlows(santa::NetworkFlowAggregator&, SNDProcessFlows*, struct timespec,
+                             struct timespec, SNTCachedDecision*) override;
+  std::vector<uint8_t> SerializeNetworkActivity(
+      const santa::NetworkFlowAggregator::Window&) override;
 
   std::vector<uint8_t> SerializeFileAccess(
       const std::string& policy_version, const std::string& policy_name, const santa::Message& msg,
@@ -101,6 +114,14 @@ class Protobuf : public Serializer {
   std::vector<uint8_t> SerializeDiskAppeared(NSDictionary*, bool) override;
   std::vector<uint8_t> SerializeDiskDisappeared(NSDictionary*) override;
 
+  std::vector<uint8_t> SerializeEventSummary(const santa::EventSummary&, struct timespec,
+                                             struct timespec) override;
+
+  std::vector<uint8_t> SerializeExecTrace(const santa::ExecTrace::Summary&) override;
+
+  // Totals across all Protobuf serializers since santad started.
+  static ExecCaptureStats CollectExecCaptureStats();
+
  private:
   ::santa::pb::v1::SantaMessage* CreateDefaultProto(google::protobuf::Arena* arena);
   ::santa::pb::v1::SantaMessage* CreateDefaultProto(google::protobuf::Arena* arena,
@@ -120,6 +141,10 @@ class Protobuf : public Serializer {
   // Toggle for transforming protobuf output to its JSON form.
   // See https://protobuf.dev/programming-guides/proto3/#json
   bool json_;
+  // Per-event byte budgets for exec args and envs, 0 for no limit.
+  uint64_t exec_args_max_bytes_;
+  uint64_t exec_envs_max_bytes_;
+  bool hash_truncated_exec_envs_;
   // Cached boot session UUID to avoid repeated ObjC dispatch on every event.
   std::string boot_session_uuid_;
   // Random per-process salt, generated once at construction. Each event_id is
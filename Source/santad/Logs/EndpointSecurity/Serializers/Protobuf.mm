@@ -26,19 +26,25 @@
 #include <sys/wait.h>
 #include <time.h>
 
+#include <atomic>
 #include <optional>
+#include <string>
 #include <string_view>
 
 #include "Source/common/AuditUtilities.h"
+#include "Source/common/BufferPool.h"
 #include "Source/common/EncodeEntitlements.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTConfigurator.h"
 #include "Source/common/SNTLogging.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/SNTSystemInfo.h"
 #include "Source/common/SNTXxhash.h"
 #import "Source/common/String.h"
+#include "Source/common/TelemetryEventMap.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/ReusableArena.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Utilities.h"
 #import "Source/santad/SNTDecisionCache.h"
 #include "absl/status/status.h"
@@ -46,6 +52,7 @@
 #import "src/santanetd/NetworkFlowsSerializer.h"
 
 using google::protobuf::Arena;
+using google::protobuf::RepeatedPtrField;
 using google::protobuf::Timestamp;
 using JsonPrintOptions = google::protobuf::json::PrintOptions;
 using google::protobuf::json::MessageToJsonString;
@@ -54,6 +61,18 @@ namespace pbv1 = ::santa::pb::v1;
 
 namespace santa {
 
+static std::atomic<uint64_t> exec_args_truncated = 0;
+static std::atomic<uint64_t> exec_envs_truncated = 0;
+static std::atomic<uint64_t> exec_envs_hashed = 0;
+
+ExecCaptureStats Protobuf::CollectExecCaptureStats() {
+  return {
+      .args_truncated = exec_args_truncated.load(std::memory_order_relaxed),
+      .envs_truncated = exec_envs_truncated.load(std::memory_order_relaxed),
+      .envs_hashed = exec_envs_hashed.load(std::memory_order_relaxed),
+  };
+}
+
 std::shared_ptr<Protobuf> Protobuf::Create(std::shared_ptr<EndpointSecurityAPI> esapi,
                                            SNTDecisionCache* decision_cache, bool json) {
   return std::make_shared<Protobuf>(esapi, std::move(decision_cache), json);
@@ -64,6 +83,9 @@ Protobuf::Protobuf(std::shared_ptr<EndpointSecurityAPI> esapi, SNTDecisionCache*
     : Serializer(std::move(decision_cache)),
       esapi_(std::move(esapi)),
       json_(json),
+      exec_args_max_bytes_([[SNTConfigurator configurator] execArgsMaxBytes]),
+      exec_envs_max_bytes_([[SNTConfigurator configurator] execEnvsMaxBytes]),
+      hash_truncated_exec_envs_([[SNTConfigurator configurator] hashTruncatedExecEnvs]),
       boot_session_uuid_(NSStringToUTF8String([SNTSystemInfo bootSessionUUID])) {
   // Generate a random per-process salt mixed into each event_id hash.
   arc4random_buf(session_salt_.data(), session_salt_.size());
@@ -202,11 +224,27 @@ static inline void EncodeFileInfoLight(::pbv1::FileInfoLight* pb_file, const es_
   pb_file->set_truncated(es_file->path_truncated);
 }
 
-template <typename F>
-static inline void EncodeAnnotations(F&& lazy_f, const EnrichedProcess& enriched_proc) {
-  if (std::optional<pbv1::process_tree::Annotations> proc_annotations = enriched_proc.annotations();
-      proc_annotations) {
-    *lazy_f() = *proc_annotations;
+// Whether the message being built on this thread will be serialized to the
+// binary wire format. Set for each message by CreateDefaultProto.
+static thread_local bool encode_binary = false;
+
+// Processes keep their annotations both merged and encoded. For binary output,
+// the encoded bytes are added as an unknown field with the number of the
+// annotations field, so they are written out as is and parse back as regular
+// annotations. The JSON printer skips unknown fields, so JSON output copies the
+// message instead.
+template <typename T>
+static inline void EncodeAnnotations(T* pb_proc_info, const EnrichedProcess& enriched_proc) {
+  const auto& proc_annotations = enriched_proc.annotations();
+  if (!proc_annotations) {
+    return;
+  }
+
+  if (encode_binary) {
+    pb_proc_info->mutable_unknown_fields()->AddLengthDelimited(T::kAnnotationsFieldNumber,
+                                                               proc_annotations->serialized);
+  } else {
+    pb_proc_info->mutable_annotations()->CopyFrom(proc_annotations->proto);
   }
 }
 
@@ -245,7 +283,7 @@ static inline void EncodeProcessInfoLight(::pbv1::ProcessInfoLight* pb_proc_info
 
   EncodeFileInfoLight(pb_proc_info->mutable_executable(), es_proc->executable);
 
-  EncodeAnnotations([pb_proc_info] { return pb_proc_info->mutable_annotations(); }, enriched_proc);
+  EncodeAnnotations(pb_proc_info, enriched_proc);
 }
 
 static inline void EncodeProcessInfoLight(::pbv1::ProcessInfoLight* pb_proc_info,
@@ -297,7 +335,7 @@ static inline void EncodeProcessInfo(::pbv1::ProcessInfo* pb_proc_info, uint32_t
     EncodeTimestamp(pb_proc_info->mutable_start_time(), es_proc->start_time);
   }
 
-  EncodeAnnotations([pb_proc_info] { return pb_proc_info->mutable_annotations(); }, enriched_proc);
+  EncodeAnnotations(pb_proc_info, enriched_proc);
 }
 
 void EncodeExitStatus(::pbv1::Exit* pb_exit, int exitStatus) {
@@ -429,6 +467,7 @@ static inline void EncodeCertificateInfo(::pbv1::CertificateInfo* pb_cert_info,
 ::pbv1::SantaMessage* Protobuf::CreateDefaultProto(Arena* arena, struct timespec event_time,
                                                    struct timespec processed_time) {
   ::pbv1::SantaMessage* santa_msg = Arena::Create<::pbv1::SantaMessage>(arena);
+  encode_binary = !json_;
 
   if (EnableMachineIDDecoration()) {
     EncodeString([santa_msg] { return santa_msg->mutable_machine_id(); }, *MachineID());
@@ -484,20 +523,24 @@ std::vector<uint8_t> Protobuf::FinalizeProto(::pbv1::SantaMessage* santa_msg) {
       LOGE(@"Failed to convert protobuf to JSON: %s", status.ToString().c_str());
     }
 
-    std::vector<uint8_t> vec(json.begin(), json.end());
+    std::vector<uint8_t> vec = BufferPool::Shared().Acquire(json.size() + 1);
+    vec.assign(json.begin(), json.end());
     // Add a newline to the end of the JSON row.
     vec.push_back('\n');
     return vec;
   }
 
-  std::vector<uint8_t> vec(santa_msg->ByteSizeLong());
+  // The buffer is returned to the pool by the writer once it has been consumed.
+  size_t size = santa_msg->ByteSizeLong();
+  std::vector<uint8_t> vec = BufferPool::Shared().Acquire(size);
+  vec.resize(size);
   santa_msg->SerializeWithCachedSizesToArray(vec.data());
   return vec;
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedClose& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Close* pb_close = santa_msg->mutable_close();
 
@@ -509,8 +552,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedClose& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExchange& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Exchangedata* pb_exchangedata = santa_msg->mutable_exchangedata();
 
@@ -537,9 +580,58 @@ void EncodeEntitlements(::pbv1::Execution* pb_exec, SNTCachedDecision* cd) {
       });
 }
 
+// Adds `count` strings returned by `string_at` to `field`, keeping at most
+// `max_bytes` of them (0 for no limit). The string crossing the limit is cut
+// short and the rest are dropped. Returns whether anything was dropped.
+template <typename F>
+static bool EncodeExecStrings(RepeatedPtrField<std::string>* field, uint32_t count,
+                              uint64_t max_bytes, F&& string_at) {
+  uint64_t remaining = max_bytes;
+  for (uint32_t i = 0; i < count; i++) {
+    es_string_token_t tok = string_at(i);
+    if (max_bytes > 0) {
+      if (tok.length > remaining) {
+        if (remaining > 0) {
+          field->Add()->assign(tok.data, remaining);
+        }
+        return true;
+      }
+      remaining -= tok.length;
+    }
+    field->Add()->assign(tok.data, tok.length);
+  }
+  return false;
+}
+
+// Like EncodeExecStrings, but if the strings don't fit in `max_bytes`, none are
+// kept and the hex encoded hash of all of them is returned instead.
+template <typename F>
+static std::optional<std::string> EncodeExecStringsOrHash(RepeatedPtrField<std::string>* field,
+                                                          uint32_t count, uint64_t max_bytes,
+                                                          F&& string_at) {
+  Xxhash128 hash;
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    es_string_token_t tok = string_at(i);
+    hash.Update(tok.data, tok.length);
+    // Separate the strings so {"ab", "c"} and {"a", "bc"} hash differently.
+    hash.Update("", 1);
+    total += tok.length;
+    if (total <= max_bytes) {
+      field->Add()->assign(tok.data, tok.length);
+    }
+  }
+
+  if (total <= max_bytes) {
+    return std::nullopt;
+  }
+  field->Clear();
+  return hash.HexDigest();
+}
+
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExec& msg, SNTCachedDecision* cd) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Execution* pb_exec = santa_msg->mutable_execution();
 
@@ -559,18 +651,31 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExec& msg, SNTCach
   uint32_t arg_count = esapi_->ExecArgCount(&msg->event.exec);
   if (arg_count > 0) {
     pb_exec->mutable_args()->Reserve(arg_count);
-    for (uint32_t i = 0; i < arg_count; i++) {
-      es_string_token_t tok = esapi_->ExecArg(&msg->event.exec, i);
-      pb_exec->add_args(tok.data, tok.length);
+    if (EncodeExecStrings(pb_exec->mutable_args(), arg_count, exec_args_max_bytes_,
+                          [this, &msg](uint32_t i) {
+                            return esapi_->ExecArg(&msg->event.exec, i);
+                          })) {
+      pb_exec->set_args_truncated(true);
+      exec_args_truncated.fetch_add(1, std::memory_order_relaxed);
     }
   }
 
   uint32_t env_count = esapi_->ExecEnvCount(&msg->event.exec);
   if (env_count > 0) {
+    auto env_at = [this, &msg](uint32_t i) { return esapi_->ExecEnv(&msg->event.exec, i); };
     pb_exec->mutable_envs()->Reserve(env_count);
-    for (uint32_t i = 0; i < env_count; i++) {
-      es_string_token_t tok = esapi_->ExecEnv(&msg->event.exec, i);
-      pb_exec->add_envs(tok.data, tok.length);
+    if (hash_truncated_exec_envs_ && exec_envs_max_bytes_ > 0) {
+      std::optional<std::string> envs_hash =
+          EncodeExecStringsOrHash(pb_exec->mutable_envs(), env_count, exec_envs_max_bytes_, env_at);
+      if (envs_hash.has_value()) {
+        pb_exec->set_envs_truncated(true);
+        pb_exec->set_envs_hash(*std::move(envs_hash));
+        exec_envs_hashed.fetch_add(1, std::memory_order_relaxed);
+      }
+    } else if (EncodeExecStrings(pb_exec->mutable_envs(), env_count, exec_envs_max_bytes_,
+                                 env_at)) {
+      pb_exec->set_envs_truncated(true);
+      exec_envs_truncated.fetch_add(1, std::memory_order_relaxed);
     }
   }
 
@@ -628,8 +733,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExec& msg, SNTCach
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExit& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Exit* pb_exit = santa_msg->mutable_exit();
 
@@ -640,8 +745,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedExit& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedFork& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Fork* pb_fork = santa_msg->mutable_fork();
 
@@ -652,8 +757,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedFork& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLink& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Link* pb_link = santa_msg->mutable_link();
   EncodeProcessInfoLight(pb_link->mutable_instigator(), msg);
@@ -665,8 +770,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLink& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedRename& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Rename* pb_rename = santa_msg->mutable_rename();
   EncodeProcessInfoLight(pb_rename->mutable_instigator(), msg);
@@ -684,8 +789,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedRename& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedUnlink& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Unlink* pb_unlink = santa_msg->mutable_unlink();
   EncodeProcessInfoLight(pb_unlink->mutable_instigator(), msg);
@@ -695,8 +800,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedUnlink& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedCSInvalidated& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::CodesigningInvalidated* pb_cs_invalidated = santa_msg->mutable_codesigning_invalidated();
   EncodeProcessInfoLight(pb_cs_invalidated->mutable_instigator(), msg);
@@ -716,8 +821,8 @@ static ::pbv1::ProcSuspendResume::Type GetProcSuspendResumeType(
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedProcSuspendResume& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::ProcSuspendResume* pb_psr = santa_msg->mutable_proc_suspend_resume();
   EncodeProcessInfoLight(pb_psr->mutable_instigator(), msg);
@@ -731,8 +836,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedProcSuspendResume&
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedClone& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Clone* pb_clone = santa_msg->mutable_clone();
   EncodeProcessInfoLight(pb_clone->mutable_instigator(), msg);
@@ -743,8 +848,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedClone& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedCopyfile& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Copyfile* pb_copyfile = santa_msg->mutable_copyfile();
   EncodeProcessInfoLight(pb_copyfile->mutable_instigator(), msg);
@@ -799,8 +904,8 @@ static inline void EncodeUserInfo(F&& lazy_f, const es_string_token_t& name) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSessionLogin& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::LoginWindowSessionLogin* pb_lw_login =
       santa_msg->mutable_login_window_session()->mutable_login();
 
@@ -815,8 +920,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSession
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSessionLogout& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::LoginWindowSessionLogout* pb_lw_logout =
       santa_msg->mutable_login_window_session()->mutable_logout();
 
@@ -831,8 +936,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSession
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSessionLock& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::LoginWindowSessionLock* pb_lw_lock =
       santa_msg->mutable_login_window_session()->mutable_lock();
 
@@ -846,8 +951,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSession
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSessionUnlock& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::LoginWindowSessionUnlock* pb_lw_unlock =
       santa_msg->mutable_login_window_session()->mutable_unlock();
 
@@ -862,8 +967,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginWindowSession
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedScreenSharingAttach& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::ScreenSharingAttach* pb_attach = santa_msg->mutable_screen_sharing()->mutable_attach();
 
   EncodeProcessInfoLight(pb_attach->mutable_instigator(), msg);
@@ -890,8 +995,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedScreenSharingAttac
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedScreenSharingDetach& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::ScreenSharingDetach* pb_detach = santa_msg->mutable_screen_sharing()->mutable_detach();
 
   EncodeProcessInfoLight(pb_detach->mutable_instigator(), msg);
@@ -908,8 +1013,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedScreenSharingDetac
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedOpenSSHLogin& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::OpenSSHLogin* pb_ssh_login = santa_msg->mutable_open_ssh()->mutable_login();
 
   EncodeProcessInfoLight(pb_ssh_login->mutable_instigator(), msg);
@@ -929,8 +1034,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedOpenSSHLogin& msg)
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedOpenSSHLogout& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::OpenSSHLogout* pb_ssh_logout = santa_msg->mutable_open_ssh()->mutable_logout();
 
   EncodeProcessInfoLight(pb_ssh_logout->mutable_instigator(), msg);
@@ -945,8 +1050,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedOpenSSHLogout& msg
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginLogin& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::Login* pb_login = santa_msg->mutable_login_logout()->mutable_login();
 
   EncodeProcessInfoLight(pb_login->mutable_instigator(), msg);
@@ -964,8 +1069,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginLogin& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLoginLogout& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::Logout* pb_logout = santa_msg->mutable_login_logout()->mutable_logout();
 
   EncodeProcessInfoLight(pb_logout->mutable_instigator(), msg);
@@ -999,8 +1104,8 @@ static inline void EncodeEventInstigatorOrFallback(const EnrichedEventWithInstig
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationOD& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Authentication* pb_auth = santa_msg->mutable_authentication();
   pb_auth->set_success(msg->event.authentication->success);
@@ -1030,8 +1135,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationOD&
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationTouchID& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Authentication* pb_auth = santa_msg->mutable_authentication();
   pb_auth->set_success(msg->event.authentication->success);
@@ -1053,8 +1158,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationTouc
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationToken& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Authentication* pb_auth = santa_msg->mutable_authentication();
   pb_auth->set_success(msg->event.authentication->success);
@@ -1086,8 +1191,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationToke
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationAutoUnlock& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::Authentication* pb_auth = santa_msg->mutable_authentication();
   pb_auth->set_success(msg->event.authentication->success);
@@ -1119,8 +1224,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedAuthenticationAuto
 
 std::vector<uint8_t> Protobuf::SerializeMessageLaunchItemAdd(const EnrichedLaunchItem& msg) {
   assert(msg->event_type == ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_ADD);
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   const es_event_btm_launch_item_add_t* btm = msg->event.btm_launch_item_add;
 
@@ -1157,8 +1262,8 @@ std::vector<uint8_t> Protobuf::SerializeMessageLaunchItemAdd(const EnrichedLaunc
 
 std::vector<uint8_t> Protobuf::SerializeMessageLaunchItemRemove(const EnrichedLaunchItem& msg) {
   assert(msg->event_type == ES_EVENT_TYPE_NOTIFY_BTM_LAUNCH_ITEM_REMOVE);
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   const es_event_btm_launch_item_remove_t* btm = msg->event.btm_launch_item_remove;
 
@@ -1205,8 +1310,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedLaunchItem& msg) {
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedXProtectDetected& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::XProtect* pb_xp = santa_msg->mutable_xprotect();
   ::pbv1::XProtectDetected* pb_xp_detected = pb_xp->mutable_detected();
@@ -1227,8 +1332,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedXProtectDetected&
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedXProtectRemediated& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::XProtect* pb_xp = santa_msg->mutable_xprotect();
   ::pbv1::XProtectRemediated* pb_xp_remediated = pb_xp->mutable_remediated();
@@ -1280,8 +1385,8 @@ static inline void EncodeFileInfo(::pbv1::FileInfo* pb_file, es_string_token_t p
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedGatekeeperOverride& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
   ::pbv1::GatekeeperOverride* pb_gk = santa_msg->mutable_gatekeeper_override();
   es_event_gatekeeper_user_override_t* gk = msg->event.gatekeeper_user_override;
 
@@ -1391,8 +1496,8 @@ std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedGatekeeperOverride
 }
 
 std::vector<uint8_t> Protobuf::SerializeMessage(const EnrichedTCCModification& msg) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   const es_event_tcc_modify_t* tcc = msg->event.tcc_modify;
 
@@ -1424,11 +1529,31 @@ std::vector<uint8_t> Protobuf::SerializeNetworkFlows(SNDProcessFlows* processFlo
                                                      struct timespec window_start,
                                                      struct timespec window_end,
                                                      SNTCachedDecision* cd) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, window_start, window_end);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), window_start, window_end);
   auto* na = santa_msg->mutable_network_activity();
   auto* process = na->add_processes();
-  santanetd::PopulateNetworkActivityProcess(&arena, process, processFlows, cd);
+  santanetd::PopulateNetworkActivityProcess(arena.get(), process, processFlows, cd);
+  return FinalizeProto(santa_msg);
+}
+
+bool Protobuf::AggregateNetworkFlows(NetworkFlowAggregator& aggregator,
+                                     SNDProcessFlows* processFlows, struct timespec window_start,
+                                     struct timespec window_end, SNTCachedDecision* cd) {
+  ReusableArena arena;
+  auto* process = Arena::Create<::pbv1::NetworkActivity::Process>(arena.get());
+  santanetd::PopulateNetworkActivityProcess(arena.get(), process, processFlows, cd);
+  return aggregator.Add(*process, window_start, window_end);
+}
+
+std::vector<uint8_t> Protobuf::SerializeNetworkActivity(
+    const NetworkFlowAggregator::Window& window) {
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), window.start, window.end);
+  auto* na = santa_msg->mutable_network_activity();
+  for (const ::pbv1::NetworkActivity::Process& process : window.processes) {
+    *na->add_processes() = process;
+  }
   return FinalizeProto(santa_msg);
 }
 
@@ -1437,8 +1562,8 @@ std::vector<uint8_t> Protobuf::SerializeFileAccess(
     const EnrichedProcess& enriched_process, size_t target_index,
     std::optional<santa::EnrichedFile> enriched_event_target, FileAccessPolicyDecision decision,
     std::string_view operation_id, int64_t rule_id) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena, msg);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), msg);
 
   ::pbv1::FileAccess* file_access = santa_msg->mutable_file_access();
 
@@ -1470,8 +1595,8 @@ std::vector<uint8_t> Protobuf::SerializeFileAccess(
 
 std::vector<uint8_t> Protobuf::SerializeAllowlist(const Message& msg, const std::string_view hash,
                                                   const std::string_view target_path) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get());
 
   const es_file_t* es_file = santa::GetAllowListTargetFile(msg);
 
@@ -1497,8 +1622,8 @@ std::vector<uint8_t> Protobuf::SerializeAllowlist(const Message& msg, const std:
 }
 
 std::vector<uint8_t> Protobuf::SerializeBundleHashingEvent(SNTStoredExecutionEvent* event) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get());
 
   ::pbv1::Bundle* pb_bundle = santa_msg->mutable_bundle();
 
@@ -1565,8 +1690,8 @@ static void EncodeDisk(::pbv1::Disk* pb_disk, ::pbv1::Disk_Action action, NSDict
 }
 
 std::vector<uint8_t> Protobuf::SerializeDiskAppeared(NSDictionary* props, bool allowed) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get());
 
   EncodeDisk(santa_msg->mutable_disk(),
              allowed ? ::pbv1::Disk::ACTION_APPEARED : ::pbv1::Disk::ACTION_BLOCKED, props,
@@ -1576,12 +1701,61 @@ std::vector<uint8_t> Protobuf::SerializeDiskAppeared(NSDictionary* props, bool a
 }
 
 std::vector<uint8_t> Protobuf::SerializeDiskDisappeared(NSDictionary* props) {
-  Arena arena;
-  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(&arena);
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get());
 
   EncodeDisk(santa_msg->mutable_disk(), ::pbv1::Disk::ACTION_DISAPPEARED, props, true);
 
   return FinalizeProto(santa_msg);
 }
 
+std::vector<uint8_t> Protobuf::SerializeEventSummary(const EventSummary& summary,
+                                                     struct timespec window_start,
+                                                     struct timespec window_end) {
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg = CreateDefaultProto(arena.get(), window_start, window_end);
+  ::pbv1::EventSummary* pb_summary = santa_msg->mutable_event_summary();
+
+  EncodeString([pb_summary] { return pb_summary->mutable_executable_path(); },
+               summary.executable_path);
+  EncodeString([pb_summary] { return pb_summary->mutable_event_type(); },
+               TelemetryEventToName(summary.event));
+  pb_summary->set_count(summary.count);
+
+  for (const auto& [path, count] : summary.top_paths) {
+    ::pbv1::EventSummary::PathCount* pb_path = pb_summary->add_top_paths();
+    EncodeString([pb_path] { return pb_path->mutable_path(); }, path);
+    pb_path->set_count(count);
+  }
+
+  return FinalizeProto(santa_msg);
+}
+
+std::vector<uint8_t> Protobuf::SerializeExecTrace(const ExecTrace::Summary& trace) {
+  ReusableArena arena;
+  ::pbv1::SantaMessage* santa_msg =
+      CreateDefaultProto(arena.get(), trace.start_time, trace.end_time);
+  ::pbv1::ExecTrace* pb_trace = santa_msg->mutable_exec_trace();
+
+  pb_trace->set_trace_id(trace.id);
+  pb_trace->set_pid(trace.pid);
+  EncodeString([pb_trace] { return pb_trace->mutable_target_path(); }, trace.path);
+  EncodeString([pb_trace] { return pb_trace->mutable_result(); }, trace.result);
+
+  for (size_t i = 0; i < kExecTraceStageCount; i++) {
+    if (trace.stage_ns[i] == 0) {
+      continue;
+    }
+    ::pbv1::ExecTrace::Stage* pb_stage = pb_trace->add_stages();
+    EncodeString([pb_stage] { return pb_stage->mutable_name(); },
+                 ExecTraceStageName(static_cast<ExecTraceStage>(i)));
+    pb_stage->set_duration_ns(trace.stage_ns[i]);
+  }
+
+  pb_trace->set_total_ns(trace.total_ns);
+  pb_trace->set_hash_bytes_read(trace.hash_bytes_read);
+
+  return FinalizeProto(santa_msg);
+}
+
 }  // namespace santa
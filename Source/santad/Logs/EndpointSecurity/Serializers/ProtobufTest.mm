@@ -456,7 +456,7 @@ void SerializeAndCheckNonESEvents(
 
   self.mockDecisionCache = OCMClassMock([SNTDecisionCache class]);
   OCMStub([self.mockDecisionCache sharedCache]).andReturn(self.mockDecisionCache);
-  OCMStub([self.mockDecisionCache resetTimestampForCachedDecision:{}])
+  OCMStub([self.mockDecisionCache takeDecisionForExecOfProcess:{} file:{}])
       .ignoringNonObjectArgs()
       .andReturn(self.testCachedDecision);
 }
@@ -2046,6 +2046,100 @@ void SerializeAndCheckNonESEvents(
   XCTAssertFalse(pbDisk.has_appearance());
 }
 
+- (void)testSerializeEventSummary {
+  santa::EventSummary summary{
+      .executable_path = "/usr/bin/make",
+      .event = santa::TelemetryEvent::kFork,
+      .count = 42,
+      .top_paths = {{"/tmp/a", 30}, {"/tmp/b", 12}},
+  };
+
+  std::vector<uint8_t> vec = Protobuf::Create(nullptr, nil)->SerializeEventSummary(
+      summary, {.tv_sec = 100, .tv_nsec = 0}, {.tv_sec = 160, .tv_nsec = 0});
+  std::string protoStr(vec.begin(), vec.end());
+
+  ::pbv1::SantaMessage santaMsg;
+  XCTAssertTrue(santaMsg.ParseFromString(protoStr));
+  XCTAssertTrue(santaMsg.has_event_summary());
+  XCTAssertEqual(santaMsg.event_time().seconds(), 100);
+  XCTAssertEqual(santaMsg.processed_time().seconds(), 160);
+
+  const ::pbv1::EventSummary& pbSummary = santaMsg.event_summary();
+  XCTAssertEqualObjects(@(pbSummary.executable_path().c_str()), @"/usr/bin/make");
+  XCTAssertEqualObjects(@(pbSummary.event_type().c_str()), @"fork");
+  XCTAssertEqual(pbSummary.count(), 42);
+  XCTAssertEqual(pbSummary.top_paths_size(), 2);
+  XCTAssertEqualObjects(@(pbSummary.top_paths(0).path().c_str()), @"/tmp/a");
+  XCTAssertEqual(pbSummary.top_paths(0).count(), 30);
+  XCTAssertEqualObjects(@(pbSummary.top_paths(1).path().c_str()), @"/tmp/b");
+  XCTAssertEqual(pbSummary.top_paths(1).count(), 12);
+}
+
+- (void)testSerializeNetworkActivity {
+  santa::NetworkFlowAggregator::Window window{
+      .start = {.tv_sec = 100, .tv_nsec = 0},
+      .end = {.tv_sec = 400, .tv_nsec = 0},
+  };
+  ::pbv1::NetworkActivity::Process& process = window.processes.emplace_back();
+  process.mutable_process()->mutable_id()->set_pid(12);
+  ::pbv1::NetworkActivity::Flow* flow = process.add_flows();
+  flow->set_remote_address("10.0.0.1");
+  flow->set_remote_port(443);
+  flow->set_bytes_outbound(1234);
+  flow->set_flow_count(3);
+
+  std::vector<uint8_t> vec = Protobuf::Create(nullptr, nil)->SerializeNetworkActivity(window);
+  std::string protoStr(vec.begin(), vec.end());
+
+  ::pbv1::SantaMessage santaMsg;
+  XCTAssertTrue(santaMsg.ParseFromString(protoStr));
+  XCTAssertTrue(santaMsg.has_network_activity());
+  XCTAssertEqual(santaMsg.event_time().seconds(), 100);
+  XCTAssertEqual(santaMsg.processed_time().seconds(), 400);
+
+  const ::pbv1::NetworkActivity& pbActivity = santaMsg.network_activity();
+  XCTAssertEqual(pbActivity.processes_size(), 1);
+  XCTAssertEqual(pbActivity.processes(0).process().id().pid(), 12);
+  XCTAssertEqual(pbActivity.processes(0).flows_size(), 1);
+  XCTAssertEqualObjects(@(pbActivity.processes(0).flows(0).remote_address().c_str()), @"10.0.0.1");
+  XCTAssertEqual(pbActivity.processes(0).flows(0).bytes_outbound(), 1234);
+  XCTAssertEqual(pbActivity.processes(0).flows(0).flow_count(), 3);
+}
+
+- (void)testSerializeExecTrace {
+  santa::ExecTrace::Summary trace{
+      .id = 7,
+      .pid = 123,
+      .path = "/usr/bin/make",
+      .result = "deny",
+      .start_time = {.tv_sec = 100, .tv_nsec = 0},
+      .end_time = {.tv_sec = 101, .tv_nsec = 0},
+      .total_ns = 5000,
+      .hash_bytes_read = 4096,
+  };
+  trace.stage_ns[static_cast<size_t>(santa::ExecTraceStage::kCodesign)] = 3000;
+
+  std::vector<uint8_t> vec = Protobuf::Create(nullptr, nil)->SerializeExecTrace(trace);
+  std::string protoStr(vec.begin(), vec.end());
+
+  ::pbv1::SantaMessage santaMsg;
+  XCTAssertTrue(santaMsg.ParseFromString(protoStr));
+  XCTAssertTrue(santaMsg.has_exec_trace());
+  XCTAssertEqual(santaMsg.event_time().seconds(), 100);
+  XCTAssertEqual(santaMsg.processed_time().seconds(), 101);
+
+  const ::pbv1::ExecTrace& pbTrace = santaMsg.exec_trace();
+  XCTAssertEqual(pbTrace.trace_id(), 7);
+  XCTAssertEqual(pbTrace.pid(), 123);
+  XCTAssertEqualObjects(@(pbTrace.target_path().c_str()), @"/usr/bin/make");
+  XCTAssertEqualObjects(@(pbTrace.result().c_str()), @"deny");
+  XCTAssertEqual(pbTrace.total_ns(), 5000);
+  XCTAssertEqual(pbTrace.hash_bytes_read(), 4096);
+  XCTAssertEqual(pbTrace.stages_size(), 1);
+  XCTAssertEqualObjects(@(pbTrace.stages(0).name().c_str()), @"codesign");
+  XCTAssertEqual(pbTrace.stages(0).duration_ns(), 3000);
+}
+
 - (void)testSerializeDiskDisppeared {
   NSDictionary* props = @{
     @"DADevicePath" : @"",
@@ -2137,6 +2231,126 @@ void SerializeAndCheckNonESEvents(
   XCTAssertFalse(santaMsg2.execution().has_rule_id());
 }
 
+- (void)testSerializeExecArgsAndEnvsBudget {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+
+  es_file_t procFile = MakeESFile("foo", MakeStat(100));
+  es_file_t procFileTarget = MakeESFile("fooexec", MakeStat(300));
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_process_t procTarget =
+      MakeESProcess(&procFileTarget, MakeAuditToken(23, 45), MakeAuditToken(67, 89));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_EXEC, &proc);
+  esMsg.event.exec.target = &procTarget;
+  esMsg.event.exec.last_fd = 0;
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.decision = SNTEventStateAllowBinary;
+  cd.decisionClientMode = SNTClientModeLockdown;
+
+  OCMStub([self.mockConfigurator execArgsMaxBytes]).andReturn(10);
+  OCMStub([self.mockConfigurator execEnvsMaxBytes]).andReturn(8);
+
+  auto serialize = ^::pbv1::Execution(std::shared_ptr<Serializer> serializer) {
+    mockESApi->SetExpectationsRetainReleaseMessage();
+    EXPECT_CALL(*mockESApi, ExecArgCount).WillOnce(testing::Return(3));
+    EXPECT_CALL(*mockESApi, ExecArg)
+        .WillOnce(testing::Return(MakeESStringToken("exec")))
+        .WillOnce(testing::Return(MakeESStringToken("--foo")))
+        .WillOnce(testing::Return(MakeESStringToken("--bar")));
+    EXPECT_CALL(*mockESApi, ExecEnvCount).WillOnce(testing::Return(2));
+    EXPECT_CALL(*mockESApi, ExecEnv)
+        .WillOnce(testing::Return(MakeESStringToken("A=1")))
+        .WillOnce(testing::Return(MakeESStringToken("PATH=/bin")));
+    if (esMsg.version >= 4) {
+      EXPECT_CALL(*mockESApi, ExecFDCount).WillOnce(testing::Return(0));
+    }
+
+    auto enrichedMsg = Enricher().Enrich(Message(mockESApi, &esMsg));
+    const auto& execMsg = std::get<santa::EnrichedExec>(enrichedMsg->GetEnrichedMessage());
+    std::vector<uint8_t> vec = serializer->SerializeMessage(execMsg, cd);
+
+    ::pbv1::SantaMessage santaMsg;
+    XCTAssertTrue(santaMsg.ParseFromString(std::string(vec.begin(), vec.end())));
+    XCTAssertTrue(santaMsg.has_execution());
+    XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+    return santaMsg.execution();
+  };
+
+  santa::ExecCaptureStats before = Protobuf::CollectExecCaptureStats();
+
+  // The strings crossing the budget are cut short
+  ::pbv1::Execution pbExec = serialize(Protobuf::Create(mockESApi, nil));
+  XCTAssertEqual(pbExec.args_size(), 3);
+  XCTAssertEqual(pbExec.args(0), "exec");
+  XCTAssertEqual(pbExec.args(1), "--foo");
+  XCTAssertEqual(pbExec.args(2), "-");
+  XCTAssertTrue(pbExec.args_truncated());
+  XCTAssertEqual(pbExec.envs_size(), 2);
+  XCTAssertEqual(pbExec.envs(0), "A=1");
+  XCTAssertEqual(pbExec.envs(1), "PATH=");
+  XCTAssertTrue(pbExec.envs_truncated());
+  XCTAssertFalse(pbExec.has_envs_hash());
+
+  // Large environments can be replaced by their hash
+  OCMStub([self.mockConfigurator hashTruncatedExecEnvs]).andReturn(YES);
+  pbExec = serialize(Protobuf::Create(mockESApi, nil));
+  XCTAssertEqual(pbExec.envs_size(), 0);
+  XCTAssertTrue(pbExec.envs_truncated());
+  XCTAssertEqual(pbExec.envs_hash().size(), 32);
+
+  santa::ExecCaptureStats after = Protobuf::CollectExecCaptureStats();
+  XCTAssertEqual(after.args_truncated - before.args_truncated, 2);
+  XCTAssertEqual(after.envs_truncated - before.envs_truncated, 1);
+  XCTAssertEqual(after.envs_hashed - before.envs_hashed, 1);
+}
+
+- (void)testSerializeAnnotations {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  es_file_t procFile = MakeESFile("foo", MakeStat(100));
+  es_file_t openFile = MakeESFile("open_file", MakeStat(300));
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_OPEN, &proc);
+  esMsg.event.open.file = &openFile;
+
+  Message msg(mockESApi, &esMsg);
+  (void)msg.PathTargets();
+
+  ::santa::pb::v1::process_tree::Annotations annotations;
+  annotations.set_originator(::santa::pb::v1::process_tree::Annotations::LOGIN);
+  auto exported =
+      std::make_shared<const santa::santad::process_tree::ExportedAnnotations>(annotations);
+
+  // Binary output splices in the encoded annotations, JSON output copies them. Both must decode
+  // to the same annotations.
+  for (bool json : {false, true}) {
+    std::vector<uint8_t> vec = Protobuf::Create(mockESApi, nil, json)
+                                   ->SerializeFileAccess(
+                                       "v1", "policy", msg,
+                                       santa::EnrichedProcess(
+                                           std::optional<std::shared_ptr<std::string>>(),
+                                           std::optional<std::shared_ptr<std::string>>(),
+                                           std::optional<std::shared_ptr<std::string>>(),
+                                           std::optional<std::shared_ptr<std::string>>(),
+                                           Enricher().Enrich(*msg->process->executable), exported),
+                                       0, Enricher().Enrich(openFile),
+                                       FileAccessPolicyDecision::kDenied, "op123", 0);
+
+    ::pbv1::SantaMessage santaMsg;
+    std::string str(vec.begin(), vec.end());
+    if (json) {
+      XCTAssertTrue(JsonStringToMessage(str, &santaMsg).ok());
+    } else {
+      XCTAssertTrue(santaMsg.ParseFromString(str));
+    }
+    XCTAssertTrue(santaMsg.file_access().instigator().has_annotations());
+    XCTAssertEqual(santaMsg.file_access().instigator().annotations().originator(),
+                   ::santa::pb::v1::process_tree::Annotations::LOGIN);
+    XCTAssertEqual(santaMsg.file_access().instigator().unknown_fields().field_count(), 0);
+  }
+}
+
 - (void)testSerializeFileAccessRuleId {
   auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
   mockESApi->SetExpectationsRetainReleaseMessage();
@@ -0,0 +1,98 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_SERIALIZERS_REUSABLEARENA_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_SERIALIZERS_REUSABLEARENA_H
+
+#include <google/protobuf/arena.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace santa {
+
+// Arenas are reused separately for each kind of work so that, e.g., the size
+// of CEL evaluations doesn't skew the initial blocks kept for log messages.
+// Below, a "message" is one use of an arena from the pool.
+enum class ReusableArenaPool {
+  kLogging = 0,
+  kCELEvaluation,
+};
+
+struct ReusableArenaStats {
+  // Largest number of bytes used by a single message since the last call to
+  // ReusableArena::CollectStats.
+  uint64_t high_water_bytes;
+  // Cumulative number of messages built in reused arenas.
+  uint64_t messages;
+  // Cumulative number of bytes used by messages built in reused arenas.
+  uint64_t total_bytes;
+  // Cumulative number of times a thread's initial block was reallocated to
+  // track a change in message sizes.
+  uint64_t resizes;
+  // Cumulative number of messages that needed a heap allocated arena because
+  // the thread's arena was already in use.
+  uint64_t fallbacks;
+  // Bytes currently held in the initial blocks of every thread's arena.
+  uint64_t block_bytes;
+};
+
+// Scoped access to a protobuf arena that is reused by every message built on
+// the current thread from the same pool.
+//
+// Each thread keeps one arena backed by a caller owned initial block, sized
+// from a moving average of recent messages so that a typical message needs no
+// further allocation. The arena is reset when the ReusableArena goes out of
+// scope, so any message allocated from it must not outlive this object.
+//
+// Nested instances on the same thread fall back to a temporary arena.
+class ReusableArena {
+ public:
+  // Bounds on the size of each thread's initial block.
+  static constexpr size_t kMinBlockSize = 4 * 1024;
+  static constexpr size_t kMaxBlockSize = 256 * 1024;
+
+  explicit ReusableArena(ReusableArenaPool pool = ReusableArenaPool::kLogging);
+  ~ReusableArena();
+
+  ReusableArena(const ReusableArena&) = delete;
+  ReusableArena& operator=(const ReusableArena&) = delete;
+
+  google::protobuf::Arena* get() const { return arena_; }
+
+  // Returns the size of the current thread's initial block for the pool, or 0
+  // if no message has been built from it on this thread yet.
+  static size_t CurrentThreadBlockSize(
+      ReusableArenaPool pool = ReusableArenaPool::kLogging);
+
+  // Returns the pool's stats across all threads and resets its high water
+  // mark.
+  static ReusableArenaStats CollectStats(
+      ReusableArenaPool pool = ReusableArenaPool::kLogging);
+
+  // Returns the bytes held in the initial blocks of every thread's arena for
+  // the pool. Unlike CollectStats this leaves the high water mark alone.
+  static uint64_t BlockBytes(
+      ReusableArenaPool pool = ReusableArenaPool::kLogging);
+
+ private:
+  ReusableArenaPool pool_;
+  google::protobuf::Arena* arena_;
+  std::unique_ptr<google::protobuf::Arena> fallback_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_SERIALIZERS_REUSABLEARENA_H
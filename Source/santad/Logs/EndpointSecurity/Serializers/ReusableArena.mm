@@ -0,0 +1,177 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Serializers/ReusableArena.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <optional>
+
+using google::protobuf::Arena;
+using google::protobuf::ArenaOptions;
+
+namespace santa {
+
+namespace {
+
+// Weight given to each new message in the moving average of message sizes,
+// expressed as a shift (1/8).
+constexpr int kAverageShift = 3;
+
+// Block sizes are rounded to this granularity so that small fluctuations in
+// message size don't cause a reallocation.
+constexpr size_t kBlockGranularity = 4 * 1024;
+
+constexpr size_t kNumPools = static_cast<size_t>(ReusableArenaPool::kCELEvaluation) + 1;
+
+struct PoolStats {
+  std::atomic<uint64_t> high_water_bytes{0};
+  std::atomic<uint64_t> messages{0};
+  std::atomic<uint64_t> total_bytes{0};
+  std::atomic<uint64_t> resizes{0};
+  std::atomic<uint64_t> fallbacks{0};
+  std::atomic<uint64_t> block_bytes{0};
+};
+
+std::array<PoolStats, kNumPools> g_stats;
+
+PoolStats& StatsForPool(ReusableArenaPool pool) {
+  return g_stats[static_cast<size_t>(pool)];
+}
+
+// Returns the initial block size to use for messages averaging avg_bytes,
+// leaving 25% headroom for larger than average messages.
+size_t TargetBlockSize(uint64_t avg_bytes) {
+  uint64_t want = avg_bytes + avg_bytes / 4;
+  want = (want + kBlockGranularity - 1) / kBlockGranularity * kBlockGranularity;
+  return std::clamp<size_t>(want, ReusableArena::kMinBlockSize, ReusableArena::kMaxBlockSize);
+}
+
+struct ThreadState {
+  // The block must outlive the arena using it, so it is declared first.
+  std::unique_ptr<char[]> block;
+  size_t block_size = 0;
+  std::optional<Arena> arena;
+  uint64_t avg_bytes = 0;
+  bool in_use = false;
+  // Set once the first block is allocated.
+  PoolStats* block_stats = nullptr;
+
+  ~ThreadState() {
+    if (block_stats) {
+      block_stats->block_bytes.fetch_sub(block_size, std::memory_order_relaxed);
+    }
+  }
+
+  void Allocate(size_t size) {
+    arena.reset();
+    block.reset(new char[size]);
+    block_stats->block_bytes.fetch_add(size, std::memory_order_relaxed);
+    block_stats->block_bytes.fetch_sub(block_size, std::memory_order_relaxed);
+    block_size = size;
+
+    ArenaOptions options;
+    options.initial_block = block.get();
+    options.initial_block_size = size;
+    arena.emplace(options);
+  }
+
+  Arena* Acquire(PoolStats& pool_stats) {
+    if (!arena.has_value()) {
+      block_stats = &pool_stats;
+      Allocate(ReusableArena::kMinBlockSize);
+    }
+    in_use = true;
+    return &*arena;
+  }
+
+  void Release(PoolStats& stats) {
+    uint64_t used = arena->SpaceUsed();
+    // Reset keeps the caller owned initial block and frees anything the
+    // arena had to allocate beyond it.
+    arena->Reset();
+    in_use = false;
+
+    uint64_t prev = stats.high_water_bytes.load(std::memory_order_relaxed);
+    while (used > prev && !stats.high_water_bytes.compare_exchange_weak(
+                              prev, used, std::memory_order_relaxed)) {
+    }
+    stats.messages.fetch_add(1, std::memory_order_relaxed);
+    stats.total_bytes.fetch_add(used, std::memory_order_relaxed);
+
+    if (avg_bytes == 0) {
+      avg_bytes = used;
+    } else if (used > avg_bytes) {
+      avg_bytes += (used - avg_bytes) >> kAverageShift;
+    } else {
+      avg_bytes -= (avg_bytes - used) >> kAverageShift;
+    }
+
+    // Grow as soon as typical messages no longer fit, but only shrink once
+    // the block is well oversized to avoid reallocating back and forth.
+    size_t target = TargetBlockSize(avg_bytes);
+    if (target > block_size || target * 4 <= block_size) {
+      Allocate(target);
+      stats.resizes.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+};
+
+ThreadState& CurrentThreadState(ReusableArenaPool pool) {
+  static thread_local std::array<ThreadState, kNumPools> states;
+  return states[static_cast<size_t>(pool)];
+}
+
+}  // namespace
+
+ReusableArena::ReusableArena(ReusableArenaPool pool) : pool_(pool) {
+  ThreadState& state = CurrentThreadState(pool_);
+  if (state.in_use) {
+    fallback_ = std::make_unique<Arena>();
+    arena_ = fallback_.get();
+  } else {
+    arena_ = state.Acquire(StatsForPool(pool_));
+  }
+}
+
+ReusableArena::~ReusableArena() {
+  if (fallback_) {
+    StatsForPool(pool_).fallbacks.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    CurrentThreadState(pool_).Release(StatsForPool(pool_));
+  }
+}
+
+size_t ReusableArena::CurrentThreadBlockSize(ReusableArenaPool pool) {
+  return CurrentThreadState(pool).block_size;
+}
+
+ReusableArenaStats ReusableArena::CollectStats(ReusableArenaPool pool) {
+  PoolStats& stats = StatsForPool(pool);
+  return ReusableArenaStats{
+      .high_water_bytes = stats.high_water_bytes.exchange(0, std::memory_order_relaxed),
+      .messages = stats.messages.load(std::memory_order_relaxed),
+      .total_bytes = stats.total_bytes.load(std::memory_order_relaxed),
+      .resizes = stats.resizes.load(std::memory_order_relaxed),
+      .fallbacks = stats.fallbacks.load(std::memory_order_relaxed),
+      .block_bytes = stats.block_bytes.load(std::memory_order_relaxed),
+  };
+}
+
+uint64_t ReusableArena::BlockBytes(ReusableArenaPool pool) {
+  return StatsForPool(pool).block_bytes.load(std::memory_order_relaxed);
+}
+
+}  // namespace santa
@@ -0,0 +1,174 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Serializers/ReusableArena.h"
+
+#import <XCTest/XCTest.h>
+#include <google/protobuf/arena.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+using santa::ReusableArena;
+using santa::ReusableArenaStats;
+
+static void AllocateFromArena(size_t bytes) {
+  ReusableArena arena;
+  (void)google::protobuf::Arena::CreateArray<char>(arena.get(), bytes);
+}
+
+@interface ReusableArenaTest : XCTestCase
+@end
+
+@implementation ReusableArenaTest
+
+- (void)setUp {
+  // Clear the high water mark left by other tests.
+  ReusableArena::CollectStats();
+}
+
+- (void)testArenaIsReusedOnSameThread {
+  google::protobuf::Arena* first;
+  {
+    ReusableArena arena;
+    first = arena.get();
+    (void)google::protobuf::Arena::CreateArray<char>(first, 128);
+    XCTAssertGreaterThanOrEqual(first->SpaceUsed(), 128);
+  }
+
+  ReusableArena arena;
+  XCTAssertEqual(arena.get(), first);
+  // The previous message's allocations were released.
+  XCTAssertLessThan(arena.get()->SpaceUsed(), 128);
+}
+
+- (void)testNestedArenaFallsBack {
+  uint64_t fallbacks = ReusableArena::CollectStats().fallbacks;
+  ReusableArena outer;
+  {
+    ReusableArena inner;
+    XCTAssertNotEqual(inner.get(), outer.get());
+    (void)google::protobuf::Arena::CreateArray<char>(inner.get(), 64);
+  }
+  XCTAssertEqual(ReusableArena::CollectStats().fallbacks, fallbacks + 1);
+}
+
+- (void)testThreadsUseDistinctArenas {
+  uint64_t fallbacks = ReusableArena::CollectStats().fallbacks;
+  ReusableArena arena;
+  google::protobuf::Arena* other = nullptr;
+  std::thread t([&other] {
+    ReusableArena thread_arena;
+    other = thread_arena.get();
+  });
+  t.join();
+  XCTAssertNotEqual(other, nullptr);
+  XCTAssertNotEqual(other, arena.get());
+  XCTAssertEqual(ReusableArena::CollectStats().fallbacks, fallbacks);
+}
+
+- (void)testBlockTracksMessageSizes {
+  uint64_t resizes = ReusableArena::CollectStats().resizes;
+  std::thread t([self] {
+    AllocateFromArena(64);
+    XCTAssertEqual(ReusableArena::CurrentThreadBlockSize(), ReusableArena::kMinBlockSize);
+
+    // Consistently larger messages grow the initial block to fit them.
+    for (int i = 0; i < 64; ++i) {
+      AllocateFromArena(40 * 1024);
+    }
+    size_t grown = ReusableArena::CurrentThreadBlockSize();
+    XCTAssertGreaterThanOrEqual(grown, 40 * 1024);
+    XCTAssertLessThanOrEqual(grown, ReusableArena::kMaxBlockSize);
+
+    // Occasional outliers don't shrink it again.
+    AllocateFromArena(64);
+    XCTAssertEqual(ReusableArena::CurrentThreadBlockSize(), grown);
+
+    // A sustained drop eventually does.
+    for (int i = 0; i < 64; ++i) {
+      AllocateFromArena(64);
+    }
+    XCTAssertLessThan(ReusableArena::CurrentThreadBlockSize(), grown);
+
+    // Huge messages are clamped to the maximum block size.
+    for (int i = 0; i < 64; ++i) {
+      AllocateFromArena(4 * ReusableArena::kMaxBlockSize);
+    }
+    XCTAssertEqual(ReusableArena::CurrentThreadBlockSize(), ReusableArena::kMaxBlockSize);
+  });
+  t.join();
+
+  XCTAssertGreaterThanOrEqual(ReusableArena::CollectStats().resizes, resizes + 3);
+}
+
+- (void)testPoolsAreIndependent {
+  using santa::ReusableArenaPool;
+  ReusableArena::CollectStats(ReusableArenaPool::kCELEvaluation);
+  ReusableArenaStats logging = ReusableArena::CollectStats(ReusableArenaPool::kLogging);
+  ReusableArenaStats cel = ReusableArena::CollectStats(ReusableArenaPool::kCELEvaluation);
+
+  std::thread t([] {
+    ReusableArena log_arena(ReusableArenaPool::kLogging);
+    // Not nested, as the pools don't share an arena.
+    ReusableArena cel_arena(ReusableArenaPool::kCELEvaluation);
+    XCTAssertNotEqual(log_arena.get(), cel_arena.get());
+    (void)google::protobuf::Arena::CreateArray<char>(cel_arena.get(), 40 * 1024);
+  });
+  t.join();
+
+  ReusableArenaStats logging_after = ReusableArena::CollectStats(ReusableArenaPool::kLogging);
+  ReusableArenaStats cel_after = ReusableArena::CollectStats(ReusableArenaPool::kCELEvaluation);
+  XCTAssertEqual(logging_after.fallbacks, logging.fallbacks);
+  XCTAssertEqual(cel_after.fallbacks, cel.fallbacks);
+  XCTAssertEqual(cel_after.messages, cel.messages + 1);
+  XCTAssertGreaterThanOrEqual(cel_after.total_bytes - cel.total_bytes, 40 * 1024);
+  XCTAssertGreaterThanOrEqual(cel_after.high_water_bytes, 40 * 1024);
+  XCTAssertLessThan(logging_after.total_bytes - logging.total_bytes, 40 * 1024);
+}
+
+- (void)testBlockBytesAreReleasedWhenThreadsExit {
+  using santa::ReusableArenaPool;
+  uint64_t before = ReusableArena::CollectStats(ReusableArenaPool::kCELEvaluation).block_bytes;
+
+  std::thread t([before] {
+    { ReusableArena arena(ReusableArenaPool::kCELEvaluation); }
+    size_t block_size = ReusableArena::CurrentThreadBlockSize(ReusableArenaPool::kCELEvaluation);
+    XCTAssertGreaterThan(block_size, 0);
+    XCTAssertEqual(ReusableArena::CollectStats(ReusableArenaPool::kCELEvaluation).block_bytes,
+                   before + block_size);
+  });
+  t.join();
+
+  XCTAssertEqual(ReusableArena::BlockBytes(ReusableArenaPool::kCELEvaluation), before);
+}
+
+- (void)testHighWaterMarkResetsOnCollect {
+  AllocateFromArena(1000);
+  AllocateFromArena(10000);
+  AllocateFromArena(100);
+
+  ReusableArenaStats stats = ReusableArena::CollectStats();
+  XCTAssertGreaterThanOrEqual(stats.high_water_bytes, 10000);
+  XCTAssertLessThan(stats.high_water_bytes, 20000);
+  XCTAssertGreaterThanOrEqual(stats.messages, 3);
+
+  AllocateFromArena(100);
+  stats = ReusableArena::CollectStats();
+  XCTAssertGreaterThanOrEqual(stats.high_water_bytes, 100);
+  XCTAssertLessThan(stats.high_water_bytes, 1000);
+}
+
+@end
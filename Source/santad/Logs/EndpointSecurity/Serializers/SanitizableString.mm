@@ -14,12 +14,76 @@
 
 #include "Source/santad/Logs/EndpointSecurity/Serializers/SanitizableString.h"
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <bit>
+#include <cstdint>
+
 #include "Source/common/String.h"
 
 using santa::NSStringToUTF8StringView;
 
 namespace santa {
 
+namespace {
+
+inline bool IsSanitizableChar(char c) {
+  return c == '|' || c == '\n' || c == '\r';
+}
+
+// Returns the offset of the first character that needs to be replaced, or
+// `length` if there are none. Strings are scanned 16 bytes at a time, with
+// the remainder checked one byte at a time.
+size_t FindSanitizableChar(const char* str, size_t length) {
+  size_t i = 0;
+
+#if defined(__ARM_NEON)
+  const uint8x16_t pipe = vdupq_n_u8('|');
+  const uint8x16_t newline = vdupq_n_u8('\n');
+  const uint8x16_t carriage_return = vdupq_n_u8('\r');
+  for (; i + 16 <= length; i += 16) {
+    uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(str + i));
+    uint8x16_t matches = vorrq_u8(vorrq_u8(vceqq_u8(chunk, pipe), vceqq_u8(chunk, newline)),
+                                  vceqq_u8(chunk, carriage_return));
+    // Narrow each byte of the comparison to a nibble so the result fits in
+    // a 64-bit mask with 4 bits per input byte.
+    uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+    if (mask) {
+      return i + (std::countr_zero(mask) >> 2);
+    }
+  }
+#elif defined(__SSE2__)
+  const __m128i pipe = _mm_set1_epi8('|');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  for (; i + 16 <= length; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+    __m128i matches =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, pipe), _mm_cmpeq_epi8(chunk, newline)),
+                     _mm_cmpeq_epi8(chunk, carriage_return));
+    unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(matches));
+    if (mask) {
+      return i + std::countr_zero(mask);
+    }
+  }
+#endif
+
+  for (; i < length; i++) {
+    if (IsSanitizableChar(str[i])) {
+      return i;
+    }
+  }
+
+  return length;
+}
+
+}  // namespace
+
 SanitizableString::SanitizableString(const es_file_t* file)
     : data_(file->path.data, file->path.length) {}
 
@@ -56,56 +120,40 @@ std::optional<std::string> SanitizableString::SanitizeString(const char* str) {
 }
 
 std::optional<std::string> SanitizableString::SanitizeString(const char* str, size_t length) {
-  size_t strOffset = 0;
-  char c = 0;
-  std::string buf;
-  bool reservedStringSpace = false;
-
-  if (!str) {
+  if (!str || length < 1) {
     return std::nullopt;
   }
 
-  if (length < 1) {
+  // Most strings don't need sanitizing, so only allocate once a character
+  // that needs replacing has been found.
+  size_t found = FindSanitizableChar(str, length);
+  if (found == length) {
     return std::nullopt;
   }
 
-  // Loop through the string one character at a time, looking for the characters
-  // we want to remove.
-  for (const char* p = str; (c = *p) != 0; ++p) {
-    if (c == '|' || c == '\n' || c == '\r') {
-      if (!reservedStringSpace) {
-        // Assume the common case won't grow the string length by more than a
-        // factor of 2. String will grow more if it needs to.
-        buf.reserve(length * 2);
-        reservedStringSpace = true;
-      }
-
-      // Copy from the last offset up to the character we just found into the buffer
-      ptrdiff_t diff = p - str;
-      buf.append(str + strOffset, diff - strOffset);
-
-      // Update the buffer and string offsets
-      strOffset = diff + 1;
-
-      // Replace the found character and advance the buffer offset
-      switch (c) {
-        case '|': buf.append("<pipe>"); break;
-        case '\n': buf.append("\\n"); break;
-        case '\r': buf.append("\\r"); break;
-      }
+  // Assume the common case won't grow the string length by more than a
+  // factor of 2. String will grow more if it needs to.
+  std::string buf;
+  buf.reserve(length * 2);
+
+  size_t offset = 0;
+  while (found < length) {
+    // Copy everything since the last match, then the replacement
+    buf.append(str + offset, found - offset);
+    switch (str[found]) {
+      case '|': buf.append("<pipe>"); break;
+      case '\n': buf.append("\\n"); break;
+      case '\r': buf.append("\\r"); break;
     }
-  }
 
-  if (strOffset > 0 && strOffset < length) {
-    // Copy any characters from the last match to the end of the string into the buffer.
-    buf.append(str + strOffset, length - strOffset);
+    offset = found + 1;
+    found = offset + FindSanitizableChar(str + offset, length - offset);
   }
 
-  if (reservedStringSpace) {
-    return buf;
-  }
+  // Copy any characters from the last match to the end of the string
+  buf.append(str + offset, length - offset);
 
-  return std::nullopt;
+  return buf;
 }
 
 }  // namespace santa
@@ -17,13 +17,47 @@
 #include <EndpointSecurity/ESTypes.h>
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
+#include <optional>
 #include <sstream>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include "Source/common/TestUtils.h"
 
 using santa::SanitizableString;
 
+// The byte at a time loop SanitizeString used before scanning in chunks. Used
+// to check results and as a baseline for the benchmarks.
+static std::optional<std::string> ScalarSanitizeString(const char* str, size_t length) {
+  std::string buf;
+  bool sanitized = false;
+  for (size_t i = 0; i < length; i++) {
+    switch (str[i]) {
+      case '|': buf.append("<pipe>"); sanitized = true; break;
+      case '\n': buf.append("\\n"); sanitized = true; break;
+      case '\r': buf.append("\\r"); sanitized = true; break;
+      default: buf.push_back(str[i]); break;
+    }
+  }
+  return sanitized ? std::make_optional(buf) : std::nullopt;
+}
+
+// Paths of the kind seen in exec events, a few of which need sanitizing.
+static std::vector<std::string> BenchmarkPaths() {
+  std::vector<std::string> paths;
+  for (int i = 0; i < 1000; i++) {
+    std::string path = "/Applications/Some Long Application Name.app/Contents/Frameworks/"
+                       "Helper Framework.framework/Versions/A/Resources/helper_" +
+                       std::to_string(i);
+    if (i % 50 == 0) {
+      path += "|with\nescapes";
+    }
+    paths.push_back(std::move(path));
+  }
+  return paths;
+}
+
 @interface SanitizableStringTest : XCTestCase
 @end
 
@@ -75,6 +109,67 @@ using santa::SanitizableString;
   XCTAssertCStringEqual(SanitizableString(base).Sanitized().data(), [want UTF8String]);
 }
 
+- (void)testSanitizeStringMatchesScalar {
+  // Place characters needing replacement at every offset around the 16 byte
+  // chunk boundaries, alone and in runs.
+  for (size_t length = 1; length <= 70; length++) {
+    for (size_t pos = 0; pos < length; pos++) {
+      for (char c : {'|', '\n', '\r'}) {
+        std::string str(length, 'a');
+        str[pos] = c;
+        if (pos + 1 < length) str[length - 1] = '|';
+
+        XCTAssertEqual(SanitizableString::SanitizeString(str.data(), str.length()),
+                       ScalarSanitizeString(str.data(), str.length()), @"length: %zu, pos: %zu",
+                       length, pos);
+      }
+    }
+
+    std::string clean(length, 'b');
+    XCTAssertEqual(std::nullopt, SanitizableString::SanitizeString(clean.data(), clean.length()));
+  }
+
+  // Characters with the high bit set aren't mistaken for ones to replace
+  std::string utf8 = "/Users/\xc3\xa9l\xc3\xa8ve/\x80\xfc|\xfd\xff/file";
+  XCTAssertEqual(SanitizableString::SanitizeString(utf8.data(), utf8.length()),
+                 ScalarSanitizeString(utf8.data(), utf8.length()));
+}
+
+- (void)testSanitizeStringUsesLength {
+  // Only the given length is scanned...
+  const char* str = "abc|def";
+  XCTAssertEqual(std::nullopt, SanitizableString::SanitizeString(str, 3));
+
+  // ...and all of it is, including anything after an embedded NUL
+  std::string embedded("ab\0c|d", 6);
+  std::optional<std::string> got = SanitizableString::SanitizeString(embedded.data(),
+                                                                     embedded.length());
+  XCTAssertTrue(got.has_value());
+  XCTAssertEqual(got.value(), std::string("ab\0c<pipe>d", 11));
+}
+
+- (void)testBenchmarkSanitizeString {
+  std::vector<std::string> paths = BenchmarkPaths();
+  [self measureBlock:^{
+    for (int i = 0; i < 100; i++) {
+      for (const std::string& path : paths) {
+        (void)SanitizableString::SanitizeString(path.data(), path.length());
+      }
+    }
+  }];
+}
+
+- (void)testBenchmarkScalarSanitizeString {
+  std::vector<std::string> paths = BenchmarkPaths();
+  [self measureBlock:^{
+    for (int i = 0; i < 100; i++) {
+      for (const std::string& path : paths) {
+        (void)ScalarSanitizeString(path.data(), path.length());
+      }
+    }
+  }];
+}
+
 - (void)testStream {
   // Test that using the `<<` operator will sanitize the string
   std::ostringstream ss;
@@ -24,11 +24,14 @@
 #include <string_view>
 #include <vector>
 
+#include "Source/common/ExecTrace.h"
 #include "Source/common/Platform.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTXxhash.h"
 #include "Source/common/es/EnrichedTypes.h"
+#include "Source/santad/Logs/EndpointSecurity/NetworkFlowAggregator.h"
+#include "Source/santad/Logs/EndpointSecurity/TelemetryAggregator.h"
 #import "Source/santad/SNTDecisionCache.h"
 
 @class SNDProcessFlows;
@@ -112,9 +115,27 @@ class Serializer {
                                              struct timespec window_start,
                                              struct timespec window_end);
 
+  // Merge the flows of a process into the aggregator instead of serializing
+  // them. Returns false if they were not merged and should be serialized with
+  // SerializeNetworkFlows, e.g. because the format does not support it.
+  virtual bool AggregateNetworkFlows(santa::NetworkFlowAggregator& aggregator,
+                                     SNDProcessFlows* processFlows, struct timespec window_start,
+                                     struct timespec window_end, SNTCachedDecision* cd) = 0;
+  bool AggregateNetworkFlows(santa::NetworkFlowAggregator& aggregator,
+                             SNDProcessFlows* processFlows, struct timespec window_start,
+                             struct timespec window_end);
+  virtual std::vector<uint8_t> SerializeNetworkActivity(
+      const santa::NetworkFlowAggregator::Window& window) = 0;
+
   virtual std::vector<uint8_t> SerializeDiskAppeared(NSDictionary*, bool) = 0;
   virtual std::vector<uint8_t> SerializeDiskDisappeared(NSDictionary*) = 0;
 
+  virtual std::vector<uint8_t> SerializeEventSummary(const santa::EventSummary& summary,
+                                                     struct timespec window_start,
+                                                     struct timespec window_end) = 0;
+
+  virtual std::vector<uint8_t> SerializeExecTrace(const santa::ExecTrace::Summary& trace) = 0;
+
  private:
   // Template pattern methods used to ensure a place to implement any desired
   // functionality that shouldn't be overridden by derived classes.
@@ -69,13 +69,15 @@ std::shared_ptr<std::string> Serializer::MachineID() const {
 }
 
 std::vector<uint8_t> Serializer::SerializeMessageTemplate(const santa::EnrichedExec& msg) {
-  SNTCachedDecision* cd;
+  // The exec is logged once, so the decision recorded when it was authorized
+  // can be forgotten now.
+  const es_process_t* target = msg->event.exec.target;
+  SNTCachedDecision* cd = [decision_cache_ takeDecisionForExecOfProcess:target->audit_token
+                                                                   file:target->executable->stat];
   if (msg->action_type == ES_ACTION_TYPE_NOTIFY &&
       msg->action.notify.result.auth == ES_AUTH_RESULT_ALLOW) {
     // For allowed execs, cached decision timestamps must be updated
-    cd = [decision_cache_ resetTimestampForCachedDecision:msg->event.exec.target->executable->stat];
-  } else {
-    cd = [decision_cache_ cachedDecisionForFile:msg->event.exec.target->executable->stat];
+    [decision_cache_ resetTimestampForDecision:cd];
   }
 
   return SerializeMessage(msg, cd);
@@ -121,4 +123,12 @@ std::vector<uint8_t> Serializer::SerializeNetworkFlows(SNDProcessFlows* processF
       [decision_cache_ cachedDecisionForVnode:[processFlows.processInfo vnode]]);
 }
 
+bool Serializer::AggregateNetworkFlows(NetworkFlowAggregator& aggregator,
+                                       SNDProcessFlows* processFlows,
+                                       struct timespec window_start, struct timespec window_end) {
+  return AggregateNetworkFlows(
+      aggregator, processFlows, window_start, window_end,
+      [decision_cache_ cachedDecisionForVnode:[processFlows.processInfo vnode]]);
+}
+
 };  // namespace santa
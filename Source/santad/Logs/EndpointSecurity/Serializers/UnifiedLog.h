@@ -0,0 +1,61 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_SERIALIZERS_UNIFIEDLOG_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_SERIALIZERS_UNIFIEDLOG_H
+
+#import <Foundation/Foundation.h>
+
+#include <memory>
+#include <vector>
+
+#import "Source/common/SNTCachedDecision.h"
+#include "Source/common/es/EndpointSecurityAPI.h"
+#include "Source/common/es/EnrichedTypes.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/BasicString.h"
+#import "Source/santad/SNTDecisionCache.h"
+
+namespace santa {
+
+// Logs the highest volume events straight to the unified logging system as
+// structured os_log entries, with each field passed as a separate argument.
+// The unified logging system stores the arguments in binary form and only
+// formats the entry when it is read. Nothing is returned for these events.
+//
+// Other events, and all events when machine ID decoration is enabled, are
+// formatted the same way as BasicString and are expected to be written by
+// the Syslog writer.
+class UnifiedLog : public BasicString {
+ public:
+  static std::shared_ptr<UnifiedLog> Create(std::shared_ptr<santa::EndpointSecurityAPI> esapi,
+                                            SNTDecisionCache* decision_cache);
+
+  UnifiedLog(std::shared_ptr<santa::EndpointSecurityAPI> esapi, SNTDecisionCache* decision_cache);
+
+  using BasicString::SerializeMessage;
+
+  std::vector<uint8_t> SerializeMessage(const santa::EnrichedClose&) override;
+  std::vector<uint8_t> SerializeMessage(const santa::EnrichedExec&, SNTCachedDecision*) override;
+  std::vector<uint8_t> SerializeMessage(const santa::EnrichedExit&) override;
+  std::vector<uint8_t> SerializeMessage(const santa::EnrichedFork&) override;
+  std::vector<uint8_t> SerializeMessage(const santa::EnrichedRename&) override;
+  std::vector<uint8_t> SerializeMessage(const santa::EnrichedUnlink&) override;
+
+ private:
+  std::shared_ptr<santa::EndpointSecurityAPI> esapi_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_SERIALIZERS_UNIFIEDLOG_H
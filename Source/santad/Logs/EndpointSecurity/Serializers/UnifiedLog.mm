@@ -0,0 +1,192 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Serializers/UnifiedLog.h"
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#include <os/log.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "Source/common/AuditUtilities.h"
+#import "Source/common/SNTCommonEnums.h"
+
+namespace santa {
+
+static os_log_t EventLog() {
+  static os_log_t log = os_log_create("com.northpolesec.santa.daemon", "events");
+  return log;
+}
+
+static inline const char* NameOrNull(const std::optional<std::shared_ptr<std::string>>& name) {
+  return name.has_value() ? name->get()->c_str() : "(null)";
+}
+
+static inline const char* UTF8OrEmpty(NSString* str) {
+  return str.UTF8String ?: "";
+}
+
+std::shared_ptr<UnifiedLog> UnifiedLog::Create(std::shared_ptr<EndpointSecurityAPI> esapi,
+                                               SNTDecisionCache* decision_cache) {
+  return std::make_shared<UnifiedLog>(esapi, decision_cache);
+}
+
+UnifiedLog::UnifiedLog(std::shared_ptr<EndpointSecurityAPI> esapi,
+                       SNTDecisionCache* decision_cache)
+    : BasicString(esapi, decision_cache, false), esapi_(esapi) {}
+
+std::vector<uint8_t> UnifiedLog::SerializeMessage(const EnrichedClose& msg) {
+  if (EnableMachineIDDecoration()) {
+    return BasicString::SerializeMessage(msg);
+  }
+
+  const es_process_t* proc = msg->process;
+  const es_string_token_t& path = msg->event.close.target->path;
+  const es_string_token_t& proc_path = proc->executable->path;
+  os_log(EventLog(),
+         "action=WRITE|path=%{public}.*s|pid=%d|ppid=%d|processpath=%{public}.*s"
+         "|uid=%d|user=%{public}s|gid=%d|group=%{public}s",
+         (int)path.length, path.data, Pid(proc->audit_token), proc->original_ppid,
+         (int)proc_path.length, proc_path.data, (int)RealUser(proc->audit_token),
+         NameOrNull(msg.instigator().real_user()), (int)RealGroup(proc->audit_token),
+         NameOrNull(msg.instigator().real_group()));
+
+  return {};
+}
+
+std::vector<uint8_t> UnifiedLog::SerializeMessage(const EnrichedExec& msg,
+                                                  SNTCachedDecision* cd) {
+  if (EnableMachineIDDecoration()) {
+    return BasicString::SerializeMessage(msg, cd);
+  }
+
+  // Arguments are the only field that has to be assembled before logging.
+  // The buffer keeps its capacity from one exec to the next.
+  static thread_local std::string args;
+  args.clear();
+  uint32_t arg_count = esapi_->ExecArgCount(&msg->event.exec);
+  for (uint32_t i = 0; i < arg_count; i++) {
+    if (i != 0) {
+      args.push_back(' ');
+    }
+    es_string_token_t arg = esapi_->ExecArg(&msg->event.exec, i);
+    args.append(arg.data, arg.length);
+  }
+
+  const es_process_t* target = msg->event.exec.target;
+  const es_string_token_t& path = target->executable->path;
+  std::string_view decision = GetDecisionString(cd.decision);
+  std::string_view reason = GetReasonString(cd.decision);
+  std::string_view mode = GetModeString(cd.decisionClientMode);
+  os_log(EventLog(),
+         "action=EXEC|decision=%{public}.*s|reason=%{public}.*s|explain=%{public}s"
+         "|sha256=%{public}s|cert_sha256=%{public}s|teamid=%{public}s"
+         "|pid=%d|pidversion=%d|ppid=%d|uid=%d|user=%{public}s|gid=%d|group=%{public}s"
+         "|mode=%{public}.*s|path=%{public}.*s|args=%{public}.*s",
+         (int)decision.length(), decision.data(), (int)reason.length(), reason.data(),
+         UTF8OrEmpty(cd.decisionExtra), UTF8OrEmpty(cd.sha256), UTF8OrEmpty(cd.certSHA256),
+         UTF8OrEmpty(cd.teamID), Pid(target->audit_token), Pidversion(target->audit_token),
+         target->original_ppid, (int)RealUser(target->audit_token),
+         NameOrNull(msg.instigator().real_user()), (int)RealGroup(target->audit_token),
+         NameOrNull(msg.instigator().real_group()), (int)mode.length(), mode.data(),
+         (int)path.length, path.data, (int)args.length(), args.data());
+
+  return {};
+}
+
+std::vector<uint8_t> UnifiedLog::SerializeMessage(const EnrichedExit& msg) {
+  if (EnableMachineIDDecoration()) {
+    return BasicString::SerializeMessage(msg);
+  }
+
+  const es_process_t* proc = msg->process;
+  os_log(EventLog(), "action=EXIT|pid=%d|pidversion=%d|ppid=%d|uid=%d|gid=%d",
+         Pid(proc->audit_token), Pidversion(proc->audit_token), proc->original_ppid,
+         (int)RealUser(proc->audit_token), (int)RealGroup(proc->audit_token));
+
+  return {};
+}
+
+std::vector<uint8_t> UnifiedLog::SerializeMessage(const EnrichedFork& msg) {
+  if (EnableMachineIDDecoration()) {
+    return BasicString::SerializeMessage(msg);
+  }
+
+  const es_process_t* child = msg->event.fork.child;
+  os_log(EventLog(), "action=FORK|pid=%d|pidversion=%d|ppid=%d|uid=%d|gid=%d",
+         Pid(child->audit_token), Pidversion(child->audit_token), child->original_ppid,
+         (int)RealUser(child->audit_token), (int)RealGroup(child->audit_token));
+
+  return {};
+}
+
+std::vector<uint8_t> UnifiedLog::SerializeMessage(const EnrichedRename& msg) {
+  if (EnableMachineIDDecoration()) {
+    return BasicString::SerializeMessage(msg);
+  }
+
+  // The destination is logged as a directory and a file name so that a new
+  // path doesn't need to be joined before logging.
+  es_string_token_t new_dir = {.length = 0, .data = ""};
+  es_string_token_t new_name = {.length = 0, .data = ""};
+  switch (msg->event.rename.destination_type) {
+    case ES_DESTINATION_TYPE_EXISTING_FILE:
+      new_name = msg->event.rename.destination.existing_file->path;
+      break;
+    case ES_DESTINATION_TYPE_NEW_PATH:
+      new_dir = msg->event.rename.destination.new_path.dir->path;
+      new_name = msg->event.rename.destination.new_path.filename;
+      break;
+    default: new_name = {.length = 6, .data = "(null)"}; break;
+  }
+
+  const es_process_t* proc = msg->process;
+  const es_string_token_t& path = msg->event.rename.source->path;
+  const es_string_token_t& proc_path = proc->executable->path;
+  os_log(EventLog(),
+         "action=RENAME|path=%{public}.*s|newpath=%{public}.*s%{public}s%{public}.*s"
+         "|pid=%d|ppid=%d|processpath=%{public}.*s"
+         "|uid=%d|user=%{public}s|gid=%d|group=%{public}s",
+         (int)path.length, path.data, (int)new_dir.length, new_dir.data,
+         new_dir.length > 0 ? "/" : "", (int)new_name.length, new_name.data,
+         Pid(proc->audit_token), proc->original_ppid, (int)proc_path.length, proc_path.data,
+         (int)RealUser(proc->audit_token), NameOrNull(msg.instigator().real_user()),
+         (int)RealGroup(proc->audit_token), NameOrNull(msg.instigator().real_group()));
+
+  return {};
+}
+
+std::vector<uint8_t> UnifiedLog::SerializeMessage(const EnrichedUnlink& msg) {
+  if (EnableMachineIDDecoration()) {
+    return BasicString::SerializeMessage(msg);
+  }
+
+  const es_process_t* proc = msg->process;
+  const es_string_token_t& path = msg->event.unlink.target->path;
+  const es_string_token_t& proc_path = proc->executable->path;
+  os_log(EventLog(),
+         "action=DELETE|path=%{public}.*s|pid=%d|ppid=%d|processpath=%{public}.*s"
+         "|uid=%d|user=%{public}s|gid=%d|group=%{public}s",
+         (int)path.length, path.data, Pid(proc->audit_token), proc->original_ppid,
+         (int)proc_path.length, proc_path.data, (int)RealUser(proc->audit_token),
+         NameOrNull(msg.instigator().real_user()), (int)RealGroup(proc->audit_token),
+         NameOrNull(msg.instigator().real_group()));
+
+  return {};
+}
+
+}  // namespace santa
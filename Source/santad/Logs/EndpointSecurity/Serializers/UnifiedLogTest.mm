@@ -0,0 +1,115 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Serializers/UnifiedLog.h"
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#import <OCMock/OCMock.h>
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#import "Source/common/SNTConfigurator.h"
+#include "Source/common/TestUtils.h"
+#include "Source/common/es/Enricher.h"
+#include "Source/common/es/Message.h"
+#include "Source/common/es/MockEndpointSecurityAPI.h"
+
+using santa::Enricher;
+using santa::Message;
+using santa::Serializer;
+using santa::UnifiedLog;
+
+static std::string UnifiedLogSerializeMessage(es_message_t* esMsg) {
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  std::shared_ptr<Serializer> ul = UnifiedLog::Create(mockESApi, nil);
+  std::vector<uint8_t> ret = ul->SerializeMessage(Enricher().Enrich(Message(mockESApi, esMsg)));
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+
+  return std::string(ret.begin(), ret.end());
+}
+
+@interface UnifiedLogTest : XCTestCase
+@property id mockConfigurator;
+@property BOOL enableMachineIDDecoration;
+@end
+
+@implementation UnifiedLogTest
+
+- (void)setUp {
+  self.enableMachineIDDecoration = NO;
+  self.mockConfigurator = OCMClassMock([SNTConfigurator class]);
+  OCMStub([self.mockConfigurator configurator]).andReturn(self.mockConfigurator);
+  OCMStub([self.mockConfigurator enableMachineIDDecoration]).andDo(^(NSInvocation* inv) {
+    BOOL enabled = self.enableMachineIDDecoration;
+    [inv setReturnValue:&enabled];
+  });
+  OCMStub([self.mockConfigurator machineID]).andReturn(@"my_id");
+}
+
+- (void)tearDown {
+  [self.mockConfigurator stopMocking];
+}
+
+- (void)testStructuredEventsAreLoggedDirectly {
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_file_t file = MakeESFile("close_file");
+
+  es_message_t closeMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &proc);
+  closeMsg.event.close.modified = true;
+  closeMsg.event.close.target = &file;
+  XCTAssertCppStringEqual(UnifiedLogSerializeMessage(&closeMsg), "");
+
+  es_message_t unlinkMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_UNLINK, &proc);
+  unlinkMsg.event.unlink.target = &file;
+  XCTAssertCppStringEqual(UnifiedLogSerializeMessage(&unlinkMsg), "");
+
+  es_message_t exitMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_EXIT, &proc);
+  XCTAssertCppStringEqual(UnifiedLogSerializeMessage(&exitMsg), "");
+}
+
+- (void)testOtherEventsAreFormatted {
+  es_file_t procFile = MakeESFile("foo");
+  es_file_t srcFile = MakeESFile("link_src");
+  es_file_t dstDir = MakeESFile("link_dst");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_LINK, &proc);
+  esMsg.event.link.source = &srcFile;
+  esMsg.event.link.target_dir = &dstDir;
+  esMsg.event.link.target_filename = MakeESStringToken("link_name");
+
+  std::string want = "action=LINK|path=link_src|newpath=link_dst/link_name"
+                     "|pid=12|ppid=56|process=foo|processpath=foo"
+                     "|uid=-2|user=nobody|gid=-1|group=nogroup\n";
+  XCTAssertCppStringEqual(UnifiedLogSerializeMessage(&esMsg), want);
+}
+
+- (void)testMachineIDDecorationFormatsStructuredEvents {
+  self.enableMachineIDDecoration = YES;
+
+  es_file_t procFile = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&procFile, MakeAuditToken(12, 34), MakeAuditToken(56, 78));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_EXIT, &proc);
+
+  std::string want = "action=EXIT|pid=12|pidversion=34|ppid=56|uid=-2|gid=-1|machineid=my_id\n";
+  XCTAssertCppStringEqual(UnifiedLogSerializeMessage(&esMsg), want);
+}
+
+@end
@@ -19,7 +19,7 @@
 #include <sys/mount.h>
 #include <sys/param.h>
 
-#include "Source/common/SantaCache.h"
+#include "Source/common/SantaFlatCache.h"
 #import "Source/common/SantaVnode.h"
 #include "Source/common/String.h"
 
@@ -34,8 +34,10 @@ namespace santa {
 NSString* const kMountFromNameKey = @"SNTMountFromName";
 
 NSString* OriginalPathForTranslocation(const es_process_t* es_proc) {
-  // Cache vnodes that have been determined to not be translocated
-  static SantaCache<SantaVnode, bool> isNotTranslocatedCache(1024);
+  // Cache vnodes that have been determined to not be translocated. This is
+  // consulted for every serialized process, so use the flat layout to avoid
+  // per-insert allocations and pointer chasing on lookup.
+  static SantaFlatCache<SantaVnode, bool> isNotTranslocatedCache(1024);
 
   if (!es_proc) {
     return nil;
@@ -0,0 +1,133 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_TELEMETRYAGGREGATOR_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_TELEMETRYAGGREGATOR_H
+
+#include <time.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Source/common/TelemetryEventMap.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+/// All events of one type from one executable within an aggregation window.
+struct EventSummary {
+  /// Empty for events from executables beyond the per-window limit.
+  std::string executable_path;
+  TelemetryEvent event;
+  uint64_t count;
+  /// The most common target paths, most common first. Counts are estimates
+  /// that can be too high for paths first seen late in the window.
+  std::vector<std::pair<std::string, uint64_t>> top_paths;
+};
+
+/// Thins out high volume telemetry, either by only logging one of every N
+/// events of a type, or by counting events of a type per executable and
+/// periodically logging summaries instead of the events themselves. Under
+/// backpressure, low priority events can also be shed before any others.
+///
+/// Target paths are tracked with the Space-Saving algorithm, so each summary
+/// needs a fixed amount of memory no matter how many paths are seen.
+class TelemetryAggregator {
+ public:
+  static constexpr size_t kTopPaths = 5;
+  static constexpr size_t kTrackedPaths = 4 * kTopPaths;
+  static constexpr size_t kMaxExecutables = 4096;
+
+  struct Window {
+    struct timespec start;
+    struct timespec end;
+    std::vector<EventSummary> summaries;
+  };
+
+  TelemetryAggregator();
+
+  TelemetryAggregator(const TelemetryAggregator&) = delete;
+  TelemetryAggregator& operator=(const TelemetryAggregator&) = delete;
+
+  /// Set the sample rate of every event in the mask. A rate of 0 or 1 logs
+  /// every event.
+  void SetSampleRate(TelemetryEvent events, uint32_t rate);
+  void SetAggregatedEvents(TelemetryEvent events);
+
+  inline bool IsAggregated(TelemetryEvent event) const {
+    return (event & aggregated_events_.load(std::memory_order_relaxed)) != TelemetryEvent::kNone;
+  }
+
+  /// Returns true if this occurrence of the event should be logged.
+  bool Sample(TelemetryEvent event);
+
+  /// Shed the given events when the event log falls behind. Once the backlog
+  /// reaches the threshold, the share of these events that is logged falls
+  /// linearly, until none are logged at twice the threshold. A threshold of 0
+  /// disables load shedding.
+  void SetLoadShedding(TelemetryEvent events, size_t threshold);
+
+  inline bool IsSheddable(TelemetryEvent event) const {
+    return shed_threshold_.load(std::memory_order_relaxed) > 0 &&
+           (event & shed_events_.load(std::memory_order_relaxed)) != TelemetryEvent::kNone;
+  }
+
+  /// Returns true if this occurrence of a sheddable event should be dropped,
+  /// given the number of events waiting to be written.
+  bool Shed(TelemetryEvent event, size_t backlog);
+
+  /// The cumulative number of events dropped by Shed, for each event type
+  /// that has been dropped.
+  std::vector<std::pair<TelemetryEvent, uint64_t>> ShedCounts() const;
+
+  /// Count an event towards the current window. The path may be empty for
+  /// events without a target.
+  void Aggregate(TelemetryEvent event, std::string_view executable_path, std::string_view path);
+
+  /// Ends the current window, returning its summaries ordered by executable
+  /// and event type, and starts a new one.
+  Window Drain();
+
+ private:
+  struct Entry {
+    uint64_t count = 0;
+    absl::flat_hash_map<std::string, uint64_t> paths;
+  };
+
+  static size_t EventIndex(TelemetryEvent event);
+
+  std::atomic<TelemetryEvent> aggregated_events_;
+  std::array<std::atomic<uint32_t>, 64> sample_rates_;
+  std::array<std::atomic<uint64_t>, 64> sample_counts_;
+
+  std::atomic<TelemetryEvent> shed_events_;
+  std::atomic<size_t> shed_threshold_;
+  std::atomic<uint64_t> shed_sample_count_;
+  std::array<std::atomic<uint64_t>, 64> shed_counts_;
+
+  absl::Mutex mu_;
+  absl::flat_hash_map<std::pair<std::string, TelemetryEvent>, Entry> entries_ ABSL_GUARDED_BY(mu_);
+  struct timespec window_start_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_TELEMETRYAGGREGATOR_H
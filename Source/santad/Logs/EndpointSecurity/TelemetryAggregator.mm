@@ -0,0 +1,168 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/TelemetryAggregator.h"
+
+#include <algorithm>
+#include <bit>
+#include <tuple>
+
+namespace santa {
+
+TelemetryAggregator::TelemetryAggregator()
+    : aggregated_events_(TelemetryEvent::kNone),
+      shed_events_(TelemetryEvent::kNone),
+      shed_threshold_(0),
+      shed_sample_count_(0) {
+  for (size_t i = 0; i < sample_rates_.size(); i++) {
+    sample_rates_[i].store(1, std::memory_order_relaxed);
+    sample_counts_[i].store(0, std::memory_order_relaxed);
+    shed_counts_[i].store(0, std::memory_order_relaxed);
+  }
+  clock_gettime(CLOCK_REALTIME, &window_start_);
+}
+
+size_t TelemetryAggregator::EventIndex(TelemetryEvent event) {
+  return std::countr_zero(static_cast<uint64_t>(event));
+}
+
+void TelemetryAggregator::SetSampleRate(TelemetryEvent events, uint32_t rate) {
+  uint64_t mask = static_cast<uint64_t>(events);
+  for (size_t i = 0; i < sample_rates_.size(); i++) {
+    if (mask & (1ULL << i)) {
+      sample_rates_[i].store(std::max(rate, 1u), std::memory_order_relaxed);
+    }
+  }
+}
+
+void TelemetryAggregator::SetAggregatedEvents(TelemetryEvent events) {
+  aggregated_events_.store(events, std::memory_order_relaxed);
+}
+
+bool TelemetryAggregator::Sample(TelemetryEvent event) {
+  if (event == TelemetryEvent::kNone) {
+    return true;
+  }
+
+  size_t index = EventIndex(event);
+  uint32_t rate = sample_rates_[index].load(std::memory_order_relaxed);
+  if (rate <= 1) {
+    return true;
+  }
+  return sample_counts_[index].fetch_add(1, std::memory_order_relaxed) % rate == 0;
+}
+
+void TelemetryAggregator::SetLoadShedding(TelemetryEvent events, size_t threshold) {
+  shed_events_.store(events, std::memory_order_relaxed);
+  shed_threshold_.store(threshold, std::memory_order_relaxed);
+}
+
+bool TelemetryAggregator::Shed(TelemetryEvent event, size_t backlog) {
+  size_t threshold = shed_threshold_.load(std::memory_order_relaxed);
+  if (threshold == 0 || backlog < threshold) {
+    return false;
+  }
+
+  // Keep (2 * threshold - backlog) of every threshold events, spread evenly.
+  bool shed = backlog >= 2 * threshold ||
+              shed_sample_count_.fetch_add(1, std::memory_order_relaxed) % threshold >=
+                  2 * threshold - backlog;
+  if (shed) {
+    shed_counts_[EventIndex(event)].fetch_add(1, std::memory_order_relaxed);
+  }
+  return shed;
+}
+
+std::vector<std::pair<TelemetryEvent, uint64_t>> TelemetryAggregator::ShedCounts() const {
+  std::vector<std::pair<TelemetryEvent, uint64_t>> counts;
+  for (size_t i = 0; i < shed_counts_.size(); i++) {
+    if (uint64_t count = shed_counts_[i].load(std::memory_order_relaxed); count > 0) {
+      counts.emplace_back(static_cast<TelemetryEvent>(1ULL << i), count);
+    }
+  }
+  return counts;
+}
+
+void TelemetryAggregator::Aggregate(TelemetryEvent event, std::string_view executable_path,
+                                    std::string_view path) {
+  absl::MutexLock lock(mu_);
+
+  auto key = std::make_pair(std::string(executable_path), event);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    if (entries_.size() >= kMaxExecutables) {
+      key.first.clear();
+    }
+    it = entries_.try_emplace(std::move(key)).first;
+  }
+
+  Entry& entry = it->second;
+  entry.count++;
+  if (path.empty()) {
+    return;
+  }
+
+  if (auto path_it = entry.paths.find(path); path_it != entry.paths.end()) {
+    path_it->second++;
+  } else if (entry.paths.size() < kTrackedPaths) {
+    entry.paths.emplace(path, 1);
+  } else {
+    // Replace the least common path, which the new one inherits the count of
+    auto min = std::min_element(entry.paths.begin(), entry.paths.end(),
+                                [](const auto& a, const auto& b) { return a.second < b.second; });
+    uint64_t count = min->second + 1;
+    entry.paths.erase(min);
+    entry.paths.emplace(path, count);
+  }
+}
+
+TelemetryAggregator::Window TelemetryAggregator::Drain() {
+  Window window;
+  absl::flat_hash_map<std::pair<std::string, TelemetryEvent>, Entry> entries;
+  {
+    absl::MutexLock lock(mu_);
+    std::swap(entries, entries_);
+    window.start = window_start_;
+    clock_gettime(CLOCK_REALTIME, &window_start_);
+    window.end = window_start_;
+  }
+
+  window.summaries.reserve(entries.size());
+  for (const auto& [key, entry] : entries) {
+    EventSummary summary{
+        .executable_path = key.first,
+        .event = key.second,
+        .count = entry.count,
+    };
+
+    summary.top_paths.assign(entry.paths.begin(), entry.paths.end());
+    std::sort(summary.top_paths.begin(), summary.top_paths.end(),
+              [](const auto& a, const auto& b) {
+                return std::tie(b.second, a.first) < std::tie(a.second, b.first);
+              });
+    if (summary.top_paths.size() > kTopPaths) {
+      summary.top_paths.resize(kTopPaths);
+    }
+
+    window.summaries.push_back(std::move(summary));
+  }
+
+  std::sort(window.summaries.begin(), window.summaries.end(), [](const auto& a, const auto& b) {
+    return std::tie(a.executable_path, a.event) < std::tie(b.executable_path, b.event);
+  });
+
+  return window;
+}
+
+}  // namespace santa
@@ -0,0 +1,209 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/TelemetryAggregator.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Source/common/TelemetryEventMap.h"
+
+using santa::EventSummary;
+using santa::TelemetryAggregator;
+using santa::TelemetryEvent;
+
+@interface TelemetryAggregatorTest : XCTestCase
+@end
+
+@implementation TelemetryAggregatorTest
+
+- (void)testSampling {
+  TelemetryAggregator aggregator;
+
+  // Everything is logged by default
+  for (int i = 0; i < 10; i++) {
+    XCTAssertTrue(aggregator.Sample(TelemetryEvent::kFork));
+  }
+
+  aggregator.SetSampleRate(TelemetryEvent::kFork | TelemetryEvent::kExit, 4);
+  int forks = 0;
+  int exits = 0;
+  for (int i = 0; i < 100; i++) {
+    forks += aggregator.Sample(TelemetryEvent::kFork);
+    exits += aggregator.Sample(TelemetryEvent::kExit);
+    XCTAssertTrue(aggregator.Sample(TelemetryEvent::kClose));
+  }
+  XCTAssertEqual(forks, 25);
+  XCTAssertEqual(exits, 25);
+
+  aggregator.SetSampleRate(TelemetryEvent::kEverything, 0);
+  XCTAssertTrue(aggregator.Sample(TelemetryEvent::kFork));
+  XCTAssertTrue(aggregator.Sample(TelemetryEvent::kFork));
+  XCTAssertTrue(aggregator.Sample(TelemetryEvent::kNone));
+}
+
+- (void)testLoadShedding {
+  TelemetryAggregator aggregator;
+
+  // Nothing is shed by default
+  XCTAssertFalse(aggregator.IsSheddable(TelemetryEvent::kFork));
+
+  aggregator.SetLoadShedding(TelemetryEvent::kFork | TelemetryEvent::kExit, 100);
+  XCTAssertTrue(aggregator.IsSheddable(TelemetryEvent::kFork));
+  XCTAssertFalse(aggregator.IsSheddable(TelemetryEvent::kExecution));
+
+  // Below the threshold everything is kept, and above twice the threshold
+  // nothing is
+  for (int i = 0; i < 100; i++) {
+    XCTAssertFalse(aggregator.Shed(TelemetryEvent::kFork, 99));
+    XCTAssertTrue(aggregator.Shed(TelemetryEvent::kExit, 200));
+  }
+
+  // In between, the share kept falls with the backlog
+  int forks_shed = 0;
+  for (int i = 0; i < 1000; i++) {
+    forks_shed += aggregator.Shed(TelemetryEvent::kFork, 175);
+  }
+  XCTAssertEqual(forks_shed, 750);
+
+  std::vector<std::pair<TelemetryEvent, uint64_t>> want = {
+      {TelemetryEvent::kFork, 750},
+      {TelemetryEvent::kExit, 100},
+  };
+  XCTAssertTrue(aggregator.ShedCounts() == want);
+
+  aggregator.SetLoadShedding(TelemetryEvent::kFork, 0);
+  XCTAssertFalse(aggregator.IsSheddable(TelemetryEvent::kFork));
+  XCTAssertFalse(aggregator.Shed(TelemetryEvent::kFork, 1000));
+}
+
+- (void)testIsAggregated {
+  TelemetryAggregator aggregator;
+  XCTAssertFalse(aggregator.IsAggregated(TelemetryEvent::kClose));
+
+  aggregator.SetAggregatedEvents(TelemetryEvent::kClose | TelemetryEvent::kFork);
+  XCTAssertTrue(aggregator.IsAggregated(TelemetryEvent::kClose));
+  XCTAssertTrue(aggregator.IsAggregated(TelemetryEvent::kFork));
+  XCTAssertFalse(aggregator.IsAggregated(TelemetryEvent::kExecution));
+  XCTAssertFalse(aggregator.IsAggregated(TelemetryEvent::kNone));
+}
+
+- (void)testSummaries {
+  TelemetryAggregator aggregator;
+  for (int i = 0; i < 3; i++) {
+    aggregator.Aggregate(TelemetryEvent::kClose, "/bin/b", "/tmp/x");
+  }
+  aggregator.Aggregate(TelemetryEvent::kClose, "/bin/b", "/tmp/y");
+  aggregator.Aggregate(TelemetryEvent::kExit, "/bin/b", "");
+  aggregator.Aggregate(TelemetryEvent::kClose, "/bin/a", "/tmp/z");
+
+  TelemetryAggregator::Window window = aggregator.Drain();
+  XCTAssertLessThanOrEqual(window.start.tv_sec, window.end.tv_sec);
+  XCTAssertEqual(window.summaries.size(), 3);
+
+  const EventSummary& a = window.summaries[0];
+  XCTAssertTrue(a.executable_path == "/bin/a");
+  XCTAssertEqual(a.event, TelemetryEvent::kClose);
+  XCTAssertEqual(a.count, 1);
+
+  const EventSummary& b_close = window.summaries[1];
+  XCTAssertTrue(b_close.executable_path == "/bin/b");
+  XCTAssertEqual(b_close.event, TelemetryEvent::kClose);
+  XCTAssertEqual(b_close.count, 4);
+  XCTAssertEqual(b_close.top_paths.size(), 2);
+  XCTAssertTrue(b_close.top_paths[0].first == "/tmp/x");
+  XCTAssertEqual(b_close.top_paths[0].second, 3);
+  XCTAssertTrue(b_close.top_paths[1].first == "/tmp/y");
+  XCTAssertEqual(b_close.top_paths[1].second, 1);
+
+  const EventSummary& b_exit = window.summaries[2];
+  XCTAssertEqual(b_exit.event, TelemetryEvent::kExit);
+  XCTAssertEqual(b_exit.count, 1);
+  XCTAssertTrue(b_exit.top_paths.empty());
+
+  // Draining starts a new window
+  TelemetryAggregator::Window next = aggregator.Drain();
+  XCTAssertTrue(next.summaries.empty());
+  XCTAssertEqual(next.start.tv_sec, window.end.tv_sec);
+  XCTAssertEqual(next.start.tv_nsec, window.end.tv_nsec);
+}
+
+- (void)testTopPathsAreBounded {
+  TelemetryAggregator aggregator;
+
+  // A few hot paths amongst many that are only seen once
+  for (int i = 0; i < 1000; i++) {
+    aggregator.Aggregate(TelemetryEvent::kClose, "/bin/a", "/hot/" + std::to_string(i % 3));
+    aggregator.Aggregate(TelemetryEvent::kClose, "/bin/a", "/cold/" + std::to_string(i));
+  }
+
+  TelemetryAggregator::Window window = aggregator.Drain();
+  XCTAssertEqual(window.summaries.size(), 1);
+
+  const EventSummary& summary = window.summaries[0];
+  XCTAssertEqual(summary.count, 2000);
+  XCTAssertEqual(summary.top_paths.size(), TelemetryAggregator::kTopPaths);
+  for (size_t i = 0; i < 3; i++) {
+    XCTAssertTrue(summary.top_paths[i].first.starts_with("/hot/"));
+    XCTAssertGreaterThanOrEqual(summary.top_paths[i].second, 333);
+  }
+}
+
+- (void)testExecutablesAreBounded {
+  TelemetryAggregator aggregator;
+  const size_t kExtra = 10;
+  for (size_t i = 0; i < TelemetryAggregator::kMaxExecutables + kExtra; i++) {
+    aggregator.Aggregate(TelemetryEvent::kFork, "/bin/" + std::to_string(i), "");
+  }
+  // Already tracked executables are still counted separately
+  aggregator.Aggregate(TelemetryEvent::kFork, "/bin/0", "");
+
+  TelemetryAggregator::Window window = aggregator.Drain();
+  XCTAssertEqual(window.summaries.size(), TelemetryAggregator::kMaxExecutables + 1);
+
+  // The overflow entry has no executable and sorts first
+  XCTAssertTrue(window.summaries[0].executable_path.empty());
+  XCTAssertEqual(window.summaries[0].count, kExtra);
+  XCTAssertTrue(window.summaries[1].executable_path == "/bin/0");
+  XCTAssertEqual(window.summaries[1].count, 2);
+}
+
+- (void)testConcurrentAggregation {
+  TelemetryAggregator aggregator;
+  const int kThreads = 8;
+  const int kEventsPerThread = 10000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&aggregator] {
+      for (int i = 0; i < kEventsPerThread; i++) {
+        aggregator.Aggregate(TelemetryEvent::kClose, "/bin/a", "/tmp/a");
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  TelemetryAggregator::Window window = aggregator.Drain();
+  XCTAssertEqual(window.summaries.size(), 1);
+  XCTAssertEqual(window.summaries[0].count, kThreads * kEventsPerThread);
+  XCTAssertEqual(window.summaries[0].top_paths[0].second, kThreads * kEventsPerThread);
+}
+
+@end
@@ -15,14 +15,20 @@
 #ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ANYBATCHER_H
 #define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ANYBATCHER_H
 
+#include <string>
 #include <vector>
 
-#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/binaryproto.pb.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 
 namespace fsspool {
 
+// Batches messages into a `binaryproto::LogBatch` of `Any` records.
+//
+// Records are encoded directly into the batch's wire format as they are
+// written, so each message is copied once into the batch rather than being
+// wrapped in an `Any` and re-serialized when the batch completes. The output
+// is byte-for-byte what serializing the equivalent LogBatch would produce.
 class AnyBatcher {
  public:
   AnyBatcher();
@@ -37,7 +43,10 @@ class AnyBatcher {
 
  private:
   std::string type_url_;
-  santa::fsspool::binaryproto::LogBatch cache_;
+  // Pre-encoded `type_url` field shared by every record.
+  std::string type_url_field_;
+  // Encoded LogBatch containing every record written since the last batch.
+  std::string batch_;
 };
 
 }  // namespace fsspool
@@ -14,18 +14,48 @@
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
 
+#include <climits>
+
+#include "Source/common/BufferPool.h"
 #include "Source/common/santa.pb.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool_platform_specific.h"
 #include "absl/strings/str_cat.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
 
 static const char* kTypeGoogleApisComPrefix = "type.googleapis.com/";
-static constexpr int kReservedBatchSize = 2048;
 
 namespace fsspool {
 
+namespace {
+
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+// Field numbers of `LogBatch.records` and `Any.type_url`/`Any.value`.
+constexpr int kRecordsFieldNumber = 1;
+constexpr int kTypeUrlFieldNumber = 1;
+constexpr int kValueFieldNumber = 2;
+
+void AppendVarint32(std::string* out, uint32_t value) {
+  uint8_t buf[5];
+  uint8_t* end = CodedOutputStream::WriteVarint32ToArray(value, buf);
+  out->append(reinterpret_cast<const char*>(buf), end - buf);
+}
+
+void AppendLengthDelimitedHeader(std::string* out, int field_number, size_t length) {
+  AppendVarint32(out,
+                 WireFormatLite::MakeTag(field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+  AppendVarint32(out, static_cast<uint32_t>(length));
+}
+
+}  // namespace
+
 AnyBatcher::AnyBatcher() {
   type_url_ = absl::StrCat(kTypeGoogleApisComPrefix,
                            ::santa::pb::v1::SantaMessage::descriptor()->full_name());
+  AppendLengthDelimitedHeader(&type_url_field_, kTypeUrlFieldNumber, type_url_.size());
+  type_url_field_.append(type_url_);
 }
 
 absl::Status AnyBatcher::InitializeBatch(int fd) {
@@ -34,31 +64,43 @@ absl::Status AnyBatcher::InitializeBatch(int fd) {
 
 bool AnyBatcher::NeedToOpenFile() {
   // Only indicate a new file should be opened if there are records to write.
-  return cache_.records().size() > 0;
+  return !batch_.empty();
 }
 
 absl::Status AnyBatcher::Write(std::vector<uint8_t> bytes) {
-  google::protobuf::Any any;
-  any.set_value(absl::string_view((const char*)bytes.data(), bytes.size()));
-  any.set_type_url(type_url_);
+  if (bytes.size() > INT_MAX) {
+    return absl::InternalError("Telemetry event size too large");
+  }
 
-  *cache_.mutable_records()->Add() = any;
+  // An empty value is the proto3 default and so is omitted, as it would be
+  // when serializing an Any.
+  size_t value_field_size = 0;
+  if (!bytes.empty()) {
+    value_field_size =
+        WireFormatLite::TagSize(kValueFieldNumber, WireFormatLite::TYPE_BYTES) +
+        CodedOutputStream::VarintSize32(static_cast<uint32_t>(bytes.size())) + bytes.size();
+  }
 
+  AppendLengthDelimitedHeader(&batch_, kRecordsFieldNumber,
+                              type_url_field_.size() + value_field_size);
+  batch_.append(type_url_field_);
+  if (!bytes.empty()) {
+    AppendLengthDelimitedHeader(&batch_, kValueFieldNumber, bytes.size());
+    batch_.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  }
+
+  santa::BufferPool::Shared().Release(std::move(bytes));
   return absl::OkStatus();
 }
 
 absl::StatusOr<size_t> AnyBatcher::CompleteBatch(int fd) {
-  std::string msg;
-  if (!cache_.SerializeToString(&msg)) {
-    return absl::InternalError("Failed to serialize internal LogBatch cache.");
-  }
-
-  absl::Status status = WriteBuffer(fd, msg);
+  absl::Status status = WriteBuffer(fd, batch_);
+  size_t size = batch_.size();
 
-  cache_ = santa::fsspool::binaryproto::LogBatch();
-  cache_.mutable_records()->Reserve(kReservedBatchSize);
+  // Keep the capacity for the next batch.
+  batch_.clear();
 
-  return msg.size();
+  return size;
 }
 
 }  // namespace fsspool
@@ -0,0 +1,163 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
+
+#include <climits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Source/common/BufferPool.h"
+#include "Source/common/santa.pb.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/binaryproto.pb.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool_platform_specific.h"
+#include "absl/container/inlined_vector.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+
+namespace fsspool {
+
+namespace {
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::internal::WireFormatLite;
+
+// Group of records that couldn't be split into fields, and the column holding
+// their bytes.
+constexpr uint32_t kUnparsedGroup = 0;
+constexpr uint32_t kUnparsedColumn = 0;
+
+struct FieldSpan {
+  uint32_t field_number;
+  int begin;
+  int end;
+};
+
+std::shared_ptr<const absl::flat_hash_set<uint32_t>> EventFieldNumbers() {
+  auto fields = std::make_shared<absl::flat_hash_set<uint32_t>>();
+  const google::protobuf::OneofDescriptor* oneof =
+      ::santa::pb::v1::SantaMessage::descriptor()->FindOneofByName("event");
+  for (int i = 0; oneof && i < oneof->field_count(); ++i) {
+    fields->insert(static_cast<uint32_t>(oneof->field(i)->number()));
+  }
+  return fields;
+}
+
+}  // namespace
+
+ColumnarBatcher::ColumnarBatcher() : event_fields_(EventFieldNumbers()) {}
+
+absl::Status ColumnarBatcher::InitializeBatch(int fd) {
+  return absl::OkStatus();
+}
+
+bool ColumnarBatcher::NeedToOpenFile() {
+  // Only indicate a new file should be opened if there are records to write.
+  return !groups_.empty();
+}
+
+void ColumnarBatcher::AddUnparsedRecord(const std::vector<uint8_t>& bytes) {
+  Group& group = groups_[kUnparsedGroup];
+  Column& column = group.columns[kUnparsedColumn];
+  column.lengths.push_back(static_cast<uint32_t>(bytes.size()));
+  column.data.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  group.record_count++;
+}
+
+absl::Status ColumnarBatcher::Write(std::vector<uint8_t> bytes) {
+  if (bytes.size() > INT_MAX) {
+    return absl::InternalError("Telemetry event size too large");
+  }
+
+  // Find the top-level field boundaries and which event the record holds.
+  absl::InlinedVector<FieldSpan, 8> spans;
+  uint32_t event_field = kUnparsedGroup;
+  bool parsed = true;
+  CodedInputStream input(bytes.data(), static_cast<int>(bytes.size()));
+  while (true) {
+    int begin = input.CurrentPosition();
+    uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      // Either the end of the record, or an invalid tag.
+      parsed = begin == static_cast<int>(bytes.size());
+      break;
+    }
+    if (!WireFormatLite::SkipField(&input, tag)) {
+      parsed = false;
+      break;
+    }
+
+    uint32_t field_number = WireFormatLite::GetTagFieldNumber(tag);
+    if (event_fields_->contains(field_number)) {
+      event_field = field_number;
+    }
+    spans.push_back({field_number, begin, input.CurrentPosition()});
+  }
+
+  if (!parsed || event_field == kUnparsedGroup) {
+    AddUnparsedRecord(bytes);
+    santa::BufferPool::Shared().Release(std::move(bytes));
+    return absl::OkStatus();
+  }
+
+  Group& group = groups_[event_field];
+  for (const FieldSpan& span : spans) {
+    Column& column = group.columns[span.field_number];
+    // Columns first seen partway through the group have nothing for the
+    // earlier records.
+    column.lengths.resize(group.record_count + 1, 0);
+    column.lengths.back() += static_cast<uint32_t>(span.end - span.begin);
+    column.data.append(reinterpret_cast<const char*>(bytes.data()) + span.begin,
+                       span.end - span.begin);
+  }
+  group.record_count++;
+
+  santa::BufferPool::Shared().Release(std::move(bytes));
+  return absl::OkStatus();
+}
+
+absl::StatusOr<size_t> ColumnarBatcher::CompleteBatch(int fd) {
+  ::santa::fsspool::binaryproto::ColumnarLogBatch batch;
+  for (auto& [event_field, group] : groups_) {
+    ::santa::fsspool::binaryproto::ColumnarRecordGroup* out_group = batch.add_groups();
+    out_group->set_event_field_number(event_field);
+    out_group->set_record_count(group.record_count);
+    for (auto& [field_number, column] : group.columns) {
+      // Columns missing from the last records of the group.
+      column.lengths.resize(group.record_count, 0);
+
+      ::santa::fsspool::binaryproto::ColumnarColumn* out_column = out_group->add_columns();
+      out_column->set_field_number(field_number);
+      out_column->mutable_lengths()->Assign(column.lengths.begin(), column.lengths.end());
+      out_column->set_data(std::move(column.data));
+    }
+  }
+  groups_.clear();
+
+  std::string serialized;
+  if (!batch.SerializeToString(&serialized)) {
+    return absl::InternalError("Failed to serialize columnar batch");
+  }
+
+  absl::Status status = WriteBuffer(fd, serialized);
+  if (!status.ok()) {
+    return status;
+  }
+
+  return serialized.size();
+}
+
+}  // namespace fsspool
@@ -0,0 +1,109 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_SPOOLFRAMEINDEX_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_SPOOLFRAMEINDEX_H
+
+#include <sys/types.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+
+namespace fsspool {
+
+// Summary of one independently decompressible zstd frame of a spool file, so
+// that readers looking for events from a time range, of a given type or from a
+// given pid can skip frames that can't hold any.
+//
+// Every query is conservative: a frame is only ruled out when none of its
+// records could match.
+struct SpoolFrameInfo {
+  // 2048 bits, enough for a few hundred distinct pids per frame.
+  static constexpr size_t kPidBloomWords = 32;
+
+  // Set when the frame holds records whose event time or instigating pid
+  // couldn't be determined.
+  static constexpr uint32_t kHasRecordsWithoutTime = 1 << 0;
+  static constexpr uint32_t kHasRecordsWithoutPid = 1 << 1;
+
+  // Location of the compressed frame within the spool file.
+  uint64_t offset = 0;
+  uint64_t length = 0;
+
+  uint32_t record_count = 0;
+  uint32_t flags = 0;
+  int64_t min_event_time_ns = std::numeric_limits<int64_t>::max();
+  int64_t max_event_time_ns = std::numeric_limits<int64_t>::min();
+  // Bit n is set when the frame holds an event stored in field n of the
+  // `SantaMessage.event` oneof. Bit 0 covers fields beyond the bitmap.
+  uint64_t event_types = 0;
+  std::array<uint64_t, kPidBloomWords> pid_bloom = {};
+
+  bool MayContainEventsBetween(int64_t start_ns, int64_t end_ns) const;
+  bool MayContainEventType(uint32_t event_field_number) const;
+  bool MayContainPid(pid_t pid) const;
+
+  void AddEventType(uint32_t event_field_number);
+  void AddPid(pid_t pid);
+};
+
+// Builds the frame index of a spool file of serialized `SantaMessage` records
+// as they are written. Records are only scanned for the few fields the index
+// needs, not parsed.
+//
+// The index is stored at the end of the spool file in a zstd skippable frame,
+// which decompressors ignore, so indexed files remain plain zstd streams.
+class SpoolFrameIndexBuilder {
+ public:
+  SpoolFrameIndexBuilder();
+
+  void AddRecord(const uint8_t* data, size_t size);
+
+  bool FrameHasRecords() const { return current_.record_count > 0; }
+
+  // Ends the current frame, where end_offset is the number of compressed
+  // bytes written to the file so far.
+  void EndFrame(uint64_t end_offset);
+
+  // Returns the encoded index of the frames ended so far, or an empty string
+  // if there are none, and resets the builder for the next file.
+  std::string Finish();
+
+ private:
+  // Field numbers of the `SantaMessage.event` oneof members whose first field
+  // is the instigating process. Shared between copies, since every shard of a
+  // spool gets its own copy of the batcher.
+  std::shared_ptr<const absl::flat_hash_set<uint32_t>> instigator_events_;
+  std::vector<SpoolFrameInfo> frames_;
+  SpoolFrameInfo current_;
+};
+
+std::string EncodeSpoolFrameIndex(const std::vector<SpoolFrameInfo>& frames);
+
+// Reads the frame index stored at the end of the spool file open as fd.
+// Returns NotFoundError for files without an index, e.g. those written before
+// indexing was added or merged by spool compaction.
+absl::StatusOr<std::vector<SpoolFrameInfo>> ReadSpoolFrameIndex(int fd);
+
+}  // namespace fsspool
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_SPOOLFRAMEINDEX_H
@@ -0,0 +1,412 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/SpoolFrameIndex.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <utility>
+
+#include "Source/common/santa.pb.h"
+#include "absl/status/status.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "zstd.h"
+
+namespace fsspool {
+
+namespace {
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+// The index is a skippable frame whose payload is:
+//   u32 version, u32 frame count, frame entries,
+//   u32 payload size, u32 kIndexMagic
+// The trailing size and magic let readers find the index from the end of the
+// file. All integers are little endian.
+constexpr uint32_t kSkippableFrameMagic = ZSTD_MAGIC_SKIPPABLE_START;
+constexpr uint32_t kIndexMagic = 0x49544E53;
+constexpr uint32_t kIndexVersion = 1;
+constexpr size_t kSkippableHeaderSize = 8;
+constexpr size_t kPayloadHeaderSize = 8;
+constexpr size_t kPayloadFooterSize = 8;
+constexpr size_t kEntrySize =
+    8 + 8 + 4 + 4 + 8 + 8 + 8 + 8 * SpoolFrameInfo::kPidBloomWords;
+
+// Field number of the instigator of the events that have one.
+constexpr uint32_t kInstigatorFieldNumber = 1;
+constexpr int64_t kNanosPerSecond = 1000000000;
+
+constexpr size_t kPidBloomBits = 64 * SpoolFrameInfo::kPidBloomWords;
+constexpr int kPidBloomProbes = 3;
+
+struct Span {
+  const uint8_t* data;
+  int size;
+};
+
+std::shared_ptr<const absl::flat_hash_set<uint32_t>> InstigatorEventFields() {
+  auto fields = std::make_shared<absl::flat_hash_set<uint32_t>>();
+  const google::protobuf::OneofDescriptor* oneof =
+      ::santa::pb::v1::SantaMessage::descriptor()->FindOneofByName("event");
+  const google::protobuf::Descriptor* process_info = ::santa::pb::v1::ProcessInfo::descriptor();
+  const google::protobuf::Descriptor* process_info_light =
+      ::santa::pb::v1::ProcessInfoLight::descriptor();
+  for (int i = 0; oneof && i < oneof->field_count(); ++i) {
+    const google::protobuf::Descriptor* event = oneof->field(i)->message_type();
+    const google::protobuf::FieldDescriptor* first =
+        event ? event->FindFieldByNumber(kInstigatorFieldNumber) : nullptr;
+    if (first && first->name() == "instigator" &&
+        (first->message_type() == process_info || first->message_type() == process_info_light)) {
+      fields->insert(static_cast<uint32_t>(oneof->field(i)->number()));
+    }
+  }
+  return fields;
+}
+
+// Finds the first occurrence of a field of the given wire type in msg. For
+// length-delimited fields, sub is set to the field's bytes, otherwise varint is
+// set to its value.
+bool FindField(Span msg, uint32_t field_number, WireFormatLite::WireType wire_type, Span* sub,
+               uint64_t* varint) {
+  CodedInputStream input(msg.data, msg.size);
+  while (uint32_t tag = input.ReadTag()) {
+    if (WireFormatLite::GetTagFieldNumber(tag) != field_number ||
+        WireFormatLite::GetTagWireType(tag) != wire_type) {
+      if (!WireFormatLite::SkipField(&input, tag)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (wire_type == WireFormatLite::WIRETYPE_VARINT) {
+      return input.ReadVarint64(varint);
+    }
+
+    uint32_t length;
+    if (!input.ReadVarint32(&length)) {
+      return false;
+    }
+    int offset = input.CurrentPosition();
+    if (length > static_cast<uint32_t>(msg.size - offset)) {
+      return false;
+    }
+    *sub = {msg.data + offset, static_cast<int>(length)};
+    return true;
+  }
+  return false;
+}
+
+bool FindMessageField(Span msg, uint32_t field_number, Span* sub) {
+  return FindField(msg, field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, sub, nullptr);
+}
+
+bool FindVarintField(Span msg, uint32_t field_number, uint64_t* value) {
+  return FindField(msg, field_number, WireFormatLite::WIRETYPE_VARINT, nullptr, value);
+}
+
+bool ParseEventTime(Span timestamp, int64_t* time_ns) {
+  uint64_t seconds = 0;
+  uint64_t nanos = 0;
+  // Zero is the proto3 default and so may be omitted.
+  FindVarintField(timestamp, google::protobuf::Timestamp::kSecondsFieldNumber, &seconds);
+  FindVarintField(timestamp, google::protobuf::Timestamp::kNanosFieldNumber, &nanos);
+  int64_t s = static_cast<int64_t>(seconds);
+  if (s > INT64_MAX / kNanosPerSecond || s < INT64_MIN / kNanosPerSecond) {
+    return false;
+  }
+  *time_ns = s * kNanosPerSecond + static_cast<int32_t>(nanos);
+  return true;
+}
+
+bool ParseInstigatorPid(Span event, pid_t* pid) {
+  Span instigator, id;
+  uint64_t value;
+  // ProcessInfo and ProcessInfoLight share the field number of their ID.
+  if (!FindMessageField(event, kInstigatorFieldNumber, &instigator) ||
+      !FindMessageField(instigator, ::santa::pb::v1::ProcessInfoLight::kIdFieldNumber, &id) ||
+      !FindVarintField(id, ::santa::pb::v1::ProcessID::kPidFieldNumber, &value)) {
+    return false;
+  }
+  *pid = static_cast<pid_t>(value);
+  return true;
+}
+
+uint64_t Mix(uint64_t x) {
+  // splitmix64 finalizer
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+template <typename F>
+void ForEachPidBloomBit(pid_t pid, F&& f) {
+  uint64_t hash = Mix(static_cast<uint32_t>(pid));
+  uint64_t h1 = hash;
+  uint64_t h2 = (hash >> 32) | 1;
+  for (int i = 0; i < kPidBloomProbes; ++i) {
+    f(static_cast<size_t>((h1 + i * h2) % kPidBloomBits));
+  }
+}
+
+uint8_t* AppendLE32(uint32_t value, uint8_t* out) {
+  return CodedOutputStream::WriteLittleEndian32ToArray(value, out);
+}
+
+uint8_t* AppendLE64(uint64_t value, uint8_t* out) {
+  return CodedOutputStream::WriteLittleEndian64ToArray(value, out);
+}
+
+uint32_t LE32(const uint8_t* in) {
+  uint32_t value;
+  CodedInputStream::ReadLittleEndian32FromArray(in, &value);
+  return value;
+}
+
+uint64_t LE64(const uint8_t* in) {
+  uint64_t value;
+  CodedInputStream::ReadLittleEndian64FromArray(in, &value);
+  return value;
+}
+
+absl::Status ReadFully(int fd, uint8_t* buf, size_t size, off_t offset) {
+  while (size > 0) {
+    ssize_t n = pread(fd, buf, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return absl::ErrnoToStatus(errno, "Failed to read spool frame index");
+    }
+    if (n == 0) {
+      return absl::DataLossError("Truncated spool frame index");
+    }
+    buf += n;
+    size -= n;
+    offset += n;
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+bool SpoolFrameInfo::MayContainEventsBetween(int64_t start_ns, int64_t end_ns) const {
+  return (flags & kHasRecordsWithoutTime) ||
+         (min_event_time_ns <= end_ns && max_event_time_ns >= start_ns);
+}
+
+bool SpoolFrameInfo::MayContainEventType(uint32_t event_field_number) const {
+  return (event_types & 1) || (event_field_number < 64 && (event_types >> event_field_number) & 1);
+}
+
+bool SpoolFrameInfo::MayContainPid(pid_t pid) const {
+  if (flags & kHasRecordsWithoutPid) {
+    return true;
+  }
+  bool found = true;
+  ForEachPidBloomBit(pid, [&](size_t bit) {
+    found &= (pid_bloom[bit / 64] >> (bit % 64)) & 1;
+  });
+  return found;
+}
+
+void SpoolFrameInfo::AddEventType(uint32_t event_field_number) {
+  event_types |= 1ULL << (event_field_number < 64 ? event_field_number : 0);
+}
+
+void SpoolFrameInfo::AddPid(pid_t pid) {
+  ForEachPidBloomBit(pid, [&](size_t bit) { pid_bloom[bit / 64] |= 1ULL << (bit % 64); });
+}
+
+SpoolFrameIndexBuilder::SpoolFrameIndexBuilder() : instigator_events_(InstigatorEventFields()) {}
+
+void SpoolFrameIndexBuilder::AddRecord(const uint8_t* data, size_t size) {
+  current_.record_count++;
+  if (size > INT_MAX) {
+    current_.flags |=
+        SpoolFrameInfo::kHasRecordsWithoutTime | SpoolFrameInfo::kHasRecordsWithoutPid;
+    current_.AddEventType(0);
+    return;
+  }
+
+  // Find the event time and the event, skipping every other top-level field.
+  Span record = {data, static_cast<int>(size)};
+  Span event_time = {nullptr, 0};
+  Span event = {nullptr, 0};
+  uint32_t event_field = 0;
+  CodedInputStream input(record.data, record.size);
+  while (uint32_t tag = input.ReadTag()) {
+    uint32_t field_number = WireFormatLite::GetTagFieldNumber(tag);
+    if (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+        (field_number != ::santa::pb::v1::SantaMessage::kEventTimeFieldNumber &&
+         field_number < ::santa::pb::v1::SantaMessage::kExecutionFieldNumber)) {
+      if (!WireFormatLite::SkipField(&input, tag)) {
+        break;
+      }
+      continue;
+    }
+
+    uint32_t length;
+    if (!input.ReadVarint32(&length)) {
+      break;
+    }
+    int offset = input.CurrentPosition();
+    if (length > static_cast<uint32_t>(record.size - offset) || !input.Skip(length)) {
+      break;
+    }
+    Span field = {record.data + offset, static_cast<int>(length)};
+    if (field_number == ::santa::pb::v1::SantaMessage::kEventTimeFieldNumber) {
+      event_time = field;
+    } else {
+      event = field;
+      event_field = field_number;
+    }
+  }
+
+  int64_t time_ns;
+  if (event_time.data && ParseEventTime(event_time, &time_ns)) {
+    current_.min_event_time_ns = std::min(current_.min_event_time_ns, time_ns);
+    current_.max_event_time_ns = std::max(current_.max_event_time_ns, time_ns);
+  } else {
+    current_.flags |= SpoolFrameInfo::kHasRecordsWithoutTime;
+  }
+
+  current_.AddEventType(event_field);
+
+  pid_t pid;
+  if (event.data && instigator_events_->contains(event_field) && ParseInstigatorPid(event, &pid)) {
+    current_.AddPid(pid);
+  } else {
+    current_.flags |= SpoolFrameInfo::kHasRecordsWithoutPid;
+  }
+}
+
+void SpoolFrameIndexBuilder::EndFrame(uint64_t end_offset) {
+  uint64_t start = frames_.empty() ? 0 : frames_.back().offset + frames_.back().length;
+  if (current_.record_count == 0 || end_offset <= start) {
+    current_ = SpoolFrameInfo();
+    return;
+  }
+  current_.offset = start;
+  current_.length = end_offset - start;
+  frames_.push_back(std::exchange(current_, SpoolFrameInfo()));
+}
+
+std::string SpoolFrameIndexBuilder::Finish() {
+  std::string encoded = frames_.empty() ? std::string() : EncodeSpoolFrameIndex(frames_);
+  frames_.clear();
+  current_ = SpoolFrameInfo();
+  return encoded;
+}
+
+std::string EncodeSpoolFrameIndex(const std::vector<SpoolFrameInfo>& frames) {
+  size_t payload_size = kPayloadHeaderSize + frames.size() * kEntrySize + kPayloadFooterSize;
+  std::string encoded(kSkippableHeaderSize + payload_size, '\0');
+  uint8_t* out = reinterpret_cast<uint8_t*>(encoded.data());
+
+  out = AppendLE32(kSkippableFrameMagic, out);
+  out = AppendLE32(static_cast<uint32_t>(payload_size), out);
+  out = AppendLE32(kIndexVersion, out);
+  out = AppendLE32(static_cast<uint32_t>(frames.size()), out);
+  for (const SpoolFrameInfo& frame : frames) {
+    out = AppendLE64(frame.offset, out);
+    out = AppendLE64(frame.length, out);
+    out = AppendLE32(frame.record_count, out);
+    out = AppendLE32(frame.flags, out);
+    out = AppendLE64(static_cast<uint64_t>(frame.min_event_time_ns), out);
+    out = AppendLE64(static_cast<uint64_t>(frame.max_event_time_ns), out);
+    out = AppendLE64(frame.event_types, out);
+    for (uint64_t word : frame.pid_bloom) {
+      out = AppendLE64(word, out);
+    }
+  }
+  out = AppendLE32(static_cast<uint32_t>(payload_size), out);
+  AppendLE32(kIndexMagic, out);
+  return encoded;
+}
+
+absl::StatusOr<std::vector<SpoolFrameInfo>> ReadSpoolFrameIndex(int fd) {
+  struct stat sb;
+  if (fstat(fd, &sb) != 0) {
+    return absl::ErrnoToStatus(errno, "Failed to stat spool file");
+  }
+  size_t file_size = static_cast<size_t>(sb.st_size);
+  if (file_size < kSkippableHeaderSize + kPayloadHeaderSize + kPayloadFooterSize) {
+    return absl::NotFoundError("Spool file has no frame index");
+  }
+
+  uint8_t footer[kPayloadFooterSize];
+  if (absl::Status status = ReadFully(fd, footer, sizeof(footer), file_size - sizeof(footer));
+      !status.ok()) {
+    return status;
+  }
+  size_t payload_size = LE32(footer);
+  if (LE32(footer + 4) != kIndexMagic) {
+    return absl::NotFoundError("Spool file has no frame index");
+  }
+  if (payload_size < kPayloadHeaderSize + kPayloadFooterSize ||
+      payload_size + kSkippableHeaderSize > file_size) {
+    return absl::DataLossError("Corrupt spool frame index");
+  }
+
+  std::vector<uint8_t> buf(kSkippableHeaderSize + payload_size);
+  if (absl::Status status = ReadFully(fd, buf.data(), buf.size(), file_size - buf.size());
+      !status.ok()) {
+    return status;
+  }
+  const uint8_t* in = buf.data();
+  if (LE32(in) != kSkippableFrameMagic || LE32(in + 4) != payload_size) {
+    return absl::DataLossError("Corrupt spool frame index");
+  }
+  if (LE32(in + 8) != kIndexVersion) {
+    return absl::UnimplementedError("Unsupported spool frame index version");
+  }
+  size_t count = LE32(in + 12);
+  if (count != (payload_size - kPayloadHeaderSize - kPayloadFooterSize) / kEntrySize ||
+      count * kEntrySize + kPayloadHeaderSize + kPayloadFooterSize != payload_size) {
+    return absl::DataLossError("Corrupt spool frame index");
+  }
+
+  std::vector<SpoolFrameInfo> frames(count);
+  in += kSkippableHeaderSize + kPayloadHeaderSize;
+  for (SpoolFrameInfo& frame : frames) {
+    frame.offset = LE64(in);
+    frame.length = LE64(in + 8);
+    frame.record_count = LE32(in + 16);
+    frame.flags = LE32(in + 20);
+    frame.min_event_time_ns = static_cast<int64_t>(LE64(in + 24));
+    frame.max_event_time_ns = static_cast<int64_t>(LE64(in + 32));
+    frame.event_types = LE64(in + 40);
+    for (size_t i = 0; i < SpoolFrameInfo::kPidBloomWords; ++i) {
+      frame.pid_bloom[i] = LE64(in + 48 + 8 * i);
+    }
+    in += kEntrySize;
+
+    if (frame.offset + frame.length > file_size - buf.size()) {
+      return absl::DataLossError("Corrupt spool frame index");
+    }
+  }
+  return frames;
+}
+
+}  // namespace fsspool
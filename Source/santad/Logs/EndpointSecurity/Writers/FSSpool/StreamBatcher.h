@@ -15,10 +15,14 @@
 #ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STREAMBATCHER_H
 #define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STREAMBATCHER_H
 
+#include <concepts>
+#include <string>
 #include <vector>
 
+#include "Source/common/BufferPool.h"
 #include "Source/common/SNTXxhash.h"
 #include "Source/common/Unit.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/SpoolFrameIndex.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -30,11 +34,26 @@ namespace fsspool {
 
 static constexpr uint32_t kStreamBatcherMagic = 0x21544E53;
 
+// Compressed streams that can end a frame at any point. Spool files written
+// through them are split into frames of about frame_index_interval
+// uncompressed bytes, which are described by a SpoolFrameIndex stored at the
+// end of the file.
+template <typename T>
+concept FramedOutputStream = requires(T stream) {
+  { stream.EndFrame() } -> std::same_as<bool>;
+  { stream.CompressedByteCount() } -> std::same_as<int64_t>;
+};
+
 template <typename T>
 class StreamBatcher {
  public:
+  static constexpr size_t kDefaultFrameIndexInterval = 256 * 1024;
+
   template <typename F>
-  StreamBatcher(F&& factory) : factory_(std::forward<F>(factory)) {}
+  StreamBatcher(F&& factory,
+                size_t frame_index_interval = kDefaultFrameIndexInterval)
+      : factory_(std::forward<F>(factory)),
+        frame_index_interval_(frame_index_interval) {}
 
   inline bool ShouldInitializeBeforeWrite() { return true; }
 
@@ -46,6 +65,8 @@ class StreamBatcher {
     }
     coded_output_ = std::make_shared<google::protobuf::io::CodedOutputStream>(
         compressed_output_.get());
+    frame_start_ = 0;
+    frame_index_failed_ = false;
     return absl::OkStatus();
   }
 
@@ -69,20 +90,70 @@ class StreamBatcher {
     // intentionally for different types.
     coded_output_->WriteVarint32(static_cast<uint32_t>(bytes.size()));
     coded_output_->WriteRaw(bytes.data(), static_cast<int>(bytes.size()));
+
+    if constexpr (FramedOutputStream<T>) {
+      frame_index_.AddRecord(bytes.data(), bytes.size());
+      if (static_cast<size_t>(coded_output_->ByteCount() - frame_start_) >=
+              frame_index_interval_ &&
+          !EndIndexedFrame()) {
+        santa::BufferPool::Shared().Release(std::move(bytes));
+        return absl::InternalError("Ending compressed frame failed");
+      }
+    }
+
+    santa::BufferPool::Shared().Release(std::move(bytes));
     return absl::OkStatus();
   }
 
   absl::StatusOr<size_t> CompleteBatch(int fd) {
     int bytes_written = coded_output_->ByteCount();
+
+    std::string frame_index;
+    if constexpr (FramedOutputStream<T>) {
+      if (frame_index_.FrameHasRecords()) {
+        EndIndexedFrame();
+      }
+      frame_index = frame_index_.Finish();
+      if (frame_index_failed_) {
+        frame_index.clear();
+      }
+    }
+
     coded_output_.reset();
     compressed_output_.reset();
+
+    // The index follows the last compressed frame.
+    if (!frame_index.empty()) {
+      google::protobuf::io::CodedOutputStream raw_coded(raw_output_.get());
+      raw_coded.WriteRaw(frame_index.data(),
+                         static_cast<int>(frame_index.size()));
+    }
+
     raw_output_.reset();
     return bytes_written;
   }
 
  private:
+  bool EndIndexedFrame() {
+    // Push the records buffered by the coded stream into the frame first.
+    coded_output_->Trim();
+    if (!compressed_output_->EndFrame()) {
+      // Frame boundaries are no longer known, so don't write an index.
+      frame_index_failed_ = true;
+      return false;
+    }
+    frame_index_.EndFrame(compressed_output_->CompressedByteCount());
+    frame_start_ = coded_output_->ByteCount();
+    return true;
+  }
+
   std::function<std::shared_ptr<T>(google::protobuf::io::ZeroCopyOutputStream*)>
       factory_;
+  size_t frame_index_interval_;
+  SpoolFrameIndexBuilder frame_index_;
+  // Uncompressed byte count at the start of the current frame.
+  int64_t frame_start_ = 0;
+  bool frame_index_failed_ = false;
   std::shared_ptr<google::protobuf::io::ZeroCopyOutputStream> raw_output_;
   std::shared_ptr<T> compressed_output_;
   std::shared_ptr<google::protobuf::io::CodedOutputStream> coded_output_;
@@ -126,6 +197,7 @@ class StreamBatcher<::santa::Unit> {
 
     coded_output_->WriteVarint32(static_cast<uint32_t>(bytes.size()));
     coded_output_->WriteRaw(bytes.data(), static_cast<int>(bytes.size()));
+    santa::BufferPool::Shared().Release(std::move(bytes));
     return absl::OkStatus();
   }
 
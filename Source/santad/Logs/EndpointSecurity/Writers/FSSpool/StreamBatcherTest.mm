@@ -15,17 +15,41 @@
 #import <Foundation/Foundation.h>
 #import <XCTest/XCTest.h>
 
+#include <algorithm>
 #include <cstring>
 #include <random>
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
+#include "Source/common/BufferPool.h"
 #import "Source/common/NSData+Zlib.h"
+#include "Source/common/santa.pb.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/SpoolFrameIndex.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/binaryproto.pb.h"
 #include "absl/status/statusor.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "zstd.h"
 
+// Compresses data as a single zstd frame, optionally using a dictionary.
+static std::string ZstdCompress(const std::string& data,
+                                std::shared_ptr<const ::fsspool::ZstdDictionary> dictionary) {
+  std::string compressed;
+  {
+    google::protobuf::io::StringOutputStream raw(&compressed);
+    auto zstd = ::fsspool::ZstdOutputStream::Create(
+        &raw, ZSTD_CLEVEL_DEFAULT, ::fsspool::ZstdOutputStream::kDefaultBufferSize, dictionary);
+    google::protobuf::io::CodedOutputStream coded(zstd.get());
+    coded.WriteRaw(data.data(), static_cast<int>(data.size()));
+  }
+  return compressed;
+}
+
 @interface StreamBatcherTest : XCTestCase
 @property NSFileManager* fileMgr;
 @property NSString* testDir;
@@ -176,4 +200,387 @@
   }
 }
 
+- (void)testWriteReturnsBufferToPool {
+  NSString* path = [NSString stringWithFormat:@"%@/%@", self.testDir, @"pool.bin"];
+  XCTAssertTrue([self.fileMgr createFileAtPath:path contents:nil attributes:nil]);
+  NSFileHandle* handle = [NSFileHandle fileHandleForWritingAtPath:path];
+  XCTAssertNotNil(handle);
+
+  ::fsspool::UncompressedStreamBatcher stream;
+  XCTAssertTrue(stream.InitializeBatch(handle.fileDescriptor).ok());
+
+  santa::BufferPool& pool = santa::BufferPool::Shared();
+  std::vector<uint8_t> buf = pool.Acquire(128);
+  buf.assign(128, 'A');
+  XCTAssertTrue(stream.Write(std::move(buf)).ok());
+
+  // The batcher copied the message into the stream and recycled its storage.
+  uint64_t hits = pool.Hits();
+  std::vector<uint8_t> reused = pool.Acquire(128);
+  XCTAssertEqual(pool.Hits(), hits + 1);
+  XCTAssertTrue(reused.empty());
+
+  XCTAssertTrue(stream.CompleteBatch(handle.fileDescriptor).ok());
+}
+
+- (void)testAnyBatcherMatchesLogBatchEncoding {
+  NSString* path = [NSString stringWithFormat:@"%@/%@", self.testDir, @"any.bin"];
+  XCTAssertTrue([self.fileMgr createFileAtPath:path contents:nil attributes:nil]);
+  NSFileHandle* handle = [NSFileHandle fileHandleForWritingAtPath:path];
+  XCTAssertNotNil(handle);
+
+  ::fsspool::AnyBatcher batcher;
+  santa::fsspool::binaryproto::LogBatch want;
+  XCTAssertFalse(batcher.NeedToOpenFile());
+
+  // Include an empty record and one large enough to need a multi-byte length.
+  for (size_t size : {0, 1, 127, 128, 300, 70000}) {
+    std::vector<uint8_t> bytes(size, static_cast<uint8_t>('a' + size % 26));
+    google::protobuf::Any* any = want.add_records();
+    any->set_type_url(batcher.TypeURL());
+    any->set_value(std::string(bytes.begin(), bytes.end()));
+    XCTAssertTrue(batcher.Write(std::move(bytes)).ok());
+  }
+  XCTAssertTrue(batcher.NeedToOpenFile());
+
+  absl::StatusOr<size_t> size = batcher.CompleteBatch(handle.fileDescriptor);
+  XCTAssertTrue(size.ok());
+  XCTAssertFalse(batcher.NeedToOpenFile());
+  [handle closeFile];
+
+  NSData* got = [NSData dataWithContentsOfFile:path];
+  std::string wantBytes = want.SerializeAsString();
+  XCTAssertEqual(*size, wantBytes.size());
+  XCTAssertEqual(got.length, wantBytes.size());
+  XCTAssertEqual(memcmp(got.bytes, wantBytes.data(), wantBytes.size()), 0);
+
+  santa::fsspool::binaryproto::LogBatch parsed;
+  XCTAssertTrue(parsed.ParseFromArray(got.bytes, (int)got.length));
+  XCTAssertEqual(parsed.records_size(), want.records_size());
+}
+
+- (void)testColumnarBatcher {
+  NSString* path = [NSString stringWithFormat:@"%@/%@", self.testDir, @"columnar.bin"];
+  XCTAssertTrue([self.fileMgr createFileAtPath:path contents:nil attributes:nil]);
+  NSFileHandle* handle = [NSFileHandle fileHandleForWritingAtPath:path];
+  XCTAssertNotNil(handle);
+
+  ::fsspool::ColumnarBatcher batcher;
+  XCTAssertFalse(batcher.NeedToOpenFile());
+
+  // Records of two event types, where only some set machine_id.
+  std::vector<::santa::pb::v1::SantaMessage> execs(3);
+  execs[0].set_machine_id("foo");
+  execs[0].mutable_execution()->set_decision(::santa::pb::v1::Execution::DECISION_ALLOW);
+  execs[1].mutable_event_time()->set_seconds(123);
+  execs[1].mutable_execution();
+  execs[2].set_machine_id("bar");
+  execs[2].mutable_execution();
+  ::santa::pb::v1::SantaMessage fork;
+  fork.set_machine_id("baz");
+  fork.mutable_fork();
+
+  auto write = [&batcher](const ::santa::pb::v1::SantaMessage& msg) {
+    std::string bytes = msg.SerializeAsString();
+    return batcher.Write(std::vector<uint8_t>(bytes.begin(), bytes.end())).ok();
+  };
+  XCTAssertTrue(write(execs[0]));
+  XCTAssertTrue(write(fork));
+  XCTAssertTrue(write(execs[1]));
+  XCTAssertTrue(write(execs[2]));
+  // Records that can't be split into fields are kept as written.
+  XCTAssertTrue(batcher.Write(std::vector<uint8_t>{0xff, 0xff}).ok());
+  XCTAssertTrue(batcher.NeedToOpenFile());
+
+  absl::StatusOr<size_t> size = batcher.CompleteBatch(handle.fileDescriptor);
+  XCTAssertTrue(size.ok());
+  XCTAssertFalse(batcher.NeedToOpenFile());
+  [handle closeFile];
+
+  NSData* got = [NSData dataWithContentsOfFile:path];
+  XCTAssertEqual(got.length, *size);
+  santa::fsspool::binaryproto::ColumnarLogBatch batch;
+  XCTAssertTrue(batch.ParseFromArray(got.bytes, (int)got.length));
+
+  // Groups are ordered by event field number.
+  XCTAssertEqual(batch.groups_size(), 3);
+  XCTAssertEqual(batch.groups(0).event_field_number(), 0);
+  XCTAssertEqual(batch.groups(1).event_field_number(),
+                 ::santa::pb::v1::SantaMessage::kExecutionFieldNumber);
+  XCTAssertEqual(batch.groups(2).event_field_number(),
+                 ::santa::pb::v1::SantaMessage::kForkFieldNumber);
+
+  const auto& unparsed = batch.groups(0);
+  XCTAssertEqual(unparsed.record_count(), 1);
+  XCTAssertEqual(unparsed.columns_size(), 1);
+  XCTAssertTrue(unparsed.columns(0).data() == std::string("\xff\xff"));
+
+  // Each group's columns reassemble into the original records.
+  auto reassemble = [](const santa::fsspool::binaryproto::ColumnarRecordGroup& group) {
+    std::vector<std::string> records(group.record_count());
+    for (const auto& column : group.columns()) {
+      XCTAssertEqual(column.lengths_size(), group.record_count());
+      size_t offset = 0;
+      for (int i = 0; i < column.lengths_size(); ++i) {
+        records[i].append(column.data(), offset, column.lengths(i));
+        offset += column.lengths(i);
+      }
+      XCTAssertEqual(offset, column.data().size());
+    }
+    return records;
+  };
+
+  const auto& execGroup = batch.groups(1);
+  XCTAssertEqual(execGroup.record_count(), 3);
+  // machine_id, event_time and execution.
+  XCTAssertEqual(execGroup.columns_size(), 3);
+  std::vector<std::string> execRecords = reassemble(execGroup);
+  for (size_t i = 0; i < execs.size(); ++i) {
+    ::santa::pb::v1::SantaMessage parsed;
+    XCTAssertTrue(parsed.ParseFromString(execRecords[i]));
+    XCTAssertTrue(parsed.SerializeAsString() == execs[i].SerializeAsString());
+  }
+
+  std::vector<std::string> forkRecords = reassemble(batch.groups(2));
+  XCTAssertEqual(forkRecords.size(), 1);
+  ::santa::pb::v1::SantaMessage parsedFork;
+  XCTAssertTrue(parsedFork.ParseFromString(forkRecords[0]));
+  XCTAssertTrue(parsedFork.SerializeAsString() == fork.SerializeAsString());
+}
+
+- (void)testZstdDictionary {
+  // A handful of small, similar records, like typical telemetry.
+  std::string records;
+  for (int i = 0; i < 8; i++) {
+    records += "/Applications/Santa.app/Contents/MacOS/Santa";
+    records += "platform:com.apple.santa EQHXZ8M8AV ";
+    records += std::to_string(i);
+  }
+
+  std::string dictBytes;
+  for (int i = 0; i < 4; i++) {
+    dictBytes += "/Applications/Santa.app/Contents/MacOS/Santa";
+    dictBytes += "platform:com.apple.santa EQHXZ8M8AV ";
+  }
+  auto dictionary = std::make_shared<const ::fsspool::ZstdDictionary>(dictBytes);
+  // Raw content dictionaries have no ID.
+  XCTAssertEqual(dictionary->id(), 0);
+
+  std::string withoutDict = ZstdCompress(records, nullptr);
+  std::string withDict = ZstdCompress(records, dictionary);
+  XCTAssertLessThan(withDict.size(), withoutDict.size());
+
+  std::vector<char> decompressed(records.size() * 2);
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  size_t size =
+      ZSTD_decompress_usingDict(dctx, decompressed.data(), decompressed.size(), withDict.data(),
+                                withDict.size(), dictBytes.data(), dictBytes.size());
+  ZSTD_freeDCtx(dctx);
+  XCTAssertFalse(ZSTD_isError(size), "Decompression error: %s", ZSTD_getErrorName(size));
+  XCTAssertTrue(std::string(decompressed.data(), size) == records);
+}
+
+- (void)testZstdDictionaryLoad {
+  NSString* path = [NSString stringWithFormat:@"%@/zstd.dict", self.testDir];
+
+  XCTAssertFalse(::fsspool::ZstdDictionary::Load(path.UTF8String).ok());
+
+  XCTAssertTrue([self.fileMgr createFileAtPath:path contents:[NSData data] attributes:nil]);
+  XCTAssertFalse(::fsspool::ZstdDictionary::Load(path.UTF8String).ok());
+
+  XCTAssertTrue([[@"some dictionary content" dataUsingEncoding:NSUTF8StringEncoding]
+      writeToFile:path
+       atomically:YES]);
+  auto dictionary = ::fsspool::ZstdDictionary::Load(path.UTF8String);
+  XCTAssertTrue(dictionary.ok());
+  XCTAssertTrue((*dictionary)->bytes() == "some dictionary content");
+}
+
+- (void)testRecompressZstdFiles {
+  std::string dictBytes = "/Applications/Santa.app/Contents/MacOS/Santa EQHXZ8M8AV ";
+  auto dictionary = std::make_shared<const ::fsspool::ZstdDictionary>(dictBytes);
+
+  std::string want;
+  std::vector<std::string> paths;
+  for (int i = 0; i < 3; i++) {
+    std::string records;
+    for (int j = 0; j < 1000; j++) {
+      records += dictBytes + std::to_string(i * 1000 + j);
+    }
+    want += records;
+
+    std::string compressed = ZstdCompress(records, dictionary);
+    NSString* path = [NSString stringWithFormat:@"%@/in-%d.zst", self.testDir, i];
+    XCTAssertTrue([[NSData dataWithBytes:compressed.data()
+                                  length:compressed.size()] writeToFile:path
+                                                             atomically:YES]);
+    paths.push_back(path.UTF8String);
+  }
+
+  NSString* outPath = [NSString stringWithFormat:@"%@/out.zst", self.testDir];
+  XCTAssertTrue([self.fileMgr createFileAtPath:outPath contents:nil attributes:nil]);
+  NSFileHandle* outHandle = [NSFileHandle fileHandleForWritingAtPath:outPath];
+  absl::Status status =
+      ::fsspool::RecompressZstdFiles(paths, outHandle.fileDescriptor, 19, dictionary);
+  [outHandle closeFile];
+  XCTAssertTrue(status.ok(), "%s", status.ToString().c_str());
+
+  // The output is a single stream holding every input's records, in order.
+  NSData* merged = [NSData dataWithContentsOfFile:outPath];
+  std::vector<char> decompressed(want.size() * 2);
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  size_t size = ZSTD_decompress_usingDict(dctx, decompressed.data(), decompressed.size(),
+                                          merged.bytes, merged.length, dictBytes.data(),
+                                          dictBytes.size());
+  ZSTD_freeDCtx(dctx);
+  XCTAssertFalse(ZSTD_isError(size), "Decompression error: %s", ZSTD_getErrorName(size));
+  XCTAssertTrue(std::string(decompressed.data(), size) == want);
+
+  // Inputs that aren't zstd are rejected.
+  XCTAssertTrue([[@"not zstd" dataUsingEncoding:NSUTF8StringEncoding]
+      writeToFile:[NSString stringWithUTF8String:paths[1].c_str()]
+       atomically:YES]);
+  outHandle = [NSFileHandle fileHandleForWritingAtPath:outPath];
+  XCTAssertFalse(
+      ::fsspool::RecompressZstdFiles(paths, outHandle.fileDescriptor, 19, dictionary).ok());
+  [outHandle closeFile];
+}
+
+- (void)testZstdFrameIndex {
+  using ::santa::pb::v1::SantaMessage;
+  static constexpr int kRecords = 500;
+  static constexpr int64_t kFirstEventTime = 1000;
+  static constexpr int64_t kNanosPerSecond = 1000000000;
+
+  NSString* path = [NSString stringWithFormat:@"%@/%@", self.testDir, @"indexed.zst"];
+  XCTAssertTrue([self.fileMgr createFileAtPath:path contents:nil attributes:nil]);
+  NSFileHandle* handle = [NSFileHandle fileHandleForWritingAtPath:path];
+
+  // Use small frames so that the records span many of them.
+  ::fsspool::ZstdStreamBatcher zstdStream(
+      ^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
+        return ::fsspool::ZstdOutputStream::Create(raw_stream);
+      },
+      4096);
+  XCTAssertTrue(zstdStream.InitializeBatch(handle.fileDescriptor).ok());
+
+  auto write = [&](const SantaMessage& msg) {
+    std::string bytes = msg.SerializeAsString();
+    XCTAssertTrue(zstdStream.Write(std::vector<uint8_t>(bytes.begin(), bytes.end())).ok());
+  };
+
+  for (int i = 0; i < kRecords; i++) {
+    SantaMessage msg;
+    msg.mutable_event_time()->set_seconds(kFirstEventTime + i);
+    msg.set_event_id(std::string(128, 'a' + (i % 26)));
+    if (i % 2 == 0) {
+      msg.mutable_execution()->mutable_instigator()->mutable_id()->set_pid(100 + i);
+    } else {
+      msg.mutable_fork()->mutable_instigator()->mutable_id()->set_pid(100 + i);
+    }
+    write(msg);
+  }
+
+  // A record with neither an event time nor an instigator.
+  SantaMessage disk;
+  disk.mutable_disk()->set_mount("/Volumes/Foo");
+  write(disk);
+
+  absl::StatusOr<size_t> size = zstdStream.CompleteBatch(handle.fileDescriptor);
+  XCTAssertTrue(size.ok());
+  [handle closeFile];
+
+  int fd = open(path.UTF8String, O_RDONLY);
+  XCTAssertGreaterThanOrEqual(fd, 0);
+  absl::StatusOr<std::vector<::fsspool::SpoolFrameInfo>> frames =
+      ::fsspool::ReadSpoolFrameIndex(fd);
+  close(fd);
+  XCTAssertTrue(frames.ok(), "%s", frames.status().ToString().c_str());
+  XCTAssertGreaterThan(frames->size(), 10);
+
+  // Frames are contiguous from the start of the file, and each decompresses
+  // on its own.
+  NSData* data = [NSData dataWithContentsOfFile:path];
+  const uint8_t* bytes = static_cast<const uint8_t*>(data.bytes);
+  std::vector<uint8_t> decompressed(*size * 2);
+  uint64_t offset = 0;
+  uint32_t records = 0;
+  for (const ::fsspool::SpoolFrameInfo& frame : *frames) {
+    XCTAssertEqual(frame.offset, offset);
+    offset += frame.length;
+    records += frame.record_count;
+
+    size_t frameSize = ZSTD_decompress(decompressed.data(), decompressed.size(),
+                                       bytes + frame.offset, frame.length);
+    XCTAssertFalse(ZSTD_isError(frameSize), "%s", ZSTD_getErrorName(frameSize));
+    XCTAssertGreaterThan(frameSize, 0);
+  }
+  XCTAssertEqual(records, kRecords + 1);
+
+  // The index is skipped when decompressing the whole file.
+  size_t total = ZSTD_decompress(decompressed.data(), decompressed.size(), data.bytes, data.length);
+  XCTAssertFalse(ZSTD_isError(total), "%s", ZSTD_getErrorName(total));
+  XCTAssertEqual(total, *size);
+
+  const ::fsspool::SpoolFrameInfo& first = frames->front();
+  XCTAssertTrue(first.MayContainPid(100));
+  XCTAssertTrue(first.MayContainEventsBetween(kFirstEventTime * kNanosPerSecond,
+                                              kFirstEventTime * kNanosPerSecond));
+  XCTAssertFalse(first.MayContainEventsBetween((kFirstEventTime + kRecords) * kNanosPerSecond,
+                                               INT64_MAX));
+  XCTAssertTrue(first.MayContainEventType(SantaMessage::kExecutionFieldNumber));
+  XCTAssertTrue(first.MayContainEventType(SantaMessage::kForkFieldNumber));
+  XCTAssertFalse(first.MayContainEventType(SantaMessage::kCloseFieldNumber));
+  XCTAssertEqual(first.flags, 0);
+
+  // Only a few frames can hold any one pid.
+  size_t framesWithPid = std::count_if(
+      frames->begin(), frames->end(),
+      [](const ::fsspool::SpoolFrameInfo& frame) { return frame.MayContainPid(100); });
+  XCTAssertLessThan(framesWithPid, 3);
+
+  // The last frame can hold anything, since it has a record without a time
+  // or pid.
+  const ::fsspool::SpoolFrameInfo& last = frames->back();
+  XCTAssertTrue(last.MayContainPid(100));
+  XCTAssertTrue(last.MayContainEventsBetween(0, 0));
+  XCTAssertTrue(last.MayContainEventType(SantaMessage::kDiskFieldNumber));
+
+  // Files without an index are reported as such.
+  NSString* plainPath = [NSString stringWithFormat:@"%@/%@", self.testDir, @"plain.zst"];
+  std::string plain = ZstdCompress("not indexed", nullptr);
+  XCTAssertTrue([[NSData dataWithBytes:plain.data() length:plain.size()] writeToFile:plainPath
+                                                                          atomically:YES]);
+  fd = open(plainPath.UTF8String, O_RDONLY);
+  XCTAssertTrue(absl::IsNotFound(::fsspool::ReadSpoolFrameIndex(fd).status()));
+  close(fd);
+}
+
+- (void)testAdaptiveZstdLevel {
+  static constexpr size_t kThreshold = ::fsspool::AdaptiveZstdLevel::kBacklogThreshold;
+  ::fsspool::AdaptiveZstdLevel level(5, 1);
+
+  // Without a backlog source the preferred level is used.
+  XCTAssertEqual(level.Level(), 5);
+
+  XCTAssertEqual(level.LevelForBacklog(0), 5);
+  XCTAssertEqual(level.LevelForBacklog(kThreshold), 5);
+  XCTAssertEqual(level.LevelForBacklog(kThreshold + 1), 4);
+  XCTAssertEqual(level.LevelForBacklog(kThreshold * 2), 4);
+  XCTAssertEqual(level.LevelForBacklog(kThreshold * 2 + 1), 3);
+  XCTAssertEqual(level.LevelForBacklog(kThreshold * 8 + 1), 1);
+  // Never backs off below the minimum.
+  XCTAssertEqual(level.LevelForBacklog(SIZE_MAX), 1);
+
+  size_t backlog = 0;
+  level.SetBacklogSource([&backlog] {
+    return backlog;
+  });
+  XCTAssertEqual(level.Level(), 5);
+  backlog = kThreshold * 4;
+  XCTAssertEqual(level.Level(), 3);
+  backlog = 0;
+  XCTAssertEqual(level.Level(), 5);
+}
+
 @end
@@ -15,12 +15,75 @@
 #ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDOUTPUTSTREAM_H
 #define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDOUTPUTSTREAM_H
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/stubs/common.h"
 #include "zstd.h"
 
 namespace fsspool {
 
+// A zstd dictionary used to prime compression of every spool file. Telemetry
+// records are small and share many strings (paths, signing IDs, team IDs), so
+// a dictionary trained on representative records substantially improves the
+// compression ratio of small batches.
+//
+// Consumers need the same dictionary to decompress. Frames record the
+// dictionary's ID, which consumers can use to select it.
+class ZstdDictionary {
+ public:
+  // Reads a dictionary, as produced by `zstd --train`, from path.
+  static absl::StatusOr<std::shared_ptr<const ZstdDictionary>> Load(
+      const std::string& path);
+
+  explicit ZstdDictionary(std::string bytes);
+
+  const std::string& bytes() const { return bytes_; }
+
+  // The ID stored in the dictionary header, or 0 for raw content
+  // dictionaries.
+  unsigned id() const { return id_; }
+
+ private:
+  std::string bytes_;
+  unsigned id_;
+};
+
+// Picks the compression level for each new spool file from the writer's
+// backlog, so that compression backs off when events are queued faster than
+// they can be compressed and recovers once the backlog drains.
+//
+// The level starts at max_level and drops by one for each doubling of the
+// backlog beyond kBacklogThreshold, down to min_level.
+class AdaptiveZstdLevel {
+ public:
+  static constexpr size_t kBacklogThreshold = 256;
+
+  AdaptiveZstdLevel(int max_level, int min_level);
+
+  // Sets the function reporting the number of writes waiting to be
+  // processed. Until set, max_level is always used.
+  void SetBacklogSource(std::function<size_t()> backlog);
+
+  int Level() const;
+
+  // Returns the level to use for the given backlog.
+  int LevelForBacklog(size_t backlog) const;
+
+ private:
+  const int max_level_;
+  const int min_level_;
+  mutable absl::Mutex mtx_;
+  std::function<size_t()> backlog_ ABSL_GUARDED_BY(mtx_);
+};
+
 class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
  public:
   // Matches the Gzip default buffer size
@@ -29,11 +92,13 @@ class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
   static std::unique_ptr<ZstdOutputStream> Create(
       google::protobuf::io::ZeroCopyOutputStream* output,
       int compression_level = ZSTD_CLEVEL_DEFAULT,
-      size_t buffer_size = kDefaultBufferSize);
+      size_t buffer_size = kDefaultBufferSize,
+      std::shared_ptr<const ZstdDictionary> dictionary = nullptr);
 
   ZstdOutputStream(google::protobuf::io::ZeroCopyOutputStream* output,
                    ZSTD_CStream* cstream,
-                   size_t buffer_size = kDefaultBufferSize);
+                   size_t buffer_size = kDefaultBufferSize,
+                   std::shared_ptr<const ZstdDictionary> dictionary = nullptr);
 
   ~ZstdOutputStream();
 
@@ -42,12 +107,21 @@ class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
   void BackUp(int count) override;
   int64_t ByteCount() const override;
 
+  // Compresses everything written so far and ends the current frame, so the
+  // data written next starts a new frame that can be decompressed on its own.
+  bool EndFrame();
+
+  // Number of compressed bytes passed to the underlying stream.
+  int64_t CompressedByteCount() const { return compressed_byte_count_; }
+
  private:
   bool CompressAndFlush(ZSTD_EndDirective end_directive);
   bool FlushOutput(size_t bytes_to_write);
 
   google::protobuf::io::ZeroCopyOutputStream* output_;
   ZSTD_CStream* cstream_;
+  // Referenced by cstream_, so must outlive it.
+  std::shared_ptr<const ZstdDictionary> dictionary_;
 
   // Input buffer for uncompressed data
   std::vector<uint8_t> input_buffer_;
@@ -58,8 +132,21 @@ class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
   std::vector<uint8_t> output_buffer_;
 
   int64_t byte_count_;
+  int64_t compressed_byte_count_;
+  // Whether anything was written since the last frame ended. Starts true so
+  // that an empty stream is still a valid zstd frame.
+  bool frame_pending_;
 };
 
+// Decompresses each of input_paths in turn and compresses their combined
+// contents as a single stream to output_fd, which remains open. Inputs must be
+// zstd streams primed with dictionary, if any, and the output is primed with it
+// too.
+absl::Status RecompressZstdFiles(
+    const std::vector<std::string>& input_paths, int output_fd,
+    int compression_level,
+    std::shared_ptr<const ZstdDictionary> dictionary = nullptr);
+
 }  // namespace fsspool
 
 #endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDOUTPUTSTREAM_H
@@ -14,40 +14,110 @@
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
 
 namespace fsspool {
 
+absl::StatusOr<std::shared_ptr<const ZstdDictionary>> ZstdDictionary::Load(
+    const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return absl::NotFoundError("Unable to open zstd dictionary");
+  }
+
+  std::string bytes((std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>());
+  if (file.bad()) {
+    return absl::InternalError("Unable to read zstd dictionary");
+  }
+  if (bytes.empty()) {
+    return absl::InvalidArgumentError("Empty zstd dictionary");
+  }
+
+  return std::make_shared<const ZstdDictionary>(std::move(bytes));
+}
+
+ZstdDictionary::ZstdDictionary(std::string bytes)
+    : bytes_(std::move(bytes)), id_(ZSTD_getDictID_fromDict(bytes_.data(), bytes_.size())) {}
+
+AdaptiveZstdLevel::AdaptiveZstdLevel(int max_level, int min_level)
+    : max_level_(max_level), min_level_(std::min(min_level, max_level)) {}
+
+void AdaptiveZstdLevel::SetBacklogSource(std::function<size_t()> backlog) {
+  absl::MutexLock lock(&mtx_);
+  backlog_ = std::move(backlog);
+}
+
+int AdaptiveZstdLevel::Level() const {
+  size_t backlog = 0;
+  {
+    absl::MutexLock lock(&mtx_);
+    if (backlog_) {
+      backlog = backlog_();
+    }
+  }
+  return LevelForBacklog(backlog);
+}
+
+int AdaptiveZstdLevel::LevelForBacklog(size_t backlog) const {
+  int level = max_level_;
+  for (size_t threshold = kBacklogThreshold; backlog > threshold && level > min_level_;
+       threshold *= 2) {
+    level--;
+  }
+  return level;
+}
+
 std::unique_ptr<ZstdOutputStream> ZstdOutputStream::Create(
-    google::protobuf::io::ZeroCopyOutputStream* output, int compression_level, size_t buffer_size) {
+    google::protobuf::io::ZeroCopyOutputStream* output, int compression_level, size_t buffer_size,
+    std::shared_ptr<const ZstdDictionary> dictionary) {
   ZSTD_CStream* cstream = ZSTD_createCStream();
   if (!cstream) {
     return nullptr;
   }
 
-  size_t result = ZSTD_initCStream(cstream, compression_level);
+  size_t result = ZSTD_CCtx_setParameter(cstream, ZSTD_c_compressionLevel, compression_level);
+  if (!ZSTD_isError(result) && dictionary) {
+    // Avoid copying the dictionary into every stream. The stream keeps a
+    // reference to it for as long as the dictionary is in use.
+    result = ZSTD_CCtx_loadDictionary_byReference(cstream, dictionary->bytes().data(),
+                                                  dictionary->bytes().size());
+  }
   if (ZSTD_isError(result)) {
     ZSTD_freeCStream(cstream);
     return nullptr;
   }
 
-  return std::make_unique<ZstdOutputStream>(output, cstream, buffer_size);
+  return std::make_unique<ZstdOutputStream>(output, cstream, buffer_size, std::move(dictionary));
 }
 
 ZstdOutputStream::ZstdOutputStream(google::protobuf::io::ZeroCopyOutputStream* output,
-                                   ZSTD_CStream* cstream, size_t buffer_size)
+                                   ZSTD_CStream* cstream, size_t buffer_size,
+                                   std::shared_ptr<const ZstdDictionary> dictionary)
     : output_(output),
       cstream_(cstream),
+      dictionary_(std::move(dictionary)),
       input_buffer_(buffer_size),
       input_position_(0),
       input_available_(0),
       output_buffer_(buffer_size),
-      byte_count_(0) {}
+      byte_count_(0),
+      compressed_byte_count_(0),
+      frame_pending_(true) {}
 
 ZstdOutputStream::~ZstdOutputStream() {
-  CompressAndFlush(ZSTD_e_end);
+  if (frame_pending_ || input_available_ > 0) {
+    CompressAndFlush(ZSTD_e_end);
+  }
   ZSTD_freeCStream(cstream_);
 }
 
@@ -66,6 +136,7 @@ bool ZstdOutputStream::Next(void** data, int* size) {
   input_position_ = 0;
   input_available_ = input_buffer_.size();
   byte_count_ += input_buffer_.size();
+  frame_pending_ = true;
 
   return true;
 }
@@ -83,6 +154,14 @@ int64_t ZstdOutputStream::ByteCount() const {
   return byte_count_;
 }
 
+bool ZstdOutputStream::EndFrame() {
+  if (!CompressAndFlush(ZSTD_e_end)) {
+    return false;
+  }
+  frame_pending_ = false;
+  return true;
+}
+
 bool ZstdOutputStream::CompressAndFlush(ZSTD_EndDirective end_directive) {
   ZSTD_inBuffer input = {
       .src = input_buffer_.data(),
@@ -143,9 +222,83 @@ bool ZstdOutputStream::FlushOutput(size_t bytes_to_write) {
 
     data += to_write;
     remaining -= to_write;
+    compressed_byte_count_ += to_write;
   }
 
   return true;
 }
 
+absl::Status RecompressZstdFiles(const std::vector<std::string>& input_paths, int output_fd,
+                                 int compression_level,
+                                 std::shared_ptr<const ZstdDictionary> dictionary) {
+  std::unique_ptr<ZSTD_DStream, decltype(&ZSTD_freeDStream)> dstream(ZSTD_createDStream(),
+                                                                      &ZSTD_freeDStream);
+  if (!dstream) {
+    return absl::InternalError("Unable to create zstd decompression stream");
+  }
+  if (dictionary) {
+    size_t result = ZSTD_DCtx_loadDictionary_byReference(
+        dstream.get(), dictionary->bytes().data(), dictionary->bytes().size());
+    if (ZSTD_isError(result)) {
+      return absl::InternalError("Unable to load zstd dictionary for decompression");
+    }
+  }
+
+  google::protobuf::io::FileOutputStream raw_output(output_fd);
+  {
+    std::unique_ptr<ZstdOutputStream> output = ZstdOutputStream::Create(
+        &raw_output, compression_level, ZstdOutputStream::kDefaultBufferSize, dictionary);
+    if (!output) {
+      return absl::InternalError("Unable to create zstd compression stream");
+    }
+
+    std::vector<char> input_buffer(ZSTD_DStreamInSize());
+    for (const std::string& path : input_paths) {
+      std::ifstream file(path, std::ios::binary);
+      if (!file) {
+        return absl::NotFoundError("Unable to open zstd file to recompress");
+      }
+
+      ZSTD_DCtx_reset(dstream.get(), ZSTD_reset_session_only);
+      size_t frame_remaining = 0;
+      while (file) {
+        file.read(input_buffer.data(), input_buffer.size());
+        ZSTD_inBuffer input = {
+            .src = input_buffer.data(),
+            .size = static_cast<size_t>(file.gcount()),
+            .pos = 0,
+        };
+
+        // Decompress straight into the compressor's input buffer. Keep going while the buffer
+        // fills, since the decompressor may hold more output than fit.
+        ZSTD_outBuffer decompressed;
+        do {
+          void* data;
+          int size;
+          if (!output->Next(&data, &size)) {
+            return absl::InternalError("Failed to write recompressed data");
+          }
+          decompressed = {.dst = data, .size = static_cast<size_t>(size), .pos = 0};
+          frame_remaining = ZSTD_decompressStream(dstream.get(), &decompressed, &input);
+          output->BackUp(static_cast<int>(decompressed.size - decompressed.pos));
+          if (ZSTD_isError(frame_remaining)) {
+            return absl::DataLossError("Corrupt zstd file");
+          }
+        } while (input.pos < input.size || decompressed.pos == decompressed.size);
+      }
+      if (file.bad()) {
+        return absl::InternalError("Failed to read zstd file to recompress");
+      }
+      if (frame_remaining != 0) {
+        return absl::DataLossError("Truncated zstd file");
+      }
+    }
+  }
+
+  if (!raw_output.Flush()) {
+    return absl::ErrnoToStatus(raw_output.GetErrno(), "Failed to write recompressed file");
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace fsspool
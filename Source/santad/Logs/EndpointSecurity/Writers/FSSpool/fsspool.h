@@ -24,13 +24,17 @@
 
 #include <algorithm>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool_platform_specific.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/random/random.h"
 #include "absl/status/status.h"
@@ -39,6 +43,8 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 
 // Forward declarations
@@ -49,6 +55,128 @@ class FsSpoolWriterPeer;
 
 namespace fsspool {
 
+// In-memory index of the files in a spool directory and their on-disk sizes,
+// so the size of the spool is known without rescanning the directory. The
+// writers and reader of a spool directory within a process should share one
+// index, which keeps it exact: writers record each file they complete or
+// evict and the reader each file it deletes.
+//
+// Changes made by anything else (e.g. files removed by an administrator) are
+// picked up by rescanning the directory once reconcile_interval has passed
+// since the last scan. The directory is first scanned when the index is first
+// used.
+//
+// This class is thread-safe.
+class SpoolIndex {
+ public:
+  static constexpr absl::Duration kDefaultReconcileInterval = absl::Minutes(10);
+
+  explicit SpoolIndex(
+      std::string spool_dir,
+      absl::Duration reconcile_interval = kDefaultReconcileInterval)
+      : spool_dir_(std::move(spool_dir)),
+        reconcile_interval_(reconcile_interval) {}
+
+  SpoolIndex(const SpoolIndex&) = delete;
+  SpoolIndex& operator=(const SpoolIndex&) = delete;
+
+  // Returns the summed on-disk size of the spool files, rescanning the
+  // directory first when reconciliation is due.
+  absl::StatusOr<size_t> TotalSize() {
+    absl::MutexLock lock(&mtx_);
+    if (absl::Status status = ReconcileIfNeededLocked(); !status.ok()) {
+      return status;
+    }
+    return total_;
+  }
+
+  // Rescans the spool directory, replacing the contents of the index.
+  absl::Status Reconcile() {
+    absl::MutexLock lock(&mtx_);
+    return ReconcileLocked();
+  }
+
+  // Records a new spool file. Replaces any existing entry for the same path.
+  void Add(DirEntryInfo file) {
+    absl::MutexLock lock(&mtx_);
+    RemoveLocked(file.path);
+    total_ += file.occupancy;
+    std::string path = file.path;
+    files_.emplace(std::move(path), std::move(file));
+  }
+
+  // Forgets a spool file. Unknown paths are ignored.
+  void Remove(const std::string& path) {
+    absl::MutexLock lock(&mtx_);
+    RemoveLocked(path);
+  }
+
+  // Returns the indexed files, oldest first, rescanning the directory first
+  // when reconciliation is due.
+  absl::StatusOr<std::vector<DirEntryInfo>> FilesOldestFirst() {
+    std::vector<DirEntryInfo> files;
+    {
+      absl::MutexLock lock(&mtx_);
+      if (absl::Status status = ReconcileIfNeededLocked(); !status.ok()) {
+        return status;
+      }
+      files.reserve(files_.size());
+      for (const auto& [path, file] : files_) {
+        files.push_back(file);
+      }
+    }
+
+    std::sort(files.begin(), files.end(),
+              [](const DirEntryInfo& a, const DirEntryInfo& b) {
+                return a.mtime != b.mtime ? a.mtime < b.mtime : a.path < b.path;
+              });
+    return files;
+  }
+
+ private:
+  absl::Status ReconcileIfNeededLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mtx_) {
+    if (last_reconcile_.has_value() &&
+        absl::Now() - *last_reconcile_ < reconcile_interval_) {
+      return absl::OkStatus();
+    }
+    return ReconcileLocked();
+  }
+
+  absl::Status ReconcileLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mtx_) {
+    std::vector<DirEntryInfo> files;
+    absl::StatusOr<size_t> total = BulkStatRegularFiles(spool_dir_, &files);
+    if (!total.ok()) {
+      return total.status();
+    }
+
+    files_.clear();
+    for (DirEntryInfo& file : files) {
+      std::string path = file.path;
+      files_.emplace(std::move(path), std::move(file));
+    }
+    total_ = *total;
+    last_reconcile_ = absl::Now();
+    return absl::OkStatus();
+  }
+
+  void RemoveLocked(const std::string& path)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mtx_) {
+    auto it = files_.find(path);
+    if (it == files_.end()) {
+      return;
+    }
+    total_ -= std::min(total_, it->second.occupancy);
+    files_.erase(it);
+  }
+
+  const std::string spool_dir_;
+  const absl::Duration reconcile_interval_;
+  absl::Mutex mtx_;
+  absl::flat_hash_map<std::string, DirEntryInfo> files_ ABSL_GUARDED_BY(mtx_);
+  size_t total_ ABSL_GUARDED_BY(mtx_) = 0;
+  std::optional<absl::Time> last_reconcile_ ABSL_GUARDED_BY(mtx_);
+};
+
 template <typename T>
 concept BatcherInterface =
     (std::default_initializable<T> || requires {
@@ -61,6 +189,31 @@ concept BatcherInterface =
       { batcher.CompleteBatch(fd) } -> std::same_as<absl::StatusOr<size_t>>;
     };
 
+// How hard FsSpoolWriter works to get completed spool files onto stable
+// storage.
+enum class Durability {
+  // Completed files are left in the page cache for the OS to write back. A
+  // power loss can lose or truncate recently completed files.
+  kNone,
+  // Each completed file is flushed to stable storage before it's renamed into
+  // the spool directory, so a file found there after a power loss is complete.
+  kBatch,
+  // As kBatch, and the spool directory is flushed after each rename, so a
+  // completed file is also never lost.
+  kStrict,
+};
+
+// What a writer flushed to stable storage.
+enum class SyncTarget {
+  kFile,
+  kDirectory,
+};
+
+// Invoked after each flush to stable storage with what was flushed, how long
+// it took and whether it succeeded.
+using SyncCallback =
+    std::function<void(SyncTarget, absl::Duration, const absl::Status&)>;
+
 // Enqueues messages into the spool. Multiple concurrent writers can
 // write to the same directory. (Note that this class is only thread-compatible
 // and not thread-safe though!)
@@ -74,8 +227,11 @@ class FsSpoolWriter {
   // erased whenever the spool exceeds its size limit and the oldest files are
   // evicted to make room. Used to surface an eviction metric without coupling
   // this generic spool library to a particular metrics implementation.
+  // `spool_index`, when set, is shared with the other writers and the reader of
+  // the same directory; otherwise this writer keeps its own index.
   FsSpoolWriter(T batcher, absl::string_view base_dir, size_t max_spool_size,
-                std::function<void(size_t)> eviction_callback = nullptr)
+                std::function<void(size_t)> eviction_callback = nullptr,
+                std::shared_ptr<SpoolIndex> spool_index = nullptr)
       : batcher_(std::move(batcher)),
         base_dir_(base_dir),
         spool_dir_(SpoolNewDirectory(base_dir)),
@@ -87,9 +243,8 @@ class FsSpoolWriter {
             "%016x",
             absl::Uniform<uint64_t>(absl::BitGen(), 0,
                                     std::numeric_limits<uint64_t>::max()))),
-        // Guess that the spool is full during construction, so we will
-        // recompute the actual spool size on the first write.
-        spool_size_estimate_(max_spool_size + 1) {
+        spool_index_(spool_index ? std::move(spool_index)
+                                 : std::make_shared<SpoolIndex>(spool_dir_)) {
     (void)IterateDirectory(
         tmp_dir_, [this](const std::string& file_name, bool* stop) {
           if (file_name == std::string(".") || file_name == std::string("..")) {
@@ -107,35 +262,40 @@ class FsSpoolWriter {
 
   ~FsSpoolWriter() { (void)Flush(); };
 
+  // Applies to spool files completed from now on. `sync_callback`, when set,
+  // is invoked after each flush to stable storage.
+  void SetDurability(Durability durability,
+                     SyncCallback sync_callback = nullptr) {
+    durability_ = durability;
+    sync_callback_ = std::move(sync_callback);
+  }
+
   absl::Status SpaceAvailable() {
-    if (spool_size_estimate_ <= max_spool_size_) {
+    absl::StatusOr<size_t> size = spool_index_->TotalSize();
+    if (!size.ok()) {
+      return size.status();  // failed to compute spool size
+    }
+    if (*size <= max_spool_size_) {
       return absl::OkStatus();
     }
 
-    // Recompute the spool size with a single directory walk, also collecting
-    // per-file metadata so eviction (below) can reuse it instead of walking and
-    // stat()ing every file a second time.
-    std::vector<DirEntryInfo> files;
-    absl::StatusOr<size_t> estimate = EstimateSpoolDirSize(&files);
-    if (!estimate.ok()) {
-      return estimate.status();  // failed to recompute spool size
-    }
-    spool_size_estimate_ = *estimate;
-
-    if (spool_size_estimate_ > max_spool_size_) {
-      // Over the limit: rather than dropping all new telemetry, erase the
-      // oldest spool files to make room. This keeps the freshest data flowing
-      // (and lets signal processing continue) at the cost of the oldest,
-      // not-yet-exported files. Updates spool_size_estimate_ to the
-      // post-eviction total.
-      EvictOldestSpoolFiles(files, *estimate);
-
-      // If eviction couldn't free enough space (e.g. unlinks failing on a
-      // read-only remount or immutable files), keep the spool bounded by
-      // refusing the write rather than letting it grow without limit.
-      if (spool_size_estimate_ > max_spool_size_) {
-        return absl::ResourceExhaustedError("No space left in spool directory");
-      }
+    // Over the limit: rather than dropping all new telemetry, erase the
+    // oldest spool files to make room. This keeps the freshest data flowing
+    // (and lets signal processing continue) at the cost of the oldest,
+    // not-yet-exported files.
+    if (absl::Status status = EvictOldestSpoolFiles(); !status.ok()) {
+      return status;
+    }
+
+    // If eviction couldn't free enough space (e.g. unlinks failing on a
+    // read-only remount or immutable files), keep the spool bounded by
+    // refusing the write rather than letting it grow without limit.
+    size = spool_index_->TotalSize();
+    if (!size.ok()) {
+      return size.status();
+    }
+    if (*size > max_spool_size_) {
+      return absl::ResourceExhaustedError("No space left in spool directory");
     }
 
     return absl::OkStatus();
@@ -185,6 +345,22 @@ class FsSpoolWriter {
 
     absl::StatusOr<size_t> size_estimate =
         batcher_.CompleteBatch(current_spool_state_.tmp_fd);
+    DirEntryInfo file = {
+        .path = current_spool_state_.spool_file,
+        .mtime = time(nullptr),
+        .occupancy = 0,
+    };
+    if (size_estimate.ok()) {
+      file.occupancy = OnDiskSize(current_spool_state_.tmp_fd, *size_estimate,
+                                  &file.mtime);
+      // A failed flush is reported but the file is kept, since its contents
+      // are still in the page cache and will most likely be written back.
+      if (durability_ != Durability::kNone) {
+        (void)Sync(SyncTarget::kFile, [this] {
+          return FullSync(current_spool_state_.tmp_fd);
+        });
+      }
+    }
     ::fsspool::Close(current_spool_state_.tmp_fd);
     current_spool_state_.tmp_fd = -1;
 
@@ -193,8 +369,6 @@ class FsSpoolWriter {
       return size_estimate.status();
     }
 
-    spool_size_estimate_ += *size_estimate;
-
     if (absl::Status status = RenameFile(current_spool_state_.tmp_file,
                                          current_spool_state_.spool_file);
         !status.ok()) {
@@ -202,6 +376,13 @@ class FsSpoolWriter {
       return status;
     }
 
+    if (durability_ == Durability::kStrict) {
+      (void)Sync(SyncTarget::kDirectory,
+                 [this] { return FullSyncDirectory(spool_dir_); });
+    }
+
+    spool_index_->Add(std::move(file));
+
     return std::optional<std::string>(current_spool_state_.spool_file);
   }
 
@@ -284,47 +465,68 @@ class FsSpoolWriter {
     return result;
   }
 
-  // Returns the on-disk size of the spool directory via a single bulk scan
-  // (no stat() per file). When `files` is non-null it is also populated with
-  // the per-file metadata gathered during that scan, so callers needing to
-  // evict can avoid a second scan of the directory.
-  absl::StatusOr<size_t> EstimateSpoolDirSize(
-      std::vector<DirEntryInfo>* files = nullptr) {
-    return BulkStatRegularFiles(spool_dir_, files);
+  // Returns the space allocated on disk for the file open as fd, falling back
+  // to its size rounded up to a typical 4KiB disk cluster. Also updates mtime
+  // from the file when possible.
+  static size_t OnDiskSize(int fd, size_t size, time_t* mtime) {
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && sb.st_blocks > 0) {
+      *mtime = sb.st_mtime;
+      return static_cast<size_t>(sb.st_blocks) * 512;
+    }
+    return (size + 4095) / 4096 * 4096;
+  }
+
+  // Runs sync_f, reporting its result and duration to sync_callback_.
+  absl::Status Sync(SyncTarget target,
+                    const std::function<absl::Status()>& sync_f) {
+    absl::Time start = absl::Now();
+    absl::Status status = sync_f();
+    if (sync_callback_) {
+      sync_callback_(target, absl::Now() - start, status);
+    }
+    return status;
   }
 
-  // Deletes the oldest spool files until the estimated on-disk size of the
-  // spool directory drops below the low-water mark (90% of max_spool_size_).
+  // Deletes the oldest spool files until the on-disk size of the spool
+  // directory drops below the low-water mark (90% of max_spool_size_).
   // Evicting to a low-water mark rather than to exactly the limit frees ~10%
   // of headroom so eviction doesn't immediately recur on the next few writes.
-  // `files`/`total` come from the caller's directory walk, so no second walk is
-  // needed. Updates spool_size_estimate_ to the post-eviction total.
   // Best-effort: a file that fails to unlink is left in place and skipped.
-  void EvictOldestSpoolFiles(std::vector<DirEntryInfo>& files, size_t total) {
+  // Files that are already gone (e.g. evicted by another writer sharing the
+  // index) are simply dropped from the index.
+  absl::Status EvictOldestSpoolFiles() {
     const size_t low_water_mark = max_spool_size_ - max_spool_size_ / 10;
 
-    // Oldest first.
-    std::sort(files.begin(), files.end(),
-              [](const DirEntryInfo& a, const DirEntryInfo& b) {
-                return a.mtime < b.mtime;
-              });
+    absl::StatusOr<std::vector<DirEntryInfo>> files =
+        spool_index_->FilesOldestFirst();
+    if (!files.ok()) {
+      return files.status();
+    }
+
+    size_t total = 0;
+    for (const DirEntryInfo& file : *files) {
+      total += file.occupancy;
+    }
 
     size_t evicted = 0;
-    for (const DirEntryInfo& file : files) {
+    for (const DirEntryInfo& file : *files) {
       if (total <= low_water_mark) {
         break;
       }
       if (Unlink(file.path.c_str()) == 0) {
-        total -= file.occupancy;
         evicted++;
+      } else if (errno != ENOENT) {
+        continue;
       }
+      spool_index_->Remove(file.path);
+      total -= file.occupancy;
     }
 
-    spool_size_estimate_ = total;
-
     if (evicted > 0 && eviction_callback_) {
       eviction_callback_(evicted);
     }
+    return absl::OkStatus();
   }
 
   struct CurrentSpoolState {
@@ -351,18 +553,20 @@ class FsSpoolWriter {
   // AnyBatcher are buffered in memory.
   bool space_check_failure_since_last_flush_;
 
-  // Approximate maximum size of the spooling area, in bytes. If a message is
-  // being written to a spooling area which already contains more than
-  // maxSpoolSize bytes, the write will not be executed. This is an approximate
-  // estimate: no care is taken to make an exact estimate (for example, if a
-  // file gets deleted from the spool while the estimate is being computed, the
-  // final estimate is likely to still include the size of that file).
+  // Maximum size of the spooling area, in bytes. When a new spool file is
+  // started while the spooling area contains more than max_spool_size_ bytes,
+  // the oldest files are evicted to make room.
   const size_t max_spool_size_;
 
   // Invoked (when set) with the number of spool files erased during an
   // eviction.
   std::function<void(size_t)> eviction_callback_;
 
+  Durability durability_ = Durability::kNone;
+
+  // Invoked (when set) after each flush to stable storage.
+  SyncCallback sync_callback_;
+
   // 64bit hex ID for this writer. Used in combination with the sequence
   // number to generate unique names for files. This is generated through
   // util::random::NewGlobalID(), hence has only 52 bits of randomness.
@@ -373,21 +577,20 @@ class FsSpoolWriter {
   // spooled files have different names.
   uint64_t sequence_number_ = 0;
 
-  // Last estimate for the spool size. The estimate will grow every time we
-  // write messages (basically, we compute it as if there was no reader
-  // consuming messages). It will get updated with the actual value whenever we
-  // think we've passed the size limit. The new estimate will be the sum of the
-  // approximate disk space occupied by each message written (in multiples of
-  // 4KiB, i.e. a typical disk cluster size).
-  size_t spool_size_estimate_;
+  // Index of the files in the spool directory, used to track the spool size
+  // and pick files to evict without scanning the directory.
+  std::shared_ptr<SpoolIndex> spool_index_;
 };
 
 // This class is thread-unsafe.
 class FsSpoolReader {
  public:
-  explicit FsSpoolReader(absl::string_view base_directory)
+  // `spool_index`, when set, is updated as files are deleted.
+  explicit FsSpoolReader(absl::string_view base_directory,
+                         std::shared_ptr<SpoolIndex> spool_index = nullptr)
       : base_dir_(base_directory),
-        spool_dir_(SpoolNewDirectory(base_directory)) {}
+        spool_dir_(SpoolNewDirectory(base_directory)),
+        spool_index_(std::move(spool_index)) {}
   absl::Status AckMessage(const std::string& message_path, bool delete_file) {
     if (delete_file) {
       int remove_status = remove(message_path.c_str());
@@ -396,6 +599,9 @@ class FsSpoolReader {
             errno,
             absl::Substitute("Failed to remove $0: $1", message_path, errno));
       }
+      if (spool_index_) {
+        spool_index_->Remove(message_path);
+      }
     }
     unacked_messages_.erase(message_path);
     return absl::OkStatus();
@@ -441,11 +647,19 @@ class FsSpoolReader {
     return batch;
   }
 
+  // Marks a spool file as in use so it isn't returned in a batch, e.g. while
+  // it is being compacted. Returns false if it is already in use. Release it
+  // with AckMessage.
+  bool TryReserve(const std::string& message_path) {
+    return unacked_messages_.insert(message_path).second;
+  }
+
   size_t NumberOfUnackedMessages() const { return unacked_messages_.size(); }
 
  private:
   const std::string base_dir_;
   const std::string spool_dir_;
+  std::shared_ptr<SpoolIndex> spool_index_;
   absl::flat_hash_set<std::string> unacked_messages_;
 
   absl::StatusOr<std::string> OldestSpooledFile() {
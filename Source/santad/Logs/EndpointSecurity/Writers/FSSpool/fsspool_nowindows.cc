@@ -110,6 +110,27 @@ absl::Status RenameFile(const std::string& src, const std::string& dst) {
   return absl::OkStatus();
 }
 
+absl::Status FullSync(int fd) {
+  if (fcntl(fd, F_FULLFSYNC) == 0) {
+    return absl::OkStatus();
+  }
+  // Not every file system (e.g. network shares) supports F_FULLFSYNC.
+  if (fsync(fd) < 0) {
+    return absl::ErrnoToStatus(errno, "fsync() failed");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status FullSyncDirectory(const std::string& dir) {
+  int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return absl::ErrnoToStatus(errno, absl::StrCat("failed to open ", dir));
+  }
+  absl::Status status = FullSync(fd);
+  close(fd);
+  return status;
+}
+
 absl::Status IterateDirectory(
     const std::string& dir,
     std::function<void(const std::string&, bool*)> callback) {
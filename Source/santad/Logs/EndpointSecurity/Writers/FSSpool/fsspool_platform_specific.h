@@ -36,6 +36,12 @@ bool IsDirectory(const std::string& d);
 int Close(int fd);
 int Open(const char* filename, int flags, mode_t mode);
 absl::Status RenameFile(const std::string& src, const std::string& dst);
+// Flushes the file open as fd to stable storage, including the drive's own
+// cache. Falls back to fsync() on file systems that don't support that.
+absl::Status FullSync(int fd);
+// Flushes a directory's entries to stable storage, e.g. so that a file renamed
+// into it survives a power loss.
+absl::Status FullSyncDirectory(const std::string& dir);
 // Creates a directory if it doesn't exist.
 // It only accepts absolute paths.
 absl::Status MkDir(const std::string& path);
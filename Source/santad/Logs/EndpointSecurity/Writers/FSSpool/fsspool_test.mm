@@ -19,6 +19,7 @@
 #include <sys/stat.h>
 
 #include <memory>
+#include <vector>
 
 #include "Source/common/TestUtils.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
@@ -37,7 +38,6 @@ class FsSpoolWriterPeer : public FsSpoolWriter<T> {
 
   // Private Methods
   using FsSpoolWriter<T>::BuildDirectoryStructureIfNeeded;
-  using FsSpoolWriter<T>::EstimateSpoolDirSize;
 };
 
 }  // namespace fsspool
@@ -126,54 +126,123 @@ google::protobuf::Any TestAnyTimestamp(int64_t s, int32_t n) {
   XCTAssertTrue([self.fileMgr fileExistsAtPath:fifoFile]);
 }
 
-- (void)testEstimateSpoolDirSize {
+- (void)testSpoolIndexReconcile {
   NSString* testData = @"What a day for some testing!";
   NSString* largeTestData = RepeatedString(@"A", 10240);
   NSString* path = [NSString stringWithFormat:@"%@/%@", self.spoolDir, @"temppy.log"];
   NSString* secondPath = [NSString stringWithFormat:@"%@/%@", self.spoolDir, @"second.log"];
-  // EstimateSpoolDirSize is batcher-independent, so one batcher exercises it.
-  auto writer = std::make_unique<FsSpoolWriterPeer<fsspool::AnyBatcher>>(
-      fsspool::AnyBatcher(), [self.baseDir UTF8String], kSpoolSize);
+  XCTAssertTrue([self.fileMgr createDirectoryAtPath:self.spoolDir
+                        withIntermediateDirectories:YES
+                                         attributes:nil
+                                              error:nil]);
 
-  // Create the spool dir structure and ensure no files exist
-  XCTAssertStatusOk(writer->BuildDirectoryStructureIfNeeded());
-  XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count], 0);
+  // Never reconcile on its own so changes made behind the index's back are only seen on an
+  // explicit Reconcile.
+  fsspool::SpoolIndex index(self.spoolDir.UTF8String, absl::InfiniteDuration());
 
-  // An empty spool dir estimates to 0.
-  auto status = writer->EstimateSpoolDirSize();
-  XCTAssertStatusOk(status);
-  XCTAssertEqual(*status, 0);
+  // The first use scans the directory. An empty spool dir has size 0.
+  auto size = index.TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertEqual(*size, 0);
 
-  // A file shows up in the estimate.
   XCTAssertTrue([testData writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil]);
-  XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count], 1);
-  status = writer->EstimateSpoolDirSize();
-  XCTAssertStatusOk(status);
-  XCTAssertGreaterThanOrEqual(*status, testData.length);
-  size_t before_growth = *status;
-
-  // Growing a file's contents (without touching the spool dir's mtime) is
-  // reflected immediately: every call does a fresh scan, there is no mtime cache.
-  NSFileHandle* fileHandle = [NSFileHandle fileHandleForWritingAtPath:path];
-  [fileHandle seekToEndOfFile];
-  [fileHandle writeData:[largeTestData dataUsingEncoding:NSUTF8StringEncoding]];
-  [fileHandle closeFile];
-  XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count], 1);
-  status = writer->EstimateSpoolDirSize();
-  XCTAssertStatusOk(status);
-  XCTAssertGreaterThan(*status, before_growth);
-  XCTAssertGreaterThanOrEqual(*status, testData.length + largeTestData.length);
-  size_t before_second = *status;
-
-  // A second file adds to the total.
+  size = index.TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertEqual(*size, 0);
+
+  XCTAssertStatusOk(index.Reconcile());
+  size = index.TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertGreaterThanOrEqual(*size, testData.length);
+  size_t afterFirst = *size;
+
+  // A second file adds to the total once reconciled.
   XCTAssertTrue([largeTestData writeToFile:secondPath
                                 atomically:YES
                                   encoding:NSUTF8StringEncoding
                                      error:nil]);
-  XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count], 2);
-  status = writer->EstimateSpoolDirSize();
-  XCTAssertStatusOk(status);
-  XCTAssertGreaterThan(*status, before_second);
+  XCTAssertStatusOk(index.Reconcile());
+  size = index.TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertGreaterThanOrEqual(*size, afterFirst + largeTestData.length);
+
+  auto files = index.FilesOldestFirst();
+  XCTAssertStatusOk(files);
+  XCTAssertEqual(files->size(), 2);
+
+  // Files removed behind the index's back are dropped on reconcile.
+  XCTAssertTrue([self.fileMgr removeItemAtPath:secondPath error:nil]);
+  XCTAssertStatusOk(index.Reconcile());
+  size = index.TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertEqual(*size, afterFirst);
+}
+
+- (void)testSpoolIndexAddRemove {
+  fsspool::SpoolIndex index(self.spoolDir.UTF8String, absl::InfiniteDuration());
+
+  // The spool directory doesn't exist yet, so the initial scan fails.
+  XCTAssertFalse(index.TotalSize().ok());
+  XCTAssertTrue([self.fileMgr createDirectoryAtPath:self.spoolDir
+                        withIntermediateDirectories:YES
+                                         attributes:nil
+                                              error:nil]);
+  auto size = index.TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertEqual(*size, 0);
+
+  index.Add({.path = "/spool/b", .mtime = 20, .occupancy = 8192});
+  index.Add({.path = "/spool/a", .mtime = 10, .occupancy = 4096});
+  size = index.TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertEqual(*size, 12288);
+
+  // Re-adding a file replaces its entry.
+  index.Add({.path = "/spool/b", .mtime = 20, .occupancy = 4096});
+  size = index.TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertEqual(*size, 8192);
+
+  auto files = index.FilesOldestFirst();
+  XCTAssertStatusOk(files);
+  XCTAssertEqual(files->size(), 2);
+  XCTAssertCppStringEqual((*files)[0].path, "/spool/a");
+  XCTAssertCppStringEqual((*files)[1].path, "/spool/b");
+
+  index.Remove("/spool/a");
+  index.Remove("/spool/unknown");
+  size = index.TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertEqual(*size, 4096);
+}
+
+- (void)testSpoolIndexTracksWritesAndAcks {
+  auto index = std::make_shared<fsspool::SpoolIndex>(self.spoolDir.UTF8String,
+                                                     absl::InfiniteDuration());
+  auto writer = std::make_unique<FsSpoolWriterPeer<fsspool::UncompressedStreamBatcher>>(
+      fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], kSpoolSize, nullptr, index);
+  fsspool::FsSpoolReader reader([self.baseDir UTF8String], index);
+
+  std::vector<uint8_t> message(100, '\x42');
+  XCTAssertStatusOk(writer->Write(message));
+  auto flushed = writer->Flush();
+  XCTAssertStatusOk(flushed);
+  XCTAssertTrue(flushed->has_value());
+
+  // The completed file is indexed without another directory scan.
+  auto size = index->TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertGreaterThanOrEqual(*size, message.size());
+  auto files = index->FilesOldestFirst();
+  XCTAssertStatusOk(files);
+  XCTAssertEqual(files->size(), 1);
+  XCTAssertCppStringEqual((*files)[0].path, **flushed);
+
+  // Deleting the file once exported removes it from the index.
+  XCTAssertStatusOk(reader.AckMessage(**flushed, true));
+  size = index->TotalSize();
+  XCTAssertStatusOk(size);
+  XCTAssertEqual(*size, 0);
 }
 
 - (void)testSimpleWriteAnyBatcher {
@@ -324,6 +393,43 @@ google::protobuf::Any TestAnyTimestamp(int64_t s, int32_t n) {
   XCTAssertEqual(totalEvicted, (size_t)1);
 }
 
+- (void)testDurability {
+  std::vector<fsspool::SyncTarget> syncs;
+  fsspool::SyncCallback cb = [&syncs](fsspool::SyncTarget target, absl::Duration duration,
+                                      const absl::Status& status) {
+    XCTAssertStatusOk(status);
+    XCTAssertTrue(duration >= absl::ZeroDuration());
+    syncs.push_back(target);
+  };
+
+  auto writer = std::make_unique<FsSpoolWriterPeer<fsspool::AnyBatcher>>(
+      fsspool::AnyBatcher(), [self.baseDir UTF8String], kSpoolSize);
+
+  // Nothing is synced by default
+  writer->SetDurability(fsspool::Durability::kNone, cb);
+  XCTAssertStatusOk(writer->Write({123}));
+  XCTAssertStatusOk(writer->Flush());
+  XCTAssertTrue(syncs.empty());
+
+  // Batch mode only syncs the completed file
+  writer->SetDurability(fsspool::Durability::kBatch, cb);
+  XCTAssertStatusOk(writer->Write({123}));
+  XCTAssertStatusOk(writer->Flush());
+  XCTAssertTrue(syncs == std::vector<fsspool::SyncTarget>{fsspool::SyncTarget::kFile});
+
+  // Strict mode also syncs the spool directory after the rename
+  syncs.clear();
+  writer->SetDurability(fsspool::Durability::kStrict, cb);
+  XCTAssertStatusOk(writer->Write({123}));
+  XCTAssertStatusOk(writer->Flush());
+  XCTAssertTrue(syncs == (std::vector<fsspool::SyncTarget>{fsspool::SyncTarget::kFile,
+                                                            fsspool::SyncTarget::kDirectory}));
+
+  NSError* err = nil;
+  XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:&err] count], 3);
+  XCTAssertNil(err);
+}
+
 - (void)testWriteMessageNoFlushAnyBatcher {
   auto writer = std::make_unique<FsSpoolWriterPeer<fsspool::AnyBatcher>>(
       fsspool::AnyBatcher(), [self.baseDir UTF8String], kSpoolSize);
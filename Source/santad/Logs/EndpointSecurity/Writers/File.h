@@ -31,15 +31,20 @@ class FilePeer;
 
 namespace santa {
 
+// Writes batches of log lines to a file.
+//
+// Writes are queued without being copied and are appended to the file with a
+// single writev(2) on an O_APPEND descriptor once a batch fills or the flush
+// timer fires. If the file is deleted or renamed, e.g. by log rotation, a new
+// file is opened at the original path.
 class File : public Writer, public std::enable_shared_from_this<File> {
  public:
   // Factory
   static std::shared_ptr<File> Create(NSString* path, uint64_t flush_timeout_ms,
-                                      size_t batch_size_bytes,
-                                      size_t max_expected_write_size_bytes);
+                                      size_t batch_size_bytes);
 
-  File(NSString* path, size_t batch_size_bytes, size_t max_expected_write_size_bytes,
-       dispatch_queue_t q, dispatch_source_t timer_source);
+  File(NSString* path, size_t batch_size_bytes, dispatch_queue_t q,
+       dispatch_source_t timer_source);
   ~File();
 
   void Write(std::vector<uint8_t>&& bytes) override;
@@ -48,27 +53,24 @@ class File : public Writer, public std::enable_shared_from_this<File> {
   friend class santa::FilePeer;
 
  private:
-  void OpenFileHandleSerialized();
+  void OpenFileSerialized();
+  void CloseFileSerialized();
   void WatchLogFile();
   void FlushSerialized();
   bool ShouldFlush();
 
-  void EnsureCapacitySerialized(size_t additional_bytes);
-  void CopyDataSerialized(const std::vector<uint8_t>& bytes);
+  void AppendSerialized(std::vector<uint8_t>&& bytes);
+
+  // Buffers waiting to be written, in order, and their total size.
+  std::vector<std::vector<uint8_t>> pending_;
+  size_t pending_bytes_ = 0;
 
-  std::vector<uint8_t> buffer_;
   size_t batch_size_bytes_;
   dispatch_queue_t q_;
   dispatch_source_t timer_source_;
   dispatch_source_t watch_source_;
   NSString* path_;
-  NSFileHandle* file_handle_;
-
-  // Used to manually track the size of valid data in the `buffer_`.
-  // Benchmarking showed a large amount of time clearing the buffer after
-  // flushes, but that isn't very necessary. Instead we can manually track the
-  // `end` of the buffer and skip clearing the data.
-  size_t buffer_offset_ = 0;
+  int fd_ = -1;
 };
 
 }  // namespace santa
@@ -15,15 +15,23 @@
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <memory>
 
 #include "Source/common/BranchPrediction.h"
+#include "Source/common/BufferPool.h"
 
 namespace santa {
 
 std::shared_ptr<File> File::Create(NSString* path, uint64_t flush_timeout_ms,
-                                   size_t batch_size_bytes, size_t max_expected_write_size_bytes) {
+                                   size_t batch_size_bytes) {
   dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.file_event_log",
                                              DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
   dispatch_source_t timer_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
@@ -31,8 +39,7 @@ std::shared_ptr<File> File::Create(NSString* path, uint64_t flush_timeout_ms,
   dispatch_source_set_timer(timer_source, dispatch_time(DISPATCH_TIME_NOW, 0),
                             NSEC_PER_MSEC * flush_timeout_ms, 0);
 
-  auto ret_writer = std::make_shared<File>(path, batch_size_bytes, max_expected_write_size_bytes, q,
-                                           timer_source);
+  auto ret_writer = std::make_shared<File>(path, batch_size_bytes, q, timer_source);
   ret_writer->WatchLogFile();
 
   std::weak_ptr<File> weak_writer(ret_writer);
@@ -49,15 +56,14 @@ std::shared_ptr<File> File::Create(NSString* path, uint64_t flush_timeout_ms,
   return ret_writer;
 }
 
-File::File(NSString* path, size_t batch_size_bytes, size_t max_expected_write_size_bytes,
-           dispatch_queue_t q, dispatch_source_t timer_source)
-    : buffer_(batch_size_bytes + max_expected_write_size_bytes),
-      batch_size_bytes_(batch_size_bytes),
+File::File(NSString* path, size_t batch_size_bytes, dispatch_queue_t q,
+           dispatch_source_t timer_source)
+    : batch_size_bytes_(batch_size_bytes),
       q_(q),
       timer_source_(timer_source),
       watch_source_(nullptr) {
   path_ = path;
-  OpenFileHandleSerialized();
+  OpenFileSerialized();
 }
 
 void File::WatchLogFile() {
@@ -65,13 +71,13 @@ void File::WatchLogFile() {
     dispatch_source_cancel(watch_source_);
   }
 
-  watch_source_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, file_handle_.fileDescriptor,
+  watch_source_ = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, fd_,
                                          DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME, q_);
 
   auto shared_this = shared_from_this();
   dispatch_source_set_event_handler(watch_source_, ^{
-    [shared_this->file_handle_ closeFile];
-    shared_this->OpenFileHandleSerialized();
+    shared_this->CloseFileSerialized();
+    shared_this->OpenFileSerialized();
     shared_this->WatchLogFile();
   });
 
@@ -82,16 +88,23 @@ File::~File() {
   if (timer_source_) {
     dispatch_source_cancel(timer_source_);
   }
+  CloseFileSerialized();
 }
 
 // IMPORTANT: Not thread safe.
-void File::OpenFileHandleSerialized() {
-  NSFileManager* fm = [NSFileManager defaultManager];
-  if (![fm fileExistsAtPath:path_]) {
-    [fm createFileAtPath:path_ contents:nil attributes:nil];
+void File::OpenFileSerialized() {
+  // O_APPEND makes every write land at the current end of the file, even if
+  // something else has appended to it since it was opened.
+  fd_ = open(path_.fileSystemRepresentation, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+             S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+}
+
+// IMPORTANT: Not thread safe.
+void File::CloseFileSerialized() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
   }
-  file_handle_ = [NSFileHandle fileHandleForWritingAtPath:path_];
-  [file_handle_ seekToEndOfFile];
 }
 
 void File::Write(std::vector<uint8_t>&& bytes) {
@@ -101,9 +114,7 @@ void File::Write(std::vector<uint8_t>&& bytes) {
   __block std::vector<uint8_t> temp_bytes = std::move(bytes);
 
   dispatch_async(q_, ^{
-    std::vector<uint8_t> moved_bytes = std::move(temp_bytes);
-
-    shared_this->CopyDataSerialized(moved_bytes);
+    shared_this->AppendSerialized(std::move(temp_bytes));
 
     if (shared_this->ShouldFlush()) {
       shared_this->FlushSerialized();
@@ -112,7 +123,7 @@ void File::Write(std::vector<uint8_t>&& bytes) {
 }
 
 bool File::ShouldFlush() {
-  return buffer_offset_ >= batch_size_bytes_;
+  return pending_bytes_ >= batch_size_bytes_;
 }
 
 void File::Flush() {
@@ -122,27 +133,55 @@ void File::Flush() {
 }
 
 // IMPORTANT: Not thread safe.
-void File::EnsureCapacitySerialized(size_t additional_bytes) {
-  if ((buffer_offset_ + additional_bytes) > buffer_.capacity()) {
-    buffer_.resize(std::max(buffer_.capacity() * 2, buffer_offset_ + additional_bytes));
+void File::AppendSerialized(std::vector<uint8_t>&& bytes) {
+  if (bytes.empty()) {
+    BufferPool::Shared().Release(std::move(bytes));
+    return;
   }
-}
-
-// IMPORTANT: Not thread safe.
-void File::CopyDataSerialized(const std::vector<uint8_t>& bytes) {
-  EnsureCapacitySerialized(bytes.size());
-  std::copy(bytes.begin(), bytes.end(), buffer_.begin() + buffer_offset_);
-  buffer_offset_ += bytes.size();
+  pending_bytes_ += bytes.size();
+  pending_.push_back(std::move(bytes));
 }
 
 // IMPORTANT: Not thread safe.
 void File::FlushSerialized() {
-  if (likely(buffer_offset_ > 0)) {
-    write(file_handle_.fileDescriptor, buffer_.data(), buffer_offset_);
+  if (unlikely(pending_.empty())) {
+    return;
+  }
+
+  std::vector<struct iovec> iovs;
+  iovs.reserve(pending_.size());
+  for (std::vector<uint8_t>& bytes : pending_) {
+    iovs.push_back({.iov_base = bytes.data(), .iov_len = bytes.size()});
+  }
+
+  // Write the batch with as few calls as possible, picking up where the last
+  // call left off after a short write. If the file can't be written the batch
+  // is dropped, as it was when writes went through a file handle.
+  struct iovec* iov = iovs.data();
+  size_t remaining = iovs.size();
+  while (remaining > 0) {
+    ssize_t written = writev(fd_, iov, (int)std::min<size_t>(remaining, IOV_MAX));
+    if (written <= 0) {
+      if (written < 0 && errno == EINTR) continue;
+      break;
+    }
+
+    while (remaining > 0 && (size_t)written >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov++;
+      remaining--;
+    }
+    if (remaining > 0) {
+      iov->iov_base = (uint8_t*)iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
 
-    // After flushing, reset the offset back to 0
-    buffer_offset_ = 0;
+  for (std::vector<uint8_t>& bytes : pending_) {
+    BufferPool::Shared().Release(std::move(bytes));
   }
+  pending_.clear();
+  pending_bytes_ = 0;
 }
 
 }  // namespace santa
@@ -16,6 +16,7 @@
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
 #include <gtest/gtest.h>
+#include <limits.h>
 #include <sys/stat.h>
 
 #include <vector>
@@ -30,31 +31,32 @@ class FilePeer : public File {
   // Make constructors visible
   using File::File;
 
-  using File::CopyDataSerialized;
-  using File::EnsureCapacitySerialized;
+  using File::AppendSerialized;
+  using File::FlushSerialized;
   using File::ShouldFlush;
   using File::WatchLogFile;
 
   // Member accesses wrapped in a dispatch_sync to satisfy tsan.
-  NSFileHandle* FileHandle() {
-    __block NSFileHandle* h;
+  int FileDescriptor() {
+    __block int fd;
     dispatch_sync(q_, ^{
-      h = file_handle_;
+      fd = fd_;
     });
-    return h;
+    return fd;
   }
 
   size_t InternalBufferSize() {
     __block size_t s = 0;
     dispatch_sync(q_, ^{
-      s = buffer_offset_;
+      s = pending_bytes_;
     });
     return s;
   }
-  size_t InternalBufferCapacity() {
+
+  size_t PendingWriteCount() {
     __block size_t s = 0;
     dispatch_sync(q_, ^{
-      s = buffer_.capacity();
+      s = pending_.size();
     });
     return s;
   }
@@ -132,14 +134,14 @@ bool WaitForBufferSize(std::shared_ptr<FilePeer> file, size_t expectedSize) {
 }
 
 - (void)testWatchLogFile {
-  auto file = std::make_shared<FilePeer>(self.logPath, 100, 500, self.q, self.timer);
+  auto file = std::make_shared<FilePeer>(self.logPath, 100, self.q, self.timer);
   file->WatchLogFile();
 
   // Constructing a File object will open the file at the given path
   struct stat wantSBOrig;
   struct stat gotSBOrig;
   XCTAssertEqual(stat([self.logPath UTF8String], &wantSBOrig), 0);
-  XCTAssertEqual(fstat(file->FileHandle().fileDescriptor, &gotSBOrig), 0);
+  XCTAssertEqual(fstat(file->FileDescriptor(), &gotSBOrig), 0);
   XCTAssertEqual(wantSBOrig.st_ino, gotSBOrig.st_ino);
 
   // Deleting the current log file will cause a new file to be created
@@ -151,7 +153,7 @@ bool WaitForBufferSize(std::shared_ptr<FilePeer> file, size_t expectedSize) {
   struct stat wantSBAfterDelete;
   struct stat gotSBAfterDelete;
   XCTAssertEqual(stat([self.logPath UTF8String], &wantSBAfterDelete), 0);
-  XCTAssertEqual(fstat(file->FileHandle().fileDescriptor, &gotSBAfterDelete), 0);
+  XCTAssertEqual(fstat(file->FileDescriptor(), &gotSBAfterDelete), 0);
 
   XCTAssertEqual(wantSBAfterDelete.st_ino, gotSBAfterDelete.st_ino);
   XCTAssertNotEqual(wantSBOrig.st_ino, wantSBAfterDelete.st_ino);
@@ -165,7 +167,7 @@ bool WaitForBufferSize(std::shared_ptr<FilePeer> file, size_t expectedSize) {
   struct stat wantSBAfterRename;
   struct stat gotSBAfterRename;
   XCTAssertEqual(stat([self.logPath UTF8String], &wantSBAfterRename), 0);
-  XCTAssertEqual(fstat(file->FileHandle().fileDescriptor, &gotSBAfterRename), 0);
+  XCTAssertEqual(fstat(file->FileDescriptor(), &gotSBAfterRename), 0);
 
   XCTAssertEqual(wantSBAfterRename.st_ino, gotSBAfterRename.st_ino);
   XCTAssertNotEqual(wantSBAfterDelete.st_ino, wantSBAfterRename.st_ino);
@@ -176,120 +178,112 @@ bool WaitForBufferSize(std::shared_ptr<FilePeer> file, size_t expectedSize) {
   // internal buffer. The second will meet/exceed capacity and flush to disk
   size_t bufferSize = 100;
   size_t writeSize = 50;
-  auto file =
-      std::make_shared<FilePeer>(self.logPath, bufferSize, bufferSize * 2, self.q, self.timer);
+  auto file = std::make_shared<FilePeer>(self.logPath, bufferSize, self.q, self.timer);
 
   // Starting out, file size and internal buffer are 0
   struct stat gotSB;
-  XCTAssertEqual(fstat(file->FileHandle().fileDescriptor, &gotSB), 0);
+  XCTAssertEqual(fstat(file->FileDescriptor(), &gotSB), 0);
   XCTAssertEqual(0, gotSB.st_size);
   XCTAssertEqual(0, file->InternalBufferSize());
 
   // After the first write, the buffer is 50 bytes, but the file is still 0
   file->Write(std::vector<uint8_t>(writeSize, 'A'));
   WaitForBufferSize(file, 50);
-  XCTAssertEqual(fstat(file->FileHandle().fileDescriptor, &gotSB), 0);
+  XCTAssertEqual(fstat(file->FileDescriptor(), &gotSB), 0);
   XCTAssertEqual(0, gotSB.st_size);
   XCTAssertEqual(50, file->InternalBufferSize());
 
   // After the second write, the buffer is flushed. File size 100, buffer is 0.
   file->Write(std::vector<uint8_t>(writeSize, 'B'));
   WaitForBufferSize(file, 0);
-  XCTAssertEqual(fstat(file->FileHandle().fileDescriptor, &gotSB), 0);
+  XCTAssertEqual(fstat(file->FileDescriptor(), &gotSB), 0);
   XCTAssertEqual(100, gotSB.st_size);
   XCTAssertEqual(0, file->InternalBufferSize());
 }
 
-- (void)testEnsureCapacity {
-  const size_t batchSize = 100;
-  auto file =
-      std::make_shared<FilePeer>(self.logPath, batchSize, batchSize * 2, self.q, self.timer);
-
-  // Initial capacity == (batch_size + max_expected_write_size)
-  const size_t initialCapacity = batchSize + (batchSize * 2);
-
-  // Buffer size should initially be 0 and capacity match initial expectations
-  XCTAssertEqual(file->InternalBufferSize(), 0);
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity);
-
-  file->EnsureCapacitySerialized(batchSize);
-
-  // No data was written, so size is still 0
+- (void)testAppend {
+  auto file = std::make_shared<FilePeer>(self.logPath, 100, self.q, self.timer);
   XCTAssertEqual(file->InternalBufferSize(), 0);
+  XCTAssertEqual(file->PendingWriteCount(), 0);
 
-  // Capacity should be unchanged because the amount ensured didn't exceed
-  // the initial amount
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity);
+  file->AppendSerialized(std::vector<uint8_t>(30, 'A'));
+  file->AppendSerialized(std::vector<uint8_t>(40, 'B'));
+  XCTAssertEqual(file->InternalBufferSize(), 70);
+  XCTAssertEqual(file->PendingWriteCount(), 2);
 
-  file->EnsureCapacitySerialized(initialCapacity + 100);
+  // Empty writes aren't queued
+  file->AppendSerialized(std::vector<uint8_t>());
+  XCTAssertEqual(file->PendingWriteCount(), 2);
 
-  // No data was written, so size is still 0
+  file->FlushSerialized();
   XCTAssertEqual(file->InternalBufferSize(), 0);
-
-  // Capacity should be doubled since the amount ensured was greater than
-  // the previous capacity
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity * 2);
-}
-
-- (void)testEnsureCapacityBeyondDoubleInitialSize {
-  const size_t initialCapacity = 300;
-  auto file = std::make_shared<FilePeer>(self.logPath, 100, 200, self.q, self.timer);
-  file->EnsureCapacitySerialized((initialCapacity * 2) + 1);
-  XCTAssertGreaterThan(file->InternalBufferCapacity(), initialCapacity * 2);
-}
-
-- (void)testCopyData {
-  const size_t batchSize = 100;
-  // Use a buffer to copy that's slightly larger than the batch size
-  std::vector<uint8_t> bytes(batchSize + 2, 'A');
-  auto file =
-      std::make_shared<FilePeer>(self.logPath, batchSize, batchSize * 2, self.q, self.timer);
-
-  // Initial capacity == (batch_size + max_expected_write_size)
-  const size_t initialCapacity = batchSize + (batchSize * 2);
-
-  // Buffer size should initially be 0 and capacity match initial expectations
-  XCTAssertEqual(file->InternalBufferSize(), 0);
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity);
-
-  file->CopyDataSerialized(bytes);
-
-  // After a copy, buffer size should match copied data size
-  XCTAssertEqual(file->InternalBufferSize(), bytes.size());
-
-  // Do a couple more copies that should require the buffer to grow and then
-  // confirm the size/capacity still matches expectations
-  file->CopyDataSerialized(bytes);
-  file->CopyDataSerialized(bytes);
-  XCTAssertEqual(file->InternalBufferSize(), bytes.size() * 3);
-  XCTAssertEqual(file->InternalBufferCapacity(), initialCapacity * 2);
+  XCTAssertEqual(file->PendingWriteCount(), 0);
 }
 
 - (void)testShouldFlush {
   const size_t batchSize = 100;
   const size_t halfBatch = batchSize / 2;
-  std::vector<uint8_t> bytes(halfBatch);
-  auto file =
-      std::make_shared<FilePeer>(self.logPath, batchSize, batchSize * 2, self.q, self.timer);
+  auto file = std::make_shared<FilePeer>(self.logPath, batchSize, self.q, self.timer);
 
   // Should never want to flush with no data in the buffer
   XCTAssertFalse(file->ShouldFlush());
 
-  // Copy some data into the buffer
-  file->CopyDataSerialized(bytes);
+  // Queue some data
+  file->AppendSerialized(std::vector<uint8_t>(halfBatch));
 
   // Buffer size should be updated
-  XCTAssertEqual(file->InternalBufferSize(), bytes.size());
+  XCTAssertEqual(file->InternalBufferSize(), halfBatch);
 
   // Still shouldn't flush below the batch size
   XCTAssertFalse(file->ShouldFlush());
 
   // Exceed the batch size
-  file->CopyDataSerialized(bytes);
-  file->CopyDataSerialized(bytes);
+  file->AppendSerialized(std::vector<uint8_t>(halfBatch));
+  file->AppendSerialized(std::vector<uint8_t>(halfBatch));
 
   // Should want to flush now that the batch size is exceeded
   XCTAssertTrue(file->ShouldFlush());
 }
 
+- (void)testFlushWritesInOrder {
+  // More writes than fit in a single writev call
+  const int numWrites = IOV_MAX * 2 + 10;
+  auto file = std::make_shared<FilePeer>(self.logPath, SIZE_MAX, self.q, self.timer);
+
+  NSMutableString* want = [NSMutableString string];
+  for (int i = 0; i < numWrites; i++) {
+    NSString* line = [NSString stringWithFormat:@"line %d\n", i];
+    [want appendString:line];
+    const char* bytes = line.UTF8String;
+    file->AppendSerialized(std::vector<uint8_t>(bytes, bytes + strlen(bytes)));
+  }
+  file->FlushSerialized();
+
+  NSString* got = [NSString stringWithContentsOfFile:self.logPath
+                                            encoding:NSUTF8StringEncoding
+                                               error:nil];
+  XCTAssertEqualObjects(got, want);
+}
+
+- (void)testFlushAppendsToEndOfFile {
+  auto file = std::make_shared<FilePeer>(self.logPath, SIZE_MAX, self.q, self.timer);
+  file->AppendSerialized(std::vector<uint8_t>(10, 'A'));
+  file->FlushSerialized();
+
+  // Something else appends to the file after it was opened
+  NSFileHandle* other = [NSFileHandle fileHandleForWritingAtPath:self.logPath];
+  [other seekToEndOfFile];
+  [other writeData:[@"BBBBB" dataUsingEncoding:NSUTF8StringEncoding]];
+  [other closeFile];
+
+  // Later writes land after it rather than overwriting it
+  file->AppendSerialized(std::vector<uint8_t>(10, 'C'));
+  file->FlushSerialized();
+
+  NSString* got = [NSString stringWithContentsOfFile:self.logPath
+                                            encoding:NSUTF8StringEncoding
+                                               error:nil];
+  XCTAssertEqualObjects(got, @"AAAAAAAAAABBBBBCCCCCCCCCC");
+}
+
 @end
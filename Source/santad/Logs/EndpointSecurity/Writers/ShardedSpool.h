@@ -0,0 +1,140 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_SHARDEDSPOOL_H
+#define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_SHARDEDSPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Source/common/ScopedFile.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/Spool.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+
+namespace santa {
+
+// Returns a small integer identifying the calling thread, assigned in the
+// order threads first call this function.
+inline uint64_t SpoolShardThreadOrdinal() {
+  static std::atomic<uint64_t> next_ordinal{0};
+  static thread_local uint64_t ordinal = next_ordinal.fetch_add(1, std::memory_order_relaxed);
+  return ordinal;
+}
+
+// A Writer that spreads messages across several independent Spools writing to
+// the same spool directory, so that serialization of writes, batching and
+// compression aren't limited to a single queue.
+//
+// Each shard has its own queue, batcher, flush timer and spool files. Every
+// producer thread is pinned to one shard, so messages from one thread are
+// written in order, but messages from different threads may be interleaved
+// differently than they were written. All shards share one index of the spool
+// directory so that together they stay under the spool size limit, and one set
+// of spool metrics.
+//
+// Reading back from the spool for export goes through the first shard, which
+// sees the files of every shard since they share a directory.
+template <::fsspool::BatcherInterface T>
+class ShardedSpool : public Writer {
+ public:
+  // Factory. Each shard gets a copy of batcher and may buffer up to
+  // max_spool_batch_size bytes before writing a spool file.
+  static std::shared_ptr<ShardedSpool<T>> Create(
+      const T& batcher, size_t num_shards, std::string_view base_dir, size_t max_spool_disk_size,
+      size_t max_spool_batch_size, uint64_t flush_timeout_ms,
+      void (^file_closed_f)(std::string, std::shared_ptr<santa::ScopedFile>,
+                            std::shared_ptr<const santa::SignalPrefilter>) = nullptr,
+      std::shared_ptr<const santa::SignalPrefilter> (^prefilter_f)(void) = nullptr) {
+    std::shared_ptr<::fsspool::SpoolIndex> spool_index = Spool<T>::MakeSpoolIndex(base_dir);
+    std::function<void(size_t)> eviction_callback = Spool<T>::RegisterMetrics(spool_index);
+
+    std::vector<std::shared_ptr<Spool<T>>> shards;
+    for (size_t i = 0; i < std::max<size_t>(num_shards, 1); ++i) {
+      shards.push_back(Spool<T>::CreateShard(batcher, base_dir, max_spool_disk_size,
+                                             max_spool_batch_size, flush_timeout_ms, file_closed_f,
+                                             prefilter_f, eviction_callback, spool_index));
+    }
+
+    return std::make_shared<ShardedSpool<T>>(std::move(shards));
+  }
+
+  explicit ShardedSpool(std::vector<std::shared_ptr<Spool<T>>> shards)
+      : shards_(std::move(shards)) {}
+
+  void Write(std::vector<uint8_t>&& bytes) override {
+    shards_[SpoolShardThreadOrdinal() % shards_.size()]->Write(std::move(bytes));
+  }
+
+  void Flush() override {
+    for (const auto& shard : shards_) {
+      shard->Flush();
+    }
+  }
+
+  std::optional<absl::flat_hash_set<std::string>> GetFilesToExport(size_t max_count) override {
+    return shards_[0]->GetFilesToExport(max_count);
+  }
+
+  std::optional<std::string> NextFileToExport() override {
+    return shards_[0]->NextFileToExport();
+  }
+
+  void FilesExported(absl::flat_hash_map<std::string, bool> files_exported) override {
+    shards_[0]->FilesExported(std::move(files_exported));
+  }
+
+  // Returns the backlog of the most backed up shard, since each shard
+  // processes its writes independently.
+  size_t PendingWrites() const override {
+    size_t pending = 0;
+    for (const auto& shard : shards_) {
+      pending = std::max(pending, shard->PendingWrites());
+    }
+    return pending;
+  }
+
+  // All shards share a spool directory, which is compacted through the shard
+  // that exports it.
+  void SetMerger(SpoolFileMerger merger) { shards_[0]->SetMerger(std::move(merger)); }
+
+  void SetDurability(::fsspool::Durability durability) {
+    for (const auto& shard : shards_) {
+      shard->SetDurability(durability);
+    }
+  }
+
+  size_t CompactSpool(size_t target_file_size) override {
+    return shards_[0]->CompactSpool(target_file_size);
+  }
+
+  size_t NumShards() const { return shards_.size(); }
+
+ private:
+  std::vector<std::shared_ptr<Spool<T>>> shards_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_SHARDEDSPOOL_H
@@ -0,0 +1,170 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <unistd.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/ShardedSpool.h"
+
+using santa::ShardedSpool;
+using santa::SpoolShardThreadOrdinal;
+
+@interface ShardedSpoolTest : XCTestCase
+@property NSFileManager* fileMgr;
+@property NSString* testDir;
+@property NSString* baseDir;
+@property NSString* spoolDir;
+@end
+
+@implementation ShardedSpoolTest
+
+- (void)setUp {
+  self.fileMgr = [NSFileManager defaultManager];
+  self.testDir =
+      [NSString stringWithFormat:@"%@sharded-fsspool-%d", NSTemporaryDirectory(), getpid()];
+  self.baseDir = [NSString stringWithFormat:@"%@/base", self.testDir];
+  self.spoolDir = [NSString stringWithFormat:@"%@/new", self.baseDir];
+
+  XCTAssertTrue([self.fileMgr createDirectoryAtPath:self.testDir
+                        withIntermediateDirectories:YES
+                                         attributes:nil
+                                              error:nil]);
+}
+
+- (void)tearDown {
+  XCTAssertTrue([self.fileMgr removeItemAtPath:self.testDir error:nil]);
+}
+
+- (NSUInteger)spoolFileCount {
+  return [[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil] count];
+}
+
+- (std::shared_ptr<ShardedSpool<::fsspool::UncompressedStreamBatcher>>)
+    createSpoolWithShards:(size_t)numShards
+                 diskSize:(size_t)diskSize {
+  // Use a long flush timeout so that only explicit flushes create spool files.
+  return ShardedSpool<::fsspool::UncompressedStreamBatcher>::Create(
+      ::fsspool::UncompressedStreamBatcher(), numShards, [self.baseDir UTF8String], diskSize,
+      1024 * 1024, 3600 * 1000);
+}
+
+- (void)testThreadOrdinalIsStable {
+  uint64_t ordinal = SpoolShardThreadOrdinal();
+  XCTAssertEqual(SpoolShardThreadOrdinal(), ordinal);
+
+  uint64_t other = ordinal;
+  std::thread t([&other] {
+    other = SpoolShardThreadOrdinal();
+  });
+  t.join();
+  XCTAssertNotEqual(other, ordinal);
+}
+
+- (void)testZeroShardsCreatesOne {
+  auto spool = [self createSpoolWithShards:0 diskSize:1024 * 1024];
+  XCTAssertEqual(spool->NumShards(), 1);
+}
+
+- (void)testWritesFromThreadsSpreadAcrossShards {
+  const size_t kShards = 4;
+  auto spool = [self createSpoolWithShards:kShards diskSize:1024 * 1024];
+  XCTAssertEqual(spool->NumShards(), kShards);
+
+  // Consecutive new threads get consecutive ordinals, so one write from each
+  // of kShards threads reaches every shard once.
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kShards; ++i) {
+    threads.emplace_back([spool] {
+      spool->Write(std::vector<uint8_t>(64, 'A'));
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  XCTAssertEqual([self spoolFileCount], 0);
+
+  // Flushing writes out every shard's pending batch to its own file.
+  spool->Flush();
+  XCTAssertEqual([self spoolFileCount], kShards);
+
+  // Nothing left to flush.
+  spool->Flush();
+  XCTAssertEqual([self spoolFileCount], kShards);
+}
+
+- (void)testExportSeesFilesFromAllShards {
+  const size_t kShards = 3;
+  auto spool = [self createSpoolWithShards:kShards diskSize:1024 * 1024];
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kShards; ++i) {
+    threads.emplace_back([spool] {
+      spool->Write(std::vector<uint8_t>(64, 'B'));
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  spool->Flush();
+
+  std::optional<absl::flat_hash_set<std::string>> files = spool->GetFilesToExport(10);
+  XCTAssertTrue(files.has_value());
+  XCTAssertEqual(files->size(), kShards);
+
+  absl::flat_hash_map<std::string, bool> exported;
+  for (const auto& file : *files) {
+    exported[file] = true;
+  }
+  spool->FilesExported(std::move(exported));
+  // Acks are processed asynchronously, flushing waits for them to complete.
+  spool->Flush();
+
+  XCTAssertEqual([self spoolFileCount], 0);
+  XCTAssertFalse(spool->NextFileToExport().has_value());
+}
+
+- (void)testShardsShareSpoolSizeLimit {
+  const size_t kShards = 4;
+  const size_t kWriteSize = 1024;
+  // Room for about two spool files in total, even though there are more shards.
+  auto spool = [self createSpoolWithShards:kShards diskSize:2 * kWriteSize + kWriteSize / 2];
+
+  for (int round = 0; round < 4; ++round) {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kShards; ++i) {
+      threads.emplace_back([spool] {
+        spool->Write(std::vector<uint8_t>(kWriteSize, 'C'));
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    spool->Flush();
+  }
+
+  // The shards evict each other's files to stay under the shared limit rather
+  // than each shard filling its own allowance.
+  XCTAssertGreaterThan([self spoolFileCount], 0);
+  XCTAssertLessThanOrEqual([self spoolFileCount], 3);
+}
+
+@end
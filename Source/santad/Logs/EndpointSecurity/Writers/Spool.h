@@ -19,7 +19,9 @@
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -33,10 +35,13 @@
 #include "Source/common/santa.pb.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
+#include "Source/santad/SignalPrefilter.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 // Forward declarations
 namespace santa {
@@ -46,6 +51,11 @@ class SpoolPeer;
 
 namespace santa {
 
+// Writes the records of input_paths, in order, as a single spool file to
+// output_fd.
+using SpoolFileMerger =
+    std::function<absl::Status(const std::vector<std::string>& input_paths, int output_fd)>;
+
 template <::fsspool::BatcherInterface T>
 class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
  public:
@@ -53,13 +63,26 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   static std::shared_ptr<Spool<T>> Create(
       T batcher, std::string_view base_dir, size_t max_spool_disk_size, size_t max_spool_batch_size,
       uint64_t flush_timeout_ms,
-      void (^file_closed_f)(std::string, std::shared_ptr<santa::ScopedFile>) = nullptr) {
-    dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.file_base_q",
-                                               DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
-    dispatch_source_t timer_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
-    dispatch_source_set_timer(timer_source, dispatch_time(DISPATCH_TIME_NOW, 0),
-                              NSEC_PER_MSEC * flush_timeout_ms, 0);
+      void (^file_closed_f)(std::string, std::shared_ptr<santa::ScopedFile>,
+                            std::shared_ptr<const santa::SignalPrefilter>) = nullptr,
+      std::shared_ptr<const santa::SignalPrefilter> (^prefilter_f)(void) = nullptr) {
+    auto spool_index = MakeSpoolIndex(base_dir);
+    return CreateShard(std::move(batcher), base_dir, max_spool_disk_size, max_spool_batch_size,
+                       flush_timeout_ms, file_closed_f, prefilter_f, RegisterMetrics(spool_index),
+                       spool_index);
+  }
 
+  // Returns a new index of the spool directory under base_dir.
+  static std::shared_ptr<::fsspool::SpoolIndex> MakeSpoolIndex(std::string_view base_dir) {
+    return std::make_shared<::fsspool::SpoolIndex>(
+        ::fsspool::SpoolNewDirectory(absl::string_view(base_dir.data(), base_dir.length())));
+  }
+
+  // Registers the spool metrics for the spool directory tracked by spool_index and returns the
+  // eviction callback to pass to each Spool writing to it. Only one set of metrics should be
+  // registered per spool directory.
+  static std::function<void(size_t)> RegisterMetrics(
+      std::shared_ptr<::fsspool::SpoolIndex> spool_index) {
     // Records how many spool files are erased when the spool exceeds its size limit.
     SNTMetricCounter* eviction_counter = [[SNTMetricSet sharedInstance]
         counterWithName:@"/santa/spool/eviction_count"
@@ -74,16 +97,59 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
         int64GaugeWithName:@"/santa/spool/size_bytes"
                 fieldNames:@[]
                   helpText:@"Current on-disk size of the telemetry spool directory in bytes"];
-    std::string spool_dir =
-        ::fsspool::SpoolNewDirectory(absl::string_view(base_dir.data(), base_dir.length()));
     [[SNTMetricSet sharedInstance] registerCallback:^{
-      auto size = ::fsspool::EstimateDirSize(spool_dir);
+      auto size = spool_index->TotalSize();
       [size_gauge set:(size.ok() ? static_cast<long long>(*size) : 0) forFieldValues:@[]];
     }];
 
+    return eviction_callback;
+  }
+
+  // Returns a sync callback that counts the spool's flushes to stable storage and the time spent
+  // in them. Spools writing to the same directory share the metrics.
+  static ::fsspool::SyncCallback SyncMetricsCallback() {
+    SNTMetricCounter* sync_counter = [[SNTMetricSet sharedInstance]
+        counterWithName:@"/santa/spool/sync_count"
+             fieldNames:@[ @"target", @"result" ]
+               helpText:@"Number of flushes of spool files and directories to stable storage"];
+    SNTMetricCounter* sync_time_counter = [[SNTMetricSet sharedInstance]
+        counterWithName:@"/santa/spool/sync_time_usec"
+             fieldNames:@[ @"target" ]
+               helpText:@"Time spent flushing spool files and directories to stable storage"];
+    return [sync_counter, sync_time_counter](::fsspool::SyncTarget target,
+                                             absl::Duration duration, const absl::Status& status) {
+      NSString* target_name = target == ::fsspool::SyncTarget::kFile ? @"file" : @"directory";
+      if (!status.ok()) {
+        LOGW(@"Unable to flush spool %@ to stable storage: %s", target_name,
+             status.ToString().c_str());
+      }
+      [sync_counter incrementForFieldValues:@[ target_name, status.ok() ? @"ok" : @"error" ]];
+      [sync_time_counter incrementBy:absl::ToInt64Microseconds(duration)
+                      forFieldValues:@[ target_name ]];
+    };
+  }
+
+  // Creates a spool with its own queue and flush timer that reports evictions through the given
+  // callback and tracks the spool directory through spool_index, which may be shared with other
+  // spools writing to the same directory.
+  static std::shared_ptr<Spool<T>> CreateShard(
+      T batcher, std::string_view base_dir, size_t max_spool_disk_size, size_t max_spool_batch_size,
+      uint64_t flush_timeout_ms,
+      void (^file_closed_f)(std::string, std::shared_ptr<santa::ScopedFile>,
+                            std::shared_ptr<const santa::SignalPrefilter>),
+      std::shared_ptr<const santa::SignalPrefilter> (^prefilter_f)(void),
+      std::function<void(size_t)> eviction_callback,
+      std::shared_ptr<::fsspool::SpoolIndex> spool_index) {
+    dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.file_base_q",
+                                               DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+    dispatch_source_t timer_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
+    dispatch_source_set_timer(timer_source, dispatch_time(DISPATCH_TIME_NOW, 0),
+                              NSEC_PER_MSEC * flush_timeout_ms, 0);
+
     auto spool_writer = std::make_shared<Spool<T>>(
         q, timer_source, std::move(batcher), base_dir, max_spool_disk_size, max_spool_batch_size,
-        nullptr, nullptr, file_closed_f, std::move(eviction_callback));
+        nullptr, nullptr, file_closed_f, std::move(eviction_callback), std::move(spool_index),
+        prefilter_f);
 
     spool_writer->BeginFlushTask();
 
@@ -93,19 +159,26 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   Spool(dispatch_queue_t q, dispatch_source_t timer_source, T batcher, std::string_view base_dir,
         size_t max_spool_disk_size, size_t max_spool_file_size,
         void (^write_complete_f)(void) = nullptr, void (^flush_task_complete_f)(void) = nullptr,
-        void (^file_closed_f)(std::string, std::shared_ptr<santa::ScopedFile>) = nullptr,
-        std::function<void(size_t)> eviction_callback = nullptr)
+        void (^file_closed_f)(std::string, std::shared_ptr<santa::ScopedFile>,
+                              std::shared_ptr<const santa::SignalPrefilter>) = nullptr,
+        std::function<void(size_t)> eviction_callback = nullptr,
+        std::shared_ptr<::fsspool::SpoolIndex> spool_index = nullptr,
+        std::shared_ptr<const santa::SignalPrefilter> (^prefilter_f)(void) = nullptr)
       : q_(q),
         timer_source_(timer_source),
-        spool_reader_(absl::string_view(base_dir.data(), base_dir.length())),
+        tmp_dir_(
+            ::fsspool::SpoolTempDirectory(absl::string_view(base_dir.data(), base_dir.length()))),
+        spool_index_(spool_index ? std::move(spool_index) : MakeSpoolIndex(base_dir)),
+        spool_reader_(absl::string_view(base_dir.data(), base_dir.length()), spool_index_),
         spool_writer_(std::move(batcher), absl::string_view(base_dir.data(), base_dir.length()),
-                      max_spool_disk_size, std::move(eviction_callback)),
+                      max_spool_disk_size, std::move(eviction_callback), spool_index_),
         spool_file_size_threshold_(max_spool_file_size),
         spool_file_size_threshold_leniency_(spool_file_size_threshold_ *
                                             spool_file_size_threshold_leniency_factor_),
         write_complete_f_(write_complete_f),
         flush_task_complete_f_(flush_task_complete_f),
-        file_closed_f_(file_closed_f) {}
+        file_closed_f_(file_closed_f),
+        prefilter_f_(prefilter_f) {}
 
   ~Spool() {
     // Note: `log_batch_writer_` is automatically flushed when destroyed
@@ -124,6 +197,7 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
     // Workaround to move `bytes` into the block without a copy
     __block std::vector<uint8_t> temp_bytes = std::move(bytes);
 
+    pending_writes_.fetch_add(1, std::memory_order_relaxed);
     dispatch_async(q_, ^{
       std::vector<uint8_t> moved_bytes = std::move(temp_bytes);
 
@@ -135,6 +209,7 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
       // This will account for Flush failing above.
       // Use the more lenient threshold here in case the Flush failures are transitory.
       if (shared_this->accumulated_bytes_ < shared_this->spool_file_size_threshold_leniency_) {
+        shared_this->TagBatch(moved_bytes);
         size_t bytes_written = moved_bytes.size();
         auto status = shared_this->spool_writer_.Write(std::move(moved_bytes));
         if (!status.ok()) {
@@ -150,12 +225,16 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
         }
       }
 
+      shared_this->pending_writes_.fetch_sub(1, std::memory_order_relaxed);
+
       if (shared_this->write_complete_f_) {
         shared_this->write_complete_f_();
       }
     });
   }
 
+  size_t PendingWrites() const override { return pending_writes_.load(std::memory_order_relaxed); }
+
   void Flush() override {
     dispatch_sync(q_, ^{
       FlushSerialized();
@@ -190,6 +269,46 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
     });
   }
 
+  // Must be set before compacting, and not changed once exports have started.
+  void SetMerger(SpoolFileMerger merger) { merger_ = std::move(merger); }
+
+  // Applies to spool files completed from now on.
+  void SetDurability(::fsspool::Durability durability) {
+    ::fsspool::SyncCallback sync_callback = SyncMetricsCallback();
+    dispatch_sync(q_, ^{
+      spool_writer_.SetDurability(durability, sync_callback);
+    });
+  }
+
+  // Merges runs of spool files smaller than half of target_file_size, oldest first, into files of
+  // about target_file_size bytes. Each merged file takes the place and mtime of the oldest file in
+  // its run, so export and eviction order are unchanged. Files are reserved while they're merged
+  // so they aren't exported at the same time. Does nothing without a merger. Runs on the calling
+  // thread, so should be called from somewhere that can afford to wait, e.g. before an export.
+  size_t CompactSpool(size_t target_file_size) override {
+    if (!merger_) {
+      return 0;
+    }
+
+    absl::StatusOr<std::vector<::fsspool::DirEntryInfo>> files = spool_index_->FilesOldestFirst();
+    if (!files.ok()) {
+      return 0;
+    }
+
+    __block std::vector<std::vector<::fsspool::DirEntryInfo>> runs;
+    dispatch_sync(q_, ^{
+      runs = ReserveCompactionRunsSerialized(*files, target_file_size);
+    });
+
+    size_t merged = 0;
+    for (const std::vector<::fsspool::DirEntryInfo>& run : runs) {
+      if (MergeRun(run)) {
+        merged += run.size() - 1;
+      }
+    }
+    return merged;
+  }
+
   void BeginFlushTask() {
     if (flush_task_started_) {
       return;
@@ -219,12 +338,133 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   friend class santa::SpoolPeer<T>;
 
  private:
+  // Track whether the batch being written may be relevant to a signal scan. The prefilter is
+  // fetched once, when the batch's first message is written, and each message is checked against
+  // it until one may match. Runs on `q_`.
+  void TagBatch(const std::vector<uint8_t>& bytes) {
+    if (!batch_open_) {
+      batch_open_ = true;
+      batch_prefilter_ = prefilter_f_ ? prefilter_f_() : nullptr;
+      batch_may_match_ = !batch_prefilter_;
+    }
+    if (!batch_may_match_) {
+      batch_may_match_ = batch_prefilter_->MayMatch(bytes.data(), bytes.size());
+    }
+  }
+
+  // Reserves the runs of consecutive small files to merge. Runs of a single file are released
+  // again. Runs on `q_`.
+  std::vector<std::vector<::fsspool::DirEntryInfo>> ReserveCompactionRunsSerialized(
+      const std::vector<::fsspool::DirEntryInfo>& files, size_t target_file_size) {
+    std::vector<std::vector<::fsspool::DirEntryInfo>> runs;
+    std::vector<::fsspool::DirEntryInfo> run;
+    size_t run_size = 0;
+
+    auto end_run = [&] {
+      if (run.size() > 1) {
+        runs.push_back(std::move(run));
+      } else if (run.size() == 1) {
+        (void)spool_reader_.AckMessage(run[0].path, false);
+      }
+      run.clear();
+      run_size = 0;
+    };
+
+    for (const ::fsspool::DirEntryInfo& file : files) {
+      // Large files and files being exported end a run, so that merging never moves records past
+      // another file's.
+      if (file.occupancy >= target_file_size / 2 || !spool_reader_.TryReserve(file.path)) {
+        end_run();
+        continue;
+      }
+
+      run.push_back(file);
+      run_size += file.occupancy;
+      if (run_size >= target_file_size) {
+        end_run();
+      }
+    }
+    end_run();
+
+    return runs;
+  }
+
+  // Merges a reserved run into a temporary file, then renames it over the oldest file in the run
+  // and deletes the rest. A crash in between leaves some records in two files, which are then
+  // exported twice rather than lost. Releases the run's reservations.
+  bool MergeRun(const std::vector<::fsspool::DirEntryInfo>& run) {
+    const ::fsspool::DirEntryInfo& oldest = run.front();
+    std::string tmp_path = absl::StrCat(tmp_dir_, ::fsspool::PathSeparator(), "compact_",
+                                        oldest.path.substr(oldest.path.rfind('/') + 1));
+
+    std::vector<std::string> paths;
+    for (const ::fsspool::DirEntryInfo& file : run) {
+      paths.push_back(file.path);
+    }
+
+    absl::Status status = ::fsspool::MkDir(tmp_dir_);
+    int fd = -1;
+    if (status.ok()) {
+      fd = ::fsspool::Open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0400);
+      if (fd < 0) {
+        status = absl::ErrnoToStatus(errno, "open() failed");
+      }
+    }
+    if (status.ok()) {
+      status = merger_(paths, fd);
+    }
+
+    ::fsspool::DirEntryInfo merged = {
+        .path = oldest.path,
+        .mtime = oldest.mtime,
+        .occupancy = 0,
+    };
+    if (fd >= 0) {
+      struct timespec times[2] = {{.tv_sec = oldest.mtime}, {.tv_sec = oldest.mtime}};
+      struct stat sb;
+      if (status.ok() && (futimens(fd, times) != 0 || fstat(fd, &sb) != 0)) {
+        status = absl::ErrnoToStatus(errno, "Failed to update merged spool file");
+      } else if (status.ok()) {
+        merged.occupancy = static_cast<size_t>(sb.st_blocks) * 512;
+      }
+      ::fsspool::Close(fd);
+    }
+
+    if (status.ok()) {
+      status = ::fsspool::RenameFile(tmp_path, oldest.path);
+    }
+    if (!status.ok()) {
+      LOGW(@"Spool: failed to merge %zu files: %s", run.size(), status.ToString().c_str());
+      (void)::fsspool::Unlink(tmp_path.c_str());
+    }
+
+    bool ok = status.ok();
+    dispatch_sync(q_, ^{
+      if (ok) {
+        spool_index_->Add(merged);
+      }
+      for (size_t i = 0; i < paths.size(); i++) {
+        (void)spool_reader_.AckMessage(paths[i], ok && i > 0);
+      }
+    });
+    return ok;
+  }
+
   bool FlushSerialized() {
     absl::StatusOr<std::optional<std::string>> result = spool_writer_.Flush();
     if (!result.ok()) {
       return false;
     }
     accumulated_bytes_ = 0;
+
+    // Only a batch in which no message could match is scanned as clean, and only against the
+    // prefilter it was checked with.
+    std::shared_ptr<const santa::SignalPrefilter> clean_under =
+        batch_may_match_ ? nullptr : std::move(batch_prefilter_);
+    batch_prefilter_.reset();
+    batch_open_ = false;
+    batch_may_match_ = false;
+
     // A spool file was just closed (renamed into the spool dir). Hand its path and a read-only fd
     // off to the file-closed callback. The callback MUST be cheap (it runs on this serial queue
     // `q_`) — it should dispatch any real work elsewhere.
@@ -245,13 +485,17 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
         LOGW(@"Spool: failed to open closed file for signal scan: %s (errno %d)",
              closed_path.c_str(), errno);
       }
-      file_closed_f_(closed_path, std::move(scoped_file));
+      file_closed_f_(closed_path, std::move(scoped_file), std::move(clean_under));
     }
     return true;
   }
 
   dispatch_queue_t q_ = NULL;
   dispatch_source_t timer_source_ = NULL;
+  const std::string tmp_dir_;
+  SpoolFileMerger merger_;
+  // Shared by the reader and writer so that exported files are accounted for.
+  std::shared_ptr<::fsspool::SpoolIndex> spool_index_;
   ::fsspool::FsSpoolReader spool_reader_;
   ::fsspool::FsSpoolWriter<T> spool_writer_;
   const size_t spool_file_size_threshold_;
@@ -262,9 +506,17 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   bool flush_task_started_ = false;
   void (^write_complete_f_)(void);
   void (^flush_task_complete_f_)(void);
-  void (^file_closed_f_)(std::string, std::shared_ptr<santa::ScopedFile>);
+  void (^file_closed_f_)(std::string, std::shared_ptr<santa::ScopedFile>,
+                        std::shared_ptr<const santa::SignalPrefilter>);
+  std::shared_ptr<const santa::SignalPrefilter> (^prefilter_f_)(void);
+
+  // State of the batch currently being written, see TagBatch.
+  bool batch_open_ = false;
+  bool batch_may_match_ = false;
+  std::shared_ptr<const santa::SignalPrefilter> batch_prefilter_;
 
   size_t accumulated_bytes_ = 0;
+  std::atomic<size_t> pending_writes_{0};
 };
 
 }  // namespace santa
@@ -18,12 +18,15 @@
 #include <dispatch/dispatch.h>
 #include <unistd.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "Source/common/TestUtils.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Spool.h"
+#include "Source/santad/SignalPrefilter.h"
 
 namespace santa {
 
@@ -208,4 +211,99 @@ using santa::SpoolPeer;
   XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:&err] count], 2);
 }
 
+- (void)testFileClosedReportsCleanBatches {
+  dispatch_semaphore_t semaWrite = dispatch_semaphore_create(0);
+  auto prefilter = std::make_shared<const santa::SignalPrefilter>(std::vector<std::string>{"EVIL"});
+  __block std::vector<std::shared_ptr<const santa::SignalPrefilter>> closed;
+
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
+      1024,
+      ^{
+        dispatch_semaphore_signal(semaWrite);
+      },
+      nullptr,
+      ^(std::string path, std::shared_ptr<santa::ScopedFile> file,
+        std::shared_ptr<const santa::SignalPrefilter> clean_under) {
+        XCTAssertTrue(file != nullptr);
+        closed.push_back(std::move(clean_under));
+      },
+      nullptr, nullptr,
+      ^std::shared_ptr<const santa::SignalPrefilter>() {
+        return prefilter;
+      });
+
+  // No message in the batch contains a literal
+  spool->Write(std::vector<uint8_t>(50, 'A'));
+  spool->Write(std::vector<uint8_t>(50, 'B'));
+  XCTAssertSemaTrue(semaWrite, 5, "First write didn't complete within expected window");
+  XCTAssertSemaTrue(semaWrite, 5, "Second write didn't complete within expected window");
+  XCTAssertTrue(spool->FlushSerialized());
+
+  // One message does
+  std::string evil = "xxEVILxx";
+  spool->Write(std::vector<uint8_t>(50, 'C'));
+  spool->Write(std::vector<uint8_t>(evil.begin(), evil.end()));
+  XCTAssertSemaTrue(semaWrite, 5, "Third write didn't complete within expected window");
+  XCTAssertSemaTrue(semaWrite, 5, "Fourth write didn't complete within expected window");
+  XCTAssertTrue(spool->FlushSerialized());
+
+  XCTAssertEqual(closed.size(), 2);
+  XCTAssertTrue(closed[0] == prefilter);
+  XCTAssertTrue(closed[1] == nullptr);
+}
+
+- (void)testCompactSpool {
+  dispatch_semaphore_t semaWrite = dispatch_semaphore_create(0);
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
+      1024, ^{
+        dispatch_semaphore_signal(semaWrite);
+      });
+
+  // Nothing is merged without a merger
+  XCTAssertEqual(spool->CompactSpool(1024 * 1024), 0);
+
+  // Uncompressed stream files can simply be concatenated
+  spool->SetMerger([](const std::vector<std::string>& input_paths, int output_fd) {
+    for (const std::string& path : input_paths) {
+      NSData* data = [NSData dataWithContentsOfFile:@(path.c_str())];
+      absl::Status status = ::fsspool::WriteBuffer(
+          output_fd, absl::string_view(static_cast<const char*>(data.bytes), data.length));
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return absl::OkStatus();
+  });
+
+  NSMutableData* want = [NSMutableData data];
+  for (char c : std::string("ABC")) {
+    spool->Write(std::vector<uint8_t>(50, c));
+    XCTAssertSemaTrue(semaWrite, 5, "Write didn't complete within expected window");
+    XCTAssertTrue(spool->FlushSerialized());
+  }
+
+  // Files are merged in the order they were written
+  NSArray<NSString*>* files = [[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil]
+      sortedArrayUsingSelector:@selector(compare:)];
+  XCTAssertEqual(files.count, 3);
+  for (NSString* file in files) {
+    NSString* path = [self.spoolDir stringByAppendingPathComponent:file];
+    [want appendData:[NSData dataWithContentsOfFile:path]];
+  }
+
+  XCTAssertEqual(spool->CompactSpool(1024 * 1024), 2);
+
+  NSArray<NSString*>* compacted = [self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:nil];
+  XCTAssertEqual(compacted.count, 1);
+  XCTAssertEqualObjects(compacted.firstObject, files.firstObject);
+  NSString* mergedPath = [self.spoolDir stringByAppendingPathComponent:compacted.firstObject];
+  XCTAssertEqualObjects([NSData dataWithContentsOfFile:mergedPath], want);
+
+  // The merged file is exported like any other
+  XCTAssertTrue(spool->NextFileToExport().has_value());
+  XCTAssertFalse(spool->NextFileToExport().has_value());
+}
+
 @end
@@ -17,6 +17,8 @@
 
 #include <os/log.h>
 
+#include "Source/common/BufferPool.h"
+
 namespace santa {
 
 // Max length of data that should be displayed in a single line.
@@ -29,7 +31,13 @@ std::shared_ptr<Syslog> Syslog::Create() {
 }
 
 void Syslog::Write(std::vector<uint8_t>&& bytes) {
+  // Serializers that log straight to the unified logging system return
+  // nothing to write.
+  if (bytes.empty()) {
+    return;
+  }
   os_log(OS_LOG_DEFAULT, "%{public}.*s", (int)std::min(kMaxLineLength, bytes.size()), bytes.data());
+  BufferPool::Shared().Release(std::move(bytes));
 }
 
 void Syslog::Flush() {
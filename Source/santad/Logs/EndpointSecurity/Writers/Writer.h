@@ -16,6 +16,7 @@
 #ifndef SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_WRITER_H
 #define SANTA_SANTAD_LOGS_ENDPOINTSECURITY_WRITERS_WRITER_H
 
+#include <cstddef>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -43,6 +44,15 @@ class Writer {
       absl::flat_hash_map<std::string, bool> files_exported) {
     // no-op
   }
+
+  // Number of writes that have been accepted but not yet processed, for
+  // writers that process writes asynchronously.
+  virtual size_t PendingWrites() const { return 0; }
+
+  // Merges runs of small files waiting to be exported into files of about
+  // target_file_size bytes, for writers that support it. Returns the number of
+  // files merged away.
+  virtual size_t CompactSpool(size_t target_file_size) { return 0; }
 };
 
 }  // namespace santa
@@ -20,10 +20,12 @@
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
 
+#include <array>
 #include <atomic>
 #include <memory>
 #include <string>
 
+#include "Source/common/LatencyHistogram.h"
 #import "Source/common/MOLXPCConnection.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTMetricSet.h"
@@ -51,12 +53,17 @@ using FileAccessEventCountTuple =
 
 NSString* const EventTypeToString(es_event_type_t eventType);
 
+// Record how long a phase of santad startup took, from start_uptime_ns (as
+// returned by GetCurrentUptime) until now.
+void RecordStartupPhase(SNTMetricSet* metric_set, NSString* phase, uint64_t start_uptime_ns);
+
 class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Metrics> {
  public:
   static std::shared_ptr<Metrics> Create(SNTMetricSet* metric_set, uint64_t interval);
 
   Metrics(dispatch_queue_t q, dispatch_source_t timer_source, uint64_t interval,
-          SNTMetricInt64Gauge* event_processing_times, SNTMetricCounter* event_counts,
+          SNTMetricInt64Gauge* event_processing_times, SNTMetricInt64Gauge* event_latencies,
+          SNTMetricCounter* event_counts,
           SNTMetricCounter* rate_limit_counts, SNTMetricCounter* drop_counts,
           SNTMetricCounter* faa_event_counts, SNTMetricSet* metric_set,
           void (^run_on_first_start)(Metrics*));
@@ -79,7 +86,10 @@ class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Me
   void SetEventMetrics(Processor processor, EventDisposition disposition, int64_t nanos,
                        es_event_type_t event_type) override;
 
-  void AddRateLimitingMetrics(int64_t events_rate_limited_count);
+  void RecordEventLatency(Processor processor, es_event_type_t event_type, EventLatencyStage stage,
+                          int64_t nanos) override;
+
+  void AddRateLimitingMetrics(std::string key, int64_t events_rate_limited_count);
 
   void SetFileAccessEventMetrics(std::string policy_version, std::string rule_name,
                                  FileAccessMetricStatus status, es_event_type_t event_type,
@@ -93,6 +103,19 @@ class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Me
     int64_t drops = 0;
   };
 
+  // One histogram per EventLatencyStage.
+  struct EventLatencies {
+    std::array<LatencyHistogram, 3> stages;
+  };
+
+  // Processor values are contiguous, starting at kUnknown.
+  static constexpr size_t kNumProcessors =
+      static_cast<size_t>(Processor::kProcessFileAccessAuthorizer) + 1;
+  static constexpr size_t kNumEventLatencySlots = kNumProcessors * ES_EVENT_TYPE_LAST;
+
+  EventLatencies* GetEventLatencies(Processor processor, es_event_type_t event_type);
+  void FlushEventLatencies();
+
   void FlushMetrics();
   void ExportSerialized(SNTMetricSet* metric_set);
   void ExportSerialized(SNTMetricSet* metric_set, void (^reply)(BOOL));
@@ -102,6 +125,7 @@ class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Me
   dispatch_source_t timer_source_;
   uint64_t interval_;
   SNTMetricInt64Gauge* event_processing_times_;
+  SNTMetricInt64Gauge* event_latencies_;
   SNTMetricCounter* event_counts_;
   SNTMetricCounter* rate_limit_counts_;
   SNTMetricCounter* faa_event_counts_;
@@ -120,9 +144,13 @@ class Metrics : public ESMetricsObserver, public std::enable_shared_from_this<Me
   // Small caches for storing event metrics between metrics export operations
   absl::flat_hash_map<EventCountTuple, int64_t> event_counts_cache_;
   absl::flat_hash_map<EventTimesTuple, int64_t> event_times_cache_;
-  std::atomic<int64_t> rate_limit_counts_cache_;
+  absl::flat_hash_map<std::string, int64_t> rate_limit_counts_cache_;
   absl::flat_hash_map<FileAccessEventCountTuple, int64_t> faa_event_counts_cache_;
   absl::flat_hash_map<EventStatsTuple, SequenceStats> drop_cache_;
+
+  // Latency histograms indexed by processor and event type, created on first
+  // use and never freed until destruction, so recording never takes a lock.
+  std::array<std::atomic<EventLatencies*>, kNumEventLatencySlots> event_latencies_cache_ = {};
 };
 
 }  // namespace santa
@@ -17,11 +17,14 @@
 
 #include <EndpointSecurity/ESTypes.h>
 
+#include <array>
 #include <memory>
+#include <utility>
 
 #include "Source/common/Platform.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTXPCMetricServiceInterface.h"
+#include "Source/common/SystemResources.h"
 #import "Source/santad/SNTApplicationCoreMetrics.h"
 
 static NSString* const kProcessorAuthorizer = @"Authorizer";
@@ -85,6 +88,10 @@ static NSString* const kEventTypeNotifyTCCModification = @"NotifyTCCModification
 static NSString* const kEventDispositionDropped = @"Dropped";
 static NSString* const kEventDispositionProcessed = @"Processed";
 
+static NSString* const kEventLatencyStageQueued = @"Queued";
+static NSString* const kEventLatencyStageHandler = @"Handler";
+static NSString* const kEventLatencyStageDeadlineSlack = @"DeadlineSlack";
+
 static NSString* const kStatChangeStepNoChange = @"NoChange";
 static NSString* const kStatChangeStepMessageCreate = @"MessageCreate";
 static NSString* const kStatChangeStepCodesignValidation = @"CodesignValidation";
@@ -189,6 +196,18 @@ NSString* const EventDispositionToString(EventDisposition d) {
   }
 }
 
+NSString* const EventLatencyStageToString(EventLatencyStage stage) {
+  switch (stage) {
+    case EventLatencyStage::kQueued: return kEventLatencyStageQueued;
+    case EventLatencyStage::kHandler: return kEventLatencyStageHandler;
+    case EventLatencyStage::kDeadlineSlack: return kEventLatencyStageDeadlineSlack;
+    default:
+      [NSException raise:@"Invalid latency stage"
+                  format:@"Unknown latency stage value: %d", static_cast<int>(stage)];
+      return nil;
+  }
+}
+
 NSString* const FileAccessMetricStatusToString(FileAccessMetricStatus status) {
   switch (status) {
     case FileAccessMetricStatus::kOK: return kFileAccessMetricStatusOK;
@@ -215,6 +234,15 @@ NSString* const FileAccessPolicyDecisionToString(FileAccessPolicyDecision decisi
   }
 }
 
+void RecordStartupPhase(SNTMetricSet* metric_set, NSString* phase, uint64_t start_uptime_ns) {
+  SNTMetricInt64Gauge* phase_durations =
+      [metric_set int64GaugeWithName:@"/santa/startup/phase_duration_ms"
+                          fieldNames:@[ @"Phase" ]
+                            helpText:@"Time taken by each phase of santad startup in milliseconds"];
+  uint64_t elapsed_ns = GetCurrentUptime() - start_uptime_ns;
+  [phase_durations set:(long long)(elapsed_ns / NSEC_PER_MSEC) forFieldValues:@[ phase ]];
+}
+
 std::shared_ptr<Metrics> Metrics::Create(SNTMetricSet* metric_set, uint64_t interval) {
   dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.santametricsservice.q",
                                              DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
@@ -226,6 +254,12 @@ std::shared_ptr<Metrics> Metrics::Create(SNTMetricSet* metric_set, uint64_t inte
                           fieldNames:@[ @"Processor", @"Event" ]
                             helpText:@"Time to process various event types by each processor"];
 
+  SNTMetricInt64Gauge* event_latencies = [metric_set
+      int64GaugeWithName:@"/santa/event_latency"
+              fieldNames:@[ @"Processor", @"Event", @"Stage", @"Percentile" ]
+                helpText:@"Latency percentiles in nanoseconds for each processor and event type "
+                         @"since the previous export"];
+
   SNTMetricCounter* event_counts =
       [metric_set counterWithName:@"/santa/event_count"
                        fieldNames:@[ @"Processor", @"Event", @"Disposition" ]
@@ -233,7 +267,7 @@ std::shared_ptr<Metrics> Metrics::Create(SNTMetricSet* metric_set, uint64_t inte
 
   SNTMetricCounter* rate_limit_counts =
       [metric_set counterWithName:@"/santa/rate_limit_count"
-                       fieldNames:@[]
+                       fieldNames:@[ @"Key" ]
                          helpText:@"Number of FAA events rate limited"];
 
   SNTMetricCounter* faa_event_counts = [metric_set
@@ -249,7 +283,8 @@ std::shared_ptr<Metrics> Metrics::Create(SNTMetricSet* metric_set, uint64_t inte
                          helpText:@"Count of the number of drops for each event"];
 
   std::shared_ptr<Metrics> metrics = std::make_shared<Metrics>(
-      q, timer_source, interval, event_processing_times, event_counts, rate_limit_counts,
+      q, timer_source, interval, event_processing_times, event_latencies, event_counts,
+      rate_limit_counts,
       faa_event_counts, drop_counts, metric_set, ^(Metrics* metrics) {
         SNTRegisterCoreMetrics();
         metrics->EstablishConnection();
@@ -269,7 +304,8 @@ std::shared_ptr<Metrics> Metrics::Create(SNTMetricSet* metric_set, uint64_t inte
 }
 
 Metrics::Metrics(dispatch_queue_t q, dispatch_source_t timer_source, uint64_t interval,
-                 SNTMetricInt64Gauge* event_processing_times, SNTMetricCounter* event_counts,
+                 SNTMetricInt64Gauge* event_processing_times, SNTMetricInt64Gauge* event_latencies,
+                 SNTMetricCounter* event_counts,
                  SNTMetricCounter* rate_limit_counts, SNTMetricCounter* faa_event_counts,
                  SNTMetricCounter* drop_counts, SNTMetricSet* metric_set,
                  void (^run_on_first_start)(Metrics*))
@@ -277,13 +313,13 @@ Metrics::Metrics(dispatch_queue_t q, dispatch_source_t timer_source, uint64_t in
       timer_source_(timer_source),
       interval_(interval),
       event_processing_times_(event_processing_times),
+      event_latencies_(event_latencies),
       event_counts_(event_counts),
       rate_limit_counts_(rate_limit_counts),
       faa_event_counts_(faa_event_counts),
       drop_counts_(drop_counts),
       metric_set_(metric_set),
-      run_on_first_start_(run_on_first_start),
-      rate_limit_counts_cache_(0) {
+      run_on_first_start_(run_on_first_start) {
   SetInterval(interval_);
 
   events_q_ = dispatch_queue_create("com.northpolesec.santa.santametricsservice.events_q",
@@ -302,6 +338,10 @@ Metrics::~Metrics() {
     dispatch_source_cancel(timer_source_);
     dispatch_resume(timer_source_);
   }
+
+  for (auto& slot : event_latencies_cache_) {
+    delete slot.load(std::memory_order_relaxed);
+  }
 }
 
 void Metrics::EstablishConnection() {
@@ -356,10 +396,9 @@ void Metrics::FlushMetrics() {
       [event_processing_times_ set:kv.second forFieldValues:@[ processorName, eventName ]];
     }
 
-    // NB: Must use exchange here to atomically fetch the old value and reset the count. Doing
-    // both operations atomically means a dispatch queue is not needed in AddRateLimitingMetrics().
-    [rate_limit_counts_ incrementBy:rate_limit_counts_cache_.exchange(0, std::memory_order_relaxed)
-                     forFieldValues:@[]];
+    for (const auto& kv : rate_limit_counts_cache_) {
+      [rate_limit_counts_ incrementBy:kv.second forFieldValues:@[ @(kv.first.c_str()) ]];
+    }
 
     for (const auto& kv : faa_event_counts_cache_) {
       NSString* policyVersion = @(std::get<0>(kv.first).c_str());  // FileAccessMetricsPolicyVersion
@@ -394,8 +433,48 @@ void Metrics::FlushMetrics() {
     // for accurate accounting
     event_counts_cache_ = {};
     event_times_cache_ = {};
+    rate_limit_counts_cache_ = {};
     faa_event_counts_cache_ = {};
   });
+
+  FlushEventLatencies();
+}
+
+void Metrics::FlushEventLatencies() {
+  // Queueing and handler latencies matter at the high end, deadline slack at
+  // the low end.
+  using Percentiles = std::array<std::pair<NSString*, double>, 5>;
+  static const Percentiles kHighPercentiles = {
+      {{@"p50", 50.0}, {@"p90", 90.0}, {@"p99", 99.0}, {@"p99.9", 99.9}, {@"p100", 100.0}}};
+  static const Percentiles kLowPercentiles = {
+      {{@"p50", 50.0}, {@"p10", 10.0}, {@"p1", 1.0}, {@"p0.1", 0.1}, {@"p0", 0.0}}};
+
+  for (size_t i = 0; i < kNumEventLatencySlots; i++) {
+    EventLatencies* latencies = event_latencies_cache_[i].load(std::memory_order_acquire);
+    if (!latencies) {
+      continue;
+    }
+
+    NSString* processorName = ProcessorToString(static_cast<Processor>(i / ES_EVENT_TYPE_LAST));
+    NSString* eventName = EventTypeToString(static_cast<es_event_type_t>(i % ES_EVENT_TYPE_LAST));
+
+    for (size_t stage = 0; stage < latencies->stages.size(); stage++) {
+      // Each export covers the values recorded since the previous one
+      LatencyHistogram::Snapshot snapshot = latencies->stages[stage].TakeSnapshot(true);
+      if (snapshot.Count() == 0) {
+        continue;
+      }
+
+      EventLatencyStage latencyStage = static_cast<EventLatencyStage>(stage);
+      NSString* stageName = EventLatencyStageToString(latencyStage);
+      const Percentiles& percentiles =
+          latencyStage == EventLatencyStage::kDeadlineSlack ? kLowPercentiles : kHighPercentiles;
+      for (const auto& [name, percentile] : percentiles) {
+        [event_latencies_ set:(long long)snapshot.ValueAtPercentile(percentile)
+               forFieldValues:@[ processorName, eventName, stageName, name ]];
+      }
+    }
+  }
 }
 
 void Metrics::SetInterval(uint64_t interval) {
@@ -444,6 +523,37 @@ void Metrics::SetEventMetrics(Processor processor, EventDisposition disposition,
   });
 }
 
+Metrics::EventLatencies* Metrics::GetEventLatencies(Processor processor,
+                                                   es_event_type_t event_type) {
+  size_t processor_index = static_cast<size_t>(processor);
+  if (processor_index >= kNumProcessors || event_type >= ES_EVENT_TYPE_LAST) {
+    return nullptr;
+  }
+
+  std::atomic<EventLatencies*>& slot =
+      event_latencies_cache_[processor_index * ES_EVENT_TYPE_LAST + event_type];
+  EventLatencies* latencies = slot.load(std::memory_order_acquire);
+  if (latencies) {
+    return latencies;
+  }
+
+  // Racing threads may both allocate, in which case the loser frees its copy.
+  EventLatencies* created = new EventLatencies();
+  if (slot.compare_exchange_strong(latencies, created, std::memory_order_acq_rel)) {
+    return created;
+  }
+  delete created;
+  return latencies;
+}
+
+void Metrics::RecordEventLatency(Processor processor, es_event_type_t event_type,
+                                 EventLatencyStage stage, int64_t nanos) {
+  EventLatencies* latencies = GetEventLatencies(processor, event_type);
+  if (latencies) {
+    latencies->stages[static_cast<size_t>(stage)].Record(nanos);
+  }
+}
+
 void Metrics::UpdateEventStats(Processor processor, es_event_type_t event_type, uint64_t seq_num,
                                uint64_t global_seq_num) {
   dispatch_async(events_q_, ^{
@@ -480,8 +590,10 @@ void Metrics::UpdateEventStats(Processor processor, es_event_type_t event_type,
   });
 }
 
-void Metrics::AddRateLimitingMetrics(int64_t events_rate_limited_count) {
-  rate_limit_counts_cache_.fetch_add(events_rate_limited_count, std::memory_order_relaxed);
+void Metrics::AddRateLimitingMetrics(std::string key, int64_t events_rate_limited_count) {
+  dispatch_async(events_q_, ^{
+    rate_limit_counts_cache_[key] += events_rate_limited_count;
+  });
 }
 
 void Metrics::SetFileAccessEventMetrics(std::string policy_version, std::string rule_name,
@@ -32,6 +32,7 @@
 
 using santa::EventCountTuple;
 using santa::EventDisposition;
+using santa::EventLatencyStage;
 using santa::EventStatsTuple;
 using santa::EventTimesTuple;
 using santa::FileAccessEventCountTuple;
@@ -42,6 +43,7 @@ namespace santa {
 extern NSString* const ProcessorToString(Processor processor);
 extern NSString* const EventTypeToString(es_event_type_t eventType);
 extern NSString* const EventDispositionToString(EventDisposition d);
+extern NSString* const EventLatencyStageToString(EventLatencyStage stage);
 extern NSString* const FileAccessMetricStatusToString(FileAccessMetricStatus status);
 extern NSString* const FileAccessPolicyDecisionToString(FileAccessPolicyDecision decision);
 
@@ -51,6 +53,7 @@ class MetricsPeer : public Metrics {
   using Metrics::Metrics;
 
   // Private methods
+  using Metrics::FlushEventLatencies;
   using Metrics::FlushMetrics;
 
   // Private member variables
@@ -75,6 +78,7 @@ class MetricsPeer : public Metrics {
 }  // namespace santa
 
 using santa::EventDispositionToString;
+using santa::EventLatencyStageToString;
 using santa::EventTypeToString;
 using santa::FileAccessMetricStatus;
 using santa::FileAccessMetricStatusToString;
@@ -85,7 +89,7 @@ using santa::ProcessorToString;
 
 std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^block)(Metrics*)) {
   dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
-  return std::make_shared<MetricsPeer>(q, timer, 100, nil, nil, nil, nil, nil, nil, block);
+  return std::make_shared<MetricsPeer>(q, timer, 100, nil, nil, nil, nil, nil, nil, nil, block);
 }
 
 @interface MetricsTest : XCTestCase
@@ -234,6 +238,20 @@ std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^b
   XCTAssertThrows(EventDispositionToString((EventDisposition)12345));
 }
 
+- (void)testEventLatencyStageToString {
+  std::map<EventLatencyStage, NSString*> stageToString = {
+      {EventLatencyStage::kQueued, @"Queued"},
+      {EventLatencyStage::kHandler, @"Handler"},
+      {EventLatencyStage::kDeadlineSlack, @"DeadlineSlack"},
+  };
+
+  for (const auto& kv : stageToString) {
+    XCTAssertEqualObjects(EventLatencyStageToString(kv.first), kv.second);
+  }
+
+  XCTAssertThrows(EventLatencyStageToString((EventLatencyStage)12345));
+}
+
 - (void)testFileAccessMetricStatusToString {
   std::map<FileAccessMetricStatus, NSString*> statusToString = {
       {FileAccessMetricStatus::kOK, @"OK"},
@@ -317,19 +335,24 @@ std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^b
   std::shared_ptr<MetricsPeer> metrics = CreateBasicMetricsPeer(self.q, ^(Metrics*){
                                                                 });
 
-  // Initial count is zero
-  XCTAssertEqual(metrics->rate_limit_counts_cache_.load(), 0);
+  // Initial map is empty
+  XCTAssertEqual(metrics->rate_limit_counts_cache_.size(), 0);
 
   // Check counts after setting metrics once
-  metrics->AddRateLimitingMetrics(123);
-  XCTAssertEqual(metrics->rate_limit_counts_cache_.load(), 123);
+  metrics->AddRateLimitingMetrics("foo", 123);
+  metrics->DrainEventQueue();
+  XCTAssertEqual(metrics->rate_limit_counts_cache_.size(), 1);
+  XCTAssertEqual(metrics->rate_limit_counts_cache_["foo"], 123);
 
   // Re-check expected counts. One was an update, so should only be 2 items
-  metrics->AddRateLimitingMetrics(100);
-  metrics->AddRateLimitingMetrics(200);
+  metrics->AddRateLimitingMetrics("foo", 100);
+  metrics->AddRateLimitingMetrics("bar", 200);
+  metrics->DrainEventQueue();
 
-  // Check final value
-  XCTAssertEqual(metrics->rate_limit_counts_cache_.load(), 423);
+  // Check final values
+  XCTAssertEqual(metrics->rate_limit_counts_cache_.size(), 2);
+  XCTAssertEqual(metrics->rate_limit_counts_cache_["foo"], 223);
+  XCTAssertEqual(metrics->rate_limit_counts_cache_["bar"], 200);
 }
 
 - (void)testSetFileAccessEventMetrics {
@@ -427,9 +450,9 @@ std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^b
 
   dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.q);
   auto metrics =
-      std::make_shared<MetricsPeer>(self.q, timer, 100, mockEventProcessingTimes, mockEventCounts,
-                                    mockEventCounts, mockEventCounts, mockEventCounts, nil,
-                                    ^(santa::Metrics* m){
+      std::make_shared<MetricsPeer>(self.q, timer, 100, mockEventProcessingTimes, nil,
+                                    mockEventCounts, mockEventCounts, mockEventCounts,
+                                    mockEventCounts, nil, ^(santa::Metrics* m){
                                         // This block intentionally left blank
                                     });
 
@@ -438,7 +461,7 @@ std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^b
   metrics->SetEventMetrics(Processor::kAuthorizer, EventDisposition::kProcessed, nanos * 2,
                            ES_EVENT_TYPE_AUTH_OPEN);
   metrics->UpdateEventStats(Processor::kRecorder, ES_EVENT_TYPE_NOTIFY_EXEC, 123, 123);
-  metrics->AddRateLimitingMetrics(123);
+  metrics->AddRateLimitingMetrics("rule_abc", 123);
   metrics->SetFileAccessEventMetrics("v1.0", "rule_abc", FileAccessMetricStatus::kOK,
                                      ES_EVENT_TYPE_AUTH_OPEN, FileAccessPolicyDecision::kDenied);
   metrics->DrainEventQueue();
@@ -446,7 +469,8 @@ std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^b
   // First ensure we have the expected map sizes
   XCTAssertEqual(metrics->event_counts_cache_.size(), 2);
   XCTAssertEqual(metrics->event_times_cache_.size(), 2);
-  XCTAssertEqual(metrics->rate_limit_counts_cache_.load(), 123);
+  XCTAssertEqual(metrics->rate_limit_counts_cache_.size(), 1);
+  XCTAssertEqual(metrics->rate_limit_counts_cache_["rule_abc"], 123);
   XCTAssertEqual(metrics->faa_event_counts_cache_.size(), 1);
   XCTAssertEqual(metrics->drop_cache_.size(), 2);
 
@@ -473,7 +497,7 @@ std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^b
   // After a flush, map sizes should be reset to 0
   XCTAssertEqual(metrics->event_counts_cache_.size(), 0);
   XCTAssertEqual(metrics->event_times_cache_.size(), 0);
-  XCTAssertEqual(metrics->rate_limit_counts_cache_.load(), 0);
+  XCTAssertEqual(metrics->rate_limit_counts_cache_.size(), 0);
   XCTAssertEqual(metrics->faa_event_counts_cache_.size(), 0);
   // Note: The drop_cache_ should not be reset back to size 0. Instead, each
   // entry has the sequence number left intact, but drop counts reset to 0.
@@ -484,4 +508,59 @@ std::shared_ptr<MetricsPeer> CreateBasicMetricsPeer(dispatch_queue_t q, void (^b
   XCTAssertEqual(metrics->drop_cache_[globalStats].drops, 0);
 }
 
+- (void)testFlushEventLatencies {
+  id mockEventLatencies = OCMClassMock([SNTMetricInt64Gauge class]);
+  NSMutableDictionary<NSString*, NSNumber*>* reported = [NSMutableDictionary dictionary];
+
+  OCMStub([(SNTMetricInt64Gauge*)mockEventLatencies set:0 forFieldValues:[OCMArg any]])
+      .ignoringNonObjectArgs()
+      .andDo(^(NSInvocation* inv) {
+        long long value;
+        __unsafe_unretained NSArray<NSString*>* fieldValues;
+        [inv getArgument:&value atIndex:2];
+        [inv getArgument:&fieldValues atIndex:3];
+        reported[[fieldValues componentsJoinedByString:@","]] = @(value);
+      });
+
+  dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.q);
+  auto metrics = std::make_shared<MetricsPeer>(self.q, timer, 100, nil, mockEventLatencies, nil,
+                                               nil, nil, nil, nil, ^(santa::Metrics* m){
+                                                   // This block intentionally left blank
+                                               });
+
+  for (int i = 1; i <= 100; i++) {
+    metrics->RecordEventLatency(Processor::kAuthorizer, ES_EVENT_TYPE_AUTH_EXEC,
+                                EventLatencyStage::kHandler, i * 1000);
+  }
+  metrics->RecordEventLatency(Processor::kAuthorizer, ES_EVENT_TYPE_AUTH_EXEC,
+                              EventLatencyStage::kDeadlineSlack, 5000);
+
+  // Out of range keys are ignored
+  metrics->RecordEventLatency((Processor)12345, ES_EVENT_TYPE_AUTH_EXEC,
+                              EventLatencyStage::kHandler, 1);
+  metrics->RecordEventLatency(Processor::kAuthorizer, ES_EVENT_TYPE_LAST,
+                              EventLatencyStage::kHandler, 1);
+
+  metrics->FlushEventLatencies();
+
+  // 5 percentiles for each of the two recorded stages
+  XCTAssertEqual(reported.count, 10);
+
+  // Values are reported to within the histogram's precision
+  long long p50 = [reported[@"Authorizer,AuthExec,Handler,p50"] longLongValue];
+  XCTAssertGreaterThanOrEqual(p50, 50000);
+  XCTAssertLessThanOrEqual(p50, 50000 * 9 / 8);
+  XCTAssertEqualObjects(reported[@"Authorizer,AuthExec,Handler,p100"], @(100000));
+
+  for (NSString* percentile in @[ @"p50", @"p10", @"p1", @"p0.1", @"p0" ]) {
+    NSString* key = [@"Authorizer,AuthExec,DeadlineSlack," stringByAppendingString:percentile];
+    XCTAssertEqualObjects(reported[key], @(5000));
+  }
+
+  // Histograms are reset by each flush, and empty ones aren't reported
+  [reported removeAllObjects];
+  metrics->FlushEventLatencies();
+  XCTAssertEqual(reported.count, 0);
+}
+
 @end
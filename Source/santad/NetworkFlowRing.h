@@ -0,0 +1,73 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_NETWORKFLOWRING_H
+#define SANTA_SANTAD_NETWORKFLOWRING_H
+
+#include <time.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "Source/common/ne/FlowRing.h"
+#include "Source/common/santa.pb.h"
+
+namespace santa {
+
+// santad's end of the shared memory FlowRing santanetd reports network flows
+// through when it supports it, in place of archiving them over XPC.
+//
+// The ring lives in an anonymous shared memory object whose file descriptor
+// is handed to santanetd at registration. Each registration gets a new ring,
+// so a santanetd that restarts or misbehaves never shares state with the next.
+class NetworkFlowRing {
+ public:
+  using ProcessCallback = std::function<void(const ::santa::pb::v1::NetworkActivity::Process&,
+                                             struct timespec, struct timespec)>;
+
+  // Returns nullptr if the shared memory couldn't be set up. Capacity must be a
+  // power of two between FlowRing::kMinCapacity and FlowRing::kMaxCapacity.
+  static std::unique_ptr<NetworkFlowRing> Create(uint32_t capacity);
+
+  NetworkFlowRing(int fd, void* region, size_t size, FlowRing ring);
+  ~NetworkFlowRing();
+
+  NetworkFlowRing(const NetworkFlowRing&) = delete;
+  NetworkFlowRing& operator=(const NetworkFlowRing&) = delete;
+
+  // The descriptor to share with santanetd. Owned by this object.
+  int FileDescriptor() const { return fd_; }
+
+  uint64_t Dropped() const { return ring_.Dropped(); }
+
+  // Consume the published records, calling f once for each run of records
+  // reported for the same process and window. Records with values outside
+  // their enumerations are skipped. Returns the number of records consumed.
+  size_t Drain(const ProcessCallback& f);
+
+  // Exposed for testing.
+  static bool PopulateFlow(const FlowRecord& record, ::santa::pb::v1::NetworkActivity::Flow* flow);
+
+ private:
+  int fd_;
+  void* region_;
+  size_t size_;
+  FlowRing ring_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_NETWORKFLOWRING_H
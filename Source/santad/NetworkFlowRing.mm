@@ -0,0 +1,188 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/NetworkFlowRing.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#import "Source/common/SNTLogging.h"
+
+namespace pbv1 = ::santa::pb::v1;
+
+namespace santa {
+
+static struct timespec NanosToTimespec(uint64_t nanos) {
+  return {
+      .tv_sec = static_cast<time_t>(nanos / NSEC_PER_SEC),
+      .tv_nsec = static_cast<long>(nanos % NSEC_PER_SEC),
+  };
+}
+
+static void SetTimestamp(google::protobuf::Timestamp* timestamp, uint64_t nanos) {
+  timestamp->set_seconds(static_cast<int64_t>(nanos / NSEC_PER_SEC));
+  timestamp->set_nanos(static_cast<int32_t>(nanos % NSEC_PER_SEC));
+}
+
+// Formats the address according to the flow's socket family
+static bool SetAddress(std::string* out, const uint8_t address[16],
+                       pbv1::NetworkActivity::Flow::SocketFamily family) {
+  char buf[INET6_ADDRSTRLEN];
+  int af;
+  switch (family) {
+    case pbv1::NetworkActivity::Flow::SOCKET_FAMILY_INET: af = AF_INET; break;
+    case pbv1::NetworkActivity::Flow::SOCKET_FAMILY_INET6: af = AF_INET6; break;
+    default: return false;
+  }
+  if (!inet_ntop(af, address, buf, sizeof(buf))) {
+    return false;
+  }
+  out->assign(buf);
+  return true;
+}
+
+std::unique_ptr<NetworkFlowRing> NetworkFlowRing::Create(uint32_t capacity) {
+  size_t size = FlowRing::RegionSize(capacity);
+
+  // Named only until it's unlinked, so no other process can open it
+  char name[32];
+  snprintf(name, sizeof(name), "/santa.nfr.%d.%08x", getpid(), arc4random());
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    LOGE(@"Unable to create network flow ring: %s", strerror(errno));
+    return nullptr;
+  }
+  shm_unlink(name);
+
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    LOGE(@"Unable to size network flow ring: %s", strerror(errno));
+    close(fd);
+    return nullptr;
+  }
+
+  void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (region == MAP_FAILED) {
+    LOGE(@"Unable to map network flow ring: %s", strerror(errno));
+    close(fd);
+    return nullptr;
+  }
+
+  std::optional<FlowRing> ring = FlowRing::Create(region, size, capacity);
+  if (!ring.has_value()) {
+    LOGE(@"Invalid network flow ring capacity: %u", capacity);
+    munmap(region, size);
+    close(fd);
+    return nullptr;
+  }
+
+  return std::make_unique<NetworkFlowRing>(fd, region, size, *ring);
+}
+
+NetworkFlowRing::NetworkFlowRing(int fd, void* region, size_t size, FlowRing ring)
+    : fd_(fd), region_(region), size_(size), ring_(ring) {}
+
+NetworkFlowRing::~NetworkFlowRing() {
+  munmap(region_, size_);
+  close(fd_);
+}
+
+bool NetworkFlowRing::PopulateFlow(const FlowRecord& record, pbv1::NetworkActivity::Flow* flow) {
+  if (!pbv1::NetworkActivity::Flow::SocketFamily_IsValid(record.socket_family) ||
+      !pbv1::NetworkActivity::Flow::Direction_IsValid(record.direction) ||
+      !pbv1::NetworkActivity::Flow::Decision_IsValid(record.decision)) {
+    return false;
+  }
+  auto family = static_cast<pbv1::NetworkActivity::Flow::SocketFamily>(record.socket_family);
+
+  const uint8_t* id = record.flow_id;
+  char buf[40];
+  snprintf(buf, sizeof(buf),
+           "%02X%02X%02X%02X-%02X%02X-%02X%02X-%02X%02X-%02X%02X%02X%02X%02X%02X", id[0], id[1],
+           id[2], id[3], id[4], id[5], id[6], id[7], id[8], id[9], id[10], id[11], id[12], id[13],
+           id[14], id[15]);
+  flow->set_id(buf);
+  snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(record.flow_hash));
+  flow->set_hash(buf);
+
+  if (SetAddress(flow->mutable_remote_address(), record.remote_address, family)) {
+    flow->set_remote_port(record.remote_port);
+  } else {
+    flow->clear_remote_address();
+  }
+  if (SetAddress(flow->mutable_local_address(), record.local_address, family)) {
+    flow->set_local_port(record.local_port);
+  } else {
+    flow->clear_local_address();
+  }
+
+  flow->set_protocol(record.protocol);
+  flow->set_socket_family(family);
+  flow->set_direction(static_cast<pbv1::NetworkActivity::Flow::Direction>(record.direction));
+  flow->set_bytes_inbound(record.bytes_inbound);
+  flow->set_bytes_outbound(record.bytes_outbound);
+  if (record.start_time_ns) {
+    SetTimestamp(flow->mutable_start_time(), record.start_time_ns);
+  }
+  if (record.close_time_ns) {
+    SetTimestamp(flow->mutable_close_time(), record.close_time_ns);
+  }
+  if (record.decision != pbv1::NetworkActivity::Flow::DECISION_UNKNOWN) {
+    flow->set_decision(static_cast<pbv1::NetworkActivity::Flow::Decision>(record.decision));
+    flow->set_rule_id(record.rule_id);
+  }
+  return true;
+}
+
+size_t NetworkFlowRing::Drain(const ProcessCallback& f) {
+  pbv1::NetworkActivity::Process process;
+  std::optional<std::tuple<int32_t, int32_t, uint64_t, uint64_t>> current;
+
+  auto flush = [&] {
+    if (current.has_value() && process.flows_size() > 0) {
+      f(process, NanosToTimespec(std::get<2>(*current)), NanosToTimespec(std::get<3>(*current)));
+    }
+    process.Clear();
+  };
+
+  size_t count = ring_.Drain([&](const FlowRecord& record) {
+    auto key = std::make_tuple(record.pid, record.pidversion, record.window_start_ns,
+                               record.window_end_ns);
+    if (current != key) {
+      flush();
+      current = key;
+      process.mutable_process()->mutable_id()->set_pid(record.pid);
+      process.mutable_process()->mutable_id()->set_pidversion(record.pidversion);
+    }
+
+    if (!PopulateFlow(record, process.add_flows())) {
+      process.mutable_flows()->RemoveLast();
+    }
+  });
+  flush();
+
+  return count;
+}
+
+}  // namespace santa
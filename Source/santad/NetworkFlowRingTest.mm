@@ -0,0 +1,125 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/NetworkFlowRing.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "Source/common/ne/FlowRing.h"
+#include "Source/common/santa.pb.h"
+
+namespace pbv1 = ::santa::pb::v1;
+using santa::FlowRecord;
+using santa::FlowRing;
+using santa::NetworkFlowRing;
+
+static FlowRecord MakeRecord(int32_t pid, uint64_t window_start_ns) {
+  FlowRecord record = {};
+  record.window_start_ns = window_start_ns;
+  record.window_end_ns = window_start_ns + 60 * NSEC_PER_SEC;
+  record.pid = pid;
+  record.pidversion = 1;
+  record.socket_family = pbv1::NetworkActivity::Flow::SOCKET_FAMILY_INET;
+  record.direction = pbv1::NetworkActivity::Flow::DIRECTION_OUTBOUND;
+  record.protocol = 6;
+  inet_pton(AF_INET, "10.0.0.1", record.remote_address);
+  record.remote_port = 443;
+  return record;
+}
+
+@interface NetworkFlowRingTest : XCTestCase
+@end
+
+@implementation NetworkFlowRingTest
+
+- (void)testPopulateFlow {
+  FlowRecord record = MakeRecord(12, 100 * NSEC_PER_SEC);
+  for (uint8_t i = 0; i < 16; i++) {
+    record.flow_id[i] = i;
+  }
+  record.flow_hash = 0xabc;
+  record.bytes_inbound = 10;
+  record.bytes_outbound = 20;
+  record.start_time_ns = 150 * NSEC_PER_SEC + 5;
+  record.decision = pbv1::NetworkActivity::Flow::DECISION_BLOCK;
+  record.rule_id = 7;
+
+  pbv1::NetworkActivity::Flow flow;
+  XCTAssertTrue(NetworkFlowRing::PopulateFlow(record, &flow));
+  XCTAssertEqualObjects(@(flow.id().c_str()), @"00010203-0405-0607-0809-0A0B0C0D0E0F");
+  XCTAssertEqualObjects(@(flow.hash().c_str()), @"0000000000000abc");
+  XCTAssertEqualObjects(@(flow.remote_address().c_str()), @"10.0.0.1");
+  XCTAssertEqual(flow.remote_port(), 443);
+  XCTAssertEqualObjects(@(flow.local_address().c_str()), @"0.0.0.0");
+  XCTAssertEqual(flow.protocol(), 6);
+  XCTAssertEqual(flow.direction(), pbv1::NetworkActivity::Flow::DIRECTION_OUTBOUND);
+  XCTAssertEqual(flow.bytes_inbound(), 10);
+  XCTAssertEqual(flow.bytes_outbound(), 20);
+  XCTAssertEqual(flow.start_time().seconds(), 150);
+  XCTAssertEqual(flow.start_time().nanos(), 5);
+  XCTAssertFalse(flow.has_close_time());
+  XCTAssertEqual(flow.decision(), pbv1::NetworkActivity::Flow::DECISION_BLOCK);
+  XCTAssertEqual(flow.rule_id(), 7);
+
+  // Values outside the enumerations are rejected
+  record.direction = 200;
+  XCTAssertFalse(NetworkFlowRing::PopulateFlow(record, &flow));
+}
+
+- (void)testDrainGroupsByProcessAndWindow {
+  std::unique_ptr<NetworkFlowRing> ring = NetworkFlowRing::Create(64);
+  XCTAssertTrue(ring != nullptr);
+
+  // Map the ring again, as santanetd would
+  size_t size = FlowRing::RegionSize(64);
+  void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->FileDescriptor(), 0);
+  XCTAssertNotEqual(region, MAP_FAILED);
+  std::optional<FlowRing> producer = FlowRing::Attach(region, size);
+  XCTAssertTrue(producer.has_value());
+
+  FlowRecord invalid = MakeRecord(1, 0);
+  invalid.socket_family = 99;
+  producer->TryPush(MakeRecord(1, 0));
+  producer->TryPush(invalid);
+  producer->TryPush(MakeRecord(1, 0));
+  producer->TryPush(MakeRecord(2, 0));
+  producer->TryPush(MakeRecord(2, 60 * NSEC_PER_SEC));
+
+  std::vector<std::pair<pbv1::NetworkActivity::Process, struct timespec>> processes;
+  XCTAssertEqual(ring->Drain([&processes](const pbv1::NetworkActivity::Process& process,
+                                          struct timespec window_start, struct timespec) {
+    processes.emplace_back(process, window_start);
+  }),
+                 5);
+
+  XCTAssertEqual(processes.size(), 3);
+  XCTAssertEqual(processes[0].first.process().id().pid(), 1);
+  XCTAssertEqual(processes[0].first.flows_size(), 2);
+  XCTAssertEqual(processes[1].first.process().id().pid(), 2);
+  XCTAssertEqual(processes[1].second.tv_sec, 0);
+  XCTAssertEqual(processes[2].first.process().id().pid(), 2);
+  XCTAssertEqual(processes[2].second.tv_sec, 60);
+
+  XCTAssertEqual(ring->Drain([](const auto&, struct timespec, struct timespec) {}), 0);
+  munmap(region, size);
+}
+
+@end
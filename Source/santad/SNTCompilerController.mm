@@ -16,11 +16,21 @@
 #import "Source/santad/SNTCompilerController.h"
 
 #include <bsm/libbsm.h>
+#include <fcntl.h>
+#include <mach-o/fat.h>
+#include <mach-o/loader.h>
 #include <mach/message.h>
 #include <os/base.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <array>
 #include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTCommonEnums.h"
@@ -31,6 +41,8 @@
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #import "Source/santad/SNTDatabaseController.h"
 #import "Source/santad/SNTDecisionCache.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
 
 using santa::Logger;
 using santa::Message;
@@ -38,6 +50,75 @@ using santa::Message;
 static const pid_t PID_MAX = 99999;
 static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
 
+// Compiler outputs are hashed on this many serial queues. A file always
+// hashes on the same queue, chosen by its vnode.
+static constexpr size_t kNumHashQueues = 4;
+
+// Hashed outputs are committed as transitive rules in a single transaction at
+// most this long after the first one of a batch is ready, or as soon as the
+// batch holds kMaxTransitiveRuleBatchSize outputs.
+static constexpr uint64_t kTransitiveRuleCommitIntervalMS = 100;
+static constexpr size_t kMaxTransitiveRuleBatchSize = 512;
+
+// Extensions of intermediate files that compilers write in bulk and that are never executables.
+static constexpr std::array<std::string_view, 11> kIgnoredCompilerOutputExtensions = {
+    ".o",         ".d",         ".dia",         ".pcm",           ".pch",    ".gch",
+    ".a",         ".swiftdeps", ".swiftdoc",    ".swiftmodule",   ".swiftsourceinfo",
+};
+
+namespace {
+
+// Returns false if the file at path is known not to be a Mach-O executable,
+// based on its extension and the start of its header. Returns true when that
+// can't be determined, e.g. if the file can't be opened, so that the full
+// check still happens.
+//
+// Fat files are assumed to be executables, since telling requires reading
+// the header of each architecture.
+bool MayBeMachOExecutable(std::string_view path) {
+  std::string_view name = path.substr(path.find_last_of('/') + 1);
+  for (std::string_view ext : kIgnoredCompilerOutputExtensions) {
+    if (name.ends_with(ext)) {
+      return false;
+    }
+  }
+
+  int fd = open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (fd < 0) {
+    return true;
+  }
+  struct mach_header header;
+  ssize_t n = pread(fd, &header, sizeof(header), 0);
+  close(fd);
+  if (n < 0) {
+    return true;
+  } else if (n < (ssize_t)sizeof(header.magic)) {
+    return false;
+  }
+
+  switch (header.magic) {
+    case MH_MAGIC:
+    case MH_MAGIC_64: return n == sizeof(header) && header.filetype == MH_EXECUTE;
+    case MH_CIGAM:
+    case MH_CIGAM_64: return n == sizeof(header) && OSSwapInt32(header.filetype) == MH_EXECUTE;
+    case FAT_MAGIC:
+    case FAT_CIGAM:
+    case FAT_MAGIC_64:
+    case FAT_CIGAM_64: return true;
+    default: return false;
+  }
+}
+
+// A hashed compiler output waiting to be committed as a transitive rule.
+struct PendingTransitiveRule {
+  Message msg;
+  std::shared_ptr<Logger> logger;
+  SNTFileInfo* fileInfo;
+  NSString* sha256;
+};
+
+}  // namespace
+
 // Tracks compiler PIDs using pidversion to prevent PID reuse attacks.
 //
 // Each slot stores the pidversion of the active compiler at that PID index, or 0
@@ -57,11 +138,37 @@ static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
 // security issue, and is self-healing.
 @interface SNTCompilerController () {
   std::atomic<int32_t> _compilerPIDs[PID_MAX];
+
+  dispatch_queue_t _hashQueues[kNumHashQueues];
+
+  // Outputs queued for hashing that haven't started hashing yet. A file closed
+  // again before its queued hash runs only needs to be hashed once.
+  absl::Mutex _queuedVnodesMtx;
+  absl::flat_hash_set<SantaVnode> _queuedVnodes;
+
+  // Serializes access to _pendingRules.
+  dispatch_queue_t _commitQueue;
+  std::vector<PendingTransitiveRule> _pendingRules;
 }
 @end
 
 @implementation SNTCompilerController
 
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    for (size_t i = 0; i < kNumHashQueues; i++) {
+      _hashQueues[i] = dispatch_queue_create(
+          "com.northpolesec.santa.daemon.compiler_controller.hash",
+          dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+    }
+    _commitQueue = dispatch_queue_create(
+        "com.northpolesec.santa.daemon.compiler_controller.commit",
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+  }
+  return self;
+}
+
 - (BOOL)isCompiler:(const audit_token_t&)tok {
   pid_t pid = audit_token_to_pid(tok);
   if (pid < 0 || pid >= PID_MAX) return NO;
@@ -109,6 +216,7 @@ static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
 - (BOOL)handleEvent:(const Message&)esMsg withLogger:(std::shared_ptr<Logger>)logger {
   SNTFileInfo* targetFile;
   NSString* targetPath;
+  std::string destinationPath;
   NSError* error;
 
   switch (esMsg->event_type) {
@@ -118,7 +226,8 @@ static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
       }
 
       if (strncmp(kIgnoredCompilerProcessPathPrefix.data(), esMsg->event.close.target->path.data,
-                  kIgnoredCompilerProcessPathPrefix.length()) == 0) {
+                  kIgnoredCompilerProcessPathPrefix.length()) == 0 ||
+          !MayBeMachOExecutable(santa::StringTokenToStringView(esMsg->event.close.target->path))) {
         return NO;
       }
 
@@ -139,6 +248,19 @@ static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
         return NO;
       }
 
+      // The file has already been renamed, so check it at its destination.
+      if (esMsg->event.rename.destination_type == ES_DESTINATION_TYPE_EXISTING_FILE) {
+        destinationPath =
+            santa::StringTokenToString(esMsg->event.rename.destination.existing_file->path);
+      } else {
+        destinationPath =
+            santa::StringTokenToString(esMsg->event.rename.destination.new_path.dir->path) + "/" +
+            santa::StringTokenToString(esMsg->event.rename.destination.new_path.filename);
+      }
+      if (!MayBeMachOExecutable(destinationPath)) {
+        return NO;
+      }
+
       targetFile = [[SNTFileInfo alloc] initWithEndpointSecurityFile:esMsg->event.rename.source
                                                                error:&error];
       if (!targetFile) {
@@ -171,6 +293,12 @@ static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
         return NO;
       }
 
+      destinationPath = santa::StringTokenToString(esMsg->event.clone.target_dir->path) + "/" +
+                        santa::StringTokenToString(esMsg->event.clone.target_name);
+      if (!MayBeMachOExecutable(destinationPath)) {
+        return NO;
+      }
+
       targetFile = [[SNTFileInfo alloc] initWithEndpointSecurityFile:esMsg->event.clone.source
                                                                error:&error];
       if (!targetFile) {
@@ -202,51 +330,135 @@ static constexpr std::string_view kIgnoredCompilerProcessPathPrefix = "/dev/";
 }
 
 // Assume that this method is called only when we already know that the writing process is a
-// compiler.  It checks if the closed file is executable, and if so, transitively allowlists it.
-// The passed in message contains the pid of the writing process and path of closed file.
+// compiler. It queues the closed file to be hashed and, if it is executable, transitively
+// allowlisted. The passed in message contains the pid of the writing process and path of closed
+// file.
+//
+// Until the rule is committed, a pending decision is cached for the file so that executions in the
+// meantime are logged as pending a transitive rule.
 - (void)createTransitiveRule:(const Message&)esMsg
                       target:(SNTFileInfo*)targetFile
                       logger:(std::shared_ptr<Logger>)logger {
+  SantaVnode vnode = targetFile.vnode;
+  {
+    absl::MutexLock lock(_queuedVnodesMtx);
+    if (!_queuedVnodes.insert(vnode).second) {
+      return;
+    }
+  }
+
   [self saveFakeDecision:targetFile];
 
-  // Check if this file is an executable.
-  if (targetFile.isExecutable) {
+  __block Message msg = esMsg;
+  __block std::shared_ptr<Logger> blockLogger = std::move(logger);
+  dispatch_queue_t hashQueue = _hashQueues[(vnode.fsid ^ vnode.fileid) % kNumHashQueues];
+  dispatch_async(hashQueue, ^{
+    // Once hashing starts, a later close of the same file must be hashed again.
+    {
+      absl::MutexLock lock(self->_queuedVnodesMtx);
+      self->_queuedVnodes.erase(vnode);
+    }
+
+    NSString* sha256 = targetFile.isExecutable ? targetFile.SHA256 : nil;
+    if (!sha256) {
+      [self removeFakeDecision:targetFile];
+      return;
+    }
+
+    dispatch_async(self->_commitQueue, ^{
+      self->_pendingRules.push_back({
+          .msg = std::move(msg),
+          .logger = std::move(blockLogger),
+          .fileInfo = targetFile,
+          .sha256 = sha256,
+      });
+
+      if (self->_pendingRules.size() >= kMaxTransitiveRuleBatchSize) {
+        [self commitPendingTransitiveRules];
+      } else if (self->_pendingRules.size() == 1) {
+        dispatch_after(
+            dispatch_time(DISPATCH_TIME_NOW, kTransitiveRuleCommitIntervalMS * NSEC_PER_MSEC),
+            self->_commitQueue, ^{
+              [self commitPendingTransitiveRules];
+            });
+      }
+    });
+  });
+}
+
+// Must be called on _commitQueue.
+- (void)commitPendingTransitiveRules {
+  if (_pendingRules.empty()) {
+    return;
+  }
+  std::vector<PendingTransitiveRule> batch = std::move(_pendingRules);
+  _pendingRules.clear();
+
+  SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray array];
+  NSMutableSet<NSString*>* checkedHashes = [NSMutableSet set];
+  NSMutableSet<NSString*>* ruleHashes = [NSMutableSet set];
+
+  for (const PendingTransitiveRule& pending : batch) {
+    if ([checkedHashes containsObject:pending.sha256]) {
+      continue;
+    }
+    [checkedHashes addObject:pending.sha256];
+
     // Check if there is an existing (non-transitive) rule for this file.  We leave existing rules
     // alone, so that a allowlist or blocklist rule can't be overwritten by a transitive one.
-    SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
     SNTRule* prevRule =
         [ruleTable executionRuleForIdentifiers:(struct RuleIdentifiers){
-                                                   .binarySHA256 = targetFile.SHA256,
+                                                   .binarySHA256 = pending.sha256,
                                                }];
     // Note: Don't overwrite existing rules, unless it was a transitive rule which is allowed
     // in order to have timestamps updated.
-    if (!prevRule || prevRule.state == SNTRuleStateAllowTransitive) {
-      // Construct a new transitive allowlist rule for the executable.
-      SNTRule* rule = [[SNTRule alloc] initWithIdentifier:targetFile.SHA256
-                                                    state:SNTRuleStateAllowTransitive
-                                                     type:SNTRuleTypeBinary];
-
-      if (!rule) {
-        LOGW(@"Failed to create transitive rule: %@ (SHA-256: %@)", targetFile.path,
-             targetFile.SHA256);
-      } else {
-        // Add the new rule to the rules database.
-        NSArray<NSError*>* errors;
-        if (![ruleTable addExecutionRules:@[ rule ]
-                              ruleCleanup:SNTRuleCleanupNone
-                                   errors:&errors]) {
-          for (NSError* error in errors) {
-            LOGE(@"Unable to add new transitive rule to database: %@", error.localizedDescription);
-          }
-        } else {
-          logger->LogAllowlist(esMsg, santa::NSStringToUTF8StringView(targetFile.SHA256),
-                               santa::NSStringToUTF8StringView(targetFile.path));
-        }
-      }
+    if (prevRule && prevRule.state != SNTRuleStateAllowTransitive) {
+      continue;
+    }
+
+    // Construct a new transitive allowlist rule for the executable.
+    SNTRule* rule = [[SNTRule alloc] initWithIdentifier:pending.sha256
+                                                  state:SNTRuleStateAllowTransitive
+                                                   type:SNTRuleTypeBinary];
+    if (!rule) {
+      LOGW(@"Failed to create transitive rule: %@ (SHA-256: %@)", pending.fileInfo.path,
+           pending.sha256);
+      continue;
     }
+    [rules addObject:rule];
+    [ruleHashes addObject:pending.sha256];
   }
 
-  [self removeFakeDecision:targetFile];
+  // Add the new rules to the rules database in a single transaction.
+  NSArray<NSError*>* errors;
+  if (rules.count > 0 && ![ruleTable addExecutionRules:rules
+                                           ruleCleanup:SNTRuleCleanupNone
+                                                errors:&errors]) {
+    for (NSError* error in errors) {
+      LOGE(@"Unable to add new transitive rule to database: %@", error.localizedDescription);
+    }
+    [ruleHashes removeAllObjects];
+  }
+
+  for (const PendingTransitiveRule& pending : batch) {
+    if (pending.logger && [ruleHashes containsObject:pending.sha256]) {
+      pending.logger->LogAllowlist(pending.msg, santa::NSStringToUTF8StringView(pending.sha256),
+                                   santa::NSStringToUTF8StringView(pending.fileInfo.path));
+    }
+    [self removeFakeDecision:pending.fileInfo];
+  }
+}
+
+// Waits for queued outputs to be hashed, then commits them.
+- (void)flushTransitiveRules {
+  for (size_t i = 0; i < kNumHashQueues; i++) {
+    dispatch_sync(_hashQueues[i], ^{
+                  });
+  }
+  dispatch_sync(_commitQueue, ^{
+    [self commitPendingTransitiveRules];
+  });
 }
 
 @end
@@ -26,10 +26,13 @@
 
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTFileInfo.h"
+#import "Source/common/SNTRule.h"
 #include "Source/common/TestUtils.h"
 #include "Source/common/es/Message.h"
 #include "Source/common/es/MockEndpointSecurityAPI.h"
+#import "Source/santad/DataLayer/SNTRuleTable.h"
 #include "Source/santad/Logs/EndpointSecurity/Logger.h"
+#import "Source/santad/SNTDatabaseController.h"
 #import "Source/santad/SNTDecisionCache.h"
 
 using santa::Logger;
@@ -44,6 +47,7 @@ static const pid_t PID_MAX = 99999;
 - (void)createTransitiveRule:(const Message&)esMsg
                       target:(SNTFileInfo*)targetFile
                       logger:(std::shared_ptr<Logger>)logger;
+- (void)flushTransitiveRules;
 @end
 
 @interface SNTCompilerControllerTest : XCTestCase
@@ -332,6 +336,8 @@ static const pid_t PID_MAX = 99999;
   {
     esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_RENAME, &compilerProc);
     esMsg.event.rename.source = &normalFile;
+    esMsg.event.rename.destination_type = ES_DESTINATION_TYPE_EXISTING_FILE;
+    esMsg.event.rename.destination.existing_file = &normalFile;
     Message msg(mockESApi, &esMsg);
 
     id mockCompilerController = OCMPartialMock(cc);
@@ -443,8 +449,11 @@ static const pid_t PID_MAX = 99999;
   }
   // Ensure transitive rules are created for CLONE events from the source path
   {
+    es_file_t targetDir = MakeESFile("dir");
     esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLONE, &compilerProc);
     esMsg.event.clone.source = &normalFile;
+    esMsg.event.clone.target_dir = &targetDir;
+    esMsg.event.clone.target_name = MakeESStringToken("bar");
     Message msg(mockESApi, &esMsg);
 
     id mockCompilerController = OCMPartialMock(cc);
@@ -516,4 +525,121 @@ static const pid_t PID_MAX = 99999;
   }
 }
 
+- (void)testHandleEventSkipsNonExecutableOutputs {
+  es_file_t file = MakeESFile("foo");
+  audit_token_t compilerTok = MakeAuditToken(12, 34);
+  es_process_t compilerProc = MakeESProcess(&file, compilerTok, {});
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  NSString* dir = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"compiler-controller-%@",
+                                                                [NSUUID UUID].UUIDString]];
+  [[NSFileManager defaultManager] createDirectoryAtPath:dir
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  NSString* textPath = [dir stringByAppendingPathComponent:@"output"];
+  [@"not a mach-o" writeToFile:textPath atomically:YES encoding:NSUTF8StringEncoding error:nil];
+  NSString* objectPath = [dir stringByAppendingPathComponent:@"output.o"];
+  [[NSFileManager defaultManager] copyItemAtPath:@"/usr/bin/true" toPath:objectPath error:nil];
+
+  SNTCompilerController* cc = [[SNTCompilerController alloc] init];
+  [cc setProcess:compilerTok isCompiler:true];
+
+  es_message_t anyESMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &compilerProc);
+  Message anyMsg(mockESApi, &anyESMsg);
+  id mockCompilerController = OCMPartialMock(cc);
+  OCMReject([mockCompilerController createTransitiveRule:anyMsg
+                                                  target:[OCMArg any]
+                                                  logger:nullptr])
+      .ignoringNonObjectArgs();
+
+  // Neither a file without a Mach-O header nor an intermediate build product
+  // is considered, even though the latter is an executable.
+  for (NSString* path in @[ textPath, objectPath ]) {
+    es_file_t target = MakeESFile(path.UTF8String);
+    es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &compilerProc);
+    esMsg.event.close.target = &target;
+    Message msg(mockESApi, &esMsg);
+    XCTAssertFalse([cc handleEvent:msg withLogger:nullptr]);
+  }
+
+  OCMVerifyAll(mockCompilerController);
+  [mockCompilerController stopMocking];
+  [[NSFileManager defaultManager] removeItemAtPath:dir error:nil];
+}
+
+- (void)testCreateTransitiveRuleBatchesCommits {
+  es_file_t file = MakeESFile("foo");
+  audit_token_t compilerTok = MakeAuditToken(12, 34);
+  es_process_t compilerProc = MakeESProcess(&file, compilerTok, {});
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_NOTIFY_CLOSE, &compilerProc);
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+  Message msg(mockESApi, &esMsg);
+
+  id mockRuleTable = OCMClassMock([SNTRuleTable class]);
+  id mockDatabaseController = OCMClassMock([SNTDatabaseController class]);
+  OCMStub([mockDatabaseController ruleTable]).andReturn(mockRuleTable);
+
+  __block int commits = 0;
+  __block NSArray<SNTRule*>* committedRules;
+  OCMStub([mockRuleTable addExecutionRules:[OCMArg any]
+                               ruleCleanup:SNTRuleCleanupNone
+                                    errors:[OCMArg anyObjectRef]])
+      .ignoringNonObjectArgs()
+      .andDo(^(NSInvocation* invocation) {
+        __unsafe_unretained NSArray<SNTRule*>* rules;
+        [invocation getArgument:&rules atIndex:2];
+        committedRules = rules;
+        commits++;
+        BOOL ret = YES;
+        [invocation setReturnValue:&ret];
+      });
+
+  SantaVnode vnode1{.fsid = 1, .fileid = 1};
+  SantaVnode vnode2{.fsid = 1, .fileid = 2};
+  SantaVnode vnode3{.fsid = 1, .fileid = 3};
+  NSString* sha1 = @"1111111111111111111111111111111111111111111111111111111111111111";
+  NSString* sha2 = @"2222222222222222222222222222222222222222222222222222222222222222";
+  id mockFileInfo1 = OCMClassMock([SNTFileInfo class]);
+  OCMStub([mockFileInfo1 vnode]).andReturn(vnode1);
+  OCMStub([mockFileInfo1 isExecutable]).andReturn(YES);
+  OCMStub([mockFileInfo1 SHA256]).andReturn(sha1);
+  id mockFileInfo2 = OCMClassMock([SNTFileInfo class]);
+  OCMStub([mockFileInfo2 vnode]).andReturn(vnode2);
+  OCMStub([mockFileInfo2 isExecutable]).andReturn(YES);
+  OCMStub([mockFileInfo2 SHA256]).andReturn(sha2);
+  id mockNotExecutable = OCMClassMock([SNTFileInfo class]);
+  OCMStub([mockNotExecutable vnode]).andReturn(vnode3);
+  OCMStub([mockNotExecutable isExecutable]).andReturn(NO);
+
+  SNTCompilerController* cc = [[SNTCompilerController alloc] init];
+  [cc createTransitiveRule:msg target:mockFileInfo1 logger:nullptr];
+  [cc createTransitiveRule:msg target:mockFileInfo1 logger:nullptr];
+  [cc createTransitiveRule:msg target:mockFileInfo2 logger:nullptr];
+  [cc createTransitiveRule:msg target:mockNotExecutable logger:nullptr];
+  [cc flushTransitiveRules];
+
+  // Both executables are committed in one transaction, and the file closed
+  // twice only gets one rule.
+  XCTAssertEqual(commits, 1);
+  XCTAssertEqual(committedRules.count, 2);
+  NSSet* committedHashes = [NSSet setWithArray:[committedRules valueForKey:@"identifier"]];
+  XCTAssertEqualObjects(committedHashes, ([NSSet setWithObjects:sha1, sha2, nil]));
+  for (SNTRule* rule in committedRules) {
+    XCTAssertEqual(rule.state, SNTRuleStateAllowTransitive);
+  }
+
+  // Every output's pending decision is removed.
+  OCMVerify([self.mockDecisionCache forgetCachedDecisionForVnode:vnode1]);
+  OCMVerify([self.mockDecisionCache forgetCachedDecisionForVnode:vnode2]);
+  OCMVerify([self.mockDecisionCache forgetCachedDecisionForVnode:vnode3]);
+
+  [mockDatabaseController stopMocking];
+}
+
 @end
@@ -15,11 +15,13 @@
 
 #import <Foundation/Foundation.h>
 
+#include <functional>
 #include <memory>
 
 #import "Source/common/SNTXPCControlInterface.h"
 #include "Source/common/SantaVnode.h"
 #include "Source/common/faa/WatchItems.h"
+#include "Source/common/processtree/process_tree.h"
 #include "Source/santad/EventProviders/AuthResultCache.h"
 #include "Source/santad/Logs/EndpointSecurity/Logger.h"
 #include "Source/santad/SNTBinaryUploadController.h"
@@ -31,6 +33,7 @@ class TemporaryAdminMode;
 }  // namespace santa
 
 @class SNTNotificationQueue;
+@class SNTRule;
 @class SNTSyncdQueue;
 @class SNTNetworkExtensionQueue;
 
@@ -48,11 +51,18 @@ class TemporaryAdminMode;
                           (std::shared_ptr<santa::SandboxExpectations>)sandboxExpectations
                           flushCacheBlock:(void (^)(santa::FlushCacheMode,
                                                     santa::FlushCacheReason))flushCacheBlock
+                  flushCacheForRulesBlock:(void (^)(NSArray<SNTRule*>*))flushCacheForRulesBlock
+                   flushCacheEntriesBlock:
+                       (uint64_t (^)(std::function<bool(const SantaVnode&)>))flushCacheEntriesBlock
+                          flushBatchBlock:(void (^)(void (^)(void)))flushBatchBlock
                           cacheCountBlock:(NSArray<NSNumber*>* (^)(void))cacheCountBlock
                           checkCacheBlock:(SNTAction (^)(SantaVnode))checkCacheBlock
                        metricsExportBlock:(void (^)(void (^reply)(BOOL)))metricsExportBlock
                    binaryUploadController:
-                       (std::shared_ptr<santa::SNTBinaryUploadController>)binaryUploadController;
+                       (std::shared_ptr<santa::SNTBinaryUploadController>)binaryUploadController
+                              processTree:
+                                  (std::shared_ptr<santa::santad::process_tree::ProcessTree>)
+                                      processTree;
 
 /// Install the network extension, optionally checking whether an upgrade is needed first.
 /// When force is YES, delegates to installNetworkExtension: as long as installation is authorized.
@@ -24,10 +24,16 @@
 #include <sys/qos.h>
 
 #include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #import "Source/common/AccountLookup.h"
+#include "Source/common/ExecTrace.h"
+#include "Source/common/HeapSample.h"
 #import "Source/common/MOLCodesignChecker.h"
 #import "Source/common/MOLXPCConnection.h"
+#include "Source/common/MemoryAttribution.h"
 #include "Source/common/Pinning.h"
 #import "Source/common/SNTCELFallbackRule.h"
 #import "Source/common/SNTCachedDecision.h"
@@ -50,8 +56,10 @@
 #import "Source/common/SNTStrengthify.h"
 #import "Source/common/SNTTemporaryAdminPolicy.h"
 #import "Source/common/SNTTimer.h"
+#import "Source/common/SNTXPCFastPath.h"
 #import "Source/common/SNTXPCNotifierInterface.h"
 #import "Source/common/SNTXPCSyncServiceInterface.h"
+#include "Source/common/StoredEventEncoding.h"
 #include "Source/common/String.h"
 #include "Source/common/faa/WatchItems.h"
 #import "Source/common/ne/SNTSyncNetworkExtensionSettings.h"
@@ -61,11 +69,13 @@
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #include "Source/santad/KillingMachine.h"
 #import "Source/santad/SNTDatabaseController.h"
+#import "Source/santad/SNTDecisionCache.h"
 #import "Source/santad/SNTNetworkExtensionQueue.h"
 #import "Source/santad/SNTNotificationQueue.h"
 #import "Source/santad/SNTSyncdQueue.h"
 #include "Source/santad/TemporaryAdminMode.h"
 #include "Source/santad/TemporaryMonitorMode.h"
+#include "absl/container/flat_hash_set.h"
 #include "commands/v1.pb.h"
 #import "src/santanetd/SNDNetworkFlowDecision.h"
 #import "src/santanetd/SNDProcessFlows.h"
@@ -91,12 +101,35 @@ double watchdogRAMPeak = 0;
 @property dispatch_queue_t netFlowQ;
 @property dispatch_queue_t binaryUploadQ;
 
+///
+///  Whether committing the current staged rule update should flush the caches.
+///
+@property(atomic) BOOL stagedRulesShouldFlushCache;
+
+///
+///  The execution rules staged so far whose cache entries would be flushed on commit, or nil
+///  if committing should flush all caches.
+///
+@property(atomic) NSArray<SNTRule*>* stagedRulesToFlush;
+
 ///
 ///  Called when caches should be flushed (rules changed, explicit flush command, etc.).
 ///  Flushes both the auth result cache and TouchID approval cache.
 ///
 @property(copy) void (^flushCacheBlock)(santa::FlushCacheMode, santa::FlushCacheReason);
 
+///
+///  Called when rules changed, to flush only the cache entries for files whose decision could
+///  depend on the given execution rules. Also flushes the TouchID approval cache.
+///
+@property(copy) void (^flushCacheForRulesBlock)(NSArray<SNTRule*>*);
+@property(copy) uint64_t (^flushCacheEntriesBlock)(std::function<bool(const SantaVnode&)>);
+
+///
+///  Runs the given block with cache flushes coalesced, see AuthResultCache::BeginFlushBatch.
+///
+@property(copy) void (^flushBatchBlock)(void (^)(void));
+
 ///
 ///  Called to get cache counts (root cache count, non-root cache count).
 ///
@@ -119,6 +152,22 @@ static NSString* TAMUsernameForUID(uid_t uid) {
   return username.has_value() ? @(username->c_str()) : @"";
 }
 
+// Manually added rules are rejected when rules are managed by a sync server or static rules.
+static NSError* RuleAddSourceError(SNTRuleAddSource source) {
+#ifndef DEBUG
+  SNTConfigurator* config = [SNTConfigurator configurator];
+  if (source == SNTRuleAddSourceSantactl && (config.syncBaseURL || config.staticRules.count > 0)) {
+    NSError* error;
+    [SNTError populateError:&error
+                   withCode:SNTErrorCodeManualRulesDisabled
+                    message:@"Rejected by the Santa daemon"
+                     detail:@"SyncBaseURL or StaticRules are set"];
+    return error;
+  }
+#endif
+  return nil;
+}
+
 @implementation SNTDaemonControlController {
   std::shared_ptr<Logger> _logger;
   std::shared_ptr<WatchItems> _watchItems;
@@ -127,6 +176,10 @@ static NSString* TAMUsernameForUID(uid_t uid) {
   std::unique_ptr<santa::AdminUserState> _adminUserState;
   std::shared_ptr<santa::SandboxExpectations> _sandboxExpectations;
   std::shared_ptr<santa::SNTBinaryUploadController> _binaryUploadController;
+  std::shared_ptr<santa::santad::process_tree::ProcessTree> _processTree;
+  SNTXPCFastPathServer* _fastPathServer;
+  // When the last heap sample was taken. Only accessed on the command queue.
+  uint64_t _lastHeapSampleNanos;
 }
 
 - (instancetype)initWithNotificationQueue:(SNTNotificationQueue*)notQueue
@@ -138,21 +191,32 @@ static NSString* TAMUsernameForUID(uid_t uid) {
                           (std::shared_ptr<santa::SandboxExpectations>)sandboxExpectations
                           flushCacheBlock:(void (^)(santa::FlushCacheMode,
                                                     santa::FlushCacheReason))flushCacheBlock
+                  flushCacheForRulesBlock:(void (^)(NSArray<SNTRule*>*))flushCacheForRulesBlock
+                   flushCacheEntriesBlock:
+                       (uint64_t (^)(std::function<bool(const SantaVnode&)>))flushCacheEntriesBlock
+                          flushBatchBlock:(void (^)(void (^)(void)))flushBatchBlock
                           cacheCountBlock:(NSArray<NSNumber*>* (^)(void))cacheCountBlock
                           checkCacheBlock:(SNTAction (^)(SantaVnode))checkCacheBlock
                        metricsExportBlock:(void (^)(void (^reply)(BOOL)))metricsExportBlock
                    binaryUploadController:
-                       (std::shared_ptr<santa::SNTBinaryUploadController>)binaryUploadController {
+                       (std::shared_ptr<santa::SNTBinaryUploadController>)binaryUploadController
+                              processTree:
+                                  (std::shared_ptr<santa::santad::process_tree::ProcessTree>)
+                                      processTree {
   self = [super init];
   if (self) {
     _logger = logger;
     _binaryUploadController = std::move(binaryUploadController);
+    _processTree = std::move(processTree);
     _watchItems = std::move(watchItems);
     _sandboxExpectations = std::move(sandboxExpectations);
     _notQueue = notQueue;
     _syncdQueue = syncdQueue;
     _netExtQueue = netExtQueue;
     _flushCacheBlock = flushCacheBlock;
+    _flushCacheForRulesBlock = flushCacheForRulesBlock;
+    _flushCacheEntriesBlock = flushCacheEntriesBlock;
+    _flushBatchBlock = flushBatchBlock;
     _cacheCountsBlock = cacheCountBlock;
     _checkCacheBlock = checkCacheBlock;
     _metricsExportBlock = metricsExportBlock;
@@ -195,10 +259,85 @@ static NSString* TAMUsernameForUID(uid_t uid) {
         [SNTConfigurator configurator], santa::CreateAdminGroupMembership(), ^{
           tam->Revoke(SNTTemporaryAdminModeLeaveReasonSyncServerChanged);
         });
+
+    [self startFastPathServer];
   }
   return self;
 }
 
+// Serve the fast path operations with the same implementations as their NSXPC equivalents, all
+// of which reply synchronously.
+- (void)startFastPathServer {
+  _fastPathServer = [[SNTXPCFastPathServer alloc] init];
+  WEAKIFY(self);
+
+  [_fastPathServer
+        setHandler:^(xpc_object_t request, xpc_object_t reply) {
+          STRONGIFY(self);
+          [self cacheCounts:^(uint64_t rootCache, uint64_t nonRootCache) {
+            xpc_dictionary_set_uint64(reply, kSNTXPCFastPathRootCacheCountKey, rootCache);
+            xpc_dictionary_set_uint64(reply, kSNTXPCFastPathNonRootCacheCountKey, nonRootCache);
+          }];
+        }
+      forOperation:SNTXPCFastPathOperationCacheCounts];
+
+  [_fastPathServer
+        setHandler:^(xpc_object_t request, xpc_object_t reply) {
+          STRONGIFY(self);
+          [self databaseRuleCounts:^(RuleCounts ruleCounts) {
+            xpc_dictionary_set_data(reply, kSNTXPCFastPathRuleCountsKey, &ruleCounts,
+                                    sizeof(ruleCounts));
+          }];
+        }
+      forOperation:SNTXPCFastPathOperationRuleCounts];
+
+  [_fastPathServer
+        setHandler:^(xpc_object_t request, xpc_object_t reply) {
+          STRONGIFY(self);
+          [self databaseEventCount:^(int64_t count) {
+            xpc_dictionary_set_int64(reply, kSNTXPCFastPathCountKey, count);
+          }];
+        }
+      forOperation:SNTXPCFastPathOperationEventCount];
+
+  [_fastPathServer
+        setHandler:^(xpc_object_t request, xpc_object_t reply) {
+          STRONGIFY(self);
+          [self staticRuleCount:^(int64_t count) {
+            xpc_dictionary_set_int64(reply, kSNTXPCFastPathCountKey, count);
+          }];
+        }
+      forOperation:SNTXPCFastPathOperationStaticRuleCount];
+
+  [_fastPathServer
+        setHandler:^(xpc_object_t request, xpc_object_t reply) {
+          STRONGIFY(self);
+          if (!self) {
+            return;
+          }
+          size_t length = 0;
+          const SantaVnode* packed = static_cast<const SantaVnode*>(
+              xpc_dictionary_get_data(request, kSNTXPCFastPathVnodeIDsKey, &length));
+          size_t count = packed ? length / sizeof(SantaVnode) : 0;
+
+          std::vector<int64_t> actions(count);
+          std::vector<int64_t> decisions(count);
+          SNTDecisionCache* decisionCache = [SNTDecisionCache sharedCache];
+          for (size_t i = 0; i < count; i++) {
+            actions[i] = self.checkCacheBlock(packed[i]);
+            decisions[i] = [decisionCache cachedDecisionForVnode:packed[i]].decision;
+          }
+
+          xpc_dictionary_set_data(reply, kSNTXPCFastPathActionsKey, actions.data(),
+                                  actions.size() * sizeof(int64_t));
+          xpc_dictionary_set_data(reply, kSNTXPCFastPathDecisionsKey, decisions.data(),
+                                  decisions.size() * sizeof(int64_t));
+        }
+      forOperation:SNTXPCFastPathOperationCheckCache];
+
+  [_fastPathServer resume];
+}
+
 - (void)uploadBinary:(NSData*)serializedRequest reply:(void (^)(NSData*))reply {
   dispatch_async(_binaryUploadQ, ^{
     ::santa::commands::v1::BinaryUploadResponse response;
@@ -229,10 +368,89 @@ static NSString* TAMUsernameForUID(uid_t uid) {
   reply(YES);
 }
 
+- (void)flushCacheForVnodeIDs:(NSData*)vnodeIDs reply:(void (^)(uint64_t))reply {
+  absl::flat_hash_set<SantaVnode> vnodes;
+  const SantaVnode* packed = static_cast<const SantaVnode*>(vnodeIDs.bytes);
+  vnodes.insert(packed, packed + vnodeIDs.length / sizeof(SantaVnode));
+  reply(self.flushCacheEntriesBlock([&vnodes](const SantaVnode& vnode) {
+    return vnodes.contains(vnode);
+  }));
+}
+
+- (void)flushCacheForDevice:(uint64_t)fsid reply:(void (^)(uint64_t))reply {
+  reply(self.flushCacheEntriesBlock([fsid](const SantaVnode& vnode) {
+    return vnode.fsid == fsid;
+  }));
+}
+
 - (void)checkCacheForVnodeID:(SantaVnode)vnodeID withReply:(void (^)(SNTAction))reply {
   reply(self.checkCacheBlock(vnodeID));
 }
 
+- (void)checkCacheForVnodeIDs:(NSData*)vnodeIDs
+                    withReply:(void (^)(NSArray<NSNumber*>*, NSArray<NSNumber*>*))reply {
+  const SantaVnode* packed = static_cast<const SantaVnode*>(vnodeIDs.bytes);
+  NSUInteger count = vnodeIDs.length / sizeof(SantaVnode);
+  NSMutableArray<NSNumber*>* actions = [NSMutableArray arrayWithCapacity:count];
+  NSMutableArray<NSNumber*>* decisions = [NSMutableArray arrayWithCapacity:count];
+  SNTDecisionCache* decisionCache = [SNTDecisionCache sharedCache];
+  for (NSUInteger i = 0; i < count; i++) {
+    [actions addObject:@(self.checkCacheBlock(packed[i]))];
+    [decisions addObject:@([decisionCache cachedDecisionForVnode:packed[i]].decision)];
+  }
+  reply(actions, decisions);
+}
+
+- (void)cachedIdentityForFileHandle:(NSFileHandle*)fileHandle
+                              reply:(void (^)(SNTCachedDecision*))reply {
+  // The file version comes from the caller's descriptor rather than from values it sends, so it
+  // can't be used to learn about files the caller can't open.
+  struct stat sb;
+  if (!fileHandle || fstat(fileHandle.fileDescriptor, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+    reply(nil);
+    return;
+  }
+
+  SNTCachedDecision* cd = [[SNTDecisionCache sharedCache] cachedDecisionForFileVersion:sb];
+  if (!cd) {
+    reply(nil);
+    return;
+  }
+
+  // Only the identity is shared, not how the file was evaluated.
+  SNTCachedDecision* identity =
+      [[SNTCachedDecision alloc] initWithVnode:SantaVnode::VnodeForFile(sb)];
+  identity.sha256 = cd.sha256;
+  identity.cdhash = cd.cdhash;
+  identity.teamID = cd.teamID;
+  identity.signingID = cd.signingID;
+  identity.certSHA256 = cd.certSHA256;
+  identity.signingStatus = cd.signingStatus;
+  identity.platformBinary = cd.platformBinary;
+  reply(identity);
+}
+
+- (void)knownSHA256sForFileHandles:(NSArray<NSFileHandle*>*)fileHandles
+                             reply:(void (^)(NSArray<NSString*>*))reply {
+  NSMutableArray<NSString*>* sha256s = [NSMutableArray arrayWithCapacity:fileHandles.count];
+  SNTDecisionCache* decisionCache = [SNTDecisionCache sharedCache];
+  for (NSFileHandle* fileHandle in fileHandles) {
+    struct stat sb;
+    NSString* sha256;
+    if (fstat(fileHandle.fileDescriptor, &sb) == 0 && S_ISREG(sb.st_mode)) {
+      sha256 = [decisionCache knownSHA256ForFile:sb];
+    }
+    [sha256s addObject:sha256 ?: @""];
+  }
+  reply(sha256s);
+}
+
+#pragma mark Fast path ops
+
+- (void)fastPathEndpoint:(void (^)(xpc_endpoint_t))reply {
+  reply([_fastPathServer endpoint]);
+}
+
 #pragma mark Database ops
 
 - (void)databaseRuleCounts:(void (^)(RuleCounts ruleTypeCounts))reply {
@@ -279,55 +497,159 @@ static NSString* TAMUsernameForUID(uid_t uid) {
                           ruleCleanup:(SNTRuleCleanup)cleanupType
                                source:(SNTRuleAddSource)source
                                 reply:(void (^)(BOOL, NSArray<NSError*>* error))reply {
-#ifndef DEBUG
-  SNTConfigurator* config = [SNTConfigurator configurator];
-  if (source == SNTRuleAddSourceSantactl && (config.syncBaseURL || config.staticRules.count > 0)) {
-    NSError* error;
-    [SNTError populateError:&error
-                   withCode:SNTErrorCodeManualRulesDisabled
-                    message:@"Rejected by the Santa daemon"
-                     detail:@"SyncBaseURL or StaticRules are set"];
-    reply(NO, @[ error ]);
+  NSError* sourceError = RuleAddSourceError(source);
+  if (sourceError) {
+    reply(NO, @[ sourceError ]);
     return;
   }
-#endif
 
   SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
 
   // If any rules are added that are not plain allowlist rules, then flush decision cache.
   // In particular, the addition of allowlist compiler rules should cause a cache flush.
   // We also flush cache if a allowlist compiler rule is replaced with a allowlist rule.
-  BOOL flushCache = ((cleanupType != SNTRuleCleanupNone) || (fileAccessRules.count > 0) ||
+  // Updates with a cleanup are instead checked by the rule table once applied, as the rules
+  // they remove are only known then.
+  BOOL flushCache = (cleanupType == SNTRuleCleanupNone) &&
+                    ((fileAccessRules.count > 0) ||
                      [ruleTable addedRulesShouldFlushDecisionCache:executionRules]);
 
   NSArray<NSError*>* errors;
+  BOOL cleanupShouldFlushCache = NO;
   BOOL success = [ruleTable addExecutionRules:executionRules
                               fileAccessRules:fileAccessRules
                              networkFlowRules:networkFlowRules
                                       signals:signals
                                   ruleCleanup:cleanupType
+                           flushDecisionCache:&cleanupShouldFlushCache
                                        errors:&errors];
 
+  // File access rules and cleanups can affect any file, so only plain updates of execution
+  // rules flush selectively.
+  [self rulesAddedShouldFlushCache:(flushCache || cleanupShouldFlushCache)
+                      changedRules:((cleanupShouldFlushCache || fileAccessRules.count > 0)
+                                        ? nil
+                                        : executionRules)];
+  reply(success, errors);
+}
+
+- (void)databaseRuleBeginStagedUpdateFromSource:(SNTRuleAddSource)source
+                                          reply:(void (^)(NSString* updateID,
+                                                          NSError* error))reply {
+  NSError* sourceError = RuleAddSourceError(source);
+  if (sourceError) {
+    reply(nil, sourceError);
+    return;
+  }
+
+  self.stagedRulesShouldFlushCache = NO;
+  self.stagedRulesToFlush = @[];
+  NSString* updateID = [[SNTDatabaseController ruleTable] beginStagedRuleUpdate];
+  if (!updateID) {
+    reply(nil, [SNTError createErrorWithCode:SNTErrorCodeStagedUpdateInvalid
+                                      format:@"Failed to begin a staged rule update"]);
+    return;
+  }
+  reply(updateID, nil);
+}
+
+- (void)databaseRuleStageExecutionRules:(NSArray<SNTRule*>*)executionRules
+                        fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
+                       networkFlowRules:(NSArray<SNTNetworkFlowRule*>*)networkFlowRules
+                                signals:(NSArray<SNTSignal*>*)signals
+                               updateID:(NSString*)updateID
+                                  reply:(void (^)(BOOL, NSArray<NSError*>* error))reply {
+  SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
+
+  // Staged rules are only applied on commit, so the database still holds the rules they would
+  // replace and the flush decision can be made per chunk, as for an unstaged update.
+  if (fileAccessRules.count > 0 || [ruleTable addedRulesShouldFlushDecisionCache:executionRules]) {
+    self.stagedRulesShouldFlushCache = YES;
+    self.stagedRulesToFlush =
+        fileAccessRules.count > 0
+            ? nil
+            : [self.stagedRulesToFlush arrayByAddingObjectsFromArray:executionRules];
+  }
+
+  NSArray<NSError*>* errors;
+  BOOL success = [ruleTable stageExecutionRules:executionRules
+                                fileAccessRules:fileAccessRules
+                               networkFlowRules:networkFlowRules
+                                        signals:signals
+                                       updateID:updateID
+                                         errors:&errors];
+  reply(success, errors);
+}
+
+- (void)databaseRuleStageExecutionRuleBatch:(NSData*)batch
+                                   updateID:(NSString*)updateID
+                                      reply:(void (^)(BOOL, NSArray<NSError*>* error))reply {
+  SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
+  if ([ruleTable addedRuleBatchShouldFlushDecisionCache:batch]) {
+    // The rules in a batch aren't decoded here, so all caches are flushed on commit.
+    self.stagedRulesShouldFlushCache = YES;
+    self.stagedRulesToFlush = nil;
+  }
+
+  NSArray<NSError*>* errors;
+  BOOL success = [ruleTable stageExecutionRuleBatch:batch updateID:updateID errors:&errors];
+  reply(success, errors);
+}
+
+- (void)databaseRuleCommitStagedUpdate:(NSString*)updateID
+                           ruleCleanup:(SNTRuleCleanup)cleanupType
+                                 reply:(void (^)(BOOL, NSArray<NSError*>* error))reply {
+  SNTRuleTable* ruleTable = [SNTDatabaseController ruleTable];
+
+  NSArray<NSError*>* errors;
+  BOOL cleanupShouldFlushCache = NO;
+  BOOL success = [ruleTable commitStagedRuleUpdate:updateID
+                                       ruleCleanup:cleanupType
+                                flushDecisionCache:&cleanupShouldFlushCache
+                                            errors:&errors];
+
+  // As for unstaged updates, updates with a cleanup are checked by the rule table.
+  [self rulesAddedShouldFlushCache:((cleanupType == SNTRuleCleanupNone &&
+                                     self.stagedRulesShouldFlushCache) ||
+                                    cleanupShouldFlushCache)
+                      changedRules:(cleanupShouldFlushCache ? nil : self.stagedRulesToFlush)];
+  reply(success, errors);
+}
+
+- (void)databaseRuleAbortStagedUpdate:(NSString*)updateID {
+  [[SNTDatabaseController ruleTable] abortStagedRuleUpdate:updateID];
+}
+
+// When changedRules is set, only the cache entries for files whose decision could depend on
+// one of them are flushed. Otherwise all caches are flushed.
+- (void)rulesAddedShouldFlushCache:(BOOL)flushCache changedRules:(NSArray<SNTRule*>*)changedRules {
   // Whenever we add rules, we can also check for and remove outdated transitive rules.
-  [ruleTable removeOutdatedTransitiveRules];
+  [[SNTDatabaseController ruleTable] removeOutdatedTransitiveRules];
 
   // The actual cache flushing happens after the new rules have been added to the database.
   if (flushCache) {
-    LOGI(@"Flushing caches");
-    if (self.flushCacheBlock) {
+    if (changedRules && self.flushCacheForRulesBlock) {
+      LOGI(@"Flushing caches for %lu changed rules", changedRules.count);
+      self.flushCacheForRulesBlock(changedRules);
+    } else if (self.flushCacheBlock) {
+      LOGI(@"Flushing caches");
       self.flushCacheBlock(FlushCacheMode::kAllCaches, FlushCacheReason::kRulesChanged);
     }
   }
-
-  reply(success, errors);
 }
 
 - (void)databaseEventCount:(void (^)(int64_t count))reply {
   reply([[SNTDatabaseController eventTable] pendingEventsCount]);
 }
 
-- (void)databaseEventsPending:(void (^)(NSArray<SNTStoredEvent*>* events))reply {
-  reply([[SNTDatabaseController eventTable] pendingEvents]);
+- (void)databaseEventsPendingAfterIndex:(NSNumber*)index
+                                  limit:(NSUInteger)limit
+                                  reply:(void (^)(NSData* encodedEvents,
+                                                  NSArray<SNTStoredEvent*>* events))reply {
+  NSArray<SNTStoredEvent*>* events =
+      [[SNTDatabaseController eventTable] pendingEventsAfterIndex:index limit:limit];
+  NSData* encodedEvents = santa::EncodeStoredEventBatch(events);
+  reply(encodedEvents, encodedEvents ? nil : events);
 }
 
 - (void)databaseRemoveEventsWithIDs:(NSArray*)ids {
@@ -442,24 +764,90 @@ static NSString* TAMUsernameForUID(uid_t uid) {
   reply([SNTConfigurator configurator].staticRules.count);
 }
 
-- (void)retrieveAllExecutionRules:(void (^)(NSArray<SNTRule*>*, NSError*))reply {
+// Rules are not handed out if syncBaseURL or static rules are set, except in debug builds.
+static NSError* RuleRetrievalError() {
 #ifndef DEBUG
   SNTConfigurator* config = [SNTConfigurator configurator];
-  // Do not return any rules if syncBaseURL or static rules are set and return an error.
   if (config.syncBaseURL || config.staticRules.count) {
     NSError* error;
     [SNTError populateError:&error
                    withCode:SNTErrorCodeManualRulesDisabled
                      format:@"SyncBaseURL is set"];
+    return error;
+  }
+#endif
+  return nil;
+}
+
+- (void)retrieveAllExecutionRules:(void (^)(NSArray<SNTRule*>*, NSError*))reply {
+  NSError* error = RuleRetrievalError();
+  if (error) {
     reply(@[], error);
     return;
   }
-#endif
 
   NSArray<SNTRule*>* rules = [[SNTDatabaseController ruleTable] retrieveAllExecutionRules];
   reply(rules, nil);
 }
 
+- (void)exportExecutionRulesToFileHandle:(NSFileHandle*)fileHandle
+                                   reply:(void (^)(NSUInteger, NSError*))reply {
+  NSError* error = RuleRetrievalError();
+  if (error) {
+    reply(0, error);
+    return;
+  }
+
+  // Rules are serialized one at a time into a buffer that's written out whenever it fills, so
+  // neither the rules nor their JSON are ever held in memory all at once.
+  static const NSUInteger kFlushSize = 256 * 1024;
+  NSMutableData* buffer = [NSMutableData dataWithCapacity:kFlushSize * 2];
+  __block NSUInteger count = 0;
+  __block NSError* writeError;
+  BOOL (^flush)(void) = ^BOOL {
+    NSError* err;
+    if (![fileHandle writeData:buffer error:&err]) {
+      writeError = err;
+      return NO;
+    }
+    buffer.length = 0;
+    return YES;
+  };
+
+  [buffer appendData:[@"{\"rules\": [" dataUsingEncoding:NSUTF8StringEncoding]];
+
+  // Transitive and remove rules aren't relevant outside this machine.
+  [[SNTDatabaseController ruleTable]
+      enumerateExecutionRulesExcludingStates:@[
+        @(SNTRuleStateAllowTransitive), @(SNTRuleStateRemove)
+      ]
+                                  usingBlock:^(SNTRule* rule, BOOL* stop) {
+                                    NSError* err;
+                                    NSData* json = [NSJSONSerialization
+                                        dataWithJSONObject:[rule dictionaryRepresentation]
+                                                   options:0
+                                                     error:&err];
+                                    if (!json) writeError = err;
+                                    if (!json || (buffer.length >= kFlushSize && !flush())) {
+                                      *stop = YES;
+                                      return;
+                                    }
+                                    if (count++) [buffer appendBytes:",\n" length:2];
+                                    [buffer appendData:json];
+                                  }];
+
+  [buffer appendData:[@"]}\n" dataUsingEncoding:NSUTF8StringEncoding]];
+  if (!writeError) flush();
+  [fileHandle closeFile];
+
+  if (writeError) {
+    LOGE(@"Failed to export rules: %@", writeError.localizedDescription);
+    reply(0, writeError);
+    return;
+  }
+  reply(count, nil);
+}
+
 - (void)retrieveAllFileAccessRules:
     (void (^)(NSDictionary<NSString*, NSDictionary*>* fileAccessRules, NSError* error))reply {
 #ifdef DEBUG
@@ -571,6 +959,20 @@ static NSString* TAMUsernameForUID(uid_t uid) {
 }
 
 - (void)updateSyncSettings:(SNTConfigBundle*)result reply:(void (^)(void))reply {
+  // A single sync can change several settings that each flush the caches (CEL fallback rules,
+  // mode, static rules, ...). Apply them inside a flush batch so the caches are flushed once.
+  if (self.flushBatchBlock) {
+    self.flushBatchBlock(^{
+      [self applySyncSettings:result];
+    });
+  } else {
+    [self applySyncSettings:result];
+  }
+
+  reply();
+}
+
+- (void)applySyncSettings:(SNTConfigBundle*)result {
   SNTConfigurator* configurator = [SNTConfigurator configurator];
 
   // Snapshot CEL state to detect changes across the commit, including the
@@ -759,8 +1161,6 @@ static NSString* TAMUsernameForUID(uid_t uid) {
       }
     }];
   }
-
-  reply();
 }
 
 #pragma mark Command Ops
@@ -768,7 +1168,130 @@ static NSString* TAMUsernameForUID(uid_t uid) {
 - (void)killProcesses:(SNTKillRequest*)killRequest reply:(void (^)(SNTKillResponse*))reply {
   // Perform work asynchronously to not hold up processing other XPC messages
   dispatch_async(self.commandQ, ^{
-    reply(santa::KillingMachine(killRequest));
+    reply(santa::KillingMachine(killRequest, self->_processTree.get()));
+  });
+}
+
+#pragma mark Exec Tracing Ops
+
+- (void)enableExecTracingForPID:(NSNumber*)pid
+                     pathPrefix:(NSString*)pathPrefix
+                     sampleRate:(uint32_t)sampleRate
+                durationSeconds:(uint32_t)durationSeconds
+                   exportTraces:(BOOL)exportTraces
+                          reply:(void (^)(void))reply {
+  santa::ExecTraceConfig config{
+      .pid = pid ? std::make_optional([pid intValue]) : std::nullopt,
+      .path_prefix = santa::NSStringToUTF8String(pathPrefix ?: @""),
+      .sample_rate = sampleRate,
+      .duration_secs = durationSeconds,
+      .export_traces = exportTraces != NO,
+  };
+  LOGI(@"Exec tracing enabled for %d seconds (pid: %@, path prefix: %@, sample rate: %u)",
+       durationSeconds, pid ?: @"any", pathPrefix.length ? pathPrefix : @"any", sampleRate);
+  santa::ExecTracer::Shared().Enable(std::move(config));
+  reply();
+}
+
+- (void)disableExecTracing:(void (^)(void))reply {
+  LOGI(@"Exec tracing disabled");
+  santa::ExecTracer::Shared().Disable();
+  reply();
+}
+
+- (void)execTraces:(void (^)(NSArray<NSDictionary*>* traces, BOOL enabled))reply {
+  santa::ExecTracer& tracer = santa::ExecTracer::Shared();
+  NSMutableArray<NSDictionary*>* traces = [NSMutableArray array];
+  for (const santa::ExecTrace::Summary& summary : tracer.TakeCompletedTraces()) {
+    NSMutableDictionary<NSString*, NSNumber*>* stages = [NSMutableDictionary dictionary];
+    for (size_t i = 0; i < santa::kExecTraceStageCount; i++) {
+      if (summary.stage_ns[i] > 0) {
+        stages[santa::StringToNSString(
+            santa::ExecTraceStageName(static_cast<santa::ExecTraceStage>(i)))] =
+            @(summary.stage_ns[i]);
+      }
+    }
+
+    [traces addObject:@{
+      @"id" : @(summary.id),
+      @"pid" : @(summary.pid),
+      @"path" : santa::StringToNSString(summary.path),
+      @"result" : santa::StringToNSString(summary.result),
+      @"start_time" : [NSDate dateWithTimeIntervalSince1970:summary.start_time.tv_sec +
+                                                            summary.start_time.tv_nsec / 1e9],
+      @"total_ns" : @(summary.total_ns),
+      @"hash_bytes_read" : @(summary.hash_bytes_read),
+      @"stages" : stages,
+    }];
+  }
+  reply(traces, tracer.Config().has_value());
+}
+
+#pragma mark Memory Diagnostics Ops
+
+- (void)heapSample:(void (^)(NSDictionary* sample, NSError* error))reply {
+  static const uint64_t kMinHeapSampleIntervalNanos = 60 * NSEC_PER_SEC;
+
+  // Samples run one at a time, off of the queue handling other XPC messages.
+  dispatch_async(self.commandQ, ^{
+    uint64_t now = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    if (self->_lastHeapSampleNanos != 0 &&
+        now - self->_lastHeapSampleNanos < kMinHeapSampleIntervalNanos) {
+      reply(nil, [SNTError
+                     createErrorWithFormat:@"A heap sample was taken less than %llu seconds ago",
+                                           kMinHeapSampleIntervalNanos / NSEC_PER_SEC]);
+      return;
+    }
+    self->_lastHeapSampleNanos = now;
+
+    santa::HeapSample::Result result = santa::HeapSample::Collect();
+    LOGI(@"Heap sample of %zu malloc zones took %llu ms", result.zones.size(),
+         result.duration_ns / NSEC_PER_MSEC);
+
+    NSMutableArray<NSDictionary*>* zones = [NSMutableArray array];
+    for (const santa::HeapSample::Zone& zone : result.zones) {
+      NSMutableArray<NSDictionary*>* sizeClasses = [NSMutableArray array];
+      for (size_t i = 0; i < santa::HeapSample::kSizeClasses; i++) {
+        const santa::HeapSample::SizeClass& sizeClass = zone.size_classes[i];
+        if (sizeClass.blocks == 0) continue;
+        [sizeClasses addObject:@{
+          // Blocks in the class are smaller than twice this, except in the last class.
+          @"min_block_bytes" : @(i == 0 ? 0ULL : 1ULL << (i - 1)),
+          @"blocks" : @(sizeClass.blocks),
+          @"bytes" : @(sizeClass.bytes),
+        }];
+      }
+      [zones addObject:@{
+        @"name" : santa::StringToNSString(zone.name),
+        @"blocks" : @(zone.blocks),
+        @"bytes" : @(zone.bytes),
+        @"size_classes" : sizeClasses,
+      }];
+    }
+
+    NSMutableArray<NSDictionary*>* classes = [NSMutableArray array];
+    for (const santa::HeapSample::ClassUsage& usage : result.classes) {
+      [classes addObject:@{
+        @"name" : santa::StringToNSString(usage.name),
+        @"instances" : @(usage.instances),
+        @"bytes" : @(usage.bytes),
+      }];
+    }
+
+    NSMutableDictionary<NSString*, NSNumber*>* subsystems = [NSMutableDictionary dictionary];
+    for (const auto& [subsystem, bytes] :
+         santa::MemoryAttribution::Shared().CollectSubsystems()) {
+      subsystems[subsystem] = @(bytes);
+    }
+
+    NSMutableDictionary* sample = [NSMutableDictionary dictionary];
+    sample[@"timestamp"] = @([[NSDate date] timeIntervalSince1970]);
+    sample[@"duration_ns"] = @(result.duration_ns);
+    sample[@"footprint_bytes"] = @(santa::MemoryAttribution::PhysicalFootprint().value_or(0));
+    sample[@"subsystems"] = subsystems;
+    sample[@"zones"] = zones;
+    sample[@"classes"] = classes;
+    reply(sample, nil);
   });
 }
 
@@ -18,11 +18,13 @@
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
 #include <bsm/libbsm.h>
+#include <sys/stat.h>
 
 #include <memory>
 
 #import "Source/common/AuditUtilities.h"
 #import "Source/common/MOLXPCConnection.h"
+#import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTError.h"
 #import "Source/common/SNTNetworkFlowRule.h"
 #import "Source/common/SNTRule.h"
@@ -30,6 +32,7 @@
 #import "Source/common/SNTSandboxExecRequest.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #import "Source/santad/SNTDatabaseController.h"
+#import "Source/santad/SNTDecisionCache.h"
 #include "Source/santad/SandboxExpectations.h"
 
 using santa::SandboxExpectations;
@@ -78,6 +81,14 @@ static NSString* const kBinarySHA256 =
       sandboxExpectations:_sandboxExpectations
       flushCacheBlock:^(santa::FlushCacheMode, santa::FlushCacheReason) {
       }
+      flushCacheForRulesBlock:^(NSArray<SNTRule*>*) {
+      }
+      flushCacheEntriesBlock:^uint64_t(std::function<bool(const SantaVnode&)>) {
+        return 0;
+      }
+      flushBatchBlock:^(void (^changes)(void)) {
+        changes();
+      }
       cacheCountBlock:^NSArray<NSNumber*>*() {
         return @[];
       }
@@ -86,7 +97,8 @@ static NSString* const kBinarySHA256 =
       }
       metricsExportBlock:^(void (^)(BOOL)) {
       }
-      binaryUploadController:nullptr];
+      binaryUploadController:nullptr
+      processTree:nullptr];
 }
 
 - (void)tearDown {
@@ -261,7 +273,7 @@ static NSString* const kBinarySHA256 =
   XCTAssertTrue(consumed.has_value());
   XCTAssertEqual(consumed->dev, 17u);
   XCTAssertEqual(consumed->ino, 42u);
-  XCTAssertTrue(consumed->sha256 == kBinarySHA256.UTF8String);
+  XCTAssertTrue(consumed->sha256 == santa::SHA256Digest::FromHex(kBinarySHA256));
 }
 
 - (void)testRejectsDuplicateRegistration {
@@ -306,6 +318,7 @@ static NSString* const kBinarySHA256 =
                                networkFlowRules:OCMOCK_ANY
                                         signals:OCMOCK_ANY
                                     ruleCleanup:SNTRuleCleanupNone
+                             flushDecisionCache:(BOOL*)[OCMArg anyPointer]
                                          errors:[OCMArg anyObjectRef]])
       .andDo(^(NSInvocation* inv) {
         __unsafe_unretained NSArray<SNTNetworkFlowRule*>* captured = nil;
@@ -359,6 +372,82 @@ static NSString* const kBinarySHA256 =
   [mockHash stopMocking];
 }
 
+// ---- checkCacheForVnodeIDs: one reply per vnode -------------------------
+
+- (void)testCheckCacheForVnodeIDs {
+  SantaVnode vnodes[] = {{.fsid = 12345, .fileid = 1}, {.fsid = 12345, .fileid = 2}};
+  __block NSArray<NSNumber*>* gotActions;
+  __block NSArray<NSNumber*>* gotDecisions;
+  [self.sut checkCacheForVnodeIDs:[NSData dataWithBytes:vnodes length:sizeof(vnodes)]
+                        withReply:^(NSArray<NSNumber*>* actions, NSArray<NSNumber*>* decisions) {
+                          gotActions = actions;
+                          gotDecisions = decisions;
+                        }];
+
+  XCTAssertEqualObjects(gotActions, (@[ @(SNTActionRespondAllow), @(SNTActionRespondAllow) ]));
+  XCTAssertEqualObjects(gotDecisions, (@[ @0, @0 ]));
+}
+
+// ---- Cached identities: versions read from file handles ------------------
+
+- (void)testCachedIdentityForFileHandle {
+  NSString* path = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"identity-%@",
+                                                                [NSUUID UUID].UUIDString]];
+  XCTAssertTrue([@"contents" writeToFile:path
+                               atomically:NO
+                                 encoding:NSUTF8StringEncoding
+                                    error:nil]);
+  NSFileHandle* fh = [NSFileHandle fileHandleForUpdatingAtPath:path];
+  XCTAssertNotNil(fh);
+
+  struct stat sb;
+  XCTAssertEqual(fstat(fh.fileDescriptor, &sb), 0);
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] initWithVnode:SantaVnode::VnodeForFile(sb)];
+  cd.sha256 = kBinarySHA256;
+  [cd recordFileVersion:&sb];
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+  [dc cacheDecision:cd];
+
+  __block SNTCachedDecision* identity;
+  [self.sut cachedIdentityForFileHandle:fh
+                                  reply:^(SNTCachedDecision* reply) {
+                                    identity = reply;
+                                  }];
+  XCTAssertEqualObjects(identity.sha256, kBinarySHA256);
+
+  __block NSArray<NSString*>* sha256s;
+  [self.sut knownSHA256sForFileHandles:@[ fh ]
+                                 reply:^(NSArray<NSString*>* reply) {
+                                   sha256s = reply;
+                                 }];
+  XCTAssertEqualObjects(sha256s, @[ kBinarySHA256 ]);
+
+  // Once the file is written to, the cached identity no longer describes it.
+  [fh seekToEndOfFile];
+  [fh writeData:[@"more" dataUsingEncoding:NSUTF8StringEncoding]];
+  [self.sut cachedIdentityForFileHandle:fh
+                                  reply:^(SNTCachedDecision* reply) {
+                                    identity = reply;
+                                  }];
+  XCTAssertNil(identity);
+  [self.sut knownSHA256sForFileHandles:@[ fh ]
+                                 reply:^(NSArray<NSString*>* reply) {
+                                   sha256s = reply;
+                                 }];
+  XCTAssertEqualObjects(sha256s, @[ @"" ]);
+
+  [self.sut cachedIdentityForFileHandle:nil
+                                  reply:^(SNTCachedDecision* reply) {
+                                    identity = reply;
+                                  }];
+  XCTAssertNil(identity);
+
+  [dc forgetCachedDecisionForVnode:cd.vnodeId];
+  [fh closeFile];
+  [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
 // ---- databaseRuleCounts: includes networkFlow ------------------------
 
 - (void)testDatabaseRuleCountsIncludesNetworkFlow {
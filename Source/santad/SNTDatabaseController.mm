@@ -27,6 +27,9 @@
 static NSString* const kDatabasePath = @"/var/db/santa";
 static NSString* const kRulesDatabaseName = @"rules.db";
 static NSString* const kEventsDatabaseName = @"events.db";
+// Read-only connections to the rules database. Each auth thread that misses
+// the in-memory rule index, and each santactl query, holds one for a lookup.
+static const NSUInteger kRulesDatabaseReaders = 4;
 
 + (NSString* const)databasePath {
   return kDatabasePath;
@@ -72,9 +75,16 @@ static NSString* const kEventsDatabaseName = @"events.db";
 #endif
 
     ruleDatabase = [[SNTRuleTable alloc] initWithDatabaseQueue:dbq];
-
-    chown([fullPath UTF8String], 0, 0);
-    chmod([fullPath UTF8String], 0600);
+    [ruleDatabase enableConcurrentReadsWithMaxReaders:kRulesDatabaseReaders];
+
+    // WAL journaling keeps part of the database in these files alongside it.
+    for (NSString* path in @[
+           fullPath, [fullPath stringByAppendingString:@"-wal"],
+           [fullPath stringByAppendingString:@"-shm"]
+         ]) {
+      chown([path UTF8String], 0, 0);
+      chmod([path UTF8String], 0600);
+    }
   });
   return ruleDatabase;
 }
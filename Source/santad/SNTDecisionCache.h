@@ -13,12 +13,18 @@
 /// See the License for the specific language governing permissions and
 /// limitations under the License.
 
+#include <bsm/libbsm.h>
 #include <sys/stat.h>
 
 #import <Foundation/Foundation.h>
 
+#include <functional>
+#include <string_view>
+
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTFileInfo.h"
+#import "Source/common/SNTRule.h"
+#include "Source/common/SantaCacheStats.h"
 #import "Source/common/SantaVnode.h"
 #include "Source/santad/EntitlementsFilter.h"
 
@@ -34,8 +40,42 @@ inline constexpr off_t kMaxSyncRehydrateBytes = 32 * 1024 * 1024;
 - (bool)cacheDecision:(SNTCachedDecision*)cd;
 - (SNTCachedDecision*)cachedDecisionForFile:(const struct stat&)statInfo;
 - (SNTCachedDecision*)cachedDecisionForVnode:(SantaVnode)vnode;
+// Returns the cached decision for the file only if its identity fields were
+// computed for this exact version of the file.
+- (SNTCachedDecision*)cachedDecisionForFileVersion:(const struct stat&)statInfo;
 - (void)forgetCachedDecisionForVnode:(SantaVnode)vnode;
+// Forgets the cached decisions and prehashed SHA-256s for all files on the
+// given device, e.g. after it is unmounted.
+- (void)forgetCachedDecisionsForDevice:(dev_t)fsid;
+// Returns a predicate telling whether the decision for a vnode could depend on
+// any of the given execution rules, matching the rule identifiers against the
+// SHA-256, CDHash, signing ID, team ID and certificate SHA-256 of its cached
+// decision. Vnodes without a cached decision, or whose decision lacks a lazily
+// computed SHA-256 that a rule could match, are always reported as affected.
+- (std::function<bool(const SantaVnode&)>)affectedVnodesPredicateForRules:
+    (NSArray<SNTRule*>*)rules;
 - (SNTCachedDecision*)resetTimestampForCachedDecision:(const struct stat&)statInfo;
+// Updates the timestamp of the transitive rule that allowed the decision, if
+// any. Writes for the same rule are rate limited.
+- (void)resetTimestampForDecision:(SNTCachedDecision*)cd;
+// Remembers the decision made while authorizing an exec, keyed by the pid and
+// pidversion of the new process image, so that the clients handling the
+// matching NOTIFY_EXEC can reuse it without looking the file up again. Only a
+// bounded number of pending execs is kept; older entries are evicted.
+- (void)recordDecision:(SNTCachedDecision*)cd forExecOfProcess:(const audit_token_t&)token;
+// Returns the decision recorded for the exec of the given process, falling back
+// to the cached decision for the executable if none was recorded.
+- (SNTCachedDecision*)decisionForExecOfProcess:(const audit_token_t&)token
+                                          file:(const struct stat&)statInfo;
+// As above, but also forgets the recorded decision. Called once the exec has
+// been fully handled, e.g. when its NOTIFY_EXEC is logged.
+- (SNTCachedDecision*)takeDecisionForExecOfProcess:(const audit_token_t&)token
+                                              file:(const struct stat&)statInfo;
+- (SantaCacheStats)cacheStats;
+- (SantaCacheUsage)cacheUsage;
+// Changes the maximum number of cached decisions, evicting decisions if the
+// cache is over the new maximum.
+- (void)setMaximumCacheSize:(uint64_t)maximumSize;
 // Must be called exactly once, during daemon initialization, before any
 // rehydrate or backfill caller can run. Subsequent calls trip an assert —
 // the filter is not atomically swappable. Reads on other threads are
@@ -58,5 +98,19 @@ inline constexpr off_t kMaxSyncRehydrateBytes = 32 * 1024 * 1024;
 // so repeated calls for the same vnode while a rehydrate is enqueued or
 // running are coalesced.
 - (void)asyncRehydrateAndCacheDecisionForFileInfo:(SNTFileInfo*)fi;
+// Speculatively hashes a file that was just written so that its first
+// execution can reuse the SHA-256 instead of computing it inside the ES
+// deadline. Only regular, executable Mach-O files are hashed. Requests are
+// rate limited, coalesced per vnode and dropped when too many are already
+// pending; all work runs on the utility QoS cache-populate queue.
+- (void)prehashFileAsync:(std::string_view)path stat:(const struct stat&)statInfo;
+// Returns and forgets the speculatively computed SHA-256 for the file, or nil
+// if it wasn't prehashed or has changed since. A file is considered unchanged
+// if its size, mtime and ctime all still match those observed while hashing.
+- (NSString*)takePrehashedSHA256ForFile:(const struct stat&)statInfo;
+// Returns the SHA-256 santad already computed for this version of the file,
+// either while evaluating an exec or by prehashing, or nil if it has none.
+// Unlike takePrehashedSHA256ForFile:, prehashed entries are left in place.
+- (NSString*)knownSHA256ForFile:(const struct stat&)statInfo;
 
 @end
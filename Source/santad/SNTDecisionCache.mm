@@ -22,10 +22,15 @@
 #include <sys/qos.h>
 
 #include <cassert>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <string>
+#include <utility>
 
 #include "Source/common/AuditUtilities.h"
 #include "Source/common/CodeSigningIdentifierUtils.h"
+#include "Source/common/FileVersion.h"
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/MOLCodesignChecker.h"
 #import "Source/common/SNTCachedDecision.h"
@@ -33,6 +38,7 @@
 #import "Source/common/SNTFileInfo.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTRule.h"
+#import "Source/common/SNTSigningInfoCache.h"
 #include "Source/common/SantaCache.h"
 #include "Source/common/SantaVnode.h"
 #import "Source/common/SigningIDHelpers.h"
@@ -41,6 +47,34 @@
 #import "Source/santad/SNTDatabaseController.h"
 #include "absl/container/flat_hash_set.h"
 
+// Files larger than this are not speculatively hashed.
+static constexpr off_t kMaxPrehashBytes = 1024 * 1024 * 1024;
+// Upper bound on prehash requests accepted per second, and on requests
+// waiting for or being hashed at any one time.
+static constexpr uint32_t kMaxPrehashesPerSecond = 10;
+static constexpr size_t kMaxPendingPrehashes = 64;
+static constexpr size_t kPrehashCacheSize = 1024;
+// Execs only stay pending between their AUTH and NOTIFY events, so this only
+// needs to cover the number of execs in flight at once.
+static constexpr size_t kExecContextCacheSize = 4096;
+
+using ExecKey = std::pair<pid_t, int>;
+
+static inline ExecKey ExecKeyForToken(const audit_token_t& token) {
+  return std::make_pair(audit_token_to_pid(token), audit_token_to_pidversion(token));
+}
+
+// A SHA-256 computed ahead of the first execution of a file, along with the
+// stat info of the file version that was hashed.
+struct PrehashedFile {
+  NSString* sha256;
+  struct stat sb;
+
+  bool operator==(const PrehashedFile& other) const {
+    return sha256 == other.sha256 && sb.st_dev == other.sb.st_dev && sb.st_ino == other.sb.st_ino;
+  }
+};
+
 @interface SNTDecisionCache ()
 // Cache for sha256 -> date of last timestamp reset.
 @property NSCache<NSString*, NSDate*>* timestampResetMap;
@@ -48,9 +82,14 @@
 @end
 
 @implementation SNTDecisionCache {
-  SantaCache<SantaVnode, SNTCachedDecision*> _decisionCache;
+  std::unique_ptr<SantaCache<SantaVnode, SNTCachedDecision*>> _decisionCache;
   absl::flat_hash_set<SantaVnode> _pendingRehydrates;
+  absl::flat_hash_set<SantaVnode> _pendingPrehashes;
+  uint64_t _prehashWindowStart;
+  uint32_t _prehashWindowCount;
   os_unfair_lock _pendingLock;
+  std::unique_ptr<SantaCache<SantaVnode, PrehashedFile>> _prehashCache;
+  std::unique_ptr<SantaCache<ExecKey, SNTCachedDecision*>> _execContexts;
   std::shared_ptr<santa::EntitlementsFilter> _entitlementsFilter;
 }
 
@@ -81,6 +120,18 @@
 - (instancetype)init {
   self = [super init];
   if (self) {
+    // Decisions are rebuilt by hashing and evaluating the binary again, so
+    // evict gradually rather than dropping the whole cache when it fills.
+    _decisionCache = std::make_unique<SantaCache<SantaVnode, SNTCachedDecision*>>(
+        10000, 5, SantaCacheEvictionPolicy::kClock);
+
+    _prehashCache = std::make_unique<SantaCache<SantaVnode, PrehashedFile>>(
+        kPrehashCacheSize, 2, SantaCacheEvictionPolicy::kClock);
+
+    // Entries for execs whose NOTIFY was never delivered are left to eviction.
+    _execContexts = std::make_unique<SantaCache<ExecKey, SNTCachedDecision*>>(
+        kExecContextCacheSize, 2, SantaCacheEvictionPolicy::kClock);
+
     _timestampResetMap = [[NSCache alloc] init];
     _timestampResetMap.countLimit = 100;
 
@@ -99,23 +150,105 @@
 }
 
 - (bool)cacheDecision:(SNTCachedDecision*)cd {
-  return self->_decisionCache.set(cd.vnodeId, cd);
+  return self->_decisionCache->set(cd.vnodeId, cd);
 }
 
 - (bool)cacheDecisionIfNotSet:(SNTCachedDecision*)cd {
-  return self->_decisionCache.set(cd.vnodeId, cd, nil);
+  return self->_decisionCache->set(cd.vnodeId, cd, nil);
 }
 
 - (SNTCachedDecision*)cachedDecisionForFile:(const struct stat&)statInfo {
-  return self->_decisionCache.get(SantaVnode::VnodeForFile(statInfo));
+  return self->_decisionCache->get(SantaVnode::VnodeForFile(statInfo));
+}
+
+- (void)recordDecision:(SNTCachedDecision*)cd forExecOfProcess:(const audit_token_t&)token {
+  if (!cd) return;
+  self->_execContexts->set(ExecKeyForToken(token), cd);
+}
+
+- (SNTCachedDecision*)decisionForExecOfProcess:(const audit_token_t&)token
+                                          file:(const struct stat&)statInfo {
+  return self->_execContexts->get(ExecKeyForToken(token)) ?: [self cachedDecisionForFile:statInfo];
+}
+
+- (SNTCachedDecision*)takeDecisionForExecOfProcess:(const audit_token_t&)token
+                                              file:(const struct stat&)statInfo {
+  ExecKey key = ExecKeyForToken(token);
+  SNTCachedDecision* cd = self->_execContexts->get(key);
+  if (!cd) {
+    return [self cachedDecisionForFile:statInfo];
+  }
+  self->_execContexts->remove(key);
+  return cd;
 }
 
 - (SNTCachedDecision*)cachedDecisionForVnode:(SantaVnode)vnode {
-  return self->_decisionCache.get(vnode);
+  return self->_decisionCache->get(vnode);
+}
+
+- (SNTCachedDecision*)cachedDecisionForFileVersion:(const struct stat&)statInfo {
+  SNTCachedDecision* cd = [self cachedDecisionForFile:statInfo];
+  return [cd matchesFileVersion:&statInfo] ? cd : nil;
 }
 
 - (void)forgetCachedDecisionForVnode:(SantaVnode)vnode {
-  self->_decisionCache.remove(vnode);
+  self->_decisionCache->remove(vnode);
+}
+
+- (void)forgetCachedDecisionsForDevice:(dev_t)fsid {
+  auto onDevice = [fsid](const SantaVnode& vnode, auto&) { return vnode.fsid == fsid; };
+  self->_decisionCache->remove_if(onDevice);
+  self->_prehashCache->remove_if(onDevice);
+}
+
+- (std::function<bool(const SantaVnode&)>)affectedVnodesPredicateForRules:
+    (NSArray<SNTRule*>*)rules {
+  NSMutableSet<NSString*>* identifiers = [NSMutableSet setWithCapacity:rules.count];
+  BOOL binaryRules = NO;
+  BOOL certificateRules = NO;
+  for (SNTRule* rule in rules) {
+    if (rule.identifier.length) {
+      [identifiers addObject:rule.identifier];
+    }
+    binaryRules |= (rule.type == SNTRuleTypeBinary);
+    certificateRules |= (rule.type == SNTRuleTypeCertificate);
+  }
+
+  return [self, identifiers, binaryRules, certificateRules](const SantaVnode& vnode) {
+    SNTCachedDecision* cd = self->_decisionCache->get(vnode);
+    if (!cd) {
+      return true;
+    }
+
+    // The file and leaf certificate hashes aren't computed for every decision,
+    // so a decision without them can't be ruled out.
+    if ((binaryRules && !cd.sha256.length) ||
+        (certificateRules && cd.cdhash.length && !cd.certSHA256.length)) {
+      return true;
+    }
+
+    for (NSString* identifier in @[
+           cd.sha256 ?: @"", cd.cdhash ?: @"", cd.signingID ?: @"", cd.teamID ?: @"",
+           cd.certSHA256 ?: @""
+         ]) {
+      if ([identifiers containsObject:identifier]) {
+        return true;
+      }
+    }
+    return false;
+  };
+}
+
+- (SantaCacheStats)cacheStats {
+  return self->_decisionCache->stats();
+}
+
+- (SantaCacheUsage)cacheUsage {
+  return self->_decisionCache->usage();
+}
+
+- (void)setMaximumCacheSize:(uint64_t)maximumSize {
+  self->_decisionCache->set_max_size(maximumSize);
 }
 
 // Whenever a cached decision resulting from a transitive allowlist rule is used to allow the
@@ -123,8 +256,13 @@
 // To prevent writing to the database too often, we space out consecutive writes by 3600 seconds.
 - (SNTCachedDecision*)resetTimestampForCachedDecision:(const struct stat&)statInfo {
   SNTCachedDecision* cd = [self cachedDecisionForFile:statInfo];
+  [self resetTimestampForDecision:cd];
+  return cd;
+}
+
+- (void)resetTimestampForDecision:(SNTCachedDecision*)cd {
   if (!cd || cd.decision != SNTEventStateAllowTransitive || !cd.sha256) {
-    return cd;
+    return;
   }
 
   NSDate* lastUpdate = [self.timestampResetMap objectForKey:cd.sha256];
@@ -135,8 +273,6 @@
     [[SNTDatabaseController ruleTable] resetTimestampForExecutionRule:rule];
     [self.timestampResetMap setObject:[NSDate date] forKey:cd.sha256];
   }
-
-  return cd;
 }
 
 - (nullable SNTCachedDecision*)buildDecisionForFileInfo:(SNTFileInfo*)fi {
@@ -152,6 +288,11 @@
   cd.holdAndAsk = NO;
   cd.sha256 = fi.SHA256;
 
+  struct stat sb;
+  if ([fi statOpenFile:&sb]) {
+    [cd recordFileVersion:&sb];
+  }
+
   NSError* err;
   MOLCodesignChecker* csc = [fi codesignCheckerWithError:&err];
   if (csc && !err) {
@@ -188,6 +329,9 @@
     cd.codesigningFlags = csc.signatureFlags;
     cd.secureSigningTime = csc.secureSigningTime;
     cd.signingTime = csc.signingTime;
+
+    // Later executions of the same code can skip validating the signature.
+    [[SNTSigningInfoCache sharedCache] addCodesignChecker:csc];
   }
 
   return cd;
@@ -229,6 +373,78 @@
   });
 }
 
+- (void)prehashFileAsync:(std::string_view)path stat:(const struct stat&)statInfo {
+  if (!S_ISREG(statInfo.st_mode) || !(statInfo.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)) ||
+      statInfo.st_size == 0 || statInfo.st_size > kMaxPrehashBytes || path.empty()) {
+    return;
+  }
+
+  SantaVnode v = SantaVnode::VnodeForFile(statInfo);
+  uint64_t now = GetCurrentUptime();
+
+  os_unfair_lock_lock(&_pendingLock);
+  if (now - _prehashWindowStart >= NSEC_PER_SEC) {
+    _prehashWindowStart = now;
+    _prehashWindowCount = 0;
+  }
+  bool accepted = _prehashWindowCount < kMaxPrehashesPerSecond &&
+                  _pendingPrehashes.size() < kMaxPendingPrehashes &&
+                  _pendingPrehashes.insert(v).second;
+  if (accepted) {
+    _prehashWindowCount++;
+  }
+  os_unfair_lock_unlock(&_pendingLock);
+  if (!accepted) return;
+
+  NSString* pathStr = [[NSString alloc] initWithBytes:path.data()
+                                               length:path.length()
+                                             encoding:NSUTF8StringEncoding];
+  struct stat expected = statInfo;
+  dispatch_async(self.cachePopulateQ, ^{
+    [self prehashFileSerialized:pathStr expectedStat:expected];
+
+    os_unfair_lock_lock(&self->_pendingLock);
+    self->_pendingPrehashes.erase(v);
+    os_unfair_lock_unlock(&self->_pendingLock);
+  });
+}
+
+- (void)prehashFileSerialized:(NSString*)path expectedStat:(const struct stat&)expected {
+  if (!path) return;
+
+  SNTFileInfo* fi = [[SNTFileInfo alloc] initWithResolvedPath:path error:NULL];
+  if (!fi || !fi.isMachO) return;
+
+  // Only keep the hash if the open file is the one the event was about and it
+  // wasn't modified while being hashed. A later close event will trigger a
+  // new attempt if it was.
+  int fd = fi.fileHandle.fileDescriptor;
+  struct stat before, after;
+  if (fstat(fd, &before) != 0 || !santa::SameFileVersion(before, expected)) return;
+
+  NSString* sha256 = fi.SHA256;
+  if (!sha256 || fstat(fd, &after) != 0 || !santa::SameFileVersion(before, after)) return;
+
+  _prehashCache->set(fi.vnode, PrehashedFile{.sha256 = sha256, .sb = before});
+}
+
+- (NSString*)takePrehashedSHA256ForFile:(const struct stat&)statInfo {
+  SantaVnode v = SantaVnode::VnodeForFile(statInfo);
+  PrehashedFile entry = _prehashCache->get(v);
+  if (!entry.sha256) return nil;
+
+  _prehashCache->remove(v);
+  return santa::SameFileVersion(entry.sb, statInfo) ? entry.sha256 : nil;
+}
+
+- (NSString*)knownSHA256ForFile:(const struct stat&)statInfo {
+  NSString* sha256 = [self cachedDecisionForFileVersion:statInfo].sha256;
+  if (sha256) return sha256;
+
+  PrehashedFile entry = _prehashCache->get(SantaVnode::VnodeForFile(statInfo));
+  return entry.sha256 && santa::SameFileVersion(entry.sb, statInfo) ? entry.sha256 : nil;
+}
+
 #ifdef DEBUG
 - (void)waitForCachePopulateQueueForTesting {
   dispatch_sync(self.cachePopulateQ, ^{
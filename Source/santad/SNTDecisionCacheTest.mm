@@ -85,6 +85,121 @@ SNTCachedDecision* MakeCachedDecision(struct stat sb, SNTEventState decision) {
   XCTAssertNil([dc cachedDecisionForFile:sb]);
 }
 
+- (void)testForgetCachedDecisionsForDevice {
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+
+  struct stat sb = MakeStat(1000);
+  struct stat sameDevice = sb;
+  sameDevice.st_ino++;
+  struct stat otherDevice = sb;
+  otherDevice.st_dev++;
+
+  for (const struct stat& s : {sb, sameDevice, otherDevice}) {
+    [dc cacheDecision:MakeCachedDecision(s, SNTEventStateAllowBinary)];
+  }
+
+  [dc forgetCachedDecisionsForDevice:sb.st_dev];
+
+  XCTAssertNil([dc cachedDecisionForFile:sb]);
+  XCTAssertNil([dc cachedDecisionForFile:sameDevice]);
+  XCTAssertNotNil([dc cachedDecisionForFile:otherDevice]);
+
+  [dc forgetCachedDecisionForVnode:SantaVnode::VnodeForFile(otherDevice)];
+}
+
+- (void)testAffectedVnodesPredicateForRules {
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+
+  struct stat signedFile = MakeStat(2000);
+  struct stat otherSignedFile = MakeStat(2001);
+  struct stat unhashedFile = MakeStat(2002);
+  struct stat uncachedFile = MakeStat(2003);
+
+  SNTCachedDecision* cd = MakeCachedDecision(signedFile, SNTEventStateAllowBinary);
+  cd.cdhash = @"dbe8c39801f93e05fc7bc53a02af5b4d3cfc670a";
+  cd.teamID = @"EQHXZ8M8AV";
+  cd.signingID = @"EQHXZ8M8AV:com.google.Chrome";
+  cd.certSHA256 = @"345a8e098bd04794aaeefda8c9ef56a0bf3d3706d67d35bc0e23f11bb3bffce5";
+  [dc cacheDecision:cd];
+
+  SNTCachedDecision* otherCd = MakeCachedDecision(otherSignedFile, SNTEventStateAllowBinary);
+  otherCd.sha256 = @"2334f2d3a0f0e4bd7a4e2b4e18ae5d4c4a1e0bbc5d9a3c4d1f3e1e1a2b3c4d5e";
+  otherCd.teamID = @"ZMCG7MLDV9";
+  [dc cacheDecision:otherCd];
+
+  // The SHA-256 of this decision was never computed
+  SNTCachedDecision* unhashedCd = MakeCachedDecision(unhashedFile, SNTEventStateAllowBinary);
+  unhashedCd.sha256 = nil;
+  unhashedCd.teamID = @"ZMCG7MLDV9";
+  [dc cacheDecision:unhashedCd];
+
+  auto predicate = [dc affectedVnodesPredicateForRules:@[
+    [[SNTRule alloc] initWithIdentifier:@"EQHXZ8M8AV"
+                                  state:SNTRuleStateBlock
+                                   type:SNTRuleTypeTeamID],
+  ]];
+  XCTAssertTrue(predicate(SantaVnode::VnodeForFile(signedFile)));
+  XCTAssertFalse(predicate(SantaVnode::VnodeForFile(otherSignedFile)));
+  XCTAssertFalse(predicate(SantaVnode::VnodeForFile(unhashedFile)));
+  // Nothing is known about files without a cached decision
+  XCTAssertTrue(predicate(SantaVnode::VnodeForFile(uncachedFile)));
+
+  predicate = [dc affectedVnodesPredicateForRules:@[
+    [[SNTRule alloc] initWithIdentifier:otherCd.sha256
+                                  state:SNTRuleStateBlock
+                                   type:SNTRuleTypeBinary],
+  ]];
+  XCTAssertFalse(predicate(SantaVnode::VnodeForFile(signedFile)));
+  XCTAssertTrue(predicate(SantaVnode::VnodeForFile(otherSignedFile)));
+  XCTAssertTrue(predicate(SantaVnode::VnodeForFile(unhashedFile)));
+
+  predicate = [dc affectedVnodesPredicateForRules:@[
+    [[SNTRule alloc] initWithIdentifier:cd.signingID
+                                  state:SNTRuleStateBlock
+                                   type:SNTRuleTypeSigningID],
+    [[SNTRule alloc] initWithIdentifier:cd.cdhash state:SNTRuleStateBlock type:SNTRuleTypeCDHash],
+  ]];
+  XCTAssertTrue(predicate(SantaVnode::VnodeForFile(signedFile)));
+  XCTAssertFalse(predicate(SantaVnode::VnodeForFile(otherSignedFile)));
+
+  predicate = [dc affectedVnodesPredicateForRules:@[
+    [[SNTRule alloc] initWithIdentifier:cd.certSHA256
+                                  state:SNTRuleStateBlock
+                                   type:SNTRuleTypeCertificate],
+  ]];
+  XCTAssertTrue(predicate(SantaVnode::VnodeForFile(signedFile)));
+  XCTAssertFalse(predicate(SantaVnode::VnodeForFile(otherSignedFile)));
+
+  for (const struct stat& s : {signedFile, otherSignedFile, unhashedFile}) {
+    [dc forgetCachedDecisionForVnode:SantaVnode::VnodeForFile(s)];
+  }
+}
+
+- (void)testExecContext {
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+  struct stat sb = MakeStat(300);
+  SNTCachedDecision* fileCD = MakeCachedDecision(sb, SNTEventStateAllowBinary);
+  SNTCachedDecision* execCD = MakeCachedDecision(sb, SNTEventStateAllowSigningID);
+  audit_token_t tok = MakeAuditToken(12, 34);
+  audit_token_t otherTok = MakeAuditToken(12, 35);
+
+  [dc cacheDecision:fileCD];
+  [dc recordDecision:execCD forExecOfProcess:tok];
+
+  // The recorded decision is preferred and is kept until taken
+  XCTAssertEqual([dc decisionForExecOfProcess:tok file:sb], execCD);
+  XCTAssertEqual([dc decisionForExecOfProcess:tok file:sb], execCD);
+
+  // A different exec of the same pid falls back to the file's decision
+  XCTAssertEqual([dc decisionForExecOfProcess:otherTok file:sb], fileCD);
+
+  XCTAssertEqual([dc takeDecisionForExecOfProcess:tok file:sb], execCD);
+  XCTAssertEqual([dc takeDecisionForExecOfProcess:tok file:sb], fileCD);
+
+  [dc forgetCachedDecisionForVnode:fileCD.vnodeId];
+  XCTAssertNil([dc takeDecisionForExecOfProcess:tok file:sb]);
+}
+
 - (void)testResetTimestampForCachedDecision {
   SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
   struct stat sb = MakeStat();
@@ -272,4 +387,109 @@ SNTCachedDecision* MakeCachedDecision(struct stat sb, SNTEventState decision) {
   [dc resetEntitlementsFilterForTesting];
 }
 
+- (NSString*)copyExecutableToTemporaryPath:(NSString*)prefix {
+  NSString* tmpPath = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"%@-%@", prefix,
+                                                                [[NSUUID UUID] UUIDString]]];
+  XCTAssertTrue([[NSFileManager defaultManager] copyItemAtPath:@"/usr/bin/true"
+                                                        toPath:tmpPath
+                                                         error:nil]);
+  chmod(tmpPath.fileSystemRepresentation, 0755);
+  return tmpPath;
+}
+
+- (void)testPrehashFile {
+  NSString* tmpPath = [self copyExecutableToTemporaryPath:@"prehash"];
+  struct stat sb;
+  XCTAssertEqual(stat(tmpPath.fileSystemRepresentation, &sb), 0);
+
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+  [dc prehashFileAsync:tmpPath.fileSystemRepresentation stat:sb];
+  [dc waitForCachePopulateQueueForTesting];
+
+  SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:tmpPath];
+  XCTAssertEqualObjects([dc takePrehashedSHA256ForFile:sb], fi.SHA256);
+
+  // Entries are consumed by the first lookup.
+  XCTAssertNil([dc takePrehashedSHA256ForFile:sb]);
+
+  [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+}
+
+- (void)testKnownSHA256ForFile {
+  NSString* tmpPath = [self copyExecutableToTemporaryPath:@"known-sha256"];
+  struct stat sb;
+  XCTAssertEqual(stat(tmpPath.fileSystemRepresentation, &sb), 0);
+
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+  XCTAssertNil([dc knownSHA256ForFile:sb]);
+
+  // Prehashed entries are left for the exec that consumes them.
+  [dc prehashFileAsync:tmpPath.fileSystemRepresentation stat:sb];
+  [dc waitForCachePopulateQueueForTesting];
+  SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:tmpPath];
+  XCTAssertEqualObjects([dc knownSHA256ForFile:sb], fi.SHA256);
+  XCTAssertEqualObjects([dc knownSHA256ForFile:sb], fi.SHA256);
+  XCTAssertEqualObjects([dc takePrehashedSHA256ForFile:sb], fi.SHA256);
+  XCTAssertNil([dc knownSHA256ForFile:sb]);
+
+  // Cached decisions are only used for the version of the file they were made for.
+  SNTCachedDecision* cd = MakeCachedDecision(sb, SNTEventStateAllowBinary);
+  [cd recordFileVersion:&sb];
+  [dc cacheDecision:cd];
+  XCTAssertEqualObjects([dc knownSHA256ForFile:sb], cd.sha256);
+
+  struct stat changed = sb;
+  changed.st_ctimespec.tv_sec += 1;
+  XCTAssertNil([dc knownSHA256ForFile:changed]);
+
+  [dc forgetCachedDecisionForVnode:SantaVnode::VnodeForFile(sb)];
+  [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+}
+
+- (void)testPrehashedHashIsDiscardedWhenFileChanges {
+  NSString* tmpPath = [self copyExecutableToTemporaryPath:@"prehash-changed"];
+  struct stat sb;
+  XCTAssertEqual(stat(tmpPath.fileSystemRepresentation, &sb), 0);
+
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+  [dc prehashFileAsync:tmpPath.fileSystemRepresentation stat:sb];
+  [dc waitForCachePopulateQueueForTesting];
+
+  // Any change to the file updates its ctime.
+  struct stat changed = sb;
+  changed.st_ctimespec.tv_sec += 1;
+  XCTAssertNil([dc takePrehashedSHA256ForFile:changed]);
+  XCTAssertNil([dc takePrehashedSHA256ForFile:sb]);
+
+  // A file that changed between the event and the hashing is not hashed.
+  struct stat stale = sb;
+  stale.st_mtimespec.tv_sec -= 1;
+  [dc prehashFileAsync:tmpPath.fileSystemRepresentation stat:stale];
+  [dc waitForCachePopulateQueueForTesting];
+  XCTAssertNil([dc takePrehashedSHA256ForFile:sb]);
+  XCTAssertNil([dc takePrehashedSHA256ForFile:stale]);
+
+  [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+}
+
+- (void)testPrehashSkipsNonMachOFiles {
+  NSString* tmpPath = [NSTemporaryDirectory()
+      stringByAppendingPathComponent:[NSString stringWithFormat:@"prehash-script-%@",
+                                                                [[NSUUID UUID] UUIDString]]];
+  XCTAssertTrue([[@"#!/bin/sh\nexit 0\n" dataUsingEncoding:NSUTF8StringEncoding]
+      writeToFile:tmpPath
+       atomically:YES]);
+  chmod(tmpPath.fileSystemRepresentation, 0755);
+  struct stat sb;
+  XCTAssertEqual(stat(tmpPath.fileSystemRepresentation, &sb), 0);
+
+  SNTDecisionCache* dc = [SNTDecisionCache sharedCache];
+  [dc prehashFileAsync:tmpPath.fileSystemRepresentation stat:sb];
+  [dc waitForCachePopulateQueueForTesting];
+  XCTAssertNil([dc takePrehashedSHA256ForFile:sb]);
+
+  [[NSFileManager defaultManager] removeItemAtPath:tmpPath error:nil];
+}
+
 @end
@@ -137,4 +137,10 @@ using LogExecutionBlock = void (^)(santa::Message esMsg);
 ///
 - (void)flushTouchIDApprovalCache;
 
+///
+///  Synchronously writes any buffered events to the event table and sends any
+///  uploads waiting on them. Should be called before santad exits.
+///
+- (void)flushPendingEvents;
+
 @end
@@ -24,6 +24,7 @@
 
 #include <cstring>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <utility>
@@ -31,6 +32,8 @@
 #include "Source/common/AccountLookup.h"
 #include "Source/common/BranchPrediction.h"
 #include "Source/common/CodeSigningIdentifierUtils.h"
+#include "Source/common/Digest.h"
+#include "Source/common/ExecTrace.h"
 #import "Source/common/MOLCodesignChecker.h"
 #include "Source/common/PrefixTree.h"
 #import "Source/common/SNTBlockMessage.h"
@@ -42,6 +45,7 @@
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTMetricSet.h"
 #import "Source/common/SNTRule.h"
+#import "Source/common/SNTSigningInfoCache.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #include "Source/common/SantaCache.h"
 #include "Source/common/SantaVnode.h"
@@ -54,9 +58,11 @@
 #include "Source/santad/CELActivation.h"
 #import "Source/santad/DataLayer/SNTEventTable.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
+#include "Source/santad/KernelSigningInfo.h"
 #import "Source/santad/SNTDecisionCache.h"
 #import "Source/santad/SNTNotificationQueue.h"
 #import "Source/santad/SNTSyncdQueue.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 
 using santa::Message;
@@ -67,6 +73,12 @@ using santa::Unit;
 
 static const size_t kMaxAllowedPathLength = MAXPATHLEN - 1;  // -1 to account for null terminator
 
+// Events stored within this window are written to the event table in a single
+// transaction, which also bounds how long an event can be lost for if santad
+// stops unexpectedly. A full batch is written straight away.
+static const uint64_t kPendingEventsMaxDelayMs = 250;
+static const NSUInteger kMaxPendingEvents = 64;
+
 @interface SNTExecutionController ()
 @property SNTEventTable* eventTable;
 @property SNTNotificationQueue* notifierQueue;
@@ -74,6 +86,8 @@ static const size_t kMaxAllowedPathLength = MAXPATHLEN - 1;  // -1 to account fo
 @property(readwrite) SNTRuleTable* ruleTable;
 @property SNTSyncdQueue* syncdQueue;
 @property SNTMetricCounter* events;
+@property SNTMetricCounter* eventCommits;
+@property SNTMetricCounter* eventCommitTime;
 @property santa::ProcessControlBlock processControlBlock;
 
 @property dispatch_queue_t eventQueue;
@@ -121,14 +135,18 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   std::shared_ptr<TTYWriter> _ttyWriter;
   std::unique_ptr<SantaCache<std::pair<pid_t, int>, bool>> _procSignalCache;
 
-  // Cache of TouchID approvals: SHA-256 (as std::string) -> timestamp (nanoseconds since boot)
-  // Note: We use std::string instead of NSString* because SantaCache uses == for key comparison,
-  // which would compare pointer addresses for NSString*, not string contents.
-  std::unique_ptr<SantaCache<std::string, uint64_t>> _touchIDApprovalCache;
+  // Cache of TouchID approvals: SHA-256 -> timestamp (nanoseconds since boot)
+  // Note: We key on the binary digest instead of NSString* because SantaCache uses == for key
+  // comparison, which would compare pointer addresses for NSString*, not string contents.
+  std::unique_ptr<SantaCache<santa::SHA256Digest, uint64_t>> _touchIDApprovalCache;
 
   std::shared_ptr<santa::santad::process_tree::ProcessTree> _processTree;
   std::shared_ptr<santa::SandboxExpectations> _sandboxExpectations;
 
+  // Bound counters for each field value of the events counter.
+  absl::flat_hash_map<SNTEventState, std::shared_ptr<santa::ShardedCounter>> _eventCounters;
+  std::shared_ptr<santa::ShardedCounter> _unknownEventCounter;
+
   // Set of (pid, pidversion) of processes Santa authorized as sandboxed seatbelt
   // processes. Because the OS sandbox is irreversible, membership implies the
   // process is still sandboxed; it is used to relax the seatbelt requirement
@@ -136,6 +154,13 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   // stale entries from exited processes are harmless because (pid, pidversion)
   // is globally unique and never recurs.
   std::unique_ptr<SantaCache<std::pair<pid_t, int>, bool>> _sandboxedSeatbeltProcs;
+
+  // Events waiting to be written to the event table in a single transaction,
+  // and blocked events waiting to be uploaded once they've been written. Only
+  // accessed on _eventQueue.
+  NSMutableArray<SNTStoredEvent*>* _pendingEvents;
+  NSMutableArray<SNTStoredEvent*>* _pendingUploads;
+  BOOL _pendingFlushScheduled;
 }
 
 #pragma mark Initializers
@@ -161,7 +186,7 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
     _ttyWriter = std::move(ttyWriter);
     _policyProcessor = policyProcessor;
     _procSignalCache = std::make_unique<SantaCache<std::pair<pid_t, int>, bool>>(100000);
-    _touchIDApprovalCache = std::make_unique<SantaCache<std::string, uint64_t>>(100);
+    _touchIDApprovalCache = std::make_unique<SantaCache<santa::SHA256Digest, uint64_t>>(100);
     _sandboxedSeatbeltProcs = std::make_unique<SantaCache<std::pair<pid_t, int>, bool>>(100000);
     _processControlBlock = processControlBlock;
     _processTree = std::move(processTree);
@@ -169,6 +194,8 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
 
     _eventQueue =
         dispatch_queue_create("com.northpolesec.santa.daemon.event_upload", DISPATCH_QUEUE_SERIAL);
+    _pendingEvents = [NSMutableArray array];
+    _pendingUploads = [NSMutableArray array];
 
     // This establishes the XPC connection between libsecurity and syspolicyd.
     // Not doing this causes a deadlock as establishing this link goes through xpcproxy.
@@ -178,41 +205,57 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
     _events = [metricSet counterWithName:@"/santa/events"
                               fieldNames:@[ @"action_response" ]
                                 helpText:@"Events processed by Santa per response"];
+    // Event states counted under their own field value. Everything else is
+    // counted as kUnknownEventState.
+    const std::pair<SNTEventState, const NSString*> eventStates[] = {
+        {SNTEventStateBlockBinary, kBlockBinary},
+        {SNTEventStateAllowBinary, kAllowBinary},
+        {SNTEventStateAllowLocalBinary, kAllowLocalBinary},
+        {SNTEventStateBlockCertificate, kBlockCertificate},
+        {SNTEventStateAllowCertificate, kAllowCertificate},
+        {SNTEventStateBlockTeamID, kBlockTeamID},
+        {SNTEventStateAllowTeamID, kAllowTeamID},
+        {SNTEventStateBlockSigningID, kBlockSigningID},
+        {SNTEventStateAllowSigningID, kAllowSigningID},
+        {SNTEventStateBlockCDHash, kBlockCDHash},
+        {SNTEventStateAllowCDHash, kAllowCDHash},
+        {SNTEventStateBlockScope, kBlockScope},
+        {SNTEventStateAllowScope, kAllowScope},
+        {SNTEventStateBlockUnknown, kBlockUnknown},
+        {SNTEventStateAllowUnknown, kAllowUnknown},
+        {SNTEventStateAllowCompilerBinary, kAllowCompilerBinary},
+        {SNTEventStateAllowCompilerCDHash, kAllowCompilerCDHash},
+        {SNTEventStateAllowCompilerSigningID, kAllowCompilerSigningID},
+        {SNTEventStateAllowTransitive, kAllowTransitive},
+        {SNTEventStateBlockLongPath, kBlockLongPath},
+        {SNTEventStateBlockCELFallback, kBlockCELFallback},
+        {SNTEventStateAllowCELFallback, kAllowCELFallback},
+        {SNTEventStateAllowPlatform, kAllowPlatform},
+    };
+    for (const auto& [state, name] : eventStates) {
+      _eventCounters[state] = [_events shardedCounterForFieldValues:@[ (NSString*)name ]];
+    }
+    _unknownEventCounter =
+        [_events shardedCounterForFieldValues:@[ (NSString*)kUnknownEventState ]];
+
+    // Pending events are committed to the event database in groups, so with WriteDurability set,
+    // each full sync is shared by every event in the group.
+    _eventCommits = [metricSet counterWithName:@"/santa/event_db/commit_count"
+                                    fieldNames:@[ @"result" ]
+                                      helpText:@"Commits of pending events to the event database"];
+    _eventCommitTime =
+        [metricSet counterWithName:@"/santa/event_db/commit_time_usec"
+                        fieldNames:@[]
+                          helpText:@"Time spent committing pending events to the event database"];
   }
   return self;
 }
 
 - (void)incrementEventCounters:(SNTEventState)eventType {
-  const NSString* eventTypeStr;
-
-  switch (eventType) {
-    case SNTEventStateBlockBinary: eventTypeStr = kBlockBinary; break;
-    case SNTEventStateAllowBinary: eventTypeStr = kAllowBinary; break;
-    case SNTEventStateAllowLocalBinary: eventTypeStr = kAllowLocalBinary; break;
-    case SNTEventStateBlockCertificate: eventTypeStr = kBlockCertificate; break;
-    case SNTEventStateAllowCertificate: eventTypeStr = kAllowCertificate; break;
-    case SNTEventStateBlockTeamID: eventTypeStr = kBlockTeamID; break;
-    case SNTEventStateAllowTeamID: eventTypeStr = kAllowTeamID; break;
-    case SNTEventStateBlockSigningID: eventTypeStr = kBlockSigningID; break;
-    case SNTEventStateAllowSigningID: eventTypeStr = kAllowSigningID; break;
-    case SNTEventStateBlockCDHash: eventTypeStr = kBlockCDHash; break;
-    case SNTEventStateAllowCDHash: eventTypeStr = kAllowCDHash; break;
-    case SNTEventStateBlockScope: eventTypeStr = kBlockScope; break;
-    case SNTEventStateAllowScope: eventTypeStr = kAllowScope; break;
-    case SNTEventStateBlockUnknown: eventTypeStr = kBlockUnknown; break;
-    case SNTEventStateAllowUnknown: eventTypeStr = kAllowUnknown; break;
-    case SNTEventStateAllowCompilerBinary: eventTypeStr = kAllowCompilerBinary; break;
-    case SNTEventStateAllowCompilerCDHash: eventTypeStr = kAllowCompilerCDHash; break;
-    case SNTEventStateAllowCompilerSigningID: eventTypeStr = kAllowCompilerSigningID; break;
-    case SNTEventStateAllowTransitive: eventTypeStr = kAllowTransitive; break;
-    case SNTEventStateBlockLongPath: eventTypeStr = kBlockLongPath; break;
-    case SNTEventStateBlockCELFallback: eventTypeStr = kBlockCELFallback; break;
-    case SNTEventStateAllowCELFallback: eventTypeStr = kAllowCELFallback; break;
-    case SNTEventStateAllowPlatform: eventTypeStr = kAllowPlatform; break;
-    default: eventTypeStr = kUnknownEventState; break;
-  }
-
-  [_events incrementForFieldValues:@[ (NSString*)eventTypeStr ]];
+  // Counters are bound per event state so that incrementing doesn't look up
+  // field values in the metric set on every exec.
+  auto it = _eventCounters.find(eventType);
+  (it != _eventCounters.end() ? it->second : _unknownEventCounter)->Increment();
 }
 
 #pragma mark Binary Validation
@@ -312,6 +355,72 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
       std::make_pair(audit_token_to_pid(token), audit_token_to_pidversion(token)));
 }
 
+// Makes the decision for an exec whose binary has been opened as binInfo.
+- (SNTCachedDecision*)decisionForExec:(const Message&)esMsg
+                             fileInfo:(SNTFileInfo*)binInfo
+                          configState:(SNTConfigState*)configState
+                       cachedDecision:(SNTCachedDecision*)existingDecision {
+  const es_process_t* targetProc = esMsg->event.exec.target;
+
+  // TODO(markowsky): Maybe add a metric here for how many large executables we're seeing.
+  // if (binInfo.fileSize > SomeUpperLimit) ...
+
+  SNTSigningInfo* signingInfo;
+  if (!existingDecision) {
+    // Freshly written binaries may already have been hashed in the background.
+    NSString* prehashedSHA256 =
+        [[SNTDecisionCache sharedCache] takePrehashedSHA256ForFile:targetProc->executable->stat];
+    if (prehashedSHA256) {
+      [binInfo setPrecomputedSHA256:prehashedSHA256];
+    }
+
+    // Where the kernel strictly enforces the cdhash, take the signing info
+    // from the signature it already validated rather than validating the file
+    // again with Security.framework. The policy processor finds it in the
+    // signing info cache by cdhash.
+    if (santa::CdhashStrictlyEnforced(targetProc->codesigning_flags)) {
+      SNTSigningInfoCache* signingInfoCache = [SNTSigningInfoCache sharedCache];
+      signingInfo = [signingInfoCache
+          signingInfoForCDHash:santa::StringToNSString(
+                                   santa::BufToHexString(targetProc->cdhash, CS_CDHASH_LEN))];
+      if (!signingInfo) {
+        signingInfo = santa::KernelSigningInfoForExec(
+            esMsg, binInfo, [self.policyProcessor canDeferSHA256ForCDHashEnforcedBinaries]);
+        if (signingInfo) {
+          [signingInfoCache addSigningInfo:signingInfo];
+        }
+      }
+    }
+  }
+
+  // When re-evaluating with a cached decision, use the pre-computed signing
+  // metadata to avoid expensive codesign verification.
+  ActivationCallbackBlock activationBlock;
+  if (existingDecision) {
+    activationBlock = santa::CreateCELActivationBlock(
+        esMsg, existingDecision.rawSigningID, existingDecision.teamID,
+        existingDecision.platformBinary, existingDecision.signingTime,
+        existingDecision.secureSigningTime, existingDecision.rawEntitlements, _processTree);
+  } else if (signingInfo) {
+    activationBlock = santa::CreateCELActivationBlock(
+        esMsg, signingInfo.signingID, signingInfo.teamID, signingInfo.platformBinary,
+        signingInfo.signingTime, signingInfo.secureSigningTime, signingInfo.entitlements,
+        _processTree);
+  } else {
+    // Validating the code signature and hashing the file both read all of
+    // it, so hash in the background while the signature is validated.
+    [binInfo beginComputingSHA256];
+    activationBlock = santa::CreateCELActivationBlock(
+        esMsg, [binInfo codesignCheckerWithError:NULL], _processTree);
+  }
+
+  return [self.policyProcessor decisionForFileInfo:binInfo
+                                     targetProcess:targetProc
+                                       configState:configState
+                                activationCallback:activationBlock
+                                    cachedDecision:existingDecision];
+}
+
 - (void)validateExecEvent:(const Message&)esMsg
            cachedDecision:(SNTCachedDecision*)existingDecision
                postAction:(bool (^)(SNTAction, SNTCachedDecision*))postAction {
@@ -328,47 +437,47 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
 
   const es_process_t* targetProc = esMsg->event.exec.target;
 
-  // Get info about the file. If we can't get this info, respond appropriately and log an error.
-  NSError* fileInfoError;
-  SNTFileInfo* binInfo = [[SNTFileInfo alloc] initWithEndpointSecurityFile:targetProc->executable
-                                                                     error:&fileInfoError];
-  if (unlikely(!binInfo)) {
-    if (config.failClosed) {
-      LOGE(@"Failed to read file %@: %@ and denying action", @(targetProc->executable->path.data),
-           fileInfoError.localizedDescription);
-      postAction(SNTActionRespondDeny, nil);
-      [self.events incrementForFieldValues:@[ (NSString*)kDenyNoFileInfo ]];
-    } else {
-      LOGE(@"Failed to read file %@: %@ but allowing action", @(targetProc->executable->path.data),
-           fileInfoError.localizedDescription);
-      postAction(SNTActionRespondAllow, nil);
-      [self.events incrementForFieldValues:@[ (NSString*)kAllowNoFileInfo ]];
+  // Critical system binaries can be recognized by their CDHash alone, so
+  // there's no need to open the file.
+  SNTCachedDecision* cd =
+      existingDecision
+          ? nil
+          : [self.policyProcessor criticalSystemBinaryDecisionForProcess:targetProc
+                                                             configState:configState];
+
+  SNTFileInfo* binInfo;
+  if (!cd) {
+    // Get info about the file. If we can't get this info, respond appropriately and log an error.
+    NSError* fileInfoError;
+    {
+      santa::ExecTrace::Span span(santa::ExecTraceStage::kFileInfo);
+      binInfo = [[SNTFileInfo alloc] initWithEndpointSecurityFile:targetProc->executable
+                                                            error:&fileInfoError];
+    }
+    if (unlikely(!binInfo)) {
+      if (config.failClosed) {
+        LOGE(@"Failed to read file %@: %@ and denying action",
+             @(targetProc->executable->path.data), fileInfoError.localizedDescription);
+        postAction(SNTActionRespondDeny, nil);
+        [self.events incrementForFieldValues:@[ (NSString*)kDenyNoFileInfo ]];
+      } else {
+        LOGE(@"Failed to read file %@: %@ but allowing action",
+             @(targetProc->executable->path.data), fileInfoError.localizedDescription);
+        postAction(SNTActionRespondAllow, nil);
+        [self.events incrementForFieldValues:@[ (NSString*)kAllowNoFileInfo ]];
+      }
+      return;
     }
-    return;
-  }
-
-  // TODO(markowsky): Maybe add a metric here for how many large executables we're seeing.
-  // if (binInfo.fileSize > SomeUpperLimit) ...
 
-  // When re-evaluating with a cached decision, use the pre-computed signing
-  // metadata to avoid expensive codesign verification.
-  ActivationCallbackBlock activationBlock =
-      existingDecision
-          ? santa::CreateCELActivationBlock(
-                esMsg, existingDecision.rawSigningID, existingDecision.teamID,
-                existingDecision.platformBinary, existingDecision.signingTime,
-                existingDecision.secureSigningTime, existingDecision.rawEntitlements, _processTree)
-          : santa::CreateCELActivationBlock(esMsg, [binInfo codesignCheckerWithError:NULL],
-                                            _processTree);
-
-  SNTCachedDecision* cd = [self.policyProcessor decisionForFileInfo:binInfo
-                                                      targetProcess:targetProc
-                                                        configState:configState
-                                                 activationCallback:activationBlock
-                                                     cachedDecision:existingDecision];
+    cd = [self decisionForExec:esMsg
+                      fileInfo:binInfo
+                   configState:configState
+                cachedDecision:existingDecision];
+  }
 
   cd.codesigningFlags = targetProc->codesigning_flags;
   cd.vnodeId = SantaVnode::VnodeForFile(targetProc->executable);
+  [cd recordFileVersion:&targetProc->executable->stat];
 
   // Seatbelt expectation check: the sandboxed exec is authorized iff
   // santactl pre-registered an expectation for the caller's audit token,
@@ -411,9 +520,9 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
         authorized = memcmp(maybeExp->cdhash.data(), targetProc->cdhash, CS_CDHASH_LEN) == 0;
       } else {
         authorized = maybeExp->dev == targetProc->executable->stat.st_dev &&
-                     maybeExp->ino == targetProc->executable->stat.st_ino && cd.sha256.length > 0 &&
-                     !maybeExp->sha256.empty() &&
-                     santa::NSStringToUTF8String(cd.sha256) == maybeExp->sha256;
+                     maybeExp->ino == targetProc->executable->stat.st_ino &&
+                     maybeExp->sha256.has_value() &&
+                     santa::SHA256Digest::FromHex(cd.sha256) == *maybeExp->sha256;
       }
 
       if (!authorized) {
@@ -451,6 +560,7 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   // the shasum stored in the decision details to update the rule's timestamp whenever an
   // ACTION_NOTIFY_EXEC message related to the transitive rule is received.
   [[SNTDecisionCache sharedCache] cacheDecision:cd];
+  [[SNTDecisionCache sharedCache] recordDecision:cd forExecOfProcess:targetProc->audit_token];
 
   // Upgrade the action to SNTActionRespondAllowCompiler when appropriate, because we want the
   // kernel to track this information in its decision cache.
@@ -466,10 +576,15 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
       std::make_pair(newProcPid, audit_token_to_pidversion(targetProc->audit_token));
 
   // Check TouchID approval cache before prompting - only if cooldown was specified
-  if (cd.holdAndAsk && cd.sha256 && cd.touchIDCooldownMinutes != nil) {
+  // TouchID approvals are cached by the binary SHA-256 of the file.
+  std::optional<santa::SHA256Digest> sha256Key;
+  if (cd.holdAndAsk) {
+    sha256Key = santa::SHA256Digest::FromHex(cd.sha256);
+  }
+  if (cd.holdAndAsk && sha256Key && cd.touchIDCooldownMinutes != nil) {
     uint64_t cooldownMinutes = [cd.touchIDCooldownMinutes unsignedLongLongValue];
     if (cooldownMinutes > 0) {
-      uint64_t cachedTimestamp = _touchIDApprovalCache->get(santa::NSStringToUTF8String(cd.sha256));
+      uint64_t cachedTimestamp = _touchIDApprovalCache->get(*sha256Key);
       if (cachedTimestamp > 0) {
         uint64_t expiryTime = cachedTimestamp + (cooldownMinutes * 60 * NSEC_PER_SEC);
         if (GetCurrentUptime() < expiryTime) {
@@ -508,6 +623,13 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   if (config.enableAllEventUpload ||
       (cd.decision == SNTEventStateAllowUnknown && !config.disableUnknownEventUpload) ||
       cd.auditReturn || (cd.decision & SNTEventStateAllow) == 0) {
+    if (!binInfo) {
+      // Critical system binaries are decided without opening the file. The
+      // event still reports its path and bundle details.
+      binInfo = [[SNTFileInfo alloc] initWithEndpointSecurityFile:targetProc->executable
+                                                            error:NULL];
+    }
+
     SNTStoredExecutionEvent* se = [[SNTStoredExecutionEvent alloc] init];
     se.occurrenceDate = [[NSDate alloc] init];
     se.fileSHA256 = cd.sha256;
@@ -563,7 +685,7 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
     // Only store events if there is a sync server configured.
     if (config.syncBaseURL) {
       dispatch_async(_eventQueue, ^{
-        [self.eventTable addStoredEvent:se];
+        [self enqueuePendingEvent:se];
       });
     }
 
@@ -578,9 +700,11 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
         se.needsBundleHash = YES;
       } else if (config.syncBaseURL) {
         // So the server has something to show the user straight away, initiate an event
-        // upload for the blocked binary rather than waiting for the next sync.
+        // upload for the blocked binary rather than waiting for the next sync. The upload
+        // is sent once the event has been written so the sync service can remove it from
+        // the event table afterwards.
         dispatch_async(_eventQueue, ^{
-          [self.syncdQueue addStoredEvent:se];
+          [self enqueuePendingUpload:se];
         });
       }
 
@@ -645,10 +769,9 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
 
             // Cache the TouchID approval so subsequent executions within the cooldown period
             // don't require re-authorization - only if cooldown was specified and > 0
-            if (cd.sha256 && cd.touchIDCooldownMinutes != nil &&
+            if (sha256Key && cd.touchIDCooldownMinutes != nil &&
                 [cd.touchIDCooldownMinutes unsignedLongLongValue] > 0) {
-              std::string sha256Key = santa::NSStringToUTF8String(cd.sha256);
-              self->_touchIDApprovalCache->set(sha256Key, GetCurrentUptime());
+              self->_touchIDApprovalCache->set(*sha256Key, GetCurrentUptime());
             }
 
             if (stoppedProc) {
@@ -685,6 +808,7 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
       // so it must always be shown even if the flags were somehow combined.
       if (!cd.silentBlockGUI || cd.holdAndAsk) {
         // Let the user know what happened in the GUI.
+        santa::ExecTrace::Span span(santa::ExecTraceStage::kNotificationQueue);
         [self.notifierQueue addEvent:se
                    withCustomMessage:cd.customMsg
                            customURL:cd.customURL ?: config.eventDetailURL
@@ -795,4 +919,62 @@ static bool SameBinary(const es_process_t* a, NSString* aSHA256, const es_proces
   _touchIDApprovalCache->clear();
 }
 
+#pragma mark Event Storage
+
+// Must be called on _eventQueue.
+- (void)enqueuePendingEvent:(SNTStoredEvent*)event {
+  [_pendingEvents addObject:event];
+  if (_pendingEvents.count >= kMaxPendingEvents) {
+    [self writePendingEvents];
+  } else {
+    [self schedulePendingFlush];
+  }
+}
+
+// Must be called on _eventQueue.
+- (void)enqueuePendingUpload:(SNTStoredEvent*)event {
+  if (_pendingEvents.count == 0) {
+    [self.syncdQueue addStoredEvent:event];
+    return;
+  }
+  [_pendingUploads addObject:event];
+  [self schedulePendingFlush];
+}
+
+// Must be called on _eventQueue.
+- (void)schedulePendingFlush {
+  if (_pendingFlushScheduled) return;
+  _pendingFlushScheduled = YES;
+
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kPendingEventsMaxDelayMs * NSEC_PER_MSEC),
+                 _eventQueue, ^{
+                   [self writePendingEvents];
+                 });
+}
+
+// Must be called on _eventQueue.
+- (void)writePendingEvents {
+  _pendingFlushScheduled = NO;
+  if (_pendingEvents.count) {
+    NSArray<SNTStoredEvent*>* events = [_pendingEvents copy];
+    [_pendingEvents removeAllObjects];
+    uint64_t start = GetCurrentUptime();
+    BOOL committed = [self.eventTable addStoredEvents:events];
+    [self.eventCommitTime incrementBy:(long long)((GetCurrentUptime() - start) / NSEC_PER_USEC)
+                       forFieldValues:@[]];
+    [self.eventCommits incrementForFieldValues:@[ committed ? @"ok" : @"error" ]];
+  }
+
+  for (SNTStoredEvent* event in _pendingUploads) {
+    [self.syncdQueue addStoredEvent:event];
+  }
+  [_pendingUploads removeAllObjects];
+}
+
+- (void)flushPendingEvents {
+  dispatch_sync(_eventQueue, ^{
+    [self writePendingEvents];
+  });
+}
+
 @end
@@ -69,6 +69,12 @@ static NSString* HexString(const uint8_t* bytes, size_t len) {
   return s;
 }
 
+// Sandbox expectations store SHA-256s in binary, so these must be well formed.
+static NSString* const kSeatbeltSHA256 =
+    @"cafebabecafebabecafebabecafebabecafebabecafebabecafebabecafebabe";
+static NSString* const kOtherSHA256 =
+    @"deadbeefdeadbeefdeadbeefdeadbeefdeadbeefdeadbeefdeadbeefdeadbeef";
+
 static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, const uint8_t* cdhash,
                                                  NSString* sha256) {
   SNTRuleIdentifiers* ids = [[SNTRuleIdentifiers alloc]
@@ -107,6 +113,8 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   self.mockDecisionCache = OCMStrictClassMock([SNTDecisionCache class]);
   OCMStub([self.mockDecisionCache sharedCache]).andReturn(self.mockDecisionCache);
   OCMStub([self.mockDecisionCache cacheDecision:OCMOCK_ANY]).andReturn(YES);
+  OCMStub([self.mockDecisionCache recordDecision:OCMOCK_ANY forExecOfProcess:{}])
+      .ignoringNonObjectArgs();
 
   [[SNTMetricSet sharedInstance] reset];
 
@@ -557,7 +565,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
   [self stubRule:rule forIdentifiers:{.certificateSHA256 = @"a"}];
 
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase addStoredEvents:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondDeny];
 
@@ -622,7 +630,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
   [self stubRule:rule forIdentifiers:{.binarySHA256 = @"a"}];
 
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase addStoredEvents:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondDeny];
 
@@ -667,7 +675,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
   [self stubRule:rule forIdentifiers:{.binarySHA256 = @"a"}];
 
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase addStoredEvents:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondDeny];
 
@@ -723,12 +731,55 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   XCTAssertEqual(cd.decisionClientMode, SNTClientModeUnknown);
 }
 
+- (void)testCriticalSystemBinaryMatchedByCDHash {
+  OCMStub([self.mockConfigurator clientMode]).andReturn(SNTClientModeLockdown);
+  // A critical system binary is decided before the file is hashed.
+  OCMReject([self.mockFileInfo SHA256]);
+
+  es_file_t file = MakeESFile("foo");
+  es_process_t proc = MakeESProcess(&file);
+  es_file_t fileExec = MakeESFile("bar", {.st_dev = 12, .st_ino = 34});
+  es_process_t procExec = MakeESProcess(&fileExec);
+  procExec.is_platform_binary = true;
+  procExec.codesigning_flags = CS_SIGNED | CS_VALID | CS_KILL | CS_HARD;
+  procExec.signing_id = MakeESStringToken(kExampleSigningID);
+  memset(procExec.cdhash, 0xab, sizeof(procExec.cdhash));
+  es_message_t esMsg = MakeESMessage(ES_EVENT_TYPE_AUTH_EXEC, &proc);
+  esMsg.event.exec.target = &procExec;
+
+  SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+  cd.decision = SNTEventStateAllowSigningID;
+  OCMStub([self.mockRuleDatabase criticalSystemBinariesByCDHash]).andReturn(@{
+    @"abababababababababababababababababababab" : cd
+  });
+
+  auto mockESApi = std::make_shared<MockEndpointSecurityAPI>();
+  mockESApi->SetExpectationsRetainReleaseMessage();
+
+  __block SNTCachedDecision* returnedCd = nil;
+  {
+    Message msg(mockESApi, &esMsg);
+    [self.sut validateExecEvent:msg
+                 cachedDecision:nil
+                     postAction:^bool(SNTAction action, SNTCachedDecision* resultCd) {
+                       XCTAssertEqual(action, SNTActionRespondAllow);
+                       returnedCd = resultCd;
+                       return true;
+                     }];
+  }
+
+  XCTBubbleMockVerifyAndClearExpectations(mockESApi.get());
+  [self checkMetricCounters:kAllowSigningID expected:@1];
+  XCTAssertEqual(returnedCd.decisionClientMode, SNTClientModeLockdown);
+  XCTAssertEqual(cd.decisionClientMode, SNTClientModeUnknown);
+}
+
 - (void)testDefaultDecision {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
   OCMStub([self.mockFileInfo SHA256]).andReturn(@"a");
 
   OCMExpect([self.mockConfigurator clientMode]).andReturn(SNTClientModeMonitor);
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase addStoredEvents:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondAllow];
 
@@ -785,19 +836,35 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 - (void)testPageZero {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
   OCMStub([self.mockFileInfo isMissingPageZero]).andReturn(YES);
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase addStoredEvents:OCMOCK_ANY]);
 
   [self validateExecEvent:SNTActionRespondDeny];
   OCMVerifyAllWithDelay(self.mockEventDatabase, 1);
   [self checkMetricCounters:kBlockUnknown expected:@1];
 }
 
+- (void)testPendingEventsWrittenInOneBatchOnFlush {
+  OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
+  OCMStub([self.mockFileInfo isMissingPageZero]).andReturn(YES);
+  OCMExpect([self.mockEventDatabase addStoredEvents:[OCMArg checkWithBlock:^BOOL(NSArray* events) {
+                                      return events.count == 2;
+                                    }]]);
+
+  [self validateExecEvent:SNTActionRespondDeny];
+  [self validateExecEvent:SNTActionRespondDeny];
+  [self.sut flushPendingEvents];
+
+  // Both events were buffered and written together without waiting for the
+  // flush window to elapse.
+  OCMVerifyAll(self.mockEventDatabase);
+}
+
 - (void)testAllEventUpload {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
   OCMStub([self.mockFileInfo SHA256]).andReturn(@"a");
 
   OCMExpect([self.mockConfigurator enableAllEventUpload]).andReturn(YES);
-  OCMExpect([self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMExpect([self.mockEventDatabase addStoredEvents:OCMOCK_ANY]);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateAllow;
@@ -818,7 +885,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   OCMExpect([self.mockConfigurator disableUnknownEventUpload]).andReturn(YES);
 
   [self validateExecEvent:SNTActionRespondAllow];
-  OCMVerify(never(), [self.mockEventDatabase addStoredEvent:OCMOCK_ANY]);
+  OCMVerify(never(), [self.mockEventDatabase addStoredEvents:OCMOCK_ANY]);
   [self checkMetricCounters:kAllowUnknown expected:@1];
 }
 
@@ -947,8 +1014,10 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 // Test that successful TouchID auth populates the cache, and subsequent executions
 // of the same binary skip the TouchID prompt (cache hit scenario)
 - (void)testTouchIDCacheHitSkipsPrompt {
+  // Approvals are cached by the binary digest, so this must be a valid SHA-256
+  NSString* sha256 = @"2334f2d3a0f0e4bd7a4e2b4e18ae5d4c4a1e0bbc5d9a3c4d1f3e1e1a2b3c4d5e";
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cachedsha256");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(sha256);
   OCMStub([self.mockConfigurator clientMode]).andReturn(SNTClientModeLockdown);
 
   // Create mock notifier queue that captures the reply block
@@ -1020,7 +1089,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   currentDecision.decision = SNTEventStateBlockUnknown;
   currentDecision.holdAndAsk = YES;
   currentDecision.decisionClientMode = SNTClientModeLockdown;
-  currentDecision.sha256 = @"cachedsha256";
+  currentDecision.sha256 = sha256;
   currentDecision.touchIDCooldownMinutes = @(5);  // 5 minute cooldown for caching
 
   {
@@ -1055,7 +1124,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   secondDecision.decision = SNTEventStateBlockUnknown;
   secondDecision.holdAndAsk = YES;
   secondDecision.decisionClientMode = SNTClientModeLockdown;
-  secondDecision.sha256 = @"cachedsha256";       // Same SHA256 - should hit cache
+  secondDecision.sha256 = sha256;  // Same SHA256 - should hit cache
   secondDecision.touchIDCooldownMinutes = @(5);  // Same cooldown
   currentDecision = secondDecision;
 
@@ -1205,12 +1274,12 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
 - (void)testSeatbeltRuleFallbackAllowsOnFullMatch {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
 
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
@@ -1221,18 +1290,18 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(msg->process->audit_token,
-                                              MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
+                                              MakeSandboxRequest(17, 42, cdhash, kSeatbeltSHA256));
              }];
 }
 
 - (void)testSeatbeltRuleFallbackDeniesOnDevMismatch {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
 
   [self validateExecEvent:SNTActionRespondDeny
              messageSetup:^(es_message_t* msg) {
@@ -1244,18 +1313,18 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(
                    msg->process->audit_token,
-                   MakeSandboxRequest(/*dev=*/999, /*ino=*/42, cdhash, @"cafebabe"));
+                   MakeSandboxRequest(/*dev=*/999, /*ino=*/42, cdhash, kSeatbeltSHA256));
              }];
 }
 
 - (void)testSeatbeltRuleFallbackDeniesOnInoMismatch {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
 
   [self validateExecEvent:SNTActionRespondDeny
              messageSetup:^(es_message_t* msg) {
@@ -1267,18 +1336,18 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(
                    msg->process->audit_token,
-                   MakeSandboxRequest(17, /*ino=*/999, cdhash, @"cafebabe"));
+                   MakeSandboxRequest(17, /*ino=*/999, cdhash, kSeatbeltSHA256));
              }];
 }
 
 - (void)testSeatbeltRuleFallbackDeniesOnSHA256Mismatch {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
 
   [self validateExecEvent:SNTActionRespondDeny
              messageSetup:^(es_message_t* msg) {
@@ -1289,7 +1358,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(msg->process->audit_token,
-                                              MakeSandboxRequest(17, 42, cdhash, @"deadbeef"));
+                                              MakeSandboxRequest(17, 42, cdhash, kOtherSHA256));
              }];
 }
 
@@ -1311,18 +1380,18 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(msg->process->audit_token,
-                                              MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
+                                              MakeSandboxRequest(17, 42, cdhash, kSeatbeltSHA256));
              }];
 }
 
 - (void)testSeatbeltRuleFallbackDeniesWhenExpectationSHA256IsEmpty {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
 
   [self validateExecEvent:SNTActionRespondDeny
              messageSetup:^(es_message_t* msg) {
@@ -1340,12 +1409,12 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 - (void)testSeatbeltRuleFallbackWhenStrictFlagsWithoutCSValid {
   // CS_HARD|CS_KILL but missing CS_VALID -> falls to fallback branch.
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
 
   [self validateExecEvent:SNTActionRespondAllowNoCache
              messageSetup:^(es_message_t* msg) {
@@ -1357,7 +1426,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(msg->process->audit_token,
-                                              MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
+                                              MakeSandboxRequest(17, 42, cdhash, kSeatbeltSHA256));
              }];
 }
 
@@ -1388,12 +1457,12 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 // re-exec is a self-exec.
 - (void)testSeatbeltSandboxedSelfExecAllows {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
   // No cached decision for the instigator -> relaxation uses the (dev, ino) fallback.
   [self stubInstigatorSHA256:nil];
 
@@ -1409,7 +1478,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(msg->process->audit_token,
-                                              MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
+                                              MakeSandboxRequest(17, 42, cdhash, kSeatbeltSHA256));
              }];
 
   // Call 2: the recorded process (now the instigator (501, 1)) re-execs the
@@ -1471,12 +1540,12 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 // not hold.
 - (void)testSeatbeltSelfExecNotTrackedDenies {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
 
   [self validateExecEvent:SNTActionRespondDeny
              messageSetup:^(es_message_t* msg) {
@@ -1494,12 +1563,12 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 // the relaxation is limited to self-exec.
 - (void)testSeatbeltSandboxedNonSelfExecDenies {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
   // No cached decision for the instigator -> relaxation uses the (dev, ino) fallback.
   [self stubInstigatorSHA256:nil];
 
@@ -1514,7 +1583,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(msg->process->audit_token,
-                                              MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
+                                              MakeSandboxRequest(17, 42, cdhash, kSeatbeltSHA256));
              }];
 
   // Call 2: instigator (531, 1) is recorded, but the target is a different
@@ -1554,12 +1623,12 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   self.sut = [self makeControllerWithProcessTree:tree];
 
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
   // No cached decision for the instigator -> relaxation uses the (dev, ino) fallback.
   [self stubInstigatorSHA256:nil];
 
@@ -1574,7 +1643,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(msg->process->audit_token,
-                                              MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
+                                              MakeSandboxRequest(17, 42, cdhash, kSeatbeltSHA256));
              }];
 
   // Call 2: the double-forked descendant D (602, 3) re-execs the same binary
@@ -1608,12 +1677,12 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
   self.sut = [self makeControllerWithProcessTree:tree];
 
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
 
   // No ancestor was recorded -> C (701, 2) self-exec is denied.
   [self validateExecEvent:SNTActionRespondDeny
@@ -1632,14 +1701,14 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 // even when (dev, ino) differ, exercising the hash comparison in SameBinary.
 - (void)testSeatbeltSandboxedSelfExecAllowsViaSHA256 {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
-  // Cached instigator hash matches the target's SHA-256 (@"cafebabe").
-  [self stubInstigatorSHA256:@"cafebabe"];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
+  // Cached instigator hash matches the target's SHA-256 (kSeatbeltSHA256).
+  [self stubInstigatorSHA256:kSeatbeltSHA256];
 
   // Call 1: record sandboxed target token (701, 1).
   [self validateExecEvent:SNTActionRespondAllowNoCache
@@ -1652,7 +1721,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(msg->process->audit_token,
-                                              MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
+                                              MakeSandboxRequest(17, 42, cdhash, kSeatbeltSHA256));
              }];
 
   // Call 2: instigator (701, 1) re-execs with a DIFFERENT (dev, ino) but the same
@@ -1673,12 +1742,12 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 // the same (pid, pidversion) is no longer relaxed.
 - (void)testForgetSandboxedSeatbeltProcDenies {
   OCMStub([self.mockFileInfo isMachO]).andReturn(YES);
-  OCMStub([self.mockFileInfo SHA256]).andReturn(@"cafebabe");
+  OCMStub([self.mockFileInfo SHA256]).andReturn(kSeatbeltSHA256);
 
   SNTRule* rule = [[SNTRule alloc] init];
   rule.state = SNTRuleStateSeatbelt;
   rule.type = SNTRuleTypeBinary;
-  [self stubRule:rule forIdentifiers:{.binarySHA256 = @"cafebabe"}];
+  [self stubRule:rule forIdentifiers:{.binarySHA256 = kSeatbeltSHA256}];
 
   // Call 1: record sandboxed target token (801, 1).
   [self validateExecEvent:SNTActionRespondAllowNoCache
@@ -1691,7 +1760,7 @@ static SNTSandboxExecRequest* MakeSandboxRequest(uint64_t dev, uint64_t ino, con
 
                const uint8_t cdhash[20] = {0};
                _sandboxExpectations->Register(msg->process->audit_token,
-                                              MakeSandboxRequest(17, 42, cdhash, @"cafebabe"));
+                                              MakeSandboxRequest(17, 42, cdhash, kSeatbeltSHA256));
              }];
 
   // Evict the recorded process, as the tree-aware authorizer does on its exit.
@@ -16,6 +16,8 @@
 
 #import <Foundation/Foundation.h>
 
+#include <bit>
+#include <memory>
 #include <utility>
 
 #import "Source/common/MOLXPCConnection.h"
@@ -38,6 +40,7 @@
 #import "Source/common/ne/SNTXPCNetworkExtensionInterface.h"
 #import "Source/santad/DaemonConfigBundle.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
+#include "Source/santad/NetworkFlowRing.h"
 #import "Source/santad/SNTDecisionCache.h"
 #import "Source/santad/SNTNotificationQueue.h"
 #import "Source/santad/SNTSyncdQueue.h"
@@ -52,10 +55,26 @@ NSString* const kSantaNetworkExtensionProtocolVersion = @"1.1";
 // the event-upload backoff: it only collapses prompt bursts for one (process, rule, destination).
 static const NSTimeInterval kNetworkFlowDialogDedupeInterval = 60;
 
+// How often records santanetd published to the flow ring are logged.
+static const uint64_t kNetworkFlowRingDrainIntervalNS = 1 * NSEC_PER_SEC;
+
+// Flows read from the ring are only available in their protobuf form.
+static BOOL EventLogTypeSupportsNetworkFlowRing(SNTEventLogType type) {
+  switch (type) {
+    case SNTEventLogTypeSyslog:
+    case SNTEventLogTypeUnifiedLog:
+    case SNTEventLogTypeFilelog:
+    case SNTEventLogTypeNull: return NO;
+    default: return YES;
+  }
+}
+
 @interface SNTNetworkExtensionQueue () {
   std::shared_ptr<santa::Logger> _logger;
   std::shared_ptr<santa::TTYWriter> _ttyWriter;
 }
+// Drains the flow ring shared with the connected santanetd, if one was set up at registration.
+@property dispatch_source_t flowRingTimer;
 @property MOLXPCConnection* netExtConnection;
 @property(readwrite) NSString* connectedProtocolVersion;
 @property NSArray<SNTKVOManager*>* kvoWatchers;
@@ -159,18 +178,19 @@ static const NSTimeInterval kNetworkFlowDialogDedupeInterval = 60;
     // read above and the materialization below). `nil` rules means "rules unchanged" to
     // santanetd, so settings-only changes skip the snapshot allocation entirely.
     NSArray<SNTNetworkFlowRule*>* rules = nil;
+    NSString* rulesHash = nil;
     NSString* hashToRecord = currentHash;
     if (rulesChanged) {
       SNTNetworkFlowRulesSnapshot* snapshot = [self.ruleTable retrieveAllNetworkFlowRulesSnapshot];
       rules = snapshot.rules;
-      hashToRecord = snapshot.networkFlowRulesHash;
+      rulesHash = hashToRecord = snapshot.networkFlowRulesHash;
     }
     // The wire object carries the scalar settings plus the rules delta (nil rules == "unchanged").
     // lastPushedSettings stays the scalar `settings` object below; networkFlowRules is excluded
     // from -isEqual:/-hash so it never perturbs the settings delta, and the rules delta is tracked
     // separately via lastPushedNetworkFlowRulesHash.
     SNTNetworkExtensionSettings* wireSettings =
-        [settings settingsByAttachingNetworkFlowRules:rules];
+        [settings settingsByAttachingNetworkFlowRules:rules networkFlowRulesHash:rulesHash];
 
     // Record lastPushed only on a successful reply, so a netd-side rejection leaves our
     // recorded state matching netd's actual state and the next reconcile retries. The reply
@@ -400,7 +420,61 @@ static const NSTimeInterval kNetworkFlowDialogDedupeInterval = 60;
     // The reply carries the scalar settings plus the full ruleset in networkFlowRules. We keep
     // lastPushedSettings as the scalar `settings`; since networkFlowRules is excluded from
     // -isEqual:, the rules-bearing wire object still compares equal to it.
-    return [settings settingsByAttachingNetworkFlowRules:snapshot.rules];
+    SNTNetworkExtensionSettings* reply =
+        [settings settingsByAttachingNetworkFlowRules:snapshot.rules
+                                 networkFlowRulesHash:snapshot.networkFlowRulesHash];
+    NSFileHandle* flowRing = [self startNetworkFlowRing];
+    return flowRing ? [reply settingsByAttachingNetworkFlowRing:flowRing] : reply;
+  }
+}
+
+// Each registration gets a fresh ring, so nothing a previous santanetd left in one is read after
+// it's gone. Returns nil when the ring is disabled or couldn't be created, in which case
+// santanetd keeps reporting flows over XPC.
+- (NSFileHandle*)startNetworkFlowRing {
+  SNTConfigurator* configurator = [SNTConfigurator configurator];
+  NSUInteger capacity = [configurator networkFlowRingCapacity];
+  if (!capacity || !EventLogTypeSupportsNetworkFlowRing([configurator eventLogType])) {
+    return nil;
+  }
+
+  std::shared_ptr<santa::NetworkFlowRing> ring =
+      santa::NetworkFlowRing::Create(std::bit_ceil(static_cast<uint32_t>(capacity)));
+  if (!ring) {
+    return nil;
+  }
+
+  dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.flow_ring",
+                                             DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
+  self.flowRingTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
+
+  // The handler keeps the ring alive until the timer is cancelled and released.
+  WEAKIFY(self);
+  std::shared_ptr<santa::Logger> logger = _logger;
+  dispatch_source_set_event_handler(self.flowRingTimer, ^{
+    STRONGIFY(self);
+    if (![self shouldInstallNetworkExtension]) {
+      return;
+    }
+    ring->Drain([&logger](const ::santa::pb::v1::NetworkActivity::Process& process,
+                          struct timespec window_start, struct timespec window_end) {
+      logger->LogNetworkActivity(process, window_start, window_end);
+    });
+  });
+  dispatch_source_set_timer(self.flowRingTimer,
+                            dispatch_time(DISPATCH_TIME_NOW, kNetworkFlowRingDrainIntervalNS),
+                            kNetworkFlowRingDrainIntervalNS, kNetworkFlowRingDrainIntervalNS / 10);
+  dispatch_resume(self.flowRingTimer);
+
+  LOGI(@"Offering network extension a flow ring of %lu records", (unsigned long)capacity);
+  // The ring owns the descriptor; NSXPC duplicates it when sending the handle.
+  return [[NSFileHandle alloc] initWithFileDescriptor:ring->FileDescriptor() closeOnDealloc:NO];
+}
+
+- (void)stopNetworkFlowRing {
+  if (self.flowRingTimer) {
+    dispatch_source_cancel(self.flowRingTimer);
+    self.flowRingTimer = nil;
   }
 }
 
@@ -432,6 +506,7 @@ static const NSTimeInterval kNetworkFlowDialogDedupeInterval = 60;
     // Forget what we told the old santanetd; the next one starts empty and must be re-seeded.
     self.lastPushedSettings = nil;
     self.lastPushedNetworkFlowRulesHash = nil;
+    [self stopNetworkFlowRing];
   }
 }
 
@@ -47,6 +47,7 @@
 @property SNTNetworkExtensionSettings* lastPushedSettings;
 @property NSString* lastPushedNetworkFlowRulesHash;
 @property(readwrite) NSString* connectedProtocolVersion;
+@property dispatch_source_t flowRingTimer;
 - (instancetype)initWithNotifierQueue:(SNTNotificationQueue*)notifierQueue
                            syncdQueue:(SNTSyncdQueue*)syncdQueue
                             ruleTable:(SNTRuleTable*)ruleTable
@@ -149,7 +150,7 @@
   OCMExpect([self.mockProxy
       updateNetworkExtensionSettings:[OCMArg checkWithBlock:^BOOL(SNTNetworkExtensionSettings* c) {
         return c.enable && c.flowDefaultAction == SNTNetworkFlowDefaultActionDeny &&
-               c.networkFlowRules.count == 2;
+               c.networkFlowRules.count == 2 && [c.networkFlowRulesHash isEqualToString:@"h1"];
       }]
                                reply:[OCMArg invokeBlock]]);
 
@@ -169,7 +170,7 @@
   OCMExpect([self.mockProxy
       updateNetworkExtensionSettings:[OCMArg checkWithBlock:^BOOL(SNTNetworkExtensionSettings* c) {
         return c.enable && c.flowDefaultAction == SNTNetworkFlowDefaultActionAllow &&
-               c.networkFlowRules == nil;
+               c.networkFlowRules == nil && c.networkFlowRulesHash == nil;
       }]
                                reply:[OCMArg invokeBlock]]);
   // Settings-only change must not materialize the ruleset.
@@ -190,7 +191,7 @@
   OCMExpect([self.mockProxy
       updateNetworkExtensionSettings:[OCMArg checkWithBlock:^BOOL(SNTNetworkExtensionSettings* c) {
         return c.enable && c.flowDefaultAction == SNTNetworkFlowDefaultActionDeny &&
-               c.networkFlowRules.count == 1;
+               c.networkFlowRules.count == 1 && [c.networkFlowRulesHash isEqualToString:@"h2"];
       }]
                                reply:[OCMArg invokeBlock]]);
 
@@ -283,6 +284,7 @@
   XCTAssertTrue(settings.enable);
   XCTAssertEqual(settings.flowDefaultAction, SNTNetworkFlowDefaultActionDeny);
   XCTAssertEqual(settings.networkFlowRules.count, 2);
+  XCTAssertEqualObjects(settings.networkFlowRulesHash, @"h1");
 
   // last-pushed reflects what the reply seeded (scalars equal; networkFlowRules is excluded from
   // -isEqual:), so an immediate no-change reconcile is a no-op.
@@ -293,6 +295,50 @@
   [sutMock stopMocking];
 }
 
+- (void)testRegistrationOffersFlowRingWhenEnabled {
+  [self stubConfiguratorEnable:YES action:SNTNetworkFlowDefaultActionDeny];
+  [self stubRuleTableHash:@"h1" rules:@[ [self rule:1] ]];
+  OCMStub([self.mockConfigurator networkFlowRingCapacity]).andReturn(1024);
+  OCMStub([self.mockConfigurator eventLogType]).andReturn(SNTEventLogTypeProtobuf);
+
+  id sutMock = OCMPartialMock(self.sut);
+  OCMStub([sutMock establishNetworkExtensionConnection]).andDo(^(NSInvocation* inv) {
+    self.sut.netExtConnection = self.mockConnection;
+  });
+
+  SNTNetworkExtensionSettings* settings = [self.sut handleRegistrationWithProtocolVersion:@"1.1"
+                                                                                    error:nil];
+  XCTAssertNotNil(settings.networkFlowRing);
+  XCTAssertEqual(settings.networkFlowRules.count, 1);
+  XCTAssertEqualObjects(settings.networkFlowRulesHash, @"h1");
+  XCTAssertNotNil(self.sut.flowRingTimer);
+
+  // The ring goes away with the connection
+  [self.sut clearNetworkExtensionConnection];
+  XCTAssertNil(self.sut.flowRingTimer);
+
+  [sutMock stopMocking];
+}
+
+- (void)testRegistrationDoesNotOfferFlowRingForBasicStringLogs {
+  [self stubConfiguratorEnable:YES action:SNTNetworkFlowDefaultActionDeny];
+  [self stubRuleTableHash:@"h1" rules:@[]];
+  OCMStub([self.mockConfigurator networkFlowRingCapacity]).andReturn(1024);
+  OCMStub([self.mockConfigurator eventLogType]).andReturn(SNTEventLogTypeFilelog);
+
+  id sutMock = OCMPartialMock(self.sut);
+  OCMStub([sutMock establishNetworkExtensionConnection]).andDo(^(NSInvocation* inv) {
+    self.sut.netExtConnection = self.mockConnection;
+  });
+
+  SNTNetworkExtensionSettings* settings = [self.sut handleRegistrationWithProtocolVersion:@"1.1"
+                                                                                    error:nil];
+  XCTAssertNil(settings.networkFlowRing);
+  XCTAssertNil(self.sut.flowRingTimer);
+
+  [sutMock stopMocking];
+}
+
 - (void)testConnectionClearResetsLastPushedSoNextSeedIsFull {
   self.sut.lastPushedNetworkFlowRulesHash = @"h1";
   self.sut.lastPushedSettings =
@@ -24,6 +24,29 @@
 #import "Source/common/SNTStrengthify.h"
 #import "Source/common/SNTXPCNotifierInterface.h"
 
+// Block notifications for the same binary and team within this long of the first are folded
+// into it rather than sent to the GUI on their own.
+static const NSTimeInterval kBlockNotificationCoalesceInterval = 10;
+
+// Returns nil for events that shouldn't be coalesced, i.e. those without a hash.
+static NSString* CoalesceKey(SNTStoredExecutionEvent* event) {
+  if (!event.fileSHA256.length) return nil;
+  return [NSString stringWithFormat:@"%@|%@", event.fileSHA256, event.teamID ?: @""];
+}
+
+// Call the notification's reply block, if any, along with those of the events folded into it.
+static void ReplyToNotification(NSDictionary* d, BOOL authenticated) {
+  NotificationReplyBlock replyBlock = d[@"reply"];
+  if (replyBlock) {
+    replyBlock(authenticated);
+  }
+  NSMutableArray<NotificationReplyBlock>* coalesced = d[@"coalescedReplies"];
+  for (NotificationReplyBlock coalescedReply in coalesced) {
+    coalescedReply(authenticated);
+  }
+  [coalesced removeAllObjects];
+}
+
 @interface SNTNotificationQueue ()
 @property dispatch_queue_t pendingQueue;
 @property NSMutableArray* sentToUser;
@@ -59,6 +82,7 @@
     return;
   }
 
+  NSString* coalesceKey = CoalesceKey(event);
   NSMutableDictionary* d = [NSMutableDictionary dictionary];
   [d setValue:event forKey:@"event"];
   [d setValue:message forKey:@"message"];
@@ -68,43 +92,85 @@
   // This is necessary because the block is allocated on the stack in the
   // Execution controller which goes out of scope.
   [d setValue:[replyBlock copy] forKey:@"reply"];
+  [d setValue:coalesceKey forKey:@"coalesceKey"];
+  [d setValue:[NSDate date] forKey:@"added"];
+  [d setValue:[NSMutableArray array] forKey:@"coalescedReplies"];
 
   dispatch_sync(self.pendingQueue, ^{
+    if ([self coalesceIntoExistingSerialized:coalesceKey reply:d[@"reply"]]) {
+      return;
+    }
+
     NSDictionary* msg = _pendingNotifications->Enqueue(d).value_or(nil);
 
     if (msg != nil) {
       LOGI(@"Pending GUI notification count is over %zu, dropping oldest notification.",
            _pendingNotifications->Capacity());
-      // Check if the dropped notification had a reply block and if so, call it
-      // so any resources can be cleaned up.
-      NotificationReplyBlock replyBlock = msg[@"reply"];
-      if (replyBlock) {
-        replyBlock(NO);
-      }
+      // Call any reply blocks of the dropped notification so resources can be cleaned up.
+      ReplyToNotification(msg, NO);
     }
 
     [self flushQueueSerialized];
   });
 }
 
+/// During a burst of blocks of the same binary, e.g. an installer spawning
+/// many copies of a helper, fold the repeats into the notification already
+/// pending or on screen for it, so the GUI is only sent one. The repeat's reply
+/// is called with the user's response to that notification.
+- (BOOL)coalesceIntoExistingSerialized:(NSString*)coalesceKey reply:(NotificationReplyBlock)reply {
+  if (!coalesceKey) {
+    return NO;
+  }
+
+  NSDate* cutoff = [NSDate dateWithTimeIntervalSinceNow:-kBlockNotificationCoalesceInterval];
+  auto matches = ^BOOL(NSDictionary* d) {
+    return [d[@"coalesceKey"] isEqualToString:coalesceKey] &&
+           [d[@"added"] compare:cutoff] == NSOrderedDescending;
+  };
+
+  NSMutableDictionary* existing = nil;
+  for (NSMutableDictionary* d : *_pendingNotifications) {
+    if (matches(d)) {
+      existing = d;
+      break;
+    }
+  }
+  if (!existing) {
+    for (NSMutableDictionary* d in self.sentToUser) {
+      if (matches(d)) {
+        existing = d;
+        break;
+      }
+    }
+  }
+  if (!existing) {
+    return NO;
+  }
+
+  NSMutableArray<NotificationReplyBlock>* coalesced = existing[@"coalescedReplies"];
+  if (reply) {
+    [coalesced addObject:reply];
+  }
+  LOGD(@"Coalesced block notification for %@", coalesceKey);
+  return YES;
+}
+
 /// For each pending notification, call the reply block if set then clear the
 /// reply so it won't be called again when the notification is eventually sent.
 - (void)clearAllPendingWithRepliesSerialized {
   // Auto-respond to blocks that have been sent to the UI but have not yet received a response.
   for (NSDictionary* d in self.sentToUser) {
-    NotificationReplyBlock replyBlock = d[@"reply"];
-    if (replyBlock) {
-      replyBlock(NO);
-    }
+    ReplyToNotification(d, NO);
   }
   [self.sentToUser removeAllObjects];
 
   _pendingNotifications->Erase(
       std::remove_if(_pendingNotifications->begin(), _pendingNotifications->end(),
                      [](NSMutableDictionary* d) {
-                       NotificationReplyBlock replyBlock = d[@"reply"];
-                       if (replyBlock) {
-                         replyBlock(NO);
+                       NSArray* coalesced = d[@"coalescedReplies"];
+                       if (d[@"reply"] || coalesced.count) {
+                         ReplyToNotification(d, NO);
                          return true;
                        } else {
                          return false;
@@ -144,12 +210,19 @@
     WEAKIFY(self);
     NotificationReplyBlock wrappedReplyBlock = ^(BOOL authenticated) {
       STRONGIFY(self);
+      __block NSArray<NotificationReplyBlock>* coalesced = nil;
       if (self) {
         dispatch_sync(self.pendingQueue, ^{
           [self.sentToUser removeObject:d];
+          // Taken under the queue so events coalesced from now on start a new notification.
+          coalesced = [d[@"coalescedReplies"] copy];
+          [d[@"coalescedReplies"] removeAllObjects];
         });
       }
       replyBlock(authenticated);
+      for (NotificationReplyBlock coalescedReply in coalesced) {
+        coalescedReply(authenticated);
+      }
     };
 
     [rop postBlockNotification:d[@"event"]
@@ -298,6 +298,75 @@
   XCTAssertTrue(self.ringbuf->Empty());
 }
 
+- (void)testAddEventCoalescesRepeatsOfSameBinary {
+  SNTStoredExecutionEvent* (^makeEvent)(NSString*) = ^(NSString* teamID) {
+    SNTStoredExecutionEvent* se = [[SNTStoredExecutionEvent alloc] init];
+    se.fileSHA256 = @"7ae80b9ab38af0c63a9a81765f434d9a7cd8f720eb6037ef303de39d779bc258";
+    se.teamID = teamID;
+    return se;
+  };
+  SNTStoredExecutionEvent* se1 = makeEvent(@"EQHXZ8M8AV");
+  SNTStoredExecutionEvent* se2 = makeEvent(@"EQHXZ8M8AV");
+  SNTStoredExecutionEvent* se3 = makeEvent(@"EQHXZ8M8AV");
+  SNTStoredExecutionEvent* otherTeam = makeEvent(@"ZMCG7MLDV9");
+
+  // The GUI only hears about the first event for the binary and team
+  __block NotificationReplyBlock guiReply;
+  OCMExpect([self.mockProxy postBlockNotification:se1
+                                withCustomMessage:OCMOCK_ANY
+                                        customURL:OCMOCK_ANY
+                                      configState:OCMOCK_ANY
+                                         andReply:OCMOCK_ANY])
+      .andDo(^(NSInvocation* inv) {
+        void (^__unsafe_unretained replyBlock)(BOOL);
+        [inv getArgument:&replyBlock atIndex:6];
+        guiReply = [replyBlock copy];
+      });
+  OCMExpect([self.mockProxy postBlockNotification:otherTeam
+                                withCustomMessage:OCMOCK_ANY
+                                        customURL:OCMOCK_ANY
+                                      configState:OCMOCK_ANY
+                                         andReply:OCMOCK_ANY]);
+  OCMReject([self.mockProxy postBlockNotification:se2
+                                withCustomMessage:OCMOCK_ANY
+                                        customURL:OCMOCK_ANY
+                                      configState:OCMOCK_ANY
+                                         andReply:OCMOCK_ANY]);
+  OCMReject([self.mockProxy postBlockNotification:se3
+                                withCustomMessage:OCMOCK_ANY
+                                        customURL:OCMOCK_ANY
+                                      configState:OCMOCK_ANY
+                                         andReply:OCMOCK_ANY]);
+
+  NSMutableArray<XCTestExpectation*>* expectations = [NSMutableArray array];
+  for (SNTStoredExecutionEvent* se in @[ se1, se2, se3 ]) {
+    XCTestExpectation* expectation = [self expectationWithDescription:@"Reply called"];
+    [expectations addObject:expectation];
+    [self.sut addEvent:se
+        withCustomMessage:nil
+                customURL:nil
+              configState:nil
+                 andReply:^(BOOL val) {
+                   XCTAssertTrue(val);
+                   [expectation fulfill];
+                 }];
+  }
+  [self.sut addEvent:otherTeam
+      withCustomMessage:nil
+              customURL:nil
+            configState:nil
+               andReply:nil];
+
+  OCMVerifyAll(self.mockProxy);
+
+  // Every coalesced event gets the user's response to the one notification
+  XCTAssertNotNil(guiReply);
+  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    guiReply(YES);
+  });
+  [self waitForExpectations:expectations timeout:3.0];
+}
+
 // Patch 1: with no GUI connection, the TAM auth request must invoke its reply
 // synchronously with (NO, @"") rather than leaving it uninvoked — otherwise the
 // daemon-side grant stalls its full fail-closed timeout.
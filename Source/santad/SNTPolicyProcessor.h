@@ -51,6 +51,13 @@ using ActivationCallbackBlock =
                         entitlementsFilter:
                             (std::shared_ptr<santa::EntitlementsFilter>)entitlementsFilter;
 
+///
+///  Compile the plans for the CEL rules in the rule table in the background, and size the plan
+///  caches to hold them, so executions matching those rules don't wait on compilation. Call at
+///  startup and whenever CEL rules are added.
+///
+- (void)precompileCELRules;
+
 ///
 ///  Convenience initializer. Will obtain the teamID and construct the signingID
 ///  identifier if able.
@@ -66,6 +73,22 @@ using ActivationCallbackBlock =
                                    (nullable ActivationCallbackBlock)activationCallback
                                    cachedDecision:(nullable SNTCachedDecision*)existingDecision;
 
+///
+///  Returns the decision for a critical system binary identified by the CDHash the kernel
+///  strictly enforces for targetProc, or nil if it isn't one. Only the es_process_t fields are
+///  needed, so the binary doesn't have to be opened.
+///
+- (nullable SNTCachedDecision*)
+    criticalSystemBinaryDecisionForProcess:(nonnull const es_process_t*)targetProc
+                               configState:(nonnull SNTConfigState*)configState;
+
+///
+///  Returns YES if decisions for binaries whose CDHash the kernel strictly enforces can be made
+///  without the SHA-256 of the file, i.e. lazy binary hashing is enabled and no rule or event
+///  upload identifies binaries by their SHA-256.
+///
+- (BOOL)canDeferSHA256ForCDHashEnforcedBinaries;
+
 ///
 /// Updates a decision for a given file and agent configuration.
 ///
@@ -21,27 +21,38 @@
 #import <Security/SecCode.h>
 #import <Security/Security.h>
 
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
 #import "Source/common/CertificateHelpers.h"
 #include "Source/common/CodeSigningIdentifierUtils.h"
+#include "Source/common/ExecTrace.h"
 #import "Source/common/MOLCodesignChecker.h"
 #import "Source/common/SNTCELFallbackRule.h"
 #import "Source/common/SNTCachedDecision.h"
 #import "Source/common/SNTConfigurator.h"
-#import "Source/common/SNTDeepCopy.h"
 #import "Source/common/SNTFileInfo.h"
 #import "Source/common/SNTKVOManager.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTRule.h"
+#import "Source/common/SNTSigningInfoCache.h"
 #import "Source/common/SigningIDHelpers.h"
 #include "Source/common/String.h"
 #include "Source/common/cel/CELPlanCache.h"
 #include "Source/common/cel/Evaluator.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/ReusableArena.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
 #include "cel/v1.pb.h"
 
-static constexpr uint64_t kCELPlanCacheMaxSize = 128;
+// Bounds on the number of plans kept per CEL evaluator. Within them each cache
+// is sized to hold a plan for every CEL rule, with room to spare for rules
+// added between precompilations.
+static constexpr uint64_t kCELPlanCacheMinSize = 128;
+static constexpr uint64_t kCELPlanCacheMaxSize = 8192;
 
 enum class PlatformBinaryState {
   kRuntimeTrue = 0,
@@ -86,9 +97,12 @@ struct CompiledFallbackRule {
 struct FallbackBatch {
   std::unique_ptr<google::protobuf::Arena> arena;
   std::vector<CompiledFallbackRule> rules;
+  // Union over all rules, as they are evaluated against one activation.
+  santa::cel::ReferencedFields referencedFields;
 
-  FallbackBatch(std::unique_ptr<google::protobuf::Arena> a, std::vector<CompiledFallbackRule> r)
-      : arena(std::move(a)), rules(std::move(r)) {}
+  FallbackBatch(std::unique_ptr<google::protobuf::Arena> a, std::vector<CompiledFallbackRule> r,
+                santa::cel::ReferencedFields f)
+      : arena(std::move(a)), rules(std::move(r)), referencedFields(std::move(f)) {}
 
   // Compiles each rule's expression with `evaluator` into a fresh shared arena
   // and returns an immutable batch. Returns nullptr if any expression fails to
@@ -98,16 +112,21 @@ struct FallbackBatch {
     auto arena = std::make_unique<google::protobuf::Arena>();
     std::vector<CompiledFallbackRule> compiled;
     compiled.reserve(rules.count);
+    santa::cel::ReferencedFields batchFields;
     for (SNTCELFallbackRule* rule in rules) {
-      auto result = evaluator->Compile(santa::NSStringToUTF8StringView(rule.celExpr), arena.get());
+      santa::cel::ReferencedFields ruleFields;
+      auto result = evaluator->Compile(santa::NSStringToUTF8StringView(rule.celExpr), arena.get(),
+                                       &ruleFields);
       if (!result.ok()) {
         LOGE(@"Failed to compile CEL fallback expression '%@': %s", rule.celExpr,
              std::string(result.status().message()).c_str());
         return nullptr;
       }
       compiled.push_back({std::move(*result), rule.customMsg, rule.customURL});
+      batchFields |= ruleFields;
     }
-    return std::make_shared<FallbackBatch>(std::move(arena), std::move(compiled));
+    return std::make_shared<FallbackBatch>(std::move(arena), std::move(compiled),
+                                           std::move(batchFields));
   }
 };
 
@@ -128,6 +147,7 @@ struct FallbackBatch {
 @property SNTRuleTable* ruleTable;
 @property SNTConfigurator* configurator;
 @property SNTKVOManager* celFallbackRulesObserver;
+@property dispatch_queue_t celPrecompileQueue;
 @end
 
 @implementation SNTPolicyProcessor
@@ -136,12 +156,16 @@ struct FallbackBatch {
   self = [super init];
   if (self) {
     _configurator = [SNTConfigurator configurator];
+    _celPrecompileQueue = dispatch_queue_create(
+        "com.northpolesec.santa.daemon.celprecompile",
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL,
+                                                QOS_CLASS_UTILITY, 0));
 
     auto evaluatorV1 = santa::cel::Evaluator<false>::Create();
     if (evaluatorV1.ok()) {
       celEvaluatorV1_ = std::move(*evaluatorV1);
       celPlanCacheV1_ = std::make_unique<santa::cel::CELPlanCache<false>>(celEvaluatorV1_.get(),
-                                                                          kCELPlanCacheMaxSize);
+                                                                          kCELPlanCacheMinSize);
     } else {
       LOGW(@"Failed to create CEL v1 evaluator: %s",
            std::string(evaluatorV1.status().message()).c_str());
@@ -153,7 +177,7 @@ struct FallbackBatch {
     if (evaluatorV2.ok()) {
       celEvaluatorV2_ = std::move(*evaluatorV2);
       celPlanCacheV2_ = std::make_unique<santa::cel::CELPlanCache<true>>(celEvaluatorV2_.get(),
-                                                                         kCELPlanCacheMaxSize);
+                                                                         kCELPlanCacheMinSize);
     } else {
       LOGW(@"Failed to create CEL v2 evaluator: %s",
            std::string(evaluatorV2.status().message()).c_str());
@@ -188,6 +212,54 @@ struct FallbackBatch {
   return self;
 }
 
+- (void)precompileCELRules {
+  __weak __typeof(self) weakSelf = self;
+  dispatch_async(self.celPrecompileQueue, ^{
+    [weakSelf compileCELRulePlans];
+  });
+}
+
+// Resizes the plan caches to fit the current CEL rules and compiles a plan for
+// each rule that doesn't have one cached. Runs on celPrecompileQueue.
+- (void)compileCELRulePlans {
+  SNTRuleTable* ruleTable = self.ruleTable;
+  if (!ruleTable || (!celPlanCacheV1_ && !celPlanCacheV2_)) {
+    return;
+  }
+
+  // Copy the expressions out first so a read-only connection isn't held
+  // while they compile.
+  __block std::vector<std::pair<bool, std::string>> exprs;
+  [ruleTable enumerateCELRulesUsingBlock:^(SNTRule* rule, BOOL* stop) {
+    exprs.emplace_back(rule.state == SNTRuleStateCELv2, santa::NSStringToUTF8String(rule.celExpr));
+  }];
+
+  uint64_t count = exprs.size();
+  uint64_t maxSize = std::clamp(count + count / 4, kCELPlanCacheMinSize, kCELPlanCacheMaxSize);
+  if (celPlanCacheV1_) celPlanCacheV1_->SetMaxSize(maxSize);
+  if (celPlanCacheV2_) celPlanCacheV2_->SetMaxSize(maxSize);
+
+  // Compiling more plans than fit would only evict the ones compiled earlier.
+  if (exprs.size() > maxSize) {
+    exprs.resize(maxSize);
+  }
+
+  uint64_t failed = 0;
+  for (const auto& [useV2, expr] : exprs) {
+    absl::Status status;
+    if (useV2 && celPlanCacheV2_) {
+      status = celPlanCacheV2_->GetOrCompile(expr).status();
+    } else if (!useV2 && celPlanCacheV1_) {
+      status = celPlanCacheV1_->GetOrCompile(expr).status();
+    }
+    if (!status.ok()) ++failed;
+  }
+
+  if (failed > 0) {
+    LOGW(@"Failed to precompile %llu of %llu CEL rules", failed, count);
+  }
+}
+
 - (void)compileFallbackRules:(NSArray<SNTCELFallbackRule*>*)rules {
   if (!celEvaluatorV2_) {
     return;
@@ -215,6 +287,8 @@ struct FallbackBatch {
     return NO;
   }
 
+  santa::ExecTrace::Span span(santa::ExecTraceStage::kCEL);
+
   // Snapshot the published batch with a single atomic load + refcount bump
   // (O(1) regardless of rule count). The snapshot co-owns the arena and all
   // compiled plans, so this stays valid even if compileFallbackRules: swaps
@@ -229,17 +303,25 @@ struct FallbackBatch {
     return NO;
   }
 
-  auto activation = activationCallback(/*useV2=*/true);
+  // Evaluation temporaries go in this thread's reused evaluation arena, which
+  // is reset when it goes out of scope after the activation.
+  santa::ReusableArena evalArena(santa::ReusableArenaPool::kCELEvaluation);
 
-  // Use a stack-local arena for evaluation temporaries.
-  google::protobuf::Arena evalArena;
+  // Every rule is evaluated against the same activation, so variables built
+  // for one rule (e.g. the args list) are reused by the rules after it.
+  auto activation = activationCallback(/*useV2=*/true);
+  assert(dynamic_cast<santa::cel::Activation<true>*>(activation.get()) != nullptr);
+  auto* v2Activation = static_cast<santa::cel::Activation<true>*>(activation.get());
+  v2Activation->SetReferencedFields(batch->referencedFields);
+  v2Activation->ShareValuesInArena(evalArena.get());
 
   for (const CompiledFallbackRule& rule : batch->rules) {
     CELEvaluationResult celResult = [self evaluateCompiledCELExpression:rule.expression.get()
                                                                   useV2:true
                                                          cachedDecision:cd
                                                              activation:*activation
-                                                              evalArena:&evalArena
+                                                              evalArena:evalArena.get()
+                                                            resultCache:nullptr
                                                       inFallbackContext:YES];
 
     if (!celResult.succeeded) {
@@ -261,18 +343,31 @@ struct FallbackBatch {
   return NO;
 }
 
+// When resultCache is set, a cacheable result is kept there for the binary
+// identified by cd.sha256 and reused instead of evaluating again.
 - (CELEvaluationResult)
     evaluateCompiledCELExpression:(const ::google::api::expr::runtime::CelExpression*)expression
                             useV2:(bool)useV2
                    cachedDecision:(SNTCachedDecision*)cd
                        activation:(const ::google::api::expr::runtime::BaseActivation&)activation
                         evalArena:(google::protobuf::Arena*)evalArena
+                      resultCache:(santa::cel::CELResultCache*)resultCache
                 inFallbackContext:(BOOL)inFallbackContext {
   int returnValue = 0;
   bool cacheable = true;
   std::optional<uint64_t> touchIDCooldownMinutes;
 
-  if (useV2) {
+  std::string resultKey;
+  if (resultCache && cd.sha256.length) {
+    resultKey = santa::NSStringToUTF8String(cd.sha256);
+  }
+
+  std::optional<santa::cel::CachedCELResult> hit =
+      resultKey.empty() ? std::nullopt : resultCache->get(resultKey);
+  if (hit.has_value()) {
+    returnValue = hit->value;
+    touchIDCooldownMinutes = hit->touchIDCooldownMinutes;
+  } else if (useV2) {
     const auto& v2Activation = static_cast<const santa::cel::Activation<true>&>(activation);
     assert(dynamic_cast<const santa::cel::Activation<true>*>(&activation) != nullptr);
     auto evalResult = celEvaluatorV2_->Evaluate(expression, v2Activation, evalArena);
@@ -310,6 +405,13 @@ struct FallbackBatch {
     // V1 doesn't support TouchID, so cooldown is always nullopt
   }
 
+  if (!hit.has_value() && cacheable && !resultKey.empty()) {
+    resultCache->set(resultKey, santa::cel::CachedCELResult{
+                                    .value = returnValue,
+                                    .touchIDCooldownMinutes = touchIDCooldownMinutes,
+                                });
+  }
+
   // Apply cacheability before the switch below so that an early return from a
   // particular return value doesn't drop a non-cacheable result.
   if (!cacheable) {
@@ -392,8 +494,8 @@ struct FallbackBatch {
 - (CELEvaluationResult)evaluateCELExpressionForRule:(SNTRule*)rule
                                      cachedDecision:(SNTCachedDecision*)cd
                                  activationCallback:(ActivationCallbackBlock)activationCallback {
+  santa::ExecTrace::Span span(santa::ExecTraceStage::kCEL);
   bool useV2 = (rule.state == SNTRuleStateCELv2);
-  auto activation = activationCallback(useV2);
 
   if ((useV2 && !celPlanCacheV2_) || (!useV2 && !celPlanCacheV1_)) {
     LOGE(@"CEL v%d evaluator unavailable", useV2 ? 2 : 1);
@@ -418,14 +520,24 @@ struct FallbackBatch {
     return {.succeeded = false, .decisionMade = false, .resultState = {}};
   }
 
-  // Per-exec evaluation temporaries live on a stack arena; the plan's own
-  // (cached) constant arena is long-lived and read-only here.
-  google::protobuf::Arena evalArena;
+  // Per-exec evaluation temporaries live in this thread's reused evaluation
+  // arena, reset once it goes out of scope after the activation; the plan's
+  // own (cached) constant arena is long-lived and read-only here.
+  santa::ReusableArena evalArena(santa::ReusableArenaPool::kCELEvaluation);
+
+  auto activation = activationCallback(useV2);
+  if (useV2) {
+    assert(dynamic_cast<santa::cel::Activation<true>*>(activation.get()) != nullptr);
+    static_cast<santa::cel::Activation<true>*>(activation.get())
+        ->SetReferencedFields((*planResult)->referencedFields);
+  }
+
   return [self evaluateCompiledCELExpression:(*planResult)->expression.get()
                                        useV2:useV2
                               cachedDecision:cd
                                   activation:*activation
-                                   evalArena:&evalArena
+                                   evalArena:evalArena.get()
+                                 resultCache:&(*planResult)->results
                            inFallbackContext:NO];
 }
 
@@ -571,20 +683,21 @@ static void ApplySilentBlock(SNTCachedDecision* cd, SNTRuleState state) {
 }
 
 static void UpdateCachedDecisionSigningInfo(
-    SNTCachedDecision* cd, MOLCodesignChecker* csInfo, PlatformBinaryState platformBinaryState,
+    SNTCachedDecision* cd, SNTSigningInfo* signingInfo, PlatformBinaryState platformBinaryState,
     NSDictionary* _Nullable (^entitlementsFilterCallback)(NSDictionary* _Nullable entitlements)) {
-  cd.certSHA256 = csInfo.leafCertificate.SHA256;
-  cd.certCommonName = csInfo.leafCertificate.commonName;
-  cd.certChain = csInfo.certificates;
-  cd.rawSigningID = csInfo.signingID;
+  cd.certSHA256 = signingInfo.leafCertificate.SHA256;
+  cd.certCommonName = signingInfo.leafCertificate.commonName;
+  cd.certChain = signingInfo.certificates;
+  cd.rawSigningID = signingInfo.signingID;
   // Check if we need to get teamID from code signing.
   if (!cd.teamID) {
-    cd.teamID = csInfo.teamID;
+    cd.teamID = signingInfo.teamID;
   }
 
   // Check if we need to get signing ID from code signing.
   if (!cd.signingID) {
-    cd.signingID = FormatSigningID(csInfo);
+    cd.signingID =
+        FormatSigningID(signingInfo.signingID, signingInfo.teamID, signingInfo.platformBinary);
   }
 
   // Ensure that if no teamID exists but a signingID does exist, that the binary
@@ -593,7 +706,7 @@ static void UpdateCachedDecisionSigningInfo(
     switch (platformBinaryState) {
       case PlatformBinaryState::kRuntimeTrue: break;
       case PlatformBinaryState::kStaticCheck:
-        if (!csInfo.platformBinary) {
+        if (!signingInfo.platformBinary) {
           cd.signingID = nil;
         }
         break;
@@ -602,19 +715,11 @@ static void UpdateCachedDecisionSigningInfo(
     }
   }
 
-  NSDictionary* entitlements = csInfo.entitlements;
-  cd.rawEntitlements = [entitlements sntDeepCopy];
-
-  if (entitlementsFilterCallback) {
-    cd.entitlements = entitlementsFilterCallback(entitlements);
-    cd.entitlementsFiltered = (cd.entitlements.count != entitlements.count);
-  } else {
-    cd.entitlements = cd.rawEntitlements;
-    cd.entitlementsFiltered = NO;
-  }
+  // Copied and filtered only if something reads them.
+  [cd setEntitlementsFromSignature:signingInfo.entitlements filter:entitlementsFilterCallback];
 
-  cd.secureSigningTime = csInfo.secureSigningTime;
-  cd.signingTime = csInfo.signingTime;
+  cd.secureSigningTime = signingInfo.secureSigningTime;
+  cd.signingTime = signingInfo.signingTime;
 }
 
 - (nonnull SNTCachedDecision*)
@@ -622,6 +727,7 @@ static void UpdateCachedDecisionSigningInfo(
                    configState:(nonnull SNTConfigState*)configState
                 cachedDecision:(nonnull SNTCachedDecision*)cd
            platformBinaryState:(PlatformBinaryState)platformBinaryState
+                   deferSHA256:(BOOL)deferSHA256
          signingStatusCallback:(SNTSigningStatus (^_Nonnull)())signingStatusCallback
             activationCallback:(nullable ActivationCallbackBlock)activationCallback
     entitlementsFilterCallback:
@@ -635,7 +741,7 @@ static void UpdateCachedDecisionSigningInfo(
     return systemCd;
   }
 
-  if (!cd.sha256) {
+  if (!cd.sha256 && !deferSHA256) {
     cd.sha256 = fileInfo.SHA256;
   }
   cd.signingStatus = signingStatusCallback();
@@ -645,20 +751,32 @@ static void UpdateCachedDecisionSigningInfo(
 
   NSError* csInfoError;
   if (!cd.certSHA256.length) {
-    // Grab the code signature, if there's an error don't try to capture
-    // any of the signature details.
-    // TODO(mlw): MOLCodesignChecker should be updated to still grab signing information
-    // even if validity check fails. Once that is done, this code can be updated to grab
-    // cert information so that it can still be reported to the sync server.
-    MOLCodesignChecker* csInfo = [fileInfo codesignCheckerWithError:&csInfoError];
-    if (csInfoError) {
-      csInfo = nil;
-      cd.decisionExtra = [NSString
-          stringWithFormat:@"Signature ignored due to error: %ld", (long)csInfoError.code];
-      cd.signingStatus = (cd.signingStatus == SNTSigningStatusUnsigned ? SNTSigningStatusUnsigned
-                                                                       : SNTSigningStatusInvalid);
-    } else {
-      UpdateCachedDecisionSigningInfo(cd, csInfo, platformBinaryState, entitlementsFilterCallback);
+    // The cdhash is only set when the kernel enforces it for the executing
+    // binary, in which case any binary with the same cdhash has the same
+    // signature and it doesn't need to be validated again.
+    SNTSigningInfoCache* signingInfoCache = [SNTSigningInfoCache sharedCache];
+    SNTSigningInfo* signingInfo = [signingInfoCache signingInfoForCDHash:cd.cdhash];
+    if (!signingInfo) {
+      // Grab the code signature, if there's an error don't try to capture
+      // any of the signature details.
+      // TODO(mlw): MOLCodesignChecker should be updated to still grab signing information
+      // even if validity check fails. Once that is done, this code can be updated to grab
+      // cert information so that it can still be reported to the sync server.
+      MOLCodesignChecker* csInfo = [fileInfo codesignCheckerWithError:&csInfoError];
+      if (csInfoError) {
+        cd.decisionExtra = [NSString
+            stringWithFormat:@"Signature ignored due to error: %ld", (long)csInfoError.code];
+        cd.signingStatus =
+            (cd.signingStatus == SNTSigningStatusUnsigned ? SNTSigningStatusUnsigned
+                                                          : SNTSigningStatusInvalid);
+      } else {
+        signingInfo = [signingInfoCache addCodesignChecker:csInfo]
+                          ?: [[SNTSigningInfo alloc] initWithCodesignChecker:csInfo];
+      }
+    }
+    if (signingInfo) {
+      UpdateCachedDecisionSigningInfo(cd, signingInfo, platformBinaryState,
+                                      entitlementsFilterCallback);
     }
   }
 
@@ -713,16 +831,56 @@ static void UpdateCachedDecisionSigningInfo(
   }
 }
 
+- (nullable SNTCachedDecision*)
+    criticalSystemBinaryDecisionForProcess:(nonnull const es_process_t*)targetProc
+                               configState:(nonnull SNTConfigState*)configState {
+  if (!santa::CdhashStrictlyEnforced(targetProc->codesigning_flags)) {
+    return nil;
+  }
+
+  // Critical system binaries are validated when the rule table first builds
+  // them, so a process the kernel holds to the same CDHash needs no checks.
+  NSString* cdhash =
+      santa::StringToNSString(santa::BufToHexString(targetProc->cdhash, CS_CDHASH_LEN));
+  SNTCachedDecision* systemCd = [self.ruleTable.criticalSystemBinariesByCDHash[cdhash] copy];
+  systemCd.decisionClientMode = configState.clientMode;
+  return systemCd;
+}
+
+// Whether the decision for a binary can be made without its SHA-256. Rules are
+// then matched by CDHash, signing ID, certificate and team ID only, so the
+// kernel must enforce the CDHash and no binary rule may exist.
+- (BOOL)canDeferSHA256ForDecision:(SNTCachedDecision*)cd {
+  return cd.cdhash.length && [self canDeferSHA256ForCDHashEnforcedBinaries];
+}
+
+- (BOOL)canDeferSHA256ForCDHashEnforcedBinaries {
+  SNTConfigurator* config = self.configurator;
+  return config.enableLazyBinaryHashing && !config.enableTransitiveRules &&
+         !config.enableAllEventUpload && ![self.ruleTable hasBinaryRules];
+}
+
+// Whether the execution controller will store or act on an event for the
+// decision, all of which identify the binary by its SHA-256. This mirrors the
+// checks made in SNTExecutionController.
+- (BOOL)decisionRequiresSHA256:(SNTCachedDecision*)cd {
+  return cd.holdAndAsk || cd.auditReturn || (cd.decision & SNTEventStateAllow) == 0 ||
+         (cd.decision == SNTEventStateAllowUnknown &&
+          !self.configurator.disableUnknownEventUpload);
+}
+
 - (nonnull SNTCachedDecision*)decisionForFileInfo:(nonnull SNTFileInfo*)fileInfo
                                     targetProcess:(nonnull const es_process_t*)targetProc
                                       configState:(nonnull SNTConfigState*)configState
                                activationCallback:
                                    (nullable ActivationCallbackBlock)activationCallback
                                    cachedDecision:(nullable SNTCachedDecision*)existingDecision {
+  santa::ExecTrace::Span span(santa::ExecTraceStage::kPolicy);
   PlatformBinaryState pbs = targetProc->is_platform_binary ? PlatformBinaryState::kRuntimeTrue
                                                            : PlatformBinaryState::kRuntimeFalse;
 
-  const char* entitlementsFilterTeamID = NULL;
+  // Owned copies, as the entitlements filter can run after the message is gone.
+  NSString* entitlementsFilterTeamID;
   SNTCachedDecision* cd;
 
   if (existingDecision) {
@@ -732,9 +890,9 @@ static void UpdateCachedDecisionSigningInfo(
     // (CS_SIGNED, CS_VALID, signing_id exists, team_id exists), so a non-nil
     // teamID implies all those conditions were satisfied.
     if (cd.teamID.length) {
-      entitlementsFilterTeamID = cd.teamID.UTF8String;
+      entitlementsFilterTeamID = cd.teamID;
     } else if (targetProc->is_platform_binary) {
-      entitlementsFilterTeamID = "platform";
+      entitlementsFilterTeamID = @"platform";
     }
   } else {
     cd = [[SNTCachedDecision alloc] init];
@@ -742,13 +900,13 @@ static void UpdateCachedDecisionSigningInfo(
     if (targetProc->codesigning_flags & CS_SIGNED && targetProc->codesigning_flags & CS_VALID) {
       if (targetProc->signing_id.length > 0) {
         if (targetProc->team_id.length > 0) {
-          entitlementsFilterTeamID = targetProc->team_id.data;
           cd.teamID = santa::StringTokenToNSString(targetProc->team_id);
+          entitlementsFilterTeamID = cd.teamID;
           cd.signingID =
               [NSString stringWithFormat:@"%@:%@", cd.teamID,
                                          santa::StringTokenToNSString(targetProc->signing_id)];
         } else if (targetProc->is_platform_binary) {
-          entitlementsFilterTeamID = "platform";
+          entitlementsFilterTeamID = @"platform";
           cd.signingID =
               [NSString stringWithFormat:@"platform:%@",
                                          santa::StringTokenToNSString(targetProc->signing_id)];
@@ -771,10 +929,14 @@ static void UpdateCachedDecisionSigningInfo(
     }
   }
 
-  return [self decisionForFileInfo:fileInfo
+  BOOL deferSHA256 = !cd.sha256 && [self canDeferSHA256ForDecision:cd];
+
+  std::shared_ptr<santa::EntitlementsFilter> entitlementsFilter = entitlementsFilter_;
+  SNTCachedDecision* decision = [self decisionForFileInfo:fileInfo
       configState:configState
       cachedDecision:cd
       platformBinaryState:pbs
+      deferSHA256:deferSHA256
       signingStatusCallback:^SNTSigningStatus {
         uint32_t csFlags = targetProc->codesigning_flags;
         if ((csFlags & CS_SIGNED) == 0) {
@@ -791,8 +953,13 @@ static void UpdateCachedDecisionSigningInfo(
       }
       activationCallback:activationCallback
       entitlementsFilterCallback:^NSDictionary*(NSDictionary* entitlements) {
-        return entitlementsFilter_->Filter(entitlementsFilterTeamID, entitlements);
+        return entitlementsFilter->Filter(entitlementsFilterTeamID.UTF8String, entitlements);
       }];
+
+  if (!decision.sha256 && deferSHA256 && [self decisionRequiresSHA256:decision]) {
+    decision.sha256 = fileInfo.SHA256;
+  }
+  return decision;
 }
 
 ///
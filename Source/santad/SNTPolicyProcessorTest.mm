@@ -1048,6 +1048,89 @@ BOOL RuleIdentifiersAreEqual(struct RuleIdentifiers r1, struct RuleIdentifiers r
   XCTAssertEqual(cd1.decision, cd2.decision);
 }
 
+// A cacheable CEL result is reused for later executions of the same binary,
+// while results that depended on per-exec inputs are always re-evaluated.
+- (void)testDBCELRuleResultCachedPerBinary {
+  __block int entitlementsCalls = 0;
+  __block int argsCalls = 0;
+  ActivationCallbackBlock activation =
+      ^std::unique_ptr<::google::api::expr::runtime::BaseActivation>(bool useV2) {
+    using AncestorT = santa::cel::CELProtoTraits<true>::AncestorT;
+    using FileDescriptorT = santa::cel::CELProtoTraits<true>::FileDescriptorT;
+    auto ef = std::make_unique<santa::cel::CELProtoTraits<true>::ExecutableFileT>();
+    auto a = std::make_unique<santa::cel::Activation<true>>(
+        std::move(ef),
+        ^std::vector<std::string>() {
+          argsCalls++;
+          return std::vector<std::string>{"arg1"};
+        },
+        ^std::map<std::string, std::string>() {
+          return {};
+        },
+        ^uid_t() {
+          return 0;
+        },
+        ^std::string() {
+          return "/";
+        },
+        ^std::string() {
+          return "/usr/bin/test";
+        },
+        ^std::vector<AncestorT>() {
+          return {};
+        },
+        ^std::vector<FileDescriptorT>() {
+          return {};
+        });
+    a->SetLazyEntitlements(^std::map<std::string, std::string>() {
+      entitlementsCalls++;
+      return {{"com.apple.security.get-task-allow", "true"}};
+    });
+    return a;
+  };
+
+  SNTRule* (^createCELRule)(NSString*) = ^SNTRule*(NSString* celExpr) {
+    return [[SNTRule alloc]
+        initWithIdentifier:@"1234567890abcdef1234567890abcdef1234567890abcdef1234567890abcdef"
+                     state:SNTRuleStateCELv2
+                      type:SNTRuleTypeBinary
+                 customMsg:nil
+                 customURL:nil
+                 timestamp:0
+                   comment:nil
+                   celExpr:celExpr
+            seatbeltPolicy:nil
+                    ruleId:0
+                     error:NULL];
+  };
+
+  SNTCachedDecision* (^evaluate)(SNTRule*, NSString*) = ^(SNTRule* r, NSString* sha256) {
+    SNTCachedDecision* cd = [[SNTCachedDecision alloc] init];
+    cd.sha256 = sha256;
+    [self.processor decision:cd
+                         forRule:r
+             withTransitiveRules:YES
+        andCELActivationCallback:activation];
+    return cd;
+  };
+
+  SNTRule* r = createCELRule(
+      @"'com.apple.security.get-task-allow' in target.entitlements ? BLOCKLIST : ALLOWLIST");
+  XCTAssertEqual(evaluate(r, @"aa").decision, SNTEventStateBlockBinary);
+  XCTAssertEqual(evaluate(r, @"aa").decision, SNTEventStateBlockBinary);
+  XCTAssertEqual(entitlementsCalls, 1);
+
+  // A different binary is evaluated on its own.
+  XCTAssertEqual(evaluate(r, @"bb").decision, SNTEventStateBlockBinary);
+  XCTAssertEqual(entitlementsCalls, 2);
+
+  // Reading args makes the result non-cacheable.
+  r = createCELRule(@"'arg1' in args ? BLOCKLIST : ALLOWLIST");
+  XCTAssertEqual(evaluate(r, @"aa").decision, SNTEventStateBlockBinary);
+  XCTAssertEqual(evaluate(r, @"aa").decision, SNTEventStateBlockBinary);
+  XCTAssertEqual(argsCalls, 2);
+}
+
 - (void)testCELAncestors {
   using AncestorT = santa::cel::CELProtoTraits<true>::AncestorT;
 
@@ -1697,6 +1780,57 @@ BOOL RuleIdentifiersAreEqual(struct RuleIdentifiers r1, struct RuleIdentifiers r
   XCTAssertNotEqualObjects(cd.decisionExtra, @"Platform Binary");
 }
 
+- (SNTCachedDecision*)lazilyHashedDecisionForFileInfo:(SNTFileInfo*)fi
+                                      platformBinary:(BOOL)isPlatformBinary {
+  id mockRuleTable = OCMClassMock([SNTRuleTable class]);
+  OCMStub([mockRuleTable hasBinaryRules]).andReturn(NO);
+  SNTPolicyProcessor* processor =
+      [[SNTPolicyProcessor alloc] initWithRuleTable:mockRuleTable
+                                 entitlementsFilter:santa::EntitlementsFilter::Create(@[], @[])];
+
+  id mockConfigurator = OCMClassMock([SNTConfigurator class]);
+  OCMStub([mockConfigurator enableLazyBinaryHashing]).andReturn(YES);
+  OCMStub([mockConfigurator clientMode]).andReturn(SNTClientModeMonitor);
+  processor.configurator = mockConfigurator;
+
+  es_file_t file = MakeESFile("/bin/ls");
+  es_process_t proc = MakeESProcess(&file);
+  proc.is_platform_binary = isPlatformBinary;
+  proc.codesigning_flags = CS_SIGNED | CS_VALID | CS_HARD | CS_KILL;
+  memset(proc.cdhash, 0xab, sizeof(proc.cdhash));
+
+  SNTConfigState* configState = [[SNTConfigState alloc] initWithConfig:mockConfigurator];
+  SNTCachedDecision* cd = [processor decisionForFileInfo:fi
+                                           targetProcess:&proc
+                                             configState:configState
+                                      activationCallback:nil
+                                          cachedDecision:nil];
+  [mockConfigurator stopMocking];
+  return cd;
+}
+
+- (void)testLazyBinaryHashingSkipsSHA256WhenUnneeded {
+  SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:@"/bin/ls"];
+  XCTAssertNotNil(fi);
+  id mockFileInfo = OCMPartialMock(fi);
+  OCMReject([mockFileInfo SHA256]);
+
+  SNTCachedDecision* cd = [self lazilyHashedDecisionForFileInfo:mockFileInfo platformBinary:YES];
+  XCTAssertEqual(cd.decision, SNTEventStateAllowPlatform);
+  XCTAssertNil(cd.sha256);
+  OCMVerifyAll(mockFileInfo);
+}
+
+- (void)testLazyBinaryHashingComputesSHA256ForStoredEvents {
+  // Unknown binaries in monitor mode are uploaded, so they still need a hash.
+  SNTFileInfo* fi = [[SNTFileInfo alloc] initWithPath:@"/bin/ls"];
+  XCTAssertNotNil(fi);
+
+  SNTCachedDecision* cd = [self lazilyHashedDecisionForFileInfo:fi platformBinary:NO];
+  XCTAssertEqual(cd.decision, SNTEventStateAllowUnknown);
+  XCTAssertEqualObjects(cd.sha256, fi.SHA256);
+}
+
 #pragma mark fileIsScopeAllowed:/fileIsScopeBlocked:
 
 // /bin/ls is an Apple-signed Mach-O executable (with a __PAGEZERO segment)
@@ -30,6 +30,8 @@
 - (void)reassessSyncServiceConnection;
 - (void)reassessSyncServiceConnectionImmediately;
 
+/// Events are coalesced for a short window, deduplicated and handed to the sync service as a
+/// single batch. Holds and blocks flush the batch immediately and are sorted to the front.
 - (void)addStoredEvent:(SNTStoredEvent*)event;
 - (void)addBundleEvents:(NSArray<SNTStoredExecutionEvent*>*)events
          withBundleHash:(NSString*)bundleHash;
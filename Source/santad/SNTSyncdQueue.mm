@@ -24,6 +24,7 @@
 #import "Source/common/SNTStoredFileAccessEvent.h"
 #import "Source/common/SNTXPCSyncServiceInterface.h"
 #include "Source/common/SantaCache.h"
+#include "Source/common/StoredEventEncoding.h"
 #include "Source/common/String.h"
 
 @interface SNTSyncdQueue ()
@@ -33,15 +34,32 @@
 @property NSURL* previousSyncBaseURL;
 @end
 
+// Events are held for up to this long so that bursts, e.g. all of the events
+// for a bundle, are handed to the sync service as one batch.
+static const int64_t kEventCoalesceWindowMS = 1000;
+
+// Once this many events are pending they are flushed without waiting for the
+// window to close.
+static const NSUInteger kMaxPendingEvents = 256;
+
 @implementation SNTSyncdQueue {
   // TODO(https://github.com/northpolesec/santa/issues/344): Eventually replace with an LRU.
   std::unique_ptr<SantaCache<std::string, NSDate*>> _uploadBackoff;
+
+  // Only accessed on the syncdQueue.
+  NSMutableArray<SNTStoredEvent*>* _pendingEvents;
+  NSMutableSet<NSString*>* _pendingEventIDs;
+  NSMutableSet<NSString*>* _pendingBackoffKeys;
+  BOOL _pendingFlushScheduled;
 }
 
 - (instancetype)initWithCacheSize:(uint64_t)cacheSize {
   self = [super init];
   if (self) {
     _uploadBackoff = std::make_unique<SantaCache<std::string, NSDate*>>(cacheSize);
+    _pendingEvents = [NSMutableArray array];
+    _pendingEventIDs = [NSMutableSet set];
+    _pendingBackoffKeys = [NSMutableSet set];
     _syncdQueue = dispatch_queue_create("com.northpolesec.syncd_queue",
                                         DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
   }
@@ -173,16 +191,93 @@
   }
 
   [self dispatchBlockOnSyncdQueue:^{
-    [self.syncConnection.remoteObjectProxy
-        postEventsToSyncServer:events
-                         reply:^(BOOL success) {
-                           if (!success) {
-                             _uploadBackoff->remove(santa::NSStringToUTF8String(backoffHashKey));
-                           }
-                         }];
+    [self addPendingEventsSerialized:events withBackoffHashKey:backoffHashKey];
   }];
 }
 
+// Events the user is waiting on, holds and blocks, are flushed right away and
+// sorted ahead of everything else in the batch.
++ (BOOL)isPriorityEvent:(SNTStoredEvent*)event {
+  if (![event isKindOfClass:[SNTStoredExecutionEvent class]]) {
+    return NO;
+  }
+  SNTStoredExecutionEvent* se = (SNTStoredExecutionEvent*)event;
+  return se.holdAndAsk || (se.decision & SNTEventStateBlock);
+}
+
+- (void)addPendingEventsSerialized:(NSArray<SNTStoredEvent*>*)events
+                withBackoffHashKey:(NSString*)backoffHashKey {
+  BOOL flushNow = NO;
+  for (SNTStoredEvent* event in events) {
+    // Bundle events and repeated blocks of the same binary within a window
+    // only need to be uploaded once.
+    NSString* uniqueID = [event uniqueID];
+    if (uniqueID) {
+      if ([_pendingEventIDs containsObject:uniqueID]) continue;
+      [_pendingEventIDs addObject:uniqueID];
+    }
+    [_pendingEvents addObject:event];
+    flushNow |= [[self class] isPriorityEvent:event];
+  }
+  if (backoffHashKey) [_pendingBackoffKeys addObject:backoffHashKey];
+
+  if (flushNow || _pendingEvents.count >= kMaxPendingEvents) {
+    [self flushPendingEventsSerialized];
+  } else if (_pendingEvents.count && !_pendingFlushScheduled) {
+    _pendingFlushScheduled = YES;
+    WEAKIFY(self);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kEventCoalesceWindowMS * NSEC_PER_MSEC),
+                   self.syncdQueue, ^{
+                     STRONGIFY(self);
+                     [self flushPendingEventsSerialized];
+                   });
+  }
+}
+
+- (void)flushPendingEventsSerialized {
+  _pendingFlushScheduled = NO;
+  if (!_pendingEvents.count) return;
+
+  NSArray<SNTStoredEvent*>* events = [_pendingEvents
+      sortedArrayWithOptions:NSSortStable
+             usingComparator:^NSComparisonResult(SNTStoredEvent* a, SNTStoredEvent* b) {
+               BOOL aPriority = [SNTSyncdQueue isPriorityEvent:a];
+               BOOL bPriority = [SNTSyncdQueue isPriorityEvent:b];
+               if (aPriority == bPriority) return NSOrderedSame;
+               return aPriority ? NSOrderedAscending : NSOrderedDescending;
+             }];
+  NSSet<NSString*>* backoffKeys = [_pendingBackoffKeys copy];
+  [_pendingEvents removeAllObjects];
+  [_pendingEventIDs removeAllObjects];
+  [_pendingBackoffKeys removeAllObjects];
+
+  WEAKIFY(self);
+  void (^reply)(BOOL) = ^(BOOL success) {
+    STRONGIFY(self);
+    if (!self || success) return;
+    for (NSString* key in backoffKeys) {
+      self->_uploadBackoff->remove(santa::NSStringToUTF8String(key));
+    }
+  };
+
+  // Events are sent as a StoredEventBatch where possible, which holds each
+  // certificate once rather than archiving it with every event. Batches with
+  // events that have no protobuf encoding are archived instead.
+  NSData* encodedEvents = santa::EncodeStoredEventBatch(events);
+  if (encodedEvents) {
+    [self.syncConnection.remoteObjectProxy postEncodedEventsToSyncServer:encodedEvents
+                                                                   reply:reply];
+  } else {
+    [self.syncConnection.remoteObjectProxy postEventsToSyncServer:events reply:reply];
+  }
+}
+
+- (void)flushPendingEvents {
+  dispatch_sync(self.syncdQueue, ^{
+    [self flushPendingEventsSerialized];
+  });
+}
+
 - (void)addBundleEvent:(SNTStoredExecutionEvent*)event reply:(void (^)(SNTBundleEventAction))reply {
   if ([self backoffForPrimaryHash:event.fileBundleHash]) return;
   [self dispatchBlockOnSyncdQueue:^{
@@ -21,7 +21,9 @@
 #import "Source/common/MOLXPCConnection.h"
 #import "Source/common/SNTStoredExecutionEvent.h"
 #import "Source/common/SNTStoredFileAccessEvent.h"
+#import "Source/common/SNTStoredTemporaryMonitorModeAuditEvent.h"
 #import "Source/common/SNTXPCSyncServiceInterface.h"
+#include "Source/common/StoredEventEncoding.h"
 
 @interface SNTSyncdQueue (Testing)
 @property dispatch_queue_t syncdQueue;
@@ -29,6 +31,7 @@
 
 - (BOOL)backoffForPrimaryHash:(NSString*)hash;
 - (void)dispatchBlockOnSyncdQueue:(void (^)(void))block;
+- (void)flushPendingEvents;
 @end
 
 @interface SNTSyncdQueueTest : XCTestCase
@@ -123,45 +126,111 @@
 
   // First attempt: Post event, capture the reply block but don't invoke it yet
   __block void (^replyBlock)(BOOL) = nil;
-  OCMStub([mockProxy postEventsToSyncServer:[OCMArg any]
-                                      reply:[OCMArg checkWithBlock:^BOOL(id obj) {
-                                        replyBlock = obj;
-                                        return YES;
-                                      }]]);
+  OCMStub([mockProxy postEncodedEventsToSyncServer:[OCMArg any]
+                                             reply:[OCMArg checkWithBlock:^BOOL(id obj) {
+                                               replyBlock = obj;
+                                               return YES;
+                                             }]]);
   [sut addStoredEvent:se];
-  dispatch_sync(sut.syncdQueue, ^{
-                });
-  OCMVerify(times(1), [mockProxy postEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+  [sut flushPendingEvents];
+  OCMVerify(times(1), [mockProxy postEncodedEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
 
   // Second attempt: Event should be dropped due to backoff
   [sut addStoredEvent:se];
-  dispatch_sync(sut.syncdQueue, ^{
-                });
-  OCMVerify(times(1), [mockProxy postEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+  [sut flushPendingEvents];
+  OCMVerify(times(1), [mockProxy postEncodedEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
 
   // Simulate the first upload failing, which should remove the backoff
   replyBlock(NO);
 
   // Third attempt: Since backoff was removed, event should be dispatched again
   [sut addStoredEvent:se];
-  dispatch_sync(sut.syncdQueue, ^{
-                });
-  OCMVerify(times(2), [mockProxy postEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+  [sut flushPendingEvents];
+  OCMVerify(times(2), [mockProxy postEncodedEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
 
   // Fourth attempt: Event should be dropped due to backoff
   [sut addStoredEvent:se];
-  dispatch_sync(sut.syncdQueue, ^{
-                });
-  OCMVerify(times(2), [mockProxy postEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+  [sut flushPendingEvents];
+  OCMVerify(times(2), [mockProxy postEncodedEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
 
   // Now simulate the second upload succeeding, which should keep the backoff
   replyBlock(YES);
 
   // Fifth attempt: Event should still be dropped due to backoff (success keeps backoff)
   [sut addStoredEvent:se];
+  [sut flushPendingEvents];
+  OCMVerify(times(2), [mockProxy postEncodedEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+}
+
+- (void)testEventsWithoutProtobufEncodingAreArchived {
+  SNTSyncdQueue* sut = [[SNTSyncdQueue alloc] initWithCacheSize:1024];
+
+  id mockConnection = OCMClassMock([MOLXPCConnection class]);
+  id mockProxy = OCMProtocolMock(@protocol(SNTSyncServiceXPC));
+  OCMStub([mockConnection remoteObjectProxy]).andReturn(mockProxy);
+  OCMStub([mockConnection isConnected]).andReturn(YES);
+  sut.syncConnection = mockConnection;
+
+  SNTStoredExecutionEvent* se = [[SNTStoredExecutionEvent alloc] init];
+  se.fileSHA256 = @"abc123";
+  [sut addStoredEvent:se];
+  [sut addStoredEvent:[[SNTStoredTemporaryMonitorModeLeaveAuditEvent alloc]
+                          initWithUUID:@"uuid"
+                                reason:SNTTemporaryMonitorModeLeaveReasonCancelled]];
+  [sut flushPendingEvents];
+
+  OCMVerify(times(1), [mockProxy postEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+  OCMVerify(never(), [mockProxy postEncodedEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+}
+
+- (void)testAddEventsCoalescesAndPrioritizes {
+  SNTSyncdQueue* sut = [[SNTSyncdQueue alloc] initWithCacheSize:1024];
+
+  id mockConnection = OCMClassMock([MOLXPCConnection class]);
+  id mockProxy = OCMProtocolMock(@protocol(SNTSyncServiceXPC));
+  OCMStub([mockConnection remoteObjectProxy]).andReturn(mockProxy);
+  OCMStub([mockConnection isConnected]).andReturn(YES);
+  sut.syncConnection = mockConnection;
+
+  __block NSArray<SNTStoredEvent*>* posted;
+  OCMStub([mockProxy postEncodedEventsToSyncServer:[OCMArg checkWithBlock:^BOOL(id obj) {
+                       posted = santa::DecodeStoredEventBatch(obj);
+                       return YES;
+                     }]
+                                             reply:[OCMArg any]]);
+
+  SNTStoredExecutionEvent* (^makeEvent)(NSString*) = ^(NSString* sha) {
+    SNTStoredExecutionEvent* se = [[SNTStoredExecutionEvent alloc] init];
+    se.fileSHA256 = sha;
+    se.decision = SNTEventStateAllowUnknown;
+    return se;
+  };
+
+  SNTStoredExecutionEvent* bundleEvent1 = makeEvent(@"a");
+  SNTStoredExecutionEvent* bundleEvent2 = makeEvent(@"b");
+  SNTStoredExecutionEvent* allowed = makeEvent(@"c");
+
+  // Events within the window are held and the duplicate dropped
+  [sut addBundleEvents:@[ bundleEvent1, bundleEvent2, makeEvent(@"a") ] withBundleHash:@"bundle"];
+  [sut addStoredEvent:allowed];
   dispatch_sync(sut.syncdQueue, ^{
                 });
-  OCMVerify(times(2), [mockProxy postEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+  OCMVerify(never(), [mockProxy postEncodedEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+
+  // A block flushes the whole batch immediately, ahead of the other events
+  SNTStoredExecutionEvent* blocked = makeEvent(@"d");
+  blocked.decision = SNTEventStateBlockUnknown;
+  [sut addStoredEvent:blocked];
+  dispatch_sync(sut.syncdQueue, ^{
+                });
+  OCMVerify(times(1), [mockProxy postEncodedEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
+
+  NSArray* want = @[ blocked, bundleEvent1, bundleEvent2, allowed ];
+  XCTAssertEqualObjects(posted, want);
+
+  // Nothing is left pending
+  [sut flushPendingEvents];
+  OCMVerify(times(1), [mockProxy postEncodedEventsToSyncServer:[OCMArg any] reply:[OCMArg any]]);
 }
 
 @end
@@ -20,13 +20,17 @@
 #include <bsm/libbsm.h>
 
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <optional>
-#include <string>
 #include <utility>
+#include <vector>
 
+#include "Source/common/Digest.h"
+#include "Source/common/TimerWheel.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 
@@ -34,6 +38,14 @@
 
 namespace santa {
 
+// Expectations registered by santactl sandbox for execs that are about to
+// happen, consumed by the AUTH_EXEC handler.
+//
+// Entries are spread over a few shards with their own locks, so concurrent
+// sandboxed launches mostly don't contend, and Consume only takes the lock of
+// the shard holding its entry and never allocates. Expiry is tracked in a
+// timer wheel that Register advances, so reclaiming stranded entries costs a
+// constant amount per entry instead of a scan of the whole table.
 class SandboxExpectations {
  public:
   static constexpr size_t kMaxEntries = 128;
@@ -49,7 +61,9 @@ class SandboxExpectations {
     uint64_t dev = 0;
     uint64_t ino = 0;
     std::array<uint8_t, CS_CDHASH_LEN> cdhash{};
-    std::string sha256;
+    // std::nullopt if the request had no SHA-256, or one that isn't lowercase
+    // hex, so the fallback (dev, ino, sha256) check can never match.
+    std::optional<SHA256Digest> sha256;
     uint64_t created_at_ns = 0;
   };
 
@@ -84,12 +98,44 @@ class SandboxExpectations {
   size_t CountForTesting();
 
  private:
+  static constexpr size_t kShards = 8;
+  // Expiry is tracked to the millisecond, and checked exactly when an entry's
+  // tick comes up.
+  static constexpr uint64_t kTickNanos = 1000ULL * 1000ULL;
+
+  struct Entry {
+    Expectation expectation;
+    // Distinguishes this registration from earlier ones for the same token,
+    // whose timers may still be pending.
+    uint64_t serial = 0;
+  };
+
+  struct Timer {
+    uint64_t key;
+    uint64_t serial;
+  };
+
+  struct alignas(64) Shard {
+    absl::Mutex mu;
+    absl::flat_hash_map<uint64_t, Entry> entries ABSL_GUARDED_BY(mu);
+  };
+
   static uint64_t KeyFromToken(const audit_token_t& token);
-  void SweepExpiredLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Sharded on the pid, which the kernel hands out sequentially.
+  Shard& ShardForKey(uint64_t key) { return shards_[(key & 0xFFFFFFFFULL) % kShards]; }
+  void SweepExpired() ABSL_LOCKS_EXCLUDED(wheel_mu_);
 
   std::function<uint64_t()> clock_;
-  mutable absl::Mutex mu_;
-  absl::flat_hash_map<uint64_t, Expectation> entries_ ABSL_GUARDED_BY(mu_);
+  std::array<Shard, kShards> shards_;
+  // Entries across all shards, reserved before inserting so that concurrent
+  // registrations can't exceed kMaxEntries.
+  std::atomic<size_t> size_ = 0;
+  std::atomic<uint64_t> next_serial_ = 0;
+
+  absl::Mutex wheel_mu_;
+  TimerWheel<Timer> wheel_ ABSL_GUARDED_BY(wheel_mu_);
+  // Timers that fired within a millisecond before their entry expired.
+  std::vector<Timer> almost_due_ ABSL_GUARDED_BY(wheel_mu_);
 };
 
 }  // namespace santa
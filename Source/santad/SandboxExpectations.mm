@@ -17,9 +17,9 @@
 #include <time.h>
 
 #include <cstring>
+#include <vector>
 
 #import "Source/common/SNTSandboxExecRequest.h"
-#include "Source/common/String.h"
 
 namespace santa {
 
@@ -27,12 +27,16 @@ namespace {
 uint64_t DefaultMonotonicNanos() {
   return clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW_APPROX);
 }
+
+bool IsExpired(const SandboxExpectations::Expectation& e, uint64_t now) {
+  return now - e.created_at_ns > SandboxExpectations::kTTLNanos;
+}
 }  // namespace
 
-SandboxExpectations::SandboxExpectations() : clock_(DefaultMonotonicNanos) {}
+SandboxExpectations::SandboxExpectations() : SandboxExpectations(DefaultMonotonicNanos) {}
 
 SandboxExpectations::SandboxExpectations(std::function<uint64_t()> clock)
-    : clock_(std::move(clock)) {}
+    : clock_(std::move(clock)), wheel_(clock_() / kTickNanos) {}
 
 uint64_t SandboxExpectations::KeyFromToken(const audit_token_t& token) {
   uint64_t pid = static_cast<uint64_t>(audit_token_to_pid(token));
@@ -40,15 +44,44 @@ uint64_t SandboxExpectations::KeyFromToken(const audit_token_t& token) {
   return (pidver << 32) | (pid & 0xFFFFFFFFULL);
 }
 
-void SandboxExpectations::SweepExpiredLocked() {
+void SandboxExpectations::SweepExpired() {
   uint64_t now = clock_();
-  absl::erase_if(entries_,
-                 [now](const auto& kv) { return now - kv.second.created_at_ns > kTTLNanos; });
+  std::vector<Timer> due;
+  {
+    absl::MutexLock lock(wheel_mu_);
+    due.swap(almost_due_);
+    wheel_.Advance(now / kTickNanos, due);
+  }
+
+  // Timers fire on the tick their entry expires in, which may be slightly
+  // before it actually does. Those are checked again on the next sweep.
+  std::vector<Timer> not_yet_expired;
+  for (const Timer& timer : due) {
+    Shard& shard = ShardForKey(timer.key);
+    absl::MutexLock lock(shard.mu);
+    auto it = shard.entries.find(timer.key);
+    // Already consumed, possibly followed by a new registration for the same
+    // token with its own timer.
+    if (it == shard.entries.end() || it->second.serial != timer.serial) continue;
+
+    if (IsExpired(it->second.expectation, now)) {
+      shard.entries.erase(it);
+      size_.fetch_sub(1, std::memory_order_relaxed);
+    } else {
+      not_yet_expired.push_back(timer);
+    }
+  }
+
+  if (!not_yet_expired.empty()) {
+    absl::MutexLock lock(wheel_mu_);
+    almost_due_.insert(almost_due_.end(), not_yet_expired.begin(), not_yet_expired.end());
+  }
 }
 
 SandboxExpectations::RegisterResult SandboxExpectations::Register(const audit_token_t& token,
                                                                   SNTSandboxExecRequest* request) {
-  Expectation e;
+  Entry entry;
+  Expectation& e = entry.expectation;
   e.dev = request.fsDev;
   e.ino = request.fsIno;
   // cdhash is copied only for signed binaries (cdhashBytes is exactly
@@ -59,43 +92,55 @@ SandboxExpectations::RegisterResult SandboxExpectations::Register(const audit_to
   if (cdhashBytes.length == CS_CDHASH_LEN) {
     std::memcpy(e.cdhash.data(), cdhashBytes.bytes, CS_CDHASH_LEN);
   }
-  e.sha256 = santa::NSStringToUTF8String(request.identifiers.binarySHA256);
+  e.sha256 = SHA256Digest::FromHex(request.identifiers.binarySHA256);
   e.created_at_ns = clock_();
+  entry.serial = next_serial_.fetch_add(1, std::memory_order_relaxed);
 
-  absl::MutexLock lock(mu_);
-  SweepExpiredLocked();
+  SweepExpired();
 
   uint64_t key = KeyFromToken(token);
-  if (entries_.contains(key)) return RegisterResult::kDuplicate;
-  if (entries_.size() >= kMaxEntries) return RegisterResult::kCapacityExceeded;
+  uint64_t deadline_tick = (e.created_at_ns + kTTLNanos) / kTickNanos;
+  Timer timer{.key = key, .serial = entry.serial};
+  {
+    Shard& shard = ShardForKey(key);
+    absl::MutexLock lock(shard.mu);
+    if (shard.entries.contains(key)) return RegisterResult::kDuplicate;
+    if (size_.fetch_add(1, std::memory_order_relaxed) >= kMaxEntries) {
+      size_.fetch_sub(1, std::memory_order_relaxed);
+      return RegisterResult::kCapacityExceeded;
+    }
+    shard.entries.emplace(key, std::move(entry));
+  }
 
-  entries_.emplace(key, std::move(e));
+  // If the entry is consumed before this runs, its timer finds nothing to
+  // expire when it fires.
+  absl::MutexLock lock(wheel_mu_);
+  wheel_.Schedule(deadline_tick, timer);
   return RegisterResult::kOk;
 }
 
 std::optional<SandboxExpectations::Expectation> SandboxExpectations::Consume(
     const audit_token_t& token) {
   // Consume runs on the AUTH_EXEC hot path and must return quickly. It only
-  // checks TTL on the specific entry being looked up; a stranded-entry
-  // expired under a different key is irrelevant to this request and can
-  // wait for the next Register to be swept.
-  absl::MutexLock lock(mu_);
+  // takes the lock of the entry's shard and checks TTL on that entry. The
+  // entry's timer is left to fire and find nothing, rather than cancelling it
+  // under the wheel lock that every Register also takes.
   uint64_t key = KeyFromToken(token);
-  auto it = entries_.find(key);
-  if (it == entries_.end()) return std::nullopt;
-  if (clock_() - it->second.created_at_ns > kTTLNanos) {
-    entries_.erase(it);
-    return std::nullopt;
-  }
-  Expectation out = std::move(it->second);
-  entries_.erase(it);
+  Shard& shard = ShardForKey(key);
+  absl::MutexLock lock(shard.mu);
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end()) return std::nullopt;
+
+  Expectation out = it->second.expectation;
+  shard.entries.erase(it);
+  size_.fetch_sub(1, std::memory_order_relaxed);
+  if (IsExpired(out, clock_())) return std::nullopt;
   return out;
 }
 
 size_t SandboxExpectations::CountForTesting() {
-  absl::MutexLock lock(mu_);
-  SweepExpiredLocked();
-  return entries_.size();
+  SweepExpired();
+  return size_.load(std::memory_order_relaxed);
 }
 
 }  // namespace santa
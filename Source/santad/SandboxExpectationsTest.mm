@@ -19,12 +19,20 @@
 #include <bsm/libbsm.h>
 #include <string.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "Source/common/AuditUtilities.h"
+#include "Source/common/Digest.h"
 #import "Source/common/SNTSandboxExecRequest.h"
 
 using santa::SandboxExpectations;
 using RegisterResult = santa::SandboxExpectations::RegisterResult;
 
+static NSString* const kSHA256 =
+    @"feedfacefeedfacefeedfacefeedfacefeedfacefeedfacefeedfacefeedface";
+
 // Builds a hex string of |CS_CDHASH_LEN * 2| chars by repeating each nibble of
 // |fill|. Keeps the tests' "single byte fill value" convention readable.
 static NSString* HexCdhashFromFill(uint8_t fill) {
@@ -131,7 +139,7 @@ static SNTSandboxExecRequest* MakeStubRequest(uint64_t dev, uint64_t ino, uint8_
   audit_token_t token = santa::MakeStubAuditToken(77, 1);
 
   SNTRuleIdentifiers* ids =
-      [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:{.binarySHA256 = @"abc"}];
+      [[SNTRuleIdentifiers alloc] initWithRuleIdentifiers:{.binarySHA256 = kSHA256}];
   SNTSandboxExecRequest* r = [[SNTSandboxExecRequest alloc] initWithIdentifiers:ids
                                                                           fsDev:1
                                                                           fsIno:2
@@ -148,8 +156,7 @@ static SNTSandboxExecRequest* MakeStubRequest(uint64_t dev, uint64_t ino, uint8_
   SandboxExpectations exp;
   audit_token_t token = santa::MakeStubAuditToken(1234, 7);
 
-  XCTAssertEqual(exp.Register(token, MakeStubRequest(42, 99, 0xAB, @"feedface")),
-                 RegisterResult::kOk);
+  XCTAssertEqual(exp.Register(token, MakeStubRequest(42, 99, 0xAB, kSHA256)), RegisterResult::kOk);
 
   auto got = exp.Consume(token);
   XCTAssertTrue(got.has_value());
@@ -157,7 +164,7 @@ static SNTSandboxExecRequest* MakeStubRequest(uint64_t dev, uint64_t ino, uint8_
   XCTAssertEqual(got->ino, 99u);
   XCTAssertEqual(got->cdhash[0], 0xAB);
   XCTAssertEqual(got->cdhash[19], 0xAB);
-  XCTAssertEqual(got->sha256, std::string("feedface"));
+  XCTAssertTrue(got->sha256 == santa::SHA256Digest::FromHex(kSHA256));
 }
 
 - (void)testRegisterWithNilSHA256LeavesExpectationSha256Empty {
@@ -170,7 +177,82 @@ static SNTSandboxExecRequest* MakeStubRequest(uint64_t dev, uint64_t ino, uint8_
   XCTAssertTrue(got.has_value());
   XCTAssertEqual(got->dev, 1u);
   XCTAssertEqual(got->ino, 2u);
-  XCTAssertTrue(got->sha256.empty());
+  XCTAssertFalse(got->sha256.has_value());
+}
+
+- (void)testRegisterWithMalformedSHA256LeavesExpectationSha256Empty {
+  SandboxExpectations exp;
+  audit_token_t token = santa::MakeStubAuditToken(5679, 1);
+
+  XCTAssertEqual(exp.Register(token, MakeStubRequest(1, 2, 0xCD, @"feedface")),
+                 RegisterResult::kOk);
+  XCTAssertEqual(exp.Register(santa::MakeStubAuditToken(5680, 1),
+                              MakeStubRequest(1, 2, 0xCD, kSHA256.uppercaseString)),
+                 RegisterResult::kOk);
+
+  XCTAssertFalse(exp.Consume(token)->sha256.has_value());
+  XCTAssertFalse(exp.Consume(santa::MakeStubAuditToken(5680, 1))->sha256.has_value());
+}
+
+- (void)testExpiryOfConsumedEntryDoesNotRemoveNewRegistration {
+  uint64_t now = 0;
+  SandboxExpectations exp([&now] { return now; });
+  audit_token_t token = santa::MakeStubAuditToken(88, 1);
+
+  XCTAssertEqual(exp.Register(token, MakeStubRequest(0, 0, 0x11, nil)), RegisterResult::kOk);
+  XCTAssertTrue(exp.Consume(token).has_value());
+
+  // Register again for the same token just before the first entry's timer
+  // is due, then let it fire.
+  now = SandboxExpectations::kTTLNanos - 1;
+  XCTAssertEqual(exp.Register(token, MakeStubRequest(0, 0, 0x22, nil)), RegisterResult::kOk);
+  now = SandboxExpectations::kTTLNanos + 1;
+  XCTAssertEqual(exp.CountForTesting(), 1u);
+
+  auto got = exp.Consume(token);
+  XCTAssertTrue(got.has_value());
+  XCTAssertEqual(got->cdhash[0], 0x22);
+}
+
+- (void)testEntriesExpireAtTheirExactTTL {
+  uint64_t now = 0;
+  SandboxExpectations exp([&now] { return now; });
+
+  // Registered partway through a millisecond, so the entry's timer comes up
+  // before it has actually expired.
+  now = 500;
+  XCTAssertEqual(exp.Register(santa::MakeStubAuditToken(1, 1), MakeStubRequest(0, 0, 0, nil)),
+                 RegisterResult::kOk);
+
+  now = SandboxExpectations::kTTLNanos + 500;
+  XCTAssertEqual(exp.CountForTesting(), 1u);
+  now += 1;
+  XCTAssertEqual(exp.CountForTesting(), 0u);
+}
+
+- (void)testConcurrentRegistrationsRespectCap {
+  SandboxExpectations exp;
+  const int kThreads = 8;
+  const int kTokensPerThread = SandboxExpectations::kMaxEntries / 2;
+  std::atomic<size_t> registered = 0;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&exp, &registered, t] {
+      for (int i = 0; i < kTokensPerThread; i++) {
+        audit_token_t token = santa::MakeStubAuditToken(20000 + t * kTokensPerThread + i, 1);
+        if (exp.Register(token, MakeStubRequest(0, 0, 0, nil)) == RegisterResult::kOk) {
+          registered++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  XCTAssertEqual(registered.load(), SandboxExpectations::kMaxEntries);
+  XCTAssertEqual(exp.CountForTesting(), SandboxExpectations::kMaxEntries);
 }
 
 @end
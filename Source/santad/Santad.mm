@@ -16,6 +16,8 @@
 #include "Source/santad/Santad.h"
 #include "Source/santad/SandboxExpectations.h"
 
+#include <signal.h>
+
 #include <cstdlib>
 #include <memory>
 
@@ -25,18 +27,23 @@
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTKVOManager.h"
 #import "Source/common/SNTLogging.h"
+#import "Source/common/SNTMetricSet.h"
+#import "Source/common/SNTRule.h"
 #import "Source/common/SNTStoredFileAccessEvent.h"
 #import "Source/common/SNTStoredNetworkMountEvent.h"
 #import "Source/common/SNTStoredUSBMountEvent.h"
 #import "Source/common/SNTXPCNotifierInterface.h"
 #import "Source/common/SNTXPCSyncServiceInterface.h"
+#include "Source/common/SystemResources.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
 #include "Source/common/es/Enricher.h"
 #include "Source/common/faa/WatchItemPolicy.h"
 #include "Source/common/faa/WatchItems.h"
 #include "Source/santad/AdminUserState.h"
+#include "Source/santad/CacheSnapshot.h"
 #include "Source/santad/DaemonConfigBundle.h"
+#include "Source/santad/DatabaseMaintenance.h"
 #import "Source/santad/DataLayer/SNTEventTable.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #include "Source/santad/EventProviders/AuthResultCache.h"
@@ -89,6 +96,7 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                 std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree,
                 std::shared_ptr<santa::EntitlementsFilter> entitlements_filter,
                 std::shared_ptr<santa::SandboxExpectations> sandbox_expectations) {
+  uint64_t start_uptime = GetCurrentUptime();
   SNTConfigurator* configurator = [SNTConfigurator configurator];
 
   std::weak_ptr<Metrics> weak_metrics(metrics);
@@ -113,6 +121,23 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
             auth_result_cache->FlushCache(mode, reason);
             [exec_controller flushTouchIDApprovalCache];
           }
+          flushCacheForRulesBlock:^(NSArray<SNTRule*>* rules) {
+            auth_result_cache->FlushAffectedEntries(
+                [[SNTDecisionCache sharedCache] affectedVnodesPredicateForRules:rules],
+                FlushCacheReason::kRulesChanged);
+            [exec_controller flushTouchIDApprovalCache];
+          }
+          flushCacheEntriesBlock:^uint64_t(std::function<bool(const SantaVnode&)> affected) {
+            uint64_t removed = auth_result_cache->FlushAffectedEntries(
+                affected, FlushCacheReason::kExplicitCommand);
+            [exec_controller flushTouchIDApprovalCache];
+            return removed;
+          }
+          flushBatchBlock:^(void (^changes)(void)) {
+            auth_result_cache->BeginFlushBatch();
+            changes();
+            auth_result_cache->EndFlushBatch();
+          }
           cacheCountBlock:^NSArray<NSNumber*>*() {
             return auth_result_cache->CacheCounts();
           }
@@ -126,7 +151,8 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
               if (reply) reply(NO);
             }
           }
-          binaryUploadController:binary_upload_controller];
+          binaryUploadController:binary_upload_controller
+          processTree:process_tree];
 
   // Watch for the sync server being removed or replaced, and restore any
   // recorded natural admins if that already happened while the daemon was not
@@ -137,10 +163,6 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
   control_connection.exportedObject = dc;
   [control_connection resume];
 
-  if ([configurator exportMetrics]) {
-    metrics->StartPoll();
-  }
-
   SNTEndpointSecurityDeviceManager* device_client = [[SNTEndpointSecurityDeviceManager alloc]
                             initWithESAPI:esapi
                                   metrics:metrics
@@ -182,17 +204,27 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                                               prefixTree:prefix_tree
                                              processTree:process_tree];
 
-  SNTEndpointSecurityAuthorizer* authorizer_client =
-      [[SNTEndpointSecurityAuthorizer alloc] initWithESAPI:esapi
-                                                   metrics:metrics
-                                            execController:exec_controller
-                                        compilerController:compiler_controller
-                                           authResultCache:auth_result_cache
-                                                 ttyWriter:tty_writer
-                                               processTree:process_tree];
+  // AUTH events can be spread over several authorizer clients, each handling
+  // the processes in its own shard.
+  uint32_t authorizer_shard_count = (uint32_t)[configurator authorizerShardCount];
+  NSMutableArray<SNTEndpointSecurityAuthorizer*>* authorizer_clients = [NSMutableArray array];
+  for (uint32_t i = 0; i < authorizer_shard_count; i++) {
+    [authorizer_clients
+        addObject:[[SNTEndpointSecurityAuthorizer alloc] initWithESAPI:esapi
+                                                               metrics:metrics
+                                                        execController:exec_controller
+                                                    compilerController:compiler_controller
+                                                       authResultCache:auth_result_cache
+                                                             ttyWriter:tty_writer
+                                                           processTree:process_tree
+                                                            shardIndex:i
+                                                            shardCount:authorizer_shard_count]];
+  }
+  SNTEndpointSecurityAuthorizer* authorizer_client = authorizer_clients.firstObject;
 
   // While any client could be used, this implementation chooses to use the
   // authorizer client as it is most concerned with the state of ES caches.
+  // Clearing the ES cache from one client clears it for all of them.
   auth_result_cache->SetESClient(authorizer_client);
 
   SNTEndpointSecurityTamperResistance* tamper_client = [[SNTEndpointSecurityTamperResistance alloc]
@@ -222,15 +254,15 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
 
   SNTEndpointSecurityDataFileAccessAuthorizer* data_faa_client =
       [[SNTEndpointSecurityDataFileAccessAuthorizer alloc]
-                        initWithESAPI:esapi
-                              metrics:metrics
-                               logger:logger
-                             enricher:enricher
-                   faaPolicyProcessor:std::make_shared<santa::DataFAAPolicyProcessorProxy>(
-                                          faaPolicyProcessor)
-                            ttyWriter:tty_writer
-          findPoliciesForTargetsBlock:^(santa::IterateTargetsBlock iterateBlock) {
-            watch_items->FindPoliciesForTargets(iterateBlock);
+                      initWithESAPI:esapi
+                            metrics:metrics
+                             logger:logger
+                           enricher:enricher
+                 faaPolicyProcessor:std::make_shared<santa::DataFAAPolicyProcessorProxy>(
+                                        faaPolicyProcessor)
+                          ttyWriter:tty_writer
+          findPoliciesForPathsBlock:^(const std::vector<std::string_view>& paths) {
+            return watch_items->FindPoliciesForPaths(paths);
           }];
 
   watch_items->RegisterDataWatchItemsUpdatedCallback(
@@ -259,6 +291,10 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                                           faaPolicyProcessor)
           iterateProcessPoliciesBlock:^(santa::CheckPolicyBlock checkPolicyBlock) {
             watch_items->IterateProcessPolicies(checkPolicyBlock);
+          }
+          iterateCandidatePoliciesBlock:^(const santa::ProcessPolicyLookupKeys& keys,
+                                          santa::CheckPolicyBlock checkPolicyBlock) {
+            watch_items->IterateCandidateProcessPolicies(keys, checkPolicyBlock);
           }];
 
   watch_items->RegisterProcWatchItemsUpdatedCallback(^(size_t count) {
@@ -277,8 +313,10 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                             configState:cs];
   };
 
-  [authorizer_client registerAuthExecProbe:proc_faa_client];
-  [authorizer_client registerAuthExecProbe:data_faa_client];
+  for (SNTEndpointSecurityAuthorizer* client in authorizer_clients) {
+    [client registerAuthExecProbe:proc_faa_client];
+    [client registerAuthExecProbe:data_faa_client];
+  }
 
   [syncd_queue reassessSyncServiceConnectionImmediately];
 
@@ -604,6 +642,48 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
                 LOGI(@"Telemetry changed: %@ -> %@", [oldValue componentsJoinedByString:@","],
                      [newValue componentsJoinedByString:@","]);
                 logger->SetTelemetryMask(santa::TelemetryConfigToBitmask(newValue));
+                [monitor_client updateEventFilter];
+              }],
+    [[SNTKVOManager alloc]
+        initWithObject:configurator
+              selector:@selector(fileChangesRegex)
+                  type:[NSRegularExpression class]
+              callback:^(NSRegularExpression* oldValue, NSRegularExpression* newValue) {
+                // Only whether a regex is set affects which events are delivered
+                if (!oldValue == !newValue) {
+                  return;
+                }
+
+                LOGI(@"FileChangesRegex %@", newValue ? @"set" : @"removed");
+                [monitor_client updateEventFilter];
+              }],
+    [[SNTKVOManager alloc]
+        initWithObject:configurator
+              selector:@selector(telemetrySampleRates)
+                  type:[NSDictionary class]
+              callback:^(NSDictionary* oldValue, NSDictionary* newValue) {
+                if ((!oldValue && !newValue) || [oldValue isEqualToDictionary:newValue]) {
+                  return;
+                }
+
+                LOGI(@"TelemetrySampleRates changed: %@ -> %@", oldValue, newValue);
+                // Get the value from the configurator since it ensures proper types
+                logger->SetTelemetrySampleRates([configurator telemetrySampleRates]);
+              }],
+    [[SNTKVOManager alloc]
+        initWithObject:configurator
+              selector:@selector(telemetryAggregatedEvents)
+                  type:[NSArray class]
+              callback:^(NSArray* oldValue, NSArray* newValue) {
+                if ((!oldValue && !newValue) || [oldValue isEqualToArray:newValue]) {
+                  return;
+                }
+
+                LOGI(@"TelemetryAggregatedEvents changed: %@ -> %@",
+                     [oldValue componentsJoinedByString:@","],
+                     [newValue componentsJoinedByString:@","]);
+                logger->SetTelemetryAggregatedEvents(santa::TelemetryConfigToBitmask(
+                    [configurator telemetryAggregatedEvents] ?: @[]));
               }],
     [[SNTKVOManager alloc] initWithObject:configurator
                                  selector:@selector(enableSilentTTYMode)
@@ -737,6 +817,54 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
 
                                    logger->SetMaxFilesPerBatch(newInterval);
                                  }],
+    [[SNTKVOManager alloc] initWithObject:configurator
+                                 selector:@selector(telemetryExportStreamingDelaySec)
+                                     type:[NSNumber class]
+                                 callback:^(NSNumber* oldValue, NSNumber* newValue) {
+                                   uint32_t oldDelay = [oldValue unsignedIntValue];
+                                   uint32_t newDelay = [newValue unsignedIntValue];
+
+                                   if (oldDelay == newDelay) {
+                                     return;
+                                   }
+
+                                   LOGI(@"TelemetryExportStreamingDelaySec changed: %u -> %u",
+                                        oldDelay, newDelay);
+
+                                   logger->SetStreamingExportDelaySecs(newDelay);
+                                 }],
+    [[SNTKVOManager alloc] initWithObject:configurator
+                                 selector:@selector(telemetryExportMaxConcurrentBatches)
+                                     type:[NSNumber class]
+                                 callback:^(NSNumber* oldValue, NSNumber* newValue) {
+                                   uint32_t oldVal = [oldValue unsignedIntValue];
+                                   uint32_t newVal = [newValue unsignedIntValue];
+
+                                   if (oldVal == newVal) {
+                                     return;
+                                   }
+
+                                   LOGI(@"TelemetryExportMaxConcurrentBatches changed: %u -> %u",
+                                        oldVal, newVal);
+
+                                   logger->SetMaxConcurrentExports(newVal);
+                                 }],
+    [[SNTKVOManager alloc] initWithObject:configurator
+                                 selector:@selector(telemetryExportMaxKBPerSec)
+                                     type:[NSNumber class]
+                                 callback:^(NSNumber* oldValue, NSNumber* newValue) {
+                                   uint32_t oldVal = [oldValue unsignedIntValue];
+                                   uint32_t newVal = [newValue unsignedIntValue];
+
+                                   if (oldVal == newVal) {
+                                     return;
+                                   }
+
+                                   LOGI(@"TelemetryExportMaxKBPerSec changed: %u -> %u",
+                                        oldVal, newVal);
+
+                                   logger->SetExportBandwidthLimitKBps(newVal);
+                                 }],
 
     [[SNTKVOManager alloc]
         initWithObject:configurator
@@ -834,17 +962,58 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
   (void)kvoObservers;
 
   if (process_tree) {
+    uint64_t backfill_start_uptime = GetCurrentUptime();
     if (absl::Status status = process_tree->Backfill(); !status.ok()) {
       std::string err = status.ToString();
       LOGE(@"Failed to backfill process tree: %@", @(err.c_str()));
     }
+    santa::RecordStartupPhase([SNTMetricSet sharedInstance], @"ProcessTreeBackfill",
+                              backfill_start_uptime);
   }
 
+  // Restore the warm-start cache snapshot before the Authorizer is enabled so
+  // restored entries are in place before the first AUTH EXEC arrives.
+  std::shared_ptr<santa::CacheSnapshot> cache_snapshot;
+  if ([configurator enableCacheSnapshot]) {
+    cache_snapshot = santa::CacheSnapshot::Create(
+        @"/var/db/santa/cache_snapshot.db", auth_result_cache, [SNTDecisionCache sharedCache], ^{
+          return santa::CacheSnapshot::PolicyDigest([SNTConfigurator configurator],
+                                                    [SNTDatabaseController ruleTable]);
+        });
+    uint64_t load_start_uptime = GetCurrentUptime();
+    cache_snapshot->Load();
+    santa::RecordStartupPhase([SNTMetricSet sharedInstance], @"CacheSnapshotLoad",
+                              load_start_uptime);
+    cache_snapshot->StartTimerWithInterval([configurator cacheSnapshotIntervalSec]);
+  }
+
+  // Persist buffered events and the latest cache state when launchd stops the
+  // daemon.
+  signal(SIGTERM, SIG_IGN);
+  dispatch_source_t sigterm_source = dispatch_source_create(
+      DISPATCH_SOURCE_TYPE_SIGNAL, SIGTERM, 0,
+      dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0));
+  dispatch_source_set_event_handler(sigterm_source, ^{
+    [exec_controller flushPendingEvents];
+    if (cache_snapshot) {
+      cache_snapshot->StopTimer();
+      cache_snapshot->Write();
+    }
+    exit(EXIT_SUCCESS);
+  });
+  dispatch_resume(sigterm_source);
+
   // IMPORTANT: ES will hold up third party execs until early boot clients make
   // their first subscription. Ensuring the `Authorizer` client is enabled first
   // means that the AUTH EXEC event is subscribed first and Santa can apply
   // execution policy appropriately.
-  [authorizer_client enable];
+  for (SNTEndpointSecurityAuthorizer* client in authorizer_clients) {
+    [client enable];
+  }
+  for (SNTEndpointSecurityAuthorizer* client in authorizer_clients) {
+    [client beginSharding];
+  }
+  santa::RecordStartupPhase([SNTMetricSet sharedInstance], @"AuthorizerSubscribe", start_uptime);
 
   // Tamper protection is not enabled on debug builds.
 #ifndef DEBUG
@@ -864,6 +1033,12 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
   [monitor_client enable];
   [device_client enable];
 
+  // Exporting metrics isn't needed to evaluate execs, so the connection to
+  // the metric service waits until every client has subscribed.
+  if ([configurator exportMetrics]) {
+    metrics->StartPoll();
+  }
+
   if ([configurator enableTelemetryExport]) {
     // Delay initial start to allow Santa to stabilize
     LOGW(@"WARNING - Telemetry export is currently in beta. Configuration and format are subject "
@@ -899,5 +1074,14 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
     }
   });
 
+  // Keep the databases compact and their query planner statistics current.
+  auto database_maintenance = santa::DatabaseMaintenance::Create(
+      @{
+        @"rules" : [SNTDatabaseController ruleTable],
+        @"events" : [SNTDatabaseController eventTable],
+      },
+      [SNTMetricSet sharedInstance]);
+  database_maintenance->StartTimerWithInterval(santa::DatabaseMaintenance::kDefaultIntervalSecs);
+
   [[NSRunLoop mainRunLoop] run];
 }
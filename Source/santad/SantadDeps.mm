@@ -15,9 +15,16 @@
 
 #include "Source/santad/SantadDeps.h"
 
+#include <sqlite3.h>
+
 #include <cstdlib>
+#include <map>
 #include <memory>
+#include <optional>
 
+#include "Source/common/CacheRegistry.h"
+#include "Source/common/ExecTrace.h"
+#include "Source/common/MemoryAttribution.h"
 #include "Source/common/RingBuffer.h"
 #import "Source/common/SNTExportConfiguration.h"
 #import "Source/common/SNTLogging.h"
@@ -25,6 +32,9 @@
 #import "Source/common/SNTStoredSignalReport.h"
 #import "Source/common/SNTStrengthify.h"
 #import "Source/common/SNTXPCControlInterface.h"
+#include "Source/common/String.h"
+#include "Source/common/SantaCacheMetrics.h"
+#include "Source/common/SystemResources.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/common/es/EndpointSecurityAPI.h"
 #include "Source/common/es/EnrichedTypes.h"
@@ -35,6 +45,9 @@
 #import "Source/santad/DataLayer/SNTEventTable.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #include "Source/santad/EntitlementsFilter.h"
+#import "Source/santad/EventProviders/SNTEndpointSecurityRecorder.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/ReusableArena.h"
 #import "Source/santad/SNTDatabaseController.h"
 #import "Source/santad/SNTDecisionCache.h"
 #import "Source/santad/SNTNetworkExtensionQueue.h"
@@ -58,6 +71,8 @@ namespace santa {
 std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
                                                SNTMetricSet* metric_set,
                                                santa::ProcessControlBlock processControlBlock) {
+  uint64_t start_uptime = GetCurrentUptime();
+
   // TODO(mlw): The XPC interfaces should be injectable. Could either make a new
   // protocol defining appropriate methods or accept values as params.
   MOLXPCConnection* control_connection =
@@ -70,20 +85,36 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
   control_connection.privilegedInterface = [SNTXPCControlInterface controlInterface];
   control_connection.unprivilegedInterface = [SNTXPCUnprivilegedControlInterface controlInterface];
 
+  // The rule and event databases are independent, so open (and migrate) the
+  // event database while the rule database is being opened.
+  dispatch_queue_t init_queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+  dispatch_group_t init_group = dispatch_group_create();
+  __block SNTEventTable* event_table;
+  dispatch_group_async(init_group, init_queue, ^{
+    event_table = [SNTDatabaseController eventTable];
+  });
+
   SNTRuleTable* rule_table = [SNTDatabaseController ruleTable];
   if (!rule_table) {
     LOGE(@"Failed to initialize rule table.");
     exit(EXIT_FAILURE);
   }
   // Prime the lazily-computed critical system binaries now, at startup, so the
-  // expensive hashing/codesigning doesn't block the first AUTH decision.
-  (void)rule_table.criticalSystemBinaries;
-
-  SNTEventTable* event_table = [SNTDatabaseController eventTable];
+  // expensive hashing/codesigning doesn't block the first AUTH decision. This
+  // overlaps with the rest of startup; a decision that needs them before they
+  // are ready waits for them on the rule table's dispatch_once.
+  dispatch_async(init_queue, ^{
+    uint64_t critical_start_uptime = GetCurrentUptime();
+    (void)rule_table.criticalSystemBinaries;
+    RecordStartupPhase(metric_set, @"CriticalSystemBinaries", critical_start_uptime);
+  });
+
+  dispatch_group_wait(init_group, DISPATCH_TIME_FOREVER);
   if (!event_table) {
     LOGE(@"Failed to initialize event table.");
     exit(EXIT_FAILURE);
   }
+  [event_table setWriteDurability:[configurator writeDurability]];
 
   SNTCompilerController* compiler_controller = [[SNTCompilerController alloc] init];
   if (!compiler_controller) {
@@ -141,9 +172,7 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
   std::shared_ptr<::PrefixTree<Unit>> prefix_tree = std::make_shared<::PrefixTree<Unit>>();
 
   // TODO(bur): Add KVO handling for fileChangesPrefixFilters.
-  NSArray<NSString*>* prefix_filters =
-      [@[ @"/.", @"/dev/" ] arrayByAddingObjectsFromArray:[configurator fileChangesPrefixFilters]];
-  for (NSString* filter in prefix_filters) {
+  for (NSString* filter in [SNTEndpointSecurityRecorder fileChangesPrefixFilters]) {
     prefix_tree->InsertPrefix([filter fileSystemRepresentation], Unit {});
   }
 
@@ -180,20 +209,59 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
       ^SNTExportConfiguration*() {
         return [configurator exportConfig];
       },
-      ^(std::string path, std::shared_ptr<santa::ScopedFile> file) {
-        signal_scanner->ScanFile(std::move(path), std::move(file));
+      ^(std::string path, std::shared_ptr<santa::ScopedFile> file,
+        std::shared_ptr<const santa::SignalPrefilter> clean_under) {
+        signal_scanner->ScanFile(std::move(path), std::move(file), std::move(clean_under));
+      },
+      ^std::shared_ptr<const santa::SignalPrefilter>() {
+        return signal_scanner->Prefilter();
       },
       TelemetryConfigToBitmask([configurator telemetry]), [configurator eventLogType],
       [SNTDecisionCache sharedCache], [configurator eventLogPath], [configurator spoolDirectory],
       spool_dir_threshold_bytes, spool_file_threshold_bytes, spool_flush_timeout_ms,
       telemetry_export_frequency_secs, [configurator telemetryExportTimeoutSec],
       [configurator telemetryExportBatchThresholdSizeMB],
-      [configurator telemetryExportMaxFilesPerBatch]);
+      [configurator telemetryExportMaxFilesPerBatch],
+      static_cast<uint32_t>([configurator spoolDirectoryShardCount]),
+      [configurator spoolDirectoryZstdDictionaryPath],
+      static_cast<uint32_t>([configurator spoolDirectoryCompactionZstdLevel]),
+      [configurator writeDurability]);
   if (!logger) {
     LOGE(@"Failed to create logger.");
     exit(EXIT_FAILURE);
   }
 
+  logger->SetTelemetrySampleRates([configurator telemetrySampleRates]);
+  logger->SetTelemetryAggregatedEvents(
+      TelemetryConfigToBitmask([configurator telemetryAggregatedEvents] ?: @[]));
+  logger->SetLoadShedding(
+      TelemetryLoadSheddingConfigToBitmask([configurator telemetryLoadSheddingEvents]),
+      [configurator telemetryLoadSheddingThreshold]);
+  logger->StartEventAggregation(
+      static_cast<uint32_t>([configurator telemetryAggregationWindowSec]));
+  logger->SetStreamingExportDelaySecs([configurator telemetryExportStreamingDelaySec]);
+  logger->SetMaxConcurrentExports([configurator telemetryExportMaxConcurrentBatches]);
+  logger->SetExportBandwidthLimitKBps([configurator telemetryExportMaxKBPerSec]);
+  if (NSUInteger window_secs = [configurator networkFlowAggregationWindowSec]) {
+    logger->StartNetworkFlowAggregation(static_cast<uint32_t>(window_secs));
+  }
+
+  // Exec traces requested with `santactl trace --export` go to the telemetry log.
+  std::weak_ptr<::Logger> weak_logger = logger;
+  santa::ExecTracer::Shared().SetExportCallback(
+      [weak_logger](const santa::ExecTrace::Summary& trace) {
+        if (std::shared_ptr<::Logger> strong_logger = weak_logger.lock()) {
+          strong_logger->LogExecTrace(trace);
+        }
+      });
+
+  if (NSUInteger log_queue_size = [configurator eventLogQueueSize]; log_queue_size > 0) {
+    using FullPolicy = santa::LogQueue<std::unique_ptr<santa::EnrichedMessage>>::FullPolicy;
+    logger->StartLogQueue(log_queue_size, [configurator eventLogQueueDropWhenFull]
+                                              ? FullPolicy::kDrop
+                                              : FullPolicy::kConsumeInline);
+  }
+
   SNTNetworkExtensionQueue* netext_queue =
       [[SNTNetworkExtensionQueue alloc] initWithNotifierQueue:notifier_queue
                                                    syncdQueue:syncd_queue
@@ -269,6 +337,14 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
     signal_scanner->SetSignals([rule_table retrieveAllSignals]);
   };
 
+  // Compile plans for the CEL rules ahead of the executions that match them.
+  [policy_processor precompileCELRules];
+  WEAKIFY(policy_processor);
+  rule_table.celRulesChangedCallback = ^(int64_t celRuleCount) {
+    STRONGIFY(policy_processor);
+    [policy_processor precompileCELRules];
+  };
+
   std::shared_ptr<::Metrics> metrics =
       Metrics::Create(metric_set, [configurator metricExportInterval]);
   if (!metrics) {
@@ -282,6 +358,265 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator* configurator,
     exit(EXIT_FAILURE);
   }
 
+  std::weak_ptr<::AuthResultCache> weak_auth_result_cache = auth_result_cache;
+  santa::RegisterCacheMetrics(metric_set, @"auth_result_root",
+                              [weak_auth_result_cache]() -> std::optional<SantaCacheStats> {
+                                auto cache = weak_auth_result_cache.lock();
+                                if (!cache) return std::nullopt;
+                                return cache->CacheStats().first;
+                              });
+  santa::RegisterCacheMetrics(metric_set, @"auth_result_nonroot",
+                              [weak_auth_result_cache]() -> std::optional<SantaCacheStats> {
+                                auto cache = weak_auth_result_cache.lock();
+                                if (!cache) return std::nullopt;
+                                return cache->CacheStats().second;
+                              });
+  santa::RegisterCacheMetrics(metric_set, @"decision", []() -> std::optional<SantaCacheStats> {
+    return [[SNTDecisionCache sharedCache] cacheStats];
+  });
+
+  // Shrink the caches under memory pressure, and grow them on hosts with
+  // plenty of memory.
+  santa::CacheRegistry& cache_registry = santa::CacheRegistry::Shared();
+  cache_registry.Register(
+      @"auth_result_root",
+      [weak_auth_result_cache]() -> std::optional<SantaCacheUsage> {
+        auto cache = weak_auth_result_cache.lock();
+        if (!cache) return std::nullopt;
+        return cache->CacheUsage().first;
+      },
+      [weak_auth_result_cache](uint64_t max_size) {
+        auto cache = weak_auth_result_cache.lock();
+        if (!cache) return false;
+        cache->SetMaxRootCacheSize(max_size);
+        return true;
+      });
+  cache_registry.Register(
+      @"auth_result_nonroot",
+      [weak_auth_result_cache]() -> std::optional<SantaCacheUsage> {
+        auto cache = weak_auth_result_cache.lock();
+        if (!cache) return std::nullopt;
+        return cache->CacheUsage().second;
+      },
+      [weak_auth_result_cache](uint64_t max_size) {
+        auto cache = weak_auth_result_cache.lock();
+        if (!cache) return false;
+        cache->SetMaxNonRootCacheSize(max_size);
+        return true;
+      });
+  cache_registry.Register(
+      @"decision",
+      []() -> std::optional<SantaCacheUsage> {
+        return [[SNTDecisionCache sharedCache] cacheUsage];
+      },
+      [](uint64_t max_size) {
+        [[SNTDecisionCache sharedCache] setMaximumCacheSize:max_size];
+        return true;
+      });
+  cache_registry.RegisterMetrics(metric_set);
+  cache_registry.StartMonitoring();
+
+  SNTMetricInt64Gauge* rule_filter_size =
+      [metric_set int64GaugeWithName:@"/santa/rules/filter/size_bytes"
+                          fieldNames:@[]
+                            helpText:@"Size of the execution rule lookup filter in bytes"];
+  SNTMetricDoubleGauge* rule_filter_fpr = [metric_set
+      doubleGaugeWithName:@"/santa/rules/filter/estimated_false_positive_rate"
+               fieldNames:@[]
+                 helpText:@"Estimated false positive rate of the execution rule lookup filter"];
+  SNTMetricCounter* rule_filter_lookups =
+      [metric_set counterWithName:@"/santa/rules/filter/lookups"
+                       fieldNames:@[ @"Result" ]
+                         helpText:@"Count of execution rule lookups by filter result"];
+  auto last_filter_stats = std::make_shared<SNTRuleFilterStats>();
+  [metric_set registerCallback:^{
+    STRONGIFY(rule_table);
+    SNTRuleFilterStats stats = [rule_table executionRuleFilterStats];
+    [rule_filter_size set:(long long)stats.sizeBytes forFieldValues:@[]];
+    [rule_filter_fpr set:stats.estimatedFalsePositiveRate forFieldValues:@[]];
+    // The rule table keeps cumulative totals, so record the change since the last export.
+    auto record = ^(uint64_t current, uint64_t previous, NSString* result) {
+      [rule_filter_lookups incrementBy:(long long)(current - previous) forFieldValues:@[ result ]];
+    };
+    record(stats.skippedLookups, last_filter_stats->skippedLookups, @"Skipped");
+    record(stats.matchedLookups, last_filter_stats->matchedLookups, @"Matched");
+    record(stats.falsePositiveLookups, last_filter_stats->falsePositiveLookups, @"FalsePositive");
+    *last_filter_stats = stats;
+  }];
+
+  SNTMetricInt64Gauge* arena_high_water =
+      [metric_set int64GaugeWithName:@"/santa/logging/arena/high_water_bytes"
+                          fieldNames:@[]
+                            helpText:@"Largest protobuf arena usage by a single log message "
+                                     @"since the last export"];
+  SNTMetricCounter* arena_events =
+      [metric_set counterWithName:@"/santa/logging/arena/events"
+                       fieldNames:@[ @"Event" ]
+                         helpText:@"Count of reusable protobuf arena events by type"];
+  auto last_arena_stats = std::make_shared<santa::ReusableArenaStats>();
+  [metric_set registerCallback:^{
+    santa::ReusableArenaStats stats = santa::ReusableArena::CollectStats();
+    [arena_high_water set:(long long)stats.high_water_bytes forFieldValues:@[]];
+    auto record = ^(uint64_t current, uint64_t previous, NSString* event) {
+      [arena_events incrementBy:(long long)(current - previous) forFieldValues:@[ event ]];
+    };
+    record(stats.messages, last_arena_stats->messages, @"Reused");
+    record(stats.resizes, last_arena_stats->resizes, @"Resized");
+    record(stats.fallbacks, last_arena_stats->fallbacks, @"Fallback");
+    *last_arena_stats = stats;
+  }];
+
+  SNTMetricCounter* exec_truncations =
+      [metric_set counterWithName:@"/santa/logging/exec_truncations"
+                       fieldNames:@[ @"Field", @"Action" ]
+                         helpText:@"Count of logged executions whose arguments or environment "
+                                  @"exceeded the configured byte budget"];
+  auto last_exec_capture_stats = std::make_shared<santa::ExecCaptureStats>();
+  [metric_set registerCallback:^{
+    santa::ExecCaptureStats stats = santa::Protobuf::CollectExecCaptureStats();
+    auto record = ^(uint64_t current, uint64_t previous, NSString* field, NSString* action) {
+      [exec_truncations incrementBy:(long long)(current - previous)
+                     forFieldValues:@[ field, action ]];
+    };
+    record(stats.args_truncated, last_exec_capture_stats->args_truncated, @"Args", @"Truncated");
+    record(stats.envs_truncated, last_exec_capture_stats->envs_truncated, @"Envs", @"Truncated");
+    record(stats.envs_hashed, last_exec_capture_stats->envs_hashed, @"Envs", @"Hashed");
+    *last_exec_capture_stats = stats;
+  }];
+
+  SNTMetricInt64Gauge* cel_arena_bytes =
+      [metric_set int64GaugeWithName:@"/santa/cel/arena/bytes_per_evaluation"
+                          fieldNames:@[ @"Statistic" ]
+                            helpText:@"Protobuf arena bytes used by CEL evaluations since the "
+                                     @"last export"];
+  SNTMetricCounter* cel_arena_events =
+      [metric_set counterWithName:@"/santa/cel/arena/events"
+                       fieldNames:@[ @"Event" ]
+                         helpText:@"Count of reusable CEL evaluation arena events by type"];
+  auto last_cel_arena_stats = std::make_shared<santa::ReusableArenaStats>();
+  [metric_set registerCallback:^{
+    santa::ReusableArenaStats stats =
+        santa::ReusableArena::CollectStats(santa::ReusableArenaPool::kCELEvaluation);
+    uint64_t evaluations = stats.messages - last_cel_arena_stats->messages;
+    if (evaluations > 0) {
+      uint64_t bytes = stats.total_bytes - last_cel_arena_stats->total_bytes;
+      [cel_arena_bytes set:(long long)(bytes / evaluations) forFieldValues:@[ @"Mean" ]];
+      [cel_arena_bytes set:(long long)stats.high_water_bytes forFieldValues:@[ @"Max" ]];
+    }
+    auto record = ^(uint64_t current, uint64_t previous, NSString* event) {
+      [cel_arena_events incrementBy:(long long)(current - previous) forFieldValues:@[ event ]];
+    };
+    record(stats.messages, last_cel_arena_stats->messages, @"Reused");
+    record(stats.resizes, last_cel_arena_stats->resizes, @"Resized");
+    record(stats.fallbacks, last_cel_arena_stats->fallbacks, @"Fallback");
+    *last_cel_arena_stats = stats;
+  }];
+
+  SNTMetricInt64Gauge* log_queue_depth =
+      [metric_set int64GaugeWithName:@"/santa/logging/queue/depth"
+                          fieldNames:@[]
+                            helpText:@"Number of events waiting in the event log queue"];
+  SNTMetricCounter* log_queue_overflow =
+      [metric_set counterWithName:@"/santa/logging/queue/overflow"
+                       fieldNames:@[ @"Action" ]
+                         helpText:@"Count of events that arrived while the event log queue was "
+                                  @"full, by how they were handled"];
+  auto last_log_queue_stats = std::make_shared<santa::LogQueueStats>();
+  [metric_set registerCallback:^{
+    auto strong_logger = weak_logger.lock();
+    if (!strong_logger) return;
+    std::optional<santa::LogQueueStats> stats = strong_logger->GetLogQueueStats();
+    if (!stats) return;
+    [log_queue_depth set:(long long)stats->depth forFieldValues:@[]];
+    auto record = ^(uint64_t current, uint64_t previous, NSString* action) {
+      [log_queue_overflow incrementBy:(long long)(current - previous)
+                       forFieldValues:@[ action ]];
+    };
+    record(stats->dropped, last_log_queue_stats->dropped, @"Dropped");
+    record(stats->inlined, last_log_queue_stats->inlined, @"Inline");
+    *last_log_queue_stats = *stats;
+  }];
+
+  SNTMetricCounter* load_shedding_dropped =
+      [metric_set counterWithName:@"/santa/logging/load_shedding/dropped"
+                       fieldNames:@[ @"Event" ]
+                         helpText:@"Count of events dropped because the event log fell behind"];
+  auto last_shed_counts = std::make_shared<std::map<TelemetryEvent, uint64_t>>();
+  [metric_set registerCallback:^{
+    auto strong_logger = weak_logger.lock();
+    if (!strong_logger) return;
+    for (const auto& [event, count] : strong_logger->GetShedCounts()) {
+      uint64_t& previous = (*last_shed_counts)[event];
+      [load_shedding_dropped incrementBy:(long long)(count - previous)
+                          forFieldValues:@[ santa::StringToNSString(TelemetryEventToName(event)) ]];
+      previous = count;
+    }
+  }];
+
+  SNTMetricInt64Gauge* process_tree_processes =
+      [metric_set int64GaugeWithName:@"/santa/process_tree/processes"
+                          fieldNames:@[]
+                            helpText:@"Number of processes tracked by the process tree"];
+  SNTMetricInt64Gauge* process_tree_slab_bytes =
+      [metric_set int64GaugeWithName:@"/santa/process_tree/slab_bytes"
+                          fieldNames:@[ @"State" ]
+                            helpText:@"Bytes of process tree slab memory by state"];
+  std::weak_ptr<santa::santad::process_tree::ProcessTree> weak_process_tree = process_tree;
+  [metric_set registerCallback:^{
+    auto strong_process_tree = weak_process_tree.lock();
+    if (!strong_process_tree) return;
+    santa::santad::process_tree::ProcessTree::MemoryUsage usage =
+        strong_process_tree->GetMemoryUsage();
+    const auto& slab = usage.process_slab;
+    [process_tree_processes set:(long long)usage.processes forFieldValues:@[]];
+    [process_tree_slab_bytes set:(long long)(slab.slots_in_use * slab.slot_size)
+                  forFieldValues:@[ @"InUse" ]];
+    [process_tree_slab_bytes set:(long long)(slab.slots_free * slab.slot_size)
+                  forFieldValues:@[ @"Free" ]];
+  }];
+
+  // Attribute memory to the subsystems holding it. Each estimate stops being
+  // collected once what it measures is gone.
+  santa::MemoryAttribution& memory = santa::MemoryAttribution::Shared();
+  memory.Register(@"caches", []() -> std::optional<uint64_t> {
+    return santa::CacheRegistry::Shared().TotalBytes();
+  });
+  memory.Register(@"process_tree", [weak_process_tree]() -> std::optional<uint64_t> {
+    auto tree = weak_process_tree.lock();
+    if (!tree) return std::nullopt;
+    return tree->GetMemoryUsage().process_slab.bytes_reserved;
+  });
+  std::weak_ptr<::PrefixTree<Unit>> weak_prefix_tree = prefix_tree;
+  memory.Register(@"prefix_tree", [weak_prefix_tree]() -> std::optional<uint64_t> {
+    auto tree = weak_prefix_tree.lock();
+    if (!tree) return std::nullopt;
+    return tree->MemoryUsageBytes();
+  });
+  std::weak_ptr<::WatchItems> weak_watch_items = watch_items;
+  memory.Register(@"faa", [weak_watch_items]() -> std::optional<uint64_t> {
+    auto items = weak_watch_items.lock();
+    if (!items) return std::nullopt;
+    return items->DataPolicyTreeBytes();
+  });
+  memory.Register(@"rule_index", [Weak_rule_table]() -> std::optional<uint64_t> {
+    STRONGIFY(rule_table);
+    if (!rule_table) return std::nullopt;
+    return [rule_table executionRuleFilterStats].sizeBytes;
+  });
+  memory.Register(@"logging", []() -> std::optional<uint64_t> {
+    return santa::ReusableArena::BlockBytes(santa::ReusableArenaPool::kLogging);
+  });
+  memory.Register(@"cel", []() -> std::optional<uint64_t> {
+    return santa::ReusableArena::BlockBytes(santa::ReusableArenaPool::kCELEvaluation);
+  });
+  // SQLite's page caches and statements for the rule and event databases.
+  memory.Register(@"database", []() -> std::optional<uint64_t> {
+    return static_cast<uint64_t>(sqlite3_memory_used());
+  });
+  memory.RegisterMetrics(metric_set);
+
+  RecordStartupPhase(metric_set, @"Dependencies", start_uptime);
+
   return std::make_unique<SantadDeps>(
       esapi, logger, std::move(metrics), std::move(watch_items), std::move(auth_result_cache),
       control_connection, compiler_controller, notifier_queue, syncd_queue, netext_queue,
@@ -0,0 +1,75 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_SANTAD_SIGNALPREFILTER_H
+#define SANTA_SANTAD_SIGNALPREFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Source/common/AhoCorasick.h"
+
+namespace cel::expr {
+class Expr;
+}  // namespace cel::expr
+
+namespace santa {
+
+// A cheap, conservative test of whether a serialized telemetry message could
+// be relevant to any of a set of detection signals, so spool batches that
+// can't match are never handed to Sleigh.
+//
+// Each signal's CEL condition is inspected for string literals the event must
+// contain for the condition to hold, e.g. the "EQHXZ8M8AV" in
+// `x.team_id == "EQHXZ8M8AV" && ...`. Since serialized protobuf strings are
+// stored verbatim, a message that contains none of those literals (searched
+// for all at once with an Aho-Corasick automaton) can't satisfy any signal.
+//
+// The filter is only sound if every signal's condition yields literals, so
+// Create returns nullptr, meaning "scan everything", if any doesn't.
+class SignalPrefilter {
+ public:
+  // Literals shorter than this are too common to filter on.
+  static constexpr size_t kMinLiteralLength = 4;
+
+  // serialized_signals are serialized santa.common.v1.Signal protos.
+  static std::shared_ptr<const SignalPrefilter> Create(
+      const std::vector<std::string>& serialized_signals);
+
+  explicit SignalPrefilter(const std::vector<std::string>& literals);
+
+  SignalPrefilter(const SignalPrefilter&) = delete;
+  SignalPrefilter& operator=(const SignalPrefilter&) = delete;
+
+  // Returns false only if the message can't match any of the signals.
+  bool MayMatch(const uint8_t* data, size_t size) const;
+
+  size_t NumLiterals() const { return matcher_.NumPatterns(); }
+
+  // Returns literals of which at least one must occur in the input for expr to
+  // evaluate to true, or std::nullopt if no such set can be derived. Exposed
+  // for testing.
+  static std::optional<std::vector<std::string>> RequiredLiterals(const cel::expr::Expr& expr);
+
+ private:
+  AhoCorasick matcher_;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_SANTAD_SIGNALPREFILTER_H
@@ -0,0 +1,211 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/SignalPrefilter.h"
+
+#include <string_view>
+#include <utility>
+
+#import "Source/common/SNTLogging.h"
+#include "absl/container/flat_hash_set.h"
+#include "cel/expr/syntax.pb.h"
+#include "common/signals.pb.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "parser/parser.h"
+
+namespace santa {
+
+namespace {
+
+using ::cel::expr::Constant;
+using ::cel::expr::Expr;
+
+// Nested messages in a Signal searched for conditions.
+constexpr int kMaxSignalDepth = 3;
+
+// A plain field access such as `a.b.c`, whose value is a field of the event
+// as serialized, not something computed from it.
+bool IsFieldPath(const Expr& expr) {
+  switch (expr.expr_kind_case()) {
+    case Expr::kIdentExpr: return true;
+    case Expr::kSelectExpr:
+      return !expr.select_expr().test_only() && IsFieldPath(expr.select_expr().operand());
+    default: return false;
+  }
+}
+
+// A string constant long enough to filter on, that is serialized the same way
+// in binary and JSON protobuf encodings.
+std::optional<std::string> UsableLiteral(const Expr& expr) {
+  if (expr.expr_kind_case() != Expr::kConstExpr ||
+      expr.const_expr().constant_kind_case() != Constant::kStringValue) {
+    return std::nullopt;
+  }
+  const std::string& value = expr.const_expr().string_value();
+  if (value.size() < SignalPrefilter::kMinLiteralLength) {
+    return std::nullopt;
+  }
+  for (unsigned char c : value) {
+    if (c < 0x20 || c > 0x7e || c == '"' || c == '\\' || c == '<' || c == '>' || c == '&') {
+      return std::nullopt;
+    }
+  }
+  return value;
+}
+
+// Collects the conditions of every string field in message that parses as CEL.
+// Returns false if any of them yields no literals. Fields that don't parse,
+// like a description, are skipped.
+bool CollectLiterals(const google::protobuf::Message& message, int depth,
+                     std::vector<std::string>& literals, bool& found_condition) {
+  const google::protobuf::Descriptor* descriptor = message.GetDescriptor();
+  const google::protobuf::Reflection* reflection = message.GetReflection();
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const google::protobuf::FieldDescriptor* field = descriptor->field(i);
+    if (field->is_repeated()) {
+      continue;
+    }
+    if (field->cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+      if (depth < kMaxSignalDepth && reflection->HasField(message, field) &&
+          !CollectLiterals(reflection->GetMessage(message, field), depth + 1, literals,
+                           found_condition)) {
+        return false;
+      }
+      continue;
+    }
+    if (field->type() != google::protobuf::FieldDescriptor::TYPE_STRING ||
+        field->name() == "name") {
+      continue;
+    }
+
+    std::string value = reflection->GetString(message, field);
+    if (value.empty()) {
+      continue;
+    }
+    auto parsed = google::api::expr::parser::Parse(value);
+    if (!parsed.ok()) {
+      continue;
+    }
+    std::optional<std::vector<std::string>> required =
+        SignalPrefilter::RequiredLiterals(parsed->expr());
+    if (!required.has_value()) {
+      return false;
+    }
+    found_condition = true;
+    literals.insert(literals.end(), required->begin(), required->end());
+  }
+  return true;
+}
+
+}  // namespace
+
+std::optional<std::vector<std::string>> SignalPrefilter::RequiredLiterals(const Expr& expr) {
+  if (expr.expr_kind_case() != Expr::kCallExpr) {
+    return std::nullopt;
+  }
+  const auto& call = expr.call_expr();
+  const std::string& function = call.function();
+
+  if (call.args_size() == 2 && (function == "_&&_" || function == "_||_")) {
+    std::optional<std::vector<std::string>> lhs = RequiredLiterals(call.args(0));
+    std::optional<std::vector<std::string>> rhs = RequiredLiterals(call.args(1));
+    if (function == "_&&_") {
+      // Both sides must hold, so either side's literals are required. Prefer the
+      // smaller set, which filters more.
+      if (lhs && rhs) {
+        return lhs->size() <= rhs->size() ? lhs : rhs;
+      }
+      return lhs ? lhs : rhs;
+    }
+    // Either side may hold, so both sides must have literals.
+    if (!lhs || !rhs) {
+      return std::nullopt;
+    }
+    lhs->insert(lhs->end(), rhs->begin(), rhs->end());
+    return lhs;
+  }
+
+  if (function == "_==_" && call.args_size() == 2) {
+    for (const auto& [field, literal] :
+         {std::pair{&call.args(0), &call.args(1)}, std::pair{&call.args(1), &call.args(0)}}) {
+      if (IsFieldPath(*field)) {
+        if (std::optional<std::string> value = UsableLiteral(*literal)) {
+          return std::vector<std::string>{std::move(*value)};
+        }
+      }
+    }
+    return std::nullopt;
+  }
+
+  if ((function == "startsWith" || function == "endsWith" || function == "contains") &&
+      call.has_target() && call.args_size() == 1 && IsFieldPath(call.target())) {
+    if (std::optional<std::string> value = UsableLiteral(call.args(0))) {
+      return std::vector<std::string>{std::move(*value)};
+    }
+    return std::nullopt;
+  }
+
+  if (function == "@in" && call.args_size() == 2 && IsFieldPath(call.args(0)) &&
+      call.args(1).expr_kind_case() == Expr::kListExpr) {
+    std::vector<std::string> literals;
+    for (const Expr& element : call.args(1).list_expr().elements()) {
+      std::optional<std::string> value = UsableLiteral(element);
+      if (!value.has_value()) {
+        return std::nullopt;
+      }
+      literals.push_back(std::move(*value));
+    }
+    if (literals.empty()) {
+      return std::nullopt;
+    }
+    return literals;
+  }
+
+  return std::nullopt;
+}
+
+std::shared_ptr<const SignalPrefilter> SignalPrefilter::Create(
+    const std::vector<std::string>& serialized_signals) {
+  if (serialized_signals.empty()) {
+    return nullptr;
+  }
+
+  absl::flat_hash_set<std::string> unique;
+  for (const std::string& serialized : serialized_signals) {
+    ::santa::common::v1::Signal signal;
+    if (!signal.ParseFromString(serialized)) {
+      return nullptr;
+    }
+    std::vector<std::string> literals;
+    bool found_condition = false;
+    if (!CollectLiterals(signal, 0, literals, found_condition) || !found_condition) {
+      LOGD(@"Signal prefilter disabled: no required literals for signal %s",
+           signal.name().c_str());
+      return nullptr;
+    }
+    unique.insert(literals.begin(), literals.end());
+  }
+
+  return std::make_shared<const SignalPrefilter>(
+      std::vector<std::string>(unique.begin(), unique.end()));
+}
+
+SignalPrefilter::SignalPrefilter(const std::vector<std::string>& literals) : matcher_(literals) {}
+
+bool SignalPrefilter::MayMatch(const uint8_t* data, size_t size) const {
+  return matcher_.ContainsAny(std::string_view(reinterpret_cast<const char*>(data), size));
+}
+
+}  // namespace santa
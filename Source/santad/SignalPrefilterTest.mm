@@ -0,0 +1,114 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/SignalPrefilter.h"
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cel/expr/syntax.pb.h"
+#include "common/signals.pb.h"
+#include "parser/parser.h"
+
+using santa::SignalPrefilter;
+
+@interface SignalPrefilterTest : XCTestCase
+@end
+
+@implementation SignalPrefilterTest
+
+- (std::optional<std::vector<std::string>>)requiredLiteralsFor:(const std::string&)expression {
+  auto parsed = google::api::expr::parser::Parse(expression);
+  XCTAssertTrue(parsed.ok());
+  std::optional<std::vector<std::string>> literals =
+      SignalPrefilter::RequiredLiterals(parsed->expr());
+  if (literals) {
+    std::sort(literals->begin(), literals->end());
+  }
+  return literals;
+}
+
+- (void)testRequiredLiterals {
+  using Literals = std::vector<std::string>;
+
+  XCTAssertTrue(([self requiredLiteralsFor:R"(event.team_id == "EQHXZ8M8AV")"] ==
+                 Literals{"EQHXZ8M8AV"}));
+  XCTAssertTrue(([self requiredLiteralsFor:R"("EQHXZ8M8AV" == event.team_id)"] ==
+                 Literals{"EQHXZ8M8AV"}));
+  XCTAssertTrue(([self requiredLiteralsFor:R"(event.path.startsWith("/tmp/x"))"] ==
+                 Literals{"/tmp/x"}));
+  XCTAssertTrue(([self requiredLiteralsFor:R"(event.path in ["/bin/ls", "/bin/cat"])"] ==
+                 (Literals{"/bin/cat", "/bin/ls"})));
+
+  // Either side of a conjunction will do, preferring the smaller set
+  XCTAssertTrue(([self requiredLiteralsFor:R"(event.pid > 5 && event.path.contains("evil"))"] ==
+                 Literals{"evil"}));
+  XCTAssertTrue(
+      ([self requiredLiteralsFor:R"(e.a in ["aaaa", "bbbb"] && e.b == "cccc" && e.c > 1)"] ==
+       Literals{"cccc"}));
+
+  // Both sides of a disjunction are needed
+  XCTAssertTrue(([self requiredLiteralsFor:R"(e.a == "aaaa" || e.b.endsWith("bbbb"))"] ==
+                 (Literals{"aaaa", "bbbb"})));
+  XCTAssertFalse([self requiredLiteralsFor:R"(e.a == "aaaa" || e.pid == 1)"].has_value());
+}
+
+- (void)testNoLiteralsForUnsafeConditions {
+  // Negation, computed values, short or escaped literals, and non-strings
+  for (const char* expression : {
+           R"(!(event.team_id == "EQHXZ8M8AV"))",
+           R"(event.team_id != "EQHXZ8M8AV")",
+           R"(event.path.lowerAscii() == "/bin/ls")",
+           R"(event.path == "/ls")",
+           R"(event.path == "a\"quoted\"")",
+           R"(event.pid == 12345)",
+           R"(event.path in ["/bin/ls", "/ls"])",
+           R"(event.args.exists(a, a == "--evil"))",
+           R"(true)",
+       }) {
+    XCTAssertFalse([self requiredLiteralsFor:expression].has_value(), @"%s", expression);
+  }
+}
+
+- (void)testCreateWithoutConditionsDisablesFilter {
+  XCTAssertTrue(SignalPrefilter::Create({}) == nullptr);
+
+  ::santa::common::v1::Signal signal;
+  signal.set_name("no_condition");
+  std::string serialized;
+  XCTAssertTrue(signal.SerializeToString(&serialized));
+  XCTAssertTrue(SignalPrefilter::Create({serialized}) == nullptr);
+
+  XCTAssertTrue(SignalPrefilter::Create({std::string("\xff\xff\xff", 3)}) == nullptr);
+}
+
+- (void)testMayMatch {
+  SignalPrefilter prefilter({"EQHXZ8M8AV", "/tmp/evil"});
+  XCTAssertEqual(prefilter.NumLiterals(), 2);
+
+  std::string message("\x0a\x0a" "EQHXZ8M8AV" "\x10\x01", 14);
+  XCTAssertTrue(prefilter.MayMatch(reinterpret_cast<const uint8_t*>(message.data()),
+                                   message.size()));
+
+  std::string clean("\x0a\x07" "/bin/ls", 9);
+  XCTAssertFalse(
+      prefilter.MayMatch(reinterpret_cast<const uint8_t*>(clean.data()), clean.size()));
+}
+
+@end
@@ -26,6 +26,7 @@
 #import "Source/common/SNTSignal.h"
 #import "Source/common/SNTStoredSignalReport.h"
 #include "Source/common/ScopedFile.h"
+#include "Source/santad/SignalPrefilter.h"
 #include "Source/santad/SleighLauncher.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
@@ -39,6 +40,9 @@ namespace santa {
 // (which persists + uploads them).
 //
 // Scans run on a private serial queue so they never block the spool's queue.
+// Files that close while a scan is running are queued and scanned together by
+// the next Sleigh launch (up to kMaxFilesPerScan at a time), so throughput
+// scales with the batch size rather than with the cost of forking Sleigh.
 class SignalScanner : public std::enable_shared_from_this<SignalScanner> {
  public:
   using ReportHandlerBlock = void (^)(NSArray<SNTStoredSignalReport*>*);
@@ -55,12 +59,19 @@ class SignalScanner : public std::enable_shared_from_this<SignalScanner> {
   // Replace the in-memory signal set. Thread-safe.
   void SetSignals(NSArray<SNTSignal*>* signals);
 
+  // The prefilter for the current signal set, used by the spool to tag batches that can't match
+  // any signal. nullptr when the signals don't allow filtering. Thread-safe.
+  std::shared_ptr<const SignalPrefilter> Prefilter();
+
   // Asynchronously scan a just-closed spool file at `path`, read via `file` (a read-only fd open
-  // on it). Returns immediately; the scan runs on the private serial queue. A no-op when no
+  // on it). Returns immediately; the scan runs on the private serial queue, possibly batched
+  // with other pending files. A no-op when no
   // signals are configured or `file` is null. Holding `file` open lets the scan read the data
   // even if the telemetry exporter unlinks the path before the scan runs; the fd is closed when
-  // the scan completes.
-  void ScanFile(std::string path, std::shared_ptr<ScopedFile> file);
+  // the scan completes. A file that `clean_under`, the prefilter it was checked with, found
+  // nothing relevant in is skipped as long as the signal set hasn't changed since.
+  void ScanFile(std::string path, std::shared_ptr<ScopedFile> file,
+                std::shared_ptr<const SignalPrefilter> clean_under);
 
  private:
   // Private: SignalScanner relies on shared_from_this(), so it must only ever be owned by a
@@ -68,6 +79,17 @@ class SignalScanner : public std::enable_shared_from_this<SignalScanner> {
   SignalScanner(std::unique_ptr<SleighLauncher> sleigh_launcher, uint32_t timeout_secs,
                 ReportHandlerBlock report_handler, dispatch_queue_t scan_q);
 
+  struct PendingScan {
+    std::string path;
+    std::shared_ptr<ScopedFile> file;
+  };
+
+  // Scan pending files in batches until none remain. Runs on scan_q_.
+  void DrainPending();
+
+  // Run one Sleigh launch over the batch and hand any reports to report_handler_.
+  void ScanBatch(const std::vector<PendingScan>& batch, const std::string& signals);
+
   // Upper bound on opened-but-not-yet-scanned files. Each pending scan retains an open fd to a
   // closed spool file; scans run serially (one Sleigh fork at a time), so under sustained heavy
   // telemetry the backlog — and the retained fds — would otherwise grow without limit, exhausting
@@ -76,14 +98,26 @@ class SignalScanner : public std::enable_shared_from_this<SignalScanner> {
   // way the spool evicts its oldest files to stay bounded.
   static constexpr int kMaxInFlightScans = 100;
 
+  // Upper bound on spool files handed to a single Sleigh launch. Bounds the fds passed to the
+  // child and how much telemetry one scan (and its timeout) has to cover.
+  static constexpr size_t kMaxFilesPerScan = 16;
+
   std::unique_ptr<SleighLauncher> sleigh_launcher_;
   uint32_t timeout_secs_;
   ReportHandlerBlock report_handler_;
   dispatch_queue_t scan_q_;
   std::atomic<int> in_flight_{0};
   absl::Mutex lock_;
-  // Each entry is a serialized santa.common.v1.Signal.
-  std::vector<std::string> signals_ ABSL_GUARDED_BY(lock_);
+  // The current signal set, from SleighLauncher::PrepareSignalScanSignals. Shared with in-progress
+  // scans so a batch doesn't copy it; null when no signals are configured (or they failed to
+  // parse).
+  std::shared_ptr<const std::string> prepared_signals_ ABSL_GUARDED_BY(lock_);
+  // Derived from the same signal set as prepared_signals_.
+  std::shared_ptr<const SignalPrefilter> prefilter_ ABSL_GUARDED_BY(lock_);
+  // Files waiting for the next batch, oldest first.
+  std::vector<PendingScan> pending_ ABSL_GUARDED_BY(lock_);
+  // Whether a DrainPending call is queued or running on scan_q_.
+  bool drain_scheduled_ ABSL_GUARDED_BY(lock_) = false;
 };
 
 }  // namespace santa
@@ -14,6 +14,9 @@
 
 #include "Source/santad/SignalScanner.h"
 
+#include <algorithm>
+#include <iterator>
+
 #import "Source/common/SNTLogging.h"
 #include "absl/cleanup/cleanup.h"
 #include "absl/status/status.h"
@@ -56,20 +59,49 @@ void SignalScanner::SetSignals(NSArray<SNTSignal*>* signals) {
     v.emplace_back(static_cast<const char*>(data.bytes), data.length);
   }
 
+  // Parse and serialize the set once here, off the per-scan path. An empty set stays null so
+  // scans are skipped entirely.
+  std::shared_ptr<const std::string> prepared;
+  if (!v.empty()) {
+    absl::StatusOr<std::string> result = SleighLauncher::PrepareSignalScanSignals(v);
+    if (!result.ok()) {
+      LOGW(@"Failed to prepare %zu signals for scanning: %s", v.size(),
+           std::string(result.status().message()).c_str());
+    } else {
+      prepared = std::make_shared<const std::string>(*std::move(result));
+    }
+  }
+
+  std::shared_ptr<const SignalPrefilter> prefilter =
+      prepared ? SignalPrefilter::Create(v) : nullptr;
+
   absl::MutexLock lock(lock_);
-  signals_ = std::move(v);
+  prepared_signals_ = std::move(prepared);
+  prefilter_ = std::move(prefilter);
 }
 
-void SignalScanner::ScanFile(std::string path, std::shared_ptr<ScopedFile> file) {
+std::shared_ptr<const SignalPrefilter> SignalScanner::Prefilter() {
+  absl::MutexLock lock(lock_);
+  return prefilter_;
+}
+
+void SignalScanner::ScanFile(std::string path, std::shared_ptr<ScopedFile> file,
+                             std::shared_ptr<const SignalPrefilter> clean_under) {
   // No readable fd for the closed file (the spool layer's open failed): nothing to scan.
   if (!file) {
     return;
   }
 
+  // The file was checked against the current signal set and nothing in it can match. A file
+  // checked against an older set is scanned, since the new signals may match it.
+  if (clean_under && clean_under == Prefilter()) {
+    return;
+  }
+
   // Cap the number of opened-but-not-yet-scanned files (see kMaxInFlightScans). Checked here,
   // synchronously on the spool's queue, so an over-cap drop releases `file` (and its fd) right
-  // away instead of letting it sit in the scan queue. Scans run serially, so ScanFile is never
-  // called concurrently; only the decrement (below) races, which the atomic handles.
+  // away instead of letting it sit in the pending queue. ScanFile is never called concurrently;
+  // only the decrement (in DrainPending) races, which the atomic handles.
   if (in_flight_.fetch_add(1, std::memory_order_relaxed) >= kMaxInFlightScans) {
     in_flight_.fetch_sub(1, std::memory_order_relaxed);
     LOGW(@"Signal scan dropped for %s: already at %d in-flight scans", path.c_str(),
@@ -77,58 +109,96 @@ void SignalScanner::ScanFile(std::string path, std::shared_ptr<ScopedFile> file)
     return;
   }
 
+  {
+    absl::MutexLock lock(lock_);
+    pending_.push_back({std::move(path), std::move(file)});
+    // A drain already scheduled (or running) will pick this file up, batched with whatever else
+    // arrives before its next Sleigh launch.
+    if (drain_scheduled_) {
+      return;
+    }
+    drain_scheduled_ = true;
+  }
+
   auto shared_this = shared_from_this();
   dispatch_async(scan_q_, ^{
-    absl::Cleanup decrement = [shared_this] {
-      shared_this->in_flight_.fetch_sub(1, std::memory_order_relaxed);
-    };
+    shared_this->DrainPending();
+  });
+}
 
-    std::vector<std::string> signals;
+void SignalScanner::DrainPending() {
+  while (true) {
+    std::vector<PendingScan> batch;
+    std::shared_ptr<const std::string> signals;
     {
-      absl::MutexLock lock(shared_this->lock_);
-      signals = shared_this->signals_;
+      absl::MutexLock lock(lock_);
+      if (pending_.empty()) {
+        // Cleared under the same lock ScanFile checks it with, so a file queued after this point
+        // schedules a fresh drain.
+        drain_scheduled_ = false;
+        return;
+      }
+      size_t n = std::min(pending_.size(), kMaxFilesPerScan);
+      batch.assign(std::make_move_iterator(pending_.begin()),
+                   std::make_move_iterator(pending_.begin() + n));
+      pending_.erase(pending_.begin(), pending_.begin() + n);
+      signals = prepared_signals_;
     }
 
-    // Nothing configured: don't even launch Sleigh. (The captured `file` closes on return.)
-    if (signals.empty()) {
-      return;
-    }
+    // Release the batch's slots under kMaxInFlightScans once it has been scanned (or skipped).
+    absl::Cleanup decrement = [this, n = static_cast<int>(batch.size())] {
+      in_flight_.fetch_sub(n, std::memory_order_relaxed);
+    };
 
-    absl::StatusOr<::santa::telemetry::v1::SleighSignalScanResponse> response =
-        shared_this->sleigh_launcher_->LaunchSignalScan(file->UnsafeFD(), signals,
-                                                        shared_this->timeout_secs_);
-    if (!response.ok()) {
-      // Sleigh not installed (e.g. lite package) is accepted; don't warn.
-      if (!absl::IsNotFound(response.status())) {
-        LOGW(@"Signal scan failed for %s: %s", path.c_str(),
-             std::string(response.status().message()).c_str());
-      }
-      return;
+    // Nothing configured: don't even launch Sleigh. (The batch's files close on scope exit.)
+    if (!signals) {
+      continue;
     }
 
-    if (response->signal_reports_size() == 0) {
-      return;
-    }
+    ScanBatch(batch, *signals);
+  }
+}
 
-    NSMutableArray<SNTStoredSignalReport*>* reports = [NSMutableArray array];
-    for (const auto& report : response->signal_reports()) {
-      std::string bytes;
-      if (!report.SerializeToString(&bytes)) {
-        continue;
-      }
-      SNTStoredSignalReport* stored = [[SNTStoredSignalReport alloc]
-          initWithReportData:[NSData dataWithBytes:bytes.data() length:bytes.size()]];
-      if (stored) {
-        // Carry the signal name so the events database can deduplicate repeated firings.
-        stored.name = [NSString stringWithUTF8String:report.name().c_str()];
-        [reports addObject:stored];
-      }
+void SignalScanner::ScanBatch(const std::vector<PendingScan>& batch, const std::string& signals) {
+  std::vector<int> fds;
+  fds.reserve(batch.size());
+  for (const PendingScan& pending : batch) {
+    fds.push_back(pending.file->UnsafeFD());
+  }
+
+  absl::StatusOr<::santa::telemetry::v1::SleighSignalScanResponse> response =
+      sleigh_launcher_->LaunchSignalScan(fds, signals, timeout_secs_);
+  if (!response.ok()) {
+    // Sleigh not installed (e.g. lite package) is accepted; don't warn.
+    if (!absl::IsNotFound(response.status())) {
+      LOGW(@"Signal scan failed for %zu file(s) starting with %s: %s", batch.size(),
+           batch.front().path.c_str(), std::string(response.status().message()).c_str());
     }
+    return;
+  }
+
+  if (response->signal_reports_size() == 0) {
+    return;
+  }
 
-    if (reports.count > 0 && shared_this->report_handler_) {
-      shared_this->report_handler_(reports);
+  NSMutableArray<SNTStoredSignalReport*>* reports = [NSMutableArray array];
+  for (const auto& report : response->signal_reports()) {
+    std::string bytes;
+    if (!report.SerializeToString(&bytes)) {
+      continue;
     }
-  });
+    SNTStoredSignalReport* stored = [[SNTStoredSignalReport alloc]
+        initWithReportData:[NSData dataWithBytes:bytes.data() length:bytes.size()]];
+    if (stored) {
+      // Carry the signal name so the events database can deduplicate repeated firings.
+      stored.name = [NSString stringWithUTF8String:report.name().c_str()];
+      [reports addObject:stored];
+    }
+  }
+
+  if (reports.count > 0 && report_handler_) {
+    report_handler_(reports);
+  }
 }
 
 }  // namespace santa
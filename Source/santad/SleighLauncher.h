@@ -67,21 +67,30 @@ class SleighLauncher {
                      const std::vector<std::string>& filter_expressions,
                      uint32_t timeout_seconds);
 
-  // Signal scan: hand input_fd to a Sleigh child along with the detection
-  // signals to evaluate (each a serialized santa.common.v1.Signal), capture
+  // Parses serialized_signals (each a serialized santa.common.v1.Signal) and
+  // serializes them as a partial SleighConfig carrying only the signal scan's
+  // signals, for use with LaunchSignalScan. Callers prepare the signal set once
+  // when it changes rather than on every scan.
+  static absl::StatusOr<std::string> PrepareSignalScanSignals(
+      const std::vector<std::string>& serialized_signals);
+
+  // Signal scan: hand input_fds to a single Sleigh child along with the
+  // detection signals to evaluate (from PrepareSignalScanSignals), capture
   // Sleigh's stdout, and parse it as a SleighResponse. Sleigh uploads nothing;
-  // it only reports which signals matched. An empty/unparseable stdout, or a
-  // non-zero exit, is returned as an error. The caller passes signals in (from
-  // the synced signal_rules config); this method does not read configuration.
+  // it only reports which signals matched across all of the inputs. An
+  // empty/unparseable stdout, or a non-zero exit, is returned as an error. The
+  // caller passes signals in (from the synced signal_rules config); this method
+  // does not read configuration.
   //
-  // input_fd must be an already-open, readable fd positioned at offset 0. The
-  // caller retains ownership of input_fd (this method scans a dup of it);
-  // holding that fd open keeps the spool file's data readable even after the
-  // telemetry exporter unlinks the path, so the scan and export need no
-  // coordination.
+  // Each of input_fds must be an already-open, readable fd positioned at
+  // offset 0. The caller retains ownership of input_fds (this method scans
+  // dups of them); holding those fds open keeps the spool files' data readable
+  // even after the telemetry exporter unlinks the paths, so the scan and export
+  // need no coordination. Passing several fds amortizes the fork/exec and
+  // state-db open over a batch of spool files.
   virtual absl::StatusOr<::santa::telemetry::v1::SleighSignalScanResponse>
-  LaunchSignalScan(int input_fd,
-                   const std::vector<std::string>& serialized_signals,
+  LaunchSignalScan(const std::vector<int>& input_fds,
+                   const std::string& prepared_signals,
                    uint32_t timeout_seconds);
 
  protected:
@@ -108,8 +117,8 @@ class SleighLauncher {
       const std::vector<std::string>& filter_expressions);
 
   absl::StatusOr<std::string> SerializeSignalScanConfig(
-      int input_fd, int state_db_fd,
-      const std::vector<std::string>& serialized_signals);
+      const std::vector<int>& input_fds, int state_db_fd,
+      const std::string& prepared_signals);
 
   // Forks Sleigh, writes the serialized config to its stdin, optionally
   // captures its stdout, and waits up to timeout_secs (SIGKILL on timeout).
@@ -120,7 +120,8 @@ absl::StatusOr<::santa::commands::v1::BinaryUploadResponse> SleighLauncher::Laun
 }
 
 absl::StatusOr<::santa::telemetry::v1::SleighSignalScanResponse> SleighLauncher::LaunchSignalScan(
-    int input_fd, const std::vector<std::string>& serialized_signals, uint32_t timeout_secs) {
+    const std::vector<int>& input_fds, const std::string& prepared_signals,
+    uint32_t timeout_secs) {
   // Bail out with the same NotFound RunSleigh would return when Sleigh isn't installed (e.g. the
   // lite package). Checked up front so an unavailable/read-only /var/db/santa can't turn the
   // absent-Sleigh case into an InternalError from the state-db open below — callers rely on
@@ -129,14 +130,31 @@ absl::StatusOr<::santa::telemetry::v1::SleighSignalScanResponse> SleighLauncher:
     return absl::NotFoundError("Sleigh binary not executable: " + sleigh_path_);
   }
 
-  // Scan a dup: RunSleigh closes the fds it is handed, but the caller owns input_fd (it keeps the
-  // spool file's inode alive for the duration of the scan). The dup shares input_fd's offset,
-  // which the caller guarantees is at 0.
-  int fd = dup(input_fd);
-  if (fd < 0) {
-    LOGD(@"SleighLauncher::LaunchSignalScan(): Failed to dup input fd: %d", errno);
-    return absl::InternalError("Failed to dup signal scan input fd");
+  if (input_fds.empty()) {
+    return absl::InvalidArgumentError("No signal scan input fds");
+  }
+
+  // Scan dups: RunSleigh closes the fds it is handed, but the caller owns input_fds (they keep the
+  // spool files' inodes alive for the duration of the scan). Each dup shares its original's
+  // offset, which the caller guarantees is at 0. The state db fd is appended last.
+  std::vector<int> fds;
+  fds.reserve(input_fds.size() + 1);
+  // Closes our dups on the early returns below; cancelled once RunSleigh owns them.
+  absl::Cleanup close_fds = [&fds]() {
+    for (int fd : fds) {
+      close(fd);
+    }
+  };
+
+  for (int input_fd : input_fds) {
+    int fd = dup(input_fd);
+    if (fd < 0) {
+      LOGD(@"SleighLauncher::LaunchSignalScan(): Failed to dup input fd: %d", errno);
+      return absl::InternalError("Failed to dup signal scan input fd");
+    }
+    fds.push_back(fd);
   }
+  std::vector<int> scan_fds = fds;
 
   // Open Sleigh's state db (as root; /var/db/santa is root-owned). Read-write, created if absent —
   // a zero-length file is a valid empty boltdb (sleigh initializes it on first open). Sleigh drops
@@ -146,22 +164,19 @@ absl::StatusOr<::santa::telemetry::v1::SleighSignalScanResponse> SleighLauncher:
   if (state_fd < 0) {
     LOGD(@"SleighLauncher::LaunchSignalScan(): Failed to open state db %s: %d",
          state_db_path.c_str(), errno);
-    close(fd);
     return absl::InternalError("Failed to open signal scan state db");
   }
+  fds.push_back(state_fd);
 
   absl::StatusOr<std::string> serialized =
-      SerializeSignalScanConfig(fd, state_fd, serialized_signals);
+      SerializeSignalScanConfig(scan_fds, state_fd, prepared_signals);
   if (!serialized.ok()) {
-    // RunSleigh closes the fds on all later paths; on this pre-RunSleigh early return
-    // we still own them, so close them here to avoid leaking the descriptors.
-    close(fd);
-    close(state_fd);
     return serialized.status();
   }
 
+  std::move(close_fds).Cancel();
   absl::StatusOr<std::string> output =
-      RunSleigh(*serialized, {fd, state_fd}, timeout_secs, /*capture_stdout=*/true);
+      RunSleigh(*serialized, fds, timeout_secs, /*capture_stdout=*/true);
   if (!output.ok()) {
     return output.status();
   }
@@ -434,15 +449,10 @@ absl::StatusOr<std::string> SleighLauncher::SerializeBinaryUploadConfig(
   return serialized;
 }
 
-absl::StatusOr<std::string> SleighLauncher::SerializeSignalScanConfig(
-    int input_fd, int state_db_fd, const std::vector<std::string>& serialized_signals) {
+absl::StatusOr<std::string> SleighLauncher::PrepareSignalScanSignals(
+    const std::vector<std::string>& serialized_signals) {
   ::santa::telemetry::v1::SleighConfig config;
-  PopulateHostInfo(&config);
-
   auto* signal_scan = config.mutable_signal_scan();
-  signal_scan->add_input_fds(input_fd);
-  signal_scan->set_state_db_fd(state_db_fd);
-
   for (const auto& serialized_signal : serialized_signals) {
     ::santa::common::v1::Signal* signal = signal_scan->add_signals();
     if (!signal->ParseFromString(serialized_signal)) {
@@ -457,4 +467,26 @@ absl::StatusOr<std::string> SleighLauncher::SerializeSignalScanConfig(
   return serialized;
 }
 
+absl::StatusOr<std::string> SleighLauncher::SerializeSignalScanConfig(
+    const std::vector<int>& input_fds, int state_db_fd, const std::string& prepared_signals) {
+  ::santa::telemetry::v1::SleighConfig config;
+  PopulateHostInfo(&config);
+
+  auto* signal_scan = config.mutable_signal_scan();
+  for (int fd : input_fds) {
+    signal_scan->add_input_fds(fd);
+  }
+  signal_scan->set_state_db_fd(state_db_fd);
+
+  std::string serialized;
+  if (!config.SerializeToString(&serialized)) {
+    return absl::UnknownError("Failed to serialize SleighConfig proto");
+  }
+  // Concatenated serialized messages parse as their merge, and an embedded message field that
+  // appears twice (signal_scan) is merged field by field, so the prepared signals land in this
+  // config's signal_scan without being parsed and re-serialized on every launch.
+  serialized.append(prepared_signals);
+  return serialized;
+}
+
 }  // namespace santa
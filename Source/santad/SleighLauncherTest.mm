@@ -24,6 +24,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "commands/v1.pb.h"
+#include "common/signals.pb.h"
 #include "telemetry/sleighconfig.pb.h"
 
 // These tests drive the real fork/stdin/stdout machinery in SleighLauncher in any
@@ -152,4 +153,35 @@ class TestableSleighLauncher : public santa::SleighLauncher {
                            // SerializeTelemetryUploadConfig.
 }
 
+// Prepared signals are appended to a per-launch config carrying the scan's fds; the two must
+// parse back as a single merged signal_scan.
+- (void)testPreparedSignalsMergeIntoScanConfig {
+  std::string signal;
+  XCTAssertTrue(::santa::common::v1::Signal().SerializeToString(&signal));
+  absl::StatusOr<std::string> prepared =
+      santa::SleighLauncher::PrepareSignalScanSignals({signal, signal});
+  XCTAssertTrue(prepared.ok());
+
+  ::santa::telemetry::v1::SleighConfig launch;
+  launch.mutable_signal_scan()->add_input_fds(3);
+  launch.mutable_signal_scan()->add_input_fds(4);
+  launch.mutable_signal_scan()->set_state_db_fd(5);
+  std::string serialized;
+  XCTAssertTrue(launch.SerializeToString(&serialized));
+  serialized.append(*prepared);
+
+  ::santa::telemetry::v1::SleighConfig parsed;
+  XCTAssertTrue(parsed.ParseFromString(serialized));
+  XCTAssertEqual(parsed.signal_scan().input_fds_size(), 2);
+  XCTAssertEqual(parsed.signal_scan().state_db_fd(), 5);
+  XCTAssertEqual(parsed.signal_scan().signals_size(), 2);
+}
+
+- (void)testPrepareSignalScanSignalsRejectsInvalidSignal {
+  absl::StatusOr<std::string> prepared =
+      santa::SleighLauncher::PrepareSignalScanSignals({std::string("\xff\xff\xff", 3)});
+  XCTAssertFalse(prepared.ok());
+  XCTAssertEqual(prepared.status().code(), absl::StatusCode::kInvalidArgument);
+}
+
 @end
@@ -21,16 +21,34 @@
 #include <dispatch/dispatch.h>
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/container/flat_hash_map.h"
 
 namespace santa {
 
 // Small helper class to synchronize writing to TTYs
+//
+// Writes are made without blocking, so a terminal that stops reading only
+// ever holds up its own messages. Within each interval, repeats of the last
+// message written to a TTY are counted rather than written, and only a
+// limited number of distinct messages are written, with the rest counted.
+// The counts are written as a summary when the interval ends.
 class TTYWriter {
  public:
+  static constexpr uint64_t kCoalesceIntervalNS = NSEC_PER_SEC;
+  static constexpr size_t kMaxMessagesPerInterval = 10;
+  // Messages that would grow a TTY's unwritten output past this are dropped.
+  static constexpr size_t kMaxBufferedBytes = 64 * 1024;
+
   static std::unique_ptr<TTYWriter> Create(bool silent_tty_mode);
 
-  TTYWriter(dispatch_queue_t q, bool silent_tty_mode);
+  TTYWriter(dispatch_queue_t q, bool silent_tty_mode,
+            uint64_t coalesce_interval_ns = kCoalesceIntervalNS);
 
   // Moves can be safe, but not currently needed/implemented
   TTYWriter(TTYWriter&& other) = delete;
@@ -54,15 +72,39 @@ class TTYWriter {
 
   // Virtual so deleting a derived instance (e.g. a test double) through a TTYWriter* is
   // well-defined once the class has virtual methods; public so unique_ptr/shared_ptr
-  // deleters can reach it.
-  virtual ~TTYWriter() = default;
+  // deleters can reach it. Output still waiting for a TTY is discarded.
+  virtual ~TTYWriter();
 
  private:
   void Write(const es_process_t* proc, bool send_signal, NSString* (^messageCreator)(void));
   void Write(NSString* ttyPath, bool send_signal, NSString* (^messageCreator)(void));
 
+  // State for a TTY with a coalescing interval in progress. Only accessed on q_.
+  struct TTYState {
+    int fd = -1;
+    // Set while waiting for the TTY to accept more output.
+    dispatch_source_t write_source = nil;
+    // Fires at the end of each interval.
+    dispatch_source_t interval_timer = nil;
+    std::string buffer;
+    bool signal_pending = false;
+    std::string last_message;
+    size_t messages = 0;
+    size_t repeats = 0;
+    size_t suppressed = 0;
+  };
+
+  void EnqueueSerialized(const std::string& tty, std::string msg, bool send_signal);
+  void EndIntervalSerialized(const std::string& tty);
+  void AppendSerialized(const std::string& tty, TTYState& state, std::string_view data,
+                        bool send_signal);
+  void FlushSerialized(const std::string& tty, TTYState& state);
+  void CloseSerialized(TTYState& state);
+
   dispatch_queue_t q_;
   std::atomic<bool> silent_tty_mode_;
+  uint64_t coalesce_interval_ns_;
+  absl::flat_hash_map<std::string, TTYState> ttys_;
 };
 
 }  // namespace santa
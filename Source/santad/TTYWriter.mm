@@ -15,11 +15,16 @@
 
 #include "Source/santad/TTYWriter.h"
 
+#include <fcntl.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/errno.h>
 #include <sys/ioctl.h>
 #include <sys/param.h>
+#include <unistd.h>
+
+#include <string>
+#include <string_view>
 
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
@@ -40,8 +45,22 @@ std::unique_ptr<TTYWriter> TTYWriter::Create(bool silent_tty_mode) {
   return std::make_unique<TTYWriter>(q, silent_tty_mode);
 }
 
-TTYWriter::TTYWriter(dispatch_queue_t q, bool silent_tty_mode)
-    : q_(q), silent_tty_mode_(silent_tty_mode) {}
+TTYWriter::TTYWriter(dispatch_queue_t q, bool silent_tty_mode, uint64_t coalesce_interval_ns)
+    : q_(q), silent_tty_mode_(silent_tty_mode), coalesce_interval_ns_(coalesce_interval_ns) {}
+
+TTYWriter::~TTYWriter() {
+  // The timers and write sources call back into this object, so they're
+  // cancelled on the queue they run on.
+  dispatch_sync(q_, ^{
+    for (auto& [tty, state] : ttys_) {
+      dispatch_source_cancel(state.interval_timer);
+      state.buffer.clear();
+      state.signal_pending = false;
+      CloseSerialized(state);
+    }
+    ttys_.clear();
+  });
+}
 
 bool TTYWriter::CanWrite(const es_process_t* proc) {
   return proc && proc->tty && proc->tty->path.length > 0;
@@ -66,30 +85,165 @@ void TTYWriter::Write(NSString* ttyPath, bool send_signal, NSString* (^messageCr
   msg = [msg stringByAppendingFormat:@"\n"];
 
   dispatch_async(q_, ^{
-    int fd = open(tty.UTF8String, O_WRONLY | O_NOCTTY);
-    if (fd == -1) {
+    EnqueueSerialized(santa::NSStringToUTF8String(tty), santa::NSStringToUTF8String(msg),
+                      send_signal);
+  });
+}
+
+void TTYWriter::EnqueueSerialized(const std::string& tty, std::string msg, bool send_signal) {
+  TTYState& state = ttys_[tty];
+  if (!state.interval_timer) {
+    state.interval_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q_);
+    std::string key = tty;
+    dispatch_source_set_event_handler(state.interval_timer, ^{
+      EndIntervalSerialized(key);
+    });
+    dispatch_source_set_timer(state.interval_timer,
+                              dispatch_time(DISPATCH_TIME_NOW, coalesce_interval_ns_),
+                              coalesce_interval_ns_, coalesce_interval_ns_ / 10);
+    dispatch_resume(state.interval_timer);
+  }
+
+  if (msg == state.last_message) {
+    state.repeats++;
+    return;
+  }
+  if (state.messages >= kMaxMessagesPerInterval) {
+    state.suppressed++;
+    return;
+  }
+
+  if (state.repeats) {
+    AppendSerialized(tty, state,
+                     "(last message repeated " + std::to_string(state.repeats) + " more times)\n",
+                     false);
+    state.repeats = 0;
+  }
+  state.messages++;
+  AppendSerialized(tty, state, msg, send_signal);
+  state.last_message = std::move(msg);
+}
+
+void TTYWriter::EndIntervalSerialized(const std::string& tty) {
+  auto it = ttys_.find(tty);
+  if (it == ttys_.end()) {
+    return;
+  }
+  TTYState& state = it->second;
+
+  if (!state.repeats && !state.suppressed) {
+    // Nothing was held back, so the next message is written out in full.
+    // Stop tracking the TTY once it has taken everything written to it.
+    if (state.buffer.empty()) {
+      dispatch_source_cancel(state.interval_timer);
+      CloseSerialized(state);
+      ttys_.erase(it);
+    } else {
+      state.messages = 0;
+      state.last_message.clear();
+    }
+    return;
+  }
+
+  std::string summary;
+  if (state.repeats) {
+    summary += "(last message repeated " + std::to_string(state.repeats) + " more times)\n";
+  }
+  if (state.suppressed) {
+    summary += "(" + std::to_string(state.suppressed) + " more messages suppressed)\n";
+  }
+  state.messages = 0;
+  state.repeats = 0;
+  state.suppressed = 0;
+  AppendSerialized(tty, state, summary, false);
+}
+
+void TTYWriter::AppendSerialized(const std::string& tty, TTYState& state, std::string_view data,
+                                 bool send_signal) {
+  if (state.buffer.size() + data.size() > kMaxBufferedBytes) {
+    LOGD(@"TTY %s is not accepting output, dropping message", tty.c_str());
+    return;
+  }
+  state.buffer.append(data);
+  state.signal_pending |= send_signal;
+
+  // Otherwise the write source flushes once the TTY can take more
+  if (!state.write_source) {
+    FlushSerialized(tty, state);
+  }
+}
+
+void TTYWriter::FlushSerialized(const std::string& tty, TTYState& state) {
+  if (state.fd == -1) {
+    state.fd = open(tty.c_str(), O_WRONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (state.fd == -1) {
       LOGW(@"Failed to open TTY for writing: %s", strerror(errno));
+      state.buffer.clear();
+      state.signal_pending = false;
       return;
     }
+  }
 
-    std::string_view str = santa::NSStringToUTF8StringView(msg);
-    write(fd, str.data(), str.length());
-
-    // Send SIGWINCH to the foreground process group to trigger a shell prompt redraw.
-    // Without this, the prompt gets "buried" above our message because the shell
-    // redraws its prompt when the blocked process exits, but our async write
-    // happens after that.
-    pid_t pgrp = 0;
-    if (send_signal) {
-      ioctl(fd, TIOCGPGRP, &pgrp);
+  while (!state.buffer.empty()) {
+    ssize_t n = write(state.fd, state.buffer.data(), state.buffer.size());
+    if (n > 0) {
+      state.buffer.erase(0, n);
+    } else if (n == -1 && errno == EINTR) {
+      continue;
+    } else if (n == -1 && errno == EAGAIN) {
+      if (!state.write_source) {
+        state.write_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_WRITE, state.fd, 0, q_);
+        std::string key = tty;
+        dispatch_source_set_event_handler(state.write_source, ^{
+          auto it = ttys_.find(key);
+          if (it != ttys_.end()) {
+            FlushSerialized(key, it->second);
+          }
+        });
+        dispatch_resume(state.write_source);
+      }
+      return;
+    } else {
+      LOGW(@"Failed to write to TTY: %s", strerror(errno));
+      state.buffer.clear();
+      break;
     }
+  }
 
-    close(fd);
+  CloseSerialized(state);
+}
 
-    if (send_signal && pgrp > 1) {
-      kill(-pgrp, SIGWINCH);
-    }
-  });
+void TTYWriter::CloseSerialized(TTYState& state) {
+  if (state.fd == -1) {
+    return;
+  }
+
+  // Send SIGWINCH to the foreground process group to trigger a shell prompt redraw.
+  // Without this, the prompt gets "buried" above our message because the shell
+  // redraws its prompt when the blocked process exits, but our async write
+  // happens after that.
+  pid_t pgrp = 0;
+  if (state.signal_pending) {
+    ioctl(state.fd, TIOCGPGRP, &pgrp);
+    state.signal_pending = false;
+  }
+
+  if (state.write_source) {
+    // The descriptor must stay open until the source is done with it
+    int fd = state.fd;
+    dispatch_source_set_cancel_handler(state.write_source, ^{
+      close(fd);
+    });
+    dispatch_source_cancel(state.write_source);
+    state.write_source = nil;
+  } else {
+    close(state.fd);
+  }
+  state.fd = -1;
+
+  if (pgrp > 1) {
+    kill(-pgrp, SIGWINCH);
+  }
 }
 
 void TTYWriter::Write(const es_process_t* proc, bool send_signal,
@@ -89,4 +89,55 @@ using santa::TTYWriter;
   XCTAssertTrue([got containsString:@"still-works"], @"got: %@", got);
 }
 
+- (void)testRepeatedMessagesAreCoalesced {
+  dispatch_queue_t q =
+      dispatch_queue_create("com.northpolesec.santa.ttywritertest", DISPATCH_QUEUE_SERIAL);
+  TTYWriter writer(q, /*silent_tty_mode=*/false, 50 * NSEC_PER_MSEC);
+  NSString* path = [self tempPathNamed:@"ttywriter-coalesce.txt"];
+
+  for (int i = 0; i < 5; i++) {
+    writer.WriteWithoutSignal(path, @"blocked");
+  }
+  dispatch_sync(q, ^{
+                });
+
+  // Only the first is written right away
+  XCTAssertEqualObjects([self contentsAtPath:path], @"blocked\n");
+
+  // The rest are counted when the interval ends
+  [NSThread sleepForTimeInterval:0.2];
+  dispatch_sync(q, ^{
+                });
+  XCTAssertEqualObjects([self contentsAtPath:path],
+                        @"blocked\n(last message repeated 4 more times)\n");
+}
+
+- (void)testDistinctMessagesAreRateLimited {
+  dispatch_queue_t q =
+      dispatch_queue_create("com.northpolesec.santa.ttywritertest", DISPATCH_QUEUE_SERIAL);
+  TTYWriter writer(q, /*silent_tty_mode=*/false, 50 * NSEC_PER_MSEC);
+  NSString* path = [self tempPathNamed:@"ttywriter-ratelimit.txt"];
+
+  size_t total = TTYWriter::kMaxMessagesPerInterval + 5;
+  for (size_t i = 0; i < total; i++) {
+    writer.WriteWithoutSignal(path, [NSString stringWithFormat:@"msg-%zu", i]);
+  }
+  dispatch_sync(q, ^{
+                });
+
+  NSString* got = [self contentsAtPath:path];
+  NSString* lastWritten =
+      [NSString stringWithFormat:@"msg-%zu\n", TTYWriter::kMaxMessagesPerInterval - 1];
+  NSString* firstDropped =
+      [NSString stringWithFormat:@"msg-%zu\n", TTYWriter::kMaxMessagesPerInterval];
+  XCTAssertTrue([got containsString:lastWritten], @"got: %@", got);
+  XCTAssertFalse([got containsString:firstDropped], @"got: %@", got);
+
+  [NSThread sleepForTimeInterval:0.2];
+  dispatch_sync(q, ^{
+                });
+  got = [self contentsAtPath:path];
+  XCTAssertTrue([got containsString:@"(5 more messages suppressed)\n"], @"got: %@", got);
+}
+
 @end
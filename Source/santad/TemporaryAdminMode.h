@@ -58,7 +58,9 @@ class TemporaryAdminMode : public TimedSyncSession, public PassKey<TemporaryAdmi
   uint32_t RequestMinutes(NSNumber* requested_duration, uid_t uid, NSString* username,
                           NSError** err);
 
-  // Whether `uid` is currently a member of the admin group.
+  // Whether `uid` is currently a member of the admin group. Answers from the
+  // membership cache so GUI queries don't block on directory services; the
+  // grant path checks live membership itself.
   bool IsCurrentlyAdmin(uid_t uid);
 
   // On a Revoke policy, cancel any active session; always re-notify GUI availability.
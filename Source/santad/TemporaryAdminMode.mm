@@ -48,7 +48,7 @@ TemporaryAdminMode::TemporaryAdminMode(PassKey, SNTConfigurator* configurator,
       target_uid_(0) {}
 
 bool TemporaryAdminMode::IsCurrentlyAdmin(uid_t uid) {
-  return membership_->IsMember(uid);
+  return membership_->IsMemberCached(uid);
 }
 
 uint32_t TemporaryAdminMode::RequestMinutes(NSNumber* requested_duration, uid_t uid,
@@ -47,7 +47,7 @@ TimedSyncSession::TimedSyncSession(uint32_t min_minutes, uint32_t max_minutes, c
     // in seconds. Convert here so the min/max clamp reflects the real bounds
     // instead of treating a minute count as a second count.
     : Timer(min_minutes * 60, max_minutes * 60, Timer::OnStart::kWaitOneCycle, label,
-            Timer::RescheduleMode::kTrailingEdge, QOS_CLASS_USER_INITIATED),
+            Timer::RescheduleMode::kTrailingEdge, QOS_CLASS_USER_INITIATED, Timer::Leeway::kStrict),
       configurator_(configurator),
       notification_queue_(notification_queue),
       deadline_(0),
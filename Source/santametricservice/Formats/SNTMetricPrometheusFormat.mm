@@ -0,0 +1,225 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/santametricservice/Formats/SNTMetricPrometheusFormat.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#import "Source/common/SNTLogging.h"
+#import "Source/common/SNTMetricSet.h"
+
+// Counters are expected to carry this suffix.
+static constexpr std::string_view kCounterSuffix = "_total";
+
+// Metric and label names may only contain [a-zA-Z0-9_] and may not start with
+// a digit. Santa metric names are paths, e.g. /santa/events becomes
+// santa_events.
+static void AppendName(std::string& out, NSString* name) {
+  size_t start = out.size();
+  for (const char* c = name.UTF8String; *c; c++) {
+    bool valid = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+                 (*c >= '0' && *c <= '9') || *c == '_';
+    if (!valid) {
+      // Drop separators before the first character of the name
+      if (out.size() != start) {
+        out.push_back('_');
+      }
+    } else {
+      if (out.size() == start && *c >= '0' && *c <= '9') {
+        out.push_back('_');
+      }
+      out.push_back(*c);
+    }
+  }
+}
+
+static void AppendEscaped(std::string& out, NSString* str, bool escapeQuotes) {
+  for (const char* c = str.UTF8String; *c; c++) {
+    switch (*c) {
+      case '\\': out.append("\\\\"); break;
+      case '\n': out.append("\\n"); break;
+      case '"':
+        if (escapeQuotes) {
+          out.append("\\\"");
+          break;
+        }
+        [[fallthrough]];
+      default: out.push_back(*c); break;
+    }
+  }
+}
+
+static void AppendLabel(std::string& out, bool* first, NSString* name, NSString* value) {
+  out.push_back(*first ? '{' : ',');
+  *first = false;
+  AppendName(out, name);
+  out.append("=\"");
+  AppendEscaped(out, value, true);
+  out.push_back('"');
+}
+
+static void AppendDouble(std::string& out, double value) {
+  if (std::isnan(value)) {
+    out.append("NaN");
+  } else if (std::isinf(value)) {
+    out.append(value > 0 ? "+Inf" : "-Inf");
+  } else {
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "%.17g", value);
+    out.append(buf, len);
+  }
+}
+
+static void AppendInt64(std::string& out, long long value) {
+  char buf[24];
+  int len = snprintf(buf, sizeof(buf), "%lld", value);
+  out.append(buf, len);
+}
+
+static const char* TypeForMetricType(SNTMetricType type) {
+  switch (type) {
+    case SNTMetricTypeCounter: return "counter";
+    case SNTMetricTypeConstantBool:
+    case SNTMetricTypeConstantString:
+    case SNTMetricTypeConstantInt64:
+    case SNTMetricTypeConstantDouble:
+    case SNTMetricTypeGaugeBool:
+    case SNTMetricTypeGaugeString:
+    case SNTMetricTypeGaugeInt64:
+    case SNTMetricTypeGaugeDouble: return "gauge";
+    default: return nullptr;
+  }
+}
+
+@implementation SNTMetricPrometheusFormat {
+  // Reused between exports so the output doesn't have to grow from scratch
+  // each time. Guarded by @synchronized(self).
+  std::string _buffer;
+}
+
+- (void)appendMetric:(NSString*)name
+           withValue:(NSDictionary*)metric
+          rootLabels:(NSDictionary<NSString*, NSString*>*)rootLabels {
+  SNTMetricType type = (SNTMetricType)[metric[@"type"] integerValue];
+  const char* typeName = TypeForMetricType(type);
+  if (!typeName) {
+    LOGE(@"encountered unknown SNTMetricType - %ld for %@", (long)type, name);
+    return;
+  }
+
+  std::string& out = _buffer;
+
+  // Render the name once and copy it into each sample
+  std::string metricName;
+  AppendName(metricName, name);
+  if (type == SNTMetricTypeCounter && !metricName.ends_with(kCounterSuffix)) {
+    metricName.append(kCounterSuffix);
+  }
+
+  if ([metric[@"description"] length]) {
+    out.append("# HELP ").append(metricName).push_back(' ');
+    AppendEscaped(out, metric[@"description"], false);
+    out.push_back('\n');
+  }
+  out.append("# TYPE ").append(metricName).push_back(' ');
+  out.append(typeName).push_back('\n');
+
+  NSArray<NSString*>* sortedRootLabels =
+      [[rootLabels allKeys] sortedArrayUsingSelector:@selector(compare:)];
+
+  for (NSString* fieldName in metric[@"fields"]) {
+    // We encode multiple fields as a single comma separated string.
+    NSArray<NSString*>* fieldNames =
+        fieldName.length ? [fieldName componentsSeparatedByString:@","] : @[];
+
+    // Sort samples by their field values so output is stable between exports
+    NSArray<NSDictionary*>* entries = [metric[@"fields"][fieldName]
+        sortedArrayUsingComparator:^NSComparisonResult(NSDictionary* lhs, NSDictionary* rhs) {
+          return [lhs[@"value"] compare:rhs[@"value"]];
+        }];
+
+    for (NSDictionary* entry in entries) {
+      NSArray<NSString*>* fieldValues =
+          fieldNames.count ? [entry[@"value"] componentsSeparatedByString:@","] : @[];
+      if (fieldNames.count != fieldValues.count) {
+        LOGE(@"malformed metric data encountered: %@", fieldName);
+        continue;
+      }
+
+      out.append(metricName);
+
+      bool first = true;
+      for (NSString* label in sortedRootLabels) {
+        AppendLabel(out, &first, label, rootLabels[label]);
+      }
+      for (NSUInteger i = 0; i < fieldNames.count; i++) {
+        AppendLabel(out, &first, fieldNames[i], fieldValues[i]);
+      }
+
+      // Samples can only hold numbers, so strings are exported as a label on
+      // a gauge that is always 1.
+      if (type == SNTMetricTypeConstantString || type == SNTMetricTypeGaugeString) {
+        AppendLabel(out, &first, @"value", entry[@"data"]);
+      }
+      if (!first) {
+        out.push_back('}');
+      }
+      out.push_back(' ');
+
+      switch (type) {
+        case SNTMetricTypeConstantBool:
+        case SNTMetricTypeGaugeBool: out.push_back([entry[@"data"] boolValue] ? '1' : '0'); break;
+        case SNTMetricTypeConstantDouble:
+        case SNTMetricTypeGaugeDouble: AppendDouble(out, [entry[@"data"] doubleValue]); break;
+        case SNTMetricTypeConstantString:
+        case SNTMetricTypeGaugeString: out.push_back('1'); break;
+        default: AppendInt64(out, [entry[@"data"] longLongValue]); break;
+      }
+      out.push_back('\n');
+    }
+  }
+}
+
+/*
+ * Convert renders the metrics dictionary in the Prometheus text exposition
+ * format. Root labels are added to every sample. Timestamps are omitted, as
+ * the textfile collector rejects them.
+ *
+ * @param metrics an NSDictionary exported by the SNTMetricSet
+ * @param error a pointer to an NSError to allow errors to bubble up.
+ *
+ * Returns an NSArray containing one entry of all metrics.
+ */
+- (NSArray<NSData*>*)convert:(NSDictionary*)metrics
+                endTimestamp:(NSDate*)endTimestamp
+                       error:(NSError**)err {
+  @synchronized(self) {
+    _buffer.clear();
+
+    NSArray<NSString*>* names =
+        [[metrics[@"metrics"] allKeys] sortedArrayUsingSelector:@selector(compare:)];
+    for (NSString* name in names) {
+      [self appendMetric:name
+               withValue:metrics[@"metrics"][name]
+              rootLabels:metrics[@"root_labels"]];
+    }
+
+    return @[ [NSData dataWithBytes:_buffer.data() length:_buffer.size()] ];
+  }
+}
+
+@end
@@ -0,0 +1,87 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import <Foundation/Foundation.h>
+#import "Source/common/SNTMetricSet.h"
+#import "Source/santametricservice/Formats/SNTMetricFormatTestHelper.h"
+#import "Source/santametricservice/Formats/SNTMetricPrometheusFormat.h"
+
+@interface SNTMetricPrometheusFormatTest : XCTestCase
+@end
+
+@implementation SNTMetricPrometheusFormatTest
+
+- (void)testMetricsConversionToPrometheusText {
+  NSDictionary* validMetricsDict = [SNTMetricFormatTestHelper createValidMetricsDictionary];
+  SNTMetricPrometheusFormat* formatter = [[SNTMetricPrometheusFormat alloc] init];
+  NSError* err = nil;
+  NSArray<NSData*>* output = [formatter convert:validMetricsDict
+                                   endTimestamp:[NSDate date]
+                                          error:&err];
+
+  XCTAssertEqual(1, output.count);
+  XCTAssertNil(err);
+
+  NSString* path = [[NSBundle bundleForClass:[self class]] resourcePath];
+  path = [path stringByAppendingPathComponent:@"testdata/prometheus/metrics.prom"];
+
+  NSData* goldenFileData = [NSData dataWithContentsOfFile:path];
+  XCTAssertNotNil(goldenFileData, @"unable to open / read golden file");
+
+  XCTAssertEqualObjects([[NSString alloc] initWithData:goldenFileData
+                                              encoding:NSUTF8StringEncoding],
+                        [[NSString alloc] initWithData:output[0] encoding:NSUTF8StringEncoding]);
+
+  // The reused buffer must not leak output between exports
+  NSArray<NSData*>* second = [formatter convert:validMetricsDict
+                                   endTimestamp:[NSDate date]
+                                          error:&err];
+  XCTAssertEqualObjects(output[0], second[0]);
+}
+
+- (void)testEscaping {
+  NSDictionary* metrics = @{
+    @"root_labels" : @{@"hostname" : @"host\"1\\"},
+    @"metrics" : @{
+      @"/santa/9lives-count" : @{
+        @"type" : @(SNTMetricTypeGaugeString),
+        @"description" : @"Line one\nline \"two\"",
+        @"fields" : @{
+          @"" : @[ @{@"value" : @"", @"data" : @"a\nb"} ],
+        },
+      },
+    },
+  };
+
+  SNTMetricPrometheusFormat* formatter = [[SNTMetricPrometheusFormat alloc] init];
+  NSArray<NSData*>* output = [formatter convert:metrics endTimestamp:[NSDate date] error:nil];
+
+  NSString* want = @"# HELP santa_9lives_count Line one\\nline \"two\"\n"
+                   @"# TYPE santa_9lives_count gauge\n"
+                   @"santa_9lives_count{hostname=\"host\\\"1\\\\\",value=\"a\\nb\"} 1\n";
+  XCTAssertEqualObjects([[NSString alloc] initWithData:output[0] encoding:NSUTF8StringEncoding],
+                        want);
+}
+
+- (void)testPassingANilOrNullErrorDoesNotCrash {
+  SNTMetricPrometheusFormat* formatter = [[SNTMetricPrometheusFormat alloc] init];
+  NSDictionary* validMetricsDict = [SNTMetricFormatTestHelper createValidMetricsDictionary];
+
+  [formatter convert:validMetricsDict endTimestamp:[NSDate date] error:nil];
+  [formatter convert:validMetricsDict endTimestamp:[NSDate date] error:NULL];
+}
+
+@end
@@ -0,0 +1,37 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/// Tracks the metric values last exported successfully so that later exports
+/// only need to include the values that have changed since.
+@interface SNTMetricDeltaTracker : NSObject
+
+/// Designated initializer. A full export is made at least once per interval so
+/// that receivers can recover from values they may have missed.
+- (instancetype)initWithFullExportInterval:(NSTimeInterval)interval NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns a copy of the exported metrics dictionary holding only the field
+/// values that changed since the last recorded export. Every value is returned
+/// if nothing has been recorded yet or a full export is due. Returns nil if
+/// nothing changed.
+- (NSDictionary*)changedMetrics:(NSDictionary*)metrics;
+
+/// Record that metrics, a complete export dictionary, has been exported
+/// successfully. Until this is called, changedMetrics: keeps including every
+/// value changed since the previous successful export.
+- (void)recordExportedMetrics:(NSDictionary*)metrics;
+
+@end
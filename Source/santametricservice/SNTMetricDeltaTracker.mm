@@ -0,0 +1,101 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import "Source/santametricservice/SNTMetricDeltaTracker.h"
+
+static NSString* BaselineKey(NSString* metricName, NSString* fieldName, NSDictionary* value) {
+  return [NSString stringWithFormat:@"%@|%@|%@", metricName, fieldName, value[@"value"]];
+}
+
+@implementation SNTMetricDeltaTracker {
+  NSTimeInterval _fullExportInterval;
+  NSDate* _lastFullExport;
+  BOOL _fullExportPending;
+  // Maps a metric name, field names and field values to the last data exported
+  NSMutableDictionary<NSString*, id>* _baseline;
+}
+
+- (instancetype)initWithFullExportInterval:(NSTimeInterval)interval {
+  self = [super init];
+  if (self) {
+    _fullExportInterval = interval;
+    _baseline = [NSMutableDictionary dictionary];
+  }
+  return self;
+}
+
+- (NSDictionary*)changedMetrics:(NSDictionary*)metrics {
+  @synchronized(self) {
+    if (!_lastFullExport ||
+        [[NSDate date] timeIntervalSinceDate:_lastFullExport] >= _fullExportInterval) {
+      _fullExportPending = YES;
+      return metrics;
+    }
+    _fullExportPending = NO;
+
+    NSMutableDictionary* changed = [NSMutableDictionary dictionary];
+    [metrics[@"metrics"] enumerateKeysAndObjectsUsingBlock:^(NSString* metricName,
+                                                             NSDictionary* metric, BOOL* stop) {
+      NSMutableDictionary* fields = [NSMutableDictionary dictionary];
+      [metric[@"fields"] enumerateKeysAndObjectsUsingBlock:^(
+                             NSString* fieldName, NSArray<NSDictionary*>* values, BOOL* stop) {
+        NSMutableArray* changedValues = [NSMutableArray array];
+        for (NSDictionary* value in values) {
+          id previous = self->_baseline[BaselineKey(metricName, fieldName, value)];
+          if (![previous isEqual:value[@"data"]]) {
+            [changedValues addObject:value];
+          }
+        }
+        if (changedValues.count) {
+          fields[fieldName] = changedValues;
+        }
+      }];
+
+      if (fields.count) {
+        NSMutableDictionary* changedMetric = [metric mutableCopy];
+        changedMetric[@"fields"] = fields;
+        changed[metricName] = changedMetric;
+      }
+    }];
+
+    if (!changed.count) {
+      return nil;
+    }
+
+    NSMutableDictionary* delta = [metrics mutableCopy];
+    delta[@"metrics"] = changed;
+    return delta;
+  }
+}
+
+- (void)recordExportedMetrics:(NSDictionary*)metrics {
+  @synchronized(self) {
+    if (_fullExportPending) {
+      _lastFullExport = [NSDate date];
+      _fullExportPending = NO;
+    }
+
+    [metrics[@"metrics"] enumerateKeysAndObjectsUsingBlock:^(NSString* metricName,
+                                                             NSDictionary* metric, BOOL* stop) {
+      [metric[@"fields"] enumerateKeysAndObjectsUsingBlock:^(
+                             NSString* fieldName, NSArray<NSDictionary*>* values, BOOL* stop) {
+        for (NSDictionary* value in values) {
+          self->_baseline[BaselineKey(metricName, fieldName, value)] = value[@"data"];
+        }
+      }];
+    }];
+  }
+}
+
+@end
@@ -0,0 +1,108 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+
+#import "Source/common/SNTMetricSet.h"
+#import "Source/santametricservice/SNTMetricDeltaTracker.h"
+
+@interface SNTMetricDeltaTrackerTest : XCTestCase
+@property SNTMetricSet* metricSet;
+@property SNTMetricCounter* counter;
+@property SNTMetricInt64Gauge* gauge;
+@end
+
+@implementation SNTMetricDeltaTrackerTest
+
+- (void)setUp {
+  self.metricSet = [[SNTMetricSet alloc] initWithHostname:@"testHost" username:@"testUser"];
+  [self.metricSet addConstantStringWithName:@"/build/label"
+                                   helpText:@"Software version running"
+                                      value:@"20210809.0.1"];
+  self.counter = [self.metricSet counterWithName:@"/santa/events"
+                                      fieldNames:@[ @"rule_type" ]
+                                        helpText:@"Count of events"];
+  self.gauge = [self.metricSet int64GaugeWithName:@"/santa/rules"
+                                       fieldNames:@[ @"rule_type" ]
+                                         helpText:@"Number of rules"];
+
+  [self.counter incrementForFieldValues:@[ @"binary" ]];
+  [self.counter incrementForFieldValues:@[ @"certificate" ]];
+  [self.gauge set:1 forFieldValues:@[ @"binary" ]];
+}
+
+- (void)testFirstExportIsFull {
+  SNTMetricDeltaTracker* tracker = [[SNTMetricDeltaTracker alloc] initWithFullExportInterval:3600];
+  NSDictionary* metrics = [self.metricSet export];
+
+  XCTAssertEqualObjects([tracker changedMetrics:metrics], metrics);
+
+  // Until an export succeeds, every value keeps being exported
+  XCTAssertEqualObjects([tracker changedMetrics:metrics], metrics);
+}
+
+- (void)testOnlyChangedValuesAreExported {
+  SNTMetricDeltaTracker* tracker = [[SNTMetricDeltaTracker alloc] initWithFullExportInterval:3600];
+  NSDictionary* metrics = [self.metricSet export];
+  [tracker changedMetrics:metrics];
+  [tracker recordExportedMetrics:metrics];
+
+  XCTAssertNil([tracker changedMetrics:[self.metricSet export]]);
+
+  [self.counter incrementForFieldValues:@[ @"binary" ]];
+  metrics = [self.metricSet export];
+  NSDictionary* delta = [tracker changedMetrics:metrics];
+
+  XCTAssertEqualObjects(delta[@"root_labels"], metrics[@"root_labels"]);
+  XCTAssertEqualObjects([delta[@"metrics"] allKeys], @[ @"/santa/events" ]);
+
+  NSArray* values = delta[@"metrics"][@"/santa/events"][@"fields"][@"rule_type"];
+  XCTAssertEqual(values.count, 1);
+  XCTAssertEqualObjects(values[0][@"value"], @"binary");
+  XCTAssertEqualObjects(values[0][@"data"], @2);
+}
+
+- (void)testFailedExportsAreBatched {
+  SNTMetricDeltaTracker* tracker = [[SNTMetricDeltaTracker alloc] initWithFullExportInterval:3600];
+  NSDictionary* metrics = [self.metricSet export];
+  [tracker changedMetrics:metrics];
+  [tracker recordExportedMetrics:metrics];
+
+  // Two intervals whose exports fail are both covered by the next export
+  [self.counter incrementForFieldValues:@[ @"binary" ]];
+  XCTAssertNotNil([tracker changedMetrics:[self.metricSet export]]);
+
+  [self.gauge set:5 forFieldValues:@[ @"binary" ]];
+  metrics = [self.metricSet export];
+  NSDictionary* delta = [tracker changedMetrics:metrics];
+
+  NSArray* names = [[delta[@"metrics"] allKeys] sortedArrayUsingSelector:@selector(compare:)];
+  XCTAssertEqualObjects(names, (@[ @"/santa/events", @"/santa/rules" ]));
+
+  [tracker recordExportedMetrics:metrics];
+  XCTAssertNil([tracker changedMetrics:[self.metricSet export]]);
+}
+
+- (void)testPeriodicFullExport {
+  SNTMetricDeltaTracker* tracker = [[SNTMetricDeltaTracker alloc] initWithFullExportInterval:0];
+  NSDictionary* metrics = [self.metricSet export];
+  [tracker changedMetrics:metrics];
+  [tracker recordExportedMetrics:metrics];
+
+  metrics = [self.metricSet export];
+  XCTAssertEqualObjects([tracker changedMetrics:metrics], metrics);
+}
+
+@end
@@ -22,7 +22,9 @@
 #import "Source/common/SNTXPCSyncServiceInterface.h"
 
 #import "SNTMetricService.h"
+#import "Source/santametricservice/SNTMetricDeltaTracker.h"
 #import "Source/santametricservice/Formats/SNTMetricMonarchJSONFormat.h"
+#import "Source/santametricservice/Formats/SNTMetricPrometheusFormat.h"
 #import "Source/santametricservice/Formats/SNTMetricRawJSONFormat.h"
 #import "Source/santametricservice/Writers/SNTMetricFileWriter.h"
 #import "Source/santametricservice/Writers/SNTMetricHTTPWriter.h"
@@ -37,7 +39,9 @@
  @private
   SNTMetricRawJSONFormat* rawJSONFormatter;
   SNTMetricMonarchJSONFormat* monarchJSONFormatter;
+  SNTMetricPrometheusFormat* prometheusFormatter;
   NSDictionary* metricWriters;
+  SNTMetricDeltaTracker* deltaTracker;
   MOLXPCConnection* syncServiceConnection;
 }
 
@@ -46,6 +50,7 @@
   if (self) {
     rawJSONFormatter = [[SNTMetricRawJSONFormat alloc] init];
     monarchJSONFormatter = [[SNTMetricMonarchJSONFormat alloc] init];
+    prometheusFormatter = [[SNTMetricPrometheusFormat alloc] init];
 
     SNTMetricHTTPWriter* httpWriter = [[SNTMetricHTTPWriter alloc] init];
     metricWriters = @{
@@ -54,6 +59,9 @@
       @"https" : httpWriter,
     };
 
+    // Receivers get everything at least hourly in case they lost a delta.
+    deltaTracker = [[SNTMetricDeltaTracker alloc] initWithFullExportInterval:3600];
+
     _queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
   }
 
@@ -87,6 +95,8 @@
       return [self->rawJSONFormatter convert:metrics endTimestamp:[NSDate date] error:err];
     case SNTMetricFormatTypeMonarchJSON:
       return [self->monarchJSONFormatter convert:metrics endTimestamp:[NSDate date] error:err];
+    case SNTMetricFormatTypePrometheus:
+      return [self->prometheusFormatter convert:metrics endTimestamp:[NSDate date] error:err];
     default: return nil;
   }
 }
@@ -121,6 +131,21 @@
     return;
   }
 
+  // Deltas are only useful to receivers that accumulate what they're sent,
+  // so files are always written in full. The tracker only moves forward when
+  // a write succeeds, so after failures the next delta covers every interval
+  // since the last success in a single request.
+  NSDictionary* allMetrics = metrics;
+  BOOL useDeltas = config.enableMetricDeltaExport && !config.metricURL.isFileURL;
+  if (useDeltas) {
+    metrics = [deltaTracker changedMetrics:allMetrics];
+    if (!metrics) {
+      LOGD(@"no metrics changed since the last export");
+      if (reply) reply(YES);
+      return;
+    }
+  }
+
   NSError* err;
   NSArray<NSData*>* formattedMetrics = [self convertMetrics:metrics
                                                    toFormat:config.metricFormat
@@ -140,6 +165,8 @@
     if (!ok) {
       LOGE(@"unable to write metrics: %@",
            err ? [self messageFromError:err] : @"no error provided");
+    } else if (useDeltas) {
+      [deltaTracker recordExportedMetrics:allMetrics];
     }
     if (reply) reply(ok);
   } else {
@@ -16,12 +16,16 @@
 #include <dispatch/dispatch.h>
 
 #import "Source/common/MOLAuthenticatingURLSession.h"
+#import "Source/common/NSData+Zlib.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/santametricservice/Writers/SNTMetricHTTPWriter.h"
 
 @interface SNTMetricHTTPWriter ()
 @property SNTConfigurator* configurator;
+@property MOLAuthenticatingURLSession* session;
+@property NSString* sessionHostname;
+@property NSTimeInterval sessionTimeout;
 @end
 
 @implementation SNTMetricHTTPWriter
@@ -48,6 +52,25 @@
   return session;
 }
 
+/**
+ * Returns the session used for posting to url, creating a new one only when the
+ * host or timeout have changed. Keeping the session between exports lets its
+ * connection, and the HTTP/2 stream multiplexing negotiated on it, be reused
+ * instead of paying for a new TLS handshake every export interval.
+ **/
+- (MOLAuthenticatingURLSession*)sessionForURL:(NSURL*)url timeout:(NSTimeInterval)timeout {
+  @synchronized(self) {
+    if (!self.session || ![self.sessionHostname isEqualToString:url.host] ||
+        self.sessionTimeout != timeout) {
+      [self.session.session finishTasksAndInvalidate];
+      self.session = [self createSessionWithHostname:url Timeout:timeout];
+      self.sessionHostname = url.host;
+      self.sessionTimeout = timeout;
+    }
+    return self.session;
+  }
+}
+
 /**
  * Post serialzied metrics to the specified URL one object at a time.
  **/
@@ -56,16 +79,20 @@
   dispatch_semaphore_t sema = dispatch_semaphore_create(0);
 
   MOLAuthenticatingURLSession* authSession =
-      [self createSessionWithHostname:url Timeout:self.configurator.metricExportTimeout];
+      [self sessionForURL:url timeout:self.configurator.metricExportTimeout];
+  BOOL compress = self.configurator.enableMetricExportCompression;
 
   NSMutableURLRequest* request = [NSMutableURLRequest requestWithURL:url];
   request.HTTPMethod = @"POST";
   [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
+  if (compress) {
+    [request setValue:@"gzip" forHTTPHeaderField:@"Content-Encoding"];
+  }
 
   for (NSData* metric in metrics) {
     NSError* taskError;
     NSURLResponse* taskResponse;
-    request.HTTPBody = (NSData*)metric;
+    request.HTTPBody = compress ? [metric gzipCompressed] : metric;
 
     // Note: In order to help ease mock writing in tests, the `task` variable is
     // sequestered into this anonymous scope to help ensure future edits outside
@@ -18,6 +18,7 @@
 #import <OCMock/OCMock.h>
 
 #import "Source/common/MOLAuthenticatingURLSession.h"
+#import "Source/common/NSData+Zlib.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/santametricservice/Writers/SNTMetricHTTPWriter.h"
 
@@ -226,4 +227,41 @@
   BOOL result = [self.httpWriter write:@[ JSONdata ] toURL:url error:nil];
   XCTAssertEqual(NO, result);
 }
+
+- (void)testSessionIsReusedAcrossWrites {
+  NSURL* url = [NSURL URLWithString:@"https://localhost:9444/submit"];
+  NSURL* otherURL = [NSURL URLWithString:@"https://otherhost:9444/submit"];
+  NSData* JSONdata = [@"{\"foo\": \"bar\"}\r\n" dataUsingEncoding:NSUTF8StringEncoding];
+
+  for (int i = 0; i < 3; i++) {
+    [self createMockResponseWithURL:url withCode:200 withData:nil withError:nil];
+    XCTAssertTrue([self.httpWriter write:@[ JSONdata ] toURL:url error:nil]);
+  }
+  OCMVerify(times(1),
+            [self.mockMOLAuthenticatingURLSession initWithSessionConfiguration:[OCMArg any]]);
+
+  // A different host requires a new session
+  [self createMockResponseWithURL:otherURL withCode:200 withData:nil withError:nil];
+  XCTAssertTrue([self.httpWriter write:@[ JSONdata ] toURL:otherURL error:nil]);
+  OCMVerify(times(2),
+            [self.mockMOLAuthenticatingURLSession initWithSessionConfiguration:[OCMArg any]]);
+}
+
+- (void)testCompressedPost {
+  OCMStub([self.mockConfigurator enableMetricExportCompression]).andReturn(YES);
+  SNTMetricHTTPWriter* httpWriter = [[SNTMetricHTTPWriter alloc] init];
+
+  NSURL* url = [NSURL URLWithString:@"http://localhost:9444/submit"];
+  NSData* JSONdata = [@"{\"foo\": \"bar\"}\r\n" dataUsingEncoding:NSUTF8StringEncoding];
+  [self createMockResponseWithURL:url withCode:200 withData:nil withError:nil];
+
+  XCTAssertTrue([httpWriter write:@[ JSONdata ] toURL:url error:nil]);
+
+  OCMVerify([self.mockSession
+      dataTaskWithRequest:[OCMArg checkWithBlock:^BOOL(NSURLRequest* request) {
+        return [[request valueForHTTPHeaderField:@"Content-Encoding"] isEqualToString:@"gzip"] &&
+               [[request.HTTPBody gzipDecompressed] isEqualToData:JSONdata];
+      }]
+        completionHandler:[OCMArg any]]);
+}
 @end
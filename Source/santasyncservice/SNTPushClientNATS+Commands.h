@@ -26,6 +26,10 @@ __BEGIN_DECLS
 void commandMessageHandler(natsConnection* nc, natsSubscription* sub,
                            natsMsg* msg, void* closure);
 
+// Forward declaration for rule push message handler
+void rulePushMessageHandler(natsConnection* nc, natsSubscription* sub,
+                            natsMsg* msg, void* closure);
+
 __END_DECLS
 
 #endif  // SANTA_SANTASYNCSERVICE_SNTPUSHCLIENTNATSCOMMANDS_H
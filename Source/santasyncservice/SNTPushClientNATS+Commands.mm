@@ -19,9 +19,14 @@
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
+#include <memory>
+#include <string>
+#include <utility>
+
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTXPCControlInterface.h"
 #include "Source/common/String.h"
+#include "Source/common/rule_push.pb.h"
 #import "Source/santasyncservice/SNTSantaCommandHandler+EventUpload.h"
 #import "Source/santasyncservice/SNTSantaCommandHandler+Kill.h"
 #import "Source/santasyncservice/SNTSantaCommandHandler.h"
@@ -36,6 +41,7 @@ __BEGIN_DECLS
 __END_DECLS
 
 namespace pbv1 = ::santa::commands::v1;
+namespace pbrp = ::santa::rulepush;
 using santa::StringToNSString;
 
 // Maximum age in seconds for command timestamps (5 minutes)
@@ -45,9 +51,16 @@ static constexpr int64_t kMaxCommandAgeSeconds = 300;
 // Semi-arbitrary cap, averaging 1 command per second per time window
 static constexpr NSUInteger kMaxCommandNonceCacheCount = kMaxCommandAgeSeconds;
 
+// Maximum size of a rule push message. Larger rule sets should be delivered by
+// a rule download instead.
+static constexpr int kMaxRulePushBytes = 1024 * 1024;
+
 namespace {
 
-bool VerifyCommandRequestHMAC(const ::pbv1::SantaCommandRequest& command, NSData* hmacKey) {
+// Verifies the hmac field of a signed message, either a SantaCommandRequest or
+// a RulePush.
+template <typename Message>
+bool VerifyCommandRequestHMAC(const Message& command, NSData* hmacKey) {
   if (hmacKey.length == 0) {
     LOGE(@"NATS: HMAC verification failed - no key available");
     return false;
@@ -59,7 +72,7 @@ bool VerifyCommandRequestHMAC(const ::pbv1::SantaCommandRequest& command, NSData
   }
 
   // Create a copy of the command and clear the HMAC field for verification
-  ::pbv1::SantaCommandRequest commandCopy = command;
+  Message commandCopy = command;
   commandCopy.clear_hmac();
 
   // Serialize deterministically: protobuf leaves map<> field ordering
@@ -94,7 +107,8 @@ bool VerifyCommandRequestHMAC(const ::pbv1::SantaCommandRequest& command, NSData
   return true;
 }
 
-bool VerifyCommandRequestTimestamp(const ::pbv1::SantaCommandRequest& command) {
+template <typename Message>
+bool VerifyCommandRequestTimestamp(const Message& command) {
   int64_t now = static_cast<int64_t>(time(nullptr));
   int64_t issued_at = command.issued_at();
   int64_t age = now - issued_at;
@@ -116,6 +130,8 @@ bool VerifyCommandRequestTimestamp(const ::pbv1::SantaCommandRequest& command) {
 @property(atomic) BOOL isShuttingDown;
 @property(nonatomic) dispatch_queue_t messageQueue;
 @property(nonatomic) dispatch_queue_t connectionQueue;
+@property(nonatomic) dispatch_queue_t commandWorkQueue;
+@property(nonatomic) NSMutableDictionary<NSNumber*, dispatch_queue_t>* commandQueues;
 @property(nonatomic) natsConnection* conn;
 @property(weak) id<SNTPushNotificationsSyncDelegate> syncDelegate;
 @property(nonatomic) SNTSantaCommandHandler* commandHandler;
@@ -125,6 +141,8 @@ bool VerifyCommandRequestTimestamp(const ::pbv1::SantaCommandRequest& command) {
 @property(nonatomic) int64_t lastRotationTime;
 
 - (BOOL)isConnectionAlive;
+- (BOOL)acquireMessageSlot;
+- (void)releaseMessageSlotWithStartTime:(uint64_t)startTime;
 - (void)publishResponse:(const ::pbv1::SantaCommandResponse&)response
            toReplyTopic:(NSString*)replyTopic;
 @end
@@ -150,7 +168,15 @@ bool VerifyCommandRequestTimestamp(const ::pbv1::SantaCommandRequest& command) {
                                      (const ::pbv1::SantaCommandRequest&)command
                                                        onArena:(google::protobuf::Arena*)arena
                                                     replyTopic:(NSString*)replyTopic;
+- (::pbv1::SantaCommandResponse*)rejectionForSantaCommand:
+                                     (const ::pbv1::SantaCommandRequest&)command
+                                                  onArena:(google::protobuf::Arena*)arena;
+- (::pbv1::SantaCommandResponse*)executeSantaCommand:(const ::pbv1::SantaCommandRequest&)command
+                                             onArena:(google::protobuf::Arena*)arena
+                                          replyTopic:(NSString*)replyTopic;
+- (dispatch_queue_t)queueForCommandCase:(::pbv1::SantaCommandRequest::CommandCase)commandCase;
 - (BOOL)checkAndRecordNonce:(NSString*)uuid;
+- (BOOL)handleRulePush:(const ::pbrp::RulePush&)rulePush;
 @end
 
 @implementation SNTPushClientNATS (Commands)
@@ -264,11 +290,24 @@ bool VerifyCommandRequestTimestamp(const ::pbv1::SantaCommandRequest& command) {
   return [self dispatchSantaCommandToHandler:command onArena:arena replyTopic:nil];
 }
 
-// Dispatch Santa command to appropriate handler based on command type
+// Verify and execute a Santa command on the calling queue
 - (::pbv1::SantaCommandResponse*)dispatchSantaCommandToHandler:
                                      (const ::pbv1::SantaCommandRequest&)command
                                                        onArena:(google::protobuf::Arena*)arena
                                                     replyTopic:(NSString*)replyTopic {
+  ::pbv1::SantaCommandResponse* rejection = [self rejectionForSantaCommand:command onArena:arena];
+  if (rejection) {
+    return rejection;
+  }
+  return [self executeSantaCommand:command onArena:arena replyTopic:replyTopic];
+}
+
+// Verify a command and record its nonce. Returns the error response to publish
+// if the command was rejected, or nullptr if it may be executed.
+// Note: Must be called from messageQueue for thread safety
+- (::pbv1::SantaCommandResponse*)rejectionForSantaCommand:
+                                     (const ::pbv1::SantaCommandRequest&)command
+                                                  onArena:(google::protobuf::Arena*)arena {
   auto response = google::protobuf::Arena::Create<::pbv1::SantaCommandResponse>(arena);
 
   // Verify HMAC signature first
@@ -319,6 +358,18 @@ bool VerifyCommandRequestTimestamp(const ::pbv1::SantaCommandRequest& command) {
     return response;
   }
 
+  return nullptr;
+}
+
+// Dispatch a verified Santa command to the appropriate handler based on
+// command type. Safe to call off messageQueue, see queueForCommandCase:.
+- (::pbv1::SantaCommandResponse*)executeSantaCommand:(const ::pbv1::SantaCommandRequest&)command
+                                             onArena:(google::protobuf::Arena*)arena
+                                          replyTopic:(NSString*)replyTopic {
+  auto response = google::protobuf::Arena::Create<::pbv1::SantaCommandResponse>(arena);
+  NSString* uuid = StringToNSString(command.uuid());
+  ::pbv1::SantaCommandRequest::CommandCase commandCase = command.command_case();
+
   switch (commandCase) {
     case ::pbv1::SantaCommandRequest::kPing: {
       LOGI(@"NATS: Dispatching PingRequest command");
@@ -366,6 +417,77 @@ bool VerifyCommandRequestTimestamp(const ::pbv1::SantaCommandRequest& command) {
   return response;
 }
 
+// Commands of the same type are executed in the order they were received, but
+// a slow command, e.g. a kill waiting on santad, doesn't hold up commands of
+// other types. The number of command types bounds how many run at once.
+// Note: Must be called from messageQueue for thread safety
+- (dispatch_queue_t)queueForCommandCase:(::pbv1::SantaCommandRequest::CommandCase)commandCase {
+  NSNumber* key = @(static_cast<int>(commandCase));
+  dispatch_queue_t queue = self.commandQueues[key];
+  if (!queue) {
+    NSString* label =
+        [NSString stringWithFormat:@"com.northpolesec.santa.nats.command.%d", key.intValue];
+    queue = dispatch_queue_create_with_target(label.UTF8String, DISPATCH_QUEUE_SERIAL,
+                                              self.commandWorkQueue);
+    self.commandQueues[key] = queue;
+  }
+  return queue;
+}
+
+// Verify a rule push and hand its rules to the sync delegate to be applied.
+// Returns NO if the push was rejected. If the rules can't be applied a sync is
+// triggered instead, so the server still gets a chance to deliver them.
+// Note: Must be called from messageQueue for thread safety
+- (BOOL)handleRulePush:(const ::pbrp::RulePush&)rulePush {
+  if (!VerifyCommandRequestHMAC(rulePush, self.hmacKey)) {
+    LOGE(@"NATS: Rule push rejected - HMAC verification failed");
+    return NO;
+  }
+
+  if (!VerifyCommandRequestTimestamp(rulePush)) {
+    LOGE(@"NATS: Rule push rejected - timestamp verification failed");
+    return NO;
+  }
+
+  NSString* uuid = StringToNSString(rulePush.uuid());
+  if (![[NSUUID alloc] initWithUUIDString:uuid]) {
+    LOGE(@"NATS: Rule push rejected - invalid uuid: \"%@\"", uuid);
+    return NO;
+  }
+
+  if (![self checkAndRecordNonce:uuid]) {
+    LOGE(@"NATS: Rule push rejected - nonce already used (uuid: %@)", uuid);
+    return NO;
+  }
+
+  if (![SNTSantaCommandHandler isCommandAllowed:@"rule_push"]) {
+    LOGW(@"NATS: Rule push rejected - not in AllowedSantaCommands");
+    return NO;
+  }
+
+  id<SNTPushNotificationsSyncDelegate> strongSyncDelegate = self.syncDelegate;
+  if (!strongSyncDelegate) {
+    LOGE(@"NATS: Rule push failed - no sync delegate");
+    return NO;
+  }
+
+  const std::string& rules = rulePush.rule_download_response();
+  LOGI(@"NATS: Applying rule push %@ (%zu bytes)", uuid, rules.size());
+  __weak __typeof(self) weakSelf = self;
+  [strongSyncDelegate applyPushedRules:[NSData dataWithBytes:rules.data() length:rules.size()]
+                                 reply:^(BOOL success) {
+                                   __typeof(self) strongSelf = weakSelf;
+                                   if (success || !strongSelf || strongSelf.isShuttingDown) {
+                                     return;
+                                   }
+                                   LOGW(@"NATS: Rule push %@ failed, triggering sync", uuid);
+                                   dispatch_async(dispatch_get_main_queue(), ^{
+                                     [strongSelf.syncDelegate syncSecondsFromNow:0];
+                                   });
+                                 }];
+  return YES;
+}
+
 @end
 
 // NATS command message handler - handles serialization/deserialization and
@@ -410,8 +532,8 @@ static void CommandMessageHandlerImpl(natsConnection* nc, natsSubscription* sub,
   // Deserialize the message to SantaCommandRequest
   // Note: We must extract all data from msg before destroying it, as NATS owns the message
   // and will free it after this callback returns
-  ::pbv1::SantaCommandRequest command;
-  if (!command.ParseFromArray(natsMsg_GetData(msg), natsMsg_GetDataLength(msg))) {
+  auto command = std::make_shared<::pbv1::SantaCommandRequest>();
+  if (!command->ParseFromArray(natsMsg_GetData(msg), natsMsg_GetDataLength(msg))) {
     LOGE(@"NATS: Failed to parse SantaCommandRequest from message on %@", msgSubject);
     // Try to send error response, but don't fail if that also fails
     ::pbv1::SantaCommandResponse errorResponse;
@@ -420,23 +542,109 @@ static void CommandMessageHandlerImpl(natsConnection* nc, natsSubscription* sub,
     return;
   }
 
-  // Process on message queue to serialize handling of messages
+  // Blocks this subscription's delivery thread while too many messages are
+  // pending, so further messages queue up against its pending limits.
+  uint64_t startTime = clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW);
+  if (![self acquireMessageSlot]) {
+    LOGE(@"NATS: Too many pending messages, dropping command message on %@", msgSubject);
+    ::pbv1::SantaCommandResponse errorResponse;
+    errorResponse.set_error(::pbv1::SantaCommandResponse::ERROR_UNSPECIFIED);
+    [self publishResponse:errorResponse toReplyTopic:replyTopic];
+    return;
+  }
+
+  // Verify on message queue to serialize use of the nonce cache, then execute
+  // on the queue for the command's type.
   // Failures are logged but don't crash the client
   dispatch_async(self.messageQueue, ^{
+    absl::Cleanup release_slot = ^{
+      [self releaseMessageSlotWithStartTime:startTime];
+    };
+
     if (self.isShuttingDown) {
       return;
     }
 
-    google::protobuf::Arena arena;
-    ::pbv1::SantaCommandResponse* response = [self dispatchSantaCommandToHandler:command
-                                                                         onArena:&arena
-                                                                      replyTopic:replyTopic];
+    google::protobuf::Arena verifyArena;
+    ::pbv1::SantaCommandResponse* rejection = [self rejectionForSantaCommand:*command
+                                                                     onArena:&verifyArena];
+    if (rejection) {
+      [self publishResponse:*rejection toReplyTopic:replyTopic];
+      return;
+    }
 
-    // A nullptr response means the handler published (or will publish) the response
-    // asynchronously (e.g. binary upload), so don't publish synchronously here.
-    if (response) {
-      [self publishResponse:*response toReplyTopic:replyTopic];
+    // The slot is released once the command has been executed instead.
+    std::move(release_slot).Cancel();
+    dispatch_async([self queueForCommandCase:command->command_case()], ^{
+      absl::Cleanup release_slot = ^{
+        [self releaseMessageSlotWithStartTime:startTime];
+      };
+
+      if (self.isShuttingDown) {
+        return;
+      }
+
+      google::protobuf::Arena arena;
+      ::pbv1::SantaCommandResponse* response = [self executeSantaCommand:*command
+                                                                 onArena:&arena
+                                                              replyTopic:replyTopic];
+
+      // A nullptr response means the handler published (or will publish) the response
+      // asynchronously (e.g. binary upload), so don't publish synchronously here.
+      if (response) {
+        [self publishResponse:*response toReplyTopic:replyTopic];
+      }
+    });
+  });
+}
+
+// NATS rule push message handler. Rule pushes have no response, failures are
+// only logged.
+static void RulePushMessageHandlerImpl(natsConnection* nc, natsSubscription* sub, natsMsg* msg,
+                                       SNTPushClientNATS* self) {
+  absl::Cleanup msg_cleanup = ^{
+    if (msg) {
+      natsMsg_Destroy(msg);
     }
+  };
+
+  if (!self || !msg || self.isShuttingDown) {
+    return;
+  }
+
+  NSString* msgSubject = @(natsMsg_GetSubject(msg) ?: "<unknown>");
+  int dataLength = natsMsg_GetDataLength(msg);
+  LOGD(@"NATS: Received rule push on subject '%@' (%d bytes)", msgSubject, dataLength);
+
+  if (dataLength <= 0 || dataLength > kMaxRulePushBytes) {
+    LOGE(@"NATS: Rule push on %@ has invalid size %d", msgSubject, dataLength);
+    return;
+  }
+
+  // Parse before returning, NATS owns the message data.
+  auto rulePush = std::make_shared<::pbrp::RulePush>();
+  if (!rulePush->ParseFromArray(natsMsg_GetData(msg), dataLength)) {
+    LOGE(@"NATS: Failed to parse RulePush from message on %@", msgSubject);
+    return;
+  }
+
+  uint64_t startTime = clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW);
+  if (![self acquireMessageSlot]) {
+    LOGE(@"NATS: Too many pending messages, dropping rule push on %@", msgSubject);
+    return;
+  }
+
+  // Serialized with command verification so they share the nonce cache.
+  // Applying the rules is an async XPC call, so this doesn't block commands.
+  dispatch_async(self.messageQueue, ^{
+    absl::Cleanup release_slot = ^{
+      [self releaseMessageSlotWithStartTime:startTime];
+    };
+
+    if (self.isShuttingDown) {
+      return;
+    }
+    [self handleRulePush:*rulePush];
   });
 }
 
@@ -448,4 +656,11 @@ void commandMessageHandler(natsConnection* nc, natsSubscription* sub, natsMsg* m
   CommandMessageHandlerImpl(nc, sub, msg, self);
 }
 
+// NATS-compatible wrapper that converts void *closure to SNTPushClientNATS *
+void rulePushMessageHandler(natsConnection* nc, natsSubscription* sub, natsMsg* msg,
+                            void* closure) {
+  SNTPushClientNATS* self = (__bridge SNTPushClientNATS*)closure;
+  RulePushMessageHandlerImpl(nc, sub, msg, self);
+}
+
 __END_DECLS
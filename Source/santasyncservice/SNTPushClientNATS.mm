@@ -19,9 +19,13 @@
 #include <string.h>
 #include <sys/cdefs.h>
 
+#include <algorithm>
+#include <atomic>
+
 #include <google/protobuf/descriptor.h>
 #include "commands/v1.pb.h"
 
+#include "Source/common/LatencyHistogram.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTStrengthify.h"
@@ -41,6 +45,20 @@ __END_DECLS
 
 namespace pbv1 = ::santa::commands::v1;
 
+// Maximum number of command and rule push messages accepted but not yet
+// handled, and how long a NATS delivery thread waits for one to finish before
+// dropping the message it holds.
+static constexpr long kMaxPendingMessages = 16;
+static constexpr int64_t kPendingMessageSlotTimeoutSeconds = 30;
+
+// Pending limits for the command and rule push subscriptions, applied to the
+// messages held by the NATS client while handlers are blocked.
+static constexpr int kMaxNATSPendingMessages = 64;
+static constexpr int kMaxNATSPendingBytes = 8 * 1024 * 1024;
+
+// Handling slower than this is logged.
+static constexpr uint64_t kSlowMessageHandlingSeconds = 5;
+
 // Helper function to convert response code to readable string using protobuf generated code
 NSString* ResponseCodeToString(::pbv1::SantaCommandResponse::Error code) {
   // Try the generated _Name() function first
@@ -141,10 +159,20 @@ static int NATSSSLVerifyCallback(int preverifyOk, void* ctx) {
 @property(nonatomic) NSMutableArray<NSValue*>* tagSubscriptions;
 // Commands subscription
 @property(nonatomic) natsSubscription* commandsSubscription;
+// Rule push subscription
+@property(nonatomic) natsSubscription* rulesSubscription;
 // Single queue for connection management
 @property(nonatomic) dispatch_queue_t connectionQueue;
 // Queue for processing messages
 @property(nonatomic) dispatch_queue_t messageQueue;
+// Concurrent queue targeted by the per-type command queues, so commands of
+// different types don't wait on each other's XPC round trips.
+@property(nonatomic) dispatch_queue_t commandWorkQueue;
+// Serial queue per command type, keyed by command case. Only accessed from
+// messageQueue.
+@property(nonatomic) NSMutableDictionary<NSNumber*, dispatch_queue_t>* commandQueues;
+// Bounds the number of messages accepted from NATS but not yet handled.
+@property(nonatomic) dispatch_semaphore_t pendingMessageSlots;
 @property(atomic, readwrite) BOOL isConnected;
 @property(nonatomic, readwrite) NSUInteger fullSyncInterval;
 @property(atomic) BOOL isShuttingDown;
@@ -169,7 +197,12 @@ static int NATSSSLVerifyCallback(int preverifyOk, void* ctx) {
 @property(nonatomic, copy) NSString* lastConnectionError;
 @end
 
-@implementation SNTPushClientNATS
+@implementation SNTPushClientNATS {
+  std::atomic<int64_t> _pendingMessages;
+  std::atomic<int64_t> _maxPendingMessages;
+  std::atomic<int64_t> _droppedMessages;
+  santa::LatencyHistogram _messageLatency;
+}
 
 - (instancetype)initWithSyncDelegate:(id<SNTPushNotificationsSyncDelegate>)syncDelegate {
   self = [super init];
@@ -181,6 +214,10 @@ static int NATSSSLVerifyCallback(int preverifyOk, void* ctx) {
         dispatch_queue_create("com.northpolesec.santa.nats.connection", DISPATCH_QUEUE_SERIAL);
     _messageQueue =
         dispatch_queue_create("com.northpolesec.santa.nats.message", DISPATCH_QUEUE_SERIAL);
+    _commandWorkQueue =
+        dispatch_queue_create("com.northpolesec.santa.nats.command", DISPATCH_QUEUE_CONCURRENT);
+    _commandQueues = [NSMutableDictionary dictionary];
+    _pendingMessageSlots = dispatch_semaphore_create(kMaxPendingMessages);
     _tagSubscriptions = [NSMutableArray array];
 
     _currentNonces = [NSMutableSet set];
@@ -542,7 +579,7 @@ static int NATSSSLVerifyCallback(int preverifyOk, void* ctx) {
     // Note: we check self.conn directly rather than isConnectionAlive since we
     // want to clean up even if the connection is closed but resources still exist.
     if (!self.conn && !self.isConnected && self.tagSubscriptions.count == 0 &&
-        !self.commandsSubscription) {
+        !self.commandsSubscription && !self.rulesSubscription) {
       if (completion) {
         dispatch_async(dispatch_get_main_queue(), completion);
       }
@@ -610,6 +647,12 @@ static int NATSSSLVerifyCallback(int preverifyOk, void* ctx) {
     self.commandsSubscription = NULL;
   }
 
+  if (self.rulesSubscription) {
+    natsSubscription_Unsubscribe(self.rulesSubscription);
+    natsSubscription_Destroy(self.rulesSubscription);
+    self.rulesSubscription = NULL;
+  }
+
   LOGD(@"NATS: All topics unsubscribed");
 }
 
@@ -701,10 +744,85 @@ static int NATSSSLVerifyCallback(int preverifyOk, void* ctx) {
     } else {
       LOGI(@"NATS: Subscribed to commands topic: %@", commandsTopic);
       self.commandsSubscription = commandsSub;
+      [self setPendingLimitsForSubscription:commandsSub];
     }
   } else {
     LOGW(@"NATS: Cannot subscribe to commands topic - no device ID available (non-fatal)");
   }
+
+  // Subscribe to rule push topic: santa.host.<device-id>.rules
+  // Note: Failure to subscribe is non-fatal - rules are still delivered by syncs
+  if (self.pushDeviceID.length > 0) {
+    NSString* rulesTopic = [NSString stringWithFormat:@"santa.host.%@.rules", self.pushDeviceID];
+    LOGD(@"NATS: Subscribing to rules topic: %@", rulesTopic);
+
+    natsSubscription* rulesSub = NULL;
+    status = natsConnection_Subscribe(&rulesSub, self.conn, [rulesTopic UTF8String],
+                                      &rulePushMessageHandler, (__bridge void*)self);
+
+    if (status != NATS_OK) {
+      LOGE(@"NATS: Failed to subscribe to rules topic %@: %s (non-fatal, continuing)", rulesTopic,
+           natsStatus_GetText(status));
+    } else {
+      LOGI(@"NATS: Subscribed to rules topic: %@", rulesTopic);
+      self.rulesSubscription = rulesSub;
+      [self setPendingLimitsForSubscription:rulesSub];
+    }
+  }
+}
+
+// Message handlers block the subscription's delivery thread while all pending
+// message slots are in use, so a burst queues up in the NATS client instead.
+// Cap that too, so a misbehaving publisher gets slow consumer errors rather
+// than growing our memory without bound.
+- (void)setPendingLimitsForSubscription:(natsSubscription*)sub {
+  natsStatus status = natsSubscription_SetPendingLimits(sub, kMaxNATSPendingMessages,
+                                                        kMaxNATSPendingBytes);
+  if (status != NATS_OK) {
+    LOGW(@"NATS: Failed to set pending limits on %s: %s", natsSubscription_GetSubject(sub),
+         natsStatus_GetText(status));
+  }
+}
+
+- (BOOL)acquireMessageSlot {
+  // Wait for a bit before giving up, this is what pushes back on NATS.
+  if (dispatch_semaphore_wait(self.pendingMessageSlots,
+                              dispatch_time(DISPATCH_TIME_NOW,
+                                            kPendingMessageSlotTimeoutSeconds * NSEC_PER_SEC))) {
+    _droppedMessages.fetch_add(1, std::memory_order_relaxed);
+    return NO;
+  }
+
+  int64_t pending = _pendingMessages.fetch_add(1, std::memory_order_relaxed) + 1;
+  int64_t max = _maxPendingMessages.load(std::memory_order_relaxed);
+  while (pending > max && !_maxPendingMessages.compare_exchange_weak(max, pending,
+                                                                      std::memory_order_relaxed)) {
+  }
+  return YES;
+}
+
+- (void)releaseMessageSlotWithStartTime:(uint64_t)startTime {
+  uint64_t elapsed = clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW) - startTime;
+  _messageLatency.Record(static_cast<int64_t>(elapsed));
+  if (elapsed > kSlowMessageHandlingSeconds * NSEC_PER_SEC) {
+    LOGW(@"NATS: Message handling took %llu ms", elapsed / NSEC_PER_MSEC);
+  }
+
+  _pendingMessages.fetch_sub(1, std::memory_order_relaxed);
+  dispatch_semaphore_signal(self.pendingMessageSlots);
+}
+
+- (NSDictionary<NSString*, NSNumber*>*)messageHandlingStats {
+  santa::LatencyHistogram::Snapshot snapshot = _messageLatency.TakeSnapshot(false);
+  return @{
+    @"pending" : @(_pendingMessages.load(std::memory_order_relaxed)),
+    @"max_pending" : @(_maxPendingMessages.load(std::memory_order_relaxed)),
+    @"dropped" : @(_droppedMessages.load(std::memory_order_relaxed)),
+    @"handled" : @(snapshot.Count()),
+    @"latency_p50_ns" : @(snapshot.ValueAtPercentile(50)),
+    @"latency_p99_ns" : @(snapshot.ValueAtPercentile(99)),
+    @"latency_max_ns" : @(snapshot.Max()),
+  };
 }
 
 // Handle a push notification for the given subject by dispatching a sync.
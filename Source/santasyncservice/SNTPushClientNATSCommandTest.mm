@@ -21,6 +21,7 @@
 #import "Source/common/SNTSyncConstants.h"
 #import "Source/santasyncservice/SNTPushClientNATS.h"
 #import "Source/santasyncservice/SNTPushNotifications.h"
+#include "Source/common/rule_push.pb.h"
 #include "commands/v1.pb.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -33,6 +34,7 @@ __BEGIN_DECLS
 __END_DECLS
 
 namespace pbv1 = ::santa::commands::v1;
+namespace pbrp = ::santa::rulepush;
 
 // Constants from SNTPushClientNATS+Commands.mm
 static constexpr int64_t kMaxCommandAgeSeconds = 300;
@@ -65,6 +67,11 @@ static constexpr NSUInteger kMaxCommandNonceCacheCount = kMaxCommandAgeSeconds;
                                                        onArena:(google::protobuf::Arena*)arena;
 - (void)publishResponse:(const ::pbv1::SantaCommandResponse&)response
            toReplyTopic:(NSString*)replyTopic;
+- (BOOL)handleRulePush:(const ::pbrp::RulePush&)rulePush;
+- (dispatch_queue_t)queueForCommandCase:(::pbv1::SantaCommandRequest::CommandCase)commandCase;
+- (BOOL)acquireMessageSlot;
+- (void)releaseMessageSlotWithStartTime:(uint64_t)startTime;
+- (NSDictionary<NSString*, NSNumber*>*)messageHandlingStats;
 @end
 
 @interface SNTPushClientNATSCommandTest : XCTestCase
@@ -76,6 +83,8 @@ static constexpr NSUInteger kMaxCommandNonceCacheCount = kMaxCommandAgeSeconds;
 
 // Helper method to sign a command request with HMAC
 - (void)signCommandRequest:(::pbv1::SantaCommandRequest*)command;
+// Helper method to sign a rule push with HMAC
+- (void)signRulePush:(::pbrp::RulePush*)rulePush;
 @end
 
 @implementation SNTPushClientNATSCommandTest
@@ -143,6 +152,28 @@ static constexpr NSUInteger kMaxCommandNonceCacheCount = kMaxCommandAgeSeconds;
   command->set_hmac(hmac, CC_SHA256_DIGEST_LENGTH);
 }
 
+- (void)signRulePush:(::pbrp::RulePush*)rulePush {
+  rulePush->set_issued_at(time(nullptr));
+  rulePush->clear_hmac();
+
+  std::string serialized;
+  {
+    google::protobuf::io::StringOutputStream stream(&serialized);
+    google::protobuf::io::CodedOutputStream coded(&stream);
+    coded.SetSerializationDeterministic(true);
+    if (!rulePush->SerializeToCodedStream(&coded)) {
+      XCTFail(@"Failed to serialize rule push for HMAC signing");
+      return;
+    }
+  }
+
+  unsigned char hmac[CC_SHA256_DIGEST_LENGTH];
+  CCHmac(kCCHmacAlgSHA256, self.testHMACKey.bytes, self.testHMACKey.length, serialized.data(),
+         serialized.size(), hmac);
+
+  rulePush->set_hmac(hmac, CC_SHA256_DIGEST_LENGTH);
+}
+
 #pragma mark - Command Response Publishing Tests
 
 - (void)testPublishCommandResponseSuccess {
@@ -1199,4 +1230,135 @@ static constexpr NSUInteger kMaxCommandNonceCacheCount = kMaxCommandAgeSeconds;
                  @"Should return ERROR_INVALID_PATH on empty path");
 }
 
+#pragma mark - Rule Push Tests
+
+- (void)testRulePushApplied {
+  ::pbrp::RulePush rulePush;
+  rulePush.set_uuid([[NSUUID UUID] UUIDString].UTF8String);
+  rulePush.set_rule_download_response("rules");
+  [self signRulePush:&rulePush];
+
+  NSData* rules = [@"rules" dataUsingEncoding:NSUTF8StringEncoding];
+  OCMExpect([self.mockSyncDelegate applyPushedRules:rules reply:OCMOCK_ANY]);
+
+  XCTAssertTrue([self.client handleRulePush:rulePush]);
+  OCMVerifyAll(self.mockSyncDelegate);
+}
+
+- (void)testRulePushRejected {
+  OCMReject([self.mockSyncDelegate applyPushedRules:OCMOCK_ANY reply:OCMOCK_ANY]);
+
+  // Modified after signing
+  ::pbrp::RulePush tampered;
+  tampered.set_uuid([[NSUUID UUID] UUIDString].UTF8String);
+  tampered.set_rule_download_response("rules");
+  [self signRulePush:&tampered];
+  tampered.set_rule_download_response("other rules");
+  XCTAssertFalse([self.client handleRulePush:tampered]);
+
+  // Unsigned
+  ::pbrp::RulePush unsigned_push;
+  unsigned_push.set_uuid([[NSUUID UUID] UUIDString].UTF8String);
+  unsigned_push.set_issued_at(time(nullptr));
+  XCTAssertFalse([self.client handleRulePush:unsigned_push]);
+
+  // Invalid UUID
+  ::pbrp::RulePush badUUID;
+  badUUID.set_uuid("not-a-uuid");
+  [self signRulePush:&badUUID];
+  XCTAssertFalse([self.client handleRulePush:badUUID]);
+
+  OCMVerifyAll(self.mockSyncDelegate);
+}
+
+- (void)testRulePushReplayRejected {
+  ::pbrp::RulePush rulePush;
+  rulePush.set_uuid([[NSUUID UUID] UUIDString].UTF8String);
+  [self signRulePush:&rulePush];
+
+  XCTAssertTrue([self.client handleRulePush:rulePush]);
+  XCTAssertFalse([self.client handleRulePush:rulePush]);
+}
+
+- (void)testRulePushNotAllowed {
+  OCMStub([self.mockConfigurator allowedSantaCommands]).andReturn(@[ @"ping" ]);
+  OCMReject([self.mockSyncDelegate applyPushedRules:OCMOCK_ANY reply:OCMOCK_ANY]);
+
+  ::pbrp::RulePush rulePush;
+  rulePush.set_uuid([[NSUUID UUID] UUIDString].UTF8String);
+  [self signRulePush:&rulePush];
+
+  XCTAssertFalse([self.client handleRulePush:rulePush]);
+  OCMVerifyAll(self.mockSyncDelegate);
+}
+
+- (void)testRulePushFailureTriggersSync {
+  OCMStub([self.mockSyncDelegate applyPushedRules:OCMOCK_ANY reply:OCMOCK_ANY])
+      .andDo(^(NSInvocation* invocation) {
+        __unsafe_unretained void (^reply)(BOOL);
+        [invocation getArgument:&reply atIndex:3];
+        reply(NO);
+      });
+
+  XCTestExpectation* expectation = [self expectationWithDescription:@"Sync triggered"];
+  OCMStub([self.mockSyncDelegate syncSecondsFromNow:0]).andDo(^(NSInvocation* invocation) {
+    [expectation fulfill];
+  });
+
+  ::pbrp::RulePush rulePush;
+  rulePush.set_uuid([[NSUUID UUID] UUIDString].UTF8String);
+  [self signRulePush:&rulePush];
+
+  XCTAssertTrue([self.client handleRulePush:rulePush]);
+  [self waitForExpectations:@[ expectation ] timeout:2.0];
+}
+
+#pragma mark - Message Handling Tests
+
+- (void)testCommandQueuesArePerType {
+  __block dispatch_queue_t kill1, kill2, ping;
+  dispatch_sync(self.client.messageQueue, ^{
+    kill1 = [self.client queueForCommandCase:pbv1::SantaCommandRequest::kKill];
+    kill2 = [self.client queueForCommandCase:pbv1::SantaCommandRequest::kKill];
+    ping = [self.client queueForCommandCase:pbv1::SantaCommandRequest::kPing];
+  });
+
+  XCTAssertEqual(kill1, kill2);
+  XCTAssertNotEqual(kill1, ping);
+
+  // A blocked kill doesn't hold up a ping
+  dispatch_semaphore_t unblockKill = dispatch_semaphore_create(0);
+  dispatch_async(kill1, ^{
+    dispatch_semaphore_wait(unblockKill, DISPATCH_TIME_FOREVER);
+  });
+
+  XCTestExpectation* pingRan = [self expectationWithDescription:@"Ping ran"];
+  dispatch_async(ping, ^{
+    [pingRan fulfill];
+  });
+  [self waitForExpectations:@[ pingRan ] timeout:2.0];
+  dispatch_semaphore_signal(unblockKill);
+}
+
+- (void)testMessageHandlingStats {
+  uint64_t startTime = clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW);
+  XCTAssertTrue([self.client acquireMessageSlot]);
+  XCTAssertTrue([self.client acquireMessageSlot]);
+
+  NSDictionary* stats = [self.client messageHandlingStats];
+  XCTAssertEqualObjects(stats[@"pending"], @(2));
+  XCTAssertEqualObjects(stats[@"max_pending"], @(2));
+  XCTAssertEqualObjects(stats[@"handled"], @(0));
+
+  [self.client releaseMessageSlotWithStartTime:startTime];
+  [self.client releaseMessageSlotWithStartTime:startTime];
+
+  stats = [self.client messageHandlingStats];
+  XCTAssertEqualObjects(stats[@"pending"], @(0));
+  XCTAssertEqualObjects(stats[@"max_pending"], @(2));
+  XCTAssertEqualObjects(stats[@"handled"], @(2));
+  XCTAssertEqualObjects(stats[@"dropped"], @(0));
+  XCTAssertGreaterThan([stats[@"latency_max_ns"] unsignedLongLongValue], 0);
+}
+
 @end
@@ -26,6 +26,8 @@
 - (void)pushNotificationSyncSecondsFromNow:(uint64_t)seconds;
 - (MOLXPCConnection*)daemonConnection;
 - (void)eventUploadForPaths:(NSArray<NSString*>*)paths reply:(void (^)(NSError* error))reply;
+// Apply a serialized sync v2 RuleDownloadResponse pushed to this host, without a sync.
+- (void)applyPushedRules:(NSData*)rules reply:(void (^)(BOOL success))reply;
 @end
 
 @class SNTSyncState;
@@ -63,6 +63,9 @@ namespace pbv1 = ::santa::commands::v1;
     reply(err);
   }
 }
+- (void)applyPushedRules:(NSData*)rules reply:(void (^)(BOOL success))reply {
+  reply(NO);
+}
 @end
 
 @interface SNTSantaCommandHandlerTest : XCTestCase
@@ -59,6 +59,9 @@ static NSString* const kMachineID = @"50C7E1EB-2EF5-42D4-A084-A7966FC45A95";
     reply(nil);
   }
 }
+- (void)applyPushedRules:(NSData*)rules reply:(void (^)(BOOL success))reply {
+  reply(NO);
+}
 @end
 
 @interface SNTSyncCommandsTest : XCTestCase
@@ -15,6 +15,9 @@
 
 #import "Source/santasyncservice/SNTSyncEventUpload.h"
 
+#include <atomic>
+#include <memory>
+
 #include "Source/common/EncodeEntitlements.h"
 #import "Source/common/MOLCertificate.h"
 #import "Source/common/MOLXPCConnection.h"
@@ -34,6 +37,7 @@
 #import "Source/common/SNTStoredUSBMountEvent.h"
 #import "Source/common/SNTSyncConstants.h"
 #import "Source/common/SNTXPCControlInterface.h"
+#include "Source/common/StoredEventEncoding.h"
 #import "Source/common/String.h"
 #include "Source/santasyncservice/ProtoTraits.h"
 #import "Source/santasyncservice/SNTSyncLogging.h"
@@ -84,13 +88,16 @@ BOOL PerformRequest(SNTSyncEventUpload* self, google::protobuf::Message* req, in
       return NO;
     }
 
-    // A list of bundle hashes that require their related binary events to be uploaded.
+    // A list of bundle hashes that require their related binary events to be uploaded. Batches
+    // may be uploaded concurrently, so requests from every response are kept.
     if (response.event_upload_bundle_binaries_size()) {
-      self.syncState.bundleBinaryRequests =
-          [NSMutableArray arrayWithCapacity:response.event_upload_bundle_binaries_size()];
-      for (const std::string& bundle_binary : response.event_upload_bundle_binaries()) {
-        [(NSMutableArray*)self.syncState.bundleBinaryRequests
-            addObject:santa::StringToNSString(bundle_binary)];
+      @synchronized(self.syncState) {
+        NSMutableArray* requests = [self.syncState.bundleBinaryRequests mutableCopy]
+                                       ?: [NSMutableArray array];
+        for (const std::string& bundle_binary : response.event_upload_bundle_binaries()) {
+          [requests addObject:santa::StringToNSString(bundle_binary)];
+        }
+        self.syncState.bundleBinaryRequests = requests;
       }
     }
     SLOGI(@"Uploaded %d events", eventsInBatch);
@@ -710,14 +717,60 @@ void MessageForTemporaryAdminModeDeniedAuditEvent(
 }
 
 - (BOOL)sync {
-  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
-  [[self.daemonConn remoteObjectProxy] databaseEventsPending:^(NSArray* events) {
-    if (events.count) {
-      [self uploadEvents:events];
+  // Pending events are fetched one batch at a time, in index order. Up to
+  // SyncEventUploadConcurrency batches are uploaded at once, and each batch is
+  // removed from the database when the server accepts it, so a large backlog
+  // is never held in memory at once. Events in a batch that failed to upload
+  // are left in the database for the next sync.
+  NSUInteger batchSize = MAX(self.syncState.eventBatchSize, 1);
+  dispatch_queue_t uploadQueue = dispatch_queue_create(
+      "com.northpolesec.santa.syncservice.eventupload", DISPATCH_QUEUE_CONCURRENT);
+  dispatch_semaphore_t uploadSlots =
+      dispatch_semaphore_create(MAX([[SNTConfigurator configurator] syncEventUploadConcurrency], 1));
+  dispatch_group_t uploadGroup = dispatch_group_create();
+  auto uploadFailed = std::make_shared<std::atomic<bool>>(false);
+  NSNumber* lastIdx;
+
+  while (!uploadFailed->load()) {
+    // Events decoded from a batch share the MOLCertificates of their signing
+    // chains, so each certificate is only read once when building the request.
+    __block NSArray<SNTStoredEvent*>* events;
+    dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+    [[self.daemonConn remoteObjectProxy]
+        databaseEventsPendingAfterIndex:lastIdx
+                                  limit:batchSize
+                                  reply:^(NSData* encodedEvents,
+                                          NSArray<SNTStoredEvent*>* pendingEvents) {
+                                    events = encodedEvents
+                                                 ? santa::DecodeStoredEventBatch(encodedEvents)
+                                                 : pendingEvents;
+                                    dispatch_semaphore_signal(sema);
+                                  }];
+    dispatch_semaphore_wait(sema, DISPATCH_TIME_FOREVER);
+    if (!events.count) break;
+
+    // Once a batch fails the server is unlikely to accept more, so no further
+    // batches are started.
+    dispatch_semaphore_wait(uploadSlots, DISPATCH_TIME_FOREVER);
+    if (uploadFailed->load()) {
+      dispatch_semaphore_signal(uploadSlots);
+      break;
     }
-    dispatch_semaphore_signal(sema);
-  }];
-  return (dispatch_semaphore_wait(sema, DISPATCH_TIME_FOREVER) == 0);
+    dispatch_group_async(uploadGroup, uploadQueue, ^{
+      @autoreleasepool {
+        if (![self uploadEvents:events]) {
+          uploadFailed->store(true);
+        }
+      }
+      dispatch_semaphore_signal(uploadSlots);
+    });
+
+    if (events.count < batchSize) break;
+    lastIdx = events.lastObject.idx;
+  }
+
+  dispatch_group_wait(uploadGroup, DISPATCH_TIME_FOREVER);
+  return YES;
 }
 
 - (BOOL)uploadEvents:(NSArray<SNTStoredEvent*>*)events {
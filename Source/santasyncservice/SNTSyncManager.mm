@@ -50,6 +50,23 @@
 
 static const uint8_t kMaxEnqueuedSyncs = 2;
 
+// The periodic full sync interval is stretched by up to 1/kFullSyncJitterDivisor of itself, and a
+// server Retry-After by up to 1/kRetryAfterJitterDivisor, so a fleet started at the same time
+// doesn't stay in lockstep.
+static const uint64_t kFullSyncJitterDivisor = 10;
+static const uint64_t kRetryAfterJitterDivisor = 4;
+
+// FNV-1a hash of the machine ID. Stable across restarts so each machine keeps its place in the
+// spread of the fleet's syncs.
+static uint64_t JitterSeedForMachineID(NSString* machineID) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char* c = machineID.UTF8String; c && *c; c++) {
+    hash ^= (uint8_t)*c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
 @interface SNTSyncManager () <SNTPushNotificationsSyncDelegate>
 
 @property(nonatomic) dispatch_source_t fullSyncTimer;
@@ -93,6 +110,10 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 @property NSString* xsrfToken;
 @property NSString* xsrfTokenHeader;
 
+// The session shared by all requests to the sync server, and the settings it was created with.
+@property MOLAuthenticatingURLSession* authURLSession;
+@property NSArray* authURLSessionKey;
+
 // Persisted full sync interval read from the daemon on startup.
 // Used as fallback when the server doesn't provide full_sync_interval_seconds in preflight.
 // Updated when the server provides a new value so the fallback stays current.
@@ -100,6 +121,13 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 
 @property(nonatomic, readonly) dispatch_queue_t metricsQueue;
 
+// Per-machine seed for the deterministic jitter applied to sync scheduling.
+@property(nonatomic, readonly) uint64_t jitterSeed;
+
+// Set when the server asked us to back off with a Retry-After. Syncs other than those explicitly
+// requested (e.g. by santactl sync) are deferred until then.
+@property NSDate* serverBackoffUntil;
+
 @end
 
 @implementation SNTSyncManager
@@ -123,6 +151,7 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
     LOGD(@"Read persisted full sync interval from daemon: %lu", _persistedFullSyncInterval);
 
     SNTConfigurator* config = [SNTConfigurator configurator];
+    _jitterSeed = JitterSeedForMachineID(config.machineID);
 
     if (config.fcmEnabled) {
       LOGD(@"Using FCM push notifications");
@@ -139,7 +168,8 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
       // rescheduling logic.
       NSUInteger interval = self.pushNotifications ? self.pushNotifications.fullSyncInterval
                                                    : self.persistedFullSyncInterval;
-      [self rescheduleTimerQueue:self.fullSyncTimer secondsFromNow:interval];
+      [self rescheduleTimerQueue:self.fullSyncTimer
+                  secondsFromNow:[self jitteredInterval:interval]];
       [self syncType:SNTSyncTypeNormal withReply:NULL];
     }];
     _ruleSyncTimer = [self createSyncTimerWithBlock:^{
@@ -416,6 +446,38 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 }
 
 - (void)syncSecondsFromNow:(uint64_t)seconds {
+  [self rescheduleTimerQueue:self.fullSyncTimer
+              secondsFromNow:[self secondsRespectingServerBackoff:seconds]];
+}
+
+- (uint64_t)jitterForWindow:(uint64_t)window {
+  return window ? self.jitterSeed % (window + 1) : 0;
+}
+
+- (uint64_t)jitteredInterval:(uint64_t)interval {
+  return interval + [self jitterForWindow:interval / kFullSyncJitterDivisor];
+}
+
+- (uint64_t)secondsRespectingServerBackoff:(uint64_t)seconds {
+  NSTimeInterval remaining = [self.serverBackoffUntil timeIntervalSinceNow];
+  if (remaining > seconds) {
+    LOGD(@"Deferring sync for %.0f seconds at the server's request", remaining);
+    return (uint64_t)ceil(remaining);
+  }
+  return seconds;
+}
+
+// Record the server's Retry-After, if any, from the most recent sync and move the next full
+// sync past it. Each machine adds its own share of jitter so the fleet doesn't return at once.
+- (void)updateServerBackoffWithSyncState:(SNTSyncState*)syncState {
+  if (!syncState.serverRetryAfter) {
+    self.serverBackoffUntil = nil;
+    return;
+  }
+  uint64_t retryAfter = syncState.serverRetryAfter.unsignedLongLongValue;
+  uint64_t seconds = retryAfter + [self jitterForWindow:retryAfter / kRetryAfterJitterDivisor];
+  self.serverBackoffUntil = [NSDate dateWithTimeIntervalSinceNow:seconds];
+  SLOGI(@"Server requested backoff, next sync in %llu seconds", seconds);
   [self rescheduleTimerQueue:self.fullSyncTimer secondsFromNow:seconds];
 }
 
@@ -481,6 +543,32 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   });
 }
 
+- (void)applyPushedRules:(NSData*)rules reply:(void (^)(BOOL success))reply {
+  // Pushed rules go through the same staged update as a rule download, so they are applied on
+  // syncQueue to avoid interleaving with the rule download stage of a sync.
+  dispatch_async(self.syncQueue, ^() {
+    SNTSyncStatusType status = SNTSyncStatusTypeUnknown;
+    SNTSyncState* syncState = [self createSyncStateWithStatus:&status];
+    if (!syncState) {
+      LOGE(@"Pushed rules failed to create sync state: %ld", status);
+      if (reply) reply(NO);
+      return;
+    }
+
+    // The pushed rules are a sync v2 message.
+    if (!syncState.isSyncV2) {
+      LOGE(@"Pushed rules ignored: sync v2 not enabled");
+      if (reply) reply(NO);
+      return;
+    }
+
+    SNTSyncRuleDownload* p = [[SNTSyncRuleDownload alloc] initWithState:syncState];
+    BOOL success = [p applyRuleDownloadResponse:rules];
+    LOGD(@"Pushed rules %@", success ? @"applied" : @"failed");
+    if (reply) reply(success);
+  });
+}
+
 - (void)preflightSync {
   SNTSyncStatusType status = SNTSyncStatusTypeUnknown;
   SNTSyncState* syncState = [self createSyncStateWithStatus:&status];
@@ -490,9 +578,12 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   }
   syncState.preflightOnly = YES;
   [self preflightWithSyncState:syncState];
+  [self updateServerBackoffWithSyncState:syncState];
 }
 
 - (void)pushNotificationSyncSecondsFromNow:(uint64_t)seconds {
+  // A push-triggered sync must not pile onto a server that asked us to back off.
+  seconds = [self secondsRespectingServerBackoff:seconds];
   if (seconds > 0) {
     [self rescheduleTimerQueue:self.fullSyncTimer secondsFromNow:seconds];
     return;
@@ -506,6 +597,7 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   }
   syncState.pushNotificationSync = YES;
   [self preflightWithSyncState:syncState];
+  [self updateServerBackoffWithSyncState:syncState];
 }
 
 - (MOLXPCConnection*)daemonConnection {
@@ -631,7 +723,9 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   if (!syncState) {
     return status;
   }
-  return [self preflightWithSyncState:syncState];
+  status = [self preflightWithSyncState:syncState];
+  [self updateServerBackoffWithSyncState:syncState];
+  return status;
 }
 
 - (SNTSyncStatusType)preflightWithSyncState:(SNTSyncState*)syncState {
@@ -702,13 +796,14 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
     // (e.g. sync v1). In that case, fall back to the server's regular full_sync_interval.
     if (self.pushNotifications && syncState.pushNotificationsFullSyncInterval) {
       [self rescheduleTimerQueue:self.fullSyncTimer
-                  secondsFromNow:self.pushNotifications.fullSyncInterval];
+                  secondsFromNow:[self jitteredInterval:self.pushNotifications.fullSyncInterval]];
     } else {
       NSUInteger interval = syncState.fullSyncInterval
                                 ? syncState.fullSyncInterval.unsignedIntegerValue
                                 : self.persistedFullSyncInterval;
       LOGD(@"Push notifications not configured by server. Sync every %lu min.", interval / 60);
-      [self rescheduleTimerQueue:self.fullSyncTimer secondsFromNow:interval];
+      [self rescheduleTimerQueue:self.fullSyncTimer
+                  secondsFromNow:[self jitteredInterval:interval]];
     }
 
     if (syncState.preflightOnly) return SNTSyncStatusTypeSuccess;
@@ -760,6 +855,11 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 }
 
 - (SNTSyncStatusType)ruleDownloadWithSyncState:(SNTSyncState*)syncState {
+  if (syncState.rulesUnchanged) {
+    SLOGD(@"Rule download skipped, rules are unchanged");
+    return [self postflightWithSyncState:syncState];
+  }
+
   SLOGD(@"Rule download starting");
   SNTSyncRuleDownload* p = [[SNTSyncRuleDownload alloc] initWithState:syncState];
   if ([p sync]) {
@@ -831,6 +931,100 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   return timerQueue;
 }
 
+/// Returns the session used for all requests to the sync server, creating a new one only when a
+/// setting it depends on has changed. Sharing one session across syncs and event uploads lets
+/// connections, TLS sessions and the client credential be reused instead of paying for a full mTLS
+/// handshake on every request, which otherwise dominates the cost of syncing on the server.
+- (MOLAuthenticatingURLSession*)authURLSessionForSyncBaseURL:(NSURL*)syncBaseURL {
+  SNTConfigurator* config = [SNTConfigurator configurator];
+
+  // Apply extra headers at the session level so all requests (including doctor checks) get them.
+  NSSet<NSString*>* restrictedHeaders = [NSSet setWithArray:@[
+    @"content-encoding",
+    @"content-length",
+    @"content-type",
+    @"connection",
+    @"host",
+    @"proxy-authenticate",
+    @"proxy-authorization",
+    @"www-authenticate",
+  ]];
+  NSMutableDictionary* filteredHeaders = [NSMutableDictionary dictionary];
+  [[config syncExtraHeaders] enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL* stop) {
+    if (![key isKindOfClass:[NSString class]] || ![object isKindOfClass:[NSString class]]) return;
+    if ([restrictedHeaders containsObject:((NSString*)key).lowercaseString]) return;
+    filteredHeaders[key] = object;
+  }];
+
+  NSDictionary* proxyConfig = [config syncProxyConfig];
+  NSArray* sessionKey = @[
+    syncBaseURL.host ?: [NSNull null],
+    proxyConfig ?: [NSNull null],
+    filteredHeaders,
+    [config syncServerAuthRootsFile] ?: [NSNull null],
+    [config syncServerAuthRootsData] ?: [NSNull null],
+    [config syncClientAuthCertificateFile] ?: [NSNull null],
+    [config syncClientAuthCertificatePassword] ?: [NSNull null],
+    [config syncClientAuthCertificateCn] ?: [NSNull null],
+    [config syncClientAuthCertificateIssuer] ?: [NSNull null],
+  ];
+
+  @synchronized(self) {
+    if (self.authURLSession && [self.authURLSessionKey isEqual:sessionKey]) {
+      return self.authURLSession;
+    }
+
+    // Let requests still using the old session finish.
+    [self.authURLSession.session finishTasksAndInvalidate];
+
+    NSURLSessionConfiguration* sessConfig =
+        [NSURLSessionConfiguration defaultSessionConfiguration];
+    sessConfig.connectionProxyDictionary = proxyConfig;
+    if (filteredHeaders.count) {
+      sessConfig.HTTPAdditionalHeaders = filteredHeaders;
+    }
+
+    MOLAuthenticatingURLSession* authURLSession =
+        [[MOLAuthenticatingURLSession alloc] initWithSessionConfiguration:sessConfig];
+    authURLSession.userAgent = @"santactl-sync/";
+    NSString* santactlVersion =
+        [[NSBundle mainBundle] objectForInfoDictionaryKey:@"CFBundleVersion"];
+    if (santactlVersion) {
+      authURLSession.userAgent = [authURLSession.userAgent stringByAppendingString:santactlVersion];
+    }
+    authURLSession.refusesRedirects = YES;
+    authURLSession.serverHostname = syncBaseURL.host;
+    authURLSession.loggingBlock = ^(NSString* line) {
+      SLOGD(@"%@", line);
+    };
+
+    // Configure server auth
+    if (santa::IsDomainPinned(syncBaseURL)) {
+#ifndef DEBUG
+      authURLSession.serverRootsPemString = santa::PinnedCertPEMs();
+#endif
+    } else if ([config syncServerAuthRootsFile]) {
+      authURLSession.serverRootsPemFile = [config syncServerAuthRootsFile];
+    } else if ([config syncServerAuthRootsData]) {
+      authURLSession.serverRootsPemData = [config syncServerAuthRootsData];
+    }
+
+    // Configure client auth
+    if ([config syncClientAuthCertificateFile]) {
+      authURLSession.clientCertFile = [config syncClientAuthCertificateFile];
+      authURLSession.clientCertPassword = [config syncClientAuthCertificatePassword];
+    } else if ([config syncClientAuthCertificateCn]) {
+      authURLSession.clientCertCommonName = [config syncClientAuthCertificateCn];
+    } else if ([config syncClientAuthCertificateIssuer]) {
+      authURLSession.clientCertIssuerCn = [config syncClientAuthCertificateIssuer];
+    }
+
+    self.authURLSession = authURLSession;
+    self.authURLSessionKey = sessionKey;
+    return authURLSession;
+  }
+}
+
 - (SNTSyncState*)createSyncStateWithStatus:(SNTSyncStatusType*)status {
   // Gather some data needed during some sync stages
   SNTSyncState* syncState = [[SNTSyncState alloc] init];
@@ -862,46 +1056,6 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
   syncState.xsrfToken = self.xsrfToken;
   syncState.xsrfTokenHeader = self.xsrfTokenHeader;
 
-  NSURLSessionConfiguration* sessConfig = [NSURLSessionConfiguration defaultSessionConfiguration];
-  sessConfig.connectionProxyDictionary = [[SNTConfigurator configurator] syncProxyConfig];
-
-  // Apply extra headers at the session level so all requests (including doctor checks) get them.
-  NSSet<NSString*>* restrictedHeaders = [NSSet setWithArray:@[
-    @"content-encoding",
-    @"content-length",
-    @"content-type",
-    @"connection",
-    @"host",
-    @"proxy-authenticate",
-    @"proxy-authorization",
-    @"www-authenticate",
-  ]];
-  NSDictionary* extraHeaders = [config syncExtraHeaders];
-  if (extraHeaders.count) {
-    NSMutableDictionary* filtered = [NSMutableDictionary dictionary];
-    [extraHeaders enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL* stop) {
-      if (![key isKindOfClass:[NSString class]] || ![object isKindOfClass:[NSString class]]) return;
-      if ([restrictedHeaders containsObject:((NSString*)key).lowercaseString]) return;
-      filtered[key] = object;
-    }];
-    if (filtered.count) {
-      sessConfig.HTTPAdditionalHeaders = filtered;
-    }
-  }
-
-  MOLAuthenticatingURLSession* authURLSession =
-      [[MOLAuthenticatingURLSession alloc] initWithSessionConfiguration:sessConfig];
-  authURLSession.userAgent = @"santactl-sync/";
-  NSString* santactlVersion = [[NSBundle mainBundle] objectForInfoDictionaryKey:@"CFBundleVersion"];
-  if (santactlVersion) {
-    authURLSession.userAgent = [authURLSession.userAgent stringByAppendingString:santactlVersion];
-  }
-  authURLSession.refusesRedirects = YES;
-  authURLSession.serverHostname = syncState.syncBaseURL.host;
-  authURLSession.loggingBlock = ^(NSString* line) {
-    SLOGD(@"%@", line);
-  };
-
   // Ask the daemon to determine if sync v2 is enabled. Sync v2 will be enabled
   // if a pinned domain is configured or if a valid push token chain is present.
   // The push token chain is stored in the sync state which is not accessible
@@ -910,17 +1064,6 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
     syncState.isSyncV2 = reply;
   }];
 
-  // Configure server auth
-  if (santa::IsDomainPinned(syncState.syncBaseURL)) {
-#ifndef DEBUG
-    authURLSession.serverRootsPemString = santa::PinnedCertPEMs();
-#endif
-  } else if ([config syncServerAuthRootsFile]) {
-    authURLSession.serverRootsPemFile = [config syncServerAuthRootsFile];
-  } else if ([config syncServerAuthRootsData]) {
-    authURLSession.serverRootsPemData = [config syncServerAuthRootsData];
-  }
-
 // Force sync v2 via compile-time define
 #ifdef SANTA_FORCE_SYNC_V2
   syncState.isSyncV2 = YES;
@@ -928,19 +1071,20 @@ static const uint8_t kMaxEnqueuedSyncs = 2;
 
   SLOGD(@"Using sync protocol version: %d", syncState.isSyncV2 ? 2 : 1);
 
-  // Configure client auth
-  if ([config syncClientAuthCertificateFile]) {
-    authURLSession.clientCertFile = [config syncClientAuthCertificateFile];
-    authURLSession.clientCertPassword = [config syncClientAuthCertificatePassword];
-  } else if ([config syncClientAuthCertificateCn]) {
-    authURLSession.clientCertCommonName = [config syncClientAuthCertificateCn];
-  } else if ([config syncClientAuthCertificateIssuer]) {
-    authURLSession.clientCertIssuerCn = [config syncClientAuthCertificateIssuer];
-  }
-
+  MOLAuthenticatingURLSession* authURLSession =
+      [self authURLSessionForSyncBaseURL:syncState.syncBaseURL];
   syncState.session = [authURLSession session];
   syncState.daemonConn = self.daemonConn;
   syncState.contentEncoding = config.syncClientContentEncoding;
+  if (syncState.contentEncoding == SNTSyncContentEncodingZstd &&
+      config.syncClientContentEncodingDictionary) {
+    syncState.zstdDictionary =
+        [NSData dataWithContentsOfFile:config.syncClientContentEncodingDictionary];
+    if (!syncState.zstdDictionary) {
+      LOGW(@"Unable to read zstd dictionary %@, compressing without it",
+           config.syncClientContentEncodingDictionary);
+    }
+  }
   syncState.pushNotificationsToken = self.pushNotifications.token;
 
   return syncState;
@@ -33,6 +33,10 @@
 - (void)rescheduleTimerQueue:(dispatch_source_t)timerQueue secondsFromNow:(uint64_t)seconds;
 - (dispatch_source_t)createSyncTimerWithBlock:(void (^)(void))block;
 - (void)handlePathReachable:(BOOL)reachable;
+@property NSDate* serverBackoffUntil;
+- (uint64_t)jitteredInterval:(uint64_t)interval;
+- (uint64_t)secondsRespectingServerBackoff:(uint64_t)seconds;
+- (void)updateServerBackoffWithSyncState:(SNTSyncState*)syncState;
 @end
 
 @interface SNTSyncManagerTest : XCTestCase
@@ -42,6 +46,41 @@
 
 #pragma mark - Test Timer Creation and Management
 
+- (void)testJitteredIntervalIsDeterministicAndBounded {
+  id mockConnection = OCMClassMock([MOLXPCConnection class]);
+  SNTSyncManager* sm1 = [[SNTSyncManager alloc] initWithDaemonConnection:mockConnection];
+  SNTSyncManager* sm2 = [[SNTSyncManager alloc] initWithDaemonConnection:mockConnection];
+
+  const uint64_t intervals[] = {0, 60, 600, 14400};
+  for (uint64_t interval : intervals) {
+    uint64_t jittered = [sm1 jitteredInterval:interval];
+    XCTAssertEqual(jittered, [sm2 jitteredInterval:interval]);
+    XCTAssertGreaterThanOrEqual(jittered, interval);
+    XCTAssertLessThanOrEqual(jittered, interval + interval / 10);
+  }
+}
+
+- (void)testServerBackoffDefersSyncs {
+  id mockConnection = OCMClassMock([MOLXPCConnection class]);
+  SNTSyncManager* syncManager = [[SNTSyncManager alloc] initWithDaemonConnection:mockConnection];
+  XCTAssertEqual([syncManager secondsRespectingServerBackoff:5], 5);
+
+  SNTSyncState* syncState = [[SNTSyncState alloc] init];
+  syncState.serverRetryAfter = @(400);
+  [syncManager updateServerBackoffWithSyncState:syncState];
+
+  // The backoff is at least what the server asked for, plus at most a quarter of it in jitter.
+  uint64_t deferred = [syncManager secondsRespectingServerBackoff:0];
+  XCTAssertGreaterThanOrEqual(deferred, 399);
+  XCTAssertLessThanOrEqual(deferred, 500);
+  XCTAssertEqual([syncManager secondsRespectingServerBackoff:1000], 1000);
+
+  // A sync without a Retry-After clears the backoff.
+  [syncManager updateServerBackoffWithSyncState:[[SNTSyncState alloc] init]];
+  XCTAssertNil(syncManager.serverBackoffUntil);
+  XCTAssertEqual([syncManager secondsRespectingServerBackoff:0], 0);
+}
+
 - (void)testTimersAreCreatedOnInitialization {
   // Verify that both timers are created when SNTSyncManager is initialized
   id mockConnection = OCMClassMock([MOLXPCConnection class]);
@@ -66,8 +66,12 @@ BOOL Postflight(SNTSyncPostflight* self) {
     }
   }];
 
-  typename Traits::PostflightResponseT response;
-  [self performRequest:[self requestWithMessage:req] intoMessage:&response timeout:30];
+  // When preflight found the rules unchanged the server has already recorded the sync, so only
+  // the local half of postflight is needed.
+  if (!self.syncState.rulesUnchanged) {
+    typename Traits::PostflightResponseT response;
+    [self performRequest:[self requestWithMessage:req] intoMessage:&response timeout:30];
+  }
   [rop updateSyncSettings:PostflightConfigBundle(self.syncState)
                     reply:^{
                     }];
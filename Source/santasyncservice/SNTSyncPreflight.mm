@@ -94,6 +94,17 @@ SNTNetworkFlowDefaultAction NetworkFlowDefaultActionFromProto(
   }
 }
 
+// Returns the entity tag from an ETag header value, or nil if there isn't one. Weak and strong tags
+// compare the same.
+static NSString* EntityTagFromHeader(NSString* header) {
+  NSString* tag = [header stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+  if ([tag hasPrefix:@"W/"]) tag = [tag substringFromIndex:2];
+  if (tag.length >= 2 && [tag hasPrefix:@"\""] && [tag hasSuffix:@"\""]) {
+    tag = [tag substringWithRange:NSMakeRange(1, tag.length - 2)];
+  }
+  return tag.length ? tag : nil;
+}
+
 static NSString* LoadedSantanetdVersion(MOLXPCConnection* daemonConn) {
   dispatch_semaphore_t sema = dispatch_semaphore_create(0);
   __block NSString* version;
@@ -169,12 +180,18 @@ BOOL Preflight(SNTSyncPreflight* self, google::protobuf::Arena* arena,
     }
   }];
 
+  // The version of the rules this host has, i.e. the rule hashes sent in this request. See the
+  // ETag handling below.
+  __block NSString* rulesVersion;
   [rop databaseRulesHash:^(NSString* execRulesHash, NSString* faaRulesHash, NSString* nfRulesHash,
                            NSString* signalRulesHash) {
     req->set_rules_hash(NSStringToUTF8String(execRulesHash));
+    rulesVersion = execRulesHash;
     if constexpr (IsV2) {
       req->set_file_access_rules_hash(NSStringToUTF8String(faaRulesHash));
       req->set_network_flow_rules_hash(NSStringToUTF8String(nfRulesHash));
+      rulesVersion = [NSString stringWithFormat:@"%@,%@,%@", execRulesHash ?: @"",
+                                                faaRulesHash ?: @"", nfRulesHash ?: @""];
     }
   }];
 
@@ -195,7 +212,11 @@ BOOL Preflight(SNTSyncPreflight* self, google::protobuf::Arena* arena,
   }
 
   typename Traits::PreflightResponseT resp;
-  NSError* err = [self performRequest:[self requestWithMessage:req] intoMessage:&resp timeout:30];
+  NSHTTPURLResponse* httpResponse;
+  NSError* err = [self performRequest:[self requestWithMessage:req]
+                          intoMessage:&resp
+                              timeout:30
+                             response:&httpResponse];
 
   if (err) {
     SLOGE(@"Failed preflight request: %@", err);
@@ -402,6 +423,16 @@ BOOL Preflight(SNTSyncPreflight* self, google::protobuf::Arena* arena,
     self.syncState.syncType = SNTSyncTypeNormal;
   }
 
+  // A server with no rule changes for this host can say so by returning the rules version the
+  // host sent as the ETag of the response. RuleDownload is then skipped and Postflight is only
+  // applied locally, so the sync is a single request.
+  NSString* etag = EntityTagFromHeader([httpResponse valueForHTTPHeaderField:@"ETag"]);
+  self.syncState.rulesUnchanged = self.syncState.syncType == SNTSyncTypeNormal && etag &&
+                                  [etag isEqualToString:rulesVersion];
+  if (self.syncState.rulesUnchanged) {
+    SLOGD(@"Preflight: rules are unchanged (%@)", etag);
+  }
+
   // When running as sync v1, check if we have a push token chain. If so, save
   // the chain in the configurator, and check if we now should enable sync v2.
   // If so, do the preflight again as v2.
@@ -19,4 +19,14 @@
 @class SNTRule;
 
 @interface SNTSyncRuleDownload : SNTSyncStage
+
+///
+///  Apply rules that were pushed to this host rather than downloaded.
+///
+///  @param data A serialized sync v2 RuleDownloadResponse. It must not have a cursor, the rules
+///              are applied as a single update without contacting the sync server.
+///  @return YES if the rules were applied.
+///
+- (BOOL)applyRuleDownloadResponse:(NSData*)data;
+
 @end
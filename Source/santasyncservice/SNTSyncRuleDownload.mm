@@ -18,7 +18,12 @@
 
 #import <Foundation/Foundation.h>
 
+#include <atomic>
+#include <memory>
+#include <string>
+
 #import "Source/common/MOLXPCConnection.h"
+#include "Source/common/RuleBatch.h"
 #import "Source/common/SNTFileAccessRule.h"
 #import "Source/common/SNTNetworkFlowRule.h"
 #import "Source/common/SNTRule.h"
@@ -43,13 +48,16 @@ using santa::NSStringToUTF8String;
 using santa::StringToNSString;
 
 template <bool IsV2>
-SNTRule* RuleFromProtoRule(const typename santa::ProtoTraits<IsV2>::RuleT& rule);
+bool BatchRuleFromProtoRule(const typename santa::ProtoTraits<IsV2>::RuleT& rule,
+                            santa::ExecutionRuleBatch::Rule* batchRule);
 template <bool IsV2>
-void ProcessBundleNotificationsForRule(SNTSyncRuleDownload* self, SNTRule* rule,
+void ProcessBundleNotificationsForRule(SNTSyncRuleDownload* self,
+                                       const santa::ExecutionRuleBatch::Rule& rule,
                                        const typename santa::ProtoTraits<IsV2>::RuleT* protoRule);
 template <bool IsV2>
 void ProcessDeprecatedBundleNotificationsForRule(
-    SNTRule* rule, const typename santa::ProtoTraits<IsV2>::RuleT* protoRule);
+    const santa::ExecutionRuleBatch::Rule& rule,
+    const typename santa::ProtoTraits<IsV2>::RuleT* protoRule);
 SNTFileAccessRule* FAARuleFromProtoFAARuleRemove(
     const ::pbv2::FileAccessRule::Remove& pbRemoveRule);
 SNTFileAccessRule* FAARuleFromProtoFileAccessRule(const ::pbv2::FileAccessRule& wi);
@@ -62,29 +70,8 @@ NSArray* ProcessesFromProtoFAARuleProcesses(
 SNTNetworkFlowRule* NetworkFlowRuleFromProto(const ::pbv2::NetworkFlowRule& nr);
 SNTSignal* SignalFromProtoSignalRule(const ::pbv2::TelemetrySignalRule& sr);
 
-// Small local object to more easily return the different sets of downloaded rules.
-@interface SNTDownloadedRuleSets : NSObject
-@property(readonly) NSArray<SNTRule*>* executionRules;
-@property(readonly) NSArray<SNTFileAccessRule*>* fileAccessRules;
-@property(readonly) NSArray<SNTNetworkFlowRule*>* networkRules;
-@property(readonly) NSArray<SNTSignal*>* signals;
-@end
-
-@implementation SNTDownloadedRuleSets
-- (instancetype)initWithExecutionRules:(NSArray<SNTRule*>*)executionRules
-                       fileAccessRules:(NSArray<SNTFileAccessRule*>*)fileAccessRules
-                          networkRules:(NSArray<SNTNetworkFlowRule*>*)networkRules
-                               signals:(NSArray<SNTSignal*>*)signals {
-  self = [super init];
-  if (self) {
-    _executionRules = executionRules;
-    _fileAccessRules = fileAccessRules;
-    _networkRules = networkRules;
-    _signals = signals;
-  }
-  return self;
-}
-@end
+// The number of downloaded rule pages that may be waiting to be converted and staged.
+static const long kMaxPendingRuleDownloadPages = 2;
 
 SNTRuleCleanup SyncTypeToRuleCleanup(SNTSyncType syncType) {
   switch (syncType) {
@@ -95,101 +82,252 @@ SNTRuleCleanup SyncTypeToRuleCleanup(SNTSyncType syncType) {
   }
 }
 
-// Downloads new rules from server and converts them into SNTRule.
-// Returns an array of all converted rules, or nil if there was a server problem.
-// Note that rules from the server are filtered.
+// Logs the errors santad reported while updating the rules database. Returns the success value.
+static BOOL LogRuleUpdateErrors(BOOL success, NSArray<NSError*>* errors) {
+  if (!success) {
+    SLOGE(@"Failed to add rule(s) to database:");
+    for (NSError* e in errors) {
+      SLOGE(@"\t%@. Reason: %@", e.localizedDescription, e.localizedFailureReason);
+    }
+  } else if (errors.count > 0) {
+    SLOGW(@"Added rule(s) to database but with the following reported issues:");
+    for (NSError* e in errors) {
+      SLOGW(@"\t%@. Reason: %@", e.localizedDescription, e.localizedFailureReason);
+    }
+  }
+  return success;
+}
+
+// Sends one page of downloaded rules to santad to be staged, beginning the staged update before
+// the first page that has any rules. Execution rules are sent as a serialized
+// santa::rulebatch::ExecutionRuleBatch, or nil if there are none.
+// Returns NO if the rules could not be staged.
+static BOOL StageRulesWithDaemon(SNTSyncRuleDownload* self, NSString* __strong* updateID,
+                                 NSData* executionRuleBatch,
+                                 NSArray<SNTFileAccessRule*>* fileAccessRules,
+                                 NSArray<SNTNetworkFlowRule*>* networkRules,
+                                 NSArray<SNTSignal*>* signals) {
+  BOOL hasOtherRules = fileAccessRules.count || networkRules.count || signals.count;
+  if (!executionRuleBatch && !hasOtherRules) {
+    return YES;
+  }
+
+  if (!*updateID) {
+    dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+    __block NSString* newUpdateID;
+    __block NSError* error;
+    [[self.daemonConn remoteObjectProxy]
+        databaseRuleBeginStagedUpdateFromSource:SNTRuleAddSourceSyncService
+                                          reply:^(NSString* u, NSError* e) {
+                                            newUpdateID = u;
+                                            error = e;
+                                            dispatch_semaphore_signal(sema);
+                                          }];
+    if (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 30 * NSEC_PER_SEC))) {
+      SLOGE(@"Failed to add rule(s) to database: timeout sending rules to daemon");
+      return NO;
+    }
+    if (!newUpdateID) {
+      SLOGE(@"Failed to add rule(s) to database: %@. Reason: %@", error.localizedDescription,
+            error.localizedFailureReason);
+      return NO;
+    }
+    *updateID = newUpdateID;
+  }
+
+  __block NSArray<NSError*>* errors;
+  __block BOOL success;
+  BOOL (^waitForReply)(dispatch_semaphore_t) = ^BOOL(dispatch_semaphore_t sema) {
+    if (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 60 * NSEC_PER_SEC))) {
+      SLOGE(@"Failed to add rule(s) to database: timeout sending rules to daemon");
+      return NO;
+    }
+    return LogRuleUpdateErrors(success, errors);
+  };
+
+  if (executionRuleBatch) {
+    dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+    [[self.daemonConn remoteObjectProxy]
+        databaseRuleStageExecutionRuleBatch:executionRuleBatch
+                                   updateID:*updateID
+                                      reply:^(BOOL didSucceed, NSArray<NSError*>* e) {
+                                        errors = e;
+                                        success = didSucceed;
+                                        dispatch_semaphore_signal(sema);
+                                      }];
+    if (!waitForReply(sema)) return NO;
+  }
+
+  if (hasOtherRules) {
+    dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+    [[self.daemonConn remoteObjectProxy]
+        databaseRuleStageExecutionRules:@[]
+                        fileAccessRules:fileAccessRules
+                       networkFlowRules:networkRules
+                                signals:signals
+                               updateID:*updateID
+                                  reply:^(BOOL didSucceed, NSArray<NSError*>* e) {
+                                    errors = e;
+                                    success = didSucceed;
+                                    dispatch_semaphore_signal(sema);
+                                  }];
+    if (!waitForReply(sema)) return NO;
+  }
+  return YES;
+}
+
+// Converts one page of downloaded rules and sends them to santad to be staged.
+// Returns NO if the rules could not be staged.
 template <bool IsV2>
-SNTDownloadedRuleSets* DownloadNewRulesFromServer(SNTSyncRuleDownload* self) {
+BOOL ProcessRuleDownloadPage(
+    SNTSyncRuleDownload* self,
+    const typename santa::ProtoTraits<IsV2>::RuleDownloadResponseT& response,
+    NSString* __strong* updateID) {
   using Traits = santa::ProtoTraits<IsV2>;
+
+  // Execution rules are the bulk of a large rule set, so they go to santad as a protobuf batch
+  // rather than as an SNTRule each.
   google::protobuf::Arena arena;
+  auto newRules = google::protobuf::Arena::Create<santa::ExecutionRuleBatch>(&arena);
+  NSMutableArray<SNTFileAccessRule*>* newFileAccessRules = [NSMutableArray array];
+  NSMutableArray<SNTNetworkFlowRule*>* newNetworkRules = [NSMutableArray array];
+  NSMutableArray<SNTSignal*>* newSignals = [NSMutableArray array];
+
+  for (const typename Traits::RuleT& rule : response.rules()) {
+    santa::ExecutionRuleBatch::Rule* r = newRules->add_rules();
+    if (!BatchRuleFromProtoRule<IsV2>(rule, r)) {
+      SLOGD(@"Ignoring bad rule: %s", rule.Utf8DebugString().c_str());
+      newRules->mutable_rules()->RemoveLast();
+      continue;
+    }
+    ProcessBundleNotificationsForRule<IsV2>(self, *r, &rule);
+  }
+
+  if constexpr (IsV2) {
+    for (const typename Traits::FileAccessRuleT& faaRule : response.file_access_rules()) {
+      SNTFileAccessRule* rule = FAARuleFromProtoFileAccessRule(faaRule);
+      if (!rule) {
+        SLOGD(@"Ignoring bad file access rule: %s", faaRule.Utf8DebugString().c_str());
+        continue;
+      }
+      [newFileAccessRules addObject:rule];
+    }
+
+    for (const ::pbv2::NetworkFlowRule& networkRule : response.network_flow_rules()) {
+      SNTNetworkFlowRule* rule = NetworkFlowRuleFromProto(networkRule);
+      if (!rule) {
+        SLOGD(@"Ignoring bad network flow rule: %s", networkRule.Utf8DebugString().c_str());
+        continue;
+      }
+      [newNetworkRules addObject:rule];
+    }
+
+    for (const ::pbv2::TelemetrySignalRule& signalRule : response.telemetry_signal_rules()) {
+      SNTSignal* s = SignalFromProtoSignalRule(signalRule);
+      if (!s) {
+        SLOGD(@"Ignoring bad telemetry signal rule: %s", signalRule.Utf8DebugString().c_str());
+        continue;
+      }
+      [newSignals addObject:s];
+    }
+  }
+
+  NSMutableData* executionRuleBatch;
+  if (newRules->rules_size() > 0) {
+    executionRuleBatch = [NSMutableData dataWithLength:newRules->ByteSizeLong()];
+    if (!newRules->SerializeToArray(executionRuleBatch.mutableBytes,
+                                    static_cast<int>(executionRuleBatch.length))) {
+      SLOGE(@"Failed to add rule(s) to database: unable to serialize rules");
+      return NO;
+    }
+  }
+
+  if (!StageRulesWithDaemon(self, updateID, executionRuleBatch, newFileAccessRules,
+                            newNetworkRules, newSignals)) {
+    return NO;
+  }
+  self.syncState.rulesProcessed += newRules->rules_size();
+  self.syncState.fileAccessRulesProcessed += newFileAccessRules.count;
+  self.syncState.networkFlowRulesProcessed += newNetworkRules.count;
+  self.syncState.signalsProcessed += newSignals.count;
+  return YES;
+}
+
+// Downloads new rules from server, converts them for santad, and sends each page to santad to be
+// staged so only a few pages of rules are held at a time. The ID of the staged update
+// is returned in updateID, which is left nil if no rules were received.
+// Returns NO if there was a server problem or santad could not stage the rules, in which case the
+// caller must abort any staged update.
+// Pages are converted and staged on a worker queue while the next page is being downloaded, so
+// the round trip to the server overlaps with the work on the previous page.
+// Note that rules from the server are filtered.
+template <bool IsV2>
+BOOL DownloadNewRulesFromServer(SNTSyncRuleDownload* self, NSString* __strong* updateID) {
+  using Traits = santa::ProtoTraits<IsV2>;
 
   self.syncState.rulesReceived = 0;
   self.syncState.fileAccessRulesReceived = 0;
   self.syncState.networkFlowRulesReceived = 0;
   self.syncState.signalsReceived = 0;
-  NSMutableArray<SNTRule*>* newRules = [NSMutableArray array];
-  NSMutableArray<SNTFileAccessRule*>* newFileAccessRules = [NSMutableArray array];
-  NSMutableArray<SNTNetworkFlowRule*>* newNetworkRules = [NSMutableArray array];
-  NSMutableArray<SNTSignal*>* newSignals = [NSMutableArray array];
+  self.syncState.rulesProcessed = 0;
+  self.syncState.fileAccessRulesProcessed = 0;
+  self.syncState.networkFlowRulesProcessed = 0;
+  self.syncState.signalsProcessed = 0;
+
+  // Pages are processed in order on a serial queue. Downloading may only run this many pages
+  // ahead of processing, which bounds the number of pages held in memory.
+  dispatch_queue_t processQueue = dispatch_queue_create(
+      "com.northpolesec.santa.syncservice.ruledownload", DISPATCH_QUEUE_SERIAL);
+  dispatch_semaphore_t pendingPages = dispatch_semaphore_create(kMaxPendingRuleDownloadPages);
+  dispatch_group_t processGroup = dispatch_group_create();
+  auto processFailed = std::make_shared<std::atomic<bool>>(false);
+  BOOL downloadFailed = NO;
   std::string cursor;
 
   do {
+    auto response = std::make_shared<typename Traits::RuleDownloadResponseT>();
     @autoreleasepool {
+      google::protobuf::Arena arena;
       auto req = google::protobuf::Arena::Create<typename Traits::RuleDownloadRequestT>(&arena);
       req->set_machine_id(NSStringToUTF8String(self.syncState.machineID));
 
       if (!cursor.empty()) {
         req->set_cursor(cursor);
       }
-      typename Traits::RuleDownloadResponseT response;
       NSError* err = [self performRequest:[self requestWithMessage:req]
-                              intoMessage:&response
+                              intoMessage:response.get()
                                   timeout:30];
 
       if (err) {
         SLOGE(@"Error downloading rules: %@", err);
-        return nil;
-      }
-
-      for (const typename Traits::RuleT& rule : response.rules()) {
-        SNTRule* r = RuleFromProtoRule<IsV2>(rule);
-        if (!r) {
-          SLOGD(@"Ignoring bad rule: %s", rule.Utf8DebugString().c_str());
-          continue;
-        }
-        ProcessBundleNotificationsForRule<IsV2>(self, r, &rule);
-        [newRules addObject:r];
+        downloadFailed = YES;
+        break;
       }
+    }
 
-      if constexpr (IsV2) {
-        for (const typename Traits::FileAccessRuleT& faaRule : response.file_access_rules()) {
-          SNTFileAccessRule* rule = FAARuleFromProtoFileAccessRule(faaRule);
-          if (!rule) {
-            SLOGD(@"Ignoring bad file access rule: %s", faaRule.Utf8DebugString().c_str());
-            continue;
-          }
-          [newFileAccessRules addObject:rule];
-        }
-
-        for (const ::pbv2::NetworkFlowRule& networkRule : response.network_flow_rules()) {
-          SNTNetworkFlowRule* rule = NetworkFlowRuleFromProto(networkRule);
-          if (!rule) {
-            SLOGD(@"Ignoring bad network flow rule: %s", networkRule.Utf8DebugString().c_str());
-            continue;
-          }
-          [newNetworkRules addObject:rule];
-        }
+    cursor = response->cursor();
+    SLOGI(@"Received %lu rules", (unsigned long)response->rules_size());
+    self.syncState.rulesReceived += response->rules_size();
+    if constexpr (IsV2) {
+      self.syncState.fileAccessRulesReceived += response->file_access_rules_size();
+      self.syncState.networkFlowRulesReceived += response->network_flow_rules_size();
+      self.syncState.signalsReceived += response->telemetry_signal_rules_size();
+    }
 
-        for (const ::pbv2::TelemetrySignalRule& signalRule : response.telemetry_signal_rules()) {
-          SNTSignal* s = SignalFromProtoSignalRule(signalRule);
-          if (!s) {
-            SLOGD(@"Ignoring bad telemetry signal rule: %s", signalRule.Utf8DebugString().c_str());
-            continue;
-          }
-          [newSignals addObject:s];
+    dispatch_semaphore_wait(pendingPages, DISPATCH_TIME_FOREVER);
+    dispatch_group_async(processGroup, processQueue, ^{
+      @autoreleasepool {
+        // Once a page fails the update will be aborted, so later pages are dropped.
+        if (!processFailed->load() && !ProcessRuleDownloadPage<IsV2>(self, *response, updateID)) {
+          processFailed->store(true);
         }
       }
+      dispatch_semaphore_signal(pendingPages);
+    });
+  } while (!cursor.empty() && !processFailed->load());
 
-      cursor = response.cursor();
-      SLOGI(@"Received %lu rules", (unsigned long)response.rules_size());
-      self.syncState.rulesReceived += response.rules_size();
-      if constexpr (IsV2) {
-        self.syncState.fileAccessRulesReceived += response.file_access_rules_size();
-        self.syncState.networkFlowRulesReceived += response.network_flow_rules_size();
-        self.syncState.signalsReceived += response.telemetry_signal_rules_size();
-      }
-    }
-  } while (!cursor.empty());
-
-  self.syncState.rulesProcessed = newRules.count;
-  self.syncState.fileAccessRulesProcessed = newFileAccessRules.count;
-  self.syncState.networkFlowRulesProcessed = newNetworkRules.count;
-  self.syncState.signalsProcessed = newSignals.count;
-
-  return [[SNTDownloadedRuleSets alloc] initWithExecutionRules:newRules
-                                               fileAccessRules:newFileAccessRules
-                                                  networkRules:newNetworkRules
-                                                       signals:newSignals];
+  dispatch_group_wait(processGroup, DISPATCH_TIME_FOREVER);
+  return !downloadFailed && !processFailed->load();
 }
 
 NSArray* PathsFromProtoFAARulePaths(
@@ -418,17 +556,20 @@ SNTSignal* SignalFromProtoSignalRule(const ::pbv2::TelemetrySignalRule& sr) {
   }
 }
 
+// Fills in batchRule from a downloaded rule, validated and normalized as an SNTRule would be.
+// Returns false if the rule is not valid.
 template <bool IsV2>
-SNTRule* RuleFromProtoRule(const typename santa::ProtoTraits<IsV2>::RuleT& rule) {
+bool BatchRuleFromProtoRule(const typename santa::ProtoTraits<IsV2>::RuleT& rule,
+                            santa::ExecutionRuleBatch::Rule* batchRule) {
   using Traits = santa::ProtoTraits<IsV2>;
-  NSString* identifier = StringToNSString(rule.identifier());
+  batchRule->set_identifier(rule.identifier());
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
-  if (!identifier.length) identifier = StringToNSString(rule.deprecated_sha256());
+  if (batchRule->identifier().empty()) batchRule->set_identifier(rule.deprecated_sha256());
 #pragma clang diagnostic pop
-  if (!identifier.length) {
+  if (batchRule->identifier().empty()) {
     LOGE(@"Failed to process rule with no identifier");
-    return nil;
+    return false;
   }
 
   SNTRuleState state;
@@ -449,7 +590,7 @@ SNTRule* RuleFromProtoRule(const typename santa::ProtoTraits<IsV2>::RuleT& rule)
         }
       }
       LOGE(@"Failed to process rule with unknown policy: %d", rule.policy());
-      return nil;
+      return false;
   }
 
   SNTRuleType type;
@@ -459,39 +600,24 @@ SNTRule* RuleFromProtoRule(const typename santa::ProtoTraits<IsV2>::RuleT& rule)
     case Traits::TEAMID: type = SNTRuleTypeTeamID; break;
     case Traits::SIGNINGID: type = SNTRuleTypeSigningID; break;
     case Traits::CDHASH: type = SNTRuleTypeCDHash; break;
-    default: LOGE(@"Failed to process rule with unknown type: %d", rule.rule_type()); return nil;
+    default: LOGE(@"Failed to process rule with unknown type: %d", rule.rule_type()); return false;
   }
 
-  const std::string& custom_msg = rule.custom_msg();
-  NSString* customMsg = (!custom_msg.empty()) ? StringToNSString(custom_msg) : nil;
-
-  const std::string& custom_url = rule.custom_url();
-  NSString* customURL = (!custom_url.empty()) ? StringToNSString(custom_url) : nil;
-
-  const std::string& cel_expr = rule.cel_expr();
-  NSString* celExpr = (!cel_expr.empty()) ? StringToNSString(cel_expr) : nil;
-
-  int64_t ruleId = 0;
-  NSString* seatbeltPolicy = nil;
+  batchRule->set_state(state);
+  batchRule->set_type(type);
+  batchRule->set_custom_msg(rule.custom_msg());
+  batchRule->set_custom_url(rule.custom_url());
+  batchRule->set_cel_expr(rule.cel_expr());
   if constexpr (IsV2) {
-    ruleId = rule.rule_id();
-    const std::string& sb_policy = rule.seatbelt_policy();
-    if (!sb_policy.empty()) {
-      seatbeltPolicy = StringToNSString(sb_policy);
-    }
+    batchRule->set_rule_id(rule.rule_id());
+    batchRule->set_seatbelt_policy(rule.seatbelt_policy());
   }
-  return [[SNTRule alloc] initWithIdentifier:identifier
-                                       state:state
-                                        type:type
-                                   customMsg:customMsg
-                                   customURL:customURL
-                                     celExpr:celExpr
-                              seatbeltPolicy:seatbeltPolicy
-                                      ruleId:ruleId];
+  return santa::NormalizeBatchRule(*batchRule);
 }
 
 template <bool IsV2>
-void ProcessBundleNotificationsForRule(SNTSyncRuleDownload* self, SNTRule* rule,
+void ProcessBundleNotificationsForRule(SNTSyncRuleDownload* self,
+                                       const santa::ExecutionRuleBatch::Rule& rule,
                                        const typename santa::ProtoTraits<IsV2>::RuleT* protoRule) {
   // Display a system notification if notification_app_name is set and this is not a clean sync.
   NSString* appName = StringToNSString(protoRule->notification_app_name());
@@ -500,12 +626,14 @@ void ProcessBundleNotificationsForRule(SNTSyncRuleDownload* self, SNTRule* rule,
     // spam users with notifications for many apps that might be included in a clean sync, and
     // we don't want to fallback to the deprecated behavior. Also ignore app name if the rule state
     // is remove.
-    if (self.syncState.syncType != SNTSyncTypeNormal || rule.state == SNTRuleStateRemove) return;
+    if (self.syncState.syncType != SNTSyncTypeNormal || rule.state() == SNTRuleStateRemove) {
+      return;
+    }
     [[SNTPushNotificationsTracker tracker] addNotification:[@{
                                              kFileName : appName,
                                              kFileBundleBinaryCount : @(0)
                                            } mutableCopy]
-                                                   forHash:rule.identifier];
+                                                   forHash:StringToNSString(rule.identifier())];
     return;
   }
 
@@ -515,17 +643,17 @@ void ProcessBundleNotificationsForRule(SNTSyncRuleDownload* self, SNTRule* rule,
 
 template <bool IsV2>
 void ProcessDeprecatedBundleNotificationsForRule(
-    SNTRule* rule, const typename santa::ProtoTraits<IsV2>::RuleT* protoRule) {
+    const santa::ExecutionRuleBatch::Rule& rule,
+    const typename santa::ProtoTraits<IsV2>::RuleT* protoRule) {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
   // Check rule for extra notification related info.
-  if (rule.state == SNTRuleStateAllow || rule.state == SNTRuleStateAllowCompiler) {
+  if (rule.state() == SNTRuleStateAllow || rule.state() == SNTRuleStateAllowCompiler) {
     // primaryHash is the bundle hash if there was a bundle hash included in the rule, otherwise
     // it is simply the binary hash.
-    NSString* primaryHash = StringToNSString(protoRule->file_bundle_hash());
-    if (primaryHash.length != 64) {
-      primaryHash = rule.identifier;
-    }
+    const std::string& bundleHash = protoRule->file_bundle_hash();
+    NSString* primaryHash = StringToNSString(bundleHash.length() == 64 ? bundleHash
+                                                                       : rule.identifier());
 
     // As we read in rules, we update the "remaining count" information. This count represents the
     // number of rules associated with the primary hash that still need to be downloaded and added.
@@ -544,93 +672,131 @@ void ProcessDeprecatedBundleNotificationsForRule(
 }
 
 - (BOOL)sync {
-  // Grab the new rules from server
-  SNTDownloadedRuleSets* newRules;
+  // Grab the new rules from server, staging them with santad as they arrive.
+  NSString* updateID;
+  BOOL downloaded;
   if (self.syncState.isSyncV2) {
-    newRules = DownloadNewRulesFromServer<true>(self);
+    downloaded = DownloadNewRulesFromServer<true>(self, &updateID);
   } else {
-    newRules = DownloadNewRulesFromServer<false>(self);
+    downloaded = DownloadNewRulesFromServer<false>(self, &updateID);
   }
-  // `DownloadNewRulesFromServer` returns nil if there was a problem with the download
-  if (!newRules) {
+  // `DownloadNewRulesFromServer` returns NO if there was a problem with the download
+  if (!downloaded) {
+    if (updateID) {
+      [[self.daemonConn remoteObjectProxy] databaseRuleAbortStagedUpdate:updateID];
+    }
     return NO;
   }
 
   // If the request was successfully completed, but no new rules received, just return
-  if (!newRules.executionRules.count && !newRules.fileAccessRules.count &&
-      !newRules.networkRules.count && !newRules.signals.count) {
+  if (!updateID) {
     return YES;
   }
 
-  // Tell santad to add the new rules to the database.
-  // Wait until finished or until 5 minutes pass.
-  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
-  __block NSArray<NSError*>* errors;
-  __block BOOL success;
-  [[self.daemonConn remoteObjectProxy]
-      databaseRuleAddExecutionRules:newRules.executionRules
-                    fileAccessRules:newRules.fileAccessRules
-                   networkFlowRules:newRules.networkRules
-                            signals:newRules.signals
-                        ruleCleanup:SyncTypeToRuleCleanup(self.syncState.syncType)
-                             source:SNTRuleAddSourceSyncService
-                              reply:^(BOOL didSucceed, NSArray<NSError*>* e) {
-                                errors = e;
-                                success = didSucceed;
-                                dispatch_semaphore_signal(sema);
-                              }];
-  if (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 300 * NSEC_PER_SEC))) {
-    SLOGE(@"Failed to add rule(s) to database: timeout sending rules to daemon");
-    return NO;
-  }
-
-  if (!success) {
-    SLOGE(@"Failed to add rule(s) to database:");
-    for (NSError* e in errors) {
-      SLOGE(@"\t%@. Reason: %@", e.localizedDescription, e.localizedFailureReason);
-    }
+  if (![self commitStagedUpdate:updateID
+                    ruleCleanup:SyncTypeToRuleCleanup(self.syncState.syncType)]) {
     return NO;
-  } else if (errors.count > 0) {
-    SLOGW(@"Added rule(s) to database but with the following reported issues:");
-    for (NSError* e in errors) {
-      SLOGW(@"\t%@. Reason: %@", e.localizedDescription, e.localizedFailureReason);
-    }
   }
 
   // Tell santad to record a successful rules sync and wait for it to finish.
-  sema = dispatch_semaphore_create(0);
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
   [[self.daemonConn remoteObjectProxy] updateSyncSettings:RuleSyncConfigBundle()
                                                     reply:^{
                                                       dispatch_semaphore_signal(sema);
                                                     }];
   dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
 
-  if (newRules.executionRules.count) {
-    SLOGI(@"Processed %lu execution rules", newRules.executionRules.count);
-  }
+  [self logProcessedRules];
+
+  // Send out push notifications about any newly allowed binaries
+  // that had been previously blocked by santad.
+  [self announceUnblockingRules:self.syncState.rulesProcessed];
+  return YES;
+}
 
-  if (newRules.fileAccessRules.count) {
-    SLOGI(@"Processed %lu file access rules", newRules.fileAccessRules.count);
+- (BOOL)applyRuleDownloadResponse:(NSData*)data {
+  ::pbv2::RuleDownloadResponse response;
+  if (!response.ParseFromArray(data.bytes, static_cast<int>(data.length))) {
+    SLOGE(@"Failed to parse pushed rules");
+    return NO;
   }
+  if (!response.cursor().empty()) {
+    SLOGE(@"Ignoring pushed rules with a cursor, pushes must fit in a single page");
+    return NO;
+  }
+
+  SLOGI(@"Received %d pushed rules", response.rules_size());
+  self.syncState.rulesReceived = response.rules_size();
+  self.syncState.fileAccessRulesReceived = response.file_access_rules_size();
+  self.syncState.networkFlowRulesReceived = response.network_flow_rules_size();
+  self.syncState.signalsReceived = response.telemetry_signal_rules_size();
 
-  if (newRules.networkRules.count) {
-    SLOGI(@"Processed %lu network flow rules", newRules.networkRules.count);
+  NSString* updateID;
+  if (!ProcessRuleDownloadPage<true>(self, response, &updateID)) {
+    if (updateID) {
+      [[self.daemonConn remoteObjectProxy] databaseRuleAbortStagedUpdate:updateID];
+    }
+    return NO;
+  }
+  if (!updateID) {
+    return YES;
   }
 
-  if (newRules.signals.count) {
-    SLOGI(@"Processed %lu signal rules", newRules.signals.count);
+  // Pushed rules are always a delta, existing rules are never cleaned up. The last rule sync
+  // time is left alone as well, this isn't a sync with the server.
+  if (![self commitStagedUpdate:updateID ruleCleanup:SNTRuleCleanupNone]) {
+    return NO;
   }
 
-  // Send out push notifications about any newly allowed binaries
-  // that had been previously blocked by santad.
-  [self announceUnblockingRules:newRules.executionRules];
+  [self logProcessedRules];
+  [self announceUnblockingRules:self.syncState.rulesProcessed];
   return YES;
 }
 
+// Tell santad to apply the staged rules to the database.
+// Wait until finished or until 5 minutes pass.
+- (BOOL)commitStagedUpdate:(NSString*)updateID ruleCleanup:(SNTRuleCleanup)ruleCleanup {
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  __block NSArray<NSError*>* errors;
+  __block BOOL success;
+  [[self.daemonConn remoteObjectProxy]
+      databaseRuleCommitStagedUpdate:updateID
+                         ruleCleanup:ruleCleanup
+                               reply:^(BOOL didSucceed, NSArray<NSError*>* e) {
+                                 errors = e;
+                                 success = didSucceed;
+                                 dispatch_semaphore_signal(sema);
+                               }];
+  if (dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, 300 * NSEC_PER_SEC))) {
+    SLOGE(@"Failed to add rule(s) to database: timeout sending rules to daemon");
+    return NO;
+  }
+
+  return LogRuleUpdateErrors(success, errors);
+}
+
+- (void)logProcessedRules {
+  if (self.syncState.rulesProcessed) {
+    SLOGI(@"Processed %lu execution rules", self.syncState.rulesProcessed);
+  }
+
+  if (self.syncState.fileAccessRulesProcessed) {
+    SLOGI(@"Processed %lu file access rules", self.syncState.fileAccessRulesProcessed);
+  }
+
+  if (self.syncState.networkFlowRulesProcessed) {
+    SLOGI(@"Processed %lu network flow rules", self.syncState.networkFlowRulesProcessed);
+  }
+
+  if (self.syncState.signalsProcessed) {
+    SLOGI(@"Processed %lu signal rules", self.syncState.signalsProcessed);
+  }
+}
+
 // Send out push notifications for allowed bundles/binaries whose rule download was preceded by
 // an associated announcing FCM message.
-- (void)announceUnblockingRules:(NSArray<SNTRule*>*)newRules {
-  if (newRules.count == 0) {
+- (void)announceUnblockingRules:(NSUInteger)newRuleCount {
+  if (newRuleCount == 0) {
     // No new execution rules received
     return;
   }
@@ -20,6 +20,7 @@
 #import "Source/common/SNTDropRootPrivs.h"
 #import "Source/common/SNTLogging.h"
 #import "Source/common/SNTXPCControlInterface.h"
+#include "Source/common/StoredEventEncoding.h"
 #import "Source/santasyncservice/SNTSyncBroadcaster.h"
 #import "Source/santasyncservice/SNTSyncManager.h"
 
@@ -80,6 +81,16 @@
   [self.syncManager postEventsToSyncServer:events reply:reply];
 }
 
+- (void)postEncodedEventsToSyncServer:(NSData*)encodedEvents reply:(void (^)(BOOL))reply {
+  NSArray<SNTStoredEvent*>* events = santa::DecodeStoredEventBatch(encodedEvents);
+  if (!events) {
+    LOGE(@"Unable to decode events from santad");
+    reply(NO);
+    return;
+  }
+  [self.syncManager postEventsToSyncServer:events reply:reply];
+}
+
 - (void)uploadSignalReportsToSyncServer:(NSArray<SNTStoredSignalReport*>*)reports
                                   reply:(void (^)(BOOL))reply {
   [self.syncManager uploadSignalReportsToSyncServer:reports reply:reply];
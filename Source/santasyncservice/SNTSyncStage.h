@@ -86,6 +86,17 @@
                         intoMessage:(nullable google::protobuf::Message*)message
                             timeout:(NSTimeInterval)timeout
                          statusCode:(nullable NSInteger*)statusCode;
+
+/**
+  Like performRequest:intoMessage:timeout: but also returns the final HTTP response, e.g. to
+  inspect its headers. The response is nil when no HTTP response was received.
+
+  @param response Out param for the final HTTP response; pass NULL to ignore.
+*/
+- (nullable NSError*)performRequest:(nonnull NSURLRequest*)request
+                        intoMessage:(nullable google::protobuf::Message*)message
+                            timeout:(NSTimeInterval)timeout
+                           response:(NSHTTPURLResponse* _Nullable* _Nullable)response;
 #endif
 
 @end
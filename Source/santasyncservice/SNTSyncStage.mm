@@ -19,6 +19,7 @@
 
 #import "Source/common/MOLXPCConnection.h"
 #import "Source/common/NSData+Zlib.h"
+#import "Source/common/NSData+Zstd.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTError.h"
@@ -33,6 +34,32 @@
 
 using santa::NSStringToUTF8String;
 
+// Parse a Retry-After header, either delay-seconds or an HTTP-date, into the number of seconds
+// from now, capped at kMaxServerRetryAfterSeconds. Returns nil if the header is missing, invalid
+// or doesn't ask for a delay.
+static NSNumber* RetryAfterSecondsFromHeader(NSString* header) {
+  header = [header stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+  if (!header.length) return nil;
+
+  NSTimeInterval seconds;
+  long long delay;
+  NSScanner* scanner = [NSScanner scannerWithString:header];
+  if ([scanner scanLongLong:&delay] && scanner.isAtEnd) {
+    seconds = delay;
+  } else {
+    NSDateFormatter* formatter = [[NSDateFormatter alloc] init];
+    formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    formatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+    formatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+    NSDate* date = [formatter dateFromString:header];
+    if (!date) return nil;
+    seconds = ceil(date.timeIntervalSinceNow);
+  }
+
+  if (seconds <= 0) return nil;
+  return @(MIN((NSUInteger)seconds, kMaxServerRetryAfterSeconds));
+}
+
 @interface SNTSyncStage ()
 
 @property(readwrite) NSURLSession* urlSession;
@@ -126,6 +153,12 @@ using santa::NSStringToUTF8String;
       compressed = [requestBody zlibCompressed];
       contentEncodingHeader = @"deflate";
       break;
+    case SNTSyncContentEncodingZstd:
+      compressed = [requestBody zstdCompressedWithDictionary:self.syncState.zstdDictionary];
+      contentEncodingHeader = @"zstd";
+      // NSURLSession doesn't decode zstd responses, see dataFromRequest:.
+      [req setValue:@"zstd, gzip, deflate, br" forHTTPHeaderField:@"Accept-Encoding"];
+      break;
     default:
       // This would be a programming error.
       LOGD(@"Unexpected value for content encoding %ld", self.syncState.contentEncoding);
@@ -143,7 +176,7 @@ using santa::NSStringToUTF8String;
 
 - (NSData*)dataFromRequest:(NSURLRequest*)request
                    timeout:(NSTimeInterval)timeout
-                statusCode:(NSInteger*)statusCode
+             finalResponse:(out NSHTTPURLResponse**)finalResponse
                      error:(NSError**)error {
   NSHTTPURLResponse* response;
   NSError* requestError;
@@ -179,6 +212,18 @@ using santa::NSStringToUTF8String;
       continue;
     }
 
+    // A server shedding load can say when to come back. Stop retrying and let the sync manager
+    // hold off until then, rather than adding to the load with more attempts.
+    if (response.statusCode == 429 || response.statusCode == 503) {
+      NSNumber* retryAfter =
+          RetryAfterSecondsFromHeader([response valueForHTTPHeaderField:@"Retry-After"]);
+      if (retryAfter) {
+        SLOGI(@"Server asked to retry after %@ seconds", retryAfter);
+        self.syncState.serverRetryAfter = retryAfter;
+        break;
+      }
+    }
+
     // Most 4xx errors indicate a client-side problem that won't resolve by retrying.
     // Exceptions: 408 (timeout) and 429 (rate limited) are transient and worth retrying.
     if (response.statusCode >= 400 && response.statusCode < 500 && response.statusCode != 408 &&
@@ -187,10 +232,10 @@ using santa::NSStringToUTF8String;
     }
   }
 
-  // Report the final HTTP status (0 if no HTTP response was received) so callers
-  // can special-case specific codes, e.g. a 404 for an endpoint an older server
-  // does not implement.
-  if (statusCode) *statusCode = response.statusCode;
+  // Report the final HTTP response (nil if none was received) so callers can
+  // special-case specific codes, e.g. a 404 for an endpoint an older server
+  // does not implement, or inspect its headers.
+  if (finalResponse) *finalResponse = response;
 
   // If the final attempt resulted in an error, log the error and return nil.
   if (response.statusCode != 200) {
@@ -204,6 +249,19 @@ using santa::NSStringToUTF8String;
     [SNTError populateError:error withCode:SNTErrorCodeFailedToHTTP format:@"%@", errStr ?: @""];
     return nil;
   }
+
+  // NSURLSession decodes the encodings it supports itself, but not zstd.
+  if (data.length && [[[response valueForHTTPHeaderField:@"Content-Encoding"] lowercaseString]
+                         isEqualToString:@"zstd"]) {
+    data = [data zstdDecompressed];
+    if (!data) {
+      LOGE(@"Failed to decompress zstd response");
+      [SNTError populateError:error
+                     withCode:SNTErrorCodeFailedToHTTP
+                       format:@"Failed to decompress zstd response"];
+      return nil;
+    }
+  }
   return data;
 }
 
@@ -217,8 +275,24 @@ using santa::NSStringToUTF8String;
                intoMessage:(google::protobuf::Message*)message
                    timeout:(NSTimeInterval)timeout
                 statusCode:(NSInteger*)statusCode {
+  NSHTTPURLResponse* response;
+  NSError* error = [self performRequest:request
+                            intoMessage:message
+                                timeout:timeout
+                               response:&response];
+  if (statusCode) *statusCode = response.statusCode;
+  return error;
+}
+
+- (NSError*)performRequest:(NSURLRequest*)request
+               intoMessage:(google::protobuf::Message*)message
+                   timeout:(NSTimeInterval)timeout
+                  response:(NSHTTPURLResponse**)response {
   NSError* error;
-  NSData* data = [self dataFromRequest:request timeout:timeout statusCode:statusCode error:&error];
+  NSData* data = [self dataFromRequest:request
+                               timeout:timeout
+                         finalResponse:response
+                                 error:&error];
   if (error) {
     SLOGE(@"Error performing request: %@", error.localizedDescription);
     return error;
@@ -29,7 +29,8 @@
 /// that might be needed in later stages.
 @interface SNTSyncState : NSObject
 
-/// Configured session to use for requests.
+/// Configured session to use for requests. The session is shared with other sync states so that
+/// connections are reused, it must not be invalidated when the sync completes.
 @property NSURLSession* session;
 
 /// Connection to the daemon control interface.
@@ -112,6 +113,9 @@
 /// The content-encoding to use for the client uploads during the sync session.
 @property SNTSyncContentEncoding contentEncoding;
 
+/// The dictionary to compress uploads with, when the content-encoding is zstd.
+@property NSData* zstdDictionary;
+
 /// Counts of execution and file access rules received and processed during rule download.
 @property NSUInteger rulesReceived;
 @property NSUInteger rulesProcessed;
@@ -123,8 +127,16 @@
 @property NSUInteger signalsProcessed;
 
 @property BOOL preflightOnly;
+
+/// Set during preflight when the server indicated, via the ETag of the response, that it has no
+/// rule changes for this host. RuleDownload is skipped and no Postflight request is made.
+@property BOOL rulesUnchanged;
 @property BOOL pushNotificationSync;
 
+/// Set when the server rejected a request with a 429 or 503 and a Retry-After header. The number
+/// of seconds to wait before syncing again.
+@property NSNumber* serverRetryAfter;
+
 @property BOOL isSyncV2;
 
 @end
@@ -16,7 +16,4 @@
 #import "Source/santasyncservice/SNTSyncState.h"
 
 @implementation SNTSyncState
-- (void)dealloc {
-  [self.session invalidateAndCancel];
-}
 @end
@@ -17,7 +17,12 @@
 #import <OCMock/OCMock.h>
 #import <XCTest/XCTest.h>
 
+#include <atomic>
+#include <memory>
+
 #import "Source/common/MOLXPCConnection.h"
+#import "Source/common/NSData+Zstd.h"
+#include "Source/common/RuleBatch.h"
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTConfigurator.h"
 #import "Source/common/SNTModeTransition.h"
@@ -34,6 +39,7 @@
 #import "Source/common/SNTSyncConstants.h"
 #import "Source/common/SNTSystemInfo.h"
 #import "Source/common/SNTXPCControlInterface.h"
+#include "Source/common/StoredEventEncoding.h"
 #import "Source/santasyncservice/SNTPushClientNATS.h"
 #import "Source/santasyncservice/SNTPushNotifications.h"
 #import "Source/santasyncservice/SNTSyncEventUpload.h"
@@ -43,6 +49,7 @@
 #import "Source/santasyncservice/SNTSyncRuleDownload.h"
 #import "Source/santasyncservice/SNTSyncStage.h"
 #import "Source/santasyncservice/SNTSyncState.h"
+#include "syncv2/v2.pb.h"
 
 @interface SNTSyncStage (XSSI)
 - (NSData*)stripXssi:(NSData*)data;
@@ -67,6 +74,8 @@
 @property id<SNTDaemonControlXPC> daemonConnRop;
 @property id configMock;
 @property id siMock;
+// Execution rule batches staged by stubStagedRuleUpdate, in the order they were sent.
+@property NSMutableArray<NSData*>* stagedExecutionRuleBatches;
 @end
 
 // The SNTSyncTestV2 subclass will re-run all tests with `self.syncState.isSyncV2 == YES`
@@ -199,6 +208,71 @@
   return [NSData dataWithContentsOfFile:path];
 }
 
+- (void)stubStagedRuleUpdate {
+  OCMStub([self.daemonConnRop
+      databaseRuleBeginStagedUpdateFromSource:SNTRuleAddSourceSyncService
+                                        reply:([OCMArg invokeBlockWithArgs:@"update-id",
+                                                                           [NSNull null], nil])]);
+  OCMStub([self.daemonConnRop
+      databaseRuleStageExecutionRules:OCMOCK_ANY
+                      fileAccessRules:OCMOCK_ANY
+                     networkFlowRules:OCMOCK_ANY
+                              signals:OCMOCK_ANY
+                             updateID:@"update-id"
+                                reply:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(YES),
+                                                                   [NSNull null], nil])]);
+  self.stagedExecutionRuleBatches = [NSMutableArray array];
+  OCMStub([self.daemonConnRop databaseRuleStageExecutionRuleBatch:[OCMArg any]
+                                                         updateID:@"update-id"
+                                                            reply:[OCMArg any]])
+      .andDo(^(NSInvocation* inv) {
+        NSData* __unsafe_unretained batch = nil;
+        [inv getArgument:&batch atIndex:2];
+        [self.stagedExecutionRuleBatches addObject:batch];
+        void (^__unsafe_unretained replyBlock)(BOOL, NSArray<NSError*>*) = nil;
+        [inv getArgument:&replyBlock atIndex:4];
+        replyBlock(YES, nil);
+      });
+  OCMStub([self.daemonConnRop
+      databaseRuleCommitStagedUpdate:@"update-id"
+                         ruleCleanup:SNTRuleCleanupNone
+                               reply:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(YES), [NSNull null],
+                                                                  nil])]);
+}
+
+// Verifies that one of the staged execution rule batches holds exactly the given rules.
+- (void)verifyStagedExecutionRules:(NSArray<SNTRule*>*)rules {
+  NSMutableArray<NSArray<SNTRule*>*>* stagedBatches = [NSMutableArray array];
+  for (NSData* data in self.stagedExecutionRuleBatches) {
+    santa::ExecutionRuleBatch batch;
+    XCTAssertTrue(batch.ParseFromArray(data.bytes, static_cast<int>(data.length)));
+    NSMutableArray<SNTRule*>* batchRules = [NSMutableArray array];
+    for (const santa::ExecutionRuleBatch::Rule& rule : batch.rules()) {
+      SNTRule* r = santa::RuleFromBatchRule(rule);
+      XCTAssertNotNil(r);
+      if (r) [batchRules addObject:r];
+    }
+    [stagedBatches addObject:batchRules];
+  }
+  XCTAssertTrue([stagedBatches containsObject:rules], @"Staged batches: %@", stagedBatches);
+}
+
+// Serves all of the given events as the first page of pending events.
+- (void)stubPendingEvents:(NSArray<SNTStoredEvent*>*)events {
+  OCMStub([self.daemonConnRop
+              databaseEventsPendingAfterIndex:nil
+                                        limit:0
+                                        reply:([OCMArg invokeBlockWithArgs:[NSNull null], events,
+                                                                           nil])])
+      .ignoringNonObjectArgs();
+  OCMStub([self.daemonConnRop
+              databaseEventsPendingAfterIndex:[OCMArg isNotNil]
+                                        limit:0
+                                        reply:([OCMArg invokeBlockWithArgs:[NSNull null], @[],
+                                                                           nil])])
+      .ignoringNonObjectArgs();
+}
+
 - (void)setupDefaultDaemonConnResponses {
   struct RuleCounts ruleCounts = {};
   OCMStub([self.daemonConnRop
@@ -340,6 +414,46 @@
   XCTAssertEqualObjects(self.syncState.xsrfToken, @"my-xsrf-token");
 }
 
+- (void)testBaseRetryAfterStopsRetrying {
+  __block int attempts = 0;
+  NSURLResponse* resp = [self responseWithCode:429 headerDict:@{@"Retry-After" : @"120"}];
+  [self stubRequestBody:nil
+               response:resp
+                  error:nil
+          validateBlock:^BOOL(NSURLRequest* req) {
+            attempts++;
+            return [req.URL.absoluteString containsString:@"/a/"];
+          }];
+
+  NSString* stageName = [@"a" stringByAppendingFormat:@"/%@", self.syncState.machineID];
+  NSURL* u1 = [NSURL URLWithString:stageName relativeToURL:self.syncState.syncBaseURL];
+
+  SNTSyncStage* sut = [[SNTSyncStage alloc] initWithState:self.syncState];
+  sut.retryBackoffBase = 0;  // Skip the real retry nanosleep.
+  NSMutableURLRequest* req = [NSMutableURLRequest requestWithURL:u1];
+  XCTAssertNotNil([sut performRequest:req intoMessage:NULL timeout:5]);
+  XCTAssertEqual(attempts, 1);
+  XCTAssertEqualObjects(self.syncState.serverRetryAfter, @(120));
+}
+
+- (void)testBaseRetryAfterHTTPDateIsCapped {
+  NSDateFormatter* formatter = [[NSDateFormatter alloc] init];
+  formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+  formatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+  formatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss 'GMT'";
+  NSString* date = [formatter stringFromDate:[NSDate dateWithTimeIntervalSinceNow:86400]];
+
+  NSURLResponse* resp = [self responseWithCode:503 headerDict:@{@"Retry-After" : date}];
+  [self stubRequestBody:nil response:resp error:nil validateBlock:nil];
+
+  SNTSyncStage* sut = [[SNTSyncStage alloc] initWithState:self.syncState];
+  sut.retryBackoffBase = 0;  // Skip the real retry nanosleep.
+  NSURL* u1 = [NSURL URLWithString:@"a" relativeToURL:self.syncState.syncBaseURL];
+  NSURLRequest* req = [NSURLRequest requestWithURL:u1];
+  XCTAssertNotNil([sut performRequest:req intoMessage:NULL timeout:5]);
+  XCTAssertEqualObjects(self.syncState.serverRetryAfter, @(kMaxServerRetryAfterSeconds));
+}
+
 #pragma mark - SNTSyncPreflight Tests
 
 - (void)testPreflightBasicResponse {
@@ -375,6 +489,33 @@
   XCTAssertNil(self.syncState.overrideFileAccessAction);
 }
 
+- (void)testPreflightZstdContentEncoding {
+  [self setupDefaultDaemonConnResponses];
+  self.syncState.contentEncoding = SNTSyncContentEncodingZstd;
+  SNTSyncPreflight* sut = [[SNTSyncPreflight alloc] initWithState:self.syncState];
+
+  NSData* respData = [[self dataFromFixture:@"sync_preflight_basic.json"] zstdCompressed];
+  NSHTTPURLResponse* resp = [self responseWithCode:200
+                                        headerDict:@{@"Content-Encoding" : @"zstd"}];
+  [self stubRequestBody:respData
+               response:resp
+                  error:nil
+          validateBlock:^BOOL(NSURLRequest* req) {
+            NSData* expectedReqData =
+                [self dataFromFixture:(self.syncState.isSyncV2) ? @"sync_preflight_request_v2.json"
+                                                                : @"sync_preflight_request.json"];
+            XCTAssertEqualObjects([req.HTTPBody zstdDecompressed], expectedReqData);
+            XCTAssertEqualObjects([req valueForHTTPHeaderField:@"Content-Encoding"], @"zstd");
+            XCTAssertTrue([[req valueForHTTPHeaderField:@"Accept-Encoding"] containsString:@"zstd"]);
+            return YES;
+          }];
+
+  // The response is decompressed before it is parsed
+  XCTAssertTrue([sut sync]);
+  XCTAssertEqual(self.syncState.clientMode, SNTClientModeMonitor);
+  XCTAssertEqual(self.syncState.eventBatchSize, 100);
+}
+
 - (void)testPreflightTurnOnBlockUSBMount {
   [self setupDefaultDaemonConnResponses];
   SNTSyncPreflight* sut = [[SNTSyncPreflight alloc] initWithState:self.syncState];
@@ -714,6 +855,49 @@
   [sut sync];
 }
 
+- (void)testPreflightRulesUnchangedETag {
+  [self setupDefaultDaemonConnResponses];
+  SNTSyncPreflight* sut = [[SNTSyncPreflight alloc] initWithState:self.syncState];
+
+  NSString* rulesVersion =
+      self.syncState.isSyncV2 ? @"the-hash,the-faa-hash,the-nf-hash" : @"the-hash";
+  NSHTTPURLResponse* resp = [self
+      responseWithCode:200
+            headerDict:@{@"ETag" : [NSString stringWithFormat:@"W/\"%@\"", rulesVersion]}];
+  [self stubRequestBody:nil response:resp error:nil validateBlock:nil];
+
+  XCTAssertTrue([sut sync]);
+  XCTAssertTrue(self.syncState.rulesUnchanged);
+}
+
+- (void)testPreflightRulesChangedETag {
+  [self setupDefaultDaemonConnResponses];
+  SNTSyncPreflight* sut = [[SNTSyncPreflight alloc] initWithState:self.syncState];
+
+  NSHTTPURLResponse* resp = [self responseWithCode:200 headerDict:@{@"ETag" : @"\"other-hash\""}];
+  [self stubRequestBody:nil response:resp error:nil validateBlock:nil];
+
+  XCTAssertTrue([sut sync]);
+  XCTAssertFalse(self.syncState.rulesUnchanged);
+}
+
+- (void)testPreflightRulesUnchangedIgnoredForCleanSync {
+  [self setupDefaultDaemonConnResponses];
+  SNTSyncPreflight* sut = [[SNTSyncPreflight alloc] initWithState:self.syncState];
+
+  NSString* rulesVersion =
+      self.syncState.isSyncV2 ? @"the-hash,the-faa-hash,the-nf-hash" : @"the-hash";
+  NSHTTPURLResponse* resp = [self responseWithCode:200 headerDict:@{@"ETag" : rulesVersion}];
+  [self stubRequestBody:[self dataFromDict:@{kSyncType : @"CLEAN"}]
+               response:resp
+                  error:nil
+          validateBlock:nil];
+
+  XCTAssertTrue([sut sync]);
+  XCTAssertEqual(self.syncState.syncType, SNTSyncTypeClean);
+  XCTAssertFalse(self.syncState.rulesUnchanged);
+}
+
 // This method is designed to help facilitate easy testing of many different
 // permutations of clean sync request / response values and how syncType gets set.
 - (void)cleanSyncPreflightRequiredSyncType:(SNTSyncType)requestedSyncType
@@ -984,7 +1168,7 @@
   XCTAssertNil(err);
   XCTAssertEqual(events.count, 7);
 
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   [self stubRequestBody:nil
                response:nil
@@ -1147,7 +1331,7 @@
 
   NSArray* events = @[ exec, allow, block, audit ];
 
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   [self stubRequestBody:nil
                response:nil
@@ -1234,7 +1418,7 @@
               reason:SNTTemporaryAdminModeDeniedReasonJustificationRequired],
   ];
 
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   [self stubRequestBody:nil
                response:nil
@@ -1290,7 +1474,7 @@
               reason:SNTTemporaryAdminModeLeaveReasonSessionEnded],
   ];
 
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   [self stubRequestBody:nil
                response:nil
@@ -1336,7 +1520,7 @@
                                                            error:&err];
   XCTAssertNil(err);
 
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   [self stubRequestBody:nil
                response:nil
@@ -1380,7 +1564,7 @@
                                                            error:&err];
   XCTAssertNil(err);
 
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   __block int requestCount = 0;
 
@@ -1407,6 +1591,139 @@
   }
 }
 
+- (void)testEventUploadFetchesEventsInBatches {
+  SNTSyncEventUpload* sut = [[SNTSyncEventUpload alloc] initWithState:self.syncState];
+  self.syncState.eventBatchSize = 3;
+
+  NSSet* allowedClasses = [NSSet setWithObjects:[NSArray class], [SNTStoredEvent class], nil];
+  NSData* eventData = [self dataFromFixture:@"sync_eventupload_input_basic.plist"];
+  NSError* err;
+  NSArray<SNTStoredEvent*>* events = [NSKeyedUnarchiver unarchivedObjectOfClasses:allowedClasses
+                                                                         fromData:eventData
+                                                                            error:&err];
+  XCTAssertNil(err);
+  XCTAssertEqual(events.count, 7);
+
+  // Serve the events a page at a time, as the event table does.
+  __block NSMutableArray<NSNumber*>* fetchLimits = [NSMutableArray array];
+  OCMStub([self.daemonConnRop databaseEventsPendingAfterIndex:[OCMArg any]
+                                                        limit:0
+                                                        reply:[OCMArg any]])
+      .ignoringNonObjectArgs()
+      .andDo(^(NSInvocation* inv) {
+        NSNumber* __unsafe_unretained lastIdx = nil;
+        NSUInteger limit = 0;
+        void (^__unsafe_unretained replyBlock)(NSData*, NSArray<SNTStoredEvent*>*) = nil;
+        [inv getArgument:&lastIdx atIndex:2];
+        [inv getArgument:&limit atIndex:3];
+        [inv getArgument:&replyBlock atIndex:4];
+        [fetchLimits addObject:@(limit)];
+
+        NSUInteger start = 0;
+        if (lastIdx) {
+          start = [events indexOfObjectPassingTest:^BOOL(SNTStoredEvent* e, NSUInteger, BOOL*) {
+                    return [e.idx isEqual:lastIdx];
+                  }] +
+                  1;
+        }
+        // Pages are encoded as santad does.
+        NSArray<SNTStoredEvent*>* page =
+            [events subarrayWithRange:NSMakeRange(start, MIN(limit, events.count - start))];
+        NSData* encodedEvents = santa::EncodeStoredEventBatch(page);
+        replyBlock(encodedEvents, encodedEvents ? nil : page);
+      });
+
+  NSMutableSet* removedIDs = [NSMutableSet set];
+  OCMStub([self.daemonConnRop databaseRemoveEventsWithIDs:[OCMArg any]])
+      .andDo(^(NSInvocation* inv) {
+        NSArray* __unsafe_unretained ids = nil;
+        [inv getArgument:&ids atIndex:2];
+        [removedIDs addObjectsFromArray:ids];
+      });
+
+  [self stubRequestBody:nil
+               response:nil
+                  error:nil
+          validateBlock:^BOOL(NSURLRequest* req) {
+            return YES;
+          }];
+
+  XCTAssertTrue([sut sync]);
+
+  XCTAssertEqualObjects(fetchLimits, (@[ @3, @3, @3 ]));
+  XCTAssertEqualObjects(removedIDs, [NSSet setWithArray:[events valueForKey:@"idx"]]);
+}
+
+- (void)testEventUploadConcurrentBatches {
+  SNTSyncEventUpload* sut = [[SNTSyncEventUpload alloc] initWithState:self.syncState];
+  self.syncState.eventBatchSize = 2;
+  OCMStub([self.configMock syncEventUploadConcurrency]).andReturn(3);
+
+  NSSet* allowedClasses = [NSSet setWithObjects:[NSArray class], [SNTStoredEvent class], nil];
+  NSData* eventData = [self dataFromFixture:@"sync_eventupload_input_basic.plist"];
+  NSError* err;
+  NSArray<SNTStoredEvent*>* events = [NSKeyedUnarchiver unarchivedObjectOfClasses:allowedClasses
+                                                                         fromData:eventData
+                                                                            error:&err];
+  XCTAssertNil(err);
+  XCTAssertEqual(events.count, 7);
+
+  OCMStub([self.daemonConnRop databaseEventsPendingAfterIndex:[OCMArg any]
+                                                        limit:0
+                                                        reply:[OCMArg any]])
+      .ignoringNonObjectArgs()
+      .andDo(^(NSInvocation* inv) {
+        NSNumber* __unsafe_unretained lastIdx = nil;
+        NSUInteger limit = 0;
+        void (^__unsafe_unretained replyBlock)(NSData*, NSArray<SNTStoredEvent*>*) = nil;
+        [inv getArgument:&lastIdx atIndex:2];
+        [inv getArgument:&limit atIndex:3];
+        [inv getArgument:&replyBlock atIndex:4];
+
+        NSUInteger start = 0;
+        if (lastIdx) {
+          start = [events indexOfObjectPassingTest:^BOOL(SNTStoredEvent* e, NSUInteger, BOOL*) {
+                    return [e.idx isEqual:lastIdx];
+                  }] +
+                  1;
+        }
+        replyBlock(nil,
+                   [events subarrayWithRange:NSMakeRange(start, MIN(limit, events.count - start))]);
+      });
+
+  NSMutableSet* removedIDs = [NSMutableSet set];
+  OCMStub([self.daemonConnRop databaseRemoveEventsWithIDs:[OCMArg any]])
+      .andDo(^(NSInvocation* inv) {
+        NSArray* __unsafe_unretained ids = nil;
+        [inv getArgument:&ids atIndex:2];
+        @synchronized(removedIDs) {
+          [removedIDs addObjectsFromArray:ids];
+        }
+      });
+
+  // Hold each request long enough for the next batches to start.
+  auto inFlight = std::make_shared<std::atomic<int>>(0);
+  auto maxInFlight = std::make_shared<std::atomic<int>>(0);
+  [self stubRequestBody:nil
+               response:nil
+                  error:nil
+          validateBlock:^BOOL(NSURLRequest* req) {
+            int now = ++*inFlight;
+            int seen = maxInFlight->load();
+            while (now > seen && !maxInFlight->compare_exchange_weak(seen, now)) {
+            }
+            usleep(100 * 1000);
+            --*inFlight;
+            return YES;
+          }];
+
+  XCTAssertTrue([sut sync]);
+
+  XCTAssertEqualObjects(removedIDs, [NSSet setWithArray:[events valueForKey:@"idx"]]);
+  XCTAssertGreaterThan(maxInFlight->load(), 1);
+  XCTAssertLessThanOrEqual(maxInFlight->load(), 3);
+}
+
 #pragma mark - SNTSyncRuleDownload Tests
 
 - (void)testRuleDownload {
@@ -1434,16 +1751,8 @@
             return requestDict[@"cursor"] != nil;
           }];
 
-  // Stub out the call to invoke the block, verification of the input is later
-  OCMStub([self.daemonConnRop
-      databaseRuleAddExecutionRules:OCMOCK_ANY
-                    fileAccessRules:OCMOCK_ANY
-                   networkFlowRules:OCMOCK_ANY
-                            signals:OCMOCK_ANY
-                        ruleCleanup:SNTRuleCleanupNone
-                             source:SNTRuleAddSourceSyncService
-                              reply:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(YES), [NSNull null],
-                                                                 nil])]);
+  // Stub out the calls to invoke the blocks, verification of the input is later
+  [self stubStagedRuleUpdate];
   OCMStub([self.daemonConnRop postRuleSyncNotificationForApplication:[OCMArg any]
                                                                reply:([OCMArg invokeBlock])]);
   // Invoke the reply immediately; otherwise sync blocks on the 5s reply timeout.
@@ -1481,13 +1790,12 @@
                                  ruleId:0],
   ];
 
-  OCMVerify([self.daemonConnRop databaseRuleAddExecutionRules:rules
-                                              fileAccessRules:OCMOCK_ANY
-                                             networkFlowRules:OCMOCK_ANY
-                                                      signals:OCMOCK_ANY
-                                                  ruleCleanup:SNTRuleCleanupNone
-                                                       source:SNTRuleAddSourceSyncService
-                                                        reply:OCMOCK_ANY]);
+  // Each page of rules is staged separately
+  [self verifyStagedExecutionRules:[rules subarrayWithRange:NSMakeRange(0, 3)]];
+  [self verifyStagedExecutionRules:[rules subarrayWithRange:NSMakeRange(3, 2)]];
+  OCMVerify([self.daemonConnRop databaseRuleCommitStagedUpdate:@"update-id"
+                                                   ruleCleanup:SNTRuleCleanupNone
+                                                         reply:OCMOCK_ANY]);
   OCMVerify([self.daemonConnRop postRuleSyncNotificationForApplication:@"yes" reply:OCMOCK_ANY]);
 }
 
@@ -1497,16 +1805,8 @@
   NSData* respData = [self dataFromFixture:@"sync_ruledownload_with_cel_1.json"];
   [self stubRequestBody:respData response:nil error:nil validateBlock:nil];
 
-  // Stub out the call to invoke the block, verification of the input is later
-  OCMStub([self.daemonConnRop
-      databaseRuleAddExecutionRules:OCMOCK_ANY
-                    fileAccessRules:OCMOCK_ANY
-                   networkFlowRules:OCMOCK_ANY
-                            signals:OCMOCK_ANY
-                        ruleCleanup:SNTRuleCleanupNone
-                             source:SNTRuleAddSourceSyncService
-                              reply:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(YES), [NSNull null],
-                                                                 nil])]);
+  // Stub out the calls to invoke the blocks, verification of the input is later
+  [self stubStagedRuleUpdate];
   OCMStub([self.daemonConnRop postRuleSyncNotificationForApplication:[OCMArg any]
                                                                reply:([OCMArg invokeBlock])]);
   // Invoke the reply immediately; otherwise sync blocks on the 5s reply timeout.
@@ -1535,13 +1835,10 @@
                                  ruleId:0],
   ];
 
-  OCMVerify([self.daemonConnRop databaseRuleAddExecutionRules:rules
-                                              fileAccessRules:OCMOCK_ANY
-                                             networkFlowRules:OCMOCK_ANY
-                                                      signals:OCMOCK_ANY
-                                                  ruleCleanup:SNTRuleCleanupNone
-                                                       source:SNTRuleAddSourceSyncService
-                                                        reply:OCMOCK_ANY]);
+  [self verifyStagedExecutionRules:rules];
+  OCMVerify([self.daemonConnRop databaseRuleCommitStagedUpdate:@"update-id"
+                                                   ruleCleanup:SNTRuleCleanupNone
+                                                         reply:OCMOCK_ANY]);
 }
 
 - (void)testRuleDownloadSeatbelt {
@@ -1554,15 +1851,7 @@
   NSData* respData = [self dataFromFixture:@"sync_ruledownload_with_seatbelt.json"];
   [self stubRequestBody:respData response:nil error:nil validateBlock:nil];
 
-  OCMStub([self.daemonConnRop
-      databaseRuleAddExecutionRules:OCMOCK_ANY
-                    fileAccessRules:OCMOCK_ANY
-                   networkFlowRules:OCMOCK_ANY
-                            signals:OCMOCK_ANY
-                        ruleCleanup:SNTRuleCleanupNone
-                             source:SNTRuleAddSourceSyncService
-                              reply:([OCMArg invokeBlockWithArgs:OCMOCK_VALUE(YES), [NSNull null],
-                                                                 nil])]);
+  [self stubStagedRuleUpdate];
   OCMStub([self.daemonConnRop postRuleSyncNotificationForApplication:[OCMArg any]
                                                                reply:([OCMArg invokeBlock])]);
   // Invoke the reply immediately; otherwise sync blocks on the 5s reply timeout.
@@ -1580,13 +1869,54 @@
                                  ruleId:0],
   ];
 
-  OCMVerify([self.daemonConnRop databaseRuleAddExecutionRules:rules
-                                              fileAccessRules:OCMOCK_ANY
-                                             networkFlowRules:OCMOCK_ANY
-                                                      signals:OCMOCK_ANY
-                                                  ruleCleanup:SNTRuleCleanupNone
-                                                       source:SNTRuleAddSourceSyncService
-                                                        reply:OCMOCK_ANY]);
+  [self verifyStagedExecutionRules:rules];
+  OCMVerify([self.daemonConnRop databaseRuleCommitStagedUpdate:@"update-id"
+                                                   ruleCleanup:SNTRuleCleanupNone
+                                                         reply:OCMOCK_ANY]);
+}
+
+- (void)testApplyRuleDownloadResponse {
+  SNTSyncRuleDownload* sut = [[SNTSyncRuleDownload alloc] initWithState:self.syncState];
+
+  ::santa::sync::v2::RuleDownloadResponse response;
+  ::santa::sync::v2::Rule* rule = response.add_rules();
+  rule->set_identifier("ee382e199f7eda58863a93a7854b930ade35798bc6856ee8e6ab6ce9277f0eab");
+  rule->set_policy(::santa::sync::v2::BLOCKLIST);
+  rule->set_rule_type(::santa::sync::v2::BINARY);
+  std::string serialized = response.SerializeAsString();
+
+  [self stubStagedRuleUpdate];
+  // Pushed rules are not a rule sync
+  OCMReject([self.daemonConnRop updateSyncSettings:OCMOCK_ANY reply:OCMOCK_ANY]);
+
+  XCTAssertTrue([sut applyRuleDownloadResponse:[NSData dataWithBytes:serialized.data()
+                                                              length:serialized.size()]]);
+
+  SNTRule* want = [[SNTRule alloc]
+      initWithIdentifier:@"ee382e199f7eda58863a93a7854b930ade35798bc6856ee8e6ab6ce9277f0eab"
+                   state:SNTRuleStateBlock
+                    type:SNTRuleTypeBinary];
+  [self verifyStagedExecutionRules:@[ want ]];
+  OCMVerify([self.daemonConnRop databaseRuleCommitStagedUpdate:@"update-id"
+                                                   ruleCleanup:SNTRuleCleanupNone
+                                                         reply:OCMOCK_ANY]);
+  XCTAssertEqual(self.syncState.rulesProcessed, 1);
+}
+
+- (void)testApplyRuleDownloadResponseRejectsCursor {
+  SNTSyncRuleDownload* sut = [[SNTSyncRuleDownload alloc] initWithState:self.syncState];
+
+  ::santa::sync::v2::RuleDownloadResponse response;
+  response.add_rules()->set_identifier("AAAAAAAAAA");
+  response.set_cursor("more");
+  std::string serialized = response.SerializeAsString();
+
+  OCMReject([self.daemonConnRop databaseRuleBeginStagedUpdateFromSource:SNTRuleAddSourceSyncService
+                                                                  reply:OCMOCK_ANY]);
+
+  XCTAssertFalse([sut applyRuleDownloadResponse:[NSData dataWithBytes:serialized.data()
+                                                               length:serialized.size()]]);
+  XCTAssertFalse([sut applyRuleDownloadResponse:[@"junk" dataUsingEncoding:NSUTF8StringEncoding]]);
 }
 
 #pragma mark - SNTSyncPostflight Tests
@@ -1612,6 +1942,18 @@
   OCMVerify([self.daemonConnRop updateSyncSettings:OCMOCK_ANY reply:OCMOCK_ANY]);
 }
 
+- (void)testPostflightSkipsRequestWhenRulesUnchanged {
+  [self setupDefaultDaemonConnResponses];
+  self.syncState.rulesUnchanged = YES;
+  SNTSyncPostflight* sut = [[SNTSyncPostflight alloc] initWithState:self.syncState];
+
+  OCMReject([self.syncState.session dataTaskWithRequest:OCMOCK_ANY
+                                      completionHandler:OCMOCK_ANY]);
+
+  XCTAssertTrue([sut sync]);
+  OCMVerify([self.daemonConnRop updateSyncSettings:OCMOCK_ANY reply:OCMOCK_ANY]);
+}
+
 - (void)testPostflightReportsRuleCounts {
   [self setupDefaultDaemonConnResponses];
   self.syncState.rulesReceived = 10;
@@ -1962,7 +2304,7 @@
   faaEvent.process = proc;
 
   NSArray* events = @[ execEvent, faaEvent ];
-  OCMStub([self.daemonConnRop databaseEventsPending:([OCMArg invokeBlockWithArgs:events, nil])]);
+  [self stubPendingEvents:events];
 
   [self stubRequestBody:nil
                response:nil
@@ -0,0 +1,88 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_TESTING_BENCHMARKS_BENCHUTILS_H
+#define SANTA_TESTING_BENCHMARKS_BENCHUTILS_H
+
+#include <mach/mach.h>
+#include <malloc/malloc.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace santa {
+
+// Upper bound on recorded samples per benchmark run, so very fast stages
+// with millions of iterations don't grow the sample buffer unboundedly.
+inline constexpr size_t kMaxBenchSamples = 1 << 20;
+
+inline uint64_t BenchNowNs() {
+  return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+// Runs `fn` once per benchmark iteration and reports p50/p99 latency over the
+// recorded iterations as counters. The clock reads add a few tens of
+// nanoseconds to every sample, which matters only for the cache stages. In
+// multithreaded benchmarks each thread's percentiles are averaged.
+template <typename Fn>
+void RunWithPercentiles(benchmark::State& state, Fn&& fn) {
+  std::vector<uint64_t> samples;
+  samples.reserve(std::min<size_t>(kMaxBenchSamples, 1 << 16));
+  for (auto _ : state) {
+    const uint64_t start = BenchNowNs();
+    fn();
+    const uint64_t elapsed = BenchNowNs() - start;
+    if (samples.size() < kMaxBenchSamples) samples.push_back(elapsed);
+  }
+  if (samples.empty()) return;
+
+  std::sort(samples.begin(), samples.end());
+  auto percentile = [&samples](double p) {
+    size_t idx = static_cast<size_t>(p * static_cast<double>(samples.size() - 1));
+    return static_cast<double>(samples[idx]);
+  };
+  state.counters["p50_ns"] = benchmark::Counter(percentile(0.50), benchmark::Counter::kAvgThreads);
+  state.counters["p99_ns"] = benchmark::Counter(percentile(0.99), benchmark::Counter::kAvgThreads);
+}
+
+// Bytes currently allocated from all malloc zones. The growth across building
+// a structure is its memory footprint, as long as nothing else allocates on
+// another thread meanwhile.
+inline size_t MallocBytesInUse() {
+  malloc_statistics_t stats = {};
+  malloc_zone_statistics(nullptr, &stats);
+  return stats.size_in_use;
+}
+
+// The process's physical footprint, as reported by Activity Monitor and
+// jetsam. Unlike MallocBytesInUse this includes memory SQLite and other
+// libraries map outside the malloc zones.
+inline size_t PhysFootprintBytes() {
+  task_vm_info_data_t info = {};
+  mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+  if (task_info(mach_task_self(), TASK_VM_INFO, reinterpret_cast<task_info_t>(&info), &count) !=
+      KERN_SUCCESS) {
+    return 0;
+  }
+  return static_cast<size_t>(info.phys_footprint);
+}
+
+}  // namespace santa
+
+#endif  // SANTA_TESTING_BENCHMARKS_BENCHUTILS_H
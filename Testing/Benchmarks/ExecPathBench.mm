@@ -0,0 +1,369 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+/*
+
+Microbenchmarks for the stages of an AUTH_EXEC decision.
+
+Run all stages:
+  bazel run -c opt //Testing/Benchmarks:exec_path
+
+Run a subset, with repetitions for more stable numbers:
+  bazel run -c opt //Testing/Benchmarks:exec_path -- \
+      --benchmark_filter='VerifyingHasher|PolicyProcessor' --benchmark_repetitions=5
+
+Besides Google Benchmark's mean time per iteration, every benchmark reports
+p50_ns and p99_ns counters computed from per-iteration samples. Tail latency
+is what an exec waiting on a decision actually sees, so compare those across
+revisions rather than the mean.
+
+The binary used by the hashing and policy stages defaults to /usr/bin/yes and
+can be overridden with the EXEC_PATH_BENCH_BINARY environment variable, e.g.
+to point it at a large app binary.
+
+*/
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#import <Foundation/Foundation.h>
+#import <fmdb/FMDB.h>
+#include <Kernel/kern/cs_blobs.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Source/common/SantaCache.h"
+#include "Source/common/ScopedFile.h"
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTConfigState.h"
+#import "Source/common/SNTConfigurator.h"
+#import "Source/common/SNTFileInfo.h"
+#import "Source/common/SNTRule.h"
+#include "Source/common/cel/Activation.h"
+#include "Source/common/cel/CELProtoTraits.h"
+#include "Source/common/cel/Evaluator.h"
+#include "Source/common/es/EndpointSecurityAPI.h"
+#include "Source/common/verifyinghasher/VerifyingHasher.h"
+#import "Source/santad/DataLayer/SNTRuleTable.h"
+#include "Source/santad/EntitlementsFilter.h"
+#include "Source/santad/EventProviders/AuthResultCache.h"
+#import "Source/santad/SNTPolicyProcessor.h"
+#include "Testing/Benchmarks/BenchUtils.h"
+#include "benchmark/benchmark.h"
+#include "google/protobuf/arena.h"
+
+using santa::RunWithPercentiles;
+
+namespace {
+
+const char* BenchBinary() {
+  const char* path = std::getenv("EXEC_PATH_BENCH_BINARY");
+  return path && *path ? path : "/usr/bin/yes";
+}
+
+es_string_token_t StringToken(const char* s) {
+  return es_string_token_t{.length = strlen(s), .data = s};
+}
+
+// Synthetic es_file_t for a vnode. Only the stat fields consulted by the
+// caches are meaningful.
+es_file_t MakeFile(const char* path, dev_t dev, ino_t ino) {
+  es_file_t file = {.path = StringToken(path)};
+  file.stat.st_dev = dev;
+  file.stat.st_ino = ino;
+  file.stat.st_mode = S_IFREG | 0755;
+  return file;
+}
+
+// Synthetic AUTH_EXEC message whose target is the real file at `path`, so the
+// policy processor's code signature checks see the actual binary.
+struct ExecFixture {
+  es_file_t file;
+  es_process_t target;
+  es_message_t msg;
+
+  explicit ExecFixture(const char* path) {
+    file = {.path = StringToken(path)};
+    stat(path, &file.stat);
+    target = {};
+    target.executable = &file;
+    target.codesigning_flags = CS_SIGNED | CS_VALID;
+    target.signing_id = StringToken("com.apple.yes");
+    target.team_id = StringToken("");
+    msg = {};
+    msg.version = 7;
+    msg.process = &target;
+    msg.action_type = ES_ACTION_TYPE_AUTH;
+    msg.event_type = ES_EVENT_TYPE_AUTH_EXEC;
+    msg.event.exec.target = &target;
+  }
+  ExecFixture(const ExecFixture&) = delete;
+  ExecFixture& operator=(const ExecFixture&) = delete;
+};
+
+NSString* RandomSHA256(std::mt19937_64& gen) {
+  return [NSString stringWithFormat:@"%016llx%016llx%016llx%016llx", gen(), gen(), gen(), gen()];
+}
+
+#pragma mark - SantaCache
+
+void BM_SantaCacheGetHit(benchmark::State& state) {
+  SantaCache<uint64_t, uint64_t> cache(10000, 2, SantaCacheEvictionPolicy::kClock);
+  for (uint64_t i = 1; i <= 5000; ++i) {
+    cache.set(i, i);
+  }
+  uint64_t key = 0;
+  RunWithPercentiles(state, [&] {
+    key = key % 5000 + 1;
+    benchmark::DoNotOptimize(cache.get(key));
+  });
+}
+BENCHMARK(BM_SantaCacheGetHit);
+
+void BM_SantaCacheGetMiss(benchmark::State& state) {
+  SantaCache<uint64_t, uint64_t> cache(10000, 2, SantaCacheEvictionPolicy::kClock);
+  for (uint64_t i = 1; i <= 5000; ++i) {
+    cache.set(i, i);
+  }
+  uint64_t key = 5000;
+  RunWithPercentiles(state, [&] { benchmark::DoNotOptimize(cache.get(++key)); });
+}
+BENCHMARK(BM_SantaCacheGetMiss);
+
+void BM_SantaCacheSet(benchmark::State& state) {
+  // Keys cycle through twice the capacity so eviction is exercised.
+  SantaCache<uint64_t, uint64_t> cache(10000, 2, SantaCacheEvictionPolicy::kClock);
+  uint64_t key = 0;
+  RunWithPercentiles(state, [&] {
+    key = key % 20000 + 1;
+    benchmark::DoNotOptimize(cache.set(key, key));
+  });
+}
+BENCHMARK(BM_SantaCacheSet);
+
+#pragma mark - AuthResultCache
+
+void BM_AuthResultCacheCheck(benchmark::State& state) {
+  const bool hit = state.range(0);
+  auto cache = santa::AuthResultCache::Create(std::make_shared<santa::EndpointSecurityAPI>(), nil);
+
+  struct stat root_sb;
+  stat("/", &root_sb);
+  std::vector<es_file_t> files;
+  files.reserve(5000);
+  for (ino_t i = 1; i <= 5000; ++i) {
+    files.push_back(MakeFile("/usr/bin/bench", root_sb.st_dev, i));
+  }
+  for (const es_file_t& file : files) {
+    cache->AddToCache(&file, SNTActionRequestBinary);
+    cache->AddToCache(&file, SNTActionRespondAllow);
+  }
+  es_file_t miss = MakeFile("/usr/bin/bench", root_sb.st_dev, 0);
+
+  size_t i = 0;
+  RunWithPercentiles(state, [&] {
+    const es_file_t* file = hit ? &files[i++ % files.size()] : (++miss.stat.st_ino, &miss);
+    benchmark::DoNotOptimize(cache->CheckCache(file));
+  });
+}
+BENCHMARK(BM_AuthResultCacheCheck)->ArgName("hit")->Arg(1)->Arg(0);
+
+void BM_AuthResultCacheAdd(benchmark::State& state) {
+  // The two-step add (pending request, then response) done for every exec
+  // that misses the cache.
+  auto cache = santa::AuthResultCache::Create(std::make_shared<santa::EndpointSecurityAPI>(), nil);
+  struct stat root_sb;
+  stat("/", &root_sb);
+  es_file_t file = MakeFile("/usr/bin/bench", root_sb.st_dev, 0);
+  RunWithPercentiles(state, [&] {
+    ++file.stat.st_ino;
+    cache->AddToCache(&file, SNTActionRequestBinary);
+    cache->AddToCache(&file, SNTActionRespondAllow);
+  });
+}
+BENCHMARK(BM_AuthResultCacheAdd);
+
+#pragma mark - SNTPolicyProcessor
+
+// Decision for the bench binary against an in-memory rule table holding
+// state.range(0) unrelated binary rules plus a team ID rule. A fresh
+// SNTFileInfo is created on every iteration so the SHA-256 and code signature
+// checks are included, as they are for a real exec.
+void BM_PolicyProcessorDecision(benchmark::State& state) {
+  @autoreleasepool {
+    SNTRuleTable* ruleTable =
+        [[SNTRuleTable alloc] initWithDatabaseQueue:[[FMDatabaseQueue alloc] init]];
+    NSMutableArray<SNTRule*>* rules = [NSMutableArray arrayWithCapacity:state.range(0) + 1];
+    std::mt19937_64 gen(1);
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      [rules addObject:[[SNTRule alloc] initWithIdentifier:RandomSHA256(gen)
+                                                     state:SNTRuleStateAllow
+                                                      type:SNTRuleTypeBinary]];
+    }
+    [rules addObject:[[SNTRule alloc] initWithIdentifier:@"EQHXZ8M8AV"
+                                                   state:SNTRuleStateBlock
+                                                    type:SNTRuleTypeTeamID]];
+    [ruleTable addExecutionRules:rules ruleCleanup:SNTRuleCleanupNone errors:nil];
+
+    SNTPolicyProcessor* processor =
+        [[SNTPolicyProcessor alloc] initWithRuleTable:ruleTable
+                                   entitlementsFilter:santa::EntitlementsFilter::Create(@[], @[])];
+    SNTConfigState* configState =
+        [[SNTConfigState alloc] initWithConfig:[SNTConfigurator configurator]];
+
+    const char* path = BenchBinary();
+    ExecFixture fixture(path);
+    NSString* nsPath = @(path);
+    RunWithPercentiles(state, [&] {
+      @autoreleasepool {
+        SNTFileInfo* fileInfo = [[SNTFileInfo alloc] initWithPath:nsPath];
+        SNTCachedDecision* cd = [processor decisionForFileInfo:fileInfo
+                                                 targetProcess:fixture.msg.event.exec.target
+                                                   configState:configState
+                                            activationCallback:nil
+                                                cachedDecision:nil];
+        benchmark::DoNotOptimize(cd);
+      }
+    });
+  }
+}
+BENCHMARK(BM_PolicyProcessorDecision)->ArgName("rules")->Arg(0)->Arg(10000)->Arg(100000);
+
+#pragma mark - VerifyingHasher
+
+// VerifyingHasher::Run over the bench binary's host slice. The page cache is
+// warm after the first iteration, so this measures hashing rather than disk.
+void BM_VerifyingHasherRun(benchmark::State& state) {
+  const char* path = BenchBinary();
+  santa::ScopedFile sf(open(path, O_RDONLY | O_CLOEXEC));
+  struct stat sb;
+  if (sf.UnsafeFD() < 0 || fstat(sf.UnsafeFD(), &sb) != 0) {
+    state.SkipWithError("Unable to open bench binary");
+    return;
+  }
+
+  santa::VerifyingHasher::Expected expected{
+      .stat = {.dev = sb.st_dev, .ino = sb.st_ino, .size = sb.st_size, .mtime = sb.st_mtimespec},
+      // Nothing to match against: the full signed path still runs and
+      // returns kNoMatch.
+      .signed_check = santa::VerifyingHasher::Expected::Signed{},
+  };
+  santa::VerifyingHasher::RunOptions opts{
+      .parallel_page_hash = state.range(0) != 0,
+      .read_ahead_depth = static_cast<size_t>(state.range(1)),
+  };
+#if defined(__arm64__)
+  const cpu_type_t cputype = CPU_TYPE_ARM64;
+  const cpu_subtype_t cpusubtype = CPU_SUBTYPE_ARM64E;
+#else
+  const cpu_type_t cputype = CPU_TYPE_X86_64;
+  const cpu_subtype_t cpusubtype = CPU_SUBTYPE_X86_64_ALL;
+#endif
+
+  RunWithPercentiles(state, [&] {
+    auto result = santa::VerifyingHasher::Run(sf.UnsafeFD(), cputype, cpusubtype, expected, opts);
+    benchmark::DoNotOptimize(result);
+  });
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * sb.st_size);
+}
+BENCHMARK(BM_VerifyingHasherRun)
+    ->ArgNames({"parallel", "read_ahead"})
+    ->Args({0, 0})
+    ->Args({1, 0})
+    ->Args({0, 4})
+    ->Args({1, 4});
+
+#pragma mark - CEL
+
+std::unique_ptr<santa::cel::Activation<true>> MakeActivation() {
+  using ExecutableFileT = santa::cel::CELProtoTraits<true>::ExecutableFileT;
+  using AncestorT = santa::cel::CELProtoTraits<true>::AncestorT;
+  using FileDescriptorT = santa::cel::CELProtoTraits<true>::FileDescriptorT;
+
+  auto f = std::make_unique<ExecutableFileT>();
+  f->mutable_signing_time()->set_seconds(1748436989);
+  f->set_team_id("EQHXZ8M8AV");
+  return std::make_unique<santa::cel::Activation<true>>(
+      std::move(f),
+      ^std::vector<std::string>() {
+        return {"/usr/bin/yes", "--version"};
+      },
+      ^std::map<std::string, std::string>() {
+        return {{"PATH", "/usr/bin:/bin"}};
+      },
+      ^uid_t() {
+        return 501;
+      },
+      ^std::string() {
+        return "/";
+      },
+      ^std::string() {
+        return "/usr/bin/yes";
+      },
+      ^std::vector<AncestorT>() {
+        return {};
+      },
+      ^std::vector<FileDescriptorT>() {
+        return {};
+      });
+}
+
+constexpr char kCELExpression[] =
+    "target.signing_time >= timestamp('2025-05-28T12:00:00Z') && "
+    "!('--inspect' in args) ? ALLOWLIST : BLOCKLIST";
+
+// Evaluation of a precompiled plan, as done for CEL rules whose plan is cached.
+void BM_CELEvaluate(benchmark::State& state) {
+  auto evaluator = santa::cel::Evaluator<true>::Create();
+  if (!evaluator.ok()) {
+    state.SkipWithError("Unable to create evaluator");
+    return;
+  }
+  google::protobuf::Arena plan_arena;
+  auto plan = (*evaluator)->Compile(kCELExpression, &plan_arena);
+  if (!plan.ok()) {
+    state.SkipWithError("Unable to compile expression");
+    return;
+  }
+  auto activation = MakeActivation();
+  RunWithPercentiles(state, [&] {
+    google::protobuf::Arena arena;
+    benchmark::DoNotOptimize((*evaluator)->Evaluate(plan->get(), *activation, &arena));
+  });
+}
+BENCHMARK(BM_CELEvaluate);
+
+// Compile plus evaluate, the cost paid when the plan is not cached.
+void BM_CELCompileAndEvaluate(benchmark::State& state) {
+  auto evaluator = santa::cel::Evaluator<true>::Create();
+  if (!evaluator.ok()) {
+    state.SkipWithError("Unable to create evaluator");
+    return;
+  }
+  auto activation = MakeActivation();
+  RunWithPercentiles(state, [&] {
+    benchmark::DoNotOptimize((*evaluator)->CompileAndEvaluate(kCELExpression, *activation));
+  });
+}
+BENCHMARK(BM_CELCompileAndEvaluate);
+
+}  // namespace
+
+BENCHMARK_MAIN();
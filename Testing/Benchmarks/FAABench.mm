@@ -0,0 +1,272 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+/*
+
+Microbenchmarks for the file access authorization policy lookups.
+
+Run all benchmarks:
+  bazel run -c opt //Testing/Benchmarks:faa
+
+Run a subset, with repetitions for more stable numbers:
+  bazel run -c opt //Testing/Benchmarks:faa -- \
+      --benchmark_filter='ProcessWatchItems' --benchmark_repetitions=5
+
+Each benchmark runs against the given number of synthetic policies. Besides
+Google Benchmark's time per iteration and items_per_second (lookups per
+second), every benchmark reports p50_ns and p99_ns counters computed from
+per-iteration samples, and bytes_per_policy, the heap memory held by the
+lookup structure for each policy. Policy objects themselves aren't included.
+
+*/
+
+#import <Foundation/Foundation.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Source/common/faa/WatchItemPolicy.h"
+#include "Source/common/faa/WatchItems.h"
+#include "Testing/Benchmarks/BenchUtils.h"
+#include "benchmark/benchmark.h"
+
+using santa::DataWatchItemPolicy;
+using santa::DataWatchItems;
+using santa::MallocBytesInUse;
+using santa::ProcessPolicyLookupKeys;
+using santa::ProcessWatchItemPolicy;
+using santa::ProcessWatchItems;
+using santa::RunWithPercentiles;
+using santa::SetPairPathAndType;
+using santa::SetSharedProcessWatchItemPolicy;
+using santa::WatchItemPathType;
+using santa::WatchItemProcess;
+using santa::WatchItemRuleType;
+
+namespace {
+
+// Number of distinct paths or processes looked up, cycled through.
+constexpr size_t kLookupKeys = 1024;
+
+constexpr char kTeamID[] = "EQHXZ8M8AV";
+
+// Building the larger policy sets takes a while, and Google Benchmark runs each
+// benchmark several times while choosing an iteration count, so they are only
+// built once per size.
+template <typename T, typename MakeFn>
+const T& CachedFixture(size_t policies, MakeFn make) {
+  static std::map<size_t, std::unique_ptr<T>> fixtures;
+  std::unique_ptr<T>& fixture = fixtures[policies];
+  if (!fixture) {
+    fixture = make(policies);
+  }
+  return *fixture;
+}
+
+#pragma mark - DataWatchItems
+
+// Half the policies protect a directory and half a single file, spread over a
+// few parent directories the way an app's data usually is.
+struct DataFixture {
+  DataWatchItems items;
+  size_t bytes_per_policy;
+  std::vector<std::string> hits;
+  std::vector<std::string> misses;
+};
+
+std::unique_ptr<DataFixture> MakeDataFixture(size_t policies) {
+  DataWatchItems::Expansion expansion;
+  for (size_t i = 0; i < policies; i++) {
+    bool is_prefix = i % 2 == 0;
+    std::string path =
+        is_prefix ? "/Users/bench/Library/Application Support/App" + std::to_string(i) + "/"
+                  : "/Users/bench/Documents/Project" + std::to_string(i % 64) + "/secret" +
+                        std::to_string(i) + ".txt";
+    WatchItemPathType type = is_prefix ? WatchItemPathType::kPrefix : WatchItemPathType::kLiteral;
+    auto policy = std::make_shared<DataWatchItemPolicy>("policy" + std::to_string(i), "v1", path,
+                                                        type);
+    expansion.matches.emplace_back(path, policy);
+    expansion.paths.insert({path, type});
+  }
+
+  auto fixture = std::make_unique<DataFixture>();
+  const size_t bytes_before = MallocBytesInUse();
+  fixture->items.Build(std::move(expansion));
+  fixture->bytes_per_policy = (MallocBytesInUse() - bytes_before) / policies;
+
+  for (size_t i = 0; i < kLookupKeys; i++) {
+    size_t policy = (i * 7919) % policies;
+    fixture->hits.push_back(policy % 2 == 0 ? "/Users/bench/Library/Application Support/App" +
+                                                  std::to_string(policy) + "/Cache/data.db"
+                                            : "/Users/bench/Documents/Project" +
+                                                  std::to_string(policy % 64) + "/secret" +
+                                                  std::to_string(policy) + ".txt");
+    fixture->misses.push_back("/Users/bench/Library/Caches/com.bench.app" + std::to_string(i) +
+                              "/Cache.db");
+  }
+  return fixture;
+}
+
+// The lookup for the single target of most events.
+void BM_DataWatchItemsLookup(benchmark::State& state) {
+  const DataFixture& fixture = CachedFixture<DataFixture>(state.range(0), MakeDataFixture);
+  const bool hit = state.range(1);
+  std::shared_ptr<const DataWatchItems::PolicyTree> tree = fixture.items.Tree();
+  const std::vector<std::string>& paths = hit ? fixture.hits : fixture.misses;
+
+  size_t i = 0;
+  RunWithPercentiles(state, [&] {
+    benchmark::DoNotOptimize(tree->LookupLongestMatchingPrefix(paths[i++ % paths.size()]));
+  });
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+  state.counters["bytes_per_policy"] = benchmark::Counter(fixture.bytes_per_policy);
+  state.counters["nodes"] = benchmark::Counter(tree->NodeCount());
+}
+BENCHMARK(BM_DataWatchItemsLookup)
+    ->ArgNames({"policies", "hit"})
+    ->ArgsProduct({{1000, 10000, 100000}, {1, 0}});
+
+// The batched lookup for events with two targets, e.g. a rename of a
+// protected file to an unprotected path.
+void BM_DataWatchItemsLookupPair(benchmark::State& state) {
+  const DataFixture& fixture = CachedFixture<DataFixture>(state.range(0), MakeDataFixture);
+  std::shared_ptr<const DataWatchItems::PolicyTree> tree = fixture.items.Tree();
+
+  size_t i = 0;
+  std::vector<std::string_view> paths(2);
+  RunWithPercentiles(state, [&] {
+    paths[0] = fixture.hits[i % kLookupKeys];
+    paths[1] = fixture.misses[i % kLookupKeys];
+    i++;
+    benchmark::DoNotOptimize(tree->LookupLongestMatchingPrefixes(paths));
+  });
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 2);
+  state.counters["bytes_per_policy"] = benchmark::Counter(fixture.bytes_per_policy);
+}
+BENCHMARK(BM_DataWatchItemsLookupPair)->ArgName("policies")->Arg(1000)->Arg(10000)->Arg(100000);
+
+#pragma mark - ProcessWatchItems
+
+// Each policy protects one path for one process, identified by a signing ID,
+// team ID or binary path in turn.
+struct ProcessFixture {
+  ProcessWatchItems items;
+  size_t bytes_per_policy;
+  std::vector<std::string> signing_ids;
+};
+
+std::unique_ptr<ProcessFixture> MakeProcessFixture(size_t policies) {
+  SetSharedProcessWatchItemPolicy set;
+  for (size_t i = 0; i < policies; i++) {
+    NSString* signingID = nil;
+    NSString* teamID = nil;
+    NSString* binaryPath = nil;
+    switch (i % 3) {
+      case 0: signingID = [NSString stringWithFormat:@"%s:com.bench.app%zu", kTeamID, i]; break;
+      case 1: teamID = [NSString stringWithFormat:@"T%09zu", i]; break;
+      default:
+        binaryPath =
+            [NSString stringWithFormat:@"/Applications/Bench%zu.app/Contents/MacOS/Bench", i];
+        break;
+    }
+    std::optional<WatchItemProcess> proc =
+        WatchItemProcess::Create(binaryPath, signingID, teamID, nil, nil, false, nil);
+    SetPairPathAndType paths = {
+        {"/Users/bench/Library/Containers/com.bench.app" + std::to_string(i) + "/",
+         WatchItemPathType::kPrefix}};
+    set.insert(std::make_shared<ProcessWatchItemPolicy>(
+        "policy" + std::to_string(i), "v1", std::move(paths),
+        santa::kWatchItemPolicyDefaultAllowReadAccess, santa::kWatchItemPolicyDefaultAuditOnly,
+        WatchItemRuleType::kProcessesWithAllowedPaths,
+        santa::kWatchItemPolicyDefaultEnableSilentMode,
+        santa::kWatchItemPolicyDefaultEnableSilentTTYMode, "", nil, nil,
+        santa::SetWatchItemProcess{*proc}));
+  }
+
+  auto fixture = std::make_unique<ProcessFixture>();
+  const size_t bytes_before = MallocBytesInUse();
+  fixture->items.Build(std::move(set));
+  fixture->bytes_per_policy = (MallocBytesInUse() - bytes_before) / policies;
+
+  for (size_t i = 0; i < kLookupKeys; i++) {
+    fixture->signing_ids.push_back("com.bench.app" + std::to_string((i * 3 * 7919) % policies));
+  }
+  return fixture;
+}
+
+// The candidate policies for a signed process matching one signing ID policy,
+// as found for every file access by a process.
+void BM_ProcessWatchItemsCandidates(benchmark::State& state) {
+  // The fixture is only read. The lookup isn't marked const as it shares an
+  // interface with WatchItems, which takes a lock.
+  auto& fixture = const_cast<ProcessFixture&>(
+      CachedFixture<ProcessFixture>(state.range(0), MakeProcessFixture));
+  __block size_t candidates = 0;
+  santa::CheckPolicyBlock check = ^bool(std::shared_ptr<ProcessWatchItemPolicy>) {
+    candidates++;
+    return false;
+  };
+
+  size_t i = 0;
+  RunWithPercentiles(state, [&] {
+    ProcessPolicyLookupKeys keys = {
+        .binary_path = "/Applications/Bench.app/Contents/MacOS/Bench",
+        .signing_id = fixture.signing_ids[i++ % kLookupKeys],
+        .team_id = kTeamID,
+        .cdhash = "",
+        .is_signed = true,
+        .is_platform_binary = false,
+    };
+    fixture.items.IterateCandidateProcessPolicies(keys, check);
+  });
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+  state.counters["bytes_per_policy"] = benchmark::Counter(fixture.bytes_per_policy);
+  state.counters["candidates"] = benchmark::Counter(
+      static_cast<double>(candidates) / static_cast<double>(state.iterations()));
+}
+BENCHMARK(BM_ProcessWatchItemsCandidates)
+    ->ArgName("policies")
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000);
+
+// Visiting every policy, as done before candidates were indexed, for
+// comparison.
+void BM_ProcessWatchItemsIterateAll(benchmark::State& state) {
+  auto& fixture = const_cast<ProcessFixture&>(
+      CachedFixture<ProcessFixture>(state.range(0), MakeProcessFixture));
+  santa::CheckPolicyBlock check = ^bool(std::shared_ptr<ProcessWatchItemPolicy> policy) {
+    benchmark::DoNotOptimize(policy.get());
+    return false;
+  };
+
+  RunWithPercentiles(state, [&] { fixture.items.IterateProcessPolicies(check); });
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ProcessWatchItemsIterateAll)
+    ->ArgName("policies")
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,313 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+/*
+
+Benchmarks for the event logging pipeline, from serializing an event to
+handing it to each writer.
+
+Run all serializer and writer combinations:
+  bazel run -c opt //Testing/Benchmarks:logging_pipeline
+
+Run a subset:
+  bazel run -c opt //Testing/Benchmarks:logging_pipeline -- --benchmark_filter='Spool'
+
+Events are rebuilt from the exec, fork, exit, close, rename and unlink
+fixtures under Source/santad/testdata/protobuf/v<version> and cycled through.
+The version defaults to 8 and can be overridden with the LOGGING_BENCH_VERSION
+environment variable. Fixtures are found relative to BUILD_WORKSPACE_DIRECTORY,
+which bazel run sets, or in the directory named by LOGGING_BENCH_TESTDATA.
+
+Besides the time per event, every benchmark reports:
+  serialized_bytes: the average size of a serialized event
+  written_bytes:    the average growth of the writer's output per event, for
+                    writers that write to disk. Compression makes this smaller
+                    than serialized_bytes.
+  allocs:           the average number of operator new calls per event, on any
+                    thread. Objective-C objects and direct malloc calls aren't
+                    counted.
+
+Writers that queue writes are flushed every kFlushInterval events, so their
+numbers include the cost of draining the queue rather than only enqueueing.
+The syslog writer logs every event to the unified log.
+
+*/
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#import <Foundation/Foundation.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Source/common/es/Enricher.h"
+#include "Source/common/es/Message.h"
+#include "Source/common/santa.pb.h"
+#import "Source/santad/SNTDecisionCache.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/BasicString.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/Null.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/Spool.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/Syslog.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
+#include "Testing/Benchmarks/ReplayEvent.h"
+#include "benchmark/benchmark.h"
+#include "google/protobuf/io/gzip_stream.h"
+#include "google/protobuf/json/json.h"
+
+namespace pbv1 = ::santa::pb::v1;
+
+using santa::Enricher;
+using santa::MakeReplayEvent;
+using santa::Message;
+using santa::ReplayEndpointSecurityAPI;
+using santa::ReplayEvent;
+
+namespace {
+
+std::atomic<uint64_t> g_allocs = 0;
+
+}  // namespace
+
+// Count every allocation made through operator new. The nothrow and array
+// forms forward to this one.
+void* operator new(size_t size) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+namespace {
+
+// Matches the File writer's configuration in Logger.
+constexpr uint64_t kFileFlushTimeoutMS = 10000;
+constexpr size_t kFileBatchSizeBytes = 128 * 1024;
+
+// Matches the default spool configuration, except for the directory size,
+// which is raised so that long runs don't start dropping events.
+constexpr size_t kSpoolDirSizeBytes = 4ULL * 1024 * 1024 * 1024;
+constexpr size_t kSpoolFileSizeBytes = 250 * 1024;
+constexpr uint64_t kSpoolFlushTimeoutMS = 15000;
+
+constexpr int64_t kFlushInterval = 256;
+
+enum class SerializerType {
+  kBasicString,
+  kBasicStringNoPrefix,
+  kProtobuf,
+  kJSON,
+};
+
+enum class WriterType {
+  kNull,
+  kFile,
+  kSyslog,
+  kSpool,
+  kSpoolGzip,
+  kSpoolZstd,
+};
+
+uint32_t FixtureVersion() {
+  const char* version = std::getenv("LOGGING_BENCH_VERSION");
+  return version && *version ? static_cast<uint32_t>(atoi(version)) : 8;
+}
+
+NSString* FixtureDir() {
+  NSString* versionDir = [NSString stringWithFormat:@"v%u", FixtureVersion()];
+  if (const char* dir = std::getenv("LOGGING_BENCH_TESTDATA"); dir && *dir) {
+    return [@(dir) stringByAppendingPathComponent:versionDir];
+  }
+  const char* workspace = std::getenv("BUILD_WORKSPACE_DIRECTORY");
+  return [NSString pathWithComponents:@[
+    workspace ? @(workspace) : @".", @"Source", @"santad", @"testdata", @"protobuf", versionDir
+  ]];
+}
+
+// Parses the named fixture into the event field of a SantaMessage.
+bool LoadFixture(NSString* dir, NSString* name, google::protobuf::Message* event) {
+  NSString* path = [dir stringByAppendingPathComponent:[name stringByAppendingString:@".json"]];
+  NSString* json = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil];
+  if (!json) {
+    return false;
+  }
+
+  google::protobuf::json::ParseOptions options;
+  options.ignore_unknown_fields = true;
+  return google::protobuf::json::JsonStringToMessage(json.UTF8String, event, options).ok();
+}
+
+std::vector<std::unique_ptr<ReplayEvent>> LoadEvents() {
+  NSString* dir = FixtureDir();
+  pbv1::SantaMessage exec, fork, exit, close, rename, unlink;
+  if (!LoadFixture(dir, @"exec", exec.mutable_execution()) ||
+      !LoadFixture(dir, @"fork", fork.mutable_fork()) ||
+      !LoadFixture(dir, @"exit", exit.mutable_exit()) ||
+      !LoadFixture(dir, @"close", close.mutable_close()) ||
+      !LoadFixture(dir, @"rename", rename.mutable_rename()) ||
+      !LoadFixture(dir, @"unlink", unlink.mutable_unlink())) {
+    return {};
+  }
+
+  std::vector<std::unique_ptr<ReplayEvent>> events;
+  for (const pbv1::SantaMessage* santa_msg : {&exec, &fork, &exit, &close, &rename, &unlink}) {
+    std::unique_ptr<ReplayEvent> ev = MakeReplayEvent(*santa_msg);
+    ev->msg.version = FixtureVersion();
+    events.push_back(std::move(ev));
+  }
+  return events;
+}
+
+std::shared_ptr<santa::Serializer> MakeSerializer(
+    SerializerType type, std::shared_ptr<ReplayEndpointSecurityAPI> esapi) {
+  SNTDecisionCache* decision_cache = [SNTDecisionCache sharedCache];
+  switch (type) {
+    case SerializerType::kBasicString: return santa::BasicString::Create(esapi, decision_cache);
+    case SerializerType::kBasicStringNoPrefix:
+      return santa::BasicString::Create(esapi, decision_cache, false);
+    case SerializerType::kProtobuf: return santa::Protobuf::Create(esapi, decision_cache);
+    case SerializerType::kJSON: return santa::Protobuf::Create(esapi, decision_cache, true);
+  }
+}
+
+std::shared_ptr<santa::Writer> MakeWriter(WriterType type, NSString* path) {
+  switch (type) {
+    case WriterType::kNull: return santa::Null::Create();
+    case WriterType::kFile:
+      return santa::File::Create(path, kFileFlushTimeoutMS, kFileBatchSizeBytes);
+    case WriterType::kSyslog: return santa::Syslog::Create();
+    case WriterType::kSpool:
+      return santa::Spool<::fsspool::UncompressedStreamBatcher>::Create(
+          ::fsspool::UncompressedStreamBatcher(), path.UTF8String, kSpoolDirSizeBytes,
+          kSpoolFileSizeBytes, kSpoolFlushTimeoutMS);
+    case WriterType::kSpoolGzip:
+      return santa::Spool<::fsspool::GzipStreamBatcher>::Create(
+          ::fsspool::GzipStreamBatcher(^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
+            return std::make_shared<google::protobuf::io::GzipOutputStream>(raw_stream);
+          }),
+          path.UTF8String, kSpoolDirSizeBytes, kSpoolFileSizeBytes, kSpoolFlushTimeoutMS);
+    case WriterType::kSpoolZstd:
+      return santa::Spool<::fsspool::ZstdStreamBatcher>::Create(
+          ::fsspool::ZstdStreamBatcher(^(google::protobuf::io::ZeroCopyOutputStream* raw_stream) {
+            return ::fsspool::ZstdOutputStream::Create(raw_stream);
+          }),
+          path.UTF8String, kSpoolDirSizeBytes, kSpoolFileSizeBytes, kSpoolFlushTimeoutMS);
+  }
+}
+
+// Total size of the file, or of every file under the directory, at path.
+uint64_t DiskUsage(NSString* path) {
+  NSFileManager* fm = [NSFileManager defaultManager];
+  BOOL isDir = NO;
+  if (![fm fileExistsAtPath:path isDirectory:&isDir]) {
+    return 0;
+  }
+  if (!isDir) {
+    return [[fm attributesOfItemAtPath:path error:nil] fileSize];
+  }
+
+  uint64_t total = 0;
+  for (NSString* file in [fm enumeratorAtPath:path]) {
+    NSDictionary* attrs = [fm attributesOfItemAtPath:[path stringByAppendingPathComponent:file]
+                                               error:nil];
+    if ([attrs.fileType isEqualToString:NSFileTypeRegular]) {
+      total += attrs.fileSize;
+    }
+  }
+  return total;
+}
+
+void BM_Pipeline(benchmark::State& state, SerializerType serializer_type,
+                 WriterType writer_type) {
+  @autoreleasepool {
+    std::vector<std::unique_ptr<ReplayEvent>> events = LoadEvents();
+    if (events.empty()) {
+      state.SkipWithError("Unable to load fixtures, see LOGGING_BENCH_TESTDATA");
+      return;
+    }
+
+    NSString* path = [NSTemporaryDirectory()
+        stringByAppendingPathComponent:[NSString stringWithFormat:@"logging_bench_%@",
+                                                                  [NSUUID UUID].UUIDString]];
+
+    auto esapi = std::make_shared<ReplayEndpointSecurityAPI>();
+    Enricher enricher;
+    std::shared_ptr<santa::Serializer> serializer = MakeSerializer(serializer_type, esapi);
+    std::shared_ptr<santa::Writer> writer = MakeWriter(writer_type, path);
+
+    uint64_t serialized_bytes = 0;
+    int64_t written = 0;
+    uint64_t allocs_start = g_allocs.load(std::memory_order_relaxed);
+    size_t next_event = 0;
+    for (auto _ : state) {
+      const ReplayEvent* ev = events[next_event].get();
+      next_event = (next_event + 1) % events.size();
+
+      esapi->SetEvent(ev);
+      std::vector<uint8_t> bytes =
+          serializer->SerializeMessage(enricher.Enrich(Message(esapi, &ev->msg)));
+      serialized_bytes += bytes.size();
+      writer->Write(std::move(bytes));
+
+      if (++written % kFlushInterval == 0) {
+        writer->Flush();
+      }
+    }
+    writer->Flush();
+    uint64_t allocs = g_allocs.load(std::memory_order_relaxed) - allocs_start;
+
+    state.counters["serialized_bytes"] = benchmark::Counter(
+        static_cast<double>(serialized_bytes), benchmark::Counter::kAvgIterations);
+    state.counters["written_bytes"] = benchmark::Counter(static_cast<double>(DiskUsage(path)),
+                                                         benchmark::Counter::kAvgIterations);
+    state.counters["allocs"] =
+        benchmark::Counter(static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+
+    writer.reset();
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+  }
+}
+
+// The serializers alone
+BENCHMARK_CAPTURE(BM_Pipeline, basic_string, SerializerType::kBasicString, WriterType::kNull);
+BENCHMARK_CAPTURE(BM_Pipeline, protobuf, SerializerType::kProtobuf, WriterType::kNull);
+BENCHMARK_CAPTURE(BM_Pipeline, json, SerializerType::kJSON, WriterType::kNull);
+
+// The serializer and writer combinations of each event log type
+BENCHMARK_CAPTURE(BM_Pipeline, basic_string_file, SerializerType::kBasicString, WriterType::kFile);
+BENCHMARK_CAPTURE(BM_Pipeline, basic_string_syslog, SerializerType::kBasicStringNoPrefix,
+                  WriterType::kSyslog);
+BENCHMARK_CAPTURE(BM_Pipeline, json_file, SerializerType::kJSON, WriterType::kFile);
+BENCHMARK_CAPTURE(BM_Pipeline, protobuf_spool, SerializerType::kProtobuf, WriterType::kSpool);
+BENCHMARK_CAPTURE(BM_Pipeline, protobuf_spool_gzip, SerializerType::kProtobuf,
+                  WriterType::kSpoolGzip);
+BENCHMARK_CAPTURE(BM_Pipeline, protobuf_spool_zstd, SerializerType::kProtobuf,
+                  WriterType::kSpoolZstd);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,198 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+/*
+
+Microbenchmarks for the process tree, with the originator annotator santad
+uses.
+
+Run all benchmarks:
+  bazel run -c opt //Testing/Benchmarks:process_tree
+
+Run a subset, with repetitions for more stable numbers:
+  bazel run -c opt //Testing/Benchmarks:process_tree -- \
+      --benchmark_filter='Storm' --benchmark_repetitions=5
+
+Each benchmark runs against a tree already holding the given number of
+processes, all descendants of login so they carry an originator annotation.
+Besides Google Benchmark's time per iteration and items_per_second (tree
+operations per second), every benchmark reports p50_ns and p99_ns counters
+computed from per-iteration samples, and bytes_per_process, the heap memory
+held by the tree for each of its processes.
+
+*/
+
+#import <Foundation/Foundation.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Source/common/processtree/annotations/annotator.h"
+#include "Source/common/processtree/annotations/originator.h"
+#include "Source/common/processtree/process.h"
+#include "Source/common/processtree/process_tree.h"
+#include "Source/common/processtree/process_tree_test_helpers.h"
+#include "Testing/Benchmarks/BenchUtils.h"
+#include "benchmark/benchmark.h"
+
+using santa::MallocBytesInUse;
+using santa::RunWithPercentiles;
+using santa::santad::process_tree::Annotator;
+using santa::santad::process_tree::Cred;
+using santa::santad::process_tree::OriginatorAnnotator;
+using santa::santad::process_tree::Pid;
+using santa::santad::process_tree::Process;
+using santa::santad::process_tree::ProcessTreeTestPeer;
+using santa::santad::process_tree::Program;
+
+namespace {
+
+constexpr Cred kUserCred = {.uid = 501, .gid = 20};
+
+// Pids handed to each benchmark thread's processes, well clear of the
+// population's. Pid versions are never reused, so neither are pids.
+constexpr pid_t kThreadPidBase = 1000000;
+
+Program ShellProgram() {
+  return Program{.executable = "/bin/zsh", .arguments = {"/bin/zsh", "-c", "make -j8 all"}};
+}
+
+struct TreeFixture {
+  std::unique_ptr<ProcessTreeTestPeer> tree;
+  std::shared_ptr<const Process> login;
+  std::vector<std::shared_ptr<const Process>> population;
+  std::atomic<uint64_t> timestamp = 1;
+  std::atomic<uint64_t> pidversion = 1;
+  size_t bytes_per_process = 0;
+
+  uint64_t NextTimestamp() { return timestamp.fetch_add(1, std::memory_order_relaxed); }
+  uint64_t NextPidversion() { return pidversion.fetch_add(1, std::memory_order_relaxed); }
+
+  // Fork and exec a process, returning the exec'd process.
+  std::shared_ptr<const Process> Spawn(const std::shared_ptr<const Process>& parent, pid_t pid,
+                                       const Program& program) {
+    Pid forked_pid = {.pid = pid, .pidversion = NextPidversion()};
+    tree->HandleFork(NextTimestamp(), parent, forked_pid);
+    std::shared_ptr<const Process> forked = *tree->Get(forked_pid);
+
+    Pid execd_pid = {.pid = pid, .pidversion = NextPidversion()};
+    tree->HandleExec(NextTimestamp(), *forked, execd_pid, program, kUserCred);
+    return *tree->Get(execd_pid);
+  }
+};
+
+// A tree holding init, login and `population` shells spawned by login.
+std::unique_ptr<TreeFixture> MakeTree(size_t population) {
+  auto fixture = std::make_unique<TreeFixture>();
+  const size_t bytes_before = MallocBytesInUse();
+
+  std::vector<std::unique_ptr<Annotator>> annotators;
+  annotators.push_back(std::make_unique<OriginatorAnnotator>());
+  fixture->tree = std::make_unique<ProcessTreeTestPeer>(std::move(annotators));
+  std::shared_ptr<const Process> init = fixture->tree->InsertInit();
+  fixture->login =
+      fixture->Spawn(init, 2, Program{.executable = "/usr/bin/login", .arguments = {"login"}});
+
+  fixture->population.reserve(population);
+  const Program shell = ShellProgram();
+  for (size_t i = 0; i < population; i++) {
+    fixture->population.push_back(fixture->Spawn(fixture->login, 100 + (pid_t)i, shell));
+  }
+
+  // The handles kept here are a small part of the total.
+  fixture->bytes_per_process = (MallocBytesInUse() - bytes_before) / (population + 2);
+  return fixture;
+}
+
+void ReportBytesPerProcess(benchmark::State& state, const TreeFixture& fixture) {
+  if (state.thread_index() == 0) {
+    state.counters["bytes_per_process"] = benchmark::Counter(fixture.bytes_per_process);
+  }
+}
+
+#pragma mark - Storms
+
+// A fork, exec and exit per iteration, as for every short-lived command a
+// build or script runs. Threads spawn from the same login process, as
+// concurrent builds in one terminal would.
+void BM_ProcessTreeForkExecExitStorm(benchmark::State& state) {
+  static std::unique_ptr<TreeFixture> fixture;
+  if (state.thread_index() == 0) {
+    fixture = MakeTree(state.range(0));
+  }
+
+  const Program program = {.executable = "/usr/bin/clang", .arguments = {"clang", "-c", "a.c"}};
+  const pid_t pid_base = kThreadPidBase * (state.thread_index() + 1);
+  pid_t next_pid = 0;
+  RunWithPercentiles(state, [&] {
+    std::shared_ptr<const Process> child =
+        fixture->Spawn(fixture->login, pid_base + next_pid++ % 1000, program);
+    fixture->tree->HandleExit(fixture->NextTimestamp(), *child);
+  });
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 3);
+
+  ReportBytesPerProcess(state, *fixture);
+  if (state.thread_index() == 0) {
+    fixture.reset();
+  }
+}
+BENCHMARK(BM_ProcessTreeForkExecExitStorm)
+    ->ArgName("processes")
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+#pragma mark - Lookups
+
+// The lookups done for every exec by a tree-aware client: the actor, its
+// annotations and its ancestry.
+void BM_ProcessTreeLookup(benchmark::State& state) {
+  static std::unique_ptr<TreeFixture> fixture;
+  if (state.thread_index() == 0) {
+    fixture = MakeTree(state.range(0));
+  }
+
+  size_t i = state.thread_index();
+  RunWithPercentiles(state, [&] {
+    const std::shared_ptr<const Process>& proc =
+        fixture->population[i++ % fixture->population.size()];
+    benchmark::DoNotOptimize(fixture->tree->Get(proc->pid_));
+    benchmark::DoNotOptimize(fixture->tree->GetAnnotation<OriginatorAnnotator>(*proc));
+    benchmark::DoNotOptimize(fixture->tree->RootSlice(proc));
+  });
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 3);
+
+  ReportBytesPerProcess(state, *fixture);
+  if (state.thread_index() == 0) {
+    fixture.reset();
+  }
+}
+BENCHMARK(BM_ProcessTreeLookup)
+    ->ArgName("processes")
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,296 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+/*
+
+Replays a capture of Endpoint Security events through santad's event
+processing stages, and reports the throughput and latency of each stage.
+
+Captures are the spool files written by the protobufstream event log type,
+which hold every logged event along with the file metadata the serializers
+use. The es_message_t of each exec, fork, exit, close, rename and unlink
+event is rebuilt from the capture and passed through:
+  - the process tree, using the adapter the tree-aware clients use
+  - the Enricher
+  - the Protobuf and BasicString serializers the Recorder logs with
+
+Replay a capture as fast as possible:
+  bazel run -c opt //Testing/Benchmarks:es_replay -- /path/to/spool/file
+
+At ten times its original pace, three times over:
+  bazel run -c opt //Testing/Benchmarks:es_replay -- -s 10 -i 3 /path/to/spool/file
+
+The process tree is backfilled from the replaying machine, as santad does, so
+only processes forked or exec'd by processes it knows about are tracked.
+Pids in a capture rarely exist on another machine, so process tree numbers are
+most meaningful when replaying on the machine the capture was taken on.
+
+*/
+
+#include <EndpointSecurity/EndpointSecurity.h>
+#import <Foundation/Foundation.h>
+#include <fcntl.h>
+#include <mach/mach_time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Source/common/LatencyHistogram.h"
+#include "Source/common/santa.pb.h"
+#include "Source/common/es/Enricher.h"
+#include "Source/common/es/Message.h"
+#include "Source/common/processtree/SNTEndpointSecurityAdapter.h"
+#include "Source/common/processtree/process_tree.h"
+#import "Source/santad/SNTDecisionCache.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/BasicString.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
+#include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "Testing/Benchmarks/ReplayEvent.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+namespace pbv1 = ::santa::pb::v1;
+
+using santa::Enricher;
+using santa::LatencyHistogram;
+using santa::MakeReplayEvent;
+using santa::Message;
+using santa::ReplayEndpointSecurityAPI;
+using santa::ReplayEvent;
+using santa::Serializer;
+
+namespace {
+
+uint64_t NowNs() {
+  return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+// Reads the records of an uncompressed stream spool file.
+class CaptureReader {
+ public:
+  static std::unique_ptr<CaptureReader> Open(const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return nullptr;
+    }
+    return std::unique_ptr<CaptureReader>(new CaptureReader(fd));
+  }
+
+  ~CaptureReader() { close(fd_); }
+
+  // Returns false at the end of the file or at the first malformed record.
+  // The records' hashes aren't checked.
+  bool Next(pbv1::SantaMessage* msg) {
+    google::protobuf::io::CodedInputStream coded_input(&input_);
+
+    uint32_t magic;
+    uint64_t hash;
+    uint32_t length;
+    if (!coded_input.ReadLittleEndian32(&magic) || magic != ::fsspool::kStreamBatcherMagic ||
+        !coded_input.ReadRaw(&hash, sizeof(hash)) || !coded_input.ReadVarint32(&length)) {
+      return false;
+    }
+
+    buf_.resize(length);
+    return coded_input.ReadRaw(buf_.data(), length) &&
+           msg->ParseFromArray(buf_.data(), static_cast<int>(buf_.size()));
+  }
+
+ private:
+  explicit CaptureReader(int fd) : fd_(fd), input_(fd) {}
+
+  int fd_;
+  google::protobuf::io::FileInputStream input_;
+  std::vector<uint8_t> buf_;
+};
+
+struct Stage {
+  const char* name;
+  LatencyHistogram histogram;
+  uint64_t total_ns = 0;
+
+  template <typename F>
+  auto Time(F&& f) {
+    uint64_t start = NowNs();
+    auto result = f();
+    uint64_t elapsed = NowNs() - start;
+    histogram.Record(static_cast<int64_t>(elapsed));
+    total_ns += elapsed;
+    return result;
+  }
+
+  void Report() {
+    LatencyHistogram::Snapshot snapshot = histogram.TakeSnapshot(false);
+    double throughput = total_ns > 0 ? snapshot.Count() * 1e9 / total_ns : 0;
+    printf("%-14s %10llu %14.0f %10llu %10llu %10llu %10llu\n", name, snapshot.Count(),
+           throughput, snapshot.ValueAtPercentile(50), snapshot.ValueAtPercentile(90),
+           snapshot.ValueAtPercentile(99), snapshot.Max());
+  }
+};
+
+struct Config {
+  double speed = 0;
+  int iterations = 1;
+};
+
+void PrintUsage() {
+  std::cout << "Usage: " << getprogname() << " [OPTIONS] <capture file>...\n"
+            << "Options:\n"
+            << "  -s <factor>  Replay at <factor> times the captured pace, or as fast as\n"
+            << "               possible when 0 (default: 0)\n"
+            << "  -i <count>   Number of times to replay the capture (default: 1)\n"
+            << "  -h           Show this help\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  @autoreleasepool {
+    Config config;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:i:h")) != -1) {
+      switch (opt) {
+        case 's': {
+          char* end;
+          double val = strtod(optarg, &end);
+          if (*end != '\0' || val < 0) {
+            std::cerr << "Error: Invalid speed: " << optarg << std::endl;
+            return 1;
+          }
+          config.speed = val;
+          break;
+        }
+        case 'i': {
+          char* end;
+          long val = strtol(optarg, &end, 10);
+          if (*end != '\0' || val <= 0) {
+            std::cerr << "Error: Invalid iteration count: " << optarg << std::endl;
+            return 1;
+          }
+          config.iterations = (int)val;
+          break;
+        }
+        case 'h': PrintUsage(); return 0;
+        default: PrintUsage(); return 1;
+      }
+    }
+
+    if (optind >= argc) {
+      PrintUsage();
+      return 1;
+    }
+
+    // Rebuild every event up front so that reading the capture isn't timed
+    std::vector<std::unique_ptr<ReplayEvent>> events;
+    size_t skipped = 0;
+    for (int i = optind; i < argc; i++) {
+      std::unique_ptr<CaptureReader> reader = CaptureReader::Open(argv[i]);
+      if (!reader) {
+        std::cerr << "Error: Unable to open capture: " << argv[i] << std::endl;
+        return 1;
+      }
+      pbv1::SantaMessage santa_msg;
+      while (reader->Next(&santa_msg)) {
+        if (auto ev = MakeReplayEvent(santa_msg)) {
+          events.push_back(std::move(ev));
+        } else {
+          skipped++;
+        }
+      }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const auto& a, const auto& b) {
+      return a->event_time_ns < b->event_time_ns;
+    });
+
+    if (events.empty()) {
+      std::cerr << "Error: No replayable events in capture" << std::endl;
+      return 1;
+    }
+
+    auto esapi = std::make_shared<ReplayEndpointSecurityAPI>();
+    auto tree = santa::santad::process_tree::CreateTree({});
+    if (!tree.ok()) {
+      std::cerr << "Error: Unable to create process tree: " << tree.status() << std::endl;
+      return 1;
+    }
+    Enricher enricher(*tree);
+    std::shared_ptr<Serializer> protobuf =
+        santa::Protobuf::Create(esapi, [SNTDecisionCache sharedCache]);
+    std::shared_ptr<Serializer> basic_string =
+        santa::BasicString::Create(esapi, [SNTDecisionCache sharedCache]);
+
+    Stage tree_stage{.name = "process_tree"};
+    Stage enrich_stage{.name = "enricher"};
+    Stage protobuf_stage{.name = "protobuf"};
+    Stage basic_string_stage{.name = "basic_string"};
+
+    uint64_t first_event_ns = events.front()->event_time_ns;
+    uint64_t start_ns = NowNs();
+    for (int iteration = 0; iteration < config.iterations; iteration++) {
+      uint64_t iteration_start_ns = NowNs();
+      for (const auto& ev : events) {
+        if (config.speed > 0) {
+          uint64_t due_ns =
+              iteration_start_ns + (ev->event_time_ns - first_event_ns) / config.speed;
+          uint64_t now_ns = NowNs();
+          if (due_ns > now_ns) {
+            struct timespec ts = {.tv_sec = (time_t)((due_ns - now_ns) / NSEC_PER_SEC),
+                                  .tv_nsec = (long)((due_ns - now_ns) % NSEC_PER_SEC)};
+            nanosleep(&ts, nullptr);
+          }
+        }
+
+        esapi->SetEvent(ev.get());
+        ev->msg.mach_time = mach_absolute_time();
+        Message msg(esapi, &ev->msg);
+
+        tree_stage.Time([&] {
+          santa::santad::process_tree::InformFromESEvent(**tree, msg);
+          return true;
+        });
+
+        // Each serializer gets its own enriched message, since names are
+        // resolved on first use
+        protobuf_stage.Time([&] {
+          return protobuf->SerializeMessage(enricher.Enrich(Message(msg)));
+        });
+        auto enriched = enrich_stage.Time([&] { return enricher.Enrich(Message(msg)); });
+        basic_string_stage.Time(
+            [&] { return basic_string->SerializeMessage(std::move(enriched)); });
+      }
+    }
+    uint64_t elapsed_ns = NowNs() - start_ns;
+
+    size_t replayed = events.size() * config.iterations;
+    printf("Replayed %zu events (%zu unsupported events skipped) in %.3fs, %.0f events/s\n\n",
+           replayed, skipped, elapsed_ns / 1e9, replayed * 1e9 / elapsed_ns);
+    printf("%-14s %10s %14s %10s %10s %10s %10s\n", "stage", "events", "events/s", "p50_ns",
+           "p90_ns", "p99_ns", "max_ns");
+    tree_stage.Report();
+    enrich_stage.Report();
+    protobuf_stage.Report();
+    basic_string_stage.Report();
+    printf("\nThe protobuf stage includes enriching its message.\n");
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA_TESTING_BENCHMARKS_REPLAYEVENT_H
+#define SANTA_TESTING_BENCHMARKS_REPLAYEVENT_H
+
+#include <EndpointSecurity/EndpointSecurity.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Source/common/es/EndpointSecurityAPI.h"
+#include "Source/common/santa.pb.h"
+
+namespace santa {
+
+// An es_message_t rebuilt from a logged event, and everything it points to.
+struct ReplayEvent {
+  ReplayEvent() = default;
+  ReplayEvent(const ReplayEvent&) = delete;
+  ReplayEvent& operator=(const ReplayEvent&) = delete;
+
+  es_message_t msg = {};
+  uint64_t event_time_ns = 0;
+
+  // Deques so that pointers to elements stay valid as more are added
+  std::deque<std::string> strings;
+  std::deque<es_file_t> files;
+  std::deque<es_process_t> procs;
+  std::vector<es_string_token_t> args;
+  std::vector<es_string_token_t> envs;
+
+  es_string_token_t Token(const std::string& str);
+  es_file_t* File(const std::string& path);
+  es_file_t* File(const ::santa::pb::v1::FileInfo& info);
+  es_process_t* Process(const ::santa::pb::v1::ProcessInfoLight& info);
+  es_process_t* Process(const ::santa::pb::v1::ProcessInfo& info);
+};
+
+// Rebuilds the es_message_t of a logged exec, fork, exit, close, rename or
+// unlink event. Returns nullptr for other event types.
+std::unique_ptr<ReplayEvent> MakeReplayEvent(const ::santa::pb::v1::SantaMessage& santa_msg);
+
+// Serves exec args and envs from the event being replayed instead of from
+// ES, and doesn't retain or release messages, which ES doesn't own.
+class ReplayEndpointSecurityAPI : public EndpointSecurityAPI {
+ public:
+  void SetEvent(const ReplayEvent* event) { event_ = event; }
+
+  void RetainMessage(const es_message_t* msg) override {}
+  void ReleaseMessage(const es_message_t* msg) override {}
+
+  uint32_t ExecArgCount(const es_event_exec_t* event) override;
+  es_string_token_t ExecArg(const es_event_exec_t* event, uint32_t index) override;
+  std::vector<std::string> ExecArgs(const es_event_exec_t* event) override;
+
+  uint32_t ExecEnvCount(const es_event_exec_t* event) override;
+  es_string_token_t ExecEnv(const es_event_exec_t* event, uint32_t index) override;
+  std::map<std::string, std::string> ExecEnvs(const es_event_exec_t* event) override;
+
+  uint32_t ExecFDCount(const es_event_exec_t* event) override { return 0; }
+  const es_fd_t* ExecFD(const es_event_exec_t* event, uint32_t index) override { return nullptr; }
+
+ private:
+  const ReplayEvent* event_ = nullptr;
+};
+
+}  // namespace santa
+
+#endif  // SANTA_TESTING_BENCHMARKS_REPLAYEVENT_H
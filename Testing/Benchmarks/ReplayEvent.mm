@@ -0,0 +1,229 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Testing/Benchmarks/ReplayEvent.h"
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "Source/common/String.h"
+
+namespace pbv1 = ::santa::pb::v1;
+
+namespace santa {
+
+namespace {
+
+audit_token_t AuditToken(const pbv1::ProcessID& id, uid_t euid, gid_t egid, uid_t ruid,
+                         gid_t rgid) {
+  return audit_token_t{.val = {0, euid, egid, ruid, rgid, static_cast<unsigned int>(id.pid()), 0,
+                               static_cast<unsigned int>(id.pidversion())}};
+}
+
+template <typename ProcessInfoT>
+es_process_t* AddProcess(ReplayEvent& ev, const ProcessInfoT& info) {
+  es_process_t& proc = ev.procs.emplace_back();
+  proc.audit_token =
+      AuditToken(info.id(), info.effective_user().uid(), info.effective_group().gid(),
+                 info.real_user().uid(), info.real_group().gid());
+  proc.parent_audit_token = AuditToken(info.parent_id(), 0, 0, 0, 0);
+  proc.ppid = static_cast<pid_t>(info.parent_id().pid());
+  proc.original_ppid = static_cast<pid_t>(info.original_parent_pid());
+  proc.group_id = static_cast<pid_t>(info.group_id());
+  proc.session_id = static_cast<pid_t>(info.session_id());
+
+  if constexpr (std::is_same_v<ProcessInfoT, pbv1::ProcessInfo>) {
+    proc.executable = ev.File(info.executable());
+    proc.is_platform_binary = info.is_platform_binary();
+    proc.is_es_client = info.is_es_client();
+    proc.codesigning_flags = info.cs_flags();
+    const std::string& cdhash = info.code_signature().cdhash();
+    memcpy(proc.cdhash, cdhash.data(), std::min(cdhash.size(), sizeof(proc.cdhash)));
+    proc.signing_id = ev.Token(info.code_signature().signing_id());
+    proc.team_id = ev.Token(info.code_signature().team_id());
+  } else {
+    proc.executable = ev.File(info.executable().path());
+  }
+  return &proc;
+}
+
+}  // namespace
+
+es_string_token_t ReplayEvent::Token(const std::string& str) {
+  const std::string& stored = strings.emplace_back(str);
+  return es_string_token_t{.length = stored.size(), .data = stored.c_str()};
+}
+
+es_file_t* ReplayEvent::File(const std::string& path) {
+  es_file_t& file = files.emplace_back();
+  file.path = Token(path);
+  return &file;
+}
+
+es_file_t* ReplayEvent::File(const pbv1::FileInfo& info) {
+  es_file_t* file = File(info.path());
+  file->path_truncated = info.truncated();
+
+  const pbv1::Stat& pb_stat = info.stat();
+  file->stat.st_dev = pb_stat.dev();
+  file->stat.st_mode = static_cast<mode_t>(pb_stat.mode());
+  file->stat.st_nlink = static_cast<nlink_t>(pb_stat.nlink());
+  file->stat.st_ino = pb_stat.ino();
+  file->stat.st_uid = pb_stat.user().uid();
+  file->stat.st_gid = pb_stat.group().gid();
+  file->stat.st_rdev = pb_stat.rdev();
+  file->stat.st_size = pb_stat.size();
+  file->stat.st_blocks = pb_stat.blocks();
+  file->stat.st_blksize = pb_stat.blksize();
+  file->stat.st_flags = pb_stat.flags();
+  file->stat.st_gen = pb_stat.gen();
+  file->stat.st_mtimespec.tv_sec = pb_stat.modification_time().seconds();
+  file->stat.st_mtimespec.tv_nsec = pb_stat.modification_time().nanos();
+  file->stat.st_ctimespec.tv_sec = pb_stat.change_time().seconds();
+  file->stat.st_ctimespec.tv_nsec = pb_stat.change_time().nanos();
+  return file;
+}
+
+es_process_t* ReplayEvent::Process(const pbv1::ProcessInfoLight& info) {
+  return AddProcess(*this, info);
+}
+
+es_process_t* ReplayEvent::Process(const pbv1::ProcessInfo& info) {
+  return AddProcess(*this, info);
+}
+
+std::unique_ptr<ReplayEvent> MakeReplayEvent(const pbv1::SantaMessage& santa_msg) {
+  auto ev = std::make_unique<ReplayEvent>();
+  es_message_t& msg = ev->msg;
+  msg.version = 4;
+  msg.action_type = ES_ACTION_TYPE_NOTIFY;
+  msg.time.tv_sec = santa_msg.event_time().seconds();
+  msg.time.tv_nsec = santa_msg.event_time().nanos();
+  ev->event_time_ns = msg.time.tv_sec * NSEC_PER_SEC + msg.time.tv_nsec;
+
+  switch (santa_msg.event_case()) {
+    case pbv1::SantaMessage::kExecution: {
+      const pbv1::Execution& exec = santa_msg.execution();
+      msg.event_type = ES_EVENT_TYPE_NOTIFY_EXEC;
+      msg.process = ev->Process(exec.instigator());
+      msg.event.exec.target = ev->Process(exec.target());
+      if (exec.has_script()) {
+        msg.event.exec.script = ev->File(exec.script());
+      }
+      if (exec.has_working_directory()) {
+        msg.event.exec.cwd = ev->File(exec.working_directory());
+      }
+      msg.event.exec.last_fd = -1;
+      for (const std::string& arg : exec.args()) {
+        ev->args.push_back(ev->Token(arg));
+      }
+      for (const std::string& env : exec.envs()) {
+        ev->envs.push_back(ev->Token(env));
+      }
+      break;
+    }
+    case pbv1::SantaMessage::kFork:
+      msg.event_type = ES_EVENT_TYPE_NOTIFY_FORK;
+      msg.process = ev->Process(santa_msg.fork().instigator());
+      msg.event.fork.child = ev->Process(santa_msg.fork().child());
+      break;
+    case pbv1::SantaMessage::kExit: {
+      const pbv1::Exit& exit = santa_msg.exit();
+      msg.event_type = ES_EVENT_TYPE_NOTIFY_EXIT;
+      msg.process = ev->Process(exit.instigator());
+      if (exit.has_exited()) {
+        msg.event.exit.stat = W_EXITCODE(exit.exited().exit_status(), 0);
+      } else if (exit.has_signaled()) {
+        msg.event.exit.stat = W_EXITCODE(0, exit.signaled().signal());
+      }
+      break;
+    }
+    case pbv1::SantaMessage::kClose:
+      msg.event_type = ES_EVENT_TYPE_NOTIFY_CLOSE;
+      msg.process = ev->Process(santa_msg.close().instigator());
+      msg.event.close.target = ev->File(santa_msg.close().target());
+      msg.event.close.modified = santa_msg.close().modified();
+      break;
+    case pbv1::SantaMessage::kRename: {
+      const pbv1::Rename& rename = santa_msg.rename();
+      msg.event_type = ES_EVENT_TYPE_NOTIFY_RENAME;
+      msg.process = ev->Process(rename.instigator());
+      msg.event.rename.source = ev->File(rename.source());
+      if (rename.target_existed()) {
+        msg.event.rename.destination_type = ES_DESTINATION_TYPE_EXISTING_FILE;
+        msg.event.rename.destination.existing_file = ev->File(rename.target());
+      } else {
+        // The capture only has the full target path, so split it back up
+        std::string target = rename.target();
+        size_t slash = target.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "" : target.substr(0, slash);
+        std::string filename = slash == std::string::npos ? target : target.substr(slash + 1);
+        msg.event.rename.destination_type = ES_DESTINATION_TYPE_NEW_PATH;
+        msg.event.rename.destination.new_path.dir = ev->File(dir);
+        msg.event.rename.destination.new_path.filename = ev->Token(filename);
+      }
+      break;
+    }
+    case pbv1::SantaMessage::kUnlink:
+      msg.event_type = ES_EVENT_TYPE_NOTIFY_UNLINK;
+      msg.process = ev->Process(santa_msg.unlink().instigator());
+      msg.event.unlink.target = ev->File(santa_msg.unlink().target());
+      break;
+    default: return nullptr;
+  }
+
+  return ev;
+}
+
+uint32_t ReplayEndpointSecurityAPI::ExecArgCount(const es_event_exec_t* event) {
+  return static_cast<uint32_t>(event_->args.size());
+}
+
+es_string_token_t ReplayEndpointSecurityAPI::ExecArg(const es_event_exec_t* event,
+                                                     uint32_t index) {
+  return event_->args[index];
+}
+
+std::vector<std::string> ReplayEndpointSecurityAPI::ExecArgs(const es_event_exec_t* event) {
+  std::vector<std::string> args;
+  for (const es_string_token_t& arg : event_->args) {
+    args.push_back(StringTokenToString(arg));
+  }
+  return args;
+}
+
+uint32_t ReplayEndpointSecurityAPI::ExecEnvCount(const es_event_exec_t* event) {
+  return static_cast<uint32_t>(event_->envs.size());
+}
+
+es_string_token_t ReplayEndpointSecurityAPI::ExecEnv(const es_event_exec_t* event,
+                                                     uint32_t index) {
+  return event_->envs[index];
+}
+
+std::map<std::string, std::string> ReplayEndpointSecurityAPI::ExecEnvs(
+    const es_event_exec_t* event) {
+  std::map<std::string, std::string> envs;
+  for (const es_string_token_t& env : event_->envs) {
+    std::string s = StringTokenToString(env);
+    size_t npos = s.find('=');
+    envs[s.substr(0, npos)] = npos == std::string::npos ? "" : s.substr(npos + 1);
+  }
+  return envs;
+}
+
+}  // namespace santa
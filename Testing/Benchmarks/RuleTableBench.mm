@@ -0,0 +1,380 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+/*
+
+Scaling benchmarks for the execution rules in SNTRuleTable, at the rule counts
+of our largest tenants.
+
+Run all benchmarks:
+  bazel run -c opt //Testing/Benchmarks:rule_table
+
+Run a subset, with repetitions for more stable numbers:
+  bazel run -c opt //Testing/Benchmarks:rule_table -- \
+      --benchmark_filter='Lookup/rules:1000000' --benchmark_repetitions=5
+
+Every benchmark runs against a file-backed database in a temporary directory,
+holding the given number of rules in the type mix of RuleQueryBench
+(CDHash 5%, Binary 40%, SigningID 15%, Certificate 30%, TeamID 10%):
+
+  CleanSync        - Replace every rule with SNTRuleCleanupAll in a single
+                     addExecutionRules: call, as the clean sync of a full
+                     rule set does. items_per_second is rules ingested.
+  StagedCleanSync  - The same rule set staged in chunks and committed with
+                     beginStagedRuleUpdate/commitStagedRuleUpdate.
+  IncrementalSync  - Add a batch of rules without cleanup, as a normal sync
+                     does, on top of the full rule set.
+  Lookup           - executionRuleForIdentifiers: for an even mix of hits on
+                     every rule type and misses, from several threads. wal:1
+                     enables concurrent reads the way santad does, wal:0
+                     leaves every read on the database queue.
+
+Besides Google Benchmark's timings, the syncs and lookups report p50_ns and
+p99_ns counters from per-iteration samples where iterations are short enough
+to sample, and every benchmark reports:
+
+  db_bytes         - Size of the database file and its WAL.
+  footprint_bytes  - The process's physical footprint once the table is
+                     populated.
+  footprint_growth - How much of that the table itself added: SQLite's page
+                     cache, the in-memory rule index and filter, etc.
+
+*/
+
+#import <Foundation/Foundation.h>
+#import <fmdb/FMDB.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#import "Source/common/SNTCommonEnums.h"
+#import "Source/common/SNTRule.h"
+#import "Source/common/SNTRuleIdentifiers.h"
+#import "Source/santad/DataLayer/SNTRuleTable.h"
+#include "Testing/Benchmarks/BenchUtils.h"
+#include "benchmark/benchmark.h"
+
+using santa::PhysFootprintBytes;
+using santa::RunWithPercentiles;
+
+namespace {
+
+// Matches kRulesDatabaseReaders in SNTDatabaseController.
+constexpr NSUInteger kReaders = 4;
+
+// Rules per call when staging a clean sync or populating a table, about what
+// a sync server sends per page.
+constexpr NSUInteger kChunkSize = 10000;
+
+constexpr int64_t kIncrementalBatchSize = 100;
+
+// Incremental batches are generated up front and then reused, so after the
+// first pass through them a batch replaces rules added by an earlier one.
+constexpr size_t kIncrementalBatches = 64;
+
+constexpr size_t kLookups = 4096;
+
+NSString* RandomHex(std::mt19937_64& gen, int length) {
+  static const char kHex[] = "0123456789abcdef";
+  char buf[65];
+  for (int i = 0; i < length; ++i) {
+    buf[i] = kHex[gen() % 16];
+  }
+  buf[length] = '\0';
+  return @(buf);
+}
+
+NSString* RandomTeamID(std::mt19937_64& gen) {
+  static const char kChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+  char buf[11];
+  for (int i = 0; i < 10; ++i) {
+    buf[i] = kChars[gen() % (sizeof(kChars) - 1)];
+  }
+  buf[10] = '\0';
+  return @(buf);
+}
+
+SNTRule* RandomRule(std::mt19937_64& gen) {
+  static const SNTRuleType kTypes[] = {SNTRuleTypeCDHash, SNTRuleTypeBinary,
+                                       SNTRuleTypeSigningID, SNTRuleTypeCertificate,
+                                       SNTRuleTypeTeamID};
+  static std::discrete_distribution<> type_dist({5, 40, 15, 30, 10});
+  SNTRuleType type = kTypes[type_dist(gen)];
+
+  NSString* identifier;
+  switch (type) {
+    case SNTRuleTypeCDHash: identifier = RandomHex(gen, 40); break;
+    case SNTRuleTypeSigningID:
+      identifier = [NSString
+          stringWithFormat:@"%@:com.example.bench.%@", RandomTeamID(gen), RandomHex(gen, 8)];
+      break;
+    case SNTRuleTypeTeamID: identifier = RandomTeamID(gen); break;
+    default: identifier = RandomHex(gen, 64); break;
+  }
+  return [[SNTRule alloc] initWithIdentifier:identifier state:SNTRuleStateAllow type:type];
+}
+
+NSArray<SNTRule*>* RandomRules(int64_t count, std::mt19937_64& gen) {
+  NSMutableArray<SNTRule*>* rules = [NSMutableArray arrayWithCapacity:count];
+  for (int64_t i = 0; i < count; ++i) {
+    [rules addObject:RandomRule(gen)];
+  }
+  return rules;
+}
+
+// Identifiers that miss every rule, with `rule`'s identifier in its slot if
+// one is given.
+struct RuleIdentifiers LookupFor(SNTRule* rule, std::mt19937_64& gen) {
+  struct RuleIdentifiers ids = {
+      .cdhash = RandomHex(gen, 40),
+      .binarySHA256 = RandomHex(gen, 64),
+      .signingID = [NSString stringWithFormat:@"%@:com.example.miss", RandomTeamID(gen)],
+      .certificateSHA256 = RandomHex(gen, 64),
+      .teamID = RandomTeamID(gen),
+  };
+  switch (rule ? rule.type : SNTRuleTypeUnknown) {
+    case SNTRuleTypeCDHash: ids.cdhash = rule.identifier; break;
+    case SNTRuleTypeBinary: ids.binarySHA256 = rule.identifier; break;
+    case SNTRuleTypeSigningID: ids.signingID = rule.identifier; break;
+    case SNTRuleTypeCertificate: ids.certificateSHA256 = rule.identifier; break;
+    case SNTRuleTypeTeamID: ids.teamID = rule.identifier; break;
+    default: break;
+  }
+  return ids;
+}
+
+// A rule table backed by a database in its own temporary directory, which is
+// removed with it.
+class RuleTableFixture {
+ public:
+  explicit RuleTableFixture(bool wal) {
+    dir_ = [NSTemporaryDirectory()
+        stringByAppendingPathComponent:[NSString stringWithFormat:@"rule_table_bench-%@",
+                                                                  [NSUUID UUID].UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:dir_
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+    path_ = [dir_ stringByAppendingPathComponent:@"rules.db"];
+    footprint_before_ = PhysFootprintBytes();
+    table_ = [[SNTRuleTable alloc]
+        initWithDatabaseQueue:[[FMDatabaseQueue alloc] initWithPath:path_]];
+    if (wal) [table_ enableConcurrentReadsWithMaxReaders:kReaders];
+  }
+
+  ~RuleTableFixture() {
+    table_ = nil;
+    [[NSFileManager defaultManager] removeItemAtPath:dir_ error:nil];
+  }
+
+  RuleTableFixture(const RuleTableFixture&) = delete;
+  RuleTableFixture& operator=(const RuleTableFixture&) = delete;
+
+  SNTRuleTable* table() const { return table_; }
+
+  // Adds `count` random rules in chunks and keeps a sample of them to look up.
+  void Populate(int64_t count, std::mt19937_64& gen) {
+    for (int64_t added = 0; added < count; added += kChunkSize) {
+      @autoreleasepool {
+        NSArray<SNTRule*>* rules = RandomRules(std::min<int64_t>(kChunkSize, count - added), gen);
+        [table_ addExecutionRules:rules ruleCleanup:SNTRuleCleanupNone errors:nil];
+        if (sample_.count < kLookups) [sample_ addObject:rules[gen() % rules.count]];
+      }
+    }
+  }
+
+  // An even mix of hits on sampled rules and misses.
+  std::vector<struct RuleIdentifiers> Lookups(std::mt19937_64& gen) const {
+    std::vector<struct RuleIdentifiers> lookups;
+    lookups.reserve(kLookups);
+    for (size_t i = 0; i < kLookups; ++i) {
+      SNTRule* rule = (i % 2 == 0 && sample_.count) ? sample_[gen() % sample_.count] : nil;
+      lookups.push_back(LookupFor(rule, gen));
+    }
+    return lookups;
+  }
+
+  void ReportSize(benchmark::State& state) const {
+    uint64_t db_bytes = 0;
+    for (NSString* path in @[ path_, [path_ stringByAppendingString:@"-wal"] ]) {
+      struct stat sb;
+      if (stat(path.fileSystemRepresentation, &sb) == 0) db_bytes += sb.st_size;
+    }
+    const size_t footprint = PhysFootprintBytes();
+    state.counters["db_bytes"] = benchmark::Counter(db_bytes);
+    state.counters["footprint_bytes"] = benchmark::Counter(footprint);
+    state.counters["footprint_growth"] =
+        benchmark::Counter(footprint > footprint_before_ ? footprint - footprint_before_ : 0);
+  }
+
+ private:
+  NSString* dir_;
+  NSString* path_;
+  SNTRuleTable* table_;
+  NSMutableArray<SNTRule*>* sample_ = [NSMutableArray array];
+  size_t footprint_before_ = 0;
+};
+
+// The populated table the incremental sync and lookup benchmarks share. It
+// takes minutes to build at 1M rules, so it is kept until a benchmark asks
+// for a different one.
+RuleTableFixture& PopulatedTable(int64_t rules, bool wal) {
+  static std::unique_ptr<RuleTableFixture> fixture;
+  static std::pair<int64_t, bool> key = {-1, false};
+  if (!fixture || key != std::make_pair(rules, wal)) {
+    fixture.reset();
+    fixture = std::make_unique<RuleTableFixture>(wal);
+    std::mt19937_64 gen(rules);
+    fixture->Populate(rules, gen);
+    key = {rules, wal};
+  }
+  return *fixture;
+}
+
+#pragma mark - Syncs
+
+void BM_RuleTableCleanSync(benchmark::State& state) {
+  @autoreleasepool {
+    std::mt19937_64 gen(1);
+    NSArray<SNTRule*>* rules = RandomRules(state.range(0), gen);
+    RuleTableFixture fixture(/*wal=*/true);
+    for (auto _ : state) {
+      @autoreleasepool {
+        if (![fixture.table() addExecutionRules:rules
+                                    ruleCleanup:SNTRuleCleanupAll
+                                         errors:nil]) {
+          state.SkipWithError("addExecutionRules failed");
+          break;
+        }
+      }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    fixture.ReportSize(state);
+  }
+}
+BENCHMARK(BM_RuleTableCleanSync)
+    ->ArgName("rules")
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Iterations(3)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_RuleTableStagedCleanSync(benchmark::State& state) {
+  @autoreleasepool {
+    std::mt19937_64 gen(1);
+    NSArray<SNTRule*>* rules = RandomRules(state.range(0), gen);
+    RuleTableFixture fixture(/*wal=*/true);
+    for (auto _ : state) {
+      @autoreleasepool {
+        NSString* updateID = [fixture.table() beginStagedRuleUpdate];
+        for (NSUInteger i = 0; i < rules.count; i += kChunkSize) {
+          NSRange range = NSMakeRange(i, MIN(kChunkSize, rules.count - i));
+          [fixture.table() stageExecutionRules:[rules subarrayWithRange:range]
+                               fileAccessRules:nil
+                              networkFlowRules:nil
+                                       signals:nil
+                                      updateID:updateID
+                                        errors:nil];
+        }
+        if (![fixture.table() commitStagedRuleUpdate:updateID
+                                         ruleCleanup:SNTRuleCleanupAll
+                                              errors:nil]) {
+          state.SkipWithError("commitStagedRuleUpdate failed");
+          break;
+        }
+      }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    fixture.ReportSize(state);
+  }
+}
+BENCHMARK(BM_RuleTableStagedCleanSync)
+    ->ArgName("rules")
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Iterations(3)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_RuleTableIncrementalSync(benchmark::State& state) {
+  @autoreleasepool {
+    RuleTableFixture& fixture = PopulatedTable(state.range(0), /*wal=*/true);
+    std::mt19937_64 gen(2);
+    std::vector<NSArray<SNTRule*>*> batches;
+    for (size_t i = 0; i < kIncrementalBatches; ++i) {
+      batches.push_back(RandomRules(kIncrementalBatchSize, gen));
+    }
+
+    size_t i = 0;
+    RunWithPercentiles(state, [&] {
+      @autoreleasepool {
+        [fixture.table() addExecutionRules:batches[i++ % batches.size()]
+                               ruleCleanup:SNTRuleCleanupNone
+                                    errors:nil];
+      }
+    });
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kIncrementalBatchSize);
+    fixture.ReportSize(state);
+  }
+}
+BENCHMARK(BM_RuleTableIncrementalSync)
+    ->ArgName("rules")
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+#pragma mark - Lookups
+
+void BM_RuleTableLookup(benchmark::State& state) {
+  static RuleTableFixture* fixture;
+  static std::vector<struct RuleIdentifiers> lookups;
+  if (state.thread_index() == 0) {
+    fixture = &PopulatedTable(state.range(0), state.range(1));
+    std::mt19937_64 gen(3);
+    lookups = fixture->Lookups(gen);
+  }
+
+  size_t i = state.thread_index() * 997;
+  RunWithPercentiles(state, [&] {
+    @autoreleasepool {
+      benchmark::DoNotOptimize(
+          [fixture->table() executionRuleForIdentifiers:lookups[i++ % lookups.size()]]);
+    }
+  });
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+
+  if (state.thread_index() == 0) {
+    fixture->ReportSize(state);
+  }
+}
+BENCHMARK(BM_RuleTableLookup)
+    ->ArgNames({"rules", "wal"})
+    ->ArgsProduct({{10000, 100000, 1000000}, {0, 1}})
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
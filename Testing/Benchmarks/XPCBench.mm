@@ -0,0 +1,204 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+/*
+
+Microbenchmarks comparing a round trip over MOLXPCConnection (NSXPC proxies,
+NSSecureCoding) with the same call over the libxpc fast path.
+
+  bazel run -c opt //Testing/Benchmarks:xpc
+
+Both sides of each connection live in this process, so the numbers measure
+the per-call overhead of the transport rather than any daemon work.
+
+*/
+
+#import <Foundation/Foundation.h>
+#include <xpc/xpc.h>
+
+#include <cstdint>
+#include <vector>
+
+#import "Source/common/MOLXPCConnection.h"
+#import "Source/common/SNTXPCFastPath.h"
+#include "benchmark/benchmark.h"
+
+@protocol XPCBenchProtocol
+- (void)cacheCounts:(void (^)(uint64_t rootCache, uint64_t nonRootCache))reply;
+- (void)checkCacheForVnodeIDs:(NSData*)vnodeIDs
+                    withReply:(void (^)(NSArray<NSNumber*>* actions,
+                                        NSArray<NSNumber*>* decisions))reply;
+@end
+
+@interface XPCBenchService : NSObject <XPCBenchProtocol>
+@end
+
+@implementation XPCBenchService
+
+- (void)cacheCounts:(void (^)(uint64_t, uint64_t))reply {
+  reply(1, 2);
+}
+
+- (void)checkCacheForVnodeIDs:(NSData*)vnodeIDs
+                    withReply:(void (^)(NSArray<NSNumber*>*, NSArray<NSNumber*>*))reply {
+  NSUInteger count = vnodeIDs.length / sizeof(uint64_t);
+  NSMutableArray<NSNumber*>* actions = [NSMutableArray arrayWithCapacity:count];
+  NSMutableArray<NSNumber*>* decisions = [NSMutableArray arrayWithCapacity:count];
+  for (NSUInteger i = 0; i < count; i++) {
+    [actions addObject:@(i)];
+    [decisions addObject:@(i)];
+  }
+  reply(actions, decisions);
+}
+
+@end
+
+namespace {
+
+NSXPCInterface* BenchInterface() {
+  return [NSXPCInterface interfaceWithProtocol:@protocol(XPCBenchProtocol)];
+}
+
+struct NSXPCFixture {
+  NSXPCListener* listener;
+  MOLXPCConnection* server;
+  MOLXPCConnection* client;
+
+  NSXPCFixture() {
+    listener = [NSXPCListener anonymousListener];
+    server = [[MOLXPCConnection alloc] initServerWithListener:listener codeSigningRequirement:nil];
+    server.privilegedInterface = server.unprivilegedInterface = BenchInterface();
+    server.exportedObject = [[XPCBenchService alloc] init];
+    [server resume];
+
+    client = [[MOLXPCConnection alloc] initClientWithListener:listener.endpoint
+                                       codeSigningRequirement:nil];
+    client.remoteInterface = BenchInterface();
+    [client resume];
+  }
+
+  ~NSXPCFixture() {
+    [client invalidate];
+    [server invalidate];
+  }
+};
+
+struct FastPathFixture {
+  SNTXPCFastPathServer* server;
+  SNTXPCFastPathClient* client;
+
+  FastPathFixture() {
+    server = [[SNTXPCFastPathServer alloc] init];
+    [server
+          setHandler:^(xpc_object_t request, xpc_object_t reply) {
+            xpc_dictionary_set_uint64(reply, kSNTXPCFastPathRootCacheCountKey, 1);
+            xpc_dictionary_set_uint64(reply, kSNTXPCFastPathNonRootCacheCountKey, 2);
+          }
+        forOperation:SNTXPCFastPathOperationCacheCounts];
+    [server
+          setHandler:^(xpc_object_t request, xpc_object_t reply) {
+            size_t length = 0;
+            xpc_dictionary_get_data(request, kSNTXPCFastPathVnodeIDsKey, &length);
+            std::vector<int64_t> values(length / sizeof(uint64_t));
+            for (size_t i = 0; i < values.size(); i++) {
+              values[i] = i;
+            }
+            xpc_dictionary_set_data(reply, kSNTXPCFastPathActionsKey, values.data(),
+                                    values.size() * sizeof(int64_t));
+            xpc_dictionary_set_data(reply, kSNTXPCFastPathDecisionsKey, values.data(),
+                                    values.size() * sizeof(int64_t));
+          }
+        forOperation:SNTXPCFastPathOperationCheckCache];
+    [server resume];
+
+    client = [[SNTXPCFastPathClient alloc] initWithEndpoint:[server endpoint]];
+  }
+
+  ~FastPathFixture() { [client invalidate]; }
+};
+
+NSData* VnodeIDs(int64_t count) {
+  std::vector<uint64_t> ids(count);
+  for (int64_t i = 0; i < count; i++) {
+    ids[i] = i;
+  }
+  return [NSData dataWithBytes:ids.data() length:ids.size() * sizeof(uint64_t)];
+}
+
+void BM_NSXPCCacheCounts(benchmark::State& state) {
+  NSXPCFixture fixture;
+  id<XPCBenchProtocol> proxy = [fixture.client synchronousRemoteObjectProxy];
+  for (auto _ : state) {
+    @autoreleasepool {
+      __block uint64_t root = 0;
+      [proxy cacheCounts:^(uint64_t rootCache, uint64_t nonRootCache) {
+        root = rootCache;
+      }];
+      benchmark::DoNotOptimize(root);
+    }
+  }
+}
+BENCHMARK(BM_NSXPCCacheCounts);
+
+void BM_FastPathCacheCounts(benchmark::State& state) {
+  FastPathFixture fixture;
+  for (auto _ : state) {
+    @autoreleasepool {
+      xpc_object_t reply = [fixture.client sendOperation:SNTXPCFastPathOperationCacheCounts
+                                                 request:nil];
+      benchmark::DoNotOptimize(xpc_dictionary_get_uint64(reply, kSNTXPCFastPathRootCacheCountKey));
+    }
+  }
+}
+BENCHMARK(BM_FastPathCacheCounts);
+
+void BM_NSXPCCheckCache(benchmark::State& state) {
+  NSXPCFixture fixture;
+  id<XPCBenchProtocol> proxy = [fixture.client synchronousRemoteObjectProxy];
+  NSData* vnodeIDs = VnodeIDs(state.range(0));
+  for (auto _ : state) {
+    @autoreleasepool {
+      __block NSUInteger count = 0;
+      [proxy checkCacheForVnodeIDs:vnodeIDs
+                         withReply:^(NSArray<NSNumber*>* actions, NSArray<NSNumber*>* decisions) {
+                           count = actions.count;
+                         }];
+      benchmark::DoNotOptimize(count);
+    }
+  }
+}
+BENCHMARK(BM_NSXPCCheckCache)->Arg(1)->Arg(64)->Arg(1024);
+
+void BM_FastPathCheckCache(benchmark::State& state) {
+  FastPathFixture fixture;
+  NSData* vnodeIDs = VnodeIDs(state.range(0));
+  for (auto _ : state) {
+    @autoreleasepool {
+      xpc_object_t reply =
+          [fixture.client sendOperation:SNTXPCFastPathOperationCheckCache
+                                request:^(xpc_object_t request) {
+                                  xpc_dictionary_set_data(request, kSNTXPCFastPathVnodeIDsKey,
+                                                          vnodeIDs.bytes, vnodeIDs.length);
+                                }];
+      size_t length = 0;
+      benchmark::DoNotOptimize(
+          xpc_dictionary_get_data(reply, kSNTXPCFastPathActionsKey, &length));
+    }
+  }
+}
+BENCHMARK(BM_FastPathCheckCache)->Arg(1)->Arg(64)->Arg(1024);
+
+}  // namespace
+
+BENCHMARK_MAIN();
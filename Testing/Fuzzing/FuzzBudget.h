@@ -0,0 +1,103 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+// Shared plumbing for the *PerfFuzzer targets: default libFuzzer limits
+// baked into the binary, and an in-process per-input time budget that is
+// much tighter than libFuzzer's whole-second -timeout.
+#ifndef SANTA_TESTING_FUZZING_FUZZBUDGET_H
+#define SANTA_TESTING_FUZZING_FUZZBUDGET_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <vector>
+
+namespace santa::fuzzing {
+
+// Prepends `defaults` to the libFuzzer command line. Call from
+// LLVMFuzzerInitialize, which runs before libFuzzer parses its flags.
+// libFuzzer lets the last occurrence of a flag win, so anything passed on
+// the command line (or by the rules_fuzzing launcher) still overrides the
+// defaults.
+inline void InjectDefaultFlags(int* argc, char*** argv,
+                               std::initializer_list<const char*> defaults) {
+  // libFuzzer keeps pointers into argv for the life of the process.
+  static std::vector<char*> args;
+  args.clear();
+  args.push_back((*argv)[0]);
+  for (const char* flag : defaults) {
+    args.push_back(const_cast<char*>(flag));
+  }
+  for (int i = 1; i < *argc; ++i) {
+    args.push_back((*argv)[i]);
+  }
+  args.push_back(nullptr);
+  *argc = static_cast<int>(args.size() - 1);
+  *argv = args.data();
+}
+
+// Aborts, so libFuzzer saves the input as a crash reproducer, when the
+// enclosing scope takes longer than `budget`. The first input in a process
+// is exempt: it pays for one-time costs such as loading Security.framework
+// that say nothing about the input itself.
+//
+// SANTA_FUZZ_BUDGET_SCALE multiplies every budget, for slow or heavily
+// loaded machines (e.g. SANTA_FUZZ_BUDGET_SCALE=4 on a shared CI runner).
+class ScopedInputBudget {
+ public:
+  ScopedInputBudget(std::chrono::milliseconds budget, size_t input_size)
+      : budget_(budget * Scale()),
+        input_size_(input_size),
+        start_(std::chrono::steady_clock::now()) {}
+
+  ScopedInputBudget(const ScopedInputBudget&) = delete;
+  ScopedInputBudget& operator=(const ScopedInputBudget&) = delete;
+
+  ~ScopedInputBudget() {
+    static bool warmed_up = false;
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    if (!warmed_up) {
+      warmed_up = true;
+      return;
+    }
+    if (elapsed <= budget_) return;
+    std::fprintf(stderr,
+                 "==santa== ERROR: %zu-byte input took %.3f ms "
+                 "(budget %.3f ms)\n",
+                 input_size_,
+                 std::chrono::duration<double, std::milli>(elapsed).count(),
+                 budget_.count());
+    std::abort();
+  }
+
+ private:
+  static double Scale() {
+    static const double scale = [] {
+      const char* env = std::getenv("SANTA_FUZZ_BUDGET_SCALE");
+      double v = env ? std::strtod(env, nullptr) : 1.0;
+      return v > 0 ? v : 1.0;
+    }();
+    return scale;
+  }
+
+  std::chrono::duration<double, std::milli> budget_;
+  size_t input_size_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace santa::fuzzing
+
+#endif  // SANTA_TESTING_FUZZING_FUZZBUDGET_H
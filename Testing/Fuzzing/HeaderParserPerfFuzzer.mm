@@ -0,0 +1,72 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+// Fuzz target: HeaderParser::Update() fed the way VerifyingHasherCore feeds
+// it in production (1 MiB preads), on inputs up to twice kMaxSizeOfCmds.
+// Oracles: ASan, plus a per-input time budget (FuzzBudget.h) and libFuzzer
+// allocation limits sized for the worst header santad must accept: 64
+// fat_arch entries and a full 1 MiB load-command region.
+#include <mach/machine.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "Source/common/verifyinghasher/HeaderParser.h"
+#include "Testing/Fuzzing/FuzzBudget.h"
+
+using santa::ArchSelector;
+using santa::HeaderParser;
+
+namespace {
+#if defined(__arm64__) || defined(__aarch64__)
+constexpr ArchSelector kArch = {CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64E};
+#elif defined(__x86_64__)
+constexpr ArchSelector kArch = {CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL};
+#else
+#error "Unsupported host architecture"
+#endif
+
+// VerifyingHasherCore::Options::buf_size default.
+constexpr size_t kChunkSize = 1u << 20;
+
+// Header parsing runs before any page is hashed, so it should never cost
+// more than a small slice of the AUTH EXEC deadline, even for the largest
+// load-command region HeaderParser accepts.
+constexpr std::chrono::milliseconds kBudget(20);
+}  // namespace
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+  santa::fuzzing::InjectDefaultFlags(argc, argv,
+                                     {
+                                         "-max_len=2097152",
+                                         "-timeout=1",
+                                         "-malloc_limit_mb=16",
+                                         "-rss_limit_mb=512",
+                                     });
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  santa::fuzzing::ScopedInputBudget budget(kBudget, size);
+  HeaderParser hp(kArch, static_cast<uint64_t>(size));
+  size_t off = 0;
+  while (off < size && hp.status() == HeaderParser::Status::kNeedMore) {
+    const size_t n = std::min(kChunkSize, size - off);
+    hp.Update(data + off, n, static_cast<uint64_t>(off));
+    off += n;
+  }
+  return 0;
+}
@@ -0,0 +1,49 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+// Fuzz target: KernelCsBlob::ParseBytes() on inputs up to 4 MiB. Oracles:
+// ASan, plus a per-input time budget (FuzzBudget.h) and libFuzzer
+// allocation limits. The worst cases are the BlobIndex walk, which
+// FindSlotPayload repeats for each slot it looks up, and the entitlement
+// payload copies; CMSDecoder and trust evaluation on real signatures set
+// the floor for the budget.
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "Source/common/verifyinghasher/KernelCsBlob.h"
+#include "Testing/Fuzzing/FuzzBudget.h"
+
+namespace {
+constexpr std::chrono::milliseconds kBudget(500);
+}  // namespace
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+  santa::fuzzing::InjectDefaultFlags(argc, argv,
+                                     {
+                                         "-max_len=4194304",
+                                         "-timeout=5",
+                                         "-malloc_limit_mb=64",
+                                         "-rss_limit_mb=1024",
+                                     });
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  santa::fuzzing::ScopedInputBudget budget(kBudget, size);
+  santa::KernelCsBlob::ParseBytes(std::span<const uint8_t>(data, size),
+                                  /*cd_bytes=*/{});
+  return 0;
+}
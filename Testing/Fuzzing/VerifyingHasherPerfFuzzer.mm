@@ -0,0 +1,73 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+// Fuzz target: VerifyingHasherCore::Run() on inputs up to 4 MiB. Oracles:
+//   1. ASan
+//   2. A per-input time budget (FuzzBudget.h) and libFuzzer allocation
+//      limits, so inputs that make verification slow or memory hungry are
+//      reported as findings instead of passing silently
+//   3. CountingMemoryFileReader::MaxReadsAnyByte() <= 1
+#include <mach/machine.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "Source/common/verifyinghasher/CountingMemoryFileReader.h"
+#include "Source/common/verifyinghasher/VerifyingHasherCore.h"
+#include "Testing/Fuzzing/FuzzBudget.h"
+
+using santa::ArchSelector;
+using santa::CountingMemoryFileReader;
+using santa::VerifyingHasherCore;
+
+namespace {
+#if defined(__arm64__) || defined(__aarch64__)
+constexpr ArchSelector kArch = {CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64E};
+#elif defined(__x86_64__)
+constexpr ArchSelector kArch = {CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL};
+#else
+#error "Unsupported host architecture"
+#endif
+
+// Covers the header walk, the CS blob parse, and hashing every page of a
+// 4 MiB input twice (file SHA-256 plus slot hashes).
+constexpr std::chrono::milliseconds kBudget(250);
+}  // namespace
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+  santa::fuzzing::InjectDefaultFlags(argc, argv,
+                                     {
+                                         "-max_len=4194304",
+                                         "-timeout=2",
+                                         "-malloc_limit_mb=64",
+                                         "-rss_limit_mb=1024",
+                                     });
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  std::vector<uint8_t> bytes(data, data + size);
+  CountingMemoryFileReader reader(std::move(bytes));
+  {
+    // The reader's copy of the input and its per-byte counters are set up
+    // outside the budget; only verification itself is timed.
+    santa::fuzzing::ScopedInputBudget budget(kBudget, size);
+    VerifyingHasherCore v(reader, kArch);
+    (void)v.Run();
+  }
+  if (reader.MaxReadsAnyByte() > 1) std::abort();
+  return 0;
+}
@@ -0,0 +1,217 @@
+#!/bin/bash
+#
+# Copyright 2026 North Pole Security, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Generate the worst-case seeds for the *PerfFuzzer targets into OUT_DIR.
+# Each seed sits at a limit the parsers enforce (64 fat_arch entries, 1 MiB
+# of load commands, a SuperBlob index filling its blob, ...), so replaying
+# the corpus under the *PerfFuzzer budgets doubles as a regression
+# benchmark. The :perf_corpus genrule runs this at build time, so the
+# seeds, several MiB each, are never checked in. Idempotent.
+#
+# Unlike regenerate_corpus.sh this only needs python3, so it runs on Linux.
+set -ueo pipefail
+
+if [[ $# -ne 1 ]]; then
+  echo "usage: $0 OUT_DIR" >&2
+  exit 1
+fi
+
+python3 - "$1" <<'PY'
+import hashlib
+import os
+import struct
+import sys
+
+OUT_DIR = sys.argv[1]
+
+MIB = 1 << 20
+
+CPU_TYPE_X86_64 = 0x01000007
+CPU_TYPE_ARM64 = 0x0100000C
+CPU_TYPE_POWERPC = 18
+CPU_SUBTYPE_X86_64_ALL = 3
+CPU_SUBTYPE_ARM64E = 2
+
+MH_MAGIC_64 = 0xFEEDFACF
+MH_EXECUTE = 2
+LC_SOURCE_VERSION = 0x2A
+LC_CODE_SIGNATURE = 0x1D
+
+CSMAGIC_EMBEDDED_SIGNATURE = 0xFADE0CC0
+CSMAGIC_CODEDIRECTORY = 0xFADE0C02
+CSMAGIC_EMBEDDED_ENTITLEMENTS = 0xFADE7171
+CSMAGIC_EMBEDDED_DER_ENTITLEMENTS = 0xFADE7172
+CSSLOT_CODEDIRECTORY = 0
+CSSLOT_REQUIREMENTS = 2
+CSSLOT_ENTITLEMENTS = 5
+CSSLOT_DER_ENTITLEMENTS = 7
+CSSLOT_ALTERNATE_CODEDIRECTORIES = 0x1000
+CSSLOT_SIGNATURESLOT = 0x10000
+CS_HASHTYPE_SHA1 = 1
+CS_HASHTYPE_SHA256 = 2
+CS_HASHTYPE_SHA256_TRUNCATED = 3
+CS_HASHTYPE_SHA384 = 4
+CS_ADHOC = 0x2
+
+# Mirrors HeaderParser's limits.
+MAX_NFAT = 64
+MAX_SIZEOFCMDS = MIB
+
+# Both host architectures the fuzzers select, so every fat seed is parsed
+# the whole way through on either kind of machine.
+HOST_ARCHS = [
+    (CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64E),
+    (CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL),
+]
+
+def write(name, data):
+    os.makedirs(OUT_DIR, exist_ok=True)
+    with open(os.path.join(OUT_DIR, name), "wb") as f:
+        f.write(data)
+
+def align(n, a):
+    return (n + a - 1) // a * a
+
+def fat(slice_bytes, fat64, slice_off=16384):
+    # 64 entries, with the host archs last so the arch table walk visits
+    # every entry. All entries share one slice: HeaderParser doesn't check
+    # for overlap, and it keeps the seed small.
+    fillers = [(CPU_TYPE_POWERPC, i) for i in range(MAX_NFAT - len(HOST_ARCHS))]
+    out = struct.pack(">II", 0xCAFEBABF if fat64 else 0xCAFEBABE, MAX_NFAT)
+    for ct, st in fillers + HOST_ARCHS:
+        if fat64:
+            out += struct.pack(">IIQQII", ct, st, slice_off, len(slice_bytes), 14, 0)
+        else:
+            out += struct.pack(">IIIII", ct, st, slice_off, len(slice_bytes), 14)
+    return out.ljust(slice_off, b"\0") + slice_bytes
+
+def max_load_commands(cs_size):
+    # A full MAX_SIZEOFCMDS region of minimum-size (8 byte) load commands,
+    # with the LC_CODE_SIGNATURE the walk is looking for at the very end.
+    lc_cs_size = 16
+    nfiller = (MAX_SIZEOFCMDS - lc_cs_size) // 8
+    hdr_size = 32
+    cs_off = align(hdr_size + MAX_SIZEOFCMDS, 16)
+    cmds = struct.pack("<II", LC_SOURCE_VERSION, 8) * nfiller
+    cmds += struct.pack("<IIII", LC_CODE_SIGNATURE, lc_cs_size, cs_off, cs_size)
+    assert len(cmds) == MAX_SIZEOFCMDS
+    hdr = struct.pack("<IiiIIIII", MH_MAGIC_64, CPU_TYPE_ARM64,
+                      CPU_SUBTYPE_ARM64E, MH_EXECUTE, nfiller + 1,
+                      len(cmds), 0, 0)
+    return (hdr + cmds).ljust(cs_off, b"\0"), cs_off
+
+def super_blob(blobs, extra_index=()):
+    # blobs: [(slot_type, bytes)]; extra_index: [(slot_type, blob number)]
+    # appended after the real entries, pointing at existing blobs.
+    count = len(blobs) + len(extra_index)
+    off = 12 + 8 * count
+    offsets = []
+    body = b""
+    for _, b in blobs:
+        offsets.append(off + len(body))
+        body += b
+    index = b"".join(struct.pack(">II", t, o)
+                     for (t, _), o in zip(blobs, offsets))
+    index += b"".join(struct.pack(">II", t, offsets[i]) for t, i in extra_index)
+    length = off + len(body)
+    return struct.pack(">III", CSMAGIC_EMBEDDED_SIGNATURE, length, count) + index + body
+
+HASHES = {
+    CS_HASHTYPE_SHA1: (hashlib.sha1, 20),
+    CS_HASHTYPE_SHA256: (hashlib.sha256, 32),
+    CS_HASHTYPE_SHA256_TRUNCATED: (hashlib.sha256, 20),
+    CS_HASHTYPE_SHA384: (hashlib.sha384, 48),
+}
+
+def code_directory(hash_type, code=None, page_shift=12):
+    # Version 0x20400 CodeDirectory. With `code`, carries correct slot
+    # hashes for every page of it; without, is a bare header that only
+    # passes the structural floor non-picked candidates are held to.
+    fn, size = HASHES[hash_type]
+    ident = b"com.northpolesec.santa.perf\0"
+    page = 1 << page_shift
+    slots = b""
+    if code is not None:
+        for i in range(0, len(code), page):
+            slots += fn(code[i:i + page]).digest()[:size]
+    hdr_len = 88
+    ident_off = hdr_len
+    hash_off = align(ident_off + len(ident), 8)
+    length = hash_off + len(slots)
+    code_limit = len(code) if code is not None else 0
+    hdr = struct.pack(">IIIIIIIIIBBBBIIIIQQQQ", CSMAGIC_CODEDIRECTORY, length,
+                      0x20400, CS_ADHOC, hash_off, ident_off, 0,
+                      len(slots) // size, code_limit, size, hash_type, 0,
+                      page_shift, 0, 0, 0, 0, 0, 0, 0, 0)
+    assert len(hdr) == hdr_len
+    return (hdr + ident).ljust(hash_off, b"\0") + slots
+
+def generic_blob(magic, payload):
+    return struct.pack(">II", magic, 8 + len(payload)) + payload
+
+# HeaderParserPerfFuzzer: the largest header HeaderParser accepts, behind
+# both fat table flavours.
+hp_slice, _ = max_load_commands(cs_size=0)
+write("fat32_max_archs_max_cmds",
+      fat(hp_slice, fat64=False))
+write("fat64_max_archs_max_cmds",
+      fat(hp_slice, fat64=True))
+
+# VerifyingHasherPerfFuzzer: the same header, ad-hoc signed with every
+# supported hash type so the picker sees all four ranks, the strongest
+# (SHA-384) holding valid hashes for every page, and the SuperBlob index
+# padded with non-CD entries the candidate walk has to skip.
+cds = [
+    (CSSLOT_CODEDIRECTORY, CS_HASHTYPE_SHA1),
+    (CSSLOT_ALTERNATE_CODEDIRECTORIES, CS_HASHTYPE_SHA256_TRUNCATED),
+    (CSSLOT_ALTERNATE_CODEDIRECTORIES + 1, CS_HASHTYPE_SHA256),
+    (CSSLOT_ALTERNATE_CODEDIRECTORIES + 2, CS_HASHTYPE_SHA384),
+]
+def signature(code):
+    blobs = [(slot, code_directory(ht, code if ht == CS_HASHTYPE_SHA384 else None))
+             for slot, ht in cds]
+    return super_blob(blobs, [(CSSLOT_REQUIREMENTS, 0)] * 4096)
+# The signature's size feeds back into LC_CODE_SIGNATURE, which is hashed,
+# so build once to learn the size and again with it in place.
+size = len(signature(max_load_commands(cs_size=0)[0]))
+code, _ = max_load_commands(cs_size=size)
+sig = signature(code)
+assert len(sig) == size
+write("fat32_max_archs_max_cmds_signed",
+      fat(code + sig, fat64=False))
+
+# KernelCsBlobPerfFuzzer: a 1 MiB SuperBlob whose index fills the blob,
+# every entry a near miss (right slot type, wrong magic) for one of the
+# three FindSlotPayload lookups...
+decoy = generic_blob(0xFADE0000, b"")
+count = (MIB - 12 - len(decoy)) // 8
+types = [CSSLOT_ENTITLEMENTS, CSSLOT_DER_ENTITLEMENTS, CSSLOT_SIGNATURESLOT]
+write("max_index_entries.csblob",
+      super_blob([(types[0], decoy)],
+                 [(types[(i + 1) % 3], 0) for i in range(count - 1)]))
+
+# ...and one with 1 MiB entitlement payloads in both slots, which are
+# copied out of the blob.
+xml = (b'<?xml version="1.0" encoding="UTF-8"?>\n<plist version="1.0"><dict>'
+       + b"<key>k</key><true/>" * (MIB // 19) + b"</dict></plist>\n")
+der_items = b"\x0c\x01k" * (MIB // 3)
+der = b"\x70\x83" + struct.pack(">I", len(der_items))[1:] + der_items
+write("large_entitlements.csblob",
+      super_blob([(CSSLOT_ENTITLEMENTS,
+                   generic_blob(CSMAGIC_EMBEDDED_ENTITLEMENTS, xml)),
+                  (CSSLOT_DER_ENTITLEMENTS,
+                   generic_blob(CSMAGIC_EMBEDDED_DER_ENTITLEMENTS, der))]))
+PY
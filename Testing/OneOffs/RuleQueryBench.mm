@@ -15,6 +15,8 @@
 /*
 
 Benchmark different SQL query strategies for execution rule lookups.
+For ingest and lookup through SNTRuleTable itself at up to 1M rules, see
+Testing/Benchmarks/RuleTableBench.mm.
 
 Generate a test database:
   bazel-bin/Testing/OneOffs/rule_query_bench -g 100000 -d /tmp/rule_bench.db
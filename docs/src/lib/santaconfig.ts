@@ -120,6 +120,58 @@ export const SantaConfigKeyGroups: SantaConfigGroups = {
       type: "bool",
       defaultValue: false,
     },
+    {
+      key: "BatchedEventDispatchWorkers",
+      description: `If set, EndpointSecurity events are handed to this many shared worker threads through
+        per-client queues, and AUTH deadlines are enforced by a single shared timer, instead of dispatching each
+        event and its deadline individually. This reduces overhead at high event rates. At most 64. Requires a
+        restart of santad to take effect.`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "AuthorizerShardCount",
+      description: `The number of EndpointSecurity clients that execution authorization is spread over.
+        Processes are assigned to a client by pid, so execs that are slow to evaluate, e.g. of large binaries
+        that must be hashed, only hold up other execs assigned to the same client. At most 8. Requires a
+        restart of santad to take effect.`,
+      type: "integer",
+      defaultValue: 1,
+    },
+    {
+      key: "EnableCacheSnapshot",
+      description: `If true, santad periodically saves its allowed execution decisions for binaries on the root
+        volume and restores them at startup, so the decision cache starts warm after a restart. The snapshot is
+        discarded if the rules, client mode, path regexes or Santa version have changed since it was written.`,
+      type: "bool",
+      defaultValue: false,
+    },
+    {
+      key: "CacheSnapshotIntervalSec",
+      description: `If \`EnableCacheSnapshot\` is true, the number of seconds between snapshots of the decision
+        cache. Values are clamped between 60 and 86400 (one day).`,
+      type: "integer",
+      defaultValue: 600,
+      enableIf: (data) => data.EnableCacheSnapshot,
+    },
+    {
+      key: "EnablePrehashing",
+      description: `If true, santad hashes Mach-O executables in the background as soon as they are closed after
+        being written, so the first execution of a freshly built or downloaded binary doesn't have to compute its
+        SHA-256 before the EndpointSecurity deadline. Background hashing is rate limited and runs at a low priority.`,
+      type: "bool",
+      defaultValue: false,
+    },
+    {
+      key: "EnableLazyBinaryHashing",
+      description: `If true, santad only computes the SHA-256 of an executable when something needs it: a binary
+        rule exists, an event for the execution will be stored, or \`EnableTransitiveRules\` or
+        \`EnableAllEventUpload\` is set. Otherwise decisions for binaries whose CDHash is enforced by the kernel are
+        made from their CDHash and signing details alone, only the executing slice of a universal binary is read and
+        hashed, and their execution logs omit the SHA-256.`,
+      type: "bool",
+      defaultValue: false,
+    },
     {
       key: "AntiSuspendSigningIDs",
       description: "A list of Signing IDs to protect from `pid_suspend` calls.",
@@ -139,6 +191,7 @@ export const SantaConfigKeyGroups: SantaConfigGroups = {
         { value: "kill" },
         { value: "ping" },
         { value: "eventupload" },
+        { value: "rule_push" },
       ],
       versionAdded: "2026.3",
     },
@@ -400,6 +453,62 @@ The following sequences will be replaced in the final URL:
       ],
       versionAdded: "2024.11",
     },
+    {
+      key: "TelemetrySampleRates",
+      description: `Dictionary mapping event names, as used in the \`Telemetry\` key, to a sample rate N.
+        Only 1 in every N events of that type is logged. Events without an entry, or with a rate of 1, are
+        always logged.`,
+      type: "dict",
+    },
+    {
+      key: "TelemetryAggregatedEvents",
+      description: `Array of event names, as used in the \`Telemetry\` key, that are aggregated instead of
+        being logged individually. For each aggregation window, a single \`EVENT_SUMMARY\` record is logged
+        per executable and event type with a count and the most frequent target paths.`,
+      type: "string",
+      repeated: true,
+    },
+    {
+      key: "TelemetryAggregationWindowSec",
+      description: `The number of seconds covered by each \`EVENT_SUMMARY\` record logged for events listed in
+        \`TelemetryAggregatedEvents\`. Values are clamped between 10 and 3600.`,
+      type: "integer",
+      defaultValue: 60,
+    },
+    {
+      key: "TelemetryLoadSheddingThreshold",
+      description: `When set, events listed in \`TelemetryLoadSheddingEvents\` are dropped once this many events
+        are waiting to be written to the event log. The share of these events that is logged falls as the
+        backlog grows, until none are logged at twice the threshold. A value of 0 disables load shedding.`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "TelemetryLoadSheddingEvents",
+      description: `Array of event names, as used in the \`Telemetry\` key, that are dropped first when the event
+        log falls behind. When unset, \`Fork\`, \`Exit\`, \`Close\` and \`Link\` events are shed. \`Execution\` and
+        \`FileAccess\` events are never dropped.`,
+      type: "string",
+      repeated: true,
+    },
+    {
+      key: "NetworkFlowAggregationWindowSec",
+      description: `When set, network flows are merged by process, remote endpoint and protocol, and a single
+        \`NetworkActivity\` record is logged per window of this many seconds instead of one per reporting
+        interval. Merged flows carry the summed byte counts and a \`flow_count\`. Only supported by the
+        protobuf log formats. A value of 0 disables aggregation; other values are clamped between 10 and 3600.`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "NetworkFlowRingCapacity",
+      description: `When set, the network extension is offered a shared memory ring holding this many flow
+        records to report network flows through, instead of sending them to santad over XPC. Flows that
+        don't fit while the ring is full are dropped. Only supported by the protobuf log formats. A value of 0
+        disables the ring; other values are clamped between 1024 and 65536 and rounded up to a power of two.`,
+      type: "integer",
+      defaultValue: 0,
+    },
     {
       key: "EnableForkAndExitLogging",
       description: `This key is no longer supported. Use the new \`Telemetry\` key instead.`,
@@ -419,12 +528,22 @@ changes in the release notes of any future release that changes them.`,
           value: "syslog",
           description: "Sent to the macOS Unified Logging Systen",
         },
+        {
+          value: "unifiedlog",
+          description:
+            "Same as syslog, but exec, fork, exit, write, rename and delete events are sent as structured entries that are only formatted when read",
+        },
         { value: "file", description: "Sent to a file on disk" },
         {
           value: "protobuf",
           description:
             "(BETA) Sent to file on disk using a maildir-like format",
         },
+        {
+          value: "protobufcolumnar",
+          description:
+            "Same as protobuf, but each spool file groups events by type and stores each top-level field as a separate column",
+        },
         {
           value: "json",
           description:
@@ -449,7 +568,9 @@ changes in the release notes of any future release that changes them.`,
         save files according to a maildir-like format`,
       type: "string",
       defaultValue: "/var/db/santa/spool",
-      enableIf: (data) => data.EventLogType == "protobuf",
+      enableIf: (data) =>
+        data.EventLogType == "protobuf" ||
+        data.EventLogType == "protobufcolumnar",
     },
     {
       key: "SpoolDirectoryFileSizeThresholdKB",
@@ -458,7 +579,9 @@ changes in the release notes of any future release that changes them.`,
         exceeded (or \`SpoolDirectoryEventMaxFlushTimeSec\` is exceeded)`,
       type: "integer",
       defaultValue: 250,
-      enableIf: (data) => data.EventLogType == "protobuf",
+      enableIf: (data) =>
+        data.EventLogType == "protobuf" ||
+        data.EventLogType == "protobufcolumnar",
     },
     {
       key: "SpoolDirectorySizeThresholdMB",
@@ -466,7 +589,9 @@ changes in the release notes of any future release that changes them.`,
         limit of all files in the spool directory. Once the threshold is met, no more events will be saved`,
       type: "integer",
       defaultValue: 100,
-      enableIf: (data) => data.EventLogType == "protobuf",
+      enableIf: (data) =>
+        data.EventLogType == "protobuf" ||
+        data.EventLogType == "protobufcolumnar",
     },
     {
       key: "SpoolDirectoryEventMaxFlushTimeSec",
@@ -475,7 +600,105 @@ changes in the release notes of any future release that changes them.`,
         \`SpoolDirectoryFileSizeThresholdKB\` would be exceeded`,
       type: "integer",
       defaultValue: 15,
-      enableIf: (data) => data.EventLogType == "protobuf",
+      enableIf: (data) =>
+        data.EventLogType == "protobuf" ||
+        data.EventLogType == "protobufcolumnar",
+    },
+    {
+      key: "SpoolDirectoryShardCount",
+      description: `If \`EventLogType\` is set to \`protobuf\`, SpoolDirectoryShardCount defines the number of
+        independent writers events are spread across before being written to the spool directory. Each writer
+        batches and writes its own spool files, which can help hosts with a high event rate keep up. Events from
+        one thread always go through the same writer. \`SpoolDirectorySizeThresholdMB\` applies to all writers
+        combined. Values above 16 are clamped to 16.`,
+      type: "integer",
+      defaultValue: 1,
+      enableIf: (data) =>
+        data.EventLogType == "protobuf" ||
+        data.EventLogType == "protobufcolumnar",
+    },
+    {
+      key: "SpoolDirectoryZstdDictionaryPath",
+      description: `If \`EventLogType\` is set to \`protobufstreamzstd\`, SpoolDirectoryZstdDictionaryPath is the path
+        to a zstd dictionary (e.g. created with \`zstd --train\`) used to compress spool files. Dictionaries
+        significantly improve compression of telemetry, but spool files can then only be decompressed with the same
+        dictionary.`,
+      type: "string",
+    },
+    {
+      key: "SpoolDirectoryCompactionZstdLevel",
+      description: `If \`EventLogType\` is set to \`protobufstreamzstd\` and this is set, runs of small spool files are
+        merged and recompressed at this zstd level (e.g. 19) before they're exported, using
+        \`SpoolDirectoryZstdDictionaryPath\` if set. This reduces the number of files and bytes uploaded at the cost of
+        CPU time on the export path. Values above the highest zstd level are clamped to it.`,
+      type: "integer",
+      defaultValue: 0,
+      enableIf: (data) => data.EventLogType == "protobufstreamzstd",
+    },
+    {
+      key: "WriteDurability",
+      description: `How hard Santa works to get completed spool files and stored events onto stable storage. On APFS
+        only \`F_FULLFSYNC\` flushes the drive's own cache, and it's expensive, so only use \`batch\` or \`strict\`
+        where a power loss must not lose telemetry.`,
+      type: "string",
+      possibleValues: [
+        {
+          value: "none",
+          description:
+            "Spool files are left in the page cache and stored events use SQLite's default syncing. A power loss can lose recent telemetry and events",
+        },
+        {
+          value: "batch",
+          description:
+            "Each completed spool file is flushed with F_FULLFSYNC before it's moved into the spool directory, and each group of stored events is committed with F_FULLFSYNC",
+        },
+        {
+          value: "strict",
+          description:
+            "As batch, and the spool and event database directories are also flushed, so completed spool files and committed events survive a power loss",
+        },
+      ],
+      defaultValue: "none",
+    },
+    {
+      key: "EventLogQueueSize",
+      description: `If set, events are handed off to a queue of this many entries and serialized and written to the
+        event log on a dedicated thread, instead of on the thread that handled the event. This reduces the time spent
+        handling each event when logging is slow. Values are rounded up to a power of two. Values above 65536 are
+        clamped to 65536.`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "EventLogQueueDropWhenFull",
+      description: `If \`EventLogQueueSize\` is set and the queue is full, events are dropped when this key is true.
+        Otherwise they are serialized and written on the thread that handled the event.`,
+      type: "bool",
+      defaultValue: false,
+      enableIf: (data) => data.EventLogQueueSize > 0,
+    },
+    {
+      key: "ExecArgsMaxBytes",
+      description: `If \`EventLogType\` is set to one of the protobuf types or \`json\`, this limits the number of bytes
+        of arguments logged for each execution. The argument crossing the limit is cut short, the rest are dropped
+        and the event is marked as truncated. 0 means no limit.`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "ExecEnvsMaxBytes",
+      description: `The same as \`ExecArgsMaxBytes\`, for the environment variables logged for each execution.`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "HashTruncatedExecEnvs",
+      description: `If \`ExecEnvsMaxBytes\` is set and an execution's environment exceeds it, a hash of the whole
+        environment is logged instead of the environment variables that fit. Executions with identical environments
+        have identical hashes.`,
+      type: "bool",
+      defaultValue: false,
+      enableIf: (data) => data.ExecEnvsMaxBytes > 0,
     },
     {
       key: "EnableMachineIDDecoration",
@@ -522,6 +745,30 @@ changes in the release notes of any future release that changes them.`,
       repeated: true,
       versionAdded: "2026.5",
     },
+    {
+      key: "TelemetryExportStreamingDelaySec",
+      description: `When set, telemetry files are exported this many seconds after a spool file is closed, instead
+        of waiting for the next export interval. Files closed in the meantime are exported in the same batch, and
+        the export interval still applies as a fallback. A value of 0 disables streaming export; values above 300
+        are clamped to 300.`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "TelemetryExportMaxConcurrentBatches",
+      description: `The number of telemetry batches that may be exported at the same time when there is a backlog.
+        Batches are still exported oldest-first. Only one batch at a time is exported while on battery power or on
+        an expensive or constrained network. Values above 8 are clamped to 8.`,
+      type: "integer",
+      defaultValue: 1,
+    },
+    {
+      key: "TelemetryExportMaxKBPerSec",
+      description: `Limits the average rate at which telemetry is exported, in kilobytes per second. Exports are
+        paused between batches to stay under the limit. A value of 0 means no limit.`,
+      type: "integer",
+      defaultValue: 0,
+    },
   ],
   faa: [
     {
@@ -899,6 +1146,11 @@ mount flags that are a superset of \`RemovableMediaRemountFlags\` or \`Encrypted
           description:
             "A format consumable by Google's internal Monarch tooling.",
         },
+        {
+          value: "prometheus",
+          description:
+            "The Prometheus text exposition format, which can be read by the node-exporter textfile collector when written to a file:// MetricURL.",
+        },
       ],
     },
     {
@@ -930,6 +1182,22 @@ mount flags that are a superset of \`RemovableMediaRemountFlags\` or \`Encrypted
         Alternatively if a value is set for an existing key then the new value will override the old.`,
       enableIf: (data) => data.MetricFormat !== "",
     },
+    {
+      key: "EnableMetricDeltaExport",
+      description: `If true, metrics exported to an HTTP(S) MetricURL only include values that changed since the
+        last successful export. All metrics are still exported at least once an hour.`,
+      type: "bool",
+      defaultValue: false,
+      enableIf: (data) => data.MetricFormat !== "",
+    },
+    {
+      key: "EnableMetricExportCompression",
+      description: `If true, metrics exported to an HTTP(S) MetricURL are gzip compressed and sent with a
+        \`Content-Encoding: gzip\` header.`,
+      type: "bool",
+      defaultValue: false,
+      enableIf: (data) => data.MetricFormat !== "",
+    },
   ],
   rules: [
     {
@@ -1043,6 +1311,13 @@ thousand static rules working correctly, but we don't recommend using StaticRule
       type: "bool",
       defaultValue: false,
     },
+    {
+      key: "SyncEventUploadConcurrency",
+      description: `The number of event upload requests a sync may have in flight at once. Each batch of events
+        is removed from the database once the server accepts it. Between 1 and 8`,
+      type: "integer",
+      defaultValue: 1,
+    },
     {
       key: "ClientAuthCertificateFile",
       description: `If set, this contains the location of a PKCS#12 certificate to be used for sync authentication`,
@@ -1148,10 +1423,18 @@ thousand static rules working correctly, but we don't recommend using StaticRule
       possibleValues: [
         { value: "deflate" },
         { value: "gzip" },
+        { value: "zstd" },
         { value: "none" },
       ],
       defaultValue: "deflate",
     },
+    {
+      key: "SyncClientContentEncodingDictionary",
+      description: `Path to a zstd dictionary, as produced by \`zstd --train\`, used to compress requests when
+        SyncClientContentEncoding is zstd. The sync server must decompress requests with the same dictionary`,
+      type: "string",
+      enableIf: (data) => data.SyncClientContentEncoding === "zstd",
+    },
     {
       key: "SyncExtraHeaders",
       description: `Dictionary of additional headers to include in all requests made to the sync server.